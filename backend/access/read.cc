@@ -16,13 +16,37 @@
 
 #include "backend/access/read.h"
 
+#include <cstdint>
 #include <ostream>
+#include <vector>
+
+#include "zetasql/public/value.h"
 
 namespace google {
 namespace spanner {
 namespace emulator {
 namespace backend {
 
+void RowBatch::Reset(int num_columns) {
+  num_rows = 0;
+  columns.resize(num_columns);
+  for (std::vector<zetasql::Value>& column : columns) {
+    column.clear();
+  }
+}
+
+bool RowCursor::NextBatch(int64_t max_rows, RowBatch* batch) {
+  const int num_columns = NumColumns();
+  batch->Reset(num_columns);
+  while (batch->num_rows < max_rows && Next()) {
+    for (int i = 0; i < num_columns; ++i) {
+      batch->columns[i].push_back(ColumnValue(i));
+    }
+    ++batch->num_rows;
+  }
+  return batch->num_rows > 0;
+}
+
 std::ostream& operator<<(std::ostream& out, const ReadArg& arg) {
   out << "Table  : '" << arg.table << "'\n";
   if (!arg.change_stream_for_partition_table.empty()) {
@@ -40,6 +64,12 @@ std::ostream& operator<<(std::ostream& out, const ReadArg& arg) {
     out << "'" << arg.columns[i] << "'";
   }
   out << "]\n";
+  if (arg.limit > 0) {
+    out << "Limit  : " << arg.limit << "\n";
+  }
+  if (arg.reverse) {
+    out << "Reverse: true\n";
+  }
 
   return out;
 }
@@ -17,6 +17,8 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACCESS_READ_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACCESS_READ_H_
 
+#include <cstdint>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -56,11 +58,34 @@ struct ReadArg {
 
   // Set of columns to read.
   std::vector<std::string> columns;
+
+  // If positive, the caller reads at most this many rows, so the reader may
+  // stop reading the key set once it has returned them. Readers which ignore
+  // the limit return the same rows, so callers must still apply it.
+  int64_t limit = 0;
+
+  // If true, rows are returned in reverse key order, and a limit bounds the
+  // rows read from the end of the key set rather than its start.
+  bool reverse = false;
 };
 
 // Streams a debug string representation of ReadArg to out.
 std::ostream& operator<<(std::ostream& out, const ReadArg& arg);
 
+// RowBatch holds a batch of rows read from a RowCursor, laid out column by
+// column.
+struct RowBatch {
+  // Empties the batch for rows of num_columns columns. The columns keep their
+  // capacity, so that a batch reused across reads does not reallocate.
+  void Reset(int num_columns);
+
+  // The number of rows in the batch.
+  int64_t num_rows = 0;
+
+  // columns[i][r] is the value of column i in row r of the batch.
+  std::vector<std::vector<zetasql::Value>> columns;
+};
+
 // RowCursor is an abstract interface for iterating over rows.
 //
 // All rows will have the same number of columns, column types, and column
@@ -76,6 +101,17 @@ std::ostream& operator<<(std::ostream& out, const ReadArg& arg);
 //       }
 //     }
 //     ZETASQL_RETURN_IF_ERROR(cursor->Status());
+//
+// Consumers which process many rows in a loop may read them in batches:
+//     RowBatch batch;
+//     while (cursor->NextBatch(kMaxRowsPerBatch, &batch)) {
+//       for (int64_t r = 0; r < batch.num_rows; ++r) {
+//         for (int i = 0; i < cursor->NumColumns(); ++i) {
+//           const zetasql::Value& value = batch.columns[i][r];
+//         }
+//       }
+//     }
+//     ZETASQL_RETURN_IF_ERROR(cursor->Status());
 class RowCursor {
  public:
   virtual ~RowCursor() {}
@@ -103,6 +139,16 @@ class RowCursor {
   // Returns the type of the specified column. Types are owned by the database's
   // TypeFactory and not by the RowCursor.
   virtual const zetasql::Type* ColumnType(int i) const = 0;
+
+  // Reads up to max_rows rows following the current row into batch, replacing
+  // its contents, and returns false if there were none. As with Next(), use
+  // Status() to tell an exhausted cursor from a failed one. The rows read are
+  // consumed, so ColumnValue() is not valid again until Next() returns true.
+  //
+  // The default implementation reads the rows one at a time through Next() and
+  // ColumnValue(). Cursors which can produce many rows more cheaply at once
+  // override it.
+  virtual bool NextBatch(int64_t max_rows, RowBatch* batch);
 };
 
 // RowReader defines an abstract interface for reading rows from a database.
@@ -117,6 +163,18 @@ class RowReader {
   // Reads rows from a database based on the provided read_arg.
   virtual absl::Status Read(const ReadArg& read_arg,
                             std::unique_ptr<RowCursor>* cursor) = 0;
+
+  // Returns an error once the request which the rows are read for has been
+  // abandoned, so that long running scans over the cursors returned by Read
+  // can stop early. Readers which are not tied to a request never fail it.
+  virtual absl::Status CheckNotCancelled() { return absl::OkStatus(); }
+
+  // Returns the number of rows of the table which a read of all of it would
+  // return, if the reader can count them without reading them, or nullopt
+  // otherwise.
+  virtual std::optional<int64_t> CountRows(const std::string& table_name) {
+    return std::nullopt;
+  }
 };
 
 }  // namespace backend
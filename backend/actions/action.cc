@@ -19,8 +19,10 @@
 #include <variant>
 
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "backend/actions/ops.h"
 #include "absl/status/status.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
@@ -83,6 +85,14 @@ absl::Status Effector::Effect(const ActionContext* ctx,
                     op);
 }
 
+absl::Status Effector::EffectBatch(
+    const ActionContext* ctx, absl::Span<const WriteOp* const> ops) const {
+  for (const WriteOp* op : ops) {
+    ZETASQL_RETURN_IF_ERROR(Effect(ctx, *op));
+  }
+  return absl::OkStatus();
+}
+
 absl::Status Effector::Effect(const ActionContext* ctx,
                               const InsertOp& op) const {
   return absl::OkStatus();
@@ -106,6 +116,14 @@ absl::Status Verifier::Verify(const ActionContext* ctx,
                     op);
 }
 
+absl::Status Verifier::VerifyBatch(
+    const ActionContext* ctx, absl::Span<const WriteOp* const> ops) const {
+  for (const WriteOp* op : ops) {
+    ZETASQL_RETURN_IF_ERROR(Verify(ctx, *op));
+  }
+  return absl::OkStatus();
+}
+
 absl::Status Verifier::Verify(const ActionContext* ctx,
                               const InsertOp& op) const {
   return absl::OkStatus();
@@ -20,6 +20,7 @@
 #include <string>
 
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
 #include "backend/schema/catalog/table.h"
@@ -136,6 +137,14 @@ class Effector {
   // action context.
   absl::Status Effect(const ActionContext* ctx, const WriteOp& op) const;
 
+  // Creates additional WriteOp(s) for the given WriteOps, which all apply to
+  // the table of the effector, at once. This is used for effectors registered
+  // to run after the WriteOps have been buffered, which can read the store for
+  // many operations more cheaply at once than one at a time; by default each
+  // operation is effected in turn.
+  virtual absl::Status EffectBatch(const ActionContext* ctx,
+                                   absl::Span<const WriteOp* const> ops) const;
+
  private:
   virtual absl::Status Effect(const ActionContext* ctx,
                               const InsertOp& op) const;
@@ -155,6 +164,13 @@ class Verifier {
   // context.
   absl::Status Verify(const ActionContext* ctx, const WriteOp& op) const;
 
+  // Executes the verification on the given WriteOps of a statement, which all
+  // apply to the table of the verifier, in order. Verifiers which can check
+  // many operations more cheaply at once than one at a time override this;
+  // by default each operation is verified in turn.
+  virtual absl::Status VerifyBatch(const ActionContext* ctx,
+                                   absl::Span<const WriteOp* const> ops) const;
+
  private:
   virtual absl::Status Verify(const ActionContext* ctx,
                               const InsertOp& op) const;
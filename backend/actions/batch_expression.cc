@@ -0,0 +1,94 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/actions/batch_expression.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+absl::StatusOr<BatchExpression> BatchExpression::Create(
+    std::shared_ptr<zetasql::PreparedExpression> expr) {
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<std::string> referenced_columns,
+                   expr->GetReferencedColumns());
+  return BatchExpression(std::move(expr), std::move(referenced_columns));
+}
+
+absl::Status BatchExpression::Evaluate(
+    absl::Span<const std::string> column_names,
+    absl::Span<const std::vector<zetasql::Value>> column_values,
+    int num_rows, std::vector<zetasql::Value>* values) const {
+  ZETASQL_RET_CHECK_EQ(column_names.size(), column_values.size());
+  values->reserve(values->size() + num_rows);
+
+  // Find the column bound to each referenced column. Column names are case
+  // insensitive.
+  std::vector<const std::vector<zetasql::Value>*> bound_columns;
+  bound_columns.reserve(referenced_columns_.size());
+  for (const std::string& referenced_column : referenced_columns_) {
+    const std::vector<zetasql::Value>* bound_column = nullptr;
+    for (int i = column_names.size() - 1; i >= 0; --i) {
+      if (absl::EqualsIgnoreCase(column_names[i], referenced_column)) {
+        bound_column = &column_values[i];
+        break;
+      }
+    }
+    if (bound_column == nullptr) {
+      // Evaluate the rows by name so that the evaluator reports the missing
+      // column.
+      for (int row = 0; row < num_rows; ++row) {
+        zetasql::ParameterValueMap row_values;
+        for (int i = 0; i < column_names.size(); ++i) {
+          row_values[column_names[i]] = column_values[i][row];
+        }
+        ZETASQL_ASSIGN_OR_RETURN(values->emplace_back(), Evaluate(row_values));
+      }
+      return absl::OkStatus();
+    }
+    ZETASQL_RET_CHECK_GE(bound_column->size(), num_rows);
+    bound_columns.push_back(bound_column);
+  }
+
+  zetasql::ParameterValueList row_values(bound_columns.size());
+  for (int row = 0; row < num_rows; ++row) {
+    for (int i = 0; i < bound_columns.size(); ++i) {
+      row_values[i] = (*bound_columns[i])[row];
+    }
+    ZETASQL_ASSIGN_OR_RETURN(
+        values->emplace_back(),
+        expr_->ExecuteAfterPrepareWithOrderedParams(row_values, {}));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,85 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_BATCH_EXPRESSION_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_BATCH_EXPRESSION_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// BatchExpression evaluates a prepared expression over a batch of rows held in
+// column-major order. The columns referenced by the expression are looked up
+// once per batch and bound by position, instead of building a
+// ParameterValueMap keyed by column name for every row.
+class BatchExpression {
+ public:
+  // The number of rows evaluated at a time by callers which evaluate an
+  // expression over all rows of a table.
+  static constexpr int kScanBatchSize = 256;
+
+  // Wraps expr, which must have been prepared with expression columns.
+  static absl::StatusOr<BatchExpression> Create(
+      std::shared_ptr<zetasql::PreparedExpression> expr);
+
+  zetasql::PreparedExpression* expression() const { return expr_.get(); }
+
+  // Evaluates the expression for a single row.
+  absl::StatusOr<zetasql::Value> Evaluate(
+      const zetasql::ParameterValueMap& column_values) const {
+    return expr_->Execute(column_values);
+  }
+
+  // Evaluates the expression for each of the num_rows rows of a batch in
+  // which column_values[i][j] is the value of the column named
+  // column_names[i] in row j, and appends the results to values. If a name
+  // appears more than once, its last column is used.
+  absl::Status Evaluate(
+      absl::Span<const std::string> column_names,
+      absl::Span<const std::vector<zetasql::Value>> column_values,
+      int num_rows, std::vector<zetasql::Value>* values) const;
+
+ private:
+  BatchExpression(std::shared_ptr<zetasql::PreparedExpression> expr,
+                  std::vector<std::string> referenced_columns)
+      : expr_(std::move(expr)),
+        referenced_columns_(std::move(referenced_columns)) {}
+
+  std::shared_ptr<zetasql::PreparedExpression> expr_;
+
+  // The names of the columns referenced by the expression, in the order in
+  // which it binds them.
+  std::vector<std::string> referenced_columns_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_BATCH_EXPRESSION_H_
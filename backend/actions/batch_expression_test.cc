@@ -0,0 +1,93 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/actions/batch_expression.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "backend/query/analyzer_options.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::NullInt64;
+using ::testing::ElementsAre;
+
+absl::StatusOr<BatchExpression> PrepareBatchExpression(
+    const std::string& sql) {
+  auto expr = std::make_shared<zetasql::PreparedExpression>(sql);
+  zetasql::AnalyzerOptions options = MakeGoogleSqlAnalyzerOptions();
+  ZETASQL_RETURN_IF_ERROR(options.AddExpressionColumn("a", zetasql::types::Int64Type()));
+  ZETASQL_RETURN_IF_ERROR(options.AddExpressionColumn("b", zetasql::types::Int64Type()));
+  ZETASQL_RETURN_IF_ERROR(expr->Prepare(options));
+  return BatchExpression::Create(std::move(expr));
+}
+
+TEST(BatchExpressionTest, EvaluatesColumnMajorRows) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(BatchExpression expr, PrepareBatchExpression("a - b"));
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(expr.Evaluate({"B", "c", "A"},
+                          {{Int64(1), Int64(2)},
+                           {Int64(0), Int64(0)},
+                           {Int64(10), NullInt64()}},
+                          /*num_rows=*/2, &values));
+  EXPECT_THAT(values, ElementsAre(Int64(9), NullInt64()));
+}
+
+TEST(BatchExpressionTest, UsesLastColumnWithName) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(BatchExpression expr, PrepareBatchExpression("a + 1"));
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(expr.Evaluate({"a", "a"}, {{Int64(1)}, {Int64(2)}},
+                          /*num_rows=*/1, &values));
+  EXPECT_THAT(values, ElementsAre(Int64(3)));
+}
+
+TEST(BatchExpressionTest, MatchesEvaluationByName) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(BatchExpression expr, PrepareBatchExpression("a * b"));
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(expr.Evaluate({"a", "b"}, {{Int64(3)}, {Int64(4)}},
+                          /*num_rows=*/1, &values));
+  EXPECT_THAT(expr.Evaluate({{"a", Int64(3)}, {"b", Int64(4)}}),
+              zetasql_base::testing::IsOkAndHolds(values[0]));
+}
+
+TEST(BatchExpressionTest, ReportsMissingColumn) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(BatchExpression expr, PrepareBatchExpression("a + b"));
+  std::vector<zetasql::Value> values;
+  EXPECT_FALSE(
+      expr.Evaluate({"a"}, {{Int64(1)}}, /*num_rows=*/1, &values).ok());
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
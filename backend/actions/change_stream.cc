@@ -18,7 +18,9 @@
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "zetasql/public/value.h"
@@ -40,11 +42,16 @@ namespace backend {
 
 namespace {
 
-// TODO: Since the partitions don't change within a transaction,
-// reading partition token only once for each transaction after GetBufferedOps
-// in the transaction store.
+// Returns the partition the records of the transaction are written to. The
+// partition table is only read for the first op of each change stream in a
+// transaction, since partitions do not change within a transaction.
 absl::StatusOr<zetasql::Value> GetPartitionToken(
     const ActionContext* ctx, const ChangeStream* change_stream) {
+  std::optional<zetasql::Value> cached_token =
+      ctx->change_stream_effects()->GetPartitionToken(change_stream);
+  if (cached_token.has_value()) {
+    return *std::move(cached_token);
+  }
   // Get partition_token to make the primary key for change stream data
   // table
   std::vector<const Column*> read_columns = {
@@ -65,8 +72,12 @@ absl::StatusOr<zetasql::Value> GetPartitionToken(
     }
   }
   ZETASQL_RET_CHECK(!active_partition_tokens.empty());
-  std::sort(active_partition_tokens.begin(), active_partition_tokens.end());
-  return zetasql::Value::String(active_partition_tokens[0]);
+  zetasql::Value partition_token = zetasql::Value::String(
+      *std::min_element(active_partition_tokens.begin(),
+                        active_partition_tokens.end()));
+  ctx->change_stream_effects()->SetPartitionToken(change_stream,
+                                                  partition_token);
+  return partition_token;
 }
 }  // namespace
 
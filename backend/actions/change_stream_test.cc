@@ -551,6 +551,76 @@ TEST_F(ChangeStreamTest, AddWriteOpForDifferentChangeStreams) {
   ASSERT_EQ(count_cs_test_table2, 1);
 }
 
+TEST_F(ChangeStreamTest, DeleteRecordHasSameJsonAsParsedFromText) {
+  std::vector<const Column*> columns = {
+      change_stream_->change_stream_partition_table()
+          ->FindKeyColumn("partition_token")
+          ->column(),
+      change_stream_->change_stream_partition_table()->FindColumn("end_time")};
+  const std::vector<zetasql::Value> values = {
+      zetasql::Value::String("11111"), zetasql::Value::NullTimestamp()};
+  ZETASQL_EXPECT_OK(store()->Insert(change_stream_->change_stream_partition_table(),
+                            Key({String("11111")}), columns, values));
+  ZETASQL_EXPECT_OK(effector_->Effect(ctx(), Delete(table_, Key({Int64(1)}))));
+  ctx()->change_stream_effects()->BuildMutation();
+
+  ASSERT_EQ(change_stream_effects_buffer()->GetWriteOps().size(), 1);
+  WriteOp op = change_stream_effects_buffer()->GetWriteOps()[0];
+  auto* operation = std::get_if<InsertOp>(&op);
+  ASSERT_NE(operation, nullptr);
+  // The column types and mods are built as JSON values without a text round
+  // trip, and must serialize like the text they used to be parsed from.
+  const zetasql::Value& col_types = operation->values[6];
+  ASSERT_EQ(col_types.num_elements(), 1);
+  EXPECT_EQ(col_types.element(0).json_value().ToString(),
+            R"({"is_primary_key":true,"name":"int64_col",)"
+            R"("ordinal_position":1,"type":"{\"code\":\"INT64\"}"})");
+  const zetasql::Value& mods = operation->values[7];
+  ASSERT_EQ(mods.num_elements(), 1);
+  EXPECT_EQ(mods.element(0).json_value().ToString(),
+            R"({"keys":"{\"int64_col\":\"1\"}","new_values":"{}",)"
+            R"("old_values":"{}"})");
+  EXPECT_EQ(operation->values[8], zetasql::Value(String("DELETE")));
+}
+
+TEST_F(ChangeStreamTest, OnlyLastRecordOfMultiStatementTransactionIsLast) {
+  std::vector<const Column*> columns = {
+      change_stream_->change_stream_partition_table()
+          ->FindKeyColumn("partition_token")
+          ->column(),
+      change_stream_->change_stream_partition_table()->FindColumn("end_time")};
+  const std::vector<zetasql::Value> values = {
+      zetasql::Value::String("11111"), zetasql::Value::NullTimestamp()};
+  ZETASQL_EXPECT_OK(store()->Insert(change_stream_->change_stream_partition_table(),
+                            Key({String("11111")}), columns, values));
+
+  // Each statement of the transaction ends its records, so the inserts of the
+  // same shape are written as one record per statement.
+  for (int64_t k = 1; k <= 3; ++k) {
+    ZETASQL_EXPECT_OK(effector_->Effect(
+        ctx(), Insert(table_, Key({Int64(k)}), base_columns_,
+                      {Int64(k), String("value"), String("value2")})));
+    ctx()->change_stream_effects()->EndStatement();
+  }
+  ctx()->change_stream_effects()->BuildMutation();
+
+  const std::vector<std::string> record_sequences = {"00000000", "00000001",
+                                                    "00000002"};
+  std::vector<WriteOp> ops = change_stream_effects_buffer()->GetWriteOps();
+  ASSERT_EQ(ops.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    auto* operation = std::get_if<InsertOp>(&ops[i]);
+    ASSERT_NE(operation, nullptr);
+    // Verify record_sequence
+    EXPECT_EQ(operation->values[3],
+              zetasql::Value(String(record_sequences[i])));
+    // Verify is_last_record_in_transaction_in_partition
+    EXPECT_EQ(operation->values[4], zetasql::Value(Bool(i == 2)));
+    // Verify number_of_records_in_transaction
+    EXPECT_EQ(operation->values[10], zetasql::Value(Int64(3)));
+  }
+}
+
 TEST_F(ChangeStreamTest,
        InsertUpdateDeleteUntrackedColumnsForChangeStreamTrackingKeyColsOnly) {
   // Populate ChangeStream_TestTable3_partition_table with the initial partition
@@ -17,6 +17,7 @@
 #include "backend/actions/check_constraint.h"
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -24,8 +25,9 @@
 #include "zetasql/public/value.h"
 #include "absl/status/status.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
+#include "backend/actions/batch_expression.h"
 #include "backend/actions/ops.h"
-#include "backend/query/analyzer_options.h"
 #include "backend/schema/catalog/check_constraint.h"
 #include "backend/schema/catalog/table.h"
 #include "common/errors.h"
@@ -38,23 +40,22 @@ namespace backend {
 
 absl::Status CheckConstraintVerifier::PrepareExpression(
     const CheckConstraint* check_constraint,
-    zetasql::Catalog* function_catalog) {
+    zetasql::Catalog* function_catalog,
+    PreparedExpressionCache* expression_cache) {
   // Prepare an execuatable expression given a check constraint expression.
-  auto expr = std::make_unique<zetasql::PreparedExpression>(
-      check_constraint->expression());
-  zetasql::AnalyzerOptions options = MakeGoogleSqlAnalyzerOptions();
-  for (const Column* dep : check_constraint->dependent_columns()) {
-    ZETASQL_RETURN_IF_ERROR(options.AddExpressionColumn(dep->Name(), dep->GetType()));
-  }
-  ZETASQL_RETURN_IF_ERROR(expr->Prepare(options, function_catalog));
+  ZETASQL_ASSIGN_OR_RETURN(
+      auto expr,
+      expression_cache->GetOrPrepare(check_constraint->expression(),
+                                     check_constraint->dependent_columns(),
+                                     function_catalog));
   ZETASQL_RET_CHECK(expr->output_type()->Equals(zetasql::types::BoolType()));
-  expression_ = std::move(expr);
+  ZETASQL_ASSIGN_OR_RETURN(expression_, BatchExpression::Create(std::move(expr)));
   return absl::OkStatus();
 }
 
 absl::Status CheckConstraintVerifier::VerifyRow(
     const zetasql::ParameterValueMap& column_values, const Key& key) const {
-  ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value, expression_->Execute(column_values));
+  ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value, expression_->Evaluate(column_values));
   // The value could be True, False, or Null. The check constraint is violated
   // if the value is False.
   if (value.Equals(zetasql::values::False())) {
@@ -65,11 +66,34 @@ absl::Status CheckConstraintVerifier::VerifyRow(
   return absl::OkStatus();
 }
 
+absl::Status CheckConstraintVerifier::VerifyRows(
+    absl::Span<const std::string> column_names,
+    absl::Span<const std::vector<zetasql::Value>> column_values,
+    absl::Span<const Key> keys) const {
+  // Rows are reported in order, so a violation is returned rather than an
+  // error evaluating a later row.
+  std::vector<zetasql::Value> values;
+  absl::Status status =
+      expression_->Evaluate(column_names, column_values, keys.size(), &values);
+  for (int i = 0; i < values.size(); ++i) {
+    if (values[i].Equals(zetasql::values::False())) {
+      return error::CheckConstraintViolated(check_constraint_->Name(),
+                                            check_constraint_->table()->Name(),
+                                            keys[i].DebugString());
+    }
+  }
+  return status;
+}
+
 CheckConstraintVerifier::CheckConstraintVerifier(
     const CheckConstraint* check_constraint,
-    zetasql::Catalog* function_catalog)
-    : check_constraint_(check_constraint) {
-  absl::Status s = PrepareExpression(check_constraint, function_catalog);
+    zetasql::Catalog* function_catalog,
+    PreparedExpressionCache* expression_cache)
+    : check_constraint_(check_constraint),
+      dependent_columns_(check_constraint->dependent_columns().begin(),
+                         check_constraint->dependent_columns().end()) {
+  absl::Status s =
+      PrepareExpression(check_constraint, function_catalog, expression_cache);
   ZETASQL_DCHECK(s.ok()) << "Failed to initialize CheckConstraintVerifier: " << s;
 }
 
@@ -107,6 +131,9 @@ absl::Status CheckConstraintVerifier::Verify(const ActionContext* ctx,
 
 absl::Status CheckConstraintVerifier::Verify(const ActionContext* ctx,
                                              const UpdateOp& op) const {
+  if (!UpdatesAnyColumn(op, dependent_columns_)) {
+    return absl::OkStatus();
+  }
   return VerifyInsertUpdateOp(ctx, op.table, op.columns, op.values, op.key);
 }
 
@@ -18,9 +18,16 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_CHECK_CONSTRAINT_H_
 
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "zetasql/public/evaluator.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
 #include "backend/actions/action.h"
+#include "backend/actions/batch_expression.h"
+#include "backend/actions/prepared_expression_cache.h"
 
 namespace google {
 namespace spanner {
@@ -29,21 +36,33 @@ namespace backend {
 
 // CheckConstraintVerifier validates if the inserted/updated rows constaint
 // values which will violate the check constraints that reference the
-// corresponding columns.
+// corresponding columns. Updates which write none of the columns the check
+// constraint depends on are not verified again.
 class CheckConstraintVerifier : public Verifier {
  public:
   explicit CheckConstraintVerifier(const CheckConstraint* check_constraint,
-                                   zetasql::Catalog* function_catalog);
+                                   zetasql::Catalog* function_catalog,
+                                   PreparedExpressionCache* expression_cache);
   // Verifies that column values of the row with a given key satisfy the check
   // constraint.
   absl::Status VerifyRow(const zetasql::ParameterValueMap& column_values,
                          const Key& key) const;
 
+  // Verifies that each row of a batch satisfies the check constraint, where
+  // column_values[i][j] is the value of the column named column_names[i] in
+  // the row with key keys[j].
+  absl::Status VerifyRows(
+      absl::Span<const std::string> column_names,
+      absl::Span<const std::vector<zetasql::Value>> column_values,
+      absl::Span<const Key> keys) const;
+
  private:
   // Initializes an executable expression (i.e. expression_) given the check
-  // constraint expression.
+  // constraint expression, reusing it from expression_cache if it has been
+  // prepared before.
   absl::Status PrepareExpression(const CheckConstraint* check_constraint,
-                                 zetasql::Catalog* function_catalog);
+                                 zetasql::Catalog* function_catalog,
+                                 PreparedExpressionCache* expression_cache);
   // Computes the vaule of the check constraint expression.
   absl::Status EvaluateCheckConstraintExpression(
       const zetasql::ParameterValueMap& row_column_values) const;
@@ -59,7 +78,10 @@ class CheckConstraintVerifier : public Verifier {
                       const UpdateOp& op) const override;
 
   const CheckConstraint* check_constraint_;
-  std::unique_ptr<zetasql::PreparedExpression> expression_;
+  std::optional<BatchExpression> expression_;
+
+  // The columns the check constraint expression depends on.
+  absl::flat_hash_set<const Column*> dependent_columns_;
 };
 
 }  // namespace backend
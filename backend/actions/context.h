@@ -17,6 +17,7 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_CONTEXT_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_CONTEXT_H_
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -85,6 +86,25 @@ class ChangeStreamEffectsBuffer {
   virtual void BuildMutation() = 0;
 
   virtual std::vector<WriteOp> GetWriteOps() = 0;
+
+  // Called after the ops of each statement (or call to Write) have been
+  // processed. Mods of later statements do not join the records of earlier
+  // ones.
+  virtual void EndStatement() {}
+
+  // Discards everything buffered so far, e.g. when a transaction is reset
+  // after an abort.
+  virtual void Reset() {}
+
+  // Partitions of a change stream do not change within a transaction, so the
+  // partition its records are written to is looked up once per transaction
+  // and remembered here. Returns nullopt if none has been recorded yet.
+  virtual std::optional<zetasql::Value> GetPartitionToken(
+      const ChangeStream* change_stream) const {
+    return std::nullopt;
+  }
+  virtual void SetPartitionToken(const ChangeStream* change_stream,
+                                 const zetasql::Value& partition_token) {}
 };
 
 // ReadOnlyStore abstracts the storage environment in which an action lives.
@@ -16,13 +16,19 @@
 
 #include "backend/actions/foreign_key.h"
 
+#include <algorithm>
+#include <numeric>
+#include <variant>
+#include <vector>
+
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "backend/actions/action.h"
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
-#include "backend/datamodel/key_range.h"
-#include "backend/storage/iterator.h"
+#include "backend/actions/prefix_scan.h"
+#include "backend/datamodel/key.h"
 #include "common/errors.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
@@ -32,63 +38,175 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+// Returns the first num_columns columns of key as a key of table, whose
+// leading key columns are the columns of a foreign key.
+Key ForeignKeyPrefix(const Key& key, int num_columns, const Table* table) {
+  Key prefix;
+  for (int i = 0; i < num_columns; ++i) {
+    prefix.AddColumn(key.ColumnValue(i),
+                     table->primary_key()[i]->is_descending());
+  }
+  return prefix;
+}
+
+// Returns whether table has a row with each of the given key prefixes.
+absl::StatusOr<std::vector<bool>> PrefixesExist(
+    const ReadOnlyStore* store, const Table* table,
+    const std::vector<Key>& prefixes) {
+  if (prefixes.size() == 1) {
+    ZETASQL_ASSIGN_OR_RETURN(bool exists, store->PrefixExists(table, prefixes[0]));
+    return std::vector<bool>{exists};
+  }
+  std::vector<bool> exists(prefixes.size(), false);
+  if (prefixes.empty()) {
+    return exists;
+  }
+  std::vector<int> order(prefixes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](int a, int b) { return prefixes[a] < prefixes[b]; });
+
+  // Scan the distinct prefixes, remembering the position of each prefix in
+  // the sorted order of its first copy.
+  std::vector<Key> distinct_prefixes;
+  std::vector<int> first_copy;
+  for (int i = 0; i < static_cast<int>(order.size()); ++i) {
+    if (distinct_prefixes.empty() ||
+        distinct_prefixes.back() < prefixes[order[i]]) {
+      distinct_prefixes.push_back(prefixes[order[i]]);
+      first_copy.push_back(i);
+    }
+  }
+  first_copy.push_back(order.size());
+  const int num_distinct = distinct_prefixes.size();
+  std::vector<bool> distinct_exists(num_distinct, false);
+  ZETASQL_RETURN_IF_ERROR(ForEachRowWithPrefix(
+      store, table, distinct_prefixes, [&](int i, const Key&) {
+        distinct_exists[i] = true;
+        return absl::OkStatus();
+      }));
+  for (int i = 0; i < num_distinct; ++i) {
+    for (int j = first_copy[i]; j < first_copy[i + 1]; ++j) {
+      exists[order[j]] = distinct_exists[i];
+    }
+  }
+  return exists;
+}
+
+}  // namespace
+
 ForeignKeyReferencingVerifier::ForeignKeyReferencingVerifier(
     const ForeignKey* foreign_key)
     : foreign_key_(foreign_key) {}
 
-absl::Status ForeignKeyReferencingVerifier::Verify(const ActionContext* ctx,
-                                                   const InsertOp& op) const {
-  // Check that the corresponding row exists in the referenced index. Exclude
+absl::Status ForeignKeyReferencingVerifier::VerifyKeys(
+    const ActionContext* ctx, const std::vector<Key>& keys) const {
+  // Check that the corresponding rows exist in the referenced index. Exclude
   // any extra columns from the primary key that are not used by the foreign
   // key.
-  Key key(std::vector<zetasql::Value>(
-      op.key.column_values().begin(),
-      op.key.column_values().begin() +
-          foreign_key_->referencing_columns().size()));
+  const int num_columns = foreign_key_->referencing_columns().size();
+  const Table* referenced_data_table = foreign_key_->referenced_data_table();
+  std::vector<Key> prefixes;
+  prefixes.reserve(keys.size());
+  for (const Key& key : keys) {
+    prefixes.push_back(
+        ForeignKeyPrefix(key, num_columns, referenced_data_table));
+  }
   ZETASQL_ASSIGN_OR_RETURN(
-      bool exists,
-      ctx->store()->PrefixExists(foreign_key_->referenced_data_table(), key));
-  if (!exists) {
-    return error::ForeignKeyReferencedKeyNotFound(
-        foreign_key_->Name(), foreign_key_->referencing_table()->Name(),
-        foreign_key_->referenced_table()->Name(), key.DebugString());
+      std::vector<bool> exists,
+      PrefixesExist(ctx->store(), referenced_data_table, prefixes));
+  for (int i = 0; i < prefixes.size(); ++i) {
+    if (!exists[i]) {
+      return error::ForeignKeyReferencedKeyNotFound(
+          foreign_key_->Name(), foreign_key_->referencing_table()->Name(),
+          foreign_key_->referenced_table()->Name(),
+          prefixes[i].DebugString());
+    }
   }
   return absl::OkStatus();
 }
 
+absl::Status ForeignKeyReferencingVerifier::Verify(const ActionContext* ctx,
+                                                   const InsertOp& op) const {
+  return VerifyKeys(ctx, {op.key});
+}
+
+absl::Status ForeignKeyReferencingVerifier::VerifyBatch(
+    const ActionContext* ctx, absl::Span<const WriteOp* const> ops) const {
+  std::vector<Key> keys;
+  for (const WriteOp* op : ops) {
+    if (const auto* insert_op = std::get_if<InsertOp>(op)) {
+      keys.push_back(insert_op->key);
+    }
+  }
+  return VerifyKeys(ctx, keys);
+}
+
 ForeignKeyReferencedVerifier::ForeignKeyReferencedVerifier(
     const ForeignKey* foreign_key)
     : foreign_key_(foreign_key) {}
 
-absl::Status ForeignKeyReferencedVerifier::Verify(const ActionContext* ctx,
-                                                  const DeleteOp& op) const {
-  // Check that the corresponding row does not exist in the referencing index.
+absl::Status ForeignKeyReferencedVerifier::VerifyKeys(
+    const ActionContext* ctx, const std::vector<Key>& keys) const {
+  // Check that the corresponding rows do not exist in the referencing index.
   // Exclude any extra columns from the primary key that are not used by the
   // foreign key.
-  Key key(std::vector<zetasql::Value>(
-      op.key.column_values().begin(),
-      op.key.column_values().begin() +
-          foreign_key_->referencing_columns().size()));
+  const int num_columns = foreign_key_->referencing_columns().size();
+  const Table* referenced_data_table = foreign_key_->referenced_data_table();
+  const Table* referencing_data_table = foreign_key_->referencing_data_table();
+  std::vector<Key> referenced_prefixes;
+  referenced_prefixes.reserve(keys.size());
+  for (const Key& key : keys) {
+    referenced_prefixes.push_back(
+        ForeignKeyPrefix(key, num_columns, referenced_data_table));
+  }
 
   // It is possible that a deleted key is inserted back in the same transaction
   // later. So check whether the key is really deleted before validating the
   // foreign key.
   ZETASQL_ASSIGN_OR_RETURN(
-      bool referenced_key_exists,
-      ctx->store()->PrefixExists(foreign_key_->referenced_data_table(), key));
-  if (!referenced_key_exists) {
-    ZETASQL_ASSIGN_OR_RETURN(bool referencing_key_exists,
-                     ctx->store()->PrefixExists(
-                         foreign_key_->referencing_data_table(), key));
-    if (referencing_key_exists) {
+      std::vector<bool> referenced_key_exists,
+      PrefixesExist(ctx->store(), referenced_data_table, referenced_prefixes));
+  std::vector<Key> referencing_prefixes;
+  for (int i = 0; i < keys.size(); ++i) {
+    if (!referenced_key_exists[i]) {
+      referencing_prefixes.push_back(
+          ForeignKeyPrefix(keys[i], num_columns, referencing_data_table));
+    }
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::vector<bool> referencing_key_exists,
+      PrefixesExist(ctx->store(), referencing_data_table,
+                    referencing_prefixes));
+  for (int i = 0; i < referencing_prefixes.size(); ++i) {
+    if (referencing_key_exists[i]) {
       return error::ForeignKeyReferencingKeyFound(
           foreign_key_->Name(), foreign_key_->referencing_table()->Name(),
-          foreign_key_->referenced_table()->Name(), key.DebugString());
+          foreign_key_->referenced_table()->Name(),
+          referencing_prefixes[i].DebugString());
     }
   }
   return absl::OkStatus();
 }
 
+absl::Status ForeignKeyReferencedVerifier::Verify(const ActionContext* ctx,
+                                                  const DeleteOp& op) const {
+  return VerifyKeys(ctx, {op.key});
+}
+
+absl::Status ForeignKeyReferencedVerifier::VerifyBatch(
+    const ActionContext* ctx, absl::Span<const WriteOp* const> ops) const {
+  std::vector<Key> keys;
+  for (const WriteOp* op : ops) {
+    if (const auto* delete_op = std::get_if<DeleteOp>(op)) {
+      keys.push_back(delete_op->key);
+    }
+  }
+  return VerifyKeys(ctx, keys);
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
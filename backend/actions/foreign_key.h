@@ -17,9 +17,13 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_FOREIGN_KEY_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_FOREIGN_KEY_H_
 
+#include <vector>
+
+#include "absl/types/span.h"
 #include "backend/actions/action.h"
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
+#include "backend/datamodel/key.h"
 #include "backend/schema/catalog/foreign_key.h"
 #include "absl/status/status.h"
 
@@ -41,13 +45,21 @@ namespace backend {
 // referencing row, and a following operation inserts the referenced row. Since
 // verifiers are triggered after all operations have been evaluated and applied,
 // this verifier will only see the final result.
+//
+// The referenced keys of all inserts of a statement are checked with a single
+// sorted scan of the referenced index.
 class ForeignKeyReferencingVerifier : public Verifier {
  public:
   explicit ForeignKeyReferencingVerifier(const ForeignKey* foreign_key);
 
  private:
+  // Verifies the inserted rows with the given keys in the referencing index.
+  absl::Status VerifyKeys(const ActionContext* ctx,
+                          const std::vector<Key>& keys) const;
   absl::Status Verify(const ActionContext* ctx,
                       const InsertOp& op) const override;
+  absl::Status VerifyBatch(const ActionContext* ctx,
+                           absl::Span<const WriteOp* const> ops) const override;
 
   const ForeignKey* foreign_key_;
 };
@@ -67,13 +79,21 @@ class ForeignKeyReferencingVerifier : public Verifier {
 // referenced row, but a following operation inserts it. Since verifiers are
 // triggered after all operations have been evaluated and applied, this verifier
 // will only see the final result.
+//
+// The keys of all deletes of a statement are checked with a single sorted scan
+// of each index.
 class ForeignKeyReferencedVerifier : public Verifier {
  public:
   explicit ForeignKeyReferencedVerifier(const ForeignKey* foreign_key);
 
  private:
+  // Verifies the deleted rows with the given keys in the referenced index.
+  absl::Status VerifyKeys(const ActionContext* ctx,
+                          const std::vector<Key>& keys) const;
   absl::Status Verify(const ActionContext* ctx,
                       const DeleteOp& op) const override;
+  absl::Status VerifyBatch(const ActionContext* ctx,
+                           absl::Span<const WriteOp* const> ops) const override;
 
   const ForeignKey* foreign_key_;
 };
@@ -18,6 +18,8 @@
 
 #include <memory>
 #include <queue>
+#include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -142,6 +144,170 @@ TEST_F(ForeignKeyTest, DeleteReferencedRowWithoutReferencingRow) {
       ctx(), Delete(referenced_data_, Key({Int64(4), Int64(5), Int64(6)}))));
 }
 
+TEST_F(ForeignKeyTest, VerifyBatchOfReferencingRows) {
+  ZETASQL_ASSERT_OK(
+      store()->Insert(referenced_data_, Key({Int64(1), Int64(2), Int64(3)}),
+                      referenced_columns_, {Int64(1), Int64(2), Int64(3)}));
+  ZETASQL_ASSERT_OK(
+      store()->Insert(referenced_data_, Key({Int64(4), Int64(5), Int64(6)}),
+                      referenced_columns_, {Int64(4), Int64(5), Int64(6)}));
+
+  // Referencing rows are verified with one scan regardless of their order, and
+  // the first row without a referenced row is reported.
+  WriteOp first = Insert(referencing_data_, Key({Int64(4), Int64(5), Int64(7)}),
+                         referencing_columns_, {Int64(4), Int64(5), Int64(7)});
+  WriteOp second =
+      Insert(referencing_data_, Key({Int64(1), Int64(2), Int64(8)}),
+             referencing_columns_, {Int64(1), Int64(2), Int64(8)});
+  WriteOp missing =
+      Insert(referencing_data_, Key({Int64(2), Int64(3), Int64(9)}),
+             referencing_columns_, {Int64(2), Int64(3), Int64(9)});
+  ZETASQL_EXPECT_OK(referencing_verifier_->VerifyBatch(ctx(),
+                                               {&first, &second, &first}));
+  EXPECT_THAT(
+      referencing_verifier_->VerifyBatch(ctx(), {&first, &missing, &second}),
+      StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST_F(ForeignKeyTest, VerifyBatchOfDeletedReferencedRows) {
+  ZETASQL_ASSERT_OK(
+      store()->Insert(referencing_data_, Key({Int64(4), Int64(5), Int64(7)}),
+                      referencing_columns_, {Int64(4), Int64(5), Int64(7)}));
+
+  WriteOp unreferenced =
+      Delete(referenced_data_, Key({Int64(1), Int64(2), Int64(3)}));
+  WriteOp referenced =
+      Delete(referenced_data_, Key({Int64(4), Int64(5), Int64(6)}));
+  ZETASQL_EXPECT_OK(referenced_verifier_->VerifyBatch(ctx(), {&unreferenced}));
+  EXPECT_THAT(
+      referenced_verifier_->VerifyBatch(ctx(), {&unreferenced, &referenced}),
+      StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST_F(ForeignKeyTest, VerifyBatchOfSparseReferencingRows) {
+  // Many referenced rows fall between the referencing rows, so the scan seeks
+  // past them rather than reading them all.
+  for (int i = 0; i < 100; ++i) {
+    ZETASQL_ASSERT_OK(store()->Insert(
+        referenced_data_, Key({Int64(i), Int64(i), Int64(i)}),
+        referenced_columns_, {Int64(i), Int64(i), Int64(i)}));
+  }
+  WriteOp first = Insert(referencing_data_, Key({Int64(0), Int64(0), Int64(0)}),
+                         referencing_columns_, {Int64(0), Int64(0), Int64(0)});
+  WriteOp middle =
+      Insert(referencing_data_, Key({Int64(50), Int64(50), Int64(0)}),
+             referencing_columns_, {Int64(50), Int64(50), Int64(0)});
+  WriteOp last =
+      Insert(referencing_data_, Key({Int64(99), Int64(99), Int64(0)}),
+             referencing_columns_, {Int64(99), Int64(99), Int64(0)});
+  WriteOp missing =
+      Insert(referencing_data_, Key({Int64(75), Int64(76), Int64(0)}),
+             referencing_columns_, {Int64(75), Int64(76), Int64(0)});
+  ZETASQL_EXPECT_OK(
+      referencing_verifier_->VerifyBatch(ctx(), {&last, &first, &middle}));
+  EXPECT_THAT(referencing_verifier_->VerifyBatch(
+                  ctx(), {&last, &first, &missing, &middle}),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+// Returns a key of the given values whose first column is descending.
+Key DescendingKey(std::vector<zetasql::Value> values) {
+  Key key(std::move(values));
+  key.SetColumnDescending(0, true);
+  return key;
+}
+
+class ForeignKeyDescendingTest : public test::ActionsTest {
+ public:
+  ForeignKeyDescendingTest()
+      : schema_(emulator::test::CreateSchemaFromDDL({R"(
+            CREATE TABLE T (
+              A INT64 NOT NULL,
+              B INT64 NOT NULL,
+            ) PRIMARY KEY(A DESC, B)
+          )",
+                                                     R"(
+             CREATE TABLE U (
+               X INT64 NOT NULL,
+               Y INT64 NOT NULL,
+               Z INT64 NOT NULL,
+               CONSTRAINT C FOREIGN KEY (X, Y) REFERENCES T (A, B),
+             ) PRIMARY KEY(X DESC, Y, Z)
+           )"},
+                                                    &type_factory_)
+                    .value()),
+        foreign_key_(schema_->FindTable("U")->FindForeignKey("C")),
+        referencing_data_(foreign_key_->referencing_data_table()),
+        referencing_columns_(referencing_data_->columns()),
+        referenced_data_(foreign_key_->referenced_data_table()),
+        referenced_columns_(referenced_data_->columns()),
+        referencing_verifier_(
+            std::make_unique<ForeignKeyReferencingVerifier>(foreign_key_)),
+        referenced_verifier_(
+            std::make_unique<ForeignKeyReferencedVerifier>(foreign_key_)) {}
+
+ protected:
+  // Test components.
+  zetasql::TypeFactory type_factory_;
+  std::unique_ptr<const Schema> schema_;
+
+  // Test variables.
+  const ForeignKey* foreign_key_;
+  const Table* referencing_data_;
+  absl::Span<const Column* const> referencing_columns_;
+  const Table* referenced_data_;
+  absl::Span<const Column* const> referenced_columns_;
+  std::unique_ptr<Verifier> referencing_verifier_;
+  std::unique_ptr<Verifier> referenced_verifier_;
+};
+
+TEST_F(ForeignKeyDescendingTest, VerifyBatchOfReferencingRows) {
+  // The foreign key uses the primary keys of both tables, which sort their
+  // first column in descending order.
+  ASSERT_EQ(referenced_data_, schema_->FindTable("T"));
+  ASSERT_EQ(referencing_data_, schema_->FindTable("U"));
+  for (int i = 0; i < 100; ++i) {
+    ZETASQL_ASSERT_OK(store()->Insert(referenced_data_,
+                              DescendingKey({Int64(i), Int64(i)}),
+                              referenced_columns_, {Int64(i), Int64(i)}));
+  }
+  WriteOp first = Insert(
+      referencing_data_, DescendingKey({Int64(99), Int64(99), Int64(0)}),
+      referencing_columns_, {Int64(99), Int64(99), Int64(0)});
+  WriteOp middle = Insert(
+      referencing_data_, DescendingKey({Int64(50), Int64(50), Int64(0)}),
+      referencing_columns_, {Int64(50), Int64(50), Int64(0)});
+  WriteOp last = Insert(referencing_data_,
+                        DescendingKey({Int64(0), Int64(0), Int64(0)}),
+                        referencing_columns_, {Int64(0), Int64(0), Int64(0)});
+  WriteOp missing = Insert(referencing_data_,
+                           DescendingKey({Int64(75), Int64(76), Int64(0)}),
+                           referencing_columns_,
+                           {Int64(75), Int64(76), Int64(0)});
+  ZETASQL_EXPECT_OK(
+      referencing_verifier_->VerifyBatch(ctx(), {&last, &first, &middle}));
+  EXPECT_THAT(referencing_verifier_->VerifyBatch(
+                  ctx(), {&last, &first, &missing, &middle}),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST_F(ForeignKeyDescendingTest, VerifyBatchOfDeletedReferencedRows) {
+  ZETASQL_ASSERT_OK(store()->Insert(
+      referencing_data_, DescendingKey({Int64(50), Int64(50), Int64(0)}),
+      referencing_columns_, {Int64(50), Int64(50), Int64(0)}));
+
+  WriteOp unreferenced =
+      Delete(referenced_data_, DescendingKey({Int64(99), Int64(99)}));
+  WriteOp referenced =
+      Delete(referenced_data_, DescendingKey({Int64(50), Int64(50)}));
+  WriteOp other = Delete(referenced_data_, DescendingKey({Int64(0), Int64(0)}));
+  ZETASQL_EXPECT_OK(
+      referenced_verifier_->VerifyBatch(ctx(), {&other, &unreferenced}));
+  EXPECT_THAT(referenced_verifier_->VerifyBatch(
+                  ctx(), {&other, &referenced, &unreferenced}),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -27,10 +27,11 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
 #include "backend/access/write.h"
+#include "backend/actions/batch_expression.h"
 #include "backend/actions/ops.h"
 #include "backend/common/graph_dependency_helper.h"
-#include "backend/query/analyzer_options.h"
 #include "common/errors.h"
 #include "zetasql/base/status_macros.h"
 
@@ -66,41 +67,50 @@ absl::Status GetGeneratedColumnsInTopologicalOrder(
   return sorter.TopologicalOrder(generated_columns);
 }
 
-absl::StatusOr<std::unique_ptr<zetasql::PreparedExpression>>
+absl::StatusOr<std::shared_ptr<zetasql::PreparedExpression>>
 PrepareExpression(const Column* generated_column,
-                  zetasql::Catalog* function_catalog) {
+                  zetasql::Catalog* function_catalog,
+                  PreparedExpressionCache* expression_cache) {
   constexpr char kExpression[] = "CAST (($0) AS $1)";
   std::string sql = absl::Substitute(
       kExpression, generated_column->expression().value(),
       generated_column->GetType()->TypeName(zetasql::PRODUCT_EXTERNAL));
-  auto expr = std::make_unique<zetasql::PreparedExpression>(sql);
-  zetasql::AnalyzerOptions options = MakeGoogleSqlAnalyzerOptions();
-  for (const Column* dep : generated_column->dependent_columns()) {
-    ZETASQL_RETURN_IF_ERROR(options.AddExpressionColumn(dep->Name(), dep->GetType()));
-  }
-  ZETASQL_RETURN_IF_ERROR(expr->Prepare(options, function_catalog));
+  ZETASQL_ASSIGN_OR_RETURN(
+      auto expr,
+      expression_cache->GetOrPrepare(
+          sql, generated_column->dependent_columns(), function_catalog));
   ZETASQL_RET_CHECK(generated_column->GetType()->Equals(expr->output_type()));
-  return std::move(expr);
+  return expr;
 }
 
 }  // namespace
 
 GeneratedColumnEffector::GeneratedColumnEffector(
-    const Table* table, zetasql::Catalog* function_catalog, bool for_keys)
+    const Table* table, zetasql::Catalog* function_catalog,
+    PreparedExpressionCache* expression_cache, bool for_keys)
     : table_(table), for_keys_(for_keys) {
-  absl::Status s = Initialize(function_catalog);
+  absl::Status s = Initialize(function_catalog, expression_cache);
   ZETASQL_DCHECK(s.ok()) << "Failed to initialize GeneratedColumnEffector: " << s;
 }
 
 absl::Status GeneratedColumnEffector::Initialize(
-    zetasql::Catalog* function_catalog) {
+    zetasql::Catalog* function_catalog,
+    PreparedExpressionCache* expression_cache) {
   ZETASQL_RETURN_IF_ERROR(
       GetGeneratedColumnsInTopologicalOrder(table_, &generated_columns_));
   expressions_.reserve(generated_columns_.size());
   for (const Column* generated_column : generated_columns_) {
-    ZETASQL_ASSIGN_OR_RETURN(auto expr,
-                     PrepareExpression(generated_column, function_catalog));
-    expressions_[generated_column] = std::move(expr);
+    ZETASQL_ASSIGN_OR_RETURN(auto expr, PrepareExpression(generated_column,
+                                                  function_catalog,
+                                                  expression_cache));
+    ZETASQL_ASSIGN_OR_RETURN(BatchExpression batch_expr,
+                     BatchExpression::Create(std::move(expr)));
+    expressions_.emplace(generated_column, std::move(batch_expr));
+    if (generated_column->is_generated()) {
+      generated_dependencies_.insert(
+          generated_column->dependent_columns().begin(),
+          generated_column->dependent_columns().end());
+    }
   }
   return absl::OkStatus();
 }
@@ -114,7 +124,7 @@ GeneratedColumnEffector::ComputeGeneratedColumnValue(
              generated_column->has_default_value()));
   ZETASQL_ASSIGN_OR_RETURN(
       zetasql::Value value,
-      expressions_.at(generated_column)->Execute(row_column_values));
+      expressions_.at(generated_column).Evaluate(row_column_values));
   if (value.is_null() && !generated_column->is_nullable()) {
     return error::NullValueForNotNullColumn(table_->Name(),
                                             generated_column->FullName());
@@ -123,6 +133,30 @@ GeneratedColumnEffector::ComputeGeneratedColumnValue(
   return value;
 }
 
+absl::Status GeneratedColumnEffector::ComputeGeneratedColumnValues(
+    const Column* generated_column, absl::Span<const std::string> column_names,
+    absl::Span<const std::vector<zetasql::Value>> column_values, int num_rows,
+    std::vector<zetasql::Value>* values) const {
+  ZETASQL_RET_CHECK(generated_column != nullptr &&
+            (generated_column->is_generated() ||
+             generated_column->has_default_value()));
+  values->clear();
+  // Rows are reported in order, so a NULL value is returned rather than an
+  // error evaluating a later row.
+  absl::Status status = expressions_.at(generated_column)
+                            .Evaluate(column_names, column_values, num_rows,
+                                      values);
+  if (!generated_column->is_nullable()) {
+    for (const zetasql::Value& value : *values) {
+      if (value.is_null()) {
+        return error::NullValueForNotNullColumn(table_->Name(),
+                                                generated_column->FullName());
+      }
+    }
+  }
+  return status;
+}
+
 absl::Status GeneratedColumnEffector::Effect(
     const MutationOp& op,
     std::vector<std::vector<zetasql::Value>>* generated_values,
@@ -131,10 +165,17 @@ absl::Status GeneratedColumnEffector::Effect(
 
   columns_with_generated_values->reserve(generated_columns_.size());
 
-  // This vector stores column values for each row that can be used to evaluate
-  // generated columns.
-  std::vector<zetasql::ParameterValueMap> row_column_values(
-      op.rows.size(), zetasql::ParameterValueMap());
+  // The values of the columns of the rows in column-major order, which are
+  // used to evaluate generated columns over all rows at once. Generated values
+  // are appended so that the generated columns depending on them can use them.
+  std::vector<std::string> column_names(op.columns.begin(), op.columns.end());
+  std::vector<std::vector<zetasql::Value>> column_values(op.columns.size());
+  for (int j = 0; j < op.columns.size(); ++j) {
+    column_values[j].reserve(op.rows.size());
+    for (int i = 0; i < op.rows.size(); ++i) {
+      column_values[j].push_back(op.rows[i][j]);
+    }
+  }
   // Evaluate generated columns in topological order.
   for (int i = 0; i < generated_columns_.size(); ++i) {
     const Column* generated_column = generated_columns_[i];
@@ -159,19 +200,15 @@ absl::Status GeneratedColumnEffector::Effect(
       }
     }
 
+    std::vector<zetasql::Value> values;
+    ZETASQL_RETURN_IF_ERROR(ComputeGeneratedColumnValues(
+        generated_column, column_names, column_values, op.rows.size(),
+        &values));
     for (int i = 0; i < op.rows.size(); ++i) {
-      // Calculate values of generated columns for each row.
-      for (int j = 0; j < op.columns.size(); ++j) {
-        row_column_values[i][op.columns[j]] = op.rows[i][j];
-      }
-      ZETASQL_ASSIGN_OR_RETURN(
-          zetasql::Value value,
-          ComputeGeneratedColumnValue(generated_column, row_column_values[i]));
-      // Update row_column_values so that other dependent columns on this
-      // generated column can use the value.
-      row_column_values[i][generated_column->Name()] = value;
-      generated_values->at(i).push_back(value);
+      generated_values->at(i).push_back(values[i]);
     }
+    column_names.push_back(generated_column->Name());
+    column_values.push_back(std::move(values));
     columns_with_generated_values->push_back(generated_column);
   }
   return absl::OkStatus();
@@ -207,6 +244,11 @@ absl::Status GeneratedColumnEffector::Effect(const ActionContext* ctx,
     // This is a generated column effect. Don't process it again.
     return absl::OkStatus();
   }
+  // Default values are only computed for inserts, so an update which writes
+  // none of the columns generated columns depend on has no effect.
+  if (!UpdatesAnyColumn(op, generated_dependencies_)) {
+    return absl::OkStatus();
+  }
 
   zetasql::ParameterValueMap column_values;
   ZETASQL_ASSIGN_OR_RETURN(
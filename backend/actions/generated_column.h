@@ -18,16 +18,21 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_GENERATED_COLUMN_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "zetasql/public/catalog.h"
 #include "zetasql/public/evaluator.h"
 #include "zetasql/public/value.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "backend/access/write.h"
 #include "backend/actions/action.h"
+#include "backend/actions/batch_expression.h"
 #include "backend/actions/ops.h"
+#include "backend/actions/prepared_expression_cache.h"
 #include "backend/schema/catalog/table.h"
 #include "absl/status/status.h"
 
@@ -48,6 +53,7 @@ class GeneratedColumnEffector : public Effector {
  public:
   explicit GeneratedColumnEffector(const Table* table,
                                    zetasql::Catalog* function_catalog,
+                                   PreparedExpressionCache* expression_cache,
                                    bool for_keys = false);
 
   // Computes the value of the given 'generated_column' based on the given
@@ -56,6 +62,15 @@ class GeneratedColumnEffector : public Effector {
       const Column* generated_column,
       const zetasql::ParameterValueMap& row_column_values) const;
 
+  // Computes the values of the given 'generated_column' for each of the
+  // 'num_rows' rows of a batch, in which column_values[i][j] is the value of
+  // the column named column_names[i] in row j.
+  absl::Status ComputeGeneratedColumnValues(
+      const Column* generated_column,
+      absl::Span<const std::string> column_names,
+      absl::Span<const std::vector<zetasql::Value>> column_values, int num_rows,
+      std::vector<zetasql::Value>* values) const;
+
   // Computed the default values of primary key columns (if any) based
   // on the given `mutation_op`. Those columns are returned via
   // `columns_with_generated_values`, and their values are returned via
@@ -66,7 +81,8 @@ class GeneratedColumnEffector : public Effector {
       std::vector<const Column*>* columns_with_generated_values) const;
 
  private:
-  absl::Status Initialize(zetasql::Catalog* function_catalog);
+  absl::Status Initialize(zetasql::Catalog* function_catalog,
+                          PreparedExpressionCache* expression_cache);
   absl::Status Effect(const ActionContext* ctx,
                       const InsertOp& op) const override;
   absl::Status Effect(const ActionContext* ctx,
@@ -88,9 +104,11 @@ class GeneratedColumnEffector : public Effector {
   std::vector<const Column*> generated_columns_;
 
   // Map of generated and default columns to their corresponding expressions.
-  absl::flat_hash_map<const Column*,
-                      std::unique_ptr<zetasql::PreparedExpression>>
-      expressions_;
+  absl::flat_hash_map<const Column*, BatchExpression> expressions_;
+
+  // The columns which generated columns depend on. Updates which write none of
+  // them leave every generated column unchanged.
+  absl::flat_hash_set<const Column*> generated_dependencies_;
 };
 
 }  // namespace backend
@@ -60,6 +60,7 @@ IndexEffector::IndexEffector(const Index* index) : index_(index) {
   for (const Column* column : index->index_data_table()->columns()) {
     base_columns_.emplace_back(column->source_column());
   }
+  base_column_set_.insert(base_columns_.begin(), base_columns_.end());
 }
 
 absl::Status IndexEffector::Effect(const ActionContext* ctx,
@@ -80,6 +81,11 @@ absl::Status IndexEffector::Effect(const ActionContext* ctx,
 
 absl::Status IndexEffector::Effect(const ActionContext* ctx,
                                    const UpdateOp& op) const {
+  // The index entry of the row does not change if none of its columns do.
+  if (!UpdatesAnyColumn(op, base_column_set_)) {
+    return absl::OkStatus();
+  }
+
   // Read the current base row values from the indexed table.
   ZETASQL_ASSIGN_OR_RETURN(Row base_row,
                    ReadBaseTableRow(ctx, op.table, op.key, base_columns_));
@@ -17,6 +17,9 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_INDEX_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_INDEX_H_
 
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
 #include "backend/actions/action.h"
 #include "backend/actions/ops.h"
 #include "backend/schema/catalog/table.h"
@@ -35,7 +38,8 @@ namespace backend {
 // - Insert: Index entry is computed from the indexed row & buffered to the
 //           index.
 // - Update: Old index entry is buffered to be deleted and a new index entry is
-//           buffered to be added.
+//           buffered to be added, unless the update writes none of the
+//           indexed table columns relevant to the index.
 // - Delete: Index entry is buffered to be deleted.
 //
 // NULL_FILTERED index entries are omitted from all operations above.
@@ -56,6 +60,9 @@ class IndexEffector : public Effector {
 
   // List of indexed table columns relevant to the index.
   std::vector<const Column*> base_columns_;
+
+  // The same columns, for finding updates which leave the index unchanged.
+  absl::flat_hash_set<const Column*> base_column_set_;
 };
 
 }  // namespace backend
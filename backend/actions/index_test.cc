@@ -57,6 +57,10 @@ class IndexTest : public test::ActionsTest {
                             CREATE UNIQUE NULL_FILTERED INDEX TestIndex ON
                             TestTable(string_col DESC)
                             STORING(another_string_col)
+                        )",
+                        R"(
+                            CREATE INDEX AnotherIndex ON
+                            TestTable(another_string_col)
                     )"},
                     &type_factory_)
                     .value()),
@@ -166,6 +170,19 @@ TEST_F(IndexTest, UpdateColumnOnlyDeletesOldEntry) {
           index_->index_data_table(), Key({String("value"), Int64(1)})}));
 }
 
+TEST_F(IndexTest, UpdateOfUnindexedColumnIsSkipped) {
+  ZETASQL_EXPECT_OK(store()->Insert(table_, Key({Int64(1)}), base_columns_,
+                            {Int64(1), String("value"), String("value2")}));
+
+  // The update writes no column of the index, so its entry is left as is.
+  std::unique_ptr<Effector> effector =
+      std::make_unique<IndexEffector>(schema_->FindIndex("AnotherIndex"));
+  ZETASQL_EXPECT_OK(effector->Effect(
+      ctx(), Update(table_, Key({Int64(1)}), {table_->FindColumn("string_col")},
+                    {String("new-value")})));
+  EXPECT_EQ(effects_buffer()->ops_queue()->size(), 0);
+}
+
 TEST_F(IndexTest, UpdateCascadesToIndexEntry) {
   // Add row in base table & index.
   ZETASQL_EXPECT_OK(store()->Insert(table_, Key({Int64(1)}), base_columns_,
@@ -16,12 +16,16 @@
 
 #include "backend/actions/interleave.h"
 
-#include <memory>
+#include <algorithm>
+#include <utility>
+#include <variant>
+#include <vector>
 
-#include "backend/datamodel/key_range.h"
-#include "backend/storage/iterator.h"
+#include "backend/actions/prefix_scan.h"
+#include "backend/datamodel/key.h"
 #include "common/errors.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 
 namespace google {
 namespace spanner {
@@ -60,18 +64,41 @@ InterleaveParentEffector::InterleaveParentEffector(const Table* parent,
 
 absl::Status InterleaveParentEffector::Effect(const ActionContext* ctx,
                                               const DeleteOp& op) const {
+  return DeleteChildren(ctx, {op.key});
+}
+
+absl::Status InterleaveParentEffector::EffectBatch(
+    const ActionContext* ctx, absl::Span<const WriteOp* const> ops) const {
+  if (on_delete_action_ == Table::OnDeleteAction::kNoAction) {
+    return absl::OkStatus();
+  }
+  std::vector<Key> parent_keys;
+  for (const WriteOp* op : ops) {
+    if (const auto* delete_op = std::get_if<DeleteOp>(op)) {
+      parent_keys.push_back(delete_op->key);
+    }
+  }
+  return DeleteChildren(ctx, std::move(parent_keys));
+}
+
+absl::Status InterleaveParentEffector::DeleteChildren(
+    const ActionContext* ctx, std::vector<Key> parent_keys) const {
   switch (on_delete_action_) {
     case Table::OnDeleteAction::kNoAction: {
       return absl::OkStatus();
     }
     case Table::OnDeleteAction::kCascade: {
-      ZETASQL_ASSIGN_OR_RETURN(
-          std::unique_ptr<StorageIterator> itr,
-          ctx->store()->Read(child_, KeyRange::Prefix(op.key), {}));
-      while (itr->Next()) {
-        ctx->effects()->Delete(child_, itr->Key());
+      if (parent_keys.empty()) {
+        return absl::OkStatus();
       }
-      return itr->Status();
+      std::sort(parent_keys.begin(), parent_keys.end());
+      parent_keys.erase(std::unique(parent_keys.begin(), parent_keys.end()),
+                        parent_keys.end());
+      return ForEachRowWithPrefix(ctx->store(), child_, parent_keys,
+                                  [&](int, const Key& key) {
+                                    ctx->effects()->Delete(child_, key);
+                                    return absl::OkStatus();
+                                  });
     }
   }
 }
@@ -17,10 +17,14 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_INTERLEAVE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_INTERLEAVE_H_
 
+#include <vector>
+
 #include "backend/actions/action.h"
 #include "backend/actions/ops.h"
+#include "backend/datamodel/key.h"
 #include "backend/schema/catalog/table.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 
 namespace google {
 namespace spanner {
@@ -57,14 +61,24 @@ class InterleaveParentValidator : public Validator {
 // there are the following two cases:
 // - kNoAction: No extra mutations are added.
 // - kCascade : Additional mutations are added to delete child rows.
+//
+// When a batch of parent rows is deleted, their child rows are found with a
+// single scan of the child table.
 class InterleaveParentEffector : public Effector {
  public:
   InterleaveParentEffector(const Table* parent, const Table* child);
 
+  absl::Status EffectBatch(const ActionContext* ctx,
+                           absl::Span<const WriteOp* const> ops) const override;
+
  private:
   absl::Status Effect(const ActionContext* ctx,
                       const DeleteOp& op) const override;
 
+  // Adds delete mutations for the child rows of the given parent keys.
+  absl::Status DeleteChildren(const ActionContext* ctx,
+                              std::vector<Key> parent_keys) const;
+
   const Table* parent_;
   const Table* child_;
   const Table::OnDeleteAction on_delete_action_;
@@ -16,8 +16,11 @@
 
 #include "backend/actions/interleave.h"
 
+#include <cstdint>
 #include <memory>
 #include <queue>
+#include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -148,6 +151,40 @@ TEST_F(InterleaveTest, ParentRowDeleteWithOnDeleteCascadeAddsEffects) {
                   DeleteOp{cascade_delete_child_, Key({Int64(1), Int64(1)})}));
 }
 
+TEST_F(InterleaveTest, BatchOfParentRowDeletesCascadesWithOneScan) {
+  std::unique_ptr<Effector> effector =
+      std::make_unique<InterleaveParentEffector>(parent_table_,
+                                                 cascade_delete_child_);
+
+  for (int64_t parent : {1, 2, 3}) {
+    for (int64_t child : {1, 2}) {
+      ZETASQL_EXPECT_OK(store()->Insert(cascade_delete_child_,
+                                Key({Int64(parent), Int64(child)}), {}, {}));
+    }
+  }
+
+  // Children of parents outside the batch inside the scanned range are kept.
+  WriteOp third = Delete(parent_table_, Key({Int64(3)}));
+  WriteOp first = Delete(parent_table_, Key({Int64(1)}));
+  ZETASQL_EXPECT_OK(effector->EffectBatch(ctx(), {&third, &first, &third}));
+  std::vector<WriteOp> effects;
+  while (!effects_buffer()->ops_queue()->empty()) {
+    effects.push_back(effects_buffer()->ops_queue()->front());
+    effects_buffer()->ops_queue()->pop();
+  }
+  EXPECT_THAT(
+      effects,
+      testing::ElementsAre(
+          testing::VariantWith<DeleteOp>(
+              DeleteOp{cascade_delete_child_, Key({Int64(1), Int64(1)})}),
+          testing::VariantWith<DeleteOp>(
+              DeleteOp{cascade_delete_child_, Key({Int64(1), Int64(2)})}),
+          testing::VariantWith<DeleteOp>(
+              DeleteOp{cascade_delete_child_, Key({Int64(3), Int64(1)})}),
+          testing::VariantWith<DeleteOp>(
+              DeleteOp{cascade_delete_child_, Key({Int64(3), Int64(2)})})));
+}
+
 TEST_F(InterleaveTest, ChildRowInsertFailsWithoutParentRow) {
   std::unique_ptr<Validator> validator =
       std::make_unique<InterleaveChildValidator>(parent_table_,
@@ -172,6 +209,83 @@ TEST_F(InterleaveTest, ChildRowInsertSucceedsWithParentRow) {
       ctx(), Insert(cascade_delete_child_, Key({Int64(1), Int64(1)}))));
 }
 
+// Returns a key of the given values whose first column is descending.
+Key DescendingKey(std::vector<zetasql::Value> values) {
+  Key key(std::move(values));
+  key.SetColumnDescending(0, true);
+  return key;
+}
+
+class InterleaveDescendingTest : public test::ActionsTest {
+ public:
+  InterleaveDescendingTest()
+      : schema_(emulator::test::CreateSchemaFromDDL({R"(
+            CREATE TABLE Parent (
+              k1 INT64 NOT NULL,
+            ) PRIMARY KEY (k1 DESC)
+          )",
+                                                     R"(
+            CREATE TABLE Child (
+              k1 INT64 NOT NULL,
+              k2 INT64 NOT NULL,
+            ) PRIMARY KEY (k1 DESC, k2),
+              INTERLEAVE IN PARENT Parent ON DELETE CASCADE
+          )"},
+                                                    &type_factory_)
+                    .value()),
+        parent_table_(schema_->FindTable("Parent")),
+        child_table_(schema_->FindTable("Child")) {}
+
+ protected:
+  // Test components.
+  zetasql::TypeFactory type_factory_;
+  std::unique_ptr<const Schema> schema_;
+
+  // Test variables.
+  const Table* parent_table_;
+  const Table* child_table_;
+};
+
+TEST_F(InterleaveDescendingTest, BatchOfSparseParentRowDeletesCascades) {
+  std::unique_ptr<Effector> effector =
+      std::make_unique<InterleaveParentEffector>(parent_table_, child_table_);
+
+  for (int64_t parent = 0; parent <= 25; ++parent) {
+    for (int64_t child : {1, 2}) {
+      ZETASQL_EXPECT_OK(store()->Insert(child_table_,
+                                DescendingKey({Int64(parent), Int64(child)}),
+                                {}, {}));
+    }
+  }
+
+  // Many children of other parents fall between the deleted parents, so the
+  // scan seeks past them rather than reading them all. Children are deleted
+  // in descending order of their parents.
+  WriteOp first = Delete(parent_table_, DescendingKey({Int64(0)}));
+  WriteOp middle = Delete(parent_table_, DescendingKey({Int64(12)}));
+  WriteOp last = Delete(parent_table_, DescendingKey({Int64(25)}));
+  ZETASQL_EXPECT_OK(effector->EffectBatch(ctx(), {&first, &middle, &last}));
+  std::vector<WriteOp> effects;
+  while (!effects_buffer()->ops_queue()->empty()) {
+    effects.push_back(effects_buffer()->ops_queue()->front());
+    effects_buffer()->ops_queue()->pop();
+  }
+  EXPECT_THAT(effects,
+              testing::ElementsAre(
+                  testing::VariantWith<DeleteOp>(DeleteOp{
+                      child_table_, DescendingKey({Int64(25), Int64(1)})}),
+                  testing::VariantWith<DeleteOp>(DeleteOp{
+                      child_table_, DescendingKey({Int64(25), Int64(2)})}),
+                  testing::VariantWith<DeleteOp>(DeleteOp{
+                      child_table_, DescendingKey({Int64(12), Int64(1)})}),
+                  testing::VariantWith<DeleteOp>(DeleteOp{
+                      child_table_, DescendingKey({Int64(12), Int64(2)})}),
+                  testing::VariantWith<DeleteOp>(DeleteOp{
+                      child_table_, DescendingKey({Int64(0), Int64(1)})}),
+                  testing::VariantWith<DeleteOp>(DeleteOp{
+                      child_table_, DescendingKey({Int64(0), Int64(2)})})));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -16,17 +16,23 @@
 
 #include "backend/actions/manager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "zetasql/public/types/type_factory.h"
 #include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "backend/access/write.h"
 #include "backend/actions/change_stream.h"
 #include "backend/actions/check_constraint.h"
@@ -45,6 +51,7 @@
 #include "backend/schema/catalog/foreign_key.h"
 #include "backend/schema/catalog/index.h"
 #include "backend/schema/catalog/schema.h"
+#include "common/config.h"
 #include "common/errors.h"
 #include "zetasql/base/status_macros.h"
 
@@ -55,7 +62,7 @@ namespace backend {
 
 absl::Status ActionRegistry::ExecuteValidators(const ActionContext* ctx,
                                                const WriteOp& op) {
-  for (auto& validator : table_validators_[TableOf(op)]) {
+  for (auto& validator : GetTableActions(TableOf(op))->validators) {
     ZETASQL_RETURN_IF_ERROR(validator->Validate(ctx, op));
   }
   return absl::OkStatus();
@@ -63,7 +70,7 @@ absl::Status ActionRegistry::ExecuteValidators(const ActionContext* ctx,
 
 absl::Status ActionRegistry::ExecuteEffectors(const ActionContext* ctx,
                                               const WriteOp& op) {
-  for (auto& effector : table_effectors_[TableOf(op)]) {
+  for (auto& effector : GetTableActions(TableOf(op))->effectors) {
     ZETASQL_RETURN_IF_ERROR(effector->Effect(ctx, op));
   }
   return absl::OkStatus();
@@ -73,121 +80,251 @@ absl::Status ActionRegistry::ExecuteGeneratedKeyEffectors(
     const MutationOp& op,
     std::vector<std::vector<zetasql::Value>>* generated_values,
     std::vector<const Column*>* columns_with_generated_values) {
-  if (table_generated_key_effectors_.find(op.table) ==
-      table_generated_key_effectors_.end()) {
+  const Table* table = schema_->FindTableCaseSensitive(op.table);
+  if (table == nullptr) {
+    return absl::OkStatus();
+  }
+  const TableActions* actions = GetTableActions(table);
+  if (actions->generated_key_effector == nullptr) {
     return absl::OkStatus();
   }
 
-  ZETASQL_RETURN_IF_ERROR(table_generated_key_effectors_[op.table]->Effect(
+  ZETASQL_RETURN_IF_ERROR(actions->generated_key_effector->Effect(
       op, generated_values, columns_with_generated_values));
   return absl::OkStatus();
 }
 
 absl::Status ActionRegistry::ExecuteModifiers(const ActionContext* ctx,
                                               const WriteOp& op) {
-  for (auto& modifier : table_modifiers_[TableOf(op)]) {
+  for (auto& modifier : GetTableActions(TableOf(op))->modifiers) {
     ZETASQL_RETURN_IF_ERROR(modifier->Modify(ctx, op));
   }
   return absl::OkStatus();
 }
 
-absl::Status ActionRegistry::ExecuteVerifiers(const ActionContext* ctx,
-                                              const WriteOp& op) {
-  for (auto& verifier : table_verifiers_[TableOf(op)]) {
-    ZETASQL_RETURN_IF_ERROR(verifier->Verify(ctx, op));
-  }
-  return absl::OkStatus();
-}
+namespace {
 
-ActionRegistry::ActionRegistry(const Schema* schema,
-                               const FunctionCatalog* function_catalog,
-                               zetasql::TypeFactory* type_factory_)
-    : schema_(schema), catalog_(schema, function_catalog, type_factory_) {
-  BuildActionRegistry();
-}
+// Commits verifying fewer operations than this verify them on the calling
+// thread, as starting threads would cost more than the checks.
+constexpr size_t kMinOpsForParallelVerification = 256;
 
-void ActionRegistry::BuildActionRegistry() {
-  for (const Table* table : schema_->tables()) {
-    // Column value checks for all tables.
-    table_validators_[table].emplace_back(
-        std::make_unique<ColumnValueValidator>());
+// Operations grouped by their table, with the tables in the order of their
+// first operation.
+struct OpsByTable {
+  std::vector<const Table*> tables;
+  absl::flat_hash_map<const Table*, std::vector<const WriteOp*>> table_ops;
+};
 
-    // Row existence checks for all tables.
-    table_validators_[table].emplace_back(
-        std::make_unique<RowExistenceValidator>());
+OpsByTable GroupOpsByTable(const std::vector<WriteOp>& ops) {
+  OpsByTable ops_by_table;
+  for (const WriteOp& op : ops) {
+    auto [itr, inserted] = ops_by_table.table_ops.try_emplace(TableOf(op));
+    if (inserted) {
+      ops_by_table.tables.push_back(TableOf(op));
+    }
+    itr->second.push_back(&op);
+  }
+  return ops_by_table;
+}
 
-    // Interleave actions for child tables.
-    for (const Table* child : table->children()) {
-      table_validators_[table].emplace_back(
-          std::make_unique<InterleaveParentValidator>(table, child));
+}  // namespace
 
-      table_effectors_[table].emplace_back(
-          std::make_unique<InterleaveParentEffector>(table, child));
+absl::Status ActionRegistry::ExecuteBatchEffectors(
+    const ActionContext* ctx, const std::vector<WriteOp>& ops) {
+  OpsByTable ops_by_table = GroupOpsByTable(ops);
+  for (const Table* table : ops_by_table.tables) {
+    for (auto& effector : GetTableActions(table)->batch_effectors) {
+      ZETASQL_RETURN_IF_ERROR(
+          effector->EffectBatch(ctx, ops_by_table.table_ops[table]));
     }
+  }
+  return absl::OkStatus();
+}
 
-    // Interleave actions for parent table.
-    if (table->parent() != nullptr) {
-      table_validators_[table].emplace_back(
-          std::make_unique<InterleaveChildValidator>(table->parent(), table));
+absl::Status ActionRegistry::ExecuteVerifiers(
+    const ActionContext* ctx, const std::vector<WriteOp>& ops) {
+  // Verifiers only read the transaction's view of the database, so the
+  // verifiers of different tables, and of the same table, are independent.
+  struct Verification {
+    const Verifier* verifier;
+    absl::Span<const WriteOp* const> ops;
+  };
+  OpsByTable ops_by_table = GroupOpsByTable(ops);
+  std::vector<Verification> verifications;
+  size_t num_verified_ops = 0;
+  for (const Table* table : ops_by_table.tables) {
+    const std::vector<const WriteOp*>& table_ops =
+        ops_by_table.table_ops[table];
+    for (auto& verifier : GetTableActions(table)->verifiers) {
+      verifications.push_back({verifier.get(), table_ops});
+      num_verified_ops += table_ops.size();
     }
-    // Actions for ChangeStream.
-    for (const ChangeStream* change_stream : table->change_streams()) {
-      table_effectors_[table].emplace_back(
-          std::make_unique<ChangeStreamEffector>(change_stream));
+  }
+
+  const size_t num_threads =
+      num_verified_ops < kMinOpsForParallelVerification
+          ? 1
+          : std::min<size_t>(
+                {verifications.size(), std::thread::hardware_concurrency(),
+                 static_cast<size_t>(
+                     std::max(config::commit_verification_threads(), 1))});
+  if (num_threads <= 1) {
+    for (const Verification& verification : verifications) {
+      ZETASQL_RETURN_IF_ERROR(
+          verification.verifier->VerifyBatch(ctx, verification.ops));
     }
-    // Actions for Index.
-    for (const Index* index : table->indexes()) {
-      // Index effects.
-      table_effectors_[table].emplace_back(
-          std::make_unique<IndexEffector>(index));
-
-      // Index uniqueness checks.
-      if (index->is_unique()) {
-        table_verifiers_[index->index_data_table()].emplace_back(
-            std::make_unique<UniqueIndexVerifier>(index));
-      }
+    return absl::OkStatus();
+  }
+
+  // The verifications are handed out in order to the calling thread and
+  // num_threads - 1 workers, and the first failed verification in order is
+  // returned, as it would be if they ran one after the other.
+  std::vector<absl::Status> statuses(verifications.size());
+  std::atomic<size_t> next_verification = 0;
+  auto verify = [&]() {
+    for (size_t i = next_verification++; i < verifications.size();
+         i = next_verification++) {
+      statuses[i] =
+          verifications[i].verifier->VerifyBatch(ctx, verifications[i].ops);
     }
+  };
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < num_threads; ++t) {
+    workers.emplace_back(verify);
+  }
+  verify();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  for (const absl::Status& status : statuses) {
+    ZETASQL_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
 
-    // Actions for foreign keys.
-    for (const ForeignKey* foreign_key : table->foreign_keys()) {
-      table_verifiers_[foreign_key->referencing_data_table()].emplace_back(
+ActionRegistry::ActionRegistry(const Schema* schema,
+                               const FunctionCatalog* function_catalog,
+                               zetasql::TypeFactory* type_factory_,
+                               PreparedExpressionCache* expression_cache)
+    : schema_(schema),
+      catalog_(schema, function_catalog, type_factory_),
+      expression_cache_(expression_cache) {}
+
+const ActionRegistry::TableActions* ActionRegistry::GetTableActions(
+    const Table* table) {
+  // Every op looks up the actions of its table, and they are only built once,
+  // so lookups only take the lock shared.
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto itr = table_actions_.find(table);
+    if (itr != table_actions_.end()) {
+      return itr->second.get();
+    }
+  }
+  absl::MutexLock lock(&mutex_);
+  std::unique_ptr<TableActions>& actions = table_actions_[table];
+  if (actions == nullptr) {
+    actions = std::make_unique<TableActions>();
+    BuildTableActions(table, actions.get());
+  }
+  return actions.get();
+}
+
+void ActionRegistry::BuildTableActions(const Table* table,
+                                       TableActions* actions) {
+  // The data table of an index has no actions of its own, but is verified by
+  // the constraints defined on its indexed table.
+  const Index* owner_index = table->owner_index();
+  const Table* source_table =
+      owner_index != nullptr ? owner_index->indexed_table() : table;
+  if (owner_index == nullptr &&
+      schema_->FindTableCaseSensitive(table->Name()) != table) {
+    return;
+  }
+
+  // Index uniqueness checks.
+  if (owner_index != nullptr && owner_index->is_unique()) {
+    actions->verifiers.emplace_back(
+        std::make_unique<UniqueIndexVerifier>(owner_index));
+  }
+
+  // Actions for foreign keys.
+  for (const ForeignKey* foreign_key : source_table->foreign_keys()) {
+    if (foreign_key->referencing_data_table() == table) {
+      actions->verifiers.emplace_back(
           std::make_unique<ForeignKeyReferencingVerifier>(foreign_key));
     }
-    for (const ForeignKey* foreign_key : table->referencing_foreign_keys()) {
-      table_verifiers_[foreign_key->referenced_data_table()].emplace_back(
+  }
+  for (const ForeignKey* foreign_key :
+       source_table->referencing_foreign_keys()) {
+    if (foreign_key->referenced_data_table() == table) {
+      actions->verifiers.emplace_back(
           std::make_unique<ForeignKeyReferencedVerifier>(foreign_key));
     }
+  }
 
-    // Actions for check constraints.
-    for (const CheckConstraint* check_constraint : table->check_constraints()) {
-      table_verifiers_[table].emplace_back(
-          std::make_unique<CheckConstraintVerifier>(check_constraint,
-                                                    &catalog_));
-    }
+  if (owner_index != nullptr) {
+    return;
+  }
+
+  // Column value checks for all tables.
+  actions->validators.emplace_back(std::make_unique<ColumnValueValidator>());
+
+  // Row existence checks for all tables.
+  actions->validators.emplace_back(std::make_unique<RowExistenceValidator>());
 
-    // A set containing key columns with default/generated values.
-    absl::flat_hash_set<std::string> default_key_columns;
-    // Effector for primary key default columns.
-    for (const Column* column : table->columns()) {
-      if ((column->has_default_value()
-           ) &&
-          table->FindKeyColumn(column->Name()) != nullptr) {
-        default_key_columns.insert(column->Name());
-        table_generated_key_effectors_[table->Name()] =
-            std::make_unique<GeneratedColumnEffector>(table, &catalog_,
-                                                      /*for_keys=*/true);
-        break;
-      }
+  // Interleave actions for child tables.
+  for (const Table* child : table->children()) {
+    actions->validators.emplace_back(
+        std::make_unique<InterleaveParentValidator>(table, child));
+
+    actions->batch_effectors.emplace_back(
+        std::make_unique<InterleaveParentEffector>(table, child));
+  }
+
+  // Interleave actions for parent table.
+  if (table->parent() != nullptr) {
+    actions->validators.emplace_back(
+        std::make_unique<InterleaveChildValidator>(table->parent(), table));
+  }
+  // Actions for ChangeStream.
+  for (const ChangeStream* change_stream : table->change_streams()) {
+    actions->effectors.emplace_back(
+        std::make_unique<ChangeStreamEffector>(change_stream));
+  }
+  // Index effects.
+  for (const Index* index : table->indexes()) {
+    actions->effectors.emplace_back(std::make_unique<IndexEffector>(index));
+  }
+
+  // Actions for check constraints.
+  for (const CheckConstraint* check_constraint : table->check_constraints()) {
+    actions->verifiers.emplace_back(std::make_unique<CheckConstraintVerifier>(
+        check_constraint, &catalog_, expression_cache_));
+  }
+
+  // A set containing key columns with default/generated values.
+  absl::flat_hash_set<std::string> default_key_columns;
+  // Effector for primary key default columns.
+  for (const Column* column : table->columns()) {
+    if (column->has_default_value() &&
+        table->FindKeyColumn(column->Name()) != nullptr) {
+      default_key_columns.insert(column->Name());
+      actions->generated_key_effector =
+          std::make_unique<GeneratedColumnEffector>(
+              table, &catalog_, expression_cache_, /*for_keys=*/true);
+      break;
     }
+  }
 
-    // Effector for non-key generated and default columns.
-    for (const Column* column : table->columns()) {
-          if (!default_key_columns.contains(column->Name()) &&
-          (column->is_generated() || column->has_default_value())) {
-        table_effectors_[table].emplace_back(
-            std::make_unique<GeneratedColumnEffector>(table, &catalog_));
-        break;
-      }
+  // Effector for non-key generated and default columns.
+  for (const Column* column : table->columns()) {
+    if (!default_key_columns.contains(column->Name()) &&
+        (column->is_generated() || column->has_default_value())) {
+      actions->effectors.emplace_back(
+          std::make_unique<GeneratedColumnEffector>(table, &catalog_,
+                                                    expression_cache_));
+      break;
     }
   }
 }
@@ -197,12 +334,13 @@ void ActionManager::AddActionsForSchema(const Schema* schema,
                                         zetasql::TypeFactory* type_factory) {
   absl::MutexLock l(&mutex_);
   registry_[schema] =
-      std::make_unique<ActionRegistry>(schema, function_catalog, type_factory);
+      std::make_unique<ActionRegistry>(schema, function_catalog, type_factory,
+                                       &expression_cache_);
 }
 
 absl::StatusOr<ActionRegistry*> ActionManager::GetActionsForSchema(
     const Schema* schema) const {
-  absl::MutexLock l(&mutex_);
+  absl::ReaderMutexLock l(&mutex_);
   auto itr = registry_.find(schema);
   if (itr == registry_.end()) {
     return error::Internal(
@@ -212,6 +350,11 @@ absl::StatusOr<ActionRegistry*> ActionManager::GetActionsForSchema(
   return itr->second.get();
 }
 
+void ActionManager::RemoveActionsForSchema(const Schema* schema) {
+  absl::MutexLock l(&mutex_);
+  registry_.erase(schema);
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
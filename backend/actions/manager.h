@@ -25,11 +25,13 @@
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/access/write.h"
 #include "backend/actions/action.h"
 #include "backend/actions/context.h"
 #include "backend/actions/generated_column.h"
 #include "backend/actions/ops.h"
+#include "backend/actions/prepared_expression_cache.h"
 #include "backend/query/catalog.h"
 #include "backend/query/function_catalog.h"
 #include "backend/schema/catalog/schema.h"
@@ -43,12 +45,18 @@ namespace backend {
 // ActionRegistry is a collection of actions for a given schema.
 //
 // Transactions use this registry for constraint checking the writes to a
-// database.
+// database. The actions of a table are only built when the table is first
+// written to, so that a schema change does not pay for preparing the actions
+// of every table in the schema. Prepared expressions are still shared with the
+// registries of other schemas through the PreparedExpressionCache.
+//
+// This class is thread safe.
 class ActionRegistry {
  public:
   explicit ActionRegistry(const Schema* schema,
                           const FunctionCatalog* function_catalog,
-                          zetasql::TypeFactory* type_factory);
+                          zetasql::TypeFactory* type_factory,
+                          PreparedExpressionCache* expression_cache);
 
   // Executes the list of validators that apply to the given operation.
   absl::Status ExecuteValidators(const ActionContext* ctx, const WriteOp& op);
@@ -56,6 +64,13 @@ class ActionRegistry {
   // Executes the list of effectors that apply to the given operation.
   absl::Status ExecuteEffectors(const ActionContext* ctx, const WriteOp& op);
 
+  // Executes the list of batch effectors that apply to the given operations,
+  // after the operations have been buffered. The operations are grouped by
+  // table, and each batch effector adds the effects of all operations on its
+  // table at once.
+  absl::Status ExecuteBatchEffectors(const ActionContext* ctx,
+                                     const std::vector<WriteOp>& ops);
+
   // Executes the generated key effector that applies to the given mutation op.
   absl::Status ExecuteGeneratedKeyEffectors(
       const MutationOp& op,
@@ -65,40 +80,51 @@ class ActionRegistry {
   // Executes the list of modifiers that apply to the given operation.
   absl::Status ExecuteModifiers(const ActionContext* ctx, const WriteOp& op);
 
-  // Executes the list of verifiers that apply to the given operation.
-  absl::Status ExecuteVerifiers(const ActionContext* ctx, const WriteOp& op);
+  // Executes the list of verifiers that apply to the given operations. The
+  // operations are grouped by table, and each verifier checks all operations
+  // on its table at once. With enough operations, the verifiers run
+  // concurrently, so ctx must allow concurrent reads.
+  absl::Status ExecuteVerifiers(const ActionContext* ctx,
+                                const std::vector<WriteOp>& ops);
 
  private:
-  // Initialize the validators, effectors, modifiers and verifiers for each
-  // table in the given schema.
-  void BuildActionRegistry();
+  // The actions which apply to the operations on a table.
+  struct TableActions {
+    std::vector<std::unique_ptr<Validator>> validators;
+    std::vector<std::unique_ptr<Effector>> effectors;
+    // Effectors which only read the store for rows of other tables, such that
+    // they can run once for all operations of a statement on this table.
+    std::vector<std::unique_ptr<Effector>> batch_effectors;
+    // Effector for primary key columns, if any.
+    std::unique_ptr<GeneratedColumnEffector> generated_key_effector;
+    std::vector<std::unique_ptr<Modifier>> modifiers;
+    std::vector<std::unique_ptr<Verifier>> verifiers;
+  };
+
+  // Returns the actions of table, building them on first use. Actions are
+  // never removed, so the returned pointer stays valid.
+  const TableActions* GetTableActions(const Table* table)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Initializes the validators, effectors, modifiers and verifiers of table.
+  // Besides the tables of the schema, this applies to the data tables of
+  // indexes, which may have unique index and foreign key verifiers.
+  void BuildTableActions(const Table* table, TableActions* actions);
 
   // Schema used to define the registry of actions.
   const Schema* schema_;
 
-  // List of validators per table.
-  absl::node_hash_map<const Table*, std::vector<std::unique_ptr<Validator>>>
-      table_validators_;
-
-  // List of effectors per table.
-  absl::node_hash_map<const Table*, std::vector<std::unique_ptr<Effector>>>
-      table_effectors_;
-
-  // List of effectors for primary key columns per table.
-  absl::node_hash_map<const std::string,
-                      std::unique_ptr<GeneratedColumnEffector>>
-      table_generated_key_effectors_;
+  absl::Mutex mutex_;
 
-  // List of modifiers per table.
-  absl::node_hash_map<const Table*, std::vector<std::unique_ptr<Modifier>>>
-      table_modifiers_;
-
-  // List of verifiers per table.
-  absl::node_hash_map<const Table*, std::vector<std::unique_ptr<Verifier>>>
-      table_verifiers_;
+  // Actions per table, for the tables written to so far.
+  absl::node_hash_map<const Table*, std::unique_ptr<TableActions>>
+      table_actions_ ABSL_GUARDED_BY(mutex_);
 
   // Used for function resolution in actions.
   Catalog catalog_;
+
+  // Shares the prepared expressions of actions with other schemas.
+  PreparedExpressionCache* expression_cache_;
 };
 
 // ActionManager manages the registry of actions for each schema in the
@@ -114,7 +140,15 @@ class ActionManager {
   absl::StatusOr<ActionRegistry*> GetActionsForSchema(
       const Schema* schema) const;
 
+  // Drops the registry of actions for given schema, once no transaction uses
+  // the schema any more.
+  void RemoveActionsForSchema(const Schema* schema);
+
  private:
+  // Prepared check constraint and generated column expressions shared by the
+  // registries of all schemas, whose catalogs use the same FunctionCatalog.
+  PreparedExpressionCache expression_cache_;
+
   absl::node_hash_map<const Schema*, std::unique_ptr<ActionRegistry>> registry_
       ABSL_GUARDED_BY(mutex_);
 
@@ -0,0 +1,227 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/actions/manager.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "backend/actions/ops.h"
+#include "backend/actions/prepared_expression_cache.h"
+#include "backend/query/function_catalog.h"
+#include "tests/common/actions.h"
+#include "tests/common/schema_constructor.h"
+
+ABSL_DECLARE_FLAG(int, commit_verification_threads);
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql_base::testing::StatusIs;
+
+// The number of rows written to each table, such that a commit writing to all
+// of them verifies its constraints on several threads.
+constexpr int64_t kRowsPerTable = 100;
+
+class ActionManagerTest : public test::ActionsTest {
+ public:
+  ActionManagerTest()
+      : schema_(emulator::test::CreateSchemaFromDDL(
+                    {"CREATE TABLE A (k INT64, v INT64) PRIMARY KEY(k)",
+                     "CREATE UNIQUE INDEX AIndex ON A(v)",
+                     "CREATE TABLE B (k INT64, v INT64) PRIMARY KEY(k)",
+                     "CREATE UNIQUE INDEX BIndex ON B(v)",
+                     "CREATE TABLE C (k INT64, v INT64) PRIMARY KEY(k)",
+                     "CREATE UNIQUE INDEX CIndex ON C(v)"},
+                    &type_factory_)
+                    .value()) {
+    action_manager_.AddActionsForSchema(schema_.get(),
+                                        /*function_catalog=*/nullptr,
+                                        &type_factory_);
+  }
+
+  void TearDown() override {
+    absl::SetFlag(&FLAGS_commit_verification_threads, 8);
+  }
+
+  // Returns the data table of the named index.
+  const Table* IndexDataTable(absl::string_view index) {
+    return schema_->FindIndex(index)->index_data_table();
+  }
+
+  // Adds inserts of kRowsPerTable rows into the data table of index to ops,
+  // and their index entries to the store.
+  void InsertRows(absl::string_view index, std::vector<WriteOp>* ops) {
+    const Table* table = IndexDataTable(index);
+    for (int64_t k = 0; k < kRowsPerTable; ++k) {
+      Key key({Int64(k), Int64(k)});
+      ZETASQL_ASSERT_OK(store()->Insert(table, key, {}));
+      ops->push_back(Insert(table, key));
+    }
+  }
+
+  // Adds an index entry with the same indexed value as an inserted row to the
+  // data table of index, so that verifying the inserts fails.
+  void AddDuplicateEntry(absl::string_view index) {
+    ZETASQL_ASSERT_OK(store()->Insert(IndexDataTable(index),
+                              Key({Int64(kRowsPerTable / 2),
+                                   Int64(kRowsPerTable)}),
+                              {}));
+  }
+
+  // Verifies ops with at most the given number of threads.
+  absl::Status ExecuteVerifiers(const std::vector<WriteOp>& ops,
+                                int num_threads) {
+    absl::SetFlag(&FLAGS_commit_verification_threads, num_threads);
+    ZETASQL_ASSIGN_OR_RETURN(ActionRegistry * registry,
+                     action_manager_.GetActionsForSchema(schema_.get()));
+    return registry->ExecuteVerifiers(ctx(), ops);
+  }
+
+ protected:
+  // Test components.
+  zetasql::TypeFactory type_factory_;
+  std::unique_ptr<const Schema> schema_;
+  ActionManager action_manager_;
+};
+
+TEST_F(ActionManagerTest, VerifiesLargeCommitsOnAnyNumberOfThreads) {
+  std::vector<WriteOp> ops;
+  InsertRows("AIndex", &ops);
+  InsertRows("BIndex", &ops);
+  InsertRows("CIndex", &ops);
+  ZETASQL_EXPECT_OK(ExecuteVerifiers(ops, /*num_threads=*/1));
+  ZETASQL_EXPECT_OK(ExecuteVerifiers(ops, /*num_threads=*/8));
+}
+
+TEST_F(ActionManagerTest, ReturnsFirstFailedVerificationInOrder) {
+  std::vector<WriteOp> ops;
+  InsertRows("AIndex", &ops);
+  InsertRows("BIndex", &ops);
+  InsertRows("CIndex", &ops);
+  AddDuplicateEntry("BIndex");
+  AddDuplicateEntry("CIndex");
+
+  // The verifications of BIndex and CIndex both fail, and the failure of
+  // BIndex, whose operations come first, is returned however many threads
+  // run them.
+  absl::Status sequential = ExecuteVerifiers(ops, /*num_threads=*/1);
+  EXPECT_THAT(sequential, StatusIs(absl::StatusCode::kAlreadyExists,
+                                   testing::HasSubstr("BIndex")));
+  for (int num_threads : {2, 3, 8}) {
+    EXPECT_EQ(ExecuteVerifiers(ops, num_threads), sequential);
+  }
+
+  // Once the operations of CIndex come first, its failure is returned.
+  std::vector<WriteOp> reordered(ops.begin() + 2 * kRowsPerTable, ops.end());
+  reordered.insert(reordered.end(), ops.begin(),
+                   ops.begin() + 2 * kRowsPerTable);
+  sequential = ExecuteVerifiers(reordered, /*num_threads=*/1);
+  EXPECT_THAT(sequential, StatusIs(absl::StatusCode::kAlreadyExists,
+                                   testing::HasSubstr("CIndex")));
+  for (int num_threads : {2, 3, 8}) {
+    EXPECT_EQ(ExecuteVerifiers(reordered, num_threads), sequential);
+  }
+}
+
+class ActionRegistryTest : public test::ActionsTest {
+ public:
+  ActionRegistryTest() : function_catalog_(&type_factory_) {}
+
+  // Returns a schema with a check constraint on each of tables T and U, and
+  // the given extra statements.
+  std::unique_ptr<const Schema> CreateSchema(
+      std::vector<std::string> extra_statements = {}) {
+    std::vector<std::string> statements = {
+        "CREATE TABLE T (k INT64, v INT64, CONSTRAINT c CHECK (v > 0))"
+        " PRIMARY KEY(k)",
+        "CREATE TABLE U (k INT64, v INT64, CONSTRAINT d CHECK (v < 10))"
+        " PRIMARY KEY(k)"};
+    statements.insert(statements.end(), extra_statements.begin(),
+                      extra_statements.end());
+    return emulator::test::CreateSchemaFromDDL(statements, &type_factory_)
+        .value();
+  }
+
+  // Runs the modifiers of a delete from table, which builds its actions.
+  absl::Status WriteTo(ActionRegistry* registry, const Schema* schema,
+                       absl::string_view table) {
+    return registry->ExecuteModifiers(
+        ctx(), Delete(schema->FindTable(table), Key({Int64(1)})));
+  }
+
+ protected:
+  zetasql::TypeFactory type_factory_;
+  FunctionCatalog function_catalog_;
+  PreparedExpressionCache expression_cache_;
+};
+
+TEST_F(ActionRegistryTest, BuildsTableActionsOnFirstWrite) {
+  std::unique_ptr<const Schema> schema = CreateSchema();
+  ActionRegistry registry(schema.get(), &function_catalog_, &type_factory_,
+                          &expression_cache_);
+  EXPECT_EQ(expression_cache_.size(), 0);
+
+  ZETASQL_EXPECT_OK(WriteTo(&registry, schema.get(), "T"));
+  EXPECT_EQ(expression_cache_.size(), 1);
+  ZETASQL_EXPECT_OK(WriteTo(&registry, schema.get(), "T"));
+  EXPECT_EQ(expression_cache_.size(), 1);
+
+  ZETASQL_EXPECT_OK(WriteTo(&registry, schema.get(), "U"));
+  EXPECT_EQ(expression_cache_.size(), 2);
+}
+
+TEST_F(ActionRegistryTest, ReusesExpressionsOfUnchangedTables) {
+  std::unique_ptr<const Schema> schema = CreateSchema();
+  ActionRegistry registry(schema.get(), &function_catalog_, &type_factory_,
+                          &expression_cache_);
+  ZETASQL_EXPECT_OK(WriteTo(&registry, schema.get(), "T"));
+  ZETASQL_EXPECT_OK(WriteTo(&registry, schema.get(), "U"));
+  EXPECT_EQ(expression_cache_.size(), 2);
+
+  // The check constraints of T and U are not prepared again for a schema in
+  // which only another table was added.
+  std::unique_ptr<const Schema> new_schema =
+      CreateSchema({"CREATE TABLE V (k INT64, v INT64, CONSTRAINT e CHECK "
+                    "(v IS NOT NULL)) PRIMARY KEY(k)"});
+  ActionRegistry new_registry(new_schema.get(), &function_catalog_,
+                              &type_factory_, &expression_cache_);
+  ZETASQL_EXPECT_OK(WriteTo(&new_registry, new_schema.get(), "T"));
+  ZETASQL_EXPECT_OK(WriteTo(&new_registry, new_schema.get(), "U"));
+  EXPECT_EQ(expression_cache_.size(), 2);
+
+  ZETASQL_EXPECT_OK(WriteTo(&new_registry, new_schema.get(), "V"));
+  EXPECT_EQ(expression_cache_.size(), 3);
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -136,6 +136,25 @@ const Table* TableOf(const WriteOp& op) {
   return std::visit(TableVisitor(), op);
 }
 
+struct KeyVisitor {
+  template <typename OpT>
+  const Key& operator()(const OpT& op) const {
+    return op.key;
+  }
+};
+
+const Key& KeyOf(const WriteOp& op) { return std::visit(KeyVisitor(), op); }
+
+bool UpdatesAnyColumn(const UpdateOp& op,
+                      const absl::flat_hash_set<const Column*>& columns) {
+  for (const Column* column : op.columns) {
+    if (columns.contains(column)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
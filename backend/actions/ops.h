@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "zetasql/public/value.h"
+#include "absl/container/flat_hash_set.h"
 #include "backend/common/rows.h"
 #include "backend/common/variant.h"
 #include "backend/datamodel/key.h"
@@ -76,6 +77,15 @@ using WriteOp = std::variant<InsertOp, UpdateOp, DeleteOp>;
 // Returns the table of the row operation.
 const Table* TableOf(const WriteOp& op);
 
+// Returns the primary key of the row operation.
+const Key& KeyOf(const WriteOp& op);
+
+// Returns true if the update operation writes any of the given columns. Actions
+// which depend only on some columns of a row use this to skip updates which
+// cannot change their result.
+bool UpdatesAnyColumn(const UpdateOp& op,
+                      const absl::flat_hash_set<const Column*>& columns);
+
 // Streams out a string representation of the WriteOp.
 std::ostream& operator<<(std::ostream& out, const WriteOp& op);
 std::ostream& operator<<(std::ostream& out, const InsertOp& op);
@@ -0,0 +1,81 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/actions/prefix_scan.h"
+
+#include <memory>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "backend/actions/context.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+absl::Status ForEachRowWithPrefix(
+    const ReadOnlyStore* store, const Table* table,
+    absl::Span<const Key> prefixes,
+    absl::FunctionRef<absl::Status(int, const Key&)> fn) {
+  if (prefixes.empty()) {
+    return absl::OkStatus();
+  }
+  const int num_prefixes = prefixes.size();
+  const Key limit = prefixes.back().ToPrefixLimit();
+  int pos = 0;
+  while (pos < num_prefixes) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<StorageIterator> itr,
+        store->Read(table, KeyRange::ClosedOpen(prefixes[pos], limit), {}));
+    int num_skipped = 0;
+    bool seek = false;
+    while (itr->Next()) {
+      const Key& key = itr->Key();
+      // Prefixes which sort before the row have no more rows.
+      while (pos < num_prefixes && prefixes[pos].ToPrefixLimit() <= key) {
+        ++pos;
+      }
+      if (pos == num_prefixes) {
+        break;
+      }
+      if (prefixes[pos].IsPrefixOf(key)) {
+        num_skipped = 0;
+        ZETASQL_RETURN_IF_ERROR(fn(pos, key));
+      } else if (++num_skipped > kMaxSkippedRows) {
+        // The row sorts before prefixes[pos], none of whose rows have been
+        // read yet, so the scan can restart from it.
+        seek = true;
+        break;
+      }
+    }
+    ZETASQL_RETURN_IF_ERROR(itr->Status());
+    if (!seek) {
+      break;
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,55 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_PREFIX_SCAN_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_PREFIX_SCAN_H_
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "backend/actions/context.h"
+#include "backend/datamodel/key.h"
+#include "backend/schema/catalog/table.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Calls fn(i, key) for the key of each row of table which has prefixes[i] as
+// a prefix, in key order. The prefixes must be sorted and distinct, and none
+// may be a prefix of another. Stops at the first error returned by fn.
+//
+// Rather than reading each prefix separately, the prefixes are merged with a
+// scan of the table from the smallest to the largest. When the scan passes
+// more than kMaxSkippedRows consecutive rows which match no prefix, it seeks
+// directly to the next prefix instead, so sparse prefixes over a large table
+// do not read the rows between them.
+absl::Status ForEachRowWithPrefix(
+    const ReadOnlyStore* store, const Table* table,
+    absl::Span<const Key> prefixes,
+    absl::FunctionRef<absl::Status(int, const Key&)> fn);
+
+// The number of consecutive rows matching no prefix which
+// ForEachRowWithPrefix reads before seeking to the next prefix.
+inline constexpr int kMaxSkippedRows = 16;
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_PREFIX_SCAN_H_
@@ -0,0 +1,125 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/actions/prefix_scan.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+#include "tests/common/actions.h"
+#include "tests/common/schema_constructor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql_base::testing::StatusIs;
+
+class PrefixScanTest : public test::ActionsTest {
+ public:
+  PrefixScanTest()
+      : schema_(emulator::test::CreateSchemaFromDDL({R"(
+            CREATE TABLE T (
+              k1 INT64 NOT NULL,
+              k2 INT64 NOT NULL,
+            ) PRIMARY KEY (k1, k2)
+          )"},
+                                                    &type_factory_)
+                    .value()),
+        table_(schema_->FindTable("T")) {}
+
+  void SetUp() override {
+    // Each k1 has two rows.
+    for (int64_t k1 = 0; k1 < 100; ++k1) {
+      for (int64_t k2 : {1, 2}) {
+        ZETASQL_ASSERT_OK(
+            store()->Insert(table_, Key({Int64(k1), Int64(k2)}), {}));
+      }
+    }
+  }
+
+  // Returns the (prefix index, key) pairs visited for the given prefixes.
+  std::vector<std::pair<int, Key>> Scan(const std::vector<Key>& prefixes) {
+    std::vector<std::pair<int, Key>> rows;
+    ZETASQL_EXPECT_OK(ForEachRowWithPrefix(store(), table_, prefixes,
+                                   [&](int i, const Key& key) {
+                                     rows.emplace_back(i, key);
+                                     return absl::OkStatus();
+                                   }));
+    return rows;
+  }
+
+ protected:
+  // Test components.
+  zetasql::TypeFactory type_factory_;
+  std::unique_ptr<const Schema> schema_;
+
+  // Test variables.
+  const Table* table_;
+};
+
+TEST_F(PrefixScanTest, VisitsRowsOfDensePrefixes) {
+  EXPECT_THAT(
+      Scan({Key({Int64(3)}), Key({Int64(4)}), Key({Int64(6)})}),
+      testing::ElementsAre(testing::Pair(0, Key({Int64(3), Int64(1)})),
+                           testing::Pair(0, Key({Int64(3), Int64(2)})),
+                           testing::Pair(1, Key({Int64(4), Int64(1)})),
+                           testing::Pair(1, Key({Int64(4), Int64(2)})),
+                           testing::Pair(2, Key({Int64(6), Int64(1)})),
+                           testing::Pair(2, Key({Int64(6), Int64(2)}))));
+}
+
+TEST_F(PrefixScanTest, VisitsRowsOfSparsePrefixes) {
+  // More than kMaxSkippedRows rows fall between the prefixes, so the scan
+  // seeks to each of them.
+  EXPECT_THAT(
+      Scan({Key({Int64(0)}), Key({Int64(50)}), Key({Int64(99)}),
+            Key({Int64(150)})}),
+      testing::ElementsAre(testing::Pair(0, Key({Int64(0), Int64(1)})),
+                           testing::Pair(0, Key({Int64(0), Int64(2)})),
+                           testing::Pair(1, Key({Int64(50), Int64(1)})),
+                           testing::Pair(1, Key({Int64(50), Int64(2)})),
+                           testing::Pair(2, Key({Int64(99), Int64(1)})),
+                           testing::Pair(2, Key({Int64(99), Int64(2)}))));
+}
+
+TEST_F(PrefixScanTest, StopsAtFirstError) {
+  int num_rows = 0;
+  EXPECT_THAT(ForEachRowWithPrefix(store(), table_,
+                                   {Key({Int64(0)}), Key({Int64(50)})},
+                                   [&](int, const Key&) {
+                                     ++num_rows;
+                                     return absl::InternalError("stop");
+                                   }),
+              StatusIs(absl::StatusCode::kInternal));
+  EXPECT_EQ(num_rows, 1);
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,91 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/actions/prepared_expression_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "backend/query/analyzer_options.h"
+#include "backend/schema/catalog/column.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Returns the key of the cache entry for sql analyzed with columns. Column
+// names cannot contain the separators.
+std::string CacheKey(const std::string& sql,
+                     absl::Span<const Column* const> columns) {
+  std::string key = sql;
+  for (const Column* column : columns) {
+    absl::StrAppend(&key, "\n", column->Name(), " ",
+                    column->GetType()->DebugString());
+  }
+  return key;
+}
+
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<zetasql::PreparedExpression>>
+PreparedExpressionCache::GetOrPrepare(const std::string& sql,
+                                      absl::Span<const Column* const> columns,
+                                      zetasql::Catalog* catalog) {
+  std::string key = CacheKey(sql, columns);
+  {
+    absl::MutexLock lock(&mu_);
+    auto itr = expressions_.find(key);
+    if (itr != expressions_.end()) {
+      return itr->second;
+    }
+  }
+
+  // Expressions are prepared without holding the lock. If two callers prepare
+  // the same expression, the first to finish is kept.
+  auto expr = std::make_shared<zetasql::PreparedExpression>(sql);
+  zetasql::AnalyzerOptions options = MakeGoogleSqlAnalyzerOptions();
+  for (const Column* column : columns) {
+    ZETASQL_RETURN_IF_ERROR(
+        options.AddExpressionColumn(column->Name(), column->GetType()));
+  }
+  ZETASQL_RETURN_IF_ERROR(expr->Prepare(options, catalog));
+
+  absl::MutexLock lock(&mu_);
+  return expressions_.try_emplace(std::move(key), std::move(expr))
+      .first->second;
+}
+
+int PreparedExpressionCache::size() const {
+  absl::MutexLock lock(&mu_);
+  return expressions_.size();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
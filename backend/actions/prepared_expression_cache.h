@@ -0,0 +1,71 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_PREPARED_EXPRESSION_CACHE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_PREPARED_EXPRESSION_CACHE_H_
+
+#include <memory>
+#include <string>
+
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "backend/schema/catalog/column.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// PreparedExpressionCache shares the prepared expressions of check constraints
+// and generated columns between the action registries of the schemas of a
+// database, so that an expression is only analyzed again when its text or the
+// types of the columns it references change.
+//
+// Prepared expressions refer to the functions of the catalog they were
+// prepared with, so all expressions in a cache must be prepared with catalogs
+// using the same FunctionCatalog, which must outlive the cache.
+//
+// This class is thread-safe.
+class PreparedExpressionCache {
+ public:
+  // Returns the expression sql prepared with the given columns as expression
+  // columns, preparing it with catalog if it is not in the cache. Expressions
+  // which fail to prepare are not cached.
+  absl::StatusOr<std::shared_ptr<zetasql::PreparedExpression>> GetOrPrepare(
+      const std::string& sql, absl::Span<const Column* const> columns,
+      zetasql::Catalog* catalog);
+
+  // Returns the number of expressions in the cache.
+  int size() const;
+
+ private:
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<std::string,
+                      std::shared_ptr<zetasql::PreparedExpression>>
+      expressions_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_PREPARED_EXPRESSION_CACHE_H_
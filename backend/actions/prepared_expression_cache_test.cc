@@ -0,0 +1,96 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/actions/prepared_expression_cache.h"
+
+#include <memory>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "backend/query/catalog.h"
+#include "backend/query/function_catalog.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/schema.h"
+#include "tests/common/schema_constructor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql_base::testing::IsOkAndHolds;
+
+class PreparedExpressionCacheTest : public testing::Test {
+ public:
+  PreparedExpressionCacheTest()
+      : function_catalog_(&type_factory_),
+        schema_(test::CreateSchemaWithOneTable(&type_factory_)),
+        catalog_(schema_.get(), &function_catalog_, &type_factory_) {}
+
+ protected:
+  const Column* column(const std::string& name) const {
+    return schema_->FindTable("test_table")->FindColumn(name);
+  }
+
+  zetasql::TypeFactory type_factory_;
+  FunctionCatalog function_catalog_;
+  std::unique_ptr<const Schema> schema_;
+  Catalog catalog_;
+  PreparedExpressionCache cache_;
+};
+
+TEST_F(PreparedExpressionCacheTest, ReusesExpressionWithSameColumns) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto expr, cache_.GetOrPrepare("int64_col + 1", {column("int64_col")},
+                                     &catalog_));
+  EXPECT_THAT(expr->Execute({{"int64_col", Int64(1)}}),
+              IsOkAndHolds(Int64(2)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto cached_expr, cache_.GetOrPrepare(
+                            "int64_col + 1", {column("int64_col")}, &catalog_));
+  EXPECT_EQ(cached_expr, expr);
+  EXPECT_EQ(cache_.size(), 1);
+}
+
+TEST_F(PreparedExpressionCacheTest, PreparesExpressionWithOtherColumns) {
+  ZETASQL_ASSERT_OK(cache_.GetOrPrepare("int64_col IS NULL", {column("int64_col")},
+                                &catalog_));
+  ZETASQL_ASSERT_OK(cache_.GetOrPrepare("int64_col IS NULL",
+                                {column("int64_col"), column("string_col")},
+                                &catalog_));
+  EXPECT_EQ(cache_.size(), 2);
+}
+
+TEST_F(PreparedExpressionCacheTest, DoesNotCacheInvalidExpression) {
+  EXPECT_FALSE(
+      cache_.GetOrPrepare("unknown_col + 1", {column("int64_col")}, &catalog_)
+          .ok());
+  EXPECT_EQ(cache_.size(), 0);
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -16,13 +16,22 @@
 
 #include "backend/actions/unique_index.h"
 
+#include <algorithm>
+#include <memory>
+#include <variant>
+#include <vector>
+
 #include "backend/actions/action.h"
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
+#include "backend/actions/prefix_scan.h"
+#include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
 #include "backend/storage/iterator.h"
 #include "common/errors.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status_macros.h"
 
 namespace google {
@@ -59,6 +68,61 @@ absl::Status UniqueIndexVerifier::Verify(const ActionContext* ctx,
   return absl::OkStatus();
 }
 
+absl::Status UniqueIndexVerifier::VerifyBatch(
+    const ActionContext* ctx, absl::Span<const WriteOp* const> ops) const {
+  if (!index_->is_unique()) {
+    return absl::OkStatus();
+  }
+
+  const int num_key_columns = index_->key_columns().size();
+  std::vector<const InsertOp*> inserts;
+  for (const WriteOp* op : ops) {
+    if (const auto* insert_op = std::get_if<InsertOp>(op)) {
+      inserts.push_back(insert_op);
+    }
+  }
+  if (inserts.size() <= 1) {
+    for (const InsertOp* insert_op : inserts) {
+      ZETASQL_RETURN_IF_ERROR(Verify(ctx, *insert_op));
+    }
+    return absl::OkStatus();
+  }
+
+  // Inserted rows have distinct index data table keys, so two inserts with the
+  // same index key prefix are a violation regardless of the other rows.
+  std::vector<Key> index_keys;
+  index_keys.reserve(inserts.size());
+  for (const InsertOp* insert_op : inserts) {
+    index_keys.push_back(insert_op->key.Prefix(num_key_columns));
+  }
+  std::sort(index_keys.begin(), index_keys.end());
+  auto duplicate = std::adjacent_find(index_keys.begin(), index_keys.end());
+  if (duplicate != index_keys.end()) {
+    return error::UniqueIndexConstraintViolation(index_->Name(),
+                                                 duplicate->DebugString());
+  }
+
+  // Each inserted index key must have exactly one row, its own, in the index.
+  std::vector<int> num_rows(index_keys.size(), 0);
+  ZETASQL_RETURN_IF_ERROR(ForEachRowWithPrefix(
+      ctx->store(), index_->index_data_table(), index_keys,
+      [&](int i, const Key&) {
+        if (++num_rows[i] > 1) {
+          return error::UniqueIndexConstraintViolation(
+              index_->Name(), index_keys[i].DebugString());
+        }
+        return absl::OkStatus();
+      }));
+  for (int i = 0; i < static_cast<int>(index_keys.size()); ++i) {
+    if (num_rows[i] == 0) {
+      return error::Internal(
+          absl::StrCat("Missing entry for index: ", index_->Name(),
+                       " key: ", index_keys[i].DebugString()));
+    }
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -22,6 +22,7 @@
 #include "backend/actions/ops.h"
 #include "backend/schema/catalog/index.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 
 namespace google {
 namespace spanner {
@@ -39,6 +40,12 @@ class UniqueIndexVerifier : public Verifier {
  public:
   explicit UniqueIndexVerifier(const Index* index);
 
+  // Checks the inserts of a statement together. Inserts which share an index
+  // key are reported without reading the index, and the remaining index keys
+  // are checked with a single scan of the index data table.
+  absl::Status VerifyBatch(const ActionContext* ctx,
+                           absl::Span<const WriteOp* const> ops) const override;
+
  private:
   absl::Status Verify(const ActionContext* ctx,
                       const InsertOp& op) const override;
@@ -16,12 +16,15 @@
 
 #include "backend/actions/unique_index.h"
 
+#include <cstdint>
 #include <memory>
+#include <string>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
 #include "tests/common/actions.h"
 #include "tests/common/schema_constructor.h"
 
@@ -96,6 +99,62 @@ TEST_F(UniqueIndexTest, UniqueIndexKeysReturnsOk) {
                                             Key({String("value")}), {}, {})));
 }
 
+TEST_F(UniqueIndexTest, VerifyBatchOfInsertsWithSameIndexKeyFails) {
+  const Table* table = index_->index_data_table();
+  ZETASQL_EXPECT_OK(store()->Insert(table, Key({String("value"), Int64(3)}), {}, {}));
+  ZETASQL_EXPECT_OK(store()->Insert(table, Key({String("value"), Int64(4)}), {}, {}));
+
+  WriteOp first = Insert(table, Key({String("value"), Int64(3)}), {}, {});
+  WriteOp second = Insert(table, Key({String("value"), Int64(4)}), {}, {});
+  EXPECT_THAT(verifier_->VerifyBatch(ctx(), {&first, &second}),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+}
+
+TEST_F(UniqueIndexTest, VerifyBatchChecksInsertsAgainstExistingRows) {
+  const Table* table = index_->index_data_table();
+  ZETASQL_EXPECT_OK(store()->Insert(table, Key({String("a"), Int64(1)}), {}, {}));
+  ZETASQL_EXPECT_OK(store()->Insert(table, Key({String("b"), Int64(2)}), {}, {}));
+  ZETASQL_EXPECT_OK(store()->Insert(table, Key({String("c"), Int64(3)}), {}, {}));
+
+  WriteOp first = Insert(table, Key({String("a"), Int64(1)}), {}, {});
+  WriteOp third = Insert(table, Key({String("c"), Int64(3)}), {}, {});
+  ZETASQL_EXPECT_OK(verifier_->VerifyBatch(ctx(), {&first, &third}));
+
+  ZETASQL_EXPECT_OK(store()->Insert(table, Key({String("c"), Int64(4)}), {}, {}));
+  EXPECT_THAT(verifier_->VerifyBatch(ctx(), {&first, &third}),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+}
+
+TEST_F(UniqueIndexTest, VerifyBatchOfSparseDescendingIndexKeys) {
+  // TestIndex sorts string_col in descending order, so keys read back from
+  // the index data table are descending in their first column.
+  const Table* table = index_->index_data_table();
+  auto index_key = [](std::string value, int64_t id) {
+    Key key({String(value), Int64(id)});
+    key.SetColumnDescending(0, true);
+    return key;
+  };
+  for (int i = 0; i < 100; ++i) {
+    ZETASQL_EXPECT_OK(
+        store()->Insert(table, index_key(absl::StrCat("v", i), i), {}, {}));
+  }
+
+  // Many index rows fall between the inserted keys, so the scan seeks past
+  // them rather than reading them all.
+  WriteOp first = Insert(table, index_key("v10", 10), {}, {});
+  WriteOp middle = Insert(table, index_key("v50", 50), {}, {});
+  WriteOp last = Insert(table, index_key("v99", 99), {}, {});
+  ZETASQL_EXPECT_OK(verifier_->VerifyBatch(ctx(), {&middle, &last, &first}));
+
+  ZETASQL_EXPECT_OK(store()->Insert(table, index_key("v50", 100), {}, {}));
+  EXPECT_THAT(verifier_->VerifyBatch(ctx(), {&middle, &last, &first}),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+
+  WriteOp missing = Insert(table, index_key("w", 101), {}, {});
+  EXPECT_THAT(verifier_->VerifyBatch(ctx(), {&last, &missing, &first}),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
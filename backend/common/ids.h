@@ -49,8 +49,15 @@ class UniqueIdGenerator {
     return IdType{next_seq_++};
   }
 
+  // Returns the sequence number of the next ID, which can be used to start
+  // another generator that continues this one.
+  int64_t next_seq() const ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    return next_seq_;
+  }
+
  private:
-  absl::Mutex mu_;
+  mutable absl::Mutex mu_;
   int64_t next_seq_ ABSL_GUARDED_BY(mu_);
 };
 
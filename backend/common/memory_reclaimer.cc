@@ -0,0 +1,122 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/common/memory_reclaimer.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "common/metrics.h"
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Lowers the scheduling priority of the calling thread as far as it goes.
+void LowerThreadPriority() {
+#if defined(__linux__)
+  // On Linux, the nice value set for a thread ID applies to that thread only.
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+
+}  // namespace
+
+MemoryReclaimer* MemoryReclaimer::Default() {
+  static MemoryReclaimer* reclaimer = [] {
+    MemoryReclaimer* reclaimer = new MemoryReclaimer();
+    metrics::RegisterGaugeCallback(
+        "emulator_memory_reclaimer_pending_objects", {}, [reclaimer]() {
+          return std::vector<metrics::GaugeSample>{
+              {{}, static_cast<double>(reclaimer->pending())}};
+        });
+    return reclaimer;
+  }();
+  return reclaimer;
+}
+
+MemoryReclaimer::MemoryReclaimer() : thread_(&MemoryReclaimer::Run, this) {}
+
+MemoryReclaimer::~MemoryReclaimer() {
+  {
+    absl::MutexLock lock(&mu_);
+    stop_ = true;
+  }
+  thread_.join();
+}
+
+void MemoryReclaimer::Reclaim(std::shared_ptr<const void> object) {
+  if (object == nullptr) {
+    return;
+  }
+  absl::MutexLock lock(&mu_);
+  queue_.push_back(std::move(object));
+  ++num_enqueued_;
+}
+
+void MemoryReclaimer::Flush() {
+  absl::MutexLock lock(&mu_);
+  const int64_t target = num_enqueued_;
+  auto released = [this, target]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return num_released_ >= target;
+  };
+  mu_.Await(absl::Condition(&released));
+}
+
+int64_t MemoryReclaimer::pending() const {
+  absl::MutexLock lock(&mu_);
+  return num_enqueued_ - num_released_;
+}
+
+void MemoryReclaimer::Run() {
+  LowerThreadPriority();
+  auto ready = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stop_ || !queue_.empty();
+  };
+  absl::MutexLock lock(&mu_);
+  while (true) {
+    mu_.Await(absl::Condition(&ready));
+    if (queue_.empty()) {
+      return;
+    }
+    std::shared_ptr<const void> object = std::move(queue_.front());
+    queue_.pop_front();
+    // The object is released without holding the lock, so that callers of
+    // Reclaim are not blocked while it is destroyed.
+    mu_.Unlock();
+    object.reset();
+    mu_.Lock();
+    ++num_released_;
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,84 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_MEMORY_RECLAIMER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_MEMORY_RECLAIMER_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// MemoryReclaimer destroys objects on a background thread, so that freeing a
+// large structure, such as the storage of a dropped database or the rows of a
+// dropped table, does not stall the thread dropping it.
+//
+// Objects are destroyed one at a time, in the order they were handed over, by
+// a single thread which runs at the lowest scheduling priority where the
+// platform supports it, so that reclamation yields to serving requests.
+//
+// This class is thread-safe.
+class MemoryReclaimer {
+ public:
+  // Returns the process-wide reclaimer, starting its thread on first use.
+  static MemoryReclaimer* Default();
+
+  MemoryReclaimer();
+  ~MemoryReclaimer();
+
+  // Releases object on the reclamation thread. The object is destroyed there
+  // unless it is still shared with other owners, in which case it is
+  // destroyed when the last of them releases it.
+  void Reclaim(std::shared_ptr<const void> object) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns once every object handed over before the call has been released.
+  void Flush() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of objects waiting to be released.
+  int64_t pending() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  MemoryReclaimer(const MemoryReclaimer&) = delete;
+  MemoryReclaimer& operator=(const MemoryReclaimer&) = delete;
+
+  // Releases the queued objects until the reclaimer is destroyed.
+  void Run() ABSL_LOCKS_EXCLUDED(mu_);
+
+  mutable absl::Mutex mu_;
+  std::deque<std::shared_ptr<const void>> queue_ ABSL_GUARDED_BY(mu_);
+
+  // The number of objects handed over, and the number released, so far.
+  int64_t num_enqueued_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t num_released_ ABSL_GUARDED_BY(mu_) = 0;
+
+  bool stop_ ABSL_GUARDED_BY(mu_) = false;
+  std::thread thread_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_MEMORY_RECLAIMER_H_
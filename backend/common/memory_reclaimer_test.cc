@@ -0,0 +1,76 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/common/memory_reclaimer.h"
+
+#include <memory>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Notifies when destroyed.
+class Tracked {
+ public:
+  explicit Tracked(absl::Notification* destroyed) : destroyed_(destroyed) {}
+  ~Tracked() { destroyed_->Notify(); }
+
+ private:
+  absl::Notification* destroyed_;
+};
+
+TEST(MemoryReclaimerTest, DestroysObjectsInTheBackground) {
+  MemoryReclaimer reclaimer;
+  absl::Notification destroyed;
+  reclaimer.Reclaim(std::make_shared<Tracked>(&destroyed));
+  reclaimer.Flush();
+  EXPECT_TRUE(destroyed.HasBeenNotified());
+  EXPECT_EQ(reclaimer.pending(), 0);
+}
+
+TEST(MemoryReclaimerTest, SharedObjectsOutliveReclamation) {
+  MemoryReclaimer reclaimer;
+  absl::Notification destroyed;
+  auto object = std::make_shared<Tracked>(&destroyed);
+  reclaimer.Reclaim(object);
+  reclaimer.Flush();
+  EXPECT_FALSE(destroyed.HasBeenNotified());
+  object.reset();
+  EXPECT_TRUE(destroyed.HasBeenNotified());
+}
+
+TEST(MemoryReclaimerTest, DestructorReleasesPendingObjects) {
+  absl::Notification destroyed;
+  {
+    MemoryReclaimer reclaimer;
+    reclaimer.Reclaim(std::make_shared<Tracked>(&destroyed));
+  }
+  EXPECT_TRUE(destroyed.HasBeenNotified());
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,53 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/common/memory_tracker.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "common/errors.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+absl::Status MemoryTracker::Reserve(int64_t bytes) {
+  int64_t held = bytes_.load(std::memory_order_relaxed);
+  do {
+    if (limit_bytes_ > 0 && held + bytes > limit_bytes_) {
+      return error::QueryMemoryLimitExceeded(limit_bytes_);
+    }
+  } while (!bytes_.compare_exchange_weak(held, held + bytes,
+                                         std::memory_order_relaxed));
+  int64_t peak = peak_bytes_.load(std::memory_order_relaxed);
+  while (held + bytes > peak &&
+         !peak_bytes_.compare_exchange_weak(peak, held + bytes,
+                                            std::memory_order_relaxed)) {
+  }
+  return absl::OkStatus();
+}
+
+void MemoryTracker::Release(int64_t bytes) {
+  bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
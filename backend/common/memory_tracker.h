@@ -0,0 +1,74 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_MEMORY_TRACKER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_MEMORY_TRACKER_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/status/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// MemoryTracker accounts for the memory held by a single query: the rows of
+// its materialized result, and the protos they are converted to. Reservations
+// which would take the bytes held past the limit fail with RESOURCE_EXHAUSTED,
+// and the largest number of bytes held at once is kept for the query's stats.
+//
+// The tracker only counts what its callers report, and frees nothing itself.
+//
+// This class is thread-safe.
+class MemoryTracker {
+ public:
+  // A zero or negative limit tracks memory without limiting it.
+  explicit MemoryTracker(int64_t limit_bytes) : limit_bytes_(limit_bytes) {}
+
+  // Accounts for bytes more being held. Fails, without accounting for them,
+  // if they would take the bytes held past the limit.
+  absl::Status Reserve(int64_t bytes);
+
+  // Accounts for bytes which were reserved no longer being held.
+  void Release(int64_t bytes);
+
+  // Returns the number of bytes held.
+  int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+  // Returns the largest number of bytes held at once.
+  int64_t peak_bytes() const {
+    return peak_bytes_.load(std::memory_order_relaxed);
+  }
+
+  int64_t limit_bytes() const { return limit_bytes_; }
+
+ private:
+  MemoryTracker(const MemoryTracker&) = delete;
+  MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+  const int64_t limit_bytes_;
+  std::atomic<int64_t> bytes_ = 0;
+  std::atomic<int64_t> peak_bytes_ = 0;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_MEMORY_TRACKER_H_
@@ -0,0 +1,59 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "backend/common/memory_tracker.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::zetasql_base::testing::StatusIs;
+
+TEST(MemoryTrackerTest, RejectsReservationsPastTheLimit) {
+  MemoryTracker tracker(/*limit_bytes=*/100);
+  ZETASQL_EXPECT_OK(tracker.Reserve(60));
+  EXPECT_THAT(tracker.Reserve(50),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+  EXPECT_EQ(tracker.bytes(), 60);
+
+  tracker.Release(30);
+  ZETASQL_EXPECT_OK(tracker.Reserve(50));
+  EXPECT_EQ(tracker.bytes(), 80);
+}
+
+TEST(MemoryTrackerTest, KeepsPeakBytes) {
+  MemoryTracker tracker(/*limit_bytes=*/0);
+  ZETASQL_EXPECT_OK(tracker.Reserve(1000));
+  tracker.Release(1000);
+  ZETASQL_EXPECT_OK(tracker.Reserve(400));
+  EXPECT_EQ(tracker.bytes(), 400);
+  EXPECT_EQ(tracker.peak_bytes(), 1000);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
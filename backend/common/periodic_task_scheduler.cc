@@ -0,0 +1,112 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/common/periodic_task_scheduler.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+PeriodicTaskScheduler::PeriodicTaskScheduler(int num_workers) {
+  for (int i = 0; i < std::max(num_workers, 1); ++i) {
+    workers_.emplace_back(&PeriodicTaskScheduler::WorkerLoop, this);
+  }
+}
+
+PeriodicTaskScheduler::~PeriodicTaskScheduler() {
+  {
+    absl::MutexLock l(&mu_);
+    stop_ = true;
+    cvar_.SignalAll();
+  }
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+PeriodicTaskScheduler::TaskId PeriodicTaskScheduler::AddTask(
+    TaskFn fn, absl::Duration initial_delay) {
+  absl::MutexLock l(&mu_);
+  TaskId id = next_task_id_++;
+  tasks_.emplace(id, std::move(fn));
+  queue_.emplace(absl::Now() + initial_delay, id);
+  cvar_.SignalAll();
+  return id;
+}
+
+void PeriodicTaskScheduler::CancelTask(TaskId id) {
+  absl::MutexLock l(&mu_);
+  tasks_.erase(id);
+  for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+    if (it->second == id) {
+      queue_.erase(it);
+      break;
+    }
+  }
+  while (running_.contains(id)) {
+    cvar_.Wait(&mu_);
+  }
+}
+
+int PeriodicTaskScheduler::NumTasks() const {
+  absl::MutexLock l(&mu_);
+  return tasks_.size();
+}
+
+void PeriodicTaskScheduler::WorkerLoop() {
+  absl::MutexLock l(&mu_);
+  while (!stop_) {
+    if (queue_.empty()) {
+      cvar_.Wait(&mu_);
+      continue;
+    }
+    const absl::Time deadline = queue_.begin()->first;
+    if (deadline > absl::Now()) {
+      cvar_.WaitWithDeadline(&mu_, deadline);
+      continue;
+    }
+    const TaskId id = queue_.begin()->second;
+    queue_.erase(queue_.begin());
+    TaskFn fn = tasks_.at(id);
+    running_.insert(id);
+
+    mu_.Unlock();
+    const absl::Duration delay = fn();
+    mu_.Lock();
+
+    running_.erase(id);
+    // Only reschedule the task if it was not cancelled while running.
+    if (tasks_.contains(id)) {
+      queue_.emplace(absl::Now() + delay, id);
+    }
+    cvar_.SignalAll();
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,103 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_PERIODIC_TASK_SCHEDULER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_PERIODIC_TASK_SCHEDULER_H_
+
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// PeriodicTaskScheduler runs periodic tasks on a small shared pool of
+// worker threads.
+//
+// Rather than parking a dedicated thread per periodic task, e.g. per change
+// stream or database, all tasks of a scheduler are kept in a single queue
+// ordered by their next deadline, and the workers only wake up when the
+// earliest deadline is due. Each task returns the delay until its next run,
+// which lets a failed run be retried sooner than the regular interval. A task
+// which runs for long holds up a worker, so tasks which must run on time
+// should not share a scheduler with long running ones.
+class PeriodicTaskScheduler {
+ public:
+  using TaskId = int64_t;
+
+  // A periodic task. Returns how long to wait before running it again.
+  using TaskFn = std::function<absl::Duration()>;
+
+  explicit PeriodicTaskScheduler(int num_workers);
+  ~PeriodicTaskScheduler();
+
+  PeriodicTaskScheduler(const PeriodicTaskScheduler&) = delete;
+  PeriodicTaskScheduler& operator=(const PeriodicTaskScheduler&) = delete;
+
+  // Schedules fn to first run after initial_delay, and then again after each
+  // delay it returns until the task is cancelled.
+  TaskId AddTask(TaskFn fn, absl::Duration initial_delay)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Cancels the task. If the task is currently running, blocks until that run
+  // has finished. The task will not run again once this returns.
+  void CancelTask(TaskId id) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of tasks which have not been cancelled.
+  int NumTasks() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  void WorkerLoop() ABSL_LOCKS_EXCLUDED(mu_);
+
+  mutable absl::Mutex mu_;
+
+  // Signalled when a task is added, finishes running, or the scheduler stops.
+  absl::CondVar cvar_;
+
+  bool stop_ ABSL_GUARDED_BY(mu_) = false;
+
+  TaskId next_task_id_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // Tasks which have not been cancelled, by id.
+  absl::flat_hash_map<TaskId, TaskFn> tasks_ ABSL_GUARDED_BY(mu_);
+
+  // Tasks waiting for their next run, ordered by deadline.
+  std::set<std::pair<absl::Time, TaskId>> queue_ ABSL_GUARDED_BY(mu_);
+
+  // Tasks currently being run by a worker.
+  absl::flat_hash_set<TaskId> running_ ABSL_GUARDED_BY(mu_);
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_PERIODIC_TASK_SCHEDULER_H_
@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/common/periodic_task_scheduler.h"
+
+#include <atomic>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+TEST(PeriodicTaskSchedulerTest, RunsTaskRepeatedlyAtReturnedInterval) {
+  PeriodicTaskScheduler scheduler(/*num_workers=*/1);
+  std::atomic<int> runs = 0;
+  scheduler.AddTask(
+      [&runs]() {
+        ++runs;
+        return absl::Milliseconds(1);
+      },
+      absl::ZeroDuration());
+  absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (runs < 3 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_GE(runs, 3);
+}
+
+TEST(PeriodicTaskSchedulerTest, DoesNotRunTaskBeforeInitialDelay) {
+  PeriodicTaskScheduler scheduler(/*num_workers=*/1);
+  std::atomic<int> runs = 0;
+  PeriodicTaskScheduler::TaskId id = scheduler.AddTask(
+      [&runs]() {
+        ++runs;
+        return absl::Hours(1);
+      },
+      absl::Hours(1));
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_EQ(runs, 0);
+  scheduler.CancelTask(id);
+}
+
+TEST(PeriodicTaskSchedulerTest, CancelledTaskDoesNotRunAgain) {
+  PeriodicTaskScheduler scheduler(/*num_workers=*/2);
+  std::atomic<int> runs = 0;
+  PeriodicTaskScheduler::TaskId id = scheduler.AddTask(
+      [&runs]() {
+        ++runs;
+        return absl::Milliseconds(1);
+      },
+      absl::ZeroDuration());
+  absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (runs == 0 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  scheduler.CancelTask(id);
+  EXPECT_EQ(scheduler.NumTasks(), 0);
+  int runs_at_cancel = runs;
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_EQ(runs, runs_at_cancel);
+}
+
+TEST(PeriodicTaskSchedulerTest, ManyTasksShareFewWorkers) {
+  PeriodicTaskScheduler scheduler(/*num_workers=*/2);
+  constexpr int kNumTasks = 100;
+  std::atomic<int> runs = 0;
+  for (int i = 0; i < kNumTasks; ++i) {
+    scheduler.AddTask(
+        [&runs]() {
+          ++runs;
+          return absl::Hours(1);
+        },
+        absl::ZeroDuration());
+  }
+  EXPECT_EQ(scheduler.NumTasks(), kNumTasks);
+  absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (runs < kNumTasks && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(runs, kNumTasks);
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,163 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_STATS_BUCKETS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_STATS_BUCKETS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Returns the average of a total over count samples, or 0 if there are none.
+inline double Average(int64_t total, int64_t count) {
+  return count == 0 ? 0 : static_cast<double>(total) / count;
+}
+
+// Returns the average of a total duration over count samples in seconds, or 0
+// if there are none.
+inline double AverageSeconds(absl::Duration total, int64_t count) {
+  return count == 0 ? 0 : absl::ToDoubleSeconds(total) / count;
+}
+
+// StatsBuckets retains the totals of the most recent intervals of a fixed
+// length, overall and per key (e.g. per query fingerprint), for the SPANNER_SYS
+// statistics tables.
+//
+// Intervals are aligned to the Unix epoch, and only the last max_intervals are
+// retained. Within each interval at most max_tracked_keys keys are tracked.
+// Users track more keys than they report, so that a key which becomes
+// expensive later in an interval can still be reported among the top keys.
+//
+// Keys are held in a KeyMap, which needs to be an ordered map for keys which
+// cannot be hashed.
+//
+// This class is not thread-safe, its users guard it with a mutex.
+template <typename Key, typename Totals,
+          typename KeyMap = absl::flat_hash_map<Key, Totals>>
+class StatsBuckets {
+ public:
+  // The totals of one interval.
+  struct Bucket {
+    absl::Time interval_end;
+    Totals totals;
+    KeyMap keys;
+  };
+
+  StatsBuckets(absl::Duration length, int max_intervals, int max_tracked_keys)
+      : length_(length),
+        max_intervals_(max_intervals),
+        max_tracked_keys_(max_tracked_keys) {}
+
+  // Returns the end of the interval which contains time.
+  absl::Time IntervalEnd(absl::Time time) const {
+    absl::Duration since_epoch = time - absl::UnixEpoch();
+    return absl::UnixEpoch() + absl::Floor(since_epoch, length_) + length_;
+  }
+
+  // Returns the bucket of the interval which contains now, starting a new one
+  // if needed. Returns null if the interval is no longer retained.
+  Bucket* BucketAt(absl::Time now) {
+    absl::Time interval_end = IntervalEnd(now);
+    if (buckets_.empty() || buckets_.back().interval_end < interval_end) {
+      buckets_.push_back(Bucket{interval_end, Totals{}, {}});
+      while (buckets_.size() > max_intervals_) {
+        buckets_.pop_front();
+      }
+    }
+
+    // Samples normally arrive in time order, but one which completed just
+    // before a newer sample started a new interval still belongs to its own.
+    auto bucket = std::find_if(
+        buckets_.rbegin(), buckets_.rend(),
+        [&](const Bucket& b) { return b.interval_end == interval_end; });
+    return bucket == buckets_.rend() ? nullptr : &*bucket;
+  }
+
+  // Returns the totals of key within bucket, adding them if needed. Returns
+  // null if the bucket already tracks the maximum number of keys.
+  Totals* KeyTotals(Bucket* bucket, const Key& key) const {
+    auto it = bucket->keys.find(key);
+    if (it == bucket->keys.end()) {
+      if (bucket->keys.size() >= max_tracked_keys_) {
+        return nullptr;
+      }
+      it = bucket->keys.emplace(key, Totals{}).first;
+    }
+    return &it->second;
+  }
+
+  // Returns the buckets of the intervals which ended at or before now, or are
+  // in progress at now, latest first.
+  std::vector<const Bucket*> ReportedBuckets(absl::Time now) const {
+    const absl::Time current_end = IntervalEnd(now);
+    std::vector<const Bucket*> buckets;
+    for (auto bucket = buckets_.rbegin(); bucket != buckets_.rend(); ++bucket) {
+      if (bucket->interval_end <= current_end) {
+        buckets.push_back(&*bucket);
+      }
+    }
+    return buckets;
+  }
+
+  // Returns the keys of bucket with the highest value of rank, at most
+  // max_keys of them, in decreasing order of rank. Ties are broken by key.
+  template <typename Rank>
+  static std::vector<std::pair<Key, const Totals*>> TopKeys(
+      const Bucket& bucket, int max_keys, Rank rank) {
+    std::vector<std::pair<Key, const Totals*>> keys;
+    keys.reserve(bucket.keys.size());
+    for (const auto& [key, totals] : bucket.keys) {
+      keys.emplace_back(key, &totals);
+    }
+    std::sort(keys.begin(), keys.end(), [&](const auto& a, const auto& b) {
+      auto a_rank = rank(*a.second);
+      auto b_rank = rank(*b.second);
+      if (a_rank != b_rank) {
+        return a_rank > b_rank;
+      }
+      return a.first < b.first;
+    });
+    if (keys.size() > max_keys) {
+      keys.resize(max_keys);
+    }
+    return keys;
+  }
+
+ private:
+  const absl::Duration length_;
+  const int max_intervals_;
+  const int max_tracked_keys_;
+
+  // The retained buckets, oldest first.
+  std::deque<Bucket> buckets_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_STATS_BUCKETS_H_
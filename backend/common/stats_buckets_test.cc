@@ -0,0 +1,135 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/common/stats_buckets.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+struct Totals {
+  int64_t count = 0;
+};
+
+using Buckets = StatsBuckets<std::string, Totals>;
+
+absl::Time At(int seconds) {
+  return absl::UnixEpoch() + absl::Seconds(seconds);
+}
+
+std::vector<absl::Time> IntervalEnds(
+    const std::vector<const Buckets::Bucket*>& buckets) {
+  std::vector<absl::Time> ends;
+  for (const Buckets::Bucket* bucket : buckets) {
+    ends.push_back(bucket->interval_end);
+  }
+  return ends;
+}
+
+TEST(StatsBucketsTest, IntervalsAreAlignedToTheEpoch) {
+  Buckets buckets(absl::Minutes(1), /*max_intervals=*/10,
+                  /*max_tracked_keys=*/10);
+  EXPECT_EQ(buckets.IntervalEnd(At(0)), At(60));
+  EXPECT_EQ(buckets.IntervalEnd(At(59)), At(60));
+  EXPECT_EQ(buckets.IntervalEnd(At(60)), At(120));
+}
+
+TEST(StatsBucketsTest, LateSamplesAreRecordedInTheirOwnInterval) {
+  Buckets buckets(absl::Minutes(1), /*max_intervals=*/2,
+                  /*max_tracked_keys=*/10);
+  Buckets::Bucket* first = buckets.BucketAt(At(30));
+  ASSERT_NE(first, nullptr);
+  ++first->totals.count;
+  ASSERT_NE(buckets.BucketAt(At(90)), nullptr);
+
+  Buckets::Bucket* late = buckets.BucketAt(At(50));
+  ASSERT_NE(late, nullptr);
+  EXPECT_EQ(late->interval_end, At(60));
+  EXPECT_EQ(late->totals.count, 1);
+
+  // Once a newer interval starts, the oldest one is no longer retained.
+  ASSERT_NE(buckets.BucketAt(At(150)), nullptr);
+  EXPECT_EQ(buckets.BucketAt(At(50)), nullptr);
+}
+
+TEST(StatsBucketsTest, ReportsRetainedIntervalsUpToNowLatestFirst) {
+  Buckets buckets(absl::Minutes(1), /*max_intervals=*/10,
+                  /*max_tracked_keys=*/10);
+  buckets.BucketAt(At(30));
+  buckets.BucketAt(At(90));
+  buckets.BucketAt(At(150));
+  EXPECT_THAT(IntervalEnds(buckets.ReportedBuckets(At(100))),
+              ElementsAre(At(120), At(60)));
+  EXPECT_THAT(IntervalEnds(buckets.ReportedBuckets(At(200))),
+              ElementsAre(At(180), At(120), At(60)));
+}
+
+TEST(StatsBucketsTest, TracksAtMostMaxTrackedKeys) {
+  Buckets buckets(absl::Minutes(1), /*max_intervals=*/10,
+                  /*max_tracked_keys=*/2);
+  Buckets::Bucket* bucket = buckets.BucketAt(At(0));
+  ASSERT_NE(buckets.KeyTotals(bucket, "a"), nullptr);
+  ASSERT_NE(buckets.KeyTotals(bucket, "b"), nullptr);
+  EXPECT_EQ(buckets.KeyTotals(bucket, "c"), nullptr);
+  EXPECT_EQ(buckets.KeyTotals(bucket, "a"), buckets.KeyTotals(bucket, "a"));
+}
+
+TEST(StatsBucketsTest, TopKeysAreOrderedByRankThenKey) {
+  Buckets buckets(absl::Minutes(1), /*max_intervals=*/10,
+                  /*max_tracked_keys=*/10);
+  Buckets::Bucket* bucket = buckets.BucketAt(At(0));
+  buckets.KeyTotals(bucket, "a")->count = 1;
+  buckets.KeyTotals(bucket, "b")->count = 3;
+  buckets.KeyTotals(bucket, "c")->count = 3;
+  buckets.KeyTotals(bucket, "d")->count = 2;
+
+  std::vector<std::pair<std::string, int64_t>> top;
+  for (const auto& [key, totals] :
+       Buckets::TopKeys(*bucket, /*max_keys=*/3,
+                        [](const Totals& totals) { return totals.count; })) {
+    top.emplace_back(key, totals->count);
+  }
+  EXPECT_THAT(top, ElementsAre(Pair("b", 3), Pair("c", 3), Pair("d", 2)));
+}
+
+TEST(StatsBucketsTest, AveragesOfNoSamplesAreZero) {
+  EXPECT_EQ(Average(6, 4), 1.5);
+  EXPECT_EQ(Average(6, 0), 0);
+  EXPECT_EQ(AverageSeconds(absl::Seconds(3), 2), 1.5);
+  EXPECT_EQ(AverageSeconds(absl::Seconds(3), 0), 0);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,101 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/change_stream/change_stream_notifier.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+void ChangeStreamNotifier::NotifyCommit(absl::string_view change_stream_name,
+                                        absl::Time commit_timestamp) {
+  absl::MutexLock lock(&mu_);
+  absl::Time& last_commit_timestamp =
+      last_commit_timestamps_.try_emplace(change_stream_name,
+                                          absl::InfinitePast())
+          .first->second;
+  last_commit_timestamp = std::max(last_commit_timestamp, commit_timestamp);
+  commit_cvar_.SignalAll();
+}
+
+void ChangeStreamNotifier::BeginCommit(absl::string_view change_stream_name) {
+  absl::MutexLock lock(&mu_);
+  ++num_commits_in_progress_[change_stream_name];
+}
+
+void ChangeStreamNotifier::EndCommit(
+    absl::string_view change_stream_name,
+    std::optional<absl::Time> commit_timestamp) {
+  {
+    absl::MutexLock lock(&mu_);
+    auto itr = num_commits_in_progress_.find(change_stream_name);
+    if (itr != num_commits_in_progress_.end() && --itr->second == 0) {
+      num_commits_in_progress_.erase(itr);
+    }
+  }
+  if (commit_timestamp.has_value()) {
+    NotifyCommit(change_stream_name, *commit_timestamp);
+  }
+}
+
+bool ChangeStreamNotifier::MayHaveCommits(absl::string_view change_stream_name,
+                                          absl::Time since,
+                                          absl::Time until) const {
+  // Commit timestamps are never earlier than the system time at which they are
+  // reserved, so a commit before until which has passed was announced before
+  // now is read.
+  if (absl::Now() < until) {
+    return true;
+  }
+  absl::MutexLock lock(&mu_);
+  return num_commits_in_progress_.contains(change_stream_name) ||
+         LastCommitTimestamp(change_stream_name) >= since;
+}
+
+absl::Time ChangeStreamNotifier::WaitForCommit(
+    absl::string_view change_stream_name, absl::Time since,
+    absl::Duration timeout) {
+  const absl::Time deadline = absl::Now() + timeout;
+  absl::MutexLock lock(&mu_);
+  while (LastCommitTimestamp(change_stream_name) < since) {
+    if (commit_cvar_.WaitWithDeadline(&mu_, deadline)) {
+      break;
+    }
+  }
+  return LastCommitTimestamp(change_stream_name);
+}
+
+absl::Time ChangeStreamNotifier::LastCommitTimestamp(
+    absl::string_view change_stream_name) const {
+  auto itr = last_commit_timestamps_.find(change_stream_name);
+  return itr == last_commit_timestamps_.end() ? absl::InfinitePast()
+                                              : itr->second;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
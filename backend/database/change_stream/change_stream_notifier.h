@@ -0,0 +1,104 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_NOTIFIER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_NOTIFIER_H_
+
+#include <optional>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// ChangeStreamNotifier lets change stream queries wait for new records instead
+// of polling the internal change stream tables.
+//
+// Each database has a single notifier. Read-write transactions notify it when
+// they commit writes to the data or partition table of a change stream, and
+// change stream queries wait on it until a commit newer than the records they
+// have already returned arrives. Only the latest commit timestamp of each
+// change stream is kept, the records themselves are still read from storage.
+//
+// Read-write transactions also announce their commits with BeginCommit before
+// they reserve a commit timestamp, so that an idle query can tell from
+// MayHaveCommits that a window of its change stream has no records, and send a
+// heartbeat for it without reading the change stream tables.
+class ChangeStreamNotifier {
+ public:
+  // Records that a transaction which wrote to the internal tables of the named
+  // change stream committed at commit_timestamp, and wakes up waiting queries.
+  void NotifyCommit(absl::string_view change_stream_name,
+                    absl::Time commit_timestamp) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Records that a transaction which writes to the internal tables of the named
+  // change stream is committing. Called before the transaction reserves its
+  // commit timestamp, and followed by a call to EndCommit.
+  void BeginCommit(absl::string_view change_stream_name)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Records that the commit started by BeginCommit ended, and notifies it as
+  // by NotifyCommit if it committed at commit_timestamp.
+  void EndCommit(absl::string_view change_stream_name,
+                 std::optional<absl::Time> commit_timestamp)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns false if no transaction announced by BeginCommit can have
+  // committed to the named change stream at or after since and before until.
+  // This is only known once until has passed and no commit is in progress.
+  bool MayHaveCommits(absl::string_view change_stream_name, absl::Time since,
+                      absl::Time until) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Blocks until a commit to the named change stream at or after since has
+  // been notified, or until timeout passes. Returns the latest commit
+  // timestamp notified for the change stream, or absl::InfinitePast() if there
+  // has been none.
+  absl::Time WaitForCommit(absl::string_view change_stream_name,
+                           absl::Time since, absl::Duration timeout)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  absl::Time LastCommitTimestamp(absl::string_view change_stream_name) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+
+  // Signalled whenever a commit is notified.
+  absl::CondVar commit_cvar_;
+
+  // Latest commit timestamp notified for each change stream, by name.
+  absl::flat_hash_map<std::string, absl::Time> last_commit_timestamps_
+      ABSL_GUARDED_BY(mu_);
+
+  // Number of commits between BeginCommit and EndCommit for each change
+  // stream, by name.
+  absl::flat_hash_map<std::string, int> num_commits_in_progress_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_NOTIFIER_H_
@@ -0,0 +1,91 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/change_stream/change_stream_notifier.h"
+
+#include <optional>
+#include <thread>  // NOLINT
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+TEST(ChangeStreamNotifierTest, WaitReturnsAfterTimeoutWithoutCommits) {
+  ChangeStreamNotifier notifier;
+  EXPECT_EQ(notifier.WaitForCommit("cs", absl::Now(), absl::Milliseconds(1)),
+            absl::InfinitePast());
+}
+
+TEST(ChangeStreamNotifierTest, WaitReturnsImmediatelyForPastCommit) {
+  ChangeStreamNotifier notifier;
+  absl::Time t0 = absl::Now();
+  notifier.NotifyCommit("cs", t0);
+  EXPECT_EQ(notifier.WaitForCommit("cs", t0, absl::InfiniteDuration()), t0);
+}
+
+TEST(ChangeStreamNotifierTest, WaitIgnoresOtherChangeStreams) {
+  ChangeStreamNotifier notifier;
+  absl::Time t0 = absl::Now();
+  notifier.NotifyCommit("other", t0);
+  EXPECT_EQ(notifier.WaitForCommit("cs", t0, absl::Milliseconds(1)),
+            absl::InfinitePast());
+}
+
+TEST(ChangeStreamNotifierTest, CommitWakesUpWaitingQuery) {
+  ChangeStreamNotifier notifier;
+  absl::Time t0 = absl::Now();
+  std::thread committer([&]() {
+    absl::SleepFor(absl::Milliseconds(10));
+    notifier.NotifyCommit("cs", t0 + absl::Seconds(1));
+  });
+  EXPECT_EQ(notifier.WaitForCommit("cs", t0, absl::InfiniteDuration()),
+            t0 + absl::Seconds(1));
+  committer.join();
+}
+
+TEST(ChangeStreamNotifierTest, TellsWhenWindowsHaveNoCommits) {
+  ChangeStreamNotifier notifier;
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Microseconds(1);
+  EXPECT_FALSE(notifier.MayHaveCommits("cs", t0, t0));
+  // Commits may still be made before a window which has not passed yet.
+  EXPECT_TRUE(notifier.MayHaveCommits("cs", t0, t0 + absl::Hours(1)));
+
+  notifier.BeginCommit("cs");
+  EXPECT_TRUE(notifier.MayHaveCommits("cs", t0, t0));
+  EXPECT_FALSE(notifier.MayHaveCommits("other", t0, t0));
+  notifier.EndCommit("cs", t0);
+  EXPECT_TRUE(notifier.MayHaveCommits("cs", t0, t1));
+  EXPECT_FALSE(notifier.MayHaveCommits("cs", t1, t1));
+
+  // Failed commits leave no records behind.
+  notifier.BeginCommit("cs");
+  notifier.EndCommit("cs", std::nullopt);
+  EXPECT_FALSE(notifier.MayHaveCommits("cs", t1, t1));
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,79 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/change_stream/change_stream_partition_cache.h"
+
+#include <optional>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+void ChangeStreamPartitionCache::BeginChurn(
+    absl::string_view change_stream_name) {
+  absl::MutexLock lock(&mu_);
+  ++churns_[change_stream_name].num_in_progress;
+}
+
+void ChangeStreamPartitionCache::EndChurn(
+    absl::string_view change_stream_name,
+    absl::Span<const std::string> ended_partition_tokens,
+    absl::Time commit_timestamp) {
+  absl::MutexLock lock(&mu_);
+  ChangeStreamChurns& churns = churns_[change_stream_name];
+  --churns.num_in_progress;
+  // Churns of a change stream do not normally overlap, but if they do, only
+  // the partitions ended by the latest one are kept.
+  if (commit_timestamp >= churns.last_churn_timestamp) {
+    churns.last_churn_timestamp = commit_timestamp;
+    churns.last_churn_ended_tokens.clear();
+    churns.last_churn_ended_tokens.insert(ended_partition_tokens.begin(),
+                                          ended_partition_tokens.end());
+  }
+}
+
+std::optional<absl::Time> ChangeStreamPartitionCache::FindEndTime(
+    absl::string_view change_stream_name, absl::string_view partition_token,
+    absl::Time active_at) const {
+  absl::MutexLock lock(&mu_);
+  auto itr = churns_.find(change_stream_name);
+  if (itr == churns_.end()) {
+    return absl::InfiniteFuture();
+  }
+  const ChangeStreamChurns& churns = itr->second;
+  if (churns.num_in_progress > 0) {
+    return std::nullopt;
+  }
+  if (churns.last_churn_ended_tokens.contains(partition_token)) {
+    return churns.last_churn_timestamp;
+  }
+  if (churns.last_churn_timestamp <= active_at) {
+    return absl::InfiniteFuture();
+  }
+  return std::nullopt;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
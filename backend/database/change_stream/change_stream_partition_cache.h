@@ -0,0 +1,96 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_PARTITION_CACHE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_PARTITION_CACHE_H_
+
+#include <optional>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// ChangeStreamPartitionCache lets change stream queries find out whether their
+// partition has ended without reading the partition table on every scan.
+//
+// Each database has a single cache. ChangeStreamPartitionChurner records each
+// churn of a change stream's partitions in it: BeginChurn before committing,
+// and EndChurn with the commit timestamp and the ended partitions afterwards.
+// A query which has read from the partition table that its partition was
+// active at some timestamp can then ask the cache whether a churn may have
+// ended the partition since, and only reads the partition table again if so,
+// which is once per churn at most.
+//
+// Since BeginChurn is called before a churn reserves its commit timestamp, a
+// churn committed at or before a read timestamp has at least begun once reads
+// at that timestamp are safe, i.e. once a read-only transaction at that
+// timestamp has waited for the commits before it.
+class ChangeStreamPartitionCache {
+ public:
+  // Records that a churn of the named change stream is being committed.
+  void BeginChurn(absl::string_view change_stream_name)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Records that the churn started by BeginChurn ended the given partitions at
+  // commit_timestamp. A churn which failed to commit is recorded with no ended
+  // partitions and a timestamp at least as late as any it may have reserved.
+  void EndChurn(absl::string_view change_stream_name,
+                absl::Span<const std::string> ended_partition_tokens,
+                absl::Time commit_timestamp) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the end time of partition_token of the named change stream, read
+  // from the partition table as still active at active_at, as of any read
+  // timestamp at which reads are safe: the end time if the latest churn ended
+  // it, absl::InfiniteFuture() if no churn has committed after active_at, and
+  // nullopt if a churn is being committed or an earlier churn after
+  // active_at may have ended it, in which case the partition table needs to be
+  // read again.
+  std::optional<absl::Time> FindEndTime(absl::string_view change_stream_name,
+                                        absl::string_view partition_token,
+                                        absl::Time active_at) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct ChangeStreamChurns {
+    // The number of churns between BeginChurn and EndChurn.
+    int num_in_progress = 0;
+
+    // The commit timestamp of the latest churn, and the partitions it ended.
+    absl::Time last_churn_timestamp = absl::InfinitePast();
+    absl::flat_hash_set<std::string> last_churn_ended_tokens;
+  };
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<std::string, ChangeStreamChurns> churns_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_PARTITION_CACHE_H_
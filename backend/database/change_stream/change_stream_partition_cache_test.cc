@@ -0,0 +1,69 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/change_stream/change_stream_partition_cache.h"
+
+#include <optional>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+TEST(ChangeStreamPartitionCacheTest, PartitionsStayActiveWithoutChurns) {
+  ChangeStreamPartitionCache cache;
+  EXPECT_EQ(cache.FindEndTime("cs", "token", absl::Now()),
+            absl::InfiniteFuture());
+}
+
+TEST(ChangeStreamPartitionCacheTest, ReturnsEndTimesOfLatestChurn) {
+  ChangeStreamPartitionCache cache;
+  const absl::Time t0 = absl::Now();
+  const absl::Time t1 = t0 + absl::Seconds(1);
+  cache.BeginChurn("cs");
+  EXPECT_EQ(cache.FindEndTime("cs", "ended", t0), std::nullopt);
+  cache.EndChurn("cs", {"ended"}, t1);
+
+  EXPECT_EQ(cache.FindEndTime("cs", "ended", t0), t1);
+  // Partitions which were read as active after the churn are still active,
+  // while those read before it need to be read again.
+  EXPECT_EQ(cache.FindEndTime("cs", "active", t1), absl::InfiniteFuture());
+  EXPECT_EQ(cache.FindEndTime("cs", "active", t0), std::nullopt);
+  EXPECT_EQ(cache.FindEndTime("other", "active", t0), absl::InfiniteFuture());
+}
+
+TEST(ChangeStreamPartitionCacheTest, ForgetsPartitionsEndedByEarlierChurns) {
+  ChangeStreamPartitionCache cache;
+  const absl::Time t0 = absl::Now();
+  cache.BeginChurn("cs");
+  cache.EndChurn("cs", {"first"}, t0 + absl::Seconds(1));
+  cache.BeginChurn("cs");
+  cache.EndChurn("cs", {"second"}, t0 + absl::Seconds(2));
+  EXPECT_EQ(cache.FindEndTime("cs", "first", t0), std::nullopt);
+  EXPECT_EQ(cache.FindEndTime("cs", "second", t0), t0 + absl::Seconds(2));
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
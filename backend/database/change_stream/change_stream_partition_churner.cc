@@ -18,7 +18,6 @@
 
 #include <memory>  // NOLINT
 #include <string>
-#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -62,6 +61,10 @@ ABSL_FLAG(
 ABSL_FLAG(bool, enable_change_stream_churning, true,
           "Whether to enable change stream churning.");
 
+ABSL_FLAG(int, change_stream_churn_threads, 2,
+          "Number of threads shared by all databases to churn change stream "
+          "partitions.");
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -70,63 +73,64 @@ namespace backend {
 using zetasql::values::String;
 using zetasql::values::StringArray;
 
-void ChangeStreamPartitionChurner::CreateChurningThread(
+PeriodicTaskScheduler* ChangeStreamPartitionChurner::DefaultScheduler() {
+  static PeriodicTaskScheduler* scheduler = new PeriodicTaskScheduler(
+      absl::GetFlag(FLAGS_change_stream_churn_threads));
+  return scheduler;
+}
+
+void ChangeStreamPartitionChurner::CreateChurningTask(
     absl::string_view change_stream_name) {
   mu_.AssertHeld();
   if (!absl::GetFlag(FLAGS_enable_change_stream_churning)) {
     return;
   }
-  auto churning_thread = std::make_unique<ChurningThread>();
-  auto thread =
-      std::thread(&ChangeStreamPartitionChurner::PeriodicChurnPartitions, this,
-                  std::string(change_stream_name), churning_thread.get());
-  churning_thread->thread = std::move(thread);
-  churn_threads_.try_emplace(change_stream_name, std::move(churning_thread));
+  PeriodicTaskScheduler::TaskId id = scheduler_->AddTask(
+      [this, name = std::string(change_stream_name)]() {
+        return PeriodicChurnPartitions(name);
+      },
+      absl::GetFlag(FLAGS_change_stream_churn_thread_sleep_interval));
+  churn_tasks_.try_emplace(change_stream_name, id);
 }
 
-void ChangeStreamPartitionChurner::ClearChurningThread(
+void ChangeStreamPartitionChurner::ClearChurningTask(
     absl::string_view change_stream_name) {
   mu_.AssertHeld();
-  churn_threads_.erase(change_stream_name);
+  auto it = churn_tasks_.find(change_stream_name);
+  if (it == churn_tasks_.end()) {
+    return;
+  }
+  scheduler_->CancelTask(it->second);
+  churn_tasks_.erase(it);
 }
 
-void ChangeStreamPartitionChurner::ClearAllChurningThreads() {
+void ChangeStreamPartitionChurner::ClearAllChurningTasks() {
   absl::MutexLock l(&mu_);
-  churn_threads_.clear();
+  for (const auto& [change_stream_name, id] : churn_tasks_) {
+    scheduler_->CancelTask(id);
+  }
+  churn_tasks_.clear();
 }
 
-void ChangeStreamPartitionChurner::PeriodicChurnPartitions(
-    absl::string_view change_stream_name, ChurningThread* churning_thread) {
-  while (true) {
-    {
-      absl::MutexLock l(&churning_thread->mu);
-      churning_thread->mu.AwaitWithTimeout(
-          absl::Condition(&churning_thread->stop_thread),
-          absl::GetFlag(FLAGS_change_stream_churn_thread_sleep_interval));
-      if (churning_thread->stop_thread) {
-        return;
-      }
-    }
-    absl::Status s;
-    // In the current state, the emulator only allows one ongoing transaction
-    // at a time. Thus, churn might fail occasionally due to conflict with
-    // another ongoing transaction. We should retry the churn in cases of
-    // failure.
-    do {
-      s = ChurnPartitions(change_stream_name);
-
-      const auto delay =
-          absl::GetFlag(FLAGS_change_stream_churn_thread_retry_jitter) *
-          absl::Uniform<double>(absl::BitGen(), 0, 1);
-      absl::SleepFor(
-          absl::GetFlag(FLAGS_change_stream_churn_thread_retry_sleep_interval) +
-          absl::Milliseconds(delay));
-      if (!s.ok() && !absl::IsAborted(s)) {
-        ZETASQL_LOG(ERROR) << "Failed to churn change stream " << change_stream_name
-                   << " with status: " << s;
-      }
-    } while (!s.ok());
+absl::Duration ChangeStreamPartitionChurner::PeriodicChurnPartitions(
+    absl::string_view change_stream_name) {
+  // In the current state, the emulator only allows one ongoing transaction
+  // at a time. Thus, churn might fail occasionally due to conflict with
+  // another ongoing transaction. We should retry the churn in cases of
+  // failure.
+  absl::Status s = ChurnPartitions(change_stream_name);
+  if (s.ok()) {
+    return absl::GetFlag(FLAGS_change_stream_churn_thread_sleep_interval);
+  }
+  if (!absl::IsAborted(s)) {
+    ZETASQL_LOG(ERROR) << "Failed to churn change stream " << change_stream_name
+               << " with status: " << s;
   }
+  const auto delay =
+      absl::GetFlag(FLAGS_change_stream_churn_thread_retry_jitter) *
+      absl::Uniform<double>(absl::BitGen(), 0, 1);
+  return absl::GetFlag(FLAGS_change_stream_churn_thread_retry_sleep_interval) +
+         absl::Milliseconds(delay);
 }
 
 // TODO: Change stream churn transactions can potentially cause
@@ -180,7 +184,23 @@ absl::Status ChangeStreamPartitionChurner::ChurnPartitions(
     ZETASQL_RETURN_IF_ERROR(
         ChurnPartition(change_stream_name, churned_partition, txn.get()));
   }
-  return txn->Commit();
+  if (partition_cache_ == nullptr || churned_partitions.empty()) {
+    return txn->Commit();
+  }
+
+  // The churn is recorded as in progress until its commit timestamp is known,
+  // so that queries reading at or after it do not rely on the cache meanwhile.
+  partition_cache_->BeginChurn(change_stream_name);
+  absl::Status commit_status = txn->Commit();
+  absl::StatusOr<absl::Time> commit_timestamp = txn->GetCommitTimestamp();
+  if (commit_status.ok() && commit_timestamp.ok()) {
+    partition_cache_->EndChurn(change_stream_name, churned_partitions,
+                               *commit_timestamp);
+  } else {
+    // A failed commit may have reserved a timestamp, which is before now.
+    partition_cache_->EndChurn(change_stream_name, {}, clock_->Now());
+  }
+  return commit_status;
 }
 
 absl::Status ChangeStreamPartitionChurner::ChurnPartition(
@@ -213,28 +233,28 @@ void ChangeStreamPartitionChurner::Update(const Schema* schema) {
   // Iterate through the change streams in the schema.
   absl::MutexLock l(&mu_);
   absl::flat_hash_set<std::string> change_stream_names;
-  for (const auto& [change_stream_name, churn_thread] : churn_threads_) {
+  for (const auto& [change_stream_name, churn_task] : churn_tasks_) {
     change_stream_names.insert(change_stream_name);
   }
 
   for (const auto* change_stream : schema->change_streams()) {
-    // If the thread does not exist in the factory.
+    // If the change stream is not being churned yet.
     if (!change_stream_names.contains(change_stream->Name())) {
-      CreateChurningThread(change_stream->Name());
+      CreateChurningTask(change_stream->Name());
     }
   }
 
-  // Remove all nonexistent change stream threads.
+  // Cancel the tasks of all nonexistent change streams.
   for (auto& change_stream_name : change_stream_names) {
     if (schema->FindChangeStream(change_stream_name) == nullptr) {
-      ClearChurningThread(change_stream_name);
+      ClearChurningTask(change_stream_name);
     }
   }
 }
 
-int ChangeStreamPartitionChurner::GetNumThreads() {
+int ChangeStreamPartitionChurner::GetNumChurningTasks() {
   absl::MutexLock l(&mu_);
-  return churn_threads_.size();
+  return churn_tasks_.size();
 }
 
 }  // namespace backend
@@ -17,12 +17,12 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_PARTITION_CHURNER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_PARTITION_CHURNER_H_
 
-#include <thread>  // NOLINT
-
 #include "absl/base/thread_annotations.h"
 #include "absl/random/random.h"
 #include "backend/actions/manager.h"
+#include "backend/database/change_stream/change_stream_partition_cache.h"
 #include "backend/common/ids.h"
+#include "backend/common/periodic_task_scheduler.h"
 #include "backend/locking/manager.h"
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/transaction/read_write_transaction.h"
@@ -30,7 +30,7 @@
 // How often to terminate currently active change stream partitions.
 ABSL_DECLARE_FLAG(absl::Duration, change_stream_churning_interval);
 
-// How often to run the thread with the change stream churning logic.
+// How often to run the churning logic of each change stream.
 ABSL_DECLARE_FLAG(absl::Duration, change_stream_churn_thread_sleep_interval);
 
 // How long to sleep before retrying a failed change stream churn transaction.
@@ -63,7 +63,9 @@ namespace backend {
 // stream in a per-change stream background thread that will be cached
 // in this class. We will add background threads or remove background threads
 // from ChangeStreamChurningFactory every time there is a schema change that
-// adds or removes change streams.
+// adds or removes change streams. Churns are recorded in partition_cache, if
+// any, so that change stream queries can learn which partitions ended without
+// reading the partition table.
 class ChangeStreamPartitionChurner {
  public:
   using CreateReadWriteTransactionFn =
@@ -72,45 +74,37 @@ class ChangeStreamPartitionChurner {
 
   ChangeStreamPartitionChurner(
       CreateReadWriteTransactionFn create_read_write_transaction_fn,
-      Clock* clock)
+      Clock* clock, ChangeStreamPartitionCache* partition_cache = nullptr,
+      PeriodicTaskScheduler* scheduler = DefaultScheduler())
       : create_read_write_transaction_fn_(create_read_write_transaction_fn),
-        clock_(clock) {}
+        clock_(clock),
+        partition_cache_(partition_cache),
+        scheduler_(scheduler) {}
+
+  ~ChangeStreamPartitionChurner() { ClearAllChurningTasks(); }
 
-  ~ChangeStreamPartitionChurner() { ClearAllChurningThreads(); }
+  // Returns the scheduler which churns the change streams of all databases in
+  // the process.
+  static PeriodicTaskScheduler* DefaultScheduler();
 
   void Update(const Schema* schema);
 
-  int GetNumThreads();
+  // Returns the number of change streams whose partitions are being churned.
+  int GetNumChurningTasks();
 
  private:
-  std::vector<std::string> GetAllChangeStreamNames() const;
-
-  struct ChurningThread {
-    std::thread thread;
-    bool stop_thread ABSL_GUARDED_BY(mu) = false;
-    absl::Mutex mu;
-
-    ~ChurningThread() {
-      {
-        absl::MutexLock l(&mu);
-        ZETASQL_LOG(ERROR) << "Stopping ChurningThread ";
-        stop_thread = true;
-      }
-      // Join the thread.
-      thread.join();
-    }
-  };
+  void CreateChurningTask(absl::string_view change_stream_name);
 
-  void CreateChurningThread(absl::string_view change_stream_name);
+  void ClearChurningTask(absl::string_view change_stream_name);
 
-  void ClearChurningThread(absl::string_view change_stream_name);
-
-  void ClearAllChurningThreads();
+  void ClearAllChurningTasks();
 
   absl::Status ChurnPartitions(absl::string_view change_stream_name);
 
-  void PeriodicChurnPartitions(absl::string_view change_stream_name,
-                               ChurningThread* churning_thread);
+  // Runs one churn of the change stream's partitions and returns the delay
+  // until the next one, which is shorter if the churn failed and should be
+  // retried.
+  absl::Duration PeriodicChurnPartitions(absl::string_view change_stream_name);
 
   absl::Status ChurnPartition(absl::string_view change_stream_name,
                               absl::string_view partition_token,
@@ -121,10 +115,17 @@ class ChangeStreamPartitionChurner {
   // Clock shared across emulator components.
   Clock* clock_;
 
+  // Cache of the partition end times, notified of every churn. Not owned, may
+  // be null.
+  ChangeStreamPartitionCache* partition_cache_;
+
+  // Scheduler running the churning tasks. Not owned.
+  PeriodicTaskScheduler* scheduler_;
+
   mutable absl::Mutex mu_;
 
-  absl::flat_hash_map<std::string, std::unique_ptr<ChurningThread>>
-      churn_threads_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, PeriodicTaskScheduler::TaskId>
+      churn_tasks_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace backend
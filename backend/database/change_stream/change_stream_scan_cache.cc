@@ -0,0 +1,162 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/change_stream/change_stream_scan_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+ChangeStreamScanCache::Subscription&
+ChangeStreamScanCache::Subscription::operator=(Subscription&& other) {
+  if (this != &other) {
+    if (cache_ != nullptr) {
+      cache_->Unsubscribe(*this);
+    }
+    cache_ = other.cache_;
+    key_ = std::move(other.key_);
+    id_ = other.id_;
+    other.cache_ = nullptr;
+  }
+  return *this;
+}
+
+ChangeStreamScanCache::Subscription::~Subscription() {
+  if (cache_ != nullptr) {
+    cache_->Unsubscribe(*this);
+  }
+}
+
+ChangeStreamScanCache::Subscription ChangeStreamScanCache::Subscribe(
+    absl::string_view change_stream_name, absl::string_view partition_token,
+    absl::Time start) {
+  Subscription subscription;
+  subscription.cache_ = this;
+  subscription.key_ = {std::string(change_stream_name),
+                       std::string(partition_token)};
+  absl::MutexLock lock(&mu_);
+  subscription.id_ = next_subscription_id_++;
+  std::unique_ptr<Partition>& partition = partitions_[subscription.key_];
+  if (partition == nullptr) {
+    partition = std::make_unique<Partition>();
+  }
+  partition->positions[subscription.id_] = start;
+  return subscription;
+}
+
+void ChangeStreamScanCache::Unsubscribe(const Subscription& subscription) {
+  absl::MutexLock lock(&mu_);
+  auto it = partitions_.find(subscription.key_);
+  if (it == partitions_.end()) {
+    return;
+  }
+  it->second->positions.erase(subscription.id_);
+  if (it->second->positions.empty()) {
+    partitions_.erase(it);
+  }
+}
+
+void ChangeStreamScanCache::Trim(Partition* partition) {
+  absl::Time slowest = absl::InfiniteFuture();
+  for (const auto& [id, position] : partition->positions) {
+    slowest = std::min(slowest, position);
+  }
+  partition->covered_start = std::max(partition->covered_start, slowest);
+  std::deque<Record>& records = partition->records;
+  while (static_cast<int64_t>(records.size()) > max_records_per_partition_) {
+    partition->covered_start =
+        std::max(partition->covered_start,
+                 records.front().commit_timestamp + absl::Microseconds(1));
+    records.pop_front();
+  }
+  while (!records.empty() &&
+         records.front().commit_timestamp < partition->covered_start) {
+    records.pop_front();
+  }
+  partition->covered_end =
+      std::max(partition->covered_end, partition->covered_start);
+}
+
+absl::StatusOr<std::vector<ChangeStreamScanCache::Record>>
+ChangeStreamScanCache::Read(Subscription* subscription, absl::Time start,
+                            absl::Time end, const Scanner& scan) {
+  mu_.Lock();
+  // The partition stays in the cache for as long as it has subscribers.
+  Partition* partition = partitions_.at(subscription->key_).get();
+  partition->positions[subscription->id_] = start;
+  while (true) {
+    while (partition->scanning) {
+      scanned_.Wait(&mu_);
+    }
+    Trim(partition);
+    if (start < partition->covered_start) {
+      // The records have been dropped to keep within the bound, so scan them
+      // without the cache.
+      partition->positions[subscription->id_] = end;
+      mu_.Unlock();
+      return scan(start, end);
+    }
+    if (end <= partition->covered_end) {
+      const std::deque<Record>& records = partition->records;
+      auto first = std::partition_point(
+          records.begin(), records.end(),
+          [&](const Record& r) { return r.commit_timestamp < start; });
+      auto last = std::partition_point(
+          first, records.end(),
+          [&](const Record& r) { return r.commit_timestamp < end; });
+      std::vector<Record> result(first, last);
+      partition->positions[subscription->id_] = end;
+      mu_.Unlock();
+      return result;
+    }
+    // Extend the cache up to the end of this window, while the subscribers
+    // that need the same records wait for them.
+    const absl::Time scan_start = partition->covered_end;
+    partition->scanning = true;
+    mu_.Unlock();
+    absl::StatusOr<std::vector<Record>> scanned = scan(scan_start, end);
+    mu_.Lock();
+    partition->scanning = false;
+    scanned_.SignalAll();
+    if (!scanned.ok()) {
+      mu_.Unlock();
+      return scanned.status();
+    }
+    for (Record& record : *scanned) {
+      partition->records.push_back(std::move(record));
+    }
+    partition->covered_end = end;
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
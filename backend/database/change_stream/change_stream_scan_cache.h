@@ -0,0 +1,140 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_SCAN_CACHE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_SCAN_CACHE_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// ChangeStreamScanCache shares the scans of the data change records of a
+// change stream partition between the queries reading that partition.
+//
+// Each database has a single cache. A partition query subscribes to its
+// partition at its start time and then reads consecutive windows of records
+// through the cache. The first query to reach a window scans the data table
+// for it and adds the records to the cache; other queries wait for that scan
+// rather than repeating it, and then copy the records of their own windows out
+// of the cache. Each query streams its records back at its own pace. The cache
+// keeps a partition's records from the position of its slowest subscriber
+// onwards, up to a bound past which subscribers that fell behind scan for
+// themselves, and drops them once the partition has no subscribers left.
+class ChangeStreamScanCache {
+ public:
+  // A data change record with the commit timestamp it is ordered by.
+  struct Record {
+    absl::Time commit_timestamp;
+    zetasql::Value change_record;
+  };
+
+  // Returns the records committed in [start, end), ordered by commit timestamp.
+  // A scanner must see every commit before end, i.e. it must read at or after
+  // end.
+  using Scanner = std::function<absl::StatusOr<std::vector<Record>>(
+      absl::Time start, absl::Time end)>;
+
+  // A query's subscription to a partition, which is dropped when destroyed.
+  class Subscription {
+   public:
+    Subscription() = default;
+    Subscription(Subscription&& other) { *this = std::move(other); }
+    Subscription& operator=(Subscription&& other);
+    ~Subscription();
+
+   private:
+    friend class ChangeStreamScanCache;
+
+    ChangeStreamScanCache* cache_ = nullptr;
+    std::pair<std::string, std::string> key_;
+    int64_t id_ = 0;
+  };
+
+  static constexpr int64_t kDefaultMaxRecordsPerPartition = 10000;
+
+  explicit ChangeStreamScanCache(
+      int64_t max_records_per_partition = kDefaultMaxRecordsPerPartition)
+      : max_records_per_partition_(max_records_per_partition) {}
+
+  // Subscribes to partition_token of the named change stream at start, before
+  // which the subscriber will not read.
+  Subscription Subscribe(absl::string_view change_stream_name,
+                         absl::string_view partition_token, absl::Time start)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the records of the subscribed partition committed in [start, end),
+  // calling scan for those not cached yet. start must not be before the end
+  // of the subscription's previous read, and scan must be able to read up to
+  // end.
+  absl::StatusOr<std::vector<Record>> Read(Subscription* subscription,
+                                           absl::Time start, absl::Time end,
+                                           const Scanner& scan)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Partition {
+    // The position of each subscriber, by subscription id.
+    std::map<int64_t, absl::Time> positions;
+
+    // Every record committed in [covered_start, covered_end), in order.
+    absl::Time covered_start = absl::InfinitePast();
+    absl::Time covered_end = absl::InfinitePast();
+    std::deque<Record> records;
+
+    // Whether a subscriber is scanning past covered_end.
+    bool scanning = false;
+  };
+
+  void Unsubscribe(const Subscription& subscription) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Drops the records before the slowest subscriber, and the oldest records
+  // over the bound.
+  void Trim(Partition* partition) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t max_records_per_partition_;
+
+  absl::Mutex mu_;
+  absl::CondVar scanned_;
+  int64_t next_subscription_id_ ABSL_GUARDED_BY(mu_) = 1;
+  absl::flat_hash_map<std::pair<std::string, std::string>,
+                      std::unique_ptr<Partition>>
+      partitions_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_CHANGE_STREAM_CHANGE_STREAM_SCAN_CACHE_H_
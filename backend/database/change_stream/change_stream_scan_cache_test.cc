@@ -0,0 +1,155 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/change_stream/change_stream_scan_cache.h"
+
+#include <cstdint>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using ::testing::ElementsAre;
+using Record = ChangeStreamScanCache::Record;
+
+const absl::Time kEpoch = absl::FromUnixSeconds(0);
+
+absl::Time At(int64_t seconds) { return kEpoch + absl::Seconds(seconds); }
+
+// A scanner over a record committed every second, which counts its scans.
+class FakeDataTable {
+ public:
+  ChangeStreamScanCache::Scanner Scanner() {
+    return [this](absl::Time start,
+                  absl::Time end) -> absl::StatusOr<std::vector<Record>> {
+      absl::MutexLock lock(&mu_);
+      scans_.push_back({absl::ToUnixSeconds(start), absl::ToUnixSeconds(end)});
+      std::vector<Record> records;
+      for (absl::Time t = start; t < end; t += absl::Seconds(1)) {
+        records.push_back(
+            {t, zetasql::values::Int64(absl::ToUnixSeconds(t))});
+      }
+      return records;
+    };
+  }
+
+  std::vector<std::pair<int64_t, int64_t>> scans() {
+    absl::MutexLock lock(&mu_);
+    return scans_;
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<std::pair<int64_t, int64_t>> scans_;
+};
+
+std::vector<int64_t> Seconds(const absl::StatusOr<std::vector<Record>>& read) {
+  std::vector<int64_t> seconds;
+  for (const Record& record : read.value()) {
+    seconds.push_back(record.change_record.int64_value());
+  }
+  return seconds;
+}
+
+TEST(ChangeStreamScanCacheTest, ReadersOfPartitionShareScans) {
+  ChangeStreamScanCache cache;
+  FakeDataTable table;
+  auto fast = cache.Subscribe("cs", "token", At(0));
+  auto slow = cache.Subscribe("cs", "token", At(0));
+  auto other = cache.Subscribe("cs", "other", At(0));
+
+  EXPECT_THAT(Seconds(cache.Read(&fast, At(0), At(2), table.Scanner())),
+              ElementsAre(0, 1));
+  EXPECT_THAT(Seconds(cache.Read(&fast, At(2), At(4), table.Scanner())),
+              ElementsAre(2, 3));
+  // The slower reader reads its own windows from the cache, and only scans
+  // past the records the faster one has scanned.
+  EXPECT_THAT(Seconds(cache.Read(&slow, At(0), At(3), table.Scanner())),
+              ElementsAre(0, 1, 2));
+  EXPECT_THAT(Seconds(cache.Read(&slow, At(3), At(5), table.Scanner())),
+              ElementsAre(3, 4));
+  EXPECT_THAT(Seconds(cache.Read(&other, At(0), At(1), table.Scanner())),
+              ElementsAre(0));
+  EXPECT_THAT(table.scans(), ElementsAre(std::pair<int64_t, int64_t>{0, 2},
+                                         std::pair<int64_t, int64_t>{2, 4},
+                                         std::pair<int64_t, int64_t>{4, 5},
+                                         std::pair<int64_t, int64_t>{0, 1}));
+}
+
+TEST(ChangeStreamScanCacheTest, ConcurrentReadersWaitForSameScan) {
+  ChangeStreamScanCache cache;
+  FakeDataTable table;
+  absl::Notification scanning;
+  absl::Notification proceed;
+  ChangeStreamScanCache::Scanner blocking_scanner =
+      [&](absl::Time start, absl::Time end) {
+        scanning.Notify();
+        proceed.WaitForNotification();
+        return table.Scanner()(start, end);
+      };
+  auto first = cache.Subscribe("cs", "token", At(0));
+  auto second = cache.Subscribe("cs", "token", At(0));
+
+  std::thread scanner([&]() {
+    EXPECT_THAT(Seconds(cache.Read(&first, At(0), At(3), blocking_scanner)),
+                ElementsAre(0, 1, 2));
+  });
+  scanning.WaitForNotification();
+  std::thread waiter([&]() {
+    EXPECT_THAT(Seconds(cache.Read(&second, At(0), At(2), table.Scanner())),
+                ElementsAre(0, 1));
+  });
+  proceed.Notify();
+  scanner.join();
+  waiter.join();
+  EXPECT_EQ(table.scans().size(), 1);
+}
+
+TEST(ChangeStreamScanCacheTest, ReadersBehindBoundScanForThemselves) {
+  ChangeStreamScanCache cache(/*max_records_per_partition=*/2);
+  FakeDataTable table;
+  auto fast = cache.Subscribe("cs", "token", At(0));
+  auto slow = cache.Subscribe("cs", "token", At(0));
+
+  EXPECT_THAT(Seconds(cache.Read(&fast, At(0), At(2), table.Scanner())),
+              ElementsAre(0, 1));
+  EXPECT_THAT(Seconds(cache.Read(&fast, At(2), At(4), table.Scanner())),
+              ElementsAre(2, 3));
+  EXPECT_THAT(Seconds(cache.Read(&slow, At(0), At(2), table.Scanner())),
+              ElementsAre(0, 1));
+  // The slower reader caught up with the cached records.
+  EXPECT_THAT(Seconds(cache.Read(&slow, At(2), At(4), table.Scanner())),
+              ElementsAre(2, 3));
+  EXPECT_EQ(table.scans().size(), 3);
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
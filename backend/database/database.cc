@@ -16,26 +16,75 @@
 
 #include "backend/database/database.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <string>
 #include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/functional/bind_front.h"
 #include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
+#include "backend/access/read.h"
 #include "backend/actions/manager.h"
 #include "backend/common/ids.h"
+#include "backend/common/periodic_task_scheduler.h"
+#include "backend/database/change_stream/change_stream_notifier.h"
 #include "backend/database/change_stream/change_stream_partition_churner.h"
+#include "backend/database/snapshot.pb.h"
+#include "backend/database/write_ahead_log.h"
+#include "backend/database/write_ahead_log.pb.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
 #include "backend/locking/manager.h"
 #include "backend/query/query_engine.h"
+#include "backend/schema/backfills/index_backfill.h"
+#include "backend/schema/catalog/change_stream.h"
+#include "backend/schema/catalog/check_constraint.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/foreign_key.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
 #include "backend/schema/catalog/versioned_catalog.h"
+#include "backend/schema/ddl/operations.pb.h"
+#include "backend/schema/parser/ddl_parser.h"
+#include "backend/schema/printer/print_ddl.h"
 #include "backend/schema/updater/schema_updater.h"
+#include "backend/schema/updater/schema_validation_context.h"
 #include "backend/schema/updater/scoped_schema_change_lock.h"
+#include "backend/schema/verifiers/check_constraint_verifiers.h"
+#include "backend/schema/verifiers/column_value_verifiers.h"
+#include "backend/schema/verifiers/foreign_key_verifiers.h"
+#include "backend/storage/commit_timestamp_index.h"
+#include "backend/storage/compact_in_memory_storage.h"
+#include "backend/storage/disk_storage.h"
+#include "backend/storage/fixture_storage.h"
 #include "backend/storage/in_memory_storage.h"
+#include "backend/storage/key_access_heatmap.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/partitioned_scan.h"
+#include "backend/storage/storage.h"
+#include "backend/storage/value_interner.h"
 #include "backend/transaction/options.h"
+#include "common/config.h"
+#include "common/errors.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
@@ -44,20 +93,668 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+// Reads check the stale read limit before reading from storage, so versions are
+// kept for a little longer than the limit to avoid collecting versions needed
+// by a read which has just passed the check.
+constexpr absl::Duration kVersionGcSafetyMargin = absl::Minutes(1);
+
+// Released read write transactions kept for reuse. Single-use transactions
+// are short lived, so a few of them cover many concurrent RPCs.
+constexpr size_t kMaxPooledTransactions = 64;
+
+// The number of workers collecting the garbage of all databases. A pass over a
+// large database can take a while, so a few of them keep the passes of other
+// databases from waiting on it.
+constexpr int kVersionGcWorkers = 2;
+
+// Returns the scheduler which runs the periodic version garbage collection of
+// all databases in the process, so that databases do not each keep a thread of
+// their own waiting for the next run.
+PeriodicTaskScheduler* VersionGcScheduler() {
+  static PeriodicTaskScheduler* scheduler =
+      new PeriodicTaskScheduler(kVersionGcWorkers);
+  return scheduler;
+}
+
+// Returns the scheduler which aborts the idle transactions of all databases in
+// the process. Aborts are quick, and have a worker of their own so that they
+// never wait behind a garbage collection pass.
+PeriodicTaskScheduler* IdleTransactionReaperScheduler() {
+  static PeriodicTaskScheduler* scheduler =
+      new PeriodicTaskScheduler(/*num_workers=*/1);
+  return scheduler;
+}
+
+// Appends the IDs of the storage tables holding the rows of the tables, indexes
+// and change streams of schema to table_ids.
+void AddDataTableIds(const Schema* schema, std::vector<TableID>* table_ids) {
+  for (const Table* table : schema->tables()) {
+    table_ids->push_back(table->id());
+    for (const Index* index : table->indexes()) {
+      table_ids->push_back(index->index_data_table()->id());
+    }
+  }
+  for (const ChangeStream* change_stream : schema->change_streams()) {
+    table_ids->push_back(change_stream->change_stream_data_table()->id());
+    table_ids->push_back(change_stream->change_stream_partition_table()->id());
+  }
+}
+
+// Returns true if statement is an ANALYZE statement.
+bool IsAnalyzeStatement(absl::string_view statement) {
+  if (!absl::StrContainsIgnoreCase(statement, "ANALYZE")) {
+    return false;
+  }
+  ddl::DDLStatement ddl_statement;
+  return ddl::ParseDDLStatement(statement, &ddl_statement).ok() &&
+         ddl_statement.has_analyze();
+}
+
+// Returns true if table has a column which allows commit timestamps.
+bool AllowsCommitTimestamps(const Table* table) {
+  return std::any_of(
+      table->columns().begin(), table->columns().end(),
+      [](const Column* column) { return column->allows_commit_timestamp(); });
+}
+
+// Returns true if statement drops an index of schema which is still being
+// backfilled online. Its CREATE INDEX statement is only logged once the index
+// is readable, so neither is the DROP INDEX.
+bool DropsWriteOnlyIndex(const Schema* schema, absl::string_view statement) {
+  ddl::DDLStatement ddl_statement;
+  if (!ddl::ParseDDLStatement(statement, &ddl_statement).ok() ||
+      !ddl_statement.has_drop_index()) {
+    return false;
+  }
+  const Index* index =
+      schema->FindIndex(ddl_statement.drop_index().index_name());
+  return index != nullptr && index->is_write_only();
+}
+
+// Returns true if statement changes the schema without reading or rewriting
+// any data, so that read-write transactions which started before it can
+// commit after it without violating the new schema. Enabling commit
+// timestamps on a column is not, as its values are verified to be in the
+// past and a concurrent transaction could still write a later one.
+bool IsDataIndependentStatement(absl::string_view statement) {
+  ddl::DDLStatement ddl_statement;
+  if (!ddl::ParseDDLStatement(statement, &ddl_statement).ok()) {
+    return false;
+  }
+  switch (ddl_statement.statement_case()) {
+    case ddl::DDLStatement::kCreateFunction:
+    case ddl::DDLStatement::kDropFunction:
+      return true;
+    case ddl::DDLStatement::kSetColumnOptions:
+      return std::none_of(
+          ddl_statement.set_column_options().options().begin(),
+          ddl_statement.set_column_options().options().end(),
+          [](const ddl::SetOption& option) {
+            return option.option_name() == ddl::kCommitTimestampOptionName &&
+                   option.bool_value();
+          });
+    case ddl::DDLStatement::kAlterTable: {
+      if (!ddl_statement.alter_table().has_add_column()) {
+        return false;
+      }
+      const ddl::ColumnDefinition& column =
+          ddl_statement.alter_table().add_column().column();
+      return !column.not_null() && !column.has_column_default() &&
+             !column.has_generated_column();
+    }
+    default:
+      return false;
+  }
+}
+
+// Builds the statistics of data_table, a table or index data table, from its
+// rows at timestamp.
+absl::StatusOr<TableStatistics> ComputeTableStatistics(
+    const Storage* storage, const Table* data_table, absl::Time timestamp) {
+  std::vector<ColumnID> column_ids;
+  for (const KeyColumn* key_column : data_table->primary_key()) {
+    column_ids.push_back(key_column->column()->id());
+  }
+  std::vector<ColumnID> value_column_ids;
+  for (const Column* column : data_table->columns()) {
+    if (data_table->FindKeyColumn(column->Name()) == nullptr) {
+      value_column_ids.push_back(column->id());
+    }
+  }
+  column_ids.insert(column_ids.end(), value_column_ids.begin(),
+                    value_column_ids.end());
+
+  TableStatisticsBuilder builder(column_ids, data_table->primary_key().size());
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_RETURN_IF_ERROR(storage->Read(timestamp, data_table->id(), KeyRange::All(),
+                                value_column_ids, &itr));
+  std::vector<zetasql::Value> row;
+  while (itr->Next()) {
+    row.clear();
+    for (int i = 0; i < itr->Key().NumColumns(); ++i) {
+      row.push_back(itr->Key().ColumnValue(i));
+    }
+    for (int i = 0; i < itr->NumColumns(); ++i) {
+      row.push_back(itr->ColumnValue(i));
+    }
+    builder.AddRow(row);
+  }
+  ZETASQL_RETURN_IF_ERROR(itr->Status());
+  return std::move(builder).Build();
+}
+
+// Reads every row of table, or of index if it is non-null, into table_snapshot.
+absl::Status SnapshotRows(ReadOnlyTransaction* txn, const Table* table,
+                          const Index* index, TableSnapshot* table_snapshot) {
+  ReadArg read_arg;
+  read_arg.table = table->Name();
+  read_arg.key_set = KeySet::All();
+  const Table* data_table = table;
+  if (index != nullptr) {
+    read_arg.index = index->Name();
+    data_table = index->index_data_table();
+    table_snapshot->set_name(index->Name());
+    table_snapshot->set_is_index(true);
+  } else {
+    table_snapshot->set_name(table->Name());
+  }
+  for (const Column* column : data_table->columns()) {
+    read_arg.columns.push_back(column->Name());
+    table_snapshot->add_columns(column->Name());
+  }
+
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_RETURN_IF_ERROR(txn->Read(read_arg, &cursor));
+  while (cursor->Next()) {
+    TableSnapshot::Row* row = table_snapshot->add_rows();
+    for (int i = 0; i < cursor->NumColumns(); ++i) {
+      ZETASQL_RETURN_IF_ERROR(cursor->ColumnValue(i).Serialize(row->add_values()));
+    }
+  }
+  return cursor->Status();
+}
+
+// Writes every row of data_table visible at timestamp to writer, as the rows of
+// the fixture table with the given name.
+absl::Status WriteFixtureRows(const Storage& storage, absl::Time timestamp,
+                              const std::string& name, bool is_index,
+                              const Table* data_table, FixtureWriter* writer) {
+  std::vector<std::string> column_names;
+  std::vector<ColumnID> column_ids;
+  for (const Column* column : data_table->columns()) {
+    column_names.push_back(column->Name());
+    column_ids.push_back(column->id());
+  }
+  ZETASQL_RETURN_IF_ERROR(writer->AddTable(name, is_index, column_names));
+
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_RETURN_IF_ERROR(storage.Read(timestamp, data_table->id(),
+                               KeyRange::All(), column_ids, &itr));
+  std::vector<zetasql::Value> values;
+  while (itr->Next()) {
+    values.clear();
+    for (int i = 0; i < itr->NumColumns(); ++i) {
+      values.push_back(itr->ColumnValue(i));
+    }
+    ZETASQL_RETURN_IF_ERROR(writer->AddRow(itr->Key(), values));
+  }
+  return itr->Status();
+}
+
+// The storage table and columns which the rows of a snapshot table are written
+// to. Unlike the schema objects it is resolved from, it can be kept after the
+// schema is destroyed, as long as the types of the columns are.
+struct SnapshotTable {
+  TableID table_id;
+  std::vector<ColumnID> column_ids;
+  std::vector<const zetasql::Type*> column_types;
+
+  // The positions of the key columns in column_ids, in key order.
+  std::vector<int> key_positions;
+  std::vector<bool> key_descending;
+};
+
+// Resolves the columns of table_snapshot in schema.
+absl::StatusOr<SnapshotTable> ResolveSnapshotTable(
+    const Schema* schema, const TableSnapshot& table_snapshot) {
+  const Table* table = nullptr;
+  if (table_snapshot.is_index()) {
+    const Index* index = schema->FindIndex(table_snapshot.name());
+    if (index != nullptr) {
+      table = index->index_data_table();
+    }
+  } else {
+    table = schema->FindTable(table_snapshot.name());
+  }
+  if (table == nullptr) {
+    return error::Internal(absl::StrCat(
+        "Snapshot contains rows for unknown ",
+        table_snapshot.is_index() ? "index " : "table ", table_snapshot.name()));
+  }
+
+  std::vector<const Column*> columns;
+  for (const std::string& column_name : table_snapshot.columns()) {
+    const Column* column = table->FindColumn(column_name);
+    if (column == nullptr) {
+      return error::Internal(absl::StrCat("Snapshot contains unknown column ",
+                                          column_name, " for ",
+                                          table_snapshot.name()));
+    }
+    columns.push_back(column);
+  }
+  std::vector<int> key_positions;
+  for (const KeyColumn* key_column : table->primary_key()) {
+    auto itr = std::find(columns.begin(), columns.end(), key_column->column());
+    if (itr == columns.end()) {
+      return error::Internal(absl::StrCat("Snapshot is missing key column ",
+                                          key_column->column()->Name(),
+                                          " for ", table_snapshot.name()));
+    }
+    key_positions.push_back(itr - columns.begin());
+  }
+
+  SnapshotTable snapshot_table{.table_id = table->id(),
+                               .key_positions = std::move(key_positions)};
+  for (const Column* column : columns) {
+    snapshot_table.column_ids.push_back(column->id());
+    snapshot_table.column_types.push_back(column->GetType());
+  }
+  for (const KeyColumn* key_column : table->primary_key()) {
+    snapshot_table.key_descending.push_back(key_column->is_descending());
+  }
+  return snapshot_table;
+}
+
+// Appends a storage write op for each row of table_snapshot, resolved as
+// table, to ops.
+absl::Status AddSnapshotRows(const SnapshotTable& table,
+                             const TableSnapshot& table_snapshot,
+                             std::vector<StorageWriteOp>* ops) {
+  const int num_columns = table.column_ids.size();
+  for (const TableSnapshot::Row& row : table_snapshot.rows()) {
+    if (row.values_size() != num_columns) {
+      return error::Internal(absl::StrCat("Snapshot row for ",
+                                          table_snapshot.name(), " has ",
+                                          row.values_size(), " values, expected ",
+                                          num_columns));
+    }
+    StorageWriteOp& op = ops->emplace_back();
+    op.table_id = table.table_id;
+    op.column_ids = table.column_ids;
+    op.values.reserve(num_columns);
+    for (int i = 0; i < num_columns; ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          zetasql::Value value,
+          zetasql::Value::Deserialize(row.values(i), table.column_types[i]));
+      op.values.push_back(std::move(value));
+    }
+    for (int i = 0; i < table.key_positions.size(); ++i) {
+      op.key.AddColumn(op.values[table.key_positions[i]],
+                       table.key_descending[i]);
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Appends the storage write ops of a commit record written by
+// FlushWriteOpsToStorage to ops.
+absl::Status AddLoggedWrites(const Schema* schema, const CommitRecord& commit,
+                             std::vector<StorageWriteOp>* ops) {
+  for (const CommitRecord::Write& write : commit.writes()) {
+    const Table* table = nullptr;
+    if (write.table_kind() == CommitRecord::Write::INDEX) {
+      const Index* index = schema->FindIndex(write.table());
+      if (index != nullptr) {
+        table = index->index_data_table();
+      }
+    } else if (write.table_kind() == CommitRecord::Write::CHANGE_STREAM) {
+      const ChangeStream* change_stream =
+          schema->FindChangeStream(write.table());
+      if (change_stream != nullptr) {
+        table = change_stream->change_stream_data_table();
+      }
+    } else {
+      table = schema->FindTable(write.table());
+    }
+    if (table == nullptr) {
+      return error::Internal(absl::StrCat(
+          "Write ahead log contains a write to unknown table ", write.table()));
+    }
+    if (write.key_size() != table->primary_key().size() ||
+        write.values_size() != write.columns_size()) {
+      return error::Internal(absl::StrCat(
+          "Write ahead log contains a malformed write to ", write.table()));
+    }
+
+    StorageWriteOp& op = ops->emplace_back();
+    op.table_id = table->id();
+    op.is_delete = write.is_delete();
+    for (int i = 0; i < write.key_size(); ++i) {
+      const KeyColumn* key_column = table->primary_key()[i];
+      ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value,
+                       zetasql::Value::Deserialize(
+                           write.key(i), key_column->column()->GetType()));
+      op.key.AddColumn(std::move(value), key_column->is_descending());
+    }
+    op.column_ids.reserve(write.columns_size());
+    op.values.reserve(write.columns_size());
+    for (int i = 0; i < write.columns_size(); ++i) {
+      const Column* column = table->FindColumn(write.columns(i));
+      if (column == nullptr) {
+        return error::Internal(
+            absl::StrCat("Write ahead log contains a write to unknown column ",
+                         write.columns(i), " of ", write.table()));
+      }
+      ZETASQL_ASSIGN_OR_RETURN(
+          zetasql::Value value,
+          zetasql::Value::Deserialize(write.values(i), column->GetType()));
+      op.column_ids.push_back(column->id());
+      op.values.push_back(std::move(value));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Appends a storage write op for each row of table_snapshot, which holds rows
+// to be bulk loaded into table, to ops.
+absl::Status AddBulkLoadRows(const Table* table,
+                             const TableSnapshot& table_snapshot,
+                             std::vector<StorageWriteOp>* ops) {
+  std::vector<const Column*> columns;
+  for (const std::string& column_name : table_snapshot.columns()) {
+    const Column* column = table->FindColumn(column_name);
+    if (column == nullptr) {
+      return error::ColumnNotFound(table->Name(), column_name);
+    }
+    columns.push_back(column);
+  }
+  std::vector<int> key_positions;
+  for (const KeyColumn* key_column : table->primary_key()) {
+    auto itr = std::find(columns.begin(), columns.end(), key_column->column());
+    if (itr == columns.end()) {
+      return error::BulkLoadMissingKeyColumn(table->Name(),
+                                             key_column->column()->Name());
+    }
+    key_positions.push_back(itr - columns.begin());
+  }
+
+  ops->reserve(ops->size() + table_snapshot.rows_size());
+  for (const TableSnapshot::Row& row : table_snapshot.rows()) {
+    if (row.values_size() != columns.size()) {
+      return error::BulkLoadRowSizeMismatch(table->Name(), row.values_size(),
+                                            columns.size());
+    }
+    StorageWriteOp& op = ops->emplace_back();
+    op.table_id = table->id();
+    op.column_ids.reserve(columns.size());
+    op.values.reserve(columns.size());
+    for (int i = 0; i < columns.size(); ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          zetasql::Value value,
+          zetasql::Value::Deserialize(row.values(i), columns[i]->GetType()));
+      op.column_ids.push_back(columns[i]->id());
+      op.values.push_back(std::move(value));
+    }
+    for (int i = 0; i < key_positions.size(); ++i) {
+      op.key.AddColumn(op.values[key_positions[i]],
+                       table->primary_key()[i]->is_descending());
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Returns an error if any row of table does not have a parent row.
+absl::Status VerifyParentRowsExist(const Table* table,
+                                   const SchemaValidationContext* context) {
+  const Table* parent = table->parent();
+  if (parent == nullptr) {
+    return absl::OkStatus();
+  }
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_RETURN_IF_ERROR(context->storage()->Read(context->pending_commit_timestamp(),
+                                           table->id(), KeyRange::All(),
+                                           /*column_ids=*/{}, &itr));
+  // Rows are read in key order, so siblings share the lookup of their parent.
+  std::optional<Key> verified_parent_key;
+  while (itr->Next()) {
+    Key parent_key = itr->Key().Prefix(parent->primary_key().size());
+    if (verified_parent_key.has_value() && parent_key == *verified_parent_key) {
+      continue;
+    }
+    absl::Status status = context->storage()->Lookup(
+        context->pending_commit_timestamp(), parent->id(), parent_key,
+        /*column_ids=*/{}, /*values=*/nullptr);
+    if (absl::IsNotFound(status)) {
+      return error::ParentKeyNotFound(parent->Name(), table->Name(),
+                                      itr->Key().DebugString());
+    }
+    ZETASQL_RETURN_IF_ERROR(status);
+    verified_parent_key = std::move(parent_key);
+  }
+  return itr->Status();
+}
+
+// Builds the indexes of the bulk loaded tables, and verifies their rows
+// against the constraints of the schema.
+absl::Status BackfillAndVerifyBulkLoad(
+    absl::Span<const Table* const> tables,
+    const SchemaValidationContext* context) {
+  // Indexes are built first, since foreign keys are verified using their
+  // backing indexes.
+  for (const Table* table : tables) {
+    for (const Index* index : table->indexes()) {
+      ZETASQL_RETURN_IF_ERROR(BackfillIndex(index, context));
+    }
+  }
+  for (const Table* table : tables) {
+    ZETASQL_RETURN_IF_ERROR(VerifyParentRowsExist(table, context));
+    for (const Column* column : table->columns()) {
+      if (!column->is_nullable()) {
+        ZETASQL_RETURN_IF_ERROR(VerifyColumnNotNull(table, column, context));
+      }
+      if (column->effective_max_length() > 0) {
+        ZETASQL_RETURN_IF_ERROR(VerifyColumnLength(
+            table, column, column->effective_max_length(), context));
+      }
+      if (column->allows_commit_timestamp()) {
+        ZETASQL_RETURN_IF_ERROR(VerifyColumnCommitTimestamp(table, column, context));
+      }
+    }
+    for (const CheckConstraint* check_constraint :
+         table->check_constraints()) {
+      ZETASQL_RETURN_IF_ERROR(VerifyCheckConstraintData(check_constraint, context));
+    }
+    for (const ForeignKey* foreign_key : table->foreign_keys()) {
+      ZETASQL_RETURN_IF_ERROR(VerifyForeignKeyData(foreign_key, context));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Registers table and its ancestors with storage, outermost first.
+void RegisterInterleavedTable(const Table* table, Storage* storage) {
+  const Table* parent = table->parent();
+  if (parent == nullptr) {
+    return;
+  }
+  RegisterInterleavedTable(parent, storage);
+  storage->RegisterInterleavedTable(parent->id(), parent->primary_key().size(),
+                                    table->id(), table->primary_key().size());
+}
+
+// Lets storage cluster the interleaved tables and indexes of schema. Newly
+// created tables are empty, so registering them after the schema change which
+// created them is early enough, except for the data tables of interleaved
+// indexes which are backfilled by the schema change. Storage keeps those in
+// separate keyspaces.
+void RegisterInterleavedTables(const Schema* schema, Storage* storage) {
+  if (!config::cluster_interleaved_tables()) {
+    return;
+  }
+  for (const Table* table : schema->tables()) {
+    RegisterInterleavedTable(table, storage);
+    for (const Index* index : table->indexes()) {
+      RegisterInterleavedTable(index->index_data_table(), storage);
+    }
+  }
+}
+
+// Partitioned DML statements are retried this many times in a key range which
+// aborts, backing off between attempts, before the statement fails.
+constexpr int kMaxPartitionedDmlAttempts = 10;
+constexpr absl::Duration kPartitionedDmlInitialBackoff = absl::Milliseconds(10);
+
+// Returns the keys and ranges of key_set which are within range, which must be
+// a ClosedOpen range.
+KeySet IntersectKeySet(const KeySet& key_set, const KeyRange& range) {
+  KeySet result;
+  for (const Key& key : key_set.keys()) {
+    if (range.Contains(key)) {
+      result.AddKey(key);
+    }
+  }
+  for (const KeyRange& key_range : key_set.ranges()) {
+    const KeyRange closed_open = key_range.ToClosedOpen();
+    const Key& start = std::max(closed_open.start_key(), range.start_key());
+    const Key& limit = std::min(closed_open.limit_key(), range.limit_key());
+    if (start < limit) {
+      result.AddRange(KeyRange::ClosedOpen(start, limit));
+    }
+  }
+  return result;
+}
+
+// A RowCursor which skips the rows of another cursor whose primary key in
+// table is not within a key range. The wrapped cursor may have more columns
+// than are exposed, to read the key columns.
+class KeyRangeFilteringRowCursor : public RowCursor {
+ public:
+  KeyRangeFilteringRowCursor(std::unique_ptr<RowCursor> cursor,
+                             int num_columns, std::vector<int> key_positions,
+                             const Table* table, const KeyRange& range)
+      : cursor_(std::move(cursor)),
+        num_columns_(num_columns),
+        key_positions_(std::move(key_positions)),
+        table_(table),
+        range_(range) {}
+
+  bool Next() override {
+    while (cursor_->Next()) {
+      Key key;
+      for (int i = 0; i < key_positions_.size(); ++i) {
+        key.AddColumn(cursor_->ColumnValue(key_positions_[i]),
+                      table_->primary_key()[i]->is_descending());
+      }
+      if (range_.Contains(key)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  absl::Status Status() const override { return cursor_->Status(); }
+  int NumColumns() const override { return num_columns_; }
+  const std::string ColumnName(int i) const override {
+    return cursor_->ColumnName(i);
+  }
+  const zetasql::Value ColumnValue(int i) const override {
+    return cursor_->ColumnValue(i);
+  }
+  const zetasql::Type* ColumnType(int i) const override {
+    return cursor_->ColumnType(i);
+  }
+
+ private:
+  std::unique_ptr<RowCursor> cursor_;
+  const int num_columns_;
+  const std::vector<int> key_positions_;
+  const Table* table_;
+  const KeyRange range_;
+};
+
+// A RowReader which restricts the reads of table, through the table itself or
+// any of its indexes, to the rows whose primary key is within a ClosedOpen key
+// range. Reads of other tables are passed through unchanged.
+class KeyRangeRowReader : public RowReader {
+ public:
+  KeyRangeRowReader(RowReader* reader, const Table* table,
+                    const KeyRange& range)
+      : reader_(reader), table_(table), range_(range) {}
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    if (read_arg.table != table_->Name()) {
+      return reader_->Read(read_arg, cursor);
+    }
+    if (read_arg.index.empty()) {
+      ReadArg range_read_arg = read_arg;
+      range_read_arg.key_set = IntersectKeySet(read_arg.key_set, range_);
+      return reader_->Read(range_read_arg, cursor);
+    }
+
+    // Index rows are not ordered by the primary key of the table, so they are
+    // filtered by it instead, reading the key columns if they were not asked
+    // for.
+    ReadArg index_read_arg = read_arg;
+    std::vector<int> key_positions;
+    for (const KeyColumn* key_column : table_->primary_key()) {
+      const std::string& name = key_column->column()->Name();
+      auto itr = std::find_if(
+          read_arg.columns.begin(), read_arg.columns.end(),
+          [&name](const std::string& column) {
+            return absl::EqualsIgnoreCase(column, name);
+          });
+      if (itr != read_arg.columns.end()) {
+        key_positions.push_back(itr - read_arg.columns.begin());
+      } else {
+        key_positions.push_back(index_read_arg.columns.size());
+        index_read_arg.columns.push_back(name);
+      }
+    }
+    std::unique_ptr<RowCursor> index_cursor;
+    ZETASQL_RETURN_IF_ERROR(reader_->Read(index_read_arg, &index_cursor));
+    *cursor = std::make_unique<KeyRangeFilteringRowCursor>(
+        std::move(index_cursor), read_arg.columns.size(),
+        std::move(key_positions), table_, range_);
+    return absl::OkStatus();
+  }
+
+ private:
+  RowReader* reader_;
+  const Table* table_;
+  const KeyRange range_;
+};
+
+// The number of rows of the indexed table backfilled into a write-only index
+// each time an online index backfill locks the database.
+constexpr int64_t kOnlineIndexBackfillChunkRows = 1000;
+
+// How long an online index backfill waits before locking the database again
+// when transactions are in progress.
+constexpr absl::Duration kOnlineIndexBackfillRetryDelay =
+    absl::Milliseconds(10);
+
+}  // namespace
+
 // TransactionIDGenerator is initialized to 1 because 0 is used as a sentinel
 // value for an invalid transaction.
 Database::Database() : transaction_id_generator_(1) {}
 
+Database::Database(int64_t next_table_seq, int64_t next_column_seq,
+                   int64_t next_change_stream_seq)
+    : transaction_id_generator_(1),
+      table_id_generator_(next_table_seq),
+      change_stream_id_generator_(next_change_stream_seq),
+      column_id_generator_(next_column_seq) {}
+
 absl::StatusOr<std::unique_ptr<Database>> Database::Create(
-    Clock* clock, const SchemaChangeOperation& schema_change_operation) {
+    Clock* clock, const SchemaChangeOperation& schema_change_operation,
+    const StorageOptions& storage_options) {
   auto database = absl::WrapUnique(new Database());
   database->clock_ = clock;
-  database->storage_ = std::make_unique<InMemoryStorage>();
-  database->lock_manager_ = std::make_unique<LockManager>(clock);
-  database->type_factory_ = std::make_unique<zetasql::TypeFactory>();
-  database->query_engine_ =
-      std::make_unique<QueryEngine>(database->type_factory_.get());
-  database->action_manager_ = std::make_unique<ActionManager>();
+  ZETASQL_ASSIGN_OR_RETURN(database->storage_, CreateStorage(storage_options));
+  database->type_factory_ = std::make_shared<zetasql::TypeFactory>();
 
   if (schema_change_operation.statements.empty()) {
       database->versioned_catalog_ = std::make_unique<VersionedCatalog>();
@@ -71,36 +768,838 @@ absl::StatusOr<std::unique_ptr<Database>> Database::Create(
         std::make_unique<VersionedCatalog>(std::move(schema));
   }
 
-  database->action_manager_->AddActionsForSchema(
-      database->versioned_catalog_->GetLatestSchema(),
-      database->query_engine_->function_catalog(),
-      database->query_engine_->type_factory());
+  ZETASQL_RETURN_IF_ERROR(database->WrapStorage(storage_options));
+  database->InitializeFromSchema();
+  ZETASQL_RETURN_IF_ERROR(database->AnalyzeTables(clock->Now()));
+  return database;
+}
+
+absl::StatusOr<std::shared_ptr<const Database::SchemaTemplate>>
+Database::CreateSchemaTemplate(
+    const SchemaChangeOperation& schema_change_operation) {
+  ZETASQL_RET_CHECK(!schema_change_operation.statements.empty());
+  auto type_factory = std::make_shared<zetasql::TypeFactory>();
+  TableIDGenerator table_id_generator;
+  ColumnIDGenerator column_id_generator;
+  // Backfills of the new schema have no rows to read or write, except for
+  // change stream partitions, which make the schema unshareable.
+  InMemoryStorage storage;
+  SchemaUpdater updater;
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<const Schema> schema,
+                   updater.CreateSchemaFromDDL(
+                       schema_change_operation,
+                       SchemaChangeContext{
+                           .type_factory = type_factory.get(),
+                           .table_id_generator = &table_id_generator,
+                           .column_id_generator = &column_id_generator,
+                           .storage = &storage,
+                       }));
+  if (!schema->change_streams().empty()) {
+    return nullptr;
+  }
+  return std::make_shared<const SchemaTemplate>(SchemaTemplate{
+      .schema = std::move(schema),
+      .type_factory = std::move(type_factory),
+      .next_table_seq = table_id_generator.next_seq(),
+      .next_column_seq = column_id_generator.next_seq(),
+  });
+}
+
+absl::StatusOr<std::unique_ptr<Database>> Database::CreateFromTemplate(
+    Clock* clock, std::shared_ptr<const SchemaTemplate> schema_template,
+    const StorageOptions& storage_options) {
+  auto database = absl::WrapUnique(
+      new Database(schema_template->next_table_seq,
+                   schema_template->next_column_seq,
+                   /*next_change_stream_seq=*/0));
+  database->clock_ = clock;
+  ZETASQL_ASSIGN_OR_RETURN(database->storage_, CreateStorage(storage_options));
+  database->type_factory_ = schema_template->type_factory;
+  database->versioned_catalog_ =
+      std::make_unique<VersionedCatalog>(schema_template->schema);
+  ZETASQL_RETURN_IF_ERROR(database->WrapStorage(storage_options));
+  database->InitializeFromSchema();
+  ZETASQL_RETURN_IF_ERROR(database->AnalyzeTables(clock->Now()));
+  return database;
+}
+
+absl::StatusOr<std::unique_ptr<Storage>> Database::CreateStorage(
+    const StorageOptions& storage_options) {
+  if (!storage_options.disk_storage_dir.empty()) {
+    return DiskStorage::Create(DiskStorage::Options{
+        .directory = storage_options.disk_storage_dir,
+        .cache_size_bytes = storage_options.disk_storage_cache_bytes});
+  }
+  if (config::use_compact_storage()) {
+    return std::make_unique<CompactInMemoryStorage>();
+  }
+  return std::make_unique<InMemoryStorage>(
+      config::intern_string_values() ? std::make_shared<ValueInterner>()
+                                     : nullptr,
+      config::database_memory_quota_bytes(),
+      config::key_access_sampling_interval());
+}
+
+absl::Status Database::WrapStorage(const StorageOptions& storage_options) {
+  if (!storage_options.fixture_path.empty()) {
+    ZETASQL_RETURN_IF_ERROR(OpenFixture(storage_options.fixture_path));
+  }
+  if (storage_options.hydrate_snapshots_lazily) {
+    auto hydrating_storage =
+        std::make_unique<HydratingStorage>(std::move(storage_));
+    hydrating_storage_ = hydrating_storage.get();
+    snapshot_hydration_threads_ = storage_options.snapshot_hydration_threads;
+    storage_ = std::move(hydrating_storage);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Database::OpenFixture(const std::string& path) {
+  const Schema* schema = versioned_catalog_->GetLatestSchema();
+  auto bind_table = [schema](const FixtureHeader::Table& fixture_table)
+      -> absl::StatusOr<FixtureStorage::TableBinding> {
+    const Table* table = nullptr;
+    if (fixture_table.is_index()) {
+      const Index* index = schema->FindIndex(fixture_table.name());
+      if (index != nullptr) {
+        table = index->index_data_table();
+      }
+    } else {
+      table = schema->FindTable(fixture_table.name());
+    }
+    if (table == nullptr) {
+      return error::Internal(
+          absl::StrCat("Fixture contains rows for unknown ",
+                       fixture_table.is_index() ? "index " : "table ",
+                       fixture_table.name()));
+    }
+    FixtureStorage::TableBinding binding{.table_id = table->id()};
+    for (const std::string& column_name : fixture_table.columns()) {
+      const Column* column = table->FindColumn(column_name);
+      if (column == nullptr) {
+        return error::Internal(absl::StrCat("Fixture contains unknown column ",
+                                            column_name, " for ",
+                                            fixture_table.name()));
+      }
+      binding.column_ids.push_back(column->id());
+      binding.column_types.push_back(column->GetType());
+    }
+    return binding;
+  };
+  ZETASQL_ASSIGN_OR_RETURN(storage_,
+                   FixtureStorage::Open(path, bind_table, std::move(storage_)));
+  return absl::OkStatus();
+}
 
-  database->change_stream_partition_churner_ =
-      std::make_unique<ChangeStreamPartitionChurner>(
-          absl::bind_front(&Database::CreateReadWriteTransaction,
-                           database.get()),
-          database->clock_);
+absl::StatusOr<std::unique_ptr<Database>> Database::Clone() {
+  // Block transactions and schema changes so that the clone sees a consistent
+  // set of tables and schemas.
+  ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                              lock_manager_.get()};
+  ZETASQL_RETURN_IF_ERROR(lock.Wait());
 
-  database->change_stream_partition_churner_->Update(
-      database->versioned_catalog_->GetLatestSchema());
+  // The backfills of online index creations are not carried over to clones.
+  for (const Table* table : versioned_catalog_->GetLatestSchema()->tables()) {
+    for (const Index* index : table->indexes()) {
+      if (index->is_write_only()) {
+        return error::IndexBackfillInProgress(index->Name());
+      }
+    }
+  }
 
+  auto clone = absl::WrapUnique(new Database(
+      table_id_generator_.next_seq(), column_id_generator_.next_seq(),
+      change_stream_id_generator_.next_seq()));
+  clone->clock_ = clock_;
+  ZETASQL_ASSIGN_OR_RETURN(clone->storage_, storage_->Clone());
+  clone->type_factory_ = type_factory_;
+  clone->versioned_catalog_ = versioned_catalog_->Clone();
+  {
+    absl::MutexLock dropped_lock(&dropped_tables_mu_);
+    clone->dropped_tables_ = dropped_tables_;
+  }
+  clone->statistics_.CopyFrom(statistics_);
+  clone->InitializeFromSchema();
+  return clone;
+}
+
+void Database::InitializeFromSchema() {
+  RegisterInterleavedTables(versioned_catalog_->GetLatestSchema(),
+                            storage_.get());
+  LockManager::LockGranularity granularity =
+      LockManager::LockGranularity::kDatabase;
+  if (config::enable_optimistic_concurrency()) {
+    granularity = LockManager::LockGranularity::kOptimistic;
+  } else if (config::enable_row_level_locking()) {
+    granularity = LockManager::LockGranularity::kRow;
+  }
+  lock_manager_ = std::make_unique<LockManager>(clock_, granularity);
+  // The rows already in storage were written at or before now, by commits or
+  // by restores of rows whose commit timestamps are no later than now.
+  commit_timestamp_index_ =
+      std::make_unique<CommitTimestampIndex>(clock_->Now());
+  query_engine_ = std::make_unique<QueryEngine>(
+      type_factory_.get(), storage_.get(), lock_manager_->lock_stats(),
+      &txn_stats_, &read_stats_, &statistics_, commit_timestamp_index_.get());
+  action_manager_ = std::make_unique<ActionManager>();
+  action_manager_->AddActionsForSchema(versioned_catalog_->GetLatestSchema(),
+                                       query_engine_->function_catalog(),
+                                       query_engine_->type_factory());
+
+  // The partitions of the change streams of a follower's copy of a database
+  // are churned by the emulator it follows, whose commits carry them over.
+  if (config::follow_write_ahead_log_dir().empty()) {
+    change_stream_partition_churner_ =
+        std::make_unique<ChangeStreamPartitionChurner>(
+            absl::bind_front(&Database::CreateReadWriteTransaction, this),
+            clock_, &change_stream_partition_cache_);
+    change_stream_partition_churner_->Update(
+        versioned_catalog_->GetLatestSchema());
+  }
+
+  const absl::Duration gc_interval = config::version_gc_interval();
+  if (gc_interval > absl::ZeroDuration()) {
+    gc_task_ = VersionGcScheduler()->AddTask(
+        [this, gc_interval] {
+          CollectGarbage();
+          return gc_interval;
+        },
+        gc_interval);
+  }
+
+  // Checking twice per timeout bounds how long an idle transaction can hold
+  // its locks to one and a half times the timeout.
+  const absl::Duration idle_timeout = config::idle_transaction_timeout();
+  if (idle_timeout > absl::ZeroDuration()) {
+    idle_transaction_reaper_task_ = IdleTransactionReaperScheduler()->AddTask(
+        [this, idle_timeout] {
+          AbortIdleTransactions(idle_timeout);
+          return idle_timeout / 2;
+        },
+        idle_timeout / 2);
+  }
+}
+
+absl::StatusOr<std::unique_ptr<Database>> Database::CreateFromSnapshot(
+    Clock* clock, const DatabaseSnapshot& snapshot,
+    const StorageOptions& storage_options) {
+  std::vector<std::string> statements(snapshot.ddl_statements().begin(),
+                                      snapshot.ddl_statements().end());
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<Database> database,
+      Create(clock, SchemaChangeOperation{.statements = statements},
+             storage_options));
+  ZETASQL_RETURN_IF_ERROR(database->RestoreRows(snapshot));
   return database;
 }
+
+Database::~Database() {
+  {
+    absl::MutexLock lock(&index_backfill_mu_);
+    stop_index_backfills_ = true;
+  }
+  if (index_backfill_thread_.joinable()) {
+    index_backfill_thread_.join();
+  }
+  // Blocks until a run in progress has finished.
+  if (gc_task_.has_value()) {
+    VersionGcScheduler()->CancelTask(*gc_task_);
+  }
+  if (idle_transaction_reaper_task_.has_value()) {
+    IdleTransactionReaperScheduler()->CancelTask(
+        *idle_transaction_reaper_task_);
+  }
+}
+
+int64_t Database::AbortIdleTransactions(absl::Duration idle_timeout) {
+  const int64_t aborted = lock_manager_->AbortIdleTransactions(idle_timeout);
+  idle_transactions_aborted_.fetch_add(aborted, std::memory_order_relaxed);
+  return aborted;
+}
+
+absl::StatusOr<DatabaseSnapshot> Database::CreateSnapshot() {
+  // A strong read waits for in-flight commits, so the snapshot includes every
+  // transaction committed before this call.
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ReadOnlyTransaction> txn,
+                   CreateReadOnlyTransaction(ReadOnlyOptions()));
+  const Schema* schema = txn->schema();
+
+  DatabaseSnapshot snapshot;
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<std::string> statements,
+                   ddl_statement_cache_.PrintDDLStatements(schema));
+  for (std::string& statement : statements) {
+    snapshot.add_ddl_statements(std::move(statement));
+  }
+  for (const Table* table : schema->tables()) {
+    ZETASQL_RETURN_IF_ERROR(
+        SnapshotRows(txn.get(), table, /*index=*/nullptr, snapshot.add_tables()));
+    for (const Index* index : table->indexes()) {
+      ZETASQL_RETURN_IF_ERROR(
+          SnapshotRows(txn.get(), table, index, snapshot.add_tables()));
+    }
+  }
+  return snapshot;
+}
+
+absl::Status Database::WriteFixture(const std::string& path) {
+  // As for CreateSnapshot, a strong read waits for in-flight commits.
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ReadOnlyTransaction> txn,
+                   CreateReadOnlyTransaction(ReadOnlyOptions()));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<FixtureWriter> writer,
+                   FixtureWriter::Create(path));
+  for (const Table* table : txn->schema()->tables()) {
+    ZETASQL_RETURN_IF_ERROR(WriteFixtureRows(*storage_, txn->read_timestamp(),
+                                     table->Name(), /*is_index=*/false, table,
+                                     writer.get()));
+    for (const Index* index : table->indexes()) {
+      ZETASQL_RETURN_IF_ERROR(WriteFixtureRows(
+          *storage_, txn->read_timestamp(), index->Name(), /*is_index=*/true,
+          index->index_data_table(), writer.get()));
+    }
+  }
+  return writer->Finish();
+}
+
+absl::Status Database::ExportTables(const TableExporter& export_table) {
+  // As for CreateSnapshot, a strong read waits for in-flight commits.
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ReadOnlyTransaction> txn,
+                   CreateReadOnlyTransaction(ReadOnlyOptions()));
+  const absl::Span<const Table* const> tables = txn->schema()->tables();
+  std::vector<absl::Status> statuses(tables.size());
+  std::atomic<int> next_table = 0;
+  auto export_tables = [&]() {
+    for (int i = next_table++; i < tables.size(); i = next_table++) {
+      std::vector<ColumnID> column_ids;
+      for (const Column* column : tables[i]->columns()) {
+        column_ids.push_back(column->id());
+      }
+      std::unique_ptr<StorageIterator> itr;
+      statuses[i] = storage_->Read(txn->read_timestamp(), tables[i]->id(),
+                                   KeyRange::All(), column_ids, &itr);
+      if (statuses[i].ok()) {
+        statuses[i] = export_table(tables[i], itr.get());
+      }
+      if (statuses[i].ok()) {
+        statuses[i] = itr->Status();
+      }
+    }
+  };
+  const int num_workers =
+      std::min<int>(tables.size(), DefaultScanParallelism());
+  std::vector<std::thread> workers;
+  for (int i = 1; i < num_workers; ++i) {
+    workers.emplace_back(export_tables);
+  }
+  export_tables();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  for (const absl::Status& status : statuses) {
+    ZETASQL_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Database::RestoreRows(const DatabaseSnapshot& snapshot) {
+  const Schema* schema = versioned_catalog_->GetLatestSchema();
+  if (hydrating_storage_ != nullptr) {
+    return RestoreRowsLazily(schema, snapshot);
+  }
+  std::vector<StorageWriteOp> ops;
+  for (const TableSnapshot& table_snapshot : snapshot.tables()) {
+    ZETASQL_ASSIGN_OR_RETURN(SnapshotTable table,
+                     ResolveSnapshotTable(schema, table_snapshot));
+    ZETASQL_RETURN_IF_ERROR(AddSnapshotRows(table, table_snapshot, &ops));
+  }
+
+  // Rows are written like a schema change, at a timestamp reserved while
+  // holding the database-wide lock.
+  ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                              lock_manager_.get()};
+  ZETASQL_RETURN_IF_ERROR(lock.Wait());
+  ZETASQL_ASSIGN_OR_RETURN(absl::Time timestamp, lock.ReserveCommitTimestamp());
+  for (const StorageWriteOp& op : ops) {
+    commit_timestamp_index_->Erase(op.table_id, timestamp);
+  }
+  ZETASQL_RETURN_IF_ERROR(storage_->ApplyBatch(timestamp, absl::MakeSpan(ops)));
+  return AnalyzeTables(timestamp);
+}
+
+absl::Status Database::RestoreRowsLazily(const Schema* schema,
+                                         const DatabaseSnapshot& snapshot) {
+  // The snapshot tables are resolved now, so that a snapshot which does not
+  // match the schema is still rejected here, and copied for the loaders, which
+  // run after the caller's snapshot may be gone. Decoding their rows, which is
+  // most of the cost of a restore, is left to the loaders.
+  using SnapshotRows = std::vector<std::pair<SnapshotTable, TableSnapshot>>;
+  std::vector<std::pair<TableID, std::shared_ptr<SnapshotRows>>> tables;
+  absl::flat_hash_map<TableID, SnapshotRows*> rows_by_table;
+  for (const TableSnapshot& table_snapshot : snapshot.tables()) {
+    ZETASQL_ASSIGN_OR_RETURN(SnapshotTable table,
+                     ResolveSnapshotTable(schema, table_snapshot));
+    SnapshotRows*& rows = rows_by_table[table.table_id];
+    if (rows == nullptr) {
+      tables.emplace_back(table.table_id, std::make_shared<SnapshotRows>());
+      rows = tables.back().second.get();
+    }
+    rows->emplace_back(std::move(table), table_snapshot);
+  }
+
+  ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                              lock_manager_.get()};
+  ZETASQL_RETURN_IF_ERROR(lock.Wait());
+  ZETASQL_ASSIGN_OR_RETURN(absl::Time timestamp, lock.ReserveCommitTimestamp());
+  for (auto& [table_id, rows] : tables) {
+    commit_timestamp_index_->Erase(table_id, timestamp);
+    // The loader holds on to the type factory, which owns the column types,
+    // since the storage outlives the database's reference to it.
+    hydrating_storage_->AddTable(
+        timestamp, table_id,
+        [rows = std::move(rows), type_factory = type_factory_]()
+            -> absl::StatusOr<std::vector<StorageWriteOp>> {
+          std::vector<StorageWriteOp> ops;
+          for (const auto& [table, table_snapshot] : *rows) {
+            ZETASQL_RETURN_IF_ERROR(
+                AddSnapshotRows(table, table_snapshot, &ops));
+          }
+          return ops;
+        });
+  }
+  hydrating_storage_->HydrateInBackground(snapshot_hydration_threads_);
+
+  // Analyzing the tables would hydrate all of them, so their statistics are
+  // left to be computed by the next ANALYZE.
+  return absl::OkStatus();
+}
+
+absl::Status Database::BulkLoad(absl::Span<const TableSnapshot> tables) {
+  ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                              lock_manager_.get()};
+  ZETASQL_RETURN_IF_ERROR(lock.Wait());
+  ZETASQL_ASSIGN_OR_RETURN(absl::Time timestamp, lock.ReserveCommitTimestamp());
+
+  const Schema* schema = versioned_catalog_->GetLatestSchema();
+  std::vector<const Table*> loaded_tables;
+  std::vector<StorageWriteOp> ops;
+  for (const TableSnapshot& table_snapshot : tables) {
+    if (table_snapshot.is_index()) {
+      return error::BulkLoadIntoIndex(table_snapshot.name());
+    }
+    const Table* table = schema->FindTable(table_snapshot.name());
+    if (table == nullptr) {
+      return error::TableNotFound(table_snapshot.name());
+    }
+    if (std::find(loaded_tables.begin(), loaded_tables.end(), table) ==
+        loaded_tables.end()) {
+      std::unique_ptr<StorageIterator> itr;
+      ZETASQL_RETURN_IF_ERROR(storage_->Read(timestamp, table->id(), KeyRange::All(),
+                                     /*column_ids=*/{}, &itr));
+      if (itr->Next()) {
+        return error::BulkLoadTableNotEmpty(table->Name());
+      }
+      loaded_tables.push_back(table);
+    }
+    ZETASQL_RETURN_IF_ERROR(AddBulkLoadRows(table, table_snapshot, &ops));
+  }
+
+  // Rows are written in key order, which also finds duplicate keys without a
+  // lookup per row.
+  std::stable_sort(ops.begin(), ops.end(),
+                   [](const StorageWriteOp& a, const StorageWriteOp& b) {
+                     return a.table_id != b.table_id ? a.table_id < b.table_id
+                                                     : a.key < b.key;
+                   });
+  for (int i = 1; i < ops.size(); ++i) {
+    if (ops[i].table_id == ops[i - 1].table_id &&
+        ops[i].key == ops[i - 1].key) {
+      auto table_itr = std::find_if(
+          loaded_tables.begin(), loaded_tables.end(),
+          [&](const Table* table) { return table->id() == ops[i].table_id; });
+      return error::RowAlreadyExists((*table_itr)->Name(),
+                                     ops[i].key.DebugString());
+    }
+  }
+  for (const Table* table : loaded_tables) {
+    commit_timestamp_index_->Erase(table->id(), timestamp);
+  }
+  ZETASQL_RETURN_IF_ERROR(storage_->ApplyBatch(timestamp, absl::MakeSpan(ops)));
+
+  SchemaValidationContext context(storage_.get(), /*global_names=*/nullptr,
+                                  type_factory_.get(), timestamp);
+  context.SetValidatedNewSchemaSnapshot(schema);
+  absl::Status status = BackfillAndVerifyBulkLoad(loaded_tables, &context);
+  if (!status.ok()) {
+    // Deletes at the timestamp of the load replace the loaded versions, so
+    // neither the rows nor their index entries are ever visible.
+    for (const Table* table : loaded_tables) {
+      ZETASQL_RETURN_IF_ERROR(
+          storage_->Delete(timestamp, table->id(), KeyRange::All()));
+      for (const Index* index : table->indexes()) {
+        ZETASQL_RETURN_IF_ERROR(storage_->Delete(
+            timestamp, index->index_data_table()->id(), KeyRange::All()));
+      }
+    }
+    return status;
+  }
+  for (const Table* table : loaded_tables) {
+    ZETASQL_RETURN_IF_ERROR(AnalyzeTable(table, timestamp));
+  }
+
+  if (write_ahead_log_ != nullptr) {
+    WriteAheadLogRecord record;
+    for (const TableSnapshot& table_snapshot : tables) {
+      *record.mutable_bulk_load()->add_tables() = table_snapshot;
+    }
+    ZETASQL_RETURN_IF_ERROR(write_ahead_log_->Append(record));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Database::ResetData() {
+  ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                              lock_manager_.get()};
+  ZETASQL_RETURN_IF_ERROR(lock.Wait());
+  ZETASQL_ASSIGN_OR_RETURN(absl::Time timestamp, lock.ReserveCommitTimestamp());
+
+  std::vector<TableID> table_ids;
+  for (const Table* table : versioned_catalog_->GetLatestSchema()->tables()) {
+    table_ids.push_back(table->id());
+    for (const Index* index : table->indexes()) {
+      table_ids.push_back(index->index_data_table()->id());
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(storage_->Truncate(timestamp, table_ids));
+  ZETASQL_RETURN_IF_ERROR(AnalyzeTables(timestamp));
+
+  if (write_ahead_log_ != nullptr) {
+    WriteAheadLogRecord record;
+    record.mutable_reset_data();
+    ZETASQL_RETURN_IF_ERROR(write_ahead_log_->Append(record));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Database::StartWriteAheadLog(std::unique_ptr<WriteAheadLog> log) {
+  if (log->empty()) {
+    WriteAheadLogRecord record;
+    ZETASQL_ASSIGN_OR_RETURN(*record.mutable_snapshot(), CreateSnapshot());
+    ZETASQL_RETURN_IF_ERROR(log->Append(record));
+  }
+  write_ahead_log_ = std::move(log);
+  // Pooled transactions would keep appending to no log.
+  absl::MutexLock lock(&transaction_pool_mu_);
+  transaction_pool_.clear();
+  return absl::OkStatus();
+}
+
+absl::Status Database::ResetWriteAheadLog(const DatabaseSnapshot& snapshot) {
+  if (write_ahead_log_ == nullptr) {
+    return absl::OkStatus();
+  }
+  WriteAheadLogRecord record;
+  *record.mutable_snapshot() = snapshot;
+  return write_ahead_log_->Reset(record);
+}
+
+absl::Status Database::ReplayWriteAheadLogRecord(
+    const WriteAheadLogRecord& record) {
+  switch (record.record_case()) {
+    case WriteAheadLogRecord::kSchemaChange: {
+      std::vector<std::string> statements(
+          record.schema_change().statements().begin(),
+          record.schema_change().statements().end());
+      int num_successful_statements;
+      absl::Time commit_timestamp;
+      absl::Status backfill_status;
+      ZETASQL_RETURN_IF_ERROR(
+          UpdateSchema(SchemaChangeOperation{.statements = statements},
+                       &num_successful_statements, &commit_timestamp,
+                       &backfill_status));
+      return backfill_status;
+    }
+    case WriteAheadLogRecord::kCommit: {
+      std::vector<StorageWriteOp> ops;
+      ZETASQL_RETURN_IF_ERROR(
+          AddLoggedWrites(GetLatestSchema(), record.commit(), &ops));
+      ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                                  lock_manager_.get()};
+      ZETASQL_RETURN_IF_ERROR(lock.Wait());
+      ZETASQL_ASSIGN_OR_RETURN(absl::Time timestamp, lock.ReserveCommitTimestamp());
+      // Whether the logged writes were inserts is not recorded, so the
+      // statistics of the tables are dropped rather than updated. The logged
+      // writes carry the commit timestamps of the emulator which made them,
+      // so the commit timestamp index no longer covers their tables either.
+      for (const StorageWriteOp& op : ops) {
+        statistics_.Erase(op.table_id);
+        commit_timestamp_index_->Erase(op.table_id, timestamp);
+      }
+      return storage_->ApplyBatch(timestamp, absl::MakeSpan(ops));
+    }
+    case WriteAheadLogRecord::kBulkLoad: {
+      std::vector<TableSnapshot> tables(record.bulk_load().tables().begin(),
+                                        record.bulk_load().tables().end());
+      return BulkLoad(tables);
+    }
+    case WriteAheadLogRecord::kResetData:
+      return ResetData();
+    default:
+      return error::Internal(
+          "Write ahead log contains an unexpected snapshot record");
+  }
+}
+
+int64_t Database::CollectGarbage() {
+  absl::Duration retention = kMaxStaleReadDuration;
+  for (const ChangeStream* change_stream :
+       versioned_catalog_->GetLatestSchema()->change_streams()) {
+    retention = std::max(
+        retention, absl::Seconds(change_stream->parsed_retention_period()));
+  }
+  const absl::Time version_horizon =
+      clock_->Now() - retention - kVersionGcSafetyMargin;
+  int64_t reclaimed_bytes = storage_->CollectGarbage(version_horizon);
+  commit_timestamp_index_->CollectGarbage(version_horizon);
+  const absl::Duration cold_version_age = config::cold_version_age();
+  if (cold_version_age > absl::ZeroDuration()) {
+    reclaimed_bytes +=
+        storage_->CompressVersions(clock_->Now() - cold_version_age);
+  }
+  reclaimed_bytes += TruncateDroppedTables(version_horizon);
+  for (const std::shared_ptr<const Schema>& schema :
+       versioned_catalog_->CollectGarbage(version_horizon)) {
+    action_manager_->RemoveActionsForSchema(schema.get());
+    read_plan_cache_.EraseSchema(schema.get());
+    query_engine_->EraseSchema(schema.get());
+  }
+  reclaimed_version_bytes_.fetch_add(reclaimed_bytes,
+                                     std::memory_order_relaxed);
+  return reclaimed_bytes;
+}
+
+absl::Status Database::AnalyzeDataTable(const Table* data_table,
+                                        absl::Time timestamp) {
+  ZETASQL_ASSIGN_OR_RETURN(
+      TableStatistics statistics,
+      ComputeTableStatistics(storage_.get(), data_table, timestamp));
+  statistics_.Set(data_table->id(), std::move(statistics));
+  return absl::OkStatus();
+}
+
+absl::Status Database::AnalyzeTable(const Table* table, absl::Time timestamp) {
+  ZETASQL_RETURN_IF_ERROR(AnalyzeDataTable(table, timestamp));
+  for (const Index* index : table->indexes()) {
+    if (!index->is_write_only()) {
+      ZETASQL_RETURN_IF_ERROR(AnalyzeDataTable(index->index_data_table(), timestamp));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Database::AnalyzeTables(absl::Time timestamp) {
+  for (const Table* table : versioned_catalog_->GetLatestSchema()->tables()) {
+    ZETASQL_RETURN_IF_ERROR(AnalyzeTable(table, timestamp));
+  }
+  return absl::OkStatus();
+}
+
+int64_t Database::TruncateDroppedTables(absl::Time version_horizon) {
+  std::vector<TableID> table_ids;
+  {
+    absl::MutexLock lock(&dropped_tables_mu_);
+    auto it = dropped_tables_.begin();
+    for (; it != dropped_tables_.end() && it->first < version_horizon; ++it) {
+      table_ids.push_back(it->second);
+    }
+    dropped_tables_.erase(dropped_tables_.begin(), it);
+  }
+  if (table_ids.empty()) {
+    return 0;
+  }
+
+  int64_t reclaimed_bytes = 0;
+  const std::map<TableID, StorageMemoryUsage> usage =
+      storage_->GetMemoryUsage();
+  for (const TableID& table_id : table_ids) {
+    auto it = usage.find(table_id);
+    if (it != usage.end()) {
+      reclaimed_bytes += it->second.total_bytes();
+    }
+  }
+  // No read can see the dropped tables, so their rows are discarded at once.
+  if (!storage_->Truncate(clock_->Now(), table_ids).ok()) {
+    // The tables are tried again by the next collection.
+    absl::MutexLock lock(&dropped_tables_mu_);
+    for (const TableID& table_id : table_ids) {
+      dropped_tables_.emplace_front(absl::InfinitePast(), table_id);
+    }
+    return 0;
+  }
+  return reclaimed_bytes;
+}
+
+std::map<std::string, int64_t> Database::GetMemoryUsage() const {
+  std::map<TableID, StorageMemoryUsage> usage = storage_->GetMemoryUsage();
+  std::map<std::string, int64_t> usage_by_name;
+  auto add = [&](const std::string& name, const Table* data_table) {
+    auto it = usage.find(data_table->id());
+    if (it != usage.end()) {
+      usage_by_name[name] = it->second.total_bytes();
+    }
+  };
+  for (const Table* table : GetLatestSchema()->tables()) {
+    add(table->Name(), table);
+    for (const Index* index : table->indexes()) {
+      add(index->Name(), index->index_data_table());
+    }
+  }
+  return usage_by_name;
+}
+
+std::string Database::ExportKeyAccessHeatmapJson() const {
+  const KeyAccessHeatmap* heatmap = storage_->key_access_heatmap();
+  if (heatmap == nullptr) {
+    return "[]";
+  }
+  std::map<TableID, std::vector<KeyAccessHeatmap::Interval>> snapshot =
+      heatmap->Snapshot();
+  std::vector<std::string> tables;
+  auto add = [&](const std::string& name, const Table* data_table) {
+    auto it = snapshot.find(data_table->id());
+    if (it == snapshot.end()) {
+      return;
+    }
+    std::vector<std::string> intervals;
+    for (const KeyAccessHeatmap::Interval& interval : it->second) {
+      intervals.push_back(absl::StrCat(
+          "{\"start\":\"",
+          absl::FormatTime(absl::RFC3339_full, interval.start,
+                           absl::UTCTimeZone()),
+          "\",\"reads\":[", absl::StrJoin(interval.reads, ","),
+          "],\"writes\":[", absl::StrJoin(interval.writes, ","), "]}"));
+    }
+    tables.push_back(absl::StrCat("{\"table\":\"", name,
+                                  "\",\"intervals\":[",
+                                  absl::StrJoin(intervals, ","), "]}"));
+  };
+  for (const Table* table : GetLatestSchema()->tables()) {
+    add(table->Name(), table);
+    for (const Index* index : table->indexes()) {
+      add(index->Name(), index->index_data_table());
+    }
+  }
+  return absl::StrCat("[", absl::StrJoin(tables, ","), "]");
+}
+
 absl::StatusOr<std::unique_ptr<ReadOnlyTransaction>>
 Database::CreateReadOnlyTransaction(const ReadOnlyOptions& options) {
   return std::make_unique<ReadOnlyTransaction>(
       options, transaction_id_generator_.NextId(), clock_, storage_.get(),
-      lock_manager_.get(), versioned_catalog_.get());
+      lock_manager_.get(), versioned_catalog_.get(), &read_plan_cache_);
 }
 
 absl::StatusOr<std::unique_ptr<ReadWriteTransaction>>
 Database::CreateReadWriteTransaction(const ReadWriteOptions& options,
                                      const RetryState& retry_state) {
+  std::unique_ptr<ReadWriteTransaction> transaction;
+  {
+    absl::MutexLock lock(&transaction_pool_mu_);
+    if (!transaction_pool_.empty()) {
+      transaction = std::move(transaction_pool_.back());
+      transaction_pool_.pop_back();
+    }
+  }
+  if (transaction != nullptr) {
+    transaction->Reinitialize(options, retry_state,
+                              transaction_id_generator_.NextId(),
+                              lock_manager_.get());
+    return transaction;
+  }
   return std::make_unique<ReadWriteTransaction>(
       options, retry_state, transaction_id_generator_.NextId(), clock_,
       storage_.get(), lock_manager_.get(), versioned_catalog_.get(),
-      action_manager_.get());
+      action_manager_.get(), &change_stream_notifier_, write_ahead_log_.get(),
+      &read_plan_cache_, &txn_stats_, &statistics_,
+      commit_timestamp_index_.get());
+}
+
+void Database::ReleaseReadWriteTransaction(
+    std::unique_ptr<ReadWriteTransaction> transaction) {
+  transaction->Recycle();
+  absl::MutexLock lock(&transaction_pool_mu_);
+  if (transaction_pool_.size() < kMaxPooledTransactions) {
+    transaction_pool_.push_back(std::move(transaction));
+  }
+}
+
+absl::StatusOr<int64_t> Database::ExecutePartitionedDml(const Query& query) {
+  const Schema* schema = GetLatestSchema();
+  ZETASQL_ASSIGN_OR_RETURN(std::string table_name,
+                   query_engine_->GetDmlTargetTable(query, schema));
+  const Table* table = schema->FindTable(table_name);
+  ZETASQL_RET_CHECK_NE(table, nullptr);
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<KeyRange> partitions,
+                   PartitionTableScan(storage_.get(), clock_->Now(),
+                                      table->id()));
+
+  std::vector<int64_t> modified_row_counts(partitions.size());
+  auto execute_partition = [&](int i, const KeyRange& partition) {
+    absl::StatusOr<int64_t> modified_row_count =
+        ExecutePartitionedDmlInKeyRange(query, table, partition);
+    if (!modified_row_count.ok()) {
+      return modified_row_count.status();
+    }
+    modified_row_counts[i] = *modified_row_count;
+    return absl::OkStatus();
+  };
+  // Without row-level locking or optimistic concurrency, concurrent read-write
+  // transactions abort each other, so the partitions are executed one at a
+  // time.
+  if (config::enable_row_level_locking() ||
+      config::enable_optimistic_concurrency()) {
+    ZETASQL_RETURN_IF_ERROR(ScanPartitionsInParallel(partitions, execute_partition));
+  } else {
+    for (int i = 0; i < partitions.size(); ++i) {
+      ZETASQL_RETURN_IF_ERROR(execute_partition(i, partitions[i]));
+    }
+  }
+
+  int64_t modified_row_count = 0;
+  for (int64_t count : modified_row_counts) {
+    modified_row_count += count;
+  }
+  return modified_row_count;
+}
+
+absl::StatusOr<int64_t> Database::ExecutePartitionedDmlInKeyRange(
+    const Query& query, const Table* table, const KeyRange& key_range) {
+  RetryState retry_state;
+  absl::Duration backoff = kPartitionedDmlInitialBackoff;
+  for (int attempt = 1;; ++attempt) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        CreateReadWriteTransaction(ReadWriteOptions(), retry_state));
+    KeyRangeRowReader reader(txn.get(), table, key_range);
+    absl::StatusOr<QueryResult> result = query_engine_->ExecuteSql(
+        query, QueryContext{.schema = txn->schema(),
+                            .reader = &reader,
+                            .writer = txn.get()});
+    absl::Status status = result.status();
+    if (status.ok()) {
+      status = txn->Commit();
+    }
+    if (status.ok()) {
+      return result->modified_row_count;
+    }
+    txn->Rollback().IgnoreError();
+    if (!absl::IsAborted(status) || attempt == kMaxPartitionedDmlAttempts) {
+      return status;
+    }
+    // Keep the priority of the aborted transaction, so that wound-wait lets
+    // the retry through eventually.
+    retry_state = txn->retry_state();
+    absl::SleepFor(backoff);
+    backoff *= 2;
+  }
 }
 
 SchemaChangeContext Database::GetSchemaChangeContext() {
@@ -120,16 +1619,30 @@ absl::Status Database::UpdateSchema(
     return error::UpdateDatabaseMissingStatements();
   }
 
-  // Make an exclusive lock request for the database. If there are any
-  // concurrent transactions it will be denied and the operation aborted.
-  ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
-                              lock_manager_.get()};
-  ZETASQL_RETURN_IF_ERROR(lock.Wait());
-
   // Reserve a commit timestamp for the schema changes. Even if the
   // schema change fails, it will result in a no-op commit that will
   // be invisible to other read-only/read-write transactions.
-  ZETASQL_ASSIGN_OR_RETURN(auto update_timestamp, lock.ReserveCommitTimestamp());
+  const bool preserves_data =
+      std::all_of(schema_change_operation.statements.begin(),
+                  schema_change_operation.statements.end(),
+                  IsDataIndependentStatement);
+  std::optional<ScopedMetadataChange> metadata_change;
+  std::optional<ScopedSchemaChangeLock> lock;
+  absl::Time update_timestamp;
+  if (preserves_data) {
+    // Transactions in progress keep their locks, and commit after the schema
+    // change against the schema they started on.
+    metadata_change.emplace(transaction_id_generator_.NextId(),
+                            lock_manager_.get());
+    ZETASQL_ASSIGN_OR_RETURN(update_timestamp,
+                     metadata_change->ReserveCommitTimestamp());
+  } else {
+    // Make an exclusive lock request for the database. If there are any
+    // concurrent transactions it will be denied and the operation aborted.
+    lock.emplace(transaction_id_generator_.NextId(), lock_manager_.get());
+    ZETASQL_RETURN_IF_ERROR(lock->Wait());
+    ZETASQL_ASSIGN_OR_RETURN(update_timestamp, lock->ReserveCommitTimestamp());
+  }
 
   auto context = GetSchemaChangeContext();
   context.schema_change_timestamp = update_timestamp;
@@ -146,18 +1659,336 @@ absl::Status Database::UpdateSchema(
   // schema will be the schema for the last valid statement before the statement
   // for which the backfill/verification failed.
   if (result.updated_schema != nullptr) {
-    ZETASQL_RETURN_IF_ERROR(versioned_catalog_->AddSchema(
-        update_timestamp, std::move(result.updated_schema)));
-    action_manager_->AddActionsForSchema(versioned_catalog_->GetLatestSchema(),
-                                         query_engine_->function_catalog(),
-                                         query_engine_->type_factory());
+    ZETASQL_RETURN_IF_ERROR(AddSchema(
+        update_timestamp, std::move(result.updated_schema), preserves_data));
+  }
+  if (change_stream_partition_churner_ != nullptr) {
+    change_stream_partition_churner_->Update(
+        versioned_catalog_->GetLatestSchema());
+  }
+
+  absl::Span<const std::string> applied_statements =
+      schema_change_operation.statements.subspan(
+          0, result.num_successful_statements);
+  if (std::any_of(applied_statements.begin(), applied_statements.end(),
+                  IsAnalyzeStatement)) {
+    ZETASQL_RETURN_IF_ERROR(AnalyzeTables(update_timestamp));
+  }
+
+  // Only the statements which were applied are logged, so that replaying them
+  // leads to the same schema.
+  std::vector<std::string> logged_statements;
+  for (const std::string& statement : applied_statements) {
+    if (!DropsWriteOnlyIndex(existing_schema, statement)) {
+      logged_statements.push_back(statement);
+    }
+  }
+  return LogSchemaChange(logged_statements);
+}
+
+absl::Status Database::AddSchema(absl::Time timestamp,
+                                 std::unique_ptr<const Schema> schema,
+                                 bool preserves_data) {
+  const Schema* previous_schema = versioned_catalog_->GetLatestSchema();
+  std::vector<TableID> previous_table_ids;
+  AddDataTableIds(previous_schema, &previous_table_ids);
+  ZETASQL_RETURN_IF_ERROR(versioned_catalog_->AddSchema(
+      timestamp, std::move(schema), preserves_data));
+
+  // New tables and indexes, including those which an online backfill made
+  // readable, are analyzed once so that commits keep their statistics up to
+  // date from then on.
+  std::sort(previous_table_ids.begin(), previous_table_ids.end());
+  auto is_new = [&](const Table* data_table) {
+    return !std::binary_search(previous_table_ids.begin(),
+                               previous_table_ids.end(), data_table->id());
+  };
+  for (const Table* table : versioned_catalog_->GetLatestSchema()->tables()) {
+    if (is_new(table)) {
+      ZETASQL_RETURN_IF_ERROR(AnalyzeDataTable(table, timestamp));
+    }
+    // The keys of a table are only recorded in the commit timestamp index
+    // while it has a column which allows commit timestamps, so the index of a
+    // table which gains one only covers the writes from now on.
+    const Table* previous_table = previous_schema->FindTable(table->Name());
+    if (AllowsCommitTimestamps(table) && previous_table != nullptr &&
+        previous_table->id() == table->id() &&
+        !AllowsCommitTimestamps(previous_table)) {
+      commit_timestamp_index_->Erase(table->id(), timestamp);
+    }
+    for (const Index* index : table->indexes()) {
+      if (index->is_write_only()) {
+        continue;
+      }
+      const Index* previous_index = previous_schema->FindIndex(index->Name());
+      if (is_new(index->index_data_table()) || previous_index == nullptr ||
+          previous_index->is_write_only()) {
+        ZETASQL_RETURN_IF_ERROR(
+            AnalyzeDataTable(index->index_data_table(), timestamp));
+      }
+    }
   }
-  change_stream_partition_churner_->Update(
-      versioned_catalog_->GetLatestSchema());
 
+  // Storage tables are never reused, so those of the tables, indexes and
+  // change streams which were dropped can be discarded once reads at earlier
+  // timestamps are no longer allowed.
+  std::vector<TableID> latest_table_ids;
+  AddDataTableIds(versioned_catalog_->GetLatestSchema(), &latest_table_ids);
+  std::sort(latest_table_ids.begin(), latest_table_ids.end());
+  {
+    absl::MutexLock lock(&dropped_tables_mu_);
+    for (const TableID& table_id : previous_table_ids) {
+      if (!std::binary_search(latest_table_ids.begin(), latest_table_ids.end(),
+                              table_id)) {
+        dropped_tables_.emplace_back(timestamp, table_id);
+        statistics_.Erase(table_id);
+      }
+    }
+  }
+
+  RegisterInterleavedTables(versioned_catalog_->GetLatestSchema(),
+                            storage_.get());
+  action_manager_->AddActionsForSchema(versioned_catalog_->GetLatestSchema(),
+                                       query_engine_->function_catalog(),
+                                       query_engine_->type_factory());
   return absl::OkStatus();
 }
 
+absl::Status Database::LogSchemaChange(
+    absl::Span<const std::string> statements) {
+  if (write_ahead_log_ == nullptr || statements.empty()) {
+    return absl::OkStatus();
+  }
+  WriteAheadLogRecord record;
+  for (const std::string& statement : statements) {
+    record.mutable_schema_change()->add_statements(statement);
+  }
+  return write_ahead_log_->Append(record);
+}
+
+bool Database::CanCreateIndexesOnline(
+    const SchemaChangeOperation& schema_change_operation) {
+  if (schema_change_operation.statements.empty()) {
+    return false;
+  }
+  for (const std::string& statement : schema_change_operation.statements) {
+    ddl::DDLStatement ddl_statement;
+    if (!ddl::ParseDDLStatement(statement, &ddl_statement).ok() ||
+        !ddl_statement.has_create_index()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+absl::Status Database::CreateIndexesOnline(
+    const SchemaChangeOperation& schema_change_operation,
+    absl::Time* commit_timestamp, std::function<void(absl::Status)> done) {
+  ZETASQL_RET_CHECK(CanCreateIndexesOnline(schema_change_operation));
+  OnlineIndexBackfill backfill{
+      .statements = {schema_change_operation.statements.begin(),
+                     schema_change_operation.statements.end()},
+      .done = std::move(done)};
+  {
+    ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                                lock_manager_.get()};
+    ZETASQL_RETURN_IF_ERROR(lock.Wait());
+    ZETASQL_ASSIGN_OR_RETURN(absl::Time update_timestamp,
+                     lock.ReserveCommitTimestamp());
+
+    // The indexes are created without backfilling them, so the statements
+    // either all apply or fail validation.
+    SchemaChangeContext context = GetSchemaChangeContext();
+    context.schema_change_timestamp = update_timestamp;
+    context.create_write_only_indexes = true;
+    const Schema* existing_schema = versioned_catalog_->GetLatestSchema();
+    SchemaUpdater updater;
+    ZETASQL_ASSIGN_OR_RETURN(SchemaChangeResult result,
+                     updater.UpdateSchemaFromDDL(
+                         existing_schema, schema_change_operation, context));
+    ZETASQL_RETURN_IF_ERROR(result.backfill_status);
+    ZETASQL_RET_CHECK_EQ(result.num_successful_statements,
+                 static_cast<int>(schema_change_operation.statements.size()));
+
+    // Write-only indexes which already existed belong to an earlier call.
+    for (const Table* table : result.updated_schema->tables()) {
+      for (const Index* index : table->indexes()) {
+        if (index->is_write_only() &&
+            existing_schema->FindIndex(index->Name()) == nullptr) {
+          backfill.index_names.push_back(index->Name());
+        }
+      }
+    }
+    ZETASQL_RET_CHECK(!backfill.index_names.empty());
+    ZETASQL_RETURN_IF_ERROR(
+        AddSchema(update_timestamp, std::move(result.updated_schema)));
+    *commit_timestamp = update_timestamp;
+  }
+
+  // The thread of earlier backfills exits once none are left, and is replaced.
+  std::thread finished_thread;
+  {
+    absl::MutexLock lock(&index_backfill_mu_);
+    index_backfills_.push_back(std::move(backfill));
+    if (!index_backfill_thread_running_) {
+      index_backfill_thread_running_ = true;
+      finished_thread = std::move(index_backfill_thread_);
+      index_backfill_thread_ =
+          std::thread(&Database::RunOnlineIndexBackfills, this);
+    }
+  }
+  if (finished_thread.joinable()) {
+    finished_thread.join();
+  }
+  return absl::OkStatus();
+}
+
+void Database::RunOnlineIndexBackfills() {
+  while (true) {
+    OnlineIndexBackfill backfill;
+    {
+      absl::MutexLock lock(&index_backfill_mu_);
+      if (stop_index_backfills_) {
+        break;
+      }
+      if (index_backfills_.empty()) {
+        index_backfill_thread_running_ = false;
+        return;
+      }
+      backfill = std::move(index_backfills_.front());
+      index_backfills_.pop_front();
+    }
+    backfill.done(BackfillIndexesOnline(backfill));
+  }
+
+  // Nothing else is queued once stop_index_backfills_ is set.
+  std::deque<OnlineIndexBackfill> cancelled;
+  {
+    absl::MutexLock lock(&index_backfill_mu_);
+    cancelled.swap(index_backfills_);
+  }
+  for (const OnlineIndexBackfill& backfill : cancelled) {
+    backfill.done(
+        error::OnlineIndexBackfillCancelled(backfill.index_names.front()));
+  }
+}
+
+absl::Status Database::BackfillIndexesOnline(
+    const OnlineIndexBackfill& backfill) {
+  absl::Status status = [&]() -> absl::Status {
+    for (const std::string& index_name : backfill.index_names) {
+      Key start_key = Key::Empty();
+      bool backfilled = false;
+      while (!backfilled) {
+        ZETASQL_RETURN_IF_ERROR(RunWithSchemaChangeLock(
+            index_name, [&](absl::Time timestamp) -> absl::Status {
+              // The index may have been dropped since the last chunk.
+              const Index* index =
+                  versioned_catalog_->GetLatestSchema()->FindIndex(index_name);
+              if (index == nullptr || !index->is_write_only()) {
+                return error::OnlineIndexBackfillCancelled(index_name);
+              }
+              SchemaValidationContext context{storage_.get(),
+                                              /*global_names=*/nullptr,
+                                              type_factory_.get(), timestamp};
+              ZETASQL_ASSIGN_OR_RETURN(
+                  backfilled,
+                  BackfillIndexChunk(index, &context,
+                                     kOnlineIndexBackfillChunkRows,
+                                     &start_key));
+              return absl::OkStatus();
+            }));
+      }
+    }
+
+    const std::string& index_name = backfill.index_names.front();
+    return RunWithSchemaChangeLock(
+        index_name, [&](absl::Time timestamp) -> absl::Status {
+          const Schema* existing_schema = versioned_catalog_->GetLatestSchema();
+          for (const std::string& name : backfill.index_names) {
+            const Index* index = existing_schema->FindIndex(name);
+            if (index == nullptr || !index->is_write_only()) {
+              return error::OnlineIndexBackfillCancelled(name);
+            }
+          }
+          SchemaChangeContext context = GetSchemaChangeContext();
+          context.schema_change_timestamp = timestamp;
+          SchemaUpdater updater;
+          ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<const Schema> schema,
+                           updater.MakeIndexesReadable(
+                               existing_schema, backfill.index_names, context));
+          ZETASQL_RETURN_IF_ERROR(AddSchema(timestamp, std::move(schema)));
+
+          // The statements are only logged once the backfill has succeeded,
+          // so that replaying them, which creates the indexes with a full
+          // backfill, does not fail. They follow the writes committed during
+          // the backfill, which the replayed backfill then indexes.
+          return LogSchemaChange(backfill.statements);
+        });
+  }();
+  if (!status.ok()) {
+    // Best effort: if the database is being destroyed, so are its indexes.
+    DropWriteOnlyIndexes(backfill.index_names).IgnoreError();
+  }
+  return status;
+}
+
+absl::Status Database::RunWithSchemaChangeLock(
+    absl::string_view index_name,
+    const std::function<absl::Status(absl::Time)>& fn) {
+  while (true) {
+    {
+      ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
+                                  lock_manager_.get()};
+      absl::Status status = lock.Wait();
+      if (status.ok()) {
+        ZETASQL_ASSIGN_OR_RETURN(absl::Time timestamp,
+                         lock.ReserveCommitTimestamp());
+        return fn(timestamp);
+      }
+      if (status.code() != absl::StatusCode::kFailedPrecondition) {
+        return status;
+      }
+    }
+    absl::MutexLock lock(&index_backfill_mu_);
+    index_backfill_mu_.AwaitWithTimeout(
+        absl::Condition(&stop_index_backfills_),
+        kOnlineIndexBackfillRetryDelay);
+    if (stop_index_backfills_) {
+      return error::OnlineIndexBackfillCancelled(index_name);
+    }
+  }
+}
+
+absl::Status Database::DropWriteOnlyIndexes(
+    absl::Span<const std::string> index_names) {
+  return RunWithSchemaChangeLock(
+      index_names.front(), [&](absl::Time timestamp) -> absl::Status {
+        std::vector<std::string> statements;
+        const Schema* existing_schema = versioned_catalog_->GetLatestSchema();
+        for (const std::string& name : index_names) {
+          const Index* index = existing_schema->FindIndex(name);
+          if (index != nullptr && index->is_write_only()) {
+            statements.push_back(absl::StrCat("DROP INDEX `", name, "`"));
+          }
+        }
+        if (statements.empty()) {
+          return absl::OkStatus();
+        }
+        SchemaChangeContext context = GetSchemaChangeContext();
+        context.schema_change_timestamp = timestamp;
+        SchemaUpdater updater;
+        ZETASQL_ASSIGN_OR_RETURN(
+            SchemaChangeResult result,
+            updater.UpdateSchemaFromDDL(
+                existing_schema,
+                SchemaChangeOperation{.statements = statements}, context));
+        ZETASQL_RETURN_IF_ERROR(result.backfill_status);
+        // The indexes were never logged, see BackfillIndexesOnline.
+        return AddSchema(timestamp, std::move(result.updated_schema));
+      });
+}
+
 const Schema* Database::GetLatestSchema() const {
   return versioned_catalog_->GetLatestSchema();
 }
@@ -17,28 +17,54 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_DATABASE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_DATABASE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "zetasql/public/type.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "backend/actions/manager.h"
 #include "backend/common/ids.h"
+#include "backend/common/periodic_task_scheduler.h"
+#include "backend/database/change_stream/change_stream_notifier.h"
+#include "backend/database/change_stream/change_stream_partition_cache.h"
 #include "backend/database/change_stream/change_stream_partition_churner.h"
+#include "backend/database/change_stream/change_stream_scan_cache.h"
+#include "backend/database/snapshot.pb.h"
+#include "backend/database/write_ahead_log.h"
+#include "backend/database/write_ahead_log.pb.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/locking/manager.h"
 #include "backend/query/query_engine.h"
+#include "backend/query/read_stats_aggregator.h"
+#include "backend/query/transaction_stats_aggregator.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
 #include "backend/schema/catalog/versioned_catalog.h"
+#include "backend/schema/printer/print_ddl.h"
 #include "backend/schema/updater/schema_updater.h"
+#include "backend/storage/commit_timestamp_index.h"
+#include "backend/storage/hydrating_storage.h"
 #include "backend/storage/storage.h"
 #include "backend/transaction/options.h"
 #include "backend/transaction/read_only_transaction.h"
 #include "backend/transaction/read_write_transaction.h"
+#include "backend/transaction/resolve.h"
 #include "common/clock.h"
 #include "absl/status/status.h"
 
@@ -47,27 +73,105 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+// Options for the storage which holds the rows of a database.
+struct StorageOptions {
+  // If non-empty, rows are kept in a DiskStorage with its scratch file in this
+  // directory. Otherwise they are kept in memory.
+  std::string disk_storage_dir;
+
+  // The size of the cache of values read back from the scratch file.
+  int64_t disk_storage_cache_bytes = 64 << 20;
+
+  // If non-empty, the database initially holds the rows of the fixture at
+  // this path, written by Database::WriteFixture, which are served from the
+  // file by a FixtureStorage on top of the storage selected above.
+  std::string fixture_path;
+
+  // If true, a database created from a snapshot writes the rows of each table
+  // to storage when the table is first accessed rather than while it is
+  // created, so that it can serve requests before a large snapshot has been
+  // decoded. See HydratingStorage.
+  bool hydrate_snapshots_lazily = false;
+
+  // The number of threads writing the rows of such tables in the background
+  // until every table has been accessed. Zero leaves tables to be written by
+  // their first access.
+  int snapshot_hydration_threads = 0;
+};
+
 // Database represents a database in the emulator backend.
 //
 // Database largely ties together various subsystems - transactions, locking,
 // schemas, queries, storage etc. and acts as a container for these subsystems.
 class Database {
  public:
+  // A schema created from DDL statements, which databases created from the
+  // same statements can share instead of building it again.
+  struct SchemaTemplate {
+    std::shared_ptr<const Schema> schema;
+
+    // Owns the types referenced by the schema.
+    std::shared_ptr<zetasql::TypeFactory> type_factory;
+
+    // The sequence numbers of the first IDs not assigned in the schema.
+    int64_t next_table_seq = 0;
+    int64_t next_column_seq = 0;
+  };
+
   // Constructs a fully initialized database with schema created using
   // create_statements. Returns an error if create_statements are invalid, or if
   // failed to create the database.
   static absl::StatusOr<std::unique_ptr<Database>> Create(
-      Clock* clock, const SchemaChangeOperation& schema_change_operation);
+      Clock* clock, const SchemaChangeOperation& schema_change_operation,
+      const StorageOptions& storage_options = {});
+
+  // Builds the schema Create would for the non-empty list of statements in
+  // schema_change_operation. Returns null if the schema cannot be shared,
+  // because creating it also writes rows: the initial partitions of change
+  // streams.
+  static absl::StatusOr<std::shared_ptr<const SchemaTemplate>>
+  CreateSchemaTemplate(const SchemaChangeOperation& schema_change_operation);
+
+  // Constructs a database whose initial schema is that of schema_template.
+  // Equivalent to Create with the statements of the template.
+  static absl::StatusOr<std::unique_ptr<Database>> CreateFromTemplate(
+      Clock* clock, std::shared_ptr<const SchemaTemplate> schema_template,
+      const StorageOptions& storage_options = {});
+
+  // Constructs a database with the schema and rows of the given snapshot.
+  static absl::StatusOr<std::unique_ptr<Database>> CreateFromSnapshot(
+      Clock* clock, const DatabaseSnapshot& snapshot,
+      const StorageOptions& storage_options = {});
+
+  // Constructs a copy of this database with its schema and all row versions
+  // committed so far. Storage and schemas are shared with this database and
+  // copied on write, so cloning is cheap regardless of the amount of data.
+  // Changes made to either database afterwards are not visible in the other.
+  //
+  // Like a schema change, cloning requires exclusive access to the database and
+  // fails if there are other transactions in progress, or if indexes created by
+  // CreateIndexesOnline are still being backfilled.
+  absl::StatusOr<std::unique_ptr<Database>> Clone();
+
+  ~Database();
 
   // Creates a read only transaction attached to this database.
   absl::StatusOr<std::unique_ptr<ReadOnlyTransaction>>
   CreateReadOnlyTransaction(const ReadOnlyOptions& options);
 
-  // Creates a read write transaction attached to this database.
+  // Creates a read write transaction attached to this database. The
+  // transaction object is reused from those released by
+  // ReleaseReadWriteTransaction when there are any.
   absl::StatusOr<std::unique_ptr<ReadWriteTransaction>>
   CreateReadWriteTransaction(const ReadWriteOptions& options,
                              const RetryState& retry_state);
 
+  // Returns a read write transaction created by this database, which is no
+  // longer used, for reuse by CreateReadWriteTransaction. Its locks are
+  // released right away.
+  void ReleaseReadWriteTransaction(
+      std::unique_ptr<ReadWriteTransaction> transaction);
+
   // Updates the schema for this database.
   //
   // All schema changes are applied synchronously and transactionally.
@@ -97,29 +201,299 @@ class Database {
   // encountered while processing the backfill/verification actions for the
   // statements, then the first such error will be returned in
   // `backfill_status`.
+  //
+  // Statements which leave the data untouched, such as CREATE VIEW, ALTER
+  // TABLE ADD COLUMN of a nullable column without a default, and SET OPTIONS on
+  // columns, are committed without the database lock when they are all the
+  // statements of the operation: concurrent read-write transactions are then
+  // neither waited for nor aborted, and can commit after the schema change.
   absl::Status UpdateSchema(
       const SchemaChangeOperation& schema_change_operation,
       int* num_succesful_statements, absl::Time* commit_timestamp,
       absl::Status* backfill_status);
 
+  // Returns true if schema_change_operation can be applied by
+  // CreateIndexesOnline: it is made only of CREATE INDEX statements.
+  static bool CanCreateIndexesOnline(
+      const SchemaChangeOperation& schema_change_operation);
+
+  // Creates the indexes of schema_change_operation, which must satisfy
+  // CanCreateIndexesOnline, without holding the database lock for the length
+  // of their backfill.
+  //
+  // The statements are validated and applied synchronously, like UpdateSchema,
+  // except that the new indexes are write-only: writes maintain them, but they
+  // cannot be read from. On success `commit_timestamp` is set to the timestamp
+  // of that schema change. The indexes are then backfilled in the background,
+  // a chunk of rows at a time, each chunk briefly holding the database lock so
+  // that transactions can commit between chunks. Once every index is
+  // backfilled, the indexes are made readable and `done` is called with
+  // absl::OkStatus(). If the backfill fails, for instance because of a unique
+  // index violation, the indexes which are still write-only are dropped and
+  // `done` is called with the error. If the database is destroyed first,
+  // `done` is called with a CANCELLED error.
+  //
+  // `done` is not called if the returned status is not ok, and it is called
+  // from a background thread otherwise.
+  absl::Status CreateIndexesOnline(
+      const SchemaChangeOperation& schema_change_operation,
+      absl::Time* commit_timestamp, std::function<void(absl::Status)> done);
+
   // Retrives the current version of the schema.
   const Schema* GetLatestSchema() const;
 
+  // Prints the DDL statements of a version of the schema of this database,
+  // reusing those printed for the previous version where it is unchanged.
+  absl::StatusOr<std::vector<std::string>> PrintDDLStatements(
+      const Schema* schema) {
+    return ddl_statement_cache_.PrintDDLStatements(schema);
+  }
+
   // Used to execute queries against the database.
   QueryEngine* query_engine() { return query_engine_.get(); }
 
+  // Records the read requests of this database for the SPANNER_SYS read
+  // statistics.
+  ReadStatsAggregator* read_stats() { return &read_stats_; }
+
+  // Optimizer statistics of the tables and indexes of this database, which are
+  // rebuilt by ANALYZE and kept up to date by commits.
+  const DatabaseStatistics* statistics() const { return &statistics_; }
+
   ChangeStreamPartitionChurner* get_change_stream_partition_churner() {
     return change_stream_partition_churner_.get();
   }
 
+  // Used by change stream queries to wait for newly committed records.
+  ChangeStreamNotifier* change_stream_notifier() {
+    return &change_stream_notifier_;
+  }
+
+  // Used by change stream queries to find out when their partitions end.
+  ChangeStreamPartitionCache* change_stream_partition_cache() {
+    return &change_stream_partition_cache_;
+  }
+
+  // Shared by change stream queries reading the same partitions.
+  ChangeStreamScanCache* change_stream_scan_cache() {
+    return &change_stream_scan_cache_;
+  }
+
+  // Returns a snapshot of the latest schema and of the rows visible to a strong
+  // read. The schema is captured as the DDL statements returned by
+  // GetDatabaseDdl, and only the latest version of each row is kept.
+  absl::StatusOr<DatabaseSnapshot> CreateSnapshot();
+
+  // Writes the rows of every table and index visible to a strong read to a
+  // fixture at path (see FixtureWriter), which databases with the same tables
+  // and columns can be created from with StorageOptions::fixture_path. Only
+  // the latest version of each row is kept.
+  absl::Status WriteFixture(const std::string& path);
+
+  // Exports the rows of a table, see ExportTables.
+  using TableExporter =
+      std::function<absl::Status(const Table* table, StorageIterator* itr)>;
+
+  // Calls export_table for each table visible to a strong read, with an
+  // iterator over the rows of the table at the read timestamp which returns
+  // the values of its columns in order. Rows are streamed straight from
+  // storage rather than read through the query engine, and up to
+  // DefaultScanParallelism() tables are exported in parallel, so export_table
+  // must be thread-safe. Returns the first error in table order.
+  absl::Status ExportTables(const TableExporter& export_table);
+
+  // Loads the rows of the given tables in a single batch, for seeding large
+  // datasets. Unlike a commit, rows are written to storage without running the
+  // per-row validators and effectors. Instead, once all rows are written, the
+  // indexes of the tables are built and the rows are verified with the same
+  // checks as a schema change adding the corresponding constraints. If any of
+  // the checks fail, none of the rows are visible.
+  //
+  // The tables must be empty, and each row must have a value for every key
+  // column. Values of generated columns and column defaults are not computed,
+  // and the rows are not recorded in change streams. Like a schema change,
+  // bulk loading requires exclusive access to the database.
+  absl::Status BulkLoad(absl::Span<const TableSnapshot> tables);
+
+  // Discards the rows of every table and index, keeping the schema, so that
+  // tests can start each case from an empty database without deleting rows or
+  // recreating the database. Storage discards the rows of whole tables at once
+  // rather than deleting them one by one (see Storage::Truncate), so resetting
+  // costs the same regardless of the number of rows. Reads at timestamps
+  // before the reset may see no rows afterwards. The partitions and records of
+  // change streams are kept. Like a schema change, resetting requires
+  // exclusive access to the database.
+  absl::Status ResetData();
+
+  // Starts appending the changes made to this database to log: the commits of
+  // read write transactions created afterwards, schema changes and bulk loads.
+  // If log is empty, a snapshot of the database is appended first, so that the
+  // log alone can recreate the database. Must be called before the database is
+  // used by any transaction.
+  absl::Status StartWriteAheadLog(std::unique_ptr<WriteAheadLog> log);
+
+  // Replaces the records in the write ahead log, if any, with snapshot, which
+  // must be a snapshot of this database returned by CreateSnapshot while no
+  // transactions were in progress.
+  absl::Status ResetWriteAheadLog(const DatabaseSnapshot& snapshot);
+
+  // Applies a record that follows the initial snapshot of a write ahead log to
+  // this database, which must have been created from that snapshot. Commits are
+  // written to storage directly, at a new timestamp, without running
+  // validators or effectors again, since the record holds all their writes.
+  absl::Status ReplayWriteAheadLogRecord(const WriteAheadLogRecord& record);
+
+  // Executes query, a partitioned DML statement, and returns the number of rows
+  // it modified. The rows of the table modified by the statement are split into
+  // key ranges, and the statement is executed and committed in a separate
+  // transaction for each of them, retrying ranges which abort. The ranges are
+  // executed concurrently when row-level locking is enabled, and one after the
+  // other otherwise, so that other writers can commit between them. As in
+  // Cloud Spanner, if executing a range fails, the ranges already committed
+  // stay committed.
+  absl::StatusOr<int64_t> ExecutePartitionedDml(const Query& query);
+
+  // Discards row versions which can no longer be read, the rows of tables,
+  // indexes and change streams dropped before then, and the schema versions
+  // superseded before then which no live transaction uses, together with their
+  // actions and cached queries. Versions are retained for the stale read limit,
+  // or for the longest change stream retention period if that is longer. If
+  // config::cold_version_age() is positive, the versions superseded before
+  // then are also compressed. Returns an estimate of the bytes of rows
+  // reclaimed.
+  //
+  // This is called periodically in the background, see
+  // config::version_gc_interval().
+  int64_t CollectGarbage();
+
+  // Returns the bytes of memory used by the rows of each table and index of the
+  // latest schema, keyed by name. Tables whose rows are stored with their
+  // parent's are not included. See Storage::GetMemoryUsage.
+  std::map<std::string, int64_t> GetMemoryUsage() const;
+
+  // Returns the key access heatmap of each table and index of the latest
+  // schema as a JSON array, or an empty array if the storage does not sample
+  // its key accesses. See Storage::key_access_heatmap. Each element has the
+  // name of the table and its intervals, oldest first, each with its start
+  // time and the estimated reads and writes of each key range bucket.
+  std::string ExportKeyAccessHeatmapJson() const;
+
+  // Returns the total number of bytes reclaimed by CollectGarbage.
+  int64_t reclaimed_version_bytes() const {
+    return reclaimed_version_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Aborts read-write transactions which have held locks without making a
+  // request for at least idle_timeout, so that other writers can proceed.
+  // Returns the number of transactions aborted.
+  //
+  // This is called periodically in the background, see
+  // config::idle_transaction_timeout().
+  int64_t AbortIdleTransactions(absl::Duration idle_timeout);
+
+  // Returns the total number of transactions aborted by AbortIdleTransactions.
+  int64_t idle_transactions_aborted() const {
+    return idle_transactions_aborted_.load(std::memory_order_relaxed);
+  }
+
+  // Returns a summary of the lock contention between the transactions of this
+  // database. Conflicts per key are reported in the SPANNER_SYS.LOCK_STATS_*
+  // tables.
+  LockManager::ContentionStats GetLockContentionStats() const {
+    return lock_manager_->GetContentionStats();
+  }
+
  private:
   Database();
+  // Constructs a database whose storage ID generators continue from the given
+  // sequence numbers, so that IDs are not reused in a clone.
+  Database(int64_t next_table_seq, int64_t next_column_seq,
+           int64_t next_change_stream_seq);
   // Delete copy and assignment operators since database shouldn't be copyable.
   Database(const Database&) = delete;
   Database& operator=(const Database&) = delete;
 
   SchemaChangeContext GetSchemaChangeContext();
 
+  // Creates the storage selected by storage_options.
+  static absl::StatusOr<std::unique_ptr<Storage>> CreateStorage(
+      const StorageOptions& storage_options);
+
+  // Puts the storages selected by storage_options, if any, in front of
+  // storage_: a FixtureStorage whose tables are bound to those of the latest
+  // schema, then a HydratingStorage for lazily restored snapshots. Must be
+  // called before InitializeFromSchema.
+  absl::Status WrapStorage(const StorageOptions& storage_options);
+  absl::Status OpenFixture(const std::string& path);
+
+  // Writes the rows of the given snapshot to storage in a single batch, or
+  // hands them to hydrating_storage_ if it is set. The snapshot rows must match
+  // the current schema.
+  absl::Status RestoreRows(const DatabaseSnapshot& snapshot);
+  absl::Status RestoreRowsLazily(const Schema* schema,
+                                 const DatabaseSnapshot& snapshot);
+
+  // Executes the partitioned DML statement query and commits it, with the
+  // reads of table restricted to key_range.
+  absl::StatusOr<int64_t> ExecutePartitionedDmlInKeyRange(
+      const Query& query, const Table* table, const KeyRange& key_range);
+
+  // A set of write-only indexes created by CreateIndexesOnline, and the
+  // callback to run once they are backfilled.
+  struct OnlineIndexBackfill {
+    // The CREATE INDEX statements, logged once the indexes are readable.
+    std::vector<std::string> statements;
+    std::vector<std::string> index_names;
+    std::function<void(absl::Status)> done;
+  };
+
+  // Makes schema the latest schema of this database as of timestamp. If
+  // preserves_data is true, schema differs from the latest one in metadata
+  // only (see VersionedCatalog::AddSchema).
+  absl::Status AddSchema(absl::Time timestamp,
+                         std::unique_ptr<const Schema> schema,
+                         bool preserves_data = false);
+
+  // Appends statements, which were applied as a schema change, to the write
+  // ahead log if there is one.
+  absl::Status LogSchemaChange(absl::Span<const std::string> statements);
+
+  // Runs the backfills queued by CreateIndexesOnline until the database is
+  // destroyed.
+  void RunOnlineIndexBackfills();
+
+  // Backfills the write-only indexes of backfill and makes them readable.
+  absl::Status BackfillIndexesOnline(const OnlineIndexBackfill& backfill);
+
+  // Runs fn under an exclusive database lock at a reserved commit timestamp,
+  // waiting for transactions in progress to finish. Returns a CANCELLED error
+  // if the database is destroyed while waiting.
+  absl::Status RunWithSchemaChangeLock(
+      absl::string_view index_name,
+      const std::function<absl::Status(absl::Time)>& fn);
+
+  // Discards the rows of the storage tables dropped before version_horizon.
+  // Returns an estimate of the bytes reclaimed.
+  int64_t TruncateDroppedTables(absl::Time version_horizon);
+
+  // Rebuilds the statistics of data_table, a table or index data table, from
+  // its rows at timestamp.
+  absl::Status AnalyzeDataTable(const Table* data_table, absl::Time timestamp);
+
+  // Rebuilds the statistics of table and of its readable indexes.
+  absl::Status AnalyzeTable(const Table* table, absl::Time timestamp);
+
+  // Rebuilds the statistics of every table and readable index of the latest
+  // schema.
+  absl::Status AnalyzeTables(absl::Time timestamp);
+
+  // Drops those of index_names which are still write-only.
+  absl::Status DropWriteOnlyIndexes(absl::Span<const std::string> index_names);
+
+  // Creates the subsystems which are not shared with clones of this database,
+  // once storage, type_factory_ and versioned_catalog_ are set up.
+  void InitializeFromSchema();
+
   // Clock to provide commit timestamps.
   Clock* clock_;
 
@@ -138,23 +512,102 @@ class Database {
   // Underlying storage for the database.
   std::unique_ptr<Storage> storage_;
 
+  // The storage_ of a database created with
+  // StorageOptions::hydrate_snapshots_lazily, or null.
+  HydratingStorage* hydrating_storage_ = nullptr;
+  int snapshot_hydration_threads_ = 0;
+
   // Lock management.
   std::unique_ptr<LockManager> lock_manager_;
 
-  // Type factory used for all ZetaSQL operations on this database.
-  std::unique_ptr<zetasql::TypeFactory> type_factory_;
+  // Type factory used for all ZetaSQL operations on this database. Types made
+  // by it are referenced from schemas, so it is shared with clones.
+  std::shared_ptr<zetasql::TypeFactory> type_factory_;
 
   // Versioned catalog of this database.
   std::unique_ptr<VersionedCatalog> versioned_catalog_;
 
+  // Cache of the reads resolved against the schemas of versioned_catalog_.
+  // Schemas are never removed from the catalog, which is destroyed after the
+  // cache, so every cached schema stays alive as long as the cache.
+  ReadPlanCache read_plan_cache_;
+
+  // Statistics of the read-write transactions and reads of this database,
+  // served by the query engine's SPANNER_SYS tables.
+  TransactionStatsAggregator txn_stats_;
+  ReadStatsAggregator read_stats_;
+
+  // Optimizer statistics of the tables and indexes, used by the query engine
+  // to choose how to scan them.
+  DatabaseStatistics statistics_;
+
+  // The keys written by each commit to tables with commit timestamp columns,
+  // used by the query engine to find the rows changed since a timestamp.
+  std::unique_ptr<CommitTimestampIndex> commit_timestamp_index_;
+
   // Query engine of the database.
   std::unique_ptr<QueryEngine> query_engine_;
 
   // Maintains an action registry per schema.
   std::unique_ptr<ActionManager> action_manager_;
 
+  // Notified by read write transactions which write change stream records.
+  ChangeStreamNotifier change_stream_notifier_;
+
+  // Notified by change_stream_partition_churner_ of the partitions it ends.
+  ChangeStreamPartitionCache change_stream_partition_cache_;
+
+  // Holds the data change records scanned by change stream queries.
+  ChangeStreamScanCache change_stream_scan_cache_;
+
+  // Holds the DDL statements printed for the latest schema.
+  DDLStatementCache ddl_statement_cache_;
+
+  // Log of the changes made to this database. May be null.
+  std::unique_ptr<WriteAheadLog> write_ahead_log_;
+
+  // Null when following another emulator's write ahead log.
   std::unique_ptr<ChangeStreamPartitionChurner>
       change_stream_partition_churner_;
+
+  // Transactions released by ReleaseReadWriteTransaction, at most
+  // kMaxPooledTransactions of them. They point into the members above, so are
+  // destroyed before them.
+  absl::Mutex transaction_pool_mu_;
+  std::vector<std::unique_ptr<ReadWriteTransaction>> transaction_pool_
+      ABSL_GUARDED_BY(transaction_pool_mu_);
+
+  // Total bytes reclaimed by version garbage collection.
+  std::atomic<int64_t> reclaimed_version_bytes_ = 0;
+
+  // Storage tables of the dropped tables, indexes and change streams, with the
+  // time they were dropped, oldest first. Their rows are discarded by
+  // CollectGarbage once no read can see them.
+  absl::Mutex dropped_tables_mu_;
+  std::deque<std::pair<absl::Time, TableID>> dropped_tables_
+      ABSL_GUARDED_BY(dropped_tables_mu_);
+
+  // Background version garbage collection, run by a scheduler shared with the
+  // other databases until the database is destroyed.
+  std::optional<PeriodicTaskScheduler::TaskId> gc_task_;
+
+  // Total transactions aborted by AbortIdleTransactions.
+  std::atomic<int64_t> idle_transactions_aborted_ = 0;
+
+  // Background aborts of idle transactions, run like gc_task_ but by a
+  // scheduler of their own.
+  std::optional<PeriodicTaskScheduler::TaskId> idle_transaction_reaper_task_;
+
+  // Background backfills of online index creations. CreateIndexesOnline starts
+  // the thread when it is not running, and the thread exits once no backfills
+  // are left or stop_index_backfills_ is set.
+  absl::Mutex index_backfill_mu_;
+  std::deque<OnlineIndexBackfill> index_backfills_
+      ABSL_GUARDED_BY(index_backfill_mu_);
+  bool stop_index_backfills_ ABSL_GUARDED_BY(index_backfill_mu_) = false;
+  bool index_backfill_thread_running_ ABSL_GUARDED_BY(index_backfill_mu_) =
+      false;
+  std::thread index_backfill_thread_;
 };
 
 }  // namespace backend
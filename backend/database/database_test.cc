@@ -16,7 +16,9 @@
 
 #include "backend/database/database.h"
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,12 +28,23 @@
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
 #include "backend/access/read.h"
+#include "backend/database/snapshot.pb.h"
+#include "backend/database/write_ahead_log.h"
+#include "backend/database/write_ahead_log.pb.h"
+#include "backend/datamodel/key.h"
 #include "backend/datamodel/key_set.h"
+#include "backend/query/query_engine.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
 #include "backend/schema/updater/schema_updater.h"
 #include "backend/transaction/options.h"
 #include "common/clock.h"
 #include "common/errors.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
@@ -40,6 +53,7 @@ namespace backend {
 namespace {
 
 using zetasql::values::Int64;
+using zetasql::values::String;
 using zetasql_base::testing::StatusIs;
 
 class DatabaseTest : public ::testing::Test {
@@ -77,6 +91,31 @@ TEST_F(DatabaseTest, CreateSuccessful) {
                        SchemaChangeOperation{.statements = create_statements}));
 }
 
+TEST_F(DatabaseTest, CreateAppliesStatementsInOrder) {
+  std::vector<std::string> create_statements = {
+      "CREATE TABLE T(k1 INT64, k2 INT64) PRIMARY KEY(k1)",
+      "CREATE INDEX I ON T(k2)",
+      "ALTER TABLE T ADD COLUMN c STRING(MAX)",
+      "DROP INDEX I",
+      "CREATE INDEX J ON T(c)",
+  };
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Database> database,
+      Database::Create(&clock_,
+                       SchemaChangeOperation{.statements = create_statements}));
+
+  const Schema* schema = database->GetLatestSchema();
+  EXPECT_NE(schema->FindTable("T")->FindColumn("c"), nullptr);
+  EXPECT_EQ(schema->FindIndex("I"), nullptr);
+  EXPECT_NE(schema->FindIndex("J"), nullptr);
+
+  create_statements.push_back("CREATE INDEX J ON T(k2)");
+  EXPECT_THAT(
+      Database::Create(&clock_,
+                       SchemaChangeOperation{.statements = create_statements}),
+      StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
 TEST_F(DatabaseTest, UpdateSchemaSuccessful) {
   ZETASQL_ASSERT_OK_AND_ASSIGN(auto db,
                        Database::Create(&clock_, SchemaChangeOperation{}));
@@ -189,6 +228,91 @@ TEST_F(DatabaseTest, ConcurrentSchemaChangeIsAborted) {
       error::ConcurrentSchemaChangeOrReadWriteTxnInProgress());
 }
 
+TEST_F(DatabaseTest, MetadataSchemaChangeDoesNotAbortTransactions) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+
+  // Initiate a Read inside a read-write transaction to acquire locks.
+  std::unique_ptr<RowCursor> row_cursor;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  ZETASQL_EXPECT_OK(txn->Read(read_column("T", "k1"), &row_cursor));
+
+  std::vector<std::string> update_statements = {
+      "CREATE VIEW V SQL SECURITY INVOKER AS SELECT T.k1 FROM T",
+      "ALTER TABLE T ADD COLUMN c STRING(MAX)"};
+  absl::Status backfill_status;
+  int completed_statements;
+  absl::Time commit_ts;
+  ZETASQL_ASSERT_OK(
+      db->UpdateSchema(SchemaChangeOperation{.statements = update_statements},
+                       &completed_statements, &commit_ts, &backfill_status));
+  ZETASQL_EXPECT_OK(backfill_status);
+  EXPECT_EQ(completed_statements, 2);
+
+  // The transaction commits after the schema change, against the schema it
+  // started on.
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+               {{Int64(1), Int64(2)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  // Schema changes which touch data still wait for exclusive access.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      txn, db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  ZETASQL_EXPECT_OK(txn->Read(read_column("T", "k1"), &row_cursor));
+  EXPECT_EQ(db->UpdateSchema(
+                SchemaChangeOperation{
+                    .statements = {"ALTER TABLE T ADD COLUMN d INT64 NOT NULL "
+                                   "DEFAULT (0)"}},
+                &completed_statements, &commit_ts, &backfill_status),
+            error::ConcurrentSchemaChangeOrReadWriteTxnInProgress());
+}
+
+TEST_F(DatabaseTest, EnablingCommitTimestampsWaitsForTransactions) {
+  std::vector<std::string> create_statements = {
+      "CREATE TABLE T(k1 INT64, ts TIMESTAMP) PRIMARY KEY(k1)"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+
+  std::unique_ptr<RowCursor> row_cursor;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  ZETASQL_EXPECT_OK(txn->Read(read_column("T", "k1"), &row_cursor));
+
+  // The existing values of the column are verified to be in the past, which
+  // the transaction could still change.
+  absl::Status backfill_status;
+  int completed_statements;
+  absl::Time commit_ts;
+  EXPECT_EQ(db->UpdateSchema(
+                SchemaChangeOperation{
+                    .statements = {"ALTER TABLE T ALTER COLUMN ts SET OPTIONS "
+                                   "(allow_commit_timestamp = true)"}},
+                &completed_statements, &commit_ts, &backfill_status),
+            error::ConcurrentSchemaChangeOrReadWriteTxnInProgress());
+
+  // Disabling them does not read any data.
+  ZETASQL_ASSERT_OK(db->UpdateSchema(
+      SchemaChangeOperation{
+          .statements = {"ALTER TABLE T ALTER COLUMN ts SET OPTIONS "
+                         "(allow_commit_timestamp = null)"}},
+      &completed_statements, &commit_ts, &backfill_status));
+  ZETASQL_EXPECT_OK(backfill_status);
+  ZETASQL_EXPECT_OK(txn->Commit());
+}
+
 TEST_F(DatabaseTest, SchemaChangeLocksSuccesfullyReleased) {
   std::vector<std::string> create_statements = {R"(
     CREATE TABLE T(
@@ -224,6 +348,999 @@ TEST_F(DatabaseTest, SchemaChangeLocksSuccesfullyReleased) {
   ZETASQL_EXPECT_OK(txn->Commit());
 }
 
+TEST_F(DatabaseTest, ReusesReleasedReadWriteTransactions) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+
+  // A transaction released with buffered writes and held locks leaves none of
+  // them behind.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+               {{Int64(1), Int64(1)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  const ReadWriteTransaction* released = txn.get();
+  const TransactionID released_id = txn->id();
+  db->ReleaseReadWriteTransaction(std::move(txn));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      txn, db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  EXPECT_EQ(txn.get(), released);
+  EXPECT_NE(txn->id(), released_id);
+  EXPECT_EQ(txn->state(), ReadWriteTransaction::State::kUninitialized);
+  std::unique_ptr<RowCursor> row_cursor;
+  ZETASQL_ASSERT_OK(txn->Read(read_column("T", "k1"), &row_cursor));
+  EXPECT_FALSE(row_cursor->Next());
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+  db->ReleaseReadWriteTransaction(std::move(txn));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      txn, db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  ZETASQL_ASSERT_OK(txn->Read(read_column("T", "k1"), &row_cursor));
+  ASSERT_TRUE(row_cursor->Next());
+  EXPECT_EQ(row_cursor->ColumnValue(0), Int64(1));
+  ZETASQL_EXPECT_OK(txn->Commit());
+}
+
+TEST_F(DatabaseTest, CollectGarbageKeepsVersionsWithinStaleReadLimit) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+
+  for (int64_t value : {1, 2}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsertOrUpdate, "T", {"k1", "k2"},
+                 {{Int64(1), Int64(value)}});
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+
+  // Both versions are still within the stale read limit.
+  EXPECT_EQ(db->CollectGarbage(), 0);
+  EXPECT_EQ(db->reclaimed_version_bytes(), 0);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> txn,
+                       db->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  std::unique_ptr<RowCursor> row_cursor;
+  ZETASQL_ASSERT_OK(txn->Read(read_column("T", "k2"), &row_cursor));
+  ASSERT_TRUE(row_cursor->Next());
+  EXPECT_EQ(row_cursor->ColumnValue(0), Int64(2));
+  EXPECT_FALSE(row_cursor->Next());
+}
+
+TEST_F(DatabaseTest, CollectGarbageKeepsDroppedTablesWithinStaleReadLimit) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                 {{Int64(1), Int64(1)}});
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+  const absl::Time before_drop = clock_.Now();
+
+  std::vector<std::string> update_statements = {"DROP TABLE T"};
+  absl::Status backfill_status;
+  int completed_statements;
+  absl::Time commit_ts;
+  ZETASQL_ASSERT_OK(
+      db->UpdateSchema(SchemaChangeOperation{.statements = update_statements},
+                       &completed_statements, &commit_ts, &backfill_status));
+  ZETASQL_ASSERT_OK(backfill_status);
+
+  // The dropped table can still be read at timestamps within the stale read
+  // limit, so its rows are kept.
+  EXPECT_EQ(db->CollectGarbage(), 0);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadOnlyTransaction> txn,
+      db->CreateReadOnlyTransaction(
+          ReadOnlyOptions{.bound = TimestampBound::kExactTimestamp,
+                          .timestamp = before_drop}));
+  std::unique_ptr<RowCursor> row_cursor;
+  ZETASQL_ASSERT_OK(txn->Read(read_column("T", "k2"), &row_cursor));
+  ASSERT_TRUE(row_cursor->Next());
+  EXPECT_EQ(row_cursor->ColumnValue(0), Int64(1));
+  EXPECT_FALSE(row_cursor->Next());
+}
+
+TEST_F(DatabaseTest, MaintainsTableStatisticsAcrossCommitsAndAnalyze) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )",
+                                                R"(
+    CREATE INDEX I on T(k2)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+  const Table* table = db->GetLatestSchema()->FindTable("T");
+  const Table* index_table =
+      db->GetLatestSchema()->FindIndex("I")->index_data_table();
+  EXPECT_EQ(db->statistics()->RowCount(table->id()), 0);
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                 {{Int64(1), Int64(10)},
+                  {Int64(2), Int64(10)},
+                  {Int64(3), Int64(20)}});
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddDeleteOp("T", KeySet(Key({Int64(3)})));
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+
+  // Commits keep the row counts up to date, but deleted values are still
+  // counted as distinct values until the next ANALYZE.
+  EXPECT_EQ(db->statistics()->RowCount(table->id()), 2);
+  EXPECT_EQ(db->statistics()->RowCount(index_table->id()), 2);
+  std::optional<double> distinct_values = db->statistics()->DistinctValues(
+      table->id(), table->FindColumn("k2")->id());
+  ASSERT_TRUE(distinct_values.has_value());
+  EXPECT_NEAR(*distinct_values, 2, 0.5);
+
+  std::vector<std::string> update_statements = {"ANALYZE"};
+  absl::Status backfill_status;
+  int completed_statements;
+  absl::Time commit_ts;
+  ZETASQL_ASSERT_OK(
+      db->UpdateSchema(SchemaChangeOperation{.statements = update_statements},
+                       &completed_statements, &commit_ts, &backfill_status));
+  ZETASQL_ASSERT_OK(backfill_status);
+  EXPECT_EQ(db->statistics()->RowCount(table->id()), 2);
+  distinct_values = db->statistics()->DistinctValues(
+      table->id(), table->FindColumn("k2")->id());
+  ASSERT_TRUE(distinct_values.has_value());
+  EXPECT_NEAR(*distinct_values, 1, 0.5);
+}
+
+TEST_F(DatabaseTest, RestoresRowsAndIndexesFromSnapshot) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1 DESC)
+  )",
+                                                R"(
+    CREATE INDEX I on T(k2)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+               {{Int64(1), Int64(20)}, {Int64(2), Int64(10)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(DatabaseSnapshot snapshot, db->CreateSnapshot());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto restored,
+                       Database::CreateFromSnapshot(&clock_, snapshot));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadOnlyTransaction> ro_txn,
+      restored->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(ro_txn->Read(read_column("T", "k1"), &cursor));
+  std::vector<zetasql::Value> keys;
+  while (cursor->Next()) {
+    keys.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(keys, testing::ElementsAre(Int64(2), Int64(1)));
+
+  ReadArg index_read = read_column("T", "k1");
+  index_read.index = "I";
+  ZETASQL_ASSERT_OK(ro_txn->Read(index_read, &cursor));
+  keys.clear();
+  while (cursor->Next()) {
+    keys.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(keys, testing::ElementsAre(Int64(2), Int64(1)));
+}
+
+TEST_F(DatabaseTest, RestoresSnapshotRowsLazily) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k INT64,
+      v INT64,
+    ) PRIMARY KEY(k)
+  )",
+                                                R"(
+    CREATE TABLE U(
+      k INT64,
+    ) PRIMARY KEY(k)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k", "v"},
+               {{Int64(1), Int64(10)}, {Int64(2), Int64(20)}});
+  m.AddWriteOp(MutationOpType::kInsert, "U", {"k"}, {{Int64(3)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(DatabaseSnapshot snapshot, db->CreateSnapshot());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto restored,
+      Database::CreateFromSnapshot(
+          &clock_, snapshot,
+          StorageOptions{.hydrate_snapshots_lazily = true,
+                         .snapshot_hydration_threads = 1}));
+
+  // Changes to a table are made on top of its restored rows.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      txn, restored->CreateReadWriteTransaction(ReadWriteOptions(),
+                                                RetryState()));
+  Mutation update;
+  update.AddWriteOp(MutationOpType::kUpdate, "T", {"k", "v"},
+                    {{Int64(2), Int64(21)}});
+  ZETASQL_ASSERT_OK(txn->Write(update));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadOnlyTransaction> ro_txn,
+      restored->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(ro_txn->Read(read_column("T", "v"), &cursor));
+  std::vector<zetasql::Value> values;
+  while (cursor->Next()) {
+    values.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(values, testing::ElementsAre(Int64(10), Int64(21)));
+
+  ZETASQL_ASSERT_OK(ro_txn->Read(read_column("U", "k"), &cursor));
+  values.clear();
+  while (cursor->Next()) {
+    values.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(values, testing::ElementsAre(Int64(3)));
+}
+
+TEST_F(DatabaseTest, StoresRowsOnDisk) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k INT64,
+      v STRING(MAX),
+    ) PRIMARY KEY(k)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db,
+      Database::Create(
+          &clock_, SchemaChangeOperation{.statements = create_statements},
+          StorageOptions{.disk_storage_dir = testing::TempDir()}));
+
+  // Large enough to be spilled to the scratch file.
+  const std::string large_value(1000, 'v');
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k", "v"},
+               {{Int64(1), String(large_value)}, {Int64(2), String("small")}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> ro_txn,
+                       db->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(ro_txn->Read(read_column("T", "v"), &cursor));
+  std::vector<zetasql::Value> values;
+  while (cursor->Next()) {
+    values.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(values,
+              testing::ElementsAre(String(large_value), String("small")));
+}
+
+TEST_F(DatabaseTest, ServesRowsAndIndexesFromFixture) {
+  const std::string path =
+      absl::StrCat(testing::TempDir(), "/serves_rows_from_fixture.fixture");
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1 DESC)
+  )",
+                                                R"(
+    CREATE INDEX I on T(k2)
+  )"};
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto db,
+        Database::Create(
+            &clock_, SchemaChangeOperation{.statements = create_statements}));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                 {{Int64(1), Int64(20)}, {Int64(2), Int64(10)}});
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+    ZETASQL_ASSERT_OK(db->WriteFixture(path));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db,
+      Database::Create(
+          &clock_, SchemaChangeOperation{.statements = create_statements},
+          StorageOptions{.fixture_path = path}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kUpdate, "T", {"k1", "k2"},
+               {{Int64(1), Int64(5)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> ro_txn,
+                       db->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(ro_txn->Read(read_column("T", "k2"), &cursor));
+  std::vector<zetasql::Value> values;
+  while (cursor->Next()) {
+    values.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(values, testing::ElementsAre(Int64(10), Int64(5)));
+
+  ReadArg index_read = read_column("T", "k1");
+  index_read.index = "I";
+  ZETASQL_ASSERT_OK(ro_txn->Read(index_read, &cursor));
+  values.clear();
+  while (cursor->Next()) {
+    values.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(values, testing::ElementsAre(Int64(1), Int64(2)));
+}
+
+TEST_F(DatabaseTest, ReplaysWriteAheadLog) {
+  const std::string path =
+      absl::StrCat(testing::TempDir(), "/replays_write_ahead_log.wal");
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k INT64,
+      v INT64,
+    ) PRIMARY KEY(k)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                       WriteAheadLog::Open(path, /*size=*/0, /*sync=*/true));
+  ZETASQL_ASSERT_OK(db->StartWriteAheadLog(std::move(log)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k", "v"},
+               {{Int64(1), Int64(20)}, {Int64(2), Int64(10)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+  std::vector<std::string> update_statements = {"CREATE INDEX I ON T(v)"};
+  int num_succesful;
+  absl::Time timestamp;
+  absl::Status backfill_status;
+  ZETASQL_ASSERT_OK(db->UpdateSchema(
+      SchemaChangeOperation{.statements = update_statements}, &num_succesful,
+      &timestamp, &backfill_status));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      txn, db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation delete_mutation;
+  delete_mutation.AddDeleteOp("T", KeySet(Key({Int64(1)})));
+  ZETASQL_ASSERT_OK(txn->Write(delete_mutation));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  std::unique_ptr<Database> replayed;
+  ZETASQL_ASSERT_OK(WriteAheadLog::Replay(
+                path,
+                [&](const WriteAheadLogRecord& record) -> absl::Status {
+                  if (replayed == nullptr) {
+                    ZETASQL_ASSIGN_OR_RETURN(replayed, Database::CreateFromSnapshot(
+                                                   &clock_, record.snapshot()));
+                    return absl::OkStatus();
+                  }
+                  return replayed->ReplayWriteAheadLogRecord(record);
+                })
+                .status());
+  ASSERT_NE(replayed, nullptr);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadOnlyTransaction> ro_txn,
+      replayed->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  ReadArg index_read = read_column("T", "k");
+  index_read.index = "I";
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(ro_txn->Read(index_read, &cursor));
+  std::vector<zetasql::Value> keys;
+  while (cursor->Next()) {
+    keys.push_back(cursor->ColumnValue(0));
+  }
+  EXPECT_THAT(keys, testing::ElementsAre(Int64(2)));
+}
+
+// Returns a TableSnapshot holding the given rows of table, for BulkLoad.
+TableSnapshot MakeTableSnapshot(
+    absl::string_view table, std::vector<std::string> columns,
+    const std::vector<std::vector<zetasql::Value>>& rows) {
+  TableSnapshot table_snapshot;
+  table_snapshot.set_name(std::string(table));
+  for (std::string& column : columns) {
+    table_snapshot.add_columns(std::move(column));
+  }
+  for (const std::vector<zetasql::Value>& row : rows) {
+    TableSnapshot::Row* row_snapshot = table_snapshot.add_rows();
+    for (const zetasql::Value& value : row) {
+      ZETASQL_EXPECT_OK(value.Serialize(row_snapshot->add_values()));
+    }
+  }
+  return table_snapshot;
+}
+
+class DatabaseBulkLoadTest : public DatabaseTest {
+ protected:
+  void SetUp() override {
+    std::vector<std::string> create_statements = {R"(
+      CREATE TABLE P(
+        k INT64,
+        v STRING(5) NOT NULL,
+      ) PRIMARY KEY(k)
+    )",
+                                                  R"(
+      CREATE TABLE C(
+        k INT64,
+        c INT64,
+      ) PRIMARY KEY(k, c),
+        INTERLEAVE IN PARENT P
+    )",
+                                                  R"(
+      CREATE UNIQUE INDEX PByValue on P(v)
+    )"};
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        db_, Database::Create(&clock_, SchemaChangeOperation{
+                                           .statements = create_statements}));
+  }
+
+  std::vector<zetasql::Value> ReadColumn(const std::string& table,
+                                         const std::string& column,
+                                         const std::string& index = "") {
+    std::vector<zetasql::Value> values;
+    auto txn = db_->CreateReadOnlyTransaction(ReadOnlyOptions());
+    ZETASQL_EXPECT_OK(txn.status());
+    ReadArg read_arg = read_column(table, column);
+    read_arg.index = index;
+    std::unique_ptr<RowCursor> cursor;
+    ZETASQL_EXPECT_OK((*txn)->Read(read_arg, &cursor));
+    while (cursor->Next()) {
+      values.push_back(cursor->ColumnValue(0));
+    }
+    return values;
+  }
+
+  std::unique_ptr<Database> db_;
+};
+
+TEST_F(DatabaseBulkLoadTest, LoadsRowsAndBuildsIndexes) {
+  std::vector<TableSnapshot> tables = {
+      MakeTableSnapshot("C", {"k", "c"},
+                        {{Int64(2), Int64(1)}, {Int64(1), Int64(1)}}),
+      MakeTableSnapshot("P", {"v", "k"},
+                        {{String("b"), Int64(2)}, {String("a"), Int64(3)},
+                         {String("c"), Int64(1)}}),
+  };
+  ZETASQL_ASSERT_OK(db_->BulkLoad(tables));
+
+  EXPECT_THAT(ReadColumn("P", "k"),
+              testing::ElementsAre(Int64(1), Int64(2), Int64(3)));
+  EXPECT_THAT(ReadColumn("P", "k", "PByValue"),
+              testing::ElementsAre(Int64(3), Int64(2), Int64(1)));
+  EXPECT_THAT(ReadColumn("C", "k"), testing::ElementsAre(Int64(1), Int64(2)));
+}
+
+TEST_F(DatabaseBulkLoadTest, FailedLoadLeavesNoRows) {
+  // The child row has no parent.
+  std::vector<TableSnapshot> tables = {
+      MakeTableSnapshot("P", {"k", "v"}, {{Int64(1), String("a")}}),
+      MakeTableSnapshot("C", {"k", "c"}, {{Int64(2), Int64(1)}}),
+  };
+  EXPECT_THAT(db_->BulkLoad(tables), StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(ReadColumn("P", "k"), testing::IsEmpty());
+  EXPECT_THAT(ReadColumn("P", "k", "PByValue"), testing::IsEmpty());
+  EXPECT_THAT(ReadColumn("C", "k"), testing::IsEmpty());
+
+  // Rows can be loaded again once the data is fixed.
+  tables[1] = MakeTableSnapshot("C", {"k", "c"}, {{Int64(1), Int64(1)}});
+  ZETASQL_EXPECT_OK(db_->BulkLoad(tables));
+  EXPECT_THAT(ReadColumn("C", "k"), testing::ElementsAre(Int64(1)));
+}
+
+TEST_F(DatabaseBulkLoadTest, VerifiesConstraints) {
+  EXPECT_THAT(db_->BulkLoad({MakeTableSnapshot(
+                  "P", {"k", "v"},
+                  {{Int64(1), String("a")}, {Int64(1), String("b")}})}),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+  EXPECT_THAT(db_->BulkLoad({MakeTableSnapshot(
+                  "P", {"k", "v"},
+                  {{Int64(1), String("a")}, {Int64(2), String("a")}})}),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(db_->BulkLoad({MakeTableSnapshot("P", {"k"}, {{Int64(1)}})}),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(db_->BulkLoad({MakeTableSnapshot(
+                  "P", {"k", "v"},
+                  {{Int64(1), String("long")}, {Int64(2), String("longer")}})}),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(
+      db_->BulkLoad({MakeTableSnapshot("P", {"v"}, {{String("a")}})}),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ReadColumn("P", "k"), testing::IsEmpty());
+}
+
+TEST_F(DatabaseBulkLoadTest, RequiresEmptyTables) {
+  ZETASQL_ASSERT_OK(db_->BulkLoad(
+      {MakeTableSnapshot("P", {"k", "v"}, {{Int64(1), String("a")}})}));
+  EXPECT_THAT(db_->BulkLoad({MakeTableSnapshot("P", {"k", "v"},
+                                               {{Int64(2), String("b")}})}),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(ReadColumn("P", "k"), testing::ElementsAre(Int64(1)));
+}
+
+TEST_F(DatabaseTest, CloneIsIsolatedFromSource) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+  auto insert = [](Database* db, int64_t key) -> absl::Status {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                 {{Int64(key), Int64(key)}});
+    ZETASQL_RETURN_IF_ERROR(txn->Write(m));
+    return txn->Commit();
+  };
+  auto read_keys = [](Database* db) {
+    std::vector<zetasql::Value> keys;
+    auto txn = db->CreateReadOnlyTransaction(ReadOnlyOptions());
+    ZETASQL_EXPECT_OK(txn.status());
+    std::unique_ptr<RowCursor> cursor;
+    ZETASQL_EXPECT_OK((*txn)->Read(read_column("T", "k1"), &cursor));
+    while (cursor->Next()) {
+      keys.push_back(cursor->ColumnValue(0));
+    }
+    return keys;
+  };
+  ZETASQL_ASSERT_OK(insert(db.get(), 1));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Database> clone, db->Clone());
+  EXPECT_EQ(clone->GetLatestSchema(), db->GetLatestSchema());
+  ZETASQL_ASSERT_OK(insert(db.get(), 2));
+  ZETASQL_ASSERT_OK(insert(clone.get(), 3));
+  EXPECT_THAT(read_keys(db.get()), testing::ElementsAre(Int64(1), Int64(2)));
+  EXPECT_THAT(read_keys(clone.get()),
+              testing::ElementsAre(Int64(1), Int64(3)));
+
+  // Schema changes to the clone do not affect the source, and do not reuse
+  // the storage IDs of the source.
+  int num_succesful_statements;
+  absl::Time commit_timestamp;
+  absl::Status backfill_status;
+  ZETASQL_ASSERT_OK(clone->UpdateSchema(
+      SchemaChangeOperation{.statements = {"ALTER TABLE T ADD COLUMN c INT64"}},
+      &num_succesful_statements, &commit_timestamp, &backfill_status));
+  ZETASQL_ASSERT_OK(backfill_status);
+  EXPECT_EQ(db->GetLatestSchema()->FindTable("T")->FindColumn("c"), nullptr);
+  const Table* table = clone->GetLatestSchema()->FindTable("T");
+  ASSERT_NE(table->FindColumn("c"), nullptr);
+  for (const Column* column : table->columns()) {
+    if (column->Name() != "c") {
+      EXPECT_NE(column->id(), table->FindColumn("c")->id());
+    }
+  }
+}
+
+TEST_F(DatabaseTest, ResetDataKeepsSchema) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )",
+                                                R"(
+    CREATE UNIQUE INDEX I on T(k2)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+  auto insert = [&db](int64_t key) -> absl::Status {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                 {{Int64(key), Int64(key)}});
+    ZETASQL_RETURN_IF_ERROR(txn->Write(m));
+    return txn->Commit();
+  };
+  auto read_keys = [&db](const std::string& index) {
+    std::vector<zetasql::Value> keys;
+    auto txn = db->CreateReadOnlyTransaction(ReadOnlyOptions());
+    ZETASQL_EXPECT_OK(txn.status());
+    ReadArg read = read_column("T", "k1");
+    read.index = index;
+    std::unique_ptr<RowCursor> cursor;
+    ZETASQL_EXPECT_OK((*txn)->Read(read, &cursor));
+    while (cursor->Next()) {
+      keys.push_back(cursor->ColumnValue(0));
+    }
+    return keys;
+  };
+  ZETASQL_ASSERT_OK(insert(1));
+  ZETASQL_ASSERT_OK(insert(2));
+  const Schema* schema = db->GetLatestSchema();
+
+  ZETASQL_ASSERT_OK(db->ResetData());
+  EXPECT_EQ(db->GetLatestSchema(), schema);
+  EXPECT_THAT(read_keys(""), testing::IsEmpty());
+  EXPECT_THAT(read_keys("I"), testing::IsEmpty());
+
+  // The rows can be inserted again, without violating the unique index.
+  ZETASQL_ASSERT_OK(insert(1));
+  EXPECT_THAT(read_keys(""), testing::ElementsAre(Int64(1)));
+  EXPECT_THAT(read_keys("I"), testing::ElementsAre(Int64(1)));
+}
+
+TEST_F(DatabaseTest, CreateFromTemplateSharesSchema) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<const Database::SchemaTemplate> schema_template,
+      Database::CreateSchemaTemplate(
+          SchemaChangeOperation{.statements = create_statements}));
+  ASSERT_NE(schema_template, nullptr);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Database> db1,
+                       Database::CreateFromTemplate(&clock_, schema_template));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Database> db2,
+                       Database::CreateFromTemplate(&clock_, schema_template));
+  EXPECT_EQ(db1->GetLatestSchema(), schema_template->schema.get());
+  EXPECT_EQ(db2->GetLatestSchema(), schema_template->schema.get());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db1->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+               {{Int64(1), Int64(1)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  // Schema changes do not reuse the storage IDs of the template.
+  int num_succesful_statements;
+  absl::Time commit_timestamp;
+  absl::Status backfill_status;
+  ZETASQL_ASSERT_OK(db2->UpdateSchema(
+      SchemaChangeOperation{.statements = {"ALTER TABLE T ADD COLUMN c INT64"}},
+      &num_succesful_statements, &commit_timestamp, &backfill_status));
+  ZETASQL_ASSERT_OK(backfill_status);
+  EXPECT_EQ(db1->GetLatestSchema()->FindTable("T")->FindColumn("c"), nullptr);
+  const Table* table = db2->GetLatestSchema()->FindTable("T");
+  ASSERT_NE(table->FindColumn("c"), nullptr);
+  for (const Column* column : table->columns()) {
+    if (column->Name() != "c") {
+      EXPECT_NE(column->id(), table->FindColumn("c")->id());
+    }
+  }
+}
+
+TEST_F(DatabaseTest, SchemaTemplateIsNullWithChangeStreams) {
+  std::vector<std::string> create_statements = {
+      "CREATE TABLE T(k1 INT64) PRIMARY KEY(k1)",
+      "CREATE CHANGE STREAM C FOR T"};
+  EXPECT_THAT(Database::CreateSchemaTemplate(
+                  SchemaChangeOperation{.statements = create_statements}),
+              zetasql_base::testing::IsOkAndHolds(nullptr));
+}
+
+TEST_F(DatabaseTest, ExecutesPartitionedDmlOverAllRows) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )",
+                                                R"(
+    CREATE INDEX I on T(k2))"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db, Database::Create(&clock_, SchemaChangeOperation{
+                                             .statements = create_statements}));
+
+  // Enough rows to be split into several partitions on most machines.
+  constexpr int kNumRows = 10000;
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    for (int i = 0; i < kNumRows; ++i) {
+      m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                   {{Int64(i), Int64(0)}});
+    }
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+
+  EXPECT_THAT(db->ExecutePartitionedDml(
+                  Query{.sql = "UPDATE T SET k2 = 1 WHERE k1 >= 1000"}),
+              zetasql_base::testing::IsOkAndHolds(kNumRows - 1000));
+  EXPECT_THAT(
+      db->ExecutePartitionedDml(Query{.sql = "DELETE FROM T WHERE k2 = 0"}),
+      zetasql_base::testing::IsOkAndHolds(1000));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> txn,
+                       db->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  ReadArg index_read = read_column("T", "k2");
+  index_read.index = "I";
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(txn->Read(index_read, &cursor));
+  int num_rows = 0;
+  while (cursor->Next()) {
+    EXPECT_EQ(cursor->ColumnValue(0), Int64(1));
+    ++num_rows;
+  }
+  ZETASQL_EXPECT_OK(cursor->Status());
+  EXPECT_EQ(num_rows, kNumRows - 1000);
+}
+
+TEST_F(DatabaseTest, QueriesRowsChangedSinceAfterAllowingCommitTimestamps) {
+  std::vector<std::string> create_statements = {
+      "CREATE TABLE T(k INT64, ts TIMESTAMP) PRIMARY KEY(k)"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Database> db,
+      Database::Create(&clock_, SchemaChangeOperation{
+                                    .statements = create_statements}));
+  const absl::Time since = clock_.Now();
+
+  // The row is written before the column allows commit timestamps, so its
+  // key is not recorded by the commit.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k", "ts"},
+               {{Int64(1), zetasql::values::Timestamp(clock_.Now())}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  std::vector<std::string> update_statements = {
+      "ALTER TABLE T ALTER COLUMN ts SET OPTIONS "
+      "(allow_commit_timestamp = true)"};
+  int num_succesful;
+  absl::Time timestamp;
+  absl::Status backfill_status;
+  ZETASQL_ASSERT_OK(db->UpdateSchema(
+      SchemaChangeOperation{.statements = update_statements}, &num_succesful,
+      &timestamp, &backfill_status));
+  ZETASQL_ASSERT_OK(backfill_status);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> ro_txn,
+                       db->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      db->query_engine()->ExecuteSql(
+          Query{"SELECT k FROM T WHERE ts > @since",
+                {{"since", zetasql::values::Timestamp(since)}}},
+          QueryContext{.schema = db->GetLatestSchema(),
+                       .reader = ro_txn.get(),
+                       .writer = nullptr,
+                       .snapshot_epoch = absl::Now()}));
+  std::vector<zetasql::Value> keys;
+  while (result.rows->Next()) {
+    keys.push_back(result.rows->ColumnValue(0));
+  }
+  ZETASQL_ASSERT_OK(result.rows->Status());
+  EXPECT_THAT(keys, testing::ElementsAre(Int64(1)));
+}
+
+class DatabaseOnlineIndexTest : public DatabaseTest {
+ protected:
+  void SetUp() override {
+    std::vector<std::string> create_statements = {R"(
+      CREATE TABLE T(
+        k1 INT64,
+        k2 INT64,
+      ) PRIMARY KEY(k1)
+    )"};
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        db_, Database::Create(&clock_, SchemaChangeOperation{
+                                           .statements = create_statements}));
+
+    // More rows than are backfilled under a single lock.
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ReadWriteTransaction> txn,
+        db_->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+    Mutation m;
+    for (int i = 0; i < kNumRows; ++i) {
+      m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                   {{Int64(i), Int64(i % 2)}});
+    }
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+
+  static constexpr int kNumRows = 2500;
+  std::unique_ptr<Database> db_;
+};
+
+TEST_F(DatabaseOnlineIndexTest, BackfillsIndexInTheBackground) {
+  std::vector<std::string> statements = {"CREATE INDEX I ON T(k2)"};
+  SchemaChangeOperation operation{.statements = statements};
+  ASSERT_TRUE(Database::CanCreateIndexesOnline(operation));
+
+  absl::Time commit_timestamp;
+  absl::Status backfill_status;
+  absl::Notification backfilled;
+  ZETASQL_ASSERT_OK(db_->CreateIndexesOnline(operation, &commit_timestamp,
+                                     [&](absl::Status status) {
+                                       backfill_status = status;
+                                       backfilled.Notify();
+                                     }));
+  backfilled.WaitForNotification();
+  ZETASQL_ASSERT_OK(backfill_status);
+  EXPECT_FALSE(db_->GetLatestSchema()->FindIndex("I")->is_write_only());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> txn,
+                       db_->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  ReadArg index_read = read_column("T", "k2");
+  index_read.index = "I";
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(txn->Read(index_read, &cursor));
+  int num_rows = 0;
+  while (cursor->Next()) {
+    EXPECT_EQ(cursor->ColumnValue(0), Int64(num_rows < kNumRows / 2 ? 0 : 1));
+    ++num_rows;
+  }
+  ZETASQL_EXPECT_OK(cursor->Status());
+  EXPECT_EQ(num_rows, kNumRows);
+
+  // The schema as of the commit timestamp has the index, not yet readable.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      txn, db_->CreateReadOnlyTransaction(ReadOnlyOptions{
+               .bound = TimestampBound::kExactTimestamp,
+               .timestamp = commit_timestamp}));
+  EXPECT_THAT(txn->Read(index_read, &cursor),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST_F(DatabaseOnlineIndexTest, DropsIndexWhenBackfillFails) {
+  std::vector<std::string> statements = {"CREATE UNIQUE INDEX U ON T(k2)"};
+  absl::Time commit_timestamp;
+  absl::Status backfill_status;
+  absl::Notification backfilled;
+  ZETASQL_ASSERT_OK(db_->CreateIndexesOnline(
+      SchemaChangeOperation{.statements = statements}, &commit_timestamp,
+      [&](absl::Status status) {
+        backfill_status = status;
+        backfilled.Notify();
+      }));
+  backfilled.WaitForNotification();
+  EXPECT_THAT(backfill_status,
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_EQ(db_->GetLatestSchema()->FindIndex("U"), nullptr);
+}
+
+TEST_F(DatabaseOnlineIndexTest, ReplaysOnlyIndexesWhichWereBackfilled) {
+  const std::string path = absl::StrCat(
+      testing::TempDir(), "/replays_only_indexes_which_were_backfilled.wal");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                       WriteAheadLog::Open(path, /*size=*/0, /*sync=*/true));
+  ZETASQL_ASSERT_OK(db_->StartWriteAheadLog(std::move(log)));
+
+  auto create_index_online = [&](const std::string& statement) {
+    std::vector<std::string> statements = {statement};
+    absl::Time commit_timestamp;
+    absl::Status backfill_status;
+    absl::Notification backfilled;
+    absl::Status status = db_->CreateIndexesOnline(
+        SchemaChangeOperation{.statements = statements}, &commit_timestamp,
+        [&](absl::Status status) {
+          backfill_status = status;
+          backfilled.Notify();
+        });
+    if (!status.ok()) return status;
+    backfilled.WaitForNotification();
+    return backfill_status;
+  };
+  // The unique index fails its backfill and is dropped, so replaying the log
+  // must not create it again.
+  EXPECT_THAT(create_index_online("CREATE UNIQUE INDEX U ON T(k2)"),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  ZETASQL_ASSERT_OK(create_index_online("CREATE INDEX I ON T(k2)"));
+
+  std::unique_ptr<Database> replayed;
+  ZETASQL_ASSERT_OK(WriteAheadLog::Replay(
+                path,
+                [&](const WriteAheadLogRecord& record) -> absl::Status {
+                  if (replayed == nullptr) {
+                    ZETASQL_ASSIGN_OR_RETURN(replayed, Database::CreateFromSnapshot(
+                                                   &clock_, record.snapshot()));
+                    return absl::OkStatus();
+                  }
+                  return replayed->ReplayWriteAheadLogRecord(record);
+                })
+                .status());
+  ASSERT_NE(replayed, nullptr);
+  EXPECT_EQ(replayed->GetLatestSchema()->FindIndex("U"), nullptr);
+  ASSERT_NE(replayed->GetLatestSchema()->FindIndex("I"), nullptr);
+  EXPECT_FALSE(replayed->GetLatestSchema()->FindIndex("I")->is_write_only());
+}
+
+TEST_F(DatabaseOnlineIndexTest, OnlyCreateIndexStatementsAreOnline) {
+  std::vector<std::string> statements = {"CREATE INDEX I ON T(k2)",
+                                         "ALTER TABLE T ADD COLUMN c INT64"};
+  EXPECT_FALSE(Database::CanCreateIndexesOnline(
+      SchemaChangeOperation{.statements = statements}));
+  EXPECT_FALSE(Database::CanCreateIndexesOnline(SchemaChangeOperation{}));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -0,0 +1,222 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/write_ahead_log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/database/write_ahead_log.pb.h"
+#include "common/errors.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+constexpr int kLengthSize = 4;
+
+// Returns record prefixed with its serialized size.
+std::string FrameRecord(const WriteAheadLogRecord& record) {
+  const std::string payload = record.SerializeAsString();
+  const uint32_t length = payload.size();
+  std::string framed(kLengthSize, '\0');
+  for (int i = 0; i < kLengthSize; ++i) {
+    framed[i] = static_cast<char>((length >> (8 * i)) & 0xff);
+  }
+  framed.append(payload);
+  return framed;
+}
+
+absl::Status IoError(absl::string_view operation, absl::string_view path) {
+  return error::Internal(absl::StrCat("Failed to ", operation,
+                                      " write ahead log ", path, ": ",
+                                      std::strerror(errno)));
+}
+
+absl::Status WriteFully(int fd, absl::string_view data,
+                        absl::string_view path) {
+  while (!data.empty()) {
+    const ssize_t written = ::write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return IoError("write", path);
+    }
+    data.remove_prefix(written);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<WriteAheadLog>> WriteAheadLog::Open(
+    const std::string& path, int64_t size, bool sync) {
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    return IoError("open", path);
+  }
+  if (::ftruncate(fd, size) != 0) {
+    absl::Status status = IoError("truncate", path);
+    ::close(fd);
+    return status;
+  }
+  return absl::WrapUnique(new WriteAheadLog(path, fd, size, sync));
+}
+
+absl::StatusOr<int64_t> WriteAheadLog::Replay(
+    const std::string& path,
+    const std::function<absl::Status(const WriteAheadLogRecord&)>& fn,
+    int64_t start) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in || !in.seekg(start)) {
+    return IoError("read", path);
+  }
+  int64_t size = start;
+  std::string payload;
+  WriteAheadLogRecord record;
+  while (true) {
+    unsigned char length_bytes[kLengthSize];
+    if (!in.read(reinterpret_cast<char*>(length_bytes), kLengthSize)) {
+      break;
+    }
+    uint32_t length = 0;
+    for (int i = 0; i < kLengthSize; ++i) {
+      length |= static_cast<uint32_t>(length_bytes[i]) << (8 * i);
+    }
+    payload.resize(length);
+    if (!in.read(payload.data(), length) || !record.ParseFromString(payload)) {
+      break;
+    }
+    ZETASQL_RETURN_IF_ERROR(fn(record));
+    size += kLengthSize + length;
+  }
+  return size;
+}
+
+WriteAheadLog::WriteAheadLog(std::string path, int fd, int64_t size, bool sync)
+    : path_(std::move(path)),
+      sync_(sync),
+      fd_(fd),
+      size_(size),
+      synced_size_(size) {}
+
+WriteAheadLog::~WriteAheadLog() {
+  absl::MutexLock lock(&mu_);
+  ::close(fd_);
+}
+
+absl::Status WriteAheadLog::Append(const WriteAheadLogRecord& record) {
+  const std::string data = FrameRecord(record);
+  absl::MutexLock lock(&mu_);
+  ZETASQL_RETURN_IF_ERROR(status_);
+  status_ = WriteFully(fd_, data, path_);
+  ZETASQL_RETURN_IF_ERROR(status_);
+  size_ += data.size();
+  if (!sync_) {
+    return absl::OkStatus();
+  }
+  return SyncTo(size_);
+}
+
+absl::Status WriteAheadLog::SyncTo(int64_t end) {
+  while (synced_size_ < end) {
+    ZETASQL_RETURN_IF_ERROR(status_);
+    if (syncing_) {
+      // The sync in progress may not cover end, in which case this caller
+      // syncs next, together with everyone else who appended meanwhile.
+      mu_.Await(absl::Condition(
+          +[](bool* syncing) { return !*syncing; }, &syncing_));
+      continue;
+    }
+    syncing_ = true;
+    const int64_t target = size_;
+    const int fd = fd_;
+    mu_.Unlock();
+    const bool synced = ::fdatasync(fd) == 0;
+    mu_.Lock();
+    syncing_ = false;
+    if (!synced) {
+      status_ = IoError("sync", path_);
+    } else {
+      synced_size_ = target;
+    }
+  }
+  return status_;
+}
+
+absl::Status WriteAheadLog::Reset(const WriteAheadLogRecord& record) {
+  // The new contents are written next to the log and renamed over it, so that a
+  // crash leaves either the old or the new log behind.
+  const std::string data = FrameRecord(record);
+  const std::string temp_path = absl::StrCat(path_, ".tmp");
+  const int fd =
+      ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0) {
+    return IoError("create", temp_path);
+  }
+  absl::Status status = WriteFully(fd, data, temp_path);
+  if (status.ok() && ::fdatasync(fd) != 0) {
+    status = IoError("sync", temp_path);
+  }
+  if (status.ok() && std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    status = IoError("rename", temp_path);
+  }
+  if (!status.ok()) {
+    ::close(fd);
+    return status;
+  }
+
+  absl::MutexLock lock(&mu_);
+  mu_.Await(
+      absl::Condition(+[](bool* syncing) { return !*syncing; }, &syncing_));
+  ::close(fd_);
+  fd_ = fd;
+  size_ = data.size();
+  synced_size_ = size_;
+  status_ = absl::OkStatus();
+  return absl::OkStatus();
+}
+
+bool WriteAheadLog::empty() const {
+  absl::MutexLock lock(&mu_);
+  return size_ == 0;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
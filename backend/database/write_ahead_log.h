@@ -0,0 +1,119 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_WRITE_AHEAD_LOG_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_WRITE_AHEAD_LOG_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/database/write_ahead_log.pb.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// WriteAheadLog is an append-only file of WriteAheadLogRecords for a single
+// database. Each record is stored as its serialized size, a 32-bit little
+// endian integer, followed by the serialized proto.
+//
+// Appends may be called concurrently. When the log syncs, an append returns
+// only once its record is flushed to disk, and appends which arrive while
+// another append is syncing are flushed together by the next fdatasync, so
+// concurrent commits share the cost of a sync.
+class WriteAheadLog {
+ public:
+  // Opens the log file at path for appending, creating it if it does not exist.
+  // The file is first truncated to size bytes, which drops an incomplete record
+  // left behind by a crash, see Replay. If sync is false, appends return once
+  // the record is written to the file, without waiting for it to reach disk.
+  static absl::StatusOr<std::unique_ptr<WriteAheadLog>> Open(
+      const std::string& path, int64_t size, bool sync);
+
+  // Calls fn with each complete record of the log file at path, in the order
+  // they were appended, stopping at the first error returned by fn. A record
+  // cut short at the end of the file is ignored. Returns the size of the
+  // complete records, for passing to Open.
+  //
+  // Replay starts at the record at byte offset start, which lets a reader
+  // tailing a log that is still being appended to pick up where a previous
+  // Replay stopped, by passing the size it returned.
+  static absl::StatusOr<int64_t> Replay(
+      const std::string& path,
+      const std::function<absl::Status(const WriteAheadLogRecord&)>& fn,
+      int64_t start = 0);
+
+  ~WriteAheadLog();
+
+  // Appends record to the log, returning once it is durable.
+  absl::Status Append(const WriteAheadLogRecord& record)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Atomically replaces all the records in the log with record, which is
+  // usually a snapshot of the database, to bound the size of the log.
+  absl::Status Reset(const WriteAheadLogRecord& record)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns true if no records have been appended to the log.
+  bool empty() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  WriteAheadLog(std::string path, int fd, int64_t size, bool sync);
+  WriteAheadLog(const WriteAheadLog&) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+  // Flushes the file until all bytes up to end are durable, letting a single
+  // caller sync at a time on behalf of all the others.
+  absl::Status SyncTo(int64_t end) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Path of the log file.
+  const std::string path_;
+
+  // Whether appends wait for their record to be synced.
+  const bool sync_;
+
+  mutable absl::Mutex mu_;
+
+  // File descriptor of the open log file.
+  int fd_ ABSL_GUARDED_BY(mu_);
+
+  // Bytes written to the file so far.
+  int64_t size_ ABSL_GUARDED_BY(mu_);
+
+  // Bytes known to be flushed to disk.
+  int64_t synced_size_ ABSL_GUARDED_BY(mu_);
+
+  // True while an append is syncing the file without holding mu_.
+  bool syncing_ ABSL_GUARDED_BY(mu_) = false;
+
+  // The first write or sync error, after which all appends fail since the
+  // contents of the file are unknown.
+  absl::Status status_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATABASE_WRITE_AHEAD_LOG_H_
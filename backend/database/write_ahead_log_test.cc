@@ -0,0 +1,165 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/database/write_ahead_log.h"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "backend/database/write_ahead_log.pb.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using ::testing::ElementsAre;
+
+WriteAheadLogRecord SchemaChange(const std::string& statement) {
+  WriteAheadLogRecord record;
+  record.mutable_schema_change()->add_statements(statement);
+  return record;
+}
+
+class WriteAheadLogTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = absl::StrCat(testing::TempDir(), "/",
+                         testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name(),
+                         ".wal");
+    ::unlink(path_.c_str());
+  }
+
+  // Returns the first statement of each record in the log.
+  std::vector<std::string> ReplayStatements(int64_t* size = nullptr,
+                                            int64_t start = 0) {
+    std::vector<std::string> statements;
+    absl::StatusOr<int64_t> replayed_size = WriteAheadLog::Replay(
+        path_,
+        [&](const WriteAheadLogRecord& record) {
+          statements.push_back(record.schema_change().statements(0));
+          return absl::OkStatus();
+        },
+        start);
+    EXPECT_TRUE(replayed_size.ok());
+    if (size != nullptr) {
+      *size = replayed_size.value_or(0);
+    }
+    return statements;
+  }
+
+  std::string path_;
+};
+
+TEST_F(WriteAheadLogTest, ReplaysAppendedRecordsInOrder) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                       WriteAheadLog::Open(path_, /*size=*/0, /*sync=*/true));
+  EXPECT_TRUE(log->empty());
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("first")));
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("second")));
+  EXPECT_FALSE(log->empty());
+
+  EXPECT_THAT(ReplayStatements(), ElementsAre("first", "second"));
+}
+
+TEST_F(WriteAheadLogTest, ReopenedLogDropsIncompleteRecord) {
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                         WriteAheadLog::Open(path_, /*size=*/0, /*sync=*/false));
+    ZETASQL_ASSERT_OK(log->Append(SchemaChange("complete")));
+    ZETASQL_ASSERT_OK(log->Append(SchemaChange("torn")));
+  }
+  int64_t size = 0;
+  ASSERT_THAT(ReplayStatements(&size), ElementsAre("complete", "torn"));
+  ASSERT_EQ(::truncate(path_.c_str(), size - 2), 0);
+
+  ASSERT_THAT(ReplayStatements(&size), ElementsAre("complete"));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                       WriteAheadLog::Open(path_, size, /*sync=*/true));
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("appended")));
+  EXPECT_THAT(ReplayStatements(), ElementsAre("complete", "appended"));
+}
+
+TEST_F(WriteAheadLogTest, ReplayResumesWhereItStopped) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                       WriteAheadLog::Open(path_, /*size=*/0, /*sync=*/true));
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("first")));
+  int64_t size = 0;
+  ASSERT_THAT(ReplayStatements(&size), ElementsAre("first"));
+
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("second")));
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("third")));
+  int64_t resumed_size = 0;
+  EXPECT_THAT(ReplayStatements(&resumed_size, size),
+              ElementsAre("second", "third"));
+  EXPECT_THAT(ReplayStatements(&size, resumed_size), ElementsAre());
+  EXPECT_EQ(size, resumed_size);
+}
+
+TEST_F(WriteAheadLogTest, ResetReplacesRecords) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                       WriteAheadLog::Open(path_, /*size=*/0, /*sync=*/true));
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("old")));
+  ZETASQL_ASSERT_OK(log->Reset(SchemaChange("compacted")));
+  ZETASQL_ASSERT_OK(log->Append(SchemaChange("new")));
+
+  EXPECT_THAT(ReplayStatements(), ElementsAre("compacted", "new"));
+}
+
+TEST_F(WriteAheadLogTest, ConcurrentAppendsAreAllDurable) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WriteAheadLog> log,
+                       WriteAheadLog::Open(path_, /*size=*/0, /*sync=*/true));
+  constexpr int kNumThreads = 8;
+  constexpr int kAppendsPerThread = 20;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&log, i]() {
+      for (int j = 0; j < kAppendsPerThread; ++j) {
+        ZETASQL_EXPECT_OK(log->Append(SchemaChange(absl::StrCat(i, "-", j))));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(ReplayStatements().size(), kNumThreads * kAppendsPerThread);
+}
+
+TEST_F(WriteAheadLogTest, ReplayFailsForMissingFile) {
+  EXPECT_FALSE(WriteAheadLog::Replay(path_, [](const WriteAheadLogRecord&) {
+                 return absl::OkStatus();
+               }).ok());
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
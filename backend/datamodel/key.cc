@@ -16,6 +16,8 @@
 
 #include "backend/datamodel/key.h"
 
+#include <cstdint>
+#include <iterator>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -23,6 +25,7 @@
 #include <vector>
 
 #include "zetasql/public/numeric_value.h"
+#include "zetasql/base/logging.h"
 
 namespace google {
 namespace spanner {
@@ -62,20 +65,52 @@ int64_t LogicalBytesInternal(const zetasql::Value& value) {
   }
 }
 
+// Returns the sign of a three-way comparison of a and b.
+template <typename T>
+int ThreeWayCompare(const T& a, const T& b) {
+  return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+// Performs a three-way comparison of two values of a key column. Non-NULL
+// INT64, STRING and BYTES values, the columns of most keys, are compared
+// directly rather than by Value::LessThan followed by Value::Equals, each of
+// which dispatches on the type of the values again.
+int CompareColumnValues(const zetasql::Value& a, const zetasql::Value& b) {
+  if (a.is_valid() && b.is_valid() && !a.is_null() && !b.is_null() &&
+      a.type_kind() == b.type_kind()) {
+    switch (a.type_kind()) {
+      case zetasql::TYPE_INT64:
+        return ThreeWayCompare(a.int64_value(), b.int64_value());
+      case zetasql::TYPE_STRING:
+        return ThreeWayCompare(a.string_value(), b.string_value());
+      case zetasql::TYPE_BYTES:
+        return ThreeWayCompare(a.bytes_value(), b.bytes_value());
+      default:
+        break;
+    }
+  }
+  if (a.LessThan(b)) {
+    return -1;
+  }
+  return a.Equals(b) ? 0 : 1;
+}
+
 }  // namespace
 
 Key::Key() = default;
 
 Key::Key(std::vector<zetasql::Value> columns)
-    : columns_(std::move(columns)),
-      is_descending_(columns_.size())
-{}
+    : columns_(std::make_move_iterator(columns.begin()),
+               std::make_move_iterator(columns.end())) {
+  ZETASQL_DCHECK_LE(NumColumns(), kMaxColumns);
+}
 
 void Key::AddColumn(zetasql::Value value,
                     bool desc
 ) {
+  ZETASQL_DCHECK_LT(NumColumns(), kMaxColumns);
   columns_.emplace_back(std::move(value));
-  is_descending_.push_back(desc);
+  SetColumnDescending(NumColumns() - 1, desc);
 }
 
 int Key::NumColumns() const { return columns_.size(); }
@@ -84,11 +119,19 @@ void Key::SetColumnValue(int i, zetasql::Value value) {
   columns_[i] = std::move(value);
 }
 
-void Key::SetColumnDescending(int i, bool value) { is_descending_[i] = value; }
+void Key::SetColumnDescending(int i, bool value) {
+  if (value) {
+    descending_mask_ |= uint64_t{1} << i;
+  } else {
+    descending_mask_ &= ~(uint64_t{1} << i);
+  }
+}
 
 const zetasql::Value& Key::ColumnValue(int i) const { return columns_[i]; }
 
-bool Key::IsColumnDescending(int i) const { return is_descending_[i]; }
+bool Key::IsColumnDescending(int i) const {
+  return (descending_mask_ >> i) & 1;
+}
 
 int Key::Compare(const Key& other) const {
   // Handle infinity keys first.
@@ -105,15 +148,11 @@ int Key::Compare(const Key& other) const {
       // If we reached here, other is a prefix of *this.
       return other.is_prefix_limit_ ? -1 : 1;
     }
-    if (columns_[i].LessThan(other.columns_[i])) {
-      return is_descending_[i] ? 1 : -1;
+    const int column_order =
+        CompareColumnValues(columns_[i], other.columns_[i]);
+    if (column_order != 0) {
+      return IsColumnDescending(i) ? -column_order : column_order;
     }
-
-    if (columns_[i].Equals(other.columns_[i])) {
-      continue;
-    }
-
-    return is_descending_[i] ? -1 : 1;
   }
 
   // If we reached here, *this is a prefix of other.
@@ -148,7 +187,9 @@ Key Key::ToPrefixLimit() const {
 Key Key::Prefix(int n) const {
   Key k = (*this);
   k.columns_.resize(n);
-  k.is_descending_.resize(n);
+  if (n < kMaxColumns) {
+    k.descending_mask_ &= (uint64_t{1} << n) - 1;
+  }
   return k;
 }
 
@@ -201,7 +242,7 @@ std::ostream& operator<<(std::ostream& out, const Key& k) {
       out << ", ";
     }
     out << k.ColumnValue(i);
-    if (k.is_descending_[i]) {
+    if (k.IsColumnDescending(i)) {
       out << "↓";
     }
   }
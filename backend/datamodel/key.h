@@ -17,11 +17,14 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATAMODEL_KEY_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATAMODEL_KEY_H_
 
+#include <cstdint>
 #include <ostream>
 #include <string>
 #include <vector>
 
 #include "zetasql/public/value.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/types/span.h"
 
 namespace google {
 namespace spanner {
@@ -42,8 +45,16 @@ namespace backend {
 // prefix limit key K+ (obtained by Key::ToPrefixLimit()) is a point in the key
 // space larger than any key with prefix K. This is useful in implementing
 // prefix ranges as the range [K, K+) will cover all keys with prefix K.
+//
+// Keys are created and copied on every read and write, so the values of up to
+// kInlineColumns columns are stored inline rather than on the heap, and the
+// column orders are packed into a bitmask. A key has at most kMaxColumns
+// columns, which is more than an index key and the table key it references.
 class Key {
  public:
+  static constexpr int kInlineColumns = 4;
+  static constexpr int kMaxColumns = 64;
+
   // Constructs an empty key.
   Key();
 
@@ -67,9 +78,7 @@ class Key {
   bool IsColumnDescending(int i) const;
 
   // Returns all column values in the key.
-  const std::vector<zetasql::Value>& column_values() const {
-    return columns_;
-  }
+  absl::Span<const zetasql::Value> column_values() const { return columns_; }
 
   // Performs a three-way comparison against another key.
   // k1.Compare(k2) returns
@@ -96,6 +105,12 @@ class Key {
   // Returns true if the key does not have any columns.
   bool IsEmpty() const { return columns_.empty(); }
 
+  // Returns true if this is Key::Infinity().
+  bool IsInfinity() const { return is_infinity_; }
+
+  // Returns true if this is a prefix limit key (see ToPrefixLimit()).
+  bool IsPrefixLimit() const { return is_prefix_limit_; }
+
   // Returns the logical size of the key in bytes.
   int64_t LogicalSizeInBytes() const;
 
@@ -104,7 +119,7 @@ class Key {
 
  private:
   // Individual columns that make up the key.
-  std::vector<zetasql::Value> columns_;
+  absl::InlinedVector<zetasql::Value, kInlineColumns> columns_;
 
   // Key metadata.
   bool is_infinity_ = false;
@@ -112,8 +127,8 @@ class Key {
 
   // TODO: We may refactor this by creating an immutable class which
   // has both the ordering and null handling.
-  // Column metadata.
-  std::vector<bool> is_descending_;
+  // Column metadata: bit i is set if column i is descending.
+  uint64_t descending_mask_ = 0;
 
   // Friend for member access.
   friend std::ostream& operator<<(std::ostream& out, const Key& k);
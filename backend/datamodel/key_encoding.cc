@@ -0,0 +1,330 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/datamodel/key_encoding.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "zetasql/public/numeric_value.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/base/casts.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+#include "zetasql/base/logging.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Identifies the type of a column in its header byte. The header byte of a
+// column is 2 * tag for NULL values and 2 * tag + 1 otherwise, so that NULL
+// sorts before any other value of the same type. Headers of ascending columns
+// are below 0x80 and those of descending columns, once inverted, are above
+// 0x80 and below kPrefixLimit.
+enum TypeTag : uint8_t {
+  kBool = 1,
+  kInt64 = 2,
+  kDouble = 3,
+  kString = 4,
+  kBytes = 5,
+  kTimestamp = 6,
+  kDate = 7,
+  kNumeric = 8,
+};
+
+constexpr char kPrefixLimit = '\xff';
+constexpr absl::string_view kInfinity = "\xff\xff";
+constexpr uint64_t kSignBit = uint64_t{1} << 63;
+
+TypeTag GetTypeTag(const zetasql::Type* type) {
+  switch (type->kind()) {
+    case zetasql::TYPE_BOOL:
+      return kBool;
+    case zetasql::TYPE_INT64:
+      return kInt64;
+    case zetasql::TYPE_DOUBLE:
+      return kDouble;
+    case zetasql::TYPE_STRING:
+      return kString;
+    case zetasql::TYPE_BYTES:
+      return kBytes;
+    case zetasql::TYPE_TIMESTAMP:
+      return kTimestamp;
+    case zetasql::TYPE_DATE:
+      return kDate;
+    case zetasql::TYPE_NUMERIC:
+      return kNumeric;
+    default:
+      ZETASQL_LOG(FATAL) << "Unsupported key column type: "
+                 << type->DebugString();
+  }
+}
+
+const zetasql::Type* GetType(uint8_t tag) {
+  switch (tag) {
+    case kBool:
+      return zetasql::types::BoolType();
+    case kInt64:
+      return zetasql::types::Int64Type();
+    case kDouble:
+      return zetasql::types::DoubleType();
+    case kString:
+      return zetasql::types::StringType();
+    case kBytes:
+      return zetasql::types::BytesType();
+    case kTimestamp:
+      return zetasql::types::TimestampType();
+    case kDate:
+      return zetasql::types::DateType();
+    case kNumeric:
+      return zetasql::types::NumericType();
+    default:
+      ZETASQL_LOG(FATAL) << "Invalid encoded key column tag: " << int{tag};
+  }
+}
+
+void AppendBigEndian(uint64_t value, int num_bytes, std::string* out) {
+  for (int i = num_bytes - 1; i >= 0; --i) {
+    out->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+// Strings are terminated by 0x00 0x01, with each 0x00 within the string
+// escaped as 0x00 0xFF, so that a string sorts before any longer string with
+// the same prefix.
+void AppendEscapedString(absl::string_view value, std::string* out) {
+  for (char c : value) {
+    out->push_back(c);
+    if (c == '\0') {
+      out->push_back('\xff');
+    }
+  }
+  out->push_back('\0');
+  out->push_back('\x01');
+}
+
+// Maps doubles to unsigned integers in the order used by
+// zetasql::Value::LessThan: NaN sorts first, and -0.0 equals 0.0.
+uint64_t OrderedDoubleBits(double value) {
+  if (std::isnan(value)) {
+    return 0;
+  }
+  if (value == 0) {
+    value = 0;
+  }
+  const uint64_t bits = absl::bit_cast<uint64_t>(value);
+  return (bits & kSignBit) ? ~bits : bits | kSignBit;
+}
+
+double DoubleFromOrderedBits(uint64_t bits) {
+  if (bits == 0) {
+    return std::nan("");
+  }
+  return absl::bit_cast<double>((bits & kSignBit) ? bits ^ kSignBit : ~bits);
+}
+
+void AppendColumnValue(const zetasql::Value& value, std::string* out) {
+  switch (value.type_kind()) {
+    case zetasql::TYPE_BOOL:
+      out->push_back(value.bool_value() ? '\x01' : '\0');
+      break;
+    case zetasql::TYPE_INT64:
+      AppendBigEndian(static_cast<uint64_t>(value.int64_value()) ^ kSignBit,
+                      8, out);
+      break;
+    case zetasql::TYPE_DOUBLE:
+      AppendBigEndian(OrderedDoubleBits(value.double_value()), 8, out);
+      break;
+    case zetasql::TYPE_STRING:
+      AppendEscapedString(value.string_value(), out);
+      break;
+    case zetasql::TYPE_BYTES:
+      AppendEscapedString(value.bytes_value(), out);
+      break;
+    case zetasql::TYPE_TIMESTAMP: {
+      // Seconds are rounded down, so the nanoseconds are always positive.
+      const absl::Time time = value.ToTime();
+      const int64_t seconds = absl::ToUnixSeconds(time);
+      const int64_t nanos =
+          absl::ToInt64Nanoseconds(time - absl::FromUnixSeconds(seconds));
+      AppendBigEndian(static_cast<uint64_t>(seconds) ^ kSignBit, 8, out);
+      AppendBigEndian(nanos, 4, out);
+      break;
+    }
+    case zetasql::TYPE_DATE:
+      AppendBigEndian(static_cast<uint32_t>(value.date_value()) ^ 0x80000000,
+                      4, out);
+      break;
+    case zetasql::TYPE_NUMERIC: {
+      const unsigned __int128 packed =
+          static_cast<unsigned __int128>(value.numeric_value().as_packed_int())
+          ^ (static_cast<unsigned __int128>(1) << 127);
+      AppendBigEndian(static_cast<uint64_t>(packed >> 64), 8, out);
+      AppendBigEndian(static_cast<uint64_t>(packed), 8, out);
+      break;
+    }
+    default:
+      ZETASQL_LOG(FATAL) << "Unsupported key column value: "
+                 << value.DebugString();
+  }
+}
+
+void AppendColumn(const zetasql::Value& value, bool desc, std::string* out) {
+  const size_t start = out->size();
+  const uint8_t tag = GetTypeTag(value.type());
+  out->push_back(static_cast<char>(2 * tag + (value.is_null() ? 0 : 1)));
+  if (!value.is_null()) {
+    AppendColumnValue(value, out);
+  }
+  if (desc) {
+    for (size_t i = start; i < out->size(); ++i) {
+      (*out)[i] = static_cast<char>(~(*out)[i]);
+    }
+  }
+}
+
+// Reads the bytes of a single column, inverting them if it is descending.
+class ColumnReader {
+ public:
+  ColumnReader(absl::string_view encoded, size_t pos)
+      : encoded_(encoded),
+        pos_(pos),
+        desc_(static_cast<uint8_t>(encoded[pos]) >= 0x80) {}
+
+  bool desc() const { return desc_; }
+  size_t pos() const { return pos_; }
+
+  uint8_t ReadByte() {
+    const uint8_t byte = encoded_[pos_++];
+    return desc_ ? static_cast<uint8_t>(~byte) : byte;
+  }
+
+  uint64_t ReadBigEndian(int num_bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; ++i) {
+      value = (value << 8) | ReadByte();
+    }
+    return value;
+  }
+
+  std::string ReadEscapedString() {
+    std::string value;
+    while (true) {
+      const char c = ReadByte();
+      if (c == '\0' && ReadByte() == '\x01') {
+        return value;
+      }
+      value.push_back(c);
+    }
+  }
+
+ private:
+  absl::string_view encoded_;
+  size_t pos_;
+  const bool desc_;
+};
+
+zetasql::Value ReadColumnValue(uint8_t tag, ColumnReader& reader) {
+  switch (tag) {
+    case kBool:
+      return zetasql::Value::Bool(reader.ReadByte() != 0);
+    case kInt64:
+      return zetasql::Value::Int64(
+          static_cast<int64_t>(reader.ReadBigEndian(8) ^ kSignBit));
+    case kDouble:
+      return zetasql::Value::Double(
+          DoubleFromOrderedBits(reader.ReadBigEndian(8)));
+    case kString:
+      return zetasql::Value::String(reader.ReadEscapedString());
+    case kBytes:
+      return zetasql::Value::Bytes(reader.ReadEscapedString());
+    case kTimestamp: {
+      const int64_t seconds =
+          static_cast<int64_t>(reader.ReadBigEndian(8) ^ kSignBit);
+      const int64_t nanos = reader.ReadBigEndian(4);
+      return zetasql::Value::Timestamp(absl::FromUnixSeconds(seconds) +
+                                         absl::Nanoseconds(nanos));
+    }
+    case kDate:
+      return zetasql::Value::Date(
+          static_cast<int32_t>(reader.ReadBigEndian(4) ^ 0x80000000));
+    case kNumeric: {
+      unsigned __int128 packed = reader.ReadBigEndian(8);
+      packed = (packed << 64) | reader.ReadBigEndian(8);
+      packed ^= static_cast<unsigned __int128>(1) << 127;
+      return zetasql::Value::Numeric(
+          zetasql::NumericValue::FromPackedInt(static_cast<__int128>(packed))
+              .value());
+    }
+    default:
+      ZETASQL_LOG(FATAL) << "Invalid encoded key column tag: " << int{tag};
+  }
+}
+
+}  // namespace
+
+void AppendEncodedKey(const Key& key, std::string* out) {
+  if (key.IsInfinity()) {
+    out->append(kInfinity.data(), kInfinity.size());
+    return;
+  }
+  for (int i = 0; i < key.NumColumns(); ++i) {
+    AppendColumn(key.ColumnValue(i), key.IsColumnDescending(i), out);
+  }
+  if (key.IsPrefixLimit()) {
+    out->push_back(kPrefixLimit);
+  }
+}
+
+std::string EncodeKey(const Key& key) {
+  std::string encoded;
+  AppendEncodedKey(key, &encoded);
+  return encoded;
+}
+
+Key DecodeKey(absl::string_view encoded) {
+  if (encoded == kInfinity) {
+    return Key::Infinity();
+  }
+  Key key;
+  size_t pos = 0;
+  while (pos < encoded.size()) {
+    if (encoded[pos] == kPrefixLimit) {
+      return key.ToPrefixLimit();
+    }
+    ColumnReader reader(encoded, pos);
+    const uint8_t header = reader.ReadByte();
+    const zetasql::Type* type = GetType(header / 2);
+    key.AddColumn((header & 1) ? ReadColumnValue(header / 2, reader)
+                               : zetasql::Value::Null(type),
+                  reader.desc());
+    pos = reader.pos();
+  }
+  return key;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,64 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATAMODEL_KEY_ENCODING_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATAMODEL_KEY_ENCODING_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Memcomparable key encoding.
+//
+// EncodeKey maps a Key to a byte string such that comparing two encoded keys
+// bytewise (e.g. with memcmp or std::string::compare) orders them the same way
+// as Key::Compare orders the keys. Containers ordered by encoded keys only pay
+// for a memcmp per probe instead of a per-column comparison of
+// zetasql::Values.
+//
+// Each column is encoded as a header byte identifying its type and whether it
+// is NULL, followed by an order-preserving encoding of its value. All bytes of
+// a descending column are inverted. Prefix limit keys have a trailing 0xFF,
+// which sorts after any further column, and Key::Infinity() is encoded as
+// 0xFF 0xFF. The encoding is self-describing, so DecodeKey recovers the key,
+// including the descending flags of its columns.
+//
+// Only types supported for key columns (see IsSupportedKeyColumnType) can be
+// encoded. Like Key::Compare, the order of keys whose columns have mismatching
+// types is not meaningful.
+
+// Returns the memcomparable encoding of key.
+std::string EncodeKey(const Key& key);
+
+// Appends the memcomparable encoding of key to out.
+void AppendEncodedKey(const Key& key, std::string* out);
+
+// Returns the key for a string returned by EncodeKey.
+Key DecodeKey(absl::string_view encoded);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_DATAMODEL_KEY_ENCODING_H_
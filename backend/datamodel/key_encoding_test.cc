@@ -0,0 +1,178 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/datamodel/key_encoding.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/numeric_value.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Bool;
+using zetasql::values::Bytes;
+using zetasql::values::Date;
+using zetasql::values::Double;
+using zetasql::values::Int64;
+using zetasql::values::Null;
+using zetasql::values::Numeric;
+using zetasql::values::String;
+using zetasql::values::Timestamp;
+
+int Sign(int value) { return (value > 0) - (value < 0); }
+
+// Values of each key column type, including NULL.
+std::vector<std::vector<zetasql::Value>> ValuesByType() {
+  return {
+      {Null(zetasql::types::BoolType()), Bool(false), Bool(true)},
+      {Null(zetasql::types::Int64Type()),
+       Int64(std::numeric_limits<int64_t>::min()), Int64(-1), Int64(0),
+       Int64(1), Int64(256), Int64(std::numeric_limits<int64_t>::max())},
+      {Null(zetasql::types::DoubleType()), Double(std::nan("")),
+       Double(-std::numeric_limits<double>::infinity()), Double(-1.5),
+       Double(-std::numeric_limits<double>::denorm_min()), Double(0),
+       Double(std::numeric_limits<double>::denorm_min()), Double(2.25),
+       Double(std::numeric_limits<double>::infinity())},
+      {Null(zetasql::types::StringType()), String(""),
+       String(std::string("\0", 1)), String(std::string("\0\0", 2)),
+       String(std::string("a\0", 2)), String("a"), String("ab"),
+       String("\xff")},
+      {Null(zetasql::types::BytesType()), Bytes(""),
+       Bytes(std::string("\0\x01", 2)), Bytes("\x01"), Bytes("\xff\xff")},
+      {Null(zetasql::types::TimestampType()),
+       Timestamp(absl::FromUnixSeconds(-1) - absl::Nanoseconds(1)),
+       Timestamp(absl::FromUnixSeconds(-1)),
+       Timestamp(absl::FromUnixSeconds(-1) + absl::Nanoseconds(1)),
+       Timestamp(absl::UnixEpoch()),
+       Timestamp(absl::FromUnixSeconds(1) + absl::Nanoseconds(999999999))},
+      {Null(zetasql::types::DateType()), Date(-719162), Date(-1), Date(0),
+       Date(1), Date(2932896)},
+      {Null(zetasql::types::NumericType()),
+       Numeric(zetasql::NumericValue::MinValue()),
+       Numeric(zetasql::NumericValue::FromStringStrict("-1.5").value()),
+       Numeric(zetasql::NumericValue()),
+       Numeric(zetasql::NumericValue::FromStringStrict("1e-9").value()),
+       Numeric(zetasql::NumericValue::MaxValue())},
+  };
+}
+
+void ExpectSameOrder(const std::vector<Key>& keys) {
+  for (const Key& k1 : keys) {
+    for (const Key& k2 : keys) {
+      EXPECT_EQ(Sign(EncodeKey(k1).compare(EncodeKey(k2))),
+                Sign(k1.Compare(k2)))
+          << k1 << " vs " << k2;
+    }
+  }
+}
+
+TEST(KeyEncoding, RoundTripsAllKeyColumnTypes) {
+  for (const auto& values : ValuesByType()) {
+    for (const zetasql::Value& value : values) {
+      for (bool desc : {false, true}) {
+        Key key;
+        key.AddColumn(value, desc);
+        Key decoded = DecodeKey(EncodeKey(key));
+        ASSERT_EQ(decoded.NumColumns(), 1);
+        EXPECT_EQ(decoded.IsColumnDescending(0), desc);
+        if (value.type()->IsDouble() && !value.is_null() &&
+            std::isnan(value.double_value())) {
+          EXPECT_TRUE(std::isnan(decoded.ColumnValue(0).double_value()));
+        } else {
+          EXPECT_EQ(decoded.ColumnValue(0), value);
+        }
+      }
+    }
+  }
+}
+
+TEST(KeyEncoding, RoundTripsSpecialKeys) {
+  Key key({String("a"), Int64(1)});
+  key.SetColumnDescending(1, true);
+  for (const Key& k : {Key::Empty(), Key::Empty().ToPrefixLimit(),
+                       Key::Infinity(), key, key.ToPrefixLimit(),
+                       key.Prefix(1).ToPrefixLimit()}) {
+    Key decoded = DecodeKey(EncodeKey(k));
+    EXPECT_EQ(decoded, k);
+    EXPECT_EQ(decoded.IsPrefixLimit(), k.IsPrefixLimit());
+    EXPECT_EQ(decoded.IsInfinity(), k.IsInfinity());
+  }
+}
+
+TEST(KeyEncoding, OrdersSingleColumnKeysLikeCompare) {
+  for (const auto& values : ValuesByType()) {
+    for (bool desc : {false, true}) {
+      std::vector<Key> keys;
+      for (const zetasql::Value& value : values) {
+        Key key;
+        key.AddColumn(value, desc);
+        keys.push_back(key);
+        keys.push_back(key.ToPrefixLimit());
+      }
+      ExpectSameOrder(keys);
+    }
+  }
+}
+
+TEST(KeyEncoding, OrdersMultiColumnKeysLikeCompare) {
+  std::vector<zetasql::Value> strings = {Null(zetasql::types::StringType()),
+                                         String(""), String("a"),
+                                         String(std::string("a\0", 2))};
+  std::vector<zetasql::Value> ints = {Null(zetasql::types::Int64Type()),
+                                      Int64(-1), Int64(0), Int64(7)};
+  for (bool desc : {false, true}) {
+    std::vector<Key> keys = {Key::Empty(), Key::Empty().ToPrefixLimit(),
+                             Key::Infinity()};
+    for (const zetasql::Value& s : strings) {
+      Key prefix;
+      prefix.AddColumn(s);
+      keys.push_back(prefix);
+      keys.push_back(prefix.ToPrefixLimit());
+      for (const zetasql::Value& i : ints) {
+        Key key = prefix;
+        key.AddColumn(i, desc);
+        keys.push_back(key);
+        keys.push_back(key.ToPrefixLimit());
+      }
+    }
+    ExpectSameOrder(keys);
+  }
+}
+
+TEST(KeyEncoding, EncodesNegativeZeroAsZero) {
+  EXPECT_EQ(EncodeKey(Key({Double(-0.0)})), EncodeKey(Key({Double(0.0)})));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -17,6 +17,8 @@
 #include "backend/datamodel/key.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -33,6 +35,7 @@ namespace backend {
 namespace {
 
 using zetasql::types::Int64Type;
+using zetasql::values::Bytes;
 using zetasql::values::Int64;
 using zetasql::values::Null;
 using zetasql::values::String;
@@ -114,6 +117,16 @@ TEST(Key, OrdersKeysOfSameLength) {
   EXPECT_LT(Key({String("B"), Int64(1)}), Key({String("B"), Int64(2)}));
 }
 
+TEST(Key, OrdersStringAndBytesKeysBytewise) {
+  EXPECT_LT(Key({String("B")}), Key({String("a")}));
+  EXPECT_LT(Key({String("a")}), Key({String("ab")}));
+  EXPECT_LT(Key({String("")}), Key({String("a")}));
+  EXPECT_LT(Key({Bytes("\x01")}), Key({Bytes("\x80")}));
+  EXPECT_EQ(Key({Bytes("ab"), Int64(-1)}), Key({Bytes("ab"), Int64(-1)}));
+  EXPECT_LT(Key({Int64(std::numeric_limits<int64_t>::min())}),
+            Key({Int64(std::numeric_limits<int64_t>::max())}));
+}
+
 TEST(Key, OrdersKeysOfDifferentLength) {
   EXPECT_LT(Key({Int64(1)}), Key({Int64(1), String("One")}));
   EXPECT_GT(Key({String("B"), Int64(1)}), Key({String("A")}));
@@ -185,6 +198,20 @@ TEST(Key, OrdersMultiColumnPrefixLimitKeys) {
   EXPECT_LT(Key({String("A"), Int64(1), String("B")}), key.ToPrefixLimit());
 }
 
+TEST(Key, KeepsColumnOrdersOfKeysLongerThanInlineColumns) {
+  Key key;
+  for (int i = 0; i < 2 * Key::kInlineColumns; ++i) {
+    key.AddColumn(Int64(i), /*desc=*/i % 2 == 1);
+  }
+  ASSERT_EQ(key.NumColumns(), 2 * Key::kInlineColumns);
+  for (int i = 0; i < key.NumColumns(); ++i) {
+    EXPECT_EQ(key.ColumnValue(i), Int64(i));
+    EXPECT_EQ(key.IsColumnDescending(i), i % 2 == 1);
+  }
+
+  EXPECT_EQ("{Int64(0), Int64(1)↓, Int64(2)}", key.Prefix(3).DebugString());
+}
+
 TEST(Key, GeneratesPrefixKeys) {
   Key k1d2a;
   k1d2a.AddColumn(Int64(1), true);
@@ -19,6 +19,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "backend/locking/manager.h"
+#include "common/metrics.h"
 
 namespace google {
 namespace spanner {
@@ -29,7 +30,11 @@ LockHandle::LockHandle(LockManager* manager, TransactionID tid,
                        TransactionPriority priority)
     : manager_(manager), tid_(tid), priority_(priority) {}
 
-LockHandle::~LockHandle() = default;
+LockHandle::~LockHandle() {
+  if (tracked_) {
+    manager_->ForgetHandle(this);
+  }
+}
 
 void LockHandle::EnqueueLock(const LockRequest& request) {
   manager_->EnqueueLock(this, request);
@@ -37,11 +42,7 @@ void LockHandle::EnqueueLock(const LockRequest& request) {
 
 void LockHandle::UnlockAll() { manager_->UnlockAll(this); }
 
-bool LockHandle::IsBlocked() {
-  // The current implementation never blocks.
-  absl::MutexLock lock(&mu_);
-  return false;
-}
+bool LockHandle::IsBlocked() { return manager_->IsBlocked(this); }
 
 bool LockHandle::IsAborted() {
   absl::MutexLock lock(&mu_);
@@ -49,7 +50,13 @@ bool LockHandle::IsAborted() {
 }
 
 absl::Status LockHandle::Wait() {
-  // The current implementation never blocks.
+  static metrics::LatencyHistogram* histogram =
+      metrics::GetLatencyHistogram("emulator_lock_wait_seconds");
+  metrics::ScopedLatencyTimer timer(histogram);
+  return manager_->Wait(this);
+}
+
+absl::Status LockHandle::status() {
   absl::MutexLock lock(&mu_);
   return status_;
 }
@@ -73,6 +80,9 @@ absl::Status LockHandle::MarkCommitted() {
 }
 
 void LockHandle::WaitForSafeRead(absl::Time read_time) {
+  static metrics::LatencyHistogram* histogram =
+      metrics::GetLatencyHistogram("emulator_safe_read_wait_seconds");
+  metrics::ScopedLatencyTimer timer(histogram);
   manager_->WaitForSafeRead(read_time);
 }
 
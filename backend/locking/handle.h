@@ -17,6 +17,8 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_HANDLE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_HANDLE_H_
 
+#include <atomic>
+
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -118,6 +120,9 @@ class LockHandle {
   // Resets the state of this handle.
   void Reset() ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Returns the status of the lock handle requests.
+  absl::Status status() ABSL_LOCKS_EXCLUDED(mu_);
+
   // The LockManager which this LockHandle interacts with.
   LockManager* const manager_;
 
@@ -132,6 +137,12 @@ class LockHandle {
 
   // The status of the lock handle requests.
   absl::Status status_ ABSL_GUARDED_BY(mu_);
+
+  // True while the lock manager records the activity of this handle (see
+  // LockManager::AbortIdleTransactions). Only written under the lock manager
+  // mutex, and checked on destruction so that handles which were never
+  // tracked do not acquire it.
+  std::atomic<bool> tracked_ = false;
 };
 
 }  // namespace backend
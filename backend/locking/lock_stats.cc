@@ -0,0 +1,141 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/locking/lock_stats.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_buckets.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of distinct keys tracked per interval, see StatsBuckets.
+constexpr int kMaxTrackedKeysPerInterval =
+    10 * LockStatsAggregator::kMaxKeysPerInterval;
+
+// Adds a sample lock request to samples unless it is already present.
+void AddSampleLockRequest(const LockRequestSample& request,
+                          std::vector<LockRequestSample>* samples) {
+  if (samples->size() >= LockStatsAggregator::kMaxSampleLockRequests ||
+      std::find(samples->begin(), samples->end(), request) != samples->end()) {
+    return;
+  }
+  samples->push_back(request);
+}
+
+}  // namespace
+
+LockStatsAggregator::LockStatsAggregator()
+    : minute_buckets_(absl::Minutes(1), kMaxIntervals,
+                      kMaxTrackedKeysPerInterval),
+      ten_minute_buckets_(absl::Minutes(10), kMaxIntervals,
+                          kMaxTrackedKeysPerInterval),
+      hour_buckets_(absl::Hours(1), kMaxIntervals,
+                    kMaxTrackedKeysPerInterval) {}
+
+void LockStatsAggregator::RecordInto(Buckets* buckets,
+                                     const LockConflictSample& sample,
+                                     absl::Time now) {
+  // Waits are recorded once they end, so a wait which ended just before a
+  // newer sample started a new interval still belongs to its own.
+  Buckets::Bucket* bucket = buckets->BucketAt(now);
+  if (bucket == nullptr) {
+    return;
+  }
+  bucket->totals.lock_wait += sample.wait;
+  ++bucket->totals.conflict_count;
+
+  Totals* totals = buckets->KeyTotals(
+      bucket, std::make_pair(sample.table_id, sample.row_range_start_key));
+  if (totals == nullptr) {
+    return;
+  }
+  totals->lock_wait += sample.wait;
+  ++totals->conflict_count;
+  if (sample.column_ids.empty()) {
+    AddSampleLockRequest({"", sample.mode}, &totals->sample_lock_requests);
+  }
+  for (const ColumnID& column_id : sample.column_ids) {
+    AddSampleLockRequest({column_id, sample.mode},
+                         &totals->sample_lock_requests);
+  }
+}
+
+void LockStatsAggregator::Record(const LockConflictSample& sample,
+                                 absl::Time now) {
+  absl::MutexLock lock(&mu_);
+  for (Buckets* buckets :
+       {&minute_buckets_, &ten_minute_buckets_, &hour_buckets_}) {
+    RecordInto(buckets, sample, now);
+  }
+}
+
+const LockStatsAggregator::Buckets& LockStatsAggregator::GetBuckets(
+    LockStatsInterval interval) const {
+  return interval == LockStatsInterval::kMinute       ? minute_buckets_
+         : interval == LockStatsInterval::kTenMinutes ? ten_minute_buckets_
+                                                      : hour_buckets_;
+}
+
+std::vector<LockStatsRow> LockStatsAggregator::GetStats(
+    LockStatsInterval interval, absl::Time now) const {
+  std::vector<LockStatsRow> rows;
+  absl::MutexLock lock(&mu_);
+  for (const Buckets::Bucket* bucket :
+       GetBuckets(interval).ReportedBuckets(now)) {
+    for (const auto& [key, totals] : Buckets::TopKeys(
+             *bucket, kMaxKeysPerInterval, [](const Totals& totals) {
+               return std::make_pair(totals.lock_wait, totals.conflict_count);
+             })) {
+      LockStatsRow row;
+      row.interval_end = bucket->interval_end;
+      row.table_id = key.first;
+      row.row_range_start_key = key.second;
+      row.lock_wait_seconds = absl::ToDoubleSeconds(totals->lock_wait);
+      row.conflict_count = totals->conflict_count;
+      row.sample_lock_requests = totals->sample_lock_requests;
+      rows.push_back(std::move(row));
+    }
+  }
+  return rows;
+}
+
+std::vector<LockStatsTotalRow> LockStatsAggregator::GetTotals(
+    LockStatsInterval interval, absl::Time now) const {
+  std::vector<LockStatsTotalRow> rows;
+  absl::MutexLock lock(&mu_);
+  for (const Buckets::Bucket* bucket :
+       GetBuckets(interval).ReportedBuckets(now)) {
+    rows.push_back({bucket->interval_end,
+                    absl::ToDoubleSeconds(bucket->totals.lock_wait),
+                    bucket->totals.conflict_count});
+  }
+  return rows;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
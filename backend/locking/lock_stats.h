@@ -0,0 +1,161 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_LOCK_STATS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_LOCK_STATS_H_
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+#include "backend/common/stats_buckets.h"
+#include "backend/datamodel/key.h"
+#include "backend/locking/request.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// The interval lengths over which lock statistics are aggregated. They
+// correspond to the SPANNER_SYS.LOCK_STATS_TOP_MINUTE, _10MINUTE and _HOUR
+// tables.
+enum class LockStatsInterval { kMinute, kTenMinutes, kHour };
+
+// A lock request which conflicted with locks held by another transaction.
+struct LockConflictSample {
+  LockMode mode = LockMode::kExclusive;
+  TableID table_id;
+
+  // The start of the requested key range.
+  Key row_range_start_key;
+
+  // The requested columns. Empty if the request only locks row existence.
+  std::vector<ColumnID> column_ids;
+
+  // Time spent waiting for the conflicting locks to be released. Zero if the
+  // request was denied straight away, or wounded the holders.
+  absl::Duration wait;
+};
+
+// A column lock which was requested on a contended key, as reported in the
+// SAMPLE_LOCK_REQUESTS column. An empty column_id stands for the existence of
+// the row.
+struct LockRequestSample {
+  ColumnID column_id;
+  LockMode mode = LockMode::kExclusive;
+
+  bool operator==(const LockRequestSample& other) const {
+    return column_id == other.column_id && mode == other.mode;
+  }
+};
+
+// The statistics of one contended key over one interval, as exposed by the
+// SPANNER_SYS lock stats tables.
+struct LockStatsRow {
+  absl::Time interval_end;
+  TableID table_id;
+  Key row_range_start_key;
+  double lock_wait_seconds = 0;
+  int64_t conflict_count = 0;
+  std::vector<LockRequestSample> sample_lock_requests;
+};
+
+// The total lock wait of one interval, as exposed by the SPANNER_SYS
+// LOCK_STATS_TOTAL_* tables.
+struct LockStatsTotalRow {
+  absl::Time interval_end;
+  double total_lock_wait_seconds = 0;
+  int64_t conflict_count = 0;
+};
+
+// LockStatsAggregator accumulates the lock conflicts of a database into
+// per-key statistics for each minute, ten minute and hour interval, in the
+// style of Cloud Spanner's lock statistics tables. It follows
+// QueryStatsAggregator: only the most recent intervals are retained, only the
+// keys with the highest lock wait are reported per interval, and the interval
+// in progress is reported as well.
+//
+// This class is thread-safe.
+class LockStatsAggregator {
+ public:
+  // The number of distinct keys reported per interval.
+  static constexpr int kMaxKeysPerInterval = 100;
+
+  // The number of lock requests sampled per key and interval.
+  static constexpr int kMaxSampleLockRequests = 20;
+
+  // The number of intervals of each length which are retained.
+  static constexpr int kMaxIntervals = 60;
+
+  LockStatsAggregator();
+
+  // Records sample as having happened at time now.
+  void Record(const LockConflictSample& sample, absl::Time now)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the statistics of the retained intervals of the given length
+  // which ended at or before now, or are in progress at now. Rows are ordered
+  // by interval end, latest first, and then by decreasing lock wait.
+  std::vector<LockStatsRow> GetStats(LockStatsInterval interval,
+                                     absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the totals of the same intervals as GetStats, latest first.
+  std::vector<LockStatsTotalRow> GetTotals(LockStatsInterval interval,
+                                           absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  LockStatsAggregator(const LockStatsAggregator&) = delete;
+  LockStatsAggregator& operator=(const LockStatsAggregator&) = delete;
+
+  // Running totals for a single contended key, or for all keys. Lock requests
+  // are only sampled per key.
+  struct Totals {
+    absl::Duration lock_wait;
+    int64_t conflict_count = 0;
+    std::vector<LockRequestSample> sample_lock_requests;
+  };
+
+  // Keys cannot be hashed, so they are kept in key order.
+  using ContendedKey = std::pair<TableID, Key>;
+  using Buckets =
+      StatsBuckets<ContendedKey, Totals, std::map<ContendedKey, Totals>>;
+
+  static void RecordInto(Buckets* buckets, const LockConflictSample& sample,
+                         absl::Time now);
+
+  const Buckets& GetBuckets(LockStatsInterval interval) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  Buckets minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets ten_minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets hour_buckets_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_LOCK_STATS_H_
@@ -0,0 +1,121 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/locking/lock_stats.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+#include "backend/locking/request.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using testing::ElementsAre;
+using testing::Field;
+
+LockConflictSample Sample(int64_t key, absl::Duration wait,
+                          std::vector<ColumnID> column_ids = {}) {
+  LockConflictSample sample;
+  sample.mode = LockMode::kExclusive;
+  sample.table_id = "table";
+  sample.row_range_start_key = Key({zetasql::values::Int64(key)});
+  sample.column_ids = std::move(column_ids);
+  sample.wait = wait;
+  return sample;
+}
+
+class LockStatsAggregatorTest : public testing::Test {
+ protected:
+  // An arbitrary minute boundary.
+  const absl::Time start_ = absl::FromUnixSeconds(1700000040);
+  LockStatsAggregator aggregator_;
+};
+
+TEST_F(LockStatsAggregatorTest, SumsConflictsOnTheSameKey) {
+  aggregator_.Record(Sample(1, absl::Seconds(1), {"a"}), start_);
+  aggregator_.Record(Sample(1, absl::Seconds(2), {"a", "b"}),
+                     start_ + absl::Seconds(10));
+
+  std::vector<LockStatsRow> rows = aggregator_.GetStats(
+      LockStatsInterval::kMinute, start_ + absl::Seconds(20));
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].interval_end, start_ + absl::Minutes(1));
+  EXPECT_EQ(rows[0].table_id, "table");
+  EXPECT_EQ(rows[0].row_range_start_key, Key({zetasql::values::Int64(1)}));
+  EXPECT_DOUBLE_EQ(rows[0].lock_wait_seconds, 3);
+  EXPECT_EQ(rows[0].conflict_count, 2);
+  EXPECT_THAT(rows[0].sample_lock_requests,
+              ElementsAre(Field(&LockRequestSample::column_id, "a"),
+                          Field(&LockRequestSample::column_id, "b")));
+
+  std::vector<LockStatsTotalRow> totals = aggregator_.GetTotals(
+      LockStatsInterval::kMinute, start_ + absl::Seconds(20));
+  ASSERT_EQ(totals.size(), 1);
+  EXPECT_DOUBLE_EQ(totals[0].total_lock_wait_seconds, 3);
+  EXPECT_EQ(totals[0].conflict_count, 2);
+}
+
+TEST_F(LockStatsAggregatorTest, OrdersKeysByLockWaitThenConflicts) {
+  aggregator_.Record(Sample(1, absl::ZeroDuration()), start_);
+  aggregator_.Record(Sample(2, absl::Seconds(1)), start_);
+  aggregator_.Record(Sample(3, absl::ZeroDuration()), start_);
+  aggregator_.Record(Sample(3, absl::ZeroDuration()), start_);
+
+  std::vector<LockStatsRow> rows =
+      aggregator_.GetStats(LockStatsInterval::kMinute, start_);
+  ASSERT_EQ(rows.size(), 3);
+  EXPECT_EQ(rows[0].row_range_start_key, Key({zetasql::values::Int64(2)}));
+  EXPECT_EQ(rows[1].row_range_start_key, Key({zetasql::values::Int64(3)}));
+  EXPECT_EQ(rows[2].row_range_start_key, Key({zetasql::values::Int64(1)}));
+}
+
+TEST_F(LockStatsAggregatorTest, SeparatesIntervals) {
+  aggregator_.Record(Sample(1, absl::Seconds(1)), start_);
+  aggregator_.Record(Sample(1, absl::Seconds(1)), start_ + absl::Minutes(1));
+
+  // The latest interval is reported first, and future ones are not.
+  std::vector<LockStatsTotalRow> minutes =
+      aggregator_.GetTotals(LockStatsInterval::kMinute, start_);
+  ASSERT_EQ(minutes.size(), 1);
+  minutes = aggregator_.GetTotals(LockStatsInterval::kMinute,
+                                  start_ + absl::Minutes(1));
+  ASSERT_EQ(minutes.size(), 2);
+  EXPECT_EQ(minutes[0].interval_end, start_ + absl::Minutes(2));
+  EXPECT_EQ(minutes[1].interval_end, start_ + absl::Minutes(1));
+
+  std::vector<LockStatsRow> hours =
+      aggregator_.GetStats(LockStatsInterval::kHour, start_ + absl::Minutes(1));
+  ASSERT_EQ(hours.size(), 1);
+  EXPECT_DOUBLE_EQ(hours[0].lock_wait_seconds, 2);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -16,20 +16,61 @@
 
 #include "backend/locking/manager.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/locking/lock_stats.h"
+#include "backend/locking/request.h"
 #include "common/errors.h"
+#include "common/metrics.h"
+#include "common/tracing.h"
+#include "zetasql/base/ret_check.h"
 
 namespace google {
 namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+// Maximum time a transaction waits for a conflicting row lock to be released
+// before it is aborted.
+constexpr absl::Duration kMaxRowLockWaitTime = absl::Seconds(10);
+
+// Returns true if the given ClosedOpen key ranges overlap.
+bool Overlaps(const KeyRange& lhs, const KeyRange& rhs) {
+  return lhs.start_key() < rhs.limit_key() && rhs.start_key() < lhs.limit_key();
+}
+
+// Returns true if lhs takes precedence over rhs under wound-wait. Transaction
+// priorities are derived from the time of their first attempt, so lower values
+// belong to older transactions. Ties are broken by transaction id.
+bool IsOlder(LockHandle* lhs, LockHandle* rhs) {
+  if (lhs->priority() != rhs->priority()) {
+    return lhs->priority() < rhs->priority();
+  }
+  return lhs->tid() < rhs->tid();
+}
+
+// Schema changes request a lock on an empty table id to represent a lock on
+// the whole database.
+bool IsDatabaseWideRequest(const LockRequest& request) {
+  return request.table_id().empty();
+}
+
+}  // namespace
+
 std::unique_ptr<LockHandle> LockManager::CreateHandle(
     TransactionID tid, TransactionPriority priority) {
   return absl::WrapUnique(new LockHandle(this, tid, priority));
@@ -42,10 +83,28 @@ void LockManager::EnqueueLock(LockHandle* handle, const LockRequest& request) {
   if (handle->IsAborted()) {
     return;
   }
+  RecordActivity(handle);
+
+  if (UsesGroupCommit()) {
+    EnqueueRowLock(handle, request);
+    return;
+  }
+
+  // A schema change cannot start while a metadata change is in progress.
+  if (IsDatabaseWideRequest(request) &&
+      metadata_change_tid_ != kInvalidTransactionID) {
+    handle->Abort(
+        error::AbortConcurrentTransaction(handle->tid(), metadata_change_tid_));
+    ++concurrent_transaction_aborts_;
+    return;
+  }
 
   // If there is no transaction holding the lock, we grant it.
   if (active_tid_ == kInvalidTransactionID) {
     active_tid_ = handle->tid();
+    if (IsDatabaseWideRequest(request)) {
+      database_lock_holder_ = handle;
+    }
     return;
   }
 
@@ -56,10 +115,18 @@ void LockManager::EnqueueLock(LockHandle* handle, const LockRequest& request) {
 
   // If we reached here, another transaction is already holding the lock, deny.
   handle->Abort(error::AbortConcurrentTransaction(handle->tid(), active_tid_));
+  ++concurrent_transaction_aborts_;
+  RecordConflict(request, absl::ZeroDuration());
 }
 
 void LockManager::UnlockAll(LockHandle* handle) {
   absl::MutexLock lock(&mu_);
+  EndActivity(handle);
+
+  if (UsesGroupCommit()) {
+    UnlockAllRowLocks(handle);
+    return;
+  }
 
   // If the transaction does not hold the lock, there is nothing to do.
   if (active_tid_ != handle->tid()) {
@@ -69,6 +136,9 @@ void LockManager::UnlockAll(LockHandle* handle) {
 
   // Clear the active transaction if it holds the lock.
   active_tid_ = kInvalidTransactionID;
+  if (database_lock_holder_ == handle) {
+    database_lock_holder_ = nullptr;
+  }
   handle->Reset();
 }
 
@@ -76,6 +146,20 @@ absl::StatusOr<absl::Time> LockManager::ReserveCommitTimestamp(
     LockHandle* handle) {
   absl::MutexLock lock(&mu_);
 
+  if (UsesGroupCommit()) {
+    if (!handle->IsAborted()) {
+      RecordActivity(handle);
+    }
+    return ReserveRowLockCommitTimestamp(handle);
+  }
+
+  // A transaction which was aborted, for instance for being idle, cannot
+  // commit.
+  if (handle->IsAborted()) {
+    return handle->status();
+  }
+  RecordActivity(handle);
+
   // If there is no transaction holding the lock, we grant it to the transaction
   // requesting commit timestamp. This can happen if transaction has empty
   // mutations and write locks weren't thus acquired yet.
@@ -83,27 +167,48 @@ absl::StatusOr<absl::Time> LockManager::ReserveCommitTimestamp(
     active_tid_ = handle->tid();
   } else if (active_tid_ != handle->tid()) {
     // There is another active transaction, abort this transaction.
+    ++concurrent_transaction_aborts_;
     return error::AbortConcurrentTransaction(handle->tid(), active_tid_);
   }
 
-  pending_commit_timestamp_ = clock_->Now();
-  return pending_commit_timestamp_;
+  // Commits are ordered after the metadata change in progress.
+  while (metadata_change_tid_ != kInvalidTransactionID) {
+    pending_commit_cvar_.Wait(&mu_);
+  }
+  return ReservePendingCommitTimestamp();
 }
 
 absl::Status LockManager::MarkCommitted(LockHandle* handle) {
   absl::MutexLock lock(&mu_);
 
+  if (UsesGroupCommit()) {
+    ZETASQL_RET_CHECK(committing_handles_.contains(handle)) << absl::Substitute(
+        "Transaction $0 has not reserved a commit timestamp.", handle->tid());
+    EndRowLockCommit(handle, /*committed=*/true);
+    return absl::OkStatus();
+  }
+
   // This transaction should have been set as the active transaction.
   ZETASQL_RET_CHECK_EQ(active_tid_, handle->tid())
       << absl::Substitute("Transaction $0 is not active.", handle->tid());
 
   last_commit_timestamp_ = pending_commit_timestamp_;
-  pending_commit_timestamp_ = absl::InfiniteFuture();
+  SetPendingCommitTimestamp(absl::InfiniteFuture());
   pending_commit_cvar_.SignalAll();
   return absl::OkStatus();
 }
 
 void LockManager::WaitForSafeRead(absl::Time read_time) {
+  // A read which is not in the future and precedes every in-progress commit is
+  // safe. The clock is read before the pending commit timestamp, so that a
+  // commit whose timestamp precedes read_time has published it by then (see
+  // ReservePendingCommitTimestamp).
+  if (read_time <= clock_->Now() &&
+      read_time <= absl::FromUnixMicros(pending_commit_micros_.load())) {
+    return;
+  }
+
+  tracing::ScopedSpan span("LockManager.WaitForSafeRead");
   absl::MutexLock lock(&mu_);
 
   // Wait for read time to become current if passed a future timestamp  for the
@@ -117,11 +222,551 @@ void LockManager::WaitForSafeRead(absl::Time read_time) {
   }
 }
 
+void LockManager::SetPendingCommitTimestamp(absl::Time timestamp) {
+  pending_commit_timestamp_ = timestamp;
+  pending_commit_micros_.store(absl::ToUnixMicros(timestamp));
+}
+
+absl::Time LockManager::ReservePendingCommitTimestamp() {
+  // Readers which skip mu_ might otherwise read the clock after the commit
+  // timestamp was dispensed, but the pending commit timestamp before it is
+  // published. Until then, they wait on mu_ instead.
+  pending_commit_micros_.store(std::numeric_limits<int64_t>::min());
+  SetPendingCommitTimestamp(clock_->Now());
+  return pending_commit_timestamp_;
+}
+
+absl::StatusOr<absl::Time> LockManager::BeginMetadataChange(
+    TransactionID tid) {
+  absl::MutexLock lock(&mu_);
+  while (metadata_change_tid_ != kInvalidTransactionID) {
+    pending_commit_cvar_.Wait(&mu_);
+  }
+  if (database_lock_holder_ != nullptr) {
+    ++concurrent_transaction_aborts_;
+    return error::AbortConcurrentTransaction(tid, database_lock_holder_->tid());
+  }
+
+  // Commits which have not reserved a timestamp yet now wait for the metadata
+  // change, which in turn waits for the commit in progress, or the current
+  // commit group, to publish its writes.
+  metadata_change_tid_ = tid;
+  while (pending_commit_timestamp_ != absl::InfiniteFuture()) {
+    pending_commit_cvar_.Wait(&mu_);
+  }
+  return ReservePendingCommitTimestamp();
+}
+
+void LockManager::EndMetadataChange() {
+  absl::MutexLock lock(&mu_);
+  if (metadata_change_tid_ == kInvalidTransactionID) {
+    return;
+  }
+  last_commit_timestamp_ =
+      std::max(last_commit_timestamp_, pending_commit_timestamp_);
+  metadata_change_tid_ = kInvalidTransactionID;
+  SetPendingCommitTimestamp(absl::InfiniteFuture());
+  if (UsesGroupCommit()) {
+    AdmitQueuedCommits();
+    return;
+  }
+  pending_commit_cvar_.SignalAll();
+}
+
 absl::Time LockManager::LastCommitTimestamp() {
   absl::ReaderMutexLock lock(&mu_);
   return last_commit_timestamp_;
 }
 
+absl::Status LockManager::Wait(LockHandle* handle) {
+  tracing::ScopedSpan span("LockManager.Wait");
+  absl::MutexLock lock(&mu_);
+  if (UsesGroupCommit()) {
+    absl::Status status = WaitForRowLocks(handle);
+    if (status.ok()) {
+      RecordActivity(handle);
+    }
+    span.SetStatus(status);
+    return status;
+  }
+
+  // Lock requests are either granted or denied immediately in this mode.
+  return handle->status();
+}
+
+bool LockManager::IsBlocked(LockHandle* handle) {
+  absl::MutexLock lock(&mu_);
+  return !handle->IsAborted() && pending_requests_.contains(handle);
+}
+
+void LockManager::ForgetHandle(LockHandle* handle) {
+  absl::MutexLock lock(&mu_);
+  activity_.erase(handle);
+}
+
+void LockManager::RecordActivity(LockHandle* handle) {
+  const absl::Time now = absl::Now();
+  auto itr = activity_.find(handle);
+  if (itr == activity_.end()) {
+    activity_.emplace(handle, HandleActivity{now, now});
+  } else {
+    itr->second.last_request = now;
+  }
+  handle->tracked_ = true;
+}
+
+void LockManager::EndActivity(LockHandle* handle) {
+  static metrics::LatencyHistogram* histogram =
+      metrics::GetLatencyHistogram("emulator_lock_hold_seconds");
+  auto itr = activity_.find(handle);
+  if (itr == activity_.end()) {
+    return;
+  }
+  histogram->Record(absl::Now() - itr->second.first_request);
+  activity_.erase(itr);
+  handle->tracked_ = false;
+}
+
+void LockManager::RecordConflict(const LockRequest& request,
+                                 absl::Duration wait) {
+  if (IsDatabaseWideRequest(request)) {
+    return;
+  }
+  lock_stats_.Record({request.mode(), request.table_id(),
+                      request.key_range().start_key(), request.column_ids(),
+                      wait},
+                     absl::Now());
+}
+
+LockManager::ContentionStats LockManager::GetContentionStats() {
+  absl::MutexLock lock(&mu_);
+  ContentionStats stats;
+  stats.waiting_transactions = pending_requests_.size();
+  stats.concurrent_transaction_aborts = concurrent_transaction_aborts_;
+  stats.wounded_transactions = wounded_transactions_;
+  stats.lock_wait_timeouts = lock_wait_timeouts_;
+  stats.idle_transaction_aborts = idle_transaction_aborts_;
+  stats.optimistic_conflict_aborts = optimistic_conflict_aborts_;
+  const absl::Time now = absl::Now();
+  for (const auto& [handle, activity] : activity_) {
+    if (handle->IsAborted()) {
+      continue;
+    }
+    if (absl::Duration held = now - activity.first_request;
+        stats.longest_holder_id == kInvalidTransactionID ||
+        held > stats.longest_hold_duration) {
+      stats.longest_holder_id = handle->tid();
+      stats.longest_hold_duration = held;
+    }
+  }
+  return stats;
+}
+
+bool LockManager::IsCommitting(LockHandle* handle) {
+  if (UsesGroupCommit()) {
+    return committing_handles_.contains(handle) ||
+           std::find(queued_commits_.begin(), queued_commits_.end(), handle) !=
+               queued_commits_.end();
+  }
+  return active_tid_ == handle->tid() &&
+         pending_commit_timestamp_ != absl::InfiniteFuture();
+}
+
+int64_t LockManager::AbortIdleTransactions(absl::Duration idle_timeout) {
+  absl::MutexLock lock(&mu_);
+  const absl::Time now = absl::Now();
+  std::vector<std::pair<LockHandle*, absl::Duration>> idle_handles;
+  for (const auto& [handle, activity] : activity_) {
+    const absl::Duration idle_time = now - activity.last_request;
+    if (idle_time < idle_timeout || handle->IsAborted() ||
+        IsCommitting(handle) || pending_requests_.contains(handle)) {
+      continue;
+    }
+    idle_handles.emplace_back(handle, idle_time);
+  }
+
+  for (const auto& [handle, idle_time] : idle_handles) {
+    handle->Abort(error::AbortIdleTransaction(handle->tid(), idle_time));
+    if (UsesGroupCommit()) {
+      ReleaseRowLocks(handle);
+    } else if (active_tid_ == handle->tid()) {
+      active_tid_ = kInvalidTransactionID;
+    }
+    EndActivity(handle);
+  }
+  idle_transaction_aborts_ += idle_handles.size();
+  return idle_handles.size();
+}
+
+void LockManager::EnqueueRowLock(LockHandle* handle,
+                                 const LockRequest& request) {
+  // Requests are granted in the order they were made by a handle.
+  auto pending_itr = pending_requests_.find(handle);
+  if (pending_itr != pending_requests_.end()) {
+    pending_itr->second.push_back(request);
+    return;
+  }
+  if (!TryGrantRowLock(handle, request) && !handle->IsAborted()) {
+    pending_requests_[handle].push_back(request);
+  }
+}
+
+bool LockManager::TryGrantRowLock(LockHandle* handle,
+                                  const LockRequest& request) {
+  // A database-wide lock is only granted if no other transaction holds or is
+  // committing with any locks. It never wounds or waits, consistent with
+  // schema changes failing when there are concurrent transactions.
+  if (IsDatabaseWideRequest(request)) {
+    if (database_lock_holder_ == handle) {
+      return true;
+    }
+    if (metadata_change_tid_ != kInvalidTransactionID) {
+      handle->Abort(error::AbortConcurrentTransaction(handle->tid(),
+                                                      metadata_change_tid_));
+      ++concurrent_transaction_aborts_;
+      return false;
+    }
+    LockHandle* conflict = database_lock_holder_;
+    for (const auto& [committing_handle, timestamp] : committing_handles_) {
+      if (conflict == nullptr && committing_handle != handle) {
+        conflict = committing_handle;
+      }
+    }
+    for (const auto& [table_id, locks] : row_locks_) {
+      for (const RowLock& row_lock : locks) {
+        if (conflict == nullptr && row_lock.handle != handle) {
+          conflict = row_lock.handle;
+        }
+      }
+    }
+    for (const auto& [reader, reads] : optimistic_reads_) {
+      if (conflict == nullptr && reader != handle) {
+        conflict = reader;
+      }
+    }
+    if (conflict != nullptr) {
+      handle->Abort(
+          error::AbortConcurrentTransaction(handle->tid(), conflict->tid()));
+      ++concurrent_transaction_aborts_;
+      return false;
+    }
+    database_lock_holder_ = handle;
+    return true;
+  }
+
+  // Any request made while a schema change is in progress is denied.
+  if (database_lock_holder_ != nullptr && database_lock_holder_ != handle) {
+    handle->Abort(error::AbortConcurrentTransaction(
+        handle->tid(), database_lock_holder_->tid()));
+    ++concurrent_transaction_aborts_;
+    RecordConflict(request, absl::ZeroDuration());
+    return false;
+  }
+
+  KeyRange key_range = request.key_range().ToClosedOpen();
+  if (key_range.start_key() >= key_range.limit_key()) {
+    return true;
+  }
+
+  if (granularity_ == LockGranularity::kOptimistic) {
+    RecordOptimisticAccess(handle, request, std::move(key_range));
+    return true;
+  }
+
+  // Find all conflicting holders. Shared locks only conflict with exclusive
+  // locks.
+  std::vector<RowLock>& locks = row_locks_[request.table_id()];
+  std::vector<LockHandle*> conflicts;
+  bool already_held = false;
+  for (const RowLock& row_lock : locks) {
+    if (row_lock.handle == handle) {
+      already_held |=
+          (row_lock.mode == LockMode::kExclusive ||
+           row_lock.mode == request.mode()) &&
+          row_lock.key_range.start_key() <= key_range.start_key() &&
+          key_range.limit_key() <= row_lock.key_range.limit_key();
+      continue;
+    }
+    if (row_lock.mode == LockMode::kShared &&
+        request.mode() == LockMode::kShared) {
+      continue;
+    }
+    if (Overlaps(row_lock.key_range, key_range)) {
+      conflicts.push_back(row_lock.handle);
+    }
+  }
+
+  // Wound-wait: wound all younger conflicting holders unless they are already
+  // committing. Wait for older holders.
+  // Waits are recorded as conflicts once they end, see WaitForRowLocks.
+  bool must_wait = false;
+  bool wounded = false;
+  for (LockHandle* conflict : conflicts) {
+    if (conflict->IsAborted()) {
+      continue;
+    }
+    if (!IsOlder(handle, conflict) || committing_handles_.contains(conflict)) {
+      must_wait = true;
+      continue;
+    }
+    conflict->Abort(
+        error::AbortWoundedTransaction(conflict->tid(), handle->tid()));
+    ReleaseRowLocks(conflict);
+    ++wounded_transactions_;
+    wounded = true;
+  }
+  if (wounded && !must_wait) {
+    RecordConflict(request, absl::ZeroDuration());
+  }
+  if (must_wait) {
+    return false;
+  }
+
+  if (!already_held) {
+    row_locks_[request.table_id()].push_back(
+        RowLock{handle, request.mode(), std::move(key_range)});
+  }
+  return true;
+}
+
+bool LockManager::TryGrantPendingRowLocks(LockHandle* handle) {
+  auto pending_itr = pending_requests_.find(handle);
+  if (pending_itr == pending_requests_.end()) {
+    return true;
+  }
+  std::vector<LockRequest>& requests = pending_itr->second;
+  while (!requests.empty()) {
+    if (!TryGrantRowLock(handle, requests.front())) {
+      return false;
+    }
+    requests.erase(requests.begin());
+  }
+  pending_requests_.erase(handle);
+  return true;
+}
+
+absl::Status LockManager::WaitForRowLocks(LockHandle* handle) {
+  const absl::Time wait_start = absl::Now();
+  absl::Time deadline = wait_start + kMaxRowLockWaitTime;
+  std::optional<LockRequest> blocked_request;
+  while (!handle->IsAborted() && !TryGrantPendingRowLocks(handle)) {
+    if (handle->IsAborted()) {
+      break;
+    }
+    if (!blocked_request.has_value()) {
+      blocked_request = pending_requests_.at(handle).front();
+    }
+    if (row_locks_released_cvar_.WaitWithDeadline(&mu_, deadline)) {
+      // Timed out waiting for an older transaction to release its locks.
+      handle->Abort(
+          error::AbortLockWaitTimeout(handle->tid(), kMaxRowLockWaitTime));
+      ++lock_wait_timeouts_;
+      break;
+    }
+  }
+  if (blocked_request.has_value()) {
+    RecordConflict(*blocked_request, absl::Now() - wait_start);
+  }
+  if (handle->IsAborted()) {
+    pending_requests_.erase(handle);
+  }
+  return handle->status();
+}
+
+void LockManager::ReleaseRowLocks(LockHandle* handle) {
+  for (auto& [table_id, locks] : row_locks_) {
+    locks.erase(std::remove_if(locks.begin(), locks.end(),
+                               [handle](const RowLock& row_lock) {
+                                 return row_lock.handle == handle;
+                               }),
+                locks.end());
+  }
+  pending_requests_.erase(handle);
+  optimistic_reads_.erase(handle);
+  optimistic_writes_.erase(handle);
+  if (database_lock_holder_ == handle) {
+    database_lock_holder_ = nullptr;
+  }
+  row_locks_released_cvar_.SignalAll();
+}
+
+void LockManager::RecordOptimisticAccess(LockHandle* handle,
+                                         const LockRequest& request,
+                                         KeyRange key_range) {
+  // Writes are validated as reads too, since inserts, updates and deletes
+  // depend on whether the rows they write exist.
+  if (request.mode() == LockMode::kExclusive) {
+    optimistic_writes_[handle].push_back(
+        OptimisticWrite{request.table_id(), key_range});
+  }
+  optimistic_reads_[handle].push_back(OptimisticRead{
+      request.table_id(), std::move(key_range), last_commit_timestamp_});
+}
+
+bool LockManager::ValidateOptimisticReads(LockHandle* handle) {
+  auto reads_itr = optimistic_reads_.find(handle);
+  if (reads_itr == optimistic_reads_.end()) {
+    return true;
+  }
+  for (const OptimisticRead& read : reads_itr->second) {
+    auto writes_itr = committed_writes_.find(read.table_id);
+    if (writes_itr == committed_writes_.end()) {
+      continue;
+    }
+    for (const CommittedWrite& write : writes_itr->second) {
+      if (write.commit_timestamp <= read.version ||
+          write.tid == handle->tid() ||
+          !Overlaps(write.key_range, read.key_range)) {
+        continue;
+      }
+      handle->Abort(error::AbortOptimisticConflict(handle->tid(), write.tid));
+      ++optimistic_conflict_aborts_;
+      RecordConflict(
+          LockRequest(LockMode::kShared, read.table_id, read.key_range, {}),
+          absl::ZeroDuration());
+      return false;
+    }
+  }
+  return true;
+}
+
+void LockManager::RecordCommittedWrites(LockHandle* handle,
+                                        absl::Time commit_timestamp) {
+  auto writes_itr = optimistic_writes_.find(handle);
+  if (writes_itr == optimistic_writes_.end()) {
+    return;
+  }
+  for (const OptimisticWrite& write : writes_itr->second) {
+    committed_writes_[write.table_id].push_back(
+        CommittedWrite{handle->tid(), write.key_range, commit_timestamp});
+  }
+}
+
+void LockManager::PruneCommittedWrites() {
+  // Reads which start from now on observe every write committed at or before
+  // the last commit timestamp, so only outstanding reads can conflict with
+  // them.
+  absl::Time horizon = last_commit_timestamp_;
+  for (const auto& [handle, reads] : optimistic_reads_) {
+    for (const OptimisticRead& read : reads) {
+      horizon = std::min(horizon, read.version);
+    }
+  }
+  for (auto itr = committed_writes_.begin(); itr != committed_writes_.end();) {
+    std::vector<CommittedWrite>& writes = itr->second;
+    writes.erase(std::remove_if(writes.begin(), writes.end(),
+                                [horizon](const CommittedWrite& write) {
+                                  return write.commit_timestamp <= horizon;
+                                }),
+                 writes.end());
+    if (writes.empty()) {
+      committed_writes_.erase(itr++);
+    } else {
+      ++itr;
+    }
+  }
+}
+
+void LockManager::UnlockAllRowLocks(LockHandle* handle) {
+  ReleaseRowLocks(handle);
+  // A transaction which gives up after reserving a commit timestamp leaves its
+  // commit group without committing.
+  EndRowLockCommit(handle, /*committed=*/false);
+  handle->Reset();
+}
+
+absl::StatusOr<absl::Time> LockManager::ReserveRowLockCommitTimestamp(
+    LockHandle* handle) {
+  auto committing_itr = committing_handles_.find(handle);
+  if (committing_itr == committing_handles_.end() && !handle->IsAborted()) {
+    if (committing_handles_.empty() &&
+        metadata_change_tid_ == kInvalidTransactionID) {
+      // No commit is in progress, so the transaction starts a group of its
+      // own.
+      if (!ValidateOptimisticReads(handle)) {
+        return handle->status();
+      }
+      committing_itr =
+          committing_handles_.emplace(handle, ReservePendingCommitTimestamp())
+              .first;
+      RecordCommittedWrites(handle, committing_itr->second);
+    } else {
+      // Wait for the next group, which is admitted once the current one or
+      // the metadata change in progress completes (see AdmitQueuedCommits).
+      queued_commits_.push_back(handle);
+      while (!committing_handles_.contains(handle) && !handle->IsAborted()) {
+        pending_commit_cvar_.Wait(&mu_);
+      }
+      queued_commits_.erase(
+          std::remove(queued_commits_.begin(), queued_commits_.end(), handle),
+          queued_commits_.end());
+      committing_itr = committing_handles_.find(handle);
+    }
+  }
+
+  // A transaction which was wounded cannot commit.
+  if (committing_itr == committing_handles_.end()) {
+    return handle->status();
+  }
+
+  // Transactions without locks cannot commit during a schema change.
+  if (database_lock_holder_ != nullptr && database_lock_holder_ != handle) {
+    EndRowLockCommit(handle, /*committed=*/false);
+    return error::AbortConcurrentTransaction(handle->tid(),
+                                             database_lock_holder_->tid());
+  }
+  return committing_itr->second;
+}
+
+void LockManager::EndRowLockCommit(LockHandle* handle, bool committed) {
+  auto committing_itr = committing_handles_.find(handle);
+  if (committing_itr == committing_handles_.end()) {
+    return;
+  }
+  if (committed) {
+    committed_group_timestamp_ =
+        std::max(committed_group_timestamp_, committing_itr->second);
+  }
+  committing_handles_.erase(committing_itr);
+  if (!committing_handles_.empty()) {
+    return;
+  }
+
+  // The group is complete, so its commits become visible to reads.
+  if (committed_group_timestamp_ > last_commit_timestamp_) {
+    last_commit_timestamp_ = committed_group_timestamp_;
+  }
+  committed_group_timestamp_ = absl::InfinitePast();
+  SetPendingCommitTimestamp(absl::InfiniteFuture());
+  PruneCommittedWrites();
+  AdmitQueuedCommits();
+}
+
+void LockManager::AdmitQueuedCommits() {
+  // Commits queued behind a metadata change wait for it to complete.
+  if (metadata_change_tid_ != kInvalidTransactionID) {
+    pending_commit_cvar_.SignalAll();
+    return;
+  }
+
+  // Admit every commit which queued up as the next group. The first member
+  // reserves the earliest timestamp of the group. Members are validated in the
+  // order of their commit timestamps, so that each observes the writes of
+  // those admitted before it.
+  for (LockHandle* queued : queued_commits_) {
+    if (queued->IsAborted() || !ValidateOptimisticReads(queued)) {
+      continue;
+    }
+    const absl::Time commit_timestamp = committing_handles_.empty()
+                                            ? ReservePendingCommitTimestamp()
+                                            : clock_->Now();
+    committing_handles_.emplace(queued, commit_timestamp);
+    RecordCommittedWrites(queued, commit_timestamp);
+  }
+  queued_commits_.clear();
+  pending_commit_cvar_.SignalAll();
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -17,15 +17,22 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_MANAGER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_MANAGER_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/locking/handle.h"
+#include "backend/locking/lock_stats.h"
+#include "backend/locking/request.h"
 #include "common/clock.h"
 
 namespace google {
@@ -40,12 +47,63 @@ namespace backend {
 // happens via the LockHandle. See LockHandle methods for more details about
 // this interaction.
 //
-// We currently only implement a whole-database lock. The interface is generic
+// By default we only implement a whole-database lock. The interface is generic
 // to avoid irreversibly baking the single-lock assumption into the rest of the
 // system.
+//
+// With LockGranularity::kRow, the lock manager instead grants shared and
+// exclusive locks on key ranges of individual tables, so transactions which
+// touch disjoint rows can make progress concurrently. Conflicts are resolved
+// with wound-wait: an older (higher priority) transaction aborts a younger lock
+// holder, while a younger transaction waits for an older holder to release its
+// locks.
+//
+// Commits in LockGranularity::kRow mode are group committed. Transactions which
+// reserve a commit timestamp while a commit group is in progress wait for it to
+// complete, and are then admitted together as the next group, each with its own
+// increasing commit timestamp. Members of a group hold all their locks, so they
+// do not conflict and flush their writes concurrently. Reads at or after the
+// earliest timestamp of a group wait for the whole group to complete.
+//
+// Reads which are not in the future and precede any in-progress commit, such as
+// strong reads while no commit is pending, check that without acquiring the
+// lock manager mutex.
+//
+// The lock manager records when each transaction holding locks last made a
+// request, so that transactions abandoned by their clients can be aborted with
+// AbortIdleTransactions() instead of blocking other writers indefinitely.
+//
+// With LockGranularity::kOptimistic, transactions do not acquire locks on the
+// rows they access. Instead, the lock manager records the key ranges each
+// transaction reads and writes, along with the last commit timestamp at the
+// time of the request. When a transaction reserves its commit timestamp, its
+// reads are validated against the writes of transactions which committed
+// since, and it is aborted only if one of them overlaps. Commits are group
+// committed as in LockGranularity::kRow mode, and validation happens in the
+// order commit timestamps are assigned.
+//
+// To find the transactions which serialize a workload, lock conflicts are
+// aggregated per contended key in lock_stats(), and GetContentionStats()
+// reports the number of waiting and aborted transactions and the longest
+// running lock holder.
 class LockManager {
  public:
-  explicit LockManager(Clock* clock) : clock_(clock) {}
+  // Granularity at which locks are handed out.
+  enum class LockGranularity {
+    // Only a single read-write transaction may hold locks at any time.
+    kDatabase,
+
+    // Locks are held on key ranges of individual tables.
+    kRow,
+
+    // No locks are held on key ranges. Accessed key ranges are validated at
+    // commit time instead.
+    kOptimistic,
+  };
+
+  explicit LockManager(Clock* clock,
+                       LockGranularity granularity = LockGranularity::kDatabase)
+      : clock_(clock), granularity_(granularity) {}
 
   // Returns a handle for a single transaction with the given id and priority.
   // Subsequent communication between the transaction and the lock manager
@@ -56,6 +114,52 @@ class LockManager {
   // Returns the timestamp at which last schema update or commit completed.
   absl::Time LastCommitTimestamp();
 
+  // Reserves a commit timestamp for the schema change of transaction tid which
+  // leaves the data of the database untouched, such as creating a view. Unlike
+  // other schema changes it holds no database-wide lock, so transactions which
+  // hold locks are neither waited for nor aborted. Only a commit in progress
+  // and other metadata changes are waited for, and returns an ABORTED error if
+  // another schema change holds the database lock. Until EndMetadataChange()
+  // is called, database-wide lock requests are denied, and commits and reads
+  // at or after the returned timestamp wait.
+  absl::StatusOr<absl::Time> BeginMetadataChange(TransactionID tid)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Completes the schema change started by BeginMetadataChange(), whether or
+  // not it was applied, and lets the commits waiting for it proceed.
+  void EndMetadataChange() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Aborts the transactions which have acquired locks and not made any request
+  // for at least idle_timeout, and releases their locks. Transactions which are
+  // committing or waiting for locks are never aborted. The aborted transactions
+  // observe the abort from their next request. Returns the number of
+  // transactions aborted.
+  int64_t AbortIdleTransactions(absl::Duration idle_timeout)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // A summary of the lock contention since the lock manager was created.
+  struct ContentionStats {
+    // Transactions currently waiting for conflicting locks to be released.
+    int64_t waiting_transactions = 0;
+
+    // Transactions aborted, by reason.
+    int64_t concurrent_transaction_aborts = 0;
+    int64_t wounded_transactions = 0;
+    int64_t lock_wait_timeouts = 0;
+    int64_t idle_transaction_aborts = 0;
+    int64_t optimistic_conflict_aborts = 0;
+
+    // The transaction which has been holding locks for the longest time, or
+    // kInvalidTransactionID if no transaction holds locks.
+    TransactionID longest_holder_id = kInvalidTransactionID;
+    absl::Duration longest_hold_duration;
+  };
+  ContentionStats GetContentionStats() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the lock conflicts of this lock manager, aggregated per contended
+  // key.
+  const LockStatsAggregator* lock_stats() const { return &lock_stats_; }
+
  private:
   // LockHandle simply forwards requests to the LockManager.
   friend class LockHandle;
@@ -66,6 +170,103 @@ class LockManager {
       ABSL_LOCKS_EXCLUDED(mu_);
   absl::Status MarkCommitted(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
   void WaitForSafeRead(absl::Time read_time) ABSL_LOCKS_EXCLUDED(mu_);
+  absl::Status Wait(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
+  bool IsBlocked(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
+  void ForgetHandle(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Records that handle made a request to the lock manager.
+  void RecordActivity(LockHandle* handle) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Stops recording the activity of handle, and records how long it held its
+  // locks.
+  void EndActivity(LockHandle* handle) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records that request conflicted with locks held by another transaction,
+  // after waiting for them for the given time.
+  void RecordConflict(const LockRequest& request, absl::Duration wait)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if handle has reserved a commit timestamp and not yet
+  // committed or given up.
+  bool IsCommitting(LockHandle* handle) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // A lock granted to a transaction in LockGranularity::kRow mode.
+  struct RowLock {
+    LockHandle* handle;
+    LockMode mode;
+
+    // Locked key range in ClosedOpen form.
+    KeyRange key_range;
+  };
+
+  // Returns true if commits are group committed and database-wide locks are
+  // tracked separately from key range accesses, that is, in
+  // LockGranularity::kRow and LockGranularity::kOptimistic modes.
+  bool UsesGroupCommit() const {
+    return granularity_ != LockGranularity::kDatabase;
+  }
+
+  // Implementations of the methods above for LockGranularity::kRow and
+  // LockGranularity::kOptimistic.
+  void EnqueueRowLock(LockHandle* handle, const LockRequest& request)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void UnlockAllRowLocks(LockHandle* handle) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  absl::StatusOr<absl::Time> ReserveRowLockCommitTimestamp(LockHandle* handle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  absl::Status WaitForRowLocks(LockHandle* handle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Sets pending_commit_timestamp_ and publishes it to readers which do not
+  // acquire mu_.
+  void SetPendingCommitTimestamp(absl::Time timestamp)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Dispenses a commit timestamp from the clock and sets it as the pending
+  // commit timestamp.
+  absl::Time ReservePendingCommitTimestamp() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Admits the commits which queued up behind the current commit group, or
+  // behind a metadata change, as the next commit group.
+  void AdmitQueuedCommits() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Removes handle from the current commit group, if it is a member. Once the
+  // group has no members left, publishes the commits of the group and admits
+  // the queued commits as the next group.
+  void EndRowLockCommit(LockHandle* handle, bool committed)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Attempts to grant all locks queued by handle, wounding younger conflicting
+  // holders along the way. Returns true if all queued locks were granted.
+  // Aborts handle if the request can never be granted.
+  bool TryGrantPendingRowLocks(LockHandle* handle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Attempts to grant a single lock request to handle.
+  bool TryGrantRowLock(LockHandle* handle, const LockRequest& request)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Releases all locks held or requested by handle.
+  void ReleaseRowLocks(LockHandle* handle) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records a request of handle in LockGranularity::kOptimistic mode.
+  void RecordOptimisticAccess(LockHandle* handle, const LockRequest& request,
+                              KeyRange key_range)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Validates the key ranges read by handle in LockGranularity::kOptimistic
+  // mode against the writes committed since they were read. Returns true if
+  // none overlap, otherwise aborts handle and returns false.
+  bool ValidateOptimisticReads(LockHandle* handle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records the key ranges written by handle as committed at
+  // commit_timestamp, for the validation of later commits.
+  void RecordCommittedWrites(LockHandle* handle, absl::Time commit_timestamp)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Drops the committed writes which no outstanding or future read can
+  // conflict with.
+  void PruneCommittedWrites() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   // Mutex to guard state below.
   absl::Mutex mu_;
@@ -76,15 +277,122 @@ class LockManager {
   // System wide monotonic clock used to provide commit and read timestamps.
   Clock* clock_;
 
+  // Granularity at which locks are handed out.
+  const LockGranularity granularity_;
+
+  // Locks currently granted in LockGranularity::kRow mode, by table.
+  absl::flat_hash_map<TableID, std::vector<RowLock>> row_locks_
+      ABSL_GUARDED_BY(mu_);
+
+  // Lock requests which could not be granted yet, by requesting handle.
+  absl::flat_hash_map<LockHandle*, std::vector<LockRequest>> pending_requests_
+      ABSL_GUARDED_BY(mu_);
+
+  // A key range read by a transaction in LockGranularity::kOptimistic mode.
+  struct OptimisticRead {
+    TableID table_id;
+
+    // Read key range in ClosedOpen form.
+    KeyRange key_range;
+
+    // The last commit timestamp when the range was read. Writes committed
+    // after it may not have been observed by the read.
+    absl::Time version;
+  };
+
+  // A key range written by a transaction in LockGranularity::kOptimistic mode.
+  struct OptimisticWrite {
+    TableID table_id;
+
+    // Written key range in ClosedOpen form.
+    KeyRange key_range;
+  };
+
+  // A write of a transaction which reserved a commit timestamp in
+  // LockGranularity::kOptimistic mode.
+  struct CommittedWrite {
+    TransactionID tid;
+
+    // Written key range in ClosedOpen form.
+    KeyRange key_range;
+    absl::Time commit_timestamp;
+  };
+
+  // The key ranges accessed by each transaction in LockGranularity::kOptimistic
+  // mode, until it unlocks all its locks.
+  absl::flat_hash_map<LockHandle*, std::vector<OptimisticRead>>
+      optimistic_reads_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<LockHandle*, std::vector<OptimisticWrite>>
+      optimistic_writes_ ABSL_GUARDED_BY(mu_);
+
+  // The writes of transactions which reserved a commit timestamp after the
+  // earliest outstanding read, by table.
+  absl::flat_hash_map<TableID, std::vector<CommittedWrite>> committed_writes_
+      ABSL_GUARDED_BY(mu_);
+
+  // The handle holding a database-wide lock (used by schema changes).
+  LockHandle* database_lock_holder_ ABSL_GUARDED_BY(mu_) = nullptr;
+
+  // The transaction of the metadata change in progress, if any (see
+  // BeginMetadataChange).
+  TransactionID metadata_change_tid_ ABSL_GUARDED_BY(mu_) =
+      kInvalidTransactionID;
+
+  // The handles which have reserved a commit timestamp and not yet committed
+  // in LockGranularity::kRow mode, with their commit timestamps. They form the
+  // current commit group.
+  absl::flat_hash_map<LockHandle*, absl::Time> committing_handles_
+      ABSL_GUARDED_BY(mu_);
+
+  // Handles waiting for the current commit group to complete before they
+  // reserve a commit timestamp, in LockGranularity::kRow mode.
+  std::vector<LockHandle*> queued_commits_ ABSL_GUARDED_BY(mu_);
+
+  // The latest timestamp committed by a member of the current commit group.
+  absl::Time committed_group_timestamp_ ABSL_GUARDED_BY(mu_) =
+      absl::InfinitePast();
+
+  // Signals release of row locks.
+  absl::CondVar row_locks_released_cvar_ ABSL_GUARDED_BY(mu_);
+
   // Timestamp at which last schema update or commit completed.
   absl::Time last_commit_timestamp_ ABSL_GUARDED_BY(mu_) = absl::InfinitePast();
 
-  // Commit timestamp being used by an in-progress commit.
+  // Commit timestamp being used by an in-progress commit, or the earliest
+  // commit timestamp of the current commit group.
   absl::Time pending_commit_timestamp_ ABSL_GUARDED_BY(mu_) =
       absl::InfiniteFuture();
 
+  // pending_commit_timestamp_ in unix micros, which reads check without
+  // acquiring mu_. Commits lower it to the infinite past while they reserve a
+  // timestamp.
+  std::atomic<int64_t> pending_commit_micros_{
+      absl::ToUnixMicros(absl::InfiniteFuture())};
+
   // Signals completion of pending commit.
   absl::CondVar pending_commit_cvar_ ABSL_GUARDED_BY(mu_);
+
+  // The requests made by a handle since it first requested locks.
+  struct HandleActivity {
+    absl::Time first_request;
+    absl::Time last_request;
+  };
+
+  // The activity of each handle. Handles are removed once they unlock all
+  // their locks.
+  absl::flat_hash_map<LockHandle*, HandleActivity> activity_
+      ABSL_GUARDED_BY(mu_);
+
+  // Transactions aborted since the lock manager was created, by reason. See
+  // ContentionStats.
+  int64_t concurrent_transaction_aborts_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t wounded_transactions_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t lock_wait_timeouts_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t idle_transaction_aborts_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t optimistic_conflict_aborts_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // Lock conflicts aggregated per contended key.
+  LockStatsAggregator lock_stats_;
 };
 
 }  // namespace backend
@@ -16,17 +16,26 @@
 
 #include "backend/locking/manager.h"
 
+#include <algorithm>
 #include <atomic>
 #include <map>
 #include <memory>
 #include <thread>  // NOLINT
 #include <vector>
 
+#include "zetasql/public/value.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/locking/lock_stats.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
@@ -80,6 +89,33 @@ TEST_F(LockManagerTest, ConcurrentTransactionIsAborted) {
   EXPECT_TRUE(lh2->IsAborted());
 }
 
+TEST_F(LockManagerTest, MetadataChangeCommitsWithoutTheLock) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(1));
+  lh1->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(lh1->Wait());
+
+  // The metadata change does not wait for the lock holder, but denies schema
+  // changes until it completes.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(absl::Time change_timestamp,
+                       manager()->BeginMetadataChange(TransactionID(3)));
+  lh2->EnqueueLock(LockRequest(LockMode::kExclusive, /*table_id=*/"",
+                               KeyRange::All(), /*column_ids=*/{}));
+  EXPECT_THAT(lh2->Wait(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+  manager()->EndMetadataChange();
+  EXPECT_EQ(manager()->LastCommitTimestamp(), change_timestamp);
+
+  // The lock holder commits after the metadata change.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(absl::Time commit_timestamp,
+                       lh1->ReserveCommitTimestamp());
+  EXPECT_GT(commit_timestamp, change_timestamp);
+  ZETASQL_EXPECT_OK(lh1->MarkCommitted());
+  lh1->UnlockAll();
+}
+
 TEST_F(LockManagerTest, SequentialTransactionAcquiresLock) {
   std::unique_ptr<LockHandle> lh1 =
       manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
@@ -121,6 +157,70 @@ TEST_F(LockManagerTest, TransactionsThatDidNotAcquireLockCanReleaseIt) {
   ZETASQL_EXPECT_OK(lh2->Wait());
 }
 
+TEST_F(LockManagerTest, IdleTransactionIsAbortedAndReleasesLock) {
+  std::unique_ptr<LockHandle> idle =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(1));
+
+  idle->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(idle->Wait());
+
+  // A transaction which was active recently is not aborted.
+  EXPECT_EQ(manager()->AbortIdleTransactions(absl::Hours(1)), 0);
+  EXPECT_FALSE(idle->IsAborted());
+
+  EXPECT_EQ(manager()->AbortIdleTransactions(absl::ZeroDuration()), 1);
+  EXPECT_TRUE(idle->IsAborted());
+  EXPECT_THAT(idle->ReserveCommitTimestamp(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+
+  // The lock of the idle transaction was released.
+  lh2->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(lh2->Wait());
+  ZETASQL_EXPECT_OK(lh2->ReserveCommitTimestamp());
+
+  // A committing transaction is never considered idle.
+  EXPECT_EQ(manager()->AbortIdleTransactions(absl::ZeroDuration()), 0);
+  ZETASQL_EXPECT_OK(lh2->MarkCommitted());
+  lh2->UnlockAll();
+
+  // The aborted transaction can retry with the same handle.
+  idle->UnlockAll();
+  idle->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(idle->Wait());
+}
+
+TEST_F(LockManagerTest, ReportsConcurrentTransactionConflicts) {
+  std::unique_ptr<LockHandle> holder =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(1));
+
+  holder->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(holder->Wait());
+  lh2->EnqueueLock(request());
+  EXPECT_TRUE(lh2->IsAborted());
+
+  LockManager::ContentionStats stats = manager()->GetContentionStats();
+  EXPECT_EQ(stats.waiting_transactions, 0);
+  EXPECT_EQ(stats.concurrent_transaction_aborts, 1);
+  EXPECT_EQ(stats.longest_holder_id, TransactionID(1));
+
+  // The denied request is reported without any lock wait.
+  std::vector<LockStatsRow> rows =
+      manager()->lock_stats()->GetStats(LockStatsInterval::kMinute,
+                                        absl::Now());
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].table_id, "table");
+  EXPECT_EQ(rows[0].conflict_count, 1);
+  EXPECT_DOUBLE_EQ(rows[0].lock_wait_seconds, 0);
+
+  holder->UnlockAll();
+  EXPECT_EQ(manager()->GetContentionStats().longest_holder_id,
+            kInvalidTransactionID);
+}
+
 TEST_F(LockManagerTest, EnsuresSerializationWithParallelTransactions) {
   // Simulate a thread-safe mvcc store with a single key. Even though multiple
   // threads access this store, they are synchronized by the lock manager.
@@ -179,6 +279,347 @@ TEST_F(LockManagerTest, EnsuresSerializationWithParallelTransactions) {
   EXPECT_EQ(n * k, GetValue(absl::InfiniteFuture()));
 }
 
+class RowLockManagerTest : public testing::Test {
+ public:
+  LockManager* manager() { return &manager_; }
+
+  LockRequest RowRequest(LockMode mode, int64_t key) {
+    return LockRequest(
+        mode, "table",
+        KeyRange::Point(Key({zetasql::values::Int64(key)})), {});
+  }
+
+ private:
+  Clock clock_;
+  LockManager manager_ =
+      LockManager(&clock_, LockManager::LockGranularity::kRow);
+};
+
+TEST_F(RowLockManagerTest, NonConflictingTransactionsAcquireLocks) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  // Exclusive locks on different rows do not conflict.
+  lh1->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  lh2->EnqueueLock(RowRequest(LockMode::kExclusive, 2));
+  ZETASQL_EXPECT_OK(lh1->Wait());
+  ZETASQL_EXPECT_OK(lh2->Wait());
+
+  // Shared locks on the same row do not conflict.
+  lh1->EnqueueLock(RowRequest(LockMode::kShared, 3));
+  lh2->EnqueueLock(RowRequest(LockMode::kShared, 3));
+  ZETASQL_EXPECT_OK(lh1->Wait());
+  ZETASQL_EXPECT_OK(lh2->Wait());
+}
+
+TEST_F(RowLockManagerTest, OlderTransactionWoundsYoungerHolder) {
+  std::unique_ptr<LockHandle> older =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> younger =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  younger->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_EXPECT_OK(younger->Wait());
+
+  older->EnqueueLock(RowRequest(LockMode::kShared, 1));
+  ZETASQL_EXPECT_OK(older->Wait());
+  EXPECT_TRUE(younger->IsAborted());
+  EXPECT_THAT(younger->ReserveCommitTimestamp(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+}
+
+TEST_F(RowLockManagerTest, YoungerTransactionWaitsForOlderHolder) {
+  std::unique_ptr<LockHandle> older =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> younger =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  older->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_EXPECT_OK(older->Wait());
+
+  younger->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  EXPECT_TRUE(younger->IsBlocked());
+
+  std::thread unlocker([&older]() {
+    absl::SleepFor(absl::Milliseconds(10));
+    older->UnlockAll();
+  });
+  ZETASQL_EXPECT_OK(younger->Wait());
+  EXPECT_FALSE(younger->IsBlocked());
+  unlocker.join();
+}
+
+TEST_F(RowLockManagerTest, IdleTransactionIsAbortedAndReleasesLocks) {
+  std::unique_ptr<LockHandle> idle =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> younger =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  idle->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_EXPECT_OK(idle->Wait());
+  younger->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  EXPECT_TRUE(younger->IsBlocked());
+
+  // Only the holder is idle, the younger transaction is waiting for it.
+  EXPECT_EQ(manager()->AbortIdleTransactions(absl::ZeroDuration()), 1);
+  EXPECT_TRUE(idle->IsAborted());
+  EXPECT_FALSE(younger->IsAborted());
+  ZETASQL_EXPECT_OK(younger->Wait());
+  EXPECT_THAT(idle->ReserveCommitTimestamp(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+}
+
+TEST_F(RowLockManagerTest, ReportsLockWaits) {
+  std::unique_ptr<LockHandle> older =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> younger =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  older->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_EXPECT_OK(older->Wait());
+  younger->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  EXPECT_EQ(manager()->GetContentionStats().waiting_transactions, 1);
+
+  std::thread unlocker([&older]() {
+    absl::SleepFor(absl::Milliseconds(10));
+    older->UnlockAll();
+  });
+  ZETASQL_EXPECT_OK(younger->Wait());
+  unlocker.join();
+
+  EXPECT_EQ(manager()->GetContentionStats().waiting_transactions, 0);
+  std::vector<LockStatsRow> rows =
+      manager()->lock_stats()->GetStats(LockStatsInterval::kMinute,
+                                        absl::Now());
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].row_range_start_key, Key({zetasql::values::Int64(1)}));
+  EXPECT_GT(rows[0].lock_wait_seconds, 0);
+}
+
+TEST_F(RowLockManagerTest, DatabaseLockFailsWithConcurrentTransaction) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> schema_change =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(1));
+
+  lh1->EnqueueLock(RowRequest(LockMode::kShared, 1));
+  ZETASQL_EXPECT_OK(lh1->Wait());
+
+  schema_change->EnqueueLock(
+      LockRequest(LockMode::kExclusive, "", KeyRange::All(), {}));
+  EXPECT_THAT(schema_change->Wait(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+
+  // Once the transaction is done, the schema change can proceed and blocks
+  // other transactions.
+  lh1->UnlockAll();
+  schema_change->UnlockAll();
+  schema_change->EnqueueLock(
+      LockRequest(LockMode::kExclusive, "", KeyRange::All(), {}));
+  ZETASQL_EXPECT_OK(schema_change->Wait());
+  lh1->EnqueueLock(RowRequest(LockMode::kShared, 1));
+  EXPECT_THAT(lh1->Wait(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+}
+
+TEST_F(RowLockManagerTest, CommitsAreSerialized) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(absl::Time ts1, lh1->ReserveCommitTimestamp());
+  absl::Time ts2;
+  std::thread committer([&lh2, &ts2]() {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(ts2, lh2->ReserveCommitTimestamp());
+    ZETASQL_EXPECT_OK(lh2->MarkCommitted());
+  });
+  absl::SleepFor(absl::Milliseconds(10));
+  ZETASQL_EXPECT_OK(lh1->MarkCommitted());
+  committer.join();
+  EXPECT_LT(ts1, ts2);
+  EXPECT_EQ(manager()->LastCommitTimestamp(), ts2);
+}
+
+TEST_F(RowLockManagerTest, SafeReadOnlyWaitsForEarlierPendingCommit) {
+  std::unique_ptr<LockHandle> committer =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> reader =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(absl::Time ts, committer->ReserveCommitTimestamp());
+
+  // Reads at or before the pending commit are safe.
+  reader->WaitForSafeRead(ts - absl::Seconds(1));
+  reader->WaitForSafeRead(ts);
+
+  // Reads after it wait for the commit to complete.
+  absl::Notification read;
+  std::thread read_after_commit([&]() {
+    reader->WaitForSafeRead(ts + absl::Microseconds(1));
+    read.Notify();
+  });
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_FALSE(read.HasBeenNotified());
+  ZETASQL_EXPECT_OK(committer->MarkCommitted());
+  read.WaitForNotification();
+  read_after_commit.join();
+}
+
+TEST_F(RowLockManagerTest, QueuedCommitsAreAdmittedAsOneGroup) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+  std::unique_ptr<LockHandle> lh3 =
+      manager()->CreateHandle(TransactionID(3), TransactionPriority(3));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(absl::Time ts1, lh1->ReserveCommitTimestamp());
+  absl::Time ts2;
+  absl::Time ts3;
+  absl::Notification reserved2;
+  absl::Notification reserved3;
+  std::thread committer2([&]() {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(ts2, lh2->ReserveCommitTimestamp());
+    reserved2.Notify();
+  });
+  std::thread committer3([&]() {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(ts3, lh3->ReserveCommitTimestamp());
+    reserved3.Notify();
+  });
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_FALSE(reserved2.HasBeenNotified());
+  EXPECT_FALSE(reserved3.HasBeenNotified());
+
+  // Both queued commits are admitted once the in-flight commit completes, and
+  // neither has to wait for the other.
+  ZETASQL_EXPECT_OK(lh1->MarkCommitted());
+  reserved2.WaitForNotification();
+  reserved3.WaitForNotification();
+  committer2.join();
+  committer3.join();
+  EXPECT_LT(ts1, std::min(ts2, ts3));
+  EXPECT_NE(ts2, ts3);
+
+  // The group only becomes visible once all of its members have committed.
+  ZETASQL_EXPECT_OK(lh2->MarkCommitted());
+  EXPECT_EQ(manager()->LastCommitTimestamp(), ts1);
+  ZETASQL_EXPECT_OK(lh3->MarkCommitted());
+  EXPECT_EQ(manager()->LastCommitTimestamp(), std::max(ts2, ts3));
+}
+
+class OptimisticLockManagerTest : public testing::Test {
+ public:
+  LockManager* manager() { return &manager_; }
+
+  LockRequest RowRequest(LockMode mode, int64_t key) {
+    return LockRequest(
+        mode, "table",
+        KeyRange::Point(Key({zetasql::values::Int64(key)})), {});
+  }
+
+  // Reserves a commit timestamp for handle and commits it.
+  absl::Status Commit(LockHandle* handle) {
+    ZETASQL_RETURN_IF_ERROR(handle->ReserveCommitTimestamp().status());
+    ZETASQL_RETURN_IF_ERROR(handle->MarkCommitted());
+    handle->UnlockAll();
+    return absl::OkStatus();
+  }
+
+ private:
+  Clock clock_;
+  LockManager manager_ =
+      LockManager(&clock_, LockManager::LockGranularity::kOptimistic);
+};
+
+TEST_F(OptimisticLockManagerTest, ConflictingAccessesDoNotBlock) {
+  std::unique_ptr<LockHandle> older =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> younger =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+
+  younger->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_EXPECT_OK(younger->Wait());
+  older->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_EXPECT_OK(older->Wait());
+  EXPECT_FALSE(older->IsBlocked());
+  EXPECT_FALSE(younger->IsAborted());
+}
+
+TEST_F(OptimisticLockManagerTest, ReaderIsAbortedByLaterCommittedWrite) {
+  std::unique_ptr<LockHandle> reader =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> writer =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+  std::unique_ptr<LockHandle> other_writer =
+      manager()->CreateHandle(TransactionID(3), TransactionPriority(3));
+
+  reader->EnqueueLock(RowRequest(LockMode::kShared, 1));
+  ZETASQL_EXPECT_OK(reader->Wait());
+  writer->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_EXPECT_OK(writer->Wait());
+  other_writer->EnqueueLock(RowRequest(LockMode::kExclusive, 2));
+  ZETASQL_EXPECT_OK(other_writer->Wait());
+
+  // Writes to rows which were not read do not conflict, and the first of the
+  // conflicting transactions to commit wins.
+  ZETASQL_EXPECT_OK(Commit(other_writer.get()));
+  ZETASQL_EXPECT_OK(Commit(writer.get()));
+  EXPECT_THAT(reader->ReserveCommitTimestamp(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+  EXPECT_EQ(manager()->GetContentionStats().optimistic_conflict_aborts, 1);
+  reader->UnlockAll();
+
+  // Reads made after the write committed observed it.
+  reader->EnqueueLock(RowRequest(LockMode::kShared, 1));
+  ZETASQL_EXPECT_OK(reader->Wait());
+  ZETASQL_EXPECT_OK(Commit(reader.get()));
+}
+
+TEST_F(OptimisticLockManagerTest, QueuedCommitsAreValidatedInOrder) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(2));
+  std::unique_ptr<LockHandle> lh3 =
+      manager()->CreateHandle(TransactionID(3), TransactionPriority(3));
+
+  // Both queued transactions write the same row.
+  lh2->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  lh3->EnqueueLock(RowRequest(LockMode::kExclusive, 1));
+  ZETASQL_ASSERT_OK(lh1->ReserveCommitTimestamp().status());
+  absl::Status status2;
+  absl::Status status3;
+  std::thread committer2(
+      [&]() { status2 = lh2->ReserveCommitTimestamp().status(); });
+  std::thread committer3(
+      [&]() { status3 = lh3->ReserveCommitTimestamp().status(); });
+  absl::SleepFor(absl::Milliseconds(10));
+  ZETASQL_EXPECT_OK(lh1->MarkCommitted());
+  committer2.join();
+  committer3.join();
+
+  // Only the transaction admitted first to the group commits.
+  EXPECT_NE(status2.ok(), status3.ok());
+  EXPECT_EQ(manager()->GetContentionStats().optimistic_conflict_aborts, 1);
+}
+
+TEST_F(OptimisticLockManagerTest, DatabaseLockFailsWithConcurrentTransaction) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1), TransactionPriority(1));
+  std::unique_ptr<LockHandle> schema_change =
+      manager()->CreateHandle(TransactionID(2), TransactionPriority(1));
+
+  lh1->EnqueueLock(RowRequest(LockMode::kShared, 1));
+  ZETASQL_EXPECT_OK(lh1->Wait());
+  schema_change->EnqueueLock(
+      LockRequest(LockMode::kExclusive, "", KeyRange::All(), {}));
+  EXPECT_THAT(schema_change->Wait(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+}
+
 }  // namespace
 
 }  // namespace backend
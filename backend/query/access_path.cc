@@ -0,0 +1,266 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/access_path.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "absl/types/span.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/column_filters.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Costs are estimated from the shape of the key set, and from the statistics of
+// the table or index if it has any. The cost of a read is the estimated number
+// of rows it returns when there are statistics. Otherwise, the constants below
+// are used instead, and are only meaningful relative to each other.
+
+// The estimated cost of reading every row of a table or index.
+constexpr double kFullScanCost = 1e6;
+
+// The estimated cost of reading a single row by its key.
+constexpr double kPointReadCost = 1;
+
+// The estimated fraction of rows which remain when one more key column is
+// restricted to a single value.
+constexpr double kEqualitySelectivity = 0.1;
+
+// The estimated fraction of rows which remain when the next key column is
+// restricted to a range.
+constexpr double kRangeSelectivity = 0.3;
+
+// The factor by which a lookup in the table for every index row increases the
+// cost of reading an index.
+constexpr double kBackJoinCostFactor = 2;
+
+// Returns the number of leading columns whose values agree in start and limit.
+int CommonPrefixLength(const Key& start, const Key& limit) {
+  const int n = std::min(start.NumColumns(), limit.NumColumns());
+  int i = 0;
+  while (i < n && start.ColumnValue(i).Equals(limit.ColumnValue(i))) {
+    ++i;
+  }
+  return i;
+}
+
+// Estimates the cost of reading key sets from a table or index data table, in
+// which a key prefix of unique_prefix_length columns identifies at most one
+// row.
+class ReadCostModel {
+ public:
+  ReadCostModel(const Table* data_table, int unique_prefix_length,
+                const DatabaseStatistics* statistics)
+      : data_table_(data_table), statistics_(statistics) {
+    std::optional<int64_t> row_count;
+    if (statistics_ != nullptr) {
+      row_count = statistics_->RowCount(data_table_->id());
+    }
+    has_statistics_ = row_count.has_value();
+    const int num_key_columns = data_table_->primary_key().size();
+    prefix_costs_.reserve(num_key_columns + 1);
+    double cost = has_statistics_ ? std::max<double>(kPointReadCost, *row_count)
+                                  : kFullScanCost;
+    for (int i = 0; i <= num_key_columns; ++i) {
+      prefix_costs_.push_back(i >= unique_prefix_length
+                                  ? kPointReadCost
+                                  : std::max(kPointReadCost, cost));
+      if (i < num_key_columns) {
+        cost *= EqualitySelectivity(i);
+      }
+    }
+  }
+
+  double Cost(const KeySet& key_set) const {
+    double cost = 0;
+    for (const Key& key : key_set.keys()) {
+      cost += PrefixCost(key.NumColumns());
+    }
+    for (const KeyRange& range : key_set.ranges()) {
+      const int prefix_length =
+          CommonPrefixLength(range.start_key(), range.limit_key());
+      double range_cost = PrefixCost(prefix_length);
+      if (range.start_key().NumColumns() > prefix_length ||
+          range.limit_key().NumColumns() > prefix_length) {
+        range_cost *= RangeSelectivity(range, prefix_length);
+        range_cost = std::max(kPointReadCost, range_cost);
+      }
+      cost += range_cost;
+    }
+    return cost;
+  }
+
+ private:
+  // Returns the estimated cost of reading the rows with a given value of the
+  // first prefix_length key columns.
+  double PrefixCost(int prefix_length) const {
+    return prefix_costs_[std::min<int>(prefix_length,
+                                       prefix_costs_.size() - 1)];
+  }
+
+  // Returns the estimated fraction of rows which remain when the key column at
+  // position i is restricted to a single value.
+  double EqualitySelectivity(int i) const {
+    if (has_statistics_) {
+      std::optional<double> distinct_values = statistics_->DistinctValues(
+          data_table_->id(), data_table_->primary_key()[i]->column()->id());
+      if (distinct_values.has_value()) {
+        return 1 / std::max(1.0, *distinct_values);
+      }
+    }
+    return kEqualitySelectivity;
+  }
+
+  // Returns the estimated fraction of rows which remain when the key column at
+  // position i is restricted to the values between the start and limit of
+  // range.
+  double RangeSelectivity(const KeyRange& range, int i) const {
+    if (!has_statistics_) {
+      return kRangeSelectivity;
+    }
+    const zetasql::Value* start = range.start_key().NumColumns() > i
+                                      ? &range.start_key().ColumnValue(i)
+                                      : nullptr;
+    const zetasql::Value* limit = range.limit_key().NumColumns() > i
+                                      ? &range.limit_key().ColumnValue(i)
+                                      : nullptr;
+    const KeyColumn* key_column = data_table_->primary_key()[i];
+    if (key_column->is_descending()) {
+      std::swap(start, limit);
+    }
+    return statistics_
+        ->RangeFraction(data_table_->id(), key_column->column()->id(), start,
+                        limit)
+        .value_or(kRangeSelectivity);
+  }
+
+  const Table* data_table_;
+  const DatabaseStatistics* statistics_;
+  bool has_statistics_ = false;
+
+  // The estimated cost of reading the rows with a given value of each prefix
+  // of the key columns, by prefix length.
+  std::vector<double> prefix_costs_;
+};
+
+// Returns the filter for each of key_columns, given the filters for columns.
+// The key columns of an index data table are matched through the indexed
+// table's columns that they are sourced from.
+std::vector<const zetasql::ColumnFilter*> FiltersForKeyColumns(
+    absl::Span<const KeyColumn* const> key_columns,
+    absl::Span<const Column* const> columns,
+    absl::Span<const zetasql::ColumnFilter* const> filters) {
+  std::vector<const zetasql::ColumnFilter*> key_filters;
+  key_filters.reserve(key_columns.size());
+  for (const KeyColumn* key_column : key_columns) {
+    const Column* column = key_column->column();
+    if (column->table()->owner_index() != nullptr &&
+        column->source_column() != nullptr) {
+      column = column->source_column();
+    }
+    auto it = std::find(columns.begin(), columns.end(), column);
+    key_filters.push_back(it == columns.end() ? nullptr
+                                              : filters[it - columns.begin()]);
+  }
+  return key_filters;
+}
+
+// Returns true if the index data table of index stores all of columns.
+bool IsCoveringIndex(const Index* index,
+                     absl::Span<const Column* const> columns) {
+  for (const Column* column : columns) {
+    if (index->index_data_table()->FindColumn(column->Name()) == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+AccessPath ChooseAccessPath(
+    const Table* table, absl::Span<const Column* const> columns,
+    absl::Span<const zetasql::ColumnFilter* const> filters,
+    bool allow_indexes, const DatabaseStatistics* statistics) {
+  AccessPath best;
+  best.key_set = KeySetFromColumnFilters(
+      table->primary_key(),
+      FiltersForKeyColumns(table->primary_key(), columns, filters));
+  best.cost = ReadCostModel(table, table->primary_key().size(), statistics)
+                  .Cost(best.key_set);
+  if (!allow_indexes) {
+    return best;
+  }
+
+  for (const Index* index : table->indexes()) {
+    // Indexes still being backfilled cannot be read from.
+    const Table* data_table = index->index_data_table();
+    if (data_table == nullptr || index->is_write_only()) {
+      continue;
+    }
+    std::vector<const zetasql::ColumnFilter*> key_filters =
+        FiltersForKeyColumns(data_table->primary_key(), columns, filters);
+    if (key_filters.empty() || key_filters.front() == nullptr) {
+      continue;
+    }
+    if (index->is_null_filtered() &&
+        std::any_of(key_filters.begin(),
+                    key_filters.begin() + index->key_columns().size(),
+                    [](const auto* filter) { return filter == nullptr; })) {
+      continue;
+    }
+
+    AccessPath path;
+    path.index = index;
+    path.back_join = !IsCoveringIndex(index, columns);
+    path.key_set =
+        KeySetFromColumnFilters(data_table->primary_key(), key_filters);
+    path.cost = ReadCostModel(data_table,
+                              index->is_unique()
+                                  ? index->key_columns().size()
+                                  : data_table->primary_key().size(),
+                              statistics)
+                    .Cost(path.key_set);
+    if (path.back_join) {
+      path.cost *= kBackJoinCostFactor;
+    }
+    if (path.cost < best.cost) {
+      best = std::move(path);
+    }
+  }
+  return best;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,72 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_ACCESS_PATH_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_ACCESS_PATH_H_
+
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "absl/types/span.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Describes where a table scan reads its rows from.
+struct AccessPath {
+  // The secondary index to read from, or nullptr to read the table itself.
+  const Index* index = nullptr;
+
+  // If true, the index does not store every scanned column. The table keys
+  // read from the index are then used to look up the rows in the table.
+  bool back_join = false;
+
+  // The keys to read, in the key space of the index if one is set and of the
+  // table otherwise.
+  KeySet key_set;
+
+  // The estimated relative cost of reading the rows through this path.
+  double cost = 0;
+};
+
+// Chooses the cheapest way to read the given columns of table.
+//
+// filters[i] is the filter which the ZetaSQL evaluator pushed down for
+// columns[i], or nullptr if there is none. A secondary index of table is only
+// chosen if the filters restrict a prefix of its key to fewer rows than the
+// filters on the primary key of table do. Indexes which store all of the
+// columns are preferred over those which need a lookup in the table for every
+// row. NULL_FILTERED indexes are only used if every index key column is
+// filtered, since the filters then already exclude the rows which are missing
+// from the index. If allow_indexes is false, the table itself is always read.
+// If statistics is not null, the numbers of rows read are estimated from the
+// statistics of the table and its indexes, where they have any.
+AccessPath ChooseAccessPath(
+    const Table* table, absl::Span<const Column* const> columns,
+    absl::Span<const zetasql::ColumnFilter* const> filters,
+    bool allow_indexes, const DatabaseStatistics* statistics = nullptr);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_ACCESS_PATH_H_
@@ -0,0 +1,187 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/access_path.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "tests/common/schema_constructor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+class AccessPathTest : public testing::Test {
+ public:
+  void SetUp() override {
+    schema_ = test::CreateSchemaFromDDL(
+                  {
+                      R"(
+                        CREATE TABLE T (
+                          k INT64 NOT NULL,
+                          a INT64,
+                          b STRING(MAX),
+                          c STRING(MAX)
+                        ) PRIMARY KEY (k)
+                      )",
+                      "CREATE INDEX TByA ON T(a) STORING (b)",
+                      "CREATE NULL_FILTERED INDEX TByCB ON T(c, b)",
+                  },
+                  &type_factory_)
+                  .value();
+    table_ = schema_->FindTable("T");
+  }
+
+ protected:
+  std::vector<const Column*> Columns(std::vector<std::string> names) {
+    std::vector<const Column*> columns;
+    for (const std::string& name : names) {
+      columns.push_back(table_->FindColumn(name));
+    }
+    return columns;
+  }
+
+  const Table* table_ = nullptr;
+
+ private:
+  zetasql::TypeFactory type_factory_;
+  std::unique_ptr<const Schema> schema_;
+};
+
+TEST_F(AccessPathTest, ReadsTableWithoutFilters) {
+  AccessPath path = ChooseAccessPath(table_, Columns({"k", "a"}),
+                                     {nullptr, nullptr},
+                                     /*allow_indexes=*/true);
+  EXPECT_EQ(path.index, nullptr);
+  EXPECT_EQ(path.key_set.DebugString(), KeySet::All().DebugString());
+}
+
+TEST_F(AccessPathTest, ReadsTableForPrimaryKeyFilter) {
+  zetasql::ColumnFilter k_filter(std::vector<zetasql::Value>{Int64(1)});
+  zetasql::ColumnFilter a_filter(std::vector<zetasql::Value>{Int64(2)});
+  AccessPath path = ChooseAccessPath(table_, Columns({"k", "a"}),
+                                     {&k_filter, &a_filter},
+                                     /*allow_indexes=*/true);
+  EXPECT_EQ(path.index, nullptr);
+  EXPECT_THAT(path.key_set.keys(), testing::ElementsAre(Key({Int64(1)})));
+}
+
+TEST_F(AccessPathTest, ReadsCoveringIndexForIndexKeyFilter) {
+  zetasql::ColumnFilter a_filter(std::vector<zetasql::Value>{Int64(2)});
+  AccessPath path = ChooseAccessPath(table_, Columns({"k", "a", "b"}),
+                                     {nullptr, &a_filter, nullptr},
+                                     /*allow_indexes=*/true);
+  ASSERT_NE(path.index, nullptr);
+  EXPECT_EQ(path.index->Name(), "TByA");
+  EXPECT_FALSE(path.back_join);
+}
+
+TEST_F(AccessPathTest, BackJoinsIndexWhichDoesNotStoreAllColumns) {
+  zetasql::ColumnFilter a_filter(Int64(2), Int64(5));
+  AccessPath path = ChooseAccessPath(table_, Columns({"a", "c"}),
+                                     {&a_filter, nullptr},
+                                     /*allow_indexes=*/true);
+  ASSERT_NE(path.index, nullptr);
+  EXPECT_EQ(path.index->Name(), "TByA");
+  EXPECT_TRUE(path.back_join);
+}
+
+TEST_F(AccessPathTest, SkipsNullFilteredIndexWithUnfilteredKeyColumns) {
+  zetasql::ColumnFilter c_filter(std::vector<zetasql::Value>{String("x")});
+  AccessPath path = ChooseAccessPath(table_, Columns({"k", "c"}),
+                                     {nullptr, &c_filter},
+                                     /*allow_indexes=*/true);
+  EXPECT_EQ(path.index, nullptr);
+}
+
+TEST_F(AccessPathTest, UsesNullFilteredIndexWithAllKeyColumnsFiltered) {
+  zetasql::ColumnFilter b_filter(std::vector<zetasql::Value>{String("y")});
+  zetasql::ColumnFilter c_filter(std::vector<zetasql::Value>{String("x")});
+  AccessPath path = ChooseAccessPath(table_, Columns({"k", "b", "c"}),
+                                     {nullptr, &b_filter, &c_filter},
+                                     /*allow_indexes=*/true);
+  ASSERT_NE(path.index, nullptr);
+  EXPECT_EQ(path.index->Name(), "TByCB");
+  EXPECT_FALSE(path.back_join);
+}
+
+TEST_F(AccessPathTest, SkipsIndexWhichStatisticsShowIsNotSelective) {
+  zetasql::ColumnFilter a_filter(std::vector<zetasql::Value>{Int64(2)});
+  std::vector<const Column*> columns = Columns({"k", "a", "c"});
+  std::vector<const zetasql::ColumnFilter*> filters = {nullptr, &a_filter,
+                                                         nullptr};
+  AccessPath path = ChooseAccessPath(table_, columns, filters,
+                                     /*allow_indexes=*/true);
+  ASSERT_NE(path.index, nullptr);
+  EXPECT_EQ(path.index->Name(), "TByA");
+
+  // Half of the rows have each value of a, so reading them from the index and
+  // looking them up in the table costs more than reading the table.
+  const Table* index_table = path.index->index_data_table();
+  std::vector<ColumnID> table_column_ids = {table_->FindColumn("k")->id()};
+  std::vector<ColumnID> index_column_ids;
+  for (const KeyColumn* key_column : index_table->primary_key()) {
+    index_column_ids.push_back(key_column->column()->id());
+  }
+  TableStatisticsBuilder table_builder(table_column_ids, 1);
+  TableStatisticsBuilder index_builder(index_column_ids,
+                                       index_table->primary_key().size());
+  for (int i = 0; i < 1000; ++i) {
+    table_builder.AddRow({Int64(i)});
+    index_builder.AddRow({Int64(i % 2), Int64(i)});
+  }
+  DatabaseStatistics statistics;
+  statistics.Set(table_->id(), std::move(table_builder).Build());
+  statistics.Set(index_table->id(), std::move(index_builder).Build());
+  path = ChooseAccessPath(table_, columns, filters, /*allow_indexes=*/true,
+                          &statistics);
+  EXPECT_EQ(path.index, nullptr);
+}
+
+TEST_F(AccessPathTest, ReadsTableWhenIndexesAreNotAllowed) {
+  zetasql::ColumnFilter a_filter(std::vector<zetasql::Value>{Int64(2)});
+  AccessPath path = ChooseAccessPath(table_, Columns({"k", "a", "b"}),
+                                     {nullptr, &a_filter, nullptr},
+                                     /*allow_indexes=*/false);
+  EXPECT_EQ(path.index, nullptr);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
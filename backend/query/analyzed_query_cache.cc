@@ -0,0 +1,77 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/analyzed_query_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "zetasql/base/ret_check.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+absl::Status AnalyzedQuery::ForwardingRowReader::Read(
+    const ReadArg& read_arg, std::unique_ptr<RowCursor>* cursor) {
+  ZETASQL_RET_CHECK_NE(target, nullptr);
+  return target->Read(read_arg, cursor);
+}
+
+absl::Status AnalyzedQuery::ForwardingRowReader::CheckNotCancelled() {
+  if (target == nullptr) {
+    return absl::OkStatus();
+  }
+  return target->CheckNotCancelled();
+}
+
+absl::StatusOr<std::unique_ptr<RowCursor>>
+AnalyzedQuery::ForwardingQueryEvaluator::Evaluate(const std::string& query) {
+  ZETASQL_RET_CHECK_NE(target, nullptr);
+  return target->Evaluate(query);
+}
+
+void AnalyzedQuery::Bind(RowReader* reader,
+                         std::unique_ptr<QueryEvaluator> view_evaluator) {
+  reader_.target = reader;
+  view_evaluator_.target = std::move(view_evaluator);
+}
+
+void AnalyzedQuery::Unbind() {
+  reader_.target = nullptr;
+  view_evaluator_.target.reset();
+}
+
+std::unique_ptr<AnalyzedQuery> AnalyzedQueryCache::Checkout(const Key& key) {
+  return cache_.Take(key);
+}
+
+void AnalyzedQueryCache::Return(const Key& key,
+                                std::unique_ptr<AnalyzedQuery> query) {
+  query->Unbind();
+  cache_.Insert(key, std::move(query));
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,204 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_ANALYZED_QUERY_CACHE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_ANALYZED_QUERY_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/analyzer_output.h"
+#include "zetasql/public/evaluator.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/query/catalog.h"
+#include "backend/query/changed_since_select.h"
+#include "backend/query/dml_key_filter.h"
+#include "backend/query/grouped_aggregate.h"
+#include "backend/query/hash_join.h"
+#include "backend/query/interleaved_join.h"
+#include "backend/query/parallel_aggregate.h"
+#include "backend/query/queryable_view.h"
+#include "backend/query/schema_lru_cache.h"
+#include "backend/query/simple_select.h"
+#include "backend/query/sorted_select.h"
+#include "backend/schema/catalog/schema.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// AnalyzedQuery holds the result of analyzing, validating and (for SELECT
+// queries) preparing a single SQL statement, along with the catalog that the
+// resolved AST refers to.
+//
+// The catalog's tables and views read through a reader and view evaluator
+// which forward to whatever Bind() was last called with. This allows the same
+// analyzed query to be executed against different transactions without being
+// re-analyzed. An AnalyzedQuery must only be used by one execution at a time.
+class AnalyzedQuery {
+ public:
+  AnalyzedQuery() = default;
+
+  // Binds the query to the reader and view evaluator of a single execution.
+  void Bind(RowReader* reader, std::unique_ptr<QueryEvaluator> view_evaluator);
+
+  // Releases the reader and view evaluator of the last execution.
+  void Unbind();
+
+  // The reader and view evaluator which the catalog must be built with.
+  RowReader* reader() { return &reader_; }
+  QueryEvaluator* view_evaluator() { return &view_evaluator_; }
+
+  // The catalog which resolved_statement refers to.
+  std::unique_ptr<Catalog> catalog;
+
+  // The output of analyzing the statement against catalog.
+  std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
+
+  // The rewritten and validated statement which is evaluated.
+  std::unique_ptr<const zetasql::ResolvedStatement> resolved_statement;
+
+  // The prepared evaluator for resolved_statement. Null for DML statements,
+  // and for simple selects until an execution needs to evaluate them.
+  std::unique_ptr<zetasql::PreparedQuery> prepared_query;
+
+  // The point read which resolved_statement is equivalent to, if it is a
+  // simple select.
+  std::unique_ptr<const SimpleSelect> simple_select;
+
+  // The point read of the keys written since a timestamp which
+  // resolved_statement is equivalent to, if it selects the rows whose commit
+  // timestamp column is later than a timestamp.
+  std::unique_ptr<const ChangedSinceSelect> changed_since_select;
+
+  // The merge of an interleaved child table with its parent which
+  // resolved_statement is equivalent to, if it joins them on the parent key.
+  std::unique_ptr<const InterleavedJoin> interleaved_join;
+
+  // The hash join which resolved_statement is equivalent to, if it joins two
+  // tables on the equality of their columns.
+  std::unique_ptr<const HashJoin> hash_join;
+
+  // The parallel scan which computes resolved_statement, if it aggregates
+  // every row of a table.
+  std::unique_ptr<const ParallelAggregate> parallel_aggregate;
+
+  // The sort or grouped aggregate of a table which resolved_statement is
+  // equivalent to, if queries spill rows which exceed a memory budget.
+  std::unique_ptr<const SortedSelect> sorted_select;
+  std::unique_ptr<const GroupedAggregate> grouped_aggregate;
+
+  // The prepared evaluator for a DML resolved_statement, which is prepared by
+  // its first execution and reused by later ones.
+  std::unique_ptr<zetasql::PreparedModify> prepared_modify;
+
+  // The keys which the scan of the target table of a DML resolved_statement
+  // is restricted to, if its WHERE clause compares key columns with values.
+  std::unique_ptr<const DmlKeyFilter> dml_key_filter;
+
+ private:
+  AnalyzedQuery(const AnalyzedQuery&) = delete;
+  AnalyzedQuery& operator=(const AnalyzedQuery&) = delete;
+
+  // A RowReader which forwards to the reader of the current execution.
+  class ForwardingRowReader : public RowReader {
+   public:
+    absl::Status Read(const ReadArg& read_arg,
+                      std::unique_ptr<RowCursor>* cursor) override;
+
+    absl::Status CheckNotCancelled() override;
+
+    RowReader* target = nullptr;
+  };
+
+  // A QueryEvaluator which forwards to the evaluator of the current execution.
+  class ForwardingQueryEvaluator : public QueryEvaluator {
+   public:
+    absl::StatusOr<std::unique_ptr<RowCursor>> Evaluate(
+        const std::string& query) override;
+
+    std::unique_ptr<QueryEvaluator> target;
+  };
+
+  ForwardingRowReader reader_;
+  ForwardingQueryEvaluator view_evaluator_;
+};
+
+// AnalyzedQueryCache is a thread-safe LRU cache of AnalyzedQuery objects.
+//
+// Entries are checked out of the cache while they are executing and returned
+// afterwards, so an entry is never shared between concurrent executions. A
+// concurrent execution of the same statement simply misses the cache.
+class AnalyzedQueryCache {
+ public:
+  // Identifies an analyzed query. Analysis only depends on the schema, the SQL
+  // text and the names and types of the query parameters.
+  struct Key {
+    const Schema* schema = nullptr;
+    std::string sql;
+    // A canonical description of the parameter names and types.
+    std::string parameters;
+    std::optional<std::string> change_stream_internal_lookup;
+
+    bool operator==(const Key& other) const {
+      return schema == other.schema && sql == other.sql &&
+             parameters == other.parameters &&
+             change_stream_internal_lookup ==
+                 other.change_stream_internal_lookup;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.schema, key.sql, key.parameters,
+                        key.change_stream_internal_lookup);
+    }
+  };
+
+  explicit AnalyzedQueryCache(int64_t capacity) : cache_(capacity) {}
+
+  // Removes the entry for key from the cache and returns it. Returns nullptr
+  // if there is no such entry.
+  std::unique_ptr<AnalyzedQuery> Checkout(const Key& key);
+
+  // Unbinds query and adds it to the cache as the most recently used entry,
+  // evicting the least recently used entry if the cache is full. If an entry
+  // for key was added in the meantime, query is discarded.
+  void Return(const Key& key, std::unique_ptr<AnalyzedQuery> query);
+
+  // Returns the number of entries currently in the cache.
+  int64_t size() const { return cache_.size(); }
+
+  // Removes the entries for schema from the cache, before it is destroyed.
+  void EraseSchema(const Schema* schema) { cache_.EraseSchema(schema); }
+
+ private:
+  SchemaLruCache<Key, std::unique_ptr<AnalyzedQuery>> cache_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_ANALYZED_QUERY_CACHE_H_
@@ -0,0 +1,116 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/analyzed_query_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "backend/access/read.h"
+#include "tests/common/row_reader.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::types::Int64Type;
+using zetasql::values::Int64;
+using zetasql_base::testing::StatusIs;
+
+AnalyzedQueryCache::Key MakeKey(const std::string& sql) {
+  return AnalyzedQueryCache::Key{/*schema=*/nullptr, sql, /*parameters=*/"",
+                                 /*change_stream_internal_lookup=*/{}};
+}
+
+TEST(AnalyzedQueryCacheTest, CheckoutRemovesEntry) {
+  AnalyzedQueryCache cache(/*capacity=*/2);
+  EXPECT_EQ(cache.Checkout(MakeKey("SELECT 1")), nullptr);
+
+  auto query = std::make_unique<AnalyzedQuery>();
+  AnalyzedQuery* query_ptr = query.get();
+  cache.Return(MakeKey("SELECT 1"), std::move(query));
+  EXPECT_EQ(cache.size(), 1);
+
+  EXPECT_EQ(cache.Checkout(MakeKey("SELECT 1")).get(), query_ptr);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.Checkout(MakeKey("SELECT 1")), nullptr);
+}
+
+TEST(AnalyzedQueryCacheTest, EvictsLeastRecentlyUsedEntry) {
+  AnalyzedQueryCache cache(/*capacity=*/2);
+  cache.Return(MakeKey("SELECT 1"), std::make_unique<AnalyzedQuery>());
+  cache.Return(MakeKey("SELECT 2"), std::make_unique<AnalyzedQuery>());
+
+  // Using "SELECT 1" makes "SELECT 2" the least recently used entry.
+  auto query = cache.Checkout(MakeKey("SELECT 1"));
+  ASSERT_NE(query, nullptr);
+  cache.Return(MakeKey("SELECT 1"), std::move(query));
+
+  cache.Return(MakeKey("SELECT 3"), std::make_unique<AnalyzedQuery>());
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.Checkout(MakeKey("SELECT 2")), nullptr);
+  EXPECT_NE(cache.Checkout(MakeKey("SELECT 1")), nullptr);
+  EXPECT_NE(cache.Checkout(MakeKey("SELECT 3")), nullptr);
+}
+
+TEST(AnalyzedQueryCacheTest, KeysIncludeParameterTypes) {
+  AnalyzedQueryCache cache(/*capacity=*/2);
+  AnalyzedQueryCache::Key int_key = MakeKey("SELECT @p");
+  int_key.parameters = "p:INT64,";
+  AnalyzedQueryCache::Key string_key = MakeKey("SELECT @p");
+  string_key.parameters = "p:STRING,";
+
+  cache.Return(int_key, std::make_unique<AnalyzedQuery>());
+  EXPECT_EQ(cache.Checkout(string_key), nullptr);
+  EXPECT_NE(cache.Checkout(int_key), nullptr);
+}
+
+TEST(AnalyzedQueryCacheTest, ReturnUnbindsReader) {
+  test::TestRowReader reader{
+      {{"T", {{"k"}, {Int64Type()}, {{Int64(1)}}}}}};
+  auto query = std::make_unique<AnalyzedQuery>();
+  query->Bind(&reader, /*view_evaluator=*/nullptr);
+
+  ReadArg read_arg;
+  read_arg.table = "T";
+  read_arg.columns = {"k"};
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_EXPECT_OK(query->reader()->Read(read_arg, &cursor));
+
+  AnalyzedQueryCache cache(/*capacity=*/1);
+  cache.Return(MakeKey("SELECT k FROM T"), std::move(query));
+  query = cache.Checkout(MakeKey("SELECT k FROM T"));
+  ASSERT_NE(query, nullptr);
+  EXPECT_THAT(query->reader()->Read(read_arg, &cursor),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
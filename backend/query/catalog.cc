@@ -38,7 +38,9 @@
 #include "backend/query/information_schema_catalog.h"
 #include "backend/query/queryable_table.h"
 #include "backend/query/queryable_view.h"
+#include "backend/query/spanner_sys_catalog.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table_statistics.h"
 #include "common/errors.h"
 #include "absl/status/status.h"
 
@@ -83,10 +85,22 @@ Catalog::Catalog(const Schema* schema, const FunctionCatalog* function_catalog,
                  zetasql::TypeFactory* type_factory,
                  const zetasql::AnalyzerOptions& options, RowReader* reader,
                  QueryEvaluator* query_evaluator,
-                 std::optional<std::string> change_stream_internal_lookup)
+                 std::optional<std::string> change_stream_internal_lookup,
+                 InformationSchemaCatalogCache* information_schema_cache,
+                 const QueryStatsAggregator* query_stats,
+                 const Storage* storage,
+                 const LockStatsAggregator* lock_stats,
+                 const TransactionStatsAggregator* txn_stats,
+                 const ReadStatsAggregator* read_stats)
     : schema_(schema),
       function_catalog_(function_catalog),
-      type_factory_(type_factory) {
+      type_factory_(type_factory),
+      information_schema_cache_(information_schema_cache),
+      query_stats_(query_stats),
+      storage_(storage),
+      lock_stats_(lock_stats),
+      txn_stats_(txn_stats),
+      read_stats_(read_stats) {
   // Pass the reader to tables.
   for (const auto* table : schema->tables()) {
     tables_[table->Name()] = std::make_unique<QueryableTable>(
@@ -117,6 +131,18 @@ Catalog::Catalog(const Schema* schema, const FunctionCatalog* function_catalog,
   }
 }
 
+void Catalog::DisableIndexSelection() {
+  for (auto& [name, table] : tables_) {
+    table->set_index_selection_enabled(false);
+  }
+}
+
+void Catalog::SetStatistics(const DatabaseStatistics* statistics) {
+  for (auto& [name, table] : tables_) {
+    table->set_statistics(statistics);
+  }
+}
+
 absl::Status Catalog::GetCatalog(const std::string& name,
                                  zetasql::Catalog** catalog,
                                  const FindOptions& options) {
@@ -124,6 +150,8 @@ absl::Status Catalog::GetCatalog(const std::string& name,
     *catalog = GetInformationSchemaCatalog();
   } else if (absl::EqualsIgnoreCase(name, NetCatalog::kName)) {
     *catalog = GetNetFunctionsCatalog();
+  } else if (absl::EqualsIgnoreCase(name, SpannerSysCatalog::kName)) {
+    *catalog = GetSpannerSysCatalog();
   }
   return absl::OkStatus();
 }
@@ -167,6 +195,7 @@ absl::Status Catalog::GetCatalogs(
     absl::flat_hash_set<const zetasql::Catalog*>* output) const {
   output->insert(GetInformationSchemaCatalog());
   output->insert(GetNetFunctionsCatalog());
+  output->insert(GetSpannerSysCatalog());
   return absl::OkStatus();
 }
 
@@ -196,8 +225,13 @@ absl::Status Catalog::GetFunctions(
 zetasql::Catalog* Catalog::GetInformationSchemaCatalog() const {
   absl::MutexLock lock(&mu_);
   if (!information_schema_catalog_) {
-    information_schema_catalog_ = std::make_unique<InformationSchemaCatalog>(
-        InformationSchemaCatalog::kName, schema_);
+    if (information_schema_cache_ != nullptr) {
+      information_schema_catalog_ =
+          information_schema_cache_->GetOrCreate(schema_);
+    } else {
+      information_schema_catalog_ = std::make_shared<InformationSchemaCatalog>(
+          InformationSchemaCatalog::kName, schema_);
+    }
   }
   return information_schema_catalog_.get();
 }
@@ -209,6 +243,17 @@ zetasql::Catalog* Catalog::GetNetFunctionsCatalog() const {
   }
   return net_catalog_.get();
 }
+
+zetasql::Catalog* Catalog::GetSpannerSysCatalog() const {
+  absl::MutexLock lock(&mu_);
+  if (!spanner_sys_catalog_) {
+    spanner_sys_catalog_ =
+        std::make_unique<SpannerSysCatalog>(query_stats_, schema_, storage_,
+                                            lock_stats_, txn_stats_,
+                                            read_stats_);
+  }
+  return spanner_sys_catalog_.get();
+}
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
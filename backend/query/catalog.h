@@ -42,27 +42,54 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+class InformationSchemaCatalogCache;
+class DatabaseStatistics;
+class LockStatsAggregator;
 class NetCatalog;
+class QueryStatsAggregator;
+class ReadStatsAggregator;
+class Storage;
+class TransactionStatsAggregator;
 
 // Implementation of zetasql::Catalog for the root catalog in the catalog
 // hierarchy. For more details, see code of zetasql::Catalog.
 class Catalog : public zetasql::EnumerableCatalog {
  public:
   // 'reader' can be nullptr unless CreateEvaluatorTableIterator is called
-  // on tables in the catalog.
+  // on tables in the catalog. If 'information_schema_cache' is set, the
+  // information schema catalog is shared with other catalogs using the same
+  // cache instead of being built for this catalog alone. The SPANNER_SYS
+  // query statistics tables are served from 'query_stats', and are empty if it
+  // is not set. The SPANNER_SYS table sizes are read from 'storage', and the
+  // lock, transaction and read statistics from 'lock_stats', 'txn_stats' and
+  // 'read_stats', if set.
   Catalog(
       const Schema* schema, const FunctionCatalog* function_catalog,
       zetasql::TypeFactory* type_factory,
       const zetasql::AnalyzerOptions& options =
           MakeGoogleSqlAnalyzerOptions(),
       RowReader* reader = nullptr, QueryEvaluator* query_evaluator = nullptr,
-      std::optional<std::string> change_stream_internal_lookup = std::nullopt);
+      std::optional<std::string> change_stream_internal_lookup = std::nullopt,
+      InformationSchemaCatalogCache* information_schema_cache = nullptr,
+      const QueryStatsAggregator* query_stats = nullptr,
+      const Storage* storage = nullptr,
+      const LockStatsAggregator* lock_stats = nullptr,
+      const TransactionStatsAggregator* txn_stats = nullptr,
+      const ReadStatsAggregator* read_stats = nullptr);
 
   std::string FullName() const final {
     // The name of the root catalog is "".
     return "";
   }
 
+  // Makes scans of the tables in this catalog always read the tables
+  // themselves, rather than a secondary index chosen from the query filters.
+  void DisableIndexSelection();
+
+  // Makes scans of the tables in this catalog estimate the cost of reading the
+  // tables and their indexes from statistics, which are not owned.
+  void SetStatistics(const DatabaseStatistics* statistics);
+
  private:
   friend class NetCatalog;
   // These tests needs to access the tvf map and manually add an empty tvf.
@@ -100,11 +127,14 @@ class Catalog : public zetasql::EnumerableCatalog {
   // Returns the NET catalog.
   zetasql::Catalog* GetNetFunctionsCatalog() const ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Returns the SPANNER_SYS catalog (creating one if needed).
+  zetasql::Catalog* GetSpannerSysCatalog() const ABSL_LOCKS_EXCLUDED(mu_);
+
   // The backend schema (which is the default schema in this catalog).
   const Schema* schema_ = nullptr;
 
   // Tables available in the default schema.
-  CaseInsensitiveStringMap<std::unique_ptr<const QueryableTable>> tables_;
+  CaseInsensitiveStringMap<std::unique_ptr<QueryableTable>> tables_;
   CaseInsensitiveStringMap<std::unique_ptr<const QueryableView>> views_;
 
   // Change Stream TVFs available in the default schema.
@@ -123,12 +153,29 @@ class Catalog : public zetasql::EnumerableCatalog {
   // Mutex to protect state below.
   mutable absl::Mutex mu_;
 
-  // Information schema catalog (created only if accessed).
-  mutable std::unique_ptr<zetasql::Catalog> information_schema_catalog_
+  // Cache shared with other catalogs for the information schema catalog. May
+  // be null.
+  InformationSchemaCatalogCache* information_schema_cache_ = nullptr;
+
+  // Information schema catalog (created or fetched only if accessed).
+  mutable std::shared_ptr<zetasql::Catalog> information_schema_catalog_
       ABSL_GUARDED_BY(mu_);
 
   // Sub-catalog for resolving NET function lookup.
   mutable std::unique_ptr<zetasql::Catalog> net_catalog_ ABSL_GUARDED_BY(mu_);
+
+  // Source of the SPANNER_SYS query statistics. May be null.
+  const QueryStatsAggregator* query_stats_ = nullptr;
+
+  // Source of the SPANNER_SYS table sizes. May be null.
+  const Storage* storage_ = nullptr;
+  const LockStatsAggregator* lock_stats_ = nullptr;
+  const TransactionStatsAggregator* txn_stats_ = nullptr;
+  const ReadStatsAggregator* read_stats_ = nullptr;
+
+  // SPANNER_SYS catalog (created only if accessed).
+  mutable std::unique_ptr<zetasql::Catalog> spanner_sys_catalog_
+      ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace backend
@@ -90,6 +90,23 @@ TEST_F(AnalyzeStatementTest, SelectNestedCatalogNetFunctions) {
                        "NET.IPV4_TO_INT64(b\"\\x00\\x00\\x00\\x00\")"));
 }
 
+TEST(FunctionCatalogTest, DefaultCatalogWorksWithAnyTypeFactory) {
+  EXPECT_EQ(FunctionCatalog::Default(), FunctionCatalog::Default());
+
+  // The schema types come from a different factory than the function
+  // signatures of the shared catalog.
+  zetasql::TypeFactory type_factory;
+  std::unique_ptr<const Schema> schema =
+      test::CreateSchemaWithOneTable(&type_factory);
+  auto analyzer_options = MakeGoogleSqlAnalyzerOptions();
+  Catalog catalog{schema.get(), FunctionCatalog::Default(), &type_factory,
+                  analyzer_options};
+  std::unique_ptr<const zetasql::AnalyzerOutput> output;
+  ZETASQL_EXPECT_OK(zetasql::AnalyzeStatement(
+      "SELECT ARRAY_LENGTH([int64_col]), UPPER(string_col) FROM test_table",
+      analyzer_options, &catalog, &type_factory, &output));
+}
+
 class CatalogTest : public testing::Test {
  public:
   CatalogTest() : type_factory_(), function_catalog_(&type_factory_) {}
@@ -0,0 +1,219 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/changed_since_select.h"
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/time/time.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/storage/commit_timestamp_index.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+std::unique_ptr<const ChangedSinceSelect> ChangedSinceSelect::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT ||
+      !statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  if (query_stmt->is_value_table()) {
+    return nullptr;
+  }
+
+  // Unwrap SELECT <columns> and WHERE <predicate>.
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() != zetasql::RESOLVED_PROJECT_SCAN) {
+    return nullptr;
+  }
+  const auto* project_scan = scan->GetAs<zetasql::ResolvedProjectScan>();
+  if (!project_scan->expr_list().empty() ||
+      !project_scan->hint_list().empty() ||
+      project_scan->input_scan()->node_kind() !=
+          zetasql::RESOLVED_FILTER_SCAN) {
+    return nullptr;
+  }
+  const auto* filter_scan =
+      project_scan->input_scan()->GetAs<zetasql::ResolvedFilterScan>();
+  if (!filter_scan->hint_list().empty()) {
+    return nullptr;
+  }
+
+  // Only tables read through a RowReader, not views, information schema or
+  // change stream tables, are recorded in the commit timestamp index. The
+  // columns produced by the table scan are mapped to the columns of the table,
+  // which are read under their names.
+  absl::flat_hash_map<int, const Column*> scanned_columns;
+  const QueryableTable* queryable_table =
+      MatchTableScan(filter_scan->input_scan(), &scanned_columns);
+  if (queryable_table == nullptr) {
+    return nullptr;
+  }
+  auto select = absl::WrapUnique(new ChangedSinceSelect());
+  select->table_name_ = queryable_table->Name();
+  select->table_id_ = queryable_table->wrapped_table()->id();
+  absl::flat_hash_map<const Column*, int> read_positions;
+  auto read_position = [&](const Column* column) {
+    auto [itr, inserted] =
+        read_positions.try_emplace(column, select->read_column_names_.size());
+    if (inserted) {
+      select->read_column_names_.push_back(column->Name());
+    }
+    return itr->second;
+  };
+
+  // The predicate compares a commit timestamp column with a timestamp, with
+  // the column on the left of > or >=, or on the right of < or <=.
+  const zetasql::ResolvedExpr* predicate = filter_scan->filter_expr();
+  if (predicate->node_kind() != zetasql::RESOLVED_FUNCTION_CALL) {
+    return nullptr;
+  }
+  const auto* call = predicate->GetAs<zetasql::ResolvedFunctionCall>();
+  if (!call->function()->IsZetaSQLBuiltin() ||
+      call->argument_list_size() != 2) {
+    return nullptr;
+  }
+  const std::string& function_name = call->function()->Name();
+  const zetasql::ResolvedExpr* column_ref = call->argument_list(0);
+  const zetasql::ResolvedExpr* since = call->argument_list(1);
+  if (function_name == "$greater" || function_name == "$greater_or_equal") {
+    select->inclusive_ = function_name == "$greater_or_equal";
+  } else if (function_name == "$less" || function_name == "$less_or_equal") {
+    select->inclusive_ = function_name == "$less_or_equal";
+    std::swap(column_ref, since);
+  } else {
+    return nullptr;
+  }
+  if (column_ref->node_kind() != zetasql::RESOLVED_COLUMN_REF ||
+      !since->type()->IsTimestamp()) {
+    return nullptr;
+  }
+  auto column_itr = scanned_columns.find(
+      column_ref->GetAs<zetasql::ResolvedColumnRef>()->column().column_id());
+  if (column_itr == scanned_columns.end() ||
+      !column_itr->second->GetType()->IsTimestamp() ||
+      !column_itr->second->allows_commit_timestamp()) {
+    return nullptr;
+  }
+  if (since->node_kind() == zetasql::RESOLVED_LITERAL) {
+    select->since_literal_ = since->GetAs<zetasql::ResolvedLiteral>()->value();
+  } else if (since->node_kind() == zetasql::RESOLVED_PARAMETER) {
+    select->since_parameter_ =
+        since->GetAs<zetasql::ResolvedParameter>()->name();
+  } else {
+    return nullptr;
+  }
+  select->timestamp_position_ = read_position(column_itr->second);
+
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    auto output_itr = scanned_columns.find(output_column->column().column_id());
+    if (output_itr == scanned_columns.end()) {
+      return nullptr;
+    }
+    select->output_positions_.push_back(read_position(output_itr->second));
+    select->output_column_names_.push_back(output_column->name());
+    select->output_column_types_.push_back(output_column->column().type());
+  }
+  return select;
+}
+
+absl::StatusOr<bool> ChangedSinceSelect::Execute(
+    const std::map<std::string, zetasql::Value>& params,
+    const CommitTimestampIndex& index, RowReader* reader,
+    std::vector<std::vector<zetasql::Value>>* rows) const {
+  zetasql::Value since;
+  if (since_literal_.has_value()) {
+    since = *since_literal_;
+  } else {
+    // Parameter names are case insensitive.
+    for (const auto& [name, value] : params) {
+      if (absl::EqualsIgnoreCase(name, since_parameter_)) {
+        since = value;
+      }
+    }
+  }
+  if (!since.is_valid() || since.is_null() || !since.type()->IsTimestamp()) {
+    return false;
+  }
+
+  // A row matches >= since if it was written at or after since, that is after
+  // the instant just before it.
+  const absl::Time since_time = since.ToTime();
+  std::optional<std::vector<Key>> keys = index.KeysWrittenAfter(
+      table_id_,
+      inclusive_ ? since_time - absl::Nanoseconds(1) : since_time);
+  if (!keys.has_value()) {
+    return false;
+  }
+  rows->clear();
+  if (keys->empty()) {
+    return true;
+  }
+
+  ReadArg read_arg;
+  read_arg.table = table_name_;
+  for (const Key& key : *keys) {
+    read_arg.key_set.AddKey(key);
+  }
+  read_arg.columns = read_column_names_;
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_RETURN_IF_ERROR(reader->Read(read_arg, &cursor));
+  while (cursor->Next()) {
+    // The keys include rows written after since whose timestamp is not, and
+    // rows written after the read timestamp, so every row is checked against
+    // the predicate like the evaluator would.
+    const zetasql::Value& timestamp = cursor->ColumnValue(timestamp_position_);
+    if (timestamp.is_null() || timestamp.ToTime() < since_time ||
+        (!inclusive_ && timestamp.ToTime() == since_time)) {
+      continue;
+    }
+    std::vector<zetasql::Value>& row = rows->emplace_back();
+    row.reserve(output_positions_.size());
+    for (int position : output_positions_) {
+      row.push_back(cursor->ColumnValue(position));
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(cursor->Status());
+  return true;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
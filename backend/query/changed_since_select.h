@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_CHANGED_SINCE_SELECT_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_CHANGED_SINCE_SELECT_H_
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/common/ids.h"
+#include "backend/storage/commit_timestamp_index.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// ChangedSinceSelect is a query for the rows of a table changed since a
+// timestamp, which is executed as a point read of the keys that the commit
+// timestamp index has recorded as written after it (see CommitTimestampIndex)
+// instead of by a scan of the whole table.
+//
+// It matches statements of the form
+//
+//   SELECT <columns> FROM <table> WHERE <column> > <since>
+//
+// in which <column> allows commit timestamps, the comparison may also be >=,
+// or written the other way around, <since> is a literal or query parameter of
+// type TIMESTAMP, and the select list only names columns of the table.
+// Statements with hints, an ORDER BY, a LIMIT or any other predicate do not
+// match.
+class ChangedSinceSelect {
+ public:
+  // Returns the ChangedSinceSelect equivalent to statement, or nullptr if
+  // statement is not of the form above.
+  static std::unique_ptr<const ChangedSinceSelect> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  // The names and types of the columns of the result.
+  const std::vector<std::string>& output_column_names() const {
+    return output_column_names_;
+  }
+  const std::vector<const zetasql::Type*>& output_column_types() const {
+    return output_column_types_;
+  }
+
+  // Reads the rows of the result with the given parameter values through
+  // reader into rows, reading only the keys which index has recorded. reader
+  // must read committed rows only. Returns false without reading if since is
+  // NULL, or earlier than the index covers, in which case the query must be
+  // evaluated instead.
+  absl::StatusOr<bool> Execute(
+      const std::map<std::string, zetasql::Value>& params,
+      const CommitTimestampIndex& index, RowReader* reader,
+      std::vector<std::vector<zetasql::Value>>* rows) const;
+
+ private:
+  ChangedSinceSelect() = default;
+
+  // The table which is read, and the columns read from it.
+  std::string table_name_;
+  TableID table_id_;
+  std::vector<std::string> read_column_names_;
+
+  // The position in read_column_names_ of each column of the result.
+  std::vector<int> output_positions_;
+  std::vector<std::string> output_column_names_;
+  std::vector<const zetasql::Type*> output_column_types_;
+
+  // The position in read_column_names_ of the commit timestamp column, and
+  // whether it is compared with >= rather than >.
+  int timestamp_position_ = 0;
+  bool inclusive_ = false;
+
+  // The timestamp compared with, either a literal or the name of a query
+  // parameter.
+  std::optional<zetasql::Value> since_literal_;
+  std::string since_parameter_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_CHANGED_SINCE_SELECT_H_
@@ -0,0 +1,136 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/column_filters.h"
+
+#include <vector>
+
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/value.h"
+#include "absl/types/span.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/schema/catalog/column.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The maximum number of point keys generated from IN filters. Beyond this, the
+// remaining key columns are not pushed down.
+constexpr int kMaxPushedDownKeys = 1024;
+
+// Returns true if value can be used as a key bound for column.
+bool IsPushableValue(const zetasql::Value& value, const Column* column) {
+  return value.is_valid() && value.type()->Equals(column->GetType());
+}
+
+}  // namespace
+
+KeySet KeySetFromColumnFilters(
+    absl::Span<const KeyColumn* const> key_columns,
+    absl::Span<const zetasql::ColumnFilter* const> key_filters) {
+
+  // The prefixes of the keys which may satisfy the filters seen so far.
+  std::vector<Key> prefixes = {Key()};
+  for (int i = 0; i < key_columns.size() && i < key_filters.size(); ++i) {
+    const zetasql::ColumnFilter* filter = key_filters[i];
+    if (filter == nullptr) {
+      break;
+    }
+    const Column* column = key_columns[i]->column();
+    const bool desc = key_columns[i]->is_descending();
+    // NaN ordering differs between SQL comparisons and keys, so floating point
+    // keys are never restricted.
+    if (column->GetType()->IsFloatingPoint()) {
+      break;
+    }
+
+    if (filter->kind() == zetasql::ColumnFilter::kInList) {
+      const std::vector<zetasql::Value>& values = filter->in_list();
+      bool pushable = prefixes.size() * values.size() <= kMaxPushedDownKeys;
+      for (const zetasql::Value& value : values) {
+        pushable = pushable && IsPushableValue(value, column);
+      }
+      if (!pushable) {
+        break;
+      }
+      std::vector<Key> next_prefixes;
+      next_prefixes.reserve(prefixes.size() * values.size());
+      for (const Key& prefix : prefixes) {
+        for (const zetasql::Value& value : values) {
+          Key key = prefix;
+          key.AddColumn(value, desc);
+          next_prefixes.push_back(std::move(key));
+        }
+      }
+      prefixes = std::move(next_prefixes);
+      if (prefixes.empty()) {
+        // An empty IN list matches nothing.
+        return KeySet();
+      }
+      continue;
+    }
+
+    // A range filter ends the key prefix. Bounds are inclusive, and in key
+    // order the lower bound of a descending column is its upper value.
+    const zetasql::Value& start_value =
+        desc ? filter->upper_bound() : filter->lower_bound();
+    const zetasql::Value& limit_value =
+        desc ? filter->lower_bound() : filter->upper_bound();
+    const bool has_start = IsPushableValue(start_value, column);
+    const bool has_limit = IsPushableValue(limit_value, column);
+    if (!has_start && !has_limit) {
+      break;
+    }
+    KeySet key_set;
+    for (const Key& prefix : prefixes) {
+      Key start_key = prefix;
+      Key limit_key = prefix;
+      if (has_start) {
+        start_key.AddColumn(start_value, desc);
+      }
+      if (has_limit) {
+        limit_key.AddColumn(limit_value, desc);
+      }
+      key_set.AddRange(KeyRange::ClosedClosed(start_key, limit_key));
+    }
+    return key_set;
+  }
+
+  if (prefixes.size() == 1 && prefixes.front().IsEmpty()) {
+    return KeySet::All();
+  }
+  KeySet key_set;
+  for (const Key& prefix : prefixes) {
+    if (prefix.NumColumns() == key_columns.size()) {
+      key_set.AddKey(prefix);
+    } else {
+      key_set.AddRange(KeyRange::Prefix(prefix));
+    }
+  }
+  return key_set;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
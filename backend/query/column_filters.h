@@ -0,0 +1,50 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_COLUMN_FILTERS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_COLUMN_FILTERS_H_
+
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "absl/types/span.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/schema/catalog/column.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Returns a KeySet which covers at least every row of a table (or index data
+// table) keyed by key_columns whose key satisfies the given column filters.
+//
+// key_filters[i] is the filter which the ZetaSQL evaluator pushed down for
+// key_columns[i], or nullptr if there is none. Equality and
+// IN filters on a prefix of the key columns become point keys or prefix
+// ranges, and a range filter on the column following that prefix becomes a key
+// range. Filters that cannot be translated are ignored, which only makes the
+// returned KeySet larger. The evaluator still applies the original predicates
+// to every row which is read, so the result of the query does not change.
+KeySet KeySetFromColumnFilters(
+    absl::Span<const KeyColumn* const> key_columns,
+    absl::Span<const zetasql::ColumnFilter* const> key_filters);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_COLUMN_FILTERS_H_
@@ -0,0 +1,132 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/column_filters.h"
+
+#include <memory>
+#include <vector>
+
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/schema/catalog/change_stream.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
+#include "tests/common/schema_constructor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+class ColumnFiltersTest : public testing::Test {
+ public:
+  absl::Span<const KeyColumn* const> primary_key() {
+    return schema_->FindTable("test_table")->primary_key();
+  }
+
+ protected:
+  zetasql::TypeFactory type_factory_;
+
+ private:
+  std::unique_ptr<const Schema> schema_ =
+      test::CreateSchemaWithOneTable(&type_factory_);
+};
+
+TEST_F(ColumnFiltersTest, NoFiltersReadsAllRows) {
+  KeySet key_set = KeySetFromColumnFilters(primary_key(), {nullptr});
+  ASSERT_EQ(key_set.ranges().size(), 1);
+  EXPECT_EQ(key_set.ranges()[0], KeyRange::All());
+  EXPECT_TRUE(key_set.keys().empty());
+}
+
+TEST_F(ColumnFiltersTest, InListBecomesPointKeys) {
+  zetasql::ColumnFilter filter(std::vector<zetasql::Value>{Int64(1), Int64(3)});
+  KeySet key_set = KeySetFromColumnFilters(primary_key(), {&filter});
+  EXPECT_THAT(key_set.keys(),
+              testing::ElementsAre(Key({Int64(1)}), Key({Int64(3)})));
+  EXPECT_TRUE(key_set.ranges().empty());
+}
+
+TEST_F(ColumnFiltersTest, EmptyInListReadsNoRows) {
+  zetasql::ColumnFilter filter(std::vector<zetasql::Value>{});
+  KeySet key_set = KeySetFromColumnFilters(primary_key(), {&filter});
+  EXPECT_TRUE(key_set.keys().empty());
+  EXPECT_TRUE(key_set.ranges().empty());
+}
+
+TEST_F(ColumnFiltersTest, RangeBecomesClosedKeyRange) {
+  zetasql::ColumnFilter filter(Int64(2), Int64(5));
+  KeySet key_set = KeySetFromColumnFilters(primary_key(), {&filter});
+  ASSERT_EQ(key_set.ranges().size(), 1);
+  EXPECT_EQ(key_set.ranges()[0],
+            KeyRange::ClosedClosed(Key({Int64(2)}), Key({Int64(5)})));
+}
+
+TEST_F(ColumnFiltersTest, UnboundedRangeKeepsOpenSideUnrestricted) {
+  zetasql::ColumnFilter filter(Int64(2), zetasql::Value());
+  KeySet key_set = KeySetFromColumnFilters(primary_key(), {&filter});
+  ASSERT_EQ(key_set.ranges().size(), 1);
+  EXPECT_EQ(key_set.ranges()[0],
+            KeyRange::ClosedClosed(Key({Int64(2)}), Key()));
+}
+
+TEST_F(ColumnFiltersTest, MismatchedTypesAreNotPushedDown) {
+  zetasql::ColumnFilter filter(std::vector<zetasql::Value>{String("a")});
+  KeySet key_set = KeySetFromColumnFilters(primary_key(), {&filter});
+  ASSERT_EQ(key_set.ranges().size(), 1);
+  EXPECT_EQ(key_set.ranges()[0], KeyRange::All());
+}
+
+TEST_F(ColumnFiltersTest, ChangeStreamWindowBecomesKeyRangeOfPartition) {
+  std::unique_ptr<const Schema> schema =
+      test::CreateSchemaWithOneTableAndOneChangeStream(&type_factory_);
+  const Table* data_table = schema->FindChangeStream("change_stream_test_table")
+                                ->change_stream_data_table();
+  absl::Time start = absl::FromUnixSeconds(100);
+  absl::Time end = absl::FromUnixSeconds(200);
+  zetasql::ColumnFilter token_filter(
+      std::vector<zetasql::Value>{String("token")});
+  zetasql::ColumnFilter timestamp_filter(zetasql::values::Timestamp(start),
+                                         zetasql::values::Timestamp(end));
+  KeySet key_set = KeySetFromColumnFilters(data_table->primary_key(),
+                                           {&token_filter, &timestamp_filter});
+  ASSERT_EQ(key_set.ranges().size(), 1);
+  EXPECT_EQ(key_set.ranges()[0],
+            KeyRange::ClosedClosed(
+                Key({String("token"), zetasql::values::Timestamp(start)}),
+                Key({String("token"), zetasql::values::Timestamp(end)})));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,204 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/dml_key_filter.h"
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_visitor.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/query/simple_select.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Counts the scans of a table within a statement.
+class TableScanCounter : public zetasql::ResolvedASTVisitor {
+ public:
+  explicit TableScanCounter(const zetasql::Table* table) : table_(table) {}
+
+  absl::Status VisitResolvedTableScan(
+      const zetasql::ResolvedTableScan* node) override {
+    if (node->table() == table_) {
+      ++count_;
+    }
+    return DefaultVisit(node);
+  }
+
+  int count() const { return count_; }
+
+ private:
+  const zetasql::Table* table_;
+  int count_ = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<const DmlKeyFilter> DmlKeyFilter::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (!statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const zetasql::ResolvedTableScan* table_scan;
+  const zetasql::ResolvedExpr* where_expr;
+  if (statement->node_kind() == zetasql::RESOLVED_UPDATE_STMT) {
+    const auto* update_stmt = statement->GetAs<zetasql::ResolvedUpdateStmt>();
+    table_scan = update_stmt->table_scan();
+    where_expr = update_stmt->where_expr();
+  } else if (statement->node_kind() == zetasql::RESOLVED_DELETE_STMT) {
+    const auto* delete_stmt = statement->GetAs<zetasql::ResolvedDeleteStmt>();
+    table_scan = delete_stmt->table_scan();
+    where_expr = delete_stmt->where_expr();
+  } else {
+    return nullptr;
+  }
+  if (table_scan == nullptr || where_expr == nullptr) {
+    return nullptr;
+  }
+
+  // Only tables read through a RowReader can have their reads restricted.
+  absl::flat_hash_map<int, const Column*> scanned_columns;
+  const QueryableTable* queryable_table =
+      MatchTableScan(table_scan, &scanned_columns);
+  if (queryable_table == nullptr) {
+    return nullptr;
+  }
+
+  // Every read of the table is restricted to the key set, so the statement
+  // must not read it other than through the target scan, e.g. in a subquery.
+  TableScanCounter counter(queryable_table);
+  if (!statement->Accept(&counter).ok() || counter.count() != 1) {
+    return nullptr;
+  }
+  const Table* table = queryable_table->wrapped_table();
+
+  // Conjuncts other than comparisons of key columns with values are left to
+  // the evaluator. If a column is compared more than once, any one of the
+  // comparisons restricts the keys.
+  absl::flat_hash_map<const Column*, Operand> key_operands;
+  std::vector<const zetasql::ResolvedExpr*> conjuncts;
+  CollectConjuncts(where_expr, &conjuncts);
+  for (const zetasql::ResolvedExpr* conjunct : conjuncts) {
+    if (conjunct->node_kind() != zetasql::RESOLVED_FUNCTION_CALL) {
+      continue;
+    }
+    const auto* call = conjunct->GetAs<zetasql::ResolvedFunctionCall>();
+    if (!call->function()->IsZetaSQLBuiltin() ||
+        call->function()->Name() != "$equal" ||
+        call->argument_list_size() != 2) {
+      continue;
+    }
+    const zetasql::ResolvedExpr* column_ref = call->argument_list(0);
+    const zetasql::ResolvedExpr* value = call->argument_list(1);
+    if (column_ref->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+      std::swap(column_ref, value);
+    }
+    if (column_ref->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+      continue;
+    }
+    auto column_itr = scanned_columns.find(
+        column_ref->GetAs<zetasql::ResolvedColumnRef>()->column().column_id());
+    if (column_itr == scanned_columns.end() ||
+        !HasKeyEquality(column_itr->second->GetType()) ||
+        !value->type()->Equals(column_itr->second->GetType())) {
+      continue;
+    }
+    Operand operand;
+    if (value->node_kind() == zetasql::RESOLVED_LITERAL) {
+      operand.literal = value->GetAs<zetasql::ResolvedLiteral>()->value();
+    } else if (value->node_kind() == zetasql::RESOLVED_PARAMETER) {
+      operand.parameter = value->GetAs<zetasql::ResolvedParameter>()->name();
+    } else {
+      continue;
+    }
+    key_operands.try_emplace(column_itr->second, std::move(operand));
+  }
+
+  auto key_filter = absl::WrapUnique(new DmlKeyFilter());
+  key_filter->table_name_ = queryable_table->Name();
+  for (const KeyColumn* key_column : table->primary_key()) {
+    auto operand_itr = key_operands.find(key_column->column());
+    if (operand_itr == key_operands.end()) {
+      break;
+    }
+    key_filter->key_operands_.push_back(std::move(operand_itr->second));
+    key_filter->key_types_.push_back(key_column->column()->GetType());
+    key_filter->key_descending_.push_back(key_column->is_descending());
+  }
+  if (key_filter->key_operands_.empty()) {
+    return nullptr;
+  }
+  key_filter->point_read_ =
+      key_filter->key_operands_.size() == table->primary_key().size();
+  return key_filter;
+}
+
+std::optional<KeySet> DmlKeyFilter::Bind(
+    const std::map<std::string, zetasql::Value>& params) const {
+  Key key;
+  const int num_key_operands = key_operands_.size();
+  for (int i = 0; i < num_key_operands; ++i) {
+    zetasql::Value value;
+    if (key_operands_[i].literal.has_value()) {
+      value = *key_operands_[i].literal;
+    } else {
+      // Parameter names are case insensitive.
+      for (const auto& [name, param] : params) {
+        if (absl::EqualsIgnoreCase(name, key_operands_[i].parameter)) {
+          value = param;
+          break;
+        }
+      }
+    }
+    if (!value.is_valid() || !value.type()->Equals(key_types_[i])) {
+      return std::nullopt;
+    }
+    // A comparison with NULL matches no row.
+    if (value.is_null()) {
+      return KeySet();
+    }
+    key.AddColumn(std::move(value), key_descending_[i]);
+  }
+  return point_read_ ? KeySet(key) : KeySet(KeyRange::Prefix(key));
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,93 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_DML_KEY_FILTER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_DML_KEY_FILTER_H_
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "backend/datamodel/key_set.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// DmlKeyFilter restricts the scan of the target table of an UPDATE or DELETE
+// statement to the keys which its WHERE clause can match. The ZetaSQL
+// evaluator does not push the predicates of DML statements down into their
+// table scans, so without it every execution reads the whole table.
+//
+// It matches statements of the form
+//
+//   UPDATE <table> SET ... WHERE <key1> = <v1> AND ... AND <other predicates>
+//   DELETE FROM <table> WHERE <key1> = <v1> AND ... AND <other predicates>
+//
+// in which a non-empty prefix of the primary key columns of the table is
+// compared for equality with literals or query parameters of the types of the
+// columns, and the target table is not read anywhere else in the statement.
+// The evaluator still applies the whole WHERE clause to every row read, so
+// the other predicates may be anything.
+class DmlKeyFilter {
+ public:
+  // Returns the DmlKeyFilter of statement, or nullptr if statement is not of
+  // the form above.
+  static std::unique_ptr<const DmlKeyFilter> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  // The name of the target table.
+  const std::string& table_name() const { return table_name_; }
+
+  // Returns the keys of the target table which the statement can modify with
+  // the given parameter values, or nullopt if a parameter has no value of the
+  // type of its key column, in which case the whole table must be scanned.
+  std::optional<KeySet> Bind(
+      const std::map<std::string, zetasql::Value>& params) const;
+
+ private:
+  // A literal, or the name of a query parameter.
+  struct Operand {
+    std::optional<zetasql::Value> literal;
+    std::string parameter;
+  };
+
+  DmlKeyFilter() = default;
+
+  std::string table_name_;
+
+  // The value compared with each column of the key prefix, its type and
+  // whether it is descending.
+  std::vector<Operand> key_operands_;
+  std::vector<const zetasql::Type*> key_types_;
+  std::vector<bool> key_descending_;
+
+  // True if the key prefix is the whole primary key.
+  bool point_read_ = false;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_DML_KEY_FILTER_H_
@@ -32,6 +32,7 @@ absl::Status DMLQueryValidator::VisitResolvedFunctionCall(
   const std::string name = node->function()->FullName(false);
   // Check if the function is a DML-specific function.
   if (name == kPendingCommitTimestampFunctionName) {
+    CheckSubtree(node);
     return absl::OkStatus();
   }
   // Check for other generally-available functions.
@@ -44,6 +45,7 @@ absl::Status DMLQueryValidator::VisitResolvedReturningClause(
     if (column->column().type()->IsStruct())
       return error::UnsupportedReturnStructAsColumn();
   }
+  CheckSubtree(node);
   return absl::OkStatus();
 }
 
@@ -0,0 +1,318 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/external_sorter.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.pb.h"
+#include "zetasql/public/value.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "common/errors.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+absl::Status SpillFileError(absl::string_view operation) {
+  return error::Internal(absl::StrCat("Failed to ", operation,
+                                      " query spill file: ",
+                                      std::strerror(errno)));
+}
+
+// Returns the estimated size of row in memory.
+int64_t RowSize(const std::vector<zetasql::Value>& row) {
+  int64_t size = sizeof(row);
+  for (const zetasql::Value& value : row) {
+    size += value.physical_byte_size();
+  }
+  return size;
+}
+
+}  // namespace
+
+bool SortsBefore(const std::vector<SortColumn>& order,
+                 const std::vector<zetasql::Value>& a,
+                 const std::vector<zetasql::Value>& b) {
+  for (const SortColumn& column : order) {
+    const zetasql::Value& x = a[column.position];
+    const zetasql::Value& y = b[column.position];
+    if (x.is_null() || y.is_null()) {
+      if (x.is_null() == y.is_null()) {
+        continue;
+      }
+      return x.is_null() != column.nulls_last;
+    }
+    if (x.LessThan(y)) {
+      return !column.descending;
+    }
+    if (y.LessThan(x)) {
+      return column.descending;
+    }
+  }
+  return false;
+}
+
+absl::StatusOr<std::unique_ptr<SpillFile>> SpillFile::Create(
+    const std::string& directory,
+    std::vector<const zetasql::Type*> column_types) {
+  std::string path = absl::StrCat(directory, "/spill.XXXXXX");
+  const int fd = ::mkstemp(path.data());
+  if (fd < 0) {
+    return SpillFileError(absl::StrCat("create ", path, " as"));
+  }
+  ::unlink(path.c_str());
+  std::FILE* file = ::fdopen(fd, "w+b");
+  if (file == nullptr) {
+    absl::Status status = SpillFileError("open");
+    ::close(fd);
+    return status;
+  }
+  return absl::WrapUnique(new SpillFile(file, std::move(column_types)));
+}
+
+SpillFile::~SpillFile() { std::fclose(file_); }
+
+absl::Status SpillFile::Append(const std::vector<zetasql::Value>& row) {
+  ZETASQL_RET_CHECK(!reading_);
+  ZETASQL_RET_CHECK_EQ(row.size(), column_types_.size());
+  std::string data;
+  for (const zetasql::Value& value : row) {
+    zetasql::ValueProto value_proto;
+    ZETASQL_RETURN_IF_ERROR(value.Serialize(&value_proto));
+    value_proto.SerializeToString(&data);
+    const uint32_t size = data.size();
+    const unsigned char header[4] = {
+        static_cast<unsigned char>(size), static_cast<unsigned char>(size >> 8),
+        static_cast<unsigned char>(size >> 16),
+        static_cast<unsigned char>(size >> 24)};
+    if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header) ||
+        std::fwrite(data.data(), 1, data.size(), file_) != data.size()) {
+      return SpillFileError("write");
+    }
+  }
+  ++num_rows_;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<bool> SpillFile::Read(std::vector<zetasql::Value>* row) {
+  if (!reading_) {
+    if (std::fflush(file_) != 0 || std::fseek(file_, 0, SEEK_SET) != 0) {
+      return SpillFileError("rewind");
+    }
+    reading_ = true;
+  }
+  row->clear();
+  row->reserve(column_types_.size());
+  std::string data;
+  for (const zetasql::Type* type : column_types_) {
+    unsigned char header[4];
+    const size_t read = std::fread(header, 1, sizeof(header), file_);
+    if (read == 0 && row->empty() && std::feof(file_)) {
+      return false;
+    }
+    if (read != sizeof(header)) {
+      return std::ferror(file_) ? SpillFileError("read")
+                                : error::Internal("Query spill file is cut "
+                                                  "short.");
+    }
+    const uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) |
+                          (static_cast<uint32_t>(header[3]) << 24);
+    data.resize(size);
+    if (std::fread(data.data(), 1, size, file_) != size) {
+      return SpillFileError("read");
+    }
+    zetasql::ValueProto value_proto;
+    if (!value_proto.ParseFromString(data)) {
+      return error::Internal("Failed to parse value from query spill file.");
+    }
+    ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value,
+                     zetasql::Value::Deserialize(value_proto, type));
+    row->push_back(std::move(value));
+  }
+  return true;
+}
+
+ExternalSorter::ExternalSorter(std::vector<const zetasql::Type*> column_types,
+                               std::vector<SortColumn> order, Options options)
+    : column_types_(std::move(column_types)),
+      order_(std::move(order)),
+      options_(std::move(options)) {}
+
+absl::Status ExternalSorter::Add(std::vector<zetasql::Value> row) {
+  ZETASQL_RET_CHECK(!sorted_);
+  buffered_bytes_ += RowSize(row);
+  rows_.push_back(std::move(row));
+  ++num_rows_;
+  if (buffered_bytes_ > options_.memory_budget_bytes) {
+    ZETASQL_RETURN_IF_ERROR(WriteRun(&rows_));
+    rows_ = {};
+    buffered_bytes_ = 0;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ExternalSorter::Spill(
+    std::vector<std::vector<zetasql::Value>> rows) {
+  ZETASQL_RET_CHECK(!sorted_);
+  num_rows_ += rows.size();
+  return WriteRun(&rows);
+}
+
+absl::Status ExternalSorter::WriteRun(
+    std::vector<std::vector<zetasql::Value>>* rows) {
+  std::stable_sort(rows->begin(), rows->end(),
+                   [this](const std::vector<zetasql::Value>& a,
+                          const std::vector<zetasql::Value>& b) {
+                     return SortsBefore(order_, a, b);
+                   });
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<SpillFile> file,
+                   SpillFile::Create(options_.spill_directory, column_types_));
+  for (const std::vector<zetasql::Value>& row : *rows) {
+    ZETASQL_RETURN_IF_ERROR(file->Append(row));
+  }
+  spilled_.push_back(std::move(file));
+  ++num_spilled_runs_;
+  return absl::OkStatus();
+}
+
+absl::Status ExternalSorter::Sort() {
+  ZETASQL_RET_CHECK(!sorted_);
+  sorted_ = true;
+  if (spilled_.empty()) {
+    std::stable_sort(rows_.begin(), rows_.end(),
+                     [this](const std::vector<zetasql::Value>& a,
+                            const std::vector<zetasql::Value>& b) {
+                       return SortsBefore(order_, a, b);
+                     });
+    return absl::OkStatus();
+  }
+  if (!rows_.empty()) {
+    ZETASQL_RETURN_IF_ERROR(WriteRun(&rows_));
+    rows_ = {};
+    buffered_bytes_ = 0;
+  }
+
+  // Consecutive runs are merged into one, which keeps rows which sort the same
+  // in the order they were added.
+  while (spilled_.size() > kMaxMergeFanIn) {
+    std::vector<std::unique_ptr<SpillFile>> merged;
+    for (size_t start = 0; start < spilled_.size(); start += kMaxMergeFanIn) {
+      const size_t end = std::min(spilled_.size(), start + kMaxMergeFanIn);
+      std::vector<std::unique_ptr<SpillFile>> files;
+      for (size_t i = start; i < end; ++i) {
+        files.push_back(std::move(spilled_[i]));
+      }
+      ZETASQL_RETURN_IF_ERROR(StartMerge(std::move(files)));
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::unique_ptr<SpillFile> file,
+          SpillFile::Create(options_.spill_directory, column_types_));
+      std::vector<zetasql::Value> row;
+      while (true) {
+        ZETASQL_ASSIGN_OR_RETURN(bool has_row, NextMerged(&row));
+        if (!has_row) {
+          break;
+        }
+        ZETASQL_RETURN_IF_ERROR(file->Append(row));
+      }
+      merged.push_back(std::move(file));
+    }
+    spilled_ = std::move(merged);
+  }
+  return StartMerge(std::move(spilled_));
+}
+
+absl::Status ExternalSorter::StartMerge(
+    std::vector<std::unique_ptr<SpillFile>> files) {
+  runs_.clear();
+  heap_.clear();
+  for (std::unique_ptr<SpillFile>& file : files) {
+    Run& run = runs_.emplace_back();
+    run.file = std::move(file);
+    ZETASQL_ASSIGN_OR_RETURN(bool has_row, run.file->Read(&run.row));
+    if (has_row) {
+      heap_.push_back(runs_.size() - 1);
+    }
+  }
+  std::make_heap(heap_.begin(), heap_.end(),
+                 [this](int a, int b) { return RunAfter(a, b); });
+  return absl::OkStatus();
+}
+
+bool ExternalSorter::RunAfter(int a, int b) const {
+  if (SortsBefore(order_, runs_[b].row, runs_[a].row)) {
+    return true;
+  }
+  if (SortsBefore(order_, runs_[a].row, runs_[b].row)) {
+    return false;
+  }
+  return a > b;
+}
+
+absl::StatusOr<bool> ExternalSorter::NextMerged(
+    std::vector<zetasql::Value>* row) {
+  if (heap_.empty()) {
+    return false;
+  }
+  auto run_after = [this](int a, int b) { return RunAfter(a, b); };
+  std::pop_heap(heap_.begin(), heap_.end(), run_after);
+  Run& run = runs_[heap_.back()];
+  *row = std::move(run.row);
+  ZETASQL_ASSIGN_OR_RETURN(bool has_row, run.file->Read(&run.row));
+  if (has_row) {
+    std::push_heap(heap_.begin(), heap_.end(), run_after);
+  } else {
+    heap_.pop_back();
+    run.file.reset();
+  }
+  return true;
+}
+
+absl::StatusOr<bool> ExternalSorter::Next(std::vector<zetasql::Value>* row) {
+  ZETASQL_RET_CHECK(sorted_);
+  if (num_spilled_runs_ > 0) {
+    return NextMerged(row);
+  }
+  if (next_row_ >= rows_.size()) {
+    return false;
+  }
+  *row = std::move(rows_[next_row_++]);
+  return true;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,189 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_EXTERNAL_SORTER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_EXTERNAL_SORTER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// A column by which rows are sorted.
+struct SortColumn {
+  // The position of the column in the rows.
+  int position = 0;
+
+  bool descending = false;
+
+  // NULLs sort before every other value unless nulls_last is set, which
+  // matches the ORDER BY default of ASC NULLS FIRST and DESC NULLS LAST when
+  // it equals descending.
+  bool nulls_last = false;
+};
+
+// Returns whether row a sorts before row b by the columns of order, which have
+// types with a total order under Value::LessThan (see HasKeyEquality).
+bool SortsBefore(const std::vector<SortColumn>& order,
+                 const std::vector<zetasql::Value>& a,
+                 const std::vector<zetasql::Value>& b);
+
+// SpillFile is a temporary file of rows which are written once and then read
+// back in the order they were written. Each value is stored as its serialized
+// size, a 32-bit little endian integer, followed by its serialized ValueProto.
+//
+// The file is removed from its directory as soon as it is created, so that it
+// goes away once the SpillFile is destroyed, even on a crash.
+class SpillFile {
+ public:
+  // Creates an empty spill file in directory, for rows of values of the given
+  // types, which must outlive the file.
+  static absl::StatusOr<std::unique_ptr<SpillFile>> Create(
+      const std::string& directory,
+      std::vector<const zetasql::Type*> column_types);
+
+  ~SpillFile();
+
+  // Appends row to the file. Must not be called once reading has begun.
+  absl::Status Append(const std::vector<zetasql::Value>& row);
+
+  // Reads the next row into row, starting with the first row on the first
+  // call. Returns false once every row has been read.
+  absl::StatusOr<bool> Read(std::vector<zetasql::Value>* row);
+
+  int64_t num_rows() const { return num_rows_; }
+
+ private:
+  SpillFile(std::FILE* file, std::vector<const zetasql::Type*> column_types)
+      : file_(file), column_types_(std::move(column_types)) {}
+
+  std::FILE* file_;
+  std::vector<const zetasql::Type*> column_types_;
+  int64_t num_rows_ = 0;
+  bool reading_ = false;
+};
+
+// ExternalSorter sorts rows which may not fit in memory. Rows are buffered
+// until they use more than Options::memory_budget_bytes, and then sorted and
+// written to a SpillFile as a run. Once every row has been added, the runs are
+// merged, up to kMaxMergeFanIn at a time, with only the next row of each run
+// held in memory. Rows which fit in the budget are sorted without touching
+// disk. Rows which sort the same are returned in the order they were added.
+//
+// The sizes of rows are estimated from the size of their values in memory.
+class ExternalSorter {
+ public:
+  struct Options {
+    // The size of the rows which are kept in memory before they are spilled.
+    int64_t memory_budget_bytes = 64 << 20;
+
+    // The directory in which spill files are created.
+    std::string spill_directory = "/tmp";
+  };
+
+  // The largest number of runs which are merged at once. Runs beyond it are
+  // first merged into longer runs.
+  static constexpr int kMaxMergeFanIn = 64;
+
+  // Sorts rows of values of column_types, which must outlive the sorter, by
+  // the columns of order.
+  ExternalSorter(std::vector<const zetasql::Type*> column_types,
+                 std::vector<SortColumn> order, Options options);
+
+  // Adds row to the rows to sort, spilling the buffered rows once they use
+  // more than the memory budget. Must not be called after Sort.
+  absl::Status Add(std::vector<zetasql::Value> row);
+
+  // Sorts rows, which need not fit in the memory budget, and writes them to a
+  // spill file as a run of their own. The caller is responsible for bounding
+  // the memory of the rows, which is the way a hash aggregation sheds its
+  // partial results: they are combined again by the caller when merged rows
+  // with equal sort columns are returned next to each other.
+  absl::Status Spill(std::vector<std::vector<zetasql::Value>> rows);
+
+  // Ends adding rows, and merges any spilled runs down to kMaxMergeFanIn.
+  absl::Status Sort();
+
+  // Moves the next row in sorted order into row. Returns false once every row
+  // has been returned. Must only be called after Sort.
+  absl::StatusOr<bool> Next(std::vector<zetasql::Value>* row);
+
+  // The number of rows added, and the number of runs spilled to disk.
+  int64_t num_rows() const { return num_rows_; }
+  int num_spilled_runs() const { return num_spilled_runs_; }
+
+ private:
+  // A sorted run which is being merged, with its next row.
+  struct Run {
+    std::unique_ptr<SpillFile> file;
+    std::vector<zetasql::Value> row;
+  };
+
+  // Sorts rows and writes them to a new run.
+  absl::Status WriteRun(std::vector<std::vector<zetasql::Value>>* rows);
+
+  // Opens runs_ for merging, reading the first row of each into heap_.
+  absl::Status StartMerge(std::vector<std::unique_ptr<SpillFile>> files);
+
+  // Returns whether run a should be returned after run b by the heap, which is
+  // the case if its row sorts after b's, or equal but from a later run.
+  bool RunAfter(int a, int b) const;
+
+  // Moves the next row of the merge into row, refilling the heap.
+  absl::StatusOr<bool> NextMerged(std::vector<zetasql::Value>* row);
+
+  const std::vector<const zetasql::Type*> column_types_;
+  const std::vector<SortColumn> order_;
+  const Options options_;
+
+  // Rows added since the last spill, and their estimated size.
+  std::vector<std::vector<zetasql::Value>> rows_;
+  int64_t buffered_bytes_ = 0;
+
+  // The runs spilled so far, oldest first.
+  std::vector<std::unique_ptr<SpillFile>> spilled_;
+
+  // The runs which are merged by Next, and a heap of the positions in runs_ of
+  // those which have rows left.
+  std::vector<Run> runs_;
+  std::vector<int> heap_;
+
+  // The position in rows_ of the next row returned when nothing was spilled.
+  size_t next_row_ = 0;
+
+  bool sorted_ = false;
+  int64_t num_rows_ = 0;
+  int num_spilled_runs_ = 0;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_EXTERNAL_SORTER_H_
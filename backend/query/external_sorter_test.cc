@@ -0,0 +1,131 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/external_sorter.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/statusor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::testing::ElementsAre;
+using zetasql::types::Int64Type;
+using zetasql::types::StringType;
+using zetasql::values::Int64;
+using zetasql::values::NullString;
+using zetasql::values::String;
+
+// Returns every row of a sorted sorter.
+std::vector<std::vector<zetasql::Value>> Drain(ExternalSorter* sorter) {
+  std::vector<std::vector<zetasql::Value>> rows;
+  std::vector<zetasql::Value> row;
+  while (true) {
+    absl::StatusOr<bool> has_row = sorter->Next(&row);
+    EXPECT_TRUE(has_row.ok()) << has_row.status();
+    if (!has_row.ok() || !*has_row) {
+      return rows;
+    }
+    rows.push_back(row);
+  }
+}
+
+ExternalSorter::Options SpillOptions(int64_t memory_budget_bytes) {
+  ExternalSorter::Options options;
+  options.memory_budget_bytes = memory_budget_bytes;
+  options.spill_directory = ::testing::TempDir();
+  return options;
+}
+
+TEST(ExternalSorterTest, SortsRowsInMemory) {
+  // Sort by the string ascending with NULLs first, then by the integer
+  // descending.
+  ExternalSorter sorter({StringType(), Int64Type()},
+                        {SortColumn{.position = 0},
+                         SortColumn{.position = 1,
+                                    .descending = true,
+                                    .nulls_last = true}},
+                        SpillOptions(/*memory_budget_bytes=*/1 << 20));
+  ZETASQL_ASSERT_OK(sorter.Add({String("b"), Int64(1)}));
+  ZETASQL_ASSERT_OK(sorter.Add({String("a"), Int64(1)}));
+  ZETASQL_ASSERT_OK(sorter.Add({NullString(), Int64(7)}));
+  ZETASQL_ASSERT_OK(sorter.Add({String("a"), Int64(2)}));
+  ZETASQL_ASSERT_OK(sorter.Sort());
+  EXPECT_EQ(sorter.num_spilled_runs(), 0);
+  EXPECT_THAT(Drain(&sorter),
+              ElementsAre(ElementsAre(NullString(), Int64(7)),
+                          ElementsAre(String("a"), Int64(2)),
+                          ElementsAre(String("a"), Int64(1)),
+                          ElementsAre(String("b"), Int64(1))));
+}
+
+TEST(ExternalSorterTest, MergesSpilledRunsInOrderOfAddition) {
+  // Every row is spilled as a run of its own, so more runs are spilled than
+  // are merged at once.
+  ExternalSorter sorter({Int64Type(), Int64Type()}, {SortColumn{.position = 0}},
+                        SpillOptions(/*memory_budget_bytes=*/1));
+  const int num_rows = 3 * ExternalSorter::kMaxMergeFanIn;
+  for (int i = 0; i < num_rows; ++i) {
+    ZETASQL_ASSERT_OK(sorter.Add({Int64(i % 3), Int64(i)}));
+  }
+  ZETASQL_ASSERT_OK(sorter.Sort());
+  EXPECT_EQ(sorter.num_rows(), num_rows);
+  EXPECT_EQ(sorter.num_spilled_runs(), num_rows);
+
+  std::vector<std::vector<zetasql::Value>> rows = Drain(&sorter);
+  ASSERT_EQ(rows.size(), num_rows);
+  for (int i = 1; i < num_rows; ++i) {
+    // Rows with the same sort column keep the order they were added in.
+    EXPECT_TRUE(rows[i - 1][0].int64_value() < rows[i][0].int64_value() ||
+                (rows[i - 1][0].int64_value() == rows[i][0].int64_value() &&
+                 rows[i - 1][1].int64_value() < rows[i][1].int64_value()));
+  }
+}
+
+TEST(ExternalSorterTest, MergesRunsSpilledByCaller) {
+  ExternalSorter sorter({StringType(), Int64Type()},
+                        {SortColumn{.position = 0}},
+                        SpillOptions(/*memory_budget_bytes=*/1 << 20));
+  ZETASQL_ASSERT_OK(
+      sorter.Spill({{String("b"), Int64(1)}, {String("a"), Int64(2)}}));
+  ZETASQL_ASSERT_OK(
+      sorter.Spill({{NullString(), Int64(3)}, {String("b"), Int64(4)}}));
+  ZETASQL_ASSERT_OK(sorter.Sort());
+  EXPECT_EQ(sorter.num_spilled_runs(), 2);
+  EXPECT_THAT(Drain(&sorter),
+              ElementsAre(ElementsAre(NullString(), Int64(3)),
+                          ElementsAre(String("a"), Int64(2)),
+                          ElementsAre(String("b"), Int64(1)),
+                          ElementsAre(String("b"), Int64(4))));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -56,20 +56,31 @@ const int QuerySizeLimitsChecker::kMaxParameters = 950;
 const int QuerySizeLimitsChecker::kMaxStructFields = 1000;
 const int QuerySizeLimitsChecker::kMaxNestedStructDepth = 15;
 
+namespace {
+
+// Returns true if the global checks need the counts of nodes of `kind`.
+bool IsCountedNodeKind(ResolvedNodeKind kind) {
+  switch (kind) {
+    case ResolvedNodeKind::RESOLVED_JOIN_SCAN:
+    case ResolvedNodeKind::RESOLVED_PROJECT_SCAN:
+    case ResolvedNodeKind::RESOLVED_SUBQUERY_EXPR:
+    case ResolvedNodeKind::RESOLVED_AGGREGATE_SCAN:
+    case ResolvedNodeKind::RESOLVED_FUNCTION_CALL:
+    case ResolvedNodeKind::RESOLVED_PARAMETER:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
 absl::Status QuerySizeLimitsChecker::CheckQueryAgainstLimits(
     const ResolvedNode* ast_root) {
-  std::set<ResolvedNodeKind> interest_nodes;
-  interest_nodes.insert(ResolvedNodeKind::RESOLVED_JOIN_SCAN);
-  interest_nodes.insert(ResolvedNodeKind::RESOLVED_PROJECT_SCAN);
-  interest_nodes.insert(ResolvedNodeKind::RESOLVED_SUBQUERY_EXPR);
-  interest_nodes.insert(ResolvedNodeKind::RESOLVED_AGGREGATE_SCAN);
-  interest_nodes.insert(ResolvedNodeKind::RESOLVED_FUNCTION_CALL);
-  interest_nodes.insert(ResolvedNodeKind::RESOLVED_PARAMETER);
-  std::map<ResolvedNodeKind, NodeCounts> collected_node_counts;
-  ZETASQL_RETURN_IF_ERROR(GetNodeMetricsAndRunLocalChecks(ast_root, interest_nodes,
-                                                  &collected_node_counts));
-  ZETASQL_RETURN_IF_ERROR(RunGlobalChecks(collected_node_counts));
-  return absl::OkStatus();
+  collected_node_counts_.clear();
+  local_checks_status_ = absl::OkStatus();
+  CheckSubtree(ast_root, /*depth=*/0);
+  return Finish();
 }
 
 absl::Status QuerySizeLimitsChecker::CheckNumPredicates(
@@ -296,49 +307,32 @@ absl::Status QuerySizeLimitsChecker::RunNodeLocalChecks(
   return absl::OkStatus();
 }
 
-absl::Status QuerySizeLimitsChecker::GetNodeMetricsAndRunLocalChecks(
-    const ResolvedNode* ast_root,
-    const std::set<ResolvedNodeKind>& interest_nodes,
-    std::map<ResolvedNodeKind, NodeCounts>* collected_node_counts) {
-  std::queue<const ResolvedNode*> node_queue;
-  node_queue.push(ast_root);
-  node_queue.push(nullptr);
-  int tree_depth = 0;
-  while (!node_queue.empty()) {
-    const ResolvedNode* node = node_queue.front();
-    node_queue.pop();
-    if (node == nullptr) {
-      if (!node_queue.empty()) {
-        node_queue.push(nullptr);
-        tree_depth++;
-      }
-      continue;
-    }
-    if (interest_nodes.find(node->node_kind()) != interest_nodes.end()) {
-      auto it = collected_node_counts->find(node->node_kind());
-      if (it != collected_node_counts->end()) {
-        NodeCounts& count_info = it->second;
-        count_info.total_occurrences++;
-        if (tree_depth > count_info.max_occurrence_depth) {
-          count_info.nested_occurrences++;
-        }
-        count_info.max_occurrence_depth = tree_depth;
-      } else {
-        NodeCounts node_counts;
-        node_counts.max_occurrence_depth = tree_depth;
-        node_counts.nested_occurrences = 1;
-        node_counts.total_occurrences = 1;
-        (*collected_node_counts)[node->node_kind()] = node_counts;
-      }
-    }
-    ZETASQL_RETURN_IF_ERROR(RunNodeLocalChecks(node));
-    std::vector<const ResolvedNode*> child_nodes;
-    node->GetChildNodes(&child_nodes);
-    for (const ResolvedNode* child_node : child_nodes) {
-      node_queue.push(child_node);
+void QuerySizeLimitsChecker::CheckNode(const ResolvedNode* node, int depth) {
+  if (IsCountedNodeKind(node->node_kind())) {
+    NodeCounts& count_info = collected_node_counts_[node->node_kind()];
+    count_info.total_occurrences++;
+    if (count_info.occurrence_depths.insert(depth).second) {
+      count_info.nested_occurrences++;
     }
   }
-  return absl::OkStatus();
+  if (local_checks_status_.ok()) {
+    local_checks_status_ = RunNodeLocalChecks(node);
+  }
+}
+
+absl::Status QuerySizeLimitsChecker::Finish() {
+  ZETASQL_RETURN_IF_ERROR(local_checks_status_);
+  return RunGlobalChecks(collected_node_counts_);
+}
+
+void QuerySizeLimitsChecker::CheckSubtree(const ResolvedNode* node,
+                                          int depth) {
+  CheckNode(node, depth);
+  std::vector<const ResolvedNode*> child_nodes;
+  node->GetChildNodes(&child_nodes);
+  for (const ResolvedNode* child_node : child_nodes) {
+    CheckSubtree(child_node, depth + 1);
+  }
 }
 
 }  // namespace google::spanner::emulator::backend
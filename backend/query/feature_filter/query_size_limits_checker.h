@@ -24,13 +24,24 @@
 #include "zetasql/resolved_ast/resolved_node.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "absl/status/status.h"
+#include "backend/query/resolved_node_checker.h"
 
 namespace google::spanner::emulator::backend {
 
-class QuerySizeLimitsChecker {
+// Checks a query against the query size limits of Cloud Spanner. The checker
+// can walk a tree by itself with CheckQueryAgainstLimits(), or be registered as
+// a node checker with the QueryValidator and report the outcome from Finish().
+class QuerySizeLimitsChecker : public ResolvedNodeChecker {
  public:
   absl::Status CheckQueryAgainstLimits(const zetasql::ResolvedNode* ast_root);
   virtual ~QuerySizeLimitsChecker() {}
+
+  // Counts `node` and runs the checks which only need the node itself.
+  void CheckNode(const zetasql::ResolvedNode* node, int depth) override;
+
+  // Runs the checks which need the counts of the whole tree.
+  absl::Status Finish() override;
+
   static const int kMaxJoins;
   static const int kMaxNestedSubqueryExpressions;
   static const int kMaxNestedSubselects;
@@ -46,14 +57,12 @@ class QuerySizeLimitsChecker {
 
  private:
   struct NodeCounts {
-    int max_occurrence_depth;
-    int total_occurrences;
-    int nested_occurrences;
+    // Distinct depths in the tree at which the node kind occurs.
+    std::set<int> occurrence_depths;
+    int total_occurrences = 0;
+    int nested_occurrences = 0;
   };
-  absl::Status GetNodeMetricsAndRunLocalChecks(
-      const zetasql::ResolvedNode* ast_root,
-      const std::set<zetasql::ResolvedNodeKind>& interest_nodes,
-      std::map<zetasql::ResolvedNodeKind, NodeCounts>* collected_node_counts);
+  void CheckSubtree(const zetasql::ResolvedNode* node, int depth);
   absl::Status CheckNumPredicates(
       const std::map<zetasql::ResolvedNodeKind, NodeCounts>&
           collected_node_counts);
@@ -85,6 +94,12 @@ class QuerySizeLimitsChecker {
   absl::Status CheckNumSubQueriesInSelectList(
       const zetasql::ResolvedNode* node);
   absl::Status RunNodeLocalChecks(const zetasql::ResolvedNode* node);
+
+  // Counts of the node kinds that the global checks are interested in.
+  std::map<zetasql::ResolvedNodeKind, NodeCounts> collected_node_counts_;
+
+  // The first error returned by the node local checks.
+  absl::Status local_checks_status_;
 };
 
 }  // namespace google::spanner::emulator::backend
@@ -80,6 +80,13 @@ FunctionCatalog::FunctionCatalog(zetasql::TypeFactory* type_factory,
   AddFunctionAliases();
 }
 
+const FunctionCatalog* FunctionCatalog::Default() {
+  static zetasql::TypeFactory* const type_factory = new zetasql::TypeFactory();
+  static const FunctionCatalog* const catalog =
+      new FunctionCatalog(type_factory);
+  return catalog;
+}
+
 void FunctionCatalog::AddZetaSQLBuiltInFunctions(
     zetasql::TypeFactory* type_factory) {
   // Get all the ZetaSQL built-in functions.
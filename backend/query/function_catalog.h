@@ -44,6 +44,12 @@ class FunctionCatalog {
   explicit FunctionCatalog(
       zetasql::TypeFactory* type_factory,
       const std::string& catalog_name = kCloudSpannerEmulatorFunctionCatalog);
+
+  // Returns the catalog shared by all databases in the process. Functions are
+  // immutable once registered, and the types in their signatures are owned by
+  // a TypeFactory which lives as long as the catalog, so it can be used from
+  // any thread and with types from any other TypeFactory.
+  static const FunctionCatalog* Default();
   void GetFunction(const std::string& name,
                    const zetasql::Function** output) const;
   void GetFunctions(
@@ -0,0 +1,548 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/grouped_aggregate.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/external_sorter.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/query/simple_select.h"
+#include "backend/schema/catalog/column.h"
+#include "common/errors.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of rows aggregated between checks for the cancellation of the
+// request.
+constexpr int64_t kCancellationCheckRows = 1024;
+
+// The estimated memory used by a group in the hash table beyond its key and
+// aggregated values.
+constexpr int64_t kGroupOverheadBytes = 64;
+
+// Returns the order of spilled rows, by their leading grouping columns.
+std::vector<SortColumn> GroupOrder(int num_group_columns) {
+  std::vector<SortColumn> order(num_group_columns);
+  for (int i = 0; i < num_group_columns; ++i) {
+    order[i].position = i;
+  }
+  return order;
+}
+
+}  // namespace
+
+// A cursor over the groups of the result, either computed in memory or merged
+// from the runs spilled to a sorter as the cursor is iterated.
+class GroupedAggregate::MergingCursor : public RowCursor {
+ public:
+  // Returns the given rows of the result.
+  MergingCursor(const Layout& layout,
+                std::vector<std::vector<zetasql::Value>> rows)
+      : layout_(layout), rows_(std::move(rows)) {}
+
+  // Returns the groups merged from sorter, which is sorted.
+  MergingCursor(const Layout& layout, std::unique_ptr<ExternalSorter> sorter)
+      : layout_(layout),
+        order_(GroupOrder(layout.num_group_columns)),
+        sorter_(std::move(sorter)) {}
+
+  bool Next() override {
+    if (sorter_ == nullptr) {
+      if (next_row_ >= rows_.size()) {
+        return false;
+      }
+      row_ = std::move(rows_[next_row_++]);
+      return true;
+    }
+    if (!status_.ok()) {
+      return false;
+    }
+    absl::StatusOr<bool> has_row = NextGroup();
+    if (!has_row.ok()) {
+      status_ = has_row.status();
+      return false;
+    }
+    return *has_row;
+  }
+
+  absl::Status Status() const override { return status_; }
+
+  int NumColumns() const override {
+    return layout_.output_column_names.size();
+  }
+
+  const std::string ColumnName(int i) const override {
+    return layout_.output_column_names[i];
+  }
+
+  const zetasql::Type* ColumnType(int i) const override {
+    return layout_.output_column_types[i];
+  }
+
+  const zetasql::Value ColumnValue(int i) const override { return row_[i]; }
+
+ private:
+  // Combines the partial aggregates of the spilled rows of the next group into
+  // row_.
+  absl::StatusOr<bool> NextGroup() {
+    if (!has_pending_) {
+      ZETASQL_ASSIGN_OR_RETURN(has_pending_, sorter_->Next(&pending_));
+      if (!has_pending_) {
+        return false;
+      }
+    }
+    std::vector<zetasql::Value> first = std::move(pending_);
+    std::vector<Accumulator> accumulators;
+    const int num_aggregates = layout_.aggregates.size();
+    for (int j = 0; j < num_aggregates; ++j) {
+      accumulators.push_back(ReadPartial(
+          first, layout_.num_group_columns + j * kAccumulatorColumns));
+    }
+    while (true) {
+      ZETASQL_ASSIGN_OR_RETURN(has_pending_, sorter_->Next(&pending_));
+      if (!has_pending_ || SortsBefore(order_, first, pending_)) {
+        break;
+      }
+      for (int j = 0; j < num_aggregates; ++j) {
+        Merge(layout_.aggregates[j],
+              ReadPartial(pending_,
+                          layout_.num_group_columns + j * kAccumulatorColumns),
+              &accumulators[j]);
+      }
+    }
+    first.resize(layout_.num_group_columns);
+    std::optional<std::vector<zetasql::Value>> row =
+        OutputRow(layout_, first, accumulators);
+    if (!row.has_value()) {
+      return error::SumOverflow();
+    }
+    row_ = *std::move(row);
+    return true;
+  }
+
+  const Layout layout_;
+  const std::vector<SortColumn> order_;
+
+  // The rows of the result, when nothing was spilled.
+  std::vector<std::vector<zetasql::Value>> rows_;
+  size_t next_row_ = 0;
+
+  // The sorter of the spilled groups, and the first row of the next group read
+  // from it, if has_pending_.
+  std::unique_ptr<ExternalSorter> sorter_;
+  std::vector<zetasql::Value> pending_;
+  bool has_pending_ = false;
+
+  std::vector<zetasql::Value> row_;
+  absl::Status status_;
+};
+
+std::unique_ptr<const GroupedAggregate> GroupedAggregate::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT ||
+      !statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  if (query_stmt->is_value_table()) {
+    return nullptr;
+  }
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() == zetasql::RESOLVED_PROJECT_SCAN) {
+    const auto* project_scan = scan->GetAs<zetasql::ResolvedProjectScan>();
+    if (!project_scan->expr_list().empty() ||
+        !project_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = project_scan->input_scan();
+  }
+  if (scan->node_kind() != zetasql::RESOLVED_AGGREGATE_SCAN) {
+    return nullptr;
+  }
+  const auto* aggregate_scan = scan->GetAs<zetasql::ResolvedAggregateScan>();
+  if (!aggregate_scan->hint_list().empty() ||
+      aggregate_scan->group_by_list().empty() ||
+      !aggregate_scan->grouping_set_list().empty()) {
+    return nullptr;
+  }
+  absl::flat_hash_map<int, const Column*> scanned_columns;
+  const QueryableTable* queryable_table =
+      MatchTableScan(aggregate_scan->input_scan(), &scanned_columns);
+  if (queryable_table == nullptr) {
+    return nullptr;
+  }
+
+  auto grouped_aggregate = absl::WrapUnique(new GroupedAggregate());
+  grouped_aggregate->table_name_ = queryable_table->Name();
+  Layout& layout = grouped_aggregate->layout_;
+  auto read_position = [&](const Column* column) {
+    auto& names = grouped_aggregate->read_column_names_;
+    auto itr = std::find(names.begin(), names.end(), column->Name());
+    if (itr != names.end()) {
+      return static_cast<int>(itr - names.begin());
+    }
+    names.push_back(column->Name());
+    return static_cast<int>(names.size()) - 1;
+  };
+  // Maps columns computed by the aggregate scan to the output columns which
+  // return them.
+  absl::flat_hash_map<int, OutputColumn> computed_columns;
+
+  for (const auto& computed_column : aggregate_scan->group_by_list()) {
+    const zetasql::ResolvedExpr* expr = computed_column->expr();
+    if (expr->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+      return nullptr;
+    }
+    auto column_itr = scanned_columns.find(
+        expr->GetAs<zetasql::ResolvedColumnRef>()->column().column_id());
+    // Groups are spilled in sorted order, which Value::LessThan does not give
+    // floating point values.
+    if (column_itr == scanned_columns.end() ||
+        !HasKeyEquality(column_itr->second->GetType())) {
+      return nullptr;
+    }
+    computed_columns[computed_column->column().column_id()] = {
+        .is_group = true, .index = layout.num_group_columns++};
+    grouped_aggregate->group_positions_.push_back(
+        read_position(column_itr->second));
+    layout.spill_column_types.push_back(column_itr->second->GetType());
+  }
+
+  for (const auto& computed_column : aggregate_scan->aggregate_list()) {
+    if (computed_column->node_kind() != zetasql::RESOLVED_COMPUTED_COLUMN ||
+        computed_column->GetAs<zetasql::ResolvedComputedColumn>()
+                ->expr()
+                ->node_kind() != zetasql::RESOLVED_AGGREGATE_FUNCTION_CALL) {
+      return nullptr;
+    }
+    const auto* call =
+        computed_column->GetAs<zetasql::ResolvedComputedColumn>()
+            ->expr()
+            ->GetAs<zetasql::ResolvedAggregateFunctionCall>();
+    if (!call->function()->IsZetaSQLBuiltin() || call->distinct() ||
+        call->null_handling_modifier() !=
+            zetasql::ResolvedNonScalarFunctionCallBase::
+                DEFAULT_NULL_HANDLING ||
+        call->having_modifier() != nullptr ||
+        !call->order_by_item_list().empty() || call->limit() != nullptr ||
+        !call->hint_list().empty() ||
+        call->error_mode() !=
+            zetasql::ResolvedFunctionCallBase::DEFAULT_ERROR_MODE) {
+      return nullptr;
+    }
+
+    Aggregate aggregate;
+    aggregate.type = zetasql::types::Int64Type();
+    const std::string& name = call->function()->Name();
+    if (name == "$count_star" && call->argument_list().empty()) {
+      aggregate.kind = Kind::kCountStar;
+    } else {
+      if (call->argument_list_size() != 1 ||
+          call->argument_list(0)->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+        return nullptr;
+      }
+      auto column_itr = scanned_columns.find(
+          call->argument_list(0)
+              ->GetAs<zetasql::ResolvedColumnRef>()
+              ->column()
+              .column_id());
+      if (column_itr == scanned_columns.end()) {
+        return nullptr;
+      }
+      const zetasql::Type* type = column_itr->second->GetType();
+      if (name == "count") {
+        aggregate.kind = Kind::kCount;
+      } else if (name == "sum" && type->IsInt64()) {
+        aggregate.kind = Kind::kSum;
+      } else if ((name == "min" || name == "max") && HasKeyEquality(type)) {
+        aggregate.kind = name == "min" ? Kind::kMin : Kind::kMax;
+        aggregate.type = type;
+      } else {
+        return nullptr;
+      }
+      aggregate.position = read_position(column_itr->second);
+    }
+    computed_columns[computed_column->column().column_id()] = {
+        .is_group = false, .index = static_cast<int>(layout.aggregates.size())};
+    layout.aggregates.push_back(aggregate);
+    layout.spill_column_types.insert(
+        layout.spill_column_types.end(),
+        {zetasql::types::Int64Type(), zetasql::types::Int64Type(),
+         zetasql::types::BoolType(), aggregate.type});
+  }
+
+  // The output columns may name the grouping columns and aggregates in any
+  // order.
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    auto itr = computed_columns.find(output_column->column().column_id());
+    if (itr == computed_columns.end()) {
+      return nullptr;
+    }
+    layout.output_columns.push_back(itr->second);
+    layout.output_column_names.push_back(output_column->name());
+    layout.output_column_types.push_back(output_column->column().type());
+  }
+  return grouped_aggregate;
+}
+
+void GroupedAggregate::Accumulate(const Aggregate& aggregate,
+                                  const zetasql::Value& argument,
+                                  Accumulator* accumulator) {
+  if (aggregate.kind == Kind::kCountStar) {
+    ++accumulator->count;
+    return;
+  }
+  if (argument.is_null()) {
+    return;
+  }
+  ++accumulator->count;
+  switch (aggregate.kind) {
+    case Kind::kSum:
+      accumulator->overflowed |= __builtin_add_overflow(
+          accumulator->sum, argument.int64_value(), &accumulator->sum);
+      break;
+    case Kind::kMin:
+      if (!accumulator->value.is_valid() ||
+          argument.LessThan(accumulator->value)) {
+        accumulator->value = argument;
+      }
+      break;
+    case Kind::kMax:
+      if (!accumulator->value.is_valid() ||
+          accumulator->value.LessThan(argument)) {
+        accumulator->value = argument;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void GroupedAggregate::Merge(const Aggregate& aggregate,
+                             const Accumulator& partial,
+                             Accumulator* accumulator) {
+  accumulator->count += partial.count;
+  switch (aggregate.kind) {
+    case Kind::kSum:
+      accumulator->overflowed |=
+          partial.overflowed ||
+          __builtin_add_overflow(accumulator->sum, partial.sum,
+                                 &accumulator->sum);
+      break;
+    case Kind::kMin:
+      if (partial.value.is_valid() &&
+          (!accumulator->value.is_valid() ||
+           partial.value.LessThan(accumulator->value))) {
+        accumulator->value = partial.value;
+      }
+      break;
+    case Kind::kMax:
+      if (partial.value.is_valid() &&
+          (!accumulator->value.is_valid() ||
+           accumulator->value.LessThan(partial.value))) {
+        accumulator->value = partial.value;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void GroupedAggregate::AppendPartial(const Aggregate& aggregate,
+                                     const Accumulator& accumulator,
+                                     std::vector<zetasql::Value>* row) {
+  row->push_back(zetasql::values::Int64(accumulator.count));
+  row->push_back(zetasql::values::Int64(accumulator.sum));
+  row->push_back(zetasql::values::Bool(accumulator.overflowed));
+  // MIN and MAX ignore NULL arguments, so a NULL value means there was none.
+  row->push_back(accumulator.value.is_valid()
+                     ? accumulator.value
+                     : zetasql::Value::Null(aggregate.type));
+}
+
+GroupedAggregate::Accumulator GroupedAggregate::ReadPartial(
+    const std::vector<zetasql::Value>& row, int offset) {
+  Accumulator accumulator;
+  accumulator.count = row[offset].int64_value();
+  accumulator.sum = row[offset + 1].int64_value();
+  accumulator.overflowed = row[offset + 2].bool_value();
+  if (!row[offset + 3].is_null()) {
+    accumulator.value = row[offset + 3];
+  }
+  return accumulator;
+}
+
+std::optional<std::vector<zetasql::Value>> GroupedAggregate::OutputRow(
+    const Layout& layout, const std::vector<zetasql::Value>& key,
+    const std::vector<Accumulator>& accumulators) {
+  std::vector<zetasql::Value> row;
+  row.reserve(layout.output_columns.size());
+  for (int i = 0; i < layout.output_columns.size(); ++i) {
+    const OutputColumn& column = layout.output_columns[i];
+    if (column.is_group) {
+      row.push_back(key[column.index]);
+      continue;
+    }
+    const Accumulator& result = accumulators[column.index];
+    switch (layout.aggregates[column.index].kind) {
+      case Kind::kCountStar:
+      case Kind::kCount:
+        row.push_back(zetasql::values::Int64(result.count));
+        break;
+      case Kind::kSum:
+        if (result.overflowed) {
+          return std::nullopt;
+        }
+        row.push_back(result.count == 0 ? zetasql::values::NullInt64()
+                                        : zetasql::values::Int64(result.sum));
+        break;
+      case Kind::kMin:
+      case Kind::kMax:
+        row.push_back(
+            result.value.is_valid()
+                ? result.value
+                : zetasql::Value::Null(layout.output_column_types[i]));
+        break;
+    }
+  }
+  return row;
+}
+
+absl::StatusOr<bool> GroupedAggregate::Execute(
+    RowReader* reader, const ExternalSorter::Options& options,
+    std::unique_ptr<RowCursor>* cursor, int64_t* num_rows) const {
+  ReadArg read_arg;
+  read_arg.table = table_name_;
+  read_arg.key_set = KeySet::All();
+  read_arg.columns = read_column_names_;
+  std::unique_ptr<RowCursor> table_cursor;
+  ZETASQL_RETURN_IF_ERROR(reader->Read(read_arg, &table_cursor));
+
+  auto sorter = std::make_unique<ExternalSorter>(
+      layout_.spill_column_types, GroupOrder(layout_.num_group_columns),
+      options);
+  absl::flat_hash_map<std::vector<zetasql::Value>, std::vector<Accumulator>>
+      groups;
+  int64_t group_bytes = 0;
+  // Sorts the groups aggregated so far into a run of partial aggregates.
+  auto spill = [&]() {
+    std::vector<std::vector<zetasql::Value>> rows;
+    rows.reserve(groups.size());
+    for (auto& [key, accumulators] : groups) {
+      std::vector<zetasql::Value>& row = rows.emplace_back(key);
+      for (int j = 0; j < layout_.aggregates.size(); ++j) {
+        AppendPartial(layout_.aggregates[j], accumulators[j], &row);
+      }
+    }
+    groups.clear();
+    group_bytes = 0;
+    return sorter->Spill(std::move(rows));
+  };
+
+  const zetasql::Value no_argument;
+  std::vector<zetasql::Value> key;
+  int64_t num_read_rows = 0;
+  while (table_cursor->Next()) {
+    if (++num_read_rows % kCancellationCheckRows == 0) {
+      ZETASQL_RETURN_IF_ERROR(reader->CheckNotCancelled());
+    }
+    key.clear();
+    for (int position : group_positions_) {
+      key.push_back(table_cursor->ColumnValue(position));
+    }
+    auto [itr, inserted] =
+        groups.try_emplace(key, layout_.aggregates.size(), Accumulator());
+    std::vector<Accumulator>& accumulators = itr->second;
+    for (int j = 0; j < layout_.aggregates.size(); ++j) {
+      const Aggregate& aggregate = layout_.aggregates[j];
+      Accumulate(aggregate,
+                 aggregate.position < 0
+                     ? no_argument
+                     : table_cursor->ColumnValue(aggregate.position),
+                 &accumulators[j]);
+    }
+    // A group's MIN and MAX values are counted once, by the size of the first
+    // ones, which tracks their size well enough for a budget.
+    if (inserted) {
+      group_bytes += kGroupOverheadBytes +
+                     accumulators.size() * sizeof(Accumulator);
+      for (const zetasql::Value& value : key) {
+        group_bytes += value.physical_byte_size();
+      }
+      for (const Accumulator& accumulator : accumulators) {
+        if (accumulator.value.is_valid()) {
+          group_bytes += accumulator.value.physical_byte_size();
+        }
+      }
+      if (group_bytes > options.memory_budget_bytes) {
+        ZETASQL_RETURN_IF_ERROR(spill());
+      }
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(table_cursor->Status());
+
+  if (sorter->num_spilled_runs() == 0) {
+    std::vector<std::vector<zetasql::Value>> rows;
+    rows.reserve(groups.size());
+    for (const auto& [key, accumulators] : groups) {
+      std::optional<std::vector<zetasql::Value>> row =
+          OutputRow(layout_, key, accumulators);
+      if (!row.has_value()) {
+        return false;
+      }
+      rows.push_back(*std::move(row));
+    }
+    *num_rows = rows.size();
+    *cursor = std::make_unique<MergingCursor>(layout_, std::move(rows));
+    return true;
+  }
+  if (!groups.empty()) {
+    ZETASQL_RETURN_IF_ERROR(spill());
+  }
+  ZETASQL_RETURN_IF_ERROR(sorter->Sort());
+  *num_rows = 0;
+  *cursor = std::make_unique<MergingCursor>(layout_, std::move(sorter));
+  return true;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,166 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_GROUPED_AGGREGATE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_GROUPED_AGGREGATE_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/query/external_sorter.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// GroupedAggregate is a query which aggregates the rows of a table grouped by
+// some of its columns, so that it can be executed by a hash aggregation whose
+// memory is bounded, instead of by the ZetaSQL evaluator, which keeps every
+// group in memory.
+//
+// It matches statements of the form
+//
+//   SELECT <group columns and aggregates> FROM <table> GROUP BY <columns>
+//
+// in which the aggregates are those matched by ParallelAggregate: COUNT(*), or
+// COUNT, SUM of INT64, MIN or MAX of a column of the table. Statements with
+// hints, floating point grouping columns or any other expression do not match.
+//
+// Groups are aggregated in a hash table until their partial aggregates use
+// more than the memory budget, at which point they are sorted by group and
+// spilled to disk by an ExternalSorter, and the hash table starts over. The
+// spilled runs are merged as the result is read, combining the partial
+// aggregates of each group. Groups are returned in an unspecified order.
+class GroupedAggregate {
+ public:
+  // Returns the GroupedAggregate equivalent to statement, or nullptr if
+  // statement is not of the form above.
+  static std::unique_ptr<const GroupedAggregate> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  const std::vector<std::string>& output_column_names() const {
+    return layout_.output_column_names;
+  }
+  const std::vector<const zetasql::Type*>& output_column_types() const {
+    return layout_.output_column_types;
+  }
+
+  // Reads every row of the table through reader and aggregates them, returning
+  // a cursor over the groups in cursor. num_rows is set to the number of
+  // groups if they all fit in memory, and to 0 otherwise. The cursor merges
+  // spilled groups as it is iterated, and does not use reader.
+  //
+  // Returns false if a SUM overflows before anything is spilled, in which case
+  // the query must be evaluated to report the error. Once groups are spilled,
+  // the cursor fails with OUT_OF_RANGE instead.
+  absl::StatusOr<bool> Execute(RowReader* reader,
+                               const ExternalSorter::Options& options,
+                               std::unique_ptr<RowCursor>* cursor,
+                               int64_t* num_rows) const;
+
+ private:
+  class MergingCursor;
+
+  enum class Kind { kCountStar, kCount, kSum, kMin, kMax };
+
+  struct Aggregate {
+    Kind kind;
+
+    // The position of the argument in read_column_names_, or -1 for
+    // COUNT(*), and its type, which is INT64 for COUNT(*).
+    int position = -1;
+    const zetasql::Type* type = nullptr;
+  };
+
+  // The partial result of an aggregate over some of the rows of a group.
+  struct Accumulator {
+    int64_t count = 0;
+    int64_t sum = 0;
+    bool overflowed = false;
+    zetasql::Value value;
+  };
+
+  // A column of the result: a grouping column or an aggregate, by its position
+  // in the group key or in the aggregates.
+  struct OutputColumn {
+    bool is_group = false;
+    int index = 0;
+  };
+
+  // The shape of the partial and final results, which is shared with the
+  // cursors over the groups.
+  struct Layout {
+    std::vector<Aggregate> aggregates;
+    std::vector<OutputColumn> output_columns;
+    std::vector<std::string> output_column_names;
+    std::vector<const zetasql::Type*> output_column_types;
+
+    // The types of the grouping columns followed by those of the partial
+    // aggregates, as rows are spilled.
+    std::vector<const zetasql::Type*> spill_column_types;
+    int num_group_columns = 0;
+  };
+
+  // The number of columns of a spilled row which hold each Accumulator.
+  static constexpr int kAccumulatorColumns = 4;
+
+  GroupedAggregate() = default;
+
+  static void Accumulate(const Aggregate& aggregate,
+                         const zetasql::Value& argument,
+                         Accumulator* accumulator);
+  static void Merge(const Aggregate& aggregate, const Accumulator& partial,
+                    Accumulator* accumulator);
+
+  // Appends accumulator to a spilled row, and reads one back from the columns
+  // of a spilled row starting at offset.
+  static void AppendPartial(const Aggregate& aggregate,
+                            const Accumulator& accumulator,
+                            std::vector<zetasql::Value>* row);
+  static Accumulator ReadPartial(const std::vector<zetasql::Value>& row,
+                                 int offset);
+
+  // Returns the row of the result for the group with the given key and
+  // aggregates, or nullopt if a SUM overflowed.
+  static std::optional<std::vector<zetasql::Value>> OutputRow(
+      const Layout& layout, const std::vector<zetasql::Value>& key,
+      const std::vector<Accumulator>& accumulators);
+
+  std::string table_name_;
+  std::vector<std::string> read_column_names_;
+
+  // The positions in read_column_names_ of the grouping columns.
+  std::vector<int> group_positions_;
+
+  Layout layout_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_GROUPED_AGGREGATE_H_
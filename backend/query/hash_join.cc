@@ -0,0 +1,330 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/hash_join.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/query/simple_select.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of rows read from either table between checks for the
+// cancellation of the request.
+constexpr int64_t kCancellationCheckRows = 1024;
+
+// The join hints which HashJoin honors. The deprecated JOIN_TYPE hint is an
+// alias of JOIN_METHOD.
+constexpr absl::string_view kHintJoinMethod = "join_method";
+constexpr absl::string_view kHintJoinTypeDeprecated = "join_type";
+constexpr absl::string_view kHintJoinTypeHash = "hash_join";
+constexpr absl::string_view kHashJoinBuildSide = "hash_join_build_side";
+constexpr absl::string_view kHashJoinBuildSideLeft = "build_left";
+
+// Returns the string value of a hint, or nullopt if it is not a string
+// literal.
+std::optional<std::string> StringHintValue(
+    const zetasql::ResolvedOption* hint) {
+  if (hint->value()->node_kind() != zetasql::RESOLVED_LITERAL) {
+    return std::nullopt;
+  }
+  const zetasql::Value& value =
+      hint->value()->GetAs<zetasql::ResolvedLiteral>()->value();
+  if (!value.type()->IsString() || value.is_null()) {
+    return std::nullopt;
+  }
+  return value.string_value();
+}
+
+// Reads the joined columns of the row at cursor into key. Returns false if any
+// of them is NULL, which the evaluator never finds equal to another value.
+bool JoinKey(const RowCursor& cursor, const std::vector<int>& positions,
+             std::vector<zetasql::Value>* key) {
+  key->clear();
+  key->reserve(positions.size());
+  for (int position : positions) {
+    key->push_back(cursor.ColumnValue(position));
+    if (key->back().is_null()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<const HashJoin> HashJoin::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT ||
+      !statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  if (query_stmt->is_value_table()) {
+    return nullptr;
+  }
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() == zetasql::RESOLVED_PROJECT_SCAN) {
+    const auto* project_scan = scan->GetAs<zetasql::ResolvedProjectScan>();
+    if (!project_scan->expr_list().empty() ||
+        !project_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = project_scan->input_scan();
+  }
+  if (scan->node_kind() != zetasql::RESOLVED_JOIN_SCAN) {
+    return nullptr;
+  }
+  const auto* join_scan = scan->GetAs<zetasql::ResolvedJoinScan>();
+  if (join_scan->join_type() != zetasql::ResolvedJoinScan::INNER ||
+      join_scan->join_expr() == nullptr) {
+    return nullptr;
+  }
+
+  auto join = absl::WrapUnique(new HashJoin());
+
+  // Hints which do not change how the join is executed, such as
+  // FORCE_JOIN_ORDER, are ignored; the query validator has already rejected
+  // invalid ones.
+  for (const auto& hint : join_scan->hint_list()) {
+    if (!hint->qualifier().empty() && hint->qualifier() != "spanner") {
+      continue;
+    }
+    if (absl::EqualsIgnoreCase(hint->name(), kHintJoinMethod) ||
+        absl::EqualsIgnoreCase(hint->name(), kHintJoinTypeDeprecated)) {
+      std::optional<std::string> method = StringHintValue(hint.get());
+      if (!method.has_value() ||
+          !absl::EqualsIgnoreCase(*method, kHintJoinTypeHash)) {
+        return nullptr;
+      }
+    } else if (absl::EqualsIgnoreCase(hint->name(), kHashJoinBuildSide)) {
+      std::optional<std::string> side = StringHintValue(hint.get());
+      if (!side.has_value()) {
+        return nullptr;
+      }
+      join->build_side_ = absl::EqualsIgnoreCase(*side, kHashJoinBuildSideLeft)
+                              ? BuildSide::kLeft
+                              : BuildSide::kRight;
+    }
+  }
+
+  absl::flat_hash_map<int, const Column*> left_columns;
+  absl::flat_hash_map<int, const Column*> right_columns;
+  const QueryableTable* left =
+      MatchTableScan(join_scan->left_scan(), &left_columns);
+  const QueryableTable* right =
+      MatchTableScan(join_scan->right_scan(), &right_columns);
+  if (left == nullptr || right == nullptr) {
+    return nullptr;
+  }
+  join->left_.table = left->wrapped_table();
+  join->left_.table_name = left->Name();
+  join->right_.table = right->wrapped_table();
+  join->right_.table_name = right->Name();
+
+  auto read_position = [](Input* input, const Column* column) {
+    auto& names = input->read_column_names;
+    auto itr = std::find(names.begin(), names.end(), column->Name());
+    if (itr != names.end()) {
+      return static_cast<int>(itr - names.begin());
+    }
+    names.push_back(column->Name());
+    return static_cast<int>(names.size()) - 1;
+  };
+
+  // Every conjunct must compare a column of one table with a column of the
+  // other.
+  std::vector<const zetasql::ResolvedExpr*> conjuncts;
+  CollectConjuncts(join_scan->join_expr(), &conjuncts);
+  for (const zetasql::ResolvedExpr* conjunct : conjuncts) {
+    if (conjunct->node_kind() != zetasql::RESOLVED_FUNCTION_CALL) {
+      return nullptr;
+    }
+    const auto* call = conjunct->GetAs<zetasql::ResolvedFunctionCall>();
+    if (!call->function()->IsZetaSQLBuiltin() ||
+        call->function()->Name() != "$equal" ||
+        call->argument_list_size() != 2 ||
+        call->argument_list(0)->node_kind() != zetasql::RESOLVED_COLUMN_REF ||
+        call->argument_list(1)->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+      return nullptr;
+    }
+    int left_id = call->argument_list(0)
+                      ->GetAs<zetasql::ResolvedColumnRef>()
+                      ->column()
+                      .column_id();
+    int right_id = call->argument_list(1)
+                       ->GetAs<zetasql::ResolvedColumnRef>()
+                       ->column()
+                       .column_id();
+    if (!left_columns.contains(left_id)) {
+      std::swap(left_id, right_id);
+    }
+    auto left_itr = left_columns.find(left_id);
+    auto right_itr = right_columns.find(right_id);
+    if (left_itr == left_columns.end() || right_itr == right_columns.end() ||
+        !HasKeyEquality(left_itr->second->GetType()) ||
+        !left_itr->second->GetType()->Equals(right_itr->second->GetType())) {
+      return nullptr;
+    }
+    join->left_.join_positions.push_back(
+        read_position(&join->left_, left_itr->second));
+    join->right_.join_positions.push_back(
+        read_position(&join->right_, right_itr->second));
+  }
+
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    const int column_id = output_column->column().column_id();
+    OutputColumn column;
+    if (auto itr = left_columns.find(column_id); itr != left_columns.end()) {
+      column.from_left = true;
+      column.position = read_position(&join->left_, itr->second);
+    } else if (auto itr = right_columns.find(column_id);
+               itr != right_columns.end()) {
+      column.position = read_position(&join->right_, itr->second);
+    } else {
+      return nullptr;
+    }
+    join->output_columns_.push_back(column);
+    join->output_column_names_.push_back(output_column->name());
+    join->output_column_types_.push_back(output_column->column().type());
+  }
+  return join;
+}
+
+bool HashJoin::BuildLeft(RowReader* reader,
+                         const DatabaseStatistics* statistics) const {
+  if (build_side_ != BuildSide::kUnspecified) {
+    return build_side_ == BuildSide::kLeft;
+  }
+  auto estimated_rows = [&](const Input& input) -> std::optional<int64_t> {
+    if (statistics != nullptr) {
+      if (std::optional<int64_t> rows = statistics->RowCount(input.table->id());
+          rows.has_value()) {
+        return rows;
+      }
+    }
+    return reader->CountRows(input.table_name);
+  };
+  // Unless the left side is known to be the smaller one, the right side is
+  // built, so that rows are returned in the order of the evaluator, which
+  // loops over the right side for each row of the left.
+  std::optional<int64_t> left_rows = estimated_rows(left_);
+  std::optional<int64_t> right_rows = estimated_rows(right_);
+  return left_rows.has_value() && right_rows.has_value() &&
+         *left_rows < *right_rows;
+}
+
+absl::Status HashJoin::Execute(
+    RowReader* reader, const DatabaseStatistics* statistics,
+    std::vector<std::vector<zetasql::Value>>* rows) const {
+  auto read = [reader](const Input& input, std::unique_ptr<RowCursor>* cursor) {
+    ReadArg read_arg;
+    read_arg.table = input.table_name;
+    read_arg.key_set = KeySet::All();
+    read_arg.columns = input.read_column_names;
+    return reader->Read(read_arg, cursor);
+  };
+  const bool build_left = BuildLeft(reader, statistics);
+  const Input& build_input = build_left ? left_ : right_;
+  const Input& probe_input = build_left ? right_ : left_;
+
+  // The rows of the build side, and the positions in build_rows of the rows
+  // with each value of the joined columns.
+  std::vector<std::vector<zetasql::Value>> build_rows;
+  absl::flat_hash_map<std::vector<zetasql::Value>, std::vector<int64_t>>
+      build_table;
+  std::unique_ptr<RowCursor> build;
+  ZETASQL_RETURN_IF_ERROR(read(build_input, &build));
+  std::vector<zetasql::Value> key;
+  int64_t num_rows = 0;
+  while (build->Next()) {
+    if (++num_rows % kCancellationCheckRows == 0) {
+      ZETASQL_RETURN_IF_ERROR(reader->CheckNotCancelled());
+    }
+    if (!JoinKey(*build, build_input.join_positions, &key)) {
+      continue;
+    }
+    std::vector<zetasql::Value>& row = build_rows.emplace_back();
+    row.reserve(build->NumColumns());
+    for (int i = 0; i < build->NumColumns(); ++i) {
+      row.push_back(build->ColumnValue(i));
+    }
+    build_table[key].push_back(build_rows.size() - 1);
+  }
+  ZETASQL_RETURN_IF_ERROR(build->Status());
+
+  rows->clear();
+  if (build_table.empty()) {
+    return absl::OkStatus();
+  }
+  std::unique_ptr<RowCursor> probe;
+  ZETASQL_RETURN_IF_ERROR(read(probe_input, &probe));
+  while (probe->Next()) {
+    if (++num_rows % kCancellationCheckRows == 0) {
+      ZETASQL_RETURN_IF_ERROR(reader->CheckNotCancelled());
+    }
+    if (!JoinKey(*probe, probe_input.join_positions, &key)) {
+      continue;
+    }
+    auto matches = build_table.find(key);
+    if (matches == build_table.end()) {
+      continue;
+    }
+    for (int64_t match : matches->second) {
+      const std::vector<zetasql::Value>& build_row = build_rows[match];
+      std::vector<zetasql::Value>& row = rows->emplace_back();
+      row.reserve(output_columns_.size());
+      for (const OutputColumn& column : output_columns_) {
+        row.push_back(column.from_left == build_left
+                          ? build_row[column.position]
+                          : probe->ColumnValue(column.position));
+      }
+    }
+  }
+  return probe->Status();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,122 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_HASH_JOIN_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_HASH_JOIN_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/status.h"
+#include "backend/access/read.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// HashJoin is a query which joins two tables on the equality of any of their
+// columns, so that it can be executed by reading each table once and looking
+// up the rows of one in a hash table of the rows of the other, instead of by
+// the ZetaSQL evaluator, which compares every pair of rows.
+//
+// It matches statements of the form
+//
+//   SELECT <columns> FROM <left>
+//     [INNER] JOIN [@{JOIN_METHOD=HASH_JOIN}] <right>
+//     ON <left>.<column1> = <right>.<column2> AND ...
+//
+// in which every predicate compares a column of one table with a column of the
+// same type of the other, and the select list only names columns of the two
+// tables. Joins hinted with any other JOIN_METHOD, statement and table hints,
+// floating point join columns and any other predicate do not match.
+//
+// The hash table is built from the side named by HASH_JOIN_BUILD_SIDE, if the
+// join is hinted with it, or else from the table with the fewest estimated
+// rows, or the right table if their sizes are not known. The order of the
+// joined rows is unspecified, as it is for the evaluator.
+class HashJoin {
+ public:
+  // Returns the HashJoin equivalent to statement, or nullptr if statement is
+  // not of the form above.
+  static std::unique_ptr<const HashJoin> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  // The names and types of the columns of the result.
+  const std::vector<std::string>& output_column_names() const {
+    return output_column_names_;
+  }
+  const std::vector<const zetasql::Type*>& output_column_types() const {
+    return output_column_types_;
+  }
+
+  // Reads the rows of the result through reader into rows. Only the rows of
+  // the build side are kept in memory while the other table is streamed.
+  // statistics, if not null, estimate the sizes of the two tables.
+  absl::Status Execute(RowReader* reader, const DatabaseStatistics* statistics,
+                       std::vector<std::vector<zetasql::Value>>* rows) const;
+
+ private:
+  // One of the two tables which are read.
+  struct Input {
+    const Table* table = nullptr;
+
+    // The name under which the table is read, and the columns read from it.
+    std::string table_name;
+    std::vector<std::string> read_column_names;
+
+    // The positions in read_column_names of the joined columns, in the order
+    // in which they are compared with those of the other input.
+    std::vector<int> join_positions;
+  };
+
+  // A column of the result: the input it is read from, and its position in
+  // the columns read from that input.
+  struct OutputColumn {
+    bool from_left = false;
+    int position = 0;
+  };
+
+  // The side of the join from which the hash table is built.
+  enum class BuildSide { kUnspecified, kLeft, kRight };
+
+  HashJoin() = default;
+
+  // Returns whether the hash table should be built from the left input.
+  bool BuildLeft(RowReader* reader, const DatabaseStatistics* statistics) const;
+
+  Input left_;
+  Input right_;
+
+  BuildSide build_side_ = BuildSide::kUnspecified;
+
+  std::vector<OutputColumn> output_columns_;
+  std::vector<std::string> output_column_names_;
+  std::vector<const zetasql::Type*> output_column_types_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_HASH_JOIN_H_
@@ -78,7 +78,11 @@ absl::Status IndexHintValidator::VisitResolvedTableScan(
     const zetasql::ResolvedTableScan* table_scan) {
   // Visit child nodes first.
   ZETASQL_RETURN_IF_ERROR(zetasql::ResolvedASTVisitor::DefaultVisit(table_scan));
+  return CollectIndexHint(table_scan);
+}
 
+absl::Status IndexHintValidator::CollectIndexHint(
+    const zetasql::ResolvedTableScan* table_scan) {
   std::vector<const zetasql::ResolvedNode*> child_nodes;
   table_scan->GetChildNodes(&child_nodes);
 
@@ -104,6 +108,42 @@ absl::Status IndexHintValidator::VisitResolvedTableScan(
   return absl::OkStatus();
 }
 
+void IndexHintValidator::CheckNode(const zetasql::ResolvedNode* node,
+                                   int depth) {
+  if (!check_status_.ok()) {
+    return;
+  }
+  switch (node->node_kind()) {
+    case zetasql::RESOLVED_TABLE_SCAN:
+      check_status_ =
+          CollectIndexHint(node->GetAs<zetasql::ResolvedTableScan>());
+      break;
+    case zetasql::RESOLVED_INSERT_STMT:
+      dml_target_scans_.push_back(
+          node->GetAs<zetasql::ResolvedInsertStmt>()->table_scan());
+      break;
+    case zetasql::RESOLVED_UPDATE_STMT:
+      dml_target_scans_.push_back(
+          node->GetAs<zetasql::ResolvedUpdateStmt>()->table_scan());
+      break;
+    case zetasql::RESOLVED_DELETE_STMT:
+      dml_target_scans_.push_back(
+          node->GetAs<zetasql::ResolvedDeleteStmt>()->table_scan());
+      break;
+    default:
+      break;
+  }
+}
+
+absl::Status IndexHintValidator::Finish() {
+  ZETASQL_RETURN_IF_ERROR(check_status_);
+  for (const zetasql::ResolvedTableScan* table_scan : dml_target_scans_) {
+    // The target table should not have any hints (not allowed by ZetaSQL).
+    ZETASQL_RET_CHECK(!index_hints_map_.contains(table_scan));
+  }
+  return ValidateIndexesForTables();
+}
+
 absl::Status IndexHintValidator::ValidateIndexesForTables() {
   for (auto [table_scan, index_name] : index_hints_map_) {
     if (absl::EqualsIgnoreCase(index_name, "_base_table")) {
@@ -17,11 +17,15 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_INDEX_HINT_VALIDATOR_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_INDEX_HINT_VALIDATOR_H_
 
+#include <string>
+#include <vector>
+
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_ast_visitor.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "backend/query/resolved_node_checker.h"
 #include "backend/schema/catalog/schema.h"
 
 namespace google {
@@ -30,13 +34,31 @@ namespace emulator {
 namespace backend {
 
 // Checks if an index hint specified on a table scan is valid.
-class IndexHintValidator : public zetasql::ResolvedASTVisitor {
+//
+// The validator can either walk a statement by itself as a visitor, or be
+// registered as a node checker with the QueryValidator so that the hints are
+// collected during the validator's walk and checked by Finish().
+class IndexHintValidator : public zetasql::ResolvedASTVisitor,
+                           public ResolvedNodeChecker {
  public:
   IndexHintValidator(const Schema* schema,
                      bool disable_null_filtered_index_check = false)
       : schema_(schema),
         disable_null_filtered_index_check_(disable_null_filtered_index_check) {}
 
+  // Sets whether the null-filtered index check is disabled. Must be called
+  // before Finish() when used as a node checker, since the option may only be
+  // known once the statement hints have been visited.
+  void set_disable_null_filtered_index_check(bool disable) {
+    disable_null_filtered_index_check_ = disable;
+  }
+
+  // Collects the index hint of `node` if it is a table scan.
+  void CheckNode(const zetasql::ResolvedNode* node, int depth) final;
+
+  // Validates all the index hints collected by CheckNode().
+  absl::Status Finish() final;
+
  private:
   absl::Status VisitResolvedQueryStmt(
       const zetasql::ResolvedQueryStmt* stmt) final;
@@ -58,6 +80,9 @@ class IndexHintValidator : public zetasql::ResolvedASTVisitor {
   absl::Status VisitResolvedTableScan(
       const zetasql::ResolvedTableScan* scan) final;
 
+  // Records the 'force_index' hint specified on `table_scan`, if any.
+  absl::Status CollectIndexHint(const zetasql::ResolvedTableScan* table_scan);
+
   // Mapping of table scans to the index hints specified on each.
   absl::flat_hash_map<const zetasql::ResolvedTableScan*, std::string>
       index_hints_map_;
@@ -67,7 +92,14 @@ class IndexHintValidator : public zetasql::ResolvedASTVisitor {
 
   // Whether to disable checks around using null-filtered indexes in SQL
   // queries.
-  const bool disable_null_filtered_index_check_;
+  bool disable_null_filtered_index_check_;
+
+  // Target table scans of the DML statements seen by CheckNode(), which must
+  // not have any hints.
+  std::vector<const zetasql::ResolvedTableScan*> dml_target_scans_;
+
+  // The first error encountered by CheckNode().
+  absl::Status check_status_;
 };
 
 }  // namespace backend
@@ -28,6 +28,7 @@
 #include "backend/query/analyzer_options.h"
 #include "backend/query/catalog.h"
 #include "backend/query/function_catalog.h"
+#include "backend/query/query_validator.h"
 #include "backend/query/queryable_table.h"
 #include "backend/schema/catalog/schema.h"
 #include "common/errors.h"
@@ -204,6 +205,35 @@ TEST_F(IndexHintValidatorTest, NonEmulatorManagedIndexName) {
   ZETASQL_EXPECT_OK(stmt->Accept(&validator));
 }
 
+TEST_F(IndexHintValidatorTest, ChecksHintsDuringQueryValidatorWalk) {
+  {
+    auto output = AnalyzeQuery("SELECT k1 FROM T1@{force_index=I1}");
+    IndexHintValidator validator{schema()};
+    QueryValidator query_validator{schema()};
+    query_validator.AddNodeChecker(&validator);
+    ZETASQL_EXPECT_OK(output->resolved_statement()->Accept(&query_validator));
+    ZETASQL_EXPECT_OK(validator.Finish());
+  }
+  {
+    auto output =
+        AnalyzeQuery("INSERT INTO T1(k1) SELECT k1 FROM T1@{force_index=I2}");
+    IndexHintValidator validator{schema()};
+    QueryValidator query_validator{schema()};
+    query_validator.AddNodeChecker(&validator);
+    ZETASQL_EXPECT_OK(output->resolved_statement()->Accept(&query_validator));
+    EXPECT_EQ(validator.Finish(), error::QueryHintIndexNotFound("T1", "I2"));
+  }
+  {
+    auto output = AnalyzeQuery("SELECT k1 FROM T1@{force_index=NF_I1}");
+    IndexHintValidator validator{schema()};
+    QueryValidator query_validator{schema()};
+    query_validator.AddNodeChecker(&validator);
+    ZETASQL_EXPECT_OK(output->resolved_statement()->Accept(&query_validator));
+    validator.set_disable_null_filtered_index_check(true);
+    ZETASQL_EXPECT_OK(validator.Finish());
+  }
+}
+
 }  // namespace
 
 }  // namespace backend
@@ -17,6 +17,7 @@
 #include "backend/query/information_schema_catalog.h"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -25,15 +26,20 @@
 #include <vector>
 
 #include "google/spanner/admin/database/v1/common.pb.h"
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/types/type.h"
 #include "zetasql/public/value.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/query/info_schema_columns_metadata_values.h"
 #include "backend/query/tables_from_metadata.h"
 #include "backend/schema/ddl/operations.pb.h"
@@ -41,6 +47,7 @@
 #include "backend/schema/updater/ddl_type_conversion.h"
 #include "common/limits.h"
 #include "zetasql/base/no_destructor.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
@@ -115,6 +122,7 @@ static constexpr char kIsNullFiltered[] = "IS_NULL_FILTERED";
 static constexpr char kIndexState[] = "INDEX_STATE";
 static constexpr char kSpannerIsManaged[] = "SPANNER_IS_MANAGED";
 static constexpr char kReadWrite[] = "READ_WRITE";
+static constexpr char kWriteOnly[] = "WRITE_ONLY";
 static constexpr char kColumnOrdering[] = "COLUMN_ORDERING";
 static constexpr char kConstraintCatalog[] = "CONSTRAINT_CATALOG";
 static constexpr char kConstraintSchema[] = "CONSTRAINT_SCHEMA";
@@ -334,6 +342,104 @@ std::vector<zetasql::Value> GetRowFromRowKVs(
   return row;
 }
 
+// Returns true if table_names is null or contains table_name.
+bool IncludesTable(const absl::flat_hash_set<std::string>* table_names,
+                   absl::string_view table_name) {
+  return table_names == nullptr || table_names->contains(table_name);
+}
+
+// An implementation of EvaluatorTableIterator over rows which are computed on
+// the first call to NextRow, so that a filter on the TABLE_NAME column which
+// the evaluator pushes down through SetColumnFilterMap can restrict the rows
+// which are computed.
+class TableNameFilteredIterator : public zetasql::EvaluatorTableIterator {
+ public:
+  using RowsFunction =
+      std::function<std::shared_ptr<const std::vector<std::vector<
+          zetasql::Value>>>(const absl::flat_hash_set<std::string>*)>;
+
+  TableNameFilteredIterator(const zetasql::Table* table,
+                            std::vector<int> column_idxs,
+                            int table_name_column, RowsFunction rows_function)
+      : table_(table),
+        column_idxs_(std::move(column_idxs)),
+        table_name_column_(table_name_column),
+        rows_function_(std::move(rows_function)) {}
+
+  int NumColumns() const override { return column_idxs_.size(); }
+
+  std::string GetColumnName(int i) const override {
+    return table_->GetColumn(column_idxs_[i])->Name();
+  }
+
+  const zetasql::Type* GetColumnType(int i) const override {
+    return table_->GetColumn(column_idxs_[i])->GetType();
+  }
+
+  absl::Status SetColumnFilterMap(
+      absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>>
+          filter_map) override {
+    for (const auto& [position, filter] : filter_map) {
+      if (position < 0 || position >= NumColumns() ||
+          column_idxs_[position] != table_name_column_ ||
+          filter->kind() != zetasql::ColumnFilter::kInList) {
+        continue;
+      }
+      table_names_.emplace();
+      for (const zetasql::Value& value : filter->in_list()) {
+        if (value.type()->IsString() && !value.is_null()) {
+          table_names_->insert(value.string_value());
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  bool NextRow() override {
+    if (rows_ == nullptr) {
+      rows_ = rows_function_(table_names_.has_value() ? &*table_names_
+                                                      : nullptr);
+    }
+    if (next_row_ >= rows_->size()) {
+      return false;
+    }
+    row_ = &(*rows_)[next_row_++];
+    return true;
+  }
+
+  const zetasql::Value& GetValue(int i) const override {
+    return (*row_)[column_idxs_[i]];
+  }
+
+  absl::Status Status() const override { return absl::OkStatus(); }
+
+  // Cancel is best-effort and not required.
+  absl::Status Cancel() override { return absl::OkStatus(); }
+
+ private:
+  // The table which is scanned.
+  const zetasql::Table* table_;
+
+  // The positions in table_ of the scanned columns.
+  std::vector<int> column_idxs_;
+
+  // The position of the TABLE_NAME column in table_.
+  int table_name_column_;
+
+  // Computes the rows of table_.
+  RowsFunction rows_function_;
+
+  // The table names of a pushed down TABLE_NAME filter, if there is one.
+  std::optional<absl::flat_hash_set<std::string>> table_names_;
+
+  // The rows scanned. Null until the first call to NextRow.
+  std::shared_ptr<const std::vector<std::vector<zetasql::Value>>> rows_;
+  size_t next_row_ = 0;
+
+  // The current row.
+  const std::vector<zetasql::Value>* row_ = nullptr;
+};
+
 }  // namespace
 
 InformationSchemaCatalog::InformationSchemaCatalog(
@@ -352,10 +458,13 @@ InformationSchemaCatalog::InformationSchemaCatalog(
     AddTable(table.get());
   }
 
-  FillSchemataTable();
+  // Rows are filled in when a query first looks their table up.
+  DeferFill(tables_by_name_.at(GetNameForDialect(kSchemata)).get(),
+            [this] { FillSchemataTable(); });
   // kSpannerStatistics currently has no rows in the emulator so we don't call a
   // function to fill the table.
-  FillDatabaseOptionsTable();
+  DeferFill(tables_by_name_.at(GetNameForDialect(kDatabaseOptions)).get(),
+            [this] { FillDatabaseOptionsTable(); });
 
   auto* indexes = AddIndexesTable();
   auto* index_columns = AddIndexColumnsTable();
@@ -367,21 +476,99 @@ InformationSchemaCatalog::InformationSchemaCatalog(
   auto* key_column_usage = AddKeyColumnUsageTable();
   auto* constraint_column_usage = AddConstraintColumnUsageTable();
 
-  // These tables are populated only after all tables have been added to the
-  // catalog (including meta tables) because they add rows based on the tables
-  // in the catalog.
-  FillTablesTable();
-  FillColumnsTable();
-  FillColumnColumnUsageTable();
-  FillIndexesTable(indexes);
-  FillIndexColumnsTable(index_columns);
-  FillCheckConstraintsTable(check_constraints);
-  FillTableConstraintsTable(table_constraints);
-  FillConstraintTableUsageTable(constraint_table_usage);
-  FillReferentialConstraintsTable(referential_constraints);
-  FillKeyColumnUsageTable(key_column_usage);
-  FillConstraintColumnUsageTable(constraint_column_usage);
-  FillViewsTable();
+  // TABLES and COLUMNS have a row for each table in the catalog (including
+  // meta tables), and are the largest tables, so their rows are computed when
+  // they are scanned, for the tables selected by the query if possible.
+  SetRowsFunction(
+      tables_by_name_.at(GetNameForDialect(kTables)).get(),
+      [this](const absl::flat_hash_set<std::string>* table_names) {
+        if (table_names != nullptr) {
+          return std::make_shared<const Rows>(GetTablesRows(table_names));
+        }
+        absl::MutexLock lock(&fill_mu_);
+        if (all_tables_rows_ == nullptr) {
+          all_tables_rows_ = std::make_shared<const Rows>(
+              GetTablesRows(/*table_names=*/nullptr));
+        }
+        return all_tables_rows_;
+      });
+  SetRowsFunction(
+      tables_by_name_.at(GetNameForDialect(kColumns)).get(),
+      [this](const absl::flat_hash_set<std::string>* table_names) {
+        if (table_names != nullptr) {
+          return std::make_shared<const Rows>(GetColumnsRows(table_names));
+        }
+        absl::MutexLock lock(&fill_mu_);
+        if (all_columns_rows_ == nullptr) {
+          all_columns_rows_ = std::make_shared<const Rows>(
+              GetColumnsRows(/*table_names=*/nullptr));
+        }
+        return all_columns_rows_;
+      });
+
+  DeferFill(tables_by_name_.at(GetNameForDialect(kColumnColumnUsage)).get(),
+            [this] { FillColumnColumnUsageTable(); });
+  DeferFill(indexes, [this, indexes] { FillIndexesTable(indexes); });
+  DeferFill(index_columns,
+            [this, index_columns] { FillIndexColumnsTable(index_columns); });
+  DeferFill(check_constraints, [this, check_constraints] {
+    FillCheckConstraintsTable(check_constraints);
+  });
+  DeferFill(table_constraints, [this, table_constraints] {
+    FillTableConstraintsTable(table_constraints);
+  });
+  DeferFill(constraint_table_usage, [this, constraint_table_usage] {
+    FillConstraintTableUsageTable(constraint_table_usage);
+  });
+  DeferFill(referential_constraints, [this, referential_constraints] {
+    FillReferentialConstraintsTable(referential_constraints);
+  });
+  DeferFill(key_column_usage, [this, key_column_usage] {
+    FillKeyColumnUsageTable(key_column_usage);
+  });
+  DeferFill(constraint_column_usage, [this, constraint_column_usage] {
+    FillConstraintColumnUsageTable(constraint_column_usage);
+  });
+  DeferFill(tables_by_name_.at(GetNameForDialect(kViews)).get(),
+            [this] { FillViewsTable(); });
+}
+
+absl::Status InformationSchemaCatalog::GetTable(const std::string& name,
+                                                const zetasql::Table** table,
+                                                const FindOptions& options) {
+  ZETASQL_RETURN_IF_ERROR(
+      zetasql::SimpleCatalog::GetTable(name, table, options));
+  absl::MutexLock lock(&fill_mu_);
+  if (auto it = pending_fills_.find(*table); it != pending_fills_.end()) {
+    std::function<void()> fill = std::move(it->second);
+    pending_fills_.erase(it);
+    fill();
+  }
+  return absl::OkStatus();
+}
+
+void InformationSchemaCatalog::DeferFill(const zetasql::Table* table,
+                                         std::function<void()> fill) {
+  absl::MutexLock lock(&fill_mu_);
+  pending_fills_[table] = std::move(fill);
+}
+
+void InformationSchemaCatalog::SetRowsFunction(zetasql::SimpleTable* table,
+                                               RowsFunction rows_function) {
+  int table_name_column = -1;
+  for (int i = 0; i < table->NumColumns(); ++i) {
+    if (absl::EqualsIgnoreCase(table->GetColumn(i)->Name(), kTableName)) {
+      table_name_column = i;
+    }
+  }
+  table->SetEvaluatorTableIteratorFactory(
+      [table, table_name_column, rows_function = std::move(rows_function)](
+          absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        return std::make_unique<TableNameFilteredIterator>(
+            table, std::vector<int>(column_idxs.begin(), column_idxs.end()),
+            table_name_column, rows_function);
+      });
 }
 
 inline std::string InformationSchemaCatalog::GetNameForDialect(
@@ -443,13 +630,17 @@ void InformationSchemaCatalog::FillDatabaseOptionsTable() {
 //
 // Rows are added for each table and view defined in the default schema, as well
 // as for tables in the information schema.
-void InformationSchemaCatalog::FillTablesTable() {
+InformationSchemaCatalog::Rows InformationSchemaCatalog::GetTablesRows(
+    const absl::flat_hash_set<std::string>* table_names) {
   auto tables = tables_by_name_.at(GetNameForDialect(kTables)).get();
 
   // Add table rows.
   std::vector<std::vector<zetasql::Value>> rows;
   absl::flat_hash_map<std::string, zetasql::Value> specific_kvs;
   for (const Table* table : default_schema_->tables()) {
+    if (!IncludesTable(table_names, table->Name())) {
+      continue;
+    }
     if (dialect_ == DatabaseDialect::POSTGRESQL) {
       specific_kvs[kTableSchema] = String(kPublic);
       specific_kvs[kRowDeletionPolicyExpression] = NullString();
@@ -478,6 +669,9 @@ void InformationSchemaCatalog::FillTablesTable() {
   }
 
   for (const View* view : default_schema_->views()) {
+    if (!IncludesTable(table_names, view->Name())) {
+      continue;
+    }
     if (dialect_ == DatabaseDialect::POSTGRESQL) {
       specific_kvs[kTableSchema] = String(kPublic);
       specific_kvs[kSpannerState] = NullString();
@@ -496,6 +690,9 @@ void InformationSchemaCatalog::FillTablesTable() {
   }
 
   for (const auto& table : this->tables()) {
+    if (!IncludesTable(table_names, GetNameForDialect(table->Name()))) {
+      continue;
+    }
     specific_kvs[kTableSchema] = String(GetNameForDialect(kInformationSchema));
     specific_kvs[kTableName] = String(GetNameForDialect(table->Name()));
     specific_kvs[kTableType] = String(kView);
@@ -508,7 +705,7 @@ void InformationSchemaCatalog::FillTablesTable() {
     specific_kvs.clear();
   }
 
-  tables->SetContents(rows);
+  return rows;
 }
 
 // Returns the value to be used by the "numeric_precision" column of the
@@ -547,21 +744,26 @@ zetasql::Value GetPGCharacterMaximumLength(const zetasql::Type* type) {
   return NullInt64();
 }
 
-// Fills the "information_schema.columns" table based on the specifications
-// provided for each dialect:
+// Returns the rows of the "information_schema.columns" table based on the
+// specifications provided for each dialect:
 // ZetaSQL: https://cloud.google.com/spanner/docs/information-schema#columns
 // PostgreSQL:
 // https://cloud.google.com/spanner/docs/information-schema-pg#columns
 //
 // Rows are added for each column in each table and view defined in the default
-// schema, as well as for tables in the information schema.
-void InformationSchemaCatalog::FillColumnsTable() {
+// schema, as well as for tables in the information schema. If table_names is
+// not null, only the columns of those tables are included.
+InformationSchemaCatalog::Rows InformationSchemaCatalog::GetColumnsRows(
+    const absl::flat_hash_set<std::string>* table_names) {
   auto columns = tables_by_name_.at(GetNameForDialect(kColumns)).get();
 
   // Add table rows.
   std::vector<std::vector<zetasql::Value>> rows;
   absl::flat_hash_map<std::string, zetasql::Value> specific_kvs;
   for (const Table* table : default_schema_->tables()) {
+    if (!IncludesTable(table_names, table->Name())) {
+      continue;
+    }
     int pos = 1;
     for (const Column* column : table->columns()) {
       if (dialect_ == DatabaseDialect::POSTGRESQL) {
@@ -623,6 +825,9 @@ void InformationSchemaCatalog::FillColumnsTable() {
 
   // Add columns for views.
   for (const View* view : default_schema_->views()) {
+    if (!IncludesTable(table_names, view->Name())) {
+      continue;
+    }
     int pos = 1;
     for (const View::Column& column : view->columns()) {
       if (dialect_ == DatabaseDialect::POSTGRESQL) {
@@ -664,6 +869,9 @@ void InformationSchemaCatalog::FillColumnsTable() {
 
   // Add columns for the tables that live inside INFORMATION_SCHEMA.
   for (const auto& table : this->tables()) {
+    if (!IncludesTable(table_names, GetNameForDialect(table->Name()))) {
+      continue;
+    }
     int pos = 1;
     for (int i = 0; i < table->NumColumns(); ++i) {
       const auto* column = table->GetColumn(i);
@@ -700,8 +908,7 @@ void InformationSchemaCatalog::FillColumnsTable() {
     }
   }
 
-  // Add table to catalog.
-  columns->SetContents(rows);
+  return rows;
 }
 
 void InformationSchemaCatalog::FillColumnColumnUsageTable() {
@@ -779,7 +986,7 @@ void InformationSchemaCatalog::FillIndexesTable(
           // is_null_filtered
           Bool(index->is_null_filtered()),
           // index_state
-          String(kReadWrite),
+          String(index->is_write_only() ? kWriteOnly : kReadWrite),
           // spanner_is_managed
           Bool(index->is_managed()),
       });
@@ -1920,6 +2127,34 @@ void InformationSchemaCatalog::FillViewsTable() {
   views->SetContents(rows);
 }
 
+std::shared_ptr<InformationSchemaCatalog>
+InformationSchemaCatalogCache::GetOrCreate(const Schema* schema) {
+  absl::MutexLock lock(&mu_);
+  if (schema == schema_) {
+    return catalog_;
+  }
+  // Building under the lock avoids populating the same catalog more than once
+  // when several queries miss the cache at the same time.
+  auto catalog = std::make_shared<InformationSchemaCatalog>(
+      InformationSchemaCatalog::kName, schema);
+  // Queries against an older schema (e.g. stale reads) do not displace the
+  // catalog of the newer one, which most queries use.
+  if (schema_ == nullptr || schema->generation() >= schema_->generation()) {
+    schema_ = schema;
+    catalog_ = catalog;
+  }
+  return catalog;
+}
+
+void InformationSchemaCatalogCache::EraseSchema(const Schema* schema) {
+  std::shared_ptr<InformationSchemaCatalog> erased;
+  absl::MutexLock lock(&mu_);
+  if (schema == schema_) {
+    schema_ = nullptr;
+    erased = std::move(catalog_);
+  }
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
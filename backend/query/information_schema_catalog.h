@@ -17,13 +17,19 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_INFORMATION_SCHEMA_CATALOG_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_INFORMATION_SCHEMA_CATALOG_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "google/spanner/admin/database/v1/common.pb.h"
 #include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/schema/catalog/schema.h"
 
 namespace google {
@@ -47,6 +53,11 @@ struct IndexColumnsMetaEntry;
 // In production, SPANNER_SYS schemas are also exposed which are not available
 // in the emulator.
 //
+// The rows of a table are only computed once a query looks the table up. The
+// rows of TABLES and COLUMNS are computed when they are scanned instead, and
+// only for the tables named by a TABLE_NAME equality or IN predicate if the
+// query has one.
+//
 // This class is tested via tests/conformance/cases/information_schema.cc
 class InformationSchemaCatalog : public zetasql::SimpleCatalog {
  public:
@@ -55,12 +66,41 @@ class InformationSchemaCatalog : public zetasql::SimpleCatalog {
   explicit InformationSchemaCatalog(const std::string& catalog_name,
                                     const Schema* default_schema);
 
+  // Looks up a table, filling in its rows on the first lookup.
+  absl::Status GetTable(const std::string& name, const zetasql::Table** table,
+                        const FindOptions& options) override;
+
  private:
+  using Rows = std::vector<std::vector<zetasql::Value>>;
+
+  // Returns the rows of a table whose rows are computed per scan. If
+  // table_names is not null, only the rows for those tables are returned.
+  using RowsFunction = std::function<std::shared_ptr<const Rows>(
+      const absl::flat_hash_set<std::string>* table_names)>;
+
   const Schema* default_schema_;
   const ::google::spanner::admin::database::v1::DatabaseDialect dialect_;
   absl::flat_hash_map<std::string, std::unique_ptr<zetasql::SimpleTable>>
       tables_by_name_;
 
+  // Guards the rows which are filled in lazily.
+  absl::Mutex fill_mu_;
+
+  // Fills in the rows of each table which has not been looked up yet.
+  absl::flat_hash_map<const zetasql::Table*, std::function<void()>>
+      pending_fills_ ABSL_GUARDED_BY(fill_mu_);
+
+  // The rows of TABLES and COLUMNS for all tables, once a scan needed them.
+  std::shared_ptr<const Rows> all_tables_rows_ ABSL_GUARDED_BY(fill_mu_);
+  std::shared_ptr<const Rows> all_columns_rows_ ABSL_GUARDED_BY(fill_mu_);
+
+  // Defers fill until table is first looked up.
+  void DeferFill(const zetasql::Table* table, std::function<void()> fill);
+
+  // Makes scans of table compute its rows with rows_function.
+  void SetRowsFunction(zetasql::SimpleTable* table,
+                       RowsFunction rows_function);
+
   inline std::string GetNameForDialect(absl::string_view name);
   std::pair<zetasql::Value, zetasql::Value> GetPGDataTypeAndSpannerType(
       const zetasql::Type* type, std::optional<int64_t> length);
@@ -69,8 +109,8 @@ class InformationSchemaCatalog : public zetasql::SimpleCatalog {
   void FillSpannerStatisticsTable();
   void FillDatabaseOptionsTable();
 
-  void FillTablesTable();
-  void FillColumnsTable();
+  Rows GetTablesRows(const absl::flat_hash_set<std::string>* table_names);
+  Rows GetColumnsRows(const absl::flat_hash_set<std::string>* table_names);
 
   void FillColumnColumnUsageTable();
 
@@ -106,6 +146,34 @@ class InformationSchemaCatalog : public zetasql::SimpleCatalog {
   void FillViewsTable();
 };
 
+// InformationSchemaCatalogCache shares a single InformationSchemaCatalog
+// between all the queries that run against the same schema, since populating
+// the information schema tables is expensive and only depends on the schema.
+//
+// Only the catalog of the newest schema generation requested so far is
+// retained. Catalogs handed out remain valid for as long as the caller holds on
+// to them.
+class InformationSchemaCatalogCache {
+ public:
+  // Returns the information schema catalog for schema, building it if it is
+  // not cached.
+  std::shared_ptr<InformationSchemaCatalog> GetOrCreate(const Schema* schema)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Drops the cached catalog if it was built for schema, before the schema is
+  // destroyed.
+  void EraseSchema(const Schema* schema) ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  absl::Mutex mu_;
+
+  // The schema which catalog_ was built for.
+  const Schema* schema_ ABSL_GUARDED_BY(mu_) = nullptr;
+
+  // The cached catalog.
+  std::shared_ptr<InformationSchemaCatalog> catalog_ ABSL_GUARDED_BY(mu_);
+};
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
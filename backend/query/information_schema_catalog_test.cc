@@ -16,10 +16,16 @@
 
 #include "backend/query/information_schema_catalog.h"
 
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/value.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "absl/container/flat_hash_map.h"
 #include "backend/query/info_schema_columns_metadata_values.h"
 
 namespace google::spanner::emulator::backend {
@@ -44,5 +50,62 @@ TEST(InformationSchemaCatalogTest, SpannerSysColumnsMetadataCount) {
   EXPECT_EQ(SpannerSysColumnsMetadata().size(), 293);
 }
 
+TEST(InformationSchemaCatalogTest, FiltersTablesByPushedDownTableName) {
+  Schema schema;
+  InformationSchemaCatalog catalog(InformationSchemaCatalog::kName, &schema);
+  const zetasql::Table* tables = nullptr;
+  ZETASQL_ASSERT_OK(
+      catalog.GetTable("TABLES", &tables, zetasql::Catalog::FindOptions()));
+  ASSERT_NE(tables, nullptr);
+  int table_name = -1;
+  for (int i = 0; i < tables->NumColumns(); ++i) {
+    if (tables->GetColumn(i)->Name() == "TABLE_NAME") {
+      table_name = i;
+    }
+  }
+  ASSERT_NE(table_name, -1);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<zetasql::EvaluatorTableIterator> all,
+      tables->CreateEvaluatorTableIterator({table_name}));
+  int num_tables = 0;
+  while (all->NextRow()) {
+    ++num_tables;
+  }
+  EXPECT_GT(num_tables, 1);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<zetasql::EvaluatorTableIterator> filtered,
+      tables->CreateEvaluatorTableIterator({table_name}));
+  absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>> filters;
+  filters[0] = std::make_unique<zetasql::ColumnFilter>(
+      std::vector<zetasql::Value>{zetasql::values::String("COLUMNS")});
+  ZETASQL_ASSERT_OK(filtered->SetColumnFilterMap(std::move(filters)));
+  ASSERT_TRUE(filtered->NextRow());
+  EXPECT_EQ(filtered->GetValue(0), zetasql::values::String("COLUMNS"));
+  EXPECT_FALSE(filtered->NextRow());
+}
+
+TEST(InformationSchemaCatalogCacheTest, SharesCatalogForSameSchema) {
+  Schema schema;
+  InformationSchemaCatalogCache cache;
+  auto catalog = cache.GetOrCreate(&schema);
+  ASSERT_NE(catalog, nullptr);
+  EXPECT_EQ(cache.GetOrCreate(&schema), catalog);
+}
+
+TEST(InformationSchemaCatalogCacheTest, RebuildsCatalogForNewSchema) {
+  Schema old_schema;
+  Schema new_schema;
+  InformationSchemaCatalogCache cache;
+  auto old_catalog = cache.GetOrCreate(&old_schema);
+  auto new_catalog = cache.GetOrCreate(&new_schema);
+  EXPECT_NE(new_catalog, old_catalog);
+  EXPECT_EQ(cache.GetOrCreate(&new_schema), new_catalog);
+
+  // The catalog for the old schema stays valid while it is held.
+  EXPECT_EQ(old_catalog->FullName(), InformationSchemaCatalog::kName);
+}
+
 }  // namespace
 }  // namespace google::spanner::emulator::backend
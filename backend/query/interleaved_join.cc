@@ -0,0 +1,285 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/interleaved_join.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/query/simple_select.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of child rows merged between checks for the cancellation of the
+// request.
+constexpr int64_t kCancellationCheckRows = 1024;
+
+// Returns the position of column in the primary key of table, or -1 if it is
+// not a key column.
+int KeyPosition(const Table* table, const Column* column) {
+  for (int i = 0; i < table->primary_key().size(); ++i) {
+    if (table->primary_key()[i]->column() == column) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Returns the key of the joined columns, which are read first, of the row at
+// cursor.
+Key JoinKey(const RowCursor& cursor, const std::vector<bool>& descending) {
+  Key key;
+  for (int i = 0; i < descending.size(); ++i) {
+    key.AddColumn(cursor.ColumnValue(i), descending[i]);
+  }
+  return key;
+}
+
+bool HasNullColumn(const Key& key) {
+  for (int i = 0; i < key.NumColumns(); ++i) {
+    if (key.ColumnValue(i).is_null()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+std::unique_ptr<const InterleavedJoin> InterleavedJoin::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT ||
+      !statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  if (query_stmt->is_value_table()) {
+    return nullptr;
+  }
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() == zetasql::RESOLVED_PROJECT_SCAN) {
+    const auto* project_scan = scan->GetAs<zetasql::ResolvedProjectScan>();
+    if (!project_scan->expr_list().empty() ||
+        !project_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = project_scan->input_scan();
+  }
+  if (scan->node_kind() != zetasql::RESOLVED_JOIN_SCAN) {
+    return nullptr;
+  }
+  const auto* join_scan = scan->GetAs<zetasql::ResolvedJoinScan>();
+  if (join_scan->join_type() != zetasql::ResolvedJoinScan::INNER ||
+      !join_scan->hint_list().empty() || join_scan->join_expr() == nullptr) {
+    return nullptr;
+  }
+
+  absl::flat_hash_map<int, const Column*> parent_columns;
+  absl::flat_hash_map<int, const Column*> child_columns;
+  const QueryableTable* parent =
+      MatchTableScan(join_scan->left_scan(), &parent_columns);
+  const QueryableTable* child =
+      MatchTableScan(join_scan->right_scan(), &child_columns);
+  if (parent == nullptr || child == nullptr) {
+    return nullptr;
+  }
+  if (parent->wrapped_table()->parent() == child->wrapped_table()) {
+    std::swap(parent, child);
+    std::swap(parent_columns, child_columns);
+  }
+  if (child->wrapped_table()->parent() != parent->wrapped_table()) {
+    return nullptr;
+  }
+
+  auto join = absl::WrapUnique(new InterleavedJoin());
+  join->parent_.table = parent->wrapped_table();
+  join->parent_.table_name = parent->Name();
+  join->child_.table = child->wrapped_table();
+  join->child_.table_name = child->Name();
+  join->num_join_columns_ = join->parent_.table->primary_key().size();
+
+  // Every parent key column must be compared with the child key column at the
+  // same position exactly once, and nothing else may be compared.
+  std::vector<const zetasql::ResolvedExpr*> conjuncts;
+  CollectConjuncts(join_scan->join_expr(), &conjuncts);
+  std::vector<bool> joined(join->num_join_columns_, false);
+  for (const zetasql::ResolvedExpr* conjunct : conjuncts) {
+    if (conjunct->node_kind() != zetasql::RESOLVED_FUNCTION_CALL) {
+      return nullptr;
+    }
+    const auto* call = conjunct->GetAs<zetasql::ResolvedFunctionCall>();
+    if (!call->function()->IsZetaSQLBuiltin() ||
+        call->function()->Name() != "$equal" ||
+        call->argument_list_size() != 2 ||
+        call->argument_list(0)->node_kind() != zetasql::RESOLVED_COLUMN_REF ||
+        call->argument_list(1)->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+      return nullptr;
+    }
+    int left_id = call->argument_list(0)
+                      ->GetAs<zetasql::ResolvedColumnRef>()
+                      ->column()
+                      .column_id();
+    int right_id = call->argument_list(1)
+                       ->GetAs<zetasql::ResolvedColumnRef>()
+                       ->column()
+                       .column_id();
+    if (!parent_columns.contains(left_id)) {
+      std::swap(left_id, right_id);
+    }
+    auto parent_itr = parent_columns.find(left_id);
+    auto child_itr = child_columns.find(right_id);
+    if (parent_itr == parent_columns.end() ||
+        child_itr == child_columns.end()) {
+      return nullptr;
+    }
+    const int position = KeyPosition(join->parent_.table, parent_itr->second);
+    if (position < 0 || joined[position] ||
+        KeyPosition(join->child_.table, child_itr->second) != position ||
+        !HasKeyEquality(parent_itr->second->GetType()) ||
+        !parent_itr->second->GetType()->Equals(child_itr->second->GetType())) {
+      return nullptr;
+    }
+    joined[position] = true;
+  }
+  if (std::find(joined.begin(), joined.end(), false) != joined.end()) {
+    return nullptr;
+  }
+
+  // Both tables are read in key order, so the joined key columns must sort the
+  // same way in each.
+  for (int i = 0; i < join->num_join_columns_; ++i) {
+    const bool descending =
+        join->parent_.table->primary_key()[i]->is_descending();
+    if (join->child_.table->primary_key()[i]->is_descending() != descending) {
+      return nullptr;
+    }
+    join->key_descending_.push_back(descending);
+    join->parent_.read_column_names.push_back(
+        join->parent_.table->primary_key()[i]->column()->Name());
+    join->child_.read_column_names.push_back(
+        join->child_.table->primary_key()[i]->column()->Name());
+  }
+
+  auto read_position = [](Input* input, const Column* column) {
+    auto& names = input->read_column_names;
+    auto itr = std::find(names.begin(), names.end(), column->Name());
+    if (itr != names.end()) {
+      return static_cast<int>(itr - names.begin());
+    }
+    names.push_back(column->Name());
+    return static_cast<int>(names.size()) - 1;
+  };
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    const int column_id = output_column->column().column_id();
+    OutputColumn column;
+    if (auto itr = parent_columns.find(column_id);
+        itr != parent_columns.end()) {
+      column.from_parent = true;
+      column.position = read_position(&join->parent_, itr->second);
+    } else if (auto itr = child_columns.find(column_id);
+               itr != child_columns.end()) {
+      column.position = read_position(&join->child_, itr->second);
+    } else {
+      return nullptr;
+    }
+    join->output_columns_.push_back(column);
+    join->output_column_names_.push_back(output_column->name());
+    join->output_column_types_.push_back(output_column->column().type());
+  }
+  return join;
+}
+
+absl::Status InterleavedJoin::Execute(
+    RowReader* reader, std::vector<std::vector<zetasql::Value>>* rows) const {
+  auto read = [reader](const Input& input, std::unique_ptr<RowCursor>* cursor) {
+    ReadArg read_arg;
+    read_arg.table = input.table_name;
+    read_arg.key_set = KeySet::All();
+    read_arg.columns = input.read_column_names;
+    return reader->Read(read_arg, cursor);
+  };
+  std::unique_ptr<RowCursor> parent;
+  std::unique_ptr<RowCursor> child;
+  ZETASQL_RETURN_IF_ERROR(read(parent_, &parent));
+  ZETASQL_RETURN_IF_ERROR(read(child_, &child));
+
+  // The parent key is a prefix of the child key and both reads return rows in
+  // key order, so the parent row of each child row is found by advancing the
+  // parent cursor to the first key which is not less than the child's.
+  rows->clear();
+  bool has_parent = parent->Next();
+  Key parent_key;
+  if (has_parent) {
+    parent_key = JoinKey(*parent, key_descending_);
+  }
+  int64_t num_child_rows = 0;
+  while (has_parent && child->Next()) {
+    if (++num_child_rows % kCancellationCheckRows == 0) {
+      ZETASQL_RETURN_IF_ERROR(reader->CheckNotCancelled());
+    }
+    Key child_key = JoinKey(*child, key_descending_);
+    // The evaluator finds no match for NULL key values, which compare equal
+    // as keys.
+    if (HasNullColumn(child_key)) {
+      continue;
+    }
+    while (has_parent && parent_key < child_key) {
+      has_parent = parent->Next();
+      if (has_parent) {
+        parent_key = JoinKey(*parent, key_descending_);
+      }
+    }
+    if (!has_parent || !(parent_key == child_key)) {
+      continue;
+    }
+    std::vector<zetasql::Value>& row = rows->emplace_back();
+    row.reserve(output_columns_.size());
+    for (const OutputColumn& column : output_columns_) {
+      row.push_back(column.from_parent ? parent->ColumnValue(column.position)
+                                       : child->ColumnValue(column.position));
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(parent->Status());
+  return child->Status();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
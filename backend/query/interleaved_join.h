@@ -0,0 +1,110 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_INTERLEAVED_JOIN_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_INTERLEAVED_JOIN_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/status.h"
+#include "backend/access/read.h"
+#include "backend/schema/catalog/table.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// InterleavedJoin is a query which joins an interleaved table to its parent on
+// the primary key of the parent, so that it can be executed as a merge of two
+// reads in primary key order instead of by the ZetaSQL evaluator, which
+// compares every pair of rows.
+//
+// It matches statements of the form
+//
+//   SELECT <columns> FROM <parent> [INNER] JOIN <child>
+//     ON <parent>.<key1> = <child>.<key1> AND ...
+//
+// or with the tables in the other order, in which every primary key column of
+// the parent is compared for equality with the child key column at the same
+// position, and the select list only names columns of the two tables. Rows are
+// returned in the primary key order of the child. Statements with hints,
+// floating point keys or any other predicate do not match.
+class InterleavedJoin {
+ public:
+  // Returns the InterleavedJoin equivalent to statement, or nullptr if
+  // statement is not of the form above.
+  static std::unique_ptr<const InterleavedJoin> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  // The names and types of the columns of the result.
+  const std::vector<std::string>& output_column_names() const {
+    return output_column_names_;
+  }
+  const std::vector<const zetasql::Type*>& output_column_types() const {
+    return output_column_types_;
+  }
+
+  // Reads the rows of the result through reader into rows. Rows of both
+  // tables are streamed, and only the joined rows are kept.
+  absl::Status Execute(RowReader* reader,
+                       std::vector<std::vector<zetasql::Value>>* rows) const;
+
+ private:
+  // One of the two tables which are read.
+  struct Input {
+    const Table* table = nullptr;
+
+    // The name under which the table is read, and the columns read from it.
+    // The first columns are the key columns which are joined.
+    std::string table_name;
+    std::vector<std::string> read_column_names;
+  };
+
+  // A column of the result: the input it is read from, and its position in
+  // the columns read from that input.
+  struct OutputColumn {
+    bool from_parent = false;
+    int position = 0;
+  };
+
+  InterleavedJoin() = default;
+
+  Input parent_;
+  Input child_;
+
+  // The number of parent primary key columns, which are joined.
+  int num_join_columns_ = 0;
+
+  // Whether each of the joined key columns is descending.
+  std::vector<bool> key_descending_;
+
+  std::vector<OutputColumn> output_columns_;
+  std::vector<std::string> output_column_names_;
+  std::vector<const zetasql::Type*> output_column_types_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_INTERLEAVED_JOIN_H_
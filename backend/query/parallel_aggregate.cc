@@ -0,0 +1,367 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/parallel_aggregate.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/query/simple_select.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "backend/storage/partitioned_scan.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of rows scanned between checks for the cancellation of the
+// request.
+constexpr int64_t kCancellationCheckRows = 1024;
+
+}  // namespace
+
+std::unique_ptr<const ParallelAggregate> ParallelAggregate::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT ||
+      !statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  if (query_stmt->is_value_table()) {
+    return nullptr;
+  }
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() == zetasql::RESOLVED_PROJECT_SCAN) {
+    const auto* project_scan = scan->GetAs<zetasql::ResolvedProjectScan>();
+    if (!project_scan->expr_list().empty() ||
+        !project_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = project_scan->input_scan();
+  }
+  if (scan->node_kind() != zetasql::RESOLVED_AGGREGATE_SCAN) {
+    return nullptr;
+  }
+  const auto* aggregate_scan = scan->GetAs<zetasql::ResolvedAggregateScan>();
+  if (!aggregate_scan->hint_list().empty() ||
+      !aggregate_scan->group_by_list().empty() ||
+      !aggregate_scan->grouping_set_list().empty()) {
+    return nullptr;
+  }
+  absl::flat_hash_map<int, const Column*> scanned_columns;
+  const QueryableTable* queryable_table =
+      MatchTableScan(aggregate_scan->input_scan(), &scanned_columns);
+  if (queryable_table == nullptr) {
+    return nullptr;
+  }
+
+  auto parallel_aggregate = absl::WrapUnique(new ParallelAggregate());
+  parallel_aggregate->table_ = queryable_table->wrapped_table();
+  parallel_aggregate->table_name_ = queryable_table->Name();
+  absl::flat_hash_map<int, int> aggregate_index;
+  for (const auto& computed_column : aggregate_scan->aggregate_list()) {
+    if (computed_column->node_kind() != zetasql::RESOLVED_COMPUTED_COLUMN ||
+        computed_column->GetAs<zetasql::ResolvedComputedColumn>()
+                ->expr()
+                ->node_kind() != zetasql::RESOLVED_AGGREGATE_FUNCTION_CALL) {
+      return nullptr;
+    }
+    const auto* call =
+        computed_column->GetAs<zetasql::ResolvedComputedColumn>()
+            ->expr()
+            ->GetAs<zetasql::ResolvedAggregateFunctionCall>();
+    if (!call->function()->IsZetaSQLBuiltin() || call->distinct() ||
+        call->null_handling_modifier() !=
+            zetasql::ResolvedNonScalarFunctionCallBase::
+                DEFAULT_NULL_HANDLING ||
+        call->having_modifier() != nullptr ||
+        !call->order_by_item_list().empty() || call->limit() != nullptr ||
+        !call->hint_list().empty() ||
+        call->error_mode() !=
+            zetasql::ResolvedFunctionCallBase::DEFAULT_ERROR_MODE) {
+      return nullptr;
+    }
+
+    Aggregate aggregate;
+    const std::string& name = call->function()->Name();
+    if (name == "$count_star" && call->argument_list().empty()) {
+      aggregate.kind = Kind::kCountStar;
+    } else {
+      if (call->argument_list_size() != 1 ||
+          call->argument_list(0)->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+        return nullptr;
+      }
+      auto column_itr = scanned_columns.find(
+          call->argument_list(0)
+              ->GetAs<zetasql::ResolvedColumnRef>()
+              ->column()
+              .column_id());
+      if (column_itr == scanned_columns.end()) {
+        return nullptr;
+      }
+      const zetasql::Type* type = column_itr->second->GetType();
+      if (name == "count") {
+        aggregate.kind = Kind::kCount;
+      } else if (name == "sum" && type->IsInt64()) {
+        aggregate.kind = Kind::kSum;
+      } else if ((name == "min" || name == "max") && HasKeyEquality(type)) {
+        aggregate.kind = name == "min" ? Kind::kMin : Kind::kMax;
+      } else {
+        return nullptr;
+      }
+      auto& names = parallel_aggregate->read_column_names_;
+      auto name_itr =
+          std::find(names.begin(), names.end(), column_itr->second->Name());
+      aggregate.position = name_itr - names.begin();
+      if (name_itr == names.end()) {
+        names.push_back(column_itr->second->Name());
+      }
+    }
+    aggregate_index[computed_column->column().column_id()] =
+        parallel_aggregate->aggregates_.size();
+    parallel_aggregate->aggregates_.push_back(aggregate);
+  }
+
+  // The output columns may name the aggregates in any order.
+  std::vector<Aggregate> aggregates;
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    auto itr = aggregate_index.find(output_column->column().column_id());
+    if (itr == aggregate_index.end()) {
+      return nullptr;
+    }
+    aggregates.push_back(parallel_aggregate->aggregates_[itr->second]);
+    parallel_aggregate->output_column_names_.push_back(output_column->name());
+    parallel_aggregate->output_column_types_.push_back(
+        output_column->column().type());
+  }
+  parallel_aggregate->aggregates_ = std::move(aggregates);
+  return parallel_aggregate;
+}
+
+std::vector<KeyRange> ParallelAggregate::Partition(
+    const DatabaseStatistics* statistics) const {
+  if (statistics == nullptr || table_->primary_key().empty()) {
+    return {KeyRange::All()};
+  }
+  const KeyColumn* first_key_column = table_->primary_key().front();
+  const std::vector<zetasql::Value> bounds = statistics->HistogramBounds(
+      table_->id(), first_key_column->column()->id());
+  const int64_t num_partitions = std::min<int64_t>(
+      {DefaultScanParallelism(),
+       statistics->RowCount(table_->id()).value_or(0) /
+           kMinRowsPerScanPartition,
+       static_cast<int64_t>(bounds.size()) + 1});
+  if (num_partitions <= 1) {
+    return {KeyRange::All()};
+  }
+
+  // About the same number of rows lie between each pair of histogram bounds,
+  // so evenly spaced bounds split the table into ranges of similar sizes.
+  std::vector<Key> split_keys;
+  for (int64_t i = 1; i < num_partitions; ++i) {
+    Key split_key;
+    split_key.AddColumn(bounds[i * bounds.size() / num_partitions],
+                        first_key_column->is_descending());
+    split_keys.push_back(std::move(split_key));
+  }
+  std::sort(split_keys.begin(), split_keys.end());
+  split_keys.erase(std::unique(split_keys.begin(), split_keys.end()),
+                   split_keys.end());
+
+  std::vector<KeyRange> partitions;
+  Key start_key = Key::Empty();
+  for (Key& split_key : split_keys) {
+    partitions.push_back(KeyRange::ClosedOpen(start_key, split_key));
+    start_key = std::move(split_key);
+  }
+  partitions.push_back(KeyRange::ClosedOpen(start_key, Key::Infinity()));
+  return partitions;
+}
+
+void ParallelAggregate::Accumulate(const Aggregate& aggregate,
+                                   const zetasql::Value& argument,
+                                   Accumulator* accumulator) {
+  if (aggregate.kind == Kind::kCountStar) {
+    ++accumulator->count;
+    return;
+  }
+  if (argument.is_null()) {
+    return;
+  }
+  ++accumulator->count;
+  switch (aggregate.kind) {
+    case Kind::kSum:
+      accumulator->overflowed |= __builtin_add_overflow(
+          accumulator->sum, argument.int64_value(), &accumulator->sum);
+      break;
+    case Kind::kMin:
+      if (!accumulator->value.is_valid() ||
+          argument.LessThan(accumulator->value)) {
+        accumulator->value = argument;
+      }
+      break;
+    case Kind::kMax:
+      if (!accumulator->value.is_valid() ||
+          accumulator->value.LessThan(argument)) {
+        accumulator->value = argument;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void ParallelAggregate::Merge(const Aggregate& aggregate,
+                              const Accumulator& partial,
+                              Accumulator* accumulator) {
+  accumulator->count += partial.count;
+  switch (aggregate.kind) {
+    case Kind::kSum:
+      accumulator->overflowed |=
+          partial.overflowed ||
+          __builtin_add_overflow(accumulator->sum, partial.sum,
+                                 &accumulator->sum);
+      break;
+    case Kind::kMin:
+      if (partial.value.is_valid() &&
+          (!accumulator->value.is_valid() ||
+           partial.value.LessThan(accumulator->value))) {
+        accumulator->value = partial.value;
+      }
+      break;
+    case Kind::kMax:
+      if (partial.value.is_valid() &&
+          (!accumulator->value.is_valid() ||
+           accumulator->value.LessThan(partial.value))) {
+        accumulator->value = partial.value;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+absl::StatusOr<bool> ParallelAggregate::Execute(
+    RowReader* reader, const DatabaseStatistics* statistics,
+    std::vector<std::vector<zetasql::Value>>* rows) const {
+  // COUNT(*) alone is answered from the row count of the table, if the reader
+  // keeps one.
+  if (std::all_of(aggregates_.begin(), aggregates_.end(),
+                  [](const Aggregate& aggregate) {
+                    return aggregate.kind == Kind::kCountStar;
+                  })) {
+    if (std::optional<int64_t> row_count = reader->CountRows(table_name_)) {
+      rows->emplace_back(aggregates_.size(),
+                         zetasql::values::Int64(*row_count));
+      return true;
+    }
+  }
+
+  // RowReaders are not thread-safe, so every range is read on this thread and
+  // only the cursors, which are independent of each other, are iterated on
+  // their own threads.
+  const std::vector<KeyRange> partitions = Partition(statistics);
+  std::vector<std::unique_ptr<RowCursor>> cursors(partitions.size());
+  for (int i = 0; i < partitions.size(); ++i) {
+    ReadArg read_arg;
+    read_arg.table = table_name_;
+    read_arg.key_set.AddRange(partitions[i]);
+    read_arg.columns = read_column_names_;
+    ZETASQL_RETURN_IF_ERROR(reader->Read(read_arg, &cursors[i]));
+  }
+
+  std::vector<std::vector<Accumulator>> partials(
+      partitions.size(), std::vector<Accumulator>(aggregates_.size()));
+  ZETASQL_RETURN_IF_ERROR(ScanPartitionsInParallel(
+      partitions, [&](int i, const KeyRange&) -> absl::Status {
+        RowCursor* cursor = cursors[i].get();
+        const zetasql::Value no_argument;
+        int64_t num_rows = 0;
+        while (cursor->Next()) {
+          // Only the first range is scanned on this thread, which may use the
+          // reader.
+          if (i == 0 && ++num_rows % kCancellationCheckRows == 0) {
+            ZETASQL_RETURN_IF_ERROR(reader->CheckNotCancelled());
+          }
+          for (int j = 0; j < aggregates_.size(); ++j) {
+            const Aggregate& aggregate = aggregates_[j];
+            Accumulate(aggregate,
+                       aggregate.position < 0
+                           ? no_argument
+                           : cursor->ColumnValue(aggregate.position),
+                       &partials[i][j]);
+          }
+        }
+        return cursor->Status();
+      }));
+
+  std::vector<zetasql::Value>& row = rows->emplace_back();
+  for (int j = 0; j < aggregates_.size(); ++j) {
+    Accumulator result;
+    for (const std::vector<Accumulator>& partial : partials) {
+      Merge(aggregates_[j], partial[j], &result);
+    }
+    switch (aggregates_[j].kind) {
+      case Kind::kCountStar:
+      case Kind::kCount:
+        row.push_back(zetasql::values::Int64(result.count));
+        break;
+      case Kind::kSum:
+        if (result.overflowed) {
+          rows->clear();
+          return false;
+        }
+        row.push_back(result.count == 0 ? zetasql::values::NullInt64()
+                                        : zetasql::values::Int64(result.sum));
+        break;
+      case Kind::kMin:
+      case Kind::kMax:
+        row.push_back(result.value.is_valid()
+                          ? result.value
+                          : zetasql::Value::Null(output_column_types_[j]));
+        break;
+    }
+  }
+  return true;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,123 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_PARALLEL_AGGREGATE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_PARALLEL_AGGREGATE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// ParallelAggregate is a query which aggregates every row of a table, so that
+// it can be executed by scanning ranges of the table on separate threads and
+// merging the partial aggregates of the ranges, instead of by the ZetaSQL
+// evaluator, which scans the table on a single thread.
+//
+// It matches statements of the form
+//
+//   SELECT <aggregates> FROM <table>
+//
+// in which every aggregate is COUNT(*), or COUNT, SUM, MIN or MAX of a column
+// of the table, without DISTINCT or any other modifier. SUM only matches INT64
+// columns, and MIN and MAX do not match floating point columns, so that the
+// merged aggregates are exactly those the evaluator computes.
+class ParallelAggregate {
+ public:
+  // Returns the ParallelAggregate which statement is equivalent to, or nullptr
+  // if it is not of the form above.
+  static std::unique_ptr<const ParallelAggregate> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  const std::vector<std::string>& output_column_names() const {
+    return output_column_names_;
+  }
+  const std::vector<const zetasql::Type*>& output_column_types() const {
+    return output_column_types_;
+  }
+
+  // Computes the aggregates into the single row of rows. If every aggregate is
+  // COUNT(*), the row count of the reader is used where it has one. Otherwise
+  // the table is split at the histogram bounds of its first key column in
+  // statistics, if it has enough rows, into up to DefaultScanParallelism()
+  // ranges. Returns false if a SUM overflows, in which case the query must be
+  // evaluated to report the error.
+  absl::StatusOr<bool> Execute(
+      RowReader* reader, const DatabaseStatistics* statistics,
+      std::vector<std::vector<zetasql::Value>>* rows) const;
+
+ private:
+  enum class Kind { kCountStar, kCount, kSum, kMin, kMax };
+
+  struct Aggregate {
+    Kind kind;
+
+    // The position of the argument in read_column_names_, or -1 for
+    // COUNT(*).
+    int position = -1;
+  };
+
+  // The partial result of an aggregate over some of the rows of the table.
+  struct Accumulator {
+    // The number of rows, or of non-NULL arguments.
+    int64_t count = 0;
+    int64_t sum = 0;
+    bool overflowed = false;
+
+    // The least or greatest argument, or an invalid value if there was none.
+    zetasql::Value value;
+  };
+
+  ParallelAggregate() = default;
+
+  // Returns the contiguous key ranges, in key order, into which the table is
+  // split for scanning.
+  std::vector<KeyRange> Partition(const DatabaseStatistics* statistics) const;
+
+  static void Accumulate(const Aggregate& aggregate,
+                         const zetasql::Value& argument,
+                         Accumulator* accumulator);
+  static void Merge(const Aggregate& aggregate, const Accumulator& partial,
+                    Accumulator* accumulator);
+
+  const Table* table_ = nullptr;
+  std::string table_name_;
+  std::vector<std::string> read_column_names_;
+  std::vector<Aggregate> aggregates_;
+  std::vector<std::string> output_column_names_;
+  std::vector<const zetasql::Type*> output_column_types_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_PARALLEL_AGGREGATE_H_
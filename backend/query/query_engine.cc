@@ -16,7 +16,10 @@
 
 #include "backend/query/query_engine.h"
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -41,31 +44,52 @@
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/access/write.h"
 #include "backend/common/case.h"
+#include "backend/common/memory_tracker.h"
+#include "backend/datamodel/key_set.h"
 #include "backend/datamodel/value.h"
+#include "backend/query/analyzed_query_cache.h"
 #include "backend/query/analyzer_options.h"
 #include "backend/query/catalog.h"
 #include "backend/query/change_stream/change_stream_query_validator.h"
+#include "backend/query/changed_since_select.h"
+#include "backend/query/dml_key_filter.h"
 #include "backend/query/dml_query_validator.h"
 #include "backend/query/feature_filter/query_size_limits_checker.h"
+#include "backend/query/external_sorter.h"
+#include "backend/query/grouped_aggregate.h"
+#include "backend/query/hash_join.h"
 #include "backend/query/hint_rewriter.h"
 #include "backend/query/index_hint_validator.h"
+#include "backend/query/interleaved_join.h"
+#include "backend/query/parallel_aggregate.h"
 #include "backend/query/partitionability_validator.h"
 #include "backend/query/partitioned_dml_validator.h"
 #include "backend/query/query_engine_options.h"
+#include "backend/query/query_result_cache.h"
+#include "backend/query/query_stats.h"
+#include "backend/query/query_stats_aggregator.h"
 #include "backend/query/query_validator.h"
 #include "backend/query/queryable_column.h"
 #include "backend/query/queryable_table.h"
 #include "backend/query/queryable_view.h"
+#include "backend/query/simple_select.h"
+#include "backend/query/sorted_select.h"
+#include "common/clock.h"
 #include "common/config.h"
 #include "common/constants.h"
 #include "common/errors.h"
 #include "common/limits.h"
+#include "common/metrics.h"
+#include "common/tracing.h"
 #include "frontend/converters/values.h"
 #include "zetasql/base/ret_check.h"
 #include "absl/status/status.h"
@@ -75,8 +99,139 @@ namespace google {
 namespace spanner {
 namespace emulator {
 namespace backend {
+
+// The state of a single execution of a query which is kept until the
+// execution completes, so that it can be recorded in the query statistics.
 namespace {
 
+// A RowReader which reports the cancellation and the deadline of the request
+// a query is executed for through CheckNotCancelled().
+class CancellableRowReader : public RowReader {
+ public:
+  CancellableRowReader(RowReader* reader, const QueryContext& context)
+      : reader_(reader),
+        deadline_(context.deadline),
+        is_cancelled_(context.is_cancelled) {}
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    ZETASQL_RETURN_IF_ERROR(CheckNotCancelled());
+    return reader_->Read(read_arg, cursor);
+  }
+
+  absl::Status CheckNotCancelled() override {
+    if (is_cancelled_ != nullptr && is_cancelled_()) {
+      return error::QueryCancelled();
+    }
+    if (deadline_ != absl::InfiniteFuture() && absl::Now() >= deadline_) {
+      return error::QueryDeadlineExceeded();
+    }
+    return reader_->CheckNotCancelled();
+  }
+
+  std::optional<int64_t> CountRows(const std::string& table_name) override {
+    return reader_->CountRows(table_name);
+  }
+
+ private:
+  RowReader* reader_;
+  const absl::Time deadline_;
+  const std::function<bool()> is_cancelled_;
+};
+
+// A RowReader which reads only the given keys of a table. Used for the scan of
+// the target table of a DML statement which matches a DmlKeyFilter.
+class KeyFilteredRowReader : public RowReader {
+ public:
+  KeyFilteredRowReader(RowReader* reader, std::string table_name,
+                       KeySet key_set)
+      : reader_(reader),
+        table_name_(std::move(table_name)),
+        key_set_(std::move(key_set)) {}
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    if (!absl::EqualsIgnoreCase(read_arg.table, table_name_) ||
+        !read_arg.index.empty()) {
+      return reader_->Read(read_arg, cursor);
+    }
+    ReadArg key_filtered_read_arg = read_arg;
+    key_filtered_read_arg.key_set = key_set_;
+    return reader_->Read(key_filtered_read_arg, cursor);
+  }
+
+  absl::Status CheckNotCancelled() override {
+    return reader_->CheckNotCancelled();
+  }
+
+  std::optional<int64_t> CountRows(const std::string& table_name) override {
+    return reader_->CountRows(table_name);
+  }
+
+ private:
+  RowReader* reader_;
+  const std::string table_name_;
+  const KeySet key_set_;
+};
+
+}  // namespace
+
+struct QueryExecution {
+  QueryExecution(std::string sql, absl::Time start_time,
+                 const QueryContext& context,
+                 std::atomic<int64_t>* rows_scanned,
+                 std::atomic<int64_t>* rows_returned, bool collect_stats)
+      : sql(std::move(sql)),
+        start_time(start_time),
+        rows_scanned(rows_scanned),
+        rows_returned(rows_returned),
+        memory(std::make_shared<MemoryTracker>(
+            config::query_memory_limit_bytes())),
+        cancellable_reader(context.reader, context),
+        reader(&cancellable_reader, &stats, collect_stats) {}
+
+  std::string sql;
+  absl::Time start_time;
+  QueryExecutionStats stats;
+
+  // The counters of Query::rows_scanned and Query::rows_returned, if any.
+  std::atomic<int64_t>* rows_scanned;
+  std::atomic<int64_t>* rows_returned;
+
+  // The memory held by the rows of the execution.
+  std::shared_ptr<MemoryTracker> memory;
+
+  // Fails the reads of the execution once its request has been abandoned.
+  CancellableRowReader cancellable_reader;
+
+  // Counts the rows read by the execution into stats, and records the reads of
+  // queries collecting statistics.
+  StatsCollectingRowReader reader;
+};
+
+namespace {
+
+// The maximum number of rows of a query result held by the result cache.
+constexpr int64_t kMaxCachedQueryResultRows = 10000;
+
+// Queries containing any of these lowercase terms are not cached, since they
+// may return different rows when evaluated again against the same state of the
+// database: the functions are non-deterministic, and the SPANNER_SYS tables
+// change without commits.
+constexpr absl::string_view kUncacheableQueryTerms[] = {
+    "current_date",
+    "current_time",
+    "gen_random_uuid",
+    "generate_uuid",
+    "get_next_sequence_value",
+    "nextval",
+    "now(",
+    "pending_commit_timestamp",
+    "rand",
+    "spanner_sys",
+    "tablesample",
+};
+
 // A RowCursor backed by vectors (one per each row) of values.
 class VectorsRowCursor : public RowCursor {
  public:
@@ -126,6 +281,28 @@ zetasql::EvaluatorOptions CommonEvaluatorOptions(
   absl::LoadTimeZone(kDefaultTimeZone, &time_zone);
   options.default_time_zone = time_zone;
   options.scramble_undefined_orderings = true;
+  // The evaluator fails queries whose intermediate values, such as the rows of
+  // a sort or of a hash join, exceed the limit with RESOURCE_EXHAUSTED.
+  if (config::query_memory_limit_bytes() > 0) {
+    options.max_intermediate_byte_size = config::query_memory_limit_bytes();
+  }
+  return options;
+}
+
+// Returns the number of bytes held by the values of a row.
+int64_t RowByteSize(const std::vector<zetasql::Value>& row) {
+  int64_t bytes = sizeof(row);
+  for (const zetasql::Value& value : row) {
+    bytes += value.physical_byte_size();
+  }
+  return bytes;
+}
+
+// Returns the options of the sorters of queries which spill rows to disk.
+ExternalSorter::Options SpillOptions() {
+  ExternalSorter::Options options;
+  options.memory_budget_bytes = config::query_spill_memory_bytes();
+  options.spill_directory = config::query_spill_dir();
   return options;
 }
 
@@ -138,6 +315,12 @@ absl::StatusOr<zetasql::AnalyzerOptions> MakeAnalyzerOptionsWithParameters(
   return options;
 }
 
+// Returns the histogram of time spent in the given stage of query execution.
+metrics::LatencyHistogram* QueryStageHistogram(absl::string_view stage) {
+  return metrics::GetLatencyHistogram("emulator_query_stage_latency_seconds",
+                                      "stage", stage);
+}
+
 // Uses googlesql/public/analyzer to build an AnalyzerOutput for an query.
 // We need to analyze the SQL before executing it in order to determine what
 // kind of statement (query or DML) it is.
@@ -145,6 +328,8 @@ absl::StatusOr<std::unique_ptr<const zetasql::AnalyzerOutput>> Analyze(
     const std::string& sql, zetasql::Catalog* catalog,
     const zetasql::AnalyzerOptions& options,
     zetasql::TypeFactory* type_factory) {
+  static metrics::LatencyHistogram* histogram = QueryStageHistogram("analyze");
+  metrics::ScopedLatencyTimer timer(histogram);
   // Check the overall length of the query string.
   if (sql.size() > limits::kMaxQueryStringSize) {
     return error::QueryStringTooLong(sql.size(), limits::kMaxQueryStringSize);
@@ -377,24 +562,42 @@ absl::StatusOr<CaseInsensitiveStringSet> PendingCommitTimestampColumnsInUpdate(
   return pending_ts_columns;
 }
 
+// Prepares statement for evaluation, unless an earlier execution of it already
+// has.
+absl::Status MaybePrepareModify(
+    const zetasql::ResolvedStatement* statement,
+    const zetasql::ParameterValueMap& parameters,
+    zetasql::TypeFactory* type_factory,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_modify) {
+  if (*prepared_modify != nullptr) {
+    return absl::OkStatus();
+  }
+  auto prepared = std::make_unique<zetasql::PreparedModify>(
+      statement, CommonEvaluatorOptions(type_factory));
+  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
+                   MakeAnalyzerOptionsWithParameters(parameters));
+  ZETASQL_RETURN_IF_ERROR(prepared->Prepare(analyzer_options));
+  *prepared_modify = std::move(prepared);
+  return absl::OkStatus();
+}
+
 absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedInsert(
     const zetasql::ResolvedInsertStmt* insert_statement,
     const zetasql::ParameterValueMap& parameters,
-    zetasql::TypeFactory* type_factory) {
+    zetasql::TypeFactory* type_factory,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_insert) {
   ZETASQL_ASSIGN_OR_RETURN(auto pending_ts_columns,
                    PendingCommitTimestampColumnsInInsert(
                        insert_statement->insert_column_list(),
                        insert_statement->row_list()));
 
-  auto prepared_insert = std::make_unique<zetasql::PreparedModify>(
-      insert_statement, CommonEvaluatorOptions(type_factory));
-  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
-                   MakeAnalyzerOptionsWithParameters(parameters));
-  ZETASQL_RETURN_IF_ERROR(prepared_insert->Prepare(analyzer_options));
+  ZETASQL_RETURN_IF_ERROR(MaybePrepareModify(insert_statement, parameters,
+                                     type_factory, prepared_insert));
 
   std::unique_ptr<zetasql::EvaluatorTableIterator> returning_iter;
   // `returning_iter` can be NULL if there is no THEN RETURN clause.
-  auto status_or = prepared_insert->Execute(parameters, {}, &returning_iter);
+  auto status_or =
+      (*prepared_insert)->Execute(parameters, {}, &returning_iter);
   if (!status_or.ok()) {
     return MaybeTransformZetaSQLDMLError(status_or.status());
   }
@@ -411,19 +614,18 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedInsert(
 absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedUpdate(
     const zetasql::ResolvedUpdateStmt* update_statement,
     const zetasql::ParameterValueMap& parameters,
-    zetasql::TypeFactory* type_factory) {
+    zetasql::TypeFactory* type_factory,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_update) {
   ZETASQL_ASSIGN_OR_RETURN(auto pending_ts_columns,
                    PendingCommitTimestampColumnsInUpdate(
                        update_statement->update_item_list()));
 
-  auto prepared_update = std::make_unique<zetasql::PreparedModify>(
-      update_statement, CommonEvaluatorOptions(type_factory));
-  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
-                   MakeAnalyzerOptionsWithParameters(parameters));
-  ZETASQL_RETURN_IF_ERROR(prepared_update->Prepare(analyzer_options));
+  ZETASQL_RETURN_IF_ERROR(MaybePrepareModify(update_statement, parameters,
+                                     type_factory, prepared_update));
 
   std::unique_ptr<zetasql::EvaluatorTableIterator> returning_iter;
-  auto status_or = prepared_update->Execute(parameters, {}, &returning_iter);
+  auto status_or =
+      (*prepared_update)->Execute(parameters, {}, &returning_iter);
   if (!status_or.ok()) {
     return MaybeTransformZetaSQLDMLError(status_or.status());
   }
@@ -439,16 +641,15 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedUpdate(
 absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedDelete(
     const zetasql::ResolvedDeleteStmt* delete_statement,
     const zetasql::ParameterValueMap& parameters,
-    zetasql::TypeFactory* type_factory) {
-  auto prepared_delete = std::make_unique<zetasql::PreparedModify>(
-      delete_statement, CommonEvaluatorOptions(type_factory));
-  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
-                   MakeAnalyzerOptionsWithParameters(parameters));
-  ZETASQL_RETURN_IF_ERROR(prepared_delete->Prepare(analyzer_options));
+    zetasql::TypeFactory* type_factory,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_delete) {
+  ZETASQL_RETURN_IF_ERROR(MaybePrepareModify(delete_statement, parameters,
+                                     type_factory, prepared_delete));
 
   std::unique_ptr<zetasql::EvaluatorTableIterator> returning_iter;
-  ZETASQL_ASSIGN_OR_RETURN(auto iterator,
-                   prepared_delete->Execute(parameters, {}, &returning_iter));
+  ZETASQL_ASSIGN_OR_RETURN(
+      auto iterator,
+      (*prepared_delete)->Execute(parameters, {}, &returning_iter));
   ZETASQL_ASSIGN_OR_RETURN(auto cursor,
                    BuildReturningRowResult(std::move(returning_iter)));
 
@@ -458,24 +659,27 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedDelete(
 }
 
 // Uses googlesql/public/evaluator to evaluate a DML statement represented by a
-// resolved AST and returns a pair of mutation and count of modified rows.
+// resolved AST and returns a pair of mutation and count of modified rows. The
+// statement is prepared into prepared_modify, unless it already holds the
+// prepared statement of an earlier execution.
 absl::StatusOr<ExecuteUpdateResult> EvaluateUpdate(
     const zetasql::ResolvedStatement* resolved_statement,
     zetasql::Catalog* catalog, const zetasql::ParameterValueMap& parameters,
-    zetasql::TypeFactory* type_factory) {
+    zetasql::TypeFactory* type_factory,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_modify) {
   switch (resolved_statement->node_kind()) {
     case zetasql::RESOLVED_INSERT_STMT:
       return EvaluateResolvedInsert(
           resolved_statement->GetAs<zetasql::ResolvedInsertStmt>(),
-          parameters, type_factory);
+          parameters, type_factory, prepared_modify);
     case zetasql::RESOLVED_UPDATE_STMT:
       return EvaluateResolvedUpdate(
           resolved_statement->GetAs<zetasql::ResolvedUpdateStmt>(),
-          parameters, type_factory);
+          parameters, type_factory, prepared_modify);
     case zetasql::RESOLVED_DELETE_STMT:
       return EvaluateResolvedDelete(
           resolved_statement->GetAs<zetasql::ResolvedDeleteStmt>(),
-          parameters, type_factory);
+          parameters, type_factory, prepared_modify);
     default:
       ZETASQL_RET_CHECK_FAIL() << "Unsupported support node kind "
                        << ResolvedNodeKind_Name(
@@ -484,12 +688,15 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateUpdate(
   }
 }
 
-// Uses googlesql/public/evaluator to evaluate a query statement represented by
-// a resolved AST and returns a row cursor.
-absl::StatusOr<std::unique_ptr<RowCursor>> EvaluateQuery(
+// Uses googlesql/public/evaluator to prepare a query statement represented by
+// a resolved AST for execution. The returned prepared query references
+// resolved_statement, which must outlive it.
+absl::StatusOr<std::unique_ptr<zetasql::PreparedQuery>> PrepareQuery(
     const zetasql::ResolvedStatement* resolved_statement,
     const zetasql::ParameterValueMap& params,
-    zetasql::TypeFactory* type_factory, int64_t* num_output_rows) {
+    zetasql::TypeFactory* type_factory) {
+  static metrics::LatencyHistogram* histogram = QueryStageHistogram("prepare");
+  metrics::ScopedLatencyTimer timer(histogram);
   ZETASQL_RET_CHECK_EQ(resolved_statement->node_kind(), zetasql::RESOLVED_QUERY_STMT)
       << "input is not a query statement";
 
@@ -501,8 +708,33 @@ absl::StatusOr<std::unique_ptr<RowCursor>> EvaluateQuery(
   ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
                    MakeAnalyzerOptionsWithParameters(params));
   ZETASQL_RETURN_IF_ERROR(prepared_query->Prepare(analyzer_options));
-  // Finally execute the query.
+  return prepared_query;
+}
+
+// Executes a prepared query, aborting its evaluation once `deadline` passes.
+// The deadline is set on the iterator rather than in the evaluator options, as
+// the prepared query is shared by all executions of a cached statement.
+absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>>
+ExecutePreparedQuery(zetasql::PreparedQuery* prepared_query,
+                     const zetasql::ParameterValueMap& params,
+                     absl::Time deadline) {
   ZETASQL_ASSIGN_OR_RETURN(auto iterator, prepared_query->Execute(params));
+  if (deadline != absl::InfiniteFuture()) {
+    iterator->SetDeadline(deadline);
+  }
+  return iterator;
+}
+
+// Uses googlesql/public/evaluator to evaluate a prepared query statement and
+// returns a row cursor. The materialized rows are charged to memory.
+absl::StatusOr<std::unique_ptr<RowCursor>> EvaluateQuery(
+    zetasql::PreparedQuery* prepared_query,
+    const zetasql::ParameterValueMap& params, absl::Time deadline,
+    MemoryTracker* memory, int64_t* num_output_rows) {
+  static metrics::LatencyHistogram* histogram = QueryStageHistogram("evaluate");
+  metrics::ScopedLatencyTimer timer(histogram);
+  ZETASQL_ASSIGN_OR_RETURN(auto iterator,
+                   ExecutePreparedQuery(prepared_query, params, deadline));
 
   std::vector<std::vector<zetasql::Value>> values;
   while (iterator->NextRow()) {
@@ -511,8 +743,15 @@ absl::StatusOr<std::unique_ptr<RowCursor>> EvaluateQuery(
     for (int i = 0; i < iterator->NumColumns(); ++i) {
       values.back().push_back(iterator->GetValue(i));
     }
+    ZETASQL_RETURN_IF_ERROR(memory->Reserve(RowByteSize(values.back())));
   }
-  ZETASQL_RETURN_IF_ERROR(iterator->Status());
+  absl::Status status = iterator->Status();
+  if (!status.ok() && deadline != absl::InfiniteFuture() &&
+      absl::Now() >= deadline) {
+    // Report the evaluator's own deadline error like the one of table scans.
+    return error::QueryDeadlineExceeded();
+  }
+  ZETASQL_RETURN_IF_ERROR(status);
   *num_output_rows = values.size();
   std::vector<std::string> names;
   std::vector<const zetasql::Type*> types;
@@ -606,27 +845,31 @@ ExtractValidatedResolvedStatementAndOptions(
                    rewriter.ConsumeRootNode<zetasql::ResolvedStatement>());
 
   // Validate the query and extract and return any options specified
-  // through hint if the caller requested them.
+  // through hint if the caller requested them. The index hints and the query
+  // size limits are checked during the same walk of the tree.
   QueryEngineOptions options;
   std::unique_ptr<QueryValidator> query_validator =
       IsDMLStmtWitoutSelect(analyzer_output->resolved_statement())
           ? std::make_unique<DMLQueryValidator>(schema, &options)
           : std::make_unique<QueryValidator>(schema, &options);
+  IndexHintValidator index_hint_validator{schema};
+  QuerySizeLimitsChecker checker;
+  query_validator->AddNodeChecker(&index_hint_validator);
+  query_validator->AddNodeChecker(&checker);
   ZETASQL_RETURN_IF_ERROR(statement->Accept(query_validator.get()));
   if (query_engine_options != nullptr) {
     *query_engine_options = options;
   }
 
   // Validate the index hints.
-  IndexHintValidator index_hint_validator{
-      schema, options.disable_query_null_filtered_index_check ||
-                  config::disable_query_null_filtered_index_check()};
-  ZETASQL_RETURN_IF_ERROR(statement->Accept(&index_hint_validator));
+  index_hint_validator.set_disable_null_filtered_index_check(
+      options.disable_query_null_filtered_index_check ||
+      config::disable_query_null_filtered_index_check());
+  ZETASQL_RETURN_IF_ERROR(index_hint_validator.Finish());
 
   // Check the query size limits
   // https://cloud.google.com/spanner/quotas#query_limits
-  QuerySizeLimitsChecker checker;
-  ZETASQL_RETURN_IF_ERROR(checker.CheckQueryAgainstLimits(statement.get()));
+  ZETASQL_RETURN_IF_ERROR(checker.Finish());
 
   return statement;
 }
@@ -658,16 +901,26 @@ class ExtractDmlTargetTableVisitor : public zetasql::ResolvedASTVisitor {
 };
 
 // A QueryEvaluator instance against a specific QueryEngine and QueryContext.
+// View definitions are analyzed and prepared once per schema, and reused from
+// view_cache by later evaluations.
 class QueryEvaluatorForEngine : public QueryEvaluator {
  public:
   QueryEvaluatorForEngine(const QueryEngine& query_engine,
-                          const QueryContext& query_context)
-      : query_engine_(query_engine), query_context_(query_context) {}
+                          const QueryContext& query_context,
+                          AnalyzedQueryCache* view_cache,
+                          std::atomic<int64_t>* rows_scanned)
+      : query_engine_(query_engine),
+        query_context_(query_context),
+        view_cache_(view_cache),
+        rows_scanned_(rows_scanned) {}
   ~QueryEvaluatorForEngine() override = default;
 
   absl::StatusOr<std::unique_ptr<RowCursor>> Evaluate(
       const std::string& query) override {
     Query q{/*sql=*/query, /*declared_params=*/{}, /*undeclared_params=*/{}};
+    q.statement_cache = view_cache_;
+    // The rows of a view are read by the query using it, not returned.
+    q.rows_scanned = rows_scanned_;
 
     ZETASQL_ASSIGN_OR_RETURN(auto result, query_engine_.ExecuteSql(q, query_context_));
     return std::move(result.rows);
@@ -675,9 +928,204 @@ class QueryEvaluatorForEngine : public QueryEvaluator {
 
  private:
   const QueryEngine& query_engine_;
-  const QueryContext& query_context_;
+  // Held by value since streamed query results may outlive the context passed
+  // to QueryEngine::ExecuteSql.
+  const QueryContext query_context_;
+  AnalyzedQueryCache* view_cache_;
+  std::atomic<int64_t>* rows_scanned_;
+};
+
+// Records the completion of execution in query_stats, if set, and adds the
+// rows it read and returned to the counters of its query, if any.
+void RecordQueryExecution(QueryStatsAggregator* query_stats,
+                          const QueryExecution& execution, bool failed,
+                          int64_t rows_returned, int64_t rows_written) {
+  if (execution.rows_scanned != nullptr) {
+    execution.rows_scanned->fetch_add(execution.stats.rows_scanned,
+                                      std::memory_order_relaxed);
+  }
+  if (execution.rows_returned != nullptr) {
+    execution.rows_returned->fetch_add(rows_returned,
+                                       std::memory_order_relaxed);
+  }
+  if (query_stats == nullptr) {
+    return;
+  }
+  absl::Time now = absl::Now();
+  QueryExecutionSample sample;
+  sample.sql = execution.sql;
+  sample.failed = failed;
+  sample.latency = now - execution.start_time;
+  sample.rows_returned = rows_returned;
+  sample.rows_scanned = execution.stats.rows_scanned;
+  sample.rows_written = rows_written;
+  query_stats->Record(sample, now);
+}
+
+// A RowCursor which pulls rows from a live ZetaSQL evaluator iterator as they
+// are requested instead of materializing them up front. It owns the analyzed
+// query the iterator depends on so that it can outlive the
+// QueryEngine::ExecuteSql call which created it, and returns it to the query
+// cache (if any) once it is destroyed. The execution is recorded in the query
+// statistics at that point too.
+class StreamingRowCursor : public RowCursor {
+ public:
+  StreamingRowCursor(std::unique_ptr<AnalyzedQuery> analyzed_query,
+                     std::unique_ptr<zetasql::EvaluatorTableIterator> iterator,
+                     AnalyzedQueryCache* query_cache,
+                     AnalyzedQueryCache::Key cache_key,
+                     std::unique_ptr<QueryExecution> execution,
+                     QueryStatsAggregator* query_stats)
+      : analyzed_query_(std::move(analyzed_query)),
+        iterator_(std::move(iterator)),
+        query_cache_(query_cache),
+        cache_key_(std::move(cache_key)),
+        execution_(std::move(execution)),
+        query_stats_(query_stats) {}
+
+  ~StreamingRowCursor() override {
+    bool failed = !iterator_->Status().ok();
+    iterator_.reset();
+    RecordQueryExecution(query_stats_, *execution_, failed, rows_returned_,
+                         /*rows_written=*/0);
+    if (query_cache_ != nullptr) {
+      query_cache_->Return(cache_key_, std::move(analyzed_query_));
+    }
+  }
+
+  bool Next() override {
+    if (!iterator_->NextRow()) {
+      return false;
+    }
+    ++rows_returned_;
+    return true;
+  }
+
+  absl::Status Status() const override { return iterator_->Status(); }
+
+  int NumColumns() const override { return iterator_->NumColumns(); }
+
+  const std::string ColumnName(int i) const override {
+    return iterator_->GetColumnName(i);
+  }
+
+  const zetasql::Type* ColumnType(int i) const override {
+    return iterator_->GetColumnType(i);
+  }
+
+  const zetasql::Value ColumnValue(int i) const override {
+    return iterator_->GetValue(i);
+  }
+
+ private:
+  std::unique_ptr<AnalyzedQuery> analyzed_query_;
+  std::unique_ptr<zetasql::EvaluatorTableIterator> iterator_;
+  AnalyzedQueryCache* query_cache_;
+  AnalyzedQueryCache::Key cache_key_;
+  std::unique_ptr<QueryExecution> execution_;
+  QueryStatsAggregator* query_stats_;
+  int64_t rows_returned_ = 0;
 };
 
+// Returns the key of the cached result of query in context, or nullopt if its
+// result must not be cached: it may modify the database, may return different
+// rows when evaluated again against the same state of the database, or reads
+// statistics which change without commits. Queries without an ORDER BY are
+// not cached, and neither are those whose ORDER BY turns out not to be total.
+std::optional<QueryResultCache::Key> MakeQueryResultCacheKey(
+    const Query& query, const QueryContext& context) {
+  if (!context.snapshot_epoch.has_value() || context.writer != nullptr ||
+      query.change_stream_internal_lookup.has_value()) {
+    return std::nullopt;
+  }
+  const std::string sql = absl::AsciiStrToLower(query.sql);
+  if (!absl::StrContains(sql, "order by")) {
+    return std::nullopt;
+  }
+  for (absl::string_view uncacheable : kUncacheableQueryTerms) {
+    if (absl::StrContains(sql, uncacheable)) {
+      return std::nullopt;
+    }
+  }
+
+  std::string parameters;
+  for (const auto& [name, value] : query.declared_params) {
+    absl::StrAppend(&parameters, name, ":", value.FullDebugString(), ",");
+  }
+  for (const auto& [name, value] : query.undeclared_params) {
+    absl::StrAppend(&parameters, name, ":?", value.ShortDebugString(), ",");
+  }
+  return QueryResultCache::Key{context.schema, query.sql,
+                               std::move(parameters), *context.snapshot_epoch,
+                               query.collect_stats};
+}
+
+// Returns whether statement is a query which orders its rows by all of its
+// output columns. Rows which tie under the ORDER BY are identical, so every
+// evaluation of the query returns its rows in the same order.
+bool IsTotallyOrdered(const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT) {
+    return false;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() == zetasql::RESOLVED_LIMIT_OFFSET_SCAN) {
+    scan = scan->GetAs<zetasql::ResolvedLimitOffsetScan>()->input_scan();
+  }
+  if (scan->node_kind() != zetasql::RESOLVED_ORDER_BY_SCAN) {
+    return false;
+  }
+  absl::flat_hash_set<int> ordered_column_ids;
+  for (const auto& item :
+       scan->GetAs<zetasql::ResolvedOrderByScan>()->order_by_item_list()) {
+    ordered_column_ids.insert(item->column_ref()->column().column_id());
+  }
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    if (!ordered_column_ids.contains(output_column->column().column_id())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the rows of cursor, returned by an execution with the given stats, into
+// a result which can be cached.
+absl::StatusOr<std::shared_ptr<const CachedQueryResult>> MaterializeResult(
+    RowCursor* cursor, const QueryExecutionStats& stats) {
+  auto result = std::make_shared<CachedQueryResult>();
+  result->stats = stats;
+  for (int i = 0; i < cursor->NumColumns(); ++i) {
+    result->column_names.push_back(cursor->ColumnName(i));
+    result->column_types.push_back(cursor->ColumnType(i));
+  }
+  while (cursor->Next()) {
+    std::vector<zetasql::Value> row;
+    row.reserve(cursor->NumColumns());
+    for (int i = 0; i < cursor->NumColumns(); ++i) {
+      row.push_back(cursor->ColumnValue(i));
+    }
+    result->rows.push_back(std::move(row));
+  }
+  ZETASQL_RETURN_IF_ERROR(cursor->Status());
+  return result;
+}
+
+// Returns the key identifying the analysis of query against schema.
+AnalyzedQueryCache::Key MakeAnalyzedQueryCacheKey(const Query& query,
+                                                  const Schema* schema) {
+  std::string parameters;
+  for (const auto& [name, value] : query.declared_params) {
+    absl::StrAppend(&parameters, name, ":", value.type()->DebugString(), ",");
+  }
+  // The types of undeclared parameters are inferred by the analyzer, so only
+  // their names matter.
+  for (const auto& [name, value] : query.undeclared_params) {
+    absl::StrAppend(&parameters, name, ":?,");
+  }
+  return AnalyzedQueryCache::Key{schema, query.sql, std::move(parameters),
+                                 query.change_stream_internal_lookup};
+}
+
 }  // namespace
 
 absl::StatusOr<std::string> QueryEngine::GetDmlTargetTable(
@@ -685,7 +1133,10 @@ absl::StatusOr<std::string> QueryEngine::GetDmlTargetTable(
   ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
                    MakeAnalyzerOptionsWithParameters(query.declared_params));
   analyzer_options.set_prune_unused_columns(true);
-  Catalog catalog(schema, &function_catalog_, type_factory_, analyzer_options);
+  Catalog catalog(schema, function_catalog_, type_factory_, analyzer_options,
+                  /*reader=*/nullptr, /*query_evaluator=*/nullptr,
+                  /*change_stream_internal_lookup=*/std::nullopt,
+                  information_schema_cache_.get());
   ZETASQL_ASSIGN_OR_RETURN(
       auto analyzer_output,
       Analyze(query.sql, &catalog, analyzer_options, type_factory_));
@@ -703,73 +1154,477 @@ absl::StatusOr<std::string> QueryEngine::GetDmlTargetTable(
   return *visitor.target_table();
 }
 
-absl::StatusOr<QueryResult> QueryEngine::ExecuteSql(
-    const Query& query, const QueryContext& context) const {
-  absl::Time start_time = absl::Now();
+QueryEngine::QueryEngine(zetasql::TypeFactory* type_factory,
+                         const Storage* storage,
+                         const LockStatsAggregator* lock_stats,
+                         const TransactionStatsAggregator* txn_stats,
+                         const ReadStatsAggregator* read_stats,
+                         const DatabaseStatistics* statistics,
+                         const CommitTimestampIndex* commit_timestamp_index)
+    : type_factory_(type_factory),
+      function_catalog_(FunctionCatalog::Default()),
+      storage_(storage),
+      lock_stats_(lock_stats),
+      txn_stats_(txn_stats),
+      read_stats_(read_stats),
+      statistics_(statistics),
+      commit_timestamp_index_(commit_timestamp_index) {
+  if (config::query_cache_size() > 0) {
+    query_cache_ =
+        std::make_unique<AnalyzedQueryCache>(config::query_cache_size());
+  }
+  if (config::query_result_cache_size() > 0) {
+    result_cache_ = std::make_unique<QueryResultCache>(
+        config::query_result_cache_size(), kMaxCachedQueryResultRows);
+  }
+}
+
+void QueryEngine::EraseSchema(const Schema* schema) {
+  if (query_cache_ != nullptr) {
+    query_cache_->EraseSchema(schema);
+  }
+  view_cache_->EraseSchema(schema);
+  if (result_cache_ != nullptr) {
+    result_cache_->EraseSchema(schema);
+  }
+  information_schema_cache_->EraseSchema(schema);
+}
+
+absl::StatusOr<std::unique_ptr<AnalyzedQuery>> QueryEngine::AnalyzeQuery(
+    const Query& query, const Schema* schema, absl::Time start_time,
+    zetasql::ParameterValueMap* params,
+    QueryExecutionStats* stats) const {
+  tracing::ScopedSpan span("QueryEngine.Analyze");
+  const absl::Duration analyze_start =
+      stats != nullptr ? ThreadCpuTime() : absl::ZeroDuration();
   ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
                    MakeAnalyzerOptionsWithParameters(query.declared_params));
   analyzer_options.set_prune_unused_columns(true);
 
-  QueryEvaluatorForEngine view_evaluator(*this, context);
-  Catalog catalog{
-      context.schema,
-      &function_catalog_,
-      type_factory_,
-      analyzer_options,
-      context.reader,
-      &view_evaluator,
-      query.change_stream_internal_lookup,
-  };
+  auto analyzed_query = std::make_unique<AnalyzedQuery>();
+  analyzed_query->catalog = std::make_unique<Catalog>(
+      schema, function_catalog_, type_factory_, analyzer_options,
+      analyzed_query->reader(), analyzed_query->view_evaluator(),
+      query.change_stream_internal_lookup, information_schema_cache_.get(),
+      query_stats_.get(), storage_, lock_stats_, txn_stats_, read_stats_);
+  Catalog* catalog = analyzed_query->catalog.get();
+  if (statistics_ != nullptr) {
+    catalog->SetStatistics(statistics_);
+  }
 
   std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
-    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, &catalog,
+    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, catalog,
                                               analyzer_options, type_factory_));
 
-  ZETASQL_ASSIGN_OR_RETURN(auto params,
-                   ExtractParameters(query, analyzer_output.get()));
+  ZETASQL_ASSIGN_OR_RETURN(*params, ExtractParameters(query, analyzer_output.get()));
 
+  QueryEngineOptions options;
   ZETASQL_ASSIGN_OR_RETURN(auto resolved_statement,
                    ExtractValidatedResolvedStatementAndOptions(
-                       analyzer_output.get(), context.schema));
+                       analyzer_output.get(), schema, &options));
+  // Queries which name their indexes are read exactly as hinted.
+  if (options.has_force_index_hint) {
+    catalog->DisableIndexSelection();
+  }
 
   // Change stream queries are not directly executed via this generic ExecuteSql
   // function in query engine. If a change stream query reaches here, it is from
   // an incorrect API(only ExecuteStreamingSql is allowed).
   ChangeStreamQueryValidator validator{
-      context.schema, start_time,
-      absl::flat_hash_map<std::string, zetasql::Value>(params.begin(),
-                                                         params.end())};
+      schema, start_time,
+      absl::flat_hash_map<std::string, zetasql::Value>(params->begin(),
+                                                         params->end())};
   ZETASQL_ASSIGN_OR_RETURN(auto is_change_stream,
                    validator.IsChangeStreamQuery(resolved_statement.get()));
   if (is_change_stream) {
     return error::ChangeStreamQueriesMustBeStreaming();
   }
 
-  QueryResult result;
+  const absl::Duration prepare_start =
+      stats != nullptr ? ThreadCpuTime() : absl::ZeroDuration();
+  if (stats != nullptr) {
+    stats->analyze_cpu_time = prepare_start - analyze_start;
+  }
   if (!IsDMLStmt(analyzer_output->resolved_statement()->node_kind())) {
-    ZETASQL_ASSIGN_OR_RETURN(auto cursor,
-                     EvaluateQuery(resolved_statement.get(), params,
-                                   type_factory_, &result.num_output_rows));
-    result.rows = std::move(cursor);
+    // Simple selects are read directly, so their evaluator is only prepared
+    // once the parameters of an execution rule out the point read, and so are
+    // selects of the rows changed since a timestamp. Joins of
+    // interleaved tables on the parent key are merged and never evaluated, and
+    // other equality joins of two tables are hash joined. Aggregates of whole
+    // tables are scanned in parallel, and only evaluated if a SUM overflows.
+    // With a spill memory budget, sorts and grouped aggregates of a table are
+    // executed within the budget, and likewise only evaluated on overflow.
+    analyzed_query->simple_select =
+        SimpleSelect::Match(resolved_statement.get());
+    if (analyzed_query->simple_select == nullptr &&
+        commit_timestamp_index_ != nullptr) {
+      analyzed_query->changed_since_select =
+          ChangedSinceSelect::Match(resolved_statement.get());
+    }
+    if (analyzed_query->simple_select == nullptr) {
+      analyzed_query->interleaved_join =
+          InterleavedJoin::Match(resolved_statement.get());
+    }
+    if (analyzed_query->simple_select == nullptr &&
+        analyzed_query->interleaved_join == nullptr) {
+      analyzed_query->hash_join = HashJoin::Match(resolved_statement.get());
+    }
+    if (analyzed_query->simple_select == nullptr &&
+        analyzed_query->interleaved_join == nullptr &&
+        analyzed_query->hash_join == nullptr) {
+      analyzed_query->parallel_aggregate =
+          ParallelAggregate::Match(resolved_statement.get());
+    }
+    if (config::query_spill_memory_bytes() > 0 &&
+        analyzed_query->simple_select == nullptr) {
+      analyzed_query->sorted_select =
+          SortedSelect::Match(resolved_statement.get());
+      analyzed_query->grouped_aggregate =
+          GroupedAggregate::Match(resolved_statement.get());
+    }
+    if (analyzed_query->simple_select == nullptr &&
+        analyzed_query->changed_since_select == nullptr &&
+        analyzed_query->interleaved_join == nullptr &&
+        analyzed_query->hash_join == nullptr &&
+        analyzed_query->parallel_aggregate == nullptr &&
+        analyzed_query->sorted_select == nullptr &&
+        analyzed_query->grouped_aggregate == nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          analyzed_query->prepared_query,
+          PrepareQuery(resolved_statement.get(), *params, type_factory_));
+    }
   } else {
-    ZETASQL_RET_CHECK_NE(context.writer, nullptr);
     analyzer_options.set_prune_unused_columns(false);
       ZETASQL_ASSIGN_OR_RETURN(
           analyzer_output,
-          Analyze(query.sql, &catalog, analyzer_options, type_factory_));
+          Analyze(query.sql, catalog, analyzer_options, type_factory_));
     ZETASQL_ASSIGN_OR_RETURN(resolved_statement,
                      ExtractValidatedResolvedStatementAndOptions(
-                         analyzer_output.get(), context.schema));
+                         analyzer_output.get(), schema));
+    // UPDATE and DELETE statements which compare key columns with values
+    // only scan the matching keys of their target table.
+    analyzed_query->dml_key_filter =
+        DmlKeyFilter::Match(resolved_statement.get());
+  }
 
-    ZETASQL_ASSIGN_OR_RETURN(auto execute_update_result,
-                     EvaluateUpdate(resolved_statement.get(), &catalog, params,
-                                    type_factory_));
+  if (stats != nullptr) {
+    stats->prepare_cpu_time = ThreadCpuTime() - prepare_start;
+  }
+
+  analyzed_query->analyzer_output = std::move(analyzer_output);
+  analyzed_query->resolved_statement = std::move(resolved_statement);
+  return analyzed_query;
+}
+
+absl::StatusOr<QueryResult> QueryEngine::ExecuteSql(
+    const Query& query, const QueryContext& context) const {
+  // Internal change stream lookups are not user queries, so they are left out
+  // of the query statistics.
+  QueryStatsAggregator* query_stats =
+      query.change_stream_internal_lookup.has_value() ? nullptr
+                                                      : query_stats_.get();
+
+  // Reads are always counted so that they can be reported in the query
+  // statistics, but only described for queries which collect statistics. A
+  // streamed query takes over the execution, and records it once its cursor is
+  // destroyed.
+  auto execution = std::make_unique<QueryExecution>(
+      query.sql, absl::Now(), context, query.rows_scanned, query.rows_returned,
+      query.collect_stats);
+
+  // A query whose result is cached is not evaluated, and reads nothing.
+  std::optional<QueryResultCache::Key> result_key;
+  if (result_cache_ != nullptr) {
+    result_key = MakeQueryResultCacheKey(query, context);
+  }
+  if (result_key.has_value()) {
+    if (std::shared_ptr<const CachedQueryResult> cached =
+            result_cache_->Lookup(*result_key)) {
+      QueryResult result;
+      result.num_output_rows = cached->rows.size();
+      result.is_totally_ordered = true;
+      if (query.collect_stats) {
+        result.stats = cached->stats;
+      }
+      result.rows = MakeCachedQueryResultCursor(std::move(cached));
+      result.elapsed_time = absl::Now() - execution->start_time;
+      RecordQueryExecution(query_stats, *execution, /*failed=*/false,
+                           result.num_output_rows, /*rows_written=*/0);
+      return result;
+    }
+  }
+
+  // The result of a cached query is materialized, so that it can be added to
+  // the cache once evaluated.
+  std::optional<Query> materialized_query;
+  if (result_key.has_value() && query.stream_results) {
+    materialized_query = query;
+    materialized_query->stream_results = false;
+  }
+  absl::StatusOr<QueryResult> result = ExecuteSqlInternal(
+      materialized_query.has_value() ? *materialized_query : query, context,
+      query_stats, &execution);
+  if (result.ok() && result_key.has_value() && result->rows != nullptr &&
+      result->is_totally_ordered) {
+    absl::StatusOr<std::shared_ptr<const CachedQueryResult>> cached =
+        MaterializeResult(result->rows.get(), result->stats);
+    if (!cached.ok()) {
+      result = cached.status();
+    } else {
+      result_cache_->Insert(*result_key, *cached);
+      result->rows = MakeCachedQueryResultCursor(*std::move(cached));
+    }
+  }
+  if (!result.ok()) {
+    RecordQueryExecution(query_stats, *execution, /*failed=*/true,
+                         /*rows_returned=*/0, /*rows_written=*/0);
+  } else if (execution != nullptr) {
+    RecordQueryExecution(query_stats, *execution, /*failed=*/false,
+                         result->num_output_rows, result->modified_row_count);
+  }
+  return result;
+}
+
+absl::StatusOr<QueryResult> QueryEngine::ExecuteSqlInternal(
+    const Query& query, const QueryContext& context,
+    QueryStatsAggregator* query_stats,
+    std::unique_ptr<QueryExecution>* execution) const {
+  const absl::Time start_time = (*execution)->start_time;
+  QueryExecutionStats* stats = &(*execution)->stats;
+
+  // Reuse the analysis of an identical earlier statement if one is cached.
+  AnalyzedQueryCache* query_cache = query.statement_cache != nullptr
+                                        ? query.statement_cache
+                                        : query_cache_.get();
+  AnalyzedQueryCache::Key cache_key =
+      MakeAnalyzedQueryCacheKey(query, context.schema);
+  std::unique_ptr<AnalyzedQuery> analyzed_query;
+  if (query_cache != nullptr) {
+    analyzed_query = query_cache->Checkout(cache_key);
+  }
+  zetasql::ParameterValueMap params;
+  if (analyzed_query == nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(analyzed_query,
+                     AnalyzeQuery(query, context.schema, start_time, &params,
+                                  query.collect_stats ? stats : nullptr));
+  } else {
+    stats->analysis_cached = true;
+    ZETASQL_ASSIGN_OR_RETURN(
+        params, ExtractParameters(query, analyzed_query->analyzer_output.get()));
+  }
+  RowReader* reader = &(*execution)->reader;
+  std::optional<KeyFilteredRowReader> key_filtered_reader;
+  if (analyzed_query->dml_key_filter != nullptr) {
+    std::optional<KeySet> key_set =
+        analyzed_query->dml_key_filter->Bind(params);
+    if (key_set.has_value()) {
+      key_filtered_reader.emplace(reader,
+                                  analyzed_query->dml_key_filter->table_name(),
+                                  *std::move(key_set));
+      reader = &*key_filtered_reader;
+    }
+  }
+  analyzed_query->Bind(
+      reader, std::make_unique<QueryEvaluatorForEngine>(
+                  *this, context, view_cache_.get(), query.rows_scanned));
+
+  QueryResult result;
+  result.is_totally_ordered =
+      IsTotallyOrdered(analyzed_query->resolved_statement.get());
+  // Streamed results are evaluated as they are read, within the span of the
+  // caller's conversion of the rows.
+  tracing::ScopedSpan evaluate_span("QueryEngine.Evaluate");
+  evaluate_span.SetAttribute("analysis_cached",
+                             stats->analysis_cached ? "true" : "false");
+  // The CPU time of the execution is only measured for queries which collect
+  // statistics.
+  const absl::Duration execute_start =
+      query.collect_stats ? ThreadCpuTime() : absl::ZeroDuration();
+  auto record_execute_cpu_time = [&]() {
+    if (query.collect_stats) {
+      stats->execute_cpu_time = ThreadCpuTime() - execute_start;
+    }
+  };
+  // Returns the rows of a query which was executed without the evaluator.
+  auto materialized_result =
+      [&](const std::vector<std::string>& column_names,
+          const std::vector<const zetasql::Type*>& column_types,
+          std::vector<std::vector<zetasql::Value>> rows)
+      -> absl::StatusOr<QueryResult> {
+        record_execute_cpu_time();
+        // The rows no longer depend on the analyzed query, so it is returned
+        // to the cache even if they exceed the query's memory limit.
+        if (query_cache != nullptr) {
+          query_cache->Return(cache_key, std::move(analyzed_query));
+        }
+        MemoryTracker* memory = (*execution)->memory.get();
+        for (const std::vector<zetasql::Value>& row : rows) {
+          ZETASQL_RETURN_IF_ERROR(memory->Reserve(RowByteSize(row)));
+        }
+        result.num_output_rows = rows.size();
+        result.rows = std::make_unique<VectorsRowCursor>(
+            column_names, column_types, std::move(rows));
+        result.elapsed_time = absl::Now() - start_time;
+        stats->peak_memory_bytes = (*execution)->memory->peak_bytes();
+        result.stats = *stats;
+        result.memory = (*execution)->memory;
+        return std::move(result);
+      };
+  // Returns the rows of a query which was executed without the evaluator, and
+  // whose rows are read from a cursor which depends on neither the reader nor
+  // the analyzed query.
+  auto cursor_result = [&](std::unique_ptr<RowCursor> rows,
+                           int64_t num_output_rows) {
+    result.num_output_rows = num_output_rows;
+    result.rows = std::move(rows);
+    record_execute_cpu_time();
+    if (query_cache != nullptr) {
+      query_cache->Return(cache_key, std::move(analyzed_query));
+    }
+    result.elapsed_time = absl::Now() - start_time;
+    stats->peak_memory_bytes = (*execution)->memory->peak_bytes();
+    result.stats = *stats;
+    result.memory = (*execution)->memory;
+    return std::move(result);
+  };
+  if (analyzed_query->simple_select != nullptr) {
+    const SimpleSelect& simple_select = *analyzed_query->simple_select;
+    std::vector<std::vector<zetasql::Value>> rows;
+    ZETASQL_ASSIGN_OR_RETURN(
+        bool executed,
+        simple_select.Execute(params, &(*execution)->reader, &rows));
+    if (executed) {
+      return materialized_result(simple_select.output_column_names(),
+                                 simple_select.output_column_types(),
+                                 std::move(rows));
+    }
+    if (analyzed_query->prepared_query == nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(analyzed_query->prepared_query,
+                       PrepareQuery(analyzed_query->resolved_statement.get(),
+                                    params, type_factory_));
+    }
+  }
+  if (analyzed_query->changed_since_select != nullptr) {
+    // The index only records committed writes, so it can only stand in for a
+    // scan of a snapshot which has none of its own.
+    const ChangedSinceSelect& changed_since_select =
+        *analyzed_query->changed_since_select;
+    bool executed = false;
+    std::vector<std::vector<zetasql::Value>> rows;
+    if (context.snapshot_epoch.has_value() && context.writer == nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(executed, changed_since_select.Execute(
+                                     params, *commit_timestamp_index_,
+                                     &(*execution)->reader, &rows));
+    }
+    if (executed) {
+      return materialized_result(changed_since_select.output_column_names(),
+                                 changed_since_select.output_column_types(),
+                                 std::move(rows));
+    }
+    if (analyzed_query->prepared_query == nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(analyzed_query->prepared_query,
+                       PrepareQuery(analyzed_query->resolved_statement.get(),
+                                    params, type_factory_));
+    }
+  }
+  if (analyzed_query->interleaved_join != nullptr) {
+    const InterleavedJoin& interleaved_join = *analyzed_query->interleaved_join;
+    std::vector<std::vector<zetasql::Value>> rows;
+    ZETASQL_RETURN_IF_ERROR(
+        interleaved_join.Execute(&(*execution)->reader, &rows));
+    return materialized_result(interleaved_join.output_column_names(),
+                               interleaved_join.output_column_types(),
+                               std::move(rows));
+  }
+  if (analyzed_query->hash_join != nullptr) {
+    const HashJoin& hash_join = *analyzed_query->hash_join;
+    std::vector<std::vector<zetasql::Value>> rows;
+    ZETASQL_RETURN_IF_ERROR(
+        hash_join.Execute(&(*execution)->reader, statistics_, &rows));
+    return materialized_result(hash_join.output_column_names(),
+                               hash_join.output_column_types(),
+                               std::move(rows));
+  }
+  if (analyzed_query->parallel_aggregate != nullptr) {
+    const ParallelAggregate& parallel_aggregate =
+        *analyzed_query->parallel_aggregate;
+    std::vector<std::vector<zetasql::Value>> rows;
+    ZETASQL_ASSIGN_OR_RETURN(bool executed,
+                     parallel_aggregate.Execute(&(*execution)->reader,
+                                                statistics_, &rows));
+    if (executed) {
+      return materialized_result(parallel_aggregate.output_column_names(),
+                                 parallel_aggregate.output_column_types(),
+                                 std::move(rows));
+    }
+    if (analyzed_query->prepared_query == nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(analyzed_query->prepared_query,
+                       PrepareQuery(analyzed_query->resolved_statement.get(),
+                                    params, type_factory_));
+    }
+  }
+  if (analyzed_query->sorted_select != nullptr) {
+    std::unique_ptr<RowCursor> rows;
+    int64_t num_rows = 0;
+    ZETASQL_RETURN_IF_ERROR(analyzed_query->sorted_select->Execute(
+        &(*execution)->reader, SpillOptions(), &rows, &num_rows));
+    return cursor_result(std::move(rows), num_rows);
+  }
+  if (analyzed_query->grouped_aggregate != nullptr) {
+    std::unique_ptr<RowCursor> rows;
+    int64_t num_rows = 0;
+    ZETASQL_ASSIGN_OR_RETURN(bool executed,
+                     analyzed_query->grouped_aggregate->Execute(
+                         &(*execution)->reader, SpillOptions(), &rows,
+                         &num_rows));
+    if (executed) {
+      return cursor_result(std::move(rows), num_rows);
+    }
+    if (analyzed_query->prepared_query == nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(analyzed_query->prepared_query,
+                       PrepareQuery(analyzed_query->resolved_statement.get(),
+                                    params, type_factory_));
+    }
+  }
+  if (analyzed_query->prepared_query != nullptr && query.stream_results &&
+      !query.collect_stats) {
+    ZETASQL_ASSIGN_OR_RETURN(auto iterator,
+                     ExecutePreparedQuery(analyzed_query->prepared_query.get(),
+                                          params, context.deadline));
+    result.rows = std::make_unique<StreamingRowCursor>(
+        std::move(analyzed_query), std::move(iterator), query_cache,
+        std::move(cache_key), std::move(*execution), query_stats);
+    result.elapsed_time = absl::Now() - start_time;
+    return result;
+  }
+
+  if (analyzed_query->prepared_query != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(auto cursor,
+                     EvaluateQuery(analyzed_query->prepared_query.get(), params,
+                                   context.deadline,
+                                   (*execution)->memory.get(),
+                                   &result.num_output_rows));
+    result.rows = std::move(cursor);
+  } else {
+    ZETASQL_RET_CHECK_NE(context.writer, nullptr);
+    ZETASQL_ASSIGN_OR_RETURN(
+        auto execute_update_result,
+        EvaluateUpdate(analyzed_query->resolved_statement.get(),
+                       analyzed_query->catalog.get(), params, type_factory_,
+                       &analyzed_query->prepared_modify));
     ZETASQL_RETURN_IF_ERROR(context.writer->Write(execute_update_result.mutation));
     result.modified_row_count = execute_update_result.modify_row_count;
     result.rows = std::move(execute_update_result.returning_row_cursor);
   }
+  record_execute_cpu_time();
 
+  if (query_cache != nullptr) {
+    query_cache->Return(cache_key, std::move(analyzed_query));
+  }
   result.elapsed_time = absl::Now() - start_time;
+  stats->peak_memory_bytes = (*execution)->memory->peak_bytes();
+  result.stats = *stats;
+  result.memory = (*execution)->memory;
   return result;
 }
 
@@ -778,8 +1633,14 @@ absl::Status QueryEngine::IsPartitionable(const Query& query,
   ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
                    MakeAnalyzerOptionsWithParameters(query.declared_params));
   analyzer_options.set_prune_unused_columns(true);
-  Catalog catalog{context.schema, &function_catalog_, type_factory_,
-                  analyzer_options};
+  Catalog catalog{context.schema,
+                  function_catalog_,
+                  type_factory_,
+                  analyzer_options,
+                  /*reader=*/nullptr,
+                  /*query_evaluator=*/nullptr,
+                  /*change_stream_internal_lookup=*/std::nullopt,
+                  information_schema_cache_.get()};
 
   std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
     ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, &catalog,
@@ -807,8 +1668,14 @@ absl::Status QueryEngine::IsValidPartitionedDML(
   ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
                    MakeAnalyzerOptionsWithParameters(query.declared_params));
   analyzer_options.set_prune_unused_columns(true);
-  Catalog catalog{context.schema, &function_catalog_, type_factory_,
-                  analyzer_options};
+  Catalog catalog{context.schema,
+                  function_catalog_,
+                  type_factory_,
+                  analyzer_options,
+                  /*reader=*/nullptr,
+                  /*query_evaluator=*/nullptr,
+                  /*change_stream_internal_lookup=*/std::nullopt,
+                  information_schema_cache_.get()};
   ZETASQL_ASSIGN_OR_RETURN(
       auto analyzer_output,
       Analyze(query.sql, &catalog, analyzer_options, type_factory_));
@@ -835,8 +1702,8 @@ QueryEngine::TryGetChangeStreamMetadata(const Query& query,
                    MakeAnalyzerOptionsWithParameters(query.declared_params));
   analyzer_options.set_prune_unused_columns(true);
   zetasql::TypeFactory type_factory;
-  FunctionCatalog function_catalog(&type_factory);
-  Catalog catalog{schema, &function_catalog, &type_factory, analyzer_options};
+  Catalog catalog{schema, FunctionCatalog::Default(), &type_factory,
+                  analyzer_options};
   ZETASQL_ASSIGN_OR_RETURN(
       auto analyzer_output,
       Analyze(query.sql, &catalog, analyzer_options, &type_factory));
@@ -17,6 +17,10 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_ENGINE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_ENGINE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
@@ -27,11 +31,25 @@
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/access/write.h"
+#include "backend/common/memory_tracker.h"
+#include "backend/locking/lock_stats.h"
+#include "backend/query/analyzed_query_cache.h"
 #include "backend/query/change_stream/change_stream_query_validator.h"
 #include "backend/query/function_catalog.h"
+#include "backend/query/information_schema_catalog.h"
+#include "backend/query/query_stats.h"
+#include "backend/query/query_result_cache.h"
+#include "backend/query/query_stats_aggregator.h"
+#include "backend/query/read_stats_aggregator.h"
+#include "backend/query/transaction_stats_aggregator.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "backend/storage/commit_timestamp_index.h"
+#include "backend/storage/storage.h"
+#include "common/limits.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -55,6 +73,29 @@ struct Query {
   // If not empty,the current query is an internal query against a non public
   // partition or data table of this change stream
   std::optional<std::string> change_stream_internal_lookup;
+
+  // If true, the rows of a SELECT query are produced lazily by the returned
+  // row cursor as it is advanced, instead of being materialized before
+  // ExecuteSql returns. The cursor reads through the QueryContext's reader, so
+  // it must be drained while the reader (i.e. the transaction) is still valid.
+  // Has no effect on DML statements.
+  bool stream_results = false;
+
+  // If true, the results are materialized so that QueryResult::stats covers
+  // the entire execution of the query. Overrides stream_results.
+  bool collect_stats = false;
+
+  // If not null, the analyzed statement is looked up in and returned to this
+  // cache instead of the cache of the query engine. This lets a batch of
+  // statements analyze and prepare each distinct statement once, whether or
+  // not the engine caches statements. The cache must outlive the result.
+  AnalyzedQueryCache* statement_cache = nullptr;
+
+  // If not null, the rows read by the query, including those read to evaluate
+  // the views it uses, and the rows it returns are added to these counters
+  // once it completes.
+  std::atomic<int64_t>* rows_scanned = nullptr;
+  std::atomic<int64_t>* rows_returned = nullptr;
 };
 
 // Returns true if the given query is a DML statement.
@@ -69,13 +110,31 @@ struct QueryResult {
   // The number of modified rows.
   int64_t modified_row_count = 0;
 
-  // The number of rows in the returned row cursor.
+  // The number of rows in the returned row cursor. Not populated for streamed
+  // results since the rows have not been produced yet.
   int64_t num_output_rows = 0;
 
-  // Query execution elapsed time.
+  // Query execution elapsed time. For streamed results, this only covers
+  // analysis and preparation of the query.
   absl::Duration elapsed_time;
+
+  // Execution statistics. Not populated for streamed results.
+  QueryExecutionStats stats;
+
+  // Whether the query orders its rows by all of its output columns, so that
+  // rows which tie are identical and every evaluation of the query returns
+  // them in the same order.
+  bool is_totally_ordered = false;
+
+  // The memory held by the query, against the limit of query_memory_limit_mb.
+  // Callers which convert the rows charge the converted protos to it, so that
+  // its peak covers the query as a whole. Not populated for streamed results.
+  std::shared_ptr<MemoryTracker> memory;
 };
 
+// The state of a single query execution. Defined in query_engine.cc.
+struct QueryExecution;
+
 // QueryContext provides resources required to execute a query.
 struct QueryContext {
   // The database schema.
@@ -86,13 +145,38 @@ struct QueryContext {
 
   // A writer for writing data for DML requests. Can be null for SELECT queries.
   RowWriter* writer;
+
+  // The deadline of the request. Evaluation of the query is aborted once it has
+  // passed.
+  absl::Time deadline = absl::InfiniteFuture();
+
+  // If set, returns true once the client has abandoned the request. Evaluation
+  // of the query is then aborted at the next row read from a table.
+  std::function<bool()> is_cancelled = nullptr;
+
+  // If set, reader reads a state of the database which no commit changes any
+  // more, identified by this timestamp: readers with the same snapshot epoch
+  // return the same rows. The results of SELECT queries are then looked up in
+  // and added to the engine's result cache, if it has one. See
+  // ReadOnlyTransaction::SnapshotEpoch.
+  std::optional<absl::Time> snapshot_epoch;
 };
 
 // QueryEngine handles SQL-related requests.
 class QueryEngine {
  public:
-  explicit QueryEngine(zetasql::TypeFactory* type_factory)
-      : type_factory_(type_factory), function_catalog_(type_factory) {}
+  // storage, lock_stats, txn_stats and read_stats are not owned and, if set,
+  // back the SPANNER_SYS table sizes and lock, transaction and read statistics.
+  // statistics is not owned and, if set, is used to choose how tables are
+  // scanned. commit_timestamp_index is not owned and, if set, is used to find
+  // the rows changed since a timestamp without scanning their table.
+  explicit QueryEngine(
+      zetasql::TypeFactory* type_factory, const Storage* storage = nullptr,
+      const LockStatsAggregator* lock_stats = nullptr,
+      const TransactionStatsAggregator* txn_stats = nullptr,
+      const ReadStatsAggregator* read_stats = nullptr,
+      const DatabaseStatistics* statistics = nullptr,
+      const CommitTimestampIndex* commit_timestamp_index = nullptr);
 
   // Returns the name of the table that a given DML query modifies.
   absl::StatusOr<std::string> GetDmlTargetTable(const Query& query,
@@ -122,11 +206,83 @@ class QueryEngine {
 
   zetasql::TypeFactory* type_factory() const { return type_factory_; }
 
-  const FunctionCatalog* function_catalog() const { return &function_catalog_; }
+  const FunctionCatalog* function_catalog() const { return function_catalog_; }
+
+  // Drops the statements, results and catalogs cached for schema, before the
+  // schema is destroyed.
+  void EraseSchema(const Schema* schema);
+
+  // Whether query results are cached, see QueryContext::snapshot_epoch.
+  bool caches_query_results() const { return result_cache_ != nullptr; }
+
+  // Statistics of the queries executed by this engine, served through the
+  // SPANNER_SYS query statistics tables.
+  const QueryStatsAggregator* query_stats() const { return query_stats_.get(); }
+
+  // Returns the number of view definitions currently cached, see view_cache_.
+  int64_t num_cached_views() const { return view_cache_->size(); }
 
  private:
+  // Analyzes and validates query against schema, and prepares it for
+  // evaluation if it is a SELECT query. Populates params with the values of
+  // the query parameters and, if stats is non-null, records the time spent
+  // analyzing and preparing the query in it.
+  absl::StatusOr<std::unique_ptr<AnalyzedQuery>> AnalyzeQuery(
+      const Query& query, const Schema* schema, absl::Time start_time,
+      std::map<std::string, zetasql::Value>* params,
+      QueryExecutionStats* stats) const;
+
+  // Executes query, recording its reads in execution. Takes over execution if
+  // the results are streamed.
+  absl::StatusOr<QueryResult> ExecuteSqlInternal(
+      const Query& query, const QueryContext& context,
+      QueryStatsAggregator* query_stats,
+      std::unique_ptr<QueryExecution>* execution) const;
+
   zetasql::TypeFactory* type_factory_;
-  FunctionCatalog function_catalog_;
+
+  // Shared by all query engines, see FunctionCatalog::Default.
+  const FunctionCatalog* function_catalog_;
+
+  // Storage of the database queried by this engine. May be null.
+  const Storage* storage_;
+
+  // Lock statistics of the database queried by this engine. May be null.
+  const LockStatsAggregator* lock_stats_;
+
+  // Transaction and read statistics of the database. May be null.
+  const TransactionStatsAggregator* txn_stats_;
+  const ReadStatsAggregator* read_stats_;
+
+  // Optimizer statistics of the tables of the database. May be null.
+  const DatabaseStatistics* statistics_;
+
+  // Keys written by each commit to tables with commit timestamp columns. May
+  // be null.
+  const CommitTimestampIndex* commit_timestamp_index_;
+
+  // Cache of analyzed statements reused by ExecuteSql. Null if the cache is
+  // disabled.
+  std::unique_ptr<AnalyzedQueryCache> query_cache_;
+
+  // Cache of the analyzed and prepared definitions of the views referenced by
+  // queries, keyed by schema like query_cache_. Unlike query_cache_ it is
+  // always enabled, and large enough to hold every view of a schema, so that
+  // layered views are not analyzed again by every query which reads them.
+  std::unique_ptr<AnalyzedQueryCache> view_cache_ =
+      std::make_unique<AnalyzedQueryCache>(limits::kMaxViewsPerDatabase);
+
+  // Cache of the results of queries at a snapshot epoch. Null if the cache is
+  // disabled.
+  std::unique_ptr<QueryResultCache> result_cache_;
+
+  // Information schema catalog shared by all queries against the same schema.
+  std::unique_ptr<InformationSchemaCatalogCache> information_schema_cache_ =
+      std::make_unique<InformationSchemaCatalogCache>();
+
+  // Aggregated statistics of the queries executed by this engine.
+  std::unique_ptr<QueryStatsAggregator> query_stats_ =
+      std::make_unique<QueryStatsAggregator>();
 };
 
 }  // namespace backend
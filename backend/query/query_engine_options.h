@@ -30,6 +30,10 @@ struct QueryEngineOptions {
   // If true, will disable checks to determine if a NULL_FILTERED index can be
   // used to answer a SQL query.
   bool disable_query_null_filtered_index_check = false;
+
+  // Set if the query has a FORCE_INDEX hint, in which case the query engine
+  // reads tables as hinted instead of choosing secondary indexes itself.
+  bool has_force_index_hint = false;
 };
 
 }  // namespace backend
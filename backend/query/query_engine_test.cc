@@ -16,6 +16,7 @@
 
 #include "backend/query/query_engine.h"
 
+#include <algorithm>
 #include <memory>
 #include <optional>
 #include <string>
@@ -28,25 +29,45 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/access/write.h"
 #include "backend/actions/manager.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
 #include "backend/datamodel/key_set.h"
 #include "backend/datamodel/value.h"
+#include "backend/locking/lock_stats.h"
 #include "backend/query/catalog.h"
+#include "backend/query/query_stats_aggregator.h"
+#include "backend/query/read_stats_aggregator.h"
+#include "backend/query/transaction_stats_aggregator.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "backend/schema/updater/schema_updater.h"
+#include "backend/storage/commit_timestamp_index.h"
+#include "backend/storage/in_memory_storage.h"
+#include "backend/storage/partitioned_scan.h"
 #include "tests/common/row_reader.h"
 #include "tests/common/schema_constructor.h"
 #include "tests/common/scoped_feature_flags_setter.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
+ABSL_DECLARE_FLAG(int64_t, query_cache_size);
+ABSL_DECLARE_FLAG(int64_t, query_result_cache_size);
+ABSL_DECLARE_FLAG(int64_t, query_spill_memory_mb);
+ABSL_DECLARE_FLAG(int64_t, query_memory_limit_mb);
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -113,6 +134,24 @@ absl::StatusOr<std::vector<std::vector<zetasql::Value>>> GetAllColumnValues(
   return all_values;
 }
 
+// A RowReader which records the reads issued through it.
+class RecordingRowReader : public RowReader {
+ public:
+  explicit RecordingRowReader(RowReader* reader) : reader_(reader) {}
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    read_args_.push_back(read_arg);
+    return reader_->Read(read_arg, cursor);
+  }
+
+  const std::vector<ReadArg>& read_args() const { return read_args_; }
+
+ private:
+  RowReader* reader_;
+  std::vector<ReadArg> read_args_;
+};
+
 class QueryEngineTestBase : public testing::Test {
  public:
   const Schema* schema() { return schema_.get(); }
@@ -213,6 +252,28 @@ TEST_P(QueryEngineTest, ExecuteSqlSelectsOneColumnFromTable) {
                                                 ElementsAre(String("four")))));
 }
 
+TEST_P(QueryEngineTest, ExecuteSqlStopsWhenRequestIsCancelled) {
+  EXPECT_THAT(
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col FROM test_table"},
+          QueryContext{.schema = schema(),
+                       .reader = reader(),
+                       .writer = nullptr,
+                       .is_cancelled = []() { return true; }}),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kCancelled));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlStopsWhenDeadlineHasPassed) {
+  EXPECT_THAT(
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col FROM test_table"},
+          QueryContext{.schema = schema(),
+                       .reader = reader(),
+                       .writer = nullptr,
+                       .deadline = absl::Now() - absl::Seconds(1)}),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kDeadlineExceeded));
+}
+
 TEST_P(QueryEngineTest, ExecuteSqlSelectsOneColumnFromTableWithForceIndexHint) {
   std::string hint = "@{force_index=test_index}";
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -293,6 +354,764 @@ TEST_P(QueryEngineTest, ExecuteSqlSelectsCountFromTable) {
               IsOkAndHolds(ElementsAre(ElementsAre(Int64(3)))));
 }
 
+TEST_P(QueryEngineTest, ExecuteSqlStreamsSelectResults) {
+  Query query{"SELECT * FROM test_table"};
+  query.stream_results = true;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+  ASSERT_NE(result.rows, nullptr);
+  EXPECT_EQ(result.num_output_rows, 0);
+  EXPECT_THAT(GetColumnNames(*result.rows),
+              ElementsAre("int64_col", "string_col"));
+  EXPECT_THAT(GetColumnTypes(*result.rows),
+              ElementsAre(Int64Type(), StringType()));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(
+                  UnorderedElementsAre(ElementsAre(Int64(1), String("one")),
+                                       ElementsAre(Int64(2), String("two")),
+                                       ElementsAre(Int64(4), String("four")))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlCollectsExecutionStats) {
+  Query query{"SELECT * FROM test_table"};
+  query.stream_results = true;
+  query.collect_stats = true;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+
+  // Collecting stats materializes the results.
+  EXPECT_EQ(result.num_output_rows, 3);
+  EXPECT_FALSE(result.stats.analysis_cached);
+  ASSERT_EQ(result.stats.table_scans.size(), 1);
+  EXPECT_EQ(result.stats.table_scans[0].table, "test_table");
+  EXPECT_EQ(result.stats.table_scans[0].index, "");
+  EXPECT_EQ(result.stats.table_scans[0].rows_scanned, 3);
+  EXPECT_EQ(result.stats.rows_scanned, 3);
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlDoesNotReportStatsForStreamedResults) {
+  Query query{"SELECT * FROM test_table"};
+  query.stream_results = true;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+  EXPECT_TRUE(result.stats.table_scans.empty());
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlOnlyDescribesReadsWhenCollectingStats) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(Query{"SELECT * FROM test_table"},
+                                QueryContext{schema(), reader()}));
+  EXPECT_EQ(result.num_output_rows, 3);
+  EXPECT_EQ(result.stats.rows_scanned, 3);
+  EXPECT_TRUE(result.stats.table_scans.empty());
+  EXPECT_EQ(result.stats.execute_cpu_time, absl::ZeroDuration());
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlRecordsQueryStats) {
+  const std::string sql = "SELECT int64_col FROM test_table";
+  ZETASQL_ASSERT_OK(query_engine().ExecuteSql(Query{sql},
+                                      QueryContext{schema(), reader()}));
+  Query streamed{sql};
+  streamed.stream_results = true;
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        QueryResult result,
+        query_engine().ExecuteSql(streamed, QueryContext{schema(), reader()}));
+    ZETASQL_ASSERT_OK(GetAllColumnValues(std::move(result.rows)));
+  }
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT text, execution_count, avg_rows, avg_rows_scanned "
+                "FROM SPANNER_SYS.QUERY_STATS_TOP_MINUTE "
+                "WHERE text_fingerprint = @fingerprint",
+                {{"fingerprint",
+                  Int64(QueryStatsAggregator::Fingerprint(sql))}}},
+          QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(
+                  String(sql), Int64(2), zetasql::values::Double(3),
+                  zetasql::values::Double(3)))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsTableSizes) {
+  InMemoryStorage storage;
+  QueryEngine query_engine{type_factory(), &storage};
+  const Table* table = schema()->FindTable("test_table");
+  ZETASQL_ASSERT_OK(storage.Write(absl::Now(), table->id(), Key({Int64(1)}),
+                          {table->FindColumn("string_col")->id()},
+                          {String("one")}));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine.ExecuteSql(
+          Query{"SELECT table_name, used_bytes > 0 "
+                "FROM SPANNER_SYS.TABLE_SIZES_STATS_1HOUR "
+                "WHERE table_name = 'test_table'"},
+          QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(
+                  String("test_table"), zetasql::values::Bool(true)))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsLockStats) {
+  LockStatsAggregator lock_stats;
+  QueryEngine query_engine{type_factory(), /*storage=*/nullptr, &lock_stats};
+  const Table* table = schema()->FindTable("test_table");
+  LockConflictSample sample;
+  sample.table_id = table->id();
+  sample.row_range_start_key = Key({Int64(1)});
+  sample.column_ids = {table->FindColumn("string_col")->id()};
+  sample.wait = absl::Seconds(2);
+  lock_stats.Record(sample, absl::Now());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine.ExecuteSql(
+          Query{"SELECT row_range_start_key, lock_wait_seconds, "
+                "sample_lock_requests[OFFSET(0)].column, "
+                "sample_lock_requests[OFFSET(0)].lock_mode "
+                "FROM SPANNER_SYS.LOCK_STATS_TOP_MINUTE"},
+          QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(
+                  zetasql::values::Bytes("test_table(1)"),
+                  zetasql::values::Double(2),
+                  String("test_table.string_col"), String("Exclusive")))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsTransactionAndReadStats) {
+  TransactionStatsAggregator txn_stats;
+  ReadStatsAggregator read_stats;
+  QueryEngine query_engine{type_factory(), /*storage=*/nullptr,
+                           /*lock_stats=*/nullptr, &txn_stats, &read_stats};
+  TransactionExecutionSample txn_sample;
+  txn_sample.write_constructive_columns = {"test_table.string_col"};
+  txn_sample.operations_by_table["test_table"] = {2, 10};
+  txn_stats.Record(txn_sample, absl::Now());
+  ReadExecutionSample read_sample;
+  read_sample.read_columns = {"test_table.int64_col"};
+  read_sample.rows = 4;
+  read_stats.Record(read_sample, absl::Now());
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine.ExecuteSql(
+          Query{"SELECT write_constructive_columns[OFFSET(0)], "
+                "commit_attempt_count, "
+                "operations_by_table[OFFSET(0)].insert_or_update_count "
+                "FROM SPANNER_SYS.TXN_STATS_TOP_MINUTE"},
+          QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(
+                  String("test_table.string_col"), Int64(1), Int64(2)))));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      result, query_engine.ExecuteSql(
+                  Query{"SELECT execution_count, avg_rows "
+                        "FROM SPANNER_SYS.READ_STATS_TOTAL_HOUR"},
+                  QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(
+                  ElementsAre(Int64(1), zetasql::values::Double(4)))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReusesCachedQueryWithNewReader) {
+  absl::SetFlag(&FLAGS_query_cache_size, 8);
+  QueryEngine query_engine{type_factory()};
+  absl::SetFlag(&FLAGS_query_cache_size, 0);
+
+  test::TestRowReader other_reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(7), String("seven")}}}}}};
+  for (int i = 0; i < 2; ++i) {
+    Query query{"SELECT int64_col FROM test_table WHERE int64_col > @p",
+                {{"p", Int64(1)}}};
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        QueryResult result,
+        query_engine.ExecuteSql(query, QueryContext{schema(), reader()}));
+    EXPECT_THAT(
+        GetAllColumnValues(std::move(result.rows)),
+        IsOkAndHolds(UnorderedElementsAre(ElementsAre(Int64(2)),
+                                          ElementsAre(Int64(4)))));
+
+    query.declared_params["p"] = Int64(5);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        result,
+        query_engine.ExecuteSql(query, QueryContext{schema(), &other_reader}));
+    EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+                IsOkAndHolds(ElementsAre(ElementsAre(Int64(7)))));
+  }
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsIndexForFilterOnIndexedColumn) {
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT int64_col FROM test_table WHERE string_col = 'two'"},
+          QueryContext{schema(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_EQ(recording_reader.read_args()[0].table, "test_table");
+  EXPECT_EQ(recording_reader.read_args()[0].index, "test_index");
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlDoesNotReadWriteOnlyIndex) {
+  TableIDGenerator table_id_generator;
+  ColumnIDGenerator column_id_generator;
+  InMemoryStorage storage;
+  SchemaChangeContext context{.type_factory = type_factory(),
+                              .table_id_generator = &table_id_generator,
+                              .column_id_generator = &column_id_generator,
+                              .storage = &storage,
+                              .schema_change_timestamp = absl::Now()};
+  SchemaUpdater updater;
+  const std::vector<std::string> create_table = {R"(
+      CREATE TABLE test_table (
+        int64_col INT64 NOT NULL,
+        string_col STRING(MAX)
+      ) PRIMARY KEY (int64_col)
+    )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<const Schema> table_schema,
+                       updater.CreateSchemaFromDDL(
+                           SchemaChangeOperation{.statements = create_table},
+                           context));
+
+  // The index is write-only while it is backfilled online.
+  context.create_write_only_indexes = true;
+  const std::vector<std::string> create_index = {
+      "CREATE INDEX test_index ON test_table(string_col)"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      SchemaChangeResult result,
+      updater.UpdateSchemaFromDDL(
+          table_schema.get(), SchemaChangeOperation{.statements = create_index},
+          context));
+  ZETASQL_ASSERT_OK(result.backfill_status);
+  ASSERT_NE(result.updated_schema, nullptr);
+  ASSERT_TRUE(result.updated_schema->FindIndex("test_index")->is_write_only());
+
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult query_result,
+      query_engine().ExecuteSql(
+          Query{"SELECT int64_col FROM test_table WHERE string_col = 'two'"},
+          QueryContext{result.updated_schema.get(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(query_result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_TRUE(recording_reader.read_args()[0].index.empty());
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsPrimaryKeyLookupAsPointRead) {
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col AS s, int64_col FROM test_table "
+                "WHERE int64_col = @p",
+                {{"p", Int64(2)}}},
+          QueryContext{schema(), &recording_reader}));
+  ASSERT_EQ(result.rows->NumColumns(), 2);
+  EXPECT_EQ(result.rows->ColumnName(0), "s");
+  EXPECT_EQ(result.rows->ColumnName(1), "int64_col");
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(String("two"), Int64(2)))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_EQ(recording_reader.read_args()[0].table, "test_table");
+  EXPECT_THAT(recording_reader.read_args()[0].key_set.keys(),
+              ElementsAre(Key{{Int64(2)}}));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlEvaluatesPrimaryKeyLookupOfNull) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col FROM test_table WHERE int64_col = @p",
+                {{"p", zetasql::values::NullInt64()}}},
+          QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre()));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlAppliesLimitToPrimaryKeyLookup) {
+  for (int64_t limit : {0, 1}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        QueryResult result,
+        query_engine().ExecuteSql(
+            Query{"SELECT string_col FROM test_table "
+                  "WHERE int64_col = 4 LIMIT @limit",
+                  {{"limit", Int64(limit)}}},
+            QueryContext{schema(), reader()}));
+    EXPECT_EQ(result.num_output_rows, limit);
+  }
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsInUnnestOfPrimaryKeyAsMultiGet) {
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col FROM test_table "
+                "WHERE int64_col IN UNNEST(@ids)",
+                {{"ids", zetasql::values::Array(
+                             zetasql::types::Int64ArrayType(),
+                             {Int64(4), Int64(1), Int64(3), Int64(4),
+                              zetasql::values::NullInt64()})}}},
+          QueryContext{schema(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(String("one")),
+                                       ElementsAre(String("four")))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_THAT(recording_reader.read_args()[0].key_set.keys(),
+              ElementsAre(Key{{Int64(1)}}, Key{{Int64(3)}}, Key{{Int64(4)}}));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsInListOfPrimaryKeyInOrderByOrder) {
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT int64_col FROM test_table "
+                "WHERE int64_col IN (2, @p) ORDER BY int64_col DESC",
+                {{"p", Int64(1)}}},
+          QueryContext{schema(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)),
+                                       ElementsAre(Int64(1)))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_EQ(recording_reader.read_args()[0].key_set.keys().size(), 2);
+  EXPECT_TRUE(recording_reader.read_args()[0].reverse);
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlPassesLimitOfKeyOrderedScanToReader) {
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col FROM test_table "
+                "ORDER BY int64_col LIMIT 2 OFFSET 1"},
+          QueryContext{schema(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(String("two")),
+                                       ElementsAre(String("four")))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_EQ(recording_reader.read_args()[0].limit, 3);
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsLimitOfScanInReverseKeyOrder) {
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col FROM test_table "
+                "ORDER BY int64_col DESC LIMIT 1"},
+          QueryContext{schema(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(String("four")))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_EQ(recording_reader.read_args()[0].limit, 1);
+  EXPECT_TRUE(recording_reader.read_args()[0].reverse);
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsBaseTableWhenHinted) {
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT int64_col FROM test_table@{FORCE_INDEX=_BASE_TABLE} "
+                "WHERE string_col = 'two'"},
+          QueryContext{schema(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_TRUE(recording_reader.read_args()[0].index.empty());
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlMergesInterleavedChildWithParent) {
+  test::TestRowReader reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(1), String("one")},
+          {Int64(2), String("two")},
+          {Int64(4), String("four")}}}},
+       {"child_table",
+        {{"int64_col", "child_key"},
+         {zetasql::types::Int64Type(), zetasql::types::Int64Type()},
+         {{Int64(1), Int64(10)},
+          {Int64(1), Int64(11)},
+          {Int64(3), Int64(30)},
+          {Int64(4), Int64(40)}}}}}};
+  RecordingRowReader recording_reader(&reader);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT c.child_key, t.string_col FROM child_table AS c "
+                "JOIN test_table AS t ON t.int64_col = c.int64_col"},
+          QueryContext{multi_table_schema(), &recording_reader}));
+  EXPECT_THAT(
+      GetAllColumnValues(std::move(result.rows)),
+      IsOkAndHolds(ElementsAre(ElementsAre(Int64(10), String("one")),
+                               ElementsAre(Int64(11), String("one")),
+                               ElementsAre(Int64(40), String("four")))));
+  // Each table is read once, rather than once per row of the other.
+  ASSERT_EQ(recording_reader.read_args().size(), 2);
+  EXPECT_EQ(recording_reader.read_args()[0].table, "test_table");
+  EXPECT_EQ(recording_reader.read_args()[1].table, "child_table");
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlHashJoinsTablesOnNonKeyColumns) {
+  test::TestRowReader reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(1), String("a")},
+          {Int64(2), String("b")},
+          {Int64(3), zetasql::values::NullString()}}}},
+       {"test_table2",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(10), String("b")},
+          {Int64(20), String("a")},
+          {Int64(30), String("b")},
+          {Int64(40), zetasql::values::NullString()}}}}}};
+  RecordingRowReader recording_reader(&reader);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT t.int64_col, t2.int64_col FROM test_table AS t "
+                "JOIN test_table2 AS t2 ON t.string_col = t2.string_col"},
+          QueryContext{multi_table_schema(), &recording_reader}));
+  // NULL values are not joined to each other.
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(UnorderedElementsAre(
+                  ElementsAre(Int64(1), Int64(20)),
+                  ElementsAre(Int64(2), Int64(10)),
+                  ElementsAre(Int64(2), Int64(30)))));
+  // Without estimates of their sizes, the right table is built.
+  ASSERT_EQ(recording_reader.read_args().size(), 2);
+  EXPECT_EQ(recording_reader.read_args()[0].table, "test_table2");
+  EXPECT_EQ(recording_reader.read_args()[1].table, "test_table");
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlHashJoinsInterleavedTablesWhenHinted) {
+  test::TestRowReader reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(1), String("one")}, {Int64(4), String("four")}}}},
+       {"child_table",
+        {{"int64_col", "child_key"},
+         {zetasql::types::Int64Type(), zetasql::types::Int64Type()},
+         {{Int64(1), Int64(10)},
+          {Int64(3), Int64(30)},
+          {Int64(4), Int64(40)}}}}}};
+  RecordingRowReader recording_reader(&reader);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT c.child_key, t.string_col FROM child_table AS c "
+                "JOIN @{JOIN_METHOD=HASH_JOIN, "
+                "HASH_JOIN_BUILD_SIDE=BUILD_LEFT} test_table AS t "
+                "ON t.int64_col = c.int64_col"},
+          QueryContext{multi_table_schema(), &recording_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(UnorderedElementsAre(
+                  ElementsAre(Int64(10), String("one")),
+                  ElementsAre(Int64(40), String("four")))));
+  // The hinted build side is read first, instead of merging the parent.
+  ASSERT_EQ(recording_reader.read_args().size(), 2);
+  EXPECT_EQ(recording_reader.read_args()[0].table, "child_table");
+  EXPECT_EQ(recording_reader.read_args()[1].table, "test_table");
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlSortsTableWithinSpillBudget) {
+  absl::SetFlag(&FLAGS_query_spill_memory_mb, 1);
+  QueryEngine query_engine{type_factory()};
+  absl::StatusOr<QueryResult> result = query_engine.ExecuteSql(
+      Query{"SELECT int64_col FROM test_table ORDER BY string_col DESC"},
+      QueryContext{schema(), reader()});
+  absl::SetFlag(&FLAGS_query_spill_memory_mb, 0);
+  ZETASQL_ASSERT_OK(result);
+  EXPECT_THAT(GetAllColumnValues(std::move(result->rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)),
+                                       ElementsAre(Int64(1)),
+                                       ElementsAre(Int64(4)))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlGroupsTableWithinSpillBudget) {
+  test::TestRowReader reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(1), String("a")},
+          {Int64(2), String("b")},
+          {Int64(3), String("a")},
+          {Int64(4), zetasql::values::NullString()}}}}}};
+  absl::SetFlag(&FLAGS_query_spill_memory_mb, 1);
+  QueryEngine query_engine{type_factory()};
+  absl::StatusOr<QueryResult> result = query_engine.ExecuteSql(
+      Query{"SELECT SUM(int64_col), string_col, COUNT(*) FROM test_table "
+            "GROUP BY string_col"},
+      QueryContext{schema(), &reader});
+  absl::SetFlag(&FLAGS_query_spill_memory_mb, 0);
+  ZETASQL_ASSERT_OK(result);
+  EXPECT_THAT(GetAllColumnValues(std::move(result->rows)),
+              IsOkAndHolds(UnorderedElementsAre(
+                  ElementsAre(Int64(4), String("a"), Int64(2)),
+                  ElementsAre(Int64(2), String("b"), Int64(1)),
+                  ElementsAre(Int64(4), zetasql::values::NullString(),
+                              Int64(1)))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReportsPeakMemory) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(Query{"SELECT string_col FROM test_table"},
+                                QueryContext{schema(), reader()}));
+  EXPECT_GT(result.stats.peak_memory_bytes, 0);
+  ASSERT_NE(result.memory, nullptr);
+  EXPECT_EQ(result.memory->peak_bytes(), result.stats.peak_memory_bytes);
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlFailsPastMemoryLimit) {
+  test::TestRowReader reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(1), String(std::string(2 << 20, 'a'))}}}}}};
+  absl::SetFlag(&FLAGS_query_memory_limit_mb, 1);
+  QueryEngine query_engine{type_factory()};
+  absl::StatusOr<QueryResult> result = query_engine.ExecuteSql(
+      Query{"SELECT string_col FROM test_table"},
+      QueryContext{schema(), &reader});
+  absl::SetFlag(&FLAGS_query_memory_limit_mb, 0);
+  EXPECT_THAT(result, zetasql_base::testing::StatusIs(
+                          absl::StatusCode::kResourceExhausted));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlPastMemoryLimitKeepsAnalysisCached) {
+  test::TestRowReader large_reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(1), String(std::string(2 << 20, 'a'))}}}}}};
+  AnalyzedQueryCache statement_cache(/*capacity=*/1);
+  Query query{"SELECT string_col FROM test_table"};
+  query.statement_cache = &statement_cache;
+  absl::SetFlag(&FLAGS_query_memory_limit_mb, 1);
+  absl::StatusOr<QueryResult> result = query_engine().ExecuteSql(
+      query, QueryContext{schema(), &large_reader});
+  absl::SetFlag(&FLAGS_query_memory_limit_mb, 0);
+  EXPECT_THAT(result, zetasql_base::testing::StatusIs(
+                          absl::StatusCode::kResourceExhausted));
+
+  // The analyzed query was returned to the cache despite the failure.
+  EXPECT_EQ(statement_cache.size(), 1);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult cached_result,
+      query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+  EXPECT_TRUE(cached_result.stats.analysis_cached);
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlAggregatesTableWithoutEvaluator) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT MAX(string_col) AS m, COUNT(*), SUM(int64_col), "
+                "MIN(string_col), COUNT(string_col) FROM test_table"},
+          QueryContext{schema(), reader()}));
+  ASSERT_EQ(result.rows->NumColumns(), 5);
+  EXPECT_EQ(result.rows->ColumnName(0), "m");
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(String("two"), Int64(3),
+                                                   Int64(7), String("four"),
+                                                   Int64(3)))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlCountsRowsWithoutReadingThem) {
+  class CountingRowReader : public RecordingRowReader {
+   public:
+    using RecordingRowReader::RecordingRowReader;
+
+    std::optional<int64_t> CountRows(const std::string& table_name) override {
+      return 42;
+    }
+  };
+  CountingRowReader counting_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(Query{"SELECT COUNT(*) FROM test_table"},
+                                QueryContext{schema(), &counting_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(42)))));
+  EXPECT_TRUE(counting_reader.read_args().empty());
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlSplitsAggregatedScanAtHistogramBounds) {
+  const Table* table = schema()->FindTable("test_table");
+  TableStatistics table_statistics;
+  table_statistics.row_count = 1 << 20;
+  table_statistics.columns[table->FindColumn("int64_col")->id()]
+      .histogram_bounds = {Int64(1), Int64(2), Int64(4)};
+  DatabaseStatistics statistics;
+  statistics.Set(table->id(), std::move(table_statistics));
+  QueryEngine query_engine(type_factory(), /*storage=*/nullptr,
+                           /*lock_stats=*/nullptr, /*txn_stats=*/nullptr,
+                           /*read_stats=*/nullptr, &statistics);
+
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK(query_engine
+                .ExecuteSql(Query{"SELECT COUNT(*) FROM test_table"},
+                            QueryContext{schema(), &recording_reader})
+                .status());
+  // Each range of the table is read separately, and the ranges together cover
+  // the whole table.
+  const int num_partitions = std::min(DefaultScanParallelism(), 4);
+  ASSERT_EQ(recording_reader.read_args().size(), num_partitions);
+  EXPECT_TRUE(recording_reader.read_args()
+                  .front()
+                  .key_set.ranges()
+                  .front()
+                  .start_key()
+                  .IsEmpty());
+  EXPECT_TRUE(recording_reader.read_args()
+                  .back()
+                  .key_set.ranges()
+                  .front()
+                  .limit_key()
+                  .IsInfinity());
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReadsRowsChangedSinceAsPointReads) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<const Schema> schema,
+      test::CreateSchemaFromDDL(
+          {R"(
+              CREATE TABLE changes (
+                id INT64 NOT NULL,
+                updated TIMESTAMP OPTIONS (allow_commit_timestamp = true)
+              ) PRIMARY KEY (id)
+            )"},
+          type_factory()));
+  const absl::Time start = absl::FromUnixSeconds(1'700'000'000);
+  test::TestRowReader reader{
+      {{"changes",
+        {{"id", "updated"},
+         {zetasql::types::Int64Type(), zetasql::types::TimestampType()},
+         {{Int64(1), zetasql::values::Timestamp(start + absl::Seconds(1))},
+          {Int64(2), zetasql::values::Timestamp(start + absl::Seconds(3))},
+          {Int64(3), zetasql::values::NullTimestamp()}}}}}};
+  CommitTimestampIndex index(start);
+  index.Record(schema->FindTable("changes")->id(), Key{{Int64(1)}},
+               start + absl::Seconds(1));
+  index.Record(schema->FindTable("changes")->id(), Key{{Int64(2)}},
+               start + absl::Seconds(3));
+  QueryEngine query_engine(type_factory(), /*storage=*/nullptr,
+                           /*lock_stats=*/nullptr, /*txn_stats=*/nullptr,
+                           /*read_stats=*/nullptr, /*statistics=*/nullptr,
+                           &index);
+  Query query{"SELECT id FROM changes WHERE updated > @since",
+              {{"since", zetasql::values::Timestamp(start +
+                                                    absl::Seconds(2))}}};
+
+  // Only the keys written after since are read from a snapshot.
+  RecordingRowReader recording_reader(&reader);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine.ExecuteSql(query,
+                              QueryContext{.schema = schema.get(),
+                                           .reader = &recording_reader,
+                                           .writer = nullptr,
+                                           .snapshot_epoch = absl::Now()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)))));
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_THAT(recording_reader.read_args()[0].key_set.keys(),
+              ElementsAre(Key{{Int64(2)}}));
+
+  // Reads which may see uncommitted writes, and timestamps earlier than the
+  // index covers, are evaluated.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      result,
+      query_engine.ExecuteSql(
+          query, QueryContext{.schema = schema.get(), .reader = &reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)))));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      result, query_engine.ExecuteSql(
+                  Query{"SELECT id FROM changes WHERE updated >= @since",
+                        {{"since", zetasql::values::Timestamp(
+                                       start - absl::Seconds(1))}}},
+                  QueryContext{.schema = schema.get(),
+                               .reader = &reader,
+                               .writer = nullptr,
+                               .snapshot_epoch = absl::Now()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(1)),
+                                       ElementsAre(Int64(2)))));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlCachesOnlyTotallyOrderedResults) {
+  absl::SetFlag(&FLAGS_query_result_cache_size, 8);
+  QueryEngine query_engine{type_factory()};
+  absl::SetFlag(&FLAGS_query_result_cache_size, 0);
+  RecordingRowReader recording_reader(reader());
+  const absl::Time snapshot_epoch = absl::Now();
+  auto execute = [&](const Query& query) {
+    return query_engine.ExecuteSql(query,
+                                   QueryContext{.schema = schema(),
+                                                .reader = &recording_reader,
+                                                .writer = nullptr,
+                                                .snapshot_epoch =
+                                                    snapshot_epoch});
+  };
+  const std::string ordered_sql =
+      "SELECT int64_col, string_col FROM test_table "
+      "ORDER BY int64_col, string_col";
+
+  // A query ordered by all of its output columns is only evaluated once.
+  for (int i = 0; i < 2; ++i) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(QueryResult result, execute(Query{ordered_sql}));
+    EXPECT_TRUE(result.is_totally_ordered);
+    EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+                IsOkAndHolds(ElementsAre(ElementsAre(Int64(1), String("one")),
+                                         ElementsAre(Int64(2), String("two")),
+                                         ElementsAre(Int64(4),
+                                                     String("four")))));
+  }
+  EXPECT_EQ(recording_reader.read_args().size(), 1);
+
+  // Queries whose rows may tie are evaluated every time.
+  for (int i = 0; i < 2; ++i) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        QueryResult result,
+        execute(Query{"SELECT int64_col, string_col FROM test_table "
+                      "ORDER BY int64_col"}));
+    EXPECT_FALSE(result.is_totally_ordered);
+  }
+  EXPECT_EQ(recording_reader.read_args().size(), 3);
+
+  // A query collecting statistics does not reuse the result cached without
+  // them, and its own cached result keeps them.
+  Query profiled_query{ordered_sql};
+  profiled_query.collect_stats = true;
+  for (int i = 0; i < 2; ++i) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(QueryResult result, execute(profiled_query));
+    EXPECT_EQ(result.stats.rows_scanned, 3);
+  }
+  EXPECT_EQ(recording_reader.read_args().size(), 4);
+}
+
 TEST_P(QueryEngineTest, PartitionableSimpleScan) {
   Query query{"SELECT string_col FROM test_table"};
   ZETASQL_ASSERT_OK(query_engine().IsPartitionable(
@@ -457,6 +1276,61 @@ TEST_P(QueryEngineTest, ExecuteSqlUpdatesRows) {
   EXPECT_EQ(result.modified_row_count, 2);
 }
 
+TEST_P(QueryEngineTest, ExecuteSqlReadsOnlyKeyOfSingleRowDml) {
+  MockRowWriter writer;
+  EXPECT_CALL(writer,
+              Write(Property(&Mutation::ops,
+                             UnorderedElementsAre(AllOf(
+                                 Field(&MutationOp::type,
+                                       MutationOpType::kUpdate),
+                                 Field(&MutationOp::rows,
+                                       UnorderedElementsAre(ValueList{
+                                           Int64(2), String("foo")})))))))
+      .WillOnce(Return(absl::OkStatus()));
+  RecordingRowReader recording_reader(reader());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"UPDATE test_table SET string_col = 'foo' "
+                "WHERE int64_col = @key AND string_col != 'bar'",
+                {{"key", Int64(2)}}},
+          QueryContext{schema(), &recording_reader, &writer}));
+  EXPECT_EQ(result.modified_row_count, 1);
+  ASSERT_EQ(recording_reader.read_args().size(), 1);
+  EXPECT_THAT(recording_reader.read_args()[0].key_set.keys(),
+              ElementsAre(Key{{Int64(2)}}));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReusesPreparedDmlFromStatementCache) {
+  MockRowWriter writer;
+  for (int64_t key : {5, 6}) {
+    EXPECT_CALL(writer,
+                Write(Property(
+                    &Mutation::ops,
+                    UnorderedElementsAre(AllOf(
+                        Field(&MutationOp::type, MutationOpType::kInsert),
+                        Field(&MutationOp::rows,
+                              UnorderedElementsAre(ValueList{
+                                  Int64(key), String("batched")})))))))
+        .WillOnce(Return(absl::OkStatus()));
+  }
+
+  AnalyzedQueryCache statement_cache(/*capacity=*/1);
+  for (int64_t key : {5, 6}) {
+    Query query{"INSERT INTO test_table (int64_col, string_col) "
+                "VALUES(@key, 'batched')",
+                {{"key", Int64(key)}}};
+    query.statement_cache = &statement_cache;
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        QueryResult result,
+        query_engine().ExecuteSql(query,
+                                  QueryContext{schema(), reader(), &writer}));
+    EXPECT_EQ(result.modified_row_count, 1);
+    EXPECT_EQ(result.stats.analysis_cached, key != 5);
+    EXPECT_EQ(statement_cache.size(), 1);
+  }
+}
+
 TEST_P(QueryEngineTest, CannotInsertDuplicateValuesForPrimaryKey) {
   MockRowWriter writer;
   EXPECT_THAT(query_engine().ExecuteSql(
@@ -802,6 +1676,25 @@ TEST_P(QueryEngineTest, QueryingOnViews) {
                                         ValueList{Int64(9), String("afour")})));
 }
 
+TEST_P(QueryEngineTest, ViewDefinitionsAreAnalyzedOncePerSchema) {
+  test::ScopedEmulatorFeatureFlagsSetter setter({.enable_views = true});
+  QueryEngine query_engine{type_factory()};
+  for (int i = 0; i < 2; ++i) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        QueryResult result,
+        query_engine.ExecuteSql(Query{"SELECT col FROM test_view"},
+                                QueryContext{views_schema(), reader()}));
+    EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+                IsOkAndHolds(UnorderedElementsAre(ValueList{String("aone")},
+                                                  ValueList{String("atwo")},
+                                                  ValueList{String("afour")})));
+    EXPECT_EQ(query_engine.num_cached_views(), 1);
+  }
+
+  query_engine.EraseSchema(views_schema());
+  EXPECT_EQ(query_engine.num_cached_views(), 0);
+}
+
 TEST_P(QueryEngineTest, QueryingSelectedViewColumns) {
   test::ScopedEmulatorFeatureFlagsSetter setter({.enable_views = true});
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -0,0 +1,90 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/query_result_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "backend/access/read.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// A RowCursor over the rows of a cached result, shared with the cache.
+class CachedQueryResultCursor : public RowCursor {
+ public:
+  explicit CachedQueryResultCursor(
+      std::shared_ptr<const CachedQueryResult> result)
+      : result_(std::move(result)) {}
+
+  bool Next() override { return ++row_index_ < result_->rows.size(); }
+
+  absl::Status Status() const override { return absl::OkStatus(); }
+
+  int NumColumns() const override { return result_->column_names.size(); }
+
+  const std::string ColumnName(int i) const override {
+    return result_->column_names[i];
+  }
+
+  const zetasql::Type* ColumnType(int i) const override {
+    return result_->column_types[i];
+  }
+
+  const zetasql::Value ColumnValue(int i) const override {
+    return result_->rows[row_index_][i];
+  }
+
+ private:
+  std::shared_ptr<const CachedQueryResult> result_;
+  size_t row_index_ = -1;
+};
+
+}  // namespace
+
+std::unique_ptr<RowCursor> MakeCachedQueryResultCursor(
+    std::shared_ptr<const CachedQueryResult> result) {
+  return std::make_unique<CachedQueryResultCursor>(std::move(result));
+}
+
+std::shared_ptr<const CachedQueryResult> QueryResultCache::Lookup(
+    const Key& key) {
+  return cache_.Lookup(key);
+}
+
+void QueryResultCache::Insert(const Key& key,
+                              std::shared_ptr<const CachedQueryResult> result) {
+  if (static_cast<int64_t>(result->rows.size()) > max_rows_) {
+    return;
+  }
+  cache_.Insert(key, std::move(result));
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
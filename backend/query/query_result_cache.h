@@ -0,0 +1,121 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_RESULT_CACHE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_RESULT_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/time/time.h"
+#include "backend/access/read.h"
+#include "backend/query/query_stats.h"
+#include "backend/query/schema_lru_cache.h"
+#include "backend/schema/catalog/schema.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// The rows returned by a query, as held by a QueryResultCache.
+struct CachedQueryResult {
+  std::vector<std::string> column_names;
+  std::vector<const zetasql::Type*> column_types;
+  std::vector<std::vector<zetasql::Value>> rows;
+  // The statistics of the execution which produced the rows, returned with
+  // the rows of queries which collect statistics.
+  QueryExecutionStats stats;
+};
+
+// Returns a cursor over the rows of result, which it keeps alive.
+std::unique_ptr<RowCursor> MakeCachedQueryResultCursor(
+    std::shared_ptr<const CachedQueryResult> result);
+
+// QueryResultCache is a thread-safe LRU cache of the rows returned by read-only
+// queries which order their rows by all of their output columns, so that
+// evaluating them again would return the same rows in the same order.
+//
+// Results are keyed by the snapshot epoch of the read, a timestamp which
+// identifies the state of the database read (see QueryContext::snapshot_epoch),
+// so an entry never needs to be invalidated: a commit moves later reads to a
+// new epoch, and the entries of earlier epochs age out of the cache.
+class QueryResultCache {
+ public:
+  // Identifies the result of a query. Unlike AnalyzedQueryCache::Key, the
+  // values of the parameters are part of the key.
+  struct Key {
+    const Schema* schema = nullptr;
+    std::string sql;
+    // A canonical description of the parameter names, types and values.
+    std::string parameters;
+    absl::Time snapshot_epoch;
+    // Whether the query collects statistics, which a result cached for a query
+    // that did not collect them lacks.
+    bool collect_stats = false;
+
+    bool operator==(const Key& other) const {
+      return schema == other.schema && sql == other.sql &&
+             parameters == other.parameters &&
+             snapshot_epoch == other.snapshot_epoch &&
+             collect_stats == other.collect_stats;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.schema, key.sql, key.parameters,
+                        key.snapshot_epoch, key.collect_stats);
+    }
+  };
+
+  // Results with more than max_rows rows are not cached, so that the memory
+  // held by the cache stays bounded.
+  QueryResultCache(int64_t capacity, int64_t max_rows)
+      : max_rows_(max_rows), cache_(capacity) {}
+
+  // Returns the cached result for key and makes it the most recently used
+  // entry. Returns nullptr if there is no such entry.
+  std::shared_ptr<const CachedQueryResult> Lookup(const Key& key);
+
+  // Adds result to the cache as the most recently used entry, evicting the
+  // least recently used entry if the cache is full. Does nothing if result has
+  // more than max_rows rows.
+  void Insert(const Key& key, std::shared_ptr<const CachedQueryResult> result);
+
+  // Returns the number of entries currently in the cache.
+  int64_t size() const { return cache_.size(); }
+
+  // Removes the entries for schema from the cache, before it is destroyed.
+  void EraseSchema(const Schema* schema) { cache_.EraseSchema(schema); }
+
+ private:
+  // The maximum number of rows of a cached result.
+  const int64_t max_rows_;
+
+  SchemaLruCache<Key, std::shared_ptr<const CachedQueryResult>> cache_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_RESULT_CACHE_H_
@@ -0,0 +1,116 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/query_result_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "backend/access/read.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::types::Int64Type;
+using zetasql::values::Int64;
+
+QueryResultCache::Key MakeKey(const std::string& sql,
+                              absl::Time snapshot_epoch = absl::UnixEpoch()) {
+  return QueryResultCache::Key{/*schema=*/nullptr, sql, /*parameters=*/"",
+                               snapshot_epoch};
+}
+
+std::shared_ptr<const CachedQueryResult> MakeResult(int num_rows) {
+  auto result = std::make_shared<CachedQueryResult>();
+  result->column_names = {"k"};
+  result->column_types = {Int64Type()};
+  for (int i = 0; i < num_rows; ++i) {
+    result->rows.push_back({Int64(i)});
+  }
+  return result;
+}
+
+TEST(QueryResultCacheTest, ReturnsCachedRows) {
+  QueryResultCache cache(/*capacity=*/2, /*max_rows=*/10);
+  EXPECT_EQ(cache.Lookup(MakeKey("SELECT k FROM T")), nullptr);
+
+  cache.Insert(MakeKey("SELECT k FROM T"), MakeResult(2));
+  std::shared_ptr<const CachedQueryResult> result =
+      cache.Lookup(MakeKey("SELECT k FROM T"));
+  ASSERT_NE(result, nullptr);
+
+  // The entry stays in the cache, and can be read by several cursors.
+  EXPECT_EQ(cache.size(), 1);
+  std::unique_ptr<RowCursor> cursor = MakeCachedQueryResultCursor(result);
+  ASSERT_TRUE(cursor->Next());
+  EXPECT_EQ(cursor->ColumnName(0), "k");
+  EXPECT_EQ(cursor->ColumnValue(0), Int64(0));
+  ASSERT_TRUE(cursor->Next());
+  EXPECT_EQ(cursor->ColumnValue(0), Int64(1));
+  EXPECT_FALSE(cursor->Next());
+}
+
+TEST(QueryResultCacheTest, KeysIncludeSnapshotEpoch) {
+  QueryResultCache cache(/*capacity=*/2, /*max_rows=*/10);
+  cache.Insert(MakeKey("SELECT k FROM T", absl::UnixEpoch()), MakeResult(1));
+  EXPECT_EQ(cache.Lookup(MakeKey("SELECT k FROM T",
+                                 absl::UnixEpoch() + absl::Seconds(1))),
+            nullptr);
+}
+
+TEST(QueryResultCacheTest, KeysIncludeStatsCollection) {
+  QueryResultCache cache(/*capacity=*/2, /*max_rows=*/10);
+  cache.Insert(MakeKey("SELECT k FROM T"), MakeResult(1));
+  QueryResultCache::Key profile_key = MakeKey("SELECT k FROM T");
+  profile_key.collect_stats = true;
+  EXPECT_EQ(cache.Lookup(profile_key), nullptr);
+}
+
+TEST(QueryResultCacheTest, EvictsLeastRecentlyUsedEntry) {
+  QueryResultCache cache(/*capacity=*/2, /*max_rows=*/10);
+  cache.Insert(MakeKey("SELECT 1"), MakeResult(1));
+  cache.Insert(MakeKey("SELECT 2"), MakeResult(1));
+
+  // Looking up "SELECT 1" makes "SELECT 2" the least recently used entry.
+  EXPECT_NE(cache.Lookup(MakeKey("SELECT 1")), nullptr);
+  cache.Insert(MakeKey("SELECT 3"), MakeResult(1));
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.Lookup(MakeKey("SELECT 2")), nullptr);
+  EXPECT_NE(cache.Lookup(MakeKey("SELECT 1")), nullptr);
+  EXPECT_NE(cache.Lookup(MakeKey("SELECT 3")), nullptr);
+}
+
+TEST(QueryResultCacheTest, SkipsLargeResults) {
+  QueryResultCache cache(/*capacity=*/2, /*max_rows=*/1);
+  cache.Insert(MakeKey("SELECT k FROM T"), MakeResult(2));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,120 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/query_stats.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "backend/access/read.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// A RowCursor which counts the rows produced by the cursor it wraps, in total
+// and for its scan unless scan_index is negative. The scan is referred to by
+// position since table_scans may grow while it is in use.
+class CountingRowCursor : public RowCursor {
+ public:
+  CountingRowCursor(std::unique_ptr<RowCursor> cursor,
+                    QueryExecutionStats* stats, int scan_index)
+      : cursor_(std::move(cursor)), stats_(stats), scan_index_(scan_index) {}
+
+  bool Next() override {
+    if (!cursor_->Next()) {
+      return false;
+    }
+    Count(1);
+    return true;
+  }
+
+  absl::Status Status() const override { return cursor_->Status(); }
+
+  int NumColumns() const override { return cursor_->NumColumns(); }
+
+  const std::string ColumnName(int i) const override {
+    return cursor_->ColumnName(i);
+  }
+
+  const zetasql::Value ColumnValue(int i) const override {
+    return cursor_->ColumnValue(i);
+  }
+
+  const zetasql::Type* ColumnType(int i) const override {
+    return cursor_->ColumnType(i);
+  }
+
+  bool NextBatch(int64_t max_rows, RowBatch* batch) override {
+    if (!cursor_->NextBatch(max_rows, batch)) {
+      return false;
+    }
+    Count(batch->num_rows);
+    return true;
+  }
+
+ private:
+  void Count(int64_t num_rows) {
+    stats_->rows_scanned += num_rows;
+    if (scan_index_ >= 0) {
+      stats_->table_scans[scan_index_].rows_scanned += num_rows;
+    }
+  }
+
+
+  std::unique_ptr<RowCursor> cursor_;
+  QueryExecutionStats* stats_;
+  int scan_index_;
+};
+
+}  // namespace
+
+absl::Status StatsCollectingRowReader::Read(
+    const ReadArg& read_arg, std::unique_ptr<RowCursor>* cursor) {
+  ZETASQL_RET_CHECK_NE(reader_, nullptr);
+  std::unique_ptr<RowCursor> inner;
+  ZETASQL_RETURN_IF_ERROR(reader_->Read(read_arg, &inner));
+  if (!record_scans_) {
+    *cursor = std::make_unique<CountingRowCursor>(std::move(inner), stats_,
+                                                  /*scan_index=*/-1);
+    return absl::OkStatus();
+  }
+
+  TableScanStats scan;
+  scan.table = read_arg.table;
+  scan.index = read_arg.index;
+  scan.key_ranges = read_arg.key_set.DebugString();
+  stats_->table_scans.push_back(std::move(scan));
+  *cursor = std::make_unique<CountingRowCursor>(
+      std::move(inner), stats_, stats_->table_scans.size() - 1);
+  return absl::OkStatus();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,114 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "backend/access/read.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// TableScanStats describes a single read issued against a table or index while
+// executing a query.
+struct TableScanStats {
+  // The table which was read.
+  std::string table;
+
+  // The index which was read, or empty if the base table was read.
+  std::string index;
+
+  // A debug description of the keys and ranges which were read.
+  std::string key_ranges;
+
+  // The number of rows the read returned to the query evaluator.
+  int64_t rows_scanned = 0;
+};
+
+// QueryExecutionStats holds the statistics collected while executing a single
+// query. They are returned to clients for queries executed in PROFILE mode.
+struct QueryExecutionStats {
+  // True if the analysis of the query was reused from the query cache, in
+  // which case analyze_cpu_time and prepare_cpu_time are zero.
+  bool analysis_cached = false;
+
+  // CPU time spent analyzing and validating the SQL text. Like the other CPU
+  // times, it is the time of the thread executing the query, see
+  // ThreadCpuTime.
+  absl::Duration analyze_cpu_time;
+
+  // CPU time spent preparing the evaluator for the resolved statement.
+  absl::Duration prepare_cpu_time;
+
+  // CPU time spent evaluating the statement and materializing its results.
+  absl::Duration execute_cpu_time;
+
+  // The total number of rows returned by the reads of the query.
+  int64_t rows_scanned = 0;
+
+  // The reads issued by the query, in the order they were issued. Only
+  // recorded for queries which collect statistics.
+  std::vector<TableScanStats> table_scans;
+
+  // The largest number of bytes the query's materialized rows held at once.
+  int64_t peak_memory_bytes = 0;
+};
+
+// A RowReader which counts the rows returned by the reads issued through it in
+// a QueryExecutionStats. If record_scans is set, it also records each read and
+// its rows in table_scans, which costs a description of the keys of every
+// read. Neither the wrapped reader nor the stats are owned, and both must
+// outlive the cursors returned by Read.
+class StatsCollectingRowReader : public RowReader {
+ public:
+  StatsCollectingRowReader(RowReader* reader, QueryExecutionStats* stats,
+                           bool record_scans)
+      : reader_(reader), stats_(stats), record_scans_(record_scans) {}
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override;
+
+  absl::Status CheckNotCancelled() override {
+    return reader_->CheckNotCancelled();
+  }
+
+  std::optional<int64_t> CountRows(const std::string& table_name) override {
+    return reader_->CountRows(table_name);
+  }
+
+ private:
+  RowReader* reader_;
+  QueryExecutionStats* stats_;
+  const bool record_scans_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_H_
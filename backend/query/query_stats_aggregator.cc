@@ -0,0 +1,136 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/query_stats_aggregator.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_buckets.h"
+#include "farmhash.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of distinct queries tracked per interval. Queries are only
+// reported for the top kMaxQueriesPerInterval, but more are tracked so that a
+// query which becomes expensive later in an interval can still be reported.
+constexpr int kMaxTrackedQueriesPerInterval =
+    10 * QueryStatsAggregator::kMaxQueriesPerInterval;
+
+}  // namespace
+
+QueryStatsAggregator::QueryStatsAggregator()
+    : minute_buckets_(absl::Minutes(1), kMaxIntervals,
+                      kMaxTrackedQueriesPerInterval),
+      ten_minute_buckets_(absl::Minutes(10), kMaxIntervals,
+                          kMaxTrackedQueriesPerInterval),
+      hour_buckets_(absl::Hours(1), kMaxIntervals,
+                    kMaxTrackedQueriesPerInterval) {}
+
+int64_t QueryStatsAggregator::Fingerprint(const std::string& sql) {
+  return static_cast<int64_t>(farmhash::Fingerprint64(sql));
+}
+
+void QueryStatsAggregator::RecordInto(Buckets* buckets, int64_t fingerprint,
+                                      const QueryExecutionSample& sample,
+                                      absl::Time now) {
+  Buckets::Bucket* bucket = buckets->BucketAt(now);
+  if (bucket == nullptr) {
+    return;
+  }
+  Totals* totals = buckets->KeyTotals(bucket, fingerprint);
+  if (totals == nullptr) {
+    return;
+  }
+  if (totals->execution_count == 0 && totals->failed_count == 0) {
+    totals->text_truncated = sample.sql.size() > kMaxTextLength;
+    totals->text = sample.sql.substr(0, kMaxTextLength);
+  }
+
+  if (sample.failed) {
+    ++totals->failed_count;
+    totals->total_failed_latency += sample.latency;
+    return;
+  }
+  ++totals->execution_count;
+  totals->total_latency += sample.latency;
+  totals->total_rows += sample.rows_returned;
+  totals->total_rows_scanned += sample.rows_scanned;
+  totals->total_rows_written += sample.rows_written;
+}
+
+void QueryStatsAggregator::Record(const QueryExecutionSample& sample,
+                                  absl::Time now) {
+  const int64_t fingerprint = Fingerprint(sample.sql);
+  absl::MutexLock lock(&mu_);
+  for (Buckets* buckets :
+       {&minute_buckets_, &ten_minute_buckets_, &hour_buckets_}) {
+    RecordInto(buckets, fingerprint, sample, now);
+  }
+}
+
+const QueryStatsAggregator::Buckets& QueryStatsAggregator::GetBuckets(
+    QueryStatsInterval interval) const {
+  return interval == QueryStatsInterval::kMinute       ? minute_buckets_
+         : interval == QueryStatsInterval::kTenMinutes ? ten_minute_buckets_
+                                                       : hour_buckets_;
+}
+
+std::vector<QueryStatsRow> QueryStatsAggregator::GetStats(
+    QueryStatsInterval interval, absl::Time now) const {
+  std::vector<QueryStatsRow> rows;
+  absl::MutexLock lock(&mu_);
+  for (const Buckets::Bucket* bucket :
+       GetBuckets(interval).ReportedBuckets(now)) {
+    for (const auto& [fingerprint, totals] : Buckets::TopKeys(
+             *bucket, kMaxQueriesPerInterval, [](const Totals& totals) {
+               return totals.total_latency + totals.total_failed_latency;
+             })) {
+      QueryStatsRow row;
+      row.interval_end = bucket->interval_end;
+      row.text = totals->text;
+      row.text_truncated = totals->text_truncated;
+      row.text_fingerprint = fingerprint;
+      row.execution_count = totals->execution_count;
+      row.avg_latency_seconds =
+          AverageSeconds(totals->total_latency, totals->execution_count);
+      row.avg_rows = Average(totals->total_rows, totals->execution_count);
+      row.avg_rows_scanned =
+          Average(totals->total_rows_scanned, totals->execution_count);
+      row.avg_rows_written =
+          Average(totals->total_rows_written, totals->execution_count);
+      row.all_failed_execution_count = totals->failed_count;
+      row.all_failed_avg_latency_seconds =
+          AverageSeconds(totals->total_failed_latency, totals->failed_count);
+      rows.push_back(std::move(row));
+    }
+  }
+  return rows;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,150 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_AGGREGATOR_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_AGGREGATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_buckets.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// The interval lengths over which query statistics are aggregated. They
+// correspond to the SPANNER_SYS.QUERY_STATS_TOP_MINUTE, _10MINUTE and _HOUR
+// tables.
+enum class QueryStatsInterval { kMinute, kTenMinutes, kHour };
+
+// A single completed (or failed) execution of a query.
+struct QueryExecutionSample {
+  // The SQL text of the query.
+  std::string sql;
+
+  // Whether the query completed successfully.
+  bool failed = false;
+
+  // Wall time from the start of analysis to the last row being produced.
+  absl::Duration latency;
+
+  // Rows returned to the caller.
+  int64_t rows_returned = 0;
+
+  // Rows read from tables and indexes while executing the query.
+  int64_t rows_scanned = 0;
+
+  // Rows modified by a DML statement.
+  int64_t rows_written = 0;
+};
+
+// The statistics of one query fingerprint over one interval, as exposed by the
+// SPANNER_SYS query stats tables.
+struct QueryStatsRow {
+  absl::Time interval_end;
+  std::string text;
+  bool text_truncated = false;
+  int64_t text_fingerprint = 0;
+  int64_t execution_count = 0;
+  double avg_latency_seconds = 0;
+  double avg_rows = 0;
+  double avg_rows_scanned = 0;
+  double avg_rows_written = 0;
+  int64_t all_failed_execution_count = 0;
+  double all_failed_avg_latency_seconds = 0;
+};
+
+// QueryStatsAggregator accumulates the executions of a database's queries
+// into per-fingerprint statistics for each minute, ten minute and hour
+// interval, in the style of Cloud Spanner's query statistics tables.
+//
+// Only the most recent intervals are retained, and only the queries with the
+// highest total latency are reported per interval. Unlike Cloud Spanner, the
+// interval in progress is reported as well so that statistics are visible
+// without having to wait for the interval to end.
+//
+// This class is thread-safe.
+class QueryStatsAggregator {
+ public:
+  // Query texts longer than this many bytes are truncated.
+  static constexpr int kMaxTextLength = 64 * 1024;
+
+  // The number of distinct queries reported per interval.
+  static constexpr int kMaxQueriesPerInterval = 100;
+
+  // The number of intervals of each length which are retained.
+  static constexpr int kMaxIntervals = 60;
+
+  QueryStatsAggregator();
+
+  // Records sample as having completed at time now.
+  void Record(const QueryExecutionSample& sample, absl::Time now)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the statistics of the retained intervals of the given length
+  // which ended at or before now, or are in progress at now. Rows are ordered
+  // by interval end, latest first, and then by decreasing total latency.
+  std::vector<QueryStatsRow> GetStats(QueryStatsInterval interval,
+                                      absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the fingerprint reported for the given query text.
+  static int64_t Fingerprint(const std::string& sql);
+
+ private:
+  QueryStatsAggregator(const QueryStatsAggregator&) = delete;
+  QueryStatsAggregator& operator=(const QueryStatsAggregator&) = delete;
+
+  // Running totals for a single query fingerprint.
+  struct Totals {
+    std::string text;
+    bool text_truncated = false;
+    int64_t execution_count = 0;
+    absl::Duration total_latency;
+    int64_t total_rows = 0;
+    int64_t total_rows_scanned = 0;
+    int64_t total_rows_written = 0;
+    int64_t failed_count = 0;
+    absl::Duration total_failed_latency;
+  };
+
+  using Buckets = StatsBuckets<int64_t, Totals>;
+
+  static void RecordInto(Buckets* buckets, int64_t fingerprint,
+                         const QueryExecutionSample& sample, absl::Time now);
+
+  const Buckets& GetBuckets(QueryStatsInterval interval) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  Buckets minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets ten_minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets hour_buckets_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_AGGREGATOR_H_
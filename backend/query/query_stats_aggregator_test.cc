@@ -0,0 +1,145 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/query_stats_aggregator.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+QueryExecutionSample Sample(const std::string& sql, absl::Duration latency,
+                            int64_t rows_returned, int64_t rows_scanned) {
+  QueryExecutionSample sample;
+  sample.sql = sql;
+  sample.latency = latency;
+  sample.rows_returned = rows_returned;
+  sample.rows_scanned = rows_scanned;
+  return sample;
+}
+
+class QueryStatsAggregatorTest : public testing::Test {
+ protected:
+  // An arbitrary minute boundary.
+  const absl::Time start_ = absl::FromUnixSeconds(1700000040);
+  QueryStatsAggregator aggregator_;
+};
+
+TEST_F(QueryStatsAggregatorTest, AveragesExecutionsOfTheSameQuery) {
+  aggregator_.Record(Sample("SELECT 1", absl::Seconds(1), 1, 10), start_);
+  aggregator_.Record(Sample("SELECT 1", absl::Seconds(3), 3, 30),
+                     start_ + absl::Seconds(30));
+
+  std::vector<QueryStatsRow> rows = aggregator_.GetStats(
+      QueryStatsInterval::kMinute, start_ + absl::Seconds(40));
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].interval_end, start_ + absl::Minutes(1));
+  EXPECT_EQ(rows[0].text, "SELECT 1");
+  EXPECT_FALSE(rows[0].text_truncated);
+  EXPECT_EQ(rows[0].text_fingerprint,
+            QueryStatsAggregator::Fingerprint("SELECT 1"));
+  EXPECT_EQ(rows[0].execution_count, 2);
+  EXPECT_DOUBLE_EQ(rows[0].avg_latency_seconds, 2);
+  EXPECT_DOUBLE_EQ(rows[0].avg_rows, 2);
+  EXPECT_DOUBLE_EQ(rows[0].avg_rows_scanned, 20);
+}
+
+TEST_F(QueryStatsAggregatorTest, SeparatesIntervals) {
+  aggregator_.Record(Sample("SELECT 1", absl::Seconds(1), 1, 1), start_);
+  aggregator_.Record(Sample("SELECT 1", absl::Seconds(1), 1, 1),
+                     start_ + absl::Minutes(1));
+
+  // The latest interval is reported first.
+  std::vector<QueryStatsRow> minutes = aggregator_.GetStats(
+      QueryStatsInterval::kMinute, start_ + absl::Minutes(1));
+  ASSERT_EQ(minutes.size(), 2);
+  EXPECT_EQ(minutes[0].interval_end, start_ + absl::Minutes(2));
+  EXPECT_EQ(minutes[1].interval_end, start_ + absl::Minutes(1));
+
+  // Both executions fall within the same hour.
+  std::vector<QueryStatsRow> hours = aggregator_.GetStats(
+      QueryStatsInterval::kHour, start_ + absl::Minutes(1));
+  ASSERT_EQ(hours.size(), 1);
+  EXPECT_EQ(hours[0].execution_count, 2);
+}
+
+TEST_F(QueryStatsAggregatorTest, OrdersQueriesByTotalLatency) {
+  aggregator_.Record(Sample("SELECT 1", absl::Seconds(1), 1, 1), start_);
+  aggregator_.Record(Sample("SELECT 2", absl::Seconds(5), 1, 1), start_);
+  aggregator_.Record(Sample("SELECT 1", absl::Seconds(1), 1, 1), start_);
+
+  std::vector<QueryStatsRow> rows =
+      aggregator_.GetStats(QueryStatsInterval::kMinute, start_);
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_EQ(rows[0].text, "SELECT 2");
+  EXPECT_EQ(rows[1].text, "SELECT 1");
+}
+
+TEST_F(QueryStatsAggregatorTest, CountsFailedExecutionsSeparately) {
+  aggregator_.Record(Sample("SELECT 1", absl::Seconds(1), 1, 1), start_);
+  QueryExecutionSample failed = Sample("SELECT 1", absl::Seconds(4), 0, 0);
+  failed.failed = true;
+  aggregator_.Record(failed, start_);
+
+  std::vector<QueryStatsRow> rows =
+      aggregator_.GetStats(QueryStatsInterval::kMinute, start_);
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].execution_count, 1);
+  EXPECT_DOUBLE_EQ(rows[0].avg_latency_seconds, 1);
+  EXPECT_EQ(rows[0].all_failed_execution_count, 1);
+  EXPECT_DOUBLE_EQ(rows[0].all_failed_avg_latency_seconds, 4);
+}
+
+TEST_F(QueryStatsAggregatorTest, TruncatesLongQueryText) {
+  std::string sql(QueryStatsAggregator::kMaxTextLength + 1, ' ');
+  aggregator_.Record(Sample(sql, absl::Seconds(1), 1, 1), start_);
+
+  std::vector<QueryStatsRow> rows =
+      aggregator_.GetStats(QueryStatsInterval::kMinute, start_);
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_TRUE(rows[0].text_truncated);
+  EXPECT_EQ(rows[0].text.size(), QueryStatsAggregator::kMaxTextLength);
+  EXPECT_EQ(rows[0].text_fingerprint, QueryStatsAggregator::Fingerprint(sql));
+}
+
+TEST_F(QueryStatsAggregatorTest, RetainsOnlyRecentIntervals) {
+  for (int i = 0; i <= QueryStatsAggregator::kMaxIntervals; ++i) {
+    aggregator_.Record(Sample("SELECT 1", absl::Seconds(1), 1, 1),
+                       start_ + absl::Minutes(i));
+  }
+  std::vector<QueryStatsRow> rows = aggregator_.GetStats(
+      QueryStatsInterval::kMinute,
+      start_ + absl::Minutes(QueryStatsAggregator::kMaxIntervals));
+  EXPECT_EQ(rows.size(), QueryStatsAggregator::kMaxIntervals);
+  EXPECT_EQ(rows.back().interval_end, start_ + absl::Minutes(2));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
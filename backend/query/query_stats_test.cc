@@ -0,0 +1,120 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/query_stats.h"
+
+#include <memory>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key_set.h"
+#include "tests/common/row_reader.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::types::Int64Type;
+using zetasql::values::Int64;
+
+TEST(StatsCollectingRowReaderTest, RecordsReadsAndCountsRows) {
+  test::TestRowReader reader{
+      {{"T", {{"k"}, {Int64Type()}, {{Int64(1)}, {Int64(2)}, {Int64(3)}}}},
+       {"U", {{"k"}, {Int64Type()}, {{Int64(4)}}}}}};
+  QueryExecutionStats stats;
+  StatsCollectingRowReader stats_reader(&reader, &stats,
+                                        /*record_scans=*/true);
+
+  ReadArg read_t;
+  read_t.table = "T";
+  read_t.index = "TByK";
+  read_t.key_set = KeySet::All();
+  read_t.columns = {"k"};
+  std::unique_ptr<RowCursor> cursor_t;
+  ZETASQL_ASSERT_OK(stats_reader.Read(read_t, &cursor_t));
+
+  ReadArg read_u;
+  read_u.table = "U";
+  read_u.columns = {"k"};
+  std::unique_ptr<RowCursor> cursor_u;
+  ZETASQL_ASSERT_OK(stats_reader.Read(read_u, &cursor_u));
+
+  // Rows are counted as the cursors are advanced, including after later reads
+  // have been issued.
+  ASSERT_TRUE(cursor_t->Next());
+  ASSERT_TRUE(cursor_u->Next());
+  ASSERT_TRUE(cursor_t->Next());
+  EXPECT_EQ(cursor_t->ColumnValue(0), Int64(2));
+
+  ASSERT_EQ(stats.table_scans.size(), 2);
+  EXPECT_EQ(stats.table_scans[0].table, "T");
+  EXPECT_EQ(stats.table_scans[0].index, "TByK");
+  EXPECT_EQ(stats.table_scans[0].key_ranges, KeySet::All().DebugString());
+  EXPECT_EQ(stats.table_scans[0].rows_scanned, 2);
+  EXPECT_EQ(stats.table_scans[1].table, "U");
+  EXPECT_EQ(stats.table_scans[1].index, "");
+  EXPECT_EQ(stats.table_scans[1].rows_scanned, 1);
+  EXPECT_EQ(stats.rows_scanned, 3);
+}
+
+TEST(StatsCollectingRowReaderTest, CountsRowsWithoutRecordingReads) {
+  test::TestRowReader reader{
+      {{"T", {{"k"}, {Int64Type()}, {{Int64(1)}, {Int64(2)}, {Int64(3)}}}}}};
+  QueryExecutionStats stats;
+  StatsCollectingRowReader stats_reader(&reader, &stats,
+                                        /*record_scans=*/false);
+
+  ReadArg read_arg;
+  read_arg.table = "T";
+  read_arg.key_set = KeySet::All();
+  read_arg.columns = {"k"};
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_ASSERT_OK(stats_reader.Read(read_arg, &cursor));
+  while (cursor->Next()) {
+  }
+  ZETASQL_EXPECT_OK(cursor->Status());
+  EXPECT_TRUE(stats.table_scans.empty());
+  EXPECT_EQ(stats.rows_scanned, 3);
+}
+
+TEST(StatsCollectingRowReaderTest, FailedReadsAreNotRecorded) {
+  test::TestRowReader reader{{}};
+  QueryExecutionStats stats;
+  StatsCollectingRowReader stats_reader(&reader, &stats,
+                                        /*record_scans=*/true);
+
+  ReadArg read_arg;
+  read_arg.table = "Missing";
+  std::unique_ptr<RowCursor> cursor;
+  EXPECT_FALSE(stats_reader.Read(read_arg, &cursor).ok());
+  EXPECT_TRUE(stats.table_scans.empty());
+  EXPECT_EQ(stats.rows_scanned, 0);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
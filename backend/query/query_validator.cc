@@ -251,6 +251,9 @@ absl::Status QueryValidator::CheckHintValue(
     return error::InvalidHintValue(name, value.DebugString());
   }
   if (absl::EqualsIgnoreCase(name, kHintForceIndex)) {
+    if (extracted_options_ != nullptr) {
+      extracted_options_->has_force_index_hint = true;
+    }
     const std::string& index_name = value.string_value();
     bool base_table_hint = absl::EqualsIgnoreCase(index_name, kHintBaseTable);
     if (!base_table_hint) {
@@ -261,6 +264,8 @@ absl::Status QueryValidator::CheckHintValue(
       const Index* index = schema_->FindIndex(index_name);
       if (index == nullptr) {
         return error::InvalidHintValue(name, value.DebugString());
+      } else if (index->is_write_only()) {
+        return error::IndexNotReadable(index->Name());
       } else {
         indexes_used_.insert(index);
       }
@@ -378,7 +383,29 @@ absl::Status CheckAllowedCasts(const zetasql::Type* from_type,
 
 absl::Status QueryValidator::DefaultVisit(const zetasql::ResolvedNode* node) {
   ZETASQL_RETURN_IF_ERROR(ValidateHints(node));
-  return zetasql::ResolvedASTVisitor::DefaultVisit(node);
+  for (ResolvedNodeChecker* checker : node_checkers_) {
+    checker->CheckNode(node, depth_);
+  }
+  ++depth_;
+  absl::Status status = zetasql::ResolvedASTVisitor::DefaultVisit(node);
+  --depth_;
+  return status;
+}
+
+void QueryValidator::CheckSubtree(const zetasql::ResolvedNode* node) {
+  if (node_checkers_.empty()) {
+    return;
+  }
+  for (ResolvedNodeChecker* checker : node_checkers_) {
+    checker->CheckNode(node, depth_);
+  }
+  std::vector<const zetasql::ResolvedNode*> child_nodes;
+  node->GetChildNodes(&child_nodes);
+  ++depth_;
+  for (const zetasql::ResolvedNode* child_node : child_nodes) {
+    CheckSubtree(child_node);
+  }
+  --depth_;
 }
 
 absl::Status QueryValidator::VisitResolvedQueryStmt(
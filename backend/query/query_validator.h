@@ -17,6 +17,8 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_VALIDATOR_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_VALIDATOR_H_
 
+#include <vector>
+
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
@@ -25,6 +27,7 @@
 #include "backend/query/analyzer_options.h"
 #include "backend/query/feature_filter/sql_features_view.h"
 #include "backend/query/query_engine_options.h"
+#include "backend/query/resolved_node_checker.h"
 #include "backend/schema/catalog/schema.h"
 #include "absl/status/status.h"
 
@@ -52,9 +55,20 @@ class QueryValidator : public zetasql::ResolvedASTVisitor {
     return indexes_used_;
   }
 
+  // Registers `checker` to inspect every node of the tree as part of this
+  // validator's walk, instead of walking the tree again by itself. The caller
+  // retains ownership and must call checker->Finish() after the walk.
+  void AddNodeChecker(ResolvedNodeChecker* checker) {
+    node_checkers_.push_back(checker);
+  }
+
  protected:
   absl::Status DefaultVisit(const zetasql::ResolvedNode* node) override;
 
+  // Hands `node` and all of its descendants to the registered node checkers.
+  // Subclasses call this for subtrees they accept without visiting them.
+  void CheckSubtree(const zetasql::ResolvedNode* node);
+
   absl::Status VisitResolvedQueryStmt(
       const zetasql::ResolvedQueryStmt* node) override;
 
@@ -117,6 +131,12 @@ class QueryValidator : public zetasql::ResolvedASTVisitor {
   // Options for the query engine that are extracted through user-specified
   // hints.
   QueryEngineOptions* extracted_options_;
+
+  // Checkers which are run on every node visited by this validator.
+  std::vector<ResolvedNodeChecker*> node_checkers_;
+
+  // Depth of the node currently being visited below the root of the tree.
+  int depth_ = 0;
 };
 
 }  // namespace backend
@@ -17,6 +17,7 @@
 #include "backend/query/queryable_table.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -28,6 +29,7 @@
 #include "zetasql/public/analyzer_output.h"
 #include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
@@ -36,7 +38,11 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"  //
 #include "absl/types/span.h"
+#include "zetasql/base/status_macros.h"
 #include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/access_path.h"
 #include "backend/query/queryable_column.h"
 #include "common/constants.h"
 #include "absl/status/status.h"
@@ -46,56 +52,225 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
-// An implementation of EvaluatorTableIterator which wraps a RowCursor.
+namespace {
+
+// The number of rows a table iterator returns between checks of whether the
+// request it reads for has been abandoned.
+constexpr int kRowsBetweenCancellationChecks = 64;
+
+}  // namespace
+
+// An implementation of EvaluatorTableIterator which reads a table through a
+// RowReader.
 //
-// Used by QueryableTable::CreateEvaluatorTableIterator.
+// Used by QueryableTable::CreateEvaluatorTableIterator. The read is deferred
+// until the first call to NextRow, so that the column filters which the
+// evaluator pushes down through SetColumnFilterMap can restrict the keys which
+// are read and select a secondary index to read them from.
 class RowCursorEvaluatorTableIterator
     : public zetasql::EvaluatorTableIterator {
  public:
-  explicit RowCursorEvaluatorTableIterator(std::unique_ptr<RowCursor> cursor)
-      : cursor_(std::move(cursor)) {
-    values_.reserve(cursor_->NumColumns());
-    for (int i = 0; i < cursor_->NumColumns(); ++i) {
-      values_.push_back(zetasql::values::Null(cursor_->ColumnType(i)));
-    }
-  }
+  // columns holds the columns of table named in read_arg.columns. If
+  // allow_indexes is false, the table itself is always read. statistics may be
+  // null.
+  RowCursorEvaluatorTableIterator(
+      RowReader* reader, ReadArg read_arg, const backend::Table* table,
+      std::vector<const Column*> columns,
+      std::vector<const zetasql::Type*> column_types, bool allow_indexes,
+      const DatabaseStatistics* statistics)
+      : reader_(reader),
+        read_arg_(std::move(read_arg)),
+        table_(table),
+        columns_(std::move(columns)),
+        column_types_(std::move(column_types)),
+        allow_indexes_(allow_indexes),
+        statistics_(statistics) {}
 
-  int NumColumns() const override { return cursor_->NumColumns(); }
+  int NumColumns() const override { return read_arg_.columns.size(); }
 
   std::string GetColumnName(int i) const override {
-    return cursor_->ColumnName(i);
+    return read_arg_.columns[i];
   }
 
   const zetasql::Type* GetColumnType(int i) const override {
-    return cursor_->ColumnType(i);
+    return column_types_[i];
+  }
+
+  absl::Status SetColumnFilterMap(
+      absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>>
+          filter_map) override {
+    filter_map_ = std::move(filter_map);
+    return absl::OkStatus();
   }
 
   bool NextRow() override {
-    if (cursor_->Next()) {
-      for (int i = 0; i < cursor_->NumColumns(); ++i) {
-        values_[i] = cursor_->ColumnValue(i);
+    if (cursor_ == nullptr && read_status_.ok()) {
+      read_status_ = Read();
+    }
+    if (!read_status_.ok()) {
+      return false;
+    }
+    // Stop scanning once the client has gone away or the deadline has passed,
+    // so that an abandoned query does not keep the evaluator busy.
+    if (++rows_since_cancellation_check_ >= kRowsBetweenCancellationChecks) {
+      rows_since_cancellation_check_ = 0;
+      read_status_ = reader_->CheckNotCancelled();
+      if (!read_status_.ok()) {
+        return false;
       }
+    }
+    if (++batch_row_ < batch_.num_rows) {
       return true;
-    } else {
-      return false;
     }
+    // The rows are read from the cursor a batch at a time, and the values of
+    // the current row are returned straight from the batch.
+    int64_t max_rows = kRowsPerBatch;
+    if (read_arg_.limit > 0) {
+      max_rows = std::min(max_rows, read_arg_.limit - rows_read_);
+      if (max_rows <= 0) {
+        return false;
+      }
+    }
+    while (!cursor_->NextBatch(max_rows, &batch_)) {
+      // A back-join looks up the rows of the next batch of primary keys read
+      // from the index once those of the previous batch have been returned.
+      if (index_cursor_ == nullptr || !cursor_->Status().ok()) {
+        return false;
+      }
+      read_status_ = ReadBackJoinBatch();
+      if (!read_status_.ok()) {
+        return false;
+      }
+    }
+    rows_read_ += batch_.num_rows;
+    batch_row_ = 0;
+    return true;
   }
 
-  const zetasql::Value& GetValue(int i) const override { return values_[i]; }
+  const zetasql::Value& GetValue(int i) const override {
+    return batch_.columns[i][batch_row_];
+  }
 
-  absl::Status Status() const override { return cursor_->Status(); }
+  absl::Status Status() const override {
+    if (!read_status_.ok() || cursor_ == nullptr) {
+      return read_status_;
+    }
+    return cursor_->Status();
+  }
 
   // Cancel is best-effort and not required.
   absl::Status Cancel() override { return absl::OkStatus(); }
 
  private:
-  // The wrapped RowCursor.
+  // Reads the rows which may satisfy the pushed down column filters, through
+  // the cheapest access path for them.
+  absl::Status Read() {
+    std::vector<const zetasql::ColumnFilter*> filters(columns_.size());
+    for (const auto& [position, filter] : filter_map_) {
+      if (position >= 0 && position < static_cast<int>(filters.size())) {
+        filters[position] = filter.get();
+      }
+    }
+    AccessPath path = ChooseAccessPath(table_, columns_, filters,
+                                       allow_indexes_, statistics_);
+    if (path.index == nullptr) {
+      read_arg_.key_set = std::move(path.key_set);
+      return reader_->Read(read_arg_, &cursor_);
+    }
+
+    ReadArg index_read_arg = read_arg_;
+    index_read_arg.index = path.index->Name();
+    index_read_arg.key_set = std::move(path.key_set);
+    if (!path.back_join) {
+      return reader_->Read(index_read_arg, &cursor_);
+    }
+
+    // The index does not store all the scanned columns, so read the primary
+    // keys of the matching rows from it and look those rows up in the table.
+    index_read_arg.columns.clear();
+    for (const KeyColumn* key_column : table_->primary_key()) {
+      index_read_arg.columns.push_back(key_column->column()->Name());
+    }
+    ZETASQL_RETURN_IF_ERROR(reader_->Read(index_read_arg, &index_cursor_));
+    return ReadBackJoinBatch();
+  }
+
+  // Reads the rows of the table for the next kKeysPerBackJoinBatch primary keys
+  // from index_cursor_ into cursor_. The keys of a batch are sorted when the
+  // read is resolved, so the rows are looked up in one pass over the table
+  // rather than one storage call each. Releases index_cursor_ once it has been
+  // read entirely.
+  absl::Status ReadBackJoinBatch() {
+    KeySet key_set;
+    int num_keys = 0;
+    while (num_keys < kKeysPerBackJoinBatch && index_cursor_->Next()) {
+      Key key;
+      for (int i = 0; i < table_->primary_key().size(); ++i) {
+        key.AddColumn(index_cursor_->ColumnValue(i),
+                      table_->primary_key()[i]->is_descending());
+      }
+      key_set.AddKey(key);
+      ++num_keys;
+    }
+    ZETASQL_RETURN_IF_ERROR(index_cursor_->Status());
+    if (num_keys < kKeysPerBackJoinBatch) {
+      index_cursor_ = nullptr;
+    }
+    read_arg_.key_set = std::move(key_set);
+    return reader_->Read(read_arg_, &cursor_);
+  }
+
+  // The reader which the rows are read from.
+  RowReader* reader_;
+
+  // The read to issue. Its key set is populated from the column filters.
+  ReadArg read_arg_;
+
+  // The table which is read.
+  const backend::Table* table_;
+
+  // The columns in read_arg_, and their types.
+  std::vector<const Column*> columns_;
+  std::vector<const zetasql::Type*> column_types_;
+
+  // Whether the rows may be read through a secondary index of table_.
+  bool allow_indexes_;
+
+  // Statistics used to choose the access path. May be null.
+  const DatabaseStatistics* statistics_;
+
+  // Filters pushed down by the evaluator, keyed by column position.
+  absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>> filter_map_;
+
+  // The status of the read issued on the first call to NextRow, or the error
+  // the scan was abandoned with.
+  absl::Status read_status_;
+
+  // The number of rows returned since the last cancellation check.
+  int rows_since_cancellation_check_ = 0;
+
+  // The cursor over the rows read. Null until the first call to NextRow.
   std::unique_ptr<RowCursor> cursor_;
 
-  // Values of the current row. EvaluatorTableIterator::GetValue need to return
-  // a reference so we need to buffer the values instead of simply delegate to
-  // RowCursor::ColumnValue.
-  std::vector<zetasql::Value> values_;
+  // The cursor over the primary keys read from the index of a back-join, until
+  // all of them have been looked up in the table.
+  std::unique_ptr<RowCursor> index_cursor_;
+
+  // The number of primary keys looked up in the table at a time by a
+  // back-join.
+  static constexpr int kKeysPerBackJoinBatch = 1024;
+
+  // The number of rows read from the cursor at a time.
+  static constexpr int64_t kRowsPerBatch = 64;
+
+  // The batch of rows holding the current row, at position batch_row_.
+  // EvaluatorTableIterator::GetValue needs to return a reference, so the values
+  // are buffered instead of delegating to RowCursor::ColumnValue.
+  RowBatch batch_;
+  int64_t batch_row_ = 0;
+
+  // The number of rows read from the cursor so far.
+  int64_t rows_read_ = 0;
 };
 
 QueryableTable::QueryableTable(
@@ -145,8 +320,12 @@ QueryableTable::CreateEvaluatorTableIterator(
   ZETASQL_RET_CHECK_NE(reader_, nullptr);
 
   std::vector<std::string> column_names;
+  std::vector<const Column*> columns;
+  std::vector<const zetasql::Type*> column_types;
   for (int idx : column_idxs) {
     column_names.push_back(GetColumn(idx)->Name());
+    columns.push_back(columns_[idx]->wrapped_column());
+    column_types.push_back(GetColumn(idx)->GetType());
   }
 
   ReadArg read_arg;
@@ -166,9 +345,12 @@ QueryableTable::CreateEvaluatorTableIterator(
       read_arg.change_stream_for_data_table = change_stream_name;
     }
   }
-  std::unique_ptr<RowCursor> cursor;
-  ZETASQL_RETURN_IF_ERROR(reader_->Read(read_arg, &cursor));
-  return std::make_unique<RowCursorEvaluatorTableIterator>(std::move(cursor));
+  return std::make_unique<RowCursorEvaluatorTableIterator>(
+      reader_, std::move(read_arg), wrapped_table_, std::move(columns),
+      std::move(column_types),
+      index_selection_enabled_ &&
+          wrapped_table_->owner_change_stream() == nullptr,
+      statistics_);
 }
 
 const zetasql::Column* QueryableTable::FindColumnByName(
@@ -29,6 +29,7 @@
 #include "backend/query/queryable_column.h"
 #include "backend/schema/catalog/change_stream.h"
 #include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -71,6 +72,19 @@ class QueryableTable : public zetasql::Table {
 
   const backend::Table* wrapped_table() const { return wrapped_table_; }
 
+  // Sets whether scans of this table may read their rows through one of its
+  // secondary indexes when the query filters make that cheaper. Enabled by
+  // default.
+  void set_index_selection_enabled(bool enabled) {
+    index_selection_enabled_ = enabled;
+  }
+
+  // Sets the statistics from which the cost of reading the table and its
+  // indexes is estimated when choosing how to scan it. Not owned, may be null.
+  void set_statistics(const DatabaseStatistics* statistics) {
+    statistics_ = statistics;
+  }
+
   // Override CreateEvaluatorTableIterator.
   absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>>
   CreateEvaluatorTableIterator(
@@ -89,6 +103,12 @@ class QueryableTable : public zetasql::Table {
 
   // A list of ordinal indexes of the primary key columns of the table.
   std::vector<int> primary_key_column_indexes_;
+
+  // Whether scans may read through a secondary index of the table.
+  bool index_selection_enabled_ = true;
+
+  // Statistics of the table and its indexes. May be null.
+  const DatabaseStatistics* statistics_ = nullptr;
 };
 
 }  // namespace backend
@@ -16,14 +16,25 @@
 
 #include "backend/query/queryable_table.h"
 
+#include <cstdint>
 #include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_set.h"
 #include "backend/query/catalog.h"
 #include "backend/query/queryable_column.h"
 #include "tests/common/row_cursor.h"
@@ -114,6 +125,83 @@ TEST_F(QueryableTableTest, CreateEvaluatorTableIteratorWithAllColumns) {
   ASSERT_FALSE(iterator->NextRow());
 }
 
+// A reader of table T whose index TByA has the primary keys of kNumRows rows
+// for every value of a, in descending order. Records the number of keys of
+// each read of the table.
+class BackJoinRowReader : public RowReader {
+ public:
+  static constexpr int kNumRows = 2500;
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    std::vector<std::vector<zetasql::Value>> rows;
+    if (read_arg.index == "TByA") {
+      EXPECT_THAT(read_arg.columns, ElementsAre("k"));
+      for (int64_t k = kNumRows - 1; k >= 0; --k) {
+        rows.push_back({zetasql::values::Int64(k)});
+      }
+      *cursor = std::make_unique<test::TestRowCursor>(
+          read_arg.columns,
+          std::vector<const zetasql::Type*>{zetasql::types::Int64Type()},
+          rows);
+      return absl::OkStatus();
+    }
+
+    EXPECT_TRUE(read_arg.index.empty());
+    EXPECT_THAT(read_arg.columns, ElementsAre("a", "c"));
+    for (const Key& key : read_arg.key_set.keys()) {
+      rows.push_back({zetasql::values::Int64(2),
+                      zetasql::values::String(absl::StrCat(
+                          "c", key.ColumnValue(0).int64_value()))});
+    }
+    keys_per_table_read_.push_back(read_arg.key_set.keys().size());
+    *cursor = std::make_unique<test::TestRowCursor>(
+        read_arg.columns,
+        std::vector<const zetasql::Type*>{zetasql::types::Int64Type(),
+                                          zetasql::types::StringType()},
+        rows);
+    return absl::OkStatus();
+  }
+
+  const std::vector<int>& keys_per_table_read() const {
+    return keys_per_table_read_;
+  }
+
+ private:
+  std::vector<int> keys_per_table_read_;
+};
+
+TEST(QueryableTableBackJoinTest, LooksUpRowsInBatchesOfIndexKeys) {
+  zetasql::TypeFactory type_factory;
+  std::unique_ptr<const Schema> schema =
+      test::CreateSchemaFromDDL(
+          {"CREATE TABLE T (k INT64 NOT NULL, a INT64, c STRING(MAX))"
+           " PRIMARY KEY (k)",
+           "CREATE INDEX TByA ON T(a)"},
+          &type_factory)
+          .value();
+  BackJoinRowReader reader;
+  QueryableTable table{schema->FindTable("T"), &reader};
+
+  // Scanning a and c where a = 2 reads the primary keys from TByA, which does
+  // not store c, and looks the rows up in T.
+  auto iterator =
+      table.CreateEvaluatorTableIterator(/*column_idxs=*/{1, 2}).value();
+  absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>> filters;
+  filters[0] = std::make_unique<zetasql::ColumnFilter>(
+      std::vector<zetasql::Value>{zetasql::values::Int64(2)});
+  ZETASQL_ASSERT_OK(iterator->SetColumnFilterMap(std::move(filters)));
+
+  std::set<std::string> c_values;
+  while (iterator->NextRow()) {
+    EXPECT_EQ(iterator->GetValue(0).int64_value(), 2);
+    c_values.insert(iterator->GetValue(1).string_value());
+  }
+  ZETASQL_ASSERT_OK(iterator->Status());
+  EXPECT_EQ(static_cast<int>(c_values.size()), BackJoinRowReader::kNumRows);
+  EXPECT_THAT(reader.keys_per_table_read(), ElementsAre(1024, 1024, 452));
+}
+
 }  // namespace
 
 }  // namespace backend
@@ -0,0 +1,143 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/read_stats_aggregator.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/btree_set.h"
+#include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_buckets.h"
+#include "backend/query/query_stats_aggregator.h"
+#include "farmhash.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of distinct read shapes tracked per interval, see StatsBuckets.
+constexpr int kMaxTrackedReadsPerInterval =
+    10 * ReadStatsAggregator::kMaxReadsPerInterval;
+
+}  // namespace
+
+ReadStatsAggregator::ReadStatsAggregator()
+    : minute_buckets_(absl::Minutes(1), QueryStatsAggregator::kMaxIntervals,
+                      kMaxTrackedReadsPerInterval),
+      ten_minute_buckets_(absl::Minutes(10),
+                          QueryStatsAggregator::kMaxIntervals,
+                          kMaxTrackedReadsPerInterval),
+      hour_buckets_(absl::Hours(1), QueryStatsAggregator::kMaxIntervals,
+                    kMaxTrackedReadsPerInterval) {}
+
+int64_t ReadStatsAggregator::Fingerprint(
+    const absl::btree_set<std::string>& read_columns) {
+  return static_cast<int64_t>(
+      farmhash::Fingerprint64(absl::StrJoin(read_columns, ",")));
+}
+
+void ReadStatsAggregator::Add(const ReadExecutionSample& sample,
+                              Totals* totals) {
+  ++totals->execution_count;
+  totals->rows += sample.rows;
+  totals->bytes += sample.bytes;
+  totals->latency += sample.latency;
+  if (sample.in_read_write_transaction) {
+    ++totals->rw_transaction_count;
+  }
+}
+
+void ReadStatsAggregator::Record(const ReadExecutionSample& sample,
+                                 absl::Time now) {
+  const int64_t fprint = Fingerprint(sample.read_columns);
+  absl::MutexLock lock(&mu_);
+  for (Buckets* buckets :
+       {&minute_buckets_, &ten_minute_buckets_, &hour_buckets_}) {
+    Buckets::Bucket* bucket = buckets->BucketAt(now);
+    if (bucket == nullptr) {
+      continue;
+    }
+    Add(sample, &bucket->totals);
+    Totals* totals = buckets->KeyTotals(bucket, fprint);
+    if (totals == nullptr) {
+      continue;
+    }
+    if (totals->execution_count == 0) {
+      totals->read_columns.assign(sample.read_columns.begin(),
+                                  sample.read_columns.end());
+    }
+    Add(sample, totals);
+  }
+}
+
+ReadStatsRow ReadStatsAggregator::ToRow(absl::Time interval_end,
+                                        int64_t fprint, const Totals& totals) {
+  ReadStatsRow row;
+  row.interval_end = interval_end;
+  row.read_columns = totals.read_columns;
+  row.fprint = fprint;
+  row.execution_count = totals.execution_count;
+  row.avg_rows = Average(totals.rows, totals.execution_count);
+  row.avg_bytes = Average(totals.bytes, totals.execution_count);
+  row.avg_cpu_seconds = AverageSeconds(totals.latency, totals.execution_count);
+  row.run_in_rw_transaction_execution_count = totals.rw_transaction_count;
+  return row;
+}
+
+const ReadStatsAggregator::Buckets& ReadStatsAggregator::GetBuckets(
+    QueryStatsInterval interval) const {
+  return interval == QueryStatsInterval::kMinute       ? minute_buckets_
+         : interval == QueryStatsInterval::kTenMinutes ? ten_minute_buckets_
+                                                       : hour_buckets_;
+}
+
+std::vector<ReadStatsRow> ReadStatsAggregator::GetStats(
+    QueryStatsInterval interval, absl::Time now) const {
+  std::vector<ReadStatsRow> rows;
+  absl::MutexLock lock(&mu_);
+  for (const Buckets::Bucket* bucket :
+       GetBuckets(interval).ReportedBuckets(now)) {
+    for (const auto& [fprint, totals] : Buckets::TopKeys(
+             *bucket, kMaxReadsPerInterval,
+             [](const Totals& totals) { return totals.latency; })) {
+      rows.push_back(ToRow(bucket->interval_end, fprint, *totals));
+    }
+  }
+  return rows;
+}
+
+std::vector<ReadStatsRow> ReadStatsAggregator::GetTotals(
+    QueryStatsInterval interval, absl::Time now) const {
+  std::vector<ReadStatsRow> rows;
+  absl::MutexLock lock(&mu_);
+  for (const Buckets::Bucket* bucket :
+       GetBuckets(interval).ReportedBuckets(now)) {
+    rows.push_back(ToRow(bucket->interval_end, 0, bucket->totals));
+  }
+  return rows;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
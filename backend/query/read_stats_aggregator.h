@@ -0,0 +1,135 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_READ_STATS_AGGREGATOR_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_READ_STATS_AGGREGATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/btree_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_buckets.h"
+#include "backend/query/query_stats_aggregator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// A single completed execution of a read request.
+struct ReadExecutionSample {
+  // The columns read, as "Table.Column".
+  absl::btree_set<std::string> read_columns;
+
+  // Rows and bytes returned to the caller.
+  int64_t rows = 0;
+  int64_t bytes = 0;
+
+  // Wall time spent executing the read.
+  absl::Duration latency;
+
+  // Whether the read was part of a read-write transaction.
+  bool in_read_write_transaction = false;
+};
+
+// The statistics of one read shape, or of all reads, over one interval, as
+// exposed by the SPANNER_SYS read stats tables.
+struct ReadStatsRow {
+  absl::Time interval_end;
+  std::vector<std::string> read_columns;
+  int64_t fprint = 0;
+  int64_t execution_count = 0;
+  double avg_rows = 0;
+  double avg_bytes = 0;
+  double avg_cpu_seconds = 0;
+  int64_t run_in_rw_transaction_execution_count = 0;
+};
+
+// ReadStatsAggregator accumulates the read requests of a database into
+// per-shape statistics for each minute, ten minute and hour interval, in the
+// style of Cloud Spanner's read statistics tables. Reads have the same shape
+// if they read the same columns.
+//
+// As with QueryStatsAggregator, only the most recent intervals are retained,
+// only the shapes with the highest total CPU time are reported per interval,
+// and the interval in progress is reported as well. Reads are executed on a
+// single thread, so their CPU time is their latency.
+//
+// This class is thread-safe.
+class ReadStatsAggregator {
+ public:
+  // The number of distinct read shapes reported per interval.
+  static constexpr int kMaxReadsPerInterval = 100;
+
+  ReadStatsAggregator();
+
+  // Records sample as having completed at time now.
+  void Record(const ReadExecutionSample& sample, absl::Time now)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the statistics of the top read shapes of the retained intervals of
+  // the given length, ordered by interval end, latest first, and then by
+  // decreasing total CPU time.
+  std::vector<ReadStatsRow> GetStats(QueryStatsInterval interval,
+                                     absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the statistics of all reads of the same intervals as GetStats,
+  // latest first. The fingerprint and columns are not set.
+  std::vector<ReadStatsRow> GetTotals(QueryStatsInterval interval,
+                                      absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the fingerprint reported for the given read columns.
+  static int64_t Fingerprint(const absl::btree_set<std::string>& read_columns);
+
+ private:
+  ReadStatsAggregator(const ReadStatsAggregator&) = delete;
+  ReadStatsAggregator& operator=(const ReadStatsAggregator&) = delete;
+
+  // Running totals for a single read shape, or for all reads.
+  struct Totals {
+    std::vector<std::string> read_columns;
+    int64_t execution_count = 0;
+    int64_t rows = 0;
+    int64_t bytes = 0;
+    absl::Duration latency;
+    int64_t rw_transaction_count = 0;
+  };
+  using Buckets = StatsBuckets<int64_t, Totals>;
+
+  static void Add(const ReadExecutionSample& sample, Totals* totals);
+  static ReadStatsRow ToRow(absl::Time interval_end, int64_t fprint,
+                            const Totals& totals);
+  const Buckets& GetBuckets(QueryStatsInterval interval) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  Buckets minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets ten_minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets hour_buckets_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_READ_STATS_AGGREGATOR_H_
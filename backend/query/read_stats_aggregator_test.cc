@@ -0,0 +1,117 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/read_stats_aggregator.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/btree_set.h"
+#include "absl/time/time.h"
+#include "backend/query/query_stats_aggregator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::testing::ElementsAre;
+
+ReadExecutionSample Sample(absl::btree_set<std::string> read_columns,
+                           int64_t rows, absl::Duration latency) {
+  ReadExecutionSample sample;
+  sample.read_columns = std::move(read_columns);
+  sample.rows = rows;
+  sample.bytes = 10 * rows;
+  sample.latency = latency;
+  return sample;
+}
+
+class ReadStatsAggregatorTest : public testing::Test {
+ protected:
+  // An arbitrary minute boundary.
+  const absl::Time start_ = absl::FromUnixSeconds(1700000040);
+  ReadStatsAggregator aggregator_;
+};
+
+TEST_F(ReadStatsAggregatorTest, AveragesReadsOfTheSameColumns) {
+  aggregator_.Record(Sample({"Users.Name", "Users.Age"}, 1, absl::Seconds(1)),
+                     start_);
+  ReadExecutionSample in_transaction =
+      Sample({"Users.Age", "Users.Name"}, 3, absl::Seconds(3));
+  in_transaction.in_read_write_transaction = true;
+  aggregator_.Record(in_transaction, start_ + absl::Seconds(30));
+
+  std::vector<ReadStatsRow> rows = aggregator_.GetStats(
+      QueryStatsInterval::kMinute, start_ + absl::Seconds(40));
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].interval_end, start_ + absl::Minutes(1));
+  EXPECT_THAT(rows[0].read_columns, ElementsAre("Users.Age", "Users.Name"));
+  EXPECT_EQ(rows[0].fprint, ReadStatsAggregator::Fingerprint(
+                                {"Users.Age", "Users.Name"}));
+  EXPECT_EQ(rows[0].execution_count, 2);
+  EXPECT_DOUBLE_EQ(rows[0].avg_rows, 2);
+  EXPECT_DOUBLE_EQ(rows[0].avg_bytes, 20);
+  EXPECT_DOUBLE_EQ(rows[0].avg_cpu_seconds, 2);
+  EXPECT_EQ(rows[0].run_in_rw_transaction_execution_count, 1);
+}
+
+TEST_F(ReadStatsAggregatorTest, OrdersShapesByTotalCpuTime) {
+  aggregator_.Record(Sample({"Users.Name"}, 1, absl::Seconds(1)), start_);
+  aggregator_.Record(Sample({"Users.Age"}, 1, absl::Seconds(2)), start_);
+
+  std::vector<ReadStatsRow> rows =
+      aggregator_.GetStats(QueryStatsInterval::kHour, start_);
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_THAT(rows[0].read_columns, ElementsAre("Users.Age"));
+  EXPECT_THAT(rows[1].read_columns, ElementsAre("Users.Name"));
+
+  std::vector<ReadStatsRow> totals =
+      aggregator_.GetTotals(QueryStatsInterval::kHour, start_);
+  ASSERT_EQ(totals.size(), 1);
+  EXPECT_EQ(totals[0].execution_count, 2);
+  EXPECT_DOUBLE_EQ(totals[0].avg_cpu_seconds, 1.5);
+  EXPECT_TRUE(totals[0].read_columns.empty());
+}
+
+TEST_F(ReadStatsAggregatorTest, SeparatesIntervals) {
+  aggregator_.Record(Sample({"Users.Name"}, 1, absl::Seconds(1)), start_);
+  aggregator_.Record(Sample({"Users.Name"}, 1, absl::Seconds(1)),
+                     start_ + absl::Minutes(1));
+
+  // Intervals which have not started yet are not reported.
+  EXPECT_EQ(aggregator_.GetTotals(QueryStatsInterval::kMinute, start_).size(),
+            1);
+
+  std::vector<ReadStatsRow> rows = aggregator_.GetTotals(
+      QueryStatsInterval::kMinute, start_ + absl::Minutes(1));
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_EQ(rows[0].interval_end, start_ + absl::Minutes(2));
+  EXPECT_EQ(rows[1].interval_end, start_ + absl::Minutes(1));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,81 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/resolved_ast_util.h"
+
+#include <vector>
+
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "backend/query/queryable_column.h"
+#include "backend/query/queryable_table.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+void CollectConjuncts(const zetasql::ResolvedExpr* expr,
+                      std::vector<const zetasql::ResolvedExpr*>* conjuncts) {
+  if (expr->node_kind() == zetasql::RESOLVED_FUNCTION_CALL) {
+    const auto* call = expr->GetAs<zetasql::ResolvedFunctionCall>();
+    if (call->function()->IsZetaSQLBuiltin() &&
+        call->function()->Name() == "$and") {
+      for (const auto& argument : call->argument_list()) {
+        CollectConjuncts(argument.get(), conjuncts);
+      }
+      return;
+    }
+  }
+  conjuncts->push_back(expr);
+}
+
+const QueryableTable* MatchTableScan(
+    const zetasql::ResolvedScan* scan,
+    absl::flat_hash_map<int, const Column*>* scanned_columns) {
+  if (scan->node_kind() != zetasql::RESOLVED_TABLE_SCAN) {
+    return nullptr;
+  }
+  const auto* table_scan = scan->GetAs<zetasql::ResolvedTableScan>();
+  if (!table_scan->hint_list().empty() ||
+      table_scan->for_system_time_expr() != nullptr) {
+    return nullptr;
+  }
+  const auto* queryable_table =
+      dynamic_cast<const QueryableTable*>(table_scan->table());
+  if (queryable_table == nullptr ||
+      queryable_table->wrapped_table()->owner_change_stream() != nullptr) {
+    return nullptr;
+  }
+  for (int i = 0; i < table_scan->column_list_size(); ++i) {
+    const auto* column = dynamic_cast<const QueryableColumn*>(
+        queryable_table->GetColumn(table_scan->column_index_list(i)));
+    if (column == nullptr) {
+      return nullptr;
+    }
+    (*scanned_columns)[table_scan->column_list(i).column_id()] =
+        column->wrapped_column();
+  }
+  return queryable_table;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
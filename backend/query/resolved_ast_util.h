@@ -0,0 +1,54 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_RESOLVED_AST_UTIL_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_RESOLVED_AST_UTIL_H_
+
+#include <vector>
+
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/container/flat_hash_map.h"
+#include "backend/query/queryable_table.h"
+#include "backend/schema/catalog/column.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Helpers for the matchers of resolved statements which are executed directly
+// through a RowReader instead of by the ZetaSQL evaluator.
+
+// Appends the conjuncts of expr, which are the operands of nested ANDs, to
+// conjuncts. An expr which is not an AND is its own single conjunct.
+void CollectConjuncts(const zetasql::ResolvedExpr* expr,
+                      std::vector<const zetasql::ResolvedExpr*>* conjuncts);
+
+// Returns the table read by scan and maps the columns it produces to the
+// columns of the table in scanned_columns, or returns nullptr if scan is not a
+// plain scan of a table read through a RowReader. Scans with hints or FOR
+// SYSTEM_TIME AS OF, and scans of views, information schema and change stream
+// tables do not qualify.
+const QueryableTable* MatchTableScan(
+    const zetasql::ResolvedScan* scan,
+    absl::flat_hash_map<int, const Column*>* scanned_columns);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_RESOLVED_AST_UTIL_H_
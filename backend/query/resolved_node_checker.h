@@ -0,0 +1,50 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_RESOLVED_NODE_CHECKER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_RESOLVED_NODE_CHECKER_H_
+
+#include "zetasql/resolved_ast/resolved_node.h"
+#include "absl/status/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Interface for checks which inspect the nodes of a resolved AST one at a time.
+//
+// A checker is registered with a QueryValidator, which hands it every node it
+// visits so that several checks share a single walk of the tree. A checker
+// records the first problem it finds and reports it from Finish() once the
+// walk is complete, so that the validator's own errors keep precedence.
+class ResolvedNodeChecker {
+ public:
+  virtual ~ResolvedNodeChecker() = default;
+
+  // Inspects `node`, which is `depth` levels below the root of the tree.
+  virtual void CheckNode(const zetasql::ResolvedNode* node, int depth) = 0;
+
+  // Returns the outcome of the check after all nodes have been inspected.
+  virtual absl::Status Finish() = 0;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_RESOLVED_NODE_CHECKER_H_
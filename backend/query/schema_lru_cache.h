@@ -0,0 +1,144 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SCHEMA_LRU_CACHE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SCHEMA_LRU_CACHE_H_
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/schema/catalog/schema.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// SchemaLruCache is a thread-safe LRU cache of values derived from a schema,
+// such as analyzed queries or query results. Key must be hashable and have a
+// `schema` member, by which entries are erased before their schema is
+// destroyed.
+//
+// Values removed from the cache, whether evicted, discarded or erased, are
+// destroyed after the cache's lock is released, since destroying them may be
+// expensive.
+template <typename Key, typename Value>
+class SchemaLruCache {
+ public:
+  explicit SchemaLruCache(int64_t capacity) : capacity_(capacity) {}
+
+  SchemaLruCache(const SchemaLruCache&) = delete;
+  SchemaLruCache& operator=(const SchemaLruCache&) = delete;
+
+  // Returns the value for key and makes it the most recently used entry.
+  // Returns an empty value if there is no such entry.
+  Value Lookup(const Key& key) ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return Value();
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->second;
+  }
+
+  // Removes the entry for key from the cache and returns its value. Returns an
+  // empty value if there is no such entry.
+  Value Take(const Key& key) ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return Value();
+    }
+    Value value = std::move(it->second->second);
+    entries_.erase(it->second);
+    index_.erase(it);
+    return value;
+  }
+
+  // Adds value to the cache as the most recently used entry, evicting the
+  // least recently used entry if the cache is full. If there already is an
+  // entry for key, value is discarded.
+  void Insert(const Key& key, Value value) ABSL_LOCKS_EXCLUDED(mu_) {
+    if (capacity_ <= 0) {
+      return;
+    }
+    // Declared before the lock so that an evicted entry is destroyed after the
+    // lock is released.
+    Value evicted;
+    absl::MutexLock lock(&mu_);
+    if (index_.contains(key)) {
+      evicted = std::move(value);
+      return;
+    }
+    entries_.emplace_front(key, std::move(value));
+    index_[key] = entries_.begin();
+    if (static_cast<int64_t>(entries_.size()) > capacity_) {
+      evicted = std::move(entries_.back().second);
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+  // Returns the number of entries currently in the cache.
+  int64_t size() const ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    return entries_.size();
+  }
+
+  // Removes the entries for schema from the cache, before it is destroyed.
+  void EraseSchema(const Schema* schema) ABSL_LOCKS_EXCLUDED(mu_) {
+    // Declared before the lock so that the entries are destroyed after the lock
+    // is released.
+    std::list<Entry> erased;
+    absl::MutexLock lock(&mu_);
+    for (auto itr = entries_.begin(); itr != entries_.end();) {
+      auto next = std::next(itr);
+      if (itr->first.schema == schema) {
+        index_.erase(itr->first);
+        erased.splice(erased.end(), entries_, itr);
+      }
+      itr = next;
+    }
+  }
+
+ private:
+  using Entry = std::pair<Key, Value>;
+
+  // The maximum number of entries held by the cache.
+  const int64_t capacity_;
+
+  mutable absl::Mutex mu_;
+
+  // Entries ordered from the most to the least recently used.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mu_);
+
+  // Index of entries_ by key.
+  absl::flat_hash_map<Key, typename std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SCHEMA_LRU_CACHE_H_
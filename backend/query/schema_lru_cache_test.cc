@@ -0,0 +1,115 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/schema_lru_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "backend/schema/catalog/schema.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+struct TestKey {
+  const Schema* schema = nullptr;
+  std::string name;
+
+  bool operator==(const TestKey& other) const {
+    return schema == other.schema && name == other.name;
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const TestKey& key) {
+    return H::combine(std::move(h), key.schema, key.name);
+  }
+};
+
+// The cache only compares schemas by address, so the tests use distinct
+// addresses which are never dereferenced.
+const Schema* FakeSchema(int i) {
+  static char storage[2];
+  return reinterpret_cast<const Schema*>(&storage[i]);
+}
+
+TEST(SchemaLruCacheTest, EvictsLeastRecentlyUsedEntry) {
+  SchemaLruCache<TestKey, std::shared_ptr<int>> cache(/*capacity=*/2);
+  cache.Insert({nullptr, "a"}, std::make_shared<int>(1));
+  cache.Insert({nullptr, "b"}, std::make_shared<int>(2));
+  // Looking up "a" makes "b" the least recently used entry.
+  ASSERT_NE(cache.Lookup({nullptr, "a"}), nullptr);
+  cache.Insert({nullptr, "c"}, std::make_shared<int>(3));
+
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.Lookup({nullptr, "b"}), nullptr);
+  EXPECT_EQ(*cache.Lookup({nullptr, "a"}), 1);
+  EXPECT_EQ(*cache.Lookup({nullptr, "c"}), 3);
+}
+
+TEST(SchemaLruCacheTest, KeepsExistingEntryOnInsert) {
+  SchemaLruCache<TestKey, std::shared_ptr<int>> cache(/*capacity=*/2);
+  cache.Insert({nullptr, "a"}, std::make_shared<int>(1));
+  cache.Insert({nullptr, "a"}, std::make_shared<int>(2));
+
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(*cache.Lookup({nullptr, "a"}), 1);
+}
+
+TEST(SchemaLruCacheTest, TakeRemovesEntry) {
+  SchemaLruCache<TestKey, std::unique_ptr<int>> cache(/*capacity=*/2);
+  cache.Insert({nullptr, "a"}, std::make_unique<int>(1));
+
+  std::unique_ptr<int> value = cache.Take({nullptr, "a"});
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(*value, 1);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.Take({nullptr, "a"}), nullptr);
+}
+
+TEST(SchemaLruCacheTest, CachesNothingWithoutCapacity) {
+  SchemaLruCache<TestKey, std::shared_ptr<int>> cache(/*capacity=*/0);
+  cache.Insert({nullptr, "a"}, std::make_shared<int>(1));
+
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.Lookup({nullptr, "a"}), nullptr);
+}
+
+TEST(SchemaLruCacheTest, ErasesOnlyEntriesOfSchema) {
+  SchemaLruCache<TestKey, std::shared_ptr<int>> cache(/*capacity=*/3);
+  cache.Insert({FakeSchema(0), "a"}, std::make_shared<int>(1));
+  cache.Insert({FakeSchema(1), "a"}, std::make_shared<int>(2));
+  cache.Insert({FakeSchema(0), "b"}, std::make_shared<int>(3));
+
+  cache.EraseSchema(FakeSchema(0));
+
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.Lookup({FakeSchema(0), "a"}), nullptr);
+  EXPECT_EQ(cache.Lookup({FakeSchema(0), "b"}), nullptr);
+  EXPECT_EQ(*cache.Lookup({FakeSchema(1), "a"}), 2);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,502 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/simple_select.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+bool HasKeyEquality(const zetasql::Type* type) {
+  switch (type->kind()) {
+    case zetasql::TYPE_BOOL:
+    case zetasql::TYPE_INT64:
+    case zetasql::TYPE_STRING:
+    case zetasql::TYPE_BYTES:
+    case zetasql::TYPE_DATE:
+    case zetasql::TYPE_TIMESTAMP:
+    case zetasql::TYPE_NUMERIC:
+      return true;
+    default:
+      return false;
+  }
+}
+
+namespace {
+
+// Orders values of a type with key equality (see HasKeyEquality).
+struct ValueLess {
+  bool operator()(const zetasql::Value& a, const zetasql::Value& b) const {
+    return a.LessThan(b);
+  }
+};
+
+}  // namespace
+
+std::optional<SimpleSelect::Operand> SimpleSelect::MakeOperand(
+    const zetasql::ResolvedExpr* expr) {
+  Operand operand;
+  if (expr->node_kind() == zetasql::RESOLVED_LITERAL) {
+    operand.literal = expr->GetAs<zetasql::ResolvedLiteral>()->value();
+  } else if (expr->node_kind() == zetasql::RESOLVED_PARAMETER) {
+    operand.parameter = expr->GetAs<zetasql::ResolvedParameter>()->name();
+  } else {
+    return std::nullopt;
+  }
+  return operand;
+}
+
+std::unique_ptr<const SimpleSelect> SimpleSelect::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT ||
+      !statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  if (query_stmt->is_value_table()) {
+    return nullptr;
+  }
+
+  auto simple_select = absl::WrapUnique(new SimpleSelect());
+
+  // Unwrap LIMIT <n> [OFFSET <m>], ORDER BY <items>, SELECT <columns> and
+  // WHERE <predicate>, in that order.
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() == zetasql::RESOLVED_LIMIT_OFFSET_SCAN) {
+    const auto* limit_scan = scan->GetAs<zetasql::ResolvedLimitOffsetScan>();
+    const zetasql::ResolvedExpr* limit = limit_scan->limit();
+    const zetasql::ResolvedExpr* offset = limit_scan->offset();
+    if (limit == nullptr || !limit->type()->IsInt64() ||
+        (offset != nullptr && !offset->type()->IsInt64())) {
+      return nullptr;
+    }
+    simple_select->limit_ = MakeOperand(limit);
+    if (!simple_select->limit_.has_value()) {
+      return nullptr;
+    }
+    if (offset != nullptr) {
+      simple_select->offset_ = MakeOperand(offset);
+      if (!simple_select->offset_.has_value()) {
+        return nullptr;
+      }
+    }
+    scan = limit_scan->input_scan();
+  }
+  const zetasql::ResolvedOrderByScan* order_by_scan = nullptr;
+  if (scan->node_kind() == zetasql::RESOLVED_ORDER_BY_SCAN) {
+    order_by_scan = scan->GetAs<zetasql::ResolvedOrderByScan>();
+    if (!order_by_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = order_by_scan->input_scan();
+  }
+  if (scan->node_kind() == zetasql::RESOLVED_PROJECT_SCAN) {
+    const auto* project_scan = scan->GetAs<zetasql::ResolvedProjectScan>();
+    if (!project_scan->expr_list().empty() ||
+        !project_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = project_scan->input_scan();
+  }
+  const zetasql::ResolvedFilterScan* filter_scan = nullptr;
+  if (scan->node_kind() == zetasql::RESOLVED_FILTER_SCAN) {
+    filter_scan = scan->GetAs<zetasql::ResolvedFilterScan>();
+    if (!filter_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = filter_scan->input_scan();
+  }
+
+  // Only tables read through a RowReader, not views, information schema or
+  // change stream tables, can be read directly. The columns produced by the
+  // table scan are mapped to the columns of the table, which are read under
+  // their names.
+  absl::flat_hash_map<int, const Column*> scanned_columns;
+  const QueryableTable* queryable_table = MatchTableScan(scan, &scanned_columns);
+  if (queryable_table == nullptr) {
+    return nullptr;
+  }
+  const Table* table = queryable_table->wrapped_table();
+  simple_select->table_name_ = queryable_table->Name();
+  absl::flat_hash_map<const Column*, int> read_positions;
+  auto read_position = [&](const Column* column) {
+    auto [itr, inserted] = read_positions.try_emplace(
+        column, simple_select->read_column_names_.size());
+    if (inserted) {
+      simple_select->read_column_names_.push_back(column->Name());
+    }
+    return itr->second;
+  };
+
+  // Every column of the key prefix must be compared with a value exactly once,
+  // or for at most one column, with a list of values.
+  absl::flat_hash_map<const Column*, Operand> key_operands;
+  const Column* in_column = nullptr;
+  std::vector<const zetasql::ResolvedExpr*> conjuncts;
+  if (filter_scan != nullptr) {
+    CollectConjuncts(filter_scan->filter_expr(), &conjuncts);
+  }
+  for (const zetasql::ResolvedExpr* conjunct : conjuncts) {
+    if (conjunct->node_kind() != zetasql::RESOLVED_FUNCTION_CALL) {
+      return nullptr;
+    }
+    const auto* call = conjunct->GetAs<zetasql::ResolvedFunctionCall>();
+    if (!call->function()->IsZetaSQLBuiltin()) {
+      return nullptr;
+    }
+    const std::string& function_name = call->function()->Name();
+    if (function_name == "$in" || function_name == "$in_array") {
+      const bool in_array = function_name == "$in_array";
+      const zetasql::ResolvedExpr* column_ref = call->argument_list(0);
+      if (in_column != nullptr ||
+          (in_array && call->argument_list_size() != 2) ||
+          column_ref->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+        return nullptr;
+      }
+      const zetasql::ResolvedColumn& column =
+          column_ref->GetAs<zetasql::ResolvedColumnRef>()->column();
+      auto column_itr = scanned_columns.find(column.column_id());
+      if (column_itr == scanned_columns.end() ||
+          !HasKeyEquality(column_itr->second->GetType())) {
+        return nullptr;
+      }
+      for (int i = 1; i < call->argument_list_size(); ++i) {
+        const zetasql::ResolvedExpr* value = call->argument_list(i);
+        const zetasql::Type* value_type = value->type();
+        if (in_array) {
+          value_type = value_type->IsArray()
+                           ? value_type->AsArray()->element_type()
+                           : nullptr;
+        }
+        std::optional<Operand> operand = MakeOperand(value);
+        if (value_type == nullptr ||
+            !value_type->Equals(column_itr->second->GetType()) ||
+            !operand.has_value()) {
+          return nullptr;
+        }
+        simple_select->in_operands_.push_back(*std::move(operand));
+      }
+      simple_select->in_array_ = in_array;
+      in_column = column_itr->second;
+      if (!key_operands.try_emplace(in_column, Operand()).second) {
+        return nullptr;
+      }
+      continue;
+    }
+    if (function_name != "$equal" || call->argument_list_size() != 2) {
+      return nullptr;
+    }
+    const zetasql::ResolvedExpr* column_ref = call->argument_list(0);
+    const zetasql::ResolvedExpr* value = call->argument_list(1);
+    if (column_ref->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+      std::swap(column_ref, value);
+    }
+    if (column_ref->node_kind() != zetasql::RESOLVED_COLUMN_REF) {
+      return nullptr;
+    }
+    auto column_itr = scanned_columns.find(
+        column_ref->GetAs<zetasql::ResolvedColumnRef>()->column().column_id());
+    if (column_itr == scanned_columns.end() ||
+        !HasKeyEquality(column_itr->second->GetType()) ||
+        !value->type()->Equals(column_itr->second->GetType())) {
+      return nullptr;
+    }
+    std::optional<Operand> operand = MakeOperand(value);
+    if (!operand.has_value() ||
+        !key_operands.try_emplace(column_itr->second, *std::move(operand))
+             .second) {
+      return nullptr;
+    }
+  }
+  for (const KeyColumn* key_column : table->primary_key()) {
+    auto operand_itr = key_operands.find(key_column->column());
+    if (operand_itr == key_operands.end()) {
+      break;
+    }
+    if (key_column->column() == in_column) {
+      simple_select->in_index_ = simple_select->key_operands_.size();
+    }
+    simple_select->key_operands_.push_back(std::move(operand_itr->second));
+    simple_select->key_positions_.push_back(
+        read_position(key_column->column()));
+    simple_select->key_types_.push_back(key_column->column()->GetType());
+    simple_select->key_descending_.push_back(key_column->is_descending());
+  }
+  const int prefix_size = simple_select->key_operands_.size();
+  if (prefix_size != static_cast<int>(key_operands.size())) {
+    return nullptr;
+  }
+  simple_select->point_read_ =
+      prefix_size == static_cast<int>(table->primary_key().size());
+  if (!simple_select->point_read_ &&
+      (!simple_select->limit_.has_value() || in_column != nullptr)) {
+    return nullptr;
+  }
+
+  // Rows are read in key order or in reverse key order, so the ORDER BY must
+  // name the key columns after the prefix in order, either each in the
+  // direction of the key or each in the opposite direction. Key columns in the
+  // prefix have a single value and may be named anywhere, except for a column
+  // matched by IN, whose values are read in key order as the key is whole.
+  if (order_by_scan != nullptr) {
+    int next_key_column = prefix_size;
+    bool in_column_ordered = false;
+    for (const auto& item : order_by_scan->order_by_item_list()) {
+      auto column_itr =
+          scanned_columns.find(item->column_ref()->column().column_id());
+      if (column_itr == scanned_columns.end() ||
+          item->null_order() !=
+              zetasql::ResolvedOrderByItemEnums::ORDER_UNSPECIFIED) {
+        return nullptr;
+      }
+      const KeyColumn* key_column =
+          table->FindKeyColumn(column_itr->second->Name());
+      if (key_column == nullptr) {
+        return nullptr;
+      }
+      int index = std::find(table->primary_key().begin(),
+                            table->primary_key().end(), key_column) -
+                  table->primary_key().begin();
+      if (index < prefix_size && index != simple_select->in_index_) {
+        continue;
+      }
+      const bool reverse = item->is_descending() != key_column->is_descending();
+      if (index == simple_select->in_index_) {
+        if (in_column_ordered && reverse != simple_select->reverse_) {
+          return nullptr;
+        }
+        simple_select->reverse_ = reverse;
+        in_column_ordered = true;
+        continue;
+      }
+      if (index != next_key_column ||
+          (index > prefix_size && reverse != simple_select->reverse_)) {
+        return nullptr;
+      }
+      simple_select->reverse_ = reverse;
+      ++next_key_column;
+    }
+  }
+
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    auto column_itr =
+        scanned_columns.find(output_column->column().column_id());
+    if (column_itr == scanned_columns.end()) {
+      return nullptr;
+    }
+    simple_select->output_positions_.push_back(
+        read_position(column_itr->second));
+    simple_select->output_column_names_.push_back(output_column->name());
+    simple_select->output_column_types_.push_back(
+        output_column->column().type());
+  }
+  return simple_select;
+}
+
+zetasql::Value SimpleSelect::Bind(
+    const Operand& operand,
+    const std::map<std::string, zetasql::Value>& params) {
+  if (operand.literal.has_value()) {
+    return *operand.literal;
+  }
+  // Parameter names are case insensitive.
+  for (const auto& [name, value] : params) {
+    if (absl::EqualsIgnoreCase(name, operand.parameter)) {
+      return value;
+    }
+  }
+  return zetasql::Value();
+}
+
+bool SimpleSelect::BindInValues(
+    const std::map<std::string, zetasql::Value>& params,
+    std::vector<zetasql::Value>* in_values) const {
+  const zetasql::Type* type = key_types_[in_index_];
+  auto add = [&](const zetasql::Value& value) {
+    if (!value.is_valid() || !value.type()->Equals(type)) {
+      return false;
+    }
+    // NULL is not equal to any key value.
+    if (!value.is_null()) {
+      in_values->push_back(value);
+    }
+    return true;
+  };
+  for (const Operand& operand : in_operands_) {
+    zetasql::Value value = Bind(operand, params);
+    if (!in_array_) {
+      if (!add(value)) {
+        return false;
+      }
+      continue;
+    }
+    // The evaluator decides what IN UNNEST of a NULL array returns.
+    if (!value.is_valid() || value.is_null() || !value.type()->IsArray()) {
+      return false;
+    }
+    for (const zetasql::Value& element : value.elements()) {
+      if (!add(element)) {
+        return false;
+      }
+    }
+  }
+  std::sort(in_values->begin(), in_values->end(), ValueLess());
+  in_values->erase(std::unique(in_values->begin(), in_values->end()),
+                   in_values->end());
+  return true;
+}
+
+absl::StatusOr<bool> SimpleSelect::Execute(
+    const std::map<std::string, zetasql::Value>& params, RowReader* reader,
+    std::vector<std::vector<zetasql::Value>>* rows) const {
+  // The evaluator reports errors for a NULL or negative LIMIT or OFFSET, and a
+  // NULL key value matches no row rather than the rows with a NULL key.
+  auto bind_count = [&](const std::optional<Operand>& operand,
+                        int64_t* count) {
+    if (!operand.has_value()) {
+      return true;
+    }
+    zetasql::Value value = Bind(*operand, params);
+    if (!value.is_valid() || value.is_null() || !value.type()->IsInt64() ||
+        value.int64_value() < 0) {
+      return false;
+    }
+    *count = value.int64_value();
+    return true;
+  };
+  int64_t limit = 1;
+  int64_t offset = 0;
+  if (!bind_count(limit_, &limit) || !bind_count(offset_, &offset) ||
+      offset > std::numeric_limits<int64_t>::max() - limit) {
+    return false;
+  }
+  std::vector<zetasql::Value> key_values;
+  Key key;
+  for (int i = 0; i < key_operands_.size(); ++i) {
+    if (i == in_index_) {
+      key_values.emplace_back();
+      continue;
+    }
+    zetasql::Value value = Bind(key_operands_[i], params);
+    if (!value.is_valid() || value.is_null() ||
+        !value.type()->Equals(key_types_[i])) {
+      return false;
+    }
+    key.AddColumn(value, key_descending_[i]);
+    key_values.push_back(std::move(value));
+  }
+  std::vector<zetasql::Value> in_values;
+  if (in_index_ >= 0 && !BindInValues(params, &in_values)) {
+    return false;
+  }
+
+  rows->clear();
+  if (limit == 0) {
+    return true;
+  }
+  ReadArg read_arg;
+  read_arg.table = table_name_;
+  if (in_index_ >= 0) {
+    if (in_values.empty()) {
+      return true;
+    }
+    for (const zetasql::Value& in_value : in_values) {
+      Key in_key;
+      for (int i = 0; i < key_values.size(); ++i) {
+        in_key.AddColumn(i == in_index_ ? in_value : key_values[i],
+                         key_descending_[i]);
+      }
+      read_arg.key_set.AddKey(in_key);
+    }
+  } else if (point_read_) {
+    read_arg.key_set = KeySet(key);
+  } else if (!key_values.empty()) {
+    read_arg.key_set = KeySet(KeyRange::Prefix(key));
+  } else {
+    read_arg.key_set = KeySet::All();
+  }
+  read_arg.columns = read_column_names_;
+  read_arg.limit = limit + offset;
+  read_arg.reverse = reverse_;
+  std::unique_ptr<RowCursor> cursor;
+  ZETASQL_RETURN_IF_ERROR(reader->Read(read_arg, &cursor));
+  while (static_cast<int64_t>(rows->size()) < limit && cursor->Next()) {
+    // The rows are checked against the key prefix like the evaluator checks
+    // the rows of a table scan against the predicate, in case the reader
+    // returns more than the rows in the key set.
+    bool matches = true;
+    for (int i = 0; i < key_positions_.size(); ++i) {
+      if (i == in_index_) {
+        matches = matches && std::binary_search(
+                                 in_values.begin(), in_values.end(),
+                                 cursor->ColumnValue(key_positions_[i]),
+                                 ValueLess());
+        continue;
+      }
+      matches = matches && cursor->ColumnValue(key_positions_[i]) ==
+                               key_values[i];
+    }
+    if (!matches) {
+      continue;
+    }
+    if (offset > 0) {
+      --offset;
+      continue;
+    }
+    std::vector<zetasql::Value>& row = rows->emplace_back();
+    row.reserve(output_positions_.size());
+    for (int position : output_positions_) {
+      row.push_back(cursor->ColumnValue(position));
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(cursor->Status());
+  return true;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,158 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SIMPLE_SELECT_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SIMPLE_SELECT_H_
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Returns true if SQL equality and ordering on values of type are the same as
+// those of keys, so that Value::Equals and Value::LessThan can stand in for
+// them. NaNs and signed zeros compare differently, so floating point types do
+// not qualify.
+bool HasKeyEquality(const zetasql::Type* type);
+
+// SimpleSelect is a query which reads the columns of a bounded number of rows
+// of a table in primary key order, so that it can be executed as a single read
+// through a RowReader instead of by the ZetaSQL evaluator.
+//
+// It matches statements of the form
+//
+//   SELECT <columns> FROM <table> [WHERE <key1> = <v1> AND ...]
+//     [ORDER BY <key columns>] [LIMIT <n> [OFFSET <m>]]
+//
+// in which a prefix of the primary key columns of the table is compared for
+// equality with literals or query parameters of the types of the columns, the
+// ORDER BY names key columns in the order of the key, all in its direction or
+// all in the opposite direction (which is read in reverse key order), and the
+// select list only names columns of the table. The reads of statements which
+// do not compare the whole key must be bounded by a LIMIT, which is passed on
+// to the reader. Statements with hints, floating point keys or any other
+// predicate do not match.
+//
+// One column of a whole key may instead be matched by
+//
+//   <key> IN (<v1>, <v2>, ...)  or  <key> IN UNNEST(<array>)
+//
+// of literals or query parameters, in which case the distinct non-NULL values
+// are read as a single sorted multi-get of point keys. The ORDER BY may then
+// also name that column.
+class SimpleSelect {
+ public:
+  // Returns the SimpleSelect equivalent to statement, or nullptr if statement
+  // is not of the form above.
+  static std::unique_ptr<const SimpleSelect> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  // The names and types of the columns of the result.
+  const std::vector<std::string>& output_column_names() const {
+    return output_column_names_;
+  }
+  const std::vector<const zetasql::Type*>& output_column_types() const {
+    return output_column_types_;
+  }
+
+  // Reads the rows of the result with the given parameter values through
+  // reader into rows. Returns false without reading if the parameters have
+  // values which make the query differ from a point read, such as a NULL key
+  // value, in which case the query must be evaluated instead.
+  absl::StatusOr<bool> Execute(
+      const std::map<std::string, zetasql::Value>& params, RowReader* reader,
+      std::vector<std::vector<zetasql::Value>>* rows) const;
+
+ private:
+  // A literal, or the name of a query parameter.
+  struct Operand {
+    std::optional<zetasql::Value> literal;
+    std::string parameter;
+  };
+
+  SimpleSelect() = default;
+
+  // Returns the operand of the literal or parameter expr, or nullopt if expr
+  // is neither.
+  static std::optional<Operand> MakeOperand(const zetasql::ResolvedExpr* expr);
+
+  // Returns the value of operand, or an invalid value if it names a parameter
+  // which has no value.
+  static zetasql::Value Bind(
+      const Operand& operand,
+      const std::map<std::string, zetasql::Value>& params);
+
+  // Binds the distinct non-NULL values of the IN list into in_values, in
+  // increasing order. Returns false if a parameter has no value or a value of
+  // another type, or if the IN UNNEST array is NULL.
+  bool BindInValues(const std::map<std::string, zetasql::Value>& params,
+                    std::vector<zetasql::Value>* in_values) const;
+
+  // The table which is read, and the columns read from it.
+  std::string table_name_;
+  std::vector<std::string> read_column_names_;
+
+  // The position in read_column_names_ of each column of the result.
+  std::vector<int> output_positions_;
+  std::vector<std::string> output_column_names_;
+  std::vector<const zetasql::Type*> output_column_types_;
+
+  // The value compared with each column of the key prefix, the position of the
+  // column in read_column_names_, its type and whether it is descending. The
+  // operand of the column at in_index_ is unused.
+  std::vector<Operand> key_operands_;
+  std::vector<int> key_positions_;
+  std::vector<const zetasql::Type*> key_types_;
+  std::vector<bool> key_descending_;
+
+  // True if the key prefix is the whole primary key.
+  bool point_read_ = false;
+
+  // The index in the key of the column matched by IN, or -1 if there is none,
+  // and the values of its list, or the single array it is matched against if
+  // in_array_ is true.
+  int in_index_ = -1;
+  std::vector<Operand> in_operands_;
+  bool in_array_ = false;
+
+  // True if the ORDER BY is in reverse key order.
+  bool reverse_ = false;
+
+  // The LIMIT and OFFSET of the query, if it has them.
+  std::optional<Operand> limit_;
+  std::optional<Operand> offset_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SIMPLE_SELECT_H_
@@ -0,0 +1,229 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/sorted_select.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/external_sorter.h"
+#include "backend/query/queryable_table.h"
+#include "backend/query/resolved_ast_util.h"
+#include "backend/query/simple_select.h"
+#include "backend/schema/catalog/column.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of rows read between checks for the cancellation of the request.
+constexpr int64_t kCancellationCheckRows = 1024;
+
+// A cursor over the rows returned by a sorter, of which it returns the columns
+// at positions.
+class SortedRowCursor : public RowCursor {
+ public:
+  SortedRowCursor(std::unique_ptr<ExternalSorter> sorter,
+                  std::vector<int> positions,
+                  std::vector<std::string> column_names,
+                  std::vector<const zetasql::Type*> column_types)
+      : sorter_(std::move(sorter)),
+        positions_(std::move(positions)),
+        column_names_(std::move(column_names)),
+        column_types_(std::move(column_types)) {}
+
+  bool Next() override {
+    if (!status_.ok()) {
+      return false;
+    }
+    absl::StatusOr<bool> has_row = sorter_->Next(&row_);
+    if (!has_row.ok()) {
+      status_ = has_row.status();
+      return false;
+    }
+    return *has_row;
+  }
+
+  absl::Status Status() const override { return status_; }
+
+  int NumColumns() const override { return column_names_.size(); }
+
+  const std::string ColumnName(int i) const override {
+    return column_names_[i];
+  }
+
+  const zetasql::Type* ColumnType(int i) const override {
+    return column_types_[i];
+  }
+
+  const zetasql::Value ColumnValue(int i) const override {
+    return row_[positions_[i]];
+  }
+
+ private:
+  std::unique_ptr<ExternalSorter> sorter_;
+  const std::vector<int> positions_;
+  const std::vector<std::string> column_names_;
+  const std::vector<const zetasql::Type*> column_types_;
+  std::vector<zetasql::Value> row_;
+  absl::Status status_;
+};
+
+}  // namespace
+
+std::unique_ptr<const SortedSelect> SortedSelect::Match(
+    const zetasql::ResolvedStatement* statement) {
+  if (statement->node_kind() != zetasql::RESOLVED_QUERY_STMT ||
+      !statement->hint_list().empty()) {
+    return nullptr;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+  if (query_stmt->is_value_table()) {
+    return nullptr;
+  }
+
+  // Unwrap ORDER BY <items> and SELECT <columns>, in that order.
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  if (scan->node_kind() != zetasql::RESOLVED_ORDER_BY_SCAN) {
+    return nullptr;
+  }
+  const auto* order_by_scan = scan->GetAs<zetasql::ResolvedOrderByScan>();
+  if (!order_by_scan->hint_list().empty()) {
+    return nullptr;
+  }
+  scan = order_by_scan->input_scan();
+  if (scan->node_kind() == zetasql::RESOLVED_PROJECT_SCAN) {
+    const auto* project_scan = scan->GetAs<zetasql::ResolvedProjectScan>();
+    if (!project_scan->expr_list().empty() ||
+        !project_scan->hint_list().empty()) {
+      return nullptr;
+    }
+    scan = project_scan->input_scan();
+  }
+  absl::flat_hash_map<int, const Column*> scanned_columns;
+  const QueryableTable* queryable_table =
+      MatchTableScan(scan, &scanned_columns);
+  if (queryable_table == nullptr) {
+    return nullptr;
+  }
+
+  auto sorted_select = absl::WrapUnique(new SortedSelect());
+  sorted_select->table_name_ = queryable_table->Name();
+  absl::flat_hash_map<const Column*, int> read_positions;
+  auto read_position = [&](const Column* column) {
+    auto [itr, inserted] = read_positions.try_emplace(
+        column, sorted_select->read_column_names_.size());
+    if (inserted) {
+      sorted_select->read_column_names_.push_back(column->Name());
+      sorted_select->read_column_types_.push_back(column->GetType());
+    }
+    return itr->second;
+  };
+
+  for (const auto& item : order_by_scan->order_by_item_list()) {
+    auto column_itr =
+        scanned_columns.find(item->column_ref()->column().column_id());
+    if (column_itr == scanned_columns.end() ||
+        !HasKeyEquality(column_itr->second->GetType())) {
+      return nullptr;
+    }
+    SortColumn sort_column;
+    sort_column.position = read_position(column_itr->second);
+    sort_column.descending = item->is_descending();
+    switch (item->null_order()) {
+      case zetasql::ResolvedOrderByItemEnums::NULLS_FIRST:
+        sort_column.nulls_last = false;
+        break;
+      case zetasql::ResolvedOrderByItemEnums::NULLS_LAST:
+        sort_column.nulls_last = true;
+        break;
+      default:
+        sort_column.nulls_last = item->is_descending();
+        break;
+    }
+    sorted_select->order_.push_back(sort_column);
+  }
+
+  for (const auto& output_column : query_stmt->output_column_list()) {
+    auto column_itr =
+        scanned_columns.find(output_column->column().column_id());
+    if (column_itr == scanned_columns.end()) {
+      return nullptr;
+    }
+    sorted_select->output_positions_.push_back(
+        read_position(column_itr->second));
+    sorted_select->output_column_names_.push_back(output_column->name());
+    sorted_select->output_column_types_.push_back(
+        output_column->column().type());
+  }
+  return sorted_select;
+}
+
+absl::Status SortedSelect::Execute(RowReader* reader,
+                                   const ExternalSorter::Options& options,
+                                   std::unique_ptr<RowCursor>* cursor,
+                                   int64_t* num_rows) const {
+  ReadArg read_arg;
+  read_arg.table = table_name_;
+  read_arg.key_set = KeySet::All();
+  read_arg.columns = read_column_names_;
+  std::unique_ptr<RowCursor> table_cursor;
+  ZETASQL_RETURN_IF_ERROR(reader->Read(read_arg, &table_cursor));
+
+  auto sorter =
+      std::make_unique<ExternalSorter>(read_column_types_, order_, options);
+  while (table_cursor->Next()) {
+    if ((sorter->num_rows() + 1) % kCancellationCheckRows == 0) {
+      ZETASQL_RETURN_IF_ERROR(reader->CheckNotCancelled());
+    }
+    std::vector<zetasql::Value> row;
+    row.reserve(read_column_names_.size());
+    for (int i = 0; i < read_column_names_.size(); ++i) {
+      row.push_back(table_cursor->ColumnValue(i));
+    }
+    ZETASQL_RETURN_IF_ERROR(sorter->Add(std::move(row)));
+  }
+  ZETASQL_RETURN_IF_ERROR(table_cursor->Status());
+  ZETASQL_RETURN_IF_ERROR(sorter->Sort());
+
+  *num_rows = sorter->num_rows();
+  *cursor = std::make_unique<SortedRowCursor>(
+      std::move(sorter), output_positions_, output_column_names_,
+      output_column_types_);
+  return absl::OkStatus();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,94 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SORTED_SELECT_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SORTED_SELECT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/status.h"
+#include "backend/access/read.h"
+#include "backend/query/external_sorter.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// SortedSelect is a query which returns every row of a table sorted by some of
+// its columns, so that it can be executed by an ExternalSorter, whose memory is
+// bounded, instead of by the ZetaSQL evaluator, which sorts every row in
+// memory.
+//
+// It matches statements of the form
+//
+//   SELECT <columns> FROM <table>
+//     ORDER BY <column1> [ASC|DESC] [NULLS FIRST|NULLS LAST], ...
+//
+// in which the select list and the ORDER BY only name columns of the table.
+// Statements with hints, a LIMIT or a WHERE clause, and ORDER BY floating point
+// columns, do not match.
+class SortedSelect {
+ public:
+  // Returns the SortedSelect equivalent to statement, or nullptr if statement
+  // is not of the form above.
+  static std::unique_ptr<const SortedSelect> Match(
+      const zetasql::ResolvedStatement* statement);
+
+  const std::vector<std::string>& output_column_names() const {
+    return output_column_names_;
+  }
+  const std::vector<const zetasql::Type*>& output_column_types() const {
+    return output_column_types_;
+  }
+
+  // Reads every row of the table through reader and sorts them, returning a
+  // cursor over the sorted rows in cursor and their number in num_rows. The
+  // cursor reads spilled rows back as it is iterated, and does not use
+  // reader.
+  absl::Status Execute(RowReader* reader,
+                       const ExternalSorter::Options& options,
+                       std::unique_ptr<RowCursor>* cursor,
+                       int64_t* num_rows) const;
+
+ private:
+  SortedSelect() = default;
+
+  std::string table_name_;
+
+  // The columns read from the table, their types, and the order in which their
+  // rows are sorted.
+  std::vector<std::string> read_column_names_;
+  std::vector<const zetasql::Type*> read_column_types_;
+  std::vector<SortColumn> order_;
+
+  // The position in read_column_names_ of each output column.
+  std::vector<int> output_positions_;
+  std::vector<std::string> output_column_names_;
+  std::vector<const zetasql::Type*> output_column_types_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SORTED_SELECT_H_
@@ -0,0 +1,688 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/query/spanner_sys_catalog.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status_macros.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/locking/lock_stats.h"
+#include "backend/locking/request.h"
+#include "backend/query/query_stats_aggregator.h"
+#include "backend/query/read_stats_aggregator.h"
+#include "backend/query/transaction_stats_aggregator.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/storage/storage.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::types::BoolType;
+using zetasql::types::BytesType;
+using zetasql::types::DoubleType;
+using zetasql::types::Int64Type;
+using zetasql::types::StringArrayType;
+using zetasql::types::StringType;
+using zetasql::types::TimestampType;
+using zetasql::values::Bool;
+using zetasql::values::Bytes;
+using zetasql::values::Double;
+using zetasql::values::Int64;
+using zetasql::values::NullDouble;
+using zetasql::values::NullInt64;
+using zetasql::values::String;
+using zetasql::values::Timestamp;
+
+using Columns = std::vector<std::pair<std::string, const zetasql::Type*>>;
+
+// The columns of the QUERY_STATS_TOP_* tables, in ordinal order. See
+// spanner_sys_columns_metadata.csv. LATENCY_DISTRIBUTION is not exposed.
+const Columns& QueryStatsColumns() {
+  static const auto* columns = new Columns{
+          {"INTERVAL_END", TimestampType()},
+          {"TEXT", StringType()},
+          {"TEXT_TRUNCATED", BoolType()},
+          {"TEXT_FINGERPRINT", Int64Type()},
+          {"EXECUTION_COUNT", Int64Type()},
+          {"AVG_LATENCY_SECONDS", DoubleType()},
+          {"AVG_ROWS", DoubleType()},
+          {"AVG_BYTES", DoubleType()},
+          {"AVG_ROWS_SCANNED", DoubleType()},
+          {"AVG_CPU_SECONDS", DoubleType()},
+          {"CANCELLED_OR_DISCONNECTED_EXECUTION_COUNT", Int64Type()},
+          {"TIMED_OUT_EXECUTION_COUNT", Int64Type()},
+          {"ALL_FAILED_EXECUTION_COUNT", Int64Type()},
+          {"ALL_FAILED_AVG_LATENCY_SECONDS", DoubleType()},
+          {"REQUEST_TAG", StringType()},
+          {"AVG_BYTES_WRITTEN", DoubleType()},
+          {"AVG_ROWS_WRITTEN", DoubleType()},
+          {"STATEMENT_COUNT", Int64Type()},
+          {"RUN_IN_RW_TRANSACTION_EXECUTION_COUNT", Int64Type()},
+      };
+  return *columns;
+}
+
+// The columns of the TABLE_SIZES_STATS_1HOUR table, in ordinal order.
+const Columns& TableSizesColumns() {
+  static const auto* columns = new Columns{
+      {"INTERVAL_END", TimestampType()},
+      {"TABLE_NAME", StringType()},
+      {"USED_BYTES", DoubleType()},
+  };
+  return *columns;
+}
+
+// The type of the SAMPLE_LOCK_REQUESTS column of the LOCK_STATS_TOP_* tables.
+const zetasql::ArrayType* SampleLockRequestsType() {
+  static const zetasql::ArrayType* type = [] {
+    static zetasql::TypeFactory* const type_factory =
+        new zetasql::TypeFactory();
+    const zetasql::StructType* struct_type;
+    ZETASQL_CHECK_OK(type_factory->MakeStructType({{"COLUMN", StringType()},
+                                           {"LOCK_MODE", StringType()},
+                                           {"TRANSACTION_TAG", StringType()}},
+                                          &struct_type));
+    const zetasql::ArrayType* array_type;
+    ZETASQL_CHECK_OK(type_factory->MakeArrayType(struct_type, &array_type));
+    return array_type;
+  }();
+  return type;
+}
+
+// The columns of the LOCK_STATS_TOP_* tables, in ordinal order.
+const Columns& LockStatsColumns() {
+  static const auto* columns = new Columns{
+      {"INTERVAL_END", TimestampType()},
+      {"ROW_RANGE_START_KEY", BytesType()},
+      {"LOCK_WAIT_SECONDS", DoubleType()},
+      {"SAMPLE_LOCK_REQUESTS", SampleLockRequestsType()},
+  };
+  return *columns;
+}
+
+// The columns of the LOCK_STATS_TOTAL_* tables, in ordinal order.
+const Columns& LockStatsTotalColumns() {
+  static const auto* columns = new Columns{
+      {"INTERVAL_END", TimestampType()},
+      {"TOTAL_LOCK_WAIT_SECONDS", DoubleType()},
+  };
+  return *columns;
+}
+
+// The type of the OPERATIONS_BY_TABLE column of the TXN_STATS_* tables.
+const zetasql::ArrayType* OperationsByTableType() {
+  static const zetasql::ArrayType* type = [] {
+    static zetasql::TypeFactory* const type_factory =
+        new zetasql::TypeFactory();
+    const zetasql::StructType* struct_type;
+    ZETASQL_CHECK_OK(
+        type_factory->MakeStructType({{"TABLE", StringType()},
+                                      {"INSERT_OR_UPDATE_COUNT", Int64Type()},
+                                      {"INSERT_OR_UPDATE_BYTES", Int64Type()}},
+                                     &struct_type));
+    const zetasql::ArrayType* array_type;
+    ZETASQL_CHECK_OK(type_factory->MakeArrayType(struct_type, &array_type));
+    return array_type;
+  }();
+  return type;
+}
+
+// The columns of the TXN_STATS_TOP_* tables, in ordinal order.
+// TOTAL_LATENCY_DISTRIBUTION is not exposed.
+const Columns& TransactionStatsColumns() {
+  static const auto* columns = new Columns{
+      {"INTERVAL_END", TimestampType()},
+      {"FPRINT", Int64Type()},
+      {"READ_COLUMNS", StringArrayType()},
+      {"WRITE_CONSTRUCTIVE_COLUMNS", StringArrayType()},
+      {"WRITE_DELETE_TABLES", StringArrayType()},
+      {"ATTEMPT_COUNT", Int64Type()},
+      {"COMMIT_ATTEMPT_COUNT", Int64Type()},
+      {"COMMIT_ABORT_COUNT", Int64Type()},
+      {"COMMIT_RETRY_COUNT", Int64Type()},
+      {"COMMIT_FAILED_PRECONDITION_COUNT", Int64Type()},
+      {"AVG_PARTICIPANTS", DoubleType()},
+      {"AVG_TOTAL_LATENCY_SECONDS", DoubleType()},
+      {"AVG_COMMIT_LATENCY_SECONDS", DoubleType()},
+      {"AVG_BYTES", DoubleType()},
+      {"TRANSACTION_TAG", StringType()},
+      {"OPERATIONS_BY_TABLE", OperationsByTableType()},
+  };
+  return *columns;
+}
+
+// The columns of the TXN_STATS_TOTAL_* tables, in ordinal order.
+const Columns& TransactionStatsTotalColumns() {
+  static const auto* columns = new Columns{
+      {"INTERVAL_END", TimestampType()},
+      {"ATTEMPT_COUNT", Int64Type()},
+      {"COMMIT_ATTEMPT_COUNT", Int64Type()},
+      {"COMMIT_ABORT_COUNT", Int64Type()},
+      {"COMMIT_RETRY_COUNT", Int64Type()},
+      {"COMMIT_FAILED_PRECONDITION_COUNT", Int64Type()},
+      {"AVG_PARTICIPANTS", DoubleType()},
+      {"AVG_TOTAL_LATENCY_SECONDS", DoubleType()},
+      {"AVG_COMMIT_LATENCY_SECONDS", DoubleType()},
+      {"AVG_BYTES", DoubleType()},
+      {"OPERATIONS_BY_TABLE", OperationsByTableType()},
+  };
+  return *columns;
+}
+
+// The columns of the READ_STATS_TOP_* tables, in ordinal order.
+const Columns& ReadStatsColumns() {
+  static const auto* columns = new Columns{
+      {"INTERVAL_END", TimestampType()},
+      {"READ_COLUMNS", StringArrayType()},
+      {"FPRINT", Int64Type()},
+      {"EXECUTION_COUNT", Int64Type()},
+      {"AVG_ROWS", DoubleType()},
+      {"AVG_BYTES", DoubleType()},
+      {"AVG_CPU_SECONDS", DoubleType()},
+      {"AVG_LOCKING_DELAY_SECONDS", DoubleType()},
+      {"AVG_CLIENT_WAIT_SECONDS", DoubleType()},
+      {"AVG_LEADER_REFRESH_DELAY_SECONDS", DoubleType()},
+      {"RUN_IN_RW_TRANSACTION_EXECUTION_COUNT", Int64Type()},
+      {"REQUEST_TAG", StringType()},
+  };
+  return *columns;
+}
+
+// The columns of the READ_STATS_TOTAL_* tables, in ordinal order.
+const Columns& ReadStatsTotalColumns() {
+  static const auto* columns = new Columns{
+      {"INTERVAL_END", TimestampType()},
+      {"EXECUTION_COUNT", Int64Type()},
+      {"AVG_ROWS", DoubleType()},
+      {"AVG_BYTES", DoubleType()},
+      {"AVG_CPU_SECONDS", DoubleType()},
+      {"AVG_LOCKING_DELAY_SECONDS", DoubleType()},
+      {"AVG_CLIENT_WAIT_SECONDS", DoubleType()},
+      {"AVG_LEADER_REFRESH_DELAY_SECONDS", DoubleType()},
+      {"RUN_IN_RW_TRANSACTION_EXECUTION_COUNT", Int64Type()},
+  };
+  return *columns;
+}
+
+zetasql::Value StringArray(const std::vector<std::string>& strings) {
+  std::vector<zetasql::Value> values;
+  values.reserve(strings.size());
+  for (const std::string& s : strings) {
+    values.push_back(String(s));
+  }
+  return zetasql::Value::Array(StringArrayType(), values);
+}
+
+zetasql::Value OperationsByTable(
+    const std::map<std::string, TableOperations>& operations_by_table) {
+  std::vector<zetasql::Value> values;
+  values.reserve(operations_by_table.size());
+  for (const auto& [table, operations] : operations_by_table) {
+    values.push_back(zetasql::Value::Struct(
+        OperationsByTableType()->element_type()->AsStruct(),
+        {String(table), Int64(operations.insert_or_update_count),
+         Int64(operations.insert_or_update_bytes)}));
+  }
+  return zetasql::Value::Array(OperationsByTableType(), values);
+}
+
+// Returns the values of the TXN_STATS_TOP_* columns for row.
+std::vector<zetasql::Value> TransactionStatsRowValues(
+    const TransactionStatsRow& row) {
+  return {
+      Timestamp(row.interval_end),
+      Int64(row.fprint),
+      StringArray(row.read_columns),
+      StringArray(row.write_constructive_columns),
+      StringArray(row.write_delete_tables),
+      Int64(row.attempt_count),
+      Int64(row.commit_attempt_count),
+      Int64(row.commit_abort_count),
+      Int64(row.commit_retry_count),
+      Int64(row.commit_failed_precondition_count),
+      Double(row.avg_participants),
+      Double(row.avg_total_latency_seconds),
+      Double(row.avg_commit_latency_seconds),
+      Double(row.avg_bytes),
+      String(""),
+      OperationsByTable(row.operations_by_table),
+  };
+}
+
+// Returns the values of the TXN_STATS_TOTAL_* columns for row.
+std::vector<zetasql::Value> TransactionStatsTotalRowValues(
+    const TransactionStatsRow& row) {
+  return {
+      Timestamp(row.interval_end),
+      Int64(row.attempt_count),
+      Int64(row.commit_attempt_count),
+      Int64(row.commit_abort_count),
+      Int64(row.commit_retry_count),
+      Int64(row.commit_failed_precondition_count),
+      Double(row.avg_participants),
+      Double(row.avg_total_latency_seconds),
+      Double(row.avg_commit_latency_seconds),
+      Double(row.avg_bytes),
+      OperationsByTable(row.operations_by_table),
+  };
+}
+
+// Returns the values of the READ_STATS_TOP_* columns for row.
+std::vector<zetasql::Value> ReadStatsRowValues(const ReadStatsRow& row) {
+  return {
+      Timestamp(row.interval_end),
+      StringArray(row.read_columns),
+      Int64(row.fprint),
+      Int64(row.execution_count),
+      Double(row.avg_rows),
+      Double(row.avg_bytes),
+      Double(row.avg_cpu_seconds),
+      NullDouble(),
+      NullDouble(),
+      NullDouble(),
+      Int64(row.run_in_rw_transaction_execution_count),
+      String(""),
+  };
+}
+
+// Returns the values of the READ_STATS_TOTAL_* columns for row.
+std::vector<zetasql::Value> ReadStatsTotalRowValues(const ReadStatsRow& row) {
+  return {
+      Timestamp(row.interval_end),
+      Int64(row.execution_count),
+      Double(row.avg_rows),
+      Double(row.avg_bytes),
+      Double(row.avg_cpu_seconds),
+      NullDouble(),
+      NullDouble(),
+      NullDouble(),
+      Int64(row.run_in_rw_transaction_execution_count),
+  };
+}
+
+// Names of the tables, indexes and columns of a schema by their storage IDs,
+// for reporting lock requests which only refer to the IDs.
+struct SchemaNames {
+  explicit SchemaNames(const Schema* schema) {
+    if (schema == nullptr) {
+      return;
+    }
+    auto add_table = [this](const std::string& name, const Table* table) {
+      tables[table->id()] = name;
+      for (const Column* column : table->columns()) {
+        columns[column->id()] = column->Name();
+      }
+    };
+    for (const Table* table : schema->tables()) {
+      add_table(table->Name(), table);
+      for (const Index* index : table->indexes()) {
+        add_table(index->Name(), index->index_data_table());
+      }
+    }
+  }
+
+  // Returns the name of the table with the given id, or the id itself if it is
+  // not part of the schema (e.g. it was dropped since).
+  const std::string& TableName(const TableID& id) const {
+    auto it = tables.find(id);
+    return it == tables.end() ? id : it->second;
+  }
+
+  const std::string& ColumnName(const ColumnID& id) const {
+    auto it = columns.find(id);
+    return it == columns.end() ? id : it->second;
+  }
+
+  absl::flat_hash_map<TableID, std::string> tables;
+  absl::flat_hash_map<ColumnID, std::string> columns;
+};
+
+// Formats a key the way Cloud Spanner reports ROW_RANGE_START_KEY, e.g.
+// "Singers(32,"Alice")".
+std::string RowRangeStartKey(const std::string& table_name, const Key& key) {
+  std::vector<std::string> values;
+  values.reserve(key.NumColumns());
+  for (int i = 0; i < key.NumColumns(); ++i) {
+    values.push_back(key.ColumnValue(i).ShortDebugString());
+  }
+  return absl::StrCat(table_name, "(", absl::StrJoin(values, ","), ")");
+}
+
+// Returns the values of the LOCK_STATS_TOP_* columns for row. The existence
+// of a row is reported as its _exists column, as in Cloud Spanner.
+std::vector<zetasql::Value> LockStatsRowValues(const LockStatsRow& row,
+                                               const SchemaNames& names) {
+  const std::string& table_name = names.TableName(row.table_id);
+  std::vector<zetasql::Value> samples;
+  samples.reserve(row.sample_lock_requests.size());
+  for (const LockRequestSample& sample : row.sample_lock_requests) {
+    const std::string column_name = sample.column_id.empty()
+                                        ? std::string("_exists")
+                                        : names.ColumnName(sample.column_id);
+    samples.push_back(zetasql::Value::Struct(
+        SampleLockRequestsType()->element_type()->AsStruct(),
+        {String(absl::StrCat(table_name, ".", column_name)),
+         String(sample.mode == LockMode::kShared ? "ReaderShared"
+                                                 : "Exclusive"),
+         String("")}));
+  }
+  return {
+      Timestamp(row.interval_end),
+      Bytes(RowRangeStartKey(table_name, row.row_range_start_key)),
+      Double(row.lock_wait_seconds),
+      zetasql::Value::Array(SampleLockRequestsType(), samples),
+  };
+}
+
+// Returns the values of the QUERY_STATS_TOP_* columns for row. Queries are
+// evaluated on a single thread, so their CPU time is reported as their
+// latency.
+std::vector<zetasql::Value> QueryStatsRowValues(const QueryStatsRow& row) {
+  return {
+      Timestamp(row.interval_end),
+      String(row.text),
+      Bool(row.text_truncated),
+      Int64(row.text_fingerprint),
+      Int64(row.execution_count),
+      Double(row.avg_latency_seconds),
+      Double(row.avg_rows),
+      NullDouble(),
+      Double(row.avg_rows_scanned),
+      Double(row.avg_latency_seconds),
+      Int64(0),
+      Int64(0),
+      Int64(row.all_failed_execution_count),
+      Double(row.all_failed_avg_latency_seconds),
+      String(""),
+      NullDouble(),
+      Double(row.avg_rows_written),
+      Int64(row.execution_count),
+      NullInt64(),
+  };
+}
+
+// An EvaluatorTableIterator over rows materialized when the scan starts.
+class StatsTableIterator : public zetasql::EvaluatorTableIterator {
+ public:
+  StatsTableIterator(const Columns* columns,
+                     std::vector<std::vector<zetasql::Value>> rows,
+                     absl::Span<const int> column_idxs)
+      : columns_(columns),
+        rows_(std::move(rows)),
+        column_idxs_(column_idxs.begin(), column_idxs.end()) {}
+
+  int NumColumns() const override { return column_idxs_.size(); }
+
+  std::string GetColumnName(int i) const override {
+    return (*columns_)[column_idxs_[i]].first;
+  }
+
+  const zetasql::Type* GetColumnType(int i) const override {
+    return (*columns_)[column_idxs_[i]].second;
+  }
+
+  bool NextRow() override { return ++next_row_ <= rows_.size(); }
+
+  const zetasql::Value& GetValue(int i) const override {
+    return rows_[next_row_ - 1][column_idxs_[i]];
+  }
+
+  absl::Status Status() const override { return absl::OkStatus(); }
+
+  absl::Status Cancel() override { return absl::OkStatus(); }
+
+ private:
+  const Columns* columns_;
+  std::vector<std::vector<zetasql::Value>> rows_;
+  std::vector<int> column_idxs_;
+  size_t next_row_ = 0;
+};
+
+}  // namespace
+
+SpannerSysCatalog::SpannerSysCatalog(
+    const QueryStatsAggregator* query_stats, const Schema* schema,
+    const Storage* storage, const LockStatsAggregator* lock_stats,
+    const TransactionStatsAggregator* txn_stats,
+    const ReadStatsAggregator* read_stats)
+    : zetasql::SimpleCatalog(kName), query_stats_(query_stats) {
+  AddQueryStatsTable("QUERY_STATS_TOP_MINUTE", QueryStatsInterval::kMinute);
+  AddQueryStatsTable("QUERY_STATS_TOP_10MINUTE",
+                     QueryStatsInterval::kTenMinutes);
+  AddQueryStatsTable("QUERY_STATS_TOP_HOUR", QueryStatsInterval::kHour);
+  AddTableSizesTable(schema, storage);
+  AddLockStatsTables("MINUTE", LockStatsInterval::kMinute, schema, lock_stats);
+  AddLockStatsTables("10MINUTE", LockStatsInterval::kTenMinutes, schema,
+                     lock_stats);
+  AddLockStatsTables("HOUR", LockStatsInterval::kHour, schema, lock_stats);
+  AddTransactionStatsTables("MINUTE", QueryStatsInterval::kMinute, txn_stats);
+  AddTransactionStatsTables("10MINUTE", QueryStatsInterval::kTenMinutes,
+                            txn_stats);
+  AddTransactionStatsTables("HOUR", QueryStatsInterval::kHour, txn_stats);
+  AddReadStatsTables("MINUTE", QueryStatsInterval::kMinute, read_stats);
+  AddReadStatsTables("10MINUTE", QueryStatsInterval::kTenMinutes,
+                     read_stats);
+  AddReadStatsTables("HOUR", QueryStatsInterval::kHour, read_stats);
+}
+
+void SpannerSysCatalog::AddQueryStatsTable(const char* name,
+                                           QueryStatsInterval interval) {
+  auto table = std::make_unique<zetasql::SimpleTable>(name,
+                                                        QueryStatsColumns());
+  const QueryStatsAggregator* query_stats = query_stats_;
+  table->SetEvaluatorTableIteratorFactory(
+      [query_stats, interval](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (query_stats != nullptr) {
+          for (const QueryStatsRow& row :
+               query_stats->GetStats(interval, absl::Now())) {
+            rows.push_back(QueryStatsRowValues(row));
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &QueryStatsColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(table.get());
+  tables_.push_back(std::move(table));
+}
+
+void SpannerSysCatalog::AddTableSizesTable(const Schema* schema,
+                                           const Storage* storage) {
+  auto table = std::make_unique<zetasql::SimpleTable>(
+      "TABLE_SIZES_STATS_1HOUR", TableSizesColumns());
+  table->SetEvaluatorTableIteratorFactory(
+      [schema, storage](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (schema != nullptr && storage != nullptr) {
+          absl::Time now = absl::Now();
+          std::map<TableID, StorageMemoryUsage> usage =
+              storage->GetMemoryUsage();
+          auto add_row = [&](const std::string& name, const Table* data) {
+            auto it = usage.find(data->id());
+            int64_t used_bytes =
+                it == usage.end() ? 0 : it->second.total_bytes();
+            rows.push_back({Timestamp(now), String(name),
+                            Double(static_cast<double>(used_bytes))});
+          };
+          for (const Table* data_table : schema->tables()) {
+            add_row(data_table->Name(), data_table);
+            for (const Index* index : data_table->indexes()) {
+              add_row(index->Name(), index->index_data_table());
+            }
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &TableSizesColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(table.get());
+  tables_.push_back(std::move(table));
+}
+
+void SpannerSysCatalog::AddLockStatsTables(
+    const char* suffix, LockStatsInterval interval, const Schema* schema,
+    const LockStatsAggregator* lock_stats) {
+  auto top_table = std::make_unique<zetasql::SimpleTable>(
+      absl::StrCat("LOCK_STATS_TOP_", suffix), LockStatsColumns());
+  top_table->SetEvaluatorTableIteratorFactory(
+      [schema, lock_stats, interval](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (lock_stats != nullptr) {
+          const SchemaNames names(schema);
+          for (const LockStatsRow& row :
+               lock_stats->GetStats(interval, absl::Now())) {
+            rows.push_back(LockStatsRowValues(row, names));
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &LockStatsColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(top_table.get());
+  tables_.push_back(std::move(top_table));
+
+  auto total_table = std::make_unique<zetasql::SimpleTable>(
+      absl::StrCat("LOCK_STATS_TOTAL_", suffix), LockStatsTotalColumns());
+  total_table->SetEvaluatorTableIteratorFactory(
+      [lock_stats, interval](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (lock_stats != nullptr) {
+          for (const LockStatsTotalRow& row :
+               lock_stats->GetTotals(interval, absl::Now())) {
+            rows.push_back({Timestamp(row.interval_end),
+                            Double(row.total_lock_wait_seconds)});
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &LockStatsTotalColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(total_table.get());
+  tables_.push_back(std::move(total_table));
+}
+
+void SpannerSysCatalog::AddTransactionStatsTables(
+    const char* suffix, QueryStatsInterval interval,
+    const TransactionStatsAggregator* txn_stats) {
+  auto top_table = std::make_unique<zetasql::SimpleTable>(
+      absl::StrCat("TXN_STATS_TOP_", suffix), TransactionStatsColumns());
+  top_table->SetEvaluatorTableIteratorFactory(
+      [txn_stats, interval](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (txn_stats != nullptr) {
+          for (const TransactionStatsRow& row :
+               txn_stats->GetStats(interval, absl::Now())) {
+            rows.push_back(TransactionStatsRowValues(row));
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &TransactionStatsColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(top_table.get());
+  tables_.push_back(std::move(top_table));
+
+  auto total_table = std::make_unique<zetasql::SimpleTable>(
+      absl::StrCat("TXN_STATS_TOTAL_", suffix), TransactionStatsTotalColumns());
+  total_table->SetEvaluatorTableIteratorFactory(
+      [txn_stats, interval](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (txn_stats != nullptr) {
+          for (const TransactionStatsRow& row :
+               txn_stats->GetTotals(interval, absl::Now())) {
+            rows.push_back(TransactionStatsTotalRowValues(row));
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &TransactionStatsTotalColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(total_table.get());
+  tables_.push_back(std::move(total_table));
+}
+
+void SpannerSysCatalog::AddReadStatsTables(
+    const char* suffix, QueryStatsInterval interval,
+    const ReadStatsAggregator* read_stats) {
+  auto top_table = std::make_unique<zetasql::SimpleTable>(
+      absl::StrCat("READ_STATS_TOP_", suffix), ReadStatsColumns());
+  top_table->SetEvaluatorTableIteratorFactory(
+      [read_stats, interval](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (read_stats != nullptr) {
+          for (const ReadStatsRow& row :
+               read_stats->GetStats(interval, absl::Now())) {
+            rows.push_back(ReadStatsRowValues(row));
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &ReadStatsColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(top_table.get());
+  tables_.push_back(std::move(top_table));
+
+  auto total_table = std::make_unique<zetasql::SimpleTable>(
+      absl::StrCat("READ_STATS_TOTAL_", suffix), ReadStatsTotalColumns());
+  total_table->SetEvaluatorTableIteratorFactory(
+      [read_stats, interval](absl::Span<const int> column_idxs)
+          -> absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+        std::vector<std::vector<zetasql::Value>> rows;
+        if (read_stats != nullptr) {
+          for (const ReadStatsRow& row :
+               read_stats->GetTotals(interval, absl::Now())) {
+            rows.push_back(ReadStatsTotalRowValues(row));
+          }
+        }
+        return std::make_unique<StatsTableIterator>(
+            &ReadStatsTotalColumns(), std::move(rows), column_idxs);
+      });
+  AddTable(total_table.get());
+  tables_.push_back(std::move(total_table));
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
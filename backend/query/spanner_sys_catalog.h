@@ -0,0 +1,97 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SPANNER_SYS_CATALOG_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SPANNER_SYS_CATALOG_H_
+
+#include <memory>
+#include <vector>
+
+#include "zetasql/public/simple_catalog.h"
+#include "backend/locking/lock_stats.h"
+#include "backend/query/query_stats_aggregator.h"
+#include "backend/query/read_stats_aggregator.h"
+#include "backend/query/transaction_stats_aggregator.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/storage/storage.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// SpannerSysCatalog provides the SPANNER_SYS statistics tables.
+//
+// Unlike the information schema, whose contents only depend on the schema,
+// these tables are backed by a QueryStatsAggregator and are read when a query
+// scans them. A catalog may therefore be cached across executions and still
+// return up to date statistics.
+//
+// Cloud Spanner's query statistics are documented at:
+//   https://cloud.google.com/spanner/docs/introspection/query-statistics
+//
+// Only the QUERY_STATS_TOP_*, LOCK_STATS_*, TXN_STATS_*, READ_STATS_* and
+// TABLE_SIZES_STATS_1HOUR tables are exposed. Columns which the emulator cannot
+// measure (e.g. bytes returned) are NULL. TABLE_SIZES_STATS_1HOUR reports the
+// current in-memory size of each table and index, with the time of the scan as
+// its INTERVAL_END.
+//
+// The lock statistics tables report the lock conflicts of the emulator's lock
+// manager. With the default database-wide lock, conflicting transactions are
+// aborted instead of waiting, so their keys are reported with no lock wait.
+// Lock requests are not tagged, so TRANSACTION_TAG is always empty.
+//
+// The transaction statistics tables report the attempts of read-write
+// transactions. All data lives on a single split, so AVG_PARTICIPANTS is 1 for
+// committed transactions, and TOTAL_LATENCY_DISTRIBUTION is not exposed. The
+// read statistics tables report the read requests; the emulator does not
+// measure locking, client wait or leader refresh delays, which are NULL.
+class SpannerSysCatalog : public zetasql::SimpleCatalog {
+ public:
+  static constexpr char kName[] = "SPANNER_SYS";
+
+  // The aggregators, schema and storage are not owned and may be null, in
+  // which case the tables backed by them are empty.
+  explicit SpannerSysCatalog(
+      const QueryStatsAggregator* query_stats, const Schema* schema = nullptr,
+      const Storage* storage = nullptr,
+      const LockStatsAggregator* lock_stats = nullptr,
+      const TransactionStatsAggregator* txn_stats = nullptr,
+      const ReadStatsAggregator* read_stats = nullptr);
+
+ private:
+  void AddQueryStatsTable(const char* name, QueryStatsInterval interval);
+  void AddTableSizesTable(const Schema* schema, const Storage* storage);
+  void AddLockStatsTables(const char* suffix, LockStatsInterval interval,
+                          const Schema* schema,
+                          const LockStatsAggregator* lock_stats);
+  void AddTransactionStatsTables(const char* suffix,
+                                 QueryStatsInterval interval,
+                                 const TransactionStatsAggregator* txn_stats);
+  void AddReadStatsTables(const char* suffix, QueryStatsInterval interval,
+                          const ReadStatsAggregator* read_stats);
+
+  const QueryStatsAggregator* query_stats_;
+  std::vector<std::unique_ptr<zetasql::SimpleTable>> tables_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SPANNER_SYS_CATALOG_H_
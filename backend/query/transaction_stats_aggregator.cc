@@ -0,0 +1,191 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/transaction_stats_aggregator.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_buckets.h"
+#include "backend/query/query_stats_aggregator.h"
+#include "farmhash.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of distinct transactions tracked per interval, see
+// StatsBuckets.
+constexpr int kMaxTrackedTransactionsPerInterval =
+    10 * TransactionStatsAggregator::kMaxTransactionsPerInterval;
+
+}  // namespace
+
+TransactionStatsAggregator::TransactionStatsAggregator()
+    : minute_buckets_(absl::Minutes(1), QueryStatsAggregator::kMaxIntervals,
+                      kMaxTrackedTransactionsPerInterval),
+      ten_minute_buckets_(absl::Minutes(10),
+                          QueryStatsAggregator::kMaxIntervals,
+                          kMaxTrackedTransactionsPerInterval),
+      hour_buckets_(absl::Hours(1), QueryStatsAggregator::kMaxIntervals,
+                    kMaxTrackedTransactionsPerInterval) {}
+
+int64_t TransactionStatsAggregator::Fingerprint(
+    const TransactionExecutionSample& sample) {
+  // Column and table names cannot contain NUL, so the sets cannot be confused
+  // with each other.
+  const std::string shape = absl::StrCat(
+      absl::StrJoin(sample.read_columns, ","), std::string(1, '\0'),
+      absl::StrJoin(sample.write_constructive_columns, ","),
+      std::string(1, '\0'), absl::StrJoin(sample.write_delete_tables, ","));
+  return static_cast<int64_t>(farmhash::Fingerprint64(shape));
+}
+
+void TransactionStatsAggregator::Add(const TransactionExecutionSample& sample,
+                                     Totals* totals) {
+  ++totals->attempt_count;
+  if (sample.outcome == TransactionOutcome::kAborted) {
+    return;
+  }
+  ++totals->commit_attempt_count;
+  if (sample.retry) {
+    ++totals->commit_retry_count;
+  }
+  switch (sample.outcome) {
+    case TransactionOutcome::kCommitAborted:
+      ++totals->commit_abort_count;
+      return;
+    case TransactionOutcome::kCommitFailedPrecondition:
+      ++totals->commit_failed_precondition_count;
+      return;
+    case TransactionOutcome::kCommitFailed:
+    case TransactionOutcome::kAborted:
+      return;
+    case TransactionOutcome::kCommitted:
+      break;
+  }
+  ++totals->committed_count;
+  totals->total_latency += sample.total_latency;
+  totals->commit_latency += sample.commit_latency;
+  totals->bytes += sample.bytes;
+  for (const auto& [table, operations] : sample.operations_by_table) {
+    TableOperations& table_totals = totals->operations_by_table[table];
+    table_totals.insert_or_update_count += operations.insert_or_update_count;
+    table_totals.insert_or_update_bytes += operations.insert_or_update_bytes;
+  }
+}
+
+void TransactionStatsAggregator::Record(
+    const TransactionExecutionSample& sample, absl::Time now) {
+  const int64_t fprint = Fingerprint(sample);
+  absl::MutexLock lock(&mu_);
+  for (Buckets* buckets :
+       {&minute_buckets_, &ten_minute_buckets_, &hour_buckets_}) {
+    Buckets::Bucket* bucket = buckets->BucketAt(now);
+    if (bucket == nullptr) {
+      continue;
+    }
+    Add(sample, &bucket->totals);
+    Totals* totals = buckets->KeyTotals(bucket, fprint);
+    if (totals == nullptr) {
+      continue;
+    }
+    if (totals->attempt_count == 0) {
+      totals->read_columns.assign(sample.read_columns.begin(),
+                                  sample.read_columns.end());
+      totals->write_constructive_columns.assign(
+          sample.write_constructive_columns.begin(),
+          sample.write_constructive_columns.end());
+      totals->write_delete_tables.assign(sample.write_delete_tables.begin(),
+                                         sample.write_delete_tables.end());
+    }
+    Add(sample, totals);
+  }
+}
+
+TransactionStatsRow TransactionStatsAggregator::ToRow(absl::Time interval_end,
+                                                      int64_t fprint,
+                                                      const Totals& totals) {
+  TransactionStatsRow row;
+  row.interval_end = interval_end;
+  row.fprint = fprint;
+  row.read_columns = totals.read_columns;
+  row.write_constructive_columns = totals.write_constructive_columns;
+  row.write_delete_tables = totals.write_delete_tables;
+  row.attempt_count = totals.attempt_count;
+  row.commit_attempt_count = totals.commit_attempt_count;
+  row.commit_abort_count = totals.commit_abort_count;
+  row.commit_failed_precondition_count =
+      totals.commit_failed_precondition_count;
+  row.commit_retry_count = totals.commit_retry_count;
+  // Every transaction commits on the emulator's single split.
+  row.avg_participants = totals.committed_count == 0 ? 0 : 1;
+  row.avg_total_latency_seconds =
+      AverageSeconds(totals.total_latency, totals.committed_count);
+  row.avg_commit_latency_seconds =
+      AverageSeconds(totals.commit_latency, totals.committed_count);
+  row.avg_bytes = Average(totals.bytes, totals.committed_count);
+  row.operations_by_table = totals.operations_by_table;
+  return row;
+}
+
+const TransactionStatsAggregator::Buckets&
+TransactionStatsAggregator::GetBuckets(QueryStatsInterval interval) const {
+  return interval == QueryStatsInterval::kMinute       ? minute_buckets_
+         : interval == QueryStatsInterval::kTenMinutes ? ten_minute_buckets_
+                                                       : hour_buckets_;
+}
+
+std::vector<TransactionStatsRow> TransactionStatsAggregator::GetStats(
+    QueryStatsInterval interval, absl::Time now) const {
+  std::vector<TransactionStatsRow> rows;
+  absl::MutexLock lock(&mu_);
+  for (const Buckets::Bucket* bucket :
+       GetBuckets(interval).ReportedBuckets(now)) {
+    for (const auto& [fprint, totals] :
+         Buckets::TopKeys(*bucket, kMaxTransactionsPerInterval,
+                          [](const Totals& totals) {
+                            return totals.total_latency;
+                          })) {
+      rows.push_back(ToRow(bucket->interval_end, fprint, *totals));
+    }
+  }
+  return rows;
+}
+
+std::vector<TransactionStatsRow> TransactionStatsAggregator::GetTotals(
+    QueryStatsInterval interval, absl::Time now) const {
+  std::vector<TransactionStatsRow> rows;
+  absl::MutexLock lock(&mu_);
+  for (const Buckets::Bucket* bucket :
+       GetBuckets(interval).ReportedBuckets(now)) {
+    rows.push_back(ToRow(bucket->interval_end, 0, bucket->totals));
+  }
+  return rows;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,182 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_TRANSACTION_STATS_AGGREGATOR_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_TRANSACTION_STATS_AGGREGATOR_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/btree_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_buckets.h"
+#include "backend/query/query_stats_aggregator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// The rows inserted or updated in one table by a transaction.
+struct TableOperations {
+  int64_t insert_or_update_count = 0;
+  int64_t insert_or_update_bytes = 0;
+};
+
+// How a transaction attempt ended.
+enum class TransactionOutcome {
+  kCommitted,
+  kCommitAborted,
+  kCommitFailedPrecondition,
+  kCommitFailed,
+
+  // Aborted before it attempted to commit.
+  kAborted,
+};
+
+// A single attempt of a read-write transaction.
+struct TransactionExecutionSample {
+  // The columns read by the transaction, as "Table.Column".
+  absl::btree_set<std::string> read_columns;
+
+  // The columns inserted or updated by the transaction, as "Table.Column".
+  absl::btree_set<std::string> write_constructive_columns;
+
+  // The tables from which the transaction deleted rows.
+  absl::btree_set<std::string> write_delete_tables;
+
+  // The rows inserted or updated by the transaction, by table name.
+  std::map<std::string, TableOperations> operations_by_table;
+
+  TransactionOutcome outcome = TransactionOutcome::kCommitted;
+
+  // Whether the attempt follows an aborted attempt of the same transaction.
+  bool retry = false;
+
+  // Wall time from the first operation of the attempt until it ended.
+  absl::Duration total_latency;
+
+  // Wall time spent committing.
+  absl::Duration commit_latency;
+
+  // Bytes of the values written by the transaction.
+  int64_t bytes = 0;
+};
+
+// The statistics of one transaction fingerprint, or of all transactions, over
+// one interval, as exposed by the SPANNER_SYS transaction stats tables.
+struct TransactionStatsRow {
+  absl::Time interval_end;
+  int64_t fprint = 0;
+  std::vector<std::string> read_columns;
+  std::vector<std::string> write_constructive_columns;
+  std::vector<std::string> write_delete_tables;
+  int64_t attempt_count = 0;
+  int64_t commit_attempt_count = 0;
+  int64_t commit_abort_count = 0;
+  int64_t commit_failed_precondition_count = 0;
+  int64_t commit_retry_count = 0;
+  double avg_participants = 0;
+  double avg_total_latency_seconds = 0;
+  double avg_commit_latency_seconds = 0;
+  double avg_bytes = 0;
+  std::map<std::string, TableOperations> operations_by_table;
+};
+
+// TransactionStatsAggregator accumulates the attempts of a database's
+// read-write transactions into per-fingerprint statistics for each minute, ten
+// minute and hour interval, in the style of Cloud Spanner's transaction
+// statistics tables. Transactions share a fingerprint if they read and write
+// the same columns and delete from the same tables.
+//
+// As with QueryStatsAggregator, only the most recent intervals are retained,
+// only the transactions with the highest total latency are reported per
+// interval, and the interval in progress is reported as well. Averages are
+// over the committed attempts.
+//
+// This class is thread-safe.
+class TransactionStatsAggregator {
+ public:
+  // The number of distinct transactions reported per interval.
+  static constexpr int kMaxTransactionsPerInterval = 100;
+
+  TransactionStatsAggregator();
+
+  // Records sample as having ended at time now.
+  void Record(const TransactionExecutionSample& sample, absl::Time now)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the statistics of the top transactions of the retained intervals
+  // of the given length, ordered by interval end, latest first, and then by
+  // decreasing total latency.
+  std::vector<TransactionStatsRow> GetStats(QueryStatsInterval interval,
+                                            absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the statistics of all transactions of the same intervals as
+  // GetStats, latest first. The fingerprint and columns are not set.
+  std::vector<TransactionStatsRow> GetTotals(QueryStatsInterval interval,
+                                             absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the fingerprint reported for the transaction of sample.
+  static int64_t Fingerprint(const TransactionExecutionSample& sample);
+
+ private:
+  TransactionStatsAggregator(const TransactionStatsAggregator&) = delete;
+  TransactionStatsAggregator& operator=(const TransactionStatsAggregator&) =
+      delete;
+
+  // Running totals for a single transaction fingerprint, or all transactions.
+  struct Totals {
+    std::vector<std::string> read_columns;
+    std::vector<std::string> write_constructive_columns;
+    std::vector<std::string> write_delete_tables;
+    int64_t attempt_count = 0;
+    int64_t commit_attempt_count = 0;
+    int64_t commit_abort_count = 0;
+    int64_t commit_failed_precondition_count = 0;
+    int64_t commit_retry_count = 0;
+    int64_t committed_count = 0;
+    absl::Duration total_latency;
+    absl::Duration commit_latency;
+    int64_t bytes = 0;
+    std::map<std::string, TableOperations> operations_by_table;
+  };
+  using Buckets = StatsBuckets<int64_t, Totals>;
+
+  static void Add(const TransactionExecutionSample& sample, Totals* totals);
+  static TransactionStatsRow ToRow(absl::Time interval_end, int64_t fprint,
+                                   const Totals& totals);
+  const Buckets& GetBuckets(QueryStatsInterval interval) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  Buckets minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets ten_minute_buckets_ ABSL_GUARDED_BY(mu_);
+  Buckets hour_buckets_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_TRANSACTION_STATS_AGGREGATOR_H_
@@ -0,0 +1,146 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/transaction_stats_aggregator.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "backend/query/query_stats_aggregator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::testing::ElementsAre;
+
+TransactionExecutionSample Sample(TransactionOutcome outcome,
+                                  absl::Duration total_latency) {
+  TransactionExecutionSample sample;
+  sample.read_columns = {"Users.Name"};
+  sample.write_constructive_columns = {"Users.Age", "Users.Name"};
+  sample.operations_by_table["Users"] = {1, 16};
+  sample.outcome = outcome;
+  sample.total_latency = total_latency;
+  sample.commit_latency = total_latency / 2;
+  sample.bytes = 16;
+  return sample;
+}
+
+class TransactionStatsAggregatorTest : public testing::Test {
+ protected:
+  // An arbitrary minute boundary.
+  const absl::Time start_ = absl::FromUnixSeconds(1700000040);
+  TransactionStatsAggregator aggregator_;
+};
+
+TEST_F(TransactionStatsAggregatorTest, AveragesCommittedAttempts) {
+  aggregator_.Record(Sample(TransactionOutcome::kCommitted, absl::Seconds(2)),
+                     start_);
+  aggregator_.Record(
+      Sample(TransactionOutcome::kCommitAborted, absl::Seconds(10)),
+      start_ + absl::Seconds(10));
+  TransactionExecutionSample retry =
+      Sample(TransactionOutcome::kCommitted, absl::Seconds(4));
+  retry.retry = true;
+  aggregator_.Record(retry, start_ + absl::Seconds(20));
+
+  std::vector<TransactionStatsRow> rows = aggregator_.GetStats(
+      QueryStatsInterval::kMinute, start_ + absl::Seconds(30));
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].interval_end, start_ + absl::Minutes(1));
+  EXPECT_EQ(rows[0].fprint, TransactionStatsAggregator::Fingerprint(retry));
+  EXPECT_THAT(rows[0].read_columns, ElementsAre("Users.Name"));
+  EXPECT_THAT(rows[0].write_constructive_columns,
+              ElementsAre("Users.Age", "Users.Name"));
+  EXPECT_TRUE(rows[0].write_delete_tables.empty());
+  EXPECT_EQ(rows[0].attempt_count, 3);
+  EXPECT_EQ(rows[0].commit_attempt_count, 3);
+  EXPECT_EQ(rows[0].commit_abort_count, 1);
+  EXPECT_EQ(rows[0].commit_failed_precondition_count, 0);
+  EXPECT_EQ(rows[0].commit_retry_count, 1);
+  EXPECT_DOUBLE_EQ(rows[0].avg_participants, 1);
+  EXPECT_DOUBLE_EQ(rows[0].avg_total_latency_seconds, 3);
+  EXPECT_DOUBLE_EQ(rows[0].avg_commit_latency_seconds, 1.5);
+  EXPECT_DOUBLE_EQ(rows[0].avg_bytes, 16);
+  ASSERT_EQ(rows[0].operations_by_table.size(), 1);
+  EXPECT_EQ(rows[0].operations_by_table["Users"].insert_or_update_count, 2);
+  EXPECT_EQ(rows[0].operations_by_table["Users"].insert_or_update_bytes, 32);
+}
+
+TEST_F(TransactionStatsAggregatorTest, CountsAbortsBeforeCommit) {
+  aggregator_.Record(Sample(TransactionOutcome::kAborted, absl::Seconds(1)),
+                     start_);
+
+  std::vector<TransactionStatsRow> rows =
+      aggregator_.GetStats(QueryStatsInterval::kMinute, start_);
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0].attempt_count, 1);
+  EXPECT_EQ(rows[0].commit_attempt_count, 0);
+  EXPECT_DOUBLE_EQ(rows[0].avg_participants, 0);
+  EXPECT_DOUBLE_EQ(rows[0].avg_total_latency_seconds, 0);
+}
+
+TEST_F(TransactionStatsAggregatorTest, SeparatesFingerprints) {
+  TransactionExecutionSample slow =
+      Sample(TransactionOutcome::kCommitted, absl::Seconds(5));
+  slow.write_delete_tables = {"Users"};
+  aggregator_.Record(Sample(TransactionOutcome::kCommitted, absl::Seconds(1)),
+                     start_);
+  aggregator_.Record(slow, start_);
+
+  // Transactions are ordered by total latency.
+  std::vector<TransactionStatsRow> rows =
+      aggregator_.GetStats(QueryStatsInterval::kTenMinutes, start_);
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_THAT(rows[0].write_delete_tables, ElementsAre("Users"));
+  EXPECT_TRUE(rows[1].write_delete_tables.empty());
+  EXPECT_NE(rows[0].fprint, rows[1].fprint);
+
+  std::vector<TransactionStatsRow> totals =
+      aggregator_.GetTotals(QueryStatsInterval::kTenMinutes, start_);
+  ASSERT_EQ(totals.size(), 1);
+  EXPECT_EQ(totals[0].interval_end, rows[0].interval_end);
+  EXPECT_EQ(totals[0].commit_attempt_count, 2);
+  EXPECT_DOUBLE_EQ(totals[0].avg_total_latency_seconds, 3);
+}
+
+TEST_F(TransactionStatsAggregatorTest, RetainsTheMostRecentIntervals) {
+  const int intervals = QueryStatsAggregator::kMaxIntervals + 1;
+  for (int i = 0; i < intervals; ++i) {
+    aggregator_.Record(
+        Sample(TransactionOutcome::kCommitted, absl::Seconds(1)),
+        start_ + i * absl::Minutes(1));
+  }
+
+  std::vector<TransactionStatsRow> rows = aggregator_.GetTotals(
+      QueryStatsInterval::kMinute, start_ + intervals * absl::Minutes(1));
+  ASSERT_EQ(rows.size(), QueryStatsAggregator::kMaxIntervals);
+  EXPECT_EQ(rows.front().interval_end, start_ + intervals * absl::Minutes(1));
+  EXPECT_EQ(rows.back().interval_end, start_ + 2 * absl::Minutes(1));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -17,17 +17,28 @@
 #include "backend/schema/backfills/column_value_backfill.h"
 
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "backend/actions/batch_expression.h"
 #include "backend/actions/generated_column.h"
+#include "backend/actions/prepared_expression_cache.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/datamodel/types.h"
 #include "backend/query/analyzer_options.h"
 #include "backend/query/catalog.h"
 #include "backend/query/function_catalog.h"
+#include "backend/schema/backfills/table_scan.h"
 #include "backend/schema/catalog/table.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/partitioned_scan.h"
+#include "backend/storage/storage.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
@@ -61,9 +72,10 @@ absl::StatusOr<zetasql::Value> RewriteColumnValue(
       ZETASQL_ASSIGN_OR_RETURN(
           auto new_element,
           RewriteColumnValue(old_elem_type, new_elem_type, element));
-      array_elements.push_back(new_element);
+      array_elements.push_back(std::move(new_element));
     }
-    return zetasql::Value::Array(new_column_type->AsArray(), array_elements);
+    return zetasql::Value::MakeArray(new_column_type->AsArray(),
+                                     std::move(array_elements));
   }
 
   if (old_column_type->IsString() && new_column_type->IsBytes()) {
@@ -77,6 +89,16 @@ absl::StatusOr<zetasql::Value> RewriteColumnValue(
   return absl::InternalError("Invalid type conversion");
 }
 
+// Writes the values computed by each partition of a backfill, in key order.
+absl::Status ApplyPartitionOps(const SchemaValidationContext* context,
+                               std::vector<std::vector<StorageWriteOp>>* ops) {
+  for (std::vector<StorageWriteOp>& partition_ops : *ops) {
+    ZETASQL_RETURN_IF_ERROR(context->storage()->ApplyBatch(
+        context->pending_commit_timestamp(), absl::MakeSpan(partition_ops)));
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 absl::Status BackfillColumnValue(const Column* old_column,
@@ -86,24 +108,102 @@ absl::Status BackfillColumnValue(const Column* old_column,
   auto column_id = old_column->id();
   const Table* table = old_column->table();
 
-  std::unique_ptr<StorageIterator> itr;
-  ZETASQL_RETURN_IF_ERROR(context->storage()->Read(context->pending_commit_timestamp(),
-                                           table->id(), KeyRange::All(),
-                                           {column_id}, &itr));
-
-  while (itr->Next()) {
-    std::vector<zetasql::Value> row_values;
-    ZETASQL_RET_CHECK_EQ(itr->NumColumns(), 1);
-    const zetasql::Value& orig_value = itr->ColumnValue(0);
-    ZETASQL_ASSIGN_OR_RETURN(const auto new_column_value,
-                     RewriteColumnValue(old_column->GetType(),
-                                        new_column->GetType(), orig_value));
-    ZETASQL_RETURN_IF_ERROR(context->storage()->Write(
-        context->pending_commit_timestamp(), table->id(), itr->Key(),
-        {column_id}, {new_column_value}));
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<KeyRange> partitions,
+                   PartitionTableScan(context->storage(),
+                                      context->pending_commit_timestamp(),
+                                      table->id()));
+  std::vector<std::vector<StorageWriteOp>> ops(partitions.size());
+  ZETASQL_RETURN_IF_ERROR(ScanPartitionsInParallel(
+      partitions, [&](int i, const KeyRange& key_range) -> absl::Status {
+        std::unique_ptr<StorageIterator> itr;
+        ZETASQL_RETURN_IF_ERROR(context->storage()->Read(
+            context->pending_commit_timestamp(), table->id(), key_range,
+            {column_id}, &itr));
+        while (itr->Next()) {
+          ZETASQL_RET_CHECK_EQ(itr->NumColumns(), 1);
+          const zetasql::Value& orig_value = itr->ColumnValue(0);
+          ZETASQL_ASSIGN_OR_RETURN(auto new_column_value,
+                           RewriteColumnValue(old_column->GetType(),
+                                              new_column->GetType(), orig_value));
+          ops[i].push_back(StorageWriteOp{.table_id = table->id(),
+                                          .key = itr->Key(),
+                                          .column_ids = {column_id},
+                                          .values = {new_column_value}});
+        }
+        return itr->Status();
+      }));
+  return ApplyPartitionOps(context, &ops);
+}
+
+namespace {
+
+// Computes the values of a generated column, or of a column with a default
+// value, for the rows of a scan of its table. The computed values replace those
+// in the scan, so that later consumers of the scan see them.
+class GeneratedColumnBackfillConsumer : public TableScanConsumer {
+ public:
+  GeneratedColumnBackfillConsumer(const Column* generated_column,
+                                  const SchemaValidationContext* context)
+      : generated_column_(generated_column),
+        context_(context),
+        catalog_(context->validated_new_schema(), FunctionCatalog::Default(),
+                 context->type_factory()),
+        effector_(generated_column->table(), &catalog_, &expression_cache_) {}
+
+  const Table* table() const override { return generated_column_->table(); }
+
+  void Start(absl::Span<const ColumnID> scan_columns,
+             int num_partitions) override {
+    column_names_ = ScanColumnNames(table(), scan_columns);
+    column_index_ = ScanColumnIndex(generated_column_, scan_columns);
+    ops_.assign(num_partitions, {});
   }
 
-  return absl::OkStatus();
+  absl::Status Consume(int partition, TableScanBatch* batch) override {
+    std::vector<zetasql::Value> values;
+    ZETASQL_RETURN_IF_ERROR(effector_.ComputeGeneratedColumnValues(
+        generated_column_, column_names_, batch->column_values,
+        batch->keys.size(), &values));
+    for (int k = 0; k < batch->keys.size(); ++k) {
+      batch->column_values[column_index_][k] = values[k];
+      ops_[partition].push_back(
+          StorageWriteOp{.table_id = table()->id(),
+                         .key = batch->keys[k],
+                         .column_ids = {generated_column_->id()},
+                         .values = {std::move(values[k])}});
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Finish(
+      absl::Span<const absl::Status> partition_statuses) override {
+    for (const absl::Status& status : partition_statuses) {
+      ZETASQL_RETURN_IF_ERROR(status);
+    }
+    return ApplyPartitionOps(context_, &ops_);
+  }
+
+ private:
+  const Column* generated_column_;
+  const SchemaValidationContext* context_;
+  Catalog catalog_;
+  PreparedExpressionCache expression_cache_;
+  GeneratedColumnEffector effector_;
+
+  // The names of the scanned columns, and the position of generated_column_.
+  std::vector<std::string> column_names_;
+  int column_index_ = -1;
+
+  // The writes computed for each partition.
+  std::vector<std::vector<StorageWriteOp>> ops_;
+};
+
+}  // namespace
+
+std::unique_ptr<TableScanConsumer> MakeGeneratedColumnBackfillConsumer(
+    const Column* generated_column, const SchemaValidationContext* context) {
+  return std::make_unique<GeneratedColumnBackfillConsumer>(generated_column,
+                                                           context);
 }
 
 absl::Status BackfillGeneratedColumnValue(
@@ -112,38 +212,9 @@ absl::Status BackfillGeneratedColumnValue(
             (generated_column->is_generated() ||
              generated_column->has_default_value()));
   ZETASQL_RET_CHECK_NE(context, nullptr);
-  FunctionCatalog function_catalog(context->type_factory());
-  Catalog catalog(context->validated_new_schema(), &function_catalog,
-                  context->type_factory());
-  const Table* table = generated_column->table();
-  GeneratedColumnEffector effector(table, &catalog);
-
-  std::vector<ColumnID> column_ids = GetColumnIDs(table->columns());
-  std::unique_ptr<StorageIterator> itr;
-  ZETASQL_RETURN_IF_ERROR(context->storage()->Read(context->pending_commit_timestamp(),
-                                           table->id(), KeyRange::All(),
-                                           column_ids, &itr));
-  while (itr->Next()) {
-    zetasql::ParameterValueMap row_column_values;
-    for (int i = 0; i < itr->NumColumns(); ++i) {
-      // Storage returns invalid values if a value is not present, in which case
-      // we convert it into a typed NULL.
-      row_column_values[table->columns()[i]->Name()] =
-          itr->ColumnValue(i).is_valid()
-              ? itr->ColumnValue(i)
-              : zetasql::Value::Null(table->columns()[i]->GetType());
-    }
-
-    ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value,
-                     effector.ComputeGeneratedColumnValue(generated_column,
-                                                          row_column_values));
-
-    ZETASQL_RETURN_IF_ERROR(context->storage()->Write(
-        context->pending_commit_timestamp(), table->id(), itr->Key(),
-        {generated_column->id()}, {value}));
-  }
-
-  return itr->Status();
+  return RunTableScanAction(
+      context, MakeGeneratedColumnBackfillConsumer(generated_column, context)
+                   .get());
 }
 
 }  // namespace backend
@@ -17,6 +17,9 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_BACKFILLS_COLUMN_VALUE_BACKFILL_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_BACKFILLS_COLUMN_VALUE_BACKFILL_H_
 
+#include <memory>
+
+#include "backend/schema/backfills/table_scan.h"
 #include "backend/schema/catalog/column.h"
 #include "backend/schema/updater/schema_validation_context.h"
 
@@ -35,6 +38,12 @@ absl::Status BackfillColumnValue(const Column* old_column,
 absl::Status BackfillGeneratedColumnValue(
     const Column* generated_column, const SchemaValidationContext* context);
 
+// Returns a consumer which backfills 'generated_column' from a scan of its
+// table, which may be shared with other schema change actions. Consumers after
+// it in the scan see the backfilled values.
+std::unique_ptr<TableScanConsumer> MakeGeneratedColumnBackfillConsumer(
+    const Column* generated_column, const SchemaValidationContext* context);
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -16,24 +16,34 @@
 
 #include "backend/schema/backfills/index_backfill.h"
 
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "zetasql/public/functions/string.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "backend/common/ids.h"
 #include "backend/common/indexing.h"
 #include "backend/common/rows.h"
 #include "backend/datamodel/value.h"
 #include "backend/schema/catalog/column.h"
-#include "backend/storage/in_memory_storage.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/schema/backfills/table_scan.h"
 #include "backend/storage/iterator.h"
+#include "backend/storage/storage.h"
 #include "common/errors.h"
 #include "common/limits.h"
 #include "absl/status/status.h"
@@ -44,24 +54,52 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
-absl::Status BackfillIndex(const Index* index,
-                           const SchemaValidationContext* context) {
+namespace {
+
+// Computes the index entry for base_row, unless the index filters it out.
+absl::Status AddIndexEntry(const Index* index,
+                           const std::vector<ColumnID>& index_column_ids,
+                           const Row& base_row,
+                           std::vector<StorageWriteOp>* entries) {
+  // Backfill should return failed precondition error for invalid index keys.
+  ZETASQL_ASSIGN_OR_RETURN(Key index_data_table_key, ComputeIndexKey(base_row, index),
+                   _.SetErrorCode(absl::StatusCode::kFailedPrecondition));
+  if (ShouldFilterIndexKey(index, index_data_table_key)) {
+    return absl::OkStatus();
+  }
+
+  StorageWriteOp& entry = entries->emplace_back();
+  entry.table_id = index->index_data_table()->id();
+  entry.key = std::move(index_data_table_key);
+  entry.column_ids = index_column_ids;
+  entry.values = ComputeIndexValues(base_row, index);
+  return absl::OkStatus();
+}
+
+// Computes the index entries for the first max_rows rows of the indexed table
+// in key_range, in base table key order. Returns the number of rows read, and
+// sets last_key, if not null, to the key of the last one.
+absl::StatusOr<int64_t> ComputeIndexEntries(
+    const Index* index, const SchemaValidationContext* context,
+    const KeyRange& key_range, std::vector<StorageWriteOp>* entries,
+    int64_t max_rows = std::numeric_limits<int64_t>::max(),
+    Key* last_key = nullptr) {
   absl::Span<const Column* const> base_columns =
       index->indexed_table()->columns();
-  absl::Span<const Column* const> index_columns =
-      index->index_data_table()->columns();
   std::vector<ColumnID> base_column_ids = GetColumnIDs(base_columns);
-  std::vector<ColumnID> index_column_ids = GetColumnIDs(index_columns);
+  std::vector<ColumnID> index_column_ids =
+      GetColumnIDs(index->index_data_table()->columns());
 
-  // TODO: Use actions framework for index backfills.
   std::unique_ptr<StorageIterator> itr;
   ZETASQL_RETURN_IF_ERROR(context->storage()->Read(
       context->pending_commit_timestamp(), index->indexed_table()->id(),
-      KeyRange::All(), base_column_ids, &itr));
-
-  // List of index keys used for verifying index uniqueness.
-  std::set<Key> index_keys;
-  while (itr->Next()) {
+      key_range, base_column_ids, &itr));
+  int64_t num_rows = 0;
+  while (num_rows < max_rows && itr->Next()) {
+    ++num_rows;
+    if (last_key != nullptr) {
+      *last_key = itr->Key();
+    }
     std::vector<zetasql::Value> row_values;
     row_values.reserve(itr->NumColumns());
     for (int i = 0; i < itr->NumColumns(); ++i) {
@@ -74,33 +112,231 @@ absl::Status BackfillIndex(const Index* index,
     }
 
     // Compute the index key and column values.
-    Row base_row = MakeRow(base_columns, row_values);
-    // Backfill should return failed precondition error for invalid index keys.
-    ZETASQL_ASSIGN_OR_RETURN(Key index_data_table_key, ComputeIndexKey(base_row, index),
-                     _.SetErrorCode(absl::StatusCode::kFailedPrecondition));
-    ValueList index_values = ComputeIndexValues(base_row, index);
-    if (ShouldFilterIndexKey(index, index_data_table_key)) {
+    ZETASQL_RETURN_IF_ERROR(AddIndexEntry(index, index_column_ids,
+                                  MakeRow(base_columns, row_values), entries));
+  }
+  ZETASQL_RETURN_IF_ERROR(itr->Status());
+  return num_rows;
+}
+
+// Returns the key of the indexed table row of an entry of the data table of
+// index, which has a column for each key column of the indexed table.
+Key IndexedTableKey(const Index* index, const Key& index_data_table_key) {
+  absl::Span<const KeyColumn* const> index_data_table_key_columns =
+      index->index_data_table()->primary_key();
+  Key key;
+  for (const KeyColumn* key_column : index->indexed_table()->primary_key()) {
+    for (int i = 0; i < index_data_table_key_columns.size(); ++i) {
+      if (index_data_table_key_columns[i]->column()->source_column() ==
+          key_column->column()) {
+        key.AddColumn(index_data_table_key.ColumnValue(i),
+                      key_column->is_descending());
+        break;
+      }
+    }
+  }
+  return key;
+}
+
+// Returns a UniqueIndexViolationOnIndexCreation error if an index key has more
+// than one entry in the data table of index, among the entries of the rows of
+// the indexed table before scan_limit, if not null.
+//
+// Like a serial scan of the indexed table, the error is for the index key whose
+// second entry is of the first row in the key order of the indexed table,
+// rather than for the first index key in the key order of the index.
+absl::Status VerifyUniqueIndexKeys(const Index* index,
+                                   const SchemaValidationContext* context,
+                                   const Key* scan_limit) {
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_RETURN_IF_ERROR(context->storage()->Read(
+      context->pending_commit_timestamp(), index->index_data_table()->id(),
+      KeyRange::All(), /*column_ids=*/{}, &itr));
+  const int num_key_columns = index->key_columns().size();
+  std::optional<Key> previous_index_key;
+  bool previous_index_key_duplicated = false;
+  std::optional<Key> duplicated_index_key;
+  std::optional<Key> duplicated_row_key;
+  while (itr->Next()) {
+    // The entries of an index key are adjacent in the index data table, in the
+    // key order of their rows in the indexed table.
+    Key index_key = itr->Key().Prefix(num_key_columns);
+    if (!previous_index_key.has_value() ||
+        !(index_key == *previous_index_key)) {
+      previous_index_key = std::move(index_key);
+      previous_index_key_duplicated = false;
+      continue;
+    }
+    if (previous_index_key_duplicated) {
       continue;
     }
+    previous_index_key_duplicated = true;
+    Key row_key = IndexedTableKey(index, itr->Key());
+    if ((scan_limit == nullptr || row_key < *scan_limit) &&
+        (!duplicated_row_key.has_value() || row_key < *duplicated_row_key)) {
+      duplicated_index_key = std::move(index_key);
+      duplicated_row_key = std::move(row_key);
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(itr->Status());
+  if (duplicated_index_key.has_value()) {
+    return error::UniqueIndexViolationOnIndexCreation(
+        index->Name(), duplicated_index_key->DebugString());
+  }
+  return absl::OkStatus();
+}
 
-    // Check uniqueness constraints.
-    if (index->is_unique()) {
-      Key index_key = index_data_table_key.Prefix(index->key_columns().size());
-      if (index_keys.find(index_key) != index_keys.end()) {
-        return error::UniqueIndexViolationOnIndexCreation(
-            index->Name(), index_key.DebugString());
+// Writes the index entries of each batch of a scan of the indexed table as it
+// is consumed, so that they are not all held in memory at once, and then checks
+// the uniqueness of the index in the index data table.
+//
+// The reported error is the one a serial scan of the indexed table would find
+// first: a row for which no index entry can be computed only takes precedence
+// over a duplicate index key if it comes before the second row of the key.
+class IndexBackfillConsumer : public TableScanConsumer {
+ public:
+  IndexBackfillConsumer(const Index* index,
+                        const SchemaValidationContext* context)
+      : index_(index),
+        context_(context),
+        index_column_ids_(GetColumnIDs(index->index_data_table()->columns())) {}
+
+  const Table* table() const override { return index_->indexed_table(); }
+
+  void Start(absl::Span<const ColumnID> scan_columns,
+             int num_partitions) override {
+    base_column_indexes_.clear();
+    for (const Column* column : index_->indexed_table()->columns()) {
+      base_column_indexes_.push_back(ScanColumnIndex(column, scan_columns));
+    }
+    failed_row_keys_.assign(num_partitions, std::nullopt);
+  }
+
+  absl::Status Consume(int partition, TableScanBatch* batch) override {
+    absl::Span<const Column* const> base_columns =
+        index_->indexed_table()->columns();
+    const int num_rows = batch->keys.size();
+    std::vector<StorageWriteOp> entries;
+    entries.reserve(num_rows);
+    absl::Status status;
+    for (int row = 0; row < num_rows && status.ok(); ++row) {
+      std::vector<zetasql::Value> row_values;
+      row_values.reserve(base_columns.size());
+      for (int position : base_column_indexes_) {
+        row_values.push_back(batch->column_values[position][row]);
+      }
+      status = AddIndexEntry(index_, index_column_ids_,
+                             MakeRow(base_columns, row_values), &entries);
+      if (!status.ok()) {
+        failed_row_keys_[partition] = batch->keys[row];
       }
-      // Add key to current list of index keys.
-      index_keys.insert(index_key);
     }
 
-    // Insert the new row in the index.
-    ZETASQL_RETURN_IF_ERROR(context->storage()->Write(
-        context->pending_commit_timestamp(), index->index_data_table()->id(),
-        index_data_table_key, index_column_ids, index_values));
+    // The index data table is not read by the scan, so the entries can be
+    // written while the indexed table is still being scanned. The entries of
+    // the rows before a failed one are written too, so that Finish can find the
+    // duplicate index keys which a serial scan would have found before it.
+    ZETASQL_RETURN_IF_ERROR(context_->storage()->ApplyBatch(
+        context_->pending_commit_timestamp(), absl::MakeSpan(entries)));
+    return status;
   }
 
-  return absl::OkStatus();
+  absl::Status Finish(
+      absl::Span<const absl::Status> partition_statuses) override {
+    // Partitions are in key order, so the first failed one holds the first
+    // failed row. Errors which are not for a row, such as read errors, are
+    // returned as they are.
+    absl::Status row_status;
+    const Key* failed_row_key = nullptr;
+    for (int partition = 0; partition < partition_statuses.size();
+         ++partition) {
+      if (partition_statuses[partition].ok()) {
+        continue;
+      }
+      if (!failed_row_keys_[partition].has_value()) {
+        return partition_statuses[partition];
+      }
+      row_status = partition_statuses[partition];
+      failed_row_key = &*failed_row_keys_[partition];
+      break;
+    }
+    if (index_->is_unique()) {
+      ZETASQL_RETURN_IF_ERROR(
+          VerifyUniqueIndexKeys(index_, context_, failed_row_key));
+    }
+    return row_status;
+  }
+
+ private:
+  const Index* index_;
+  const SchemaValidationContext* context_;
+  std::vector<ColumnID> index_column_ids_;
+
+  // The position in the scan of each column of the indexed table.
+  std::vector<int> base_column_indexes_;
+
+  // The key of the row of each partition for which no index entry could be
+  // computed, if any. Each partition only sets its own element.
+  std::vector<std::optional<Key>> failed_row_keys_;
+};
+
+}  // namespace
+
+std::unique_ptr<TableScanConsumer> MakeIndexBackfillConsumer(
+    const Index* index, const SchemaValidationContext* context) {
+  return std::make_unique<IndexBackfillConsumer>(index, context);
+}
+
+absl::Status BackfillIndex(const Index* index,
+                           const SchemaValidationContext* context) {
+  // TODO: Use actions framework for index backfills.
+  return RunTableScanAction(context,
+                            MakeIndexBackfillConsumer(index, context).get());
+}
+
+absl::StatusOr<bool> BackfillIndexChunk(const Index* index,
+                                        const SchemaValidationContext* context,
+                                        int64_t max_rows, Key* start_key) {
+  std::vector<StorageWriteOp> entries;
+  Key last_key;
+  ZETASQL_ASSIGN_OR_RETURN(
+      int64_t num_rows,
+      ComputeIndexEntries(index, context,
+                          KeyRange::ClosedOpen(*start_key, Key::Infinity()),
+                          &entries, max_rows, &last_key));
+
+  // Writes since the index was created have maintained it, so a unique index
+  // may already hold entries which conflict with the new ones.
+  if (index->is_unique()) {
+    std::set<Key> index_keys;
+    for (const StorageWriteOp& entry : entries) {
+      Key index_key = entry.key.Prefix(index->key_columns().size());
+      std::unique_ptr<StorageIterator> itr;
+      ZETASQL_RETURN_IF_ERROR(context->storage()->Read(
+          context->pending_commit_timestamp(), index->index_data_table()->id(),
+          KeyRange::Prefix(index_key), /*column_ids=*/{}, &itr));
+      while (itr->Next()) {
+        if (!(itr->Key() == entry.key)) {
+          return error::UniqueIndexViolationOnIndexCreation(
+              index->Name(), index_key.DebugString());
+        }
+      }
+      ZETASQL_RETURN_IF_ERROR(itr->Status());
+      if (!index_keys.insert(std::move(index_key)).second) {
+        return error::UniqueIndexViolationOnIndexCreation(
+            index->Name(), entry.key.Prefix(index->key_columns().size())
+                               .DebugString());
+      }
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(context->storage()->ApplyBatch(
+      context->pending_commit_timestamp(), absl::MakeSpan(entries)));
+
+  if (num_rows < max_rows) {
+    return true;
+  }
+  *start_key = last_key.ToPrefixLimit();
+  return false;
 }
 
 }  // namespace backend
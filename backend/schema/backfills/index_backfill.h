@@ -17,6 +17,12 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_UPDATER_BACKFILL_BACKFILL_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_UPDATER_BACKFILL_BACKFILL_H_
 
+#include <cstdint>
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "backend/datamodel/key.h"
+#include "backend/schema/backfills/table_scan.h"
 #include "backend/schema/catalog/index.h"
 #include "backend/schema/updater/schema_validation_context.h"
 #include "absl/status/status.h"
@@ -30,6 +36,21 @@ namespace backend {
 absl::Status BackfillIndex(const Index* index,
                            const SchemaValidationContext* context);
 
+// Returns a consumer which backfills index from a scan of its indexed table,
+// which may be shared with other schema change actions.
+std::unique_ptr<TableScanConsumer> MakeIndexBackfillConsumer(
+    const Index* index, const SchemaValidationContext* context);
+
+// Backfills the entries of at most max_rows rows of the indexed table,
+// starting with the row at *start_key, for an index which writes have been
+// maintaining since it was created. Returns true once the last row has been
+// backfilled, otherwise advances *start_key past the backfilled rows. Callers
+// must hold the database lock for the pending commit timestamp of context, so
+// that no write interleaves with the chunk.
+absl::StatusOr<bool> BackfillIndexChunk(const Index* index,
+                                        const SchemaValidationContext* context,
+                                        int64_t max_rows, Key* start_key);
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
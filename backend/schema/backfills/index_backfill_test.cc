@@ -24,12 +24,14 @@
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/span.h"
 #include "backend/database/database.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/updater/schema_updater.h"
 #include "backend/transaction/options.h"
 #include "common/errors.h"
+#include "common/limits.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
@@ -58,6 +60,18 @@ class BackfillTest : public ::testing::Test {
     return backfill_status;
   }
 
+  // Inserts rows of (int64_col, string_col) into TestTable.
+  absl::Status InsertRows(const std::vector<ValueList>& rows) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ReadWriteTransaction> txn,
+                     database_->CreateReadWriteTransaction(ReadWriteOptions(),
+                                                           RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "TestTable",
+                 {"int64_col", "string_col"}, rows);
+    ZETASQL_RETURN_IF_ERROR(txn->Write(m));
+    return txn->Commit();
+  }
+
  protected:
   void SetUp() override {
     std::vector<std::string> create_statements = {R"(
@@ -87,6 +101,23 @@ class BackfillTest : public ::testing::Test {
   std::vector<std::string> index_update_statements_;
 };
 
+// Returns enough rows for the scan to be partitioned, where the rows at
+// duplicate_row and duplicate_row + 1 have the same index key, and the row at
+// too_large_row has an index key which exceeds the key size limit.
+std::vector<ValueList> RowsWithErrors(int duplicate_row, int too_large_row) {
+  constexpr int kNumRows = 10000;
+  std::vector<ValueList> rows;
+  for (int i = 0; i < kNumRows; ++i) {
+    std::string value =
+        absl::StrCat("value", i == duplicate_row + 1 ? duplicate_row : i);
+    if (i == too_large_row) {
+      value = std::string(limits::kMaxKeySizeBytes + 1, 'a');
+    }
+    rows.push_back({Int64(i), String(value)});
+  }
+  return rows;
+}
+
 TEST_F(BackfillTest, BackfillIndex) {
   {
     ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadWriteTransaction> txn,
@@ -301,6 +332,62 @@ TEST_F(BackfillTest, BackfillUniqueIndex) {
                 "TestIndex", R"({String("value")↓})"));
 }
 
+TEST_F(BackfillTest, BackfillUniqueIndexOfManyRows) {
+  // Enough rows for the scan to be partitioned, where the first and last rows
+  // have the same index key.
+  constexpr int kNumRows = 10000;
+  std::vector<ValueList> rows;
+  for (int i = 0; i < kNumRows; ++i) {
+    const int value = i < kNumRows - 1 ? i : 0;
+    rows.push_back({Int64(i), String(absl::StrCat("value", value))});
+  }
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadWriteTransaction> txn,
+                         database_->CreateReadWriteTransaction(
+                             ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "TestTable",
+                 {"int64_col", "string_col"}, rows);
+    ZETASQL_EXPECT_OK(txn->Write(m));
+    ZETASQL_EXPECT_OK(txn->Commit());
+  }
+
+  EXPECT_EQ(UpdateSchema(index_update_statements_),
+            error::UniqueIndexViolationOnIndexCreation(
+                "TestIndex", R"({String("value0")↓})"));
+}
+
+TEST_F(BackfillTest, BackfillUniqueIndexReportsFirstDuplicateInTableOrder) {
+  // The second row of "value1" comes before the second row of "value2" in the
+  // table, although "value2" comes first in the descending index.
+  ZETASQL_ASSERT_OK(InsertRows({{Int64(1), String("value2")},
+                        {Int64(2), String("value1")},
+                        {Int64(3), String("value1")},
+                        {Int64(4), String("value2")}}));
+
+  EXPECT_EQ(UpdateSchema(index_update_statements_),
+            error::UniqueIndexViolationOnIndexCreation(
+                "TestIndex", R"({String("value1")↓})"));
+}
+
+TEST_F(BackfillTest, BackfillUniqueIndexReportsDuplicateBeforeTooLargeKey) {
+  ZETASQL_ASSERT_OK(InsertRows(RowsWithErrors(/*duplicate_row=*/0,
+                                      /*too_large_row=*/9999)));
+
+  EXPECT_EQ(UpdateSchema(index_update_statements_),
+            error::UniqueIndexViolationOnIndexCreation(
+                "TestIndex", R"({String("value0")↓})"));
+}
+
+TEST_F(BackfillTest, BackfillUniqueIndexReportsTooLargeKeyBeforeDuplicate) {
+  ZETASQL_ASSERT_OK(InsertRows(RowsWithErrors(/*duplicate_row=*/9998,
+                                      /*too_large_row=*/0)));
+
+  EXPECT_THAT(UpdateSchema(index_update_statements_),
+              zetasql_base::testing::StatusIs(
+                  absl::StatusCode::kFailedPrecondition));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -0,0 +1,155 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/schema/backfills/table_scan.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/actions/batch_expression.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/partitioned_scan.h"
+#include "absl/status/status.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+std::vector<std::string> ScanColumnNames(
+    const Table* table, absl::Span<const ColumnID> scan_columns) {
+  std::vector<std::string> names(scan_columns.size());
+  for (const Column* column : table->columns()) {
+    int index = ScanColumnIndex(column, scan_columns);
+    if (index >= 0) {
+      names[index] = column->Name();
+    }
+  }
+  return names;
+}
+
+int ScanColumnIndex(const Column* column,
+                    absl::Span<const ColumnID> scan_columns) {
+  for (int i = 0; i < scan_columns.size(); ++i) {
+    if (scan_columns[i] == column->id()) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+absl::StatusOr<std::vector<std::vector<absl::Status>>> ScanTable(
+    const Storage* storage, absl::Time timestamp,
+    absl::Span<TableScanConsumer* const> consumers) {
+  ZETASQL_RET_CHECK(!consumers.empty());
+  const TableID table_id = consumers[0]->table()->id();
+
+  // Consumers from different statements of a schema change see different
+  // versions of the table, so the scan reads the columns of all of them.
+  std::vector<ColumnID> column_ids;
+  std::vector<const zetasql::Type*> column_types;
+  absl::flat_hash_set<ColumnID> scanned_columns;
+  for (TableScanConsumer* consumer : consumers) {
+    ZETASQL_RET_CHECK_EQ(consumer->table()->id(), table_id);
+    for (const Column* column : consumer->table()->columns()) {
+      if (scanned_columns.insert(column->id()).second) {
+        column_ids.push_back(column->id());
+        column_types.push_back(column->GetType());
+      }
+    }
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<KeyRange> partitions,
+                   PartitionTableScan(storage, timestamp, table_id));
+  for (TableScanConsumer* consumer : consumers) {
+    consumer->Start(column_ids, partitions.size());
+  }
+  std::vector<std::vector<absl::Status>> statuses(
+      consumers.size(), std::vector<absl::Status>(partitions.size()));
+  ZETASQL_RETURN_IF_ERROR(ScanPartitionsInParallel(
+      partitions, [&](int i, const KeyRange& key_range) {
+        TableScanBatch batch;
+        batch.column_values.resize(column_ids.size());
+        auto consume_batch = [&]() {
+          for (int c = 0; c < consumers.size(); ++c) {
+            if (statuses[c][i].ok()) {
+              statuses[c][i] = consumers[c]->Consume(i, &batch);
+            }
+          }
+          for (std::vector<zetasql::Value>& values : batch.column_values) {
+            values.clear();
+          }
+          batch.keys.clear();
+        };
+
+        std::unique_ptr<StorageIterator> itr;
+        absl::Status status =
+            storage->Read(timestamp, table_id, key_range, column_ids, &itr);
+        if (status.ok()) {
+          while (itr->Next()) {
+            for (int j = 0; j < itr->NumColumns(); ++j) {
+              // Storage returns invalid values if a value is not present, in
+              // which case we convert it into a typed NULL.
+              batch.column_values[j].push_back(
+                  itr->ColumnValue(j).is_valid()
+                      ? itr->ColumnValue(j)
+                      : zetasql::Value::Null(column_types[j]));
+            }
+            batch.keys.push_back(itr->Key());
+            if (batch.keys.size() == BatchExpression::kScanBatchSize) {
+              consume_batch();
+            }
+          }
+          status = itr->Status();
+        }
+        if (status.ok() && !batch.keys.empty()) {
+          consume_batch();
+        }
+        for (int c = 0; c < consumers.size(); ++c) {
+          if (statuses[c][i].ok()) {
+            statuses[c][i] = status;
+          }
+        }
+        return absl::OkStatus();
+      }));
+  return statuses;
+}
+
+absl::Status RunTableScanAction(const SchemaValidationContext* context,
+                                TableScanConsumer* consumer) {
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::vector<std::vector<absl::Status>> statuses,
+      ScanTable(context->storage(), context->pending_commit_timestamp(),
+                {consumer}));
+  return consumer->Finish(statuses[0]);
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_BACKFILLS_TABLE_SCAN_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_BACKFILLS_TABLE_SCAN_H_
+
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/updater/schema_validation_context.h"
+#include "backend/storage/storage.h"
+#include "absl/status/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// A batch of consecutive rows read by a table scan, in key order. The values
+// are held in column-major order, in the order of the columns of the scan. A
+// column without a value in a row holds a NULL of the column's type.
+struct TableScanBatch {
+  std::vector<Key> keys;
+  std::vector<std::vector<zetasql::Value>> column_values;
+};
+
+// A schema change action which reads every row of a table, such as an index
+// backfill or a check constraint verification. Several consumers of the same
+// table can then share a single scan of it (see ScanTable).
+class TableScanConsumer {
+ public:
+  virtual ~TableScanConsumer() = default;
+
+  // Returns the table whose rows are consumed.
+  virtual const Table* table() const = 0;
+
+  // Called before the scan starts with the IDs of the columns which it reads,
+  // which include the columns of table(), and the number of partitions which
+  // the scan is split into.
+  virtual void Start(absl::Span<const ColumnID> scan_columns,
+                     int num_partitions) = 0;
+
+  // Consumes the next batch of rows of the given partition. Partitions are
+  // scanned in parallel, but the batches of each are consumed in key order.
+  // The consumer may replace the values of a column which it is backfilling,
+  // so that consumers after it see the backfilled values. Once this returns an
+  // error, the consumer is passed no more batches of the partition.
+  virtual absl::Status Consume(int partition, TableScanBatch* batch) = 0;
+
+  // Completes the action after the scan, given the status with which the
+  // consumer finished each partition, and applies any writes. The scanned
+  // table is not modified until this is called, but Consume may write to
+  // tables which the scan does not read, such as the data table of an index.
+  virtual absl::Status Finish(
+      absl::Span<const absl::Status> partition_statuses) = 0;
+};
+
+// Returns the names of the columns of table which are read by a scan of
+// scan_columns, for binding expressions over a batch of the scan. Columns
+// which are not in table have an empty name, which binds to no column.
+std::vector<std::string> ScanColumnNames(
+    const Table* table, absl::Span<const ColumnID> scan_columns);
+
+// Returns the position of column in scan_columns, or -1 if it is not read.
+int ScanColumnIndex(const Column* column,
+                    absl::Span<const ColumnID> scan_columns);
+
+// Reads every row of the table of consumers, which must all be the same table,
+// at timestamp with a single parallel scan, and passes each batch of rows to
+// every consumer in order. Consumers are not finished. Returns the status with
+// which each consumer finished each partition, indexed by consumer and then
+// partition. A read error is reported for every consumer.
+absl::StatusOr<std::vector<std::vector<absl::Status>>> ScanTable(
+    const Storage* storage, absl::Time timestamp,
+    absl::Span<TableScanConsumer* const> consumers);
+
+// Runs the action of a single consumer, scanning its table on its own.
+absl::Status RunTableScanAction(const SchemaValidationContext* context,
+                                TableScanConsumer* consumer);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_BACKFILLS_TABLE_SCAN_H_
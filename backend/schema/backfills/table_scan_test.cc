@@ -0,0 +1,145 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/schema/backfills/table_scan.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "backend/database/database.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/updater/schema_updater.h"
+#include "backend/transaction/options.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+using ::testing::ElementsAre;
+using ::zetasql_base::testing::StatusIs;
+
+class SharedTableScanTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::vector<std::string> create_statements = {R"(
+                            CREATE TABLE TestTable (
+                              int64_col INT64,
+                              string_col STRING(MAX)
+                            ) PRIMARY KEY (int64_col)
+                          )"};
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        database_,
+        Database::Create(
+            &clock_, SchemaChangeOperation{.statements = create_statements}));
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadWriteTransaction> txn,
+                         database_->CreateReadWriteTransaction(
+                             ReadWriteOptions(), RetryState()));
+    Mutation m;
+    m.AddWriteOp(MutationOpType::kInsert, "TestTable",
+                 {"int64_col", "string_col"},
+                 {{Int64(1), String("b")}, {Int64(2), String("a")}});
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+
+  absl::Status UpdateSchema(absl::Span<const std::string> update_statements,
+                            int* num_successful) {
+    absl::Status backfill_status;
+    absl::Time update_time;
+    ZETASQL_RETURN_IF_ERROR(database_->UpdateSchema(
+        SchemaChangeOperation{.statements = update_statements}, num_successful,
+        &update_time, &backfill_status));
+    return backfill_status;
+  }
+
+  std::vector<zetasql::Value> ReadIndex(const std::string& index,
+                                          std::vector<std::string> columns) {
+    std::unique_ptr<ReadOnlyTransaction> txn =
+        database_->CreateReadOnlyTransaction(ReadOnlyOptions()).value();
+    std::unique_ptr<RowCursor> cursor;
+    ReadArg read_arg;
+    read_arg.table = "TestTable";
+    read_arg.index = index;
+    read_arg.columns = std::move(columns);
+    read_arg.key_set = KeySet::All();
+    EXPECT_TRUE(txn->Read(read_arg, &cursor).ok());
+    std::vector<zetasql::Value> values;
+    while (cursor->Next()) {
+      for (int i = 0; i < cursor->NumColumns(); ++i) {
+        values.push_back(cursor->ColumnValue(i));
+      }
+    }
+    return values;
+  }
+
+  Clock clock_;
+  std::unique_ptr<Database> database_;
+};
+
+TEST_F(SharedTableScanTest, BackfillsEveryActionOfBatch) {
+  int num_successful = 0;
+  ZETASQL_EXPECT_OK(UpdateSchema(
+      {"CREATE INDEX StringIndex ON TestTable(string_col)",
+       "ALTER TABLE TestTable ADD COLUMN upper_col STRING(MAX) "
+       "AS (UPPER(string_col)) STORED",
+       "CREATE INDEX UpperIndex ON TestTable(upper_col)",
+       "ALTER TABLE TestTable ADD CONSTRAINT Positive CHECK (int64_col > 0)"},
+      &num_successful));
+  EXPECT_EQ(num_successful, 4);
+
+  EXPECT_THAT(ReadIndex("StringIndex", {"string_col", "int64_col"}),
+              ElementsAre(String("a"), Int64(2), String("b"), Int64(1)));
+  // The index on the generated column sees the values backfilled earlier in
+  // the same scan.
+  EXPECT_THAT(ReadIndex("UpperIndex", {"upper_col", "int64_col"}),
+              ElementsAre(String("A"), Int64(2), String("B"), Int64(1)));
+}
+
+TEST_F(SharedTableScanTest, FailingActionStopsAtItsStatement) {
+  int num_successful = 0;
+  EXPECT_THAT(
+      UpdateSchema(
+          {"CREATE INDEX StringIndex ON TestTable(string_col)",
+           "ALTER TABLE TestTable ADD CONSTRAINT Big CHECK (int64_col > 1)",
+           "CREATE INDEX AnotherIndex ON TestTable(int64_col, string_col)"},
+          &num_successful),
+      StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_EQ(num_successful, 1);
+
+  // The statement before the failed one was applied.
+  EXPECT_THAT(ReadIndex("StringIndex", {"string_col", "int64_col"}),
+              ElementsAre(String("a"), Int64(2), String("b"), Int64(1)));
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -79,6 +79,11 @@ class Index::Builder {
     return *this;
   }
 
+  Builder& set_write_only(bool write_only) {
+    instance_->is_write_only_ = write_only;
+    return *this;
+  }
+
   Builder& add_managing_node(const SchemaNode* node) {
     instance_->managing_nodes_.push_back(node);
     return *this;
@@ -105,6 +110,11 @@ class Index::Editor {
     return *this;
   }
 
+  Editor& set_write_only(bool write_only) {
+    instance_->is_write_only_ = write_only;
+    return *this;
+  }
+
  private:
   // Not owned.
   Index* instance_;
@@ -95,6 +95,10 @@ class Index : public SchemaNode {
   // Returns true if null filtering is enabled for this index.
   bool is_null_filtered() const { return is_null_filtered_; }
 
+  // Returns true if the index is being backfilled online. Writes maintain a
+  // write-only index, but it cannot be read from.
+  bool is_write_only() const { return is_write_only_; }
+
   // Returns true if this index is managed by other schema nodes. Managed
   // indexes are regular indexes except for their lifecycles. Users cannot
   // create, alter or drop managed indexes.
@@ -182,6 +186,9 @@ class Index : public SchemaNode {
 
   // Whether NULL value results should be filtered out.
   bool is_null_filtered_ = false;
+
+  // Whether the index is still being backfilled, see is_write_only().
+  bool is_write_only_ = false;
 };
 
 }  // namespace backend
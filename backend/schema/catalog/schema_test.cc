@@ -728,6 +728,20 @@ TEST_F(SchemaTest, PrintDDLStatementsTestStoredIndex) {
 ) PRIMARY KEY(col1))",
                   "CREATE INDEX col2_idx ON T(col2) STORING (col3, col4)")));
 }
+
+TEST_F(SchemaTest, DDLStatementCachePrintsEachSchema) {
+  std::unique_ptr<const Schema> one_table =
+      test::CreateSchemaWithOneTable(type_factory_.get());
+  std::unique_ptr<const Schema> interleaved =
+      test::CreateSchemaWithInterleaving(type_factory_.get());
+  DDLStatementCache cache;
+  for (const Schema* schema :
+       {one_table.get(), one_table.get(), interleaved.get(), one_table.get()}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<std::string> expected,
+                         PrintDDLStatements(schema));
+    EXPECT_THAT(cache.PrintDDLStatements(schema), IsOkAndHolds(expected));
+  }
+}
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -0,0 +1,249 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/schema/catalog/table_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/numeric/bits.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// The number of buckets of the histograms of key columns.
+constexpr int kHistogramBuckets = 32;
+
+// Spreads the bits of hash over all bits of the result, as the finalizer of
+// MurmurHash3 does. Value::HashCode is not uniformly distributed for every
+// type, e.g. it may be the value itself for integers.
+uint64_t MixHash(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+bool ValueLess(const zetasql::Value& a, const zetasql::Value& b) {
+  return a.LessThan(b);
+}
+
+}  // namespace
+
+void DistinctValueCounter::Add(const zetasql::Value& value) {
+  const uint64_t hash = MixHash(value.HashCode());
+  const int index = hash >> (64 - kPrecision);
+  const uint64_t rest = hash << kPrecision;
+  const int rank =
+      rest == 0 ? 64 - kPrecision + 1 : absl::countl_zero(rest) + 1;
+  registers_[index] = std::max<uint8_t>(registers_[index], rank);
+}
+
+void DistinctValueCounter::Merge(const DistinctValueCounter& other) {
+  for (int i = 0; i < kNumRegisters; ++i) {
+    registers_[i] = std::max(registers_[i], other.registers_[i]);
+  }
+}
+
+double DistinctValueCounter::Estimate() const {
+  constexpr double m = kNumRegisters;
+  double sum = 0;
+  int zero_registers = 0;
+  for (uint8_t rank : registers_) {
+    sum += std::ldexp(1.0, -rank);
+    if (rank == 0) {
+      ++zero_registers;
+    }
+  }
+  const double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  // Small cardinalities are estimated better from the number of registers
+  // which no value selected.
+  if (estimate <= 2.5 * m && zero_registers > 0) {
+    return m * std::log(m / zero_registers);
+  }
+  return estimate;
+}
+
+void DatabaseStatistics::CopyFrom(const DatabaseStatistics& other) {
+  if (&other == this) {
+    return;
+  }
+  absl::flat_hash_map<TableID, TableStatistics> tables;
+  {
+    absl::ReaderMutexLock lock(&other.mu_);
+    tables = other.tables_;
+  }
+  absl::MutexLock lock(&mu_);
+  tables_ = std::move(tables);
+}
+
+void DatabaseStatistics::Set(const TableID& table_id,
+                             TableStatistics statistics) {
+  absl::MutexLock lock(&mu_);
+  tables_[table_id] = std::move(statistics);
+}
+
+void DatabaseStatistics::Erase(const TableID& table_id) {
+  absl::MutexLock lock(&mu_);
+  tables_.erase(table_id);
+}
+
+void DatabaseStatistics::Clear() {
+  absl::MutexLock lock(&mu_);
+  tables_.clear();
+}
+
+void DatabaseStatistics::RecordWrite(const TableID& table_id,
+                                     absl::Span<const ColumnID> column_ids,
+                                     absl::Span<const zetasql::Value> values,
+                                     int64_t row_count_delta) {
+  absl::MutexLock lock(&mu_);
+  auto it = tables_.find(table_id);
+  if (it == tables_.end()) {
+    return;
+  }
+  TableStatistics& table = it->second;
+  table.row_count = std::max<int64_t>(0, table.row_count + row_count_delta);
+  for (int i = 0; i < column_ids.size() && i < values.size(); ++i) {
+    table.columns[column_ids[i]].distinct_values.Add(values[i]);
+  }
+}
+
+std::optional<int64_t> DatabaseStatistics::RowCount(
+    const TableID& table_id) const {
+  absl::ReaderMutexLock lock(&mu_);
+  auto it = tables_.find(table_id);
+  if (it == tables_.end()) {
+    return std::nullopt;
+  }
+  return it->second.row_count;
+}
+
+std::optional<double> DatabaseStatistics::DistinctValues(
+    const TableID& table_id, const ColumnID& column_id) const {
+  absl::ReaderMutexLock lock(&mu_);
+  const ColumnStatistics* column = FindColumn(table_id, column_id);
+  if (column == nullptr) {
+    return std::nullopt;
+  }
+  return column->distinct_values.Estimate();
+}
+
+std::optional<double> DatabaseStatistics::RangeFraction(
+    const TableID& table_id, const ColumnID& column_id,
+    const zetasql::Value* start, const zetasql::Value* limit) const {
+  absl::ReaderMutexLock lock(&mu_);
+  const ColumnStatistics* column = FindColumn(table_id, column_id);
+  if (column == nullptr || column->histogram_bounds.size() < 2) {
+    return std::nullopt;
+  }
+
+  // Counts the buckets which overlap the range, each of which holds about the
+  // same fraction of the rows.
+  const std::vector<zetasql::Value>& bounds = column->histogram_bounds;
+  const int num_buckets = bounds.size() - 1;
+  int overlapping = 0;
+  for (int i = 0; i < num_buckets; ++i) {
+    if (start != nullptr && bounds[i + 1].LessThan(*start)) {
+      continue;
+    }
+    if (limit != nullptr && limit->LessThan(bounds[i])) {
+      continue;
+    }
+    ++overlapping;
+  }
+  return static_cast<double>(std::max(overlapping, 1)) / num_buckets;
+}
+
+std::vector<zetasql::Value> DatabaseStatistics::HistogramBounds(
+    const TableID& table_id, const ColumnID& column_id) const {
+  absl::ReaderMutexLock lock(&mu_);
+  const ColumnStatistics* column = FindColumn(table_id, column_id);
+  if (column == nullptr) {
+    return {};
+  }
+  return column->histogram_bounds;
+}
+
+const ColumnStatistics* DatabaseStatistics::FindColumn(
+    const TableID& table_id, const ColumnID& column_id) const {
+  auto table = tables_.find(table_id);
+  if (table == tables_.end()) {
+    return nullptr;
+  }
+  auto column = table->second.columns.find(column_id);
+  return column == table->second.columns.end() ? nullptr : &column->second;
+}
+
+TableStatisticsBuilder::TableStatisticsBuilder(std::vector<ColumnID> column_ids,
+                                               int num_key_columns)
+    : column_ids_(std::move(column_ids)),
+      key_values_(std::min<int>(num_key_columns, column_ids_.size())) {
+  for (const ColumnID& column_id : column_ids_) {
+    statistics_.columns[column_id];
+  }
+}
+
+void TableStatisticsBuilder::AddRow(absl::Span<const zetasql::Value> values) {
+  ++statistics_.row_count;
+  for (int i = 0; i < column_ids_.size() && i < values.size(); ++i) {
+    ColumnStatistics& column = statistics_.columns[column_ids_[i]];
+    column.distinct_values.Add(values[i]);
+    if (i < key_values_.size()) {
+      key_values_[i].push_back(values[i]);
+    }
+  }
+}
+
+TableStatistics TableStatisticsBuilder::Build() && {
+  for (int i = 0; i < key_values_.size(); ++i) {
+    std::vector<zetasql::Value>& values = key_values_[i];
+    if (values.empty()) {
+      continue;
+    }
+    std::sort(values.begin(), values.end(), ValueLess);
+    std::vector<zetasql::Value>& bounds =
+        statistics_.columns[column_ids_[i]].histogram_bounds;
+    const int num_buckets =
+        std::min<int64_t>(kHistogramBuckets, values.size());
+    for (int b = 0; b <= num_buckets; ++b) {
+      const size_t position =
+          std::min(values.size() - 1, values.size() * b / num_buckets);
+      bounds.push_back(values[position]);
+    }
+  }
+  return std::move(statistics_);
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
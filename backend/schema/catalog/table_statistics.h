@@ -0,0 +1,165 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_TABLE_STATISTICS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_TABLE_STATISTICS_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Estimates the number of distinct values added to it, using HyperLogLog with
+// a fixed number of registers. Values may be added any number of times.
+class DistinctValueCounter {
+ public:
+  void Add(const zetasql::Value& value);
+
+  // Adds the values counted by other to this counter.
+  void Merge(const DistinctValueCounter& other);
+
+  // Returns the estimated number of distinct values added so far.
+  double Estimate() const;
+
+ private:
+  // The number of leading hash bits which select a register.
+  static constexpr int kPrecision = 10;
+  static constexpr int kNumRegisters = 1 << kPrecision;
+
+  // The longest run of leading zero bits plus one seen in the rest of the
+  // hashes which selected each register.
+  std::array<uint8_t, kNumRegisters> registers_{};
+};
+
+// Statistics of the values of a column of a table.
+struct ColumnStatistics {
+  DistinctValueCounter distinct_values;
+
+  // Bounds of an equi-depth histogram of the values of the column, in
+  // ascending order: about the same number of rows have a value between each
+  // pair of consecutive bounds. Only built for key columns, by a full scan of
+  // the table, and not updated by later writes.
+  std::vector<zetasql::Value> histogram_bounds;
+};
+
+// Statistics of the rows of a table or index data table, used by the query
+// planner to estimate how many rows a scan returns.
+struct TableStatistics {
+  int64_t row_count = 0;
+
+  absl::flat_hash_map<ColumnID, ColumnStatistics> columns;
+};
+
+// Statistics of the tables of a database.
+//
+// The statistics of a table are built by a full scan of it, on ANALYZE or when
+// the table is created, and then kept up to date with committed writes. Since
+// deleted values are not removed from the distinct value counters, estimates
+// of distinct values may be too high until the next ANALYZE. Writes which
+// bypass the commit path must Erase the statistics of the tables they change.
+// DatabaseStatistics is thread-safe.
+class DatabaseStatistics {
+ public:
+  // Replaces the statistics of every table with a copy of those in other.
+  void CopyFrom(const DatabaseStatistics& other) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Replaces the statistics of the table.
+  void Set(const TableID& table_id, TableStatistics statistics)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Discards the statistics of the table, or of every table.
+  void Erase(const TableID& table_id) ABSL_LOCKS_EXCLUDED(mu_);
+  void Clear() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Updates the statistics of the table, if it has any, for a committed write
+  // of the given column values which changed its number of rows by
+  // row_count_delta: 1 if the write added a row, -1 if it removed one, and 0
+  // otherwise.
+  void RecordWrite(const TableID& table_id,
+                   absl::Span<const ColumnID> column_ids,
+                   absl::Span<const zetasql::Value> values,
+                   int64_t row_count_delta) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the estimated number of rows of the table, or nullopt if it has
+  // no statistics.
+  std::optional<int64_t> RowCount(const TableID& table_id) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the estimated number of distinct values of the column, or nullopt
+  // if it has no statistics.
+  std::optional<double> DistinctValues(const TableID& table_id,
+                                       const ColumnID& column_id) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the estimated fraction of the rows of the table whose value of the
+  // column lies between start and limit, either of which may be null to leave
+  // that side unbounded. Returns nullopt if the column has no histogram.
+  std::optional<double> RangeFraction(const TableID& table_id,
+                                      const ColumnID& column_id,
+                                      const zetasql::Value* start,
+                                      const zetasql::Value* limit) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the bounds of the histogram of the column (see ColumnStatistics),
+  // or an empty vector if it has none.
+  std::vector<zetasql::Value> HistogramBounds(const TableID& table_id,
+                                              const ColumnID& column_id) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  const ColumnStatistics* FindColumn(const TableID& table_id,
+                                     const ColumnID& column_id) const
+      ABSL_SHARED_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<TableID, TableStatistics> tables_ ABSL_GUARDED_BY(mu_);
+};
+
+// Builds the statistics of a table from its rows, as returned by calls to
+// AddRow with the values of every column in column_ids. Histograms are built
+// for the first num_key_columns columns.
+class TableStatisticsBuilder {
+ public:
+  TableStatisticsBuilder(std::vector<ColumnID> column_ids, int num_key_columns);
+
+  void AddRow(absl::Span<const zetasql::Value> values);
+
+  TableStatistics Build() &&;
+
+ private:
+  std::vector<ColumnID> column_ids_;
+  TableStatistics statistics_;
+  std::vector<std::vector<zetasql::Value>> key_values_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_TABLE_STATISTICS_H_
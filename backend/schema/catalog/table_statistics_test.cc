@@ -0,0 +1,108 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/schema/catalog/table_statistics.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::testing::DoubleNear;
+using ::testing::Optional;
+using zetasql::values::Int64;
+using zetasql::values::NullInt64;
+
+TEST(DistinctValueCounterTest, EstimatesNumberOfDistinctValues) {
+  DistinctValueCounter small;
+  for (int repeat = 0; repeat < 3; ++repeat) {
+    for (int i = 0; i < 20; ++i) {
+      small.Add(Int64(i));
+    }
+  }
+  EXPECT_NEAR(small.Estimate(), 20, 1);
+
+  DistinctValueCounter large;
+  DistinctValueCounter other;
+  for (int i = 0; i < 100000; ++i) {
+    (i % 2 == 0 ? large : other).Add(Int64(i));
+  }
+  large.Merge(other);
+  EXPECT_NEAR(large.Estimate(), 100000, 100000 * 0.1);
+}
+
+TEST(DatabaseStatisticsTest, BuildsStatisticsFromRows) {
+  TableStatisticsBuilder builder({"k", "v"}, /*num_key_columns=*/1);
+  for (int i = 0; i < 1000; ++i) {
+    builder.AddRow({Int64(i), i % 10 == 0 ? NullInt64() : Int64(i % 4)});
+  }
+  DatabaseStatistics statistics;
+  statistics.Set("t", std::move(builder).Build());
+
+  EXPECT_THAT(statistics.RowCount("t"), Optional(1000));
+  EXPECT_THAT(statistics.DistinctValues("t", "k"),
+              Optional(DoubleNear(1000, 100)));
+  EXPECT_THAT(statistics.DistinctValues("t", "v"),
+              Optional(DoubleNear(5, 1)));
+  EXPECT_EQ(statistics.RowCount("u"), std::nullopt);
+  EXPECT_EQ(statistics.DistinctValues("t", "w"), std::nullopt);
+
+  // Only key columns have histograms.
+  const zetasql::Value start = Int64(0);
+  const zetasql::Value limit = Int64(249);
+  EXPECT_THAT(statistics.RangeFraction("t", "k", &start, &limit),
+              Optional(DoubleNear(0.25, 0.05)));
+  EXPECT_THAT(statistics.RangeFraction("t", "k", &limit, nullptr),
+              Optional(DoubleNear(0.75, 0.05)));
+  EXPECT_EQ(statistics.RangeFraction("t", "v", &start, &limit), std::nullopt);
+}
+
+TEST(DatabaseStatisticsTest, RecordsWritesToTablesWithStatistics) {
+  DatabaseStatistics statistics;
+  statistics.Set("t", TableStatisticsBuilder({"k"}, 1).Build());
+  for (int i = 0; i < 10; ++i) {
+    statistics.RecordWrite("t", {"k"}, {Int64(i)}, /*row_count_delta=*/1);
+    statistics.RecordWrite("u", {"k"}, {Int64(i)}, /*row_count_delta=*/1);
+  }
+  statistics.RecordWrite("t", {}, {}, /*row_count_delta=*/-1);
+  EXPECT_THAT(statistics.RowCount("t"), Optional(9));
+  EXPECT_THAT(statistics.DistinctValues("t", "k"),
+              Optional(DoubleNear(10, 1)));
+  EXPECT_EQ(statistics.RowCount("u"), std::nullopt);
+
+  DatabaseStatistics copy;
+  copy.CopyFrom(statistics);
+  statistics.Erase("t");
+  EXPECT_EQ(statistics.RowCount("t"), std::nullopt);
+  EXPECT_THAT(copy.RowCount("t"), Optional(9));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -16,8 +16,10 @@
 
 #include "backend/schema/catalog/versioned_catalog.h"
 
+#include <iterator>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
@@ -30,37 +32,104 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
-VersionedCatalog::VersionedCatalog() {
-  schemas_[absl::InfinitePast()] = std::make_unique<const Schema>();
-}
+VersionedCatalog::VersionedCatalog()
+    : VersionedCatalog(std::make_shared<const Schema>()) {}
 
 VersionedCatalog::VersionedCatalog(
-    std::unique_ptr<const Schema> initial_schema) {
-  schemas_[absl::InfinitePast()] = std::move(initial_schema);
+    std::shared_ptr<const Schema> initial_schema) {
+  absl::MutexLock lock(&mu_);
+  auto [itr, inserted] =
+      schemas_.emplace(absl::InfinitePast(), std::move(initial_schema));
+  data_versions_[itr->second.get()] = 0;
+  latest_.store(&*itr, std::memory_order_release);
 }
 
 const Schema* VersionedCatalog::GetSchema(absl::Time timestamp) const {
+  const SchemaMap::value_type* latest = latest_.load(std::memory_order_acquire);
+  if (timestamp >= latest->first) {
+    return latest->second.get();
+  }
   absl::MutexLock lock(&mu_);
   auto itr = schemas_.upper_bound(timestamp);
-  itr--;
+  if (itr != schemas_.begin()) {
+    itr--;
+  }
   return itr->second.get();
 }
 
+std::shared_ptr<const Schema> VersionedCatalog::GetSchemaRef(
+    absl::Time timestamp) const {
+  absl::MutexLock lock(&mu_);
+  auto itr = schemas_.upper_bound(timestamp);
+  if (itr != schemas_.begin()) {
+    itr--;
+  }
+  return itr->second;
+}
+
 const Schema* VersionedCatalog::GetLatestSchema() const {
-  return GetSchema(absl::InfiniteFuture());
+  return latest_.load(std::memory_order_acquire)->second.get();
 }
 
 absl::Status VersionedCatalog::AddSchema(absl::Time creation_time,
-                                         std::unique_ptr<const Schema> schema) {
+                                         std::unique_ptr<const Schema> schema,
+                                         bool preserves_data) {
   absl::MutexLock lock(&mu_);
   ZETASQL_RET_CHECK(creation_time > schemas_.rbegin()->first)
       << "Failed to insert schema at " << absl::FormatTime(creation_time)
       << ": the latest schema creation timestamp is "
       << absl::FormatTime(schemas_.rbegin()->first);
-  schemas_[creation_time] = std::move(schema);
+  const int64_t latest_data_version =
+      data_versions_[schemas_.rbegin()->second.get()];
+  auto [itr, inserted] = schemas_.emplace(creation_time, std::move(schema));
+  data_versions_[itr->second.get()] =
+      preserves_data ? latest_data_version : latest_data_version + 1;
+  latest_.store(&*itr, std::memory_order_release);
   return absl::OkStatus();
 }
 
+bool VersionedCatalog::IsDataCompatibleWithLatest(const Schema* schema) const {
+  if (schema == GetLatestSchema()) {
+    return true;
+  }
+  absl::MutexLock lock(&mu_);
+  auto itr = data_versions_.find(schema);
+  return itr != data_versions_.end() &&
+         itr->second == data_versions_.at(schemas_.rbegin()->second.get());
+}
+
+std::unique_ptr<VersionedCatalog> VersionedCatalog::Clone() const {
+  auto clone = std::make_unique<VersionedCatalog>();
+  absl::MutexLock lock(&mu_);
+  absl::MutexLock clone_lock(&clone->mu_);
+  clone->schemas_ = schemas_;
+  clone->data_versions_ = data_versions_;
+  clone->latest_.store(&*clone->schemas_.rbegin(), std::memory_order_release);
+  return clone;
+}
+
+std::vector<std::shared_ptr<const Schema>> VersionedCatalog::CollectGarbage(
+    absl::Time horizon) {
+  std::vector<std::shared_ptr<const Schema>> removed;
+  absl::MutexLock lock(&mu_);
+  // References are only taken under mu_, so an unreferenced schema stays so.
+  while (schemas_.size() > 1) {
+    auto itr = schemas_.begin();
+    if (std::next(itr)->first > horizon || itr->second.use_count() > 1) {
+      break;
+    }
+    data_versions_.erase(itr->second.get());
+    removed.push_back(std::move(itr->second));
+    schemas_.erase(itr);
+  }
+  return removed;
+}
+
+int VersionedCatalog::num_schemas() const {
+  absl::MutexLock lock(&mu_);
+  return schemas_.size();
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
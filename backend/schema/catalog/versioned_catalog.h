@@ -17,10 +17,15 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_VERSIONED_CATALOG_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_VERSIONED_CATALOG_H_
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
@@ -41,28 +46,62 @@ class VersionedCatalog {
 
   // The single-argument constructor is used when a database is created with an
   // initial schema specified. The initial_schema is added to the catalog and
-  // absl::InfinitePast() is assigned as its creation timestamp.
-  explicit VersionedCatalog(std::unique_ptr<const Schema> initial_schema);
+  // absl::InfinitePast() is assigned as its creation timestamp. Schemas are
+  // immutable, so the initial schema may be shared with other catalogs.
+  explicit VersionedCatalog(std::shared_ptr<const Schema> initial_schema);
 
   // Finds the newest schema that is created at or before a given timestamp and
   // returns a pointer to that schema object. There is always a first schema in
   // each VersionedCatalog, which has a creation timestamp of
   // absl::InfinitePast() (see comments of the constructors above). Therefore,
-  // GetSchema never returns a nullptr.
+  // GetSchema never returns a nullptr. Lookups at or after the creation time of
+  // the latest schema do not take mu_.
   const Schema* GetSchema(absl::Time timestamp) const ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Returns the schema GetSchema(timestamp) returns, together with a reference
+  // which keeps it from being collected by CollectGarbage for as long as it is
+  // held. Transactions hold on to the schema they use this way.
+  std::shared_ptr<const Schema> GetSchemaRef(absl::Time timestamp) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   // Returns the latest schema object in the catalog. Will return the first
   // schema initialized if there are no subsequent new schema. Therefore,
-  // GetLatestSchema never returns a nullptr.
-  const Schema* GetLatestSchema() const ABSL_LOCKS_EXCLUDED(mu_);
+  // GetLatestSchema never returns a nullptr. This does not take mu_.
+  const Schema* GetLatestSchema() const;
 
   // Adds a schema at a given timestamp. Returns an error if creation_time is
   // the same or prior to the largest timestamp in all of the schemas. In this
-  // case, the new schema will not be added.
+  // case, the new schema will not be added. If preserves_data is true, the
+  // schema differs from the latest one in metadata only, such as views or
+  // nullable columns, so that data written against the latest schema is valid
+  // against it as is.
   absl::Status AddSchema(absl::Time creation_time,
-                         std::unique_ptr<const Schema> schema)
+                         std::unique_ptr<const Schema> schema,
+                         bool preserves_data = false) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns true if every schema added after the given one preserved the data
+  // (see AddSchema), so that a read-write transaction which started on it can
+  // still commit. Returns true without taking mu_ for the latest schema.
+  bool IsDataCompatibleWithLatest(const Schema* schema) const
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Returns a catalog with the same schemas as this catalog. Schemas are
+  // immutable, so they are shared between the two catalogs rather than copied.
+  // Schemas added to either catalog afterwards are not visible in the other.
+  std::unique_ptr<VersionedCatalog> Clone() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Removes the oldest schemas which were superseded by a newer schema at or
+  // before horizon and which are not referenced outside the catalog, since no
+  // read at or after horizon uses them. Returns the removed schemas, so that
+  // the caller can drop any state it keeps for them before they are destroyed.
+  // Lookups before the creation time of the oldest remaining schema return
+  // that schema. The latest schema is never removed.
+  std::vector<std::shared_ptr<const Schema>> CollectGarbage(absl::Time horizon)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of schemas in the catalog.
+  int num_schemas() const ABSL_LOCKS_EXCLUDED(mu_);
+
  private:
   // For guarding concurrent access to `schemas_`.
   mutable absl::Mutex mu_;
@@ -75,8 +114,21 @@ class VersionedCatalog {
   // Note that this cannot be changed into a hash map (e.g. std::unordered_map)
   // because the lookup of schemas by creation timestamp depends on the ordering
   // of keys in this map.
-  std::map<absl::Time, std::unique_ptr<const Schema>> schemas_
+  using SchemaMap = std::map<absl::Time, std::shared_ptr<const Schema>>;
+  SchemaMap schemas_ ABSL_GUARDED_BY(mu_);
+
+  // The data version of each schema in `schemas_`. A schema which preserves
+  // the data shares the data version of the schema before it, and any other
+  // schema starts a new data version.
+  absl::flat_hash_map<const Schema*, int64_t> data_versions_
       ABSL_GUARDED_BY(mu_);
+
+  // The newest entry of `schemas_`, published for lock-free reads of the latest
+  // schema. The latest entry is never removed from `schemas_` and std::map does
+  // not move its entries on insertion, so the entry (and the schema it owns)
+  // stays valid until a newer schema is published; callers which keep the
+  // schema past that hold a reference from GetSchemaRef.
+  std::atomic<const SchemaMap::value_type*> latest_ = nullptr;
 };
 
 }  // namespace backend
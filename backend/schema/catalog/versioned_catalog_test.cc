@@ -16,12 +16,16 @@
 
 #include "backend/schema/catalog/versioned_catalog.h"
 
+#include <atomic>
 #include <memory>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/algorithm/container.h"
 #include "absl/memory/memory.h"
 #include "absl/time/time.h"
 
@@ -103,6 +107,108 @@ TEST(VersionedCatalogTest, AddSchemaWithSameOrEarlierCreationTime) {
                   testing::MatchesRegex(".*Failed to insert schema.*")));
 }
 
+TEST(VersionedCatalogTest, CloneSharesExistingSchemas) {
+  VersionedCatalog catalog;
+  absl::Time t1 = absl::Now();
+  absl::Time t2 = t1 + absl::Seconds(1);
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t1, std::make_unique<const Schema>()));
+
+  std::unique_ptr<VersionedCatalog> clone = catalog.Clone();
+  EXPECT_EQ(clone->GetSchema(absl::InfinitePast()),
+            catalog.GetSchema(absl::InfinitePast()));
+  EXPECT_EQ(clone->GetSchema(t1), catalog.GetSchema(t1));
+
+  // Schemas added after cloning are only visible in the catalog they were
+  // added to.
+  ZETASQL_EXPECT_OK(clone->AddSchema(t2, std::make_unique<const Schema>()));
+  EXPECT_NE(clone->GetLatestSchema(), catalog.GetLatestSchema());
+  EXPECT_EQ(catalog.GetLatestSchema(), catalog.GetSchema(t1));
+}
+
+TEST(VersionedCatalogTest, CollectsUnreferencedSupersededSchemas) {
+  VersionedCatalog catalog;
+  absl::Time t1 = absl::Now();
+  absl::Time t2 = t1 + absl::Seconds(1);
+  absl::Time t3 = t2 + absl::Seconds(1);
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t1, std::make_unique<const Schema>()));
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t2, std::make_unique<const Schema>()));
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t3, std::make_unique<const Schema>()));
+  const Schema* schema_t2 = catalog.GetSchema(t2);
+  const Schema* schema_t3 = catalog.GetSchema(t3);
+
+  // The schema in effect at the horizon is kept, as are those which are still
+  // referenced.
+  std::shared_ptr<const Schema> referenced = catalog.GetSchemaRef(t1);
+  EXPECT_EQ(catalog.CollectGarbage(t2).size(), 1);
+  EXPECT_EQ(catalog.num_schemas(), 3);
+  referenced.reset();
+  EXPECT_EQ(catalog.CollectGarbage(t2).size(), 1);
+  EXPECT_EQ(catalog.num_schemas(), 2);
+
+  // Lookups before the oldest remaining schema return that schema, and the
+  // latest schema is never collected.
+  EXPECT_EQ(catalog.GetSchema(absl::InfinitePast()), schema_t2);
+  EXPECT_EQ(catalog.CollectGarbage(absl::InfiniteFuture()).size(), 1);
+  EXPECT_EQ(catalog.num_schemas(), 1);
+  EXPECT_EQ(catalog.GetSchema(t1), schema_t3);
+  EXPECT_EQ(catalog.GetLatestSchema(), schema_t3);
+}
+
+TEST(VersionedCatalogTest, TracksSchemasWhichPreserveData) {
+  VersionedCatalog catalog;
+  absl::Time t1 = absl::Now();
+  absl::Time t2 = t1 + absl::Seconds(1);
+  absl::Time t3 = t2 + absl::Seconds(1);
+  const Schema* initial_schema = catalog.GetLatestSchema();
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t1, std::make_unique<const Schema>(),
+                              /*preserves_data=*/true));
+  EXPECT_TRUE(catalog.IsDataCompatibleWithLatest(initial_schema));
+  EXPECT_TRUE(catalog.IsDataCompatibleWithLatest(catalog.GetSchema(t1)));
+
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t2, std::make_unique<const Schema>()));
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t3, std::make_unique<const Schema>(),
+                              /*preserves_data=*/true));
+  EXPECT_FALSE(catalog.IsDataCompatibleWithLatest(initial_schema));
+  EXPECT_FALSE(catalog.IsDataCompatibleWithLatest(catalog.GetSchema(t1)));
+  EXPECT_TRUE(catalog.IsDataCompatibleWithLatest(catalog.GetSchema(t2)));
+}
+
+TEST(VersionedCatalogTest, LatestSchemaIsVisibleToConcurrentReaders) {
+  VersionedCatalog catalog;
+  const Schema* initial_schema = catalog.GetLatestSchema();
+  constexpr int kNumSchemas = 100;
+  std::vector<const Schema*> added_schemas;
+  for (int i = 0; i < kNumSchemas; ++i) {
+    added_schemas.push_back(new Schema());
+  }
+
+  std::atomic<bool> done = false;
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      while (!done) {
+        const Schema* schema = catalog.GetLatestSchema();
+        EXPECT_TRUE(schema == initial_schema ||
+                    absl::c_linear_search(added_schemas, schema));
+      }
+    });
+  }
+
+  absl::Time t = absl::Now();
+  for (int i = 0; i < kNumSchemas; ++i) {
+    t += absl::Seconds(1);
+    ZETASQL_EXPECT_OK(catalog.AddSchema(
+        t, std::unique_ptr<const Schema>(added_schemas[i])));
+    EXPECT_EQ(catalog.GetLatestSchema(), added_schemas[i]);
+    EXPECT_EQ(catalog.GetSchema(t - absl::Milliseconds(1)),
+              i == 0 ? initial_schema : added_schemas[i - 1]);
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
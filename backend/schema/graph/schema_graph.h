@@ -18,6 +18,8 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_GRAPH_SCHEMA_GRAPH_H_
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "backend/schema/graph/schema_node.h"
 #include "backend/schema/graph/schema_objects_pool.h"
@@ -32,9 +34,9 @@ class SchemaGraph {
   SchemaGraph() : pool_(std::make_unique<SchemaObjectsPool>()) {}
 
   // Constructor for creating a graph from an externally-maintained list of
-  // nodes.
+  // nodes. Nodes not owned by 'pool' must be kept alive by its base pool.
   SchemaGraph(std::vector<const SchemaNode*> schema_nodes,
-              std::unique_ptr<SchemaObjectsPool> pool)
+              std::shared_ptr<SchemaObjectsPool> pool)
       : schema_nodes_(std::move(schema_nodes)), pool_(std::move(pool)) {}
 
   // Get a list of all the nodes in the graph in the order in which they were
@@ -50,6 +52,10 @@ class SchemaGraph {
     pool_->Add(std::move(node_ptr));
   }
 
+  // Returns the pool owning the nodes of this graph, so that a graph derived
+  // from this one may share them.
+  std::shared_ptr<SchemaObjectsPool> pool() const { return pool_; }
+
   // A schema graph with no nodes.
   static const SchemaGraph* CreateEmpty() {
     static const SchemaGraph* empty = new SchemaGraph();
@@ -61,7 +67,7 @@ class SchemaGraph {
   std::vector<const SchemaNode*> schema_nodes_;
 
   // Pool for managing the lifetime of the nodes in the graph.
-  std::unique_ptr<SchemaObjectsPool> pool_;
+  std::shared_ptr<SchemaObjectsPool> pool_;
 };
 
 }  // namespace backend
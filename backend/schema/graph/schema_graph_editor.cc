@@ -17,8 +17,11 @@
 #include "backend/schema/graph/schema_graph_editor.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <memory>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "absl/container/flat_hash_map.h"
@@ -26,6 +29,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_join.h"
+#include "absl/types/span.h"
 #include "backend/schema/graph/schema_node.h"
 #include "zetasql/base/ret_check.h"
 #include "absl/status/status.h"
@@ -36,6 +40,54 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+// Below this many nodes per thread, starting a thread costs about as much as
+// the validation it takes over.
+constexpr size_t kMinNodesPerValidationThread = 512;
+
+// Runs Validate() on each of the nodes. Validate() only reads the context and
+// the nodes, so large graphs are split into contiguous ranges of nodes which
+// are validated on separate threads, the first on the calling thread. Returns
+// the error of the first invalid node, as validating the nodes in order would.
+absl::Status ValidateNodes(absl::Span<const SchemaNode* const> nodes,
+                           SchemaValidationContext* context) {
+  auto validate_range = [nodes, context](size_t begin,
+                                         size_t end) -> absl::Status {
+    for (size_t i = begin; i < end; ++i) {
+      ZETASQL_RETURN_IF_ERROR(nodes[i]->Validate(context));
+    }
+    return absl::OkStatus();
+  };
+
+  const size_t num_threads =
+      std::min<size_t>(std::thread::hardware_concurrency(),
+                       nodes.size() / kMinNodesPerValidationThread);
+  if (num_threads <= 1) {
+    return validate_range(0, nodes.size());
+  }
+  const size_t range_size = (nodes.size() + num_threads - 1) / num_threads;
+  std::vector<absl::Status> statuses(num_threads);
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < num_threads; ++t) {
+    workers.emplace_back([&, t] {
+      statuses[t] =
+          validate_range(std::min(t * range_size, nodes.size()),
+                         std::min((t + 1) * range_size, nodes.size()));
+    });
+  }
+  statuses[0] = validate_range(0, range_size);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  for (absl::Status& status : statuses) {
+    ZETASQL_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 SchemaNode* SchemaGraphEditor::MakeNewClone(const SchemaNode* node) {
   std::unique_ptr<SchemaNode> clone = node->ShallowClone();
   SchemaNode* mutable_clone = clone.get();
@@ -99,6 +151,9 @@ absl::StatusOr<const SchemaNode*> SchemaGraphEditor::Clone(
     clone_map_[node] = node;
     ZETASQL_RETURN_IF_ERROR(FixupInternal(node, mutable_node));
     ret = node;
+  } else if (share_original_nodes_) {
+    ZETASQL_RET_CHECK_EQ(kind, kOriginal);
+    ret = node;
   } else {
     ZETASQL_RET_CHECK_EQ(kind, kOriginal);
     ZETASQL_RET_CHECK(!node->is_deleted());
@@ -133,12 +188,7 @@ absl::Status SchemaGraphEditor::AddNode(
 }
 
 bool SchemaGraphEditor::IsOriginalNode(const SchemaNode* node) const {
-  for (const auto* schema_node : original_graph_->GetSchemaNodes()) {
-    if (schema_node == node) {
-      return true;
-    }
-  }
-  return false;
+  return original_nodes_.contains(node);
 }
 
 absl::StatusOr<std::unique_ptr<SchemaGraph>>
@@ -161,6 +211,9 @@ SchemaGraphEditor::CanonicalizeGraph() {
   // will be excluded from new_nodes_, but their memory will not yet be freed
   // so that ValidateUpdate() may be called on them.
   auto cloned_pool_ptr = cloned_pool_.get();
+  if (share_original_nodes_) {
+    cloned_pool_->set_base(original_graph_->pool());
+  }
   new_nodes_.erase(
       std::remove_if(new_nodes_.begin(), new_nodes_.end(),
                      [](const SchemaNode* node) { return node->is_deleted(); }),
@@ -172,7 +225,7 @@ SchemaGraphEditor::CanonicalizeGraph() {
   // Validate the update on cloned nodes which still includes edited and
   // deleted nodes.
   for (const auto* orig_node : original_graph_->GetSchemaNodes()) {
-    auto clone = FindClone(orig_node);
+    auto clone = share_original_nodes_ ? orig_node : FindClone(orig_node);
     ZETASQL_RET_CHECK_NE(clone, nullptr);
     ZETASQL_RETURN_IF_ERROR(clone->ValidateUpdate(orig_node, context_));
   }
@@ -183,19 +236,23 @@ SchemaGraphEditor::CanonicalizeGraph() {
   }
 
   // Do a final pass on the canonicalized set of nodes to perform per-node
-  // validation.
-  for (const auto* node : cloned_graph->GetSchemaNodes()) {
-    ZETASQL_RETURN_IF_ERROR(node->Validate(context_));
-  }
+  // validation. Unlike ValidateUpdate(), which records schema change actions
+  // and releases the names of deleted nodes, Validate() has no side effects, so
+  // nodes may be validated concurrently.
+  ZETASQL_RETURN_IF_ERROR(
+      ValidateNodes(cloned_graph->GetSchemaNodes(), context_));
   context_->ClearNewTempSchemaSnapshot();
 
-  // Check the invariants around the nodes.
-  ZETASQL_RET_CHECK_EQ(cloned_pool_ptr->size(), cloned_graph->GetSchemaNodes().size())
+  // Check the invariants around the nodes. Shared nodes are owned by the pool
+  // of the original graph.
+  const int num_shared_nodes = num_original_nodes() - num_cloned_nodes();
+  ZETASQL_RET_CHECK_EQ(cloned_pool_ptr->size(),
+               cloned_graph->GetSchemaNodes().size() - num_shared_nodes)
       << "\nNodes:\n"
       << cloned_pool_ptr->DebugString();
 
   ZETASQL_RET_CHECK_EQ(cloned_pool_ptr->size(),
-               num_original_nodes() - trimmed_ + added_nodes_.size())
+               num_cloned_nodes() - trimmed_ + added_nodes_.size())
       << "Internal error while cloning schema graph "
       << "Original: " << num_original_nodes() << "\n"
       << "Cloned: " << cloned_pool_ptr->size() << "\n"
@@ -209,7 +266,10 @@ SchemaGraphEditor::CanonicalizeGraph() {
 
 absl::Status SchemaGraphEditor::CanonicalizeEdits() {
   if (clone_map_.empty()) {
-    ZETASQL_RETURN_IF_ERROR(InitCloneMap());
+    // No original node was edited, so none of them refers to an added node.
+    share_original_nodes_ = true;
+    new_nodes_.assign(original_graph_->GetSchemaNodes().begin(),
+                      original_graph_->GetSchemaNodes().end());
   }
 
   // Run a fixup/cloning pass so that changes from edit nodes in the cloned
@@ -221,7 +281,7 @@ absl::Status SchemaGraphEditor::CanonicalizeEdits() {
 
   // No new clones were added.
   ZETASQL_RET_CHECK_EQ(new_nodes_.size(), num_original_nodes());
-  ZETASQL_RET_CHECK_EQ(cloned_pool_->size(), num_original_nodes());
+  ZETASQL_RET_CHECK_EQ(cloned_pool_->size(), num_cloned_nodes());
 
   ZETASQL_VLOG(2) << "Fixing added nodes";
   for (auto& added_node : added_nodes_) {
@@ -230,7 +290,7 @@ absl::Status SchemaGraphEditor::CanonicalizeEdits() {
     cloned_pool_->Add(std::move(added_node));
   }
   ZETASQL_RET_CHECK_EQ(cloned_pool_->size(),
-               num_original_nodes() + added_nodes_.size());
+               num_cloned_nodes() + added_nodes_.size());
   return absl::OkStatus();
 }
 
@@ -57,11 +57,19 @@ namespace backend {
 // ValidateUpdate() on the SchemaNodes(s) in the new and old graph respectively.
 // Validate() and ValidateUpdate() are called in the same order in which the
 // nodes were added to the containing SchemaGraph.
+//
+// If no node of the original graph is edited or deleted, e.g. when a table is
+// created, the new graph shares the original nodes instead of cloning them,
+// since none of them can refer to an added node. This keeps applying a long
+// list of CREATE TABLE statements from being quadratic in the size of the
+// schema.
 class SchemaGraphEditor {
  public:
   SchemaGraphEditor(const SchemaGraph* original_graph,
                     SchemaValidationContext* context)
       : original_graph_(original_graph),
+        original_nodes_(original_graph->GetSchemaNodes().begin(),
+                        original_graph->GetSchemaNodes().end()),
         context_(context),
         cloned_pool_(std::make_unique<SchemaObjectsPool>()) {
     context_->set_added_nodes(&added_nodes_);
@@ -224,6 +232,11 @@ class SchemaGraphEditor {
     return original_graph_->GetSchemaNodes().size();
   }
 
+  // Returns the number of original nodes owned by the new graph.
+  int num_cloned_nodes() const {
+    return share_original_nodes_ ? 0 : num_original_nodes();
+  }
+
   // Clones the original schema and creates the mapping of
   // original nodes to clones.
   absl::Status InitCloneMap();
@@ -253,6 +266,9 @@ class SchemaGraphEditor {
   // The original graph.
   const SchemaGraph* original_graph_ = nullptr;
 
+  // The nodes of the original graph.
+  absl::flat_hash_set<const SchemaNode*> original_nodes_;
+
   // Validation context passed to Validate() and ValidateUpdate() methods for
   // SchemaNode.
   // This is also being used in SchemaUpdaterImpl. This is kept as a pointer
@@ -271,6 +287,10 @@ class SchemaGraphEditor {
   // If true, the SchemaGraph is being visited in the delete fixup phase.
   bool delete_fixup_ = false;
 
+  // If true, the new graph shares the nodes of the original graph, which are
+  // not cloned.
+  bool share_original_nodes_ = false;
+
   // The set of nodes (cloned + newly added) that will constitue
   // the new SchemaGraph.
   std::vector<const SchemaNode*> new_nodes_;
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
@@ -37,6 +38,20 @@ class SchemaObjectsPool {
  public:
   SchemaObjectsPool() {}
 
+  // Releases a long chain of base pools one at a time rather than recursively.
+  ~SchemaObjectsPool() {
+    std::shared_ptr<SchemaObjectsPool> base = std::move(base_);
+    while (base != nullptr && base.use_count() == 1) {
+      base = std::move(base->base_);
+    }
+  }
+
+  // Keeps the nodes of 'base' alive for as long as this pool. Used by graphs
+  // which share the nodes of the graph they were derived from.
+  void set_base(std::shared_ptr<SchemaObjectsPool> base) {
+    base_ = std::move(base);
+  }
+
   // Takes ownership of a 'node'.
   void Add(std::unique_ptr<const SchemaNode> node) {
     schema_node_pool_.insert(std::move(node));
@@ -69,6 +84,9 @@ class SchemaObjectsPool {
 
  private:
   absl::flat_hash_set<std::unique_ptr<const SchemaNode>> schema_node_pool_;
+
+  // Pool holding nodes shared with this pool's graph. May be null.
+  std::shared_ptr<SchemaObjectsPool> base_;
 };
 
 }  // namespace backend
@@ -17,10 +17,13 @@
 
 #include "backend/schema/parser/ddl_parser.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -34,6 +37,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
 #include "backend/schema/ddl/operations.pb.h"
 #include "backend/schema/parser/DDLParserTree.h"
 #include "backend/schema/parser/DDLParserTreeConstants.h"
@@ -1269,6 +1273,47 @@ absl::Status ParseDDLStatement(absl::string_view ddl, DDLStatement* statement) {
   return UnvalidatedParseCloudDDLStatement(ddl, statement);
 }
 
+std::vector<absl::StatusOr<DDLStatement>> ParseDDLStatements(
+    absl::Span<const std::string> ddls) {
+  // Below this many statements per thread, starting a thread costs about as
+  // much as the parsing it takes over.
+  constexpr size_t kMinStatementsPerThread = 16;
+
+  std::vector<absl::StatusOr<DDLStatement>> statements(ddls.size());
+  auto parse_range = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      DDLStatement statement;
+      absl::Status status = ParseDDLStatement(ddls[i], &statement);
+      if (status.ok()) {
+        statements[i] = std::move(statement);
+      } else {
+        statements[i] = std::move(status);
+      }
+    }
+  };
+
+  size_t num_threads =
+      std::min<size_t>(std::thread::hardware_concurrency(),
+                       ddls.size() / kMinStatementsPerThread);
+  if (num_threads <= 1) {
+    parse_range(0, ddls.size());
+    return statements;
+  }
+  // Each thread parses a contiguous range of statements, the last of which is
+  // parsed on the calling thread.
+  size_t range_size = (ddls.size() + num_threads - 1) / num_threads;
+  std::vector<std::thread> threads;
+  size_t begin = 0;
+  for (; begin + range_size < ddls.size(); begin += range_size) {
+    threads.emplace_back(parse_range, begin, begin + range_size);
+  }
+  parse_range(begin, ddls.size());
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return statements;
+}
+
 }  // namespace ddl
 }  // namespace backend
 }  // namespace emulator
@@ -18,9 +18,13 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_PARSER_DDL_PARSER_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "backend/schema/ddl/operations.pb.h"
 
 namespace google {
@@ -42,6 +46,12 @@ extern const char kChangeStreamRetentionPeriodOptionName[];
 
 absl::Status ParseDDLStatement(absl::string_view ddl, DDLStatement* statement);
 
+// Parses each of the given statements independently, as ParseDDLStatement
+// would, and returns the results in the same order. Large batches are parsed
+// on several threads.
+std::vector<absl::StatusOr<DDLStatement>> ParseDDLStatements(
+    absl::Span<const std::string> ddls);
+
 }  // namespace ddl
 }  // namespace backend
 }  // namespace emulator
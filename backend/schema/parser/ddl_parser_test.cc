@@ -27,6 +27,7 @@
 #include "tests/common/proto_matchers.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "common/feature_flags.h"
 #include "tests/common/scoped_feature_flags_setter.h"
@@ -2953,6 +2954,31 @@ TEST(ParseViews, DropView) {
 TEST(ParseAnalyze, CanParseAnalyze) {
   EXPECT_THAT(ParseDDLStatement("ANALYZE"), IsOk());
 }
+
+// Batches
+
+TEST(ParseDDLStatements, ReturnsResultsInStatementOrder) {
+  // Large enough to be parsed on several threads.
+  std::vector<std::string> ddls;
+  for (int i = 0; i < 200; ++i) {
+    ddls.push_back(i % 50 == 7
+                       ? "CREATE TABLE"
+                       : absl::StrCat("CREATE DATABASE db", i));
+  }
+  std::vector<absl::StatusOr<DDLStatement>> statements =
+      ParseDDLStatements(ddls);
+  ASSERT_EQ(statements.size(), ddls.size());
+  for (int i = 0; i < ddls.size(); ++i) {
+    if (i % 50 == 7) {
+      EXPECT_THAT(statements[i], StatusIs(absl::StatusCode::kInvalidArgument));
+    } else {
+      EXPECT_THAT(statements[i], IsOkAndHolds(test::EqualsProto(absl::StrCat(
+                                     "create_database { db_name: \"db\", i,
+                                     "\" }"))));
+    }
+  }
+  EXPECT_TRUE(ParseDDLStatements({}).empty());
+}
 }  // namespace
 
 }  // namespace ddl
@@ -23,14 +23,19 @@
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/common/case.h"
 #include "backend/datamodel/types.h"
 #include "backend/schema/catalog/check_constraint.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/graph/schema_graph.h"
+#include "backend/schema/graph/schema_node.h"
 #include "backend/schema/parser/ddl_reserved_words.h"
 
 namespace google {
@@ -253,13 +258,20 @@ std::string PrintForeignKey(const ForeignKey* foreign_key) {
   return out;
 }
 
-absl::StatusOr<std::vector<std::string>> PrintDDLStatements(
-    const Schema* schema) {
+namespace {
+
+// Prints the DDL statements for all tables, indexes and views within the given
+// schema, getting the statement of each from print_statement(node, print),
+// which returns either print() or a statement printed earlier for node.
+template <typename PrintStatement>
+std::vector<std::string> PrintSchemaStatements(
+    const Schema* schema, const PrintStatement& print_statement) {
   std::vector<std::string> statements;
 
   // Print tables
   for (auto table : schema->tables()) {
-    statements.push_back(PrintTable(table));
+    statements.push_back(
+        print_statement(table, [table]() { return PrintTable(table); }));
     // Print indexes (sorted by name).
     std::vector<const Index*> indexes{table->indexes().begin(),
                                       table->indexes().end()};
@@ -269,7 +281,8 @@ absl::StatusOr<std::vector<std::string>> PrintDDLStatements(
               });
     for (auto index : indexes) {
       if (!index->is_managed()) {
-        statements.push_back(PrintIndex(index));
+        statements.push_back(
+            print_statement(index, [index]() { return PrintIndex(index); }));
       }
     }
   }
@@ -281,8 +294,41 @@ absl::StatusOr<std::vector<std::string>> PrintDDLStatements(
     TopologicalOrderViews(view, &visited, &views);
   }
   for (auto view : views) {
-    statements.push_back(PrintView(view));
+    statements.push_back(
+        print_statement(view, [view]() { return PrintView(view); }));
+  }
+  return statements;
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<std::string>> PrintDDLStatements(
+    const Schema* schema) {
+  return PrintSchemaStatements(
+      schema, [](const SchemaNode*, const auto& print) { return print(); });
+}
+
+absl::StatusOr<std::vector<std::string>> DDLStatementCache::PrintDDLStatements(
+    const Schema* schema) {
+  const SchemaGraph* graph = schema->GetSchemaGraph();
+  absl::MutexLock lock(&mu_);
+  if (absl::c_equal(graph->GetSchemaNodes(), nodes_)) {
+    return statements_;
   }
+  absl::flat_hash_map<const SchemaNode*, std::string> node_statements;
+  std::vector<std::string> statements = PrintSchemaStatements(
+      schema, [&](const SchemaNode* node, const auto& print) {
+        auto itr = node_statements_.find(node);
+        std::string statement =
+            itr != node_statements_.end() ? std::move(itr->second) : print();
+        node_statements[node] = statement;
+        return statement;
+      });
+  pool_ = graph->pool();
+  nodes_.assign(graph->GetSchemaNodes().begin(),
+                graph->GetSchemaNodes().end());
+  node_statements_ = std::move(node_statements);
+  statements_ = statements;
   return statements;
 }
 
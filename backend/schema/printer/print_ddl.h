@@ -19,15 +19,22 @@
 
 #include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/types/optional.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/foreign_key.h"
 #include "backend/schema/catalog/index.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/table.h"
+#include "backend/schema/graph/schema_node.h"
+#include "backend/schema/graph/schema_objects_pool.h"
 
 namespace google {
 namespace spanner {
@@ -66,6 +73,36 @@ std::string ColumnTypeToString(const zetasql::Type* type,
 absl::StatusOr<std::vector<std::string>> PrintDDLStatements(
     const Schema* schema);
 
+// DDLStatementCache prints the DDL statements of the successive schema versions
+// of a database, reusing what it printed for the previous version.
+//
+// The statements of a schema are returned again as long as it is the latest
+// schema printed. A schema updated by a DDL statement which only adds objects,
+// such as CREATE TABLE, shares the unchanged tables, indexes and views of the
+// previous schema, of which only the statements of the added objects are
+// printed. The nodes of the previous schema are kept alive, so that a node of
+// a later schema is never mistaken for one at the same address.
+//
+// This class is thread safe.
+class DDLStatementCache {
+ public:
+  // Returns the same statements as the PrintDDLStatements function.
+  absl::StatusOr<std::vector<std::string>> PrintDDLStatements(
+      const Schema* schema) ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  absl::Mutex mu_;
+
+  // The nodes of the schema graph last printed, and the pool owning them.
+  std::shared_ptr<SchemaObjectsPool> pool_ ABSL_GUARDED_BY(mu_);
+  std::vector<const SchemaNode*> nodes_ ABSL_GUARDED_BY(mu_);
+
+  // The statements printed for the last schema, in order and by node.
+  std::vector<std::string> statements_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<const SchemaNode*, std::string> node_statements_
+      ABSL_GUARDED_BY(mu_);
+};
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
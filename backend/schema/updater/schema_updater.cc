@@ -62,6 +62,7 @@
 #include "backend/schema/backfills/change_stream_backfill.h"
 #include "backend/schema/backfills/column_value_backfill.h"
 #include "backend/schema/backfills/index_backfill.h"
+#include "backend/schema/backfills/table_scan.h"
 #include "backend/schema/builders/change_stream_builder.h"
 #include "backend/schema/builders/check_constraint_builder.h"
 #include "backend/schema/builders/column_builder.h"
@@ -91,6 +92,7 @@
 #include "common/errors.h"
 #include "common/feature_flags.h"
 #include "common/limits.h"
+#include "common/metrics.h"
 #include "re2/re2.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status_macros.h"
@@ -106,6 +108,24 @@ namespace backend {
 
 namespace {
 
+// Returns the histogram of time spent in the given stage of schema updates:
+// "parse" for parsing the statements, "validate" for applying each statement
+// to the schema graph, and "canonicalize" for canonicalizing and validating
+// the resulting graph.
+metrics::LatencyHistogram* SchemaUpdateStageHistogram(absl::string_view stage) {
+  return metrics::GetLatencyHistogram(
+      "emulator_schema_update_stage_latency_seconds", "stage", stage);
+}
+
+// Parses statements, recording the time spent in the "parse" stage.
+std::vector<absl::StatusOr<ddl::DDLStatement>> ParseStatements(
+    absl::Span<const std::string> statements) {
+  static metrics::LatencyHistogram* histogram =
+      SchemaUpdateStageHistogram("parse");
+  metrics::ScopedLatencyTimer timer(histogram);
+  return ddl::ParseDDLStatements(statements);
+}
+
 // A struct that defines the columns used by an index.
 struct ColumnsUsedByIndex {
   std::vector<const KeyColumn*> index_key_columns;
@@ -152,10 +172,28 @@ class SchemaUpdaterImpl {
   absl::StatusOr<std::vector<SchemaValidationContext>> ApplyDDLStatements(
       const SchemaChangeOperation& schema_change_operation);
 
+  // Applies DDL statements to an empty database and returns the resulting
+  // schema. The schema change actions of each statement are run right after
+  // it: with no data to backfill or verify they are cheap, and only the
+  // schemas of the current and previous statements are kept alive, rather than
+  // every intermediate schema.
+  absl::StatusOr<std::unique_ptr<const Schema>> CreateSchema(
+      const SchemaChangeOperation& schema_change_operation);
+
   std::vector<std::unique_ptr<const Schema>> GetIntermediateSchemas() {
     return std::move(intermediate_schemas_);
   }
 
+  // See SchemaChangeContext::create_write_only_indexes.
+  void set_create_write_only_indexes(bool create_write_only_indexes) {
+    create_write_only_indexes_ = create_write_only_indexes;
+  }
+
+  // Returns a copy of `latest_schema_` in which the write-only indexes named
+  // `index_names` are readable.
+  absl::StatusOr<std::unique_ptr<const Schema>> MakeIndexesReadable(
+      absl::Span<const std::string> index_names);
+
  private:
   SchemaUpdaterImpl(zetasql::TypeFactory* type_factory,
                     TableIDGenerator* table_id_generator,
@@ -172,11 +210,26 @@ class SchemaUpdaterImpl {
   // Initializes potentially failing components after construction.
   absl::Status Init();
 
-  // Applies the given `statement` on to `latest_schema_`.
-  absl::StatusOr<std::unique_ptr<const Schema>> ApplyDDLStatement(
-      absl::string_view statement
+  // Applies the given parsed statement on to `latest_schema_` through
+  // `editor_`.
+  absl::Status ApplyDDLStatement(
+      const ddl::DDLStatement& ddl_statement
   );
 
+  // Sets up `statement_context` and `editor_`, calls `edit` to modify the
+  // schema through `editor_`, and makes the resulting schema the latest schema.
+  absl::StatusOr<std::unique_ptr<const Schema>> ApplyEditInContext(
+      const std::function<absl::Status()>& edit,
+      SchemaValidationContext* statement_context);
+
+  // Sets up `statement_context` for `statement`, applies the statement and
+  // makes the resulting schema the latest schema. `ddl_statement` is the result
+  // of parsing `statement`.
+  absl::StatusOr<std::unique_ptr<const Schema>> ApplyDDLStatementInContext(
+      absl::string_view statement,
+      const absl::StatusOr<ddl::DDLStatement>& ddl_statement,
+      SchemaValidationContext* statement_context);
+
   // Run any pending schema actions resulting from the schema change statements.
   absl::Status RunPendingActions(
       const std::vector<SchemaValidationContext>& pending_work,
@@ -447,6 +500,9 @@ class SchemaUpdaterImpl {
 
   // Manages global schema names to prevent and generate unique names.
   GlobalSchemaNames global_names_;
+
+  // See SchemaChangeContext::create_write_only_indexes.
+  bool create_write_only_indexes_ = false;
 };
 
 absl::Status SchemaUpdaterImpl::Init() {
@@ -506,85 +562,156 @@ absl::Status ValidateDdlStatement(const ddl::DDLStatement& ddl) {
   return absl::OkStatus();
 }
 
-absl::StatusOr<std::unique_ptr<const Schema>>
-SchemaUpdaterImpl::ApplyDDLStatement(
-    absl::string_view statement
+absl::Status SchemaUpdaterImpl::ApplyDDLStatement(
+    const ddl::DDLStatement& ddl_statement
 ) {
-  if (statement.empty()) {
-    return error::EmptyDDLStatement();
-  }
-
-  ZETASQL_RET_CHECK(!editor_->HasModifications());
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ddl::DDLStatement> ddl_statement,
-                   ParseDDLByDialect(statement
-                                     ));
-  ZETASQL_RETURN_IF_ERROR(ValidateDdlStatement(*ddl_statement));
+  ZETASQL_RETURN_IF_ERROR(ValidateDdlStatement(ddl_statement));
 
   // Apply the statement to the schema graph.
-  switch (ddl_statement->statement_case()) {
+  switch (ddl_statement.statement_case()) {
     case ddl::DDLStatement::kCreateTable: {
-      ZETASQL_RETURN_IF_ERROR(CreateTable(ddl_statement->create_table()
+      ZETASQL_RETURN_IF_ERROR(CreateTable(ddl_statement.create_table()
                                   ));
       break;
     }
     case ddl::DDLStatement::kCreateChangeStream: {
       ZETASQL_RETURN_IF_ERROR(
-          CreateChangeStream(ddl_statement->create_change_stream()).status());
+          CreateChangeStream(ddl_statement.create_change_stream()).status());
       break;
     }
     case ddl::DDLStatement::kCreateIndex: {
-      if (global_names_.HasName(ddl_statement->create_index().index_name()) &&
-          ddl_statement->create_index().existence_modifier() ==
+      if (global_names_.HasName(ddl_statement.create_index().index_name()) &&
+          ddl_statement.create_index().existence_modifier() ==
               ddl::IF_NOT_EXISTS) {
         break;
       }
-      ZETASQL_RETURN_IF_ERROR(CreateIndex(ddl_statement->create_index()).status());
+      ZETASQL_RETURN_IF_ERROR(CreateIndex(ddl_statement.create_index()).status());
       break;
     }
     case ddl::DDLStatement::kCreateFunction: {
-      ZETASQL_RETURN_IF_ERROR(CreateFunction(ddl_statement->create_function()));
+      ZETASQL_RETURN_IF_ERROR(CreateFunction(ddl_statement.create_function()));
       break;
     }
     case ddl::DDLStatement::kAlterTable: {
-      ZETASQL_RETURN_IF_ERROR(AlterTable(ddl_statement->alter_table()
+      ZETASQL_RETURN_IF_ERROR(AlterTable(ddl_statement.alter_table()
                                  ));
       break;
     }
     case ddl::DDLStatement::kAlterChangeStream: {
-      ZETASQL_RETURN_IF_ERROR(AlterChangeStream(ddl_statement->alter_change_stream()));
+      ZETASQL_RETURN_IF_ERROR(AlterChangeStream(ddl_statement.alter_change_stream()));
       break;
     }
     case ddl::DDLStatement::kDropTable: {
-      ZETASQL_RETURN_IF_ERROR(DropTable(ddl_statement->drop_table()));
+      ZETASQL_RETURN_IF_ERROR(DropTable(ddl_statement.drop_table()));
       break;
     }
     case ddl::DDLStatement::kDropIndex: {
-      ZETASQL_RETURN_IF_ERROR(DropIndex(ddl_statement->drop_index()));
+      ZETASQL_RETURN_IF_ERROR(DropIndex(ddl_statement.drop_index()));
       break;
     }
     case ddl::DDLStatement::kDropChangeStream: {
-      ZETASQL_RETURN_IF_ERROR(DropChangeStream(ddl_statement->drop_change_stream()));
+      ZETASQL_RETURN_IF_ERROR(DropChangeStream(ddl_statement.drop_change_stream()));
       break;
     }
     case ddl::DDLStatement::kAnalyze:
-      // Intentionally no=op.
+      // The schema is unchanged. The database rebuilds the statistics of its
+      // tables once the statement is applied.
       break;
     case ddl::DDLStatement::kSetColumnOptions:
       ZETASQL_RETURN_IF_ERROR(ApplyImplSetColumnOptions(
-          ddl_statement->set_column_options()
+          ddl_statement.set_column_options()
           ));
       break;
     case ddl::DDLStatement::kDropFunction:
-      ZETASQL_RETURN_IF_ERROR(DropFunction(ddl_statement->drop_function()));
+      ZETASQL_RETURN_IF_ERROR(DropFunction(ddl_statement.drop_function()));
       break;
     default:
       ZETASQL_RET_CHECK(false) << "Unsupported ddl statement: "
-                       << ddl_statement->statement_case();
+                       << ddl_statement.statement_case();
   }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<const Schema>>
+SchemaUpdaterImpl::ApplyDDLStatementInContext(
+    absl::string_view statement,
+    const absl::StatusOr<ddl::DDLStatement>& ddl_statement,
+    SchemaValidationContext* statement_context) {
+  ZETASQL_VLOG(2) << "Applying statement " << statement;
+  ZETASQL_RETURN_IF_ERROR(ddl_statement.status());
+  return ApplyEditInContext(
+      [&]() { return ApplyDDLStatement(*ddl_statement); }, statement_context);
+}
+
+absl::StatusOr<std::unique_ptr<const Schema>>
+SchemaUpdaterImpl::MakeIndexesReadable(
+    absl::Span<const std::string> index_names) {
+  SchemaValidationContext statement_context{
+      storage_, &global_names_, type_factory_, schema_change_timestamp_};
+  return ApplyEditInContext(
+      [&]() -> absl::Status {
+        for (const std::string& index_name : index_names) {
+          const Index* index = latest_schema_->FindIndex(index_name);
+          ZETASQL_RET_CHECK(index != nullptr && index->is_write_only())
+              << "Not a write-only index: " << index_name;
+          ZETASQL_RETURN_IF_ERROR(AlterNode<Index>(
+              index, [](Index::Editor* editor) -> absl::Status {
+                editor->set_write_only(false);
+                return absl::OkStatus();
+              }));
+        }
+        return absl::OkStatus();
+      },
+      &statement_context);
+}
+
+absl::StatusOr<std::unique_ptr<const Schema>>
+SchemaUpdaterImpl::ApplyEditInContext(
+    const std::function<absl::Status()>& edit,
+    SchemaValidationContext* statement_context) {
+  // Set up the SchemaValidationContext before passing it to `editor_`. This
+  // includes setting the old schema snapshot and a callback to construct
+  // a temporary schema snapshot of the pending new schema. The temporary
+  // schema snapshot does not own the new schema nodes but will remain alive
+  // for the lifetime of `editor_` and `statement_context_`. The callback
+  // mechanism is needed because 1) SchemaUpdater doesn't know at which point
+  // SchemaGraphEditor will validate the new schema and 2) SchemaGraphEditor
+  // or SchemaValidationContext cannot take a dependency on Schema.
+  std::unique_ptr<const Schema> new_tmp_schema = nullptr;
+  statement_context_ = statement_context;
+  statement_context_->SetOldSchemaSnapshot(latest_schema_);
+  statement_context_->SetTempNewSchemaSnapshotConstructor(
+      [this,
+       &new_tmp_schema](const SchemaGraph* unowned_graph) -> const Schema* {
+        new_tmp_schema = std::make_unique<const Schema>(
+            unowned_graph
+        );
+        return new_tmp_schema.get();
+      });
+
+  // Initialize the editor that will be used to stage the schema changes.
+  editor_ = std::make_unique<SchemaGraphEditor>(
+      latest_schema_->GetSchemaGraph(), statement_context_);
+
+  // If there is a semantic validation error, then we return right away.
+  ZETASQL_RET_CHECK(!editor_->HasModifications());
+  {
+    static metrics::LatencyHistogram* histogram =
+        SchemaUpdateStageHistogram("validate");
+    metrics::ScopedLatencyTimer timer(histogram);
+    ZETASQL_RETURN_IF_ERROR(edit());
+  }
+  static metrics::LatencyHistogram* canonicalize_histogram =
+      SchemaUpdateStageHistogram("canonicalize");
+  metrics::ScopedLatencyTimer canonicalize_timer(canonicalize_histogram);
   ZETASQL_ASSIGN_OR_RETURN(auto new_schema_graph, editor_->CanonicalizeGraph());
-  return std::make_unique<const OwningSchema>(
-      std::move(new_schema_graph)
-  );
+  std::unique_ptr<const Schema> new_schema =
+      std::make_unique<const OwningSchema>(std::move(new_schema_graph));
+
+  // Make this the new schema snapshot for processing the next statement.
+  statement_context_->SetValidatedNewSchemaSnapshot(new_schema.get());
+  latest_schema_ = new_schema.get();
+  return new_schema;
 }
 
 absl::StatusOr<std::vector<SchemaValidationContext>>
@@ -592,57 +719,48 @@ SchemaUpdaterImpl::ApplyDDLStatements(
     const SchemaChangeOperation& schema_change_operation) {
   std::vector<SchemaValidationContext> pending_work;
 
-  for (const auto& statement : schema_change_operation.statements) {
-    ZETASQL_VLOG(2) << "Applying statement " << statement;
-
-    // Set up the SchemaValidationContext before passing it to `editor_`. This
-    // includes setting the old schema snapshot and a callback to construct
-    // a temporary schema snapshot of the pending new schema. The temporary
-    // schema snapshot does not own the new schema nodes but will remain alive
-    // for the lifetime of `editor_` and `statement_context_`. The callback
-    // mechanism is needed because 1) SchemaUpdater doesn't know at which point
-    // SchemaGraphEditor will validate the new schema and 2) SchemaGraphEditor
-    // or SchemaValidationContext cannot take a dependency on Schema.
-    std::unique_ptr<const Schema> new_tmp_schema = nullptr;
+  // Parsing does not depend on the schema, so all statements are parsed up
+  // front. Parse errors are still returned in statement order.
+  std::vector<absl::StatusOr<ddl::DDLStatement>> ddl_statements =
+      ParseStatements(schema_change_operation.statements);
+  for (int i = 0; i < schema_change_operation.statements.size(); ++i) {
     SchemaValidationContext statement_context{
         storage_, &global_names_, type_factory_, schema_change_timestamp_};
-    statement_context_ = &statement_context;
-    statement_context_->SetOldSchemaSnapshot(latest_schema_);
-    statement_context_->SetTempNewSchemaSnapshotConstructor(
-        [this,
-         &new_tmp_schema](const SchemaGraph* unowned_graph) -> const Schema* {
-          new_tmp_schema = std::make_unique<const Schema>(
-              unowned_graph
-          );
-          return new_tmp_schema.get();
-        });
-
-    // Initialize the editor that will be used to stage the schema changes.
-    editor_ = std::make_unique<SchemaGraphEditor>(
-        latest_schema_->GetSchemaGraph(), statement_context_);
-
-    // If there is a semantic validation error, then we return right away.
     ZETASQL_ASSIGN_OR_RETURN(
         auto new_schema,
-        ApplyDDLStatement(statement
-                          ));
+        ApplyDDLStatementInContext(schema_change_operation.statements[i],
+                                   ddl_statements[i], &statement_context));
 
     // We save every schema snapshot as verifiers/backfillers from the
     // current/next statement may need to refer to the previous/current
-    // schema snapshots.
-    statement_context_->SetValidatedNewSchemaSnapshot(new_schema.get());
-    latest_schema_ = new_schema.get();
+    // schema snapshots. Also save the pending backfill work.
     intermediate_schemas_.emplace_back(std::move(new_schema));
-
-    // If everything was OK, make this the new schema snapshot for processing
-    // the next statement and save the pending schema snapshot and backfill
-    // work.
     pending_work.emplace_back(std::move(statement_context));
   }
 
   return pending_work;
 }
 
+absl::StatusOr<std::unique_ptr<const Schema>> SchemaUpdaterImpl::CreateSchema(
+    const SchemaChangeOperation& schema_change_operation) {
+  std::unique_ptr<const Schema> schema = nullptr;
+  std::vector<absl::StatusOr<ddl::DDLStatement>> ddl_statements =
+      ParseStatements(schema_change_operation.statements);
+  for (int i = 0; i < schema_change_operation.statements.size(); ++i) {
+    SchemaValidationContext statement_context{
+        storage_, &global_names_, type_factory_, schema_change_timestamp_};
+    ZETASQL_ASSIGN_OR_RETURN(
+        auto new_schema,
+        ApplyDDLStatementInContext(schema_change_operation.statements[i],
+                                   ddl_statements[i], &statement_context));
+    ZETASQL_RETURN_IF_ERROR(statement_context.RunSchemaChangeActions());
+
+    // The previous schema is no longer referred to by any pending action.
+    schema = std::move(new_schema);
+  }
+  return schema;
+}
+
 template <typename ColumnModifier>
 absl::Status SchemaUpdaterImpl::SetColumnOptions(
     const ::google::protobuf::RepeatedPtrField<ddl::SetOption>& set_options,
@@ -982,9 +1100,12 @@ absl::StatusOr<const Column*> SchemaUpdaterImpl::CreateColumn(
   const Column* column = builder.get();
   builder.set_table(table);
   if (column->is_generated() || column->has_default_value()) {
-    statement_context_->AddAction(
+    statement_context_->AddTableScanAction(
         [column](const SchemaValidationContext* context) {
           return BackfillGeneratedColumnValue(column, context);
+        },
+        [column](const SchemaValidationContext* context) {
+          return MakeGeneratedColumnBackfillConsumer(column, context);
         });
   }
   ZETASQL_RETURN_IF_ERROR(AddNode(builder.build()));
@@ -1721,9 +1842,12 @@ absl::Status SchemaUpdaterImpl::CreateCheckConstraint(
   }
 
   const CheckConstraint* check_constraint = builder.get();
-  statement_context_->AddAction(
+  statement_context_->AddTableScanAction(
       [check_constraint](const SchemaValidationContext* context) {
         return VerifyCheckConstraintData(check_constraint, context);
+      },
+      [check_constraint](const SchemaValidationContext* context) {
+        return MakeCheckConstraintVerifierConsumer(check_constraint, context);
       });
   ZETASQL_RETURN_IF_ERROR(AddNode(builder.build()));
   return absl::OkStatus();
@@ -2381,13 +2505,20 @@ absl::StatusOr<const Index*> SchemaUpdaterImpl::CreateIndexHelper(
         return absl::OkStatus();
       }));
 
-  // Register a backfill action for the index.
+  // Register a backfill action for the index, unless the caller backfills the
+  // index itself while writes maintain it.
   const Index* index = builder.get();
-
-    statement_context_->AddAction(
+  if (create_write_only_indexes_) {
+    builder.set_write_only(true);
+  } else {
+    statement_context_->AddTableScanAction(
         [index](const SchemaValidationContext* context) {
           return BackfillIndex(index, context);
+        },
+        [index](const SchemaValidationContext* context) {
+          return MakeIndexBackfillConsumer(index, context);
         });
+  }
 
   // The data table must be added after the index for correct order of
   // validation.
@@ -2885,10 +3016,86 @@ SchemaUpdater::ValidateSchemaFromDDL(
 // TODO : These should run in a ReadWriteTransaction with rollback
 // capability so that changes to the database can be reversed.
 absl::Status SchemaUpdater::RunPendingActions(int* num_succesful) {
-  for (const auto& pending_statement : pending_work_) {
-    ZETASQL_RETURN_IF_ERROR(pending_statement.RunSchemaChangeActions());
-    ++(*num_succesful);
+  // Consecutive actions which only scan a table, such as index backfills,
+  // generated column backfills and check constraint verifications, share a
+  // single scan of each table, so that a batch creating several indexes on a
+  // table reads it once. The actions are then finished in statement order, so
+  // that the same statement fails, with the same error, as when each action
+  // scans on its own. Scans of different tables are independent, as each of
+  // these actions only writes to its own table or to the data table of one of
+  // its indexes, and consumers of the same table see the values backfilled by
+  // those before them.
+  struct TableScanAction {
+    int statement;
+    std::unique_ptr<TableScanConsumer> consumer;
+    absl::Status scan_status;
+    std::vector<absl::Status> partition_statuses;
+  };
+  std::vector<TableScanAction> table_scans;
+  auto run_table_scans = [&]() -> absl::Status {
+    std::vector<TableID> table_ids;
+    absl::flat_hash_map<TableID, std::vector<TableScanAction*>> table_actions;
+    for (TableScanAction& action : table_scans) {
+      TableID table_id = action.consumer->table()->id();
+      std::vector<TableScanAction*>& actions = table_actions[table_id];
+      if (actions.empty()) {
+        table_ids.push_back(table_id);
+      }
+      actions.push_back(&action);
+    }
+    for (const TableID& table_id : table_ids) {
+      const std::vector<TableScanAction*>& actions = table_actions[table_id];
+      std::vector<TableScanConsumer*> consumers;
+      for (TableScanAction* action : actions) {
+        consumers.push_back(action->consumer.get());
+      }
+      const SchemaValidationContext& context =
+          pending_work_[actions[0]->statement];
+      absl::StatusOr<std::vector<std::vector<absl::Status>>> statuses =
+          ScanTable(context.storage(), context.pending_commit_timestamp(),
+                    consumers);
+      for (int i = 0; i < actions.size(); ++i) {
+        if (statuses.ok()) {
+          actions[i]->partition_statuses = std::move((*statuses)[i]);
+        } else {
+          actions[i]->scan_status = statuses.status();
+        }
+      }
+    }
+    for (TableScanAction& action : table_scans) {
+      absl::Status status = action.scan_status;
+      if (status.ok()) {
+        status = action.consumer->Finish(action.partition_statuses);
+      }
+      if (!status.ok()) {
+        *num_succesful = action.statement;
+        return status;
+      }
+    }
+    table_scans.clear();
+    return absl::OkStatus();
+  };
+
+  for (int i = 0; i < pending_work_.size(); ++i) {
+    const SchemaValidationContext& pending_statement = pending_work_[i];
+    for (int j = 0; j < pending_statement.num_actions(); ++j) {
+      if (pending_statement.table_scan_consumer(j) != nullptr) {
+        table_scans.push_back(TableScanAction{
+            .statement = i,
+            .consumer =
+                pending_statement.table_scan_consumer(j)(&pending_statement)});
+        continue;
+      }
+      ZETASQL_RETURN_IF_ERROR(run_table_scans());
+      absl::Status status = pending_statement.action(j)(&pending_statement);
+      if (!status.ok()) {
+        *num_succesful = i;
+        return status;
+      }
+    }
   }
+  ZETASQL_RETURN_IF_ERROR(run_table_scans());
+  *num_succesful = pending_work_.size();
   return absl::OkStatus();
 }
 
@@ -2901,6 +3108,7 @@ absl::StatusOr<SchemaChangeResult> SchemaUpdater::UpdateSchemaFromDDL(
                        context.type_factory, context.table_id_generator,
                        context.column_id_generator, context.storage,
                        context.schema_change_timestamp, existing_schema));
+  updater.set_create_write_only_indexes(context.create_write_only_indexes);
   ZETASQL_ASSIGN_OR_RETURN(pending_work_,
                    updater.ApplyDDLStatements(schema_change_operation));
   intermediate_schemas_ = updater.GetIntermediateSchemas();
@@ -2925,11 +3133,24 @@ absl::StatusOr<std::unique_ptr<const Schema>>
 SchemaUpdater::CreateSchemaFromDDL(
     const SchemaChangeOperation& schema_change_operation,
     const SchemaChangeContext& context) {
-  ZETASQL_ASSIGN_OR_RETURN(
-      SchemaChangeResult result,
-      UpdateSchemaFromDDL(EmptySchema(), schema_change_operation, context));
-  ZETASQL_RETURN_IF_ERROR(result.backfill_status);
-  return std::move(result.updated_schema);
+  ZETASQL_ASSIGN_OR_RETURN(SchemaUpdaterImpl updater,
+                   SchemaUpdaterImpl::Build(
+                       context.type_factory, context.table_id_generator,
+                       context.column_id_generator, context.storage,
+                       context.schema_change_timestamp, EmptySchema()));
+  return updater.CreateSchema(schema_change_operation);
+}
+
+absl::StatusOr<std::unique_ptr<const Schema>>
+SchemaUpdater::MakeIndexesReadable(const Schema* existing_schema,
+                                   absl::Span<const std::string> index_names,
+                                   const SchemaChangeContext& context) {
+  ZETASQL_ASSIGN_OR_RETURN(SchemaUpdaterImpl updater,
+                   SchemaUpdaterImpl::Build(
+                       context.type_factory, context.table_id_generator,
+                       context.column_id_generator, context.storage,
+                       context.schema_change_timestamp, existing_schema));
+  return updater.MakeIndexesReadable(index_names);
 }
 
 absl::StatusOr<std::unique_ptr<ddl::DDLStatement>> ParseDDLByDialect(
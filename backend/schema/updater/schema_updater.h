@@ -66,6 +66,11 @@ struct SchemaChangeContext {
   // The timestamp at which the schema changes/validations/backfills
   // should be done.
   absl::Time schema_change_timestamp;
+
+  // If true, indexes are created write-only and are not backfilled, see
+  // Database::CreateIndexesOnline. Only used by UpdateSchemaFromDDL, for
+  // operations made of CREATE INDEX statements.
+  bool create_write_only_indexes = false;
 };
 
 // The result of processing a set of DDL statements for a schema change request.
@@ -97,7 +102,8 @@ class SchemaUpdater {
   // any backfill or data-dependent verification tasks resulting from the new
   // schema such as creation of a new index. However, since the database will
   // not contain any data at this point, none of the backfill tasks are expected
-  // to fail.
+  // to fail, and the tasks of each statement are run as soon as it is applied
+  // instead of being kept pending with every intermediate schema.
   absl::StatusOr<std::unique_ptr<const Schema>> CreateSchemaFromDDL(
       const SchemaChangeOperation& schema_change_operation,
       const SchemaChangeContext& context);
@@ -117,6 +123,12 @@ class SchemaUpdater {
       const SchemaChangeOperation& schema_change_operation,
       const SchemaChangeContext& context);
 
+  // Returns a copy of `existing_schema` in which the write-only indexes named
+  // `index_names` are readable.
+  absl::StatusOr<std::unique_ptr<const Schema>> MakeIndexesReadable(
+      const Schema* existing_schema, absl::Span<const std::string> index_names,
+      const SchemaChangeContext& context);
+
   // Validates the given set DDL statements, producing a new schema with the
   // DDL statements applied. Does not run any backfill/verification tasks
   // entailed by `statements`.
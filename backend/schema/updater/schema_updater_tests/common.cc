@@ -14,9 +14,15 @@
 // limitations under the License.
 //
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/strings/substitute.h"
 #include "backend/schema/updater/schema_updater_tests/base.h"
+#include "common/errors.h"
+#include "common/metrics.h"
 
 namespace google {
 namespace spanner {
@@ -108,6 +114,93 @@ TEST_P(SchemaUpdaterTest, CreationOrder) {
               testing::ElementsAreArray(expected));
 }
 
+TEST_P(SchemaUpdaterTest, AddingNodesSharesUnchangedNodes) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto schema, CreateSchema({R"(
+      CREATE TABLE T1 (
+        k1 INT64,
+        c1 STRING(MAX)
+      ) PRIMARY KEY (k1)
+    )"}));
+  const Table* t1 = schema->FindTable("T1");
+
+  // Creating an unrelated table reuses the nodes of T1.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto with_t2, UpdateSchema(schema.get(), {R"(
+      CREATE TABLE T2 (
+        k1 INT64
+      ) PRIMARY KEY (k1)
+    )"}));
+  EXPECT_EQ(with_t2->FindTable("T1"), t1);
+  EXPECT_NE(with_t2->FindTable("T2"), nullptr);
+
+  // The nodes outlive the schema they were created in.
+  schema.reset();
+  EXPECT_EQ(with_t2->FindTable("T1")->FindColumn("c1")->Name(), "c1");
+
+  // Indexing T1 edits it, so it is cloned.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto with_index, UpdateSchema(with_t2.get(), {R"(
+      CREATE INDEX Idx1 ON T1(c1)
+    )"}));
+  EXPECT_NE(with_index->FindTable("T1"), t1);
+  EXPECT_EQ(with_index->FindTable("T1")->indexes().size(), 1);
+}
+
+TEST_P(SchemaUpdaterTest, ValidatesLargeSchemas) {
+  // Enough nodes for the graph to be validated on several threads.
+  constexpr int kNumTables = 300;
+  std::vector<std::string> statements;
+  for (int i = 0; i < kNumTables; ++i) {
+    statements.push_back(absl::Substitute(R"(
+      CREATE TABLE T$0 (
+        k1 INT64,
+        c1 STRING(MAX),
+        c2 INT64
+      ) PRIMARY KEY (k1)
+    )",
+                                          i));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto schema, CreateSchema(statements));
+  EXPECT_EQ(schema->tables().size(), kNumTables);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto with_index, UpdateSchema(schema.get(), {R"(
+      CREATE INDEX Idx1 ON T7(c1)
+    )"}));
+  EXPECT_EQ(with_index->FindTable("T7")->indexes().size(), 1);
+
+  EXPECT_THAT(UpdateSchema(with_index.get(), {R"(
+      CREATE TABLE T8 (
+        k1 INT64
+      ) PRIMARY KEY (k1)
+    )"}),
+              StatusIs(error::SchemaObjectAlreadyExists("Table", "T8")));
+}
+
+int64_t StageCount(absl::string_view stage) {
+  return metrics::GetLatencyHistogram(
+             "emulator_schema_update_stage_latency_seconds", "stage", stage)
+      ->Count();
+}
+
+TEST_P(SchemaUpdaterTest, RecordsLatencyOfEachStage) {
+  const int64_t parse = StageCount("parse");
+  const int64_t validate = StageCount("validate");
+  const int64_t canonicalize = StageCount("canonicalize");
+
+  // Statements are parsed together, then applied one at a time.
+  ZETASQL_ASSERT_OK(CreateSchema({R"(
+      CREATE TABLE T1 (
+        k1 INT64
+      ) PRIMARY KEY (k1)
+    )",
+                          R"(
+      CREATE TABLE T2 (
+        k1 INT64
+      ) PRIMARY KEY (k1)
+    )"}));
+  EXPECT_EQ(StageCount("parse"), parse + 1);
+  EXPECT_EQ(StageCount("validate"), validate + 2);
+  EXPECT_EQ(StageCount("canonicalize"), canonicalize + 2);
+}
+
 }  // namespace
 
 }  // namespace test
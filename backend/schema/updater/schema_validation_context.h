@@ -17,6 +17,7 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_SCHEMA_VALIDATION_CONTEXT_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_SCHEMA_VALIDATION_CONTEXT_H_
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -37,6 +38,7 @@ namespace backend {
 
 class Schema;
 class GlobalSchemaNames;
+class TableScanConsumer;
 
 // A class used to collect and execute verification/backfill actions resulting
 // from a schema change. A `SchemaChangeAction` object can be constructed and
@@ -57,6 +59,12 @@ class SchemaValidationContext {
   // A callback used to return an unowned instance of a Schema.
   using SchemaConstructorCb = std::function<const Schema*(const SchemaGraph*)>;
 
+  // A callback used to create the consumer of a table scan through which a
+  // schema change action which only scans a table can instead be run.
+  using TableScanConsumerFactory =
+      std::function<std::unique_ptr<TableScanConsumer>(
+          const SchemaValidationContext*)>;
+
   // Test-only constructor.
   // TODO : Split out into a separate Schema update validation
   // context that is used by SchemaUpdater and can therefore be mocked
@@ -81,6 +89,17 @@ class SchemaValidationContext {
   // Adds a SchemaChangeAction to this validation context.
   void AddAction(SchemaChangeAction action_fn) {
     actions_.emplace_back(std::move(action_fn));
+    table_scan_consumers_.emplace_back(nullptr);
+  }
+
+  // Adds a SchemaChangeAction which scans a single table, and whose effects
+  // are applied only after the scan. The SchemaUpdater may run the action
+  // through the consumer `scan_consumer` returns instead, sharing one scan of
+  // the table between pending actions.
+  void AddTableScanAction(SchemaChangeAction action_fn,
+                          TableScanConsumerFactory scan_consumer) {
+    actions_.emplace_back(std::move(action_fn));
+    table_scan_consumers_.emplace_back(std::move(scan_consumer));
   }
 
   // Interface used by a SchemaChangeAction to access the
@@ -146,6 +165,15 @@ class SchemaValidationContext {
   // Returns the number of pending schema change actions.
   int num_actions() const { return actions_.size(); }
 
+  // Returns the i-th pending schema change action.
+  const SchemaChangeAction& action(int i) const { return actions_[i]; }
+
+  // Returns the table scan consumer factory of the i-th pending schema change
+  // action, which is null unless it was added by AddTableScanAction.
+  const TableScanConsumerFactory& table_scan_consumer(int i) const {
+    return table_scan_consumers_[i];
+  }
+
   // Returns true if 'node' is a node that was modified using a DDL
   // statement/operation as a part of the schema change associated
   // with this SchemaValidationContext.
@@ -220,6 +248,9 @@ class SchemaValidationContext {
   // The list of pending schema change actions (verifications/backfills) to run.
   std::vector<SchemaChangeAction> actions_;
 
+  // The table scan consumer factory of each pending action, if any.
+  std::vector<TableScanConsumerFactory> table_scan_consumers_;
+
   // The old schema.
   const Schema* old_schema_snapshot_ = nullptr;
 
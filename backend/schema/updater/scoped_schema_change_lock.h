@@ -79,6 +79,43 @@ class ScopedSchemaChangeLock {
   bool has_commit_timestamp_ = false;
 };
 
+// A class that allows RAII reservation of a commit timestamp for a schema
+// change which leaves the data of the database untouched, without acquiring
+// the database lock (see LockManager::BeginMetadataChange). Concurrent
+// read-write transactions keep their locks, and commits wait for the schema
+// change to complete until this object goes out of scope.
+class ScopedMetadataChange {
+ public:
+  ScopedMetadataChange(TransactionID tid, LockManager* lock_manager)
+      : tid_(tid), lock_manager_(lock_manager) {}
+
+  // Reserves a commit timestamp for the schema change, or returns with a
+  // FAILED_PRECONDITION error if a concurrent schema change was already in
+  // progress.
+  absl::StatusOr<absl::Time> ReserveCommitTimestamp() {
+    absl::StatusOr<absl::Time> timestamp =
+        lock_manager_->BeginMetadataChange(tid_);
+    if (!timestamp.ok()) {
+      ZETASQL_RET_CHECK_EQ(timestamp.status().code(), absl::StatusCode::kAborted);
+      return error::ConcurrentSchemaChangeOrReadWriteTxnInProgress();
+    }
+    has_commit_timestamp_ = true;
+    return timestamp;
+  }
+
+  ~ScopedMetadataChange() {
+    if (has_commit_timestamp_) {
+      lock_manager_->EndMetadataChange();
+    }
+  }
+
+ private:
+  TransactionID tid_;
+  LockManager* lock_manager_;
+
+  bool has_commit_timestamp_ = false;
+};
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
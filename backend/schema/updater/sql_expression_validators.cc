@@ -174,8 +174,7 @@ absl::Status AnalyzeColumnExpression(
         options.AddExpressionColumn(name_and_type.first, name_and_type.second));
   }
   std::unique_ptr<const zetasql::AnalyzerOutput> output;
-  FunctionCatalog function_catalog(type_factory);
-  Catalog catalog(schema, &function_catalog, type_factory);
+  Catalog catalog(schema, FunctionCatalog::Default(), type_factory);
 
   ZETASQL_RETURN_IF_ERROR(zetasql::AnalyzeExpressionForAssignmentToType(
       expression, options, &catalog, type_factory, target_type, &output));
@@ -204,8 +203,8 @@ absl::Status AnalyzeViewDefinition(
   // Analyze the view definition.
   auto analyzer_options = MakeGoogleSqlAnalyzerOptionsForViews();
   analyzer_options.set_prune_unused_columns(true);
-  FunctionCatalog function_catalog(type_factory);
-  Catalog catalog(schema, &function_catalog, type_factory, analyzer_options);
+  Catalog catalog(schema, FunctionCatalog::Default(), type_factory,
+                  analyzer_options);
   std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
   ZETASQL_RETURN_IF_ERROR(zetasql::AnalyzeStatement(body, analyzer_options, &catalog,
                                               type_factory, &analyzer_output));
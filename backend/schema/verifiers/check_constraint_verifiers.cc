@@ -17,52 +17,84 @@
 #include "backend/schema/verifiers/check_constraint_verifiers.h"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "backend/actions/check_constraint.h"
-#include "backend/datamodel/key_range.h"
+#include "backend/actions/prepared_expression_cache.h"
+#include "backend/common/ids.h"
 #include "backend/query/analyzer_options.h"
 #include "backend/query/catalog.h"
 #include "backend/query/function_catalog.h"
-#include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/table.h"
-#include "common/errors.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
 namespace emulator {
 namespace backend {
 
-absl::Status VerifyCheckConstraintData(const CheckConstraint* check_constraint,
-                                       const SchemaValidationContext* context) {
-  FunctionCatalog function_catalog(context->type_factory());
-  Catalog catalog(context->validated_new_schema(), &function_catalog,
-                  context->type_factory());
-  CheckConstraintVerifier verifier(check_constraint, &catalog);
-
-  const Table* table = check_constraint->table();
-  const Storage* storage = context->storage();
-  absl::Time timestamp = context->pending_commit_timestamp();
-  std::unique_ptr<StorageIterator> iterator;
-  std::vector<ColumnID> column_ids = GetColumnIDs(table->columns());
-  ZETASQL_RETURN_IF_ERROR(storage->Read(timestamp, table->id(), KeyRange::All(),
-                                column_ids, &iterator));
+namespace {
 
-  // Loop through every row of the table and validate the check constraints.
-  while (iterator->Next()) {
-    zetasql::ParameterValueMap row_column_values;
-    for (int i = 0; i < iterator->NumColumns(); ++i) {
-      // Storage returns invalid values if a value is not present, in which case
-      // we convert it into a typed NULL.
-      row_column_values[table->columns()[i]->Name()] =
-          iterator->ColumnValue(i).is_valid()
-              ? iterator->ColumnValue(i)
-              : zetasql::Value::Null(table->columns()[i]->GetType());
+// Verifies the check constraint against the rows of a scan of its table.
+class CheckConstraintVerifierConsumer : public TableScanConsumer {
+ public:
+  CheckConstraintVerifierConsumer(const CheckConstraint* check_constraint,
+                                  const SchemaValidationContext* context)
+      : check_constraint_(check_constraint),
+        catalog_(context->validated_new_schema(), FunctionCatalog::Default(),
+                 context->type_factory()),
+        verifier_(check_constraint, &catalog_, &expression_cache_) {}
+
+  const Table* table() const override { return check_constraint_->table(); }
+
+  void Start(absl::Span<const ColumnID> scan_columns,
+             int num_partitions) override {
+    column_names_ = ScanColumnNames(table(), scan_columns);
+  }
+
+  absl::Status Consume(int partition, TableScanBatch* batch) override {
+    return verifier_.VerifyRows(column_names_, batch->column_values,
+                                batch->keys);
+  }
+
+  absl::Status Finish(
+      absl::Span<const absl::Status> partition_statuses) override {
+    // Report the error of the first partition which failed, as for a serial
+    // scan.
+    for (const absl::Status& status : partition_statuses) {
+      ZETASQL_RETURN_IF_ERROR(status);
     }
-    ZETASQL_RETURN_IF_ERROR(verifier.VerifyRow(row_column_values, iterator->Key()));
+    return absl::OkStatus();
   }
-  return iterator->Status();
+
+ private:
+  const CheckConstraint* check_constraint_;
+  Catalog catalog_;
+  PreparedExpressionCache expression_cache_;
+  CheckConstraintVerifier verifier_;
+
+  // The names of the scanned columns.
+  std::vector<std::string> column_names_;
+};
+
+}  // namespace
+
+std::unique_ptr<TableScanConsumer> MakeCheckConstraintVerifierConsumer(
+    const CheckConstraint* check_constraint,
+    const SchemaValidationContext* context) {
+  return std::make_unique<CheckConstraintVerifierConsumer>(check_constraint,
+                                                           context);
+}
+
+absl::Status VerifyCheckConstraintData(const CheckConstraint* check_constraint,
+                                       const SchemaValidationContext* context) {
+  // Loop through every row of the table and validate the check constraints.
+  return RunTableScanAction(
+      context,
+      MakeCheckConstraintVerifierConsumer(check_constraint, context).get());
 }
 
 }  // namespace backend
@@ -17,6 +17,9 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_VERIFIERS_CHECK_CONSTRAINT_VERIFIER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_VERIFIERS_CHECK_CONSTRAINT_VERIFIER_H_
 
+#include <memory>
+
+#include "backend/schema/backfills/table_scan.h"
 #include "backend/schema/catalog/check_constraint.h"
 #include "backend/schema/updater/schema_validation_context.h"
 #include "absl/status/status.h"
@@ -30,6 +33,12 @@ namespace backend {
 absl::Status VerifyCheckConstraintData(const CheckConstraint* check_constraint,
                                        const SchemaValidationContext* context);
 
+// Returns a consumer which verifies the check constraint against a scan of its
+// table, which may be shared with other schema change actions.
+std::unique_ptr<TableScanConsumer> MakeCheckConstraintVerifierConsumer(
+    const CheckConstraint* check_constraint,
+    const SchemaValidationContext* context);
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -16,10 +16,12 @@
 
 #include "backend/schema/verifiers/column_value_verifiers.h"
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "zetasql/public/functions/string.h"
 #include "zetasql/public/type.pb.h"
@@ -40,6 +42,7 @@
 #include "backend/schema/updater/schema_validation_context.h"
 #include "backend/storage/in_memory_storage.h"
 #include "backend/storage/iterator.h"
+#include "backend/storage/partitioned_scan.h"
 #include "common/errors.h"
 #include "common/limits.h"
 #include "absl/status/status.h"
@@ -52,22 +55,44 @@ namespace backend {
 
 namespace {
 
+// Calls verifier with the value of column in each row of table, streaming the
+// rows of each partition of the table in parallel. Returns the error of the
+// first row, in key order, which fails verification. Once a partition fails,
+// the partitions after it stop, as their errors would not be reported.
 absl::Status VerifyColumnValue(
     const SchemaValidationContext* context, const Table* table,
     const Column* column,
     const std::function<absl::Status(const zetasql::Value& column_value,
                                      const Key& key)>& verifier) {
-  std::unique_ptr<StorageIterator> itr;
-  ZETASQL_RETURN_IF_ERROR(context->storage()->Read(context->pending_commit_timestamp(),
-                                           table->id(), KeyRange::All(),
-                                           {column->id()}, &itr));
-
-  while (itr->Next()) {
-    for (int i = 0; i < itr->NumColumns(); ++i) {
-      ZETASQL_RETURN_IF_ERROR(verifier(itr->ColumnValue(i), itr->Key()));
-    }
-  }
-  return absl::OkStatus();
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<KeyRange> partitions,
+                   PartitionTableScan(context->storage(),
+                                      context->pending_commit_timestamp(),
+                                      table->id()));
+  std::atomic<int> first_failed_partition = partitions.size();
+  return ScanPartitionsInParallel(
+      partitions, [&](int i, const KeyRange& key_range) -> absl::Status {
+        std::unique_ptr<StorageIterator> itr;
+        ZETASQL_RETURN_IF_ERROR(context->storage()->Read(
+            context->pending_commit_timestamp(), table->id(), key_range,
+            {column->id()}, &itr));
+        absl::Status status;
+        while (status.ok() && first_failed_partition.load() > i &&
+               itr->Next()) {
+          for (int j = 0; j < itr->NumColumns() && status.ok(); ++j) {
+            status = verifier(itr->ColumnValue(j), itr->Key());
+          }
+        }
+        if (status.ok()) {
+          status = itr->Status();
+        }
+        if (!status.ok()) {
+          int failed = first_failed_partition.load();
+          while (failed > i &&
+                 !first_failed_partition.compare_exchange_weak(failed, i)) {
+          }
+        }
+        return status;
+      });
 }
 
 absl::Status VerifyStringColumnValue(absl::string_view table_name,
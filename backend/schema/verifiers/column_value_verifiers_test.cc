@@ -16,6 +16,7 @@
 
 #include "backend/schema/verifiers/column_value_verifiers.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,6 +29,7 @@
 #include "tests/common/proto_matchers.h"
 #include "absl/types/span.h"
 #include "backend/database/database.h"
+#include "backend/storage/partitioned_scan.h"
 #include "common/clock.h"
 #include "common/errors.h"
 
@@ -170,6 +172,28 @@ TEST_F(ColumnValueVerifiersTest, VerifyColumnTypeChange) {
       error::InvalidColumnSizeReduction("string_col", 10, 15, "{Int64(2)}"));
 }
 
+TEST_F(ColumnValueVerifiersTest, ReportsFirstViolationOfLargeTable) {
+  // Enough rows for the table to be verified in several partitions, each of
+  // which has values that are too long.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadWriteTransaction> txn,
+                       database_->CreateReadWriteTransaction(
+                           ReadWriteOptions(), RetryState()));
+  Mutation m;
+  for (int64_t i = 10; i < 10 + 16 * kMinRowsPerScanPartition; ++i) {
+    m.AddWriteOp(MutationOpType::kInsert, "TestTable",
+                 {"int64_col", "string_col"},
+                 {{Int64(i), String("another-long-value")}});
+  }
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  EXPECT_EQ(
+      UpdateSchema({R"(
+    ALTER TABLE TestTable ALTER COLUMN string_col STRING(10)
+  )"}),
+      error::InvalidColumnSizeReduction("string_col", 10, 15, "{Int64(2)}"));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -19,14 +19,22 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "zetasql/public/value.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/schema/catalog/foreign_key.h"
 #include "backend/schema/catalog/index.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/partitioned_scan.h"
 #include "common/errors.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
@@ -45,6 +53,20 @@ std::vector<ColumnID> DataColumnIds(const Table* data_table, int column_count) {
                                column_ids.begin() + column_count);
 }
 
+// Returns true if the first column_count key columns of both data tables sort
+// in the same direction, so that scans of both return the constraint keys in
+// the same order.
+bool KeysSortAlike(const Table* referencing_data_table,
+                   const Table* referenced_data_table, int column_count) {
+  for (int i = 0; i < column_count; ++i) {
+    if (referencing_data_table->primary_key()[i]->is_descending() !=
+        referenced_data_table->primary_key()[i]->is_descending()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 absl::Status VerifyForeignKeyData(const ForeignKey* foreign_key,
@@ -53,28 +75,70 @@ absl::Status VerifyForeignKeyData(const ForeignKey* foreign_key,
   absl::Time timestamp = context->pending_commit_timestamp();
   int column_count = foreign_key->referencing_columns().size();
   TableID referenced_data_table_id = foreign_key->referenced_data_table()->id();
-  std::unique_ptr<StorageIterator> referencing_iterator;
-  ZETASQL_RETURN_IF_ERROR(storage->Read(
-      timestamp, foreign_key->referencing_data_table()->id(), KeyRange::All(),
-      DataColumnIds(foreign_key->referencing_data_table(), column_count),
-      &referencing_iterator));
-  while (referencing_iterator->Next()) {
-    Key constraint_key(std::vector<zetasql::Value>(
-        referencing_iterator->Key().column_values().begin(),
-        referencing_iterator->Key().column_values().begin() + column_count));
-    std::unique_ptr<StorageIterator> referenced_iterator;
-    ZETASQL_RETURN_IF_ERROR(storage->Read(timestamp, referenced_data_table_id,
-                                  KeyRange::Point(constraint_key), {},
-                                  &referenced_iterator));
-    if (!referenced_iterator->Next() && referenced_iterator->Status().ok()) {
-      return error::ForeignKeyReferencedKeyNotFound(
-          foreign_key->Name(), foreign_key->referencing_table()->Name(),
-          foreign_key->referenced_table()->Name(),
-          constraint_key.DebugString());
-    }
-    ZETASQL_RETURN_IF_ERROR(referenced_iterator->Status());
-  }
-  return referencing_iterator->Status();
+  const Table* referencing_data_table = foreign_key->referencing_data_table();
+  std::vector<ColumnID> referencing_column_ids =
+      DataColumnIds(referencing_data_table, column_count);
+  const bool merge_keys = KeysSortAlike(
+      referencing_data_table, foreign_key->referenced_data_table(),
+      column_count);
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::vector<KeyRange> partitions,
+      PartitionTableScan(storage, timestamp, referencing_data_table->id()));
+  return ScanPartitionsInParallel(
+      partitions, [&](int, const KeyRange& key_range) -> absl::Status {
+        std::unique_ptr<StorageIterator> referencing_iterator;
+        ZETASQL_RETURN_IF_ERROR(storage->Read(timestamp, referencing_data_table->id(),
+                                      key_range, referencing_column_ids,
+                                      &referencing_iterator));
+        // When both data tables return the constraint keys in the same order,
+        // the referenced data table is read once, merged with the referencing
+        // rows, rather than looked up for each of them.
+        std::unique_ptr<StorageIterator> referenced_iterator;
+        bool has_referenced_row = false;
+        std::optional<Key> previous_key;
+        while (referencing_iterator->Next()) {
+          Key key = referencing_iterator->Key().Prefix(column_count);
+          if (previous_key.has_value() && key == *previous_key) {
+            continue;
+          }
+          absl::Span<const zetasql::Value> referencing_values =
+              key.column_values();
+          Key constraint_key(std::vector<zetasql::Value>(
+              referencing_values.begin(), referencing_values.end()));
+          bool found;
+          if (merge_keys) {
+            if (referenced_iterator == nullptr) {
+              ZETASQL_RETURN_IF_ERROR(storage->Read(
+                  timestamp, referenced_data_table_id,
+                  KeyRange::ClosedOpen(key, Key::Infinity()), {},
+                  &referenced_iterator));
+              has_referenced_row = referenced_iterator->Next();
+            }
+            while (has_referenced_row &&
+                   referenced_iterator->Key().Prefix(column_count) < key) {
+              has_referenced_row = referenced_iterator->Next();
+            }
+            ZETASQL_RETURN_IF_ERROR(referenced_iterator->Status());
+            found = has_referenced_row &&
+                    referenced_iterator->Key().Prefix(column_count) == key;
+          } else {
+            std::unique_ptr<StorageIterator> point_iterator;
+            ZETASQL_RETURN_IF_ERROR(storage->Read(timestamp, referenced_data_table_id,
+                                          KeyRange::Point(constraint_key), {},
+                                          &point_iterator));
+            found = point_iterator->Next();
+            ZETASQL_RETURN_IF_ERROR(point_iterator->Status());
+          }
+          if (!found) {
+            return error::ForeignKeyReferencedKeyNotFound(
+                foreign_key->Name(), foreign_key->referencing_table()->Name(),
+                foreign_key->referenced_table()->Name(),
+                constraint_key.DebugString());
+          }
+          previous_key = std::move(key);
+        }
+        return referencing_iterator->Status();
+      });
 }
 
 }  // namespace backend
@@ -123,6 +123,25 @@ TEST_F(ForeignKeyVerifiersTest, InvalidExistingData) {
   EXPECT_THAT(AddForeignKey(), StatusIs(absl::StatusCode::kFailedPrecondition));
 }
 
+TEST_F(ForeignKeyVerifiersTest, ReferencingRowsShareAndSkipReferencedKeys) {
+  for (int i = 1; i <= 5; ++i) {
+    Insert("T", {"A", "B", "C"}, {i, i, i});
+  }
+  Insert("U", {"X", "Y", "Z"}, {1, 1, 1});
+  Insert("U", {"X", "Y", "Z"}, {2, 1, 1});
+  Insert("U", {"X", "Y", "Z"}, {3, 4, 4});
+  ZETASQL_EXPECT_OK(AddForeignKey());
+}
+
+TEST_F(ForeignKeyVerifiersTest, MissingKeyBetweenReferencedKeys) {
+  Insert("T", {"A", "B", "C"}, {1, 1, 1});
+  Insert("T", {"A", "B", "C"}, {3, 3, 3});
+  Insert("U", {"X", "Y", "Z"}, {1, 1, 1});
+  Insert("U", {"X", "Y", "Z"}, {2, 2, 2});
+  Insert("U", {"X", "Y", "Z"}, {3, 3, 3});
+  EXPECT_THAT(AddForeignKey(), StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
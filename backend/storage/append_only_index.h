@@ -0,0 +1,136 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_APPEND_ONLY_INDEX_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_APPEND_ONLY_INDEX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// AppendOnlyIndex maps strings to pointers, such as the ids of tables to their
+// storage. Entries are only ever added, never changed or removed, which lets
+// Find run without any lock concurrently with Insert.
+//
+// The entries are held in an open-addressing table of atomic pointers which is
+// at most half full. Insert stores each new entry with release semantics, and
+// Find loads entries with acquire semantics, so a reader which finds an entry
+// also sees its contents. Once the table would be more than half full, Insert
+// builds one twice as large and publishes it in the same way. Readers may
+// still be probing the table it replaces, so replaced tables are only freed
+// with the index; their total size is less than that of the current one.
+//
+// Find is thread-safe. Calls to Insert must be serialized by the caller.
+template <typename T>
+class AppendOnlyIndex {
+ public:
+  AppendOnlyIndex() { Grow(kMinCapacity); }
+
+  AppendOnlyIndex(const AppendOnlyIndex&) = delete;
+  AppendOnlyIndex& operator=(const AppendOnlyIndex&) = delete;
+
+  // Returns the pointer added for key, or nullptr if there is none.
+  T* Find(absl::string_view key) const {
+    const Slots* slots = slots_.load(std::memory_order_acquire);
+    const size_t mask = slots->capacity - 1;
+    for (size_t i = absl::Hash<absl::string_view>()(key) & mask;;
+         i = (i + 1) & mask) {
+      const Entry* entry = slots->entries[i].load(std::memory_order_acquire);
+      if (entry == nullptr) {
+        return nullptr;
+      }
+      if (entry->key == key) {
+        return entry->value;
+      }
+    }
+  }
+
+  // Adds value for key, which must not have been added before.
+  void Insert(std::string key, T* value) {
+    if (2 * (entries_.size() + 1) > slots_.load()->capacity) {
+      Grow(2 * slots_.load()->capacity);
+    }
+    entries_.push_back(std::make_unique<Entry>(Entry{std::move(key), value}));
+    Place(entries_.back().get(), slots_.load());
+  }
+
+ private:
+  static constexpr size_t kMinCapacity = 16;
+
+  struct Entry {
+    const std::string key;
+    T* const value;
+  };
+
+  struct Slots {
+    explicit Slots(size_t capacity)
+        : capacity(capacity),
+          entries(std::make_unique<std::atomic<const Entry*>[]>(capacity)) {}
+
+    const size_t capacity;
+    std::unique_ptr<std::atomic<const Entry*>[]> entries;
+  };
+
+  // Stores entry in the first free slot of its probe sequence in slots.
+  static void Place(const Entry* entry, Slots* slots) {
+    const size_t mask = slots->capacity - 1;
+    size_t i = absl::Hash<absl::string_view>()(entry->key) & mask;
+    while (slots->entries[i].load(std::memory_order_relaxed) != nullptr) {
+      i = (i + 1) & mask;
+    }
+    slots->entries[i].store(entry, std::memory_order_release);
+  }
+
+  // Publishes a table of the given capacity holding every entry.
+  void Grow(size_t capacity) {
+    auto slots = std::make_unique<Slots>(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+      slots->entries[i].store(nullptr, std::memory_order_relaxed);
+    }
+    for (const auto& entry : entries_) {
+      Place(entry.get(), slots.get());
+    }
+    slots_.store(slots.get(), std::memory_order_release);
+    tables_.push_back(std::move(slots));
+  }
+
+  // Every entry, in the order they were added.
+  std::vector<std::unique_ptr<const Entry>> entries_;
+
+  // Every table ever published, the last of which is current.
+  std::vector<std::unique_ptr<Slots>> tables_;
+
+  // The current table.
+  std::atomic<Slots*> slots_{nullptr};
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_APPEND_ONLY_INDEX_H_
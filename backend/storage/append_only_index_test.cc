@@ -0,0 +1,86 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/append_only_index.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+TEST(AppendOnlyIndexTest, FindsInsertedKeys) {
+  constexpr int kNumKeys = 1000;
+  std::vector<int> values(kNumKeys);
+  AppendOnlyIndex<int> index;
+  EXPECT_EQ(index.Find("key0"), nullptr);
+  for (int i = 0; i < kNumKeys; ++i) {
+    index.Insert(absl::StrCat("key", i), &values[i]);
+  }
+  for (int i = 0; i < kNumKeys; ++i) {
+    EXPECT_EQ(index.Find(absl::StrCat("key", i)), &values[i]);
+  }
+  EXPECT_EQ(index.Find("key1000"), nullptr);
+  EXPECT_EQ(index.Find(""), nullptr);
+}
+
+TEST(AppendOnlyIndexTest, FindsKeysWhileInserting) {
+  constexpr int kNumKeys = 10000;
+  std::vector<int> values(kNumKeys);
+  AppendOnlyIndex<int> index;
+  std::atomic<int> num_inserted{0};
+  std::atomic<bool> mismatched{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&]() {
+      while (num_inserted.load() < kNumKeys) {
+        // Every key inserted before the load must be found.
+        int inserted = num_inserted.load();
+        for (int i = 0; i < inserted; i += 97) {
+          if (index.Find(absl::StrCat("key", i)) != &values[i]) {
+            mismatched = true;
+          }
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kNumKeys; ++i) {
+    index.Insert(absl::StrCat("key", i), &values[i]);
+    num_inserted.store(i + 1);
+  }
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  EXPECT_FALSE(mismatched);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
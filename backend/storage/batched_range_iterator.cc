@@ -0,0 +1,57 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/batched_range_iterator.h"
+
+#include <vector>
+
+#include "absl/status/status.h"
+#include "backend/datamodel/key_encoding.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_iterator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+BatchedRangeIterator::BatchedRangeIterator(const KeyRange& key_range,
+                                           int num_columns, bool reverse)
+    : start_key_(EncodeKey(key_range.start_key())),
+      limit_key_(EncodeKey(key_range.limit_key())),
+      num_columns_(num_columns),
+      reverse_(reverse) {}
+
+bool BatchedRangeIterator::Next() {
+  if (++pos_ < rows_.size()) {
+    return true;
+  }
+  if (exhausted_ || !status_.ok()) {
+    return false;
+  }
+  rows_.clear();
+  pos_ = 0;
+  status_ = FetchBatch(&rows_);
+  if (!status_.ok()) {
+    rows_.clear();
+  }
+  return !rows_.empty();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
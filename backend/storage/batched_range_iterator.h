@@ -0,0 +1,141 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_BATCHED_RANGE_ITERATOR_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_BATCHED_RANGE_ITERATOR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_iterator.h"
+#include "backend/storage/iterator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// BatchedRangeIterator is a StorageIterator over the rows of a key range of a
+// map keyed by encoded keys (see EncodeKey), which is guarded by a lock.
+//
+// The lock is only held while a batch of rows is fetched, so each batch resumes
+// from the last key of the previous one rather than from a map iterator. The
+// first batch is small so that reads which stop after a few rows, such as those
+// of queries with a LIMIT, copy few rows, and each batch after it is twice as
+// large up to kMaxBatchSize.
+//
+// Subclasses implement FetchBatch, which takes the lock and calls VisitBatch.
+// This class is not thread-safe.
+class BatchedRangeIterator : public StorageIterator {
+ public:
+  static constexpr size_t kInitialBatchSize = 16;
+  static constexpr size_t kMaxBatchSize = 256;
+
+  bool Next() override;
+  absl::Status Status() const override { return status_; }
+  const class Key& Key() const override { return rows_[pos_].first; }
+  int NumColumns() const override { return num_columns_; }
+  const zetasql::Value& ColumnValue(int i) const override {
+    return rows_[pos_].second[i];
+  }
+
+ protected:
+  // key_range is a ClosedOpen range, which the rows are iterated over in
+  // descending key order if reverse is true.
+  BatchedRangeIterator(const KeyRange& key_range, int num_columns,
+                       bool reverse);
+
+  // Appends the next batch of rows to rows, which is empty. An error ends the
+  // iteration, and is returned by Status.
+  virtual absl::Status FetchBatch(
+      std::vector<FixedRowStorageIterator::Row>* rows) = 0;
+
+  // Calls add_row(encoded_key, row), which returns whether it added the row to
+  // the batch, for the rows in the key range which follow the previous batch,
+  // until the batch is full. The caller must hold the lock guarding rows.
+  template <typename Row, typename AddRow>
+  void VisitBatch(const std::map<std::string, Row>& rows, AddRow add_row);
+
+ private:
+  const std::string start_key_;
+  const std::string limit_key_;
+  const int num_columns_;
+  const bool reverse_;
+
+  // The current batch of rows, and the position within it.
+  std::vector<FixedRowStorageIterator::Row> rows_;
+  size_t pos_ = 0;
+
+  // The encoded key after which the next batch starts (before which it ends
+  // for a reverse iterator), and its size.
+  std::optional<std::string> resume_key_;
+  size_t batch_size_ = kInitialBatchSize;
+
+  // True once the last batch in the key range has been fetched.
+  bool exhausted_ = false;
+
+  // The error which ended the iteration.
+  absl::Status status_;
+};
+
+template <typename Row, typename AddRow>
+void BatchedRangeIterator::VisitBatch(const std::map<std::string, Row>& rows,
+                                      AddRow add_row) {
+  std::optional<std::string> resume_key = std::move(resume_key_);
+  resume_key_.reset();
+  size_t num_added = 0;
+  if (reverse_) {
+    auto itr = rows.lower_bound(resume_key.value_or(limit_key_));
+    while (itr != rows.begin() && std::prev(itr)->first >= start_key_) {
+      --itr;
+      if (num_added == batch_size_) {
+        resume_key_ = std::next(itr)->first;
+        batch_size_ = std::min(2 * batch_size_, kMaxBatchSize);
+        return;
+      }
+      num_added += add_row(itr->first, itr->second) ? 1 : 0;
+    }
+  } else {
+    auto itr = resume_key.has_value() ? rows.upper_bound(*resume_key)
+                                      : rows.lower_bound(start_key_);
+    for (; itr != rows.end() && itr->first < limit_key_; ++itr) {
+      if (num_added == batch_size_) {
+        resume_key_ = std::prev(itr)->first;
+        batch_size_ = std::min(2 * batch_size_, kMaxBatchSize);
+        return;
+      }
+      num_added += add_row(itr->first, itr->second) ? 1 : 0;
+    }
+  }
+  exhausted_ = true;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_BATCHED_RANGE_ITERATOR_H_
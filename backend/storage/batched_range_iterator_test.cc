@@ -0,0 +1,154 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/batched_range_iterator.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_encoding.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_iterator.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using ::testing::ElementsAre;
+using zetasql::values::Int64;
+
+// A map of rows keyed by the encoding of a single INT64 key column.
+using TestRows = std::map<std::string, int64_t>;
+
+Key MakeKey(int64_t k) { return Key({Int64(k)}); }
+
+// Iterates over the rows of TestRows with even values, recording the number of
+// rows of each batch.
+class TestIterator : public BatchedRangeIterator {
+ public:
+  TestIterator(const TestRows* rows, const KeyRange& key_range, bool reverse)
+      : BatchedRangeIterator(key_range, /*num_columns=*/1, reverse),
+        rows_(rows) {}
+
+  std::vector<int> batch_sizes;
+  absl::Status fetch_status;
+
+ private:
+  absl::Status FetchBatch(
+      std::vector<FixedRowStorageIterator::Row>* rows) override {
+    ZETASQL_RETURN_IF_ERROR(fetch_status);
+    VisitBatch(*rows_, [&](const std::string& encoded_key, int64_t value) {
+      if (value % 2 != 0) {
+        return false;
+      }
+      rows->emplace_back(DecodeKey(encoded_key),
+                         std::vector<zetasql::Value>{Int64(value)});
+      return true;
+    });
+    batch_sizes.push_back(rows->size());
+    return absl::OkStatus();
+  }
+
+  const TestRows* rows_;
+};
+
+TestRows MakeRows(int64_t num_rows) {
+  TestRows rows;
+  for (int64_t k = 0; k < num_rows; ++k) {
+    rows[EncodeKey(MakeKey(k))] = k;
+  }
+  return rows;
+}
+
+std::vector<int64_t> ReadAll(TestIterator* itr) {
+  std::vector<int64_t> values;
+  while (itr->Next()) {
+    values.push_back(itr->ColumnValue(0).int64_value());
+  }
+  return values;
+}
+
+TEST(BatchedRangeIteratorTest, ReadsAddedRowsInKeyRange) {
+  TestRows rows = MakeRows(10);
+  TestIterator itr(&rows, KeyRange::ClosedOpen(MakeKey(3), MakeKey(9)),
+                   /*reverse=*/false);
+
+  EXPECT_THAT(ReadAll(&itr), ElementsAre(4, 6, 8));
+  ZETASQL_EXPECT_OK(itr.Status());
+}
+
+TEST(BatchedRangeIteratorTest, ReadsInReverse) {
+  TestRows rows = MakeRows(10);
+  TestIterator itr(&rows, KeyRange::ClosedOpen(MakeKey(2), MakeKey(8)),
+                   /*reverse=*/true);
+
+  EXPECT_THAT(ReadAll(&itr), ElementsAre(6, 4, 2));
+}
+
+TEST(BatchedRangeIteratorTest, GrowsBatches) {
+  TestRows rows = MakeRows(2000);
+  TestIterator itr(&rows, KeyRange::All(), /*reverse=*/false);
+
+  EXPECT_EQ(ReadAll(&itr).size(), 1000);
+  EXPECT_THAT(itr.batch_sizes, ElementsAre(16, 32, 64, 128, 256, 256, 248));
+}
+
+TEST(BatchedRangeIteratorTest, ResumesAfterLastKeyOfBatch) {
+  TestRows rows = MakeRows(100);
+  TestIterator itr(&rows, KeyRange::All(), /*reverse=*/false);
+  for (int i = 0; i < BatchedRangeIterator::kInitialBatchSize; ++i) {
+    ASSERT_TRUE(itr.Next());
+  }
+  EXPECT_EQ(itr.ColumnValue(0).int64_value(), 30);
+
+  // Rows changed between batches are seen by the next batch if they follow the
+  // last key of the previous one.
+  rows.erase(EncodeKey(MakeKey(32)));
+  rows[EncodeKey(MakeKey(0))] = 0;
+  ASSERT_TRUE(itr.Next());
+  EXPECT_EQ(itr.ColumnValue(0).int64_value(), 34);
+}
+
+TEST(BatchedRangeIteratorTest, StopsOnError) {
+  TestRows rows = MakeRows(100);
+  TestIterator itr(&rows, KeyRange::All(), /*reverse=*/false);
+  for (int i = 0; i < BatchedRangeIterator::kInitialBatchSize; ++i) {
+    ASSERT_TRUE(itr.Next());
+  }
+
+  itr.fetch_status = absl::InternalError("failed");
+  EXPECT_FALSE(itr.Next());
+  EXPECT_THAT(itr.Status(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kInternal));
+  EXPECT_FALSE(itr.Next());
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
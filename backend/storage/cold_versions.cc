@@ -0,0 +1,229 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/cold_versions.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.pb.h"
+#include "zetasql/public/value.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "zetasql/base/logging.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Reads a varint written by PutVarint from the front of in, which it consumes.
+uint64_t GetVarint(absl::string_view* in) {
+  uint64_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(in->front());
+    in->remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return value;
+    }
+  }
+}
+
+}  // namespace
+
+std::optional<ColdVersions> ColdVersions::Encode(
+    absl::Span<const Version> versions) {
+  if (versions.empty()) {
+    return std::nullopt;
+  }
+  ColdVersions block;
+  block.oldest_timestamp_ = versions.front().first;
+  block.latest_timestamp_ = versions.back().first;
+  block.num_versions_ = static_cast<int>(versions.size());
+
+  // Each valid value is encoded as its size plus one, the number of bytes it
+  // shares with the previous valid value and the bytes after them. An invalid
+  // value is encoded as a size of zero.
+  std::string timestamps;
+  std::string values;
+  std::string previous;
+  std::string serialized;
+  int64_t previous_nanos = absl::ToUnixNanos(block.oldest_timestamp_);
+  for (const auto& [timestamp, value] : versions) {
+    const int64_t nanos = absl::ToUnixNanos(timestamp);
+    if (absl::FromUnixNanos(nanos) != timestamp || nanos < previous_nanos) {
+      return std::nullopt;
+    }
+    PutVarint(static_cast<uint64_t>(nanos - previous_nanos), &timestamps);
+    previous_nanos = nanos;
+
+    if (!value.is_valid()) {
+      PutVarint(0, &values);
+      continue;
+    }
+    if (block.type_ == nullptr) {
+      block.type_ = value.type();
+    } else if (!value.type()->Equals(block.type_)) {
+      return std::nullopt;
+    }
+    zetasql::ValueProto value_proto;
+    if (!value.Serialize(&value_proto).ok() ||
+        !value_proto.SerializeToString(&serialized)) {
+      return std::nullopt;
+    }
+    const size_t shared =
+        std::mismatch(serialized.begin(),
+                      serialized.begin() +
+                          std::min(serialized.size(), previous.size()),
+                      previous.begin())
+            .first -
+        serialized.begin();
+    PutVarint(serialized.size() - shared + 1, &values);
+    PutVarint(shared, &values);
+    values.append(serialized, shared);
+    std::swap(previous, serialized);
+  }
+
+  block.timestamps_size_ = static_cast<int64_t>(timestamps.size());
+  block.data_ = std::move(timestamps);
+  block.data_.append(values);
+  block.data_.shrink_to_fit();
+  return block;
+}
+
+template <typename Predicate>
+int ColdVersions::CountWhile(Predicate before_or_at) const {
+  absl::string_view timestamps(data_.data(), timestamps_size_);
+  int64_t nanos = absl::ToUnixNanos(oldest_timestamp_);
+  int count = 0;
+  while (count < num_versions_) {
+    nanos += GetVarint(&timestamps);
+    if (!before_or_at(absl::FromUnixNanos(nanos))) {
+      break;
+    }
+    ++count;
+  }
+  return count;
+}
+
+template <typename Visitor>
+void ColdVersions::Visit(int n, Visitor visitor) const {
+  absl::string_view timestamps(data_.data(), timestamps_size_);
+  absl::string_view values = absl::string_view(data_).substr(timestamps_size_);
+  int64_t nanos = absl::ToUnixNanos(oldest_timestamp_);
+  std::string serialized;
+  for (int i = 0; i < n; ++i) {
+    nanos += GetVarint(&timestamps);
+    const uint64_t size_plus_one = GetVarint(&values);
+    if (size_plus_one == 0) {
+      visitor(i, absl::FromUnixNanos(nanos), nullptr);
+      continue;
+    }
+    const uint64_t shared = GetVarint(&values);
+    serialized.resize(shared);
+    serialized.append(values.data(), size_plus_one - 1);
+    values.remove_prefix(size_plus_one - 1);
+    visitor(i, absl::FromUnixNanos(nanos), &serialized);
+  }
+}
+
+zetasql::Value ColdVersions::ToValue(const std::string* serialized) const {
+  if (serialized == nullptr) {
+    return zetasql::Value();
+  }
+  zetasql::ValueProto value_proto;
+  ZETASQL_CHECK(value_proto.ParseFromString(*serialized));  // Crash OK
+  absl::StatusOr<zetasql::Value> value =
+      zetasql::Value::Deserialize(value_proto, type_);
+  ZETASQL_CHECK_OK(value.status());  // Crash OK
+  return *std::move(value);
+}
+
+std::vector<ColdVersions::Version> ColdVersions::Decode() const {
+  std::vector<Version> versions;
+  versions.reserve(num_versions_);
+  Visit(num_versions_, [&](int index, absl::Time timestamp,
+                           const std::string* serialized) {
+    versions.emplace_back(timestamp, ToValue(serialized));
+  });
+  return versions;
+}
+
+std::optional<ColdVersions::Version> ColdVersions::Find(
+    absl::Time timestamp) const {
+  const int count = CountAtOrBefore(timestamp);
+  if (count == 0) {
+    return std::nullopt;
+  }
+  std::optional<Version> version;
+  Visit(count, [&](int index, absl::Time version_timestamp,
+                   const std::string* serialized) {
+    if (index == count - 1) {
+      version.emplace(version_timestamp, ToValue(serialized));
+    }
+  });
+  return version;
+}
+
+int ColdVersions::CountBefore(absl::Time timestamp) const {
+  if (timestamp <= oldest_timestamp_) {
+    return 0;
+  }
+  if (timestamp > latest_timestamp_) {
+    return num_versions_;
+  }
+  return CountWhile([timestamp](absl::Time t) { return t < timestamp; });
+}
+
+int ColdVersions::CountAtOrBefore(absl::Time timestamp) const {
+  if (timestamp < oldest_timestamp_) {
+    return 0;
+  }
+  if (timestamp >= latest_timestamp_) {
+    return num_versions_;
+  }
+  return CountWhile([timestamp](absl::Time t) { return t <= timestamp; });
+}
+
+std::optional<ColdVersions> ColdVersions::DropOldest(int n) const {
+  if (n >= num_versions_) {
+    return std::nullopt;
+  }
+  const std::vector<Version> versions = Decode();
+  return Encode(absl::MakeConstSpan(versions).subspan(std::max(n, 0)));
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,118 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COLD_VERSIONS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COLD_VERSIONS_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// ColdVersions holds the older versions of a cell in a single encoded block,
+// so that a frequently updated cell does not keep a zetasql::Value and B-tree
+// slot for each of the versions which only stale reads can see.
+//
+// Timestamps are encoded as the nanoseconds since the previous version, and
+// each value as its serialized zetasql::ValueProto, stored as the number of
+// leading bytes it shares with the previous value and the bytes after them.
+// Successive versions of a cell tend to be similar, so they share most bytes.
+// The timestamps are stored ahead of the values, so that finding a version
+// scans only the timestamps and the values before it.
+//
+// A block is immutable and thread-safe.
+class ColdVersions {
+ public:
+  // A timestamp and the value of the cell from then on.
+  using Version = std::pair<absl::Time, zetasql::Value>;
+
+  // Encodes versions, which are in increasing order of timestamp. Returns
+  // nullopt if versions is empty, if its valid values are not all of the same
+  // type, or if one cannot be encoded, e.g. as its timestamp is not a whole
+  // number of nanoseconds.
+  static std::optional<ColdVersions> Encode(absl::Span<const Version> versions);
+
+  // Returns every version, oldest first.
+  std::vector<Version> Decode() const;
+
+  // Returns the latest version at or before timestamp, or nullopt if every
+  // version is later.
+  std::optional<Version> Find(absl::Time timestamp) const;
+
+  // Returns the number of versions before, or at or before, timestamp.
+  int CountBefore(absl::Time timestamp) const;
+  int CountAtOrBefore(absl::Time timestamp) const;
+
+  // Returns the block of the versions after the oldest n, or nullopt if there
+  // are none.
+  std::optional<ColdVersions> DropOldest(int n) const;
+
+  absl::Time oldest_timestamp() const { return oldest_timestamp_; }
+  absl::Time latest_timestamp() const { return latest_timestamp_; }
+  int num_versions() const { return num_versions_; }
+
+  // Returns an estimate of the memory used by the block.
+  int64_t size_bytes() const {
+    return sizeof(ColdVersions) + static_cast<int64_t>(data_.capacity());
+  }
+
+ private:
+  ColdVersions() = default;
+
+  // Returns the number of versions at timestamps for which before_or_at
+  // returns true, which it does for a prefix of the timestamps.
+  template <typename Predicate>
+  int CountWhile(Predicate before_or_at) const;
+
+  // Calls visitor with the index, timestamp and serialized value of each of
+  // the oldest n versions, oldest first. The serialized value is nullptr for
+  // invalid values.
+  template <typename Visitor>
+  void Visit(int n, Visitor visitor) const;
+
+  // Returns the value serialized as serialized, or an invalid value if it is
+  // nullptr.
+  zetasql::Value ToValue(const std::string* serialized) const;
+
+  // The type of every valid value, or nullptr if there are none.
+  const zetasql::Type* type_ = nullptr;
+  absl::Time oldest_timestamp_;
+  absl::Time latest_timestamp_;
+  int num_versions_ = 0;
+
+  // The encoded timestamps, followed by the encoded values from
+  // timestamps_size_ on.
+  std::string data_;
+  int64_t timestamps_size_ = 0;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COLD_VERSIONS_H_
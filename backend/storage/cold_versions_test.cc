@@ -0,0 +1,115 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/cold_versions.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::NullString;
+using zetasql::values::String;
+using ::testing::ElementsAreArray;
+using ::testing::Optional;
+using ::testing::Pair;
+
+using Version = ColdVersions::Version;
+
+absl::Time T(int64_t micros) { return absl::FromUnixMicros(micros); }
+
+TEST(ColdVersionsTest, DecodesEncodedVersions) {
+  const std::vector<Version> versions = {
+      {T(1), String("status: pending")},
+      {T(5), String("status: active")},
+      {T(6), zetasql::Value()},
+      {T(90), NullString()},
+      {T(1000), String("status: active, archived")}};
+  std::optional<ColdVersions> block = ColdVersions::Encode(versions);
+  ASSERT_TRUE(block.has_value());
+
+  EXPECT_THAT(block->Decode(), ElementsAreArray(versions));
+  EXPECT_EQ(block->num_versions(), 5);
+  EXPECT_EQ(block->oldest_timestamp(), T(1));
+  EXPECT_EQ(block->latest_timestamp(), T(1000));
+}
+
+TEST(ColdVersionsTest, FindsLatestVersionAtOrBeforeTimestamp) {
+  std::optional<ColdVersions> block = ColdVersions::Encode(
+      {{T(10), Int64(1)}, {T(20), Int64(2)}, {T(30), Int64(3)}});
+  ASSERT_TRUE(block.has_value());
+
+  EXPECT_EQ(block->Find(T(9)), std::nullopt);
+  EXPECT_THAT(block->Find(T(10)), Optional(Pair(T(10), Int64(1))));
+  EXPECT_THAT(block->Find(T(29)), Optional(Pair(T(20), Int64(2))));
+  EXPECT_THAT(block->Find(T(31)), Optional(Pair(T(30), Int64(3))));
+
+  EXPECT_EQ(block->CountBefore(T(20)), 1);
+  EXPECT_EQ(block->CountAtOrBefore(T(20)), 2);
+  EXPECT_EQ(block->CountBefore(T(31)), 3);
+}
+
+TEST(ColdVersionsTest, DropsOldestVersions) {
+  std::optional<ColdVersions> block = ColdVersions::Encode(
+      {{T(10), Int64(1)}, {T(20), Int64(2)}, {T(30), Int64(3)}});
+  ASSERT_TRUE(block.has_value());
+
+  std::optional<ColdVersions> dropped = block->DropOldest(2);
+  ASSERT_TRUE(dropped.has_value());
+  EXPECT_THAT(dropped->Decode(),
+              ElementsAreArray(std::vector<Version>{{T(30), Int64(3)}}));
+  EXPECT_FALSE(block->DropOldest(3).has_value());
+}
+
+TEST(ColdVersionsTest, IsSmallerThanTheValuesOfSimilarVersions) {
+  std::vector<Version> versions;
+  int64_t value_bytes = 0;
+  for (int i = 0; i < 100; ++i) {
+    versions.emplace_back(T(1000 * i),
+                          String(absl::StrCat("a long description, rev ", i)));
+    value_bytes +=
+        sizeof(Version) + versions.back().second.physical_byte_size();
+  }
+  std::optional<ColdVersions> block = ColdVersions::Encode(versions);
+  ASSERT_TRUE(block.has_value());
+  EXPECT_LT(block->size_bytes(), value_bytes / 4);
+}
+
+TEST(ColdVersionsTest, RejectsVersionsItCannotEncode) {
+  EXPECT_FALSE(ColdVersions::Encode({}).has_value());
+  EXPECT_FALSE(ColdVersions::Encode({{T(1), Int64(1)}, {T(2), String("1")}})
+                   .has_value());
+  EXPECT_FALSE(
+      ColdVersions::Encode({{absl::InfinitePast(), Int64(1)}}).has_value());
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,113 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/commit_timestamp_index.h"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+void CommitTimestampIndex::Record(const TableID& table_id, const Key& key,
+                                  absl::Time commit_timestamp) {
+  absl::MutexLock lock(&mu_);
+  auto [table_itr, inserted] = tables_.try_emplace(table_id);
+  TableKeys& table = table_itr->second;
+  if (inserted) {
+    table.covered_from = start_;
+  }
+  auto [key_itr, key_inserted] =
+      table.written_at.try_emplace(key, commit_timestamp);
+  if (!key_inserted) {
+    // Commits may be flushed out of timestamp order, so only a later write
+    // replaces the recorded one.
+    if (key_itr->second >= commit_timestamp) {
+      return;
+    }
+    table.by_timestamp.erase({key_itr->second, key});
+    key_itr->second = commit_timestamp;
+  }
+  table.by_timestamp.emplace(commit_timestamp, key);
+}
+
+void CommitTimestampIndex::Erase(const TableID& table_id,
+                                 absl::Time timestamp) {
+  absl::MutexLock lock(&mu_);
+  auto [table_itr, inserted] = tables_.try_emplace(table_id);
+  TableKeys& table = table_itr->second;
+  table.covered_from =
+      std::max(inserted ? start_ : table.covered_from, timestamp);
+  table.written_at.clear();
+  table.by_timestamp.clear();
+}
+
+void CommitTimestampIndex::CollectGarbage(absl::Time horizon) {
+  absl::MutexLock lock(&mu_);
+  start_ = std::max(start_, horizon);
+  for (auto itr = tables_.begin(); itr != tables_.end();) {
+    TableKeys& table = itr->second;
+    table.covered_from = std::max(table.covered_from, horizon);
+    while (!table.by_timestamp.empty() &&
+           table.by_timestamp.begin()->first <= horizon) {
+      table.written_at.erase(table.by_timestamp.begin()->second);
+      table.by_timestamp.erase(table.by_timestamp.begin());
+    }
+    if (table.by_timestamp.empty() && table.covered_from <= start_) {
+      tables_.erase(itr++);
+    } else {
+      ++itr;
+    }
+  }
+}
+
+std::optional<std::vector<Key>> CommitTimestampIndex::KeysWrittenAfter(
+    const TableID& table_id, absl::Time since) const {
+  absl::MutexLock lock(&mu_);
+  auto table_itr = tables_.find(table_id);
+  if (table_itr == tables_.end()) {
+    if (since < start_) {
+      return std::nullopt;
+    }
+    return std::vector<Key>();
+  }
+  const TableKeys& table = table_itr->second;
+  if (since < table.covered_from) {
+    return std::nullopt;
+  }
+  std::vector<Key> keys;
+  auto itr = table.by_timestamp.lower_bound({since, Key::Empty()});
+  for (; itr != table.by_timestamp.end(); ++itr) {
+    if (itr->first > since) {
+      keys.push_back(itr->second);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COMMIT_TIMESTAMP_INDEX_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COMMIT_TIMESTAMP_INDEX_H_
+
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// CommitTimestampIndex records the timestamp of the last commit which wrote
+// each key of a table, so that queries for the rows changed since a timestamp,
+// such as
+//
+//   SELECT ... FROM T WHERE LastUpdated > @since
+//
+// on a column which allows commit timestamps, can point read the keys written
+// after since instead of scanning the whole table. This is sound because such a
+// column never holds a value later than the commit which wrote it: a row whose
+// value is later than since was written by a commit later than since.
+//
+// The index of a table covers a timestamp if every key written by a commit
+// later than it is recorded. Writes which bypass the commit path, such as
+// restores and bulk loads, must Erase the tables they change before applying
+// their writes, and garbage collection drops the keys written at or before its
+// horizon, so that each only leaves later timestamps covered.
+//
+// This class is thread-safe.
+class CommitTimestampIndex {
+ public:
+  // The index covers every timestamp from start on, for tables which have no
+  // rows written before start.
+  explicit CommitTimestampIndex(absl::Time start) : start_(start) {}
+
+  // Records that the key of table_id was written (or deleted) by the commit at
+  // commit_timestamp.
+  void Record(const TableID& table_id, const Key& key,
+              absl::Time commit_timestamp) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Discards the keys of table_id, which is written outside the commit path at
+  // timestamp, so that only later timestamps remain covered.
+  void Erase(const TableID& table_id, absl::Time timestamp)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Discards the keys last written at or before horizon, after which earlier
+  // timestamps are no longer covered.
+  void CollectGarbage(absl::Time horizon) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the keys of table_id written by commits later than since, in key
+  // order, or nullopt if the index does not cover since. The keys may include
+  // rows which have been deleted since.
+  std::optional<std::vector<Key>> KeysWrittenAfter(const TableID& table_id,
+                                                   absl::Time since) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct TableKeys {
+    // The earliest timestamp covered for the table.
+    absl::Time covered_from;
+
+    // The timestamp of the last write of each key, and the same entries
+    // ordered by timestamp.
+    std::map<Key, absl::Time> written_at;
+    std::set<std::pair<absl::Time, Key>> by_timestamp;
+  };
+
+  mutable absl::Mutex mu_;
+
+  // The earliest timestamp covered for tables with no keys recorded.
+  absl::Time start_ ABSL_GUARDED_BY(mu_);
+
+  absl::flat_hash_map<TableID, TableKeys> tables_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COMMIT_TIMESTAMP_INDEX_H_
@@ -0,0 +1,106 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/commit_timestamp_index.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/public/value.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Optional;
+
+const absl::Time kStart = absl::FromUnixSeconds(1'700'000'000);
+
+Key MakeKey(int64_t value) {
+  return Key({zetasql::values::Int64(value)});
+}
+
+TEST(CommitTimestampIndexTest, ReturnsKeysWrittenAfterTimestampInKeyOrder) {
+  CommitTimestampIndex index(kStart);
+  index.Record("t1", MakeKey(3), kStart + absl::Seconds(1));
+  index.Record("t1", MakeKey(1), kStart + absl::Seconds(2));
+  index.Record("t1", MakeKey(2), kStart + absl::Seconds(3));
+  index.Record("t2", MakeKey(4), kStart + absl::Seconds(3));
+
+  EXPECT_THAT(index.KeysWrittenAfter("t1", kStart),
+              Optional(ElementsAre(MakeKey(1), MakeKey(2), MakeKey(3))));
+  EXPECT_THAT(index.KeysWrittenAfter("t1", kStart + absl::Seconds(1)),
+              Optional(ElementsAre(MakeKey(1), MakeKey(2))));
+  EXPECT_THAT(index.KeysWrittenAfter("t1", kStart + absl::Seconds(3)),
+              Optional(IsEmpty()));
+  EXPECT_THAT(index.KeysWrittenAfter("t3", kStart), Optional(IsEmpty()));
+}
+
+TEST(CommitTimestampIndexTest, KeepsTheLastWriteOfEachKey) {
+  CommitTimestampIndex index(kStart);
+  index.Record("t1", MakeKey(1), kStart + absl::Seconds(1));
+  index.Record("t1", MakeKey(1), kStart + absl::Seconds(3));
+  // A commit flushed after a later one does not replace it.
+  index.Record("t1", MakeKey(1), kStart + absl::Seconds(2));
+
+  EXPECT_THAT(index.KeysWrittenAfter("t1", kStart + absl::Seconds(2)),
+              Optional(ElementsAre(MakeKey(1))));
+}
+
+TEST(CommitTimestampIndexTest, DoesNotCoverTimestampsBeforeStartOrErase) {
+  CommitTimestampIndex index(kStart);
+  EXPECT_EQ(index.KeysWrittenAfter("t1", kStart - absl::Seconds(1)),
+            std::nullopt);
+
+  index.Record("t1", MakeKey(1), kStart + absl::Seconds(1));
+  index.Erase("t1", kStart + absl::Seconds(2));
+  EXPECT_EQ(index.KeysWrittenAfter("t1", kStart + absl::Seconds(1)),
+            std::nullopt);
+  EXPECT_THAT(index.KeysWrittenAfter("t1", kStart + absl::Seconds(2)),
+              Optional(IsEmpty()));
+
+  // Other tables are still covered.
+  EXPECT_THAT(index.KeysWrittenAfter("t2", kStart), Optional(IsEmpty()));
+}
+
+TEST(CommitTimestampIndexTest, GarbageCollectionDropsKeysAtOrBeforeHorizon) {
+  CommitTimestampIndex index(kStart);
+  index.Record("t1", MakeKey(1), kStart + absl::Seconds(1));
+  index.Record("t1", MakeKey(2), kStart + absl::Seconds(3));
+  index.CollectGarbage(kStart + absl::Seconds(2));
+
+  EXPECT_EQ(index.KeysWrittenAfter("t1", kStart), std::nullopt);
+  EXPECT_EQ(index.KeysWrittenAfter("t2", kStart), std::nullopt);
+  EXPECT_THAT(index.KeysWrittenAfter("t1", kStart + absl::Seconds(2)),
+              Optional(ElementsAre(MakeKey(2))));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,217 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/storage/compact_in_memory_storage.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "backend/storage/in_memory_iterator.h"
+#include "backend/storage/row_versions.h"
+#include "common/errors.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+CompactInMemoryStorage::Table* CompactInMemoryStorage::FindTable(
+    const TableID& table_id) const {
+  absl::ReaderMutexLock lock(&mu_);
+  auto table_itr = tables_.find(table_id);
+  if (table_itr == tables_.end()) {
+    return nullptr;
+  }
+  return table_itr->second.get();
+}
+
+CompactInMemoryStorage::Table* CompactInMemoryStorage::FindOrCreateTable(
+    const TableID& table_id) {
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    auto table_itr = tables_.find(table_id);
+    if (table_itr != tables_.end()) {
+      return table_itr->second.get();
+    }
+  }
+  absl::MutexLock lock(&mu_);
+  std::unique_ptr<Table>& table = tables_[table_id];
+  if (table == nullptr) {
+    table = std::make_unique<Table>();
+  }
+  return table.get();
+}
+
+zetasql::Value CompactInMemoryStorage::GetCellValueAtTimestamp(
+    const Row& row, const ColumnID& column_id, absl::Time timestamp) {
+  const Cell* cell = FindCellAtTimestamp(row, column_id, timestamp);
+  return cell != nullptr ? cell->value : zetasql::Value();
+}
+
+absl::Status CompactInMemoryStorage::Lookup(
+    absl::Time timestamp, const TableID& table_id, const Key& key,
+    const std::vector<ColumnID>& column_ids,
+    std::vector<zetasql::Value>* values) const {
+  // Validate the request.
+  if (!column_ids.empty() && values == nullptr) {
+    return error::Internal(
+        "CompactInMemoryStorage::Lookup was passed a nullptr for "
+        "values, but had non-empty column_ids.");
+  }
+  if (values != nullptr) {
+    values->clear();
+  }
+
+  // Lookup for given table.
+  const Table* table = FindTable(table_id);
+  if (table == nullptr) {
+    return absl::Status(
+        absl::StatusCode::kNotFound,
+        absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
+                     table_id, " at timestamp: ", absl::FormatTime(timestamp)));
+  }
+  absl::ReaderMutexLock lock(&table->mu);
+
+  // Lookup for given key.
+  auto row_itr = table->rows.find(key);
+  if (row_itr == table->rows.end()) {
+    return absl::Status(
+        absl::StatusCode::kNotFound,
+        absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
+                     table_id, " at timestamp: ", absl::FormatTime(timestamp)));
+  }
+  const Row& row = row_itr->second;
+
+  // Verify if the row exists at the given timestamp.
+  if (!RowExists(row, timestamp)) {
+    return absl::Status(
+        absl::StatusCode::kNotFound,
+        absl::StrCat(
+            "Key: ", key.DebugString(), " does not exist for table: ", table_id,
+            " at the given timestamp: " + absl::FormatTime(timestamp)));
+  }
+
+  // Fetch the value from the cell at the given timestamp.
+  for (const ColumnID& column_id : column_ids) {
+    values->emplace_back(GetCellValueAtTimestamp(row, column_id, timestamp));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CompactInMemoryStorage::Read(
+    absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
+    const std::vector<ColumnID>& column_ids,
+    std::unique_ptr<StorageIterator>* itr) const {
+  // Validate the request.
+  if (!key_range.IsClosedOpen()) {
+    return error::Internal(
+        absl::StrCat("CompactInMemoryStorage::Read should be called "
+                     "with ClosedOpen key range, found: ",
+                     key_range.DebugString()));
+  }
+
+  // Return an empty iterator for empty key_range.
+  if (key_range.start_key() >= key_range.limit_key()) {
+    *itr = std::make_unique<FixedRowStorageIterator>();
+    return absl::OkStatus();
+  }
+
+  // Lookup for given table.
+  const Table* table = FindTable(table_id);
+  if (table == nullptr) {
+    *itr = std::make_unique<FixedRowStorageIterator>();
+    return absl::OkStatus();
+  }
+  absl::ReaderMutexLock lock(&table->mu);
+
+  // Lookup keys from the given key range.
+  std::vector<FixedRowStorageIterator::Row> rows;
+  auto row_start_itr = table->rows.lower_bound(key_range.start_key());
+  auto row_end_itr = table->rows.lower_bound(key_range.limit_key());
+  for (auto row_itr = row_start_itr; row_itr != row_end_itr; ++row_itr) {
+    const Row& row = row_itr->second;
+    if (!RowExists(row, timestamp)) {
+      continue;
+    }
+
+    std::vector<zetasql::Value> values;
+    values.reserve(column_ids.size());
+    for (const ColumnID& column_id : column_ids) {
+      values.emplace_back(GetCellValueAtTimestamp(row, column_id, timestamp));
+    }
+    rows.emplace_back(row_itr->first, std::move(values));
+  }
+  *itr = std::make_unique<FixedRowStorageIterator>(std::move(rows));
+  return absl::OkStatus();
+}
+
+absl::Status CompactInMemoryStorage::Write(
+    absl::Time timestamp, const TableID& table_id, const Key& key,
+    const std::vector<ColumnID>& column_ids,
+    const std::vector<zetasql::Value>& values) {
+  // Add the table if it does not exist.
+  Table* table = FindOrCreateTable(table_id);
+  absl::MutexLock lock(&table->mu);
+
+  // Add the row if it does not exist, and mark it as existing at timestamp.
+  RowVersion<Cell>& version = FindOrInsertVersion(table->rows[key], timestamp);
+  version.exists = true;
+
+  // Add the values for the given columns.
+  for (int i = 0; i < column_ids.size(); ++i) {
+    SetCell(version, Cell{column_ids[i], values[i]});
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CompactInMemoryStorage::Delete(absl::Time timestamp,
+                                            const TableID& table_id,
+                                            const KeyRange& key_range) {
+  if (!key_range.IsClosedOpen()) {
+    return error::Internal(
+        absl::StrCat("CompactInMemoryStorage::Delete should be called "
+                     "with ClosedOpen key range, found: ",
+                     key_range.DebugString()));
+  }
+  if (key_range.start_key() >= key_range.limit_key()) {
+    return absl::OkStatus();
+  }
+
+  // Lookup for given table.
+  Table* table = FindTable(table_id);
+  if (table == nullptr) {
+    return absl::OkStatus();
+  }
+  absl::MutexLock lock(&table->mu);
+
+  // Mark the keys in the given key range as deleted.
+  auto row_start_itr = table->rows.lower_bound(key_range.start_key());
+  auto row_end_itr = table->rows.lower_bound(key_range.limit_key());
+  for (auto row_itr = row_start_itr; row_itr != row_end_itr; ++row_itr) {
+    DeleteRow(row_itr->second, timestamp);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,113 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COMPACT_IN_MEMORY_STORAGE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COMPACT_IN_MEMORY_STORAGE_H_
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/row_versions.h"
+#include "backend/storage/storage.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// CompactInMemoryStorage implements an in-memory multi-version data store with
+// the same semantics as InMemoryStorage but a more compact layout.
+//
+// Instead of keeping a separate timestamp-ordered map for every cell, each row
+// keeps all its versions in a single contiguous vector sorted by timestamp, as
+// described in row_versions.h.
+//
+// This class is thread-safe.
+class CompactInMemoryStorage : public Storage {
+ public:
+  absl::Status Lookup(absl::Time timestamp, const TableID& table_id,
+                      const Key& key, const std::vector<ColumnID>& column_ids,
+                      std::vector<zetasql::Value>* values) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Read(absl::Time timestamp, const TableID& table_id,
+                    const KeyRange& key_range,
+                    const std::vector<ColumnID>& column_ids,
+                    std::unique_ptr<StorageIterator>* itr) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Write(absl::Time timestamp, const TableID& table_id,
+                     const Key& key, const std::vector<ColumnID>& column_ids,
+                     const std::vector<zetasql::Value>& values) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Delete(absl::Time timestamp, const TableID& table_id,
+                      const KeyRange& key_range) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // A column value of a row version.
+  struct Cell {
+    ColumnID column_id;
+    zetasql::Value value;
+  };
+
+  // All versions of a row, sorted by timestamp.
+  using Row = VersionedRow<Cell>;
+  using Rows = std::map<Key, Row>;
+
+  // A single table shard. Shards are never removed once created, so pointers
+  // to them remain valid after mu_ is released.
+  struct Table {
+    mutable absl::Mutex mu;
+    Rows rows ABSL_GUARDED_BY(mu);
+  };
+  using Tables = absl::flat_hash_map<TableID, std::unique_ptr<Table>>;
+
+  // Returns the value for given row and column_id at the specified timestamp.
+  static zetasql::Value GetCellValueAtTimestamp(const Row& row,
+                                                  const ColumnID& column_id,
+                                                  absl::Time timestamp);
+
+  // Returns the shard for the given table, or nullptr if it does not exist.
+  Table* FindTable(const TableID& table_id) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the shard for the given table, creating it if it does not exist.
+  Table* FindOrCreateTable(const TableID& table_id) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Guards the set of tables. Individual table contents are guarded by the
+  // per-table mutex.
+  mutable absl::Mutex mu_;
+  Tables tables_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_COMPACT_IN_MEMORY_STORAGE_H_
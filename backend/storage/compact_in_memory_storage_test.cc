@@ -0,0 +1,170 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/storage/compact_in_memory_storage.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+class CompactInMemoryStorageTest : public testing::Test {
+ protected:
+  const TableID kTableId0 = "test_table:0";
+  const ColumnID kColumnID0 = "test_column:0";
+  const ColumnID kColumnID1 = "test_column:1";
+  CompactInMemoryStorage storage_;
+  std::unique_ptr<StorageIterator> itr_;
+};
+
+TEST_F(CompactInMemoryStorageTest, LookupReturnsValueAtTimestamp) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, key, {kColumnID0, kColumnID1},
+                           {String("a0"), String("b0")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t1, kTableId0, key, {kColumnID0}, {String("a1")}));
+
+  std::vector<zetasql::Value> values;
+  EXPECT_THAT(storage_.Lookup(t0 - absl::Seconds(1), kTableId0, key,
+                              {kColumnID0}, &values),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t0, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a0"), String("b0")));
+
+  // Unwritten cells are inherited from earlier versions.
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a1"), String("b0")));
+}
+
+TEST_F(CompactInMemoryStorageTest, OverwriteAtSameTimestamp) {
+  absl::Time t0 = absl::Now();
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t0, kTableId0, key, {kColumnID0}, {String("a")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t0, kTableId0, key, {kColumnID0}, {String("b")}));
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(t0, kTableId0, key, {kColumnID0}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("b")));
+}
+
+TEST_F(CompactInMemoryStorageTest, DeleteHidesEarlierCells) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t1 + absl::Seconds(1);
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, key, {kColumnID0, kColumnID1},
+                           {String("a0"), String("b0")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Delete(t1, kTableId0, KeyRange::Point(key).ToClosedOpen()));
+
+  std::vector<zetasql::Value> values;
+  EXPECT_THAT(storage_.Lookup(t1, kTableId0, key, {kColumnID0}, &values),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+
+  // Reinserting the row does not resurrect cells written before the delete.
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t2, kTableId0, key, {kColumnID0}, {String("a2")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t2, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a2"), zetasql::Value()));
+
+  // Older snapshots are still readable.
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t0, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a0"), String("b0")));
+}
+
+TEST_F(CompactInMemoryStorageTest, OutOfOrderWritesAreVisibleAtTheirTimestamp) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t1, kTableId0, key, {kColumnID0}, {String("a1")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t0, kTableId0, key, {kColumnID0}, {String("a0")}));
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(t0, kTableId0, key, {kColumnID0}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a0")));
+  ZETASQL_EXPECT_OK(storage_.Lookup(t1, kTableId0, key, {kColumnID0}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a1")));
+}
+
+TEST_F(CompactInMemoryStorageTest, ReadRangeSkipsDeletedRows) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+
+  for (int i = 0; i < 5; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID0},
+                             {String(absl::StrCat("value-", i))}));
+  }
+  ZETASQL_EXPECT_OK(storage_.Delete(
+      t1, kTableId0, KeyRange::ClosedOpen(Key({Int64(1)}), Key({Int64(3)}))));
+
+  ZETASQL_EXPECT_OK(storage_.Read(t1, kTableId0, KeyRange::All(), {kColumnID0},
+                          &itr_));
+  for (int i : {0, 3, 4}) {
+    EXPECT_TRUE(itr_->Next());
+    EXPECT_EQ(itr_->Key(), Key({Int64(i)}));
+    EXPECT_EQ(itr_->ColumnValue(0), String(absl::StrCat("value-", i)));
+  }
+  EXPECT_FALSE(itr_->Next());
+  ZETASQL_EXPECT_OK(itr_->Status());
+}
+
+TEST_F(CompactInMemoryStorageTest, NonClosedOpenRangesReturnInternalError) {
+  absl::Time t0 = absl::Now();
+  KeyRange range = KeyRange::ClosedClosed(Key({Int64(0)}), Key({Int64(1)}));
+
+  EXPECT_THAT(storage_.Read(t0, kTableId0, range, {}, &itr_),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT(storage_.Delete(t0, kTableId0, range),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kInternal));
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
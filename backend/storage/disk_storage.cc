@@ -0,0 +1,471 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/disk_storage.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.pb.h"
+#include "zetasql/public/value.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/datamodel/key_encoding.h"
+#include "backend/storage/batched_range_iterator.h"
+#include "backend/storage/in_memory_iterator.h"
+#include "backend/storage/row_versions.h"
+#include "common/errors.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+absl::Status ScratchFileError(absl::string_view operation) {
+  return error::Internal(absl::StrCat("Failed to ", operation,
+                                      " disk storage scratch file: ",
+                                      std::strerror(errno)));
+}
+
+}  // namespace
+
+// A StorageIterator over the rows of a table in a key range as of a timestamp.
+//
+// Only the cells of a batch are copied under the table lock; spilled values are
+// read from the scratch file after it is released.
+class DiskStorage::RangeIterator : public BatchedRangeIterator {
+ public:
+  RangeIterator(const DiskStorage* storage, const Table* table,
+                absl::Time timestamp, const KeyRange& key_range,
+                std::vector<ColumnID> column_ids)
+      : BatchedRangeIterator(key_range, column_ids.size(), /*reverse=*/false),
+        storage_(storage),
+        table_(table),
+        timestamp_(timestamp),
+        column_ids_(std::move(column_ids)) {}
+
+ private:
+  absl::Status FetchBatch(
+      std::vector<FixedRowStorageIterator::Row>* rows) override {
+    std::vector<std::pair<std::string, std::vector<Cell>>> batch;
+    {
+      absl::ReaderMutexLock lock(&table_->mu);
+      VisitBatch(table_->rows,
+                 [&](const std::string& encoded_key, const Row& row) {
+                   if (!RowExists(row, timestamp_)) {
+                     return false;
+                   }
+                   batch.emplace_back(
+                       encoded_key,
+                       GetCellsAtTimestamp(row, column_ids_, timestamp_));
+                   return true;
+                 });
+    }
+
+    for (auto& [encoded_key, cells] : batch) {
+      ZETASQL_ASSIGN_OR_RETURN(std::vector<zetasql::Value> values,
+                       storage_->CellValues(cells));
+      rows->emplace_back(DecodeKey(encoded_key), std::move(values));
+    }
+    return absl::OkStatus();
+  }
+
+  const DiskStorage* storage_;
+  const Table* table_;
+  const absl::Time timestamp_;
+  const std::vector<ColumnID> column_ids_;
+};
+
+absl::StatusOr<std::unique_ptr<DiskStorage>> DiskStorage::Create(
+    const Options& options) {
+  std::string path = absl::StrCat(options.directory, "/storage.XXXXXX");
+  const int fd = ::mkstemp(path.data());
+  if (fd < 0) {
+    return ScratchFileError(absl::StrCat("create ", path, " as"));
+  }
+  ::unlink(path.c_str());
+  return absl::WrapUnique(new DiskStorage(options, fd));
+}
+
+DiskStorage::DiskStorage(const Options& options, int fd)
+    : options_(options), fd_(fd) {}
+
+DiskStorage::~DiskStorage() { ::close(fd_); }
+
+DiskStorage::Table* DiskStorage::FindTable(const TableID& table_id) const {
+  absl::ReaderMutexLock lock(&mu_);
+  auto table_itr = tables_.find(table_id);
+  if (table_itr == tables_.end()) {
+    return nullptr;
+  }
+  return table_itr->second.get();
+}
+
+DiskStorage::Table* DiskStorage::FindOrCreateTable(const TableID& table_id) {
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    auto table_itr = tables_.find(table_id);
+    if (table_itr != tables_.end()) {
+      return table_itr->second.get();
+    }
+  }
+  absl::MutexLock lock(&mu_);
+  std::unique_ptr<Table>& table = tables_[table_id];
+  if (table == nullptr) {
+    table = std::make_unique<Table>();
+  }
+  return table.get();
+}
+
+std::vector<DiskStorage::Cell> DiskStorage::GetCellsAtTimestamp(
+    const Row& row, const std::vector<ColumnID>& column_ids,
+    absl::Time timestamp) {
+  std::vector<Cell> cells;
+  cells.reserve(column_ids.size());
+  for (const ColumnID& column_id : column_ids) {
+    const Cell* cell = FindCellAtTimestamp(row, column_id, timestamp);
+    cells.push_back(cell != nullptr ? *cell : Cell{column_id});
+  }
+  return cells;
+}
+
+absl::StatusOr<DiskStorage::Cell> DiskStorage::MakeCell(
+    const ColumnID& column_id, const zetasql::Value& value) {
+  Cell cell{column_id};
+  // The in-memory size of a value is an upper bound on its serialized size, so
+  // most small values are kept without serializing them first.
+  if (!value.is_valid() ||
+      static_cast<int64_t>(value.physical_byte_size()) <=
+          options_.max_inline_value_size) {
+    cell.value = value;
+    return cell;
+  }
+  zetasql::ValueProto value_proto;
+  ZETASQL_RETURN_IF_ERROR(value.Serialize(&value_proto));
+  const std::string data = value_proto.SerializeAsString();
+  if (static_cast<int64_t>(data.size()) <= options_.max_inline_value_size) {
+    cell.value = value;
+    return cell;
+  }
+
+  cell.type = value.type();
+  cell.size = data.size();
+  cell.offset = file_size_.fetch_add(data.size(), std::memory_order_relaxed);
+  int64_t written = 0;
+  while (written < cell.size) {
+    const ssize_t n = ::pwrite(fd_, data.data() + written, cell.size - written,
+                               cell.offset + written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ScratchFileError("write");
+    }
+    written += n;
+  }
+  return cell;
+}
+
+absl::StatusOr<zetasql::Value> DiskStorage::CellValue(const Cell& cell) const {
+  if (cell.type == nullptr) {
+    return cell.value;
+  }
+  {
+    absl::MutexLock lock(&cache_mu_);
+    auto index_itr = cache_index_.find(cell.offset);
+    if (index_itr != cache_index_.end()) {
+      cache_.splice(cache_.begin(), cache_, index_itr->second);
+      return index_itr->second->second;
+    }
+  }
+
+  std::string data(cell.size, '\0');
+  int64_t read = 0;
+  while (read < cell.size) {
+    const ssize_t n =
+        ::pread(fd_, data.data() + read, cell.size - read, cell.offset + read);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return ScratchFileError("read");
+    }
+    read += n;
+  }
+  zetasql::ValueProto value_proto;
+  if (!value_proto.ParseFromString(data)) {
+    return error::Internal("Failed to parse value from disk storage.");
+  }
+  ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value,
+                   zetasql::Value::Deserialize(value_proto, cell.type));
+
+  const int64_t value_bytes = static_cast<int64_t>(value.physical_byte_size());
+  if (value_bytes <= options_.cache_size_bytes) {
+    absl::MutexLock lock(&cache_mu_);
+    if (!cache_index_.contains(cell.offset)) {
+      cache_.emplace_front(cell.offset, value);
+      cache_index_[cell.offset] = cache_.begin();
+      cache_bytes_ += value_bytes;
+      while (cache_bytes_ > options_.cache_size_bytes) {
+        cache_bytes_ -= cache_.back().second.physical_byte_size();
+        cache_index_.erase(cache_.back().first);
+        cache_.pop_back();
+      }
+    }
+  }
+  return value;
+}
+
+absl::StatusOr<std::vector<zetasql::Value>> DiskStorage::CellValues(
+    const std::vector<Cell>& cells) const {
+  std::vector<zetasql::Value> values;
+  values.reserve(cells.size());
+  for (const Cell& cell : cells) {
+    ZETASQL_ASSIGN_OR_RETURN(values.emplace_back(), CellValue(cell));
+  }
+  return values;
+}
+
+absl::Status DiskStorage::Lookup(absl::Time timestamp, const TableID& table_id,
+                                 const Key& key,
+                                 const std::vector<ColumnID>& column_ids,
+                                 std::vector<zetasql::Value>* values) const {
+  // Validate the request.
+  if (!column_ids.empty() && values == nullptr) {
+    return error::Internal(
+        "DiskStorage::Lookup was passed a nullptr for values, but had "
+        "non-empty column_ids.");
+  }
+  if (values != nullptr) {
+    values->clear();
+  }
+
+  // Lookup for given table.
+  const Table* table = FindTable(table_id);
+  if (table == nullptr) {
+    return absl::Status(
+        absl::StatusCode::kNotFound,
+        absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
+                     table_id, " at timestamp: ", absl::FormatTime(timestamp)));
+  }
+
+  std::vector<Cell> cells;
+  {
+    absl::ReaderMutexLock lock(&table->mu);
+
+    // Lookup for given key.
+    auto row_itr = table->rows.find(EncodeKey(key));
+    if (row_itr == table->rows.end()) {
+      return absl::Status(
+          absl::StatusCode::kNotFound,
+          absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
+                       table_id,
+                       " at timestamp: ", absl::FormatTime(timestamp)));
+    }
+    const Row& row = row_itr->second;
+
+    // Verify if the row exists at the given timestamp.
+    if (!RowExists(row, timestamp)) {
+      return absl::Status(
+          absl::StatusCode::kNotFound,
+          absl::StrCat("Key: ", key.DebugString(),
+                       " does not exist for table: ", table_id,
+                       " at the given timestamp: " +
+                           absl::FormatTime(timestamp)));
+    }
+    cells = GetCellsAtTimestamp(row, column_ids, timestamp);
+  }
+
+  // Spilled values are read without holding the table lock.
+  if (values != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(*values, CellValues(cells));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status DiskStorage::Read(absl::Time timestamp, const TableID& table_id,
+                               const KeyRange& key_range,
+                               const std::vector<ColumnID>& column_ids,
+                               std::unique_ptr<StorageIterator>* itr) const {
+  // Validate the request.
+  if (!key_range.IsClosedOpen()) {
+    return error::Internal(
+        absl::StrCat("DiskStorage::Read should be called with ClosedOpen key "
+                     "range, found: ",
+                     key_range.DebugString()));
+  }
+
+  // Return an empty iterator for empty key_range or for a missing table.
+  const Table* table = FindTable(table_id);
+  if (key_range.start_key() >= key_range.limit_key() || table == nullptr) {
+    *itr = std::make_unique<FixedRowStorageIterator>();
+    return absl::OkStatus();
+  }
+  *itr = std::make_unique<RangeIterator>(this, table, timestamp, key_range,
+                                         column_ids);
+  return absl::OkStatus();
+}
+
+absl::Status DiskStorage::Write(absl::Time timestamp, const TableID& table_id,
+                                const Key& key,
+                                const std::vector<ColumnID>& column_ids,
+                                const std::vector<zetasql::Value>& values) {
+  // Large values are spilled before taking the table lock.
+  std::vector<Cell> cells;
+  cells.reserve(column_ids.size());
+  for (int i = 0; i < column_ids.size(); ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(cells.emplace_back(), MakeCell(column_ids[i], values[i]));
+  }
+
+  // Add the table if it does not exist.
+  Table* table = FindOrCreateTable(table_id);
+  absl::MutexLock lock(&table->mu);
+
+  // Add the row if it does not exist, and mark it as existing at timestamp.
+  RowVersion<Cell>& version =
+      FindOrInsertVersion(table->rows[EncodeKey(key)], timestamp);
+  version.exists = true;
+
+  // Add the cells for the given columns.
+  for (Cell& cell : cells) {
+    SetCell(version, std::move(cell));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status DiskStorage::Delete(absl::Time timestamp, const TableID& table_id,
+                                 const KeyRange& key_range) {
+  if (!key_range.IsClosedOpen()) {
+    return error::Internal(
+        absl::StrCat("DiskStorage::Delete should be called with ClosedOpen "
+                     "key range, found: ",
+                     key_range.DebugString()));
+  }
+  if (key_range.start_key() >= key_range.limit_key()) {
+    return absl::OkStatus();
+  }
+
+  // Lookup for given table.
+  Table* table = FindTable(table_id);
+  if (table == nullptr) {
+    return absl::OkStatus();
+  }
+  absl::MutexLock lock(&table->mu);
+
+  // Mark the keys in the given key range as deleted.
+  auto row_start_itr =
+      table->rows.lower_bound(EncodeKey(key_range.start_key()));
+  auto row_end_itr = table->rows.lower_bound(EncodeKey(key_range.limit_key()));
+  for (auto row_itr = row_start_itr; row_itr != row_end_itr; ++row_itr) {
+    DeleteRow(row_itr->second, timestamp);
+  }
+  return absl::OkStatus();
+}
+
+int64_t DiskStorage::CollectGarbage(absl::Time version_horizon) {
+  std::vector<Table*> tables;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    for (const auto& [table_id, table] : tables_) {
+      tables.push_back(table.get());
+    }
+  }
+
+  // Only the in-memory part of a cell is reclaimed, spilled values stay in the
+  // scratch file.
+  auto cell_bytes = [](const Cell& cell) -> int64_t {
+    return sizeof(Cell) +
+           (cell.value.is_valid() ? cell.value.physical_byte_size() : 0);
+  };
+  int64_t reclaimed_bytes = 0;
+  for (Table* table : tables) {
+    absl::MutexLock lock(&table->mu);
+    for (auto row_itr = table->rows.begin(); row_itr != table->rows.end();) {
+      Row& row = row_itr->second;
+      const int num_visible = VersionsEnd(row, version_horizon) - row.begin();
+      if (num_visible == 0 || (num_visible == 1 && row.front().exists)) {
+        ++row_itr;
+        continue;
+      }
+
+      // Every version before the latest one at the horizon is replaced by a
+      // single version holding the cells visible at the horizon, or dropped if
+      // the row did not exist at the horizon.
+      const RowVersion<Cell>& latest = row[num_visible - 1];
+      std::optional<RowVersion<Cell>> merged;
+      if (latest.exists) {
+        merged.emplace();
+        merged->timestamp = latest.timestamp;
+        merged->exists = true;
+        merged->hides_earlier_cells = true;
+        for (int i = num_visible - 1; i >= 0; --i) {
+          for (const Cell& cell : row[i].cells) {
+            auto cell_itr = CellLowerBound(merged->cells, cell.column_id);
+            if (cell_itr == merged->cells.end() ||
+                cell_itr->column_id != cell.column_id) {
+              merged->cells.insert(cell_itr, cell);
+            }
+          }
+          if (row[i].hides_earlier_cells) {
+            break;
+          }
+        }
+      }
+      for (int i = 0; i < num_visible; ++i) {
+        reclaimed_bytes += sizeof(RowVersion<Cell>);
+        for (const Cell& cell : row[i].cells) {
+          reclaimed_bytes += cell_bytes(cell);
+        }
+      }
+      row.erase(row.begin(), row.begin() + num_visible);
+      if (merged.has_value()) {
+        reclaimed_bytes -= sizeof(RowVersion<Cell>);
+        for (const Cell& cell : merged->cells) {
+          reclaimed_bytes -= cell_bytes(cell);
+        }
+        row.insert(row.begin(), std::move(*merged));
+      }
+      if (row.empty()) {
+        reclaimed_bytes += row_itr->first.size();
+        row_itr = table->rows.erase(row_itr);
+      } else {
+        ++row_itr;
+      }
+    }
+  }
+  return reclaimed_bytes;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,201 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_DISK_STORAGE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_DISK_STORAGE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/row_versions.h"
+#include "backend/storage/storage.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// DiskStorage implements the multi-version data store semantics of
+// InMemoryStorage for datasets which do not fit in memory.
+//
+// Rows are laid out as in CompactInMemoryStorage, with the versions of a row in
+// a single vector (see row_versions.h), but rows are keyed by their
+// memcomparable key encoding and column values larger than
+// Options::max_inline_value_size are not kept on the heap. Instead they are
+// serialized as ValueProtos and appended to a scratch file, with only their
+// type and location in the file kept in memory. Values read back from the file
+// are kept in an LRU cache bounded by Options::cache_size_bytes. Memory use is
+// therefore bounded by the size of the keys, the small values and the cache
+// rather than by the size of the data.
+//
+// The scratch file is removed from the directory as soon as it is created, so
+// that it goes away with the storage, even on a crash. Space used by values
+// discarded by CollectGarbage is not reclaimed until then. Types of spilled
+// values are referenced by pointer, so they must outlive the storage.
+//
+// This class is thread-safe.
+class DiskStorage : public Storage {
+ public:
+  struct Options {
+    // Directory in which the scratch file is created.
+    std::string directory;
+
+    // Values whose serialized size is at most this many bytes stay in memory.
+    int64_t max_inline_value_size = 64;
+
+    // The maximum total size of the values read back from the scratch file
+    // which are cached in memory.
+    int64_t cache_size_bytes = 64 << 20;
+  };
+
+  // Creates an empty storage, with a new scratch file in options.directory.
+  static absl::StatusOr<std::unique_ptr<DiskStorage>> Create(
+      const Options& options);
+
+  ~DiskStorage() override;
+
+  absl::Status Lookup(absl::Time timestamp, const TableID& table_id,
+                      const Key& key, const std::vector<ColumnID>& column_ids,
+                      std::vector<zetasql::Value>* values) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Read(absl::Time timestamp, const TableID& table_id,
+                    const KeyRange& key_range,
+                    const std::vector<ColumnID>& column_ids,
+                    std::unique_ptr<StorageIterator>* itr) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Write(absl::Time timestamp, const TableID& table_id,
+                     const Key& key, const std::vector<ColumnID>& column_ids,
+                     const std::vector<zetasql::Value>& values) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Delete(absl::Time timestamp, const TableID& table_id,
+                      const KeyRange& key_range) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  int64_t CollectGarbage(absl::Time version_horizon) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of bytes of values written to the scratch file.
+  int64_t spilled_bytes() const {
+    return file_size_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  class RangeIterator;
+
+  // A column value of a row version. Either value is valid, or the value is
+  // stored in the scratch file as a ValueProto of size bytes at offset.
+  struct Cell {
+    ColumnID column_id;
+    zetasql::Value value;
+    const zetasql::Type* type = nullptr;
+    int64_t offset = 0;
+    int64_t size = 0;
+  };
+
+  // All versions of a row, sorted by timestamp.
+  using Row = VersionedRow<Cell>;
+
+  // Rows keyed by their encoded key, see EncodeKey.
+  using Rows = std::map<std::string, Row>;
+
+  // A single table shard. Shards are never removed once created, so pointers
+  // to them remain valid after mu_ is released.
+  struct Table {
+    mutable absl::Mutex mu;
+    Rows rows ABSL_GUARDED_BY(mu);
+  };
+  using Tables = absl::flat_hash_map<TableID, std::unique_ptr<Table>>;
+
+  DiskStorage(const Options& options, int fd);
+  DiskStorage(const DiskStorage&) = delete;
+  DiskStorage& operator=(const DiskStorage&) = delete;
+
+  // Returns the cells of row visible at timestamp, one per column_id, with
+  // empty cells for columns which are not set.
+  static std::vector<Cell> GetCellsAtTimestamp(
+      const Row& row, const std::vector<ColumnID>& column_ids,
+      absl::Time timestamp);
+
+  // Returns the shard for the given table, or nullptr if it does not exist.
+  Table* FindTable(const TableID& table_id) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the shard for the given table, creating it if it does not exist.
+  Table* FindOrCreateTable(const TableID& table_id) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns a cell holding value, spilling it to the scratch file if it is
+  // large.
+  absl::StatusOr<Cell> MakeCell(const ColumnID& column_id,
+                                const zetasql::Value& value);
+
+  // Returns the value of cell, reading it from the cache or the scratch file.
+  // Returns an invalid value for an empty cell.
+  absl::StatusOr<zetasql::Value> CellValue(const Cell& cell) const
+      ABSL_LOCKS_EXCLUDED(cache_mu_);
+
+  // Replaces cells with their values.
+  absl::StatusOr<std::vector<zetasql::Value>> CellValues(
+      const std::vector<Cell>& cells) const;
+
+  const Options options_;
+
+  // The scratch file, and the number of bytes appended to it so far. Writers
+  // reserve a region by advancing file_size_ and then fill it in without a
+  // lock.
+  const int fd_;
+  std::atomic<int64_t> file_size_{0};
+
+  // LRU cache of values read from the scratch file, keyed by offset, with the
+  // most recently used value at the front.
+  using CacheEntry = std::pair<int64_t, zetasql::Value>;
+  mutable absl::Mutex cache_mu_;
+  mutable std::list<CacheEntry> cache_ ABSL_GUARDED_BY(cache_mu_);
+  mutable absl::flat_hash_map<int64_t, std::list<CacheEntry>::iterator>
+      cache_index_ ABSL_GUARDED_BY(cache_mu_);
+  mutable int64_t cache_bytes_ ABSL_GUARDED_BY(cache_mu_) = 0;
+
+  // Guards the set of tables. Individual table contents are guarded by the
+  // per-table mutex.
+  mutable absl::Mutex mu_;
+  Tables tables_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_DISK_STORAGE_H_
@@ -0,0 +1,192 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/disk_storage.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+class DiskStorageTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    DiskStorage::Options options;
+    options.directory = testing::TempDir();
+    options.max_inline_value_size = 16;
+    options.cache_size_bytes = 1024;
+    ZETASQL_ASSERT_OK_AND_ASSIGN(storage_, DiskStorage::Create(options));
+  }
+
+  const TableID kTableId0 = "test_table:0";
+  const ColumnID kColumnID0 = "test_column:0";
+  const ColumnID kColumnID1 = "test_column:1";
+  const std::string kLargeValue = std::string(100, 'x');
+  std::unique_ptr<DiskStorage> storage_;
+  std::unique_ptr<StorageIterator> itr_;
+};
+
+TEST_F(DiskStorageTest, LookupReturnsValueAtTimestamp) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(storage_->Write(t0, kTableId0, key, {kColumnID0, kColumnID1},
+                            {String("a0"), String(kLargeValue)}));
+  ZETASQL_EXPECT_OK(
+      storage_->Write(t1, kTableId0, key, {kColumnID0}, {String("a1")}));
+
+  std::vector<zetasql::Value> values;
+  EXPECT_THAT(storage_->Lookup(t0 - absl::Seconds(1), kTableId0, key,
+                               {kColumnID0}, &values),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  ZETASQL_EXPECT_OK(
+      storage_->Lookup(t0, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a0"), String(kLargeValue)));
+
+  // Unwritten cells are inherited from earlier versions.
+  ZETASQL_EXPECT_OK(
+      storage_->Lookup(t1, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a1"), String(kLargeValue)));
+}
+
+TEST_F(DiskStorageTest, OnlyLargeValuesAreSpilled) {
+  absl::Time t0 = absl::Now();
+
+  ZETASQL_EXPECT_OK(storage_->Write(t0, kTableId0, Key({Int64(1)}), {kColumnID0},
+                            {String("small")}));
+  EXPECT_EQ(storage_->spilled_bytes(), 0);
+
+  ZETASQL_EXPECT_OK(storage_->Write(t0, kTableId0, Key({Int64(2)}), {kColumnID0},
+                            {String(kLargeValue)}));
+  EXPECT_GT(storage_->spilled_bytes(), kLargeValue.size());
+}
+
+TEST_F(DiskStorageTest, ReadsSpilledValuesBeyondCacheSize) {
+  absl::Time t0 = absl::Now();
+
+  // The cache holds only a few of these values, so most reads go to the file.
+  for (int i = 0; i < 50; ++i) {
+    ZETASQL_EXPECT_OK(storage_->Write(t0, kTableId0, Key({Int64(i)}), {kColumnID0},
+                              {String(absl::StrCat(kLargeValue, i))}));
+  }
+
+  for (int pass = 0; pass < 2; ++pass) {
+    ZETASQL_EXPECT_OK(storage_->Read(t0, kTableId0, KeyRange::All(), {kColumnID0},
+                             &itr_));
+    for (int i = 0; i < 50; ++i) {
+      ASSERT_TRUE(itr_->Next());
+      EXPECT_EQ(itr_->Key(), Key({Int64(i)}));
+      EXPECT_EQ(itr_->ColumnValue(0), String(absl::StrCat(kLargeValue, i)));
+    }
+    EXPECT_FALSE(itr_->Next());
+    ZETASQL_EXPECT_OK(itr_->Status());
+  }
+}
+
+TEST_F(DiskStorageTest, DeleteHidesEarlierCells) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t1 + absl::Seconds(1);
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(storage_->Write(t0, kTableId0, key, {kColumnID0, kColumnID1},
+                            {String("a0"), String(kLargeValue)}));
+  ZETASQL_EXPECT_OK(
+      storage_->Delete(t1, kTableId0, KeyRange::Point(key).ToClosedOpen()));
+
+  std::vector<zetasql::Value> values;
+  EXPECT_THAT(storage_->Lookup(t1, kTableId0, key, {kColumnID0}, &values),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+
+  // Reinserting the row does not resurrect cells written before the delete.
+  ZETASQL_EXPECT_OK(
+      storage_->Write(t2, kTableId0, key, {kColumnID0}, {String("a2")}));
+  ZETASQL_EXPECT_OK(
+      storage_->Lookup(t2, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a2"), zetasql::Value()));
+
+  // Older snapshots are still readable.
+  ZETASQL_EXPECT_OK(
+      storage_->Lookup(t0, kTableId0, key, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a0"), String(kLargeValue)));
+}
+
+TEST_F(DiskStorageTest, CollectGarbageKeepsVersionAtHorizon) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t1 + absl::Seconds(1);
+  Key key0({Int64(0)});
+  Key key1({Int64(1)});
+
+  ZETASQL_EXPECT_OK(storage_->Write(t0, kTableId0, key0, {kColumnID0, kColumnID1},
+                            {String("a0"), String(kLargeValue)}));
+  ZETASQL_EXPECT_OK(
+      storage_->Write(t1, kTableId0, key0, {kColumnID0}, {String("a1")}));
+  ZETASQL_EXPECT_OK(
+      storage_->Write(t0, kTableId0, key1, {kColumnID0}, {String("b0")}));
+  ZETASQL_EXPECT_OK(
+      storage_->Delete(t1, kTableId0, KeyRange::Point(key1).ToClosedOpen()));
+
+  EXPECT_GT(storage_->CollectGarbage(t2), 0);
+
+  // The cells visible at the horizon are kept, earlier versions are not.
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_->Lookup(t2, kTableId0, key0, {kColumnID0, kColumnID1}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("a1"), String(kLargeValue)));
+  EXPECT_THAT(storage_->Lookup(t0, kTableId0, key0, {kColumnID0}, &values),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(storage_->Lookup(t0, kTableId0, key1, {kColumnID0}, &values),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+
+  // Collecting again finds nothing more to reclaim.
+  EXPECT_EQ(storage_->CollectGarbage(t2), 0);
+}
+
+TEST_F(DiskStorageTest, NonClosedOpenRangesReturnInternalError) {
+  absl::Time t0 = absl::Now();
+  KeyRange range = KeyRange::ClosedClosed(Key({Int64(0)}), Key({Int64(1)}));
+
+  EXPECT_THAT(storage_->Read(t0, kTableId0, range, {}, &itr_),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT(storage_->Delete(t0, kTableId0, range),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kInternal));
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,648 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/fixture_storage.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.pb.h"
+#include "zetasql/public/value.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/datamodel/key_encoding.h"
+#include "common/errors.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+constexpr char kFixtureMagic[] = "SPANFIX1";
+constexpr int64_t kMagicSize = sizeof(kFixtureMagic) - 1;
+constexpr int64_t kLengthSize = sizeof(uint64_t);
+
+absl::Status FixtureFileError(absl::string_view operation,
+                              const std::string& path) {
+  return error::Internal(absl::StrCat("Failed to ", operation, " fixture ",
+                                      path, ": ", std::strerror(errno)));
+}
+
+absl::Status CorruptFixture(const std::string& path) {
+  return error::Internal(absl::StrCat("Fixture ", path, " is corrupt."));
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<FixtureWriter>> FixtureWriter::Create(
+    const std::string& path) {
+  auto writer =
+      absl::WrapUnique(new FixtureWriter(path, absl::StrCat(path, ".tmp")));
+  if (!writer->out_) {
+    return FixtureFileError("create", writer->temp_path_);
+  }
+  ZETASQL_RETURN_IF_ERROR(writer->Append(kFixtureMagic, kMagicSize));
+  return writer;
+}
+
+FixtureWriter::FixtureWriter(const std::string& path,
+                             const std::string& temp_path)
+    : path_(path),
+      temp_path_(temp_path),
+      out_(temp_path, std::ios::binary | std::ios::trunc) {}
+
+absl::Status FixtureWriter::Append(const char* data, int64_t size) {
+  if (!out_.write(data, size)) {
+    return FixtureFileError("write", temp_path_);
+  }
+  size_ += size;
+  return absl::OkStatus();
+}
+
+absl::Status FixtureWriter::AppendLength(uint64_t length) {
+  return Append(reinterpret_cast<const char*>(&length), kLengthSize);
+}
+
+absl::Status FixtureWriter::AddTable(const std::string& name, bool is_index,
+                                     const std::vector<std::string>& columns) {
+  for (const FixtureHeader::Table& table : header_.tables()) {
+    if (table.name() == name && table.is_index() == is_index) {
+      return error::Internal(
+          absl::StrCat("Fixture table ", name, " was added twice."));
+    }
+  }
+  if (header_.tables_size() > 0) {
+    ZETASQL_RETURN_IF_ERROR(FinishTable());
+  }
+  FixtureHeader::Table* table = header_.add_tables();
+  table->set_name(name);
+  table->set_is_index(is_index);
+  for (const std::string& column : columns) {
+    table->add_columns(column);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FixtureWriter::AddRow(const Key& key,
+                                   absl::Span<const zetasql::Value> values) {
+  if (header_.tables_size() == 0) {
+    return error::Internal("Fixture rows must be added to a table.");
+  }
+  const FixtureHeader::Table& table = header_.tables(header_.tables_size() - 1);
+  if (values.size() != table.columns_size()) {
+    return error::Internal(absl::StrCat("Fixture row for ", table.name(),
+                                        " has ", values.size(),
+                                        " values, expected ",
+                                        table.columns_size()));
+  }
+  std::string encoded_key = EncodeKey(key);
+  if (!row_offsets_.empty() && encoded_key <= last_key_) {
+    return error::Internal(absl::StrCat(
+        "Fixture rows for ", table.name(), " must be added in key order."));
+  }
+
+  FixtureRow row;
+  for (int i = 0; i < values.size(); ++i) {
+    zetasql::ValueProto* value_proto = row.add_values();
+    if (!values[i].is_valid()) {
+      row.add_unset_columns(i);
+      continue;
+    }
+    ZETASQL_RETURN_IF_ERROR(values[i].Serialize(value_proto));
+  }
+  const std::string data = row.SerializeAsString();
+  row_offsets_.push_back(size_);
+  ZETASQL_RETURN_IF_ERROR(AppendLength(encoded_key.size()));
+  ZETASQL_RETURN_IF_ERROR(Append(encoded_key.data(), encoded_key.size()));
+  ZETASQL_RETURN_IF_ERROR(AppendLength(data.size()));
+  ZETASQL_RETURN_IF_ERROR(Append(data.data(), data.size()));
+  last_key_ = std::move(encoded_key);
+  return absl::OkStatus();
+}
+
+absl::Status FixtureWriter::FinishTable() {
+  FixtureHeader::Table* table =
+      header_.mutable_tables(header_.tables_size() - 1);
+  table->set_index_offset(size_);
+  table->set_row_count(row_offsets_.size());
+  ZETASQL_RETURN_IF_ERROR(
+      Append(reinterpret_cast<const char*>(row_offsets_.data()),
+             row_offsets_.size() * kLengthSize));
+  row_offsets_.clear();
+  last_key_.clear();
+  return absl::OkStatus();
+}
+
+absl::Status FixtureWriter::Finish() {
+  if (header_.tables_size() > 0) {
+    ZETASQL_RETURN_IF_ERROR(FinishTable());
+  }
+  const std::string data = header_.SerializeAsString();
+  const uint64_t header_offset = size_;
+  ZETASQL_RETURN_IF_ERROR(Append(data.data(), data.size()));
+  ZETASQL_RETURN_IF_ERROR(AppendLength(header_offset));
+  ZETASQL_RETURN_IF_ERROR(AppendLength(data.size()));
+  ZETASQL_RETURN_IF_ERROR(Append(kFixtureMagic, kMagicSize));
+  out_.close();
+  if (!out_) {
+    return FixtureFileError("write", temp_path_);
+  }
+  if (std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+    return FixtureFileError("move", path_);
+  }
+  return absl::OkStatus();
+}
+
+// A memory-mapped fixture file, with its tables bound to those of a database.
+class FixtureStorage::Fixture {
+ public:
+  struct Table {
+    TableBinding binding;
+
+    // The position of each column in binding.
+    absl::flat_hash_map<ColumnID, int> column_positions;
+
+    // The offsets of the rows of the table in key order.
+    int64_t index_offset = 0;
+    int64_t row_count = 0;
+  };
+
+  static absl::StatusOr<std::unique_ptr<Fixture>> Open(
+      const std::string& path, const TableBinder& bind_table);
+
+  ~Fixture() { ::munmap(const_cast<char*>(data_), size_); }
+
+  // Returns the fixture table bound to table_id, or nullptr if there is none.
+  const Table* FindTable(const TableID& table_id) const {
+    auto itr = tables_.find(table_id);
+    return itr != tables_.end() ? &itr->second : nullptr;
+  }
+
+  // Returns the position of the first row of table whose encoded key is not
+  // less than encoded_key.
+  absl::StatusOr<int64_t> LowerBound(const Table& table,
+                                     absl::string_view encoded_key) const {
+    int64_t begin = 0;
+    int64_t end = table.row_count;
+    while (begin < end) {
+      const int64_t mid = begin + (end - begin) / 2;
+      ZETASQL_ASSIGN_OR_RETURN(absl::string_view key, RowKey(table, mid));
+      if (key < encoded_key) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    return begin;
+  }
+
+  // Returns the encoded key of the row at the given position of table.
+  absl::StatusOr<absl::string_view> RowKey(const Table& table,
+                                           int64_t position) const {
+    absl::string_view key, row;
+    ZETASQL_RETURN_IF_ERROR(GetRow(table, position, &key, &row));
+    return key;
+  }
+
+  // Returns the values of the given columns of the row at the given position
+  // of table, with invalid values for columns which are not set.
+  absl::Status RowValues(const Table& table, int64_t position,
+                         const std::vector<ColumnID>& column_ids,
+                         std::vector<zetasql::Value>* values) const {
+    absl::string_view key, data;
+    ZETASQL_RETURN_IF_ERROR(GetRow(table, position, &key, &data));
+    FixtureRow row;
+    if (!row.ParseFromArray(data.data(), data.size()) ||
+        row.values_size() != table.binding.column_ids.size()) {
+      return CorruptFixture(path_);
+    }
+    values->clear();
+    values->reserve(column_ids.size());
+    for (const ColumnID& column_id : column_ids) {
+      auto itr = table.column_positions.find(column_id);
+      if (itr == table.column_positions.end() ||
+          std::find(row.unset_columns().begin(), row.unset_columns().end(),
+                    itr->second) != row.unset_columns().end()) {
+        values->emplace_back();
+        continue;
+      }
+      ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value,
+                       zetasql::Value::Deserialize(
+                           row.values(itr->second),
+                           table.binding.column_types[itr->second]));
+      values->push_back(std::move(value));
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  Fixture(const std::string& path, const char* data, int64_t size)
+      : path_(path), data_(data), size_(size) {}
+
+  // Reads the length stored at offset.
+  bool GetLength(int64_t offset, uint64_t* length) const {
+    if (offset < 0 || offset > size_ - kLengthSize) {
+      return false;
+    }
+    std::memcpy(length, data_ + offset, kLengthSize);
+    return true;
+  }
+
+  // Returns the encoded key and the FixtureRow of a row of table.
+  absl::Status GetRow(const Table& table, int64_t position,
+                      absl::string_view* key, absl::string_view* row) const {
+    const uint64_t size = size_;
+    uint64_t offset, key_size, row_size;
+    if (!GetLength(table.index_offset + position * kLengthSize, &offset) ||
+        !GetLength(offset, &key_size) || key_size > size ||
+        !GetLength(offset + kLengthSize + key_size, &row_size) ||
+        row_size > size - (offset + 2 * kLengthSize + key_size)) {
+      return CorruptFixture(path_);
+    }
+    *key = absl::string_view(data_ + offset + kLengthSize, key_size);
+    *row = absl::string_view(data_ + offset + 2 * kLengthSize + key_size,
+                             row_size);
+    return absl::OkStatus();
+  }
+
+  const std::string path_;
+  const char* const data_;
+  const int64_t size_;
+  absl::flat_hash_map<TableID, Table> tables_;
+};
+
+absl::StatusOr<std::unique_ptr<FixtureStorage::Fixture>>
+FixtureStorage::Fixture::Open(const std::string& path,
+                              const TableBinder& bind_table) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return FixtureFileError("open", path);
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return FixtureFileError("stat", path);
+  }
+  const int64_t size = st.st_size;
+  if (size < 2 * kMagicSize + 2 * kLengthSize) {
+    ::close(fd);
+    return CorruptFixture(path);
+  }
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return FixtureFileError("map", path);
+  }
+  auto fixture =
+      absl::WrapUnique(new Fixture(path, static_cast<const char*>(data), size));
+
+  // The header ends where the trailer of its offset and size starts.
+  const uint64_t header_end = size - kMagicSize - 2 * kLengthSize;
+  const char* trailer = fixture->data_ + header_end;
+  uint64_t header_offset, header_size;
+  std::memcpy(&header_offset, trailer, kLengthSize);
+  std::memcpy(&header_size, trailer + kLengthSize, kLengthSize);
+  FixtureHeader header;
+  if (std::memcmp(fixture->data_, kFixtureMagic, kMagicSize) != 0 ||
+      std::memcmp(trailer + 2 * kLengthSize, kFixtureMagic, kMagicSize) != 0 ||
+      header_offset > header_end || header_size != header_end - header_offset ||
+      !header.ParseFromArray(fixture->data_ + header_offset, header_size)) {
+    return CorruptFixture(path);
+  }
+
+  for (const FixtureHeader::Table& header_table : header.tables()) {
+    if (header_table.row_count() < 0 || header_table.index_offset() < 0 ||
+        header_table.row_count() >
+            (size - header_table.index_offset()) / kLengthSize) {
+      return CorruptFixture(path);
+    }
+    Table table;
+    ZETASQL_ASSIGN_OR_RETURN(table.binding, bind_table(header_table));
+    if (table.binding.column_ids.size() != header_table.columns_size() ||
+        table.binding.column_types.size() != header_table.columns_size()) {
+      return error::Internal(absl::StrCat("Fixture table ", header_table.name(),
+                                          " is bound to the wrong number of "
+                                          "columns."));
+    }
+    for (int i = 0; i < table.binding.column_ids.size(); ++i) {
+      table.column_positions[table.binding.column_ids[i]] = i;
+    }
+    table.index_offset = header_table.index_offset();
+    table.row_count = header_table.row_count();
+    const TableID table_id = table.binding.table_id;
+    if (!fixture->tables_.emplace(table_id, std::move(table)).second) {
+      return error::Internal(absl::StrCat("Fixture table ", header_table.name(),
+                                          " is bound to a table bound to "
+                                          "another fixture table."));
+    }
+  }
+  return fixture;
+}
+
+// A StorageIterator which merges the rows of a fixture table in a key range
+// with those read from the overlay, skipping fixture rows which have been
+// copied into the overlay.
+class FixtureStorage::MergingIterator : public StorageIterator {
+ public:
+  MergingIterator(const FixtureStorage* storage, const Fixture::Table* table,
+                  int64_t begin, int64_t end,
+                  const std::vector<ColumnID>& column_ids,
+                  std::unique_ptr<StorageIterator> overlay_itr)
+      : storage_(storage),
+        table_(table),
+        position_(begin),
+        end_(end),
+        column_ids_(column_ids),
+        overlay_itr_(std::move(overlay_itr)) {}
+
+  bool Next() override {
+    if (!status_.ok()) {
+      return false;
+    }
+    if (advance_overlay_) {
+      overlay_valid_ = overlay_itr_->Next();
+      if (overlay_valid_) {
+        overlay_key_ = EncodeKey(overlay_itr_->Key());
+      }
+      advance_overlay_ = false;
+    }
+
+    absl::string_view fixture_key;
+    for (; position_ < end_; ++position_) {
+      absl::StatusOr<absl::string_view> key =
+          storage_->fixture_->RowKey(*table_, position_);
+      if (!key.ok()) {
+        status_ = key.status();
+        return false;
+      }
+      if (!storage_->InOverlay(table_->binding.table_id, std::string(*key))) {
+        fixture_key = *key;
+        break;
+      }
+    }
+
+    if (position_ < end_ && (!overlay_valid_ || fixture_key < overlay_key_)) {
+      status_ = storage_->fixture_->RowValues(*table_, position_, column_ids_,
+                                              &values_);
+      key_ = DecodeKey(fixture_key);
+      ++position_;
+      from_overlay_ = false;
+      return status_.ok();
+    }
+    from_overlay_ = true;
+    advance_overlay_ = true;
+    return overlay_valid_;
+  }
+
+  absl::Status Status() const override {
+    return status_.ok() ? overlay_itr_->Status() : status_;
+  }
+
+  const class Key& Key() const override {
+    return from_overlay_ ? overlay_itr_->Key() : key_;
+  }
+
+  int NumColumns() const override { return column_ids_.size(); }
+
+  const zetasql::Value& ColumnValue(int i) const override {
+    return from_overlay_ ? overlay_itr_->ColumnValue(i) : values_[i];
+  }
+
+ private:
+  const FixtureStorage* storage_;
+  const Fixture::Table* table_;
+
+  // The positions of the next and past the last fixture row in the range.
+  int64_t position_;
+  const int64_t end_;
+  const std::vector<ColumnID> column_ids_;
+
+  // The overlay rows, and the encoded key of the current one if it is valid.
+  std::unique_ptr<StorageIterator> overlay_itr_;
+  bool overlay_valid_ = false;
+  bool advance_overlay_ = true;
+  std::string overlay_key_;
+
+  // The current row, if it is a fixture row.
+  bool from_overlay_ = false;
+  class Key key_;
+  std::vector<zetasql::Value> values_;
+
+  absl::Status status_;
+};
+
+absl::StatusOr<std::unique_ptr<FixtureStorage>> FixtureStorage::Open(
+    const std::string& path, const TableBinder& bind_table,
+    std::unique_ptr<Storage> overlay) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<Fixture> fixture,
+                   Fixture::Open(path, bind_table));
+  return absl::WrapUnique(
+      new FixtureStorage(std::move(fixture), std::move(overlay)));
+}
+
+FixtureStorage::FixtureStorage(std::shared_ptr<const Fixture> fixture,
+                               std::unique_ptr<Storage> overlay)
+    : fixture_(std::move(fixture)), overlay_(std::move(overlay)) {}
+
+bool FixtureStorage::InOverlay(const TableID& table_id,
+                               const std::string& encoded_key) const {
+  absl::ReaderMutexLock lock(&mu_);
+  if (truncated_tables_.contains(table_id)) {
+    return true;
+  }
+  auto itr = copied_keys_.find(table_id);
+  return itr != copied_keys_.end() && itr->second.contains(encoded_key);
+}
+
+absl::Status FixtureStorage::CopyToOverlay(const TableID& table_id,
+                                           const Key& key) {
+  const Fixture::Table* table = fixture_->FindTable(table_id);
+  if (table == nullptr || truncated_tables_.contains(table_id)) {
+    return absl::OkStatus();
+  }
+  std::string encoded_key = EncodeKey(key);
+  absl::flat_hash_set<std::string>& copied_keys = copied_keys_[table_id];
+  if (copied_keys.contains(encoded_key)) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(int64_t position,
+                   fixture_->LowerBound(*table, encoded_key));
+  if (position == table->row_count) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(absl::string_view row_key,
+                   fixture_->RowKey(*table, position));
+  if (row_key != encoded_key) {
+    return absl::OkStatus();
+  }
+
+  std::vector<zetasql::Value> row_values;
+  ZETASQL_RETURN_IF_ERROR(fixture_->RowValues(
+      *table, position, table->binding.column_ids, &row_values));
+  std::vector<ColumnID> column_ids;
+  std::vector<zetasql::Value> values;
+  for (int i = 0; i < row_values.size(); ++i) {
+    if (row_values[i].is_valid()) {
+      column_ids.push_back(table->binding.column_ids[i]);
+      values.push_back(std::move(row_values[i]));
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(overlay_->Write(absl::InfinitePast(), table_id, key,
+                                  column_ids, values));
+  copied_keys.insert(std::move(encoded_key));
+  return absl::OkStatus();
+}
+
+absl::Status FixtureStorage::Lookup(absl::Time timestamp,
+                                    const TableID& table_id, const Key& key,
+                                    const std::vector<ColumnID>& column_ids,
+                                    std::vector<zetasql::Value>* values) const {
+  const Fixture::Table* table = fixture_->FindTable(table_id);
+  if (table != nullptr) {
+    const std::string encoded_key = EncodeKey(key);
+    if (!InOverlay(table_id, encoded_key)) {
+      ZETASQL_ASSIGN_OR_RETURN(int64_t position,
+                       fixture_->LowerBound(*table, encoded_key));
+      if (position < table->row_count) {
+        ZETASQL_ASSIGN_OR_RETURN(absl::string_view row_key,
+                         fixture_->RowKey(*table, position));
+        if (row_key == encoded_key) {
+          if (values == nullptr) {
+            return absl::OkStatus();
+          }
+          return fixture_->RowValues(*table, position, column_ids, values);
+        }
+      }
+    }
+  }
+  return overlay_->Lookup(timestamp, table_id, key, column_ids, values);
+}
+
+absl::Status FixtureStorage::Read(absl::Time timestamp,
+                                  const TableID& table_id,
+                                  const KeyRange& key_range,
+                                  const std::vector<ColumnID>& column_ids,
+                                  std::unique_ptr<StorageIterator>* itr) const {
+  std::unique_ptr<StorageIterator> overlay_itr;
+  ZETASQL_RETURN_IF_ERROR(
+      overlay_->Read(timestamp, table_id, key_range, column_ids, &overlay_itr));
+  const Fixture::Table* table = fixture_->FindTable(table_id);
+  if (table == nullptr) {
+    *itr = std::move(overlay_itr);
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      int64_t begin,
+      fixture_->LowerBound(*table, EncodeKey(key_range.start_key())));
+  ZETASQL_ASSIGN_OR_RETURN(
+      int64_t end,
+      fixture_->LowerBound(*table, EncodeKey(key_range.limit_key())));
+  *itr = std::make_unique<MergingIterator>(this, table, begin,
+                                           std::max(begin, end), column_ids,
+                                           std::move(overlay_itr));
+  return absl::OkStatus();
+}
+
+absl::Status FixtureStorage::Write(absl::Time timestamp,
+                                   const TableID& table_id, const Key& key,
+                                   const std::vector<ColumnID>& column_ids,
+                                   const std::vector<zetasql::Value>& values) {
+  {
+    absl::MutexLock lock(&mu_);
+    ZETASQL_RETURN_IF_ERROR(CopyToOverlay(table_id, key));
+  }
+  return overlay_->Write(timestamp, table_id, key, column_ids, values);
+}
+
+absl::Status FixtureStorage::Delete(absl::Time timestamp,
+                                    const TableID& table_id,
+                                    const KeyRange& key_range) {
+  const Fixture::Table* table = fixture_->FindTable(table_id);
+  if (table != nullptr) {
+    // Reads before timestamp still see the deleted rows, so each of them is
+    // copied into the overlay.
+    ZETASQL_ASSIGN_OR_RETURN(
+        int64_t begin,
+        fixture_->LowerBound(*table, EncodeKey(key_range.start_key())));
+    ZETASQL_ASSIGN_OR_RETURN(
+        int64_t end,
+        fixture_->LowerBound(*table, EncodeKey(key_range.limit_key())));
+    absl::MutexLock lock(&mu_);
+    for (int64_t position = begin; position < end; ++position) {
+      ZETASQL_ASSIGN_OR_RETURN(absl::string_view row_key,
+                       fixture_->RowKey(*table, position));
+      ZETASQL_RETURN_IF_ERROR(CopyToOverlay(table_id, DecodeKey(row_key)));
+    }
+  }
+  return overlay_->Delete(timestamp, table_id, key_range);
+}
+
+absl::Status FixtureStorage::ApplyBatch(absl::Time timestamp,
+                                        absl::Span<StorageWriteOp> ops) {
+  {
+    absl::MutexLock lock(&mu_);
+    for (const StorageWriteOp& op : ops) {
+      ZETASQL_RETURN_IF_ERROR(CopyToOverlay(op.table_id, op.key));
+    }
+  }
+  return overlay_->ApplyBatch(timestamp, ops);
+}
+
+absl::StatusOr<std::unique_ptr<Storage>> FixtureStorage::Clone() const {
+  absl::ReaderMutexLock lock(&mu_);
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<Storage> overlay, overlay_->Clone());
+  auto clone =
+      absl::WrapUnique(new FixtureStorage(fixture_, std::move(overlay)));
+  clone->copied_keys_ = copied_keys_;
+  clone->truncated_tables_ = truncated_tables_;
+  return clone;
+}
+
+absl::Status FixtureStorage::Truncate(absl::Time timestamp,
+                                      absl::Span<const TableID> table_ids) {
+  {
+    absl::MutexLock lock(&mu_);
+    for (const TableID& table_id : table_ids) {
+      truncated_tables_.insert(table_id);
+      copied_keys_.erase(table_id);
+    }
+  }
+  return overlay_->Truncate(timestamp, table_ids);
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
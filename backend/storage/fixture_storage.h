@@ -0,0 +1,245 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_FIXTURE_STORAGE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_FIXTURE_STORAGE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/fixture.pb.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/key_access_heatmap.h"
+#include "backend/storage/storage.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// FixtureWriter writes the rows of a set of tables to a fixture file, which
+// FixtureStorage serves reads from without loading it into memory.
+//
+// A fixture file starts and ends with a magic string. It holds the rows of each
+// table in key order, each as its memcomparable key (see EncodeKey) followed by
+// a FixtureRow, then for each table an array of the offsets of its rows, and
+// finally a FixtureHeader. Lengths and offsets are stored in host byte order,
+// as fixtures are meant to be shared by processes on a single host.
+//
+// Tables and columns are recorded by name rather than by ID, so that a fixture
+// can be used by any database with a compatible schema.
+class FixtureWriter {
+ public:
+  // Creates a writer for a fixture at path. The file is only moved to path by
+  // Finish, so that an existing fixture is kept if writing fails.
+  static absl::StatusOr<std::unique_ptr<FixtureWriter>> Create(
+      const std::string& path);
+
+  // Starts the rows of a table, or of an index if is_index is true, with the
+  // given columns. Each table may only be added once.
+  absl::Status AddTable(const std::string& name, bool is_index,
+                        const std::vector<std::string>& columns);
+
+  // Adds a row to the last table added, with a value for each of its columns.
+  // Invalid values are recorded as not set. Rows must be added in key order.
+  absl::Status AddRow(const Key& key, absl::Span<const zetasql::Value> values);
+
+  // Writes the index and header, and moves the file to its path.
+  absl::Status Finish();
+
+ private:
+  FixtureWriter(const std::string& path, const std::string& temp_path);
+
+  // Appends data to the file.
+  absl::Status Append(const char* data, int64_t size);
+  absl::Status AppendLength(uint64_t length);
+
+  // Writes the offsets of the rows of the last table added.
+  absl::Status FinishTable();
+
+  const std::string path_;
+  const std::string temp_path_;
+  std::ofstream out_;
+
+  // The number of bytes written so far.
+  int64_t size_ = 0;
+
+  FixtureHeader header_;
+
+  // The offsets and the encoded key of the last row of the last table added.
+  std::vector<uint64_t> row_offsets_;
+  std::string last_key_;
+};
+
+// FixtureStorage serves the rows of a read-only fixture file, plus any changes
+// made to them, which are kept in an overlay storage.
+//
+// The file is memory-mapped, and only the rows which are read are decoded, so
+// processes which open the same fixture share its pages in the page cache, and
+// opening a fixture takes time proportional to the number of its tables rather
+// than of its rows. Fixture rows behave as if they were written at the
+// beginning of time, so they are visible to reads at any timestamp.
+//
+// Writes go to the overlay. Before the first write or delete of a key, its
+// fixture row is copied into the overlay at absl::InfinitePast(), and from then
+// on the overlay alone holds the key, so that the usual multi-version semantics
+// apply to it. Reads of other fixture rows are served from the file, and range
+// reads merge the file with the overlay. Deleting a range therefore copies the
+// fixture rows in it first, and truncating a table drops its fixture rows.
+//
+// Statistics and row counts are not maintained, as the overlay only has some
+// of the rows.
+//
+// This class is thread-safe.
+class FixtureStorage : public Storage {
+ public:
+  // The table which holds the rows of a table of the fixture, its columns and
+  // their types.
+  struct TableBinding {
+    TableID table_id;
+    std::vector<ColumnID> column_ids;
+    std::vector<const zetasql::Type*> column_types;
+  };
+
+  // Maps a table of the fixture to a table of the database. Returning an error
+  // fails Open.
+  using TableBinder =
+      std::function<absl::StatusOr<TableBinding>(const FixtureHeader::Table&)>;
+
+  // Opens the fixture at path, with tables bound by bind_table, on top of
+  // overlay. The types of the bindings must outlive the storage.
+  static absl::StatusOr<std::unique_ptr<FixtureStorage>> Open(
+      const std::string& path, const TableBinder& bind_table,
+      std::unique_ptr<Storage> overlay);
+
+  absl::Status Lookup(absl::Time timestamp, const TableID& table_id,
+                      const Key& key, const std::vector<ColumnID>& column_ids,
+                      std::vector<zetasql::Value>* values) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Read(absl::Time timestamp, const TableID& table_id,
+                    const KeyRange& key_range,
+                    const std::vector<ColumnID>& column_ids,
+                    std::unique_ptr<StorageIterator>* itr) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Write(absl::Time timestamp, const TableID& table_id,
+                     const Key& key, const std::vector<ColumnID>& column_ids,
+                     const std::vector<zetasql::Value>& values) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Delete(absl::Time timestamp, const TableID& table_id,
+                      const KeyRange& key_range) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status ApplyBatch(absl::Time timestamp,
+                          absl::Span<StorageWriteOp> ops) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  int64_t CollectGarbage(absl::Time version_horizon) override {
+    return overlay_->CollectGarbage(version_horizon);
+  }
+
+  int64_t CompressVersions(absl::Time cold_horizon) override {
+    return overlay_->CompressVersions(cold_horizon);
+  }
+
+  void RegisterInterleavedTable(const TableID& parent_table_id,
+                                int parent_key_size,
+                                const TableID& child_table_id,
+                                int child_key_size) override {
+    overlay_->RegisterInterleavedTable(parent_table_id, parent_key_size,
+                                       child_table_id, child_key_size);
+  }
+
+  absl::StatusOr<std::unique_ptr<Storage>> Clone() const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status Truncate(absl::Time timestamp,
+                        absl::Span<const TableID> table_ids) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  std::map<TableID, StorageMemoryUsage> GetMemoryUsage() const override {
+    return overlay_->GetMemoryUsage();
+  }
+
+  absl::Status CheckMemoryQuota() const override {
+    return overlay_->CheckMemoryQuota();
+  }
+
+  const KeyAccessHeatmap* key_access_heatmap() const override {
+    return overlay_->key_access_heatmap();
+  }
+
+ private:
+  class Fixture;
+  class MergingIterator;
+
+  FixtureStorage(std::shared_ptr<const Fixture> fixture,
+                 std::unique_ptr<Storage> overlay);
+
+  // Returns true if the key with the given encoding is served by the overlay
+  // rather than by the fixture.
+  bool InOverlay(const TableID& table_id, const std::string& encoded_key) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Copies the fixture row of key, if there is one, into the overlay unless it
+  // is there already.
+  absl::Status CopyToOverlay(const TableID& table_id, const Key& key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // The fixture, shared with clones of this storage.
+  const std::shared_ptr<const Fixture> fixture_;
+
+  const std::unique_ptr<Storage> overlay_;
+
+  // Guards copies of fixture rows into the overlay, and the records of them.
+  mutable absl::Mutex mu_;
+
+  // The encoded keys of the fixture rows of each table which have been copied
+  // into the overlay.
+  absl::flat_hash_map<TableID, absl::flat_hash_set<std::string>> copied_keys_
+      ABSL_GUARDED_BY(mu_);
+
+  // Tables whose fixture rows have been dropped by Truncate.
+  absl::flat_hash_set<TableID> truncated_tables_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_FIXTURE_STORAGE_H_
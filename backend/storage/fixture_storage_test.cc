@@ -0,0 +1,174 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/fixture_storage.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_storage.h"
+#include "backend/storage/iterator.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using ::testing::Pair;
+using zetasql::values::Int64;
+using zetasql::values::String;
+using zetasql_base::testing::StatusIs;
+
+class FixtureStorageTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = absl::StrCat(testing::TempDir(), "/fixture_storage_test.fixture");
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<FixtureWriter> writer,
+                         FixtureWriter::Create(path_));
+    ZETASQL_ASSERT_OK(writer->AddTable("T", /*is_index=*/false, {"K", "V"}));
+    for (int i = 1; i <= 3; ++i) {
+      ZETASQL_ASSERT_OK(writer->AddRow(Key({Int64(i * 10)}),
+                               {Int64(i * 10), String(absl::StrCat("v", i))}));
+    }
+    ZETASQL_ASSERT_OK(writer->Finish());
+  }
+
+  absl::StatusOr<std::unique_ptr<FixtureStorage>> Open() {
+    return FixtureStorage::Open(
+        path_,
+        [this](const FixtureHeader::Table& table)
+            -> absl::StatusOr<FixtureStorage::TableBinding> {
+          if (table.name() != "T" || table.is_index()) {
+            return absl::NotFoundError(table.name());
+          }
+          return FixtureStorage::TableBinding{
+              .table_id = kTableId,
+              .column_ids = {kKeyColumnId, kValueColumnId},
+              .column_types = {zetasql::types::Int64Type(),
+                               zetasql::types::StringType()},
+          };
+        },
+        std::make_unique<InMemoryStorage>());
+  }
+
+  // Returns the keys and values of every row visible at timestamp.
+  std::vector<std::pair<Key, zetasql::Value>> ReadAll(const Storage& storage,
+                                                       absl::Time timestamp) {
+    std::unique_ptr<StorageIterator> itr;
+    ZETASQL_EXPECT_OK(storage.Read(timestamp, kTableId, KeyRange::All(),
+                           {kValueColumnId}, &itr));
+    std::vector<std::pair<Key, zetasql::Value>> rows;
+    while (itr->Next()) {
+      rows.emplace_back(itr->Key(), itr->ColumnValue(0));
+    }
+    ZETASQL_EXPECT_OK(itr->Status());
+    return rows;
+  }
+
+  const TableID kTableId = "test_table:0";
+  const ColumnID kKeyColumnId = "test_column:0";
+  const ColumnID kValueColumnId = "test_column:1";
+  std::string path_;
+};
+
+TEST_F(FixtureStorageTest, ServesFixtureRowsAtAnyTimestamp) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<FixtureStorage> storage, Open());
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage->Lookup(absl::InfinitePast(), kTableId,
+                            Key({Int64(20)}),
+                            {kValueColumnId, "unknown_column"}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("v2"), zetasql::Value()));
+  EXPECT_THAT(storage->Lookup(absl::Now(), kTableId, Key({Int64(25)}),
+                              {kValueColumnId}, &values),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_EXPECT_OK(storage->Read(absl::Now(), kTableId,
+                          KeyRange::ClosedOpen(Key({Int64(15)}),
+                                               Key({Int64(30)})),
+                          {kValueColumnId}, &itr));
+  ASSERT_TRUE(itr->Next());
+  EXPECT_EQ(itr->Key(), Key({Int64(20)}));
+  EXPECT_EQ(itr->ColumnValue(0), String("v2"));
+  EXPECT_FALSE(itr->Next());
+  ZETASQL_EXPECT_OK(itr->Status());
+}
+
+TEST_F(FixtureStorageTest, MergesChangesWithFixtureRows) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<FixtureStorage> storage, Open());
+  const absl::Time t0 = absl::Now();
+  const absl::Time t1 = t0 + absl::Seconds(1);
+  ZETASQL_ASSERT_OK(storage->Write(t1, kTableId, Key({Int64(15)}),
+                           {kKeyColumnId, kValueColumnId},
+                           {Int64(15), String("new")}));
+  ZETASQL_ASSERT_OK(storage->Write(t1, kTableId, Key({Int64(20)}),
+                           {kValueColumnId}, {String("changed")}));
+  ZETASQL_ASSERT_OK(storage->Delete(
+      t1, kTableId, KeyRange::ClosedOpen(Key({Int64(30)}), Key({Int64(40)}))));
+
+  EXPECT_THAT(ReadAll(*storage, t0),
+              testing::ElementsAre(Pair(Key({Int64(10)}), String("v1")),
+                                   Pair(Key({Int64(20)}), String("v2")),
+                                   Pair(Key({Int64(30)}), String("v3"))));
+  EXPECT_THAT(ReadAll(*storage, t1),
+              testing::ElementsAre(Pair(Key({Int64(10)}), String("v1")),
+                                   Pair(Key({Int64(15)}), String("new")),
+                                   Pair(Key({Int64(20)}), String("changed"))));
+
+  // Columns which were not written keep their fixture values.
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage->Lookup(t1, kTableId, Key({Int64(20)}),
+                            {kKeyColumnId, kValueColumnId}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(Int64(20), String("changed")));
+  EXPECT_THAT(storage->Lookup(t1, kTableId, Key({Int64(30)}), {}, nullptr),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  // Clones share the fixture but not later changes.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Storage> clone,
+                       storage->Clone());
+  ZETASQL_ASSERT_OK(storage->Truncate(t1, {kTableId}));
+  EXPECT_THAT(ReadAll(*storage, t1), testing::IsEmpty());
+  EXPECT_EQ(ReadAll(*clone, t1).size(), 3);
+}
+
+TEST_F(FixtureStorageTest, RejectsCorruptFixtures) {
+  {
+    std::ofstream out(path_, std::ios::binary | std::ios::trunc);
+    out << "not a fixture";
+  }
+  EXPECT_THAT(Open(), StatusIs(absl::StatusCode::kInternal));
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,277 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/hydrating_storage.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/storage.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+HydratingStorage::HydratingStorage(std::unique_ptr<Storage> base)
+    : base_(std::move(base)) {}
+
+HydratingStorage::~HydratingStorage() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void HydratingStorage::AddTable(absl::Time timestamp, const TableID& table_id,
+                                Loader loader) {
+  absl::MutexLock lock(&mu_);
+  auto [it, inserted] = pending_.try_emplace(table_id);
+  it->second = PendingTable{timestamp, std::move(loader)};
+  if (inserted) {
+    queue_.push_back(table_id);
+    num_unhydrated_tables_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void HydratingStorage::HydrateInBackground(int num_threads) {
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this]() { HydrateQueuedTables(); });
+  }
+}
+
+void HydratingStorage::HydrateQueuedTables() const {
+  while (true) {
+    TableID table_id;
+    {
+      absl::MutexLock lock(&mu_);
+      // Skip tables which have been hydrated by an access meanwhile.
+      while (!queue_.empty() && !pending_.contains(queue_.front())) {
+        queue_.pop_front();
+      }
+      if (stopping_ || queue_.empty()) {
+        return;
+      }
+      table_id = queue_.front();
+      queue_.pop_front();
+    }
+    // Failures are returned to the calls which access the table.
+    Hydrate(table_id).IgnoreError();
+  }
+}
+
+absl::Status HydratingStorage::Hydrate(const TableID& table_id) const {
+  if (num_unhydrated_tables_.load(std::memory_order_acquire) == 0) {
+    return absl::OkStatus();
+  }
+
+  PendingTable table;
+  {
+    absl::MutexLock lock(&mu_);
+    while (hydrating_.contains(table_id)) {
+      hydrated_.Wait(&mu_);
+    }
+    if (auto it = failed_.find(table_id); it != failed_.end()) {
+      return it->second;
+    }
+    auto it = pending_.find(table_id);
+    if (it == pending_.end()) {
+      return absl::OkStatus();
+    }
+    table = std::move(it->second);
+    pending_.erase(it);
+    hydrating_.insert(table_id);
+  }
+
+  absl::Status status = [&]() -> absl::Status {
+    ZETASQL_ASSIGN_OR_RETURN(std::vector<StorageWriteOp> ops, table.loader());
+    return base_->ApplyBatch(table.timestamp, absl::MakeSpan(ops));
+  }();
+
+  absl::MutexLock lock(&mu_);
+  hydrating_.erase(table_id);
+  if (status.ok()) {
+    num_unhydrated_tables_.fetch_sub(1, std::memory_order_release);
+  } else {
+    failed_.emplace(table_id, status);
+  }
+  hydrated_.SignalAll();
+  return status;
+}
+
+absl::Status HydratingStorage::HydrateAll() const {
+  std::vector<TableID> table_ids;
+  {
+    absl::MutexLock lock(&mu_);
+    table_ids.reserve(pending_.size() + hydrating_.size() + failed_.size());
+    for (const auto& [table_id, table] : pending_) {
+      table_ids.push_back(table_id);
+    }
+    table_ids.insert(table_ids.end(), hydrating_.begin(), hydrating_.end());
+    for (const auto& [table_id, status] : failed_) {
+      table_ids.push_back(table_id);
+    }
+  }
+  for (const TableID& table_id : table_ids) {
+    ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status HydratingStorage::Lookup(
+    absl::Time timestamp, const TableID& table_id, const Key& key,
+    const std::vector<ColumnID>& column_ids,
+    std::vector<zetasql::Value>* values) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->Lookup(timestamp, table_id, key, column_ids, values);
+}
+
+absl::Status HydratingStorage::VisitLookup(
+    absl::Time timestamp, const TableID& table_id, const Key& key,
+    const std::vector<ColumnID>& column_ids,
+    ColumnValueVisitor visitor) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->VisitLookup(timestamp, table_id, key, column_ids, visitor);
+}
+
+absl::StatusOr<bool> HydratingStorage::Exists(absl::Time timestamp,
+                                              const TableID& table_id,
+                                              const Key& key) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->Exists(timestamp, table_id, key);
+}
+
+absl::Status HydratingStorage::MultiLookup(
+    absl::Time timestamp, const TableID& table_id,
+    absl::Span<const Key> sorted_keys, const std::vector<ColumnID>& column_ids,
+    std::vector<std::pair<Key, std::vector<zetasql::Value>>>* rows) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->MultiLookup(timestamp, table_id, sorted_keys, column_ids, rows);
+}
+
+absl::Status HydratingStorage::Read(
+    absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
+    const std::vector<ColumnID>& column_ids,
+    std::unique_ptr<StorageIterator>* itr) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->Read(timestamp, table_id, key_range, column_ids, itr);
+}
+
+absl::Status HydratingStorage::ReadReverse(
+    absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
+    const std::vector<ColumnID>& column_ids,
+    std::unique_ptr<StorageIterator>* itr) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->ReadReverse(timestamp, table_id, key_range, column_ids, itr);
+}
+
+absl::Status HydratingStorage::Write(
+    absl::Time timestamp, const TableID& table_id, const Key& key,
+    const std::vector<ColumnID>& column_ids,
+    const std::vector<zetasql::Value>& values) {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->Write(timestamp, table_id, key, column_ids, values);
+}
+
+absl::Status HydratingStorage::Write(absl::Time timestamp,
+                                     const TableID& table_id, const Key& key,
+                                     const std::vector<ColumnID>& column_ids,
+                                     std::vector<zetasql::Value>&& values) {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->Write(timestamp, table_id, key, column_ids, std::move(values));
+}
+
+absl::Status HydratingStorage::Delete(absl::Time timestamp,
+                                      const TableID& table_id,
+                                      const KeyRange& key_range) {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->Delete(timestamp, table_id, key_range);
+}
+
+absl::Status HydratingStorage::ApplyBatch(absl::Time timestamp,
+                                          absl::Span<StorageWriteOp> ops) {
+  if (num_unhydrated_tables_.load(std::memory_order_acquire) > 0) {
+    absl::flat_hash_set<TableID> table_ids;
+    for (const StorageWriteOp& op : ops) {
+      if (table_ids.insert(op.table_id).second) {
+        ZETASQL_RETURN_IF_ERROR(Hydrate(op.table_id));
+      }
+    }
+  }
+  return base_->ApplyBatch(timestamp, ops);
+}
+
+absl::StatusOr<std::unique_ptr<Storage>> HydratingStorage::Clone() const {
+  ZETASQL_RETURN_IF_ERROR(HydrateAll());
+  return base_->Clone();
+}
+
+absl::Status HydratingStorage::Truncate(absl::Time timestamp,
+                                        absl::Span<const TableID> table_ids) {
+  {
+    absl::MutexLock lock(&mu_);
+    for (const TableID& table_id : table_ids) {
+      while (hydrating_.contains(table_id)) {
+        hydrated_.Wait(&mu_);
+      }
+      if (pending_.erase(table_id) > 0 || failed_.erase(table_id) > 0) {
+        num_unhydrated_tables_.fetch_sub(1, std::memory_order_release);
+      }
+    }
+  }
+  return base_->Truncate(timestamp, table_ids);
+}
+
+absl::StatusOr<StorageRangeStats> HydratingStorage::EstimateRange(
+    const TableID& table_id, const KeyRange& key_range) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->EstimateRange(table_id, key_range);
+}
+
+absl::StatusOr<Key> HydratingStorage::EstimateNthKey(const TableID& table_id,
+                                                     int64_t n) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->EstimateNthKey(table_id, n);
+}
+
+absl::StatusOr<int64_t> HydratingStorage::RowCount(const TableID& table_id,
+                                                   absl::Time timestamp) const {
+  ZETASQL_RETURN_IF_ERROR(Hydrate(table_id));
+  return base_->RowCount(table_id, timestamp);
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,227 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_HYDRATING_STORAGE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_HYDRATING_STORAGE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/key_access_heatmap.h"
+#include "backend/storage/storage.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// HydratingStorage defers writing the initial rows of tables to a base storage
+// until the tables are first accessed, so that a database restored from a
+// large snapshot can serve requests before all of its rows are decoded.
+//
+// Each table added with AddTable is hydrated, i.e. has the rows produced by
+// its loader written to the base storage, by the first call which reads or
+// writes the table, or by a background thread started with
+// HydrateInBackground. Calls for a table which is being hydrated by another
+// thread wait for it to finish. If a loader fails, every later call for its
+// table returns the error.
+//
+// Once every table is hydrated, calls go straight to the base storage, except
+// for a check of an atomic counter.
+//
+// This class is thread-safe.
+class HydratingStorage : public Storage {
+ public:
+  // Returns the rows of a table, to be written at the timestamp the table was
+  // added with.
+  using Loader = std::function<absl::StatusOr<std::vector<StorageWriteOp>>()>;
+
+  explicit HydratingStorage(std::unique_ptr<Storage> base);
+
+  // Stops the background threads, leaving the remaining tables unhydrated.
+  ~HydratingStorage() override ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Defers writing the rows of table_id returned by loader at timestamp until
+  // the table is first accessed. The table must not have been accessed yet.
+  void AddTable(absl::Time timestamp, const TableID& table_id, Loader loader)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Starts num_threads threads which hydrate the tables which have not been
+  // accessed yet, in the order they were added.
+  void HydrateInBackground(int num_threads) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Hydrates every table which has not been hydrated yet.
+  absl::Status HydrateAll() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of tables which have not been hydrated yet.
+  int64_t num_unhydrated_tables() const {
+    return num_unhydrated_tables_.load(std::memory_order_acquire);
+  }
+
+  absl::Status Lookup(absl::Time timestamp, const TableID& table_id,
+                      const Key& key, const std::vector<ColumnID>& column_ids,
+                      std::vector<zetasql::Value>* values) const override;
+
+  absl::Status VisitLookup(absl::Time timestamp, const TableID& table_id,
+                           const Key& key,
+                           const std::vector<ColumnID>& column_ids,
+                           ColumnValueVisitor visitor) const override;
+
+  absl::StatusOr<bool> Exists(absl::Time timestamp, const TableID& table_id,
+                              const Key& key) const override;
+
+  absl::Status MultiLookup(
+      absl::Time timestamp, const TableID& table_id,
+      absl::Span<const Key> sorted_keys,
+      const std::vector<ColumnID>& column_ids,
+      std::vector<std::pair<Key, std::vector<zetasql::Value>>>* rows)
+      const override;
+
+  absl::Status Read(absl::Time timestamp, const TableID& table_id,
+                    const KeyRange& key_range,
+                    const std::vector<ColumnID>& column_ids,
+                    std::unique_ptr<StorageIterator>* itr) const override;
+
+  absl::Status ReadReverse(absl::Time timestamp, const TableID& table_id,
+                           const KeyRange& key_range,
+                           const std::vector<ColumnID>& column_ids,
+                           std::unique_ptr<StorageIterator>* itr)
+      const override;
+
+  absl::Status Write(absl::Time timestamp, const TableID& table_id,
+                     const Key& key, const std::vector<ColumnID>& column_ids,
+                     const std::vector<zetasql::Value>& values) override;
+
+  absl::Status Write(absl::Time timestamp, const TableID& table_id,
+                     const Key& key, const std::vector<ColumnID>& column_ids,
+                     std::vector<zetasql::Value>&& values) override;
+
+  absl::Status Delete(absl::Time timestamp, const TableID& table_id,
+                      const KeyRange& key_range) override;
+
+  absl::Status ApplyBatch(absl::Time timestamp,
+                          absl::Span<StorageWriteOp> ops) override;
+
+  int64_t CollectGarbage(absl::Time version_horizon) override {
+    return base_->CollectGarbage(version_horizon);
+  }
+
+  int64_t CompressVersions(absl::Time cold_horizon) override {
+    return base_->CompressVersions(cold_horizon);
+  }
+
+  void RegisterInterleavedTable(const TableID& parent_table_id,
+                                int parent_key_size,
+                                const TableID& child_table_id,
+                                int child_key_size) override {
+    base_->RegisterInterleavedTable(parent_table_id, parent_key_size,
+                                    child_table_id, child_key_size);
+  }
+
+  // Hydrates every table first, so that the clone has all of their rows.
+  absl::StatusOr<std::unique_ptr<Storage>> Clone() const override;
+
+  // Drops the rows of tables which have not been hydrated yet unread.
+  absl::Status Truncate(absl::Time timestamp,
+                        absl::Span<const TableID> table_ids) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::StatusOr<StorageRangeStats> EstimateRange(
+      const TableID& table_id, const KeyRange& key_range) const override;
+
+  absl::StatusOr<Key> EstimateNthKey(const TableID& table_id,
+                                     int64_t n) const override;
+
+  absl::StatusOr<int64_t> RowCount(const TableID& table_id,
+                                   absl::Time timestamp) const override;
+
+  std::map<TableID, StorageMemoryUsage> GetMemoryUsage() const override {
+    return base_->GetMemoryUsage();
+  }
+
+  absl::Status CheckMemoryQuota() const override {
+    return base_->CheckMemoryQuota();
+  }
+
+  const KeyAccessHeatmap* key_access_heatmap() const override {
+    return base_->key_access_heatmap();
+  }
+
+ private:
+  struct PendingTable {
+    absl::Time timestamp;
+    Loader loader;
+  };
+
+  // Hydrates table_id unless it has been hydrated already, waiting for another
+  // thread which is hydrating it. Returns the error of its loader, if any.
+  absl::Status Hydrate(const TableID& table_id) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Hydrates tables taken from queue_ until it is empty or the storage is
+  // destroyed.
+  void HydrateQueuedTables() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  const std::unique_ptr<Storage> base_;
+
+  // The number of tables in pending_, being hydrated or failed, so that calls
+  // need not take mu_ once every table is hydrated.
+  mutable std::atomic<int64_t> num_unhydrated_tables_ = 0;
+
+  mutable absl::Mutex mu_;
+  mutable absl::flat_hash_map<TableID, PendingTable> pending_
+      ABSL_GUARDED_BY(mu_);
+
+  // Tables in the order they were added, for the background threads.
+  mutable std::deque<TableID> queue_ ABSL_GUARDED_BY(mu_);
+
+  // Tables whose loader is running, and the errors of failed loaders.
+  mutable absl::flat_hash_set<TableID> hydrating_ ABSL_GUARDED_BY(mu_);
+  mutable absl::flat_hash_map<TableID, absl::Status> failed_
+      ABSL_GUARDED_BY(mu_);
+
+  // Signalled whenever a table has been hydrated or failed.
+  mutable absl::CondVar hydrated_;
+
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_HYDRATING_STORAGE_H_
@@ -0,0 +1,150 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/hydrating_storage.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_storage.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/storage.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql_base::testing::StatusIs;
+
+class HydratingStorageTest : public testing::Test {
+ protected:
+  // Returns a loader which counts its calls and returns one row per key.
+  HydratingStorage::Loader CountingLoader(const TableID& table_id,
+                                          std::vector<int64_t> keys) {
+    return [this, table_id, keys]()
+               -> absl::StatusOr<std::vector<StorageWriteOp>> {
+      ++num_loads_;
+      std::vector<StorageWriteOp> ops;
+      for (int64_t key : keys) {
+        ops.push_back(StorageWriteOp{.table_id = table_id,
+                                     .key = Key({Int64(key)}),
+                                     .column_ids = {kColumnId},
+                                     .values = {Int64(key * 10)}});
+      }
+      return ops;
+    };
+  }
+
+  const TableID kTableA = "test_table:0";
+  const TableID kTableB = "test_table:1";
+  const ColumnID kColumnId = "test_column:0";
+  const absl::Time kRestoreTime = absl::Now();
+  std::atomic<int> num_loads_ = 0;
+  HydratingStorage storage_{std::make_unique<InMemoryStorage>()};
+};
+
+TEST_F(HydratingStorageTest, HydratesTablesOnFirstAccess) {
+  storage_.AddTable(kRestoreTime, kTableA, CountingLoader(kTableA, {1, 2}));
+  storage_.AddTable(kRestoreTime, kTableB, CountingLoader(kTableB, {3}));
+  EXPECT_EQ(num_loads_, 0);
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(kRestoreTime, kTableA, Key({Int64(2)}),
+                            {kColumnId}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(Int64(20)));
+  EXPECT_EQ(num_loads_, 1);
+  EXPECT_EQ(storage_.num_unhydrated_tables(), 1);
+
+  // Rows restored into the table are not visible before the restore.
+  EXPECT_THAT(storage_.Lookup(kRestoreTime - absl::Seconds(1), kTableA,
+                              Key({Int64(2)}), {kColumnId}, &values),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  // Writes land on top of the restored rows.
+  const absl::Time t1 = kRestoreTime + absl::Seconds(1);
+  ZETASQL_ASSERT_OK(storage_.Write(t1, kTableB, Key({Int64(4)}), {kColumnId},
+                           {Int64(40)}));
+  EXPECT_EQ(num_loads_, 2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(int64_t row_count,
+                       storage_.RowCount(kTableB, t1));
+  EXPECT_EQ(row_count, 2);
+
+  ZETASQL_EXPECT_OK(storage_.HydrateAll());
+  EXPECT_EQ(num_loads_, 2);
+  EXPECT_EQ(storage_.num_unhydrated_tables(), 0);
+}
+
+TEST_F(HydratingStorageTest, ReturnsLoaderErrorsOnEveryAccess) {
+  storage_.AddTable(kRestoreTime, kTableA,
+                    []() -> absl::StatusOr<std::vector<StorageWriteOp>> {
+                      return absl::InternalError("corrupt snapshot");
+                    });
+  std::unique_ptr<StorageIterator> itr;
+  EXPECT_THAT(storage_.Read(kRestoreTime, kTableA, KeyRange::All(),
+                            {kColumnId}, &itr),
+              StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT(storage_.Exists(kRestoreTime, kTableA, Key({Int64(1)})),
+              StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT(storage_.Clone(), StatusIs(absl::StatusCode::kInternal));
+
+  // Truncating the table discards the failed rows.
+  ZETASQL_EXPECT_OK(storage_.Truncate(kRestoreTime, {kTableA}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(bool exists,
+                       storage_.Exists(kRestoreTime, kTableA, Key({Int64(1)})));
+  EXPECT_FALSE(exists);
+}
+
+TEST_F(HydratingStorageTest, HydratesTablesInBackground) {
+  absl::Notification release;
+  storage_.AddTable(kRestoreTime, kTableA,
+                    [&]() -> absl::StatusOr<std::vector<StorageWriteOp>> {
+                      release.WaitForNotification();
+                      return CountingLoader(kTableA, {1})();
+                    });
+  storage_.AddTable(kRestoreTime, kTableB, CountingLoader(kTableB, {2}));
+  storage_.HydrateInBackground(/*num_threads=*/2);
+  release.Notify();
+
+  // Accesses wait for the background threads hydrating their tables.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(bool exists,
+                       storage_.Exists(kRestoreTime, kTableA, Key({Int64(1)})));
+  EXPECT_TRUE(exists);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      exists, storage_.Exists(kRestoreTime, kTableB, Key({Int64(2)})));
+  EXPECT_TRUE(exists);
+  EXPECT_EQ(num_loads_, 2);
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
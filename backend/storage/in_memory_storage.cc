@@ -16,14 +16,26 @@
 
 #include "backend/storage/in_memory_storage.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "zetasql/public/value.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "backend/common/memory_reclaimer.h"
+#include "backend/datamodel/key_encoding.h"
+#include "backend/storage/batched_range_iterator.h"
+#include "backend/storage/cold_versions.h"
 #include "backend/storage/in_memory_iterator.h"
+#include "backend/storage/key_filter.h"
 #include "common/errors.h"
 #include "absl/status/status.h"
 
@@ -38,38 +50,202 @@ static constexpr char kExistsColumn[] = "_exists";
 
 }  // namespace
 
+// A StorageIterator over the rows of a table in a key range as of a timestamp.
+//
+// For a clustered table, key_range is a range of storage keys and rows of other
+// tables in it are skipped.
+class InMemoryStorage::RangeIterator : public BatchedRangeIterator {
+ public:
+  RangeIterator(const Table* table, const Layout* layout, absl::Time timestamp,
+                const KeyRange& key_range, std::vector<ColumnID> column_ids,
+                bool reverse)
+      : BatchedRangeIterator(key_range, column_ids.size(), reverse),
+        table_(table),
+        layout_(layout),
+        timestamp_(timestamp),
+        column_ids_(std::move(column_ids)) {}
+
+ private:
+  absl::Status FetchBatch(
+      std::vector<FixedRowStorageIterator::Row>* rows) override {
+    absl::ReaderMutexLock lock(&table_->mu);
+    VisitBatch(*table_->rows,
+               [&](const std::string& storage_key, const Row& row) {
+                 return AddRow(storage_key, row, rows);
+               });
+    return absl::OkStatus();
+  }
+
+  // Appends the given row to rows if it is a row of the table visible at
+  // timestamp_, and returns whether it did.
+  bool AddRow(const std::string& storage_key, const Row& row,
+              std::vector<FixedRowStorageIterator::Row>* rows) const {
+    if (!Exists(row, timestamp_)) {
+      return false;
+    }
+    class Key key = DecodeKey(storage_key);
+    if (layout_ != nullptr) {
+      if (!IsTableRow(*layout_, key)) {
+        return false;
+      }
+      key = FromStorageKey(*layout_, key);
+    }
+    const absl::Time insert_timestamp = InsertTimestamp(row, timestamp_);
+    std::vector<zetasql::Value> values;
+    values.reserve(column_ids_.size());
+    for (const ColumnID& column_id : column_ids_) {
+      values.emplace_back(GetCellValueAtTimestamp(row, column_id, timestamp_,
+                                                  insert_timestamp));
+    }
+    rows->emplace_back(std::move(key), std::move(values));
+    return true;
+  }
+
+  const Table* table_;
+  const Layout* layout_;
+  const absl::Time timestamp_;
+  const std::vector<ColumnID> column_ids_;
+};
+
+const InMemoryStorage::Layout* InMemoryStorage::FindLayout(
+    const TableID& table_id) const {
+  return layouts_index_.Find(table_id);
+}
+
+InMemoryStorage::Table* InMemoryStorage::FindTable(
+    const TableID& table_id, const Layout** layout) const {
+  *layout = FindLayout(table_id);
+  return tables_index_.Find(*layout != nullptr ? (*layout)->root_table_id
+                                               : table_id);
+}
+
+InMemoryStorage::Table* InMemoryStorage::FindOrCreateTable(
+    const TableID& table_id, const Layout** layout) {
+  if (Table* table = FindTable(table_id, layout); table != nullptr) {
+    return table;
+  }
+  absl::MutexLock lock(&mu_);
+  *layout = FindLayout(table_id);
+  const TableID& root_table_id =
+      *layout != nullptr ? (*layout)->root_table_id : table_id;
+  std::unique_ptr<Table>& table = tables_[root_table_id];
+  if (table == nullptr) {
+    table = std::make_unique<Table>();
+    tables_index_.Insert(root_table_id, table.get());
+  }
+  return table.get();
+}
+
+InMemoryStorage::Rows& InMemoryStorage::MutableRows(Table* table) {
+  table->mu.AssertHeld();
+  if (table->rows.use_count() > 1) {
+    table->rows = std::make_shared<Rows>(*table->rows);
+  }
+  return *table->rows;
+}
+
+absl::StatusOr<std::unique_ptr<Storage>> InMemoryStorage::Clone() const {
+  auto clone = std::make_unique<InMemoryStorage>(
+      interner_, memory_quota_bytes_,
+      key_access_heatmap_ != nullptr ? key_access_heatmap_->sampling_interval()
+                                     : 0);
+  absl::ReaderMutexLock lock(&mu_);
+  for (const auto& [table_id, table] : tables_) {
+    absl::ReaderMutexLock table_lock(&table->mu);
+    auto cloned_table = std::make_unique<Table>();
+    cloned_table->rows = table->rows;
+    for (const auto& [stats_table_id, stats] : table->stats) {
+      TableStats& cloned_stats = cloned_table->stats[stats_table_id];
+      cloned_stats.blocks = stats.blocks;
+      cloned_stats.row_count = stats.row_count;
+      cloned_stats.row_counts = stats.row_counts;
+      cloned_stats.row_counts_start = stats.row_counts_start;
+      cloned_stats.last_write_timestamp = stats.last_write_timestamp;
+    }
+    cloned_table->key_filter = table->key_filter;
+    cloned_table->memory = table->memory;
+    clone->memory_bytes_.fetch_add(table->memory.total_bytes(),
+                                   std::memory_order_relaxed);
+    clone->tables_index_.Insert(table_id, cloned_table.get());
+    clone->tables_.emplace(table_id, std::move(cloned_table));
+  }
+  for (const auto& [table_id, layout] : layouts_) {
+    auto cloned_layout = std::make_unique<const Layout>(*layout);
+    clone->layouts_index_.Insert(table_id, cloned_layout.get());
+    clone->layouts_.emplace(table_id, std::move(cloned_layout));
+  }
+  clone->next_tag_ = next_tag_;
+  return clone;
+}
+
 zetasql::Value InMemoryStorage::GetCellValueAtTimestamp(
-    const Row& row, const ColumnID& column_id, absl::Time timestamp) const {
+    const Row& row, const ColumnID& column_id, absl::Time timestamp,
+    absl::Time insert_timestamp) {
+  zetasql::Value cold_value;
+  const zetasql::Value* value = FindCellValueAtTimestamp(
+      row, column_id, timestamp, insert_timestamp, &cold_value);
+  return value != nullptr ? *value : zetasql::Value();
+}
+
+const zetasql::Value* InMemoryStorage::FindCellValueAtTimestamp(
+    const Row& row, const ColumnID& column_id, absl::Time timestamp,
+    absl::Time insert_timestamp, zetasql::Value* cold_value) {
   // Perform the lookup for given cell.
   auto cell_itr = row.find(column_id);
   if (cell_itr == row.end()) {
-    return zetasql::Value();
+    return nullptr;
   }
   const Cell& cell = cell_itr->second;
-  auto val_itr = cell.upper_bound(timestamp);
+  auto val_itr = cell.versions.upper_bound(timestamp);
 
-  // Timestamp is earlier than the time the cell was first written to.
-  if (val_itr == cell.begin()) {
-    return zetasql::Value();
+  // Timestamp is earlier than the uncompressed versions of the cell, and than
+  // the time the cell was first written to unless it has compressed ones.
+  if (val_itr == cell.versions.begin()) {
+    if (cell.cold == nullptr) {
+      return nullptr;
+    }
+    std::optional<ColdVersions::Version> version = cell.cold->Find(timestamp);
+    if (!version.has_value() || version->first < insert_timestamp) {
+      return nullptr;
+    }
+    *cold_value = std::move(version->second);
+    return cold_value;
   }
 
-  // Fetch the value from the column.
+  // The latest version was written before the row was last deleted.
   --val_itr;
-  return val_itr->second;
+  if (val_itr->first < insert_timestamp) {
+    return nullptr;
+  }
+
+  // Fetch the value from the column.
+  return &val_itr->second;
 }
 
-bool InMemoryStorage::Exists(const Row& row, absl::Time timestamp) const {
-  zetasql::Value value =
-      GetCellValueAtTimestamp(row, kExistsColumn, timestamp);
+bool InMemoryStorage::Exists(const Row& row, absl::Time timestamp) {
+  zetasql::Value value = GetCellValueAtTimestamp(
+      row, kExistsColumn, timestamp, absl::InfinitePast());
   return value.is_valid() && value.bool_value();
 }
 
+absl::Time InMemoryStorage::InsertTimestamp(const Row& row,
+                                            absl::Time timestamp) {
+  auto cell_itr = row.find(kExistsColumn);
+  if (cell_itr == row.end()) {
+    return absl::InfinitePast();
+  }
+  const Versions& exists = cell_itr->second.versions;
+  auto version_itr = exists.upper_bound(timestamp);
+  if (version_itr == exists.begin()) {
+    return absl::InfinitePast();
+  }
+  return std::prev(version_itr)->first;
+}
+
 absl::Status InMemoryStorage::Lookup(
     absl::Time timestamp, const TableID& table_id, const Key& key,
     const std::vector<ColumnID>& column_ids,
     std::vector<zetasql::Value>* values) const {
-  absl::MutexLock lock(&mu_);
-
   // Validate the request.
   if (!column_ids.empty() && values == nullptr) {
     return error::Internal(
@@ -78,21 +254,41 @@ absl::Status InMemoryStorage::Lookup(
   }
   if (values != nullptr) {
     values->clear();
+    values->resize(column_ids.size());
   }
+  absl::Status status =
+      VisitLookup(timestamp, table_id, key, column_ids,
+                  [values](int column_index, const zetasql::Value& value) {
+                    (*values)[column_index] = value;
+                  });
+  if (!status.ok() && values != nullptr) {
+    values->clear();
+  }
+  return status;
+}
+
+absl::Status InMemoryStorage::VisitLookup(
+    absl::Time timestamp, const TableID& table_id, const Key& key,
+    const std::vector<ColumnID>& column_ids,
+    ColumnValueVisitor visitor) const {
+  static const zetasql::Value* const kUnsetValue = new zetasql::Value();
+  RecordKeyAccess(table_id, key, KeyAccessHeatmap::AccessType::kRead);
 
   // Lookup for given table.
-  auto table_itr = tables_.find(table_id);
-  if (table_itr == tables_.end()) {
+  const Layout* layout;
+  const Table* table = FindTable(table_id, &layout);
+  if (table == nullptr) {
     return absl::Status(
         absl::StatusCode::kNotFound,
         absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
                      table_id, " at timestamp: ", absl::FormatTime(timestamp)));
   }
-  const Table& table = table_itr->second;
+  absl::ReaderMutexLock lock(&table->mu);
 
   // Lookup for given key.
-  auto row_itr = table.find(key);
-  if (row_itr == table.end()) {
+  auto row_itr = table->rows->find(
+      EncodeKey(layout != nullptr ? ToStorageKey(*layout, key) : key));
+  if (row_itr == table->rows->end()) {
     return absl::Status(
         absl::StatusCode::kNotFound,
         absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
@@ -114,21 +310,108 @@ absl::Status InMemoryStorage::Lookup(
     return absl::OkStatus();
   }
 
-  // Fetch the value from the cell at the given timestamp.
+  // Pass the value from the cell at the given timestamp.
+  const absl::Time insert_timestamp = InsertTimestamp(row, timestamp);
+  zetasql::Value cold_value;
   for (int i = 0; i < column_ids.size(); ++i) {
-    values->emplace_back(
-        GetCellValueAtTimestamp(row, column_ids[i], timestamp));
+    const zetasql::Value* value = FindCellValueAtTimestamp(
+        row, column_ids[i], timestamp, insert_timestamp, &cold_value);
+    visitor(i, value != nullptr ? *value : *kUnsetValue);
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status InMemoryStorage::MultiLookup(
+    absl::Time timestamp, const TableID& table_id,
+    absl::Span<const Key> sorted_keys, const std::vector<ColumnID>& column_ids,
+    std::vector<std::pair<Key, std::vector<zetasql::Value>>>* rows) const {
+  if (key_access_heatmap_ != nullptr) {
+    for (const Key& key : sorted_keys) {
+      RecordKeyAccess(table_id, key, KeyAccessHeatmap::AccessType::kRead);
+    }
   }
+  const Layout* layout;
+  const Table* table = FindTable(table_id, &layout);
+  if (table == nullptr || sorted_keys.empty()) {
+    return absl::OkStatus();
+  }
+  absl::ReaderMutexLock lock(&table->mu);
 
+  // Storage keys are in the same order as the keys of a table, so each probe
+  // starts from the row found by the previous one. Neighbouring keys are found
+  // by stepping over a few rows rather than searching the whole table again.
+  constexpr int kMaxSteps = 8;
+  auto row_itr = table->rows->begin();
+  for (const Key& key : sorted_keys) {
+    const std::string encoded_key =
+        EncodeKey(layout != nullptr ? ToStorageKey(*layout, key) : key);
+    int steps = 0;
+    while (row_itr != table->rows->end() && row_itr->first < encoded_key &&
+           steps < kMaxSteps) {
+      ++row_itr;
+      ++steps;
+    }
+    if (steps == kMaxSteps) {
+      row_itr = table->rows->lower_bound(encoded_key);
+    }
+    if (row_itr == table->rows->end()) {
+      break;
+    }
+    if (row_itr->first != encoded_key || !Exists(row_itr->second, timestamp)) {
+      continue;
+    }
+    const Row& row = row_itr->second;
+    const absl::Time insert_timestamp = InsertTimestamp(row, timestamp);
+    std::vector<zetasql::Value> values;
+    values.reserve(column_ids.size());
+    for (const ColumnID& column_id : column_ids) {
+      values.emplace_back(GetCellValueAtTimestamp(row, column_id, timestamp,
+                                                  insert_timestamp));
+    }
+    rows->emplace_back(key, std::move(values));
+  }
   return absl::OkStatus();
 }
 
+absl::StatusOr<bool> InMemoryStorage::Exists(absl::Time timestamp,
+                                             const TableID& table_id,
+                                             const Key& key) const {
+  const Layout* layout;
+  const Table* table = FindTable(table_id, &layout);
+  if (table == nullptr) {
+    return false;
+  }
+  const std::string encoded_key =
+      EncodeKey(layout != nullptr ? ToStorageKey(*layout, key) : key);
+  absl::ReaderMutexLock lock(&table->mu);
+  if (!table->key_filter.MayContain(encoded_key)) {
+    return false;
+  }
+  auto row_itr = table->rows->find(encoded_key);
+  return row_itr != table->rows->end() && Exists(row_itr->second, timestamp);
+}
+
 absl::Status InMemoryStorage::Read(
     absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
     const std::vector<ColumnID>& column_ids,
     std::unique_ptr<StorageIterator>* itr) const {
-  absl::MutexLock lock(&mu_);
+  return ReadRange(timestamp, table_id, key_range, column_ids,
+                   /*reverse=*/false, itr);
+}
+
+absl::Status InMemoryStorage::ReadReverse(
+    absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
+    const std::vector<ColumnID>& column_ids,
+    std::unique_ptr<StorageIterator>* itr) const {
+  return ReadRange(timestamp, table_id, key_range, column_ids,
+                   /*reverse=*/true, itr);
+}
 
+absl::Status InMemoryStorage::ReadRange(
+    absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
+    const std::vector<ColumnID>& column_ids, bool reverse,
+    std::unique_ptr<StorageIterator>* itr) const {
   // Validate the request.
   if (!key_range.IsClosedOpen()) {
     return error::Internal(
@@ -137,69 +420,178 @@ absl::Status InMemoryStorage::Read(
                      key_range.DebugString()));
   }
 
-  std::vector<FixedRowStorageIterator::Row> rows;
   // Return an empty iterator for empty key_range.
   if (key_range.start_key() >= key_range.limit_key()) {
     *itr = std::make_unique<FixedRowStorageIterator>();
     return absl::OkStatus();
   }
+  RecordKeyAccess(table_id, key_range.start_key(),
+                  KeyAccessHeatmap::AccessType::kRead);
 
   // Lookup for given table.
-  auto table_itr = tables_.find(table_id);
-  if (table_itr == tables_.end()) {
+  const Layout* layout;
+  const Table* table = FindTable(table_id, &layout);
+  if (table == nullptr) {
     *itr = std::make_unique<FixedRowStorageIterator>();
     return absl::OkStatus();
   }
-  const Table& table = table_itr->second;
+  *itr = std::make_unique<RangeIterator>(
+      table, layout, timestamp,
+      layout != nullptr ? ToStorageKeyRange(*layout, key_range) : key_range,
+      column_ids, reverse);
+  return absl::OkStatus();
+}
+
+void InMemoryStorage::WriteRow(absl::Time timestamp, const Key& key,
+                               const std::vector<ColumnID>& column_ids,
+                               std::vector<zetasql::Value> values,
+                               const Layout* layout, Rows& rows,
+                               TableStats& stats, KeyFilter& key_filter,
+                               StorageMemoryUsage& memory) {
+  // Add the row with _exists system column if it does not exist.
+  std::string encoded_key = EncodeKey(key);
+  auto [row_itr, inserted] = rows.try_emplace(encoded_key);
+  if (inserted) {
+    memory.key_bytes += encoded_key.size();
+    key_filter.Add(encoded_key);
+    if (key_filter.full()) {
+      RebuildKeyFilter(rows, key_filter);
+    }
+  }
+  Row& row = row_itr->second;
+  const bool existed = Exists(row, absl::InfiniteFuture());
+  const int64_t old_size = existed ? LatestRowSize(key, row) : 0;
+  if (!Exists(row, timestamp)) {
+    SetVersion(timestamp, zetasql::values::Bool(true), row[kExistsColumn],
+               memory);
+  }
+
+  // Add the values for the given columns.
+  for (int i = 0; i < column_ids.size(); ++i) {
+    SetVersion(timestamp, std::move(values[i]), row[column_ids[i]], memory);
+  }
+
+  StorageRangeStats delta;
+  delta.row_count = existed ? 0 : 1;
+  delta.size_bytes = LatestRowSize(key, row) - old_size;
+  UpdateStats(encoded_key, delta, layout, rows, stats);
+  RecordRowCount(timestamp, delta.row_count, stats);
+}
+
+void InMemoryStorage::SetVersion(absl::Time timestamp, zetasql::Value value,
+                                 Cell& cell, StorageMemoryUsage& memory) {
+  if (cell.cold != nullptr && timestamp <= cell.cold->latest_timestamp()) {
+    ExpandColdVersions(cell, memory);
+  }
+  auto [itr, inserted] = cell.versions.try_emplace(timestamp);
+  if (inserted) {
+    ++memory.num_versions;
+  } else {
+    memory.cell_bytes -= VersionSize(itr->second);
+  }
+  memory.cell_bytes += VersionSize(value);
+  itr->second = std::move(value);
+}
+
+void InMemoryStorage::RebuildKeyFilter(const Rows& rows,
+                                       KeyFilter& key_filter) {
+  KeyFilter rebuilt(2 * static_cast<int64_t>(rows.size()));
+  for (const auto& [encoded_key, row] : rows) {
+    rebuilt.Add(encoded_key);
+  }
+  key_filter = std::move(rebuilt);
+}
+
+void InMemoryStorage::DeleteRows(absl::Time timestamp,
+                                 const KeyRange& key_range,
+                                 const Layout* layout, Rows& rows,
+                                 TableStats& stats,
+                                 StorageMemoryUsage& memory) {
+  if (key_range.start_key() >= key_range.limit_key()) {
+    return;
+  }
 
   // Lookup keys from the given key range.
-  auto row_start_itr = table.lower_bound(key_range.start_key());
-  auto row_end_itr = table.lower_bound(key_range.limit_key());
+  auto row_start_itr = rows.lower_bound(EncodeKey(key_range.start_key()));
+  if (row_start_itr == rows.end()) {
+    return;
+  }
+  auto row_end_itr = rows.lower_bound(EncodeKey(key_range.limit_key()));
+
+  // Mark the keys as deleted.
   for (auto itr = row_start_itr; itr != row_end_itr; ++itr) {
-    const InMemoryStorage::Row& row = itr->second;
-    if (!Exists(row, timestamp)) {
+    const Key storage_key = DecodeKey(itr->first);
+    if (layout != nullptr && !IsTableRow(*layout, storage_key)) {
       continue;
     }
+    if (!Exists(itr->second, timestamp)) {
+      continue;
+    }
+    const bool existed = Exists(itr->second, absl::InfiniteFuture());
+    if (existed) {
+      StorageRangeStats delta;
+      delta.row_count = -1;
+      delta.size_bytes = -LatestRowSize(storage_key, itr->second);
+      UpdateStats(itr->first, delta, layout, rows, stats);
+    }
+    RecordRowCount(timestamp, existed ? -1 : 0, stats);
 
-    std::vector<zetasql::Value> values;
-    values.reserve(column_ids.size());
-    for (const ColumnID& column_id : column_ids) {
-      values.emplace_back(GetCellValueAtTimestamp(row, column_id, timestamp));
+    // Versions of the other columns written before the delete are hidden by
+    // it (see GetCellValueAtTimestamp), so only the existence of the row gets
+    // a new version. Versions written at the same timestamp are replaced by
+    // the delete, as a later insert at that timestamp would not hide them.
+    Row& row = itr->second;
+    SetVersion(timestamp, zetasql::values::Bool(false), row[kExistsColumn],
+               memory);
+    for (auto& [column_id, cell] : row) {
+      if (column_id != kExistsColumn && !cell.versions.empty() &&
+          cell.versions.rbegin()->first == timestamp) {
+        // The latest version must stay uncompressed.
+        if (cell.versions.size() == 1) {
+          ExpandColdVersions(cell, memory);
+        }
+        EraseVersions(std::prev(cell.versions.end()), cell.versions.end(),
+                      cell, memory);
+      }
     }
-    rows.emplace_back(std::make_pair(itr->first, values));
   }
-  *itr = std::make_unique<FixedRowStorageIterator>(std::move(rows));
-  return absl::OkStatus();
 }
 
 absl::Status InMemoryStorage::Write(
     absl::Time timestamp, const TableID& table_id, const Key& key,
     const std::vector<ColumnID>& column_ids,
     const std::vector<zetasql::Value>& values) {
-  absl::MutexLock lock(&mu_);
-
-  // Add the table if it does not exist.
-  Table& table = tables_[table_id];
-
-  // Add the row with _exists system column if it does not exist.
-  Row& row = table[key];
-  if (!Exists(row, timestamp)) {
-    row[kExistsColumn][timestamp] = zetasql::values::Bool(true);
-  }
+  return Write(timestamp, table_id, key, column_ids,
+               std::vector<zetasql::Value>(values));
+}
 
-  // Add the values for the given columns.
-  for (int i = 0; i < column_ids.size(); ++i) {
-    row[column_ids[i]][timestamp] = values[i];
+absl::Status InMemoryStorage::Write(absl::Time timestamp,
+                                    const TableID& table_id, const Key& key,
+                                    const std::vector<ColumnID>& column_ids,
+                                    std::vector<zetasql::Value>&& values) {
+  // Values are interned before taking the table lock.
+  std::vector<zetasql::Value> row_values = std::move(values);
+  if (interner_ != nullptr) {
+    interner_->InternAll(absl::MakeSpan(row_values));
   }
+  RecordKeyAccess(table_id, key, KeyAccessHeatmap::AccessType::kWrite);
 
+  // Add the table if it does not exist.
+  const Layout* layout;
+  Table* table = FindOrCreateTable(table_id, &layout);
+  absl::MutexLock lock(&table->mu);
+  const int64_t old_memory_bytes = table->memory.total_bytes();
+  WriteRow(timestamp, layout != nullptr ? ToStorageKey(*layout, key) : key,
+           column_ids, std::move(row_values), layout, MutableRows(table),
+           table->stats[table_id], table->key_filter, table->memory);
+  memory_bytes_.fetch_add(table->memory.total_bytes() - old_memory_bytes,
+                          std::memory_order_relaxed);
   return absl::OkStatus();
 }
 
 absl::Status InMemoryStorage::Delete(absl::Time timestamp,
                                      const TableID& table_id,
                                      const KeyRange& key_range) {
-  absl::MutexLock lock(&mu_);
-
   if (!key_range.IsClosedOpen()) {
     return error::Internal(
         absl::StrCat("InMemoryStorage::Delete should be called "
@@ -209,40 +601,708 @@ absl::Status InMemoryStorage::Delete(absl::Time timestamp,
   if (key_range.start_key() >= key_range.limit_key()) {
     return absl::OkStatus();
   }
+  RecordKeyAccess(table_id, key_range.start_key(),
+                  KeyAccessHeatmap::AccessType::kWrite);
 
-  // Lookup for given table.
-  auto table_itr = tables_.find(table_id);
-  if (table_itr == tables_.end()) {
+  // Lookup for given table. Deletes never create a table, so the shard is
+  // looked up without taking the exclusive tables lock.
+  const Layout* layout;
+  Table* table = FindTable(table_id, &layout);
+  if (table == nullptr) {
     return absl::OkStatus();
   }
-  Table& table = table_itr->second;
+  absl::MutexLock lock(&table->mu);
+  const int64_t old_memory_bytes = table->memory.total_bytes();
+  DeleteRows(timestamp,
+             layout != nullptr ? ToStorageKeyRange(*layout, key_range)
+                               : key_range,
+             layout, MutableRows(table), table->stats[table_id],
+             table->memory);
+  memory_bytes_.fetch_add(table->memory.total_bytes() - old_memory_bytes,
+                          std::memory_order_relaxed);
+  return absl::OkStatus();
+}
+
+absl::Status InMemoryStorage::ApplyBatch(absl::Time timestamp,
+                                         absl::Span<StorageWriteOp> ops) {
+  // Group the ops by table, keeping their relative order within each table.
+  // Ops on different tables are independent, so they can be applied in any
+  // order relative to each other.
+  absl::flat_hash_map<TableID, std::vector<StorageWriteOp*>> ops_by_table;
+  for (StorageWriteOp& op : ops) {
+    ops_by_table[op.table_id].push_back(&op);
+    if (interner_ != nullptr) {
+      interner_->InternAll(absl::MakeSpan(op.values));
+    }
+    RecordKeyAccess(op.table_id, op.key, KeyAccessHeatmap::AccessType::kWrite);
+  }
 
-  // Lookup keys from the given key range.
-  auto row_start_itr = table.lower_bound(key_range.start_key());
-  if (row_start_itr == table.end()) {
-    return absl::OkStatus();
+  for (auto& [table_id, table_ops] : ops_by_table) {
+    const Layout* layout;
+    Table* table = FindOrCreateTable(table_id, &layout);
+    absl::MutexLock lock(&table->mu);
+    Rows& rows = MutableRows(table);
+    TableStats& stats = table->stats[table_id];
+    const int64_t old_memory_bytes = table->memory.total_bytes();
+    for (StorageWriteOp* op : table_ops) {
+      if (layout != nullptr) {
+        op->key = ToStorageKey(*layout, op->key);
+      }
+      if (op->is_delete) {
+        DeleteRows(timestamp, KeyRange::Point(op->key), layout, rows, stats,
+                   table->memory);
+      } else {
+        WriteRow(timestamp, op->key, op->column_ids, std::move(op->values),
+                 layout, rows, stats, table->key_filter, table->memory);
+      }
+    }
+    memory_bytes_.fetch_add(table->memory.total_bytes() - old_memory_bytes,
+                            std::memory_order_relaxed);
   }
-  auto row_end_itr = table.lower_bound(key_range.limit_key());
+  return absl::OkStatus();
+}
 
-  // Mark the keys as deleted.
-  for (auto itr = row_start_itr; itr != row_end_itr; ++itr) {
-    if (!Exists(itr->second, timestamp)) {
+void InMemoryStorage::RegisterInterleavedTable(const TableID& parent_table_id,
+                                               int parent_key_size,
+                                               const TableID& child_table_id,
+                                               int child_key_size) {
+  absl::MutexLock lock(&mu_);
+  // Rows which have already been written to a separate shard stay there.
+  if (layouts_.contains(child_table_id) || tables_.contains(child_table_id)) {
+    return;
+  }
+
+  // A parent which is not interleaved itself is the root of the hierarchy.
+  // Keys of its rows are stored as they are, so it may already have rows.
+  std::unique_ptr<const Layout>& parent = layouts_[parent_table_id];
+  if (parent == nullptr) {
+    auto root = std::make_unique<Layout>();
+    root->root_table_id = parent_table_id;
+    root->num_key_columns = parent_key_size;
+    parent = std::move(root);
+    layouts_index_.Insert(parent_table_id, parent.get());
+  }
+
+  auto child = std::make_unique<Layout>(*parent);
+  child->num_key_columns = child_key_size;
+  child->tags.emplace_back(parent->num_key_columns, next_tag_++);
+  layouts_index_.Insert(child_table_id, child.get());
+  layouts_.emplace(child_table_id, std::move(child));
+}
+
+Key InMemoryStorage::ToStorageKey(const Layout& layout, const Key& key) {
+  if (layout.tags.empty() || key.IsInfinity()) {
+    return key;
+  }
+
+  // Tags are only added for the ancestors whose key columns are all present,
+  // so that a prefix of a key maps to a prefix of the storage key.
+  Key storage_key;
+  auto tag_itr = layout.tags.begin();
+  for (int i = 0; i <= key.NumColumns(); ++i) {
+    for (; tag_itr != layout.tags.end() && tag_itr->first == i; ++tag_itr) {
+      storage_key.AddColumn(zetasql::values::Int64(tag_itr->second));
+    }
+    if (i < key.NumColumns()) {
+      storage_key.AddColumn(key.ColumnValue(i), key.IsColumnDescending(i));
+    }
+  }
+  return key.IsPrefixLimit() ? storage_key.ToPrefixLimit() : storage_key;
+}
+
+KeyRange InMemoryStorage::ToStorageKeyRange(const Layout& layout,
+                                            const KeyRange& key_range) {
+  return KeyRange::ClosedOpen(ToStorageKey(layout, key_range.start_key()),
+                              ToStorageKey(layout, key_range.limit_key()));
+}
+
+Key InMemoryStorage::FromStorageKey(const Layout& layout,
+                                    const Key& storage_key) {
+  if (layout.tags.empty()) {
+    return storage_key;
+  }
+  Key key;
+  auto tag_itr = layout.tags.begin();
+  for (int i = 0; i < storage_key.NumColumns(); ++i) {
+    if (tag_itr != layout.tags.end() && tag_itr->first == key.NumColumns()) {
+      ++tag_itr;
       continue;
     }
+    key.AddColumn(storage_key.ColumnValue(i),
+                  storage_key.IsColumnDescending(i));
+  }
+  return key;
+}
 
-    for (const auto& columns : itr->second) {
-      if (columns.first == kExistsColumn) {
-        itr->second[kExistsColumn][timestamp] = zetasql::values::Bool(false);
-      } else {
-        // Column values are marked invalid zetasql::Value to avoid reading
-        // the value of the cell before the delete.
-        itr->second[columns.first][timestamp] = zetasql::Value();
+bool InMemoryStorage::IsTableRow(const Layout& layout,
+                                 const Key& storage_key) {
+  if (storage_key.NumColumns() !=
+      layout.num_key_columns + static_cast<int>(layout.tags.size())) {
+    return false;
+  }
+  // Rows of other tables in the hierarchy either have a different number of
+  // columns or differ from the table in the first tag which does not match.
+  // Checking tags outermost first guarantees that each checked position
+  // holds a tag.
+  for (int i = 0; i < layout.tags.size(); ++i) {
+    const zetasql::Value& tag =
+        storage_key.ColumnValue(layout.tags[i].first + i);
+    if (tag.int64_value() != layout.tags[i].second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::optional<Key> InMemoryStorage::LatestTableRowKey(
+    const Layout* layout, const std::string& encoded_key, const Row& row) {
+  if (!Exists(row, absl::InfiniteFuture())) {
+    return std::nullopt;
+  }
+  Key storage_key = DecodeKey(encoded_key);
+  if (layout != nullptr && !IsTableRow(*layout, storage_key)) {
+    return std::nullopt;
+  }
+  return storage_key;
+}
+
+int64_t InMemoryStorage::LatestRowSize(const Key& storage_key,
+                                       const Row& row) {
+  // The tags in the storage key of a clustered row are counted as part of its
+  // key, which is close enough for estimates.
+  int64_t size = storage_key.LogicalSizeInBytes();
+  const absl::Time insert_timestamp =
+      InsertTimestamp(row, absl::InfiniteFuture());
+  for (const auto& [column_id, cell] : row) {
+    if (column_id == kExistsColumn || cell.versions.empty() ||
+        cell.versions.rbegin()->first < insert_timestamp) {
+      continue;
+    }
+    const zetasql::Value& value = cell.versions.rbegin()->second;
+    if (value.is_valid()) {
+      size += value.physical_byte_size();
+    }
+  }
+  return size;
+}
+
+void InMemoryStorage::RecordRowCount(absl::Time timestamp,
+                                    int64_t row_count_delta,
+                                    TableStats& stats) {
+  stats.row_count += row_count_delta;
+  if (timestamp < stats.last_write_timestamp) {
+    stats.row_counts = {{stats.last_write_timestamp, stats.row_count}};
+    stats.row_counts_start = stats.last_write_timestamp;
+    return;
+  }
+  stats.last_write_timestamp = timestamp;
+  if (row_count_delta != 0) {
+    stats.row_counts[timestamp] = stats.row_count;
+  }
+}
+
+void InMemoryStorage::UpdateStats(const std::string& encoded_key,
+                                  const StorageRangeStats& delta,
+                                  const Layout* layout, const Rows& rows,
+                                  TableStats& stats) {
+  if (delta.row_count == 0 && delta.size_bytes == 0) {
+    return;
+  }
+  stats.prefix_sums.clear();
+  auto block_itr = std::prev(stats.blocks.upper_bound(encoded_key));
+  StorageRangeStats& block = block_itr->second;
+  block.row_count += delta.row_count;
+  block.size_bytes += delta.size_bytes;
+  if (block.row_count > 2 * kStatsBlockRows) {
+    SplitStatsBlock(block_itr, layout, rows, stats);
+  } else if (delta.row_count < 0 && block.row_count < kStatsBlockRows / 4 &&
+             block_itr != stats.blocks.begin()) {
+    StorageRangeStats& previous = std::prev(block_itr)->second;
+    previous.row_count += block.row_count;
+    previous.size_bytes += block.size_bytes;
+    stats.blocks.erase(block_itr);
+  }
+}
+
+void InMemoryStorage::SplitStatsBlock(StatsBlocks::iterator block_itr,
+                                      const Layout* layout, const Rows& rows,
+                                      TableStats& stats) {
+  auto next_itr = std::next(block_itr);
+  auto rows_end = next_itr == stats.blocks.end()
+                      ? rows.end()
+                      : rows.lower_bound(next_itr->first);
+  std::vector<std::pair<const std::string*, int64_t>> block_rows;
+  for (auto itr = rows.lower_bound(block_itr->first); itr != rows_end; ++itr) {
+    if (std::optional<Key> storage_key =
+            LatestTableRowKey(layout, itr->first, itr->second)) {
+      block_rows.emplace_back(&itr->first,
+                              LatestRowSize(*storage_key, itr->second));
+    }
+  }
+  if (block_rows.size() < 2) {
+    return;
+  }
+
+  const size_t middle = block_rows.size() / 2;
+  StorageRangeStats lower, upper;
+  for (size_t i = 0; i < block_rows.size(); ++i) {
+    StorageRangeStats& half = i < middle ? lower : upper;
+    ++half.row_count;
+    half.size_bytes += block_rows[i].second;
+  }
+  block_itr->second = lower;
+  stats.blocks.emplace_hint(next_itr, *block_rows[middle].first, upper);
+}
+
+const std::vector<InMemoryStorage::StatsPrefixSum>&
+InMemoryStorage::PrefixSums(TableStats& stats) {
+  if (stats.prefix_sums.empty()) {
+    stats.prefix_sums.reserve(stats.blocks.size());
+    StorageRangeStats before;
+    for (auto itr = stats.blocks.begin(); itr != stats.blocks.end(); ++itr) {
+      stats.prefix_sums.push_back({itr, before});
+      before.row_count += itr->second.row_count;
+      before.size_bytes += itr->second.size_bytes;
+    }
+  }
+  return stats.prefix_sums;
+}
+
+StorageRangeStats InMemoryStorage::CountRowsBefore(
+    const std::string& encoded_key, const Layout* layout, const Rows& rows,
+    TableStats& stats) {
+  // Find the block containing encoded_key, then count the rows of the block
+  // which precede it.
+  const std::vector<StatsPrefixSum>& prefix_sums = PrefixSums(stats);
+  auto sum_itr = std::prev(std::upper_bound(
+      prefix_sums.begin(), prefix_sums.end(), encoded_key,
+      [](const std::string& key, const StatsPrefixSum& sum) {
+        return key < sum.block->first;
+      }));
+  StorageRangeStats count = sum_itr->before;
+  for (auto itr = rows.lower_bound(sum_itr->block->first);
+       itr != rows.end() && itr->first < encoded_key; ++itr) {
+    if (std::optional<Key> storage_key =
+            LatestTableRowKey(layout, itr->first, itr->second)) {
+      ++count.row_count;
+      count.size_bytes += LatestRowSize(*storage_key, itr->second);
+    }
+  }
+  return count;
+}
+
+absl::StatusOr<StorageRangeStats> InMemoryStorage::EstimateRange(
+    const TableID& table_id, const KeyRange& key_range) const {
+  if (!key_range.IsClosedOpen()) {
+    return error::Internal(
+        absl::StrCat("InMemoryStorage::EstimateRange should be called "
+                     "with ClosedOpen key range, found: ",
+                     key_range.DebugString()));
+  }
+  if (key_range.start_key() >= key_range.limit_key()) {
+    return StorageRangeStats();
+  }
+
+  const Layout* layout;
+  Table* table = FindTable(table_id, &layout);
+  if (table == nullptr) {
+    return StorageRangeStats();
+  }
+  // Computing the prefix sums modifies the statistics, so even estimates
+  // take the table lock exclusively. They are far rarer than reads.
+  absl::MutexLock lock(&table->mu);
+  auto stats_itr = table->stats.find(table_id);
+  if (stats_itr == table->stats.end()) {
+    return StorageRangeStats();
+  }
+  const KeyRange storage_key_range =
+      layout != nullptr ? ToStorageKeyRange(*layout, key_range) : key_range;
+  const StorageRangeStats start =
+      CountRowsBefore(EncodeKey(storage_key_range.start_key()), layout,
+                      *table->rows, stats_itr->second);
+  const StorageRangeStats limit =
+      CountRowsBefore(EncodeKey(storage_key_range.limit_key()), layout,
+                      *table->rows, stats_itr->second);
+  StorageRangeStats range;
+  range.row_count = limit.row_count - start.row_count;
+  range.size_bytes = limit.size_bytes - start.size_bytes;
+  return range;
+}
+
+absl::StatusOr<Key> InMemoryStorage::EstimateNthKey(const TableID& table_id,
+                                                    int64_t n) const {
+  const Layout* layout;
+  Table* table = FindTable(table_id, &layout);
+  if (table == nullptr) {
+    return Key::Infinity();
+  }
+  absl::MutexLock lock(&table->mu);
+  auto stats_itr = table->stats.find(table_id);
+  if (stats_itr == table->stats.end()) {
+    return Key::Infinity();
+  }
+
+  // Find the last block which starts at or before the nth row. Empty blocks
+  // share their prefix sum with the next block, so the nth row is in this
+  // block unless the table has at most n rows.
+  n = std::max<int64_t>(n, 0);
+  const std::vector<StatsPrefixSum>& prefix_sums =
+      PrefixSums(stats_itr->second);
+  auto sum_itr = std::prev(std::upper_bound(
+      prefix_sums.begin(), prefix_sums.end(), n,
+      [](int64_t n, const StatsPrefixSum& sum) {
+        return n < sum.before.row_count;
+      }));
+  int64_t remaining = n - sum_itr->before.row_count;
+  if (remaining >= sum_itr->block->second.row_count) {
+    return Key::Infinity();
+  }
+  const Rows& rows = *table->rows;
+  for (auto itr = rows.lower_bound(sum_itr->block->first); itr != rows.end();
+       ++itr) {
+    if (std::optional<Key> storage_key =
+            LatestTableRowKey(layout, itr->first, itr->second)) {
+      if (remaining-- == 0) {
+        return layout != nullptr ? FromStorageKey(*layout, *storage_key)
+                                 : *storage_key;
       }
     }
   }
+  return Key::Infinity();
+}
+
+absl::StatusOr<int64_t> InMemoryStorage::RowCount(const TableID& table_id,
+                                                  absl::Time timestamp) const {
+  const Layout* layout;
+  Table* table = FindTable(table_id, &layout);
+  if (table == nullptr) {
+    return 0;
+  }
+  absl::ReaderMutexLock lock(&table->mu);
+  auto stats_itr = table->stats.find(table_id);
+  if (stats_itr == table->stats.end()) {
+    return 0;
+  }
+  const TableStats& stats = stats_itr->second;
+  if (timestamp >= stats.last_write_timestamp) {
+    return stats.row_count;
+  }
+  if (timestamp < stats.row_counts_start) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Row count of table ", table_id, " is not known at ",
+                     absl::FormatTime(timestamp)));
+  }
+  auto count_itr = stats.row_counts.upper_bound(timestamp);
+  return count_itr == stats.row_counts.begin() ? 0
+                                               : std::prev(count_itr)->second;
+}
+
+void InMemoryStorage::RecordKeyAccess(const TableID& table_id, const Key& key,
+                                      KeyAccessHeatmap::AccessType type) const {
+  if (key_access_heatmap_ == nullptr || !key_access_heatmap_->ShouldSample()) {
+    return;
+  }
+  absl::StatusOr<StorageRangeStats> preceding =
+      EstimateRange(table_id, KeyRange::ClosedOpen(Key::Empty(), key));
+  absl::StatusOr<StorageRangeStats> all =
+      EstimateRange(table_id, KeyRange::All());
+  double key_fraction = 0;
+  if (preceding.ok() && all.ok() && all->row_count > 0) {
+    key_fraction = static_cast<double>(preceding->row_count) / all->row_count;
+  }
+  key_access_heatmap_->Record(table_id, key_fraction, type);
+}
+
+std::map<TableID, StorageMemoryUsage> InMemoryStorage::GetMemoryUsage()
+    const {
+  std::map<TableID, StorageMemoryUsage> memory_usage;
+  absl::ReaderMutexLock lock(&mu_);
+  for (const auto& [table_id, table] : tables_) {
+    absl::ReaderMutexLock table_lock(&table->mu);
+    memory_usage[table_id] = table->memory;
+  }
+  return memory_usage;
+}
+
+absl::Status InMemoryStorage::CheckMemoryQuota() const {
+  const int64_t used_bytes = memory_bytes();
+  if (memory_quota_bytes_ > 0 && used_bytes > memory_quota_bytes_) {
+    return error::DatabaseMemoryQuotaExceeded(used_bytes, memory_quota_bytes_);
+  }
   return absl::OkStatus();
 }
 
+int64_t InMemoryStorage::VersionSize(const zetasql::Value& value) {
+  // Invalid values only occupy the value itself.
+  return sizeof(absl::Time) + (value.is_valid() ? value.physical_byte_size()
+                                                : sizeof(zetasql::Value));
+}
+
+int64_t InMemoryStorage::EraseVersions(Versions::iterator begin,
+                                       Versions::iterator end, Cell& cell,
+                                       StorageMemoryUsage& memory) {
+  int64_t reclaimed_bytes = 0;
+  for (auto itr = begin; itr != end; ++itr) {
+    reclaimed_bytes += VersionSize(itr->second);
+    --memory.num_versions;
+  }
+  memory.cell_bytes -= reclaimed_bytes;
+  cell.versions.erase(begin, end);
+  return reclaimed_bytes;
+}
+
+int64_t InMemoryStorage::EraseColdVersions(int n, Cell& cell,
+                                           StorageMemoryUsage& memory) {
+  if (cell.cold == nullptr || n <= 0) {
+    return 0;
+  }
+  int64_t reclaimed_bytes = cell.cold->size_bytes();
+  memory.num_versions -= std::min(n, cell.cold->num_versions());
+  std::optional<ColdVersions> remaining = cell.cold->DropOldest(n);
+  if (remaining.has_value()) {
+    reclaimed_bytes -= remaining->size_bytes();
+    cell.cold = std::make_shared<const ColdVersions>(*std::move(remaining));
+  } else {
+    cell.cold = nullptr;
+  }
+  memory.cell_bytes -= reclaimed_bytes;
+  return reclaimed_bytes;
+}
+
+void InMemoryStorage::ExpandColdVersions(Cell& cell,
+                                         StorageMemoryUsage& memory) {
+  if (cell.cold == nullptr) {
+    return;
+  }
+  memory.cell_bytes -= cell.cold->size_bytes();
+  for (ColdVersions::Version& version : cell.cold->Decode()) {
+    memory.cell_bytes += VersionSize(version.second);
+    cell.versions.emplace(version.first, std::move(version.second));
+  }
+  cell.cold = nullptr;
+}
+
+int64_t InMemoryStorage::CompressCellVersions(absl::Time cold_horizon,
+                                              Cell& cell,
+                                              StorageMemoryUsage& memory) {
+  // Like garbage collection, the latest version at or before the horizon is
+  // kept as it is, as every read at or after the horizon may see it.
+  auto hot_itr = cell.versions.upper_bound(cold_horizon);
+  if (hot_itr == cell.versions.begin() ||
+      --hot_itr == cell.versions.begin()) {
+    return 0;
+  }
+  std::vector<ColdVersions::Version> versions;
+  int64_t old_bytes = 0;
+  if (cell.cold != nullptr) {
+    versions = cell.cold->Decode();
+    old_bytes += cell.cold->size_bytes();
+  }
+  for (auto itr = cell.versions.begin(); itr != hot_itr; ++itr) {
+    versions.emplace_back(itr->first, itr->second);
+    old_bytes += VersionSize(itr->second);
+  }
+  std::optional<ColdVersions> cold = ColdVersions::Encode(versions);
+  if (!cold.has_value() || cold->size_bytes() >= old_bytes) {
+    return 0;
+  }
+  const int64_t saved_bytes = old_bytes - cold->size_bytes();
+  cell.versions.erase(cell.versions.begin(), hot_itr);
+  cell.cold = std::make_shared<const ColdVersions>(*std::move(cold));
+  memory.cell_bytes -= saved_bytes;
+  return saved_bytes;
+}
+
+int64_t InMemoryStorage::CollectCellGarbage(absl::Time version_horizon,
+                                            Cell& cell,
+                                            StorageMemoryUsage& memory) {
+  // The latest version at or before the horizon is still visible to reads at
+  // the horizon, so only versions before it can be discarded. Compressed
+  // versions are older than every uncompressed one.
+  auto visible_itr = cell.versions.upper_bound(version_horizon);
+  if (visible_itr == cell.versions.begin()) {
+    return cell.cold == nullptr
+               ? 0
+               : EraseColdVersions(
+                     cell.cold->CountAtOrBefore(version_horizon) - 1, cell,
+                     memory);
+  }
+  const int64_t reclaimed_bytes = EraseColdVersions(
+      cell.cold == nullptr ? 0 : cell.cold->num_versions(), cell, memory);
+  return reclaimed_bytes + EraseVersions(cell.versions.begin(),
+                                         std::prev(visible_itr), cell, memory);
+}
+
+absl::Status InMemoryStorage::Truncate(absl::Time timestamp,
+                                       absl::Span<const TableID> table_ids) {
+  const absl::flat_hash_set<TableID> truncated(table_ids.begin(),
+                                               table_ids.end());
+  std::vector<std::pair<TableID, Table*>> shards;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    for (const auto& [table_id, table] : tables_) {
+      if (truncated.contains(table_id)) {
+        shards.emplace_back(table_id, table.get());
+      }
+    }
+  }
+
+  absl::flat_hash_set<TableID> emptied;
+  for (const auto& [shard_id, table] : shards) {
+    absl::MutexLock lock(&table->mu);
+    // Rows of the other tables of a clustered shard must be kept.
+    if (!std::all_of(table->stats.begin(), table->stats.end(),
+                     [&](const auto& entry) {
+                       return truncated.contains(entry.first);
+                     })) {
+      continue;
+    }
+    emptied.insert(shard_id);
+    for (const auto& [stats_table_id, stats] : table->stats) {
+      emptied.insert(stats_table_id);
+    }
+    // Read iterators look up their next batch in the current rows, so they
+    // see the empty rows from then on.
+    MemoryReclaimer::Default()->Reclaim(
+        std::exchange(table->rows, std::make_shared<Rows>()));
+    table->stats.clear();
+    table->key_filter = KeyFilter();
+    memory_bytes_.fetch_sub(table->memory.total_bytes(),
+                            std::memory_order_relaxed);
+    table->memory = StorageMemoryUsage();
+  }
+  for (const TableID& table_id : table_ids) {
+    if (!emptied.contains(table_id)) {
+      absl::Status status = Delete(timestamp, table_id, KeyRange::All());
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+int64_t InMemoryStorage::CollectGarbage(absl::Time version_horizon) {
+  // Tables are never removed, so they can be collected one at a time without
+  // blocking access to the other tables.
+  std::vector<Table*> tables;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    tables.reserve(tables_.size());
+    for (const auto& [table_id, table] : tables_) {
+      tables.push_back(table.get());
+    }
+  }
+
+  int64_t reclaimed_bytes = 0;
+  for (Table* table : tables) {
+    absl::MutexLock lock(&table->mu);
+    // Only the latest row count at or before the horizon is still needed.
+    for (auto& [stats_table_id, stats] : table->stats) {
+      auto count_itr = stats.row_counts.upper_bound(version_horizon);
+      if (count_itr != stats.row_counts.begin()) {
+        --count_itr;
+        stats.row_counts.erase(stats.row_counts.begin(), count_itr);
+        stats.row_counts_start =
+            std::max(stats.row_counts_start, count_itr->first);
+      }
+    }
+
+    // Collecting a table shared with a clone would copy it, which costs more
+    // memory than it reclaims.
+    if (table->rows.use_count() > 1) {
+      continue;
+    }
+    Rows& rows = *table->rows;
+    StorageMemoryUsage& memory = table->memory;
+    const int64_t old_memory_bytes = memory.total_bytes();
+    const size_t num_rows = rows.size();
+    for (auto row_itr = rows.begin(); row_itr != rows.end();) {
+      Row& row = row_itr->second;
+      for (auto& [column_id, cell] : row) {
+        reclaimed_bytes += CollectCellGarbage(version_horizon, cell, memory);
+      }
+
+      // Versions of other columns written before the oldest remaining
+      // version of the existence of the row are hidden from every read at or
+      // after the horizon by a delete.
+      const Versions& exists = row[kExistsColumn].versions;
+      if (!exists.empty()) {
+        const absl::Time oldest_exists = exists.begin()->first;
+        for (auto& [column_id, cell] : row) {
+          if (column_id == kExistsColumn) {
+            continue;
+          }
+          if (cell.cold != nullptr) {
+            reclaimed_bytes += EraseColdVersions(
+                cell.cold->CountBefore(oldest_exists), cell, memory);
+          }
+          reclaimed_bytes += EraseVersions(
+              cell.versions.begin(), cell.versions.lower_bound(oldest_exists),
+              cell, memory);
+        }
+      }
+
+      // A row whose only remaining version is a delete at or before the
+      // horizon reads the same as a row which was never written.
+      if (exists.size() == 1 && exists.begin()->first <= version_horizon &&
+          !exists.begin()->second.bool_value()) {
+        for (auto& [column_id, cell] : row) {
+          if (cell.cold != nullptr) {
+            reclaimed_bytes +=
+                EraseColdVersions(cell.cold->num_versions(), cell, memory);
+          }
+          reclaimed_bytes += EraseVersions(cell.versions.begin(),
+                                           cell.versions.end(), cell, memory);
+        }
+        memory.key_bytes -= row_itr->first.size();
+        row_itr = rows.erase(row_itr);
+      } else {
+        ++row_itr;
+      }
+    }
+    // Drop the removed keys from the filter, so that checks for them are
+    // rejected without a probe again.
+    if (rows.size() < num_rows) {
+      RebuildKeyFilter(rows, table->key_filter);
+    }
+    memory_bytes_.fetch_add(memory.total_bytes() - old_memory_bytes,
+                            std::memory_order_relaxed);
+  }
+  return reclaimed_bytes;
+}
+
+int64_t InMemoryStorage::CompressVersions(absl::Time cold_horizon) {
+  std::vector<Table*> tables;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    tables.reserve(tables_.size());
+    for (const auto& [table_id, table] : tables_) {
+      tables.push_back(table.get());
+    }
+  }
+
+  int64_t saved_bytes = 0;
+  for (Table* table : tables) {
+    absl::MutexLock lock(&table->mu);
+    if (table->rows.use_count() > 1) {
+      continue;
+    }
+    StorageMemoryUsage& memory = table->memory;
+    const int64_t old_memory_bytes = memory.total_bytes();
+    for (auto& [encoded_key, row] : *table->rows) {
+      for (auto& [column_id, cell] : row) {
+        if (column_id != kExistsColumn) {
+          saved_bytes += CompressCellVersions(cold_horizon, cell, memory);
+        }
+      }
+    }
+    memory_bytes_.fetch_add(memory.total_bytes() - old_memory_bytes,
+                            std::memory_order_relaxed);
+  }
+  return saved_bytes;
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -17,14 +17,34 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_IN_MEMORY_STORAGE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_IN_MEMORY_STORAGE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "backend/common/ids.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
+#include "backend/storage/append_only_index.h"
+#include "backend/storage/cold_versions.h"
 #include "backend/storage/iterator.h"
+#include "backend/storage/key_access_heatmap.h"
+#include "backend/storage/key_filter.h"
 #include "backend/storage/storage.h"
+#include "backend/storage/value_interner.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 
 namespace google {
 namespace spanner {
@@ -35,51 +55,492 @@ namespace backend {
 //
 // Keys are stored in sorted order. Value versions for a given column are also
 // sorted in order of the timestamp written. Keys are never deleted, but are
-// marked deleted for multi-version lookup.
+// marked deleted for multi-version lookup. A delete adds a single version to
+// the existence of each row, rather than one to each of its columns, and
+// versions of columns older than the insert a read observes are hidden from it.
+// CollectGarbage discards versions which are no longer visible at the given
+// horizon, and removes keys which were deleted before it. CompressVersions
+// moves the versions of each column which are older than the latest one at
+// its horizon into an encoded block (see ColdVersions), which is decoded only
+// by reads at timestamps before that version.
+//
+// Clone creates a copy-on-write copy of the storage, in which each table is
+// copied by the first write to it from either storage.
 //
 // Lookup and Read return invalid zetasql::Value(s) for non-existent columns.
 //
+// Tables are sharded, each with its own reader-writer lock. Lookup and Read
+// take shared locks, while Write and Delete take an exclusive lock on only the
+// table they modify. mu_ only guards changes to the set of tables, which is
+// grow-only, so lookups of a table by Lookup, Read, Write and Delete take no
+// lock beyond that of the table itself (see AppendOnlyIndex).
+//
+// Read returns an iterator which fetches rows in batches as it is advanced,
+// holding the table lock only while it fetches a batch. Since rows are
+// multi-versioned, an iterator observes the table as of the read timestamp
+// regardless of writes at later timestamps between batches. ReadReverse
+// returns the same kind of iterator, walking the range from its limit key.
+//
+// Tables registered with RegisterInterleavedTable are clustered: the rows of
+// every table in an interleave hierarchy are stored in the shard of its root
+// table, with each child row placed directly after its parent row. To keep
+// the tables apart, the key of a row in the shard has an INT64 tag identifying
+// the child table inserted after the key columns of each of its ancestors,
+// e.g. a row of C interleaved in P(a) with key (a, b) is stored at
+// (a, tag(C), b). Reads of a clustered table skip rows of other tables, and a
+// prefix range of a child table, as used by cascading deletes, maps to a
+// single contiguous range of the shard.
+//
+// Each table maintains statistics of the latest version of its rows, which
+// answer EstimateRange and EstimateNthKey in time logarithmic in the number of
+// rows of the table. Rows are counted in blocks of contiguous keys, which are
+// split as they grow beyond 2 * kStatsBlockRows rows and merged into the
+// preceding block as they shrink, so writes only update the block of the key
+// they write. Estimates are exact for the latest version of each row, and only
+// scan the rows of the blocks at the ends of the requested range. Each table
+// also keeps its number of rows after the writes at each timestamp, which
+// answers RowCount without reading the rows.
+//
+// Each shard also keeps a bloom filter (see KeyFilter) of the storage keys of
+// its rows, so that Exists, as used to check that inserted keys are new,
+// answers for most absent keys without a probe of the rows. The filter is
+// rebuilt from the rows whenever it fills up, and after garbage collection
+// removes rows from the shard.
+//
+// If constructed with a ValueInterner, STRING and BYTES values are interned
+// before they are written, so that repeated values share a single payload.
+// Clones share the interner.
+//
+// Each shard also accounts for the memory used by its keys and the versions of
+// their cells, as estimated by VersionSize. Rows of clustered tables are
+// accounted to their root table. Shards shared with a clone are accounted to
+// both storages.
+//
 // This class is thread-safe.
 class InMemoryStorage : public Storage {
  public:
+  // All arguments are optional. CheckMemoryQuota fails once the storage uses
+  // more than memory_quota_bytes, unless it is zero or less. If
+  // key_access_sampling_interval is positive, one in that many key accesses is
+  // recorded in key_access_heatmap(). Clones sample their accesses likewise.
+  explicit InMemoryStorage(std::shared_ptr<ValueInterner> interner = nullptr,
+                           int64_t memory_quota_bytes = 0,
+                           int key_access_sampling_interval = 0)
+      : interner_(std::move(interner)),
+        memory_quota_bytes_(memory_quota_bytes),
+        key_access_heatmap_(key_access_sampling_interval > 0
+                                ? std::make_unique<KeyAccessHeatmap>(
+                                      key_access_sampling_interval)
+                                : nullptr) {}
+
   absl::Status Lookup(absl::Time timestamp, const TableID& table_id,
                       const Key& key, const std::vector<ColumnID>& column_ids,
                       std::vector<zetasql::Value>* values) const override
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Passes views of the stored values, while holding the lock of the table.
+  absl::Status VisitLookup(absl::Time timestamp, const TableID& table_id,
+                           const Key& key,
+                           const std::vector<ColumnID>& column_ids,
+                           ColumnValueVisitor visitor) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Checks the filter of the keys of the table first, so most absent keys are
+  // rejected without probing its rows.
+  absl::StatusOr<bool> Exists(absl::Time timestamp, const TableID& table_id,
+                              const Key& key) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Locks the table once for all of the keys.
+  absl::Status MultiLookup(
+      absl::Time timestamp, const TableID& table_id,
+      absl::Span<const Key> sorted_keys,
+      const std::vector<ColumnID>& column_ids,
+      std::vector<std::pair<Key, std::vector<zetasql::Value>>>* rows)
+      const override ABSL_LOCKS_EXCLUDED(mu_);
+
   absl::Status Read(absl::Time timestamp, const TableID& table_id,
                     const KeyRange& key_range,
                     const std::vector<ColumnID>& column_ids,
                     std::unique_ptr<StorageIterator>* itr) const override
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  absl::Status ReadReverse(absl::Time timestamp, const TableID& table_id,
+                           const KeyRange& key_range,
+                           const std::vector<ColumnID>& column_ids,
+                           std::unique_ptr<StorageIterator>* itr) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   absl::Status Write(absl::Time timestamp, const TableID& table_id,
                      const Key& key, const std::vector<ColumnID>& column_ids,
                      const std::vector<zetasql::Value>& values) override
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Moves the values into the written versions.
+  absl::Status Write(absl::Time timestamp, const TableID& table_id,
+                     const Key& key, const std::vector<ColumnID>& column_ids,
+                     std::vector<zetasql::Value>&& values) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   absl::Status Delete(absl::Time timestamp, const TableID& table_id,
                       const KeyRange& key_range) override
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Locks each table written by ops once, and moves keys and values out of
+  // ops.
+  absl::Status ApplyBatch(absl::Time timestamp,
+                          absl::Span<StorageWriteOp> ops) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  int64_t CollectGarbage(absl::Time version_horizon) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Skips tables shared with a clone, like CollectGarbage, and the existence
+  // of rows, which every read looks up.
+  int64_t CompressVersions(absl::Time cold_horizon) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Clusters child_table_id with the hierarchy of parent_table_id, unless the
+  // child has already been registered or written to.
+  void RegisterInterleavedTable(const TableID& parent_table_id,
+                                int parent_key_size,
+                                const TableID& child_table_id,
+                                int child_key_size) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The clone shares the rows of each table with this storage until either
+  // of them writes to the table.
+  absl::StatusOr<std::unique_ptr<Storage>> Clone() const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Replaces the rows of each shard whose tables are all truncated with an
+  // empty map, in time independent of the number of rows, and destroys the
+  // old rows on a background thread. Truncated tables which share a shard
+  // with other tables are deleted at timestamp instead.
+  absl::Status Truncate(absl::Time timestamp,
+                        absl::Span<const TableID> table_ids) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::StatusOr<StorageRangeStats> EstimateRange(
+      const TableID& table_id, const KeyRange& key_range) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::StatusOr<Key> EstimateNthKey(const TableID& table_id,
+                                     int64_t n) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Counts are always known at and after the latest timestamp written to the
+  // table. A write at an earlier timestamp than one already written may change
+  // rows at every later timestamp, so counts before it are forgotten, as are
+  // counts before the version horizon of the last garbage collection.
+  absl::StatusOr<int64_t> RowCount(const TableID& table_id,
+                                   absl::Time timestamp) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  std::map<TableID, StorageMemoryUsage> GetMemoryUsage() const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status CheckMemoryQuota() const override;
+
+  const KeyAccessHeatmap* key_access_heatmap() const override {
+    return key_access_heatmap_.get();
+  }
+
+  // Returns the estimated memory used by all tables.
+  int64_t memory_bytes() const {
+    return memory_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // The number of rows which a block of the statistics of a table is split
+  // into halves of once it exceeds twice as many.
+  static constexpr int64_t kStatsBlockRows = 256;
+
  private:
-  using Cell = std::map<absl::Time, zetasql::Value>;
+  // The versions of a cell are kept in a B-tree, whose nodes hold many
+  // versions side by side, rather than in a node per version. Scalar values
+  // are stored inline in the zetasql::Value of each version, so a version of
+  // an INT64 or TIMESTAMP cell takes little more than its timestamp and value.
+  using Versions = absl::btree_map<absl::Time, zetasql::Value>;
+  struct Cell {
+    Versions versions;
+
+    // The versions before the oldest of versions, as compressed by
+    // CompressVersions, or nullptr. The latest version of a cell is never
+    // compressed, so versions is not empty while there are compressed ones.
+    // Blocks are immutable, so clones share them.
+    std::shared_ptr<const ColdVersions> cold;
+  };
   using Row = absl::flat_hash_map<ColumnID, Cell>;
-  using Table = std::map<Key, Row>;
-  using Tables = absl::flat_hash_map<TableID, Table>;
+  // Rows are keyed by the memcomparable encoding of their keys (see
+  // EncodeKey), so that map probes compare bytes rather than column values.
+  using Rows = std::map<std::string, Row>;
+
+  // The statistics of the rows of a table in consecutive blocks of its storage
+  // keys, keyed by the encoding of the first storage key of each block. The
+  // first block starts at the empty key, so every key is in exactly one block.
+  using StatsBlocks = std::map<std::string, StorageRangeStats>;
+
+  // A block of the statistics of a table, with the totals of all the blocks
+  // before it.
+  struct StatsPrefixSum {
+    StatsBlocks::const_iterator block;
+    StorageRangeStats before;
+  };
+
+  // The statistics of the latest version of the rows of a single table.
+  struct TableStats {
+    StatsBlocks blocks = {{std::string(), StorageRangeStats()}};
+
+    // Every block in key order, or empty if a block has changed since they
+    // were last computed (see PrefixSums).
+    std::vector<StatsPrefixSum> prefix_sums;
+
+    // The number of rows of the latest version of the table.
+    int64_t row_count = 0;
+
+    // The number of rows of the table after the writes at each timestamp
+    // since row_counts_start, before which the counts are not known. The
+    // table has no rows at timestamps between row_counts_start and the first
+    // entry.
+    std::map<absl::Time, int64_t> row_counts;
+    absl::Time row_counts_start = absl::InfinitePast();
+
+    // The latest timestamp written to the table.
+    absl::Time last_write_timestamp = absl::InfinitePast();
+  };
+  using TableStatsMap = absl::flat_hash_map<TableID, TableStats>;
+
+  // A single table shard. Shards are never removed once created, so pointers
+  // to them remain valid after mu_ is released.
+  //
+  // Rows may be shared with clones of this storage, in which case they are
+  // immutable and copied by the first write to the shard (see MutableRows).
+  struct Table {
+    mutable absl::Mutex mu;
+    std::shared_ptr<Rows> rows ABSL_GUARDED_BY(mu) = std::make_shared<Rows>();
+
+    // The statistics of each table whose rows are stored in the shard. They
+    // are not shared with clones, as they are small compared to the rows.
+    TableStatsMap stats ABSL_GUARDED_BY(mu);
+
+    // May contain the encoded key of every entry of rows. Like the
+    // statistics, it is copied rather than shared with clones.
+    KeyFilter key_filter ABSL_GUARDED_BY(mu);
+
+    // The memory used by rows.
+    StorageMemoryUsage memory ABSL_GUARDED_BY(mu);
+  };
+  using Tables = absl::flat_hash_map<TableID, std::unique_ptr<Table>>;
+
+  // The placement of a clustered table in the shard of its root table.
+  // Layouts are never modified or removed once registered.
+  struct Layout {
+    // The table whose shard stores the rows of this table.
+    TableID root_table_id;
+
+    // The number of primary key columns of this table.
+    int num_key_columns = 0;
+
+    // The tag of this table and of each of its ancestors below the root,
+    // outermost first, paired with the number of primary key columns which
+    // precede the tag in the storage key.
+    std::vector<std::pair<int, int64_t>> tags;
+  };
+  using Layouts = absl::flat_hash_map<TableID, std::unique_ptr<const Layout>>;
+
+  // The iterator returned by Read and ReadReverse.
+  class RangeIterator;
+
+  // Implements Read, returning rows in reverse key order if reverse is true.
+  absl::Status ReadRange(absl::Time timestamp, const TableID& table_id,
+                         const KeyRange& key_range,
+                         const std::vector<ColumnID>& column_ids, bool reverse,
+                         std::unique_ptr<StorageIterator>* itr) const
+      ABSL_LOCKS_EXCLUDED(mu_);
 
   // Returns true if the given row is valid at the specified timestamp.
-  bool Exists(const Row& row, absl::Time timestamp) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  static bool Exists(const Row& row, absl::Time timestamp);
+
+  // Returns the timestamp of the latest version of the existence of row at or
+  // before timestamp, i.e. when the row was last inserted if it exists at
+  // timestamp, or absl::InfinitePast() if there is no such version.
+  static absl::Time InsertTimestamp(const Row& row, absl::Time timestamp);
+
+  // Returns the value for given row and column_id at the specified timestamp,
+  // or an invalid value if the latest version of the column at timestamp was
+  // written before insert_timestamp. Deletes only add a version to the
+  // existence of a row, which hides the versions of its other columns written
+  // before the next insert from reads after it.
+  static zetasql::Value GetCellValueAtTimestamp(const Row& row,
+                                                  const ColumnID& column_id,
+                                                  absl::Time timestamp,
+                                                  absl::Time insert_timestamp);
+
+  // Like GetCellValueAtTimestamp, but returns the stored value, or nullptr if
+  // the column is not set. A compressed value is decoded into cold_value,
+  // which is returned.
+  static const zetasql::Value* FindCellValueAtTimestamp(
+      const Row& row, const ColumnID& column_id, absl::Time timestamp,
+      absl::Time insert_timestamp, zetasql::Value* cold_value);
+
+  // Writes the given column values for the storage key into rows at
+  // timestamp, and updates the statistics of the table of layout, the filter
+  // of the keys of rows and the memory used by rows.
+  static void WriteRow(absl::Time timestamp, const Key& key,
+                       const std::vector<ColumnID>& column_ids,
+                       std::vector<zetasql::Value> values,
+                       const Layout* layout, Rows& rows, TableStats& stats,
+                       KeyFilter& key_filter, StorageMemoryUsage& memory);
+
+  // Sets the version of cell at timestamp to value, updating memory. The
+  // compressed versions of cell are decoded first if timestamp is not after
+  // them.
+  static void SetVersion(absl::Time timestamp, zetasql::Value value,
+                         Cell& cell, StorageMemoryUsage& memory);
+
+  // Replaces key_filter with one of the keys of rows, sized for twice as many
+  // keys so that rebuilds are amortized over the inserts which fill it.
+  static void RebuildKeyFilter(const Rows& rows, KeyFilter& key_filter);
+
+  // Marks the keys of rows in the ClosedOpen key_range as deleted at
+  // timestamp. If layout is not null, key_range is a range of storage keys
+  // and only the rows of its table are deleted.
+  static void DeleteRows(absl::Time timestamp, const KeyRange& key_range,
+                         const Layout* layout, Rows& rows, TableStats& stats,
+                         StorageMemoryUsage& memory);
+
+  // Returns the storage key of the row stored under encoded_key if it is a row
+  // of the table of layout whose latest version exists.
+  static std::optional<Key> LatestTableRowKey(const Layout* layout,
+                                              const std::string& encoded_key,
+                                              const Row& row);
+
+  // Returns the size which the latest version of row contributes to the
+  // statistics of its table.
+  static int64_t LatestRowSize(const Key& storage_key, const Row& row);
+
+  // Records that a write at timestamp changed the number of rows of the table
+  // of stats by row_count_delta, which also applies to the latest version of
+  // the table.
+  static void RecordRowCount(absl::Time timestamp, int64_t row_count_delta,
+                             TableStats& stats);
+
+  // Adds delta to the block of stats containing encoded_key, splitting or
+  // merging the block if its row count is out of bounds.
+  static void UpdateStats(const std::string& encoded_key,
+                          const StorageRangeStats& delta, const Layout* layout,
+                          const Rows& rows, TableStats& stats);
 
-  // Returns the value for given row and column_id at the specified timestamp.
-  zetasql::Value GetCellValueAtTimestamp(const Row& row,
-                                           const ColumnID& column_id,
-                                           absl::Time timestamp) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Splits the block at block_itr at its middle row, counting the rows of
+  // each half from rows.
+  static void SplitStatsBlock(StatsBlocks::iterator block_itr,
+                              const Layout* layout, const Rows& rows,
+                              TableStats& stats);
 
+  // Returns the blocks of stats with their prefix sums, computing them if a
+  // block has changed since they were last returned.
+  static const std::vector<StatsPrefixSum>& PrefixSums(TableStats& stats);
+
+  // Returns the statistics of the rows of the table of layout whose storage
+  // keys are encoded before encoded_key.
+  static StorageRangeStats CountRowsBefore(const std::string& encoded_key,
+                                           const Layout* layout,
+                                           const Rows& rows, TableStats& stats);
+
+  // Converts between the keys of a clustered table and the keys under which
+  // its rows are stored in the shard of its root table.
+  static Key ToStorageKey(const Layout& layout, const Key& key);
+  static KeyRange ToStorageKeyRange(const Layout& layout,
+                                    const KeyRange& key_range);
+  static Key FromStorageKey(const Layout& layout, const Key& storage_key);
+
+  // Returns true if storage_key is the key of a row of the table of layout.
+  static bool IsTableRow(const Layout& layout, const Key& storage_key);
+
+  // Discards versions of cell older than the latest version at or before
+  // version_horizon. Returns an estimate of the number of bytes reclaimed,
+  // which is also subtracted from memory.
+  static int64_t CollectCellGarbage(absl::Time version_horizon, Cell& cell,
+                                    StorageMemoryUsage& memory);
+
+  // Discards the versions of cell in [begin, end). Returns an estimate of the
+  // number of bytes reclaimed, which is also subtracted from memory.
+  static int64_t EraseVersions(Versions::iterator begin,
+                               Versions::iterator end, Cell& cell,
+                               StorageMemoryUsage& memory);
+
+  // Discards the oldest n compressed versions of cell, if it has any. Returns
+  // an estimate of the number of bytes reclaimed, which is also subtracted
+  // from memory.
+  static int64_t EraseColdVersions(int n, Cell& cell,
+                                   StorageMemoryUsage& memory);
+
+  // Moves the compressed versions of cell back into its versions, updating
+  // memory.
+  static void ExpandColdVersions(Cell& cell, StorageMemoryUsage& memory);
+
+  // Compresses the versions of cell older than the latest version at or
+  // before cold_horizon, together with those already compressed, unless that
+  // does not reduce its memory. Returns an estimate of the number of bytes
+  // saved, which is also subtracted from memory.
+  static int64_t CompressCellVersions(absl::Time cold_horizon, Cell& cell,
+                                      StorageMemoryUsage& memory);
+
+  // Returns an estimate of the memory used by a single cell version.
+  static int64_t VersionSize(const zetasql::Value& value);
+
+  // Returns the shard for the given table, or nullptr if it does not exist.
+  // Sets layout to the layout of the table if it is clustered, or to nullptr
+  // otherwise.
+  Table* FindTable(const TableID& table_id, const Layout** layout) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of table for writing, copying them first if they are
+  // shared with a clone.
+  static Rows& MutableRows(Table* table)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(table->mu);
+
+  // Returns the shard for the given table, creating it if it does not exist.
+  // Sets layout as FindTable does.
+  Table* FindOrCreateTable(const TableID& table_id, const Layout** layout)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the layout of the given table, or nullptr if it is not clustered.
+  const Layout* FindLayout(const TableID& table_id) const;
+
+  // Records an access to key in key_access_heatmap_ if it is sampled. The
+  // position of the key is estimated from the statistics of the table, which
+  // takes the table lock, so this must be called without holding it.
+  void RecordKeyAccess(const TableID& table_id, const Key& key,
+                       KeyAccessHeatmap::AccessType type) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Guards the set of tables and layouts. Individual table contents are
+  // guarded by the per-table mutex.
   mutable absl::Mutex mu_;
   Tables tables_ ABSL_GUARDED_BY(mu_);
+  Layouts layouts_ ABSL_GUARDED_BY(mu_);
+
+  // Index the entries of tables_ and layouts_, which are added to them while
+  // holding mu_, for lookups which do not take it.
+  AppendOnlyIndex<Table> tables_index_;
+  AppendOnlyIndex<const Layout> layouts_index_;
+
+  // The tag assigned to the next clustered child table.
+  int64_t next_tag_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // Interns the values written, or nullptr if they are stored as given.
+  const std::shared_ptr<ValueInterner> interner_;
+
+  // The quota checked by CheckMemoryQuota, or zero or less if there is none.
+  const int64_t memory_quota_bytes_;
+
+  // Records sampled key accesses, or nullptr if they are not sampled.
+  const std::unique_ptr<KeyAccessHeatmap> key_access_heatmap_;
+
+  // The sum of the memory used by every shard, updated by each writer after it
+  // modifies a shard.
+  std::atomic<int64_t> memory_bytes_ = 0;
 };
 
 }  // namespace backend
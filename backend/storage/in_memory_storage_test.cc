@@ -16,17 +16,28 @@
 
 #include "backend/storage/in_memory_storage.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "backend/datamodel/key_range.h"
 #include "backend/storage/iterator.h"
+#include "backend/storage/storage.h"
+#include "backend/storage/value_interner.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -114,6 +125,71 @@ TEST_F(InMemoryStorageTest, ReadRangeFromSingleTable) {
   EXPECT_FALSE(itr_->Next());
 }
 
+TEST_F(InMemoryStorageTest, MultiLookupSkipsMissingKeys) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+
+  // Write every other key, then delete one of them.
+  for (int i = 0; i < 100; i += 2) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {String(absl::StrCat("value-", i))}));
+  }
+  ZETASQL_EXPECT_OK(storage_.Delete(t1, kTableId0, KeyRange::Point(Key({Int64(4)}))));
+
+  // Keys close to each other and far apart are both found.
+  std::vector<Key> keys = {Key({Int64(2)}),  Key({Int64(3)}),
+                           Key({Int64(4)}),  Key({Int64(6)}),
+                           Key({Int64(80)}), Key({Int64(200)})};
+  std::vector<std::pair<Key, std::vector<zetasql::Value>>> rows;
+  ZETASQL_EXPECT_OK(storage_.MultiLookup(t1, kTableId0, keys, {kColumnID}, &rows));
+  EXPECT_THAT(
+      rows, testing::ElementsAre(
+                testing::Pair(Key({Int64(2)}),
+                              testing::ElementsAre(String("value-2"))),
+                testing::Pair(Key({Int64(6)}),
+                              testing::ElementsAre(String("value-6"))),
+                testing::Pair(Key({Int64(80)}),
+                              testing::ElementsAre(String("value-80")))));
+
+  // The deleted key is still visible at an earlier timestamp.
+  rows.clear();
+  ZETASQL_EXPECT_OK(storage_.MultiLookup(t0, kTableId0, keys, {kColumnID}, &rows));
+  EXPECT_EQ(rows.size(), 4);
+
+  // Lookups in a missing table find nothing.
+  rows.clear();
+  ZETASQL_EXPECT_OK(storage_.MultiLookup(t0, kTableId1, keys, {kColumnID}, &rows));
+  EXPECT_TRUE(rows.empty());
+}
+
+TEST_F(InMemoryStorageTest, VisitLookupPassesViewsOfStoredValues) {
+  absl::Time t0 = absl::Now();
+  std::vector<zetasql::Value> values = {String("value-1")};
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           std::move(values)));
+
+  // Every lookup passes the same stored value, rather than a copy of it.
+  std::vector<const zetasql::Value*> visited;
+  for (int i = 0; i < 2; ++i) {
+    ZETASQL_EXPECT_OK(storage_.VisitLookup(
+        t0, kTableId0, Key({Int64(1)}), {kColumnID, "missing_column"},
+        [&](int column_index, const zetasql::Value& value) {
+          if (column_index == 0) {
+            EXPECT_EQ(value, String("value-1"));
+            visited.push_back(&value);
+          } else {
+            EXPECT_FALSE(value.is_valid());
+          }
+        }));
+  }
+  ASSERT_EQ(visited.size(), 2);
+  EXPECT_EQ(visited[0], visited[1]);
+
+  EXPECT_THAT(storage_.VisitLookup(t0, kTableId0, Key({Int64(2)}), {kColumnID},
+                                   [](int, const zetasql::Value&) {}),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+}
+
 TEST_F(InMemoryStorageTest, LookupByTimestamp) {
   absl::Time write_ts = absl::Now();
 
@@ -563,6 +639,24 @@ TEST_F(InMemoryStorageTest, LookupShouldReturnMostRecentColumnValues) {
   EXPECT_EQ(itr_->Key(), Key({Int64(1)}));
 }
 
+TEST_F(InMemoryStorageTest, WriteAfterDeleteAtSameTimestampHidesOldColumns) {
+  const ColumnID kOtherColumnID = "test_column:1";
+  absl::Time t0 = absl::Now();
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, key, {kColumnID, kOtherColumnID},
+                           {String("value-1"), String("value-2")}));
+  ZETASQL_EXPECT_OK(storage_.Delete(t0, kTableId0, KeyRange::Point(key)));
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t0, kTableId0, key, {kColumnID}, {String("value-3")}));
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(t0, kTableId0, key, {kColumnID, kOtherColumnID},
+                            &values));
+  EXPECT_THAT(values,
+              testing::ElementsAre(String("value-3"), zetasql::Value()));
+}
+
 TEST_F(InMemoryStorageTest, LookupAtOrAfterDeleteTimestampReturnsInvalidValue) {
   Key key({Int64(1)});
   absl::Time write_ts = absl::Now();
@@ -702,6 +796,951 @@ TEST_F(InMemoryStorageTest,
       zetasql_base::testing::StatusIs(absl::StatusCode::kInternal));
 }
 
+TEST_F(InMemoryStorageTest, ConcurrentWritesToDifferentTables) {
+  absl::Time t0 = absl::Now();
+  std::vector<TableID> table_ids;
+  for (int i = 0; i < 8; ++i) {
+    table_ids.push_back(absl::StrCat("test_table:", i));
+  }
+
+  std::vector<std::thread> threads;
+  for (const TableID& table_id : table_ids) {
+    threads.emplace_back([this, t0, table_id]() {
+      for (int i = 0; i < 100; ++i) {
+        ZETASQL_EXPECT_OK(storage_.Write(t0, table_id, Key({Int64(i)}), {kColumnID},
+                                 {Int64(i)}));
+        std::vector<zetasql::Value> values;
+        ZETASQL_EXPECT_OK(storage_.Lookup(t0, table_id, Key({Int64(i)}),
+                                  {kColumnID}, &values));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (const TableID& table_id : table_ids) {
+    ZETASQL_EXPECT_OK(storage_.Read(t0, table_id, KeyRange::All(), {kColumnID},
+                            &itr_));
+    int num_rows = 0;
+    while (itr_->Next()) {
+      EXPECT_EQ(itr_->ColumnValue(0), Int64(num_rows));
+      ++num_rows;
+    }
+    EXPECT_EQ(num_rows, 100);
+  }
+}
+
+TEST_F(InMemoryStorageTest, ApplyBatchWritesAndDeletesAcrossTables) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+
+  std::vector<StorageWriteOp> ops(3);
+  ops[0].table_id = kTableId0;
+  ops[0].key = Key({Int64(1)});
+  ops[0].is_delete = true;
+  ops[1].table_id = kTableId1;
+  ops[1].key = Key({Int64(2)});
+  ops[1].column_ids = {kColumnID};
+  ops[1].values = {String("value-2")};
+  ops[2].table_id = kTableId0;
+  ops[2].key = Key({Int64(3)});
+  ops[2].column_ids = {kColumnID};
+  ops[2].values = {String("value-3")};
+  ZETASQL_EXPECT_OK(storage_.ApplyBatch(t1, absl::MakeSpan(ops)));
+
+  std::vector<zetasql::Value> values;
+  EXPECT_THAT(
+      storage_.Lookup(t1, kTableId0, Key({Int64(1)}), {kColumnID}, &values),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t0, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-1")));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId1, Key({Int64(2)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-2")));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId0, Key({Int64(3)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-3")));
+}
+
+TEST_F(InMemoryStorageTest, CollectGarbageKeepsVersionsVisibleAtHorizon) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+  absl::Time t3 = t0 + absl::Seconds(3);
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-0")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t3, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-3")}));
+
+  // Only the version written at t0 is hidden at t2.
+  EXPECT_GT(storage_.CollectGarbage(t2), 0);
+  EXPECT_EQ(storage_.CollectGarbage(t2), 0);
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t2, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-1")));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t3, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-3")));
+}
+
+TEST_F(InMemoryStorageTest, CollectGarbageRemovesRowsDeletedBeforeHorizon) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(2)}), {kColumnID},
+                           {String("value-2")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Delete(t1, kTableId0, KeyRange::Point(Key({Int64(1)}))));
+
+  EXPECT_GT(storage_.CollectGarbage(t2), 0);
+
+  ZETASQL_EXPECT_OK(storage_.Read(t2, kTableId0, KeyRange::All(), {kColumnID}, &itr_));
+  EXPECT_TRUE(itr_->Next());
+  EXPECT_EQ(itr_->Key(), Key({Int64(2)}));
+  EXPECT_EQ(itr_->ColumnValue(0), String("value-2"));
+  EXPECT_FALSE(itr_->Next());
+
+  // A deleted key can be written again after its versions were collected.
+  ZETASQL_EXPECT_OK(storage_.Write(t2, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-3")}));
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t2, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-3")));
+}
+
+TEST_F(InMemoryStorageTest, CollectGarbageDiscardsVersionsHiddenByDelete) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+  absl::Time t3 = t0 + absl::Seconds(3);
+  Key key({Int64(1)});
+
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t0, kTableId0, key, {kColumnID}, {String("value-1")}));
+  ZETASQL_EXPECT_OK(storage_.Delete(t1, kTableId0, KeyRange::Point(key)));
+  ZETASQL_EXPECT_OK(storage_.Write(t2, kTableId0, key, {}, {}));
+
+  EXPECT_GT(storage_.CollectGarbage(t3), 0);
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(t3, kTableId0, key, {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(zetasql::Value()));
+}
+
+TEST_F(InMemoryStorageTest, CollectGarbageKeepsRowsDeletedAfterHorizon) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Delete(t2, kTableId0, KeyRange::Point(Key({Int64(1)}))));
+
+  EXPECT_EQ(storage_.CollectGarbage(t1), 0);
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-1")));
+}
+
+TEST_F(InMemoryStorageTest, CompressedVersionsAreReadAtTheirTimestamps) {
+  absl::Time t0 = absl::Now();
+  Key key({Int64(1)});
+  auto value_at = [&](absl::Time timestamp) {
+    std::vector<zetasql::Value> values;
+    ZETASQL_EXPECT_OK(
+        storage_.Lookup(timestamp, kTableId0, key, {kColumnID}, &values));
+    return values.empty() ? zetasql::Value() : values[0];
+  };
+  for (int i = 0; i < 50; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0 + absl::Seconds(i), kTableId0, key,
+                             {kColumnID},
+                             {String(absl::StrCat("status: active ", i))}));
+  }
+  const int64_t uncompressed_bytes = storage_.memory_bytes();
+
+  // Every version before the one visible at the horizon is compressed.
+  EXPECT_GT(storage_.CompressVersions(t0 + absl::Seconds(40.5)), 0);
+  EXPECT_EQ(storage_.CompressVersions(t0 + absl::Seconds(40.5)), 0);
+  EXPECT_LT(storage_.memory_bytes(), uncompressed_bytes);
+  EXPECT_EQ(storage_.GetMemoryUsage()[kTableId0].num_versions, 51);
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(value_at(t0 + absl::Seconds(i)),
+              String(absl::StrCat("status: active ", i)));
+  }
+
+  // A write before the compressed versions decodes them again.
+  ZETASQL_EXPECT_OK(storage_.Write(t0 + absl::Seconds(10.5), kTableId0, key,
+                           {kColumnID}, {String("rewritten")}));
+  EXPECT_EQ(value_at(t0 + absl::Seconds(10.5)), String("rewritten"));
+  EXPECT_EQ(value_at(t0 + absl::Seconds(11)), String("status: active 11"));
+}
+
+TEST_F(InMemoryStorageTest, CollectGarbageDiscardsCompressedVersions) {
+  absl::Time t0 = absl::Now();
+  Key key({Int64(1)});
+  for (int i = 0; i < 10; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0 + absl::Seconds(i), kTableId0, key,
+                             {kColumnID}, {Int64(i)}));
+  }
+  EXPECT_GT(storage_.CompressVersions(t0 + absl::Seconds(9)), 0);
+
+  // The version visible at the horizon is kept, even while compressed.
+  EXPECT_GT(storage_.CollectGarbage(t0 + absl::Seconds(5)), 0);
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(t0 + absl::Seconds(5), kTableId0, key,
+                            {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(Int64(5)));
+  EXPECT_EQ(storage_.GetMemoryUsage()[kTableId0].num_versions, 6);
+
+  ZETASQL_EXPECT_OK(storage_.Delete(t0 + absl::Seconds(10), kTableId0,
+                            KeyRange::Point(key)));
+  EXPECT_GT(storage_.CollectGarbage(t0 + absl::Seconds(11)), 0);
+  EXPECT_EQ(storage_.memory_bytes(), 0);
+}
+
+TEST_F(InMemoryStorageTest, ManyVersionsOfCellAreReadAtTheirTimestamps) {
+  absl::Time t0 = absl::Now();
+  Key key({Int64(1)});
+  auto value_at = [&](absl::Time timestamp) {
+    std::vector<zetasql::Value> values;
+    ZETASQL_EXPECT_OK(
+        storage_.Lookup(timestamp, kTableId0, key, {kColumnID}, &values));
+    return values.empty() ? zetasql::Value() : values[0];
+  };
+
+  // Enough versions to span many nodes of the cell, written out of timestamp
+  // order: the even seconds first, then the odd ones.
+  constexpr int kNumVersions = 1000;
+  for (int parity : {0, 1}) {
+    for (int i = parity; i < kNumVersions; i += 2) {
+      ZETASQL_EXPECT_OK(storage_.Write(t0 + absl::Seconds(i), kTableId0, key,
+                               {kColumnID}, {Int64(i)}));
+    }
+  }
+  // Besides the versions of the cell, the row has a single existence version.
+  EXPECT_EQ(storage_.GetMemoryUsage()[kTableId0].num_versions,
+            kNumVersions + 1);
+  for (int i = 0; i < kNumVersions; ++i) {
+    EXPECT_EQ(value_at(t0 + absl::Seconds(i)), Int64(i));
+    EXPECT_EQ(value_at(t0 + absl::Seconds(i + 0.5)), Int64(i));
+  }
+
+  // Every version before the one visible at the horizon is discarded.
+  EXPECT_GT(storage_.CollectGarbage(t0 + absl::Seconds(600.5)), 0);
+  EXPECT_EQ(storage_.GetMemoryUsage()[kTableId0].num_versions,
+            kNumVersions - 600 + 1);
+  EXPECT_EQ(value_at(t0 + absl::Seconds(600.5)), Int64(600));
+  EXPECT_EQ(value_at(t0 + absl::Seconds(kNumVersions)),
+            Int64(kNumVersions - 1));
+}
+
+TEST_F(InMemoryStorageTest, ReadsShareTheElementsOfArrayCells) {
+  absl::Time t0 = absl::Now();
+  std::vector<std::string> tags;
+  for (int i = 0; i < 1000; ++i) {
+    tags.push_back(absl::StrCat("tag", i));
+  }
+  const zetasql::Value array = zetasql::values::StringArray(tags);
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {array}));
+
+  // The elements of an array are reference counted, so the values read from
+  // storage share the elements of the array written rather than copy them.
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t0, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  ASSERT_EQ(values.size(), 1);
+  EXPECT_EQ(&values[0].elements(), &array.elements());
+
+  ZETASQL_EXPECT_OK(
+      storage_.Read(t0, kTableId0, KeyRange::All(), {kColumnID}, &itr_));
+  ASSERT_TRUE(itr_->Next());
+  EXPECT_EQ(&itr_->ColumnValue(0).elements(), &array.elements());
+}
+
+TEST_F(InMemoryStorageTest, AccountsMemoryOfKeysAndVersions) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+  absl::Time t3 = t0 + absl::Seconds(3);
+  Key key({Int64(1)});
+  EXPECT_TRUE(storage_.GetMemoryUsage().empty());
+
+  // The existence of the row and the column each get a version.
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t0, kTableId0, key, {kColumnID}, {String("value-1")}));
+  StorageMemoryUsage usage = storage_.GetMemoryUsage()[kTableId0];
+  EXPECT_GT(usage.key_bytes, 0);
+  EXPECT_GT(usage.cell_bytes, 0);
+  EXPECT_EQ(usage.num_versions, 2);
+  EXPECT_EQ(storage_.memory_bytes(), usage.total_bytes());
+
+  // Overwriting a version replaces it.
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t0, kTableId0, key, {kColumnID}, {String("value-2")}));
+  EXPECT_EQ(storage_.GetMemoryUsage()[kTableId0].num_versions, 2);
+
+  ZETASQL_EXPECT_OK(
+      storage_.Write(t1, kTableId0, key, {kColumnID}, {String("value-3")}));
+  ZETASQL_EXPECT_OK(storage_.Delete(t2, kTableId0, KeyRange::Point(key)));
+  EXPECT_EQ(storage_.GetMemoryUsage()[kTableId0].num_versions, 4);
+  EXPECT_GT(storage_.memory_bytes(), usage.total_bytes());
+
+  // Removing the deleted row reclaims all of its memory.
+  EXPECT_GT(storage_.CollectGarbage(t3), 0);
+  usage = storage_.GetMemoryUsage()[kTableId0];
+  EXPECT_EQ(usage.key_bytes, 0);
+  EXPECT_EQ(usage.cell_bytes, 0);
+  EXPECT_EQ(usage.num_versions, 0);
+  EXPECT_EQ(storage_.memory_bytes(), 0);
+}
+
+TEST(InMemoryStorageQuotaTest, CheckMemoryQuotaFailsOnceQuotaIsExceeded) {
+  InMemoryStorage storage(/*interner=*/nullptr, /*memory_quota_bytes=*/100);
+  absl::Time t0 = absl::Now();
+  ZETASQL_EXPECT_OK(storage.CheckMemoryQuota());
+
+  ZETASQL_EXPECT_OK(storage.Write(t0, "test_table:0", Key({Int64(1)}),
+                          {"test_column:0"}, {String(std::string(200, 'x'))}));
+  EXPECT_THAT(
+      storage.CheckMemoryQuota(),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
+TEST_F(InMemoryStorageTest, ExistsChecksKeyAtTimestamp) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+
+  EXPECT_THAT(storage_.Exists(t0, kTableId0, Key({Int64(1)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(
+      storage_.Delete(t2, kTableId0, KeyRange::Point(Key({Int64(1)}))));
+
+  EXPECT_THAT(storage_.Exists(t0, kTableId0, Key({Int64(1)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+  EXPECT_THAT(storage_.Exists(t1, kTableId0, Key({Int64(1)})),
+              zetasql_base::testing::IsOkAndHolds(true));
+  EXPECT_THAT(storage_.Exists(t2, kTableId0, Key({Int64(1)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+  EXPECT_THAT(storage_.Exists(t1, kTableId0, Key({Int64(2)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+  EXPECT_THAT(storage_.Exists(t1, kTableId1, Key({Int64(1)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+}
+
+TEST_F(InMemoryStorageTest, ExistsFindsKeysAcrossFilterRebuilds) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+
+  // Enough rows to fill and rebuild the filter of the keys several times.
+  std::vector<StorageWriteOp> ops;
+  for (int i = 0; i < 1000; ++i) {
+    ops.push_back({kTableId0, Key({Int64(i)}), false, {kColumnID}, {Int64(i)}});
+  }
+  ZETASQL_EXPECT_OK(storage_.ApplyBatch(t0, absl::MakeSpan(ops)));
+  ZETASQL_EXPECT_OK(storage_.Delete(
+      t1, kTableId0, KeyRange::ClosedOpen(Key({Int64(0)}), Key({Int64(500)}))));
+  EXPECT_GT(storage_.CollectGarbage(t2), 0);
+
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_THAT(storage_.Exists(t2, kTableId0, Key({Int64(i)})),
+                zetasql_base::testing::IsOkAndHolds(i >= 500));
+  }
+}
+
+TEST_F(InMemoryStorageTest, CloneIsIsolatedFromLaterWrites) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId1, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Storage> clone, storage_.Clone());
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("source")}));
+  ZETASQL_EXPECT_OK(
+      clone->Delete(t1, kTableId1, KeyRange::Point(Key({Int64(1)}))));
+  ZETASQL_EXPECT_OK(clone->Write(t1, kTableId1, Key({Int64(2)}), {kColumnID},
+                         {String("clone")}));
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      clone->Lookup(t1, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-1")));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("source")));
+
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId1, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-1")));
+  EXPECT_THAT(
+      storage_.Lookup(t1, kTableId1, Key({Int64(2)}), {kColumnID}, &values),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(
+      clone->Lookup(t1, kTableId1, Key({Int64(1)}), {kColumnID}, &values),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+
+  // Versions written before cloning remain readable in the clone.
+  ZETASQL_EXPECT_OK(
+      clone->Lookup(t0, kTableId1, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-1")));
+}
+
+TEST_F(InMemoryStorageTest, ReadSpansMultipleBatches) {
+  absl::Time t0 = absl::Now();
+  constexpr int kNumRows = 1000;
+  for (int i = 0; i < kNumRows; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+
+  ZETASQL_EXPECT_OK(storage_.Read(t0, kTableId0, KeyRange::All(), {kColumnID}, &itr_));
+  for (int i = 0; i < kNumRows; ++i) {
+    ASSERT_TRUE(itr_->Next());
+    EXPECT_EQ(itr_->Key(), Key({Int64(i)}));
+    EXPECT_EQ(itr_->ColumnValue(0), Int64(i));
+  }
+  EXPECT_FALSE(itr_->Next());
+  ZETASQL_EXPECT_OK(itr_->Status());
+}
+
+TEST_F(InMemoryStorageTest, ReadReverseReturnsRangeInReverseKeyOrder) {
+  absl::Time t0 = absl::Now();
+  constexpr int kNumRows = 1000;
+  for (int i = 0; i < kNumRows; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+  ZETASQL_EXPECT_OK(
+      storage_.Delete(t0, kTableId0, KeyRange::Point(Key({Int64(500)}))));
+
+  ZETASQL_EXPECT_OK(storage_.ReadReverse(
+      t0, kTableId0, KeyRange::ClosedOpen(Key({Int64(100)}), Key({Int64(900)})),
+      {kColumnID}, &itr_));
+  for (int i = 899; i >= 100; --i) {
+    if (i == 500) {
+      continue;
+    }
+    ASSERT_TRUE(itr_->Next());
+    EXPECT_EQ(itr_->Key(), Key({Int64(i)}));
+    EXPECT_EQ(itr_->ColumnValue(0), Int64(i));
+  }
+  EXPECT_FALSE(itr_->Next());
+  ZETASQL_EXPECT_OK(itr_->Status());
+}
+
+TEST_F(InMemoryStorageTest, ReadIsNotAffectedByLaterWritesDuringIteration) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  constexpr int kNumRows = 1000;
+  for (int i = 0; i < kNumRows; i += 2) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+
+  ZETASQL_EXPECT_OK(storage_.Read(t0, kTableId0, KeyRange::All(), {kColumnID}, &itr_));
+  ASSERT_TRUE(itr_->Next());
+
+  // Writes made after the read timestamp while the iterator is in use, which
+  // insert, update and delete rows ahead of it, are not visible to it.
+  for (int i = 1; i < kNumRows; i += 2) {
+    ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(500)}), {kColumnID},
+                           {Int64(-1)}));
+  ZETASQL_EXPECT_OK(
+      storage_.Delete(t1, kTableId0, KeyRange::Point(Key({Int64(900)}))));
+
+  int num_rows = 1;
+  while (itr_->Next()) {
+    EXPECT_EQ(itr_->Key(), Key({Int64(2 * num_rows)}));
+    EXPECT_EQ(itr_->ColumnValue(0), Int64(2 * num_rows));
+    ++num_rows;
+  }
+  EXPECT_EQ(num_rows, kNumRows / 2);
+}
+
+TEST_F(InMemoryStorageTest, ReadOrdersKeysLikeKeyCompare) {
+  absl::Time t0 = absl::Now();
+  std::vector<Key> keys;
+  for (const zetasql::Value& value :
+       {zetasql::Value::NullString(), String(""), String("a"), String("ab")}) {
+    for (const zetasql::Value& id : {zetasql::Value::NullInt64(), Int64(-1),
+                                     Int64(1)}) {
+      Key key({value, id});
+      key.SetColumnDescending(1, true);
+      keys.push_back(key);
+    }
+  }
+  for (const Key& key : keys) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, key, {kColumnID}, {Bool(true)}));
+  }
+  std::sort(keys.begin(), keys.end());
+
+  ZETASQL_EXPECT_OK(storage_.Read(t0, kTableId0, KeyRange::All(), {kColumnID}, &itr_));
+  for (const Key& key : keys) {
+    ASSERT_TRUE(itr_->Next());
+    EXPECT_EQ(itr_->Key(), key);
+    EXPECT_TRUE(itr_->Key().IsColumnDescending(1));
+  }
+  EXPECT_FALSE(itr_->Next());
+}
+
+TEST_F(InMemoryStorageTest, EstimateRangeCountsLatestRows) {
+  absl::Time t0 = absl::Now();
+  const int64_t num_rows = 10 * InMemoryStorage::kStatsBlockRows;
+  for (int64_t i = 0; i < num_rows; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+  // Overwriting a row does not change the count.
+  ZETASQL_EXPECT_OK(storage_.Write(t0 + absl::Seconds(1), kTableId0,
+                           Key({Int64(0)}), {kColumnID}, {Int64(0)}));
+
+  StorageRangeStats row_stats;
+  row_stats.row_count = 1;
+  row_stats.size_bytes = Key({Int64(0)}).LogicalSizeInBytes() +
+                         Int64(0).physical_byte_size();
+  ZETASQL_ASSERT_OK_AND_ASSIGN(StorageRangeStats stats,
+                       storage_.EstimateRange(kTableId0, KeyRange::All()));
+  EXPECT_EQ(stats.row_count, num_rows);
+  EXPECT_EQ(stats.size_bytes, num_rows * row_stats.size_bytes);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      stats, storage_.EstimateRange(
+                 kTableId0, KeyRange::ClosedOpen(Key({Int64(100)}),
+                                                 Key({Int64(1000)}))));
+  EXPECT_EQ(stats.row_count, 900);
+  EXPECT_EQ(stats.size_bytes, 900 * row_stats.size_bytes);
+
+  // Deleted rows are no longer counted, even by estimates of the range which
+  // would read them at an earlier timestamp.
+  ZETASQL_EXPECT_OK(storage_.Delete(
+      t0 + absl::Seconds(2), kTableId0,
+      KeyRange::ClosedOpen(Key({Int64(500)}), Key({Int64(num_rows)}))));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(stats,
+                       storage_.EstimateRange(kTableId0, KeyRange::All()));
+  EXPECT_EQ(stats.row_count, 500);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(stats, storage_.EstimateRange(kTableId1,
+                                                     KeyRange::All()));
+  EXPECT_EQ(stats.row_count, 0);
+}
+
+TEST_F(InMemoryStorageTest, EstimateNthKeyFindsKeyInKeyOrder) {
+  absl::Time t0 = absl::Now();
+  const int64_t num_rows = 10 * InMemoryStorage::kStatsBlockRows;
+  // Write the keys in reverse so that blocks are split at their start.
+  for (int64_t i = num_rows - 1; i >= 0; --i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(2 * i)}),
+                             {kColumnID}, {Int64(i)}));
+  }
+  for (int64_t n : {int64_t{0}, int64_t{1}, int64_t{777}, num_rows - 1}) {
+    EXPECT_THAT(storage_.EstimateNthKey(kTableId0, n),
+                zetasql_base::testing::IsOkAndHolds(Key({Int64(2 * n)})));
+  }
+  EXPECT_THAT(storage_.EstimateNthKey(kTableId0, num_rows),
+              zetasql_base::testing::IsOkAndHolds(Key::Infinity()));
+
+  // Deleting most of the rows merges their blocks.
+  ZETASQL_EXPECT_OK(storage_.Delete(
+      t0 + absl::Seconds(1), kTableId0,
+      KeyRange::ClosedOpen(Key({Int64(2)}), Key({Int64(2 * num_rows - 2)}))));
+  EXPECT_THAT(storage_.EstimateNthKey(kTableId0, 1),
+              zetasql_base::testing::IsOkAndHolds(
+                  Key({Int64(2 * num_rows - 2)})));
+  EXPECT_THAT(storage_.EstimateNthKey(kTableId0, 2),
+              zetasql_base::testing::IsOkAndHolds(Key::Infinity()));
+  EXPECT_THAT(storage_.EstimateNthKey(kTableId1, 0),
+              zetasql_base::testing::IsOkAndHolds(Key::Infinity()));
+}
+
+TEST_F(InMemoryStorageTest, CloneKeepsStatistics) {
+  absl::Time t0 = absl::Now();
+  for (int64_t i = 0; i < 3; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Storage> clone, storage_.Clone());
+  ZETASQL_EXPECT_OK(clone->Write(t0, kTableId0, Key({Int64(3)}), {kColumnID},
+                         {Int64(3)}));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(StorageRangeStats stats,
+                       clone->EstimateRange(kTableId0, KeyRange::All()));
+  EXPECT_EQ(stats.row_count, 4);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(stats,
+                       storage_.EstimateRange(kTableId0, KeyRange::All()));
+  EXPECT_EQ(stats.row_count, 3);
+}
+
+TEST_F(InMemoryStorageTest, RowCountCountsRowsAtTimestamp) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t0 + absl::Seconds(2);
+  for (int64_t i = 0; i < 3; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+  ZETASQL_EXPECT_OK(storage_.Delete(t1, kTableId0, KeyRange::Point(Key({Int64(1)}))));
+  ZETASQL_EXPECT_OK(storage_.Write(t2, kTableId0, Key({Int64(3)}), {kColumnID},
+                           {Int64(3)}));
+
+  using zetasql_base::testing::IsOkAndHolds;
+  EXPECT_THAT(storage_.RowCount(kTableId0, t0 - absl::Seconds(1)),
+              IsOkAndHolds(0));
+  EXPECT_THAT(storage_.RowCount(kTableId0, t0), IsOkAndHolds(3));
+  EXPECT_THAT(storage_.RowCount(kTableId0, t1 - absl::Milliseconds(1)),
+              IsOkAndHolds(3));
+  EXPECT_THAT(storage_.RowCount(kTableId0, t1), IsOkAndHolds(2));
+  EXPECT_THAT(storage_.RowCount(kTableId0, absl::InfiniteFuture()),
+              IsOkAndHolds(3));
+  EXPECT_THAT(storage_.RowCount(kTableId1, t2), IsOkAndHolds(0));
+
+  // A write before the latest timestamp may change the rows at any later
+  // timestamp, so only the latest count is still known.
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(4)}), {kColumnID},
+                           {Int64(4)}));
+  EXPECT_THAT(storage_.RowCount(kTableId0, t1),
+              zetasql_base::testing::StatusIs(
+                  absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(storage_.RowCount(kTableId0, t2), IsOkAndHolds(4));
+
+  // Garbage collection forgets the counts before its horizon.
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId1, Key({Int64(0)}), {kColumnID},
+                           {Int64(0)}));
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId1, Key({Int64(1)}), {kColumnID},
+                           {Int64(1)}));
+  storage_.CollectGarbage(t1 + absl::Milliseconds(1));
+  EXPECT_THAT(storage_.RowCount(kTableId1, t0),
+              zetasql_base::testing::StatusIs(
+                  absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(storage_.RowCount(kTableId1, t1), IsOkAndHolds(2));
+}
+
+TEST_F(InMemoryStorageTest, TruncateDiscardsEveryVersion) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  for (int64_t i = 0; i < 3; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId1, Key({Int64(1)}), {kColumnID},
+                           {Int64(1)}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Storage> clone, storage_.Clone());
+  const int64_t memory_bytes = storage_.memory_bytes();
+
+  ZETASQL_EXPECT_OK(storage_.Truncate(t1, {kTableId0}));
+
+  std::vector<zetasql::Value> values;
+  EXPECT_THAT(
+      storage_.Lookup(t0, kTableId0, Key({Int64(1)}), {kColumnID}, &values),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(StorageRangeStats stats,
+                       storage_.EstimateRange(kTableId0, KeyRange::All()));
+  EXPECT_EQ(stats.row_count, 0);
+  EXPECT_LT(storage_.memory_bytes(), memory_bytes);
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t0, kTableId1, Key({Int64(1)}), {kColumnID}, &values));
+
+  // The table can be written again, and clones keep their rows.
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {Int64(10)}));
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(Int64(10)));
+  ZETASQL_EXPECT_OK(
+      clone->Lookup(t1, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(Int64(1)));
+}
+
+class ClusteredInMemoryStorageTest : public InMemoryStorageTest {
+ protected:
+  // Parent(a), Child(a, b) and Sibling(a, b) interleaved in Parent, and
+  // Grandchild(a, b, c) interleaved in Child.
+  void SetUp() override {
+    storage_.RegisterInterleavedTable(kParent, 1, kChild, 2);
+    storage_.RegisterInterleavedTable(kParent, 1, kSibling, 2);
+    storage_.RegisterInterleavedTable(kChild, 2, kGrandchild, 3);
+    for (int a = 0; a < 3; ++a) {
+      WriteRow(kParent, Key({Int64(a)}));
+      for (int b = 0; b < 3; ++b) {
+        WriteRow(kChild, Key({Int64(a), Int64(b)}));
+        WriteRow(kSibling, Key({Int64(a), Int64(b)}));
+        WriteRow(kGrandchild, Key({Int64(a), Int64(b), Int64(0)}));
+      }
+    }
+  }
+
+  void WriteRow(const TableID& table_id, const Key& key) {
+    ZETASQL_EXPECT_OK(
+        storage_.Write(t0_, table_id, key, {kColumnID},
+                       {String(absl::StrCat(table_id, key.DebugString()))}));
+  }
+
+  // Returns the keys of the rows of table_id in key_range, checking that each
+  // row has the value written by WriteRow.
+  std::vector<Key> ReadKeys(absl::Time timestamp, const TableID& table_id,
+                            const KeyRange& key_range) {
+    std::vector<Key> keys;
+    ZETASQL_EXPECT_OK(
+        storage_.Read(timestamp, table_id, key_range, {kColumnID}, &itr_));
+    while (itr_->Next()) {
+      EXPECT_EQ(itr_->ColumnValue(0),
+                String(absl::StrCat(table_id, itr_->Key().DebugString())));
+      keys.push_back(itr_->Key());
+    }
+    ZETASQL_EXPECT_OK(itr_->Status());
+    return keys;
+  }
+
+  const TableID kParent = "parent:0";
+  const TableID kChild = "child:0";
+  const TableID kSibling = "sibling:0";
+  const TableID kGrandchild = "grandchild:0";
+  const absl::Time t0_ = absl::Now();
+};
+
+TEST_F(ClusteredInMemoryStorageTest, ReadReturnsOnlyRowsOfTable) {
+  EXPECT_THAT(ReadKeys(t0_, kParent, KeyRange::All()),
+              testing::ElementsAre(Key({Int64(0)}), Key({Int64(1)}),
+                                   Key({Int64(2)})));
+  EXPECT_EQ(ReadKeys(t0_, kChild, KeyRange::All()).size(), 9);
+  EXPECT_EQ(ReadKeys(t0_, kSibling, KeyRange::All()).size(), 9);
+  EXPECT_EQ(ReadKeys(t0_, kGrandchild, KeyRange::All()).size(), 9);
+
+  EXPECT_THAT(ReadKeys(t0_, kChild, KeyRange::Prefix(Key({Int64(1)}))),
+              testing::ElementsAre(Key({Int64(1), Int64(0)}),
+                                   Key({Int64(1), Int64(1)}),
+                                   Key({Int64(1), Int64(2)})));
+  EXPECT_THAT(
+      ReadKeys(t0_, kChild,
+               KeyRange::ClosedOpen(Key({Int64(0), Int64(2)}),
+                                    Key({Int64(1), Int64(1)}))),
+      testing::ElementsAre(Key({Int64(0), Int64(2)}),
+                           Key({Int64(1), Int64(0)})));
+  EXPECT_THAT(
+      ReadKeys(t0_, kGrandchild, KeyRange::Prefix(Key({Int64(2), Int64(1)}))),
+      testing::ElementsAre(Key({Int64(2), Int64(1), Int64(0)})));
+  EXPECT_THAT(ReadKeys(t0_, kParent,
+                       KeyRange::ClosedOpen(Key({Int64(1)}), Key({Int64(2)}))),
+              testing::ElementsAre(Key({Int64(1)})));
+}
+
+TEST_F(ClusteredInMemoryStorageTest, LookupFindsOnlyRowsOfTable) {
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(t0_, kChild, Key({Int64(1), Int64(2)}),
+                            {kColumnID}, &values));
+  EXPECT_THAT(values,
+              testing::ElementsAre(String(absl::StrCat(
+                  kChild, Key({Int64(1), Int64(2)}).DebugString()))));
+  ZETASQL_EXPECT_OK(storage_.Lookup(t0_, kParent, Key({Int64(1)}), {kColumnID},
+                            &values));
+  EXPECT_THAT(
+      storage_.Lookup(t0_, kChild, Key({Int64(1)}), {kColumnID}, &values),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(storage_.Lookup(t0_, kGrandchild, Key({Int64(1), Int64(2)}),
+                              {kColumnID}, &values),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(ClusteredInMemoryStorageTest, ExistsFindsOnlyRowsOfTable) {
+  EXPECT_THAT(storage_.Exists(t0_, kChild, Key({Int64(1), Int64(2)})),
+              zetasql_base::testing::IsOkAndHolds(true));
+  EXPECT_THAT(storage_.Exists(t0_, kChild, Key({Int64(1), Int64(3)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+  EXPECT_THAT(storage_.Exists(t0_, kChild, Key({Int64(1)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+  EXPECT_THAT(storage_.Exists(t0_, kGrandchild, Key({Int64(1), Int64(2)})),
+              zetasql_base::testing::IsOkAndHolds(false));
+}
+
+TEST_F(ClusteredInMemoryStorageTest, PrefixDeleteOnlyDeletesRowsOfTable) {
+  absl::Time t1 = t0_ + absl::Seconds(1);
+  ZETASQL_EXPECT_OK(
+      storage_.Delete(t1, kChild, KeyRange::Prefix(Key({Int64(1)}))));
+
+  EXPECT_THAT(ReadKeys(t1, kChild, KeyRange::All()),
+              testing::ElementsAre(
+                  Key({Int64(0), Int64(0)}), Key({Int64(0), Int64(1)}),
+                  Key({Int64(0), Int64(2)}), Key({Int64(2), Int64(0)}),
+                  Key({Int64(2), Int64(1)}), Key({Int64(2), Int64(2)})));
+  EXPECT_EQ(ReadKeys(t1, kParent, KeyRange::All()).size(), 3);
+  EXPECT_EQ(ReadKeys(t1, kSibling, KeyRange::All()).size(), 9);
+  EXPECT_EQ(ReadKeys(t1, kGrandchild, KeyRange::All()).size(), 9);
+  EXPECT_EQ(ReadKeys(t0_, kChild, KeyRange::All()).size(), 9);
+}
+
+TEST_F(ClusteredInMemoryStorageTest, ApplyBatchWritesAndDeletesRowsOfTable) {
+  absl::Time t1 = t0_ + absl::Seconds(1);
+  std::vector<StorageWriteOp> ops(2);
+  ops[0].table_id = kGrandchild;
+  ops[0].key = Key({Int64(0), Int64(0), Int64(0)});
+  ops[0].is_delete = true;
+  ops[1].table_id = kParent;
+  ops[1].key = Key({Int64(3)});
+  ops[1].column_ids = {kColumnID};
+  ops[1].values = {
+      String(absl::StrCat(kParent, Key({Int64(3)}).DebugString()))};
+  ZETASQL_EXPECT_OK(storage_.ApplyBatch(t1, absl::MakeSpan(ops)));
+
+  EXPECT_EQ(ReadKeys(t1, kParent, KeyRange::All()).size(), 4);
+  EXPECT_EQ(ReadKeys(t1, kChild, KeyRange::All()).size(), 9);
+  EXPECT_EQ(ReadKeys(t1, kGrandchild, KeyRange::All()).size(), 8);
+}
+
+TEST_F(ClusteredInMemoryStorageTest,
+       TablesWrittenBeforeRegistrationStaySeparate) {
+  const TableID kLateChild = "late_child:0";
+  WriteRow(kLateChild, Key({Int64(1), Int64(1)}));
+  storage_.RegisterInterleavedTable(kParent, 1, kLateChild, 2);
+  WriteRow(kLateChild, Key({Int64(1), Int64(0)}));
+
+  EXPECT_THAT(ReadKeys(t0_, kLateChild, KeyRange::All()),
+              testing::ElementsAre(Key({Int64(1), Int64(0)}),
+                                   Key({Int64(1), Int64(1)})));
+  EXPECT_EQ(ReadKeys(t0_, kParent, KeyRange::All()).size(), 3);
+}
+
+TEST_F(ClusteredInMemoryStorageTest, EstimatesCountOnlyRowsOfTable) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(StorageRangeStats stats,
+                       storage_.EstimateRange(kParent, KeyRange::All()));
+  EXPECT_EQ(stats.row_count, 3);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      stats, storage_.EstimateRange(kChild, KeyRange::Prefix(Key({Int64(1)}))));
+  EXPECT_EQ(stats.row_count, 3);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      stats, storage_.EstimateRange(kGrandchild, KeyRange::All()));
+  EXPECT_EQ(stats.row_count, 9);
+
+  EXPECT_THAT(storage_.EstimateNthKey(kParent, 1),
+              zetasql_base::testing::IsOkAndHolds(Key({Int64(1)})));
+  EXPECT_THAT(storage_.EstimateNthKey(kSibling, 4),
+              zetasql_base::testing::IsOkAndHolds(Key({Int64(1), Int64(1)})));
+  EXPECT_THAT(storage_.EstimateNthKey(kChild, 9),
+              zetasql_base::testing::IsOkAndHolds(Key::Infinity()));
+}
+
+TEST_F(ClusteredInMemoryStorageTest, CloneKeepsTablesClustered) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Storage> clone, storage_.Clone());
+  ZETASQL_EXPECT_OK(clone->Write(t0_, kChild, Key({Int64(5), Int64(0)}),
+                         {kColumnID}, {String("value")}));
+
+  ZETASQL_EXPECT_OK(clone->Read(t0_, kChild, KeyRange::Prefix(Key({Int64(5)})),
+                        {kColumnID}, &itr_));
+  ASSERT_TRUE(itr_->Next());
+  EXPECT_EQ(itr_->Key(), Key({Int64(5), Int64(0)}));
+  EXPECT_FALSE(itr_->Next());
+  ZETASQL_EXPECT_OK(clone->Read(t0_, kParent, KeyRange::All(), {kColumnID}, &itr_));
+  for (int a = 0; a < 3; ++a) {
+    ASSERT_TRUE(itr_->Next());
+    EXPECT_EQ(itr_->Key(), Key({Int64(a)}));
+  }
+  EXPECT_FALSE(itr_->Next());
+  EXPECT_TRUE(ReadKeys(t0_, kChild, KeyRange::Prefix(Key({Int64(5)}))).empty());
+}
+
+TEST_F(ClusteredInMemoryStorageTest, TruncateKeepsOtherTablesOfHierarchy) {
+  const absl::Time t1 = t0_ + absl::Seconds(1);
+  ZETASQL_EXPECT_OK(storage_.Truncate(t1, {kChild, kGrandchild}));
+
+  EXPECT_TRUE(ReadKeys(t1, kChild, KeyRange::All()).empty());
+  EXPECT_TRUE(ReadKeys(t1, kGrandchild, KeyRange::All()).empty());
+  EXPECT_EQ(ReadKeys(t1, kParent, KeyRange::All()).size(), 3);
+  EXPECT_EQ(ReadKeys(t1, kSibling, KeyRange::All()).size(), 9);
+
+  ZETASQL_EXPECT_OK(storage_.Truncate(t1, {kParent, kChild, kSibling, kGrandchild}));
+  EXPECT_TRUE(ReadKeys(t0_, kParent, KeyRange::All()).empty());
+  EXPECT_TRUE(ReadKeys(t0_, kSibling, KeyRange::All()).empty());
+}
+
+TEST(InternedInMemoryStorageTest, RepeatedStringsShareTheirPayload) {
+  const TableID kTableId = "test_table:0";
+  const ColumnID kColumnID = "test_column:0";
+  auto interner = std::make_shared<ValueInterner>();
+  InMemoryStorage storage(interner);
+  absl::Time t0 = absl::Now();
+
+  ZETASQL_EXPECT_OK(storage.Write(t0, kTableId, Key({Int64(1)}), {kColumnID},
+                          {String("active")}));
+  std::vector<StorageWriteOp> ops(1);
+  ops[0].table_id = kTableId;
+  ops[0].key = Key({Int64(2)});
+  ops[0].column_ids = {kColumnID};
+  ops[0].values = {String("active")};
+  ZETASQL_EXPECT_OK(storage.ApplyBatch(t0, absl::MakeSpan(ops)));
+  EXPECT_EQ(interner->size(), 1);
+
+  std::vector<zetasql::Value> values1;
+  std::vector<zetasql::Value> values2;
+  ZETASQL_EXPECT_OK(
+      storage.Lookup(t0, kTableId, Key({Int64(1)}), {kColumnID}, &values1));
+  ZETASQL_EXPECT_OK(
+      storage.Lookup(t0, kTableId, Key({Int64(2)}), {kColumnID}, &values2));
+  EXPECT_EQ(values1[0], String("active"));
+  EXPECT_EQ(values1[0].string_value().data(), values2[0].string_value().data());
+}
+
+TEST(SampledInMemoryStorageTest, RecordsKeyAccessesByPosition) {
+  const TableID kTableId = "test_table:0";
+  const ColumnID kColumnID = "test_column:0";
+  InMemoryStorage storage(/*interner=*/nullptr, /*memory_quota_bytes=*/0,
+                          /*key_access_sampling_interval=*/1);
+  absl::Time t0 = absl::Now();
+  for (int64_t i = 0; i < 100; ++i) {
+    ZETASQL_EXPECT_OK(storage.Write(t0, kTableId, Key({Int64(i)}), {kColumnID},
+                            {Int64(i)}));
+  }
+  // Lookups of the last rows are counted in the last key bucket.
+  for (int64_t i = 95; i < 100; ++i) {
+    ZETASQL_EXPECT_OK(
+        storage.Lookup(t0, kTableId, Key({Int64(i)}), {}, /*values=*/nullptr));
+  }
+
+  ASSERT_NE(storage.key_access_heatmap(), nullptr);
+  std::map<TableID, std::vector<KeyAccessHeatmap::Interval>> snapshot =
+      storage.key_access_heatmap()->Snapshot();
+  ASSERT_EQ(snapshot.size(), 1);
+  int64_t last_bucket_reads = 0;
+  int64_t reads = 0;
+  int64_t writes = 0;
+  for (const KeyAccessHeatmap::Interval& interval : snapshot[kTableId]) {
+    last_bucket_reads += interval.reads[KeyAccessHeatmap::kNumKeyBuckets - 1];
+    reads += std::accumulate(interval.reads.begin(), interval.reads.end(),
+                             int64_t{0});
+    writes += std::accumulate(interval.writes.begin(), interval.writes.end(),
+                              int64_t{0});
+  }
+  EXPECT_EQ(last_bucket_reads, 5);
+  EXPECT_EQ(reads, 5);
+  EXPECT_EQ(writes, 100);
+}
+
+TEST(SampledInMemoryStorageTest, DoesNotRecordAccessesByDefault) {
+  InMemoryStorage storage;
+  EXPECT_EQ(storage.key_access_heatmap(), nullptr);
+}
+
 }  // namespace
 
 }  // namespace backend
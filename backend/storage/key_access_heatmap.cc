@@ -0,0 +1,68 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/key_access_heatmap.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+void KeyAccessHeatmap::Record(const TableID& table_id, double key_fraction,
+                              AccessType type, absl::Time now) {
+  const int bucket = std::clamp(static_cast<int>(key_fraction * kNumKeyBuckets),
+                                0, kNumKeyBuckets - 1);
+  const absl::Time start =
+      absl::UnixEpoch() + absl::Floor(now - absl::UnixEpoch(), absl::Minutes(1));
+
+  absl::MutexLock lock(&mu_);
+  std::deque<Interval>& intervals = intervals_[table_id];
+  // Accesses recorded with a slightly earlier time than the latest interval,
+  // by a thread which was preempted, are counted in the latest interval.
+  if (intervals.empty() || intervals.back().start < start) {
+    intervals.emplace_back().start = start;
+    if (intervals.size() > kMaxIntervals) {
+      intervals.pop_front();
+    }
+  }
+  Interval& interval = intervals.back();
+  (type == AccessType::kRead ? interval.reads : interval.writes)[bucket] +=
+      sampling_interval_;
+}
+
+std::map<TableID, std::vector<KeyAccessHeatmap::Interval>>
+KeyAccessHeatmap::Snapshot() const {
+  std::map<TableID, std::vector<Interval>> snapshot;
+  absl::MutexLock lock(&mu_);
+  for (const auto& [table_id, intervals] : intervals_) {
+    snapshot[table_id].assign(intervals.begin(), intervals.end());
+  }
+  return snapshot;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
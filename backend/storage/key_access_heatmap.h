@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_KEY_ACCESS_HEATMAP_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_KEY_ACCESS_HEATMAP_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// KeyAccessHeatmap counts the reads and writes of the keys of each table over
+// time, in the style of Key Visualizer, so that hotspots such as monotonically
+// increasing keys show up as a hot band of key ranges.
+//
+// Accesses are bucketed by minute and by the position of the key in the table,
+// as the fraction of the rows of the table which precede it. Only one in every
+// sampling_interval accesses is recorded, as computing the position of a key
+// is far more expensive than the access itself, and each recorded access is
+// counted sampling_interval times. The most recent kMaxIntervals minutes are
+// retained for each table.
+//
+// This class is thread-safe.
+class KeyAccessHeatmap {
+ public:
+  enum class AccessType { kRead, kWrite };
+
+  // The number of equal key ranges which the keys of a table are divided into.
+  static constexpr int kNumKeyBuckets = 20;
+
+  // The number of one minute intervals retained for each table.
+  static constexpr int kMaxIntervals = 60;
+
+  // The estimated accesses to a table during the minute starting at start.
+  // Bucket i counts the keys preceded by between i / kNumKeyBuckets and
+  // (i + 1) / kNumKeyBuckets of the rows of the table.
+  struct Interval {
+    absl::Time start;
+    std::array<int64_t, kNumKeyBuckets> reads = {};
+    std::array<int64_t, kNumKeyBuckets> writes = {};
+  };
+
+  // sampling_interval must be positive.
+  explicit KeyAccessHeatmap(int sampling_interval)
+      : sampling_interval_(sampling_interval) {}
+
+  // Returns true if the current access should be recorded. Called once for
+  // every access.
+  bool ShouldSample() {
+    return num_accesses_.fetch_add(1, std::memory_order_relaxed) %
+               sampling_interval_ ==
+           0;
+  }
+
+  // Records a sampled access to a key of table_id preceded by key_fraction of
+  // the rows of the table.
+  void Record(const TableID& table_id, double key_fraction, AccessType type,
+              absl::Time now = absl::Now()) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the retained intervals of each table which has been accessed,
+  // oldest first.
+  std::map<TableID, std::vector<Interval>> Snapshot() const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  int sampling_interval() const { return sampling_interval_; }
+
+ private:
+  const int sampling_interval_;
+  std::atomic<int64_t> num_accesses_ = 0;
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<TableID, std::deque<Interval>> intervals_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_KEY_ACCESS_HEATMAP_H_
@@ -0,0 +1,106 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/key_access_heatmap.h"
+
+#include <map>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using AccessType = KeyAccessHeatmap::AccessType;
+
+const absl::Time kStart = absl::FromUnixSeconds(1'700'000'040);
+
+TEST(KeyAccessHeatmapTest, SamplesOneInEveryInterval) {
+  KeyAccessHeatmap heatmap(3);
+  int sampled = 0;
+  for (int i = 0; i < 30; ++i) {
+    sampled += heatmap.ShouldSample();
+  }
+  EXPECT_EQ(sampled, 10);
+}
+
+TEST(KeyAccessHeatmapTest, BucketsAccessesByKeyPosition) {
+  KeyAccessHeatmap heatmap(1);
+  heatmap.Record("t1", 0.0, AccessType::kRead, kStart);
+  heatmap.Record("t1", 0.12, AccessType::kRead, kStart);
+  heatmap.Record("t1", 0.99, AccessType::kWrite, kStart);
+  heatmap.Record("t1", 1.0, AccessType::kWrite, kStart);
+  heatmap.Record("t2", 0.5, AccessType::kWrite, kStart);
+
+  std::map<TableID, std::vector<KeyAccessHeatmap::Interval>> snapshot =
+      heatmap.Snapshot();
+  ASSERT_EQ(snapshot.size(), 2);
+  ASSERT_EQ(snapshot["t1"].size(), 1);
+  const KeyAccessHeatmap::Interval& t1 = snapshot["t1"][0];
+  EXPECT_EQ(t1.start, kStart);
+  EXPECT_EQ(t1.reads[0], 1);
+  EXPECT_EQ(t1.reads[2], 1);
+  EXPECT_EQ(t1.writes[KeyAccessHeatmap::kNumKeyBuckets - 1], 2);
+  ASSERT_EQ(snapshot["t2"].size(), 1);
+  EXPECT_EQ(snapshot["t2"][0].writes[10], 1);
+}
+
+TEST(KeyAccessHeatmapTest, ScalesCountsBySamplingInterval) {
+  KeyAccessHeatmap heatmap(100);
+  heatmap.Record("t", 0.5, AccessType::kRead, kStart);
+  EXPECT_EQ(heatmap.Snapshot()["t"][0].reads[10], 100);
+}
+
+TEST(KeyAccessHeatmapTest, StartsAnIntervalEveryMinute) {
+  KeyAccessHeatmap heatmap(1);
+  heatmap.Record("t", 0.5, AccessType::kRead, kStart + absl::Seconds(10));
+  heatmap.Record("t", 0.5, AccessType::kRead, kStart + absl::Seconds(50));
+  heatmap.Record("t", 0.5, AccessType::kRead, kStart + absl::Seconds(70));
+
+  std::vector<KeyAccessHeatmap::Interval> intervals = heatmap.Snapshot()["t"];
+  ASSERT_EQ(intervals.size(), 2);
+  EXPECT_EQ(intervals[0].start, kStart);
+  EXPECT_EQ(intervals[0].reads[10], 2);
+  EXPECT_EQ(intervals[1].start, kStart + absl::Minutes(1));
+  EXPECT_EQ(intervals[1].reads[10], 1);
+}
+
+TEST(KeyAccessHeatmapTest, RetainsTheMostRecentIntervals) {
+  KeyAccessHeatmap heatmap(1);
+  for (int i = 0; i <= KeyAccessHeatmap::kMaxIntervals; ++i) {
+    heatmap.Record("t", 0.5, AccessType::kWrite, kStart + absl::Minutes(i));
+  }
+
+  std::vector<KeyAccessHeatmap::Interval> intervals = heatmap.Snapshot()["t"];
+  ASSERT_EQ(intervals.size(), KeyAccessHeatmap::kMaxIntervals);
+  EXPECT_EQ(intervals.front().start, kStart + absl::Minutes(1));
+  EXPECT_EQ(intervals.back().start,
+            kStart + absl::Minutes(KeyAccessHeatmap::kMaxIntervals));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,65 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/key_filter.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+KeyFilter::KeyFilter(int64_t capacity)
+    : capacity_(std::max(capacity, kMinCapacity)),
+      bits_((capacity_ * kBitsPerKey + 63) / 64) {}
+
+// Probes are derived from the two halves of a single hash of the key (see
+// Kirsch and Mitzenmacher, "Less Hashing, Same Performance").
+void KeyFilter::Add(absl::string_view key) {
+  const uint64_t hash = absl::Hash<absl::string_view>{}(key);
+  const uint64_t delta = (hash >> 32) | 1;
+  const uint64_t num_bits = bits_.size() * 64;
+  uint64_t probe = hash;
+  for (int i = 0; i < kNumProbes; ++i, probe += delta) {
+    const uint64_t bit = probe % num_bits;
+    bits_[bit / 64] |= uint64_t{1} << (bit % 64);
+  }
+  ++num_keys_;
+}
+
+bool KeyFilter::MayContain(absl::string_view key) const {
+  const uint64_t hash = absl::Hash<absl::string_view>{}(key);
+  const uint64_t delta = (hash >> 32) | 1;
+  const uint64_t num_bits = bits_.size() * 64;
+  uint64_t probe = hash;
+  for (int i = 0; i < kNumProbes; ++i, probe += delta) {
+    const uint64_t bit = probe % num_bits;
+    if ((bits_[bit / 64] & (uint64_t{1} << (bit % 64))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,76 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_KEY_FILTER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_KEY_FILTER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// KeyFilter is a bloom filter of encoded keys, used by storage to answer most
+// existence checks for absent keys without probing its ordered rows.
+//
+// MayContain returns true for every key which was added, and for roughly 1% of
+// the keys which were not while no more keys have been added than the filter
+// was sized for. Keys cannot be removed, so once full() the owner is expected
+// to replace the filter with one built from the keys it still stores.
+//
+// This class is not thread-safe.
+class KeyFilter {
+ public:
+  // Creates an empty filter sized for at least capacity keys.
+  explicit KeyFilter(int64_t capacity = 0);
+
+  // Adds key to the filter.
+  void Add(absl::string_view key);
+
+  // Returns false if key was definitely not added to the filter.
+  bool MayContain(absl::string_view key) const;
+
+  // Returns true if more keys have been added than the filter is sized for,
+  // beyond which its false positive rate grows quickly.
+  bool full() const { return num_keys_ > capacity_; }
+
+  // The number of keys which the filter is sized for.
+  int64_t capacity() const { return capacity_; }
+
+ private:
+  // 10 bits per key and 7 probes give a false positive rate of about 1%.
+  static constexpr int64_t kBitsPerKey = 10;
+  static constexpr int kNumProbes = 7;
+
+  // The smallest capacity of a filter, so that small tables do not rebuild
+  // their filter on every few inserts.
+  static constexpr int64_t kMinCapacity = 64;
+
+  int64_t capacity_;
+  int64_t num_keys_ = 0;
+  std::vector<uint64_t> bits_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_KEY_FILTER_H_
@@ -0,0 +1,78 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/key_filter.h"
+
+#include <cstdint>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+TEST(KeyFilterTest, ContainsAddedKeys) {
+  KeyFilter filter(1000);
+  for (int i = 0; i < 1000; ++i) {
+    filter.Add(absl::StrCat("key", i));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(filter.MayContain(absl::StrCat("key", i)));
+  }
+  EXPECT_FALSE(filter.full());
+}
+
+TEST(KeyFilterTest, RejectsMostAbsentKeys) {
+  KeyFilter filter(1000);
+  for (int i = 0; i < 1000; ++i) {
+    filter.Add(absl::StrCat("key", i));
+  }
+  int false_positives = 0;
+  for (int i = 0; i < 10000; ++i) {
+    if (filter.MayContain(absl::StrCat("absent", i))) {
+      ++false_positives;
+    }
+  }
+  EXPECT_LT(false_positives, 300);
+}
+
+TEST(KeyFilterTest, EmptyFilterContainsNothing) {
+  KeyFilter filter;
+  EXPECT_FALSE(filter.MayContain(""));
+  EXPECT_FALSE(filter.MayContain("key"));
+}
+
+TEST(KeyFilterTest, IsFullAfterCapacityKeys) {
+  KeyFilter filter;
+  int64_t added = 0;
+  while (!filter.full()) {
+    filter.Add(absl::StrCat("key", added++));
+  }
+  EXPECT_EQ(added, filter.capacity() + 1);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,154 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/partitioned_scan.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/iterator.h"
+#include "backend/storage/storage.h"
+#include "absl/status/status.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Returns the number of partitions for a table of num_rows rows.
+int64_t NumPartitions(int64_t num_rows, int max_partitions,
+                      int64_t min_rows_per_partition) {
+  return std::clamp<int64_t>(
+      num_rows / std::max<int64_t>(min_rows_per_partition, 1), 1,
+      max_partitions);
+}
+
+// Partitions the table using the statistics maintained by the storage, which
+// finds each split key without reading the rows before it.
+absl::StatusOr<std::vector<KeyRange>> PartitionByStats(
+    const Storage* storage, const TableID& table_id, int64_t num_rows,
+    int max_partitions, int64_t min_rows_per_partition) {
+  const int64_t num_partitions =
+      NumPartitions(num_rows, max_partitions, min_rows_per_partition);
+  std::vector<KeyRange> partitions;
+  partitions.reserve(num_partitions);
+  Key start_key = Key::Empty();
+  for (int64_t i = 1; i < num_partitions; ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        Key split_key,
+        storage->EstimateNthKey(table_id, i * num_rows / num_partitions));
+    // The table may shrink between calls, in which case later split keys do
+    // not follow the earlier ones.
+    if (split_key.IsInfinity() || split_key <= start_key) {
+      break;
+    }
+    partitions.push_back(KeyRange::ClosedOpen(start_key, split_key));
+    start_key = split_key;
+  }
+  partitions.push_back(KeyRange::ClosedOpen(start_key, Key::Infinity()));
+  return partitions;
+}
+
+}  // namespace
+
+int DefaultScanParallelism() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+absl::StatusOr<std::vector<KeyRange>> PartitionTableScan(
+    const Storage* storage, absl::Time timestamp, const TableID& table_id,
+    int max_partitions, int64_t min_rows_per_partition) {
+  if (max_partitions <= 1) {
+    return std::vector<KeyRange>{KeyRange::All()};
+  }
+
+  // Statistics are kept for the latest version of each row, which is close
+  // enough to the rows at timestamp to balance the partitions.
+  absl::StatusOr<StorageRangeStats> stats =
+      storage->EstimateRange(table_id, KeyRange::All());
+  if (stats.ok()) {
+    return PartitionByStats(storage, table_id, stats->row_count,
+                            max_partitions, min_rows_per_partition);
+  }
+  if (!absl::IsUnimplemented(stats.status())) {
+    return stats.status();
+  }
+
+  // Otherwise read only the keys, which is still much cheaper than the
+  // per-row work of the scans being partitioned.
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_RETURN_IF_ERROR(
+      storage->Read(timestamp, table_id, KeyRange::All(), {}, &itr));
+  std::vector<Key> keys;
+  while (itr->Next()) {
+    keys.push_back(itr->Key());
+  }
+  ZETASQL_RETURN_IF_ERROR(itr->Status());
+
+  const int64_t num_rows = keys.size();
+  const int64_t num_partitions =
+      NumPartitions(num_rows, max_partitions, min_rows_per_partition);
+  std::vector<KeyRange> partitions;
+  partitions.reserve(num_partitions);
+  Key start_key = Key::Empty();
+  for (int64_t i = 1; i < num_partitions; ++i) {
+    const Key& split_key = keys[i * num_rows / num_partitions];
+    partitions.push_back(KeyRange::ClosedOpen(start_key, split_key));
+    start_key = split_key;
+  }
+  partitions.push_back(KeyRange::ClosedOpen(start_key, Key::Infinity()));
+  return partitions;
+}
+
+absl::Status ScanPartitionsInParallel(
+    absl::Span<const KeyRange> partitions,
+    const std::function<absl::Status(int, const KeyRange&)>& scan_partition) {
+  std::vector<absl::Status> statuses(partitions.size());
+  std::vector<std::thread> workers;
+  workers.reserve(partitions.size());
+  for (int i = 1; i < partitions.size(); ++i) {
+    workers.emplace_back([&, i]() {
+      statuses[i] = scan_partition(i, partitions[i]);
+    });
+  }
+  if (!partitions.empty()) {
+    statuses[0] = scan_partition(0, partitions[0]);
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  for (const absl::Status& status : statuses) {
+    ZETASQL_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
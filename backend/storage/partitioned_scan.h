@@ -0,0 +1,71 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_PARTITIONED_SCAN_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_PARTITIONED_SCAN_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/storage.h"
+#include "absl/status/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Tables with fewer rows than this per worker are not worth splitting further,
+// as starting a thread costs more than scanning the rows.
+inline constexpr int64_t kMinRowsPerScanPartition = 1024;
+
+// Returns the number of workers used to scan a large table, which is the
+// number of hardware threads.
+int DefaultScanParallelism();
+
+// Splits the rows of table_id which exist at timestamp into at most
+// max_partitions contiguous ClosedOpen key ranges, in key order, with roughly
+// the same number of rows each. Each partition has at least
+// min_rows_per_partition rows, so small tables are returned as a single
+// partition. The partitions together cover KeyRange::All(). Uses the row
+// statistics of the storage where it maintains them (see
+// Storage::EstimateNthKey), and reads the keys of the table otherwise.
+absl::StatusOr<std::vector<KeyRange>> PartitionTableScan(
+    const Storage* storage, absl::Time timestamp, const TableID& table_id,
+    int max_partitions = DefaultScanParallelism(),
+    int64_t min_rows_per_partition = kMinRowsPerScanPartition);
+
+// Calls scan_partition(i, partitions[i]) for every partition, each on its own
+// thread, and waits for all of them to finish. The first partition is scanned
+// on the calling thread. Returns the error of the first partition (in
+// partition order) which failed, so that the reported error does not depend on
+// thread scheduling.
+absl::Status ScanPartitionsInParallel(
+    absl::Span<const KeyRange> partitions,
+    const std::function<absl::Status(int, const KeyRange&)>& scan_partition);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_PARTITIONED_SCAN_H_
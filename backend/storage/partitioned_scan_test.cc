@@ -0,0 +1,129 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/partitioned_scan.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_storage.h"
+#include "backend/storage/iterator.h"
+#include "absl/status/status.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+
+class PartitionedScanTest : public testing::Test {
+ protected:
+  void WriteRows(int64_t num_rows) {
+    for (int64_t i = 0; i < num_rows; ++i) {
+      ZETASQL_ASSERT_OK(storage_.Write(timestamp_, kTableId, Key({Int64(i)}),
+                               {kColumnId}, {Int64(i)}));
+    }
+  }
+
+  const TableID kTableId = "test_table:0";
+  const ColumnID kColumnId = "test_column:0";
+  const absl::Time timestamp_ = absl::Now();
+  InMemoryStorage storage_;
+};
+
+TEST_F(PartitionedScanTest, SmallTableIsASinglePartition) {
+  WriteRows(10);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<KeyRange> partitions,
+      PartitionTableScan(&storage_, timestamp_, kTableId, /*max_partitions=*/4,
+                         /*min_rows_per_partition=*/10));
+  EXPECT_THAT(partitions, testing::ElementsAre(KeyRange::All()));
+}
+
+TEST_F(PartitionedScanTest, PartitionsCoverTableInKeyOrder) {
+  WriteRows(10);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<KeyRange> partitions,
+      PartitionTableScan(&storage_, timestamp_, kTableId, /*max_partitions=*/3,
+                         /*min_rows_per_partition=*/2));
+  EXPECT_THAT(
+      partitions,
+      testing::ElementsAre(
+          KeyRange::ClosedOpen(Key::Empty(), Key({Int64(3)})),
+          KeyRange::ClosedOpen(Key({Int64(3)}), Key({Int64(6)})),
+          KeyRange::ClosedOpen(Key({Int64(6)}), Key::Infinity())));
+}
+
+TEST_F(PartitionedScanTest, ScansEveryPartition) {
+  WriteRows(100);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<KeyRange> partitions,
+      PartitionTableScan(&storage_, timestamp_, kTableId, /*max_partitions=*/4,
+                         /*min_rows_per_partition=*/1));
+  ASSERT_EQ(partitions.size(), 4);
+
+  absl::Mutex mu;
+  int64_t num_rows = 0;
+  ZETASQL_EXPECT_OK(ScanPartitionsInParallel(
+      partitions, [&](int, const KeyRange& key_range) -> absl::Status {
+        std::unique_ptr<StorageIterator> itr;
+        ZETASQL_RETURN_IF_ERROR(storage_.Read(timestamp_, kTableId, key_range,
+                                      {kColumnId}, &itr));
+        int64_t partition_rows = 0;
+        while (itr->Next()) {
+          ++partition_rows;
+        }
+        absl::MutexLock lock(&mu);
+        num_rows += partition_rows;
+        return itr->Status();
+      }));
+  EXPECT_EQ(num_rows, 100);
+}
+
+TEST_F(PartitionedScanTest, ReturnsErrorOfFirstFailedPartition) {
+  std::vector<KeyRange> partitions(3, KeyRange::All());
+  EXPECT_THAT(
+      ScanPartitionsInParallel(
+          partitions,
+          [](int partition, const KeyRange&) -> absl::Status {
+            if (partition == 0) {
+              return absl::OkStatus();
+            }
+            return absl::InternalError(absl::StrCat("partition ", partition));
+          }),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kInternal,
+                                      "partition 1"));
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,172 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_ROW_VERSIONS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_ROW_VERSIONS_H_
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// The versions of a row, as laid out by CompactInMemoryStorage and
+// DiskStorage.
+//
+// Instead of keeping a separate timestamp-ordered map for every cell, each row
+// keeps all its versions in a single contiguous vector sorted by timestamp.
+// Each version only holds the cells written at that timestamp; cells which were
+// not written are inherited from earlier versions. A delete is recorded as a
+// version which hides all earlier cells. This avoids a heap node per cell
+// version and keeps the data for a row close together in memory, at the cost
+// of a short backwards scan over versions on lookup.
+//
+// Cell is the type of a column value of the storage, which must have a
+// column_id member.
+
+// A single version of a row.
+template <typename Cell>
+struct RowVersion {
+  // Timestamp at which this version was written.
+  absl::Time timestamp;
+
+  // True if the row exists as of this version.
+  bool exists = false;
+
+  // True if cells from earlier versions are not visible from this version,
+  // i.e. the row was deleted at this timestamp.
+  bool hides_earlier_cells = false;
+
+  // Cells written at this timestamp, sorted by column id.
+  std::vector<Cell> cells;
+};
+
+// All versions of a row, sorted by timestamp.
+template <typename Cell>
+using VersionedRow = std::vector<RowVersion<Cell>>;
+
+// Returns an iterator past the last version of row visible at timestamp.
+template <typename Cell>
+typename VersionedRow<Cell>::const_iterator VersionsEnd(
+    const VersionedRow<Cell>& row, absl::Time timestamp) {
+  return std::upper_bound(
+      row.begin(), row.end(), timestamp,
+      [](absl::Time timestamp, const RowVersion<Cell>& version) {
+        return timestamp < version.timestamp;
+      });
+}
+
+// Returns the version of row at exactly timestamp, inserting an empty one if
+// required.
+template <typename Cell>
+RowVersion<Cell>& FindOrInsertVersion(VersionedRow<Cell>& row,
+                                      absl::Time timestamp) {
+  // Commit timestamps are monotonic, so the common case is an append.
+  if (!row.empty() && row.back().timestamp == timestamp) {
+    return row.back();
+  }
+  if (row.empty() || row.back().timestamp < timestamp) {
+    row.emplace_back();
+    row.back().timestamp = timestamp;
+    return row.back();
+  }
+  auto itr = row.begin() + (VersionsEnd(row, timestamp) - row.begin());
+  if (itr != row.begin() && std::prev(itr)->timestamp == timestamp) {
+    return *std::prev(itr);
+  }
+  itr = row.emplace(itr);
+  itr->timestamp = timestamp;
+  return *itr;
+}
+
+// Returns true if row exists at timestamp.
+template <typename Cell>
+bool RowExists(const VersionedRow<Cell>& row, absl::Time timestamp) {
+  auto end = VersionsEnd(row, timestamp);
+  if (end == row.begin()) {
+    return false;
+  }
+  return std::prev(end)->exists;
+}
+
+// Returns the position of the cell for column_id in cells, which are sorted by
+// column id, or the position at which it would be inserted.
+template <typename Cells>
+auto CellLowerBound(Cells& cells, const ColumnID& column_id) {
+  return std::lower_bound(cells.begin(), cells.end(), column_id,
+                          [](const auto& cell, const ColumnID& column_id) {
+                            return cell.column_id < column_id;
+                          });
+}
+
+// Returns the cell of row for column_id visible at timestamp, or nullptr if
+// the column is not set.
+template <typename Cell>
+const Cell* FindCellAtTimestamp(const VersionedRow<Cell>& row,
+                                const ColumnID& column_id,
+                                absl::Time timestamp) {
+  // Walk backwards from the latest visible version until we either find the
+  // cell or reach a version which hides all earlier cells.
+  for (auto itr = VersionsEnd(row, timestamp); itr != row.begin();) {
+    --itr;
+    auto cell_itr = CellLowerBound(itr->cells, column_id);
+    if (cell_itr != itr->cells.end() && cell_itr->column_id == column_id) {
+      return &*cell_itr;
+    }
+    if (itr->hides_earlier_cells) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+// Adds cell to version, replacing the cell for the same column if there is one.
+template <typename Cell>
+void SetCell(RowVersion<Cell>& version, Cell cell) {
+  auto cell_itr = CellLowerBound(version.cells, cell.column_id);
+  if (cell_itr != version.cells.end() &&
+      cell_itr->column_id == cell.column_id) {
+    *cell_itr = std::move(cell);
+  } else {
+    version.cells.insert(cell_itr, std::move(cell));
+  }
+}
+
+// Records that row was deleted at timestamp, if it exists then.
+template <typename Cell>
+void DeleteRow(VersionedRow<Cell>& row, absl::Time timestamp) {
+  if (!RowExists(row, timestamp)) {
+    return;
+  }
+  RowVersion<Cell>& version = FindOrInsertVersion(row, timestamp);
+  version.exists = false;
+  version.hides_earlier_cells = true;
+  version.cells.clear();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_ROW_VERSIONS_H_
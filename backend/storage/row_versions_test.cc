@@ -0,0 +1,94 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/row_versions.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+struct TestCell {
+  ColumnID column_id;
+  int value = 0;
+};
+
+using TestRow = VersionedRow<TestCell>;
+
+absl::Time T(int seconds) { return absl::FromUnixSeconds(seconds); }
+
+const ColumnID kColumnA = "A";
+const ColumnID kColumnB = "B";
+
+TEST(RowVersionsTest, InsertsVersionsInTimestampOrder) {
+  TestRow row;
+  FindOrInsertVersion(row, T(3));
+  FindOrInsertVersion(row, T(1));
+  FindOrInsertVersion(row, T(2));
+  FindOrInsertVersion(row, T(3));
+
+  ASSERT_EQ(row.size(), 3);
+  EXPECT_EQ(row[0].timestamp, T(1));
+  EXPECT_EQ(row[1].timestamp, T(2));
+  EXPECT_EQ(row[2].timestamp, T(3));
+  EXPECT_EQ(VersionsEnd(row, T(0)), row.begin());
+  EXPECT_EQ(VersionsEnd(row, T(2)), row.begin() + 2);
+}
+
+TEST(RowVersionsTest, InheritsCellsFromEarlierVersions) {
+  TestRow row;
+  RowVersion<TestCell>& first = FindOrInsertVersion(row, T(1));
+  first.exists = true;
+  SetCell(first, TestCell{kColumnB, 1});
+  SetCell(first, TestCell{kColumnA, 2});
+  RowVersion<TestCell>& second = FindOrInsertVersion(row, T(2));
+  second.exists = true;
+  SetCell(second, TestCell{kColumnA, 3});
+
+  EXPECT_EQ(row[0].cells[0].column_id, kColumnA);
+  EXPECT_EQ(FindCellAtTimestamp(row, kColumnA, T(1))->value, 2);
+  EXPECT_EQ(FindCellAtTimestamp(row, kColumnA, T(2))->value, 3);
+  EXPECT_EQ(FindCellAtTimestamp(row, kColumnB, T(2))->value, 1);
+  EXPECT_EQ(FindCellAtTimestamp(row, kColumnA, T(0)), nullptr);
+}
+
+TEST(RowVersionsTest, DeleteHidesEarlierCells) {
+  TestRow row;
+  RowVersion<TestCell>& version = FindOrInsertVersion(row, T(1));
+  version.exists = true;
+  SetCell(version, TestCell{kColumnA, 1});
+  DeleteRow(row, T(2));
+
+  EXPECT_TRUE(RowExists(row, T(1)));
+  EXPECT_FALSE(RowExists(row, T(2)));
+  EXPECT_EQ(FindCellAtTimestamp(row, kColumnA, T(2)), nullptr);
+
+  // Deleting a row which does not exist adds no version.
+  DeleteRow(row, T(3));
+  EXPECT_EQ(row.size(), 2);
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
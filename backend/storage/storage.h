@@ -17,13 +17,26 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_STORAGE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_STORAGE_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "zetasql/public/value.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status_macros.h"
 #include "backend/common/ids.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_iterator.h"
 #include "backend/storage/iterator.h"
+#include "backend/storage/key_access_heatmap.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -31,11 +44,51 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+// A single write or delete of one key, applied as part of Storage::ApplyBatch.
+struct StorageWriteOp {
+  TableID table_id;
+  Key key;
+
+  // If true, the key is deleted and column_ids and values are ignored.
+  bool is_delete = false;
+
+  // Column values to write, in the same order as column_ids.
+  std::vector<ColumnID> column_ids;
+  std::vector<zetasql::Value> values;
+};
+
+// The number and total size of the rows of a table in a key range, as returned
+// by Storage::EstimateRange.
+struct StorageRangeStats {
+  int64_t row_count = 0;
+
+  // The logical size of the keys of the rows plus the size of their column
+  // values, in bytes.
+  int64_t size_bytes = 0;
+};
+
+// The estimated memory used by the rows of a table, as returned by
+// Storage::GetMemoryUsage.
+struct StorageMemoryUsage {
+  // The size of the keys of the rows, including rows which are deleted but not
+  // yet garbage collected.
+  int64_t key_bytes = 0;
+
+  // The size of every version of every column value, including the existence
+  // of the rows.
+  int64_t cell_bytes = 0;
+
+  // The number of versions of column values.
+  int64_t num_versions = 0;
+
+  int64_t total_bytes() const { return key_bytes + cell_bytes; }
+};
+
 // Storage defines the interface for a multi-version data store.
 //
-// There will be a Storage instance for each database created. The current
-// interface is grow-only, i.e. once data is added, it will not be deleted.
-// Storage is thread-safe.
+// There will be a Storage instance for each database created. Once data is
+// added, it is not deleted, except by CollectGarbage which may discard versions
+// that are no longer readable. Storage is thread-safe.
 class Storage {
  public:
   virtual ~Storage() {}
@@ -50,6 +103,69 @@ class Storage {
                               const std::vector<ColumnID>& column_ids,
                               std::vector<zetasql::Value>* values) const = 0;
 
+  // Receives the index in column_ids and the value of each column of a row
+  // found by VisitLookup. The value is only valid during the call.
+  using ColumnValueVisitor =
+      absl::FunctionRef<void(int column_index, const zetasql::Value& value)>;
+
+  // Like Lookup, but calls visitor with each column value in order of
+  // column_ids instead of copying them into a vector. Storage which keeps its
+  // values in memory passes views of them, so callers copy only the values they
+  // keep. Visitor must not call back into the storage.
+  virtual absl::Status VisitLookup(absl::Time timestamp,
+                                   const TableID& table_id, const Key& key,
+                                   const std::vector<ColumnID>& column_ids,
+                                   ColumnValueVisitor visitor) const {
+    std::vector<zetasql::Value> values;
+    ZETASQL_RETURN_IF_ERROR(
+        Lookup(timestamp, table_id, key, column_ids, &values));
+    for (int i = 0; i < values.size(); ++i) {
+      visitor(i, values[i]);
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns true if the given key exists at the specified timestamp. This is
+  // equivalent to a Lookup of no columns, but storage which can rule out most
+  // absent keys cheaply answers without building a NOT_FOUND status.
+  virtual absl::StatusOr<bool> Exists(absl::Time timestamp,
+                                      const TableID& table_id,
+                                      const Key& key) const {
+    absl::Status status = Lookup(timestamp, table_id, key, {}, nullptr);
+    if (absl::IsNotFound(status)) {
+      return false;
+    }
+    if (!status.ok()) {
+      return status;
+    }
+    return true;
+  }
+
+  // Appends the key and column values of each of the given keys which exists at
+  // the specified timestamp to rows, in the same order as sorted_keys. Keys
+  // which do not exist are skipped. Column values are returned as by Lookup.
+  // This is equivalent to a Lookup of each key, but storage which is ordered by
+  // key answers all of them in one pass over the table.
+  virtual absl::Status MultiLookup(
+      absl::Time timestamp, const TableID& table_id,
+      absl::Span<const Key> sorted_keys,
+      const std::vector<ColumnID>& column_ids,
+      std::vector<std::pair<Key, std::vector<zetasql::Value>>>* rows) const {
+    for (const Key& key : sorted_keys) {
+      std::vector<zetasql::Value> values;
+      absl::Status status =
+          Lookup(timestamp, table_id, key, column_ids, &values);
+      if (absl::IsNotFound(status)) {
+        continue;
+      }
+      if (!status.ok()) {
+        return status;
+      }
+      rows->emplace_back(key, std::move(values));
+    }
+    return absl::OkStatus();
+  }
+
   // Returns zero or more rows for given key range. Keys are returned in
   // sorted order. See comments on StorageIterator for more details. KeyRange
   // interval should be in KeyRange::ClosedOpen format. Non ClosedOpen ranges
@@ -59,6 +175,33 @@ class Storage {
                             const std::vector<ColumnID>& column_ids,
                             std::unique_ptr<StorageIterator>* itr) const = 0;
 
+  // Like Read, but keys are returned in reverse sorted order, so that reads
+  // which stop after the last few rows of a range, such as those of queries
+  // ordered by descending key with a LIMIT, need not visit the rest of it.
+  // Storage which can walk its rows backwards should override this; by
+  // default the whole range is read forward and buffered.
+  virtual absl::Status ReadReverse(
+      absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
+      const std::vector<ColumnID>& column_ids,
+      std::unique_ptr<StorageIterator>* itr) const {
+    std::unique_ptr<StorageIterator> forward;
+    ZETASQL_RETURN_IF_ERROR(
+        Read(timestamp, table_id, key_range, column_ids, &forward));
+    std::vector<FixedRowStorageIterator::Row> rows;
+    while (forward->Next()) {
+      std::vector<zetasql::Value> values;
+      values.reserve(forward->NumColumns());
+      for (int i = 0; i < forward->NumColumns(); ++i) {
+        values.push_back(forward->ColumnValue(i));
+      }
+      rows.emplace_back(forward->Key(), std::move(values));
+    }
+    ZETASQL_RETURN_IF_ERROR(forward->Status());
+    std::reverse(rows.begin(), rows.end());
+    *itr = std::make_unique<FixedRowStorageIterator>(std::move(rows));
+    return absl::OkStatus();
+  }
+
   // Writes column values for given key at the specified timestamp. Column value
   // will be overwritten for non-unique <timestamp, table_id, key, column_id>
   // combination.
@@ -67,12 +210,132 @@ class Storage {
                              const std::vector<ColumnID>& column_ids,
                              const std::vector<zetasql::Value>& values) = 0;
 
+  // Like Write, but takes ownership of values, which storage that keeps the
+  // values it writes stores without copying them.
+  virtual absl::Status Write(absl::Time timestamp, const TableID& table_id,
+                             const Key& key,
+                             const std::vector<ColumnID>& column_ids,
+                             std::vector<zetasql::Value>&& values) {
+    const std::vector<zetasql::Value>& borrowed_values = values;
+    return Write(timestamp, table_id, key, column_ids, borrowed_values);
+  }
+
   // Marks the given key range as deleted at the specified timestamp. Column
   // values at older timestamps are still accessible via Read and Lookup.
   // KeyRange interval should be in KeyRange::ClosedOpen format. Non ClosedOpen
   // ranges will result in INVALID_ARGUMENT.
   virtual absl::Status Delete(absl::Time timestamp, const TableID& table_id,
                               const KeyRange& key_range) = 0;
+
+  // Applies the given ops at the specified timestamp, in order. Each op has the
+  // same effect as the corresponding call to Write, or to Delete with a point
+  // key range. Implementations may move keys and values out of ops.
+  virtual absl::Status ApplyBatch(absl::Time timestamp,
+                                  absl::Span<StorageWriteOp> ops) {
+    for (const StorageWriteOp& op : ops) {
+      absl::Status status =
+          op.is_delete ? Delete(timestamp, op.table_id, KeyRange::Point(op.key))
+                       : Write(timestamp, op.table_id, op.key, op.column_ids,
+                               op.values);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Discards versions which are not visible at or after version_horizon, i.e.
+  // every version older than the latest version at or before version_horizon.
+  // Lookup and Read at timestamps earlier than version_horizon may return
+  // incomplete results after this call. Returns an estimate of the number of
+  // bytes reclaimed. Implementations which do not support garbage collection
+  // retain all versions.
+  virtual int64_t CollectGarbage(absl::Time version_horizon) { return 0; }
+
+  // Keeps versions which are not visible at or after cold_horizon in a more
+  // compact form, which may be slower to read. Reads return the same results
+  // as before. Returns an estimate of the number of bytes saved.
+  // Implementations which do not support compression keep versions as they
+  // are.
+  virtual int64_t CompressVersions(absl::Time cold_horizon) { return 0; }
+
+  // Informs the storage that the rows of child_table_id are interleaved in
+  // those of parent_table_id, whose primary keys have child_key_size and
+  // parent_key_size columns respectively. Parents must be registered before
+  // their children. Implementations may use this to store an interleave
+  // hierarchy in a single keyspace, and may ignore tables which have already
+  // been written to. It has no effect on the results of any other method.
+  virtual void RegisterInterleavedTable(const TableID& parent_table_id,
+                                        int parent_key_size,
+                                        const TableID& child_table_id,
+                                        int child_key_size) {}
+
+  // Returns a copy of this storage with all versions written so far. Later
+  // writes to either storage are not visible in the other. Writes which are
+  // concurrent with Clone may or may not be included in the copy.
+  virtual absl::StatusOr<std::unique_ptr<Storage>> Clone() const {
+    return absl::UnimplementedError("Storage does not support cloning.");
+  }
+
+  // Discards every version of the rows of the given tables, so that reads at
+  // any timestamp find them empty. Storage which cannot discard versions
+  // deletes all rows of the tables at timestamp instead, which only hides them
+  // from reads at or after timestamp.
+  virtual absl::Status Truncate(absl::Time timestamp,
+                                absl::Span<const TableID> table_ids) {
+    for (const TableID& table_id : table_ids) {
+      absl::Status status = Delete(timestamp, table_id, KeyRange::All());
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the number and total size of the rows of table_id in the given
+  // ClosedOpen key range, as of the latest version of each row. Storage which
+  // maintains statistics answers without reading the range, so the result may
+  // differ from a read at an earlier timestamp. Returns UNIMPLEMENTED if the
+  // storage does not maintain statistics, in which case callers should read
+  // the range instead.
+  virtual absl::StatusOr<StorageRangeStats> EstimateRange(
+      const TableID& table_id, const KeyRange& key_range) const {
+    return absl::UnimplementedError("Storage does not maintain statistics.");
+  }
+
+  // Returns the key of the row of table_id which is preceded by n other rows in
+  // key order, as of the latest version of each row, or Key::Infinity() if the
+  // table has at most n rows. Returns UNIMPLEMENTED if the storage does not
+  // maintain statistics.
+  virtual absl::StatusOr<Key> EstimateNthKey(const TableID& table_id,
+                                             int64_t n) const {
+    return absl::UnimplementedError("Storage does not maintain statistics.");
+  }
+
+  // Returns the number of rows of table_id which exist at timestamp, without
+  // reading them. Returns UNIMPLEMENTED if the storage does not maintain row
+  // counts, and FAILED_PRECONDITION if it does not know the count at
+  // timestamp, in which case callers should read the table instead.
+  virtual absl::StatusOr<int64_t> RowCount(const TableID& table_id,
+                                           absl::Time timestamp) const {
+    return absl::UnimplementedError("Storage does not maintain row counts.");
+  }
+
+  // Returns the estimated memory used by the rows of each table which has been
+  // written to. Storage which does not track its memory use returns no tables.
+  virtual std::map<TableID, StorageMemoryUsage> GetMemoryUsage() const {
+    return {};
+  }
+
+  // Returns RESOURCE_EXHAUSTED if the storage uses more memory than its quota,
+  // in which case callers should reject further writes. Writes themselves never
+  // fail because of the quota, so that a batch is applied either entirely or
+  // not at all.
+  virtual absl::Status CheckMemoryQuota() const { return absl::OkStatus(); }
+
+  // Returns the heatmap of the keys accessed in this storage, or nullptr if the
+  // storage does not sample its accesses.
+  virtual const KeyAccessHeatmap* key_access_heatmap() const { return nullptr; }
 };
 
 }  // namespace backend
@@ -0,0 +1,85 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/value_interner.h"
+
+#include <cstdint>
+
+#include "zetasql/public/type.pb.h"
+#include "zetasql/public/value.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+bool ValueInterner::ShouldIntern(const zetasql::Value& value) const {
+  if (!value.is_valid() || value.is_null()) {
+    return false;
+  }
+  switch (value.type_kind()) {
+    case zetasql::TYPE_STRING:
+      return static_cast<int64_t>(value.string_value().size()) <=
+             max_value_bytes_;
+    case zetasql::TYPE_BYTES:
+      return static_cast<int64_t>(value.bytes_value().size()) <=
+             max_value_bytes_;
+    default:
+      return false;
+  }
+}
+
+zetasql::Value ValueInterner::Intern(const zetasql::Value& value) {
+  if (!ShouldIntern(value)) {
+    return value;
+  }
+  // Most values of low cardinality columns have been seen before, so look the
+  // value up under a shared lock first.
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    auto itr = values_.find(value);
+    if (itr != values_.end()) {
+      return *itr;
+    }
+    if (static_cast<int64_t>(values_.size()) >= max_values_) {
+      return value;
+    }
+  }
+  absl::MutexLock lock(&mu_);
+  if (static_cast<int64_t>(values_.size()) >= max_values_) {
+    auto itr = values_.find(value);
+    return itr != values_.end() ? *itr : value;
+  }
+  return *values_.insert(value).first;
+}
+
+void ValueInterner::InternAll(absl::Span<zetasql::Value> values) {
+  for (zetasql::Value& value : values) {
+    value = Intern(value);
+  }
+}
+
+int64_t ValueInterner::size() const {
+  absl::ReaderMutexLock lock(&mu_);
+  return values_.size();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
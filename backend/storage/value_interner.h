@@ -0,0 +1,79 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_VALUE_INTERNER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_VALUE_INTERNER_H_
+
+#include <cstdint>
+
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// ValueInterner deduplicates the payloads of STRING and BYTES values written
+// to storage, so that columns with few distinct values, such as enum-like
+// status columns, keep a single copy of each of them.
+//
+// Copies of a zetasql::Value share its reference counted payload, so interning
+// returns a copy of the first value equal to the given one which was interned.
+// Values longer than max_value_bytes are not interned, as long values are
+// rarely repeated. Interned values are never released, so once max_values
+// distinct values have been interned new values are returned unchanged.
+//
+// This class is thread-safe.
+class ValueInterner {
+ public:
+  static constexpr int64_t kDefaultMaxValueBytes = 256;
+  static constexpr int64_t kDefaultMaxValues = 1 << 20;
+
+  explicit ValueInterner(int64_t max_value_bytes = kDefaultMaxValueBytes,
+                         int64_t max_values = kDefaultMaxValues)
+      : max_value_bytes_(max_value_bytes), max_values_(max_values) {}
+
+  // Returns a value equal to value which shares its payload with the values
+  // equal to it interned before, if any.
+  zetasql::Value Intern(const zetasql::Value& value) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Replaces each of values with its interned value.
+  void InternAll(absl::Span<zetasql::Value> values) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The number of distinct values interned.
+  int64_t size() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Returns true if value is a STRING or BYTES value eligible for interning.
+  bool ShouldIntern(const zetasql::Value& value) const;
+
+  const int64_t max_value_bytes_;
+  const int64_t max_values_;
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_set<zetasql::Value> values_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_VALUE_INTERNER_H_
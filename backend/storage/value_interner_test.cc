@@ -0,0 +1,86 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/storage/value_interner.h"
+
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Bytes;
+using zetasql::values::Int64;
+using zetasql::values::NullString;
+using zetasql::values::String;
+
+TEST(ValueInternerTest, EqualStringsShareTheirPayload) {
+  ValueInterner interner;
+  zetasql::Value first = interner.Intern(String("active"));
+  zetasql::Value second = interner.Intern(String(std::string("active")));
+
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(first.string_value().data(), second.string_value().data());
+  EXPECT_EQ(interner.size(), 1);
+}
+
+TEST(ValueInternerTest, StringsAndBytesAreInternedSeparately) {
+  ValueInterner interner;
+  zetasql::Value string = interner.Intern(String("a"));
+  zetasql::Value bytes = interner.Intern(Bytes("a"));
+
+  EXPECT_EQ(string, String("a"));
+  EXPECT_EQ(bytes, Bytes("a"));
+  EXPECT_EQ(interner.size(), 2);
+}
+
+TEST(ValueInternerTest, SkipsOtherValues) {
+  ValueInterner interner(/*max_value_bytes=*/4);
+  std::vector<zetasql::Value> values = {Int64(1), NullString(),
+                                          String("long value"),
+                                          zetasql::Value()};
+  interner.InternAll(absl::MakeSpan(values));
+
+  EXPECT_THAT(values, testing::ElementsAre(Int64(1), NullString(),
+                                           String("long value"),
+                                           zetasql::Value()));
+  EXPECT_EQ(interner.size(), 0);
+}
+
+TEST(ValueInternerTest, StopsInterningNewValuesWhenFull) {
+  ValueInterner interner(/*max_value_bytes=*/16, /*max_values=*/1);
+  zetasql::Value first = interner.Intern(String("a"));
+  EXPECT_EQ(interner.Intern(String("b")), String("b"));
+  EXPECT_EQ(interner.size(), 1);
+
+  // Values interned before the interner filled up are still shared.
+  EXPECT_EQ(interner.Intern(String(std::string("a"))).string_value().data(),
+            first.string_value().data());
+}
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -18,7 +18,9 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "zetasql/public/json_value.h"
@@ -53,14 +55,7 @@ namespace backend {
 using JSON = ::nlohmann::json;
 absl::StatusOr<bool> TransactionReadOnlyStore::Exists(const Table* table,
                                                       const Key& key) const {
-  absl::StatusOr<ValueList> maybe_row =
-      read_only_store_->Lookup(table, key, {});
-  if (maybe_row.status().code() == absl::StatusCode::kNotFound) {
-    return false;
-  } else if (!maybe_row.ok()) {
-    return maybe_row.status();
-  }
-  return true;
+  return read_only_store_->Exists(table, key);
 }
 
 absl::StatusOr<bool> TransactionReadOnlyStore::PrefixExists(
@@ -110,17 +105,16 @@ std::string ToFragmentIdString(int64_t record_sequence) {
 DataChangeRecord ChangeStreamTransactionEffectsBuffer::BuildDataChangeRecord(
     std::string tracked_table_name, std::string value_capture_type,
     const ChangeStream* change_stream) {
-  std::vector<ColumnType> column_types =
-      last_mod_group_by_change_stream_[change_stream].column_types;
+  ModGroup& mod_group = last_mod_group_by_change_stream_[change_stream];
   std::string record_sequence = ToFragmentIdString(
       record_sequence_by_change_stream_[change_stream->Name()]);
   DataChangeRecord record{
-      last_mod_group_by_change_stream_[change_stream].partition_token_str,
+      mod_group.partition_token_str,
       zetasql::Value::Timestamp(kCommitTimestampValueSentinel),
       std::to_string(transaction_id_), record_sequence, false,
-      tracked_table_name, column_types,
-      last_mod_group_by_change_stream_[change_stream].mods,
-      last_mod_group_by_change_stream_[change_stream].mod_type,
+      tracked_table_name, std::move(mod_group.column_types),
+      std::move(mod_group.mods),
+      mod_group.mod_type,
       value_capture_type,
       -1,  // number_of_records_in_transaction will be reset after processing
            // all mods in one transaction
@@ -170,22 +164,25 @@ ChangeStreamTransactionEffectsBuffer::ConvertDataChangeRecordToWriteOp(
       record.is_last_record_in_transaction_in_partition));
   values.push_back(zetasql::Value::String(record.tracked_table_name));
 
+  // The column types and mods are built as JSON values directly, rather than
+  // serialized and then parsed again.
   std::vector<zetasql::JSONValue> column_types;
   for (const ColumnType& column_type : record.column_types) {
-    JSON column_type_json;
-    column_type_json["name"] = column_type.name;
+    zetasql::JSONValueRef column_type_json =
+        column_types.emplace_back().GetRef();
+    column_type_json.SetToEmptyObject();
+    column_type_json.GetMember("name").SetString(column_type.name);
     JSON type_json;
     type_json["code"] = column_type.type;
-    column_type_json["type"] = type_json.dump();
-    column_type_json["is_primary_key"] = column_type.is_primary_key;
-    column_type_json["ordinal_position"] = column_type.ordinal_position;
-    column_types.push_back(
-        zetasql::JSONValue::ParseJSONString(column_type_json.dump()).value());
+    column_type_json.GetMember("type").SetString(type_json.dump());
+    column_type_json.GetMember("is_primary_key")
+        .SetBoolean(column_type.is_primary_key);
+    column_type_json.GetMember("ordinal_position")
+        .SetInt64(column_type.ordinal_position);
   }
   values.push_back(zetasql::values::JsonArray(column_types));
   std::vector<zetasql::JSONValue> mods;
   for (const Mod& mod : record.mods) {
-    JSON mod_json;
     JSON keys_json;
     for (int i = 0; i < mod.key_columns.size(); ++i) {
       keys_json[mod.key_columns[i]->column()->Name()] =
@@ -200,16 +197,17 @@ ChangeStreamTransactionEffectsBuffer::ConvertDataChangeRecordToWriteOp(
               ? mod.new_values[i].string_value()
               : mod.new_values[i].GetSQLLiteral();
     }
-    mod_json["keys"] = keys_json.dump();
-    mod_json["new_values"] = new_values_json.dump();
+    zetasql::JSONValueRef mod_json = mods.emplace_back().GetRef();
+    mod_json.SetToEmptyObject();
+    mod_json.GetMember("keys").SetString(keys_json.dump());
     if (mod.new_values.empty()) {
-      mod_json["new_values"] = kMinimumValidJson;
+      mod_json.GetMember("new_values").SetString(kMinimumValidJson);
+    } else {
+      mod_json.GetMember("new_values").SetString(new_values_json.dump());
     }
     // OLD_AND_NEW_VALUES is not supported yet so field old_value is always an
     // empty "{}"
-    mod_json["old_values"] = kMinimumValidJson;
-    mods.push_back(
-        zetasql::JSONValue::ParseJSONString(mod_json.dump()).value());
+    mod_json.GetMember("old_values").SetString(kMinimumValidJson);
   }
   values.push_back(zetasql::values::JsonArray(mods));
   values.push_back(zetasql::Value::String(record.mod_type));
@@ -247,9 +245,10 @@ int64_t GetOrdinalPosition(const Table* table, const Column* column) {
 }
 
 // TODO: Remove the statement to exclude key columns from op_columns
-bool CheckIfNonKeyColumnsRemainSame(std::vector<const Column*> op_columns,
-                                    ModGroup last_mod_group, const Table* table,
-                                    const ChangeStream* change_stream) {
+bool CheckIfNonKeyColumnsRemainSame(
+    const std::vector<const Column*>& op_columns,
+    const ModGroup& last_mod_group, const Table* table,
+    const ChangeStream* change_stream) {
   std::vector<const Column*> op_non_key_columns_tracked_by_change_stream;
   absl::flat_hash_set<std::string> op_key_cols;
   for (const KeyColumn* pk : table->primary_key()) {
@@ -277,26 +276,30 @@ bool CheckIfNonKeyColumnsRemainSame(std::vector<const Column*> op_columns,
 
 // Accumulate tracked column types and values for same DataChangeRecord
 void ChangeStreamTransactionEffectsBuffer::LogTableMod(
-    const Key& key, std::vector<const Column*> columns,
+    const Key& key, const std::vector<const Column*>& columns,
     const std::vector<zetasql::Value>& values, const Table* tracked_table,
     const ChangeStream* change_stream, std::string mod_type,
     zetasql::Value partition_token_str) {
-  if (last_mod_group_by_change_stream_.contains(change_stream)) {
-    ModGroup last_mod_group = last_mod_group_by_change_stream_[change_stream];
+  // Consecutive mods of the same shape are appended to the last mod group of
+  // the change stream in place; the group is only turned into a record when a
+  // mod of a different shape arrives, or at commit.
+  auto last_mod_group_it = last_mod_group_by_change_stream_.find(change_stream);
+  if (last_mod_group_it != last_mod_group_by_change_stream_.end()) {
+    const ModGroup& last_mod_group = last_mod_group_it->second;
     bool same_non_pk_columns = CheckIfNonKeyColumnsRemainSame(
         columns, last_mod_group, tracked_table, change_stream);
     if (last_mod_group.mod_type != mod_type ||
         last_mod_group.table_name != tracked_table->Name() ||
         !same_non_pk_columns) {
       DataChangeRecord record = BuildDataChangeRecord(
-          last_mod_group.table_name,
+          std::string(last_mod_group.table_name),
           change_stream->value_capture_type().has_value()
               ? change_stream->value_capture_type().value()
               : std::string(kChangeStreamValueCaptureTypeDefault),
           change_stream);
       last_mod_group_by_change_stream_.erase(change_stream);
       data_change_records_in_transaction_by_change_stream_[change_stream]
-          .push_back(record);
+          .push_back(std::move(record));
     }
   }
 
@@ -323,28 +326,25 @@ void ChangeStreamTransactionEffectsBuffer::LogTableMod(
   }
 
   if (!new_values_for_tracked_cols.empty() || mod_type != kUpdate) {
-    if (!last_mod_group_by_change_stream_.contains(change_stream)) {
-      last_mod_group_by_change_stream_[change_stream] =
-          ModGroup{.table_name = tracked_table->Name(),
-                   .mod_type = mod_type,
-                   .non_key_column_names = {},
-                   .column_types = {},
-                   .mods = {},
-                   .partition_token_str = partition_token_str};
+    auto [it, inserted] = last_mod_group_by_change_stream_.try_emplace(
+        change_stream, ModGroup{.table_name = tracked_table->Name(),
+                                .mod_type = mod_type,
+                                .non_key_column_names = {},
+                                .column_types = {},
+                                .mods = {},
+                                .partition_token_str = partition_token_str});
+    ModGroup& mod_group = it->second;
+    if (inserted) {
+      mod_group.non_key_column_names = {non_key_cols.begin(),
+                                        non_key_cols.end()};
     }
-    last_mod_group_by_change_stream_[change_stream].table_name =
-        tracked_table->Name();
-    last_mod_group_by_change_stream_[change_stream].mod_type = mod_type;
-    last_mod_group_by_change_stream_[change_stream].non_key_column_names = {
-        non_key_cols.begin(), non_key_cols.end()};
-    last_mod_group_by_change_stream_[change_stream].column_types = {
-        column_types.begin(), column_types.end()};
-    Mod mod{tracked_table->primary_key(),
-            non_key_cols,
-            key.column_values(),
-            new_values_for_tracked_cols,
-            {}};
-    last_mod_group_by_change_stream_[change_stream].mods.push_back(mod);
+    mod_group.column_types = std::move(column_types);
+    mod_group.mods.push_back(Mod{
+        tracked_table->primary_key(),
+        std::move(non_key_cols),
+        {key.column_values().begin(), key.column_values().end()},
+        std::move(new_values_for_tracked_cols),
+        {}});
   }
 }
 
@@ -382,6 +382,25 @@ void ChangeStreamTransactionEffectsBuffer::BuildMutation() {
   // DataChangeRecord. Build them into DataChangeRecords before setting
   // is_last_record_in_transaction_in_partition and
   // number_of_records_in_transaction.
+  EndStatement();
+  writeops_.clear();
+  for (auto& [change_stream, records] :
+       data_change_records_in_transaction_by_change_stream_) {
+    int64_t number_of_records_in_transaction = records.size();
+    records[number_of_records_in_transaction - 1]
+        .is_last_record_in_transaction_in_partition = true;
+    for (DataChangeRecord& record : records) {
+      record.number_of_records_in_transaction =
+          number_of_records_in_transaction;
+      writeops_.push_back(
+          ConvertDataChangeRecordToWriteOp(change_stream, std::move(record))
+              .value());
+    }
+  }
+  data_change_records_in_transaction_by_change_stream_.clear();
+}
+
+void ChangeStreamTransactionEffectsBuffer::EndStatement() {
   for (auto& [change_stream, mod_group] : last_mod_group_by_change_stream_) {
     DataChangeRecord record = BuildDataChangeRecord(
         mod_group.table_name,
@@ -389,34 +408,39 @@ void ChangeStreamTransactionEffectsBuffer::BuildMutation() {
             ? change_stream->value_capture_type().value()
             : std::string(kChangeStreamValueCaptureTypeDefault),
         change_stream);
-    if (!data_change_records_in_transaction_by_change_stream_.contains(
-            change_stream)) {
-      data_change_records_in_transaction_by_change_stream_[change_stream] =
-          std::vector<DataChangeRecord>();
-    }
     data_change_records_in_transaction_by_change_stream_[change_stream]
-        .push_back(record);
+        .push_back(std::move(record));
   }
   last_mod_group_by_change_stream_.clear();
-  for (auto& [change_stream, records] :
-       data_change_records_in_transaction_by_change_stream_) {
-    int64_t number_of_records_in_transaction = records.size();
-    data_change_records_in_transaction_by_change_stream_
-        [change_stream][number_of_records_in_transaction - 1]
-            .is_last_record_in_transaction_in_partition = true;
-    for (DataChangeRecord record : records) {
-      record.number_of_records_in_transaction =
-          number_of_records_in_transaction;
-      writeops_.push_back(
-          ConvertDataChangeRecordToWriteOp(change_stream, record).value());
-    }
-  }
+}
+
+void ChangeStreamTransactionEffectsBuffer::Reset() {
+  writeops_.clear();
+  data_change_records_in_transaction_by_change_stream_.clear();
+  record_sequence_by_change_stream_.clear();
+  last_mod_group_by_change_stream_.clear();
+  partition_token_by_change_stream_.clear();
 }
 
 std::vector<WriteOp> ChangeStreamTransactionEffectsBuffer::GetWriteOps() {
   return writeops_;
 }
 
+std::optional<zetasql::Value>
+ChangeStreamTransactionEffectsBuffer::GetPartitionToken(
+    const ChangeStream* change_stream) const {
+  auto it = partition_token_by_change_stream_.find(change_stream);
+  if (it == partition_token_by_change_stream_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void ChangeStreamTransactionEffectsBuffer::SetPartitionToken(
+    const ChangeStream* change_stream, const zetasql::Value& partition_token) {
+  partition_token_by_change_stream_[change_stream] = partition_token;
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
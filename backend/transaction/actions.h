@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <vector>
 
@@ -161,15 +162,34 @@ class ChangeStreamTransactionEffectsBuffer : public ChangeStreamEffectsBuffer {
   void Delete(zetasql::Value partition_token_str,
               const ChangeStream* change_stream, const DeleteOp& op) override;
 
+  // Builds the write ops of all the records of the transaction. Called once,
+  // at commit.
   void BuildMutation() override;
 
   std::vector<WriteOp> GetWriteOps() override;
 
+  void EndStatement() override;
+
+  void Reset() override;
+
+  // Sets the ID of the transaction written to the records, for a buffer
+  // reused by a new transaction.
+  void set_transaction_id(TransactionID transaction_id) {
+    transaction_id_ = transaction_id;
+  }
+
+  std::optional<zetasql::Value> GetPartitionToken(
+      const ChangeStream* change_stream) const override;
+  void SetPartitionToken(const ChangeStream* change_stream,
+                         const zetasql::Value& partition_token) override;
+
  private:
+  // Builds a record out of the last mod group of change_stream. The mods of
+  // the group are moved into the record, so the group must be discarded.
   DataChangeRecord BuildDataChangeRecord(std::string tracked_table_name,
                                          std::string value_capture_type,
                                          const ChangeStream* change_stream);
-  void LogTableMod(const Key& key, std::vector<const Column*> columns,
+  void LogTableMod(const Key& key, const std::vector<const Column*>& columns,
                    const std::vector<zetasql::Value>& values,
                    const Table* table, const ChangeStream* change_stream,
                    std::string mod_type, zetasql::Value partition_token_str);
@@ -188,6 +208,8 @@ class ChangeStreamTransactionEffectsBuffer : public ChangeStreamEffectsBuffer {
   absl::flat_hash_map<std::string, int64_t> record_sequence_by_change_stream_;
   absl::flat_hash_map<const ChangeStream*, ModGroup>
       last_mod_group_by_change_stream_;
+  absl::flat_hash_map<const ChangeStream*, zetasql::Value>
+      partition_token_by_change_stream_;
 };
 
 }  // namespace backend
@@ -16,10 +16,32 @@
 
 #include "backend/transaction/flush.h"
 
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/actions/ops.h"
+#include "backend/common/ids.h"
 #include "backend/common/variant.h"
+#include "backend/database/write_ahead_log.h"
+#include "backend/database/write_ahead_log.pb.h"
+#include "backend/datamodel/key.h"
+#include "backend/schema/catalog/change_stream.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "backend/storage/commit_timestamp_index.h"
+#include "backend/storage/storage.h"
 #include "backend/transaction/commit_timestamp.h"
+#include "common/metrics.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
@@ -28,65 +50,199 @@ namespace backend {
 
 namespace {
 
-absl::Status FlushInsert(const InsertOp& insert_op, Storage* base_storage,
-                         absl::Time commit_timestamp) {
-  const Table* table = insert_op.table;
-  const Key key = MaybeSetCommitTimestamp(table->primary_key(), insert_op.key,
-                                          commit_timestamp);
-  std::vector<ColumnID> column_ids;
-  ValueList column_values;
-  for (int i = 0; i < insert_op.columns.size(); i++) {
-    column_ids.push_back(insert_op.columns[i]->id());
-    column_values.push_back(MaybeSetCommitTimestamp(
-        insert_op.columns[i], insert_op.values[i], commit_timestamp));
+// Builds the storage op for an insert or update, moving the key and values out
+// of the given op.
+template <typename RowOp>
+StorageWriteOp ToStorageWriteOp(RowOp& row_op, absl::Time commit_timestamp) {
+  const Table* table = row_op.table;
+  StorageWriteOp op;
+  op.table_id = table->id();
+  op.key = MaybeSetCommitTimestamp(table->primary_key(), std::move(row_op.key),
+                                   commit_timestamp);
+  op.column_ids.reserve(row_op.columns.size());
+  op.values = std::move(row_op.values);
+  for (int i = 0; i < row_op.columns.size(); i++) {
+    op.column_ids.push_back(row_op.columns[i]->id());
+    if (IsPendingCommitTimestamp(row_op.columns[i], op.values[i])) {
+      op.values[i] = zetasql::values::Timestamp(commit_timestamp);
+    }
   }
-  return base_storage->Write(commit_timestamp, table->id(), key, column_ids,
-                             column_values);
+  return op;
 }
 
-absl::Status FlushUpdate(const UpdateOp& update_op, Storage* base_storage,
-                         absl::Time commit_timestamp) {
-  const Table* table = update_op.table;
-  const Key key = MaybeSetCommitTimestamp(table->primary_key(), update_op.key,
-                                          commit_timestamp);
-  std::vector<ColumnID> column_ids;
-  ValueList column_values;
-  for (int i = 0; i < update_op.columns.size(); i++) {
-    column_ids.push_back(update_op.columns[i]->id());
-    column_values.push_back(MaybeSetCommitTimestamp(
-        update_op.columns[i], update_op.values[i], commit_timestamp));
+StorageWriteOp ToStorageWriteOp(DeleteOp& delete_op) {
+  StorageWriteOp op;
+  op.table_id = delete_op.table->id();
+  op.key = std::move(delete_op.key);
+  op.is_delete = true;
+  return op;
+}
+
+// Records op, a write to table of the given columns, in a commit record. Tables
+// are recorded by name, since storage IDs are not stable across restarts.
+absl::Status AddLoggedWrite(const Table* table,
+                            absl::Span<const Column* const> columns,
+                            const StorageWriteOp& op, CommitRecord* record) {
+  CommitRecord::Write* write = record->add_writes();
+  if (table->owner_index() != nullptr) {
+    write->set_table(table->owner_index()->Name());
+    write->set_table_kind(CommitRecord::Write::INDEX);
+  } else if (table->owner_change_stream() != nullptr) {
+    write->set_table(table->owner_change_stream()->Name());
+    write->set_table_kind(CommitRecord::Write::CHANGE_STREAM);
+  } else {
+    write->set_table(table->Name());
+  }
+  for (int i = 0; i < op.key.NumColumns(); ++i) {
+    ZETASQL_RETURN_IF_ERROR(op.key.ColumnValue(i).Serialize(write->add_key()));
   }
-  return base_storage->Write(commit_timestamp, table->id(), key, column_ids,
-                             column_values);
+  write->set_is_delete(op.is_delete);
+  for (int i = 0; i < columns.size(); ++i) {
+    write->add_columns(columns[i]->Name());
+    ZETASQL_RETURN_IF_ERROR(op.values[i].Serialize(write->add_values()));
+  }
+  return absl::OkStatus();
 }
 
-absl::Status FlushDelete(const DeleteOp& delete_op, Storage* base_storage,
-                         absl::Time commit_timestamp) {
-  return base_storage->Delete(commit_timestamp, delete_op.table->id(),
-                              KeyRange::Point(delete_op.key));
+// Records op, a write to table which changed its number of rows by
+// row_count_delta, in statistics. The key is only recorded for inserts, since
+// updates and deletes do not add key values.
+void RecordWrite(const Table* table, const StorageWriteOp& op,
+                 int64_t row_count_delta, DatabaseStatistics* statistics) {
+  statistics->RecordWrite(op.table_id, op.column_ids, op.values,
+                          row_count_delta);
+  if (row_count_delta > 0) {
+    std::vector<ColumnID> key_column_ids;
+    std::vector<zetasql::Value> key_values;
+    for (int i = 0; i < op.key.NumColumns(); ++i) {
+      key_column_ids.push_back(table->primary_key()[i]->column()->id());
+      key_values.push_back(op.key.ColumnValue(i));
+    }
+    statistics->RecordWrite(op.table_id, key_column_ids, key_values,
+                            /*row_count_delta=*/0);
+  }
+}
+
+// Returns true if the keys written to table are recorded in the commit
+// timestamp index: those of tables, but not index or change stream data
+// tables, with a column which allows commit timestamps.
+bool IsCommitTimestampIndexed(const Table* table) {
+  if (table->owner_index() != nullptr ||
+      table->owner_change_stream() != nullptr) {
+    return false;
+  }
+  for (const Column* column : table->columns()) {
+    if (column->allows_commit_timestamp()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the change in the number of rows of its table made by write_op,
+// given whether its row exists before it, and updates row_exists. Writes to a
+// row within a transaction are collapsed into one op, so an insert may replace
+// a row deleted earlier in the transaction, and a delete may remove a row which
+// only the transaction inserted, or none at all.
+int64_t RowCountDelta(const WriteOp& write_op, bool* row_exists) {
+  const bool existed = *row_exists;
+  *row_exists = !std::holds_alternative<DeleteOp>(write_op);
+  return int64_t{*row_exists} - int64_t{existed};
 }
 
 }  // namespace
 
-absl::Status FlushWriteOpsToStorage(const std::vector<WriteOp>& write_ops,
+absl::Status FlushWriteOpsToStorage(std::vector<WriteOp> write_ops,
                                     Storage* base_storage,
-                                    absl::Time commit_timestamp) {
-  for (const auto& write_op : write_ops) {
-    ZETASQL_RETURN_IF_ERROR(std::visit(
+                                    absl::Time commit_timestamp,
+                                    WriteAheadLog* write_ahead_log,
+                                    DatabaseStatistics* statistics,
+                                    CommitTimestampIndex*
+                                        commit_timestamp_index) {
+  static metrics::LatencyHistogram* histogram =
+      metrics::GetLatencyHistogram("emulator_commit_flush_seconds");
+  metrics::ScopedLatencyTimer timer(histogram);
+  std::vector<StorageWriteOp> ops;
+  ops.reserve(write_ops.size());
+  WriteAheadLogRecord record;
+  absl::flat_hash_map<const Table*, bool> indexed_tables;
+  // Whether the rows written so far exist, starting from base storage.
+  std::map<std::pair<TableID, Key>, bool> row_exists;
+  for (auto& write_op : write_ops) {
+    int64_t row_count_delta = 0;
+    if (statistics != nullptr) {
+      auto [itr, inserted] = row_exists.try_emplace(
+          std::make_pair(TableOf(write_op)->id(), KeyOf(write_op)), false);
+      if (inserted) {
+        ZETASQL_ASSIGN_OR_RETURN(
+            itr->second,
+            base_storage->Exists(absl::InfiniteFuture(), itr->first.first,
+                                 itr->first.second));
+      }
+      row_count_delta = RowCountDelta(write_op, &itr->second);
+    }
+    ops.push_back(std::visit(
         overloaded{
-            [&](const InsertOp& insert_op) {
-              return FlushInsert(insert_op, base_storage, commit_timestamp);
-            },
-            [&](const UpdateOp& update_op) {
-              return FlushUpdate(update_op, base_storage, commit_timestamp);
+            [&](InsertOp& insert_op) {
+              return ToStorageWriteOp(insert_op, commit_timestamp);
             },
-            [&](const DeleteOp& delete_op) {
-              return FlushDelete(delete_op, base_storage, commit_timestamp);
+            [&](UpdateOp& update_op) {
+              return ToStorageWriteOp(update_op, commit_timestamp);
             },
+            [&](DeleteOp& delete_op) { return ToStorageWriteOp(delete_op); },
         },
         write_op));
+    // The storage may move the values out of the ops, so they are recorded in
+    // the statistics before the batch is applied.
+    if (statistics != nullptr) {
+      RecordWrite(TableOf(write_op), ops.back(), row_count_delta, statistics);
+    }
+    if (commit_timestamp_index != nullptr) {
+      const Table* table = TableOf(write_op);
+      auto [itr, inserted] = indexed_tables.try_emplace(table, false);
+      if (inserted) {
+        itr->second = IsCommitTimestampIndexed(table);
+      }
+      if (itr->second) {
+        commit_timestamp_index->Record(ops.back().table_id, ops.back().key,
+                                       commit_timestamp);
+      }
+    }
+    if (write_ahead_log != nullptr) {
+      ZETASQL_RETURN_IF_ERROR(std::visit(
+          overloaded{
+              [&](const InsertOp& op) {
+                return AddLoggedWrite(op.table, op.columns, ops.back(),
+                                      record.mutable_commit());
+              },
+              [&](const UpdateOp& op) {
+                return AddLoggedWrite(op.table, op.columns, ops.back(),
+                                      record.mutable_commit());
+              },
+              [&](const DeleteOp& op) {
+                return AddLoggedWrite(op.table, {}, ops.back(),
+                                      record.mutable_commit());
+              },
+          },
+          write_op));
+    }
   }
-  return absl::OkStatus();
+
+  // The commit is logged before it is applied, so that it is never visible to
+  // reads unless it would also survive a restart.
+  if (write_ahead_log != nullptr && !ops.empty()) {
+    ZETASQL_RETURN_IF_ERROR(write_ahead_log->Append(record));
+  }
+  absl::Status status =
+      base_storage->ApplyBatch(commit_timestamp, absl::MakeSpan(ops));
+  if (!status.ok() && statistics != nullptr) {
+    // Which of the ops were applied is unknown, so the recorded statistics of
+    // the written tables can no longer be trusted.
+    for (const WriteOp& write_op : write_ops) {
+      statistics->Erase(TableOf(write_op)->id());
+    }
+  }
+  return status;
 }
 
 }  // namespace backend
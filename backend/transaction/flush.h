@@ -17,7 +17,15 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_FLUSH_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_FLUSH_H_
 
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/time/time.h"
 #include "backend/actions/ops.h"
+#include "backend/database/write_ahead_log.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "backend/storage/commit_timestamp_index.h"
+#include "backend/storage/storage.h"
 
 namespace google {
 namespace spanner {
@@ -27,12 +35,22 @@ namespace backend {
 // TODO : Add support to write multiple ops to base storage
 // atomically.
 
-// Flushes each of the write ops to base storage at the given timestamp. Note
+// Flushes the write ops to base storage at the given timestamp as a single
+// batch. Keys and values are moved out of write_ops. If write_ahead_log is not
+// null, the writes are first appended to it as a commit record. If statistics
+// is not null, the statistics of the written tables are updated once the batch
+// is applied. If commit_timestamp_index is not null, the keys written to tables
+// with a column which allows commit timestamps are recorded in it before the
+// batch is applied, so that they are found by any read which sees them. Note
 // that calling this function isn't thread safe and appropriate database locks
 // should be acquired.
-absl::Status FlushWriteOpsToStorage(const std::vector<WriteOp>& write_ops,
+absl::Status FlushWriteOpsToStorage(std::vector<WriteOp> write_ops,
                                     Storage* base_storage,
-                                    absl::Time commit_timestamp);
+                                    absl::Time commit_timestamp,
+                                    WriteAheadLog* write_ahead_log = nullptr,
+                                    DatabaseStatistics* statistics = nullptr,
+                                    CommitTimestampIndex*
+                                        commit_timestamp_index = nullptr);
 
 }  // namespace backend
 }  // namespace emulator
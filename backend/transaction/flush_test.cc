@@ -17,6 +17,7 @@
 #include "backend/transaction/flush.h"
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -26,6 +27,7 @@
 #include "absl/status/statusor.h"
 #include "absl/time/time.h"
 #include "backend/actions/ops.h"
+#include "backend/schema/catalog/table_statistics.h"
 #include "backend/storage/in_memory_storage.h"
 #include "tests/common/schema_constructor.h"
 
@@ -132,6 +134,80 @@ TEST_F(FlushTest, CanFlushWriteOpsToStorage) {
                                              {Int64(3), String("value")}}));
 }
 
+TEST_F(FlushTest, FlushesOpsOnTheSameKeyInOrder) {
+  absl::Time t0 = absl::Now();
+
+  // Delete and re-insert {1, "value"} in the same batch.
+  InsertOp insert_op{table_,
+                     Key({Int64(1)}),
+                     {int64_col_, string_col_},
+                     {Int64(1), String("value")}};
+  DeleteOp delete_op{table_, Key({Int64(1)})};
+  InsertOp reinsert_op{table_,
+                       Key({Int64(1)}),
+                       {int64_col_, string_col_},
+                       {Int64(1), String("new-value")}};
+  ZETASQL_ASSERT_OK(FlushWriteOpsToStorage({insert_op, delete_op, reinsert_op},
+                                   storage_.get(), t0));
+  EXPECT_THAT(ReadAll(t0), IsOkAndHoldsRows({{Int64(1), String("new-value")}}));
+
+  // A delete at the end of the batch wins.
+  absl::Time t1 = t0 + absl::Seconds(1);
+  UpdateOp update_op{
+      table_, Key({Int64(1)}), {string_col_}, {String("updated-value")}};
+  ZETASQL_ASSERT_OK(
+      FlushWriteOpsToStorage({update_op, delete_op}, storage_.get(), t1));
+  EXPECT_THAT(ReadAll(t1), IsOkAndHoldsRows({}));
+}
+
+TEST_F(FlushTest, RecordsRowCountDeltasFromPriorRowExistence) {
+  absl::Time t0 = absl::Now();
+  ZETASQL_ASSERT_OK(Write(t0, Key({Int64(1)}), {Int64(1), String("value")}));
+  ZETASQL_ASSERT_OK(Write(t0, Key({Int64(2)}), {Int64(2), String("value")}));
+
+  TableStatisticsBuilder builder({int64_col_->id()}, 1);
+  builder.AddRow({Int64(1)});
+  builder.AddRow({Int64(2)});
+  DatabaseStatistics statistics;
+  statistics.Set(table_->id(), std::move(builder).Build());
+
+  // A delete and re-insert of {1} collapses to an insert over an existing row.
+  InsertOp reinsert_op{table_,
+                       Key({Int64(1)}),
+                       {int64_col_, string_col_},
+                       {Int64(1), String("new-value")}};
+  absl::Time t1 = t0 + absl::Seconds(1);
+  ZETASQL_ASSERT_OK(FlushWriteOpsToStorage({reinsert_op}, storage_.get(), t1,
+                                   /*write_ahead_log=*/nullptr, &statistics));
+  EXPECT_EQ(statistics.RowCount(table_->id()), 2);
+
+  // A delete of the missing row {3} removes nothing.
+  DeleteOp delete_missing_op{table_, Key({Int64(3)})};
+  absl::Time t2 = t1 + absl::Seconds(1);
+  ZETASQL_ASSERT_OK(
+      FlushWriteOpsToStorage({delete_missing_op}, storage_.get(), t2,
+                             /*write_ahead_log=*/nullptr, &statistics));
+  EXPECT_EQ(statistics.RowCount(table_->id()), 2);
+
+  // Inserting the new rows {4} and {5} adds two rows, and deleting the
+  // existing row {2} removes one.
+  InsertOp insert_op{table_,
+                     Key({Int64(4)}),
+                     {int64_col_, string_col_},
+                     {Int64(4), String("value")}};
+  DeleteOp delete_op{table_, Key({Int64(2)})};
+  InsertOp another_insert_op{table_,
+                             Key({Int64(5)}),
+                             {int64_col_, string_col_},
+                             {Int64(5), String("value")}};
+  absl::Time t3 = t2 + absl::Seconds(1);
+  ZETASQL_ASSERT_OK(
+      FlushWriteOpsToStorage({insert_op, delete_op, another_insert_op},
+                             storage_.get(), t3,
+                             /*write_ahead_log=*/nullptr, &statistics));
+  EXPECT_EQ(statistics.RowCount(table_->id()), 3);
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
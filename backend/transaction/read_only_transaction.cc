@@ -16,7 +16,10 @@
 
 #include "backend/transaction/read_only_transaction.h"
 
+#include <algorithm>
 #include <memory>
+#include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -26,6 +29,7 @@
 #include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/datamodel/key_set.h"
 #include "backend/locking/manager.h"
 #include "backend/storage/in_memory_iterator.h"
@@ -41,21 +45,17 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
-namespace {
-
-absl::Duration kMaxStaleReadDuration = absl::Hours(1);
-
-}  // namespace
-
 ReadOnlyTransaction::ReadOnlyTransaction(
     const ReadOnlyOptions& options, TransactionID transaction_id, Clock* clock,
     Storage* storage, LockManager* lock_manager,
-    const VersionedCatalog* const versioned_catalog)
+    const VersionedCatalog* const versioned_catalog,
+    ReadPlanCache* read_plan_cache)
     : options_(options),
       id_(transaction_id),
       clock_(clock),
       base_storage_(storage),
       versioned_catalog_(versioned_catalog),
+      read_plan_cache_(read_plan_cache),
       lock_manager_(lock_manager) {
   lock_handle_ = lock_manager_->CreateHandle(transaction_id, /*priority=*/1);
   read_timestamp_ = PickReadTimestamp();
@@ -63,7 +63,7 @@ ReadOnlyTransaction::ReadOnlyTransaction(
 
 absl::Status ReadOnlyTransaction::Read(const ReadArg& read_arg,
                                        std::unique_ptr<RowCursor>* cursor) {
-  absl::MutexLock lock(&mu_);
+  absl::ReaderMutexLock lock(&mu_);
   // Wait for any concurrent schema change or read-write transactions to commit
   // before accessing database state to perform a read.
   lock_handle_->WaitForSafeRead(read_timestamp_);
@@ -72,26 +72,86 @@ absl::Status ReadOnlyTransaction::Read(const ReadArg& read_arg,
   }
 
   ZETASQL_ASSIGN_OR_RETURN(const ResolvedReadArg resolved_read_arg,
-                   ResolveReadArg(read_arg, schema()));
+                   ResolveReadArg(read_arg, schema(), read_plan_cache_));
 
   std::vector<std::unique_ptr<StorageIterator>> iterators;
-  for (const auto& key_range : resolved_read_arg.key_ranges) {
-    std::unique_ptr<StorageIterator> itr;
-    ZETASQL_RETURN_IF_ERROR(base_storage_->Read(
-        read_timestamp_, resolved_read_arg.table->id(), key_range,
-        GetColumnIDs(resolved_read_arg.columns), &itr));
-    iterators.push_back(std::move(itr));
+  if (!resolved_read_arg.point_keys.empty()) {
+    // Reads of individual keys look all of them up at once, rather than
+    // scanning a range for each.
+    std::vector<FixedRowStorageIterator::Row> rows;
+    ZETASQL_RETURN_IF_ERROR(base_storage_->MultiLookup(
+        read_timestamp_, resolved_read_arg.table->id(),
+        resolved_read_arg.point_keys, GetColumnIDs(resolved_read_arg.columns),
+        &rows));
+    if (read_arg.reverse) {
+      std::reverse(rows.begin(), rows.end());
+    }
+    iterators.push_back(
+        std::make_unique<FixedRowStorageIterator>(std::move(rows)));
+  } else {
+    // The key ranges are sorted, so a reverse read starts from the last.
+    const int num_ranges = resolved_read_arg.key_ranges.size();
+    for (int i = 0; i < num_ranges; ++i) {
+      const KeyRange& key_range =
+          resolved_read_arg.key_ranges[read_arg.reverse ? num_ranges - 1 - i
+                                                        : i];
+      std::unique_ptr<StorageIterator> itr;
+      if (read_arg.reverse) {
+        ZETASQL_RETURN_IF_ERROR(base_storage_->ReadReverse(
+            read_timestamp_, resolved_read_arg.table->id(), key_range,
+            GetColumnIDs(resolved_read_arg.columns), &itr));
+      } else {
+        ZETASQL_RETURN_IF_ERROR(base_storage_->Read(
+            read_timestamp_, resolved_read_arg.table->id(), key_range,
+            GetColumnIDs(resolved_read_arg.columns), &itr));
+      }
+      iterators.push_back(std::move(itr));
+    }
   }
   *cursor = std::make_unique<StorageIteratorRowCursor>(
-      std::move(iterators), resolved_read_arg.columns);
+      std::move(iterators), resolved_read_arg.columns, read_arg.limit);
   return absl::OkStatus();
 }
 
+std::optional<int64_t> ReadOnlyTransaction::CountRows(
+    const std::string& table_name) {
+  absl::ReaderMutexLock lock(&mu_);
+  lock_handle_->WaitForSafeRead(read_timestamp_);
+  if (clock_->Now() - read_timestamp_ >= kMaxStaleReadDuration) {
+    return std::nullopt;
+  }
+  const Table* table = schema()->FindTable(table_name);
+  if (table == nullptr) {
+    return std::nullopt;
+  }
+  absl::StatusOr<int64_t> row_count =
+      base_storage_->RowCount(table->id(), read_timestamp_);
+  if (!row_count.ok()) {
+    return std::nullopt;
+  }
+  return *row_count;
+}
+
+absl::StatusOr<absl::Time> ReadOnlyTransaction::SnapshotEpoch() {
+  absl::ReaderMutexLock lock(&mu_);
+  lock_handle_->WaitForSafeRead(read_timestamp_);
+  if (clock_->Now() - read_timestamp_ >= kMaxStaleReadDuration) {
+    return error::ReadTimestampPastVersionGCLimit(read_timestamp_);
+  }
+  // No commit between the last one and the read timestamp can be pending, so
+  // reads at any timestamp from the last commit on see the same rows.
+  return std::min(read_timestamp_, lock_manager_->LastCommitTimestamp());
+}
+
 const Schema* ReadOnlyTransaction::schema() const {
   // Wait for any concurrent schema change or read-write transactions to commit
   // before accessing database state to read schemas in versioned_catalog.
   lock_handle_->WaitForSafeRead(read_timestamp_);
-  return versioned_catalog_->GetSchema(read_timestamp_);
+  absl::MutexLock lock(&schema_mu_);
+  if (schema_ == nullptr) {
+    schema_ = versioned_catalog_->GetSchemaRef(read_timestamp_);
+  }
+  return schema_.get();
 }
 
 absl::Time ReadOnlyTransaction::PickReadTimestamp() {
@@ -17,7 +17,10 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_READ_ONLY_TRANSACTION_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_READ_ONLY_TRANSACTION_H_
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
@@ -30,6 +33,7 @@
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/storage/storage.h"
 #include "backend/transaction/options.h"
+#include "backend/transaction/resolve.h"
 #include "backend/transaction/transaction_store.h"
 #include "common/clock.h"
 #include "common/errors.h"
@@ -40,6 +44,10 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+// Reads at timestamps older than this are rejected, since the versions they
+// would need may have been garbage collected.
+inline constexpr absl::Duration kMaxStaleReadDuration = absl::Hours(1);
+
 // ReadOnlyTransaction is a read-only transaction that reads from a specific
 // timestamp. ReadOnlyTransaction reads the database without needing to acquire
 // any locks.
@@ -50,16 +58,29 @@ class ReadOnlyTransaction : public RowReader {
   ReadOnlyTransaction(const ReadOnlyOptions& options,
                       TransactionID transaction_id, Clock* clock,
                       Storage* storage, LockManager* lock_manager,
-                      const VersionedCatalog* const versioned_catalog);
+                      const VersionedCatalog* const versioned_catalog,
+                      ReadPlanCache* read_plan_cache = nullptr);
 
   absl::Status Read(const ReadArg& read_arg,
                     std::unique_ptr<RowCursor>* cursor) override
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Counts the rows at the read timestamp from the row counts maintained by
+  // the storage, where it has them.
+  std::optional<int64_t> CountRows(const std::string& table_name) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   absl::Time read_timestamp() const { return read_timestamp_; }
 
+  // Returns a timestamp identifying the state of the database read by this
+  // transaction, once every commit preceding the read timestamp is done:
+  // transactions with the same snapshot epoch read the same rows. This is the
+  // read timestamp, or the timestamp of the last commit if that precedes it.
+  // Fails if the read timestamp is past the version garbage collection limit.
+  absl::StatusOr<absl::Time> SnapshotEpoch() ABSL_LOCKS_EXCLUDED(mu_);
+
   // Returns the schema used by this transaction.
-  const Schema* schema() const;
+  const Schema* schema() const ABSL_LOCKS_EXCLUDED(schema_mu_);
 
   // Returns the ID of this transaction.
   const TransactionID id() const { return id_; }
@@ -68,7 +89,8 @@ class ReadOnlyTransaction : public RowReader {
   const ReadOnlyOptions& options() const { return options_; }
 
  private:
-  // Mutex that guards the Read method.
+  // Mutex that guards the Read method. Reads only take it shared, as reads at
+  // the same timestamp do not interfere with each other.
   absl::Mutex mu_;
 
   // Picks a read timestamp given transaction type and timestamp bound.
@@ -89,12 +111,21 @@ class ReadOnlyTransaction : public RowReader {
   // VersionedCatalog for the database provided at transaction creation.
   const VersionedCatalog* const versioned_catalog_;
 
+  // Cache of the tables and columns resolved for reads. May be null.
+  ReadPlanCache* read_plan_cache_;
+
   // Transaction lock management.
   std::unique_ptr<LockHandle> lock_handle_;
   LockManager* lock_manager_;
 
   // The read timestamp picked by this transaction.
   absl::Time read_timestamp_;
+
+  // The schema at the read timestamp, which is looked up on first use since it
+  // is only known once the commits preceding the read timestamp are done. The
+  // reference keeps the schema from being garbage collected.
+  mutable absl::Mutex schema_mu_;
+  mutable std::shared_ptr<const Schema> schema_ ABSL_GUARDED_BY(schema_mu_);
 };
 
 }  // namespace backend
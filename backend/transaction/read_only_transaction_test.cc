@@ -17,6 +17,7 @@
 #include "backend/transaction/read_only_transaction.h"
 
 #include <ctime>
+#include <optional>
 
 #include "zetasql/public/type.h"
 #include "gmock/gmock.h"
@@ -27,6 +28,7 @@
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/storage/in_memory_storage.h"
@@ -153,6 +155,30 @@ TEST_F(ReadOnlyTransactionTest, WaitsForFutureReadTime) {
   EXPECT_GE(clock_.Now(), opts.timestamp);
 }
 
+TEST_F(ReadOnlyTransactionTest, CountsRowsAtReadTimestamp) {
+  VersionedCatalog catalog;
+  zetasql::TypeFactory type_factory{};
+  ZETASQL_EXPECT_OK(
+      catalog.AddSchema(t0_, test::CreateSchemaWithOneTable(&type_factory)));
+  const Table* table = catalog.GetLatestSchema()->FindTable("test_table");
+  const absl::Time t1 = t0_ + absl::Microseconds(1);
+  ZETASQL_EXPECT_OK(storage_.Write(t1, table->id(),
+                           Key({zetasql::values::Int64(1)}), {}, {}));
+
+  ReadOnlyOptions opts;
+  opts.bound = TimestampBound::kExactTimestamp;
+  opts.timestamp = t0_;
+  ReadOnlyTransaction before(opts, txn_id_, &clock_, &storage_,
+                             &lock_manager_, &catalog);
+  EXPECT_EQ(before.CountRows("test_table"), 0);
+
+  opts.timestamp = t1;
+  ReadOnlyTransaction after(opts, txn_id_, &clock_, &storage_, &lock_manager_,
+                            &catalog);
+  EXPECT_EQ(after.CountRows("test_table"), 1);
+  EXPECT_EQ(after.CountRows("missing_table"), std::nullopt);
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -16,6 +16,7 @@
 
 #include "backend/transaction/read_write_transaction.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -25,7 +26,9 @@
 #include <vector>
 
 #include "zetasql/public/value.h"
+#include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/random/random.h"
 #include "absl/random/uniform_int_distribution.h"
 #include "absl/status/status.h"
@@ -33,6 +36,7 @@
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "backend/access/read.h"
@@ -42,10 +46,13 @@
 #include "backend/actions/ops.h"
 #include "backend/common/ids.h"
 #include "backend/common/rows.h"
+#include "backend/database/change_stream/change_stream_notifier.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
 #include "backend/datamodel/value.h"
 #include "backend/locking/manager.h"
+#include "backend/query/transaction_stats_aggregator.h"
+#include "backend/schema/catalog/change_stream.h"
 #include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/table.h"
@@ -64,6 +71,7 @@
 #include "common/config.h"
 #include "common/constants.h"
 #include "common/errors.h"
+#include "common/tracing.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status_macros.h"
 
@@ -98,35 +106,37 @@ absl::StatusOr<std::vector<WriteOp>> FlattenDeleteOp(
 //   corresponding WriteOp of the same type.
 absl::StatusOr<std::vector<WriteOp>> FlattenNonDeleteOpRow(
     MutationOpType type, const Table* table,
-    const std::vector<const Column*>& columns, const Key& key,
-    const ValueList& row, const TransactionStore* transaction_store) {
+    const std::vector<const Column*>& columns, Key key, ValueList row,
+    const TransactionStore* transaction_store) {
   std::vector<WriteOp> write_ops;
   switch (type) {
     case MutationOpType::kInsert: {
-      write_ops.push_back(InsertOp{table, key, columns, row});
+      write_ops.push_back(
+          InsertOp{table, std::move(key), columns, std::move(row)});
       break;
     }
     case MutationOpType::kUpdate: {
-      write_ops.push_back(UpdateOp{table, key, columns, row});
+      write_ops.push_back(
+          UpdateOp{table, std::move(key), columns, std::move(row)});
       break;
     }
     case MutationOpType::kInsertOrUpdate: {
-      absl::StatusOr<ValueList> maybe_row =
-          transaction_store->Lookup(table, key,
-                                    /*columns= */ {});
-      if (maybe_row.ok()) {
+      ZETASQL_ASSIGN_OR_RETURN(bool exists, transaction_store->Exists(table, key));
+      if (exists) {
         // Row exists and therefore we should only update.
-        write_ops.push_back(UpdateOp{table, key, columns, row});
-      } else if (maybe_row.status().code() == absl::StatusCode::kNotFound) {
-        write_ops.push_back(InsertOp{table, key, columns, row});
+        write_ops.push_back(
+            UpdateOp{table, std::move(key), columns, std::move(row)});
       } else {
-        return maybe_row.status();
+        write_ops.push_back(
+            InsertOp{table, std::move(key), columns, std::move(row)});
       }
       break;
     }
     case MutationOpType::kReplace: {
+      write_ops.reserve(2);
       write_ops.push_back(DeleteOp{table, key});
-      write_ops.push_back(InsertOp{table, key, columns, row});
+      write_ops.push_back(
+          InsertOp{table, std::move(key), columns, std::move(row)});
       break;
     }
     case MutationOpType::kDelete: {
@@ -136,6 +146,48 @@ absl::StatusOr<std::vector<WriteOp>> FlattenNonDeleteOpRow(
   return std::move(write_ops);
 }
 
+// Returns the name under which the transaction statistics report a column.
+std::string ColumnName(const Table* table, const Column* column) {
+  return absl::StrCat(table->Name(), ".", column->Name());
+}
+
+// Adds the writes of resolved_mutation_op to sample.
+void AddWriteShape(const ResolvedMutationOp& resolved_mutation_op,
+                   TransactionExecutionSample* sample) {
+  const Table* table = resolved_mutation_op.table;
+  if (resolved_mutation_op.type == MutationOpType::kDelete) {
+    sample->write_delete_tables.insert(table->Name());
+    return;
+  }
+  for (const Column* column : resolved_mutation_op.columns) {
+    sample->write_constructive_columns.insert(ColumnName(table, column));
+  }
+  TableOperations& operations = sample->operations_by_table[table->Name()];
+  for (const ValueList& row : resolved_mutation_op.rows) {
+    int64_t bytes = 0;
+    for (const zetasql::Value& value : row) {
+      bytes += value.physical_byte_size();
+    }
+    ++operations.insert_or_update_count;
+    operations.insert_or_update_bytes += bytes;
+    sample->bytes += bytes;
+  }
+}
+
+// Returns the outcome reported for a commit which returned status.
+TransactionOutcome CommitOutcome(const absl::Status& status) {
+  switch (status.code()) {
+    case absl::StatusCode::kOk:
+      return TransactionOutcome::kCommitted;
+    case absl::StatusCode::kAborted:
+      return TransactionOutcome::kCommitAborted;
+    case absl::StatusCode::kFailedPrecondition:
+      return TransactionOutcome::kCommitFailedPrecondition;
+    default:
+      return TransactionOutcome::kCommitFailed;
+  }
+}
+
 bool ShouldAbortOnFirstCommit() {
   absl::BitGen gen;
   return config::fault_injection_enabled() &&
@@ -186,7 +238,10 @@ ReadWriteTransaction::ReadWriteTransaction(
     const ReadWriteOptions& options, const RetryState& retry_state,
     TransactionID transaction_id, Clock* clock, Storage* storage,
     LockManager* lock_manager, const VersionedCatalog* const versioned_catalog,
-    ActionManager* action_manager)
+    ActionManager* action_manager, ChangeStreamNotifier* change_stream_notifier,
+    WriteAheadLog* write_ahead_log, ReadPlanCache* read_plan_cache,
+    TransactionStatsAggregator* txn_stats, DatabaseStatistics* statistics,
+    CommitTimestampIndex* commit_timestamp_index)
     : options_(options),
       retry_state_(MakeRetryState(retry_state, clock)),
       id_(transaction_id),
@@ -198,11 +253,17 @@ ReadWriteTransaction::ReadWriteTransaction(
       transaction_store_(std::make_unique<TransactionStore>(
           base_storage_, lock_handle_.get())),
       action_manager_(action_manager),
+      change_stream_notifier_(change_stream_notifier),
+      write_ahead_log_(write_ahead_log),
+      read_plan_cache_(read_plan_cache),
+      txn_stats_(txn_stats),
+      statistics_(statistics),
+      commit_timestamp_index_(commit_timestamp_index),
       action_context_(std::make_unique<ActionContext>(
           std::make_unique<TransactionReadOnlyStore>(transaction_store_.get()),
           std::make_unique<TransactionEffectsBuffer>(&write_ops_queue_),
           std::make_unique<ChangeStreamTransactionEffectsBuffer>(id_), clock)),
-      schema_(versioned_catalog_->GetLatestSchema()) {}
+      schema_(versioned_catalog_->GetSchemaRef(absl::InfiniteFuture())) {}
 
 absl::StatusOr<absl::Time> ReadWriteTransaction::GetCommitTimestamp() {
   absl::MutexLock lock(&mu_);
@@ -221,18 +282,46 @@ absl::Status ReadWriteTransaction::Read(const ReadArg& read_arg,
     mu_.AssertHeld();
 
     ZETASQL_ASSIGN_OR_RETURN(const ResolvedReadArg& resolved_read_arg,
-                     ResolveReadArg(read_arg, schema_));
+                     ResolveReadArg(read_arg, schema_.get(), read_plan_cache_));
+    if (txn_stats_ != nullptr) {
+      for (const Column* column : resolved_read_arg.columns) {
+        attempt_sample_.read_columns.insert(
+            ColumnName(resolved_read_arg.table, column));
+      }
+    }
 
     std::vector<std::unique_ptr<StorageIterator>> iterators;
-    for (const auto& key_range : resolved_read_arg.key_ranges) {
+    if (!resolved_read_arg.point_keys.empty() && !read_arg.reverse) {
       std::unique_ptr<StorageIterator> itr;
-      ZETASQL_RETURN_IF_ERROR(transaction_store_->Read(
-          resolved_read_arg.table, key_range, resolved_read_arg.columns, &itr,
+      ZETASQL_RETURN_IF_ERROR(transaction_store_->MultiLookup(
+          resolved_read_arg.table, resolved_read_arg.point_keys,
+          resolved_read_arg.columns, &itr,
           false /*allow_pending_commit_timestamps_in_read*/));
       iterators.push_back(std::move(itr));
+    } else {
+      // The locks of all the ranges are acquired together. The key ranges are
+      // sorted, so a reverse read starts from the last.
+      const int num_ranges = resolved_read_arg.key_ranges.size();
+      const bool lock_ranges_together = num_ranges > 1;
+      if (lock_ranges_together) {
+        ZETASQL_RETURN_IF_ERROR(transaction_store_->AcquireReadLocks(
+            resolved_read_arg.table, resolved_read_arg.key_ranges,
+            resolved_read_arg.columns));
+      }
+      for (int i = 0; i < num_ranges; ++i) {
+        const KeyRange& key_range =
+            resolved_read_arg
+                .key_ranges[read_arg.reverse ? num_ranges - 1 - i : i];
+        std::unique_ptr<StorageIterator> itr;
+        ZETASQL_RETURN_IF_ERROR(transaction_store_->Read(
+            resolved_read_arg.table, key_range, resolved_read_arg.columns,
+            &itr, false /*allow_pending_commit_timestamps_in_read*/,
+            read_arg.reverse, !lock_ranges_together /*acquire_lock*/));
+        iterators.push_back(std::move(itr));
+      }
     }
     *cursor = std::make_unique<StorageIteratorRowCursor>(
-        std::move(iterators), resolved_read_arg.columns);
+        std::move(iterators), resolved_read_arg.columns, read_arg.limit);
     return absl::OkStatus();
   });
 }
@@ -245,12 +334,14 @@ absl::Status ReadWriteTransaction::ApplyEffectors(const WriteOp& op) {
   return action_registry_->ExecuteEffectors(action_context_.get(), op);
 }
 
+absl::Status ReadWriteTransaction::ApplyBatchEffectors(
+    const std::vector<WriteOp>& ops) {
+  return action_registry_->ExecuteBatchEffectors(action_context_.get(), ops);
+}
+
 absl::Status ReadWriteTransaction::ApplyStatementVerifiers() {
-  for (const auto& write_op : transaction_store_->GetBufferedOps()) {
-    ZETASQL_RETURN_IF_ERROR(
-        action_registry_->ExecuteVerifiers(action_context_.get(), write_op));
-  }
-  return absl::OkStatus();
+  return action_registry_->ExecuteVerifiers(action_context_.get(),
+                                            transaction_store_->GetBufferedOps());
 }
 
 const Schema* ReadWriteTransaction::schema() const {
@@ -258,7 +349,7 @@ const Schema* ReadWriteTransaction::schema() const {
   if (state_ == State::kUninitialized) {
     return versioned_catalog_->GetLatestSchema();
   }
-  return schema_;
+  return schema_.get();
 }
 
 void ReadWriteTransaction::Reset() {
@@ -266,11 +357,56 @@ void ReadWriteTransaction::Reset() {
 
   lock_handle_->UnlockAll();
   transaction_store_->Clear();
+  action_context_->change_stream_effects()->Reset();
   std::queue<WriteOp> empty;
   write_ops_queue_.swap(empty);
   state_ = State::kUninitialized;
 }
 
+void ReadWriteTransaction::Recycle() {
+  absl::MutexLock lock(&mu_);
+  Reset();
+  transaction_store_->Reset(nullptr);
+  lock_handle_.reset();
+  deleted_key_ranges_by_table_.clear();
+  // A pooled transaction must not keep its schema from being collected.
+  schema_.reset();
+  action_registry_ = nullptr;
+}
+
+void ReadWriteTransaction::Reinitialize(const ReadWriteOptions& options,
+                                        const RetryState& retry_state,
+                                        TransactionID transaction_id,
+                                        LockManager* lock_manager) {
+  absl::MutexLock lock(&mu_);
+  options_ = options;
+  retry_state_ = MakeRetryState(retry_state, clock_);
+  id_ = transaction_id;
+  lock_handle_ = lock_manager->CreateHandle(id_, retry_state_.priority);
+  transaction_store_->Reset(lock_handle_.get());
+  // The buffer is always the one made by the constructor.
+  static_cast<ChangeStreamTransactionEffectsBuffer*>(
+      action_context_->change_stream_effects())
+      ->set_transaction_id(id_);
+  attempt_sample_ = TransactionExecutionSample();
+  committed_attempt_duration_ = absl::ZeroDuration();
+  commit_timestamp_ = absl::Time();
+  schema_ = versioned_catalog_->GetSchemaRef(absl::InfiniteFuture());
+  state_ = State::kUninitialized;
+}
+
+void ReadWriteTransaction::RecordAttempt(TransactionOutcome outcome,
+                                         absl::Duration commit_latency) {
+  if (txn_stats_ == nullptr) {
+    return;
+  }
+  const absl::Time now = absl::Now();
+  attempt_sample_.outcome = outcome;
+  attempt_sample_.total_latency = now - attempt_start_;
+  attempt_sample_.commit_latency = commit_latency;
+  txn_stats_->Record(attempt_sample_, now);
+}
+
 absl::Status ReadWriteTransaction::GuardedCall(
     OpType op, const std::function<absl::Status()>& fn) {
   absl::MutexLock lock(&mu_);
@@ -291,19 +427,25 @@ absl::Status ReadWriteTransaction::GuardedCall(
       return error::Internal(absl::StrCat(
           "Invalid call to Committed transaction. Transaction: ", id()));
     case State::kUninitialized: {
-      schema_ = versioned_catalog_->GetLatestSchema();
+      schema_ = versioned_catalog_->GetSchemaRef(absl::InfiniteFuture());
       auto maybe_action_registry =
-          action_manager_->GetActionsForSchema(schema_);
+          action_manager_->GetActionsForSchema(schema_.get());
       if (!maybe_action_registry.ok()) {
         Reset();
         return maybe_action_registry.status();
       }
       action_registry_ = maybe_action_registry.value();
       state_ = State::kActive;
+      attempt_sample_ = TransactionExecutionSample();
+      attempt_sample_.retry = retry_state_.abort_retry_count > 0;
+      attempt_start_ = absl::Now();
       break;
     }
     case State::kActive: {
-      if (schema_ != versioned_catalog_->GetLatestSchema()) {
+      // Schema changes which left the data untouched, such as new views, do
+      // not abort the transaction, which keeps using the schema it started on.
+      if (!versioned_catalog_->IsDataCompatibleWithLatest(schema_.get())) {
+        RecordAttempt(TransactionOutcome::kAborted, absl::ZeroDuration());
         Reset();
         ++retry_state_.abort_retry_count;
         return error::AbortDueToConcurrentSchemaChange(id_);
@@ -312,7 +454,16 @@ absl::Status ReadWriteTransaction::GuardedCall(
     }
   }
 
+  const absl::Time start = absl::Now();
   absl::Status status = fn();
+  if (op == OpType::kCommit) {
+    RecordAttempt(CommitOutcome(status), absl::Now() - start);
+    if (status.ok()) {
+      committed_attempt_duration_ = absl::Now() - attempt_start_;
+    }
+  } else if (status.code() == absl::StatusCode::kAborted) {
+    RecordAttempt(TransactionOutcome::kAborted, absl::ZeroDuration());
+  }
 
   if (!status.ok()) {
     if (status.code() == absl::StatusCode::kAborted) {
@@ -332,30 +483,81 @@ absl::Status ReadWriteTransaction::GuardedCall(
 }
 
 absl::Status ReadWriteTransaction::ProcessWriteOps(
-    const std::vector<WriteOp>& write_ops) {
+    std::vector<WriteOp> write_ops) {
   mu_.AssertHeld();
 
-  for (const auto& write_op : write_ops) {
-    write_ops_queue_.push(write_op);
+  for (WriteOp& write_op : write_ops) {
+    write_ops_queue_.push(std::move(write_op));
   }
 
+  // Index data tables have no validators or effectors of their own, so their
+  // ops are collected per index and buffered once the statement's base table
+  // ops have been processed. Effectors never read index data tables, so
+  // deferring these writes is not observable. Index effectors only emit
+  // deletes and full row inserts, and the store collapses either of them over
+  // an earlier op of the same key, so only the last op of each index key is
+  // kept.
+  std::vector<const Table*> index_tables;
+  absl::flat_hash_map<const Table*, absl::btree_map<Key, WriteOp>> index_ops;
   while (!write_ops_queue_.empty()) {
-    WriteOp write_op = write_ops_queue_.front();
-    write_ops_queue_.pop();
+    // The ops are processed a generation at a time, in the same order as they
+    // were queued. Each op of the generation is validated, effected and
+    // buffered in turn. Batch effectors, such as cascading deletes, then run
+    // once over the whole generation, and their effects form the next one.
+    // The write locks of the generation are acquired together, before any of
+    // its ops is processed.
+    std::queue<WriteOp> generation;
+    generation.swap(write_ops_queue_);
+    std::vector<WriteOp> buffered_ops;
+    std::vector<WriteOp> base_table_ops;
+    while (!generation.empty()) {
+      WriteOp write_op = std::move(generation.front());
+      generation.pop();
+
+      const Table* table = TableOf(write_op);
+      if (table->owner_index() != nullptr) {
+        auto [itr, inserted] = index_ops.try_emplace(table);
+        if (inserted) {
+          index_tables.push_back(table);
+        }
+        Key key = KeyOf(write_op);
+        itr->second.insert_or_assign(std::move(key), std::move(write_op));
+        continue;
+      }
+      base_table_ops.push_back(std::move(write_op));
+    }
+    ZETASQL_RETURN_IF_ERROR(
+        transaction_store_->AcquireWriteLocks(base_table_ops));
 
-    // Process the operation.
-    ZETASQL_RETURN_IF_ERROR(ApplyValidators(write_op));
-    ZETASQL_RETURN_IF_ERROR(ApplyEffectors(write_op));
+    for (WriteOp& write_op : base_table_ops) {
+      // Process the operation.
+      ZETASQL_RETURN_IF_ERROR(ApplyValidators(write_op));
+      ZETASQL_RETURN_IF_ERROR(ApplyEffectors(write_op));
 
-    // Apply to transaction store.
-    ZETASQL_RETURN_IF_ERROR(transaction_store_->BufferWriteOp(write_op));
+      // Apply to transaction store.
+      ZETASQL_RETURN_IF_ERROR(transaction_store_->BufferWriteOp(
+          write_op, /*acquire_lock=*/false));
+      buffered_ops.push_back(std::move(write_op));
+    }
+    ZETASQL_RETURN_IF_ERROR(ApplyBatchEffectors(buffered_ops));
   }
 
-  action_context_->change_stream_effects()->BuildMutation();
-  for (const WriteOp& writeop :
-       action_context_->change_stream_effects()->GetWriteOps()) {
-    ZETASQL_RETURN_IF_ERROR(transaction_store_->BufferWriteOp(writeop));
+  // Apply each index's deltas as one sorted run, with their locks acquired
+  // together.
+  std::vector<WriteOp> all_index_ops;
+  for (const Table* index_table : index_tables) {
+    for (auto& [key, write_op] : index_ops[index_table]) {
+      all_index_ops.push_back(std::move(write_op));
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(transaction_store_->AcquireWriteLocks(all_index_ops));
+  for (const WriteOp& write_op : all_index_ops) {
+    ZETASQL_RETURN_IF_ERROR(
+        transaction_store_->BufferWriteOp(write_op, /*acquire_lock=*/false));
   }
+
+  // Change stream records are only written to the transaction store at commit.
+  action_context_->change_stream_effects()->EndStatement();
   return absl::OkStatus();
 }
 
@@ -399,6 +601,8 @@ ReadWriteTransaction::ResolveNonDeleteMutationOp(const MutationOp& mutation_op,
   ZETASQL_ASSIGN_OR_RETURN(std::vector<std::optional<int>> key_indices,
                    ExtractPrimaryKeyIndices(columns, table->primary_key()));
 
+  resolved_mutation_op.rows.reserve(mutation_op.rows.size());
+  resolved_mutation_op.keys.reserve(mutation_op.rows.size());
   for (int i = 0; i < mutation_op.rows.size(); i++) {
     const ValueList& row = mutation_op.rows[i];
     ValueList new_row = row;
@@ -432,8 +636,11 @@ absl::Status ReadWriteTransaction::Write(const Mutation& mutation) {
         // Process Delete.
         ZETASQL_ASSIGN_OR_RETURN(
             ResolvedMutationOp resolved_mutation_op,
-            ResolveDeleteMutationOp(mutation_op, schema_, clock_->Now()));
+            ResolveDeleteMutationOp(mutation_op, schema_.get(), clock_->Now()));
         const std::string& table_name = resolved_mutation_op.table->Name();
+        if (txn_stats_ != nullptr) {
+          AddWriteShape(resolved_mutation_op, &attempt_sample_);
+        }
 
         std::vector<KeyRange>& key_ranges =
             deleted_key_ranges_by_table_[table_name];
@@ -445,54 +652,72 @@ absl::Status ReadWriteTransaction::Write(const Mutation& mutation) {
                                          resolved_mutation_op.key_ranges,
                                          transaction_store_.get()));
 
-        ZETASQL_RETURN_IF_ERROR(ProcessWriteOps(write_ops));
+        ZETASQL_RETURN_IF_ERROR(ProcessWriteOps(std::move(write_ops)));
       } else {
         // Process non-delete Mutation ops.
-        ZETASQL_RETURN_IF_ERROR(ValidateNonDeleteMutationOp(mutation_op, schema_));
+        const Schema* schema = schema_.get();
+        ZETASQL_RETURN_IF_ERROR(
+            ValidateNonDeleteMutationOp(mutation_op, schema));
         ZETASQL_ASSIGN_OR_RETURN(ResolvedMutationOp resolved_mutation_op,
-                         ResolveNonDeleteMutationOp(mutation_op, schema_));
+                         ResolveNonDeleteMutationOp(mutation_op, schema));
         const std::string& table_name = resolved_mutation_op.table->Name();
+        if (txn_stats_ != nullptr) {
+          AddWriteShape(resolved_mutation_op, &attempt_sample_);
+        }
+
+        // Keys deleted earlier in the transaction only need to be checked if
+        // there are any, which blind writes usually do not have.
+        auto deleted_itr = deleted_key_ranges_by_table_.find(table_name);
+        std::vector<KeyRange>* deleted_key_ranges =
+            deleted_itr != deleted_key_ranges_by_table_.end() &&
+                    !deleted_itr->second.empty()
+                ? &deleted_itr->second
+                : nullptr;
 
         // Process Insert, Update, Replace and InsertOrUpdate.
         for (int i = 0; i < resolved_mutation_op.rows.size(); i++) {
           // Spanner allows deleted entries to be reinserted within the same
           // transaction, so we must update the deleted ranges list in this
           // case.
-          if (resolved_mutation_op.type == MutationOpType::kInsert ||
-              resolved_mutation_op.type == MutationOpType::kInsertOrUpdate) {
+          if (deleted_key_ranges != nullptr &&
+              (resolved_mutation_op.type == MutationOpType::kInsert ||
+               resolved_mutation_op.type == MutationOpType::kInsertOrUpdate)) {
             std::vector<KeyRange> split_key_ranges;
-            auto& deleted_key_ranges = deleted_key_ranges_by_table_[table_name];
-            for (auto it = deleted_key_ranges.begin();
-                 it != deleted_key_ranges.end();) {
+            for (auto it = deleted_key_ranges->begin();
+                 it != deleted_key_ranges->end();) {
               if (SplitKeyRangeAndAppend(*it, resolved_mutation_op.keys[i],
                                          &split_key_ranges)) {
-                it = deleted_key_ranges.erase(it);
+                it = deleted_key_ranges->erase(it);
               } else {
                 ++it;
               }
             }
             // Insert split key ranges back into the list of deleted key ranges.
             for (const KeyRange& key_range : split_key_ranges) {
-              deleted_key_ranges.push_back(key_range);
+              deleted_key_ranges->push_back(key_range);
             }
           }
-          if (resolved_mutation_op.type == MutationOpType::kUpdate) {
-            for (const KeyRange& key_range :
-                 deleted_key_ranges_by_table_[table_name]) {
+          if (deleted_key_ranges != nullptr &&
+              resolved_mutation_op.type == MutationOpType::kUpdate) {
+            for (const KeyRange& key_range : *deleted_key_ranges) {
               if (key_range.Contains(resolved_mutation_op.keys[i])) {
                 return error::UpdateDeletedRowInTransaction(
                     table_name, resolved_mutation_op.keys[i].DebugString());
               }
             }
           }
+          // The resolved keys and rows are not needed after they are
+          // flattened, so they are moved into the write ops.
           ZETASQL_ASSIGN_OR_RETURN(
               std::vector<WriteOp> write_ops,
-              FlattenNonDeleteOpRow(
-                  resolved_mutation_op.type, resolved_mutation_op.table,
-                  resolved_mutation_op.columns, resolved_mutation_op.keys[i],
-                  resolved_mutation_op.rows[i], transaction_store_.get()));
-
-          ZETASQL_RETURN_IF_ERROR(ProcessWriteOps(write_ops));
+              FlattenNonDeleteOpRow(resolved_mutation_op.type,
+                                    resolved_mutation_op.table,
+                                    resolved_mutation_op.columns,
+                                    std::move(resolved_mutation_op.keys[i]),
+                                    std::move(resolved_mutation_op.rows[i]),
+                                    transaction_store_.get()));
+
+          ZETASQL_RETURN_IF_ERROR(ProcessWriteOps(std::move(write_ops)));
         }
       }
     }
@@ -509,14 +734,74 @@ absl::Status ReadWriteTransaction::Commit() {
       return error::AbortReadWriteTransactionOnFirstCommit(id_);
     }
 
+    // Writes are rejected while the database is over its memory quota, before
+    // a commit timestamp is reserved. Deletes are not, so that a database which
+    // is over quota can be shrunk. The check precedes the change stream
+    // records, which deletes insert too.
+    if (transaction_store_->HasBufferedInsertsOrUpdates()) {
+      ZETASQL_RETURN_IF_ERROR(base_storage_->CheckMemoryQuota());
+    }
+
+    // Buffer the change stream records of the whole transaction, built from
+    // the mods collected by every statement.
+    action_context_->change_stream_effects()->BuildMutation();
+    for (const WriteOp& op :
+         action_context_->change_stream_effects()->GetWriteOps()) {
+      ZETASQL_RETURN_IF_ERROR(transaction_store_->BufferWriteOp(op));
+    }
+
+    // Announce the commit to the change streams written by this transaction
+    // before picking its commit timestamp, so that change stream queries do not
+    // take the change streams to have no records up to a later timestamp in the
+    // meantime.
+    absl::flat_hash_set<std::string> change_streams;
+    if (change_stream_notifier_ != nullptr) {
+      for (const Table* table : transaction_store_->BufferedTables()) {
+        const ChangeStream* change_stream = table->owner_change_stream();
+        if (change_stream != nullptr) {
+          change_streams.insert(change_stream->Name());
+        }
+      }
+      for (const std::string& change_stream : change_streams) {
+        change_stream_notifier_->BeginCommit(change_stream);
+      }
+    }
+    auto end_change_stream_commits =
+        [&](std::optional<absl::Time> commit_timestamp) {
+          for (const std::string& change_stream : change_streams) {
+            change_stream_notifier_->EndCommit(change_stream, commit_timestamp);
+          }
+        };
+
     // Pick a commit timestamp.
-    ZETASQL_ASSIGN_OR_RETURN(commit_timestamp_, lock_handle_->ReserveCommitTimestamp());
+    absl::StatusOr<absl::Time> commit_timestamp =
+        lock_handle_->ReserveCommitTimestamp();
+    if (!commit_timestamp.ok()) {
+      end_change_stream_commits(std::nullopt);
+      return commit_timestamp.status();
+    }
+    commit_timestamp_ = *commit_timestamp;
+
+    // The buffered rows are moved rather than copied out of the store, which
+    // is not read again once the commit timestamp has been picked.
+    std::vector<WriteOp> write_ops = transaction_store_->TakeBufferedOps();
 
     // Write the mutations to the base storage.
-    absl::Status flush_status = FlushWriteOpsToStorage(
-        transaction_store_->GetBufferedOps(), base_storage_, commit_timestamp_);
-    ZETASQL_RETURN_IF_ERROR(lock_handle_->MarkCommitted());
-    if (!flush_status.ok()) {
+    absl::Status flush_status;
+    {
+      tracing::ScopedSpan span("Commit.Flush");
+      span.SetAttribute("write_ops", absl::StrCat(write_ops.size()));
+      flush_status =
+          FlushWriteOpsToStorage(std::move(write_ops), base_storage_,
+                                 commit_timestamp_, write_ahead_log_,
+                                 statistics_, commit_timestamp_index_);
+      span.SetStatus(flush_status);
+    }
+    // A flush which failed part way may have written some of the records.
+    absl::Status mark_committed_status = lock_handle_->MarkCommitted();
+    if (!mark_committed_status.ok() || !flush_status.ok()) {
+      end_change_stream_commits(commit_timestamp_);
+      ZETASQL_RETURN_IF_ERROR(mark_committed_status);
       return flush_status;
     }
 
@@ -526,6 +811,10 @@ absl::Status ReadWriteTransaction::Commit() {
     // Unlock all locks.
     lock_handle_->UnlockAll();
 
+    // Wake up change stream queries waiting for the records written by this
+    // transaction, which are now visible to reads after commit_timestamp_.
+    end_change_stream_commits(commit_timestamp_);
+
     return absl::OkStatus();
   });
 }
@@ -31,12 +31,17 @@
 #include "backend/actions/manager.h"
 #include "backend/common/case.h"
 #include "backend/common/ids.h"
+#include "backend/database/change_stream/change_stream_notifier.h"
+#include "backend/database/write_ahead_log.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
 #include "backend/locking/handle.h"
 #include "backend/locking/manager.h"
+#include "backend/query/transaction_stats_aggregator.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/table.h"
+#include "backend/schema/catalog/table_statistics.h"
+#include "backend/storage/commit_timestamp_index.h"
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/storage/storage.h"
 #include "backend/transaction/actions.h"
@@ -81,7 +86,13 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
                        TransactionID transaction_id, Clock* clock,
                        Storage* storage, LockManager* lock_manager,
                        const VersionedCatalog* const versioned_catalog,
-                       ActionManager* action_manager);
+                       ActionManager* action_manager,
+                       ChangeStreamNotifier* change_stream_notifier = nullptr,
+                       WriteAheadLog* write_ahead_log = nullptr,
+                       ReadPlanCache* read_plan_cache = nullptr,
+                       TransactionStatsAggregator* txn_stats = nullptr,
+                       DatabaseStatistics* statistics = nullptr,
+                       CommitTimestampIndex* commit_timestamp_index = nullptr);
 
   absl::Status Read(const ReadArg& read_arg,
                     std::unique_ptr<RowCursor>* cursor) override
@@ -98,6 +109,18 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
 
   absl::StatusOr<absl::Time> GetCommitTimestamp() ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Releases the locks, buffered writes and schema of this transaction, which
+  // is done with, so that it can be reused by Reinitialize. Database pools
+  // these to save building a new transaction for every single-use transaction.
+  void Recycle() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Prepares a recycled transaction to run as a new transaction, as if it had
+  // been constructed with the given arguments.
+  void Reinitialize(const ReadWriteOptions& options,
+                    const RetryState& retry_state,
+                    TransactionID transaction_id, LockManager* lock_manager)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   const State state() const ABSL_LOCKS_EXCLUDED(mu_) {
     absl::MutexLock lock(&mu_);
     return state_;
@@ -118,6 +141,14 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
     return retry_state_;
   }
 
+  // Returns how long the committed attempt of this transaction ran, from its
+  // first operation to its commit, holding its locks throughout. Zero until
+  // the transaction commits.
+  absl::Duration committed_attempt_duration() const ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    return committed_attempt_duration_;
+  }
+
  private:
   friend class TransactionOpsProcessor;
 
@@ -131,14 +162,20 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
 
   absl::Status GuardedCall(OpType op, const std::function<absl::Status()>& fn)
       ABSL_LOCKS_EXCLUDED(mu_);
-  absl::Status ProcessWriteOps(const std::vector<WriteOp>& write_ops);
+  absl::Status ProcessWriteOps(std::vector<WriteOp> write_ops);
 
   // Resets the transaction and marks it Active.
   void Reset();
 
+  // Records the attempt in progress with txn_stats_, if set, as having ended
+  // with the given outcome.
+  void RecordAttempt(TransactionOutcome outcome, absl::Duration commit_latency)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Apply the constraint checks and effects to the writes.
   absl::Status ApplyValidators(const WriteOp& op);
   absl::Status ApplyEffectors(const WriteOp& op);
+  absl::Status ApplyBatchEffectors(const std::vector<WriteOp>& ops);
   absl::Status ApplyStatementVerifiers();
 
   // Converts input non-delete MutationOp into ResolvedMutationOp after
@@ -158,8 +195,9 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
   // Initial state of the transaction between retry attempts.
   RetryState retry_state_ ABSL_GUARDED_BY(mu_);
 
-  // ID for this transaction.
-  const TransactionID id_;
+  // ID for this transaction. Only changed by Reinitialize, before the
+  // transaction is handed out again.
+  TransactionID id_;
 
   // System-wide monotonic clock.
   Clock* clock_;
@@ -179,6 +217,34 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
 
   // Action Manager for the transaction.
   ActionManager* action_manager_;
+
+  // Notified of commits which write change stream records. May be null.
+  ChangeStreamNotifier* change_stream_notifier_;
+
+  // Log to which the writes of the transaction are appended on commit. May be
+  // null.
+  WriteAheadLog* write_ahead_log_;
+
+  // Cache of the tables and columns resolved for reads. May be null.
+  ReadPlanCache* read_plan_cache_;
+
+  // Statistics to which the attempts of this transaction are reported. May be
+  // null.
+  TransactionStatsAggregator* txn_stats_;
+
+  // Statistics of the tables, updated with the writes of this transaction on
+  // commit. May be null.
+  DatabaseStatistics* statistics_;
+
+  // Index of the keys written by each commit, to which the writes of this
+  // transaction are added on commit. May be null.
+  CommitTimestampIndex* commit_timestamp_index_;
+
+  // The shape of the attempt in progress, and the time it started.
+  TransactionExecutionSample attempt_sample_ ABSL_GUARDED_BY(mu_);
+  absl::Time attempt_start_ ABSL_GUARDED_BY(mu_);
+  absl::Duration committed_attempt_duration_ ABSL_GUARDED_BY(mu_);
+
   ActionRegistry* action_registry_;
   std::unique_ptr<ActionContext> action_context_;
 
@@ -192,7 +258,8 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
   State state_ ABSL_GUARDED_BY(mu_) = State::kUninitialized;
 
   // The schema that is in effect at the timestamp picked for this transaction.
-  const Schema* schema_ ABSL_GUARDED_BY(mu_);
+  // The reference keeps the schema from being garbage collected.
+  std::shared_ptr<const Schema> schema_ ABSL_GUARDED_BY(mu_);
 
   CaseInsensitiveStringMap<std::vector<KeyRange>> deleted_key_ranges_by_table_;
 };
@@ -23,6 +23,8 @@
 #include <utility>
 #include <vector>
 
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
@@ -38,6 +40,9 @@
 #include "backend/datamodel/key_range.h"
 #include "backend/datamodel/key_set.h"
 #include "backend/datamodel/value.h"
+#include "backend/schema/catalog/change_stream.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/storage/in_memory_storage.h"
 #include "backend/transaction/actions.h"
@@ -53,7 +58,10 @@ namespace emulator {
 namespace backend {
 namespace {
 
+using zetasql::types::StringType;
+using zetasql::types::TimestampType;
 using zetasql::values::Int64;
+using zetasql::values::Null;
 using zetasql::values::String;
 using zetasql_base::testing::StatusIs;
 
@@ -244,6 +252,34 @@ TEST_F(ReadWriteTransactionTest, Commit) {
               IsOkAndHoldsRows({{String("value")}}));
 }
 
+TEST_F(ReadWriteTransactionTest, CommitFailsWhileOverMemoryQuota) {
+  storage_ = std::make_unique<InMemoryStorage>(/*interner=*/nullptr,
+                                               /*memory_quota_bytes=*/1);
+  Mutation m1;
+  m1.AddWriteOp(MutationOpType::kInsert, "test_table",
+               {"int64_col", "string_col"}, {{Int64(1), String("value")}});
+  auto txn1 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn1->Write(m1));
+  ZETASQL_EXPECT_OK(txn1->Commit());
+
+  Mutation m2;
+  m2.AddWriteOp(MutationOpType::kInsert, "test_table",
+               {"int64_col", "string_col"}, {{Int64(2), String("value")}});
+  auto txn2 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn2->Write(m2));
+  EXPECT_THAT(
+      txn2->Commit(),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kResourceExhausted));
+  ZETASQL_EXPECT_OK(txn2->Rollback());
+
+  // Deletes are still accepted.
+  Mutation m3;
+  m3.AddDeleteOp("test_table", KeySet(Key({Int64(1)})));
+  auto txn3 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn3->Write(m3));
+  ZETASQL_EXPECT_OK(txn3->Commit());
+}
+
 TEST_F(ReadWriteTransactionTest, CommitWithNoBufferedMutation) {
   absl::Time before_commit_timestamp_ = clock_.Now();
 
@@ -449,6 +485,50 @@ TEST_F(ReadWriteTransactionTest, ConcurrentSchemaUpdatesWithTransactions) {
   EXPECT_THAT(txn->Write(m), StatusIs(absl::StatusCode::kAborted));
 }
 
+TEST_F(ReadWriteTransactionTest, RecycledTransactionReleasesItsSchema) {
+  auto txn = CreateReadWriteTransaction();
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "test_table",
+               {"int64_col", "string_col"}, {{Int64(1), String("value")}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  auto schema = test::CreateSchemaFromDDL(
+                    {
+                        R"(
+                          CREATE TABLE new_table (
+                            int64_col INT64 NOT NULL,
+                            string_col STRING(MAX)
+                          ) PRIMARY KEY (int64_col)
+                        )",
+                    },
+                    type_factory_.get())
+                    .value();
+  ZETASQL_ASSERT_OK(versioned_catalog_->AddSchema(clock_.Now(), std::move(schema)));
+  action_manager_->AddActionsForSchema(versioned_catalog_->GetLatestSchema(),
+                                       /*function_catalog=*/nullptr,
+                                       type_factory_.get());
+
+  // The committed transaction still holds on to the schema it used.
+  EXPECT_TRUE(
+      versioned_catalog_->CollectGarbage(absl::InfiniteFuture()).empty());
+
+  txn->Recycle();
+  EXPECT_EQ(versioned_catalog_->CollectGarbage(absl::InfiniteFuture()).size(),
+            1);
+  EXPECT_EQ(versioned_catalog_->num_schemas(), 1);
+
+  // Once reused, the transaction runs against the latest schema.
+  txn->Reinitialize(ReadWriteOptions(), RetryState(), ++id_counter_,
+                    lock_manager_.get());
+  Mutation new_table_mutation;
+  new_table_mutation.AddWriteOp(MutationOpType::kInsert, "new_table",
+                                {"int64_col", "string_col"},
+                                {{Int64(1), String("value")}});
+  ZETASQL_ASSERT_OK(txn->Write(new_table_mutation));
+  ZETASQL_EXPECT_OK(txn->Commit());
+}
+
 TEST_F(ReadWriteTransactionTest, CommitWithNoEffectiveChangesToDatabase) {
   // Buffer mutations.
   Mutation m;
@@ -631,6 +711,31 @@ TEST_F(ReadWriteTransactionTest, IndexDeleteAreIdempotentTest) {
               IsOkAndHoldsRows({}));
 }
 
+TEST_F(ReadWriteTransactionTest, IndexCollapsesRepeatedChangesToARow) {
+  // The index entry of row 1 is deleted and re-inserted by each update, and
+  // ends up back at its original key.
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "test_table",
+               {"int64_col", "string_col"},
+               {{Int64(1), String("a")}, {Int64(2), String("b")}});
+  m.AddWriteOp(MutationOpType::kUpdate, "test_table",
+               {"int64_col", "string_col"}, {{Int64(1), String("c")}});
+  m.AddWriteOp(MutationOpType::kUpdate, "test_table",
+               {"int64_col", "string_col"}, {{Int64(1), String("a")}});
+
+  auto txn1 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn1->Write(m));
+  EXPECT_THAT(
+      ReadAllUsingIndex(txn1.get(), "test_index", {"string_col", "int64_col"}),
+      IsOkAndHoldsRows({{String("b"), Int64(2)}, {String("a"), Int64(1)}}));
+  ZETASQL_EXPECT_OK(txn1->Commit());
+
+  auto txn2 = CreateReadWriteTransaction();
+  EXPECT_THAT(
+      ReadAllUsingIndex(txn2.get(), "test_index", {"string_col", "int64_col"}),
+      IsOkAndHoldsRows({{String("b"), Int64(2)}, {String("a"), Int64(1)}}));
+}
+
 TEST_F(ReadWriteTransactionTest, IndexUniquenessFailTest) {
   // Buffer two mutations that should violate index uniqueness constraint.
   Mutation m;
@@ -669,6 +774,31 @@ TEST_F(ReadWriteTransactionTest, InsertSucceeds) {
               IsOkAndHoldsRows({{Int64(1), String("val1")}}));
 }
 
+TEST_F(ReadWriteTransactionTest, BlindWritesInsertNewRowsAndUpdateExisting) {
+  Mutation m1;
+  m1.AddWriteOp(MutationOpType::kInsert, "test_table",
+                {"int64_col", "string_col"}, {{Int64(1), String("val1")}});
+  auto txn1 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn1->Write(m1));
+  ZETASQL_EXPECT_OK(txn1->Commit());
+
+  Mutation m2;
+  m2.AddWriteOp(MutationOpType::kInsertOrUpdate, "test_table",
+                {"int64_col", "string_col"},
+                {{Int64(1), String("val2")}, {Int64(2), String("val3")}});
+  m2.AddWriteOp(MutationOpType::kReplace, "test_table", {"int64_col"},
+                {{Int64(2)}, {Int64(3)}});
+  auto txn2 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn2->Write(m2));
+  ZETASQL_EXPECT_OK(txn2->Commit());
+
+  auto txn3 = CreateReadWriteTransaction();
+  EXPECT_THAT(ReadAll(txn3.get(), {"int64_col", "string_col"}),
+              IsOkAndHoldsRows({{Int64(1), String("val2")},
+                                {Int64(2), Null(StringType())},
+                                {Int64(3), Null(StringType())}}));
+}
+
 TEST_F(ReadWriteTransactionTest, CannotInsertWithEmptyColumns) {
   Mutation m;
   m.AddWriteOp(MutationOpType::kInsert, "test_table", {}, {});
@@ -712,6 +842,52 @@ TEST_F(ReadWriteTransactionTest, CannotInsertWithDuplicateColumns) {
   EXPECT_THAT(txn1->Write(m), StatusIs(absl::StatusCode::kInvalidArgument));
 }
 
+class ReadWriteTransactionChangeStreamTest : public ReadWriteTransactionTest {
+ public:
+  absl::StatusOr<std::unique_ptr<const backend::Schema>> GetSchema() override {
+    return test::CreateSchemaFromDDL(
+        {
+            R"sql(
+                  CREATE TABLE test_table (
+                    int64_col INT64 NOT NULL,
+                    string_col STRING(MAX),
+                  ) PRIMARY KEY (int64_col)
+                )sql",
+            R"sql(
+                  CREATE CHANGE STREAM test_stream FOR ALL
+                )sql"},
+        type_factory_.get());
+  }
+};
+
+TEST_F(ReadWriteTransactionChangeStreamTest,
+       DeletesCommitWhileOverMemoryQuota) {
+  storage_ = std::make_unique<InMemoryStorage>(/*interner=*/nullptr,
+                                               /*memory_quota_bytes=*/1);
+  const Schema* schema = versioned_catalog_->GetSchema(absl::InfiniteFuture());
+  const Table* table = schema->FindTable("test_table");
+  const Table* partition_table =
+      schema->FindChangeStream("test_stream")->change_stream_partition_table();
+  const absl::Time timestamp = clock_.Now();
+  ZETASQL_ASSERT_OK(storage_->Write(
+      timestamp, partition_table->id(), Key({String("token")}),
+      {partition_table->FindColumn("partition_token")->id(),
+       partition_table->FindColumn("end_time")->id()},
+      {String("token"), Null(TimestampType())}));
+  ZETASQL_ASSERT_OK(storage_->Write(timestamp, table->id(), Key({Int64(1)}),
+                            {table->FindColumn("int64_col")->id(),
+                             table->FindColumn("string_col")->id()},
+                            {Int64(1), String("value")}));
+
+  // The delete also inserts a change stream record, which is not held to the
+  // quota.
+  Mutation m;
+  m.AddDeleteOp("test_table", KeySet(Key({Int64(1)})));
+  auto txn = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn->Write(m));
+  ZETASQL_EXPECT_OK(txn->Commit());
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
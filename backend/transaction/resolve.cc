@@ -24,7 +24,10 @@
 
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/access/write.h"
 #include "backend/common/case.h"
 #include "backend/common/rows.h"
@@ -195,8 +198,11 @@ Key ComputeKey(const ValueList& row,
   return key;
 }
 
-absl::StatusOr<ResolvedReadArg> ResolveReadArg(const ReadArg& read_arg,
-                                               const Schema* schema) {
+namespace {
+
+// Resolves the table and columns of read_arg, leaving its key ranges empty.
+absl::StatusOr<ResolvedReadArg> ResolveReadTableAndColumns(
+    const ReadArg& read_arg, const Schema* schema) {
   const Table* read_table;
   if (!read_arg.change_stream_for_partition_table.empty()) {
     if (schema->FindChangeStream(read_arg.change_stream_for_partition_table) ==
@@ -233,6 +239,9 @@ absl::StatusOr<ResolvedReadArg> ResolveReadArg(const ReadArg& read_arg,
       return error::IndexTableDoesNotMatchBaseTable(
           read_table->Name(), index->indexed_table()->Name(), index->Name());
     }
+    if (index->is_write_only()) {
+      return error::IndexNotReadable(index->Name());
+    }
     read_table = index->index_data_table();
   }
 
@@ -257,14 +266,78 @@ absl::StatusOr<ResolvedReadArg> ResolveReadArg(const ReadArg& read_arg,
     columns.push_back(column);
   }
 
+  ResolvedReadArg resolved_read_arg;
+  resolved_read_arg.table = read_table;
+  resolved_read_arg.columns = std::move(columns);
+  return resolved_read_arg;
+}
+
+}  // namespace
+
+absl::StatusOr<ResolvedReadArg> ReadPlanCache::Resolve(const ReadArg& read_arg,
+                                                       const Schema* schema) {
+  // Names cannot contain a NUL character, so it separates them unambiguously.
+  PlanKey key(schema,
+              absl::StrJoin({read_arg.table, read_arg.index,
+                             read_arg.change_stream_for_partition_table,
+                             read_arg.change_stream_for_data_table},
+                            absl::string_view("\0", 1)));
+  for (const std::string& column_name : read_arg.columns) {
+    absl::StrAppend(&key.second, absl::string_view("\0", 1), column_name);
+  }
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    auto itr = plans_.find(key);
+    if (itr != plans_.end()) {
+      return itr->second;
+    }
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(ResolvedReadArg plan,
+                   ResolveReadTableAndColumns(read_arg, schema));
+  absl::MutexLock lock(&mu_);
+  if (plans_.size() >= kMaxPlans) {
+    plans_.clear();
+  }
+  plans_.emplace(std::move(key), plan);
+  return plan;
+}
+
+void ReadPlanCache::EraseSchema(const Schema* schema) {
+  absl::MutexLock lock(&mu_);
+  absl::erase_if(plans_, [schema](const auto& entry) {
+    return entry.first.first == schema;
+  });
+}
+
+absl::StatusOr<ResolvedReadArg> ResolveReadArg(const ReadArg& read_arg,
+                                               const Schema* schema,
+                                               ReadPlanCache* cache) {
+  ZETASQL_ASSIGN_OR_RETURN(ResolvedReadArg resolved_read_arg,
+                   cache != nullptr
+                       ? cache->Resolve(read_arg, schema)
+                       : ResolveReadTableAndColumns(read_arg, schema));
+  const Table* read_table = resolved_read_arg.table;
+
   // Convert key set to canonicalized key ranges.
   std::vector<KeyRange> key_ranges;
   CanonicalizeKeySetForTable(read_arg.key_set, read_table, &key_ranges);
 
-  ResolvedReadArg resolved_read_arg;
-  resolved_read_arg.table = read_table;
+  // A range is a single row if it is the point range of a full primary key.
+  std::vector<Key> point_keys;
+  point_keys.reserve(key_ranges.size());
+  for (const KeyRange& key_range : key_ranges) {
+    const Key& start_key = key_range.start_key();
+    if (start_key.NumColumns() != read_table->primary_key().size() ||
+        !(key_range.limit_key() == start_key.ToPrefixLimit())) {
+      point_keys.clear();
+      break;
+    }
+    point_keys.push_back(start_key);
+  }
+
   resolved_read_arg.key_ranges = std::move(key_ranges);
-  resolved_read_arg.columns = columns;
+  resolved_read_arg.point_keys = std::move(point_keys);
   return resolved_read_arg;
 }
 
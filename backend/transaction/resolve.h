@@ -18,12 +18,19 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_RESOLVE_H_
 
 #include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/access/write.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/table.h"
 
@@ -41,6 +48,11 @@ struct ResolvedReadArg {
   // Canonicalized (disjoint and closed-open) key ranges to read.
   std::vector<KeyRange> key_ranges;
 
+  // The keys of key_ranges, in the same order, if every range is a single row
+  // of the table. Empty otherwise. Such reads are answered by a lookup of each
+  // key rather than a scan of each range.
+  std::vector<Key> point_keys;
+
   // Set of columns to read.
   std::vector<const Column*> columns;
 };
@@ -73,10 +85,41 @@ Key ComputeKey(const ValueList& row,
                absl::Span<const KeyColumn* const> primary_key,
                const std::vector<std::optional<int>>& key_indices);
 
+// A cache of the table and columns resolved for reads, keyed by the schema and
+// the names of the table, index and columns which a read refers to. Schemas are
+// immutable, so a cached resolution stays valid for as long as its schema is
+// alive, and the cache must not outlive the schemas it is used with.
+//
+// This class is thread-safe.
+class ReadPlanCache {
+ public:
+  // Returns the resolution of read_arg against schema with no key ranges, from
+  // the cache if the same read was resolved before. Reads which fail to resolve
+  // are not cached.
+  absl::StatusOr<ResolvedReadArg> Resolve(const ReadArg& read_arg,
+                                          const Schema* schema)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Drops the reads resolved against schema, before it is destroyed.
+  void EraseSchema(const Schema* schema) ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // The cache is cleared once it holds this many reads, which bounds its size
+  // without tracking recency.
+  static constexpr int kMaxPlans = 1024;
+
+  using PlanKey = std::pair<const Schema*, std::string>;
+
+  absl::Mutex mu_;
+  absl::flat_hash_map<PlanKey, ResolvedReadArg> plans_ ABSL_GUARDED_BY(mu_);
+};
+
 // Converts input ReadArg into ResolveReadArg after validating that input table,
-// index and columns are valid schema objects.
+// index and columns are valid schema objects. If cache is not null, the table
+// and columns are resolved through it.
 absl::StatusOr<ResolvedReadArg> ResolveReadArg(const ReadArg& read_arg,
-                                               const Schema* schema);
+                                               const Schema* schema,
+                                               ReadPlanCache* cache = nullptr);
 
 // Extracts the primary key column indices from the given list of columns. The
 // returned indices will be in the order specified by the primary key. Nullable
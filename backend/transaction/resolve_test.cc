@@ -105,6 +105,56 @@ TEST_F(ResolveTest, CanResolveTableAndColumnsFromReadArg) {
               testing::ElementsAre(int_col_, string_col_));
 }
 
+TEST_F(ResolveTest, ResolvesPointKeysOnlyIfEveryRangeIsARow) {
+  backend::ReadArg read_arg;
+  read_arg.table = "TestTable";
+  read_arg.columns = {"Int64Col"};
+  read_arg.key_set.AddKey(Key({Int64(3)}));
+  read_arg.key_set.AddKey(Key({Int64(1)}));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto resolved_read_arg,
+                       ResolveReadArg(read_arg, schema_.get()));
+  EXPECT_THAT(resolved_read_arg.point_keys,
+              testing::ElementsAre(Key({Int64(1)}), Key({Int64(3)})));
+
+  read_arg.key_set.AddRange(
+      KeyRange::ClosedOpen(Key({Int64(5)}), Key({Int64(10)})));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(resolved_read_arg,
+                       ResolveReadArg(read_arg, schema_.get()));
+  EXPECT_TRUE(resolved_read_arg.point_keys.empty());
+}
+
+TEST_F(ResolveTest, ResolvesReadsThroughPlanCache) {
+  ReadPlanCache cache;
+  backend::ReadArg read_arg;
+  read_arg.table = "TestTable";
+  read_arg.columns = {"Int64Col", "StringCol"};
+
+  // The key set is resolved for each read, even if the plan is cached.
+  for (int i = 0; i < 2; ++i) {
+    read_arg.key_set = KeySet(Key({Int64(i)}));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto resolved_read_arg,
+                         ResolveReadArg(read_arg, schema_.get(), &cache));
+    EXPECT_EQ(resolved_read_arg.table, test_table_);
+    EXPECT_THAT(resolved_read_arg.columns,
+                testing::ElementsAre(int_col_, string_col_));
+    EXPECT_THAT(resolved_read_arg.point_keys,
+                testing::ElementsAre(Key({Int64(i)})));
+  }
+
+  // Reads of other columns are resolved separately, and failures are reported
+  // every time.
+  read_arg.columns = {"Int64Col"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto resolved_read_arg,
+                       ResolveReadArg(read_arg, schema_.get(), &cache));
+  EXPECT_THAT(resolved_read_arg.columns, testing::ElementsAre(int_col_));
+  read_arg.columns = {"NonExistentCol"};
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_THAT(ResolveReadArg(read_arg, schema_.get(), &cache),
+                StatusIs(absl::StatusCode::kNotFound));
+  }
+}
+
 TEST_F(ResolveTest, CanResolveChangeStreamInternalPartitionTableFromReadArg) {
   backend::ReadArg read_arg;
   read_arg.change_stream_for_partition_table = "ChangeStream_TestTable";
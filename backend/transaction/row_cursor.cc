@@ -16,6 +16,8 @@
 
 #include "backend/transaction/row_cursor.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 
 #include "backend/storage/iterator.h"
@@ -26,10 +28,14 @@ namespace emulator {
 namespace backend {
 
 bool StorageIteratorRowCursor::Next() {
+  if (limit_ > 0 && num_rows_ == limit_) {
+    return false;
+  }
   // Loop over underlying iterators until a Next value is obtained.
   while (current_ < iterators_.size()) {
     if (iterators_.at(current_)->Next()) {
       // Current iterator yeilded a next element.
+      ++num_rows_;
       return true;
     }
     if (iterators_.at(current_)->Status().ok()) {
@@ -58,6 +64,35 @@ const zetasql::Value StorageIteratorRowCursor::ColumnValue(int i) const {
   return value;
 }
 
+bool StorageIteratorRowCursor::NextBatch(int64_t max_rows, RowBatch* batch) {
+  const int num_columns = NumColumns();
+  batch->Reset(num_columns);
+  if (limit_ > 0) {
+    max_rows = std::min(max_rows, limit_ - num_rows_);
+  }
+  // Values are copied straight from the storage iterators, without going
+  // through Next() and ColumnValue() for every row and column.
+  while (batch->num_rows < max_rows && current_ < iterators_.size()) {
+    StorageIterator* itr = iterators_[current_].get();
+    if (!itr->Next()) {
+      if (!itr->Status().ok()) {
+        break;
+      }
+      // Current iterator is exhausted, try next iterator.
+      ++current_;
+      continue;
+    }
+    for (int i = 0; i < num_columns; ++i) {
+      const zetasql::Value& value = itr->ColumnValue(i);
+      batch->columns[i].push_back(
+          value.is_valid() ? value : zetasql::Value::Null(ColumnType(i)));
+    }
+    ++batch->num_rows;
+    ++num_rows_;
+  }
+  return batch->num_rows > 0;
+}
+
 int StorageIteratorRowCursor::NumColumns() const { return columns_.size(); }
 
 const std::string StorageIteratorRowCursor::ColumnName(int i) const {
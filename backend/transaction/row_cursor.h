@@ -17,6 +17,10 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_ROW_CURSOR_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_ROW_CURSOR_H_
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "backend/access/read.h"
 #include "backend/schema/catalog/table.h"
 #include "backend/storage/in_memory_iterator.h"
@@ -27,15 +31,18 @@ namespace emulator {
 namespace backend {
 
 // StorageIteratorRowCursor is an implementation of RowCursor that reads from
-// storage using an array of storage iterators.
+// storage using an array of storage iterators. If limit is positive, the cursor
+// ends after that many rows without advancing the iterators any further.
 //
 // This class is not thread-safe.
 class StorageIteratorRowCursor : public RowCursor {
  public:
   StorageIteratorRowCursor(
       std::vector<std::unique_ptr<StorageIterator>> iterators,
-      std::vector<const Column*> columns)
-      : iterators_(std::move(iterators)), columns_(std::move(columns)) {}
+      std::vector<const Column*> columns, int64_t limit = 0)
+      : iterators_(std::move(iterators)),
+        columns_(std::move(columns)),
+        limit_(limit) {}
 
   // Implementation of the RowCursor interface
   bool Next() override;
@@ -44,6 +51,7 @@ class StorageIteratorRowCursor : public RowCursor {
   const std::string ColumnName(int i) const override;
   const zetasql::Value ColumnValue(int i) const override;
   const zetasql::Type* ColumnType(int i) const override;
+  bool NextBatch(int64_t max_rows, RowBatch* batch) override;
 
  private:
   const std::vector<std::unique_ptr<StorageIterator>> iterators_;
@@ -53,6 +61,12 @@ class StorageIteratorRowCursor : public RowCursor {
 
   // Set of columns to read.
   const std::vector<const Column*> columns_;
+
+  // The maximum number of rows to return, if positive.
+  const int64_t limit_;
+
+  // The number of rows returned so far.
+  int64_t num_rows_ = 0;
 };
 
 }  // namespace backend
@@ -182,6 +182,25 @@ TEST_F(StorageIteratorRowCursorTest, CreateWithMultiRowIterators) {
   ZETASQL_EXPECT_OK(rowc.Status());
 }
 
+TEST_F(StorageIteratorRowCursorTest, StopsAtLimit) {
+  std::vector<std::pair<Key, std::vector<Value>>> row_values = {
+      {Key({Int64(1)}), {Int64(10), String("test_string1")}},
+      {Key({Int64(2)}), {Int64(20), String("test_string2")}},
+      {Key({Int64(3)}), {Int64(30), String("test_string3")}}};
+  iterators_.push_back(
+      std::make_unique<FixedRowStorageIterator>(std::move(row_values)));
+
+  StorageIteratorRowCursor rowc(std::move(iterators_), std::move(columns_),
+                                /*limit=*/2);
+
+  ASSERT_TRUE(rowc.Next());
+  EXPECT_EQ(Int64(10), rowc.ColumnValue(0));
+  ASSERT_TRUE(rowc.Next());
+  EXPECT_EQ(Int64(20), rowc.ColumnValue(0));
+  EXPECT_FALSE(rowc.Next());
+  ZETASQL_EXPECT_OK(rowc.Status());
+}
+
 TEST_F(StorageIteratorRowCursorTest, CreateRowCursorMultipleMultiRowIterators) {
   std::vector<std::pair<Key, std::vector<Value>>> row_values = {
       {Key({Int64(1)}), {Int64(10), String("test_string1")}},
@@ -218,6 +237,38 @@ TEST_F(StorageIteratorRowCursorTest, CreateRowCursorMultipleMultiRowIterators) {
   ZETASQL_EXPECT_OK(rowc.Status());
 }
 
+TEST_F(StorageIteratorRowCursorTest, ReadsBatchesAcrossIteratorsUpToLimit) {
+  std::vector<std::pair<Key, std::vector<Value>>> row_values = {
+      {Key({Int64(1)}), {Int64(10), String("test_string1")}},
+      {Key({Int64(2)}), {Int64(20), zetasql::Value()}}};
+  iterators_.push_back(
+      std::make_unique<FixedRowStorageIterator>(std::move(row_values)));
+  iterators_.push_back(std::make_unique<FixedRowStorageIterator>());
+  row_values = {{Key({Int64(3)}), {Int64(30), String("test_string3")}},
+                {Key({Int64(4)}), {Int64(40), String("test_string4")}}};
+  iterators_.push_back(
+      std::make_unique<FixedRowStorageIterator>(std::move(row_values)));
+
+  StorageIteratorRowCursor rowc(std::move(iterators_), std::move(columns_),
+                                /*limit=*/3);
+
+  RowBatch batch;
+  ASSERT_TRUE(rowc.NextBatch(/*max_rows=*/2, &batch));
+  EXPECT_EQ(batch.num_rows, 2);
+  EXPECT_THAT(batch.columns[0], testing::ElementsAre(Int64(10), Int64(20)));
+  EXPECT_THAT(batch.columns[1],
+              testing::ElementsAre(String("test_string1"),
+                                   zetasql::values::NullString()));
+
+  // The batch stops at the limit of the cursor.
+  ASSERT_TRUE(rowc.NextBatch(/*max_rows=*/10, &batch));
+  EXPECT_EQ(batch.num_rows, 1);
+  EXPECT_THAT(batch.columns[0], testing::ElementsAre(Int64(30)));
+  EXPECT_FALSE(rowc.NextBatch(/*max_rows=*/10, &batch));
+  EXPECT_EQ(batch.num_rows, 0);
+  ZETASQL_EXPECT_OK(rowc.Status());
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
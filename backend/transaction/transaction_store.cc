@@ -23,11 +23,13 @@
 #include <vector>
 
 #include "zetasql/public/value.h"
+#include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "backend/actions/ops.h"
@@ -40,7 +42,6 @@
 #include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/index.h"
 #include "backend/schema/catalog/table.h"
-#include "backend/storage/in_memory_iterator.h"
 #include "backend/storage/iterator.h"
 #include "backend/transaction/commit_timestamp.h"
 #include "common/errors.h"
@@ -53,24 +54,174 @@ namespace backend {
 
 namespace {
 
-bool SortByKey(const FixedRowStorageIterator::Row& a,
-               const FixedRowStorageIterator::Row& b) {
-  return a.first < b.first;
+// A row buffered in the transaction store, projected onto the columns of a
+// read.
+struct BufferedRow {
+  // How the buffered row combines with the row in base storage.
+  enum class Op {
+    // The buffered row replaces the base row (an insert).
+    kReplace,
+    // The valid values of the buffered row override the base row (an update).
+    kMerge,
+    // The row is omitted (a delete).
+    kDelete,
+  };
+
+  Key key;
+  Op op;
+  ValueList values;
+};
+
+// Appends the row 'key' buffered by an insert, update or delete with
+// row_values to rows, projected onto columns.
+void AppendBufferedRow(const Key& key, bool is_insert, bool is_delete,
+                       const Row& row_values,
+                       absl::Span<const Column* const> columns,
+                       std::vector<BufferedRow>* rows) {
+  BufferedRow row{key, BufferedRow::Op::kDelete, {}};
+  if (!is_delete) {
+    row.op = is_insert ? BufferedRow::Op::kReplace : BufferedRow::Op::kMerge;
+    row.values.reserve(columns.size());
+    for (const Column* column : columns) {
+      auto value = row_values.find(column);
+      if (value != row_values.end()) {
+        row.values.push_back(value->second);
+      } else if (is_insert) {
+        row.values.push_back(zetasql::values::Null(column->GetType()));
+      } else {
+        // Left invalid so that the base storage value is used.
+        row.values.emplace_back();
+      }
+    }
+  }
+  rows->push_back(std::move(row));
 }
 
-void ResetInvalidValuesToNull(absl::Span<const Column* const> columns,
-                              ValueList* values) {
-  if (!values) {
-    return;
+// A StorageIterator which lazily merges rows read from base storage with the
+// rows buffered within a transaction for the same key range. Both inputs are
+// in key order (both in reverse key order for a reverse read), so the merge
+// yields one row at a time without materializing the base rows.
+//
+// The buffered rows are copied when the iterator is created, so that the
+// transaction may keep buffering mutations while the iterator is in use.
+class MergingStorageIterator : public StorageIterator {
+ public:
+  MergingStorageIterator(std::vector<BufferedRow> buffered_rows,
+                         std::unique_ptr<StorageIterator> base_itr,
+                         absl::Span<const Column* const> columns,
+                         bool reverse = false)
+      : buffered_rows_(std::move(buffered_rows)),
+        base_itr_(std::move(base_itr)),
+        reverse_(reverse) {
+    types_.reserve(columns.size());
+    for (const Column* column : columns) {
+      types_.push_back(column->GetType());
+    }
+    values_.resize(columns.size());
   }
 
-  ZETASQL_DCHECK(columns.size() == values->size());
+  bool Next() override {
+    while (true) {
+      if (!base_has_row_ && !base_done_) {
+        base_has_row_ = base_itr_->Next();
+        base_done_ = !base_has_row_;
+        if (base_done_ && !base_itr_->Status().ok()) {
+          return false;
+        }
+      }
 
-  for (int i = 0; i < columns.size(); ++i) {
-    if (!values->at(i).is_valid()) {
-      values->at(i) = zetasql::values::Null(columns[i]->GetType());
+      const bool buffer_has_row = next_buffered_row_ < buffered_rows_.size();
+      if (!base_has_row_ && !buffer_has_row) {
+        return false;
+      }
+
+      // Copy the base storage column values if this row does not exist in the
+      // transaction store.
+      if (base_has_row_ &&
+          (!buffer_has_row ||
+           Precedes(base_itr_->Key(),
+                    buffered_rows_[next_buffered_row_].key))) {
+        base_has_row_ = false;
+        key_ = base_itr_->Key();
+        for (int i = 0; i < values_.size(); ++i) {
+          values_[i] = BaseValue(i);
+        }
+        return true;
+      }
+
+      const BufferedRow& row = buffered_rows_[next_buffered_row_++];
+      const bool matches_base = base_has_row_ && base_itr_->Key() == row.key;
+      switch (row.op) {
+        case BufferedRow::Op::kReplace:
+          base_has_row_ = base_has_row_ && !matches_base;
+          key_ = row.key;
+          values_ = row.values;
+          return true;
+        case BufferedRow::Op::kDelete:
+          base_has_row_ = base_has_row_ && !matches_base;
+          continue;
+        case BufferedRow::Op::kMerge:
+          // Updates only apply to rows which exist in base storage.
+          if (!matches_base) {
+            continue;
+          }
+          base_has_row_ = false;
+          key_ = row.key;
+          for (int i = 0; i < values_.size(); ++i) {
+            values_[i] =
+                row.values[i].is_valid() ? row.values[i] : BaseValue(i);
+          }
+          return true;
+      }
     }
   }
+
+  absl::Status Status() const override { return base_itr_->Status(); }
+
+  const class Key& Key() const override { return key_; }
+
+  int NumColumns() const override { return values_.size(); }
+
+  const zetasql::Value& ColumnValue(int i) const override {
+    return values_[i];
+  }
+
+ private:
+  // Returns true if key a comes before key b in the order of the merge.
+  bool Precedes(const class Key& a, const class Key& b) const {
+    return reverse_ ? b < a : a < b;
+  }
+
+  // Returns the i-th column of the current base row, or a NULL if the column
+  // has no value.
+  zetasql::Value BaseValue(int i) const {
+    const zetasql::Value& value = base_itr_->ColumnValue(i);
+    return value.is_valid() ? value : zetasql::values::Null(types_[i]);
+  }
+
+  const std::vector<BufferedRow> buffered_rows_;
+  const std::unique_ptr<StorageIterator> base_itr_;
+  const bool reverse_;
+  std::vector<const zetasql::Type*> types_;
+
+  // Index of the next buffered row to merge.
+  int next_buffered_row_ = 0;
+
+  // True if base_itr_ is positioned on a row which has not been merged yet.
+  bool base_has_row_ = false;
+
+  // True once base_itr_ has been exhausted.
+  bool base_done_ = false;
+
+  // The current row.
+  class Key key_;
+  ValueList values_;
+};
+
+// Returns a copy of value, a value of column read from base storage, or null
+// if the column is not set.
+zetasql::Value ValueOrNull(const Column* column, const zetasql::Value& value) {
+  return value.is_valid() ? value : zetasql::values::Null(column->GetType());
 }
 
 }  // namespace
@@ -78,6 +229,7 @@ void ResetInvalidValuesToNull(absl::Span<const Column* const> columns,
 absl::Status TransactionStore::AcquireReadLock(
     const Table* table, const KeyRange& key_range,
     absl::Span<const Column* const> columns) const {
+  absl::MutexLock lock(&lock_mu_);
   lock_handle_->EnqueueLock(LockRequest(LockMode::kShared, table->id(),
                                         key_range, GetColumnIDs(columns)));
   return lock_handle_->Wait();
@@ -86,31 +238,83 @@ absl::Status TransactionStore::AcquireReadLock(
 absl::Status TransactionStore::AcquireWriteLock(
     const Table* table, const KeyRange& key_range,
     absl::Span<const Column* const> columns) const {
+  absl::MutexLock lock(&lock_mu_);
   lock_handle_->EnqueueLock(LockRequest(LockMode::kExclusive, table->id(),
                                         key_range, GetColumnIDs(columns)));
   return lock_handle_->Wait();
 }
 
+absl::Status TransactionStore::AcquireWriteLocks(
+    absl::Span<const WriteOp> ops) const {
+  if (ops.empty()) {
+    return absl::OkStatus();
+  }
+  // The requests are made in a fixed order, so that transactions locking
+  // overlapping groups of rows request the rows they share in the same order.
+  std::vector<const WriteOp*> sorted_ops;
+  sorted_ops.reserve(ops.size());
+  for (const WriteOp& op : ops) {
+    sorted_ops.push_back(&op);
+  }
+  std::sort(sorted_ops.begin(), sorted_ops.end(),
+            [](const WriteOp* a, const WriteOp* b) {
+              const TableID& a_table = TableOf(*a)->id();
+              const TableID& b_table = TableOf(*b)->id();
+              return a_table != b_table ? a_table < b_table
+                                        : KeyOf(*a) < KeyOf(*b);
+            });
+
+  absl::MutexLock lock(&lock_mu_);
+  for (const WriteOp* op : sorted_ops) {
+    absl::Span<const Column* const> columns = std::visit(
+        overloaded{
+            [](const InsertOp& op) {
+              return absl::Span<const Column* const>(op.columns);
+            },
+            [](const UpdateOp& op) {
+              return absl::Span<const Column* const>(op.columns);
+            },
+            [](const DeleteOp&) { return absl::Span<const Column* const>(); },
+        },
+        *op);
+    lock_handle_->EnqueueLock(LockRequest(LockMode::kExclusive,
+                                          TableOf(*op)->id(),
+                                          KeyRange::Point(KeyOf(*op)),
+                                          GetColumnIDs(columns)));
+  }
+  return lock_handle_->Wait();
+}
+
+absl::Status TransactionStore::AcquireReadLocks(
+    const Table* table, absl::Span<const KeyRange> sorted_key_ranges,
+    absl::Span<const Column* const> columns) const {
+  const std::vector<ColumnID> column_ids = GetColumnIDs(columns);
+  absl::MutexLock lock(&lock_mu_);
+  for (const KeyRange& key_range : sorted_key_ranges) {
+    lock_handle_->EnqueueLock(
+        LockRequest(LockMode::kShared, table->id(), key_range, column_ids));
+  }
+  return lock_handle_->Wait();
+}
+
 absl::Status TransactionStore::BufferInsert(
     const Table* table, const Key& key, absl::Span<const Column* const> columns,
-    const ValueList& values) {
+    const ValueList& values, bool acquire_lock) {
   // Acquire locks to prevent another transaction to modify this entity.
-  ZETASQL_RETURN_IF_ERROR(AcquireWriteLock(table, KeyRange::Point(key), columns));
-
-  RowOp row_op;
-  bool row_exists = RowExistsInBuffer(table, key, &row_op);
-  Row row_values;
-  if (row_exists) {
-    // There is an existing delete on this row. Normalize this insert
-    // with the previous delete mutation.
-    row_values = row_op.second;
+  if (acquire_lock) {
+    ZETASQL_RETURN_IF_ERROR(
+        AcquireWriteLock(table, KeyRange::Point(key), columns));
   }
 
+  // If there is an existing delete on this row, the insert is normalized with
+  // it by writing over the nulled row values in place.
+  RowOp& row_op = buffered_ops_[table][key];
+  row_op.first = OpType::kInsert;
+
   // Buffer the insert mutation with the row values to be inserted.
   for (int i = 0; i < columns.size(); ++i) {
-    row_values[columns[i]] = values[i];
+    row_op.second[columns[i]] = values[i];
   }
-  buffered_ops_[table][key] = std::make_pair(OpType::kInsert, row_values);
 
   TrackColumnsForCommitTimestamp(columns, values);
   TrackTableForCommitTimestamp(table, key);
@@ -119,31 +323,26 @@ absl::Status TransactionStore::BufferInsert(
 
 absl::Status TransactionStore::BufferUpdate(
     const Table* table, const Key& key, absl::Span<const Column* const> columns,
-    const ValueList& values) {
+    const ValueList& values, bool acquire_lock) {
   // Acquire locks to prevent another transaction to modify this entity.
-  ZETASQL_RETURN_IF_ERROR(AcquireWriteLock(table, KeyRange::Point(key), columns));
-
-  RowOp row_op;
-  bool row_exists = RowExistsInBuffer(table, key, &row_op);
-
-  // Buffer the update mutation with the cell values to be updated.
-  OpType op_type;
-  Row row_values;
-  if (row_exists) {
-    // There is an existing insert or update on this row. Normalize this update
-    // with the previous mutation.
-    row_values = row_op.second;
-    // If the previous mutation on this row is an insert, keep the OpType
-    // as insert, since updating an inserted row will appear as a single insert.
-    op_type = row_op.first;
-  } else {
-    op_type = OpType::kUpdate;
+  if (acquire_lock) {
+    ZETASQL_RETURN_IF_ERROR(
+        AcquireWriteLock(table, KeyRange::Point(key), columns));
+  }
+
+  // Buffer the update mutation with the cell values to be updated. If there is
+  // an existing insert or update on this row, this update is normalized with
+  // the previous mutation in place. An insert keeps its OpType, since updating
+  // an inserted row will appear as a single insert.
+  auto [row_op_itr, inserted] = buffered_ops_[table].try_emplace(key);
+  RowOp& row_op = row_op_itr->second;
+  if (inserted) {
+    row_op.first = OpType::kUpdate;
   }
 
   for (int i = 0; i < columns.size(); ++i) {
-    row_values[columns[i]] = values[i];
+    row_op.second[columns[i]] = values[i];
   }
-  buffered_ops_[table][key] = std::make_pair(op_type, row_values);
 
   TrackColumnsForCommitTimestamp(columns, values);
   TrackTableForCommitTimestamp(table, key);
@@ -151,31 +350,40 @@ absl::Status TransactionStore::BufferUpdate(
 }
 
 absl::Status TransactionStore::BufferDelete(const Table* table,
-                                            const Key& key) {
+                                            const Key& key, bool acquire_lock) {
   // Acquire locks to prevent another transaction to modify this entity.
-  ZETASQL_RETURN_IF_ERROR(AcquireWriteLock(table, KeyRange::Point(key), {}));
+  if (acquire_lock) {
+    ZETASQL_RETURN_IF_ERROR(AcquireWriteLock(table, KeyRange::Point(key), {}));
+  }
 
   // Marking all columns null to indicate a delete.
-  Row row_values;
+  RowOp& row_op = buffered_ops_[table][key];
+  row_op.first = OpType::kDelete;
+  row_op.second.clear();
+  row_op.second.reserve(table->columns().size());
   for (auto column : table->columns()) {
-    row_values[column] = zetasql::values::Null(column->GetType());
+    row_op.second[column] = zetasql::values::Null(column->GetType());
   }
-  buffered_ops_[table][key] = std::make_pair(OpType::kDelete, row_values);
 
   TrackTableForCommitTimestamp(table, key);
   return absl::OkStatus();
 }
 
-absl::Status TransactionStore::BufferWriteOp(const WriteOp& op) {
+absl::Status TransactionStore::BufferWriteOp(const WriteOp& op,
+                                             bool acquire_lock) {
   return std::visit(
       overloaded{
           [&](const InsertOp& op) {
-            return BufferInsert(op.table, op.key, op.columns, op.values);
+            return BufferInsert(op.table, op.key, op.columns, op.values,
+                                acquire_lock);
           },
           [&](const UpdateOp& op) {
-            return BufferUpdate(op.table, op.key, op.columns, op.values);
+            return BufferUpdate(op.table, op.key, op.columns, op.values,
+                                acquire_lock);
+          },
+          [&](const DeleteOp& op) {
+            return BufferDelete(op.table, op.key, acquire_lock);
           },
-          [&](const DeleteOp& op) { return BufferDelete(op.table, op.key); },
       },
       op);
 }
@@ -192,126 +400,132 @@ absl::Status TransactionStore::Read(
     const Table* table, const KeyRange& key_range,
     absl::Span<const Column* const> columns,
     std::unique_ptr<StorageIterator>* storage_itr,
-    bool allow_pending_commit_timestamps_in_read) const {
+    bool allow_pending_commit_timestamps_in_read, bool reverse,
+    bool acquire_lock) const {
   // Acquire locks to prevent another transaction to modify this entity.
-  ZETASQL_RETURN_IF_ERROR(AcquireReadLock(table, key_range, columns));
+  if (acquire_lock) {
+    ZETASQL_RETURN_IF_ERROR(AcquireReadLock(table, key_range, columns));
+  }
+
+  if (!allow_pending_commit_timestamps_in_read) {
+    ZETASQL_RETURN_IF_ERROR(CheckNoPendingCommitTimestamps(table, columns));
+  }
 
   // Read rows buffered within transaction store.
-  // Table lookup.
-  std::vector<FixedRowStorageIterator::Row> rows;
+  std::vector<BufferedRow> buffered_rows;
   auto table_itr = buffered_ops_.find(table);
   if (table_itr != buffered_ops_.end()) {
-    auto table = table_itr->second;
+    const TableOps& table_ops = table_itr->second;
     // Key range lookup.
-    auto begin_itr = table.lower_bound(key_range.start_key());
-    auto end_itr = table.lower_bound(key_range.limit_key());
+    auto begin_itr = table_ops.lower_bound(key_range.start_key());
+    auto end_itr = table_ops.lower_bound(key_range.limit_key());
 
     for (auto itr = begin_itr; itr != end_itr; ++itr) {
-      if (itr->second.first == OpType::kInsert) {
-        // Add inserts into the StorageIterator.
-        const Row& row_values = itr->second.second;
-        ValueList values;
-        values.reserve(columns.size());
-        for (const Column* column : columns) {
-          if (row_values.find(column) == row_values.end()) {
-            values.emplace_back(zetasql::values::Null(column->GetType()));
-          } else {
-            values.emplace_back(row_values.at(column));
-          }
-        }
-        rows.emplace_back(itr->first, std::move(values));
-      }
+      const auto& [op_type, row_values] = itr->second;
+      AppendBufferedRow(itr->first, op_type == OpType::kInsert,
+                        op_type == OpType::kDelete, row_values, columns,
+                        &buffered_rows);
     }
   }
-  auto buffered_rows_count = rows.size();
 
-  // Read from the base storage and apply the changes buffered in transaction
-  // store.
+  // Read from the base storage, applying the changes buffered in transaction
+  // store as the rows are iterated.
   std::unique_ptr<StorageIterator> base_itr;
-  ZETASQL_RETURN_IF_ERROR(base_storage_->Read(absl::InfiniteFuture(), table->id(),
-                                      key_range, GetColumnIDs(columns),
-                                      &base_itr));
-  while (base_itr->Next()) {
-    ValueList values;
-    values.reserve(columns.size());
-
-    RowOp row_op;
-    // Merge column values from transaction store & base storage.
-    if (RowExistsInBuffer(table, base_itr->Key(), &row_op)) {
-      if (row_op.first == OpType::kDelete || row_op.first == OpType::kInsert) {
-        // Omit the deletes from the output. The buffered inserts have already
-        // been added to the output.
-        continue;
-      }
-      if (row_op.first == OpType::kUpdate) {
-        // Update the column values to reflect the changes in transaction store.
-        for (int i = 0; i < columns.size(); i++) {
-          if (row_op.second.find(columns[i]) != row_op.second.end()) {
-            values.emplace_back(row_op.second[columns[i]]);
-          } else if (base_itr->ColumnValue(i).is_valid()) {
-            values.emplace_back(base_itr->ColumnValue(i));
-          } else {
-            values.emplace_back(zetasql::values::Null(columns[i]->GetType()));
-          }
-        }
-      }
-    } else {
-      // Copy the base storage column values since this row does not exists in
-      // transaction store.
-      for (int i = 0; i < columns.size(); i++) {
-        if (base_itr->ColumnValue(i).is_valid()) {
-          values.emplace_back(base_itr->ColumnValue(i));
-        } else {
-          values.emplace_back(zetasql::values::Null(columns[i]->GetType()));
-        }
-      }
+  if (reverse) {
+    std::reverse(buffered_rows.begin(), buffered_rows.end());
+    ZETASQL_RETURN_IF_ERROR(base_storage_->ReadReverse(
+        absl::InfiniteFuture(), table->id(), key_range, GetColumnIDs(columns),
+        &base_itr));
+  } else {
+    ZETASQL_RETURN_IF_ERROR(base_storage_->Read(
+        absl::InfiniteFuture(), table->id(), key_range, GetColumnIDs(columns),
+        &base_itr));
+  }
+  *storage_itr = std::make_unique<MergingStorageIterator>(
+      std::move(buffered_rows), std::move(base_itr), columns, reverse);
+  return absl::OkStatus();
+}
+
+absl::Status TransactionStore::MultiLookup(
+    const Table* table, absl::Span<const Key> sorted_keys,
+    absl::Span<const Column* const> columns,
+    std::unique_ptr<StorageIterator>* storage_itr,
+    bool allow_pending_commit_timestamps_in_read) const {
+  // Acquire locks to prevent another transaction to modify these entities. All
+  // the requests are queued before waiting for any of them.
+  const std::vector<ColumnID> column_ids = GetColumnIDs(columns);
+  {
+    absl::MutexLock lock(&lock_mu_);
+    for (const Key& key : sorted_keys) {
+      lock_handle_->EnqueueLock(LockRequest(LockMode::kShared, table->id(),
+                                            KeyRange::Point(key), column_ids));
     }
-    rows.emplace_back(base_itr->Key(), std::move(values));
+    ZETASQL_RETURN_IF_ERROR(lock_handle_->Wait());
   }
 
-  // Pending commit timestamp values in buffer cannot be returned to
-  // clients.
   if (!allow_pending_commit_timestamps_in_read) {
-    if (commit_ts_tables_.contains(table)) {
-      return error::CannotReadPendingCommitTimestamp(
-          absl::StrCat("Table ", table->Name()));
-    }
-    for (const auto column : columns) {
-      if (commit_ts_columns_.contains(column) ||
-          (column->source_column() != nullptr &&
-           commit_ts_columns_.contains(column->source_column()))) {
-        return error::CannotReadPendingCommitTimestamp(
-            absl::StrCat("Column ", column->Name()));
+    ZETASQL_RETURN_IF_ERROR(CheckNoPendingCommitTimestamps(table, columns));
+  }
+
+  // Read rows buffered within transaction store.
+  std::vector<BufferedRow> buffered_rows;
+  auto table_itr = buffered_ops_.find(table);
+  if (table_itr != buffered_ops_.end()) {
+    const TableOps& table_ops = table_itr->second;
+    for (const Key& key : sorted_keys) {
+      auto itr = table_ops.find(key);
+      if (itr != table_ops.end()) {
+        const auto& [op_type, row_values] = itr->second;
+        AppendBufferedRow(itr->first, op_type == OpType::kInsert,
+                          op_type == OpType::kDelete, row_values, columns,
+                          &buffered_rows);
       }
     }
   }
 
-  // The keys need to be sorted to provide iterating in order. The rows added
-  // from buffered ops and the ones added from base storage were already in
-  // sorted order respectively. Merge these two sorted subarrays to get overall
-  // sorted order.
-  ZETASQL_DCHECK(buffered_rows_count <= rows.size())
-      << buffered_rows_count << " vs " << rows.size();
-  auto first_base_row_iter = rows.begin() + buffered_rows_count;
-  std::inplace_merge(rows.begin(), first_base_row_iter, rows.end(), SortByKey);
-  *storage_itr = std::make_unique<FixedRowStorageIterator>(std::move(rows));
+  // Look up all the keys in the base storage at once, applying the changes
+  // buffered in transaction store as the rows are iterated.
+  std::vector<FixedRowStorageIterator::Row> base_rows;
+  ZETASQL_RETURN_IF_ERROR(base_storage_->MultiLookup(absl::InfiniteFuture(),
+                                             table->id(), sorted_keys,
+                                             column_ids, &base_rows));
+  *storage_itr = std::make_unique<MergingStorageIterator>(
+      std::move(buffered_rows),
+      std::make_unique<FixedRowStorageIterator>(std::move(base_rows)),
+      columns);
+  return absl::OkStatus();
+}
+
+absl::Status TransactionStore::CheckNoPendingCommitTimestamps(
+    const Table* table, absl::Span<const Column* const> columns) const {
+  if (commit_ts_tables_.contains(table)) {
+    return error::CannotReadPendingCommitTimestamp(
+        absl::StrCat("Table ", table->Name()));
+  }
+  for (const auto column : columns) {
+    if (commit_ts_columns_.contains(column) ||
+        (column->source_column() != nullptr &&
+         commit_ts_columns_.contains(column->source_column()))) {
+      return error::CannotReadPendingCommitTimestamp(
+          absl::StrCat("Column ", column->Name()));
+    }
+  }
   return absl::OkStatus();
 }
 
-bool TransactionStore::RowExistsInBuffer(const Table* table, const Key& key,
-                                         RowOp* row_op) const {
+const TransactionStore::RowOp* TransactionStore::FindInBuffer(
+    const Table* table, const Key& key) const {
   const auto table_itr = buffered_ops_.find(table);
   if (table_itr == buffered_ops_.end()) {
     // Table does not exist. This can happen if the table is empty.
-    return false;
+    return nullptr;
   }
   const auto row_op_itr = table_itr->second.find(key);
   if (row_op_itr == table_itr->second.end()) {
     // Key does not exist.
-    return false;
+    return nullptr;
   }
-  *row_op = row_op_itr->second;
-  return true;
+  return &row_op_itr->second;
 }
 
 void TransactionStore::TrackColumnsForCommitTimestamp(
@@ -349,14 +563,13 @@ absl::StatusOr<ValueList> TransactionStore::Lookup(
   ZETASQL_RETURN_IF_ERROR(AcquireReadLock(table, KeyRange::Point(key), columns));
 
   // Check if row exists within the buffer.
-  RowOp row_op;
-  if (RowExistsInBuffer(table, key, &row_op)) {
-    switch (row_op.first) {
+  if (const RowOp* row_op = FindInBuffer(table, key); row_op != nullptr) {
+    switch (row_op->first) {
       case OpType::kInsert: {
         // Fetch the latest value from the cell.
         for (auto column : columns) {
-          auto row_value = row_op.second.find(column);
-          if (row_value != row_op.second.end()) {
+          auto row_value = row_op->second.find(column);
+          if (row_value != row_op->second.end()) {
             values.emplace_back(row_value->second);
           } else {
             values.emplace_back(zetasql::values::Null(column->GetType()));
@@ -366,18 +579,19 @@ absl::StatusOr<ValueList> TransactionStore::Lookup(
       }
       case OpType::kUpdate: {
         // For update, the base storage needs to be checked to retrieve values
-        // which might not be included in the update.
-        ZETASQL_RETURN_IF_ERROR(base_storage_->Lookup(absl::InfiniteFuture(),
-                                              table->id(), key,
-                                              GetColumnIDs(columns), &values));
-        ResetInvalidValuesToNull(columns, &values);
-        for (int i = 0; i < columns.size(); ++i) {
-          // Update values retrieved from base storage with new values.
-          auto row_value = row_op.second.find(columns[i]);
-          if (row_value != row_op.second.end()) {
-            values[i] = row_value->second;
-          }
-        }
+        // which might not be included in the update. Only those are copied
+        // out of the base storage.
+        values.resize(columns.size());
+        ZETASQL_RETURN_IF_ERROR(base_storage_->VisitLookup(
+            absl::InfiniteFuture(), table->id(), key, GetColumnIDs(columns),
+            [&](int i, const zetasql::Value& value) {
+              auto row_value = row_op->second.find(columns[i]);
+              if (row_value != row_op->second.end()) {
+                values[i] = row_value->second;
+              } else {
+                values[i] = ValueOrNull(columns[i], value);
+              }
+            }));
         break;
       }
       // Ignore delete operations.
@@ -388,32 +602,75 @@ absl::StatusOr<ValueList> TransactionStore::Lookup(
     }
     return values;
   }
-  ZETASQL_RETURN_IF_ERROR(base_storage_->Lookup(absl::InfiniteFuture(), table->id(),
-                                        key, GetColumnIDs(columns), &values));
-  ResetInvalidValuesToNull(columns, &values);
+  values.resize(columns.size());
+  ZETASQL_RETURN_IF_ERROR(base_storage_->VisitLookup(
+      absl::InfiniteFuture(), table->id(), key, GetColumnIDs(columns),
+      [&](int i, const zetasql::Value& value) {
+        values[i] = ValueOrNull(columns[i], value);
+      }));
   return values;
 }
 
+absl::StatusOr<bool> TransactionStore::Exists(const Table* table,
+                                              const Key& key) const {
+  ZETASQL_RETURN_IF_ERROR(AcquireReadLock(table, KeyRange::Point(key), {}));
+  if (const RowOp* row_op = FindInBuffer(table, key); row_op != nullptr) {
+    return row_op->first != OpType::kDelete;
+  }
+  return base_storage_->Exists(absl::InfiniteFuture(), table->id(), key);
+}
+
+size_t TransactionStore::NumBufferedOps() const {
+  size_t num_ops = 0;
+  for (const auto& [table, table_ops] : buffered_ops_) {
+    num_ops += table_ops.size();
+  }
+  return num_ops;
+}
+
+bool TransactionStore::HasBufferedInsertsOrUpdates() const {
+  for (const auto& [table, table_ops] : buffered_ops_) {
+    for (const auto& [key, row_op] : table_ops) {
+      if (row_op.first != OpType::kDelete) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::vector<const Table*> TransactionStore::BufferedTables() const {
+  std::vector<const Table*> tables;
+  for (const auto& [table, table_ops] : buffered_ops_) {
+    if (!table_ops.empty()) {
+      tables.push_back(table);
+    }
+  }
+  return tables;
+}
+
 std::vector<WriteOp> TransactionStore::GetBufferedOps() const {
   std::vector<WriteOp> buffered_ops;
-  for (const auto& entry : buffered_ops_) {
-    const Table* table = entry.first;
-    for (const auto& row : entry.second) {
-      const Key& key = row.first;
-      const RowOp& row_op = row.second;
+  buffered_ops.reserve(NumBufferedOps());
+  for (const auto& [table, table_ops] : buffered_ops_) {
+    for (const auto& [key, row_op] : table_ops) {
       std::vector<const Column*> columns;
       ValueList values;
+      columns.reserve(row_op.second.size());
+      values.reserve(row_op.second.size());
       for (const auto& cell : row_op.second) {
         columns.emplace_back(cell.first);
         values.emplace_back(cell.second);
       }
       switch (row_op.first) {
         case OpType::kInsert: {
-          buffered_ops.emplace_back(InsertOp{table, key, columns, values});
+          buffered_ops.emplace_back(
+              InsertOp{table, key, std::move(columns), std::move(values)});
           break;
         }
         case OpType::kUpdate: {
-          buffered_ops.emplace_back(UpdateOp{table, key, columns, values});
+          buffered_ops.emplace_back(
+              UpdateOp{table, key, std::move(columns), std::move(values)});
           break;
         }
         case OpType::kDelete: {
@@ -426,6 +683,46 @@ std::vector<WriteOp> TransactionStore::GetBufferedOps() const {
   return buffered_ops;
 }
 
+std::vector<WriteOp> TransactionStore::TakeBufferedOps() {
+  std::vector<WriteOp> buffered_ops;
+  buffered_ops.reserve(NumBufferedOps());
+  for (auto& [table, table_ops] : buffered_ops_) {
+    while (!table_ops.empty()) {
+      // Extracting the node hands over the key and the row values without
+      // copying them.
+      auto node = table_ops.extract(table_ops.begin());
+      Key& key = node.key();
+      RowOp& row_op = node.mapped();
+      std::vector<const Column*> columns;
+      ValueList values;
+      columns.reserve(row_op.second.size());
+      values.reserve(row_op.second.size());
+      for (auto& cell : row_op.second) {
+        columns.emplace_back(cell.first);
+        values.emplace_back(std::move(cell.second));
+      }
+      switch (row_op.first) {
+        case OpType::kInsert: {
+          buffered_ops.emplace_back(InsertOp{
+              table, std::move(key), std::move(columns), std::move(values)});
+          break;
+        }
+        case OpType::kUpdate: {
+          buffered_ops.emplace_back(UpdateOp{
+              table, std::move(key), std::move(columns), std::move(values)});
+          break;
+        }
+        case OpType::kDelete: {
+          buffered_ops.emplace_back(DeleteOp{table, std::move(key)});
+          break;
+        }
+      }
+    }
+  }
+  buffered_ops_.clear();
+  return buffered_ops;
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -17,13 +17,18 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_TRANSACTION_STORE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_TRANSACTION_STORE_H_
 
+#include <cstddef>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "zetasql/public/value.h"
+#include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/actions/ops.h"
 #include "backend/common/ids.h"
 #include "backend/datamodel/key.h"
@@ -61,14 +66,28 @@ namespace backend {
 // At commit time, the read-write transaction which owns this store flushes all
 // buffered mutations to the underlying database storage in an atomic fashion.
 //
-// This class is not thread safe.
+// This class is not thread safe, except that its const reads may run
+// concurrently with each other, as the commit-time verifiers do.
 class TransactionStore {
  public:
   explicit TransactionStore(Storage* base_storage, LockHandle* lock_handle)
       : base_storage_(base_storage), lock_handle_(lock_handle) {}
 
-  // Buffers a write operation. Acquires write locks.
-  absl::Status BufferWriteOp(const WriteOp& op);
+  // Buffers a write operation. Acquires write locks, unless acquire_lock is
+  // false, for an op whose locks were acquired by AcquireWriteLocks.
+  absl::Status BufferWriteOp(const WriteOp& op, bool acquire_lock = true);
+
+  // Acquires the write locks of all of 'ops' at once. The requests are queued
+  // in table and key order, and waited for together, so that a group of ops
+  // waits for the lock manager once.
+  absl::Status AcquireWriteLocks(absl::Span<const WriteOp> ops) const;
+
+  // Acquires the read locks of all of 'sorted_key_ranges' of 'table' at once,
+  // waiting for them together. Used ahead of a Read of each of them with
+  // acquire_lock false.
+  absl::Status AcquireReadLocks(const Table* table,
+                                absl::Span<const KeyRange> sorted_key_ranges,
+                                absl::Span<const Column* const> columns) const;
 
   // Returns the column values for 'key' by merging information from the
   // buffered mutations and the base storage. Returns NOT_FOUND if 'key'
@@ -77,22 +96,60 @@ class TransactionStore {
       const Table* table, const Key& key,
       absl::Span<const Column* const> columns) const;
 
+  // Returns true if 'key' exists in the merged view. Unlike Lookup of no
+  // columns, keys which do not exist are not reported as an error, which keeps
+  // checks that inserted keys are new cheap. Acquires read locks.
+  absl::StatusOr<bool> Exists(const Table* table, const Key& key) const;
+
   // Returns an iterator for column values of 'key_range' by merging information
   // from the buffered mutations and the base storage. Acquires read locks.
   //
   // Boolean flag allow_pending_commit_timestamps_in_read can be set to false to
-  // disallow returning pending_commit_timestamp values to clients.
+  // disallow returning pending_commit_timestamp values to clients. If reverse
+  // is true, rows are returned in reverse key order. If acquire_lock is false,
+  // the read locks must have been acquired by AcquireReadLocks.
   absl::Status Read(const Table* table, const KeyRange& key_range,
                     absl::Span<const Column* const> columns,
                     std::unique_ptr<StorageIterator>* storage_itr,
-                    bool allow_pending_commit_timestamps_in_read = true) const;
-
-  // Returns the buffered mutations.
+                    bool allow_pending_commit_timestamps_in_read = true,
+                    bool reverse = false, bool acquire_lock = true) const;
+
+  // Returns an iterator for column values of each of 'sorted_keys' which
+  // exists in the merged view, in the same order. This is equivalent to a Read
+  // of the point range of each key, but the base storage is read once for all
+  // of them. Acquires read locks.
+  absl::Status MultiLookup(
+      const Table* table, absl::Span<const Key> sorted_keys,
+      absl::Span<const Column* const> columns,
+      std::unique_ptr<StorageIterator>* storage_itr,
+      bool allow_pending_commit_timestamps_in_read = true) const;
+
+  // Returns a copy of the buffered mutations.
   std::vector<WriteOp> GetBufferedOps() const;
 
+  // Moves the buffered mutations out of the store, leaving it empty. Used at
+  // commit time, when the buffered rows are no longer needed.
+  std::vector<WriteOp> TakeBufferedOps();
+
+  // Returns the tables with buffered mutations.
+  std::vector<const Table*> BufferedTables() const;
+
+  // Returns true if any buffered mutation is an insert or an update.
+  bool HasBufferedInsertsOrUpdates() const;
+
   // Clears the buffered mutations.
   void Clear() { buffered_ops_.clear(); }
 
+  // Clears all the state of the store, and acquires the locks of later
+  // operations with lock_handle. Used when reusing the store for a new
+  // transaction.
+  void Reset(LockHandle* lock_handle) {
+    lock_handle_ = lock_handle;
+    buffered_ops_.clear();
+    commit_ts_columns_.clear();
+    commit_ts_tables_.clear();
+  }
+
  private:
   // Types of mutations.
   enum class OpType {
@@ -103,6 +160,11 @@ class TransactionStore {
 
   using RowOp = std::pair<OpType, Row>;
 
+  // Buffered mutations of a single table. A btree keeps several rows per node,
+  // which makes the ordered range scans done by Read cheaper than a node based
+  // map.
+  using TableOps = absl::btree_map<Key, RowOp>;
+
   // Acquires read locks for the specified column ranges.
   absl::Status AcquireReadLock(const Table* table, const KeyRange& key_range,
                                absl::Span<const Column* const> columns) const;
@@ -111,21 +173,30 @@ class TransactionStore {
   absl::Status AcquireWriteLock(const Table* table, const KeyRange& key_range,
                                 absl::Span<const Column* const> columns) const;
 
-  // Buffers an insert mutation. Acquires write locks.
+  // Buffers an insert mutation. Acquires write locks if acquire_lock is true.
   absl::Status BufferInsert(const Table* table, const Key& key,
                             absl::Span<const Column* const> columns,
-                            const ValueList& values);
+                            const ValueList& values, bool acquire_lock);
 
-  // Buffers an update mutation. Acquires write locks.
+  // Buffers an update mutation. Acquires write locks if acquire_lock is true.
   absl::Status BufferUpdate(const Table* table, const Key& key,
                             absl::Span<const Column* const> columns,
-                            const ValueList& values);
+                            const ValueList& values, bool acquire_lock);
+
+  // Buffers a delete mutation. Acquires write locks if acquire_lock is true.
+  absl::Status BufferDelete(const Table* table, const Key& key,
+                            bool acquire_lock);
 
-  // Buffers a delete mutation. Acquires write locks.
-  absl::Status BufferDelete(const Table* table, const Key& key);
+  // Returns an error if any of 'columns' of 'table' may hold a pending commit
+  // timestamp value, which cannot be returned to clients.
+  absl::Status CheckNoPendingCommitTimestamps(
+      const Table* table, absl::Span<const Column* const> columns) const;
 
-  // Returns true if a mutation has been buffered for 'key' and fills 'row'.
-  bool RowExistsInBuffer(const Table* table, const Key& key, RowOp* row) const;
+  // Returns the mutation buffered for 'key', or nullptr if there is none.
+  const RowOp* FindInBuffer(const Table* table, const Key& key) const;
+
+  // Returns the number of buffered row mutations across all tables.
+  size_t NumBufferedOps() const;
 
   // Mark a given column non-readable if one or more values being written to it
   // in the mutation contain pending commit timestamp.
@@ -142,8 +213,18 @@ class TransactionStore {
   // Handle for the lock manager.
   LockHandle* lock_handle_;
 
+  // Serializes concurrent reads enqueueing and waiting for their locks on
+  // lock_handle_, which holds a single batch of pending requests.
+  //
+  // This is held across lock_handle_->Wait(), since another read enqueueing
+  // its requests during the wait would join the batch being waited on. A read
+  // blocked on lock_mu_ would wait for the same lock manager anyway, and
+  // Wait() returns once the locks are granted or the lock manager aborts the
+  // transaction, neither of which needs lock_mu_, so this cannot deadlock.
+  mutable absl::Mutex lock_mu_;
+
   // Map that stores the buffered mutations.
-  absl::flat_hash_map<const Table*, std::map<Key, RowOp>> buffered_ops_;
+  absl::flat_hash_map<const Table*, TableOps> buffered_ops_;
 
   // Set of non-key columns which have mutation with pending commit timestamp
   // and are thus marked as non-readable in read-your-writes transactions.
@@ -17,6 +17,7 @@
 #include "backend/transaction/transaction_store.h"
 
 #include <memory>
+#include <variant>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -30,6 +31,7 @@
 #include "backend/datamodel/key_range.h"
 #include "backend/datamodel/value.h"
 #include "backend/locking/manager.h"
+#include "backend/locking/request.h"
 #include "backend/storage/in_memory_storage.h"
 #include "common/clock.h"
 #include "tests/common/schema_constructor.h"
@@ -38,6 +40,7 @@ using zetasql::types::StringType;
 using zetasql::values::Int64;
 using zetasql::values::Null;
 using zetasql::values::String;
+using zetasql_base::testing::IsOkAndHolds;
 using zetasql_base::testing::StatusIs;
 
 namespace google {
@@ -117,10 +120,28 @@ class TransactionStoreTest : public testing::Test {
     return Read(KeyRange::All());
   }
 
-  absl::StatusOr<std::vector<ValueList>> Read(const KeyRange& key_range) {
+  absl::StatusOr<std::vector<ValueList>> Read(const KeyRange& key_range,
+                                              bool reverse = false) {
     std::unique_ptr<StorageIterator> itr;
-    ZETASQL_RETURN_IF_ERROR(transaction_store_.Read(table_, key_range,
-                                            {int64_col_, string_col_}, &itr));
+    ZETASQL_RETURN_IF_ERROR(transaction_store_.Read(
+        table_, key_range, {int64_col_, string_col_}, &itr,
+        /*allow_pending_commit_timestamps_in_read=*/true, reverse));
+
+    std::vector<ValueList> rows;
+    while (itr->Next()) {
+      rows.emplace_back();
+      for (int i = 0; i < itr->NumColumns(); i++) {
+        rows.back().push_back(itr->ColumnValue(i));
+      }
+    }
+    return rows;
+  }
+
+  absl::StatusOr<std::vector<ValueList>> MultiLookup(
+      const std::vector<Key>& keys) {
+    std::unique_ptr<StorageIterator> itr;
+    ZETASQL_RETURN_IF_ERROR(transaction_store_.MultiLookup(
+        table_, keys, {int64_col_, string_col_}, &itr));
 
     std::vector<ValueList> rows;
     while (itr->Next()) {
@@ -249,6 +270,27 @@ TEST_F(TransactionStoreTest, CanBufferDeleteInsertUpdate) {
   EXPECT_THAT(ReadAll(), IsOkAndHoldsRows({{Int64(1), String("value-3")}}));
 }
 
+TEST_F(TransactionStoreTest, MultiLookupMergesBufferedWrites) {
+  // Populate the table with some data.
+  absl::Time t0 = absl::Now();
+  ZETASQL_EXPECT_OK(Write(t0, Key({Int64(1)}), {Int64(1), String("value")}));
+  ZETASQL_EXPECT_OK(Write(t0, Key({Int64(2)}), {Int64(2), String("value")}));
+  ZETASQL_EXPECT_OK(Write(t0, Key({Int64(4)}), {Int64(4), String("value")}));
+
+  // Buffer an insert, an update and a delete.
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(3)}), {int64_col_, string_col_},
+                         {Int64(3), String("value")}));
+  ZETASQL_EXPECT_OK(
+      BufferUpdate(Key({Int64(1)}), {string_col_}, {String("new-value")}));
+  ZETASQL_EXPECT_OK(BufferDelete(Key({Int64(2)})));
+
+  // Only the requested keys which exist in the merged view are returned.
+  EXPECT_THAT(MultiLookup({Key({Int64(1)}), Key({Int64(2)}), Key({Int64(3)}),
+                           Key({Int64(5)})}),
+              IsOkAndHoldsRows({{Int64(1), String("new-value")},
+                                {Int64(3), String("value")}}));
+}
+
 TEST_F(TransactionStoreTest, ReadValueNotFound) {
   // Read on empty table.
   EXPECT_THAT(ReadAll(), IsOkAndHoldsRows({}));
@@ -332,6 +374,23 @@ TEST_F(TransactionStoreTest, LookupEmptyColumns) {
   ZETASQL_EXPECT_OK(transaction_store_.Lookup(table_, Key({Int64(1)}), {}));
 }
 
+TEST_F(TransactionStoreTest, ExistsMergesBufferAndBaseStorage) {
+  absl::Time t0 = absl::Now();
+  ZETASQL_EXPECT_OK(Write(t0, Key({Int64(1)}), {Int64(1), String("value")}));
+  EXPECT_THAT(transaction_store_.Exists(table_, Key({Int64(1)})),
+              IsOkAndHolds(true));
+  EXPECT_THAT(transaction_store_.Exists(table_, Key({Int64(2)})),
+              IsOkAndHolds(false));
+
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(2)}), {int64_col_, string_col_},
+                         {Int64(2), String("value")}));
+  ZETASQL_EXPECT_OK(BufferDelete(Key({Int64(1)})));
+  EXPECT_THAT(transaction_store_.Exists(table_, Key({Int64(1)})),
+              IsOkAndHolds(false));
+  EXPECT_THAT(transaction_store_.Exists(table_, Key({Int64(2)})),
+              IsOkAndHolds(true));
+}
+
 TEST_F(TransactionStoreTest, ReturnsNullValuesForUnpopulatedColumns) {
   // Write three rows
   // - Key(1) which only exists in base storage
@@ -368,6 +427,114 @@ TEST_F(TransactionStoreTest, ReadsClosedOpenRange) {
               IsOkAndHoldsRows({}));
 }
 
+TEST_F(TransactionStoreTest, MergesInterleavedBufferedAndBaseRows) {
+  absl::Time t0 = absl::Now();
+  for (int i = 0; i < 10; i += 2) {
+    ZETASQL_EXPECT_OK(Write(t0, Key({Int64(i)}), {Int64(i), String("base")}));
+  }
+
+  // Insert between, before and after the base rows, replace one base row,
+  // update another and delete a third.
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(-1)}), {int64_col_}, {Int64(-1)}));
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(3)}), {int64_col_, string_col_},
+                         {Int64(3), String("insert")}));
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(11)}), {int64_col_, string_col_},
+                         {Int64(11), String("insert")}));
+  ZETASQL_EXPECT_OK(BufferDelete(Key({Int64(0)})));
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(0)}), {int64_col_}, {Int64(0)}));
+  ZETASQL_EXPECT_OK(
+      BufferUpdate(Key({Int64(4)}), {string_col_}, {String("update")}));
+  ZETASQL_EXPECT_OK(BufferDelete(Key({Int64(6)})));
+
+  // An update of a row which does not exist is not visible.
+  ZETASQL_EXPECT_OK(
+      BufferUpdate(Key({Int64(7)}), {string_col_}, {String("update")}));
+
+  EXPECT_THAT(ReadAll(), IsOkAndHoldsRows({
+                             {Int64(-1), Null(StringType())},
+                             {Int64(0), Null(StringType())},
+                             {Int64(2), String("base")},
+                             {Int64(3), String("insert")},
+                             {Int64(4), String("update")},
+                             {Int64(8), String("base")},
+                             {Int64(11), String("insert")},
+                         }));
+  EXPECT_THAT(Read(KeyRange::All(), /*reverse=*/true),
+              IsOkAndHoldsRows({
+                  {Int64(11), String("insert")},
+                  {Int64(8), String("base")},
+                  {Int64(4), String("update")},
+                  {Int64(3), String("insert")},
+                  {Int64(2), String("base")},
+                  {Int64(0), Null(StringType())},
+                  {Int64(-1), Null(StringType())},
+              }));
+}
+
+TEST_F(TransactionStoreTest, ReadIsUnaffectedByLaterBufferedWrites) {
+  absl::Time t0 = absl::Now();
+  ZETASQL_EXPECT_OK(Write(t0, Key({Int64(1)}), {Int64(1), String("base")}));
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(2)}), {int64_col_, string_col_},
+                         {Int64(2), String("insert")}));
+
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_ASSERT_OK(transaction_store_.Read(table_, KeyRange::All(),
+                                    {int64_col_, string_col_}, &itr));
+
+  // Mutations buffered while the iterator is in use are not observed by it.
+  ZETASQL_EXPECT_OK(BufferDelete(Key({Int64(2)})));
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(3)}), {int64_col_}, {Int64(3)}));
+
+  ASSERT_TRUE(itr->Next());
+  EXPECT_EQ(itr->Key(), Key({Int64(1)}));
+  ASSERT_TRUE(itr->Next());
+  EXPECT_EQ(itr->Key(), Key({Int64(2)}));
+  EXPECT_EQ(itr->ColumnValue(1), String("insert"));
+  EXPECT_FALSE(itr->Next());
+  ZETASQL_EXPECT_OK(itr->Status());
+}
+
+TEST_F(TransactionStoreTest, BuffersOpsLockedTogether) {
+  std::vector<WriteOp> ops = {
+      InsertOp{table_, Key({Int64(2)}), {int64_col_, string_col_},
+               {Int64(2), String("insert")}},
+      DeleteOp{table_, Key({Int64(1)})},
+  };
+  ZETASQL_ASSERT_OK(transaction_store_.AcquireWriteLocks(ops));
+
+  // The locks are held, so another transaction cannot acquire them.
+  std::unique_ptr<LockHandle> other_handle =
+      lock_manager_.CreateHandle(TransactionID(2), TransactionPriority(2));
+  other_handle->EnqueueLock(LockRequest(LockMode::kShared, table_->id(),
+                                        KeyRange::Point(Key({Int64(2)})), {}));
+  EXPECT_THAT(other_handle->Wait(), StatusIs(absl::StatusCode::kAborted));
+
+  for (const WriteOp& op : ops) {
+    ZETASQL_ASSERT_OK(
+        transaction_store_.BufferWriteOp(op, /*acquire_lock=*/false));
+  }
+  EXPECT_THAT(ReadAll(), IsOkAndHoldsRows({{Int64(2), String("insert")}}));
+}
+
+TEST_F(TransactionStoreTest, TakeBufferedOpsEmptiesTheStore) {
+  ZETASQL_EXPECT_OK(BufferInsert(Key({Int64(2)}), {int64_col_, string_col_},
+                         {Int64(2), String("insert")}));
+  ZETASQL_EXPECT_OK(BufferDelete(Key({Int64(1)})));
+  EXPECT_TRUE(transaction_store_.HasBufferedInsertsOrUpdates());
+
+  std::vector<WriteOp> ops = transaction_store_.TakeBufferedOps();
+  ASSERT_EQ(ops.size(), 2);
+  ASSERT_TRUE(std::holds_alternative<DeleteOp>(ops[0]));
+  EXPECT_EQ(std::get<DeleteOp>(ops[0]).key, Key({Int64(1)}));
+  ASSERT_TRUE(std::holds_alternative<InsertOp>(ops[1]));
+  EXPECT_EQ(std::get<InsertOp>(ops[1]).key, Key({Int64(2)}));
+  EXPECT_EQ(std::get<InsertOp>(ops[1]).values.size(), 2);
+
+  EXPECT_TRUE(transaction_store_.GetBufferedOps().empty());
+  EXPECT_FALSE(transaction_store_.HasBufferedInsertsOrUpdates());
+  EXPECT_THAT(ReadAll(), IsOkAndHoldsRows({}));
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -0,0 +1,517 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Measures the end-to-end latency of change streams: writers commit to tracked
+// tables at a fixed rate while readers consume the partitions of a change
+// stream over all of them through ExecuteStreamingSql, following child
+// partitions as partitions end. Reports the distribution of the time from the
+// commit timestamp of each data change record to its delivery to a reader, and
+// the emulator CPU time spent per delivered record.
+//
+// By default the benchmark runs against an emulator embedded in the process.
+// Its CPU time is that of the process less the CPU time of the threads of the
+// benchmark itself, and so includes the client side of the gRPC calls. Point
+// the benchmark at a running emulator instead with --endpoint, and pass the
+// process ID of the emulator with --emulator_pid to report its CPU time, e.g.
+//   bazel run -c opt //benchmarks:change_stream_main -- \
+//     --commit_rate=200 --readers=4 --duration=60s
+//   bazel run -c opt //benchmarks:change_stream_main -- \
+//     --endpoint=localhost:9010 --emulator_pid=$(pgrep emulator_main)
+//
+// Exits with a non-zero status if a commit or change stream query failed, or
+// if no data change record was read, so that a short run can be used as a test.
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "google/spanner/v1/result_set.pb.h"
+#include "google/spanner/v1/spanner.grpc.pb.h"
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "zetasql/base/logging.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/grpc_target.h"
+#include "benchmarks/results.h"
+#include "benchmarks/workload.h"
+#include "common/clock.h"
+#include "frontend/server/embedded_emulator.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+#include "tests/common/chunking.h"
+
+ABSL_FLAG(std::string, endpoint, "",
+          "Address of the emulator to run the benchmark against. If empty, the "
+          "benchmark runs against an emulator embedded in the process.");
+
+ABSL_FLAG(int, emulator_pid, 0,
+          "Process ID of the emulator at --endpoint, whose CPU time is then "
+          "reported. Requires the emulator to run on the same machine.");
+
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(30),
+          "How long to commit to the tracked tables for.");
+
+ABSL_FLAG(absl::Duration, drain, absl::Seconds(5),
+          "How long readers keep reading once commits stop, for the records "
+          "of the last commits to be delivered.");
+
+ABSL_FLAG(double, commit_rate, 100,
+          "Number of transactions committed per second, across all writers.");
+
+ABSL_FLAG(int, writers, 4, "Number of sessions committing transactions.");
+
+ABSL_FLAG(int, rows_per_commit, 1,
+          "Number of rows inserted by each committed transaction.");
+
+ABSL_FLAG(int, tables, 4,
+          "Number of tracked tables, each transaction writes to one of them.");
+
+ABSL_FLAG(int, readers, 4,
+          "Number of readers consuming change stream partitions, each reading "
+          "one partition at a time.");
+
+ABSL_FLAG(int64_t, heartbeat_milliseconds, 1000,
+          "Heartbeat interval of the change stream queries.");
+
+ABSL_FLAG(std::string, results_out, "",
+          "If set, the file to write the results to as JSON, for comparison "
+          "with those of other runs by //benchmarks:compare_main.");
+
+namespace benchmarks = ::google::spanner::emulator::benchmarks;
+namespace spanner_api = ::google::spanner::v1;
+
+using ::google::spanner::emulator::ThreadCpuTime;
+
+namespace {
+
+constexpr char kInstanceUri[] = "projects/benchmark/instances/benchmark";
+constexpr char kChangeStream[] = "BenchmarkStream";
+
+std::string TableName(int i) { return absl::StrFormat("Tracked%d", i); }
+
+std::vector<std::string> Schema() {
+  std::vector<std::string> schema;
+  for (int i = 0; i < absl::GetFlag(FLAGS_tables); ++i) {
+    schema.push_back(absl::StrFormat(
+        "CREATE TABLE %s (Id INT64 NOT NULL, Value STRING(MAX)) "
+        "PRIMARY KEY (Id)",
+        TableName(i)));
+  }
+  schema.push_back(absl::StrFormat("CREATE CHANGE STREAM %s FOR ALL",
+                                   kChangeStream));
+  return schema;
+}
+
+std::string FormatTimestamp(absl::Time time) {
+  return absl::FormatTime(absl::RFC3339_full, time, absl::UTCTimeZone());
+}
+
+// Returns the CPU time used by the emulator so far: that of the process with
+// ID --emulator_pid if set, or else that of this process.
+absl::StatusOr<absl::Duration> EmulatorCpuTime() {
+  const int pid = absl::GetFlag(FLAGS_emulator_pid);
+  if (pid == 0) {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return absl::DurationFromTimeval(usage.ru_utime) +
+           absl::DurationFromTimeval(usage.ru_stime);
+  }
+  // Fields 14 and 15 of /proc/<pid>/stat are the user and system time of the
+  // process in clock ticks. The second field, the command, may contain spaces
+  // and is parenthesized, so fields are counted from its closing parenthesis.
+  std::ifstream stat(absl::StrFormat("/proc/%d/stat", pid));
+  std::string contents((std::istreambuf_iterator<char>(stat)),
+                       std::istreambuf_iterator<char>());
+  const size_t command_end = contents.rfind(')');
+  if (command_end == std::string::npos) {
+    return absl::NotFoundError(
+        absl::StrFormat("Cannot read the CPU time of process %d", pid));
+  }
+  std::vector<std::string> fields =
+      absl::StrSplit(contents.substr(command_end + 2), ' ');
+  int64_t utime = 0;
+  int64_t stime = 0;
+  if (fields.size() < 13 || !absl::SimpleAtoi(fields[11], &utime) ||
+      !absl::SimpleAtoi(fields[12], &stime)) {
+    return absl::InternalError(
+        absl::StrFormat("Cannot parse the CPU time of process %d", pid));
+  }
+  return absl::Seconds(static_cast<double>(utime + stime) /
+                       sysconf(_SC_CLK_TCK));
+}
+
+// What the readers received, merged across readers when reporting.
+struct ReaderStats {
+  std::vector<absl::Duration> latencies;
+  int64_t heartbeats = 0;
+  int64_t partitions = 0;
+  int64_t errors = 0;
+  absl::Duration cpu_time;
+
+  void Merge(const ReaderStats& other) {
+    latencies.insert(latencies.end(), other.latencies.begin(),
+                     other.latencies.end());
+    heartbeats += other.heartbeats;
+    partitions += other.partitions;
+    errors += other.errors;
+    cpu_time += other.cpu_time;
+  }
+};
+
+// The change stream partitions yet to be read, each identified by its token
+// and read from its start timestamp. The initial query, which returns the
+// initial partitions, is queued as a partition without a token.
+class PartitionQueue {
+ public:
+  struct Partition {
+    std::optional<std::string> token;
+    absl::Time start;
+  };
+
+  explicit PartitionQueue(absl::Time start) {
+    partitions_.push_back({std::nullopt, start});
+  }
+
+  // Queues a child partition, unless another of its parents queued it already.
+  void Add(const std::string& token, absl::Time start) {
+    absl::MutexLock lock(&mu_);
+    if (seen_.insert(token).second) {
+      partitions_.push_back({token, start});
+    }
+  }
+
+  // Returns the next partition to read, waiting for one until deadline.
+  std::optional<Partition> Next(absl::Time deadline) {
+    absl::MutexLock lock(&mu_);
+    auto has_partition = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return !partitions_.empty();
+    };
+    if (!mu_.AwaitWithDeadline(absl::Condition(&has_partition), deadline)) {
+      return std::nullopt;
+    }
+    Partition partition = std::move(partitions_.front());
+    partitions_.pop_front();
+    return partition;
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::deque<Partition> partitions_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_set<std::string> seen_ ABSL_GUARDED_BY(mu_);
+};
+
+// Reads the change records of the complete rows of responses, all received at
+// arrival, into stats and partitions.
+absl::Status ProcessRecords(
+    const std::vector<spanner_api::PartialResultSet>& responses,
+    absl::Time arrival, ReaderStats* stats, PartitionQueue* partitions) {
+  absl::StatusOr<spanner_api::ResultSet> result =
+      google::spanner::emulator::backend::test::MergePartialResultSets(
+          responses, /*columns_per_row=*/1);
+  if (!result.ok()) return result.status();
+  // Each row holds an array of change records, each a struct of arrays of
+  // data change, heartbeat and child partitions records.
+  for (const google::protobuf::ListValue& row : result->rows()) {
+    for (const google::protobuf::Value& change_record :
+         row.values(0).list_value().values()) {
+      const auto& fields = change_record.list_value().values();
+      for (const google::protobuf::Value& data_change :
+           fields[0].list_value().values()) {
+        absl::Time commit_timestamp;
+        std::string error;
+        if (!absl::ParseTime(absl::RFC3339_full,
+                             data_change.list_value().values(0).string_value(),
+                             &commit_timestamp, &error)) {
+          return absl::InternalError(error);
+        }
+        stats->latencies.push_back(arrival - commit_timestamp);
+      }
+      stats->heartbeats += fields[1].list_value().values_size();
+      for (const google::protobuf::Value& child_partitions_record :
+           fields[2].list_value().values()) {
+        const auto& record = child_partitions_record.list_value().values();
+        absl::Time start;
+        std::string error;
+        if (!absl::ParseTime(absl::RFC3339_full, record[0].string_value(),
+                             &start, &error)) {
+          return absl::InternalError(error);
+        }
+        for (const google::protobuf::Value& child :
+             record[2].list_value().values()) {
+          partitions->Add(child.list_value().values(0).string_value(), start);
+        }
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Reads change stream partitions from partitions until deadline.
+void RunReader(spanner_api::Spanner::Stub* spanner,
+               const std::string& database_uri, absl::Time deadline,
+               PartitionQueue* partitions, ReaderStats* stats) {
+  const absl::Duration cpu_start = ThreadCpuTime();
+  std::string session;
+  {
+    grpc::ClientContext ctx;
+    spanner_api::CreateSessionRequest request;
+    request.set_database(database_uri);
+    spanner_api::Session response;
+    grpc::Status status = spanner->CreateSession(&ctx, request, &response);
+    ZETASQL_CHECK(status.ok())
+        << "Failed to create session: " << status.error_message();
+    session = response.name();
+  }
+  while (std::optional<PartitionQueue::Partition> partition =
+             partitions->Next(deadline)) {
+    ++stats->partitions;
+    spanner_api::ExecuteSqlRequest request;
+    request.set_session(session);
+    request.set_sql(absl::StrFormat(
+        "SELECT ChangeRecord FROM READ_%s('%s', NULL, %s, %d)", kChangeStream,
+        FormatTimestamp(partition->start),
+        partition->token.has_value()
+            ? absl::StrFormat("'%s'", *partition->token)
+            : "NULL",
+        absl::GetFlag(FLAGS_heartbeat_milliseconds)));
+    grpc::ClientContext ctx;
+    ctx.set_deadline(absl::ToChronoTime(deadline));
+    auto reader = spanner->ExecuteStreamingSql(&ctx, request);
+    // Responses are merged up to the one which completes the rows they hold.
+    std::vector<spanner_api::PartialResultSet> responses;
+    spanner_api::PartialResultSet response;
+    absl::Status status;
+    while (status.ok() && reader->Read(&response)) {
+      const bool chunked = response.chunked_value();
+      responses.push_back(std::move(response));
+      if (!chunked) {
+        status = ProcessRecords(responses, absl::Now(), stats, partitions);
+        responses.clear();
+      }
+    }
+    if (!status.ok()) {
+      ctx.TryCancel();
+    }
+    grpc::Status finish_status = reader->Finish();
+    if (status.ok() && !finish_status.ok() &&
+        finish_status.error_code() != grpc::StatusCode::DEADLINE_EXCEEDED) {
+      status = absl::Status(
+          static_cast<absl::StatusCode>(finish_status.error_code()),
+          finish_status.error_message());
+    }
+    if (!status.ok() && ++stats->errors == 1) {
+      ZETASQL_LOG(WARNING) << "Change stream query failed: " << status;
+    }
+  }
+  stats->cpu_time = ThreadCpuTime() - cpu_start;
+}
+
+// Commits transactions inserting rows into the tracked tables at rate
+// transactions per second until deadline, and returns the CPU time it used.
+absl::Duration RunWriter(benchmarks::WorkloadTarget* target, int writer,
+                         double rate, absl::Time deadline,
+                         std::atomic<int64_t>* next_id,
+                         std::atomic<int64_t>* errors) {
+  const absl::Duration cpu_start = ThreadCpuTime();
+  auto session = target->NewSession();
+  ZETASQL_CHECK(session.ok())
+      << "Failed to create session: " << session.status();
+  const absl::Duration interval = absl::Seconds(1 / rate);
+  const int num_tables = absl::GetFlag(FLAGS_tables);
+  const int rows_per_commit = absl::GetFlag(FLAGS_rows_per_commit);
+  int64_t commits = 0;
+  for (absl::Time next = absl::Now(); next < deadline; next += interval) {
+    absl::SleepFor(next - absl::Now());
+    const std::string table = TableName((writer + commits++) % num_tables);
+    absl::Status status = (*session)->RunTransaction(
+        [&](benchmarks::WorkloadTransaction* txn) {
+          std::vector<benchmarks::Row> rows;
+          for (int i = 0; i < rows_per_commit; ++i) {
+            rows.push_back({zetasql::Value::Int64((*next_id)++),
+                            zetasql::Value::String("value")});
+          }
+          txn->Write(benchmarks::WriteOp::kInsert, table, {"Id", "Value"},
+                     std::move(rows));
+          return absl::OkStatus();
+        });
+    if (!status.ok() && (*errors)++ == 0) {
+      ZETASQL_LOG(WARNING) << "Commit failed: " << status;
+    }
+  }
+  return ThreadCpuTime() - cpu_start;
+}
+
+// Prints the delivery latencies and throughput of the records read, and returns
+// them as a run.
+benchmarks::BenchmarkRun PrintReport(ReaderStats stats, absl::Duration elapsed,
+                                     int64_t commit_errors,
+                                     absl::Duration emulator_cpu_time) {
+  std::vector<absl::Duration>& latencies = stats.latencies;
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    if (latencies.empty()) return 0.0;
+    return absl::ToDoubleMilliseconds(
+        latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+  };
+  absl::PrintF("%-28s %10d\n", "data change records", latencies.size());
+  absl::PrintF("%-28s %10.1f\n", "records/s",
+               latencies.size() / absl::ToDoubleSeconds(elapsed));
+  absl::PrintF("%-28s %10d\n", "heartbeat records", stats.heartbeats);
+  absl::PrintF("%-28s %10d\n", "partitions read", stats.partitions);
+  absl::PrintF("%-28s %10d\n", "commit errors", commit_errors);
+  absl::PrintF("%-28s %10d\n", "change stream query errors", stats.errors);
+  absl::PrintF("%-28s %10.2f\n", "p50 delivery latency ms", percentile(0.5));
+  absl::PrintF("%-28s %10.2f\n", "p90 delivery latency ms", percentile(0.9));
+  absl::PrintF("%-28s %10.2f\n", "p99 delivery latency ms", percentile(0.99));
+  absl::PrintF("%-28s %10.2f\n", "max delivery latency ms", percentile(1.0));
+  benchmarks::BenchmarkRun run{
+      .name = "change_stream",
+      .metrics = {
+          {"records_per_second",
+           latencies.size() / absl::ToDoubleSeconds(elapsed)},
+          {"p50_delivery_latency_ms", percentile(0.5)},
+          {"p90_delivery_latency_ms", percentile(0.9)},
+          {"p99_delivery_latency_ms", percentile(0.99)},
+          {"max_delivery_latency_ms", percentile(1.0)},
+          {"errors", commit_errors + stats.errors}}};
+  if (emulator_cpu_time > absl::ZeroDuration() && !latencies.empty()) {
+    const double cpu_ms_per_record =
+        absl::ToDoubleMilliseconds(emulator_cpu_time) / latencies.size();
+    absl::PrintF("%-28s %10.3f\n", "emulator CPU ms/record",
+                 cpu_ms_per_record);
+    run.metrics.emplace_back("emulator_cpu_ms_per_record", cpu_ms_per_record);
+  }
+  return run;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const std::string endpoint = absl::GetFlag(FLAGS_endpoint);
+  std::unique_ptr<google::spanner::emulator::frontend::EmbeddedEmulator>
+      emulator;
+  std::shared_ptr<grpc::Channel> channel;
+  if (endpoint.empty()) {
+    auto embedded =
+        google::spanner::emulator::frontend::EmbeddedEmulator::Create();
+    ZETASQL_CHECK(embedded.ok())
+        << "Failed to start emulator: " << embedded.status();
+    emulator = *std::move(embedded);
+    channel = emulator->channel();
+  } else {
+    channel = grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials());
+  }
+  const std::string database_id =
+      absl::StrFormat("change-streams-%d", absl::ToUnixSeconds(absl::Now()));
+  auto target = benchmarks::CreateGrpcTarget(channel, kInstanceUri,
+                                             database_id, Schema());
+  ZETASQL_CHECK(target.ok())
+      << "Failed to create database: " << target.status();
+  auto spanner = spanner_api::Spanner::NewStub(channel);
+  const std::string database_uri =
+      absl::StrFormat("%s/databases/%s", kInstanceUri, database_id);
+
+  const absl::Time start = absl::Now();
+  const absl::Time commit_deadline = start + absl::GetFlag(FLAGS_duration);
+  const absl::Time read_deadline = commit_deadline + absl::GetFlag(FLAGS_drain);
+  absl::StatusOr<absl::Duration> emulator_cpu_start = EmulatorCpuTime();
+  ZETASQL_CHECK(emulator_cpu_start.ok()) << emulator_cpu_start.status();
+
+  PartitionQueue partitions(start);
+  const int num_readers = absl::GetFlag(FLAGS_readers);
+  std::vector<ReaderStats> reader_stats(num_readers);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < num_readers; ++i) {
+    readers.emplace_back(RunReader, spanner.get(), database_uri, read_deadline,
+                         &partitions, &reader_stats[i]);
+  }
+  // Writers start once readers have had time to pick up the initial
+  // partitions, so that early records are not delayed by the initial query.
+  absl::SleepFor(absl::Milliseconds(500));
+
+  const int num_writers = absl::GetFlag(FLAGS_writers);
+  std::atomic<int64_t> next_id = 0;
+  std::atomic<int64_t> commit_errors = 0;
+  std::vector<absl::Duration> writer_cpu_times(num_writers);
+  std::vector<std::thread> writers;
+  for (int i = 0; i < num_writers; ++i) {
+    writers.emplace_back([&, i]() {
+      writer_cpu_times[i] = RunWriter(
+          target->get(), i, absl::GetFlag(FLAGS_commit_rate) / num_writers,
+          commit_deadline, &next_id, &commit_errors);
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  absl::StatusOr<absl::Duration> emulator_cpu_end = EmulatorCpuTime();
+  ZETASQL_CHECK(emulator_cpu_end.ok()) << emulator_cpu_end.status();
+
+  ReaderStats stats;
+  for (const ReaderStats& s : reader_stats) {
+    stats.Merge(s);
+  }
+  absl::Duration emulator_cpu_time = *emulator_cpu_end - *emulator_cpu_start;
+  if (absl::GetFlag(FLAGS_emulator_pid) == 0) {
+    emulator_cpu_time -= stats.cpu_time;
+    for (absl::Duration cpu_time : writer_cpu_times) {
+      emulator_cpu_time -= cpu_time;
+    }
+  }
+  const bool failed = commit_errors > 0 || stats.errors > 0 ||
+                      stats.latencies.empty();
+  benchmarks::BenchmarkRun run =
+      PrintReport(std::move(stats), commit_deadline - start, commit_errors,
+                  emulator_cpu_time);
+
+  const std::string results_out = absl::GetFlag(FLAGS_results_out);
+  if (!results_out.empty()) {
+    // The embedded emulator is part of this process.
+    if (emulator != nullptr) {
+      run.metrics.emplace_back("peak_rss_bytes", benchmarks::PeakRssBytes());
+    }
+    absl::Status status = benchmarks::WriteResults(results_out, {run});
+    ZETASQL_CHECK(status.ok()) << status;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Benchmarks for chunking result sets into PartialResultSets.
+//
+// Run with:
+//   bazel run -c opt //benchmarks:chunking_benchmark
+
+#include <cstdint>
+#include <string>
+
+#include "google/protobuf/struct.pb.h"
+#include "google/spanner/v1/result_set.pb.h"
+#include "benchmark/benchmark.h"
+#include "benchmarks/resource_counters.h"
+#include "common/limits.h"
+#include "frontend/converters/chunking.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+namespace {
+
+// Builds a result set of num_rows rows, each with an INT64 column and a
+// STRING column of value_size bytes.
+google::spanner::v1::ResultSet MakeResultSet(int64_t num_rows,
+                                             int64_t value_size) {
+  google::spanner::v1::ResultSet result_set;
+  auto* row_type = result_set.mutable_metadata()->mutable_row_type();
+  auto* int_field = row_type->add_fields();
+  int_field->set_name("k");
+  int_field->mutable_type()->set_code(google::spanner::v1::INT64);
+  auto* string_field = row_type->add_fields();
+  string_field->set_name("v");
+  string_field->mutable_type()->set_code(google::spanner::v1::STRING);
+  const std::string value(value_size, 'x');
+  for (int64_t i = 0; i < num_rows; ++i) {
+    auto* row = result_set.add_rows();
+    row->add_values()->set_string_value(std::to_string(i));
+    row->add_values()->set_string_value(value);
+  }
+  return result_set;
+}
+
+void BM_ChunkResultSet(benchmark::State& state) {
+  const int64_t num_rows = state.range(0);
+  const int64_t value_size = state.range(1);
+  const google::spanner::v1::ResultSet result_set =
+      MakeResultSet(num_rows, value_size);
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    auto chunks = ChunkResultSet(result_set, limits::kMaxStreamingChunkSize);
+    benchmark::DoNotOptimize(chunks);
+  }
+  state.SetBytesProcessed(state.iterations() * num_rows * value_size);
+}
+BENCHMARK(BM_ChunkResultSet)->ArgsProduct({{100, 1000}, {16, 1024, 64 << 10}});
+
+}  // namespace
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
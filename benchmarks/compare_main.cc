@@ -0,0 +1,104 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compares two sets of benchmark results, such as those of two releases of the
+// emulator, and reports the change of the median of every metric of every
+// benchmark with its statistical significance.
+//
+// Results are files in the JSON format of Google Benchmark, written by the
+// micro-benchmarks with --benchmark_out, and by workload_main and
+// change_stream_main with --results_out. Each side takes several files, and
+// the runs with the same name in them, including the repetitions of a
+// micro-benchmark, are the samples of a benchmark. A change is significant
+// when the Mann-Whitney U test rejects, at --alpha, that both sides' samples
+// come from the same distribution, which needs at least four samples per side
+// at the default alpha. For example:
+//   bazel run -c opt //benchmarks:storage_benchmark -- \
+//     --benchmark_repetitions=10 --benchmark_out=/tmp/new.json
+//   bazel run -c opt //benchmarks:compare_main -- \
+//     --baseline=/tmp/old.json --contender=/tmp/new.json
+
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "zetasql/base/logging.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "benchmarks/results.h"
+
+ABSL_FLAG(std::string, baseline, "",
+          "Comma-separated result files of the baseline runs.");
+
+ABSL_FLAG(std::string, contender, "",
+          "Comma-separated result files of the runs compared to the "
+          "baseline.");
+
+ABSL_FLAG(double, alpha, 0.05,
+          "Significance level below which the p-value of a change must be "
+          "for it to be reported as an improvement or a regression.");
+
+ABSL_FLAG(bool, fail_on_regression, false,
+          "If true, exits with a non-zero status if any metric has a "
+          "significant regression.");
+
+namespace benchmarks = ::google::spanner::emulator::benchmarks;
+
+namespace {
+
+std::vector<benchmarks::BenchmarkRun> ReadRuns(const std::string& paths) {
+  std::vector<benchmarks::BenchmarkRun> runs;
+  for (absl::string_view path :
+       absl::StrSplit(paths, ',', absl::SkipWhitespace())) {
+    auto file_runs = benchmarks::ReadResults(std::string(path));
+    ZETASQL_CHECK(file_runs.ok()) << file_runs.status();
+    runs.insert(runs.end(), file_runs->begin(), file_runs->end());
+  }
+  return runs;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  ZETASQL_CHECK(!absl::GetFlag(FLAGS_baseline).empty() &&
+        !absl::GetFlag(FLAGS_contender).empty())
+      << "Both --baseline and --contender must be set";
+
+  const std::vector<benchmarks::MetricComparison> comparisons =
+      benchmarks::CompareResults(ReadRuns(absl::GetFlag(FLAGS_baseline)),
+                                 ReadRuns(absl::GetFlag(FLAGS_contender)));
+  const double alpha = absl::GetFlag(FLAGS_alpha);
+  int regressions = 0;
+  absl::PrintF("%-48s %-26s %14s %14s %9s %8s\n", "benchmark", "metric",
+               "baseline", "contender", "change", "p");
+  for (const benchmarks::MetricComparison& comparison : comparisons) {
+    const bool significant = comparison.p_value < alpha;
+    const char* verdict = "";
+    if (significant && comparison.change != 0) {
+      verdict = comparison.improvement ? "improved" : "REGRESSED";
+      regressions += comparison.improvement ? 0 : 1;
+    }
+    absl::PrintF("%-48s %-26s %14.4g %14.4g %8.1f%% %8.4f %s\n",
+                 comparison.benchmark, comparison.metric,
+                 comparison.baseline_median, comparison.contender_median,
+                 comparison.change * 100, comparison.p_value, verdict);
+  }
+  absl::PrintF("%d metrics compared, %d significant regressions\n",
+               comparisons.size(), regressions);
+  return absl::GetFlag(FLAGS_fail_on_regression) && regressions > 0 ? 1 : 0;
+}
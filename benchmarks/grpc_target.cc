@@ -0,0 +1,343 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/grpc_target.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/longrunning/operations.grpc.pb.h"
+#include "google/protobuf/empty.pb.h"
+#include "google/protobuf/struct.pb.h"
+#include "google/spanner/admin/database/v1/spanner_database_admin.grpc.pb.h"
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.grpc.pb.h"
+#include "google/spanner/v1/spanner.grpc.pb.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/workload.h"
+#include "frontend/converters/types.h"
+#include "frontend/converters/values.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/support/status.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+namespace {
+
+namespace database_api = ::google::spanner::admin::database::v1;
+namespace instance_api = ::google::spanner::admin::instance::v1;
+namespace operations_api = ::google::longrunning;
+namespace spanner_api = ::google::spanner::v1;
+
+absl::Status FromGrpcStatus(const grpc::Status& status) {
+  return absl::Status(static_cast<absl::StatusCode>(status.error_code()),
+                      status.error_message());
+}
+
+// Polls the long running operation until it is done.
+absl::Status WaitForOperation(operations_api::Operations::Stub* operations,
+                              operations_api::Operation op) {
+  while (!op.done()) {
+    absl::SleepFor(absl::Milliseconds(100));
+    grpc::ClientContext ctx;
+    operations_api::GetOperationRequest request;
+    request.set_name(op.name());
+    ZETASQL_RETURN_IF_ERROR(
+        FromGrpcStatus(operations->GetOperation(&ctx, request, &op)));
+  }
+  if (op.has_error()) {
+    return absl::Status(static_cast<absl::StatusCode>(op.error().code()),
+                        op.error().message());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SetParams(const Params& params,
+                       spanner_api::ExecuteSqlRequest* request) {
+  for (const auto& [name, value] : params) {
+    ZETASQL_RETURN_IF_ERROR(frontend::ValueToProto(
+        value, &(*request->mutable_params()->mutable_fields())[name]));
+    ZETASQL_RETURN_IF_ERROR(frontend::TypeToProto(
+        value.type(), &(*request->mutable_param_types())[name]));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<Row>> RowsFromProto(
+    const spanner_api::ResultSet& result, zetasql::TypeFactory* type_factory) {
+  std::vector<const zetasql::Type*> types;
+  for (const auto& field : result.metadata().row_type().fields()) {
+    const zetasql::Type* type = nullptr;
+    ZETASQL_RETURN_IF_ERROR(
+        frontend::TypeFromProto(field.type(), type_factory, &type));
+    types.push_back(type);
+  }
+  std::vector<Row> rows;
+  rows.reserve(result.rows_size());
+  for (const google::protobuf::ListValue& row_pb : result.rows()) {
+    Row row;
+    row.reserve(types.size());
+    const int num_columns = std::min<int>(row_pb.values_size(), types.size());
+    for (int i = 0; i < num_columns; ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value,
+                       frontend::ValueFromProto(row_pb.values(i), types[i]));
+      row.push_back(std::move(value));
+    }
+    rows.push_back(std::move(row));
+  }
+  return rows;
+}
+
+absl::Status RowToProto(const Row& row, google::protobuf::ListValue* row_pb) {
+  for (const zetasql::Value& value : row) {
+    ZETASQL_RETURN_IF_ERROR(
+        frontend::ValueToProto(value, row_pb->add_values()));
+  }
+  return absl::OkStatus();
+}
+
+class GrpcTransaction : public WorkloadTransaction {
+ public:
+  GrpcTransaction(spanner_api::Spanner::Stub* spanner,
+                  const std::string& session, const std::string& id,
+                  zetasql::TypeFactory* type_factory)
+      : spanner_(spanner),
+        session_(session),
+        id_(id),
+        type_factory_(type_factory) {}
+
+  absl::StatusOr<std::vector<Row>> Query(const std::string& sql,
+                                         const Params& params) override {
+    spanner_api::ExecuteSqlRequest request;
+    request.set_session(session_);
+    request.mutable_transaction()->set_id(id_);
+    request.set_sql(sql);
+    request.set_seqno(next_seqno_++);
+    ZETASQL_RETURN_IF_ERROR(SetParams(params, &request));
+    grpc::ClientContext ctx;
+    spanner_api::ResultSet result;
+    ZETASQL_RETURN_IF_ERROR(
+        FromGrpcStatus(spanner_->ExecuteSql(&ctx, request, &result)));
+    return RowsFromProto(result, type_factory_);
+  }
+
+  void Write(WriteOp op, const std::string& table,
+             std::vector<std::string> columns,
+             std::vector<Row> rows) override {
+    spanner_api::Mutation* mutation = commit_.add_mutations();
+    if (op == WriteOp::kDelete) {
+      mutation->mutable_delete_()->set_table(table);
+      for (const Row& row : rows) {
+        AddRow(row, mutation->mutable_delete_()->mutable_key_set()->add_keys());
+      }
+      return;
+    }
+    spanner_api::Mutation::Write* write =
+        op == WriteOp::kInsert   ? mutation->mutable_insert()
+        : op == WriteOp::kUpdate ? mutation->mutable_update()
+                                 : mutation->mutable_insert_or_update();
+    write->set_table(table);
+    for (std::string& column : columns) {
+      write->add_columns(std::move(column));
+    }
+    for (const Row& row : rows) {
+      AddRow(row, write->add_values());
+    }
+  }
+
+  // Commits the transaction with the buffered writes.
+  absl::Status Commit() {
+    ZETASQL_RETURN_IF_ERROR(write_status_);
+    commit_.set_session(session_);
+    commit_.set_transaction_id(id_);
+    grpc::ClientContext ctx;
+    spanner_api::CommitResponse response;
+    return FromGrpcStatus(spanner_->Commit(&ctx, commit_, &response));
+  }
+
+ private:
+  // Encodes row into row_pb, keeping the first error for Commit to return.
+  void AddRow(const Row& row, google::protobuf::ListValue* row_pb) {
+    absl::Status status = RowToProto(row, row_pb);
+    if (write_status_.ok()) write_status_ = status;
+  }
+
+  spanner_api::Spanner::Stub* spanner_;
+  const std::string session_;
+  const std::string id_;
+  zetasql::TypeFactory* type_factory_;
+  int64_t next_seqno_ = 1;
+  spanner_api::CommitRequest commit_;
+  absl::Status write_status_;
+};
+
+class GrpcSession : public WorkloadSession {
+ public:
+  GrpcSession(spanner_api::Spanner::Stub* spanner, std::string session)
+      : spanner_(spanner), session_(std::move(session)) {}
+
+  ~GrpcSession() override {
+    grpc::ClientContext ctx;
+    spanner_api::DeleteSessionRequest request;
+    request.set_name(session_);
+    google::protobuf::Empty response;
+    spanner_->DeleteSession(&ctx, request, &response).ok();
+  }
+
+  absl::Status RunTransaction(
+      const std::function<absl::Status(WorkloadTransaction*)>& body) override {
+    // Transactions retried on the same session keep the priority of the
+    // aborted one, like those of a client library.
+    while (true) {
+      spanner_api::BeginTransactionRequest request;
+      request.set_session(session_);
+      request.mutable_options()->mutable_read_write();
+      spanner_api::Transaction txn;
+      {
+        grpc::ClientContext ctx;
+        ZETASQL_RETURN_IF_ERROR(
+            FromGrpcStatus(spanner_->BeginTransaction(&ctx, request, &txn)));
+      }
+      GrpcTransaction transaction(spanner_, session_, txn.id(),
+                                  &type_factory_);
+      absl::Status status = body(&transaction);
+      if (status.ok()) status = transaction.Commit();
+      if (status.ok()) return status;
+      if (absl::IsAborted(status)) continue;
+      grpc::ClientContext ctx;
+      spanner_api::RollbackRequest rollback;
+      rollback.set_session(session_);
+      rollback.set_transaction_id(txn.id());
+      google::protobuf::Empty response;
+      spanner_->Rollback(&ctx, rollback, &response).ok();
+      return status;
+    }
+  }
+
+  absl::StatusOr<std::vector<Row>> Query(const std::string& sql,
+                                         const Params& params) override {
+    // Without a transaction selector the query runs in a strong single use
+    // read-only transaction.
+    spanner_api::ExecuteSqlRequest request;
+    request.set_session(session_);
+    request.set_sql(sql);
+    ZETASQL_RETURN_IF_ERROR(SetParams(params, &request));
+    grpc::ClientContext ctx;
+    spanner_api::ResultSet result;
+    ZETASQL_RETURN_IF_ERROR(
+        FromGrpcStatus(spanner_->ExecuteSql(&ctx, request, &result)));
+    return RowsFromProto(result, &type_factory_);
+  }
+
+ private:
+  spanner_api::Spanner::Stub* spanner_;
+  const std::string session_;
+  zetasql::TypeFactory type_factory_;
+};
+
+class GrpcTarget : public WorkloadTarget {
+ public:
+  explicit GrpcTarget(std::shared_ptr<grpc::Channel> channel)
+      : spanner_(spanner_api::Spanner::NewStub(channel)),
+        database_admin_(database_api::DatabaseAdmin::NewStub(channel)),
+        instance_admin_(instance_api::InstanceAdmin::NewStub(channel)),
+        operations_(operations_api::Operations::NewStub(channel)) {}
+
+  absl::Status Init(absl::string_view instance_uri,
+                    absl::string_view database_id,
+                    const std::vector<std::string>& schema) {
+    {
+      const std::string project(
+          instance_uri.substr(0, instance_uri.find("/instances/")));
+      grpc::ClientContext ctx;
+      instance_api::CreateInstanceRequest request;
+      request.set_parent(project);
+      request.set_instance_id(std::string(
+          instance_uri.substr(instance_uri.find_last_of('/') + 1)));
+      request.mutable_instance()->set_config(
+          absl::StrCat(project, "/instanceConfigs/emulator-config"));
+      request.mutable_instance()->set_display_name("Benchmark");
+      request.mutable_instance()->set_node_count(1);
+      operations_api::Operation op;
+      absl::Status status = FromGrpcStatus(
+          instance_admin_->CreateInstance(&ctx, request, &op));
+      if (status.ok()) {
+        status = WaitForOperation(operations_.get(), std::move(op));
+      }
+      if (!status.ok() && !absl::IsAlreadyExists(status)) return status;
+    }
+    grpc::ClientContext ctx;
+    database_api::CreateDatabaseRequest request;
+    request.set_parent(std::string(instance_uri));
+    request.set_create_statement(
+        absl::StrCat("CREATE DATABASE `", database_id, "`"));
+    for (const std::string& statement : schema) {
+      request.add_extra_statements(statement);
+    }
+    operations_api::Operation op;
+    ZETASQL_RETURN_IF_ERROR(FromGrpcStatus(
+        database_admin_->CreateDatabase(&ctx, request, &op)));
+    ZETASQL_RETURN_IF_ERROR(WaitForOperation(operations_.get(), std::move(op)));
+    database_uri_ = absl::StrCat(instance_uri, "/databases/", database_id);
+    return absl::OkStatus();
+  }
+
+  absl::StatusOr<std::unique_ptr<WorkloadSession>> NewSession() override {
+    grpc::ClientContext ctx;
+    spanner_api::CreateSessionRequest request;
+    request.set_database(database_uri_);
+    spanner_api::Session session;
+    ZETASQL_RETURN_IF_ERROR(
+        FromGrpcStatus(spanner_->CreateSession(&ctx, request, &session)));
+    return std::make_unique<GrpcSession>(spanner_.get(), session.name());
+  }
+
+ private:
+  std::unique_ptr<spanner_api::Spanner::Stub> spanner_;
+  std::unique_ptr<database_api::DatabaseAdmin::Stub> database_admin_;
+  std::unique_ptr<instance_api::InstanceAdmin::Stub> instance_admin_;
+  std::unique_ptr<operations_api::Operations::Stub> operations_;
+  std::string database_uri_;
+};
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<WorkloadTarget>> CreateGrpcTarget(
+    std::shared_ptr<grpc::Channel> channel, absl::string_view instance_uri,
+    absl::string_view database_id, const std::vector<std::string>& schema) {
+  auto target = std::make_unique<GrpcTarget>(std::move(channel));
+  ZETASQL_RETURN_IF_ERROR(target->Init(instance_uri, database_id, schema));
+  return target;
+}
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
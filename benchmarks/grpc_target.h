@@ -0,0 +1,50 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_GRPC_TARGET_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_GRPC_TARGET_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "benchmarks/workload.h"
+#include "grpcpp/channel.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+// Creates a target backed by database database_id of the instance
+// instance_uri, e.g. "projects/p/instances/i", of the emulator at the other end
+// of channel. The instance is created if it does not exist yet, and the
+// database is created with the DDL statements of schema.
+//
+// Rows returned by queries of the sessions of the target may refer to types
+// owned by the session, and must not outlive it.
+absl::StatusOr<std::unique_ptr<WorkloadTarget>> CreateGrpcTarget(
+    std::shared_ptr<grpc::Channel> channel, absl::string_view instance_uri,
+    absl::string_view database_id, const std::vector<std::string>& schema);
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_GRPC_TARGET_H_
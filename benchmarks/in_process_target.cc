@@ -0,0 +1,197 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/in_process_target.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "backend/access/read.h"
+#include "backend/access/write.h"
+#include "backend/database/database.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/query/query_engine.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/updater/schema_updater.h"
+#include "backend/transaction/options.h"
+#include "backend/transaction/read_only_transaction.h"
+#include "backend/transaction/read_write_transaction.h"
+#include "benchmarks/workload.h"
+#include "common/clock.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+namespace {
+
+// Executes sql against reader, and writer for DML, and drains its rows.
+absl::StatusOr<std::vector<Row>> ExecuteQuery(backend::Database* database,
+                                              const backend::Schema* schema,
+                                              backend::RowReader* reader,
+                                              backend::RowWriter* writer,
+                                              const std::string& sql,
+                                              const Params& params) {
+  backend::Query query{sql};
+  query.declared_params = params;
+  ZETASQL_ASSIGN_OR_RETURN(
+      backend::QueryResult result,
+      database->query_engine()->ExecuteSql(
+          query, backend::QueryContext{
+                     .schema = schema, .reader = reader, .writer = writer}));
+  std::vector<Row> rows;
+  if (result.rows == nullptr) return rows;
+  while (result.rows->Next()) {
+    Row row;
+    row.reserve(result.rows->NumColumns());
+    for (int i = 0; i < result.rows->NumColumns(); ++i) {
+      row.push_back(result.rows->ColumnValue(i));
+    }
+    rows.push_back(std::move(row));
+  }
+  ZETASQL_RETURN_IF_ERROR(result.rows->Status());
+  return rows;
+}
+
+class InProcessTransaction : public WorkloadTransaction {
+ public:
+  InProcessTransaction(backend::Database* database,
+                       backend::ReadWriteTransaction* txn)
+      : database_(database), txn_(txn) {}
+
+  absl::StatusOr<std::vector<Row>> Query(const std::string& sql,
+                                         const Params& params) override {
+    return ExecuteQuery(database_, txn_->schema(), txn_, txn_, sql, params);
+  }
+
+  void Write(WriteOp op, const std::string& table,
+             std::vector<std::string> columns,
+             std::vector<Row> rows) override {
+    switch (op) {
+      case WriteOp::kInsert:
+        mutation_.AddWriteOp(backend::MutationOpType::kInsert, table,
+                             std::move(columns), std::move(rows));
+        break;
+      case WriteOp::kUpdate:
+        mutation_.AddWriteOp(backend::MutationOpType::kUpdate, table,
+                             std::move(columns), std::move(rows));
+        break;
+      case WriteOp::kInsertOrUpdate:
+        mutation_.AddWriteOp(backend::MutationOpType::kInsertOrUpdate, table,
+                             std::move(columns), std::move(rows));
+        break;
+      case WriteOp::kDelete: {
+        backend::KeySet key_set;
+        for (Row& row : rows) {
+          key_set.AddKey(backend::Key(std::move(row)));
+        }
+        mutation_.AddDeleteOp(table, key_set);
+        break;
+      }
+    }
+  }
+
+  // Applies the buffered writes and commits the transaction.
+  absl::Status Commit() {
+    ZETASQL_RETURN_IF_ERROR(txn_->Write(mutation_));
+    return txn_->Commit();
+  }
+
+ private:
+  backend::Database* database_;
+  backend::ReadWriteTransaction* txn_;
+  backend::Mutation mutation_;
+};
+
+class InProcessSession : public WorkloadSession {
+ public:
+  explicit InProcessSession(backend::Database* database)
+      : database_(database) {}
+
+  absl::Status RunTransaction(
+      const std::function<absl::Status(WorkloadTransaction*)>& body) override {
+    // Like a client library retrying on the same session, a retried
+    // transaction keeps the priority of the aborted one so that it eventually
+    // wins against the transactions it conflicts with.
+    backend::RetryState retry_state;
+    while (true) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::unique_ptr<backend::ReadWriteTransaction> txn,
+          database_->CreateReadWriteTransaction(backend::ReadWriteOptions(),
+                                                retry_state));
+      InProcessTransaction transaction(database_, txn.get());
+      absl::Status status = body(&transaction);
+      if (status.ok()) status = transaction.Commit();
+      if (status.ok()) return status;
+      txn->Rollback().IgnoreError();
+      if (!absl::IsAborted(status)) return status;
+      retry_state = txn->retry_state();
+    }
+  }
+
+  absl::StatusOr<std::vector<Row>> Query(const std::string& sql,
+                                         const Params& params) override {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<backend::ReadOnlyTransaction> txn,
+        database_->CreateReadOnlyTransaction(backend::ReadOnlyOptions()));
+    return ExecuteQuery(database_, txn->schema(), txn.get(),
+                        /*writer=*/nullptr, sql, params);
+  }
+
+ private:
+  backend::Database* database_;
+};
+
+class InProcessTarget : public WorkloadTarget {
+ public:
+  absl::Status Init(const std::vector<std::string>& schema) {
+    ZETASQL_ASSIGN_OR_RETURN(database_,
+                     backend::Database::Create(
+                         &clock_, backend::SchemaChangeOperation{
+                                      .statements = schema}));
+    return absl::OkStatus();
+  }
+
+  absl::StatusOr<std::unique_ptr<WorkloadSession>> NewSession() override {
+    return std::make_unique<InProcessSession>(database_.get());
+  }
+
+ private:
+  Clock clock_;
+  std::unique_ptr<backend::Database> database_;
+};
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<WorkloadTarget>> CreateInProcessTarget(
+    const std::vector<std::string>& schema) {
+  auto target = std::make_unique<InProcessTarget>();
+  ZETASQL_RETURN_IF_ERROR(target->Init(schema));
+  return target;
+}
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
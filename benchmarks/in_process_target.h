@@ -0,0 +1,43 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_IN_PROCESS_TARGET_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_IN_PROCESS_TARGET_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "benchmarks/workload.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+// Creates a target backed by a backend database created in-process with the
+// DDL statements of schema. Workloads run against it bypass gRPC and the
+// frontend, so that they measure the backend alone.
+absl::StatusOr<std::unique_ptr<WorkloadTarget>> CreateInProcessTarget(
+    const std::vector<std::string>& schema);
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_IN_PROCESS_TARGET_H_
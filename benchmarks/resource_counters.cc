@@ -0,0 +1,46 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/resource_counters.h"
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/results.h"
+#include "common/profiling.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+ResourceCounters::ResourceCounters(benchmark::State* state) : state_(state) {
+  profiling::EnableAllocationCounting();
+  start_ = profiling::ThreadAllocationCount();
+}
+
+ResourceCounters::~ResourceCounters() {
+  const profiling::AllocationCount end = profiling::ThreadAllocationCount();
+  state_->counters["allocs_per_iteration"] =
+      benchmark::Counter(end.allocations - start_.allocations,
+                         benchmark::Counter::kAvgIterations);
+  state_->counters["alloc_bytes_per_iteration"] = benchmark::Counter(
+      end.bytes - start_.bytes, benchmark::Counter::kAvgIterations);
+  state_->counters["peak_rss_bytes"] = PeakRssBytes();
+}
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,49 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_RESOURCE_COUNTERS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_RESOURCE_COUNTERS_H_
+
+#include "benchmark/benchmark.h"
+#include "common/profiling.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+// Reports the allocations made by the iterations of a micro-benchmark, and the
+// peak resident set size of the process, as counters of the benchmark:
+// allocs_per_iteration, alloc_bytes_per_iteration and peak_rss_bytes. Create
+// it after the setup of the benchmark, right before its loop. Allocations are
+// only counted if the binary links //common:allocation_hooks, and only those
+// of the benchmark thread.
+class ResourceCounters {
+ public:
+  explicit ResourceCounters(benchmark::State* state);
+  ~ResourceCounters();
+
+ private:
+  benchmark::State* state_;
+  profiling::AllocationCount start_;
+};
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_RESOURCE_COUNTERS_H_
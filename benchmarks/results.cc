@@ -0,0 +1,281 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/results.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "nlohmann/json.hpp"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+namespace {
+
+// Ordered, so that metrics are written and read in the order they are reported.
+using JSON = ::nlohmann::ordered_json;
+
+// Numeric fields of Google Benchmark runs which describe the run rather than
+// measure it.
+constexpr absl::string_view kRunFields[] = {
+    "family_index",     "per_family_instance_index",
+    "repetitions",      "repetition_index",
+    "threads",          "iterations",
+};
+
+// Returns the number of nanoseconds in a unit of time_unit.
+absl::StatusOr<double> NanosecondsPerUnit(absl::string_view time_unit) {
+  if (time_unit == "ns") return 1;
+  if (time_unit == "us") return 1e3;
+  if (time_unit == "ms") return 1e6;
+  if (time_unit == "s") return 1e9;
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown time unit: ", time_unit));
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<BenchmarkRun>> ParseResults(absl::string_view json) {
+  const JSON results = JSON::parse(json.begin(), json.end(), nullptr,
+                                   /*allow_exceptions=*/false);
+  if (results.is_discarded() || !results.is_object() ||
+      !results.contains("benchmarks") || !results["benchmarks"].is_array()) {
+    return absl::InvalidArgumentError(
+        "Benchmark results must be a JSON object with a benchmarks array");
+  }
+  std::vector<BenchmarkRun> runs;
+  for (const JSON& entry : results["benchmarks"]) {
+    if (!entry.is_object() || !entry.contains("name") ||
+        !entry["name"].is_string()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Benchmark run without a name: ", entry.dump()));
+    }
+    if (entry.value("run_type", "iteration") != "iteration" ||
+        entry.value("error_occurred", false)) {
+      continue;
+    }
+    BenchmarkRun run;
+    // Repetitions of a micro-benchmark are named after their repetition, but
+    // share their run name.
+    run.name = entry.value("run_name", entry["name"].get<std::string>());
+    double ns_per_unit = 1;
+    if (entry.contains("time_unit")) {
+      auto unit = NanosecondsPerUnit(entry.value("time_unit", ""));
+      if (!unit.ok()) return unit.status();
+      ns_per_unit = *unit;
+    }
+    for (const auto& [field, value] : entry.items()) {
+      if (!value.is_number() ||
+          std::find(std::begin(kRunFields), std::end(kRunFields), field) !=
+              std::end(kRunFields)) {
+        continue;
+      }
+      if (field == "real_time" || field == "cpu_time") {
+        run.metrics.emplace_back(absl::StrCat(field, "_ns"),
+                                 value.get<double>() * ns_per_unit);
+      } else {
+        run.metrics.emplace_back(field, value.get<double>());
+      }
+    }
+    runs.push_back(std::move(run));
+  }
+  return runs;
+}
+
+std::string ResultsToJson(absl::Span<const BenchmarkRun> runs) {
+  JSON benchmarks = JSON::array();
+  for (const BenchmarkRun& run : runs) {
+    JSON entry = JSON::object();
+    entry["name"] = run.name;
+    entry["run_name"] = run.name;
+    entry["run_type"] = "iteration";
+    for (const auto& [metric, value] : run.metrics) {
+      entry[metric] = value;
+    }
+    benchmarks.push_back(std::move(entry));
+  }
+  JSON results = JSON::object();
+  results["benchmarks"] = std::move(benchmarks);
+  return results.dump(2);
+}
+
+absl::StatusOr<std::vector<BenchmarkRun>> ReadResults(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    return absl::NotFoundError(absl::StrCat("Cannot read ", path));
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  auto runs = ParseResults(contents.str());
+  if (!runs.ok()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(path, ": ", runs.status().message()));
+  }
+  return runs;
+}
+
+absl::Status WriteResults(const std::string& path,
+                          absl::Span<const BenchmarkRun> runs) {
+  std::ofstream file(path);
+  file << ResultsToJson(runs) << "\n";
+  file.close();
+  if (!file) {
+    return absl::InternalError(absl::StrCat("Cannot write ", path));
+  }
+  return absl::OkStatus();
+}
+
+int64_t PeakRssBytes() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // Linux reports the peak resident set size in kilobytes.
+  return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+}
+
+double MannWhitneyPValue(absl::Span<const double> a,
+                         absl::Span<const double> b) {
+  if (a.size() < 2 || b.size() < 2) {
+    return 1;
+  }
+  // Ranks the samples of both sides together, giving tied samples the mean of
+  // their ranks.
+  std::vector<std::pair<double, bool>> samples;
+  for (double value : a) samples.emplace_back(value, true);
+  for (double value : b) samples.emplace_back(value, false);
+  std::sort(samples.begin(), samples.end());
+  const double n1 = a.size();
+  const double n2 = b.size();
+  const double n = samples.size();
+  double rank_sum = 0;
+  double tie_term = 0;
+  for (size_t i = 0; i < samples.size();) {
+    size_t j = i;
+    while (j < samples.size() && samples[j].first == samples[i].first) ++j;
+    const double ties = j - i;
+    const double rank = (i + 1 + j) / 2.0;
+    for (size_t k = i; k < j; ++k) {
+      if (samples[k].second) rank_sum += rank;
+    }
+    tie_term += ties * ties * ties - ties;
+    i = j;
+  }
+  const double u = rank_sum - n1 * (n1 + 1) / 2;
+  const double mean = n1 * n2 / 2;
+  const double sigma =
+      std::sqrt(n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1))));
+  if (sigma == 0) {
+    return 1;
+  }
+  const double z = std::max(0.0, std::abs(u - mean) - 0.5) / sigma;
+  return std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<MetricComparison> CompareResults(
+    absl::Span<const BenchmarkRun> baseline,
+    absl::Span<const BenchmarkRun> contender) {
+  // The samples of each metric of each benchmark, keyed by benchmark and then
+  // metric, in the order they are first seen.
+  using Samples = std::vector<std::pair<std::string, std::vector<double>>>;
+  auto collect = [](absl::Span<const BenchmarkRun> runs,
+                    std::vector<std::string>* order) {
+    absl::flat_hash_map<std::string, Samples> samples;
+    for (const BenchmarkRun& run : runs) {
+      auto [itr, inserted] = samples.try_emplace(run.name);
+      if (inserted && order != nullptr) {
+        order->push_back(run.name);
+      }
+      for (const auto& [metric, value] : run.metrics) {
+        Samples& metrics = itr->second;
+        auto m = std::find_if(metrics.begin(), metrics.end(),
+                              [&](const auto& s) { return s.first == metric; });
+        if (m == metrics.end()) {
+          metrics.emplace_back(metric, std::vector<double>());
+          m = metrics.end() - 1;
+        }
+        m->second.push_back(value);
+      }
+    }
+    return samples;
+  };
+  std::vector<std::string> names;
+  absl::flat_hash_map<std::string, Samples> baseline_samples =
+      collect(baseline, &names);
+  absl::flat_hash_map<std::string, Samples> contender_samples =
+      collect(contender, nullptr);
+
+  std::vector<MetricComparison> comparisons;
+  for (const std::string& name : names) {
+    auto contender_itr = contender_samples.find(name);
+    if (contender_itr == contender_samples.end()) {
+      continue;
+    }
+    for (const auto& [metric, a] : baseline_samples[name]) {
+      auto b = std::find_if(contender_itr->second.begin(),
+                            contender_itr->second.end(),
+                            [&](const auto& s) { return s.first == metric; });
+      if (b == contender_itr->second.end()) {
+        continue;
+      }
+      MetricComparison comparison;
+      comparison.benchmark = name;
+      comparison.metric = metric;
+      comparison.baseline_samples = a.size();
+      comparison.contender_samples = b->second.size();
+      comparison.baseline_median = Median(a);
+      comparison.contender_median = Median(b->second);
+      if (comparison.baseline_median != 0) {
+        comparison.change =
+            (comparison.contender_median - comparison.baseline_median) /
+            std::abs(comparison.baseline_median);
+      }
+      comparison.p_value = MannWhitneyPValue(a, b->second);
+      const bool higher_is_better = absl::EndsWith(metric, "_per_second");
+      comparison.improvement = higher_is_better ? comparison.change > 0
+                                                : comparison.change < 0;
+      comparisons.push_back(std::move(comparison));
+    }
+  }
+  return comparisons;
+}
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,102 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_RESULTS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_RESULTS_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+// The metrics measured by one run of one benchmark, such as an operation of a
+// workload or one repetition of a micro-benchmark. Several runs with the same
+// name are samples of the same benchmark.
+struct BenchmarkRun {
+  std::string name;
+  // Metric names and values, in the order they are reported. Metrics whose
+  // names end with "_per_second" are better when higher, and all others, such
+  // as latencies, allocations and memory, are better when lower.
+  std::vector<std::pair<std::string, double>> metrics;
+};
+
+// Parses benchmark results in the JSON format written by Google Benchmark with
+// --benchmark_out_format=json, which is also the format written by
+// ResultsToJson. Aggregate runs, such as the mean of repetitions, are skipped,
+// as comparisons compute their own. The times of micro-benchmarks are reported
+// as real_time_ns and cpu_time_ns, and their counters under their own names.
+absl::StatusOr<std::vector<BenchmarkRun>> ParseResults(absl::string_view json);
+
+// Returns runs in the JSON format read by ParseResults.
+std::string ResultsToJson(absl::Span<const BenchmarkRun> runs);
+
+// Reads the results in the file at path, as by ParseResults.
+absl::StatusOr<std::vector<BenchmarkRun>> ReadResults(const std::string& path);
+
+// Writes runs to the file at path, as by ResultsToJson.
+absl::Status WriteResults(const std::string& path,
+                          absl::Span<const BenchmarkRun> runs);
+
+// Returns the peak resident set size of the process, in bytes.
+int64_t PeakRssBytes();
+
+// The change of one metric of one benchmark between two sets of runs.
+struct MetricComparison {
+  std::string benchmark;
+  std::string metric;
+  int baseline_samples = 0;
+  int contender_samples = 0;
+  double baseline_median = 0;
+  double contender_median = 0;
+  // The relative change from the baseline to the contender median, e.g. 0.1
+  // for 10% higher.
+  double change = 0;
+  // The two-sided p-value of the samples being drawn from the same
+  // distribution, or 1 if either side has fewer than two samples.
+  double p_value = 1;
+  // Whether the change makes the metric better, e.g. lower latency.
+  bool improvement = false;
+};
+
+// Returns the two-sided p-value of the Mann-Whitney U test of samples a and b
+// being drawn from the same distribution, using the normal approximation with
+// tie and continuity corrections. Returns 1 if either has fewer than two
+// samples.
+double MannWhitneyPValue(absl::Span<const double> a,
+                         absl::Span<const double> b);
+
+// Compares every metric of every benchmark which has runs in both baseline and
+// contender, in the order of their first baseline run.
+std::vector<MetricComparison> CompareResults(
+    absl::Span<const BenchmarkRun> baseline,
+    absl::Span<const BenchmarkRun> contender);
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_RESULTS_H_
@@ -0,0 +1,130 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/results.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+namespace {
+
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+using ::testing::Pair;
+using ::testing::SizeIs;
+using ::zetasql_base::testing::StatusIs;
+
+TEST(ResultsTest, ParsesGoogleBenchmarkResults) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<BenchmarkRun> runs, ParseResults(R"({
+    "context": {"num_cpus": 8},
+    "benchmarks": [
+      {"name": "BM_Lookup/1024/repeats:2", "run_name": "BM_Lookup/1024",
+       "run_type": "iteration", "repetitions": 2, "repetition_index": 0,
+       "iterations": 1000, "real_time": 2.5, "cpu_time": 2.0,
+       "time_unit": "us", "items_per_second": 400000, "label": "x"},
+      {"name": "BM_Lookup/1024/repeats:2_mean", "run_name": "BM_Lookup/1024",
+       "run_type": "aggregate", "aggregate_name": "mean", "real_time": 2.5,
+       "cpu_time": 2.0, "time_unit": "us"}
+    ]
+  })"));
+  ASSERT_THAT(runs, SizeIs(1));
+  EXPECT_EQ(runs[0].name, "BM_Lookup/1024");
+  EXPECT_THAT(runs[0].metrics,
+              ElementsAre(Pair("real_time_ns", 2500), Pair("cpu_time_ns", 2000),
+                          Pair("items_per_second", 400000)));
+
+  EXPECT_THAT(ParseResults("[]"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ParseResults(R"({"benchmarks": [{"real_time": 1}]})"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ResultsTest, ParsesResultsItWrites) {
+  const std::vector<BenchmarkRun> runs = {
+      {.name = "ycsb_a/read",
+       .metrics = {{"p99_latency_ms", 1.5}, {"ops_per_second", 2000}}},
+      {.name = "ycsb_a/total", .metrics = {{"ops_per_second", 4000}}}};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<BenchmarkRun> parsed,
+                       ParseResults(ResultsToJson(runs)));
+  ASSERT_THAT(parsed, SizeIs(2));
+  EXPECT_EQ(parsed[0].name, "ycsb_a/read");
+  EXPECT_EQ(parsed[0].metrics, runs[0].metrics);
+  EXPECT_EQ(parsed[1].name, "ycsb_a/total");
+  EXPECT_EQ(parsed[1].metrics, runs[1].metrics);
+}
+
+TEST(ResultsTest, MannWhitneyPValue) {
+  // Five samples on each side which do not overlap.
+  EXPECT_THAT(MannWhitneyPValue({1, 2, 3, 4, 5}, {6, 7, 8, 9, 10}),
+              DoubleNear(0.0122, 1e-4));
+  EXPECT_GT(MannWhitneyPValue({1, 3, 5, 7, 9}, {2, 4, 6, 8, 10}), 0.5);
+  EXPECT_EQ(MannWhitneyPValue({1, 1, 1}, {1, 1, 1}), 1);
+  EXPECT_EQ(MannWhitneyPValue({1}, {2, 3, 4}), 1);
+}
+
+TEST(ResultsTest, ComparesMetricsOfBenchmarksOnBothSides) {
+  auto runs = [](const std::string& name, std::vector<double> latencies,
+                 double throughput) {
+    std::vector<BenchmarkRun> runs;
+    for (double latency : latencies) {
+      runs.push_back({.name = name,
+                      .metrics = {{"p99_latency_ms", latency},
+                                  {"ops_per_second", throughput}}});
+    }
+    return runs;
+  };
+  std::vector<BenchmarkRun> baseline = runs("a", {10, 11, 12, 13, 14}, 100);
+  std::vector<BenchmarkRun> only_baseline = runs("b", {1}, 1);
+  baseline.insert(baseline.end(), only_baseline.begin(), only_baseline.end());
+  const std::vector<BenchmarkRun> contender =
+      runs("a", {20, 21, 22, 23, 24}, 110);
+
+  const std::vector<MetricComparison> comparisons =
+      CompareResults(baseline, contender);
+  ASSERT_THAT(comparisons, SizeIs(2));
+  EXPECT_EQ(comparisons[0].benchmark, "a");
+  EXPECT_EQ(comparisons[0].metric, "p99_latency_ms");
+  EXPECT_EQ(comparisons[0].baseline_samples, 5);
+  EXPECT_EQ(comparisons[0].baseline_median, 12);
+  EXPECT_EQ(comparisons[0].contender_median, 22);
+  EXPECT_THAT(comparisons[0].change, DoubleNear(10.0 / 12, 1e-9));
+  EXPECT_LT(comparisons[0].p_value, 0.05);
+  EXPECT_FALSE(comparisons[0].improvement);
+
+  // Higher throughput is an improvement. Benchmark b has no contender runs.
+  EXPECT_EQ(comparisons[1].metric, "ops_per_second");
+  EXPECT_THAT(comparisons[1].change, DoubleNear(0.1, 1e-9));
+  EXPECT_LT(comparisons[1].p_value, 0.05);
+  EXPECT_TRUE(comparisons[1].improvement);
+}
+
+}  // namespace
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
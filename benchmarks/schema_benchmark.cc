@@ -0,0 +1,299 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for creating and updating large schemas through SchemaUpdater:
+// many tables, deep interleaving chains, many indexes and foreign keys, and
+// many views. Besides the time of each iteration, every benchmark reports the
+// average time per iteration spent in each stage of the schema update (see
+// emulator_schema_update_stage_latency_seconds), and in building the action
+// registry of the resulting schema, as the parse_ms, validate_ms,
+// canonicalize_ms and action_registry_ms counters.
+//
+// Run with:
+//   bazel run -c opt //benchmarks:schema_benchmark
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/type.h"
+#include "benchmark/benchmark.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/actions/manager.h"
+#include "backend/common/ids.h"
+#include "backend/query/function_catalog.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/updater/schema_updater.h"
+#include "backend/storage/in_memory_storage.h"
+#include "benchmarks/resource_counters.h"
+#include "common/limits.h"
+#include "common/metrics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+void CheckOk(const absl::Status& status) {
+  if (!status.ok()) {
+    ZETASQL_LOG(FATAL) << status;
+  }
+}
+
+// Returns the statement creating table i, with a key, two payload columns and
+// a column referencing the key of another table.
+std::string CreateTable(int i) {
+  return absl::StrCat("CREATE TABLE T", i,
+                      "(k INT64, a STRING(MAX), b INT64, ref INT64) "
+                      "PRIMARY KEY(k)");
+}
+
+std::vector<std::string> TableStatements(int num_tables) {
+  std::vector<std::string> statements;
+  for (int i = 0; i < num_tables; ++i) {
+    statements.push_back(CreateTable(i));
+  }
+  return statements;
+}
+
+// Returns chains of interleaved tables, each as deep as allowed, with
+// num_tables tables in total. Table j of chain c has the keys of its
+// ancestors followed by a key of its own.
+std::vector<std::string> InterleavedStatements(int num_tables) {
+  std::vector<std::string> statements;
+  for (int i = 0; i < num_tables; ++i) {
+    const int chain = i / limits::kMaxInterleavingDepth;
+    const int depth = i % limits::kMaxInterleavingDepth;
+    std::string columns;
+    std::string keys;
+    for (int j = 0; j <= depth; ++j) {
+      absl::StrAppend(&columns, "k", j, " INT64, ");
+      absl::StrAppend(&keys, j == 0 ? "" : ", ", "k", j);
+    }
+    std::string statement =
+        absl::StrCat("CREATE TABLE C", chain, "_", depth, "(", columns,
+                     "v STRING(MAX)) PRIMARY KEY(", keys, ")");
+    if (depth > 0) {
+      absl::StrAppend(&statement, ", INTERLEAVE IN PARENT C", chain, "_",
+                      depth - 1, " ON DELETE CASCADE");
+    }
+    statements.push_back(std::move(statement));
+  }
+  return statements;
+}
+
+// Returns tables with two secondary indexes each, and a foreign key from each
+// table to the one before it.
+std::vector<std::string> IndexAndForeignKeyStatements(int num_tables) {
+  std::vector<std::string> statements = TableStatements(num_tables);
+  for (int i = 0; i < num_tables; ++i) {
+    statements.push_back(
+        absl::StrCat("CREATE INDEX T", i, "ByA ON T", i, "(a)"));
+    statements.push_back(
+        absl::StrCat("CREATE INDEX T", i, "ByB ON T", i, "(b) STORING (a)"));
+    if (i > 0) {
+      statements.push_back(absl::StrCat("ALTER TABLE T", i,
+                                        " ADD CONSTRAINT FK", i,
+                                        " FOREIGN KEY(ref) REFERENCES T", i - 1,
+                                        "(k)"));
+    }
+  }
+  return statements;
+}
+
+// Returns tables with a view over each of them, and a view joining each table
+// with the one before it.
+std::vector<std::string> ViewStatements(int num_tables) {
+  std::vector<std::string> statements = TableStatements(num_tables);
+  for (int i = 0; i < num_tables; ++i) {
+    statements.push_back(
+        absl::StrCat("CREATE VIEW V", i, " SQL SECURITY INVOKER AS SELECT T", i,
+                     ".k, T", i, ".a FROM T", i, " WHERE T", i, ".b > 0"));
+    if (i > 0) {
+      statements.push_back(absl::StrCat(
+          "CREATE VIEW J", i, " SQL SECURITY INVOKER AS SELECT T", i,
+          ".k, P.a FROM T", i, " JOIN T", i - 1, " AS P ON T", i,
+          ".ref = P.k"));
+    }
+  }
+  return statements;
+}
+
+// The state needed to process schema changes, as kept by a database.
+struct SchemaChangeEnvironment {
+  SchemaChangeContext context() {
+    return SchemaChangeContext{
+        .type_factory = &type_factory,
+        .table_id_generator = &table_id_generator,
+        .column_id_generator = &column_id_generator,
+        .storage = &storage,
+        .schema_change_timestamp = absl::Now(),
+    };
+  }
+
+  zetasql::TypeFactory type_factory;
+  TableIDGenerator table_id_generator;
+  ColumnIDGenerator column_id_generator;
+  InMemoryStorage storage;
+};
+
+// Reports the time spent in each stage of the schema updates made by the
+// iterations of a benchmark, from the schema update stage histograms, which
+// are shared by the whole process.
+class StageCounters {
+ public:
+  explicit StageCounters(benchmark::State* state)
+      : state_(state),
+        parse_start_(Histogram("parse")->Sum()),
+        validate_start_(Histogram("validate")->Sum()),
+        canonicalize_start_(Histogram("canonicalize")->Sum()) {}
+
+  // Builds the action registry of schema, and records the time it takes.
+  void BuildActionRegistry(const Schema* schema) {
+    ActionManager action_manager;
+    const absl::Time start = absl::Now();
+    action_manager.AddActionsForSchema(schema, FunctionCatalog::Default(),
+                                       &type_factory_);
+    action_registry_time_ += absl::Now() - start;
+  }
+
+  ~StageCounters() {
+    Report("parse_ms", Histogram("parse")->Sum() - parse_start_);
+    Report("validate_ms", Histogram("validate")->Sum() - validate_start_);
+    Report("canonicalize_ms",
+           Histogram("canonicalize")->Sum() - canonicalize_start_);
+    Report("action_registry_ms", action_registry_time_);
+  }
+
+ private:
+  static metrics::LatencyHistogram* Histogram(absl::string_view stage) {
+    return metrics::GetLatencyHistogram(
+        "emulator_schema_update_stage_latency_seconds", "stage", stage);
+  }
+
+  void Report(absl::string_view name, absl::Duration time) {
+    state_->counters[std::string(name)] = benchmark::Counter(
+        absl::ToDoubleMilliseconds(time), benchmark::Counter::kAvgIterations);
+  }
+
+  benchmark::State* state_;
+  zetasql::TypeFactory type_factory_;
+  absl::Duration parse_start_;
+  absl::Duration validate_start_;
+  absl::Duration canonicalize_start_;
+  absl::Duration action_registry_time_;
+};
+
+// Creates a schema from statements in every iteration.
+void RunCreateSchema(benchmark::State& state,
+                     const std::vector<std::string>& statements) {
+  StageCounters counters(&state);
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    SchemaChangeEnvironment environment;
+    SchemaUpdater updater;
+    auto schema = updater.CreateSchemaFromDDL(
+        SchemaChangeOperation{.statements = statements}, environment.context());
+    CheckOk(schema.status());
+    counters.BuildActionRegistry(schema->get());
+  }
+  state.SetItemsProcessed(state.iterations() * statements.size());
+}
+
+void BM_CreateSchemaTables(benchmark::State& state) {
+  RunCreateSchema(state, TableStatements(state.range(0)));
+}
+BENCHMARK(BM_CreateSchemaTables)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(2500)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_CreateSchemaInterleaveChains(benchmark::State& state) {
+  RunCreateSchema(state, InterleavedStatements(state.range(0)));
+}
+BENCHMARK(BM_CreateSchemaInterleaveChains)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(2500)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_CreateSchemaIndexesAndForeignKeys(benchmark::State& state) {
+  RunCreateSchema(state, IndexAndForeignKeyStatements(state.range(0)));
+}
+BENCHMARK(BM_CreateSchemaIndexesAndForeignKeys)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_CreateSchemaViews(benchmark::State& state) {
+  RunCreateSchema(state, ViewStatements(state.range(0)));
+}
+BENCHMARK(BM_CreateSchemaViews)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Unit(benchmark::kMillisecond);
+
+// Adds a table, with an index and a foreign key, to an existing schema of many
+// tables in every iteration, as a migration of a large database would.
+void BM_UpdateSchemaAddTable(benchmark::State& state) {
+  const int num_tables = state.range(0);
+  const std::vector<std::string> create_statements =
+      IndexAndForeignKeyStatements(num_tables);
+  SchemaChangeEnvironment environment;
+  SchemaUpdater updater;
+  auto existing_schema = updater.CreateSchemaFromDDL(
+      SchemaChangeOperation{.statements = create_statements},
+      environment.context());
+  CheckOk(existing_schema.status());
+
+  const std::vector<std::string> update_statements = {
+      CreateTable(num_tables),
+      absl::StrCat("CREATE INDEX T", num_tables, "ByA ON T", num_tables, "(a)"),
+      absl::StrCat("ALTER TABLE T", num_tables, " ADD CONSTRAINT FK",
+                   num_tables, " FOREIGN KEY(ref) REFERENCES T0(k)")};
+  StageCounters counters(&state);
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    SchemaUpdater iteration_updater;
+    auto result = iteration_updater.UpdateSchemaFromDDL(
+        existing_schema->get(),
+        SchemaChangeOperation{.statements = update_statements},
+        environment.context());
+    CheckOk(result.status());
+    CheckOk(result->backfill_status);
+    counters.BuildActionRegistry(result->updated_schema.get());
+  }
+  state.SetItemsProcessed(state.iterations() * update_statements.size());
+}
+BENCHMARK(BM_UpdateSchemaAddTable)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(2500)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
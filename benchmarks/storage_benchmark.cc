@@ -0,0 +1,144 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Benchmarks for the InMemoryStorage Lookup, Read and Write paths at varying
+// table sizes.
+//
+// Run with:
+//   bazel run -c opt //benchmarks:storage_benchmark
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/value.h"
+#include "benchmark/benchmark.h"
+#include "absl/random/random.h"
+#include "absl/time/time.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_storage.h"
+#include "backend/storage/iterator.h"
+#include "benchmarks/resource_counters.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+const TableID kTableId = "test_table";
+const std::vector<ColumnID> kColumnIds = {"int64_col", "string_col"};
+
+Key MakeKey(int64_t i) { return Key({Int64(i)}); }
+
+// Fills the table with num_rows rows, all committed at the same timestamp.
+void PopulateTable(InMemoryStorage* storage, int64_t num_rows) {
+  for (int64_t i = 0; i < num_rows; ++i) {
+    const absl::Status status = storage->Write(
+        absl::FromUnixSeconds(1), kTableId, MakeKey(i), kColumnIds,
+        {Int64(i), String("value")});
+    if (!status.ok()) {
+      ZETASQL_LOG(FATAL) << "Write failed: " << status;
+    }
+  }
+}
+
+void BM_Lookup(benchmark::State& state) {
+  const int64_t num_rows = state.range(0);
+  InMemoryStorage storage;
+  PopulateTable(&storage, num_rows);
+  absl::BitGen gen;
+  std::vector<zetasql::Value> values;
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    const int64_t i = absl::Uniform<int64_t>(gen, 0, num_rows);
+    benchmark::DoNotOptimize(storage.Lookup(absl::FromUnixSeconds(2), kTableId,
+                                            MakeKey(i), kColumnIds, &values));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Lookup)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+void BM_ReadFullTable(benchmark::State& state) {
+  const int64_t num_rows = state.range(0);
+  InMemoryStorage storage;
+  PopulateTable(&storage, num_rows);
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    std::unique_ptr<StorageIterator> itr;
+    benchmark::DoNotOptimize(storage.Read(absl::FromUnixSeconds(2), kTableId,
+                                          KeyRange::All(), kColumnIds, &itr));
+    int64_t rows = 0;
+    while (itr->Next()) {
+      ++rows;
+    }
+    benchmark::DoNotOptimize(rows);
+  }
+  state.SetItemsProcessed(state.iterations() * num_rows);
+}
+BENCHMARK(BM_ReadFullTable)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+void BM_ReadShortRange(benchmark::State& state) {
+  constexpr int64_t kRowsPerRead = 100;
+  const int64_t num_rows = state.range(0);
+  InMemoryStorage storage;
+  PopulateTable(&storage, num_rows);
+  absl::BitGen gen;
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    const int64_t start =
+        absl::Uniform<int64_t>(gen, 0, num_rows - kRowsPerRead);
+    std::unique_ptr<StorageIterator> itr;
+    benchmark::DoNotOptimize(storage.Read(
+        absl::FromUnixSeconds(2), kTableId,
+        KeyRange::ClosedOpen(MakeKey(start), MakeKey(start + kRowsPerRead)),
+        kColumnIds, &itr));
+    while (itr->Next()) {
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kRowsPerRead);
+}
+BENCHMARK(BM_ReadShortRange)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+void BM_Write(benchmark::State& state) {
+  const int64_t num_rows = state.range(0);
+  InMemoryStorage storage;
+  PopulateTable(&storage, num_rows);
+  absl::BitGen gen;
+  int64_t timestamp = 2;
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    const int64_t i = absl::Uniform<int64_t>(gen, 0, num_rows);
+    benchmark::DoNotOptimize(storage.Write(absl::FromUnixSeconds(timestamp++),
+                                           kTableId, MakeKey(i), kColumnIds,
+                                           {Int64(i), String("updated")}));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Write)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,604 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/tpcc.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/random/distributions.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "benchmarks/workload.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+namespace {
+
+using zetasql::values::Double;
+using zetasql::values::Int64;
+using zetasql::values::Int64Array;
+using zetasql::values::NullInt64;
+using zetasql::values::NullTimestamp;
+using zetasql::values::String;
+using zetasql::values::Timestamp;
+
+// The initial data is loaded in transactions of about this many rows.
+constexpr int kRowsPerCommit = 500;
+
+// The fraction of new orders, without delivery, among the initial orders.
+constexpr double kUndeliveredOrderFraction = 0.3;
+
+// Stock level counts the items of the orders of the last this many orders.
+constexpr int kStockLevelOrders = 20;
+
+const std::vector<std::string>& WarehouseColumns() {
+  static const auto* columns =
+      new std::vector<std::string>{"w_id", "w_name", "w_tax", "w_ytd"};
+  return *columns;
+}
+
+const std::vector<std::string>& DistrictColumns() {
+  static const auto* columns = new std::vector<std::string>{
+      "w_id", "d_id", "d_name", "d_tax", "d_ytd", "d_next_o_id"};
+  return *columns;
+}
+
+const std::vector<std::string>& CustomerColumns() {
+  static const auto* columns = new std::vector<std::string>{
+      "w_id",          "d_id",          "c_id",          "c_last",
+      "c_credit",      "c_discount",    "c_balance",     "c_ytd_payment",
+      "c_payment_cnt", "c_delivery_cnt"};
+  return *columns;
+}
+
+const std::vector<std::string>& ItemColumns() {
+  static const auto* columns =
+      new std::vector<std::string>{"i_id", "i_name", "i_price"};
+  return *columns;
+}
+
+const std::vector<std::string>& StockColumns() {
+  static const auto* columns = new std::vector<std::string>{
+      "w_id", "i_id", "s_quantity", "s_ytd", "s_order_cnt"};
+  return *columns;
+}
+
+const std::vector<std::string>& OrdersColumns() {
+  static const auto* columns = new std::vector<std::string>{
+      "w_id",      "d_id",         "o_id",    "o_c_id",
+      "o_entry_d", "o_carrier_id", "o_ol_cnt"};
+  return *columns;
+}
+
+const std::vector<std::string>& OrderLineColumns() {
+  static const auto* columns = new std::vector<std::string>{
+      "w_id",    "d_id",           "o_id",        "ol_number",
+      "ol_i_id", "ol_supply_w_id", "ol_quantity", "ol_amount",
+      "ol_delivery_d"};
+  return *columns;
+}
+
+const std::vector<std::string>& NewOrderColumns() {
+  static const auto* columns =
+      new std::vector<std::string>{"w_id", "d_id", "o_id"};
+  return *columns;
+}
+
+// The non-uniform random numbers of TPC-C, section 2.1.6, with fixed run time
+// constants.
+int64_t NuRand(absl::BitGenRef gen, int64_t a, int64_t x, int64_t y) {
+  const int64_t c = a / 3;
+  return (((absl::Uniform<int64_t>(absl::IntervalClosed, gen, 0, a) |
+            absl::Uniform<int64_t>(absl::IntervalClosed, gen, x, y)) +
+           c) %
+          (y - x + 1)) +
+         x;
+}
+
+absl::StatusOr<Row> FirstRow(absl::StatusOr<std::vector<Row>> rows) {
+  ZETASQL_RETURN_IF_ERROR(rows.status());
+  if (rows->empty()) return absl::NotFoundError("Missing TPC-C row.");
+  return std::move(rows->front());
+}
+
+// Buffers the rows loaded into the database, and writes them a transaction
+// of kRowsPerCommit rows at a time. Rows are written in the order they were
+// added, so that parent rows are written before the rows interleaved in them.
+class Loader {
+ public:
+  explicit Loader(WorkloadSession* session) : session_(session) {}
+
+  absl::Status Insert(const std::string& table,
+                      const std::vector<std::string>& columns, Row row) {
+    if (batches_.empty() || batches_.back().table != table) {
+      batches_.push_back({table, columns, {}});
+    }
+    batches_.back().rows.push_back(std::move(row));
+    if (++num_rows_ >= kRowsPerCommit) return Flush();
+    return absl::OkStatus();
+  }
+
+  absl::Status Flush() {
+    ZETASQL_RETURN_IF_ERROR(
+        session_->RunTransaction([this](WorkloadTransaction* txn) {
+          for (const Batch& batch : batches_) {
+            txn->Write(WriteOp::kInsert, batch.table, batch.columns,
+                       batch.rows);
+          }
+          return absl::OkStatus();
+        }));
+    batches_.clear();
+    num_rows_ = 0;
+    return absl::OkStatus();
+  }
+
+ private:
+  struct Batch {
+    std::string table;
+    std::vector<std::string> columns;
+    std::vector<Row> rows;
+  };
+
+  WorkloadSession* session_;
+  std::vector<Batch> batches_;
+  int num_rows_ = 0;
+};
+
+class TpccWorkload : public Workload {
+ public:
+  explicit TpccWorkload(const TpccOptions& options) : options_(options) {}
+
+  std::vector<std::string> Schema() const override {
+    return {
+        R"(CREATE TABLE Warehouse(
+             w_id INT64 NOT NULL,
+             w_name STRING(10),
+             w_tax FLOAT64,
+             w_ytd FLOAT64,
+           ) PRIMARY KEY(w_id))",
+        R"(CREATE TABLE District(
+             w_id INT64 NOT NULL,
+             d_id INT64 NOT NULL,
+             d_name STRING(10),
+             d_tax FLOAT64,
+             d_ytd FLOAT64,
+             d_next_o_id INT64,
+           ) PRIMARY KEY(w_id, d_id),
+           INTERLEAVE IN PARENT Warehouse ON DELETE CASCADE)",
+        R"(CREATE TABLE Customer(
+             w_id INT64 NOT NULL,
+             d_id INT64 NOT NULL,
+             c_id INT64 NOT NULL,
+             c_last STRING(16),
+             c_credit STRING(2),
+             c_discount FLOAT64,
+             c_balance FLOAT64,
+             c_ytd_payment FLOAT64,
+             c_payment_cnt INT64,
+             c_delivery_cnt INT64,
+           ) PRIMARY KEY(w_id, d_id, c_id),
+           INTERLEAVE IN PARENT District ON DELETE CASCADE)",
+        R"(CREATE TABLE Item(
+             i_id INT64 NOT NULL,
+             i_name STRING(24),
+             i_price FLOAT64,
+           ) PRIMARY KEY(i_id))",
+        R"(CREATE TABLE Stock(
+             w_id INT64 NOT NULL,
+             i_id INT64 NOT NULL,
+             s_quantity INT64,
+             s_ytd INT64,
+             s_order_cnt INT64,
+           ) PRIMARY KEY(w_id, i_id),
+           INTERLEAVE IN PARENT Warehouse ON DELETE CASCADE)",
+        R"(CREATE TABLE Orders(
+             w_id INT64 NOT NULL,
+             d_id INT64 NOT NULL,
+             o_id INT64 NOT NULL,
+             o_c_id INT64,
+             o_entry_d TIMESTAMP,
+             o_carrier_id INT64,
+             o_ol_cnt INT64,
+           ) PRIMARY KEY(w_id, d_id, o_id),
+           INTERLEAVE IN PARENT District ON DELETE CASCADE)",
+        R"(CREATE INDEX OrdersByCustomer
+             ON Orders(w_id, d_id, o_c_id, o_id DESC))",
+        R"(CREATE TABLE OrderLine(
+             w_id INT64 NOT NULL,
+             d_id INT64 NOT NULL,
+             o_id INT64 NOT NULL,
+             ol_number INT64 NOT NULL,
+             ol_i_id INT64,
+             ol_supply_w_id INT64,
+             ol_quantity INT64,
+             ol_amount FLOAT64,
+             ol_delivery_d TIMESTAMP,
+           ) PRIMARY KEY(w_id, d_id, o_id, ol_number),
+           INTERLEAVE IN PARENT Orders ON DELETE CASCADE)",
+        R"(CREATE TABLE NewOrder(
+             w_id INT64 NOT NULL,
+             d_id INT64 NOT NULL,
+             o_id INT64 NOT NULL,
+           ) PRIMARY KEY(w_id, d_id, o_id),
+           INTERLEAVE IN PARENT District ON DELETE CASCADE)",
+    };
+  }
+
+  absl::Status Load(WorkloadSession* session) override {
+    absl::BitGen gen;
+    Loader loader(session);
+    for (int i = 1; i <= options_.items; ++i) {
+      ZETASQL_RETURN_IF_ERROR(loader.Insert(
+          "Item", ItemColumns(),
+          {Int64(i), String(absl::StrCat("item", i)),
+           Double(absl::Uniform(absl::IntervalClosed, gen, 1.0, 100.0))}));
+    }
+    const absl::Time now = absl::Now();
+    const int num_orders = options_.customers_per_district;
+    const int first_undelivered_order =
+        num_orders - static_cast<int>(num_orders * kUndeliveredOrderFraction);
+    for (int w = 1; w <= options_.warehouses; ++w) {
+      ZETASQL_RETURN_IF_ERROR(loader.Insert(
+          "Warehouse", WarehouseColumns(),
+          {Int64(w), String(absl::StrCat("w", w)), Double(RandomTax(gen)),
+           Double(30000 * options_.districts_per_warehouse)}));
+      for (int i = 1; i <= options_.items; ++i) {
+        ZETASQL_RETURN_IF_ERROR(loader.Insert(
+            "Stock", StockColumns(),
+            {Int64(w), Int64(i),
+             Int64(absl::Uniform(absl::IntervalClosed, gen, 10, 100)),
+             Int64(0), Int64(0)}));
+      }
+      for (int d = 1; d <= options_.districts_per_warehouse; ++d) {
+        ZETASQL_RETURN_IF_ERROR(loader.Insert(
+            "District", DistrictColumns(),
+            {Int64(w), Int64(d), String(absl::StrCat("d", d)),
+             Double(RandomTax(gen)), Double(30000), Int64(num_orders + 1)}));
+        for (int c = 1; c <= options_.customers_per_district; ++c) {
+          ZETASQL_RETURN_IF_ERROR(loader.Insert(
+              "Customer", CustomerColumns(),
+              {Int64(w), Int64(d), Int64(c), String(absl::StrCat("c", c)),
+               String(absl::Bernoulli(gen, 0.1) ? "BC" : "GC"),
+               Double(absl::Uniform(absl::IntervalClosed, gen, 0.0, 0.5)),
+               Double(-10), Double(10), Int64(1), Int64(0)}));
+        }
+        // Each customer places one of the initial orders.
+        std::vector<int64_t> customers(options_.customers_per_district);
+        std::iota(customers.begin(), customers.end(), 1);
+        std::shuffle(customers.begin(), customers.end(), gen);
+        for (int o = 1; o <= num_orders; ++o) {
+          const bool delivered = o < first_undelivered_order;
+          const int num_lines = absl::Uniform(absl::IntervalClosed, gen, 5, 15);
+          ZETASQL_RETURN_IF_ERROR(loader.Insert(
+              "Orders", OrdersColumns(),
+              {Int64(w), Int64(d), Int64(o), Int64(customers[o - 1]),
+               Timestamp(now),
+               delivered
+                   ? Int64(absl::Uniform(absl::IntervalClosed, gen, 1, 10))
+                   : NullInt64(),
+               Int64(num_lines)}));
+          for (int ol = 1; ol <= num_lines; ++ol) {
+            ZETASQL_RETURN_IF_ERROR(loader.Insert(
+                "OrderLine", OrderLineColumns(),
+                {Int64(w), Int64(d), Int64(o), Int64(ol),
+                 Int64(absl::Uniform(absl::IntervalClosed, gen, 1,
+                                     options_.items)),
+                 Int64(w), Int64(5),
+                 Double(delivered ? 0
+                                  : absl::Uniform(absl::IntervalClosed, gen,
+                                                  0.01, 9999.99)),
+                 delivered ? Timestamp(now) : NullTimestamp()}));
+          }
+        }
+        for (int o = first_undelivered_order; o <= num_orders; ++o) {
+          ZETASQL_RETURN_IF_ERROR(loader.Insert("NewOrder", NewOrderColumns(),
+                                        {Int64(w), Int64(d), Int64(o)}));
+        }
+      }
+    }
+    return loader.Flush();
+  }
+
+  absl::Status RunOperation(WorkloadSession* session, absl::BitGenRef gen,
+                            std::string* name) override {
+    const int64_t w =
+        absl::Uniform(absl::IntervalClosed, gen, 1, options_.warehouses);
+    const int r = absl::Uniform(gen, 0, 100);
+    if (r < 45) {
+      *name = "new_order";
+      return NewOrder(session, gen, w);
+    }
+    if (r < 88) {
+      *name = "payment";
+      return Payment(session, gen, w);
+    }
+    if (r < 92) {
+      *name = "order_status";
+      return OrderStatus(session, gen, w);
+    }
+    if (r < 96) {
+      *name = "delivery";
+      return Delivery(session, gen, w);
+    }
+    *name = "stock_level";
+    return StockLevel(session, gen, w);
+  }
+
+ private:
+  static double RandomTax(absl::BitGenRef gen) {
+    return absl::Uniform(absl::IntervalClosed, gen, 0.0, 0.2);
+  }
+
+  int64_t RandomDistrict(absl::BitGenRef gen) const {
+    return absl::Uniform(absl::IntervalClosed, gen, 1,
+                         options_.districts_per_warehouse);
+  }
+
+  int64_t RandomCustomer(absl::BitGenRef gen) const {
+    return NuRand(gen, 1023, 1, options_.customers_per_district);
+  }
+
+  absl::Status NewOrder(WorkloadSession* session, absl::BitGenRef gen,
+                        int64_t w) const {
+    const int64_t d = RandomDistrict(gen);
+    const int64_t c = RandomCustomer(gen);
+    const int num_lines = absl::Uniform(absl::IntervalClosed, gen, 5, 15);
+    std::map<int64_t, int64_t> quantities;
+    while (quantities.size() < static_cast<size_t>(num_lines)) {
+      quantities.emplace(NuRand(gen, 8191, 1, options_.items),
+                         absl::Uniform(absl::IntervalClosed, gen, 1, 10));
+    }
+    std::vector<int64_t> item_ids;
+    for (const auto& [i_id, quantity] : quantities) {
+      item_ids.push_back(i_id);
+    }
+    return session->RunTransaction([&](WorkloadTransaction* txn) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          Row district,
+          FirstRow(txn->Query("SELECT d_next_o_id FROM District "
+                              "WHERE w_id = @w AND d_id = @d",
+                              {{"w", Int64(w)}, {"d", Int64(d)}})));
+      ZETASQL_RETURN_IF_ERROR(
+          FirstRow(txn->Query("SELECT w_tax FROM Warehouse WHERE w_id = @w",
+                              {{"w", Int64(w)}}))
+              .status());
+      ZETASQL_RETURN_IF_ERROR(
+          FirstRow(txn->Query(
+                       "SELECT c_discount, c_last, c_credit FROM Customer "
+                       "WHERE w_id = @w AND d_id = @d AND c_id = @c",
+                       {{"w", Int64(w)}, {"d", Int64(d)}, {"c", Int64(c)}}))
+              .status());
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::vector<Row> items,
+          txn->Query("SELECT i_id, i_price FROM Item "
+                     "WHERE i_id IN UNNEST(@items)",
+                     {{"items", Int64Array(item_ids)}}));
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::vector<Row> stock,
+          txn->Query("SELECT i_id, s_quantity, s_ytd, s_order_cnt FROM Stock "
+                     "WHERE w_id = @w AND i_id IN UNNEST(@items)",
+                     {{"w", Int64(w)}, {"items", Int64Array(item_ids)}}));
+
+      const int64_t o = district[0].int64_value();
+      txn->Write(WriteOp::kUpdate, "District", {"w_id", "d_id", "d_next_o_id"},
+                 {{Int64(w), Int64(d), Int64(o + 1)}});
+      txn->Write(WriteOp::kInsert, "Orders", OrdersColumns(),
+                 {{Int64(w), Int64(d), Int64(o), Int64(c),
+                   Timestamp(absl::Now()), NullInt64(), Int64(num_lines)}});
+      txn->Write(WriteOp::kInsert, "NewOrder", NewOrderColumns(),
+                 {{Int64(w), Int64(d), Int64(o)}});
+
+      std::vector<Row> stock_updates;
+      for (const Row& row : stock) {
+        const int64_t quantity = quantities.at(row[0].int64_value());
+        int64_t s_quantity = row[1].int64_value() - quantity;
+        if (s_quantity < 10) s_quantity += 91;
+        stock_updates.push_back(
+            {Int64(w), row[0], Int64(s_quantity),
+             Int64(row[2].int64_value() + quantity),
+             Int64(row[3].int64_value() + 1)});
+      }
+      txn->Write(WriteOp::kUpdate, "Stock", StockColumns(),
+                 std::move(stock_updates));
+
+      std::vector<Row> lines;
+      for (const Row& row : items) {
+        const int64_t quantity = quantities.at(row[0].int64_value());
+        lines.push_back({Int64(w), Int64(d), Int64(o),
+                         Int64(lines.size() + 1), row[0], Int64(w),
+                         Int64(quantity),
+                         Double(quantity * row[1].double_value()),
+                         NullTimestamp()});
+      }
+      txn->Write(WriteOp::kInsert, "OrderLine", OrderLineColumns(),
+                 std::move(lines));
+      return absl::OkStatus();
+    });
+  }
+
+  absl::Status Payment(WorkloadSession* session, absl::BitGenRef gen,
+                       int64_t w) const {
+    const int64_t d = RandomDistrict(gen);
+    const int64_t c = RandomCustomer(gen);
+    const double amount =
+        absl::Uniform(absl::IntervalClosed, gen, 1.0, 5000.0);
+    return session->RunTransaction([&](WorkloadTransaction* txn) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          Row warehouse,
+          FirstRow(txn->Query("SELECT w_ytd FROM Warehouse WHERE w_id = @w",
+                              {{"w", Int64(w)}})));
+      ZETASQL_ASSIGN_OR_RETURN(
+          Row district,
+          FirstRow(txn->Query("SELECT d_ytd FROM District "
+                              "WHERE w_id = @w AND d_id = @d",
+                              {{"w", Int64(w)}, {"d", Int64(d)}})));
+      ZETASQL_ASSIGN_OR_RETURN(
+          Row customer,
+          FirstRow(txn->Query(
+              "SELECT c_balance, c_ytd_payment, c_payment_cnt FROM Customer "
+              "WHERE w_id = @w AND d_id = @d AND c_id = @c",
+              {{"w", Int64(w)}, {"d", Int64(d)}, {"c", Int64(c)}})));
+      txn->Write(WriteOp::kUpdate, "Warehouse", {"w_id", "w_ytd"},
+                 {{Int64(w), Double(warehouse[0].double_value() + amount)}});
+      txn->Write(WriteOp::kUpdate, "District", {"w_id", "d_id", "d_ytd"},
+                 {{Int64(w), Int64(d),
+                   Double(district[0].double_value() + amount)}});
+      txn->Write(WriteOp::kUpdate, "Customer",
+                 {"w_id", "d_id", "c_id", "c_balance", "c_ytd_payment",
+                  "c_payment_cnt"},
+                 {{Int64(w), Int64(d), Int64(c),
+                   Double(customer[0].double_value() - amount),
+                   Double(customer[1].double_value() + amount),
+                   Int64(customer[2].int64_value() + 1)}});
+      return absl::OkStatus();
+    });
+  }
+
+  // Reads the lines of the last order of a customer in one query, so that
+  // they are read at a single timestamp.
+  absl::Status OrderStatus(WorkloadSession* session, absl::BitGenRef gen,
+                           int64_t w) const {
+    const int64_t d = RandomDistrict(gen);
+    const int64_t c = RandomCustomer(gen);
+    return session
+        ->Query(
+            "SELECT ol_i_id, ol_supply_w_id, ol_quantity, ol_amount, "
+            "ol_delivery_d FROM OrderLine "
+            "WHERE w_id = @w AND d_id = @d AND o_id = ("
+            "  SELECT MAX(o_id) FROM Orders@{FORCE_INDEX=OrdersByCustomer} "
+            "  WHERE w_id = @w AND d_id = @d AND o_c_id = @c)",
+            {{"w", Int64(w)}, {"d", Int64(d)}, {"c", Int64(c)}})
+        .status();
+  }
+
+  // Delivers the oldest new order of every district of the warehouse.
+  absl::Status Delivery(WorkloadSession* session, absl::BitGenRef gen,
+                        int64_t w) const {
+    const int64_t carrier = absl::Uniform(absl::IntervalClosed, gen, 1, 10);
+    return session->RunTransaction([&](WorkloadTransaction* txn) {
+      const absl::Time now = absl::Now();
+      for (int64_t d = 1; d <= options_.districts_per_warehouse; ++d) {
+        const Params district = {{"w", Int64(w)}, {"d", Int64(d)}};
+        ZETASQL_ASSIGN_OR_RETURN(
+            Row new_order,
+            FirstRow(txn->Query("SELECT MIN(o_id) FROM NewOrder "
+                                "WHERE w_id = @w AND d_id = @d",
+                                district)));
+        if (new_order[0].is_null()) continue;
+        const zetasql::Value o = new_order[0];
+        Params order = district;
+        order["o"] = o;
+        ZETASQL_ASSIGN_OR_RETURN(
+            Row orders,
+            FirstRow(txn->Query("SELECT o_c_id FROM Orders "
+                                "WHERE w_id = @w AND d_id = @d AND o_id = @o",
+                                order)));
+        ZETASQL_ASSIGN_OR_RETURN(
+            std::vector<Row> lines,
+            txn->Query("SELECT ol_number, ol_amount FROM OrderLine "
+                       "WHERE w_id = @w AND d_id = @d AND o_id = @o",
+                       order));
+        order["c"] = orders[0];
+        ZETASQL_ASSIGN_OR_RETURN(
+            Row customer,
+            FirstRow(txn->Query("SELECT c_balance, c_delivery_cnt "
+                                "FROM Customer "
+                                "WHERE w_id = @w AND d_id = @d AND c_id = @c",
+                                order)));
+
+        txn->Write(WriteOp::kDelete, "NewOrder", NewOrderColumns(),
+                   {{Int64(w), Int64(d), o}});
+        txn->Write(WriteOp::kUpdate, "Orders",
+                   {"w_id", "d_id", "o_id", "o_carrier_id"},
+                   {{Int64(w), Int64(d), o, Int64(carrier)}});
+        double total = 0;
+        std::vector<Row> delivered_lines;
+        for (const Row& line : lines) {
+          total += line[1].double_value();
+          delivered_lines.push_back(
+              {Int64(w), Int64(d), o, line[0], Timestamp(now)});
+        }
+        txn->Write(WriteOp::kUpdate, "OrderLine",
+                   {"w_id", "d_id", "o_id", "ol_number", "ol_delivery_d"},
+                   std::move(delivered_lines));
+        txn->Write(WriteOp::kUpdate, "Customer",
+                   {"w_id", "d_id", "c_id", "c_balance", "c_delivery_cnt"},
+                   {{Int64(w), Int64(d), orders[0],
+                     Double(customer[0].double_value() + total),
+                     Int64(customer[1].int64_value() + 1)}});
+      }
+      return absl::OkStatus();
+    });
+  }
+
+  // Counts the items of the last orders of a district which are low on
+  // stock, in one query.
+  absl::Status StockLevel(WorkloadSession* session, absl::BitGenRef gen,
+                          int64_t w) const {
+    const int64_t d = RandomDistrict(gen);
+    const int64_t threshold = absl::Uniform(absl::IntervalClosed, gen, 10, 20);
+    return session
+        ->Query(
+            "SELECT COUNT(DISTINCT s.i_id) FROM District d "
+            "JOIN OrderLine ol ON ol.w_id = d.w_id AND ol.d_id = d.d_id "
+            "  AND ol.o_id >= d.d_next_o_id - @orders "
+            "  AND ol.o_id < d.d_next_o_id "
+            "JOIN Stock s ON s.w_id = ol.w_id AND s.i_id = ol.ol_i_id "
+            "WHERE d.w_id = @w AND d.d_id = @d "
+            "  AND s.s_quantity < @threshold",
+            {{"w", Int64(w)},
+             {"d", Int64(d)},
+             {"orders", Int64(kStockLevelOrders)},
+             {"threshold", Int64(threshold)}})
+        .status();
+  }
+
+  const TpccOptions options_;
+};
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<Workload>> CreateTpccWorkload(
+    const TpccOptions& options) {
+  if (options.warehouses <= 0 || options.districts_per_warehouse <= 0 ||
+      options.customers_per_district <= 0 || options.items < 15) {
+    return absl::InvalidArgumentError(
+        "TPC-C needs at least one warehouse, district and customer, and at "
+        "least 15 items.");
+  }
+  return std::make_unique<TpccWorkload>(options);
+}
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
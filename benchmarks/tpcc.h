@@ -0,0 +1,56 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_TPCC_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_TPCC_H_
+
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "benchmarks/workload.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+// The scale of a TPC-C-lite database. The defaults are a tenth of TPC-C for
+// customers and a hundredth for items, so that a warehouse loads in seconds.
+struct TpccOptions {
+  int warehouses = 1;
+  int districts_per_warehouse = 10;
+  int customers_per_district = 300;
+  int items = 1000;
+};
+
+// Creates a TPC-C-lite workload. Districts, customers, stock, orders, order
+// lines and new orders are interleaved in the warehouse, district or order
+// they belong to, as they would be on Cloud Spanner. Operations are the five
+// TPC-C transactions in the standard mix: 45% new order, 43% payment and 4%
+// each of order status, delivery and stock level.
+//
+// Unlike TPC-C, there is no history table, customers are always picked by
+// id, every order is supplied by its home warehouse, no new order is rolled
+// back and there are no keying or think times.
+absl::StatusOr<std::unique_ptr<Workload>> CreateTpccWorkload(
+    const TpccOptions& options);
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_TPCC_H_
@@ -0,0 +1,111 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/tpcc.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "benchmarks/in_process_target.h"
+#include "benchmarks/workload.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+namespace {
+
+using ::zetasql_base::testing::StatusIs;
+
+class TpccTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(workload_, CreateTpccWorkload(TpccOptions{
+                                        .warehouses = 1,
+                                        .districts_per_warehouse = 2,
+                                        .customers_per_district = 30,
+                                        .items = 100,
+                                    }));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(target_,
+                         CreateInProcessTarget(workload_->Schema()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(session_, target_->NewSession());
+    ZETASQL_ASSERT_OK(workload_->Load(session_.get()));
+  }
+
+  // Checks consistency conditions 1 and 2 of TPC-C, section 3.3.2.
+  void ExpectConsistent() {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::vector<Row> rows,
+        session_->Query("SELECT w.w_ytd, (SELECT SUM(d_ytd) FROM District d "
+                        "WHERE d.w_id = w.w_id) FROM Warehouse w"));
+    for (const Row& row : rows) {
+      EXPECT_NEAR(row[0].double_value(), row[1].double_value(), 1e-3);
+    }
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        rows, session_->Query(
+                  "SELECT d.d_next_o_id - 1, "
+                  "(SELECT MAX(o_id) FROM Orders o "
+                  " WHERE o.w_id = d.w_id AND o.d_id = d.d_id), "
+                  "(SELECT MAX(o_id) FROM NewOrder n "
+                  " WHERE n.w_id = d.w_id AND n.d_id = d.d_id) "
+                  "FROM District d"));
+    ASSERT_EQ(rows.size(), 2);
+    for (const Row& row : rows) {
+      EXPECT_EQ(row[0].int64_value(), row[1].int64_value());
+      if (!row[2].is_null()) {
+        EXPECT_EQ(row[0].int64_value(), row[2].int64_value());
+      }
+    }
+  }
+
+  std::unique_ptr<Workload> workload_;
+  std::unique_ptr<WorkloadTarget> target_;
+  std::unique_ptr<WorkloadSession> session_;
+};
+
+TEST_F(TpccTest, LoadsConsistentDatabase) {
+  ExpectConsistent();
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<Row> rows,
+                       session_->Query("SELECT COUNT(*) FROM Customer"));
+  EXPECT_EQ(rows[0][0].int64_value(), 60);
+}
+
+TEST_F(TpccTest, TransactionsKeepDatabaseConsistent) {
+  absl::BitGen gen;
+  std::string name;
+  for (int i = 0; i < 200; ++i) {
+    ZETASQL_EXPECT_OK(workload_->RunOperation(session_.get(), gen, &name))
+        << name;
+  }
+  ExpectConsistent();
+}
+
+TEST(TpccOptionsTest, RejectsEmptyScale) {
+  EXPECT_THAT(CreateTpccWorkload(TpccOptions{.warehouses = 0}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,147 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Benchmarks for committing read-write transactions with a varying number of
+// mutations, and for executing point and scan queries through QueryEngine.
+//
+// Run with:
+//   bazel run -c opt //benchmarks:transaction_benchmark
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/value.h"
+#include "benchmark/benchmark.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "backend/access/read.h"
+#include "backend/access/write.h"
+#include "backend/database/database.h"
+#include "backend/query/query_engine.h"
+#include "backend/schema/updater/schema_updater.h"
+#include "backend/transaction/options.h"
+#include "backend/transaction/read_only_transaction.h"
+#include "backend/transaction/read_write_transaction.h"
+#include "benchmarks/resource_counters.h"
+#include "common/clock.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+void CheckOk(const absl::Status& status) {
+  if (!status.ok()) {
+    ZETASQL_LOG(FATAL) << status;
+  }
+}
+
+std::unique_ptr<Database> CreateDatabase(Clock* clock) {
+  auto database = Database::Create(
+      clock, SchemaChangeOperation{.statements = {R"(
+        CREATE TABLE T(
+          k INT64,
+          v STRING(MAX),
+        ) PRIMARY KEY(k)
+      )"}});
+  CheckOk(database.status());
+  return std::move(database).value();
+}
+
+// Inserts or updates rows [begin, end) of T in a single transaction.
+void WriteRows(Database* database, int64_t begin, int64_t end) {
+  auto txn =
+      database->CreateReadWriteTransaction(ReadWriteOptions(), RetryState());
+  CheckOk(txn.status());
+  std::vector<ValueList> rows;
+  for (int64_t k = begin; k < end; ++k) {
+    rows.push_back({Int64(k), String(absl::StrCat("value", k))});
+  }
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsertOrUpdate, "T", {"k", "v"},
+               std::move(rows));
+  CheckOk((*txn)->Write(m));
+  CheckOk((*txn)->Commit());
+}
+
+void BM_CommitMutations(benchmark::State& state) {
+  const int64_t num_mutations = state.range(0);
+  Clock clock;
+  std::unique_ptr<Database> database = CreateDatabase(&clock);
+  int64_t next_key = 0;
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    WriteRows(database.get(), next_key, next_key + num_mutations);
+    next_key += num_mutations;
+  }
+  state.SetItemsProcessed(state.iterations() * num_mutations);
+}
+BENCHMARK(BM_CommitMutations)->RangeMultiplier(10)->Range(1, 10000);
+
+// Runs sql in a strong read-only transaction and drains the result rows.
+void RunQuery(Database* database, const std::string& sql) {
+  auto txn = database->CreateReadOnlyTransaction(ReadOnlyOptions());
+  CheckOk(txn.status());
+  auto result = database->query_engine()->ExecuteSql(
+      Query{sql}, QueryContext{.schema = database->GetLatestSchema(),
+                               .reader = txn->get()});
+  CheckOk(result.status());
+  while (result->rows->Next()) {
+  }
+  CheckOk(result->rows->Status());
+}
+
+void BM_ExecuteSqlPointQuery(benchmark::State& state) {
+  const int64_t num_rows = state.range(0);
+  Clock clock;
+  std::unique_ptr<Database> database = CreateDatabase(&clock);
+  WriteRows(database.get(), 0, num_rows);
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    RunQuery(database.get(),
+             absl::StrCat("SELECT v FROM T WHERE k = ", num_rows / 2));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExecuteSqlPointQuery)->RangeMultiplier(10)->Range(100, 100000);
+
+void BM_ExecuteSqlScanQuery(benchmark::State& state) {
+  const int64_t num_rows = state.range(0);
+  Clock clock;
+  std::unique_ptr<Database> database = CreateDatabase(&clock);
+  WriteRows(database.get(), 0, num_rows);
+  benchmarks::ResourceCounters resources(&state);
+  for (auto _ : state) {
+    RunQuery(database.get(), "SELECT k, v FROM T");
+  }
+  state.SetItemsProcessed(state.iterations() * num_rows);
+}
+BENCHMARK(BM_ExecuteSqlScanQuery)->RangeMultiplier(10)->Range(100, 100000);
+
+}  // namespace
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,113 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_WORKLOAD_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_WORKLOAD_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+// A row of values, of a query result or of a write.
+using Row = std::vector<zetasql::Value>;
+
+// The parameters of a query, keyed by name without the leading '@'.
+using Params = std::map<std::string, zetasql::Value>;
+
+// The kinds of writes a workload buffers in a transaction.
+enum class WriteOp { kInsert, kUpdate, kInsertOrUpdate, kDelete };
+
+// A read-write transaction of a WorkloadSession.
+class WorkloadTransaction {
+ public:
+  virtual ~WorkloadTransaction() = default;
+
+  // Executes the SQL query sql in the transaction and returns its rows.
+  virtual absl::StatusOr<std::vector<Row>> Query(const std::string& sql,
+                                                 const Params& params = {}) = 0;
+
+  // Buffers a write of rows of columns in table, applied on commit. Deletes
+  // take the key columns of the rows to delete.
+  virtual void Write(WriteOp op, const std::string& table,
+                     std::vector<std::string> columns,
+                     std::vector<Row> rows) = 0;
+};
+
+// A client of the database a workload runs against. A session is used by one
+// thread at a time.
+class WorkloadSession {
+ public:
+  virtual ~WorkloadSession() = default;
+
+  // Runs body in a read-write transaction and commits it, running it again
+  // in a new transaction for as long as the transaction is aborted. A
+  // transaction is rolled back when body returns an error.
+  virtual absl::Status RunTransaction(
+      const std::function<absl::Status(WorkloadTransaction*)>& body) = 0;
+
+  // Executes the SQL query sql in a strong read-only transaction and returns
+  // its rows.
+  virtual absl::StatusOr<std::vector<Row>> Query(const std::string& sql,
+                                                 const Params& params = {}) = 0;
+};
+
+// The database a workload runs against, which is either an in-process backend
+// database or a database of an emulator server reached over gRPC.
+class WorkloadTarget {
+ public:
+  virtual ~WorkloadTarget() = default;
+
+  virtual absl::StatusOr<std::unique_ptr<WorkloadSession>> NewSession() = 0;
+};
+
+// A benchmark workload: its schema, how it loads its initial data and its mix
+// of operations. Workloads are thread-safe, so that many sessions can run
+// operations of the same workload at once.
+class Workload {
+ public:
+  virtual ~Workload() = default;
+
+  // The DDL statements which create the schema of the workload.
+  virtual std::vector<std::string> Schema() const = 0;
+
+  // Loads the initial data of the workload into a database with its schema.
+  virtual absl::Status Load(WorkloadSession* session) = 0;
+
+  // Runs one operation picked from the mix of the workload, and sets name to
+  // the name it is reported under.
+  virtual absl::Status RunOperation(WorkloadSession* session,
+                                    absl::BitGenRef gen, std::string* name) = 0;
+};
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_WORKLOAD_H_
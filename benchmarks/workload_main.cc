@@ -0,0 +1,289 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Runs a standard benchmark workload, YCSB A to F or TPC-C-lite, and reports
+// latency percentiles and throughput per operation.
+//
+// By default the workload runs against an in-process backend database,
+// bypassing gRPC and the frontend. Point it at a running emulator instead with
+// --endpoint, e.g.
+//   bazel run -c opt //benchmarks:workload_main -- \
+//     --workload=ycsb_a --ycsb_distribution=uniform --threads=16
+//   bazel run -c opt //benchmarks:workload_main -- \
+//     --workload=tpcc --endpoint=localhost:9010 --duration=60s
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "zetasql/base/logging.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/grpc_target.h"
+#include "benchmarks/in_process_target.h"
+#include "benchmarks/results.h"
+#include "benchmarks/tpcc.h"
+#include "benchmarks/workload.h"
+#include "benchmarks/ycsb.h"
+#include "common/profiling.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+
+ABSL_FLAG(std::string, workload, "ycsb_a",
+          "The workload to run: ycsb_a to ycsb_f, or tpcc.");
+
+ABSL_FLAG(std::string, endpoint, "",
+          "Address of the emulator to run the workload against. If empty, the "
+          "workload runs against an in-process backend database.");
+
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(30),
+          "How long to run the workload for, after loading it.");
+
+ABSL_FLAG(int, threads, 8,
+          "Number of sessions running operations of the workload, each driven "
+          "by its own thread.");
+
+ABSL_FLAG(int64_t, ycsb_record_count, 100000,
+          "Number of records loaded by YCSB workloads.");
+
+ABSL_FLAG(std::string, ycsb_distribution, "",
+          "Key distribution of YCSB workloads: uniform, zipfian or latest. "
+          "Defaults to the one of the workload.");
+
+ABSL_FLAG(double, ycsb_zipfian_constant, 0.99,
+          "Constant of the Zipfian key distribution of YCSB workloads.");
+
+ABSL_FLAG(int, tpcc_warehouses, 1, "Number of TPC-C warehouses.");
+
+ABSL_FLAG(int, tpcc_items, 1000, "Number of TPC-C items.");
+
+ABSL_FLAG(std::string, results_out, "",
+          "If set, the file to write the results to as JSON, for comparison "
+          "with those of other runs by //benchmarks:compare_main.");
+
+namespace benchmarks = ::google::spanner::emulator::benchmarks;
+namespace profiling = ::google::spanner::emulator::profiling;
+
+namespace {
+
+// Latencies and errors of one kind of operation.
+struct OpStats {
+  std::vector<absl::Duration> latencies;
+  int64_t errors = 0;
+
+  void Merge(const OpStats& other) {
+    latencies.insert(latencies.end(), other.latencies.begin(),
+                     other.latencies.end());
+    errors += other.errors;
+  }
+};
+
+using Stats = absl::flat_hash_map<std::string, OpStats>;
+
+absl::StatusOr<std::unique_ptr<benchmarks::Workload>> CreateWorkload() {
+  const std::string workload = absl::GetFlag(FLAGS_workload);
+  if (workload == "tpcc") {
+    benchmarks::TpccOptions options;
+    options.warehouses = absl::GetFlag(FLAGS_tpcc_warehouses);
+    options.items = absl::GetFlag(FLAGS_tpcc_items);
+    return benchmarks::CreateTpccWorkload(options);
+  }
+  if (!absl::StartsWith(workload, "ycsb_") || workload.size() != 6) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unknown workload: %s", workload));
+  }
+  benchmarks::YcsbOptions options;
+  options.workload = absl::ascii_toupper(workload.back());
+  options.record_count = absl::GetFlag(FLAGS_ycsb_record_count);
+  options.zipfian_constant = absl::GetFlag(FLAGS_ycsb_zipfian_constant);
+  const std::string distribution = absl::GetFlag(FLAGS_ycsb_distribution);
+  if (distribution == "uniform") {
+    options.distribution = benchmarks::KeyDistribution::kUniform;
+  } else if (distribution == "zipfian") {
+    options.distribution = benchmarks::KeyDistribution::kZipfian;
+  } else if (distribution == "latest") {
+    options.distribution = benchmarks::KeyDistribution::kLatest;
+  } else if (!distribution.empty()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unknown key distribution: %s", distribution));
+  }
+  return benchmarks::CreateYcsbWorkload(options);
+}
+
+// Runs operations of workload in a session of target until deadline, and sets
+// allocations to those made by the thread while running them.
+void RunSession(benchmarks::WorkloadTarget* target,
+                benchmarks::Workload* workload, absl::Time deadline,
+                Stats* stats, profiling::AllocationCount* allocations) {
+  auto session = target->NewSession();
+  ZETASQL_CHECK(session.ok())
+      << "Failed to create session: " << session.status();
+  absl::BitGen gen;
+  std::string name;
+  const profiling::AllocationCount allocations_start =
+      profiling::ThreadAllocationCount();
+  while (absl::Now() < deadline) {
+    const absl::Time start = absl::Now();
+    absl::Status status = workload->RunOperation(session->get(), gen, &name);
+    OpStats& op_stats = (*stats)[name];
+    op_stats.latencies.push_back(absl::Now() - start);
+    if (!status.ok() && ++op_stats.errors == 1) {
+      ZETASQL_LOG(WARNING) << name << " failed: " << status;
+    }
+  }
+  const profiling::AllocationCount allocations_end =
+      profiling::ThreadAllocationCount();
+  allocations->allocations =
+      allocations_end.allocations - allocations_start.allocations;
+  allocations->bytes = allocations_end.bytes - allocations_start.bytes;
+}
+
+// Prints the latencies and throughput of each operation, and appends a run of
+// each, and one of all of them, to runs.
+void PrintReport(Stats stats, absl::Duration elapsed,
+                 std::vector<benchmarks::BenchmarkRun>* runs) {
+  const std::string workload = absl::GetFlag(FLAGS_workload);
+  absl::PrintF("%-18s %10s %8s %10s %10s %10s %10s\n", "operation", "count",
+               "errors", "ops/s", "p50 ms", "p99 ms", "max ms");
+  std::vector<std::string> names;
+  int64_t total = 0;
+  for (const auto& [name, op_stats] : stats) {
+    names.push_back(name);
+    total += op_stats.latencies.size();
+  }
+  std::sort(names.begin(), names.end());
+  for (const std::string& name : names) {
+    std::vector<absl::Duration>& latencies = stats[name].latencies;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+      return absl::ToDoubleMilliseconds(
+          latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+    };
+    const double ops_per_second =
+        latencies.size() / absl::ToDoubleSeconds(elapsed);
+    absl::PrintF("%-18s %10d %8d %10.1f %10.2f %10.2f %10.2f\n", name,
+                 latencies.size(), stats[name].errors, ops_per_second,
+                 percentile(0.5), percentile(0.99), percentile(1.0));
+    runs->push_back({.name = absl::StrCat(workload, "/", name),
+                     .metrics = {{"ops_per_second", ops_per_second},
+                                 {"p50_latency_ms", percentile(0.5)},
+                                 {"p99_latency_ms", percentile(0.99)},
+                                 {"max_latency_ms", percentile(1.0)},
+                                 {"errors", stats[name].errors}}});
+  }
+  absl::PrintF("%-18s %10d %8s %10.1f\n", "total", total, "",
+               total / absl::ToDoubleSeconds(elapsed));
+  runs->push_back(
+      {.name = absl::StrCat(workload, "/total"),
+       .metrics = {{"ops_per_second",
+                    total / absl::ToDoubleSeconds(elapsed)}}});
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  profiling::EnableAllocationCounting();
+
+  auto workload = CreateWorkload();
+  ZETASQL_CHECK(workload.ok()) << workload.status();
+
+  const std::string endpoint = absl::GetFlag(FLAGS_endpoint);
+  auto target =
+      endpoint.empty()
+          ? benchmarks::CreateInProcessTarget((*workload)->Schema())
+          : benchmarks::CreateGrpcTarget(
+                grpc::CreateChannel(endpoint,
+                                    grpc::InsecureChannelCredentials()),
+                "projects/benchmark/instances/benchmark",
+                absl::StrFormat("%s-%d", absl::GetFlag(FLAGS_workload),
+                                absl::ToUnixSeconds(absl::Now())),
+                (*workload)->Schema());
+  ZETASQL_CHECK(target.ok())
+      << "Failed to create database: " << target.status();
+
+  {
+    const absl::Time start = absl::Now();
+    auto session = (*target)->NewSession();
+    ZETASQL_CHECK(session.ok()) << session.status();
+    absl::Status status = (*workload)->Load(session->get());
+    ZETASQL_CHECK(status.ok()) << "Failed to load workload: " << status;
+    ZETASQL_LOG(INFO) << "Loaded " << absl::GetFlag(FLAGS_workload) << " in "
+              << absl::Now() - start;
+  }
+
+  const int num_threads = absl::GetFlag(FLAGS_threads);
+  std::vector<Stats> thread_stats(num_threads);
+  std::vector<profiling::AllocationCount> thread_allocations(num_threads);
+  std::vector<std::thread> threads;
+  const absl::Time start = absl::Now();
+  const absl::Time deadline = start + absl::GetFlag(FLAGS_duration);
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(RunSession, target->get(), workload->get(), deadline,
+                         &thread_stats[i], &thread_allocations[i]);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+
+  Stats stats;
+  int64_t total_ops = 0;
+  for (const Stats& s : thread_stats) {
+    for (const auto& [name, op_stats] : s) {
+      stats[name].Merge(op_stats);
+      total_ops += op_stats.latencies.size();
+    }
+  }
+  std::vector<benchmarks::BenchmarkRun> runs;
+  PrintReport(std::move(stats), elapsed, &runs);
+
+  const std::string results_out = absl::GetFlag(FLAGS_results_out);
+  if (!results_out.empty()) {
+    // Against an in-process database, the sessions' threads make the
+    // allocations of the operations and the process holds the database.
+    if (endpoint.empty()) {
+      std::vector<std::pair<std::string, double>>& metrics =
+          runs.back().metrics;
+      int64_t allocations = 0;
+      for (const profiling::AllocationCount& count : thread_allocations) {
+        allocations += count.allocations;
+      }
+      if (total_ops > 0) {
+        metrics.emplace_back("allocs_per_op",
+                             static_cast<double>(allocations) / total_ops);
+      }
+      metrics.emplace_back("peak_rss_bytes", benchmarks::PeakRssBytes());
+    }
+    absl::Status status = benchmarks::WriteResults(results_out, runs);
+    ZETASQL_CHECK(status.ok()) << status;
+  }
+  return 0;
+}
@@ -0,0 +1,326 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/ycsb.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/random/distributions.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "benchmarks/workload.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+constexpr absl::string_view kTable = "usertable";
+constexpr absl::string_view kKeyColumn = "ycsb_key";
+
+// Records are loaded in transactions of this many records.
+constexpr int64_t kRecordsPerCommit = 500;
+
+// The fraction of operations of each kind.
+struct Mix {
+  double read = 0;
+  double update = 0;
+  double insert = 0;
+  double scan = 0;
+  double read_modify_write = 0;
+};
+
+double Zeta(int64_t n, double theta) {
+  double sum = 0;
+  for (int64_t i = 1; i <= n; ++i) {
+    sum += 1 / std::pow(static_cast<double>(i), theta);
+  }
+  return sum;
+}
+
+// The 64-bit FNV-1a hash of the bytes of value, which YCSB scatters the hot
+// keys of its Zipfian distribution with.
+uint64_t FnvHash64(uint64_t value) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < 8; ++i) {
+    hash ^= value & 0xff;
+    hash *= 0x100000001b3ULL;
+    value >>= 8;
+  }
+  return hash;
+}
+
+std::string FieldName(int i) { return absl::StrCat("field", i); }
+
+std::string RandomField(absl::BitGenRef gen, int length) {
+  std::string field(length, ' ');
+  for (char& c : field) {
+    c = absl::Uniform<char>(absl::IntervalClosed, gen, 'a', 'z');
+  }
+  return field;
+}
+
+class YcsbWorkload : public Workload {
+ public:
+  YcsbWorkload(const YcsbOptions& options, const Mix& mix,
+               KeyDistribution distribution)
+      : options_(options),
+        mix_(mix),
+        distribution_(distribution),
+        zipfian_(options.record_count, options.zipfian_constant),
+        next_insert_key_(options.record_count) {}
+
+  std::vector<std::string> Schema() const override {
+    std::vector<std::string> columns = {
+        absl::StrCat(kKeyColumn, " INT64 NOT NULL")};
+    for (int i = 0; i < options_.field_count; ++i) {
+      columns.push_back(absl::StrCat(FieldName(i), " STRING(MAX)"));
+    }
+    return {absl::StrCat("CREATE TABLE ", kTable, "(",
+                         absl::StrJoin(columns, ", "), ") PRIMARY KEY(",
+                         kKeyColumn, ")")};
+  }
+
+  absl::Status Load(WorkloadSession* session) override {
+    absl::BitGen gen;
+    for (int64_t begin = 0; begin < options_.record_count;
+         begin += kRecordsPerCommit) {
+      const int64_t end =
+          std::min(begin + kRecordsPerCommit, options_.record_count);
+      ZETASQL_RETURN_IF_ERROR(
+          session->RunTransaction([&](WorkloadTransaction* txn) {
+            std::vector<Row> rows;
+            for (int64_t key = begin; key < end; ++key) {
+              rows.push_back(NewRecord(gen, key));
+            }
+            txn->Write(WriteOp::kInsertOrUpdate, std::string(kTable),
+                       AllColumns(), std::move(rows));
+            return absl::OkStatus();
+          }));
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status RunOperation(WorkloadSession* session, absl::BitGenRef gen,
+                            std::string* name) override {
+    double r = absl::Uniform(gen, 0.0, 1.0);
+    if ((r -= mix_.read) < 0) {
+      *name = "read";
+      return Read(session, NextKey(gen));
+    }
+    if ((r -= mix_.update) < 0) {
+      *name = "update";
+      return Update(session, gen, NextKey(gen));
+    }
+    if ((r -= mix_.insert) < 0) {
+      *name = "insert";
+      return Insert(session, gen);
+    }
+    if ((r -= mix_.scan) < 0) {
+      *name = "scan";
+      return Scan(session, gen, NextKey(gen));
+    }
+    *name = "read_modify_write";
+    return ReadModifyWrite(session, gen, NextKey(gen));
+  }
+
+ private:
+  std::vector<std::string> AllColumns() const {
+    std::vector<std::string> columns = {std::string(kKeyColumn)};
+    for (int i = 0; i < options_.field_count; ++i) {
+      columns.push_back(FieldName(i));
+    }
+    return columns;
+  }
+
+  Row NewRecord(absl::BitGenRef gen, int64_t key) const {
+    Row row = {Int64(key)};
+    for (int i = 0; i < options_.field_count; ++i) {
+      row.push_back(String(RandomField(gen, options_.field_length)));
+    }
+    return row;
+  }
+
+  // Zipfian keys are drawn from the loaded records, scattered by a hash so
+  // that the hot keys are not next to each other. Latest keys count back
+  // from the last inserted record.
+  int64_t NextKey(absl::BitGenRef gen) const {
+    const int64_t num_keys = next_insert_key_.load(std::memory_order_relaxed);
+    switch (distribution_) {
+      case KeyDistribution::kUniform:
+        return absl::Uniform<int64_t>(gen, 0, num_keys);
+      case KeyDistribution::kZipfian:
+        return FnvHash64(zipfian_.Next(gen)) % options_.record_count;
+      case KeyDistribution::kLatest:
+        return std::max<int64_t>(0, num_keys - 1 - zipfian_.Next(gen));
+    }
+    return 0;
+  }
+
+  absl::Status Read(WorkloadSession* session, int64_t key) const {
+    return session
+        ->Query(absl::StrCat("SELECT * FROM ", kTable, " WHERE ", kKeyColumn,
+                             " = @key"),
+                {{"key", Int64(key)}})
+        .status();
+  }
+
+  // Writes a new value to one field of the record, as YCSB does by default.
+  void WriteField(WorkloadTransaction* txn, absl::BitGenRef gen,
+                  int64_t key) const {
+    const int field = absl::Uniform(gen, 0, options_.field_count);
+    txn->Write(WriteOp::kInsertOrUpdate, std::string(kTable),
+               {std::string(kKeyColumn), FieldName(field)},
+               {{Int64(key), String(RandomField(gen, options_.field_length))}});
+  }
+
+  absl::Status Update(WorkloadSession* session, absl::BitGenRef gen,
+                      int64_t key) const {
+    return session->RunTransaction([&](WorkloadTransaction* txn) {
+      WriteField(txn, gen, key);
+      return absl::OkStatus();
+    });
+  }
+
+  absl::Status Insert(WorkloadSession* session, absl::BitGenRef gen) {
+    const int64_t key =
+        next_insert_key_.fetch_add(1, std::memory_order_relaxed);
+    return session->RunTransaction([&](WorkloadTransaction* txn) {
+      txn->Write(WriteOp::kInsert, std::string(kTable), AllColumns(),
+                 {NewRecord(gen, key)});
+      return absl::OkStatus();
+    });
+  }
+
+  absl::Status Scan(WorkloadSession* session, absl::BitGenRef gen,
+                    int64_t key) const {
+    const int64_t limit = absl::Uniform<int64_t>(absl::IntervalClosed, gen, 1,
+                                                 options_.max_scan_length);
+    return session
+        ->Query(absl::StrCat("SELECT * FROM ", kTable, " WHERE ", kKeyColumn,
+                             " >= @key ORDER BY ", kKeyColumn,
+                             " LIMIT @limit"),
+                {{"key", Int64(key)}, {"limit", Int64(limit)}})
+        .status();
+  }
+
+  absl::Status ReadModifyWrite(WorkloadSession* session, absl::BitGenRef gen,
+                               int64_t key) const {
+    return session->RunTransaction([&](WorkloadTransaction* txn) {
+      ZETASQL_RETURN_IF_ERROR(txn->Query(absl::StrCat("SELECT * FROM ", kTable,
+                                              " WHERE ", kKeyColumn, " = @key"),
+                                 {{"key", Int64(key)}})
+                          .status());
+      WriteField(txn, gen, key);
+      return absl::OkStatus();
+    });
+  }
+
+  const YcsbOptions options_;
+  const Mix mix_;
+  const KeyDistribution distribution_;
+  const ZipfianGenerator zipfian_;
+
+  // The key of the next record inserted. Records are loaded with the keys
+  // below the initial value.
+  std::atomic<int64_t> next_insert_key_;
+};
+
+}  // namespace
+
+ZipfianGenerator::ZipfianGenerator(int64_t num_items, double theta)
+    : num_items_(num_items),
+      theta_(theta),
+      zeta_n_(Zeta(num_items, theta)),
+      alpha_(1 / (1 - theta)),
+      eta_((1 - std::pow(2.0 / num_items, 1 - theta)) /
+           (1 - Zeta(2, theta) / zeta_n_)) {}
+
+int64_t ZipfianGenerator::Next(absl::BitGenRef gen) const {
+  const double u = absl::Uniform(gen, 0.0, 1.0);
+  const double uz = u * zeta_n_;
+  if (uz < 1) return 0;
+  if (uz < 1 + std::pow(0.5, theta_)) {
+    return std::min<int64_t>(1, num_items_ - 1);
+  }
+  const int64_t item =
+      static_cast<int64_t>(num_items_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+  return std::min(item, num_items_ - 1);
+}
+
+absl::StatusOr<std::unique_ptr<Workload>> CreateYcsbWorkload(
+    const YcsbOptions& options) {
+  if (options.record_count <= 0 || options.field_count <= 0 ||
+      options.max_scan_length <= 0) {
+    return absl::InvalidArgumentError(
+        "YCSB record count, field count and scan length must be positive.");
+  }
+  if (options.zipfian_constant <= 0 || options.zipfian_constant >= 1) {
+    return absl::InvalidArgumentError(
+        "The Zipfian constant must be between 0 and 1, exclusive.");
+  }
+  Mix mix;
+  KeyDistribution distribution = KeyDistribution::kZipfian;
+  switch (options.workload) {
+    case 'A':
+      mix = {.read = 0.5, .update = 0.5};
+      break;
+    case 'B':
+      mix = {.read = 0.95, .update = 0.05};
+      break;
+    case 'C':
+      mix = {.read = 1};
+      break;
+    case 'D':
+      mix = {.read = 0.95, .insert = 0.05};
+      distribution = KeyDistribution::kLatest;
+      break;
+    case 'E':
+      mix = {.insert = 0.05, .scan = 0.95};
+      break;
+    case 'F':
+      mix = {.read = 0.5, .read_modify_write = 0.5};
+      break;
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unknown YCSB workload: ", std::string(1, options.workload)));
+  }
+  return std::make_unique<YcsbWorkload>(
+      options, mix, options.distribution.value_or(distribution));
+}
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,98 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_YCSB_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_YCSB_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "absl/random/bit_gen_ref.h"
+#include "absl/status/statusor.h"
+#include "benchmarks/workload.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+
+// Draws integers in [0, num_items) following a Zipfian distribution, 0 being
+// the most frequent, with the algorithm of Gray et al., "Quickly Generating
+// Billion-Record Synthetic Databases", which YCSB uses.
+class ZipfianGenerator {
+ public:
+  explicit ZipfianGenerator(int64_t num_items, double theta = 0.99);
+
+  int64_t Next(absl::BitGenRef gen) const;
+
+ private:
+  const int64_t num_items_;
+  const double theta_;
+  const double zeta_n_;
+  const double alpha_;
+  const double eta_;
+};
+
+// How YCSB operations pick the keys they access.
+enum class KeyDistribution {
+  // Every key is as likely.
+  kUniform,
+  // A few keys, scattered over the key space, are accessed most often.
+  kZipfian,
+  // The most recently inserted keys are accessed most often.
+  kLatest,
+};
+
+struct YcsbOptions {
+  // The YCSB core workload, 'A' to 'F':
+  //   A: 50% reads, 50% updates.
+  //   B: 95% reads, 5% updates.
+  //   C: 100% reads.
+  //   D: 95% reads, 5% inserts, reading the latest inserts most often.
+  //   E: 95% scans, 5% inserts.
+  //   F: 50% reads, 50% read-modify-writes.
+  char workload = 'A';
+
+  // The number of records loaded.
+  int64_t record_count = 100000;
+
+  // The number of fields of a record and the length of each field.
+  int field_count = 10;
+  int field_length = 100;
+
+  // The key distribution. Defaults to the one of the workload, which is
+  // kLatest for D and kZipfian otherwise.
+  std::optional<KeyDistribution> distribution;
+
+  // The constant of the Zipfian distribution. Larger is more skewed.
+  double zipfian_constant = 0.99;
+
+  // Scans read a uniformly distributed number of records up to this many.
+  int max_scan_length = 100;
+};
+
+// Creates the YCSB core workload described by options, over a single table
+// whose rows are keyed by a record number.
+absl::StatusOr<std::unique_ptr<Workload>> CreateYcsbWorkload(
+    const YcsbOptions& options);
+
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BENCHMARKS_YCSB_H_
@@ -0,0 +1,92 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmarks/ycsb.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "benchmarks/in_process_target.h"
+#include "benchmarks/workload.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace benchmarks {
+namespace {
+
+using ::zetasql_base::testing::StatusIs;
+
+TEST(ZipfianGeneratorTest, FavorsTheFirstItems) {
+  ZipfianGenerator zipfian(1000);
+  absl::BitGen gen;
+  std::vector<int> counts(1000);
+  for (int i = 0; i < 100000; ++i) {
+    const int64_t item = zipfian.Next(gen);
+    ASSERT_GE(item, 0);
+    ASSERT_LT(item, 1000);
+    ++counts[item];
+  }
+  EXPECT_GT(counts[0], counts[1]);
+  EXPECT_GT(counts[1], counts[10]);
+  EXPECT_GT(counts[10], counts[500]);
+}
+
+TEST(YcsbTest, RejectsUnknownWorkloads) {
+  EXPECT_THAT(CreateYcsbWorkload(YcsbOptions{.workload = 'G'}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+class YcsbWorkloadTest : public testing::TestWithParam<char> {};
+
+TEST_P(YcsbWorkloadTest, RunsAgainstInProcessDatabase) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Workload> workload,
+      CreateYcsbWorkload(YcsbOptions{.workload = GetParam(),
+                                     .record_count = 1000,
+                                     .field_length = 10}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WorkloadTarget> target,
+                       CreateInProcessTarget(workload->Schema()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WorkloadSession> session,
+                       target->NewSession());
+  ZETASQL_ASSERT_OK(workload->Load(session.get()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<Row> rows,
+                       session->Query("SELECT COUNT(*) FROM usertable"));
+  EXPECT_EQ(rows[0][0].int64_value(), 1000);
+
+  absl::BitGen gen;
+  std::string name;
+  for (int i = 0; i < 200; ++i) {
+    ZETASQL_EXPECT_OK(workload->RunOperation(session.get(), gen, &name))
+        << name;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(CoreWorkloads, YcsbWorkloadTest,
+                         testing::Values('A', 'B', 'C', 'D', 'E', 'F'));
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -14,34 +14,375 @@
 // limitations under the License.
 //
 
+#include <pthread.h>
+#include <signal.h>
+
 #include <algorithm>
+#include <cstdlib>
+#include <map>
 #include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "absl/flags/parse.h"
 #include "zetasql/base/logging.h"
+#include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/time.h"
+#include "backend/database/database.h"
+#include "backend/query/function_catalog.h"
 #include "common/config.h"
+#include "common/profiling.h"
+#include "common/tracing.h"
+#include "frontend/collections/database_manager.h"
+#include "frontend/entities/database.h"
+#include "frontend/server/admission_controller.h"
+#include "frontend/server/bulk_load.h"
+#include "frontend/server/csv_export.h"
+#include "frontend/server/database_scheduler.h"
+#include "frontend/server/metrics_server.h"
+#include "frontend/server/resource_accounting.h"
+#include "frontend/server/rpc_recorder.h"
+#include "frontend/server/environment.h"
 #include "frontend/server/server.h"
+#include "frontend/server/session_executor.h"
+#include "frontend/server/shard_router.h"
+#include "frontend/server/snapshot.h"
+#include "frontend/server/write_ahead_log.h"
+#include "frontend/server/write_ahead_log_follower.h"
 
 using Server = ::google::spanner::emulator::frontend::Server;
+namespace config = ::google::spanner::emulator::config;
+namespace frontend = ::google::spanner::emulator::frontend;
+namespace profiling = ::google::spanner::emulator::profiling;
+namespace tracing = ::google::spanner::emulator::tracing;
+
+namespace {
+
+// Returns the key access heatmaps of every database as a JSON array of objects
+// with the URI of the database and the heatmap of each of its tables.
+std::string KeyAccessHeatmapJson(frontend::ServerEnv* env) {
+  std::vector<std::string> databases;
+  for (const auto& database : env->database_manager()->ListAllDatabases()) {
+    databases.push_back(absl::StrCat(
+        "{\"database\":\"", database->database_uri(), "\",\"tables\":",
+        database->backend()->ExportKeyAccessHeatmapJson(), "}"));
+  }
+  return absl::StrCat("[", absl::StrJoin(databases, ","), "]");
+}
+
+// Exports the tables of every database to dir, returning whether it succeeded.
+// Errors are logged, so that the page need not escape them.
+std::string ExportCsvFilesJson(frontend::ServerEnv* env,
+                               const std::string& dir) {
+  absl::Status status = frontend::ExportCsvFiles(env, dir);
+  if (!status.ok()) {
+    ZETASQL_LOG(ERROR) << "Failed to export databases to " << dir << ": "
+               << status;
+    return "{\"ok\":false}";
+  }
+  ZETASQL_LOG(INFO) << "Exported databases to " << dir;
+  return "{\"ok\":true}";
+}
+
+// Serves requests at --host_port by forwarding them to --database_shards
+// worker processes, see frontend::ShardRouter.
+int RunShardRouter(int argc, char** argv) {
+  if (!config::save_snapshot_path().empty() || config::save_fixtures() ||
+      !config::restore_snapshot_path().empty() ||
+      !config::bulk_load_files().empty() ||
+      !config::follow_write_ahead_log_dir().empty()) {
+    ZETASQL_LOG(ERROR) << "--database_shards cannot be combined with --save_snapshot, "
+                  "--save_fixtures, --restore_snapshot, --bulk_load or "
+                  "--follow_write_ahead_log_dir.";
+    return EXIT_FAILURE;
+  }
+  char socket_dir[] = "/tmp/spanner-emulator-shards-XXXXXX";
+  if (::mkdtemp(socket_dir) == nullptr) {
+    ZETASQL_LOG(ERROR) << "Failed to create a directory for the worker sockets.";
+    return EXIT_FAILURE;
+  }
+  auto workers_or = frontend::ShardWorkers::Start(
+      "/proc/self/exe", std::vector<std::string>(argv, argv + argc),
+      config::database_shards(), socket_dir);
+  if (!workers_or.ok()) {
+    ZETASQL_LOG(ERROR) << workers_or.status();
+    return EXIT_FAILURE;
+  }
+  std::unique_ptr<frontend::ShardWorkers> workers =
+      std::move(workers_or).value();
+
+  std::unique_ptr<frontend::ShardRouter> router =
+      frontend::ShardRouter::Create(frontend::ShardRouter::Options{
+          .server_address = config::grpc_host_port(),
+          .unix_socket_path = config::grpc_unix_socket_path(),
+          .worker_targets = workers->targets(),
+      });
+  if (!router) {
+    return EXIT_FAILURE;
+  }
+  // Workers replay their write ahead logs before they report serving.
+  absl::Status status = router->WaitForWorkers(absl::Minutes(10));
+  if (!status.ok()) {
+    ZETASQL_LOG(ERROR) << status;
+    return EXIT_FAILURE;
+  }
+
+  ZETASQL_LOG(INFO) << "Cloud Spanner Emulator running with "
+            << config::database_shards() << " database shards.";
+  ZETASQL_LOG(INFO) << "Server address: "
+            << absl::StrCat(router->host(), ":", router->port());
+  router->WaitForShutdown();
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
 
 int main(int argc, char** argv) {
   // Start the emulator gRPC server.
   absl::ParseCommandLine(argc, argv);
+
+  if (config::database_shards() > 0 && config::database_shard_index() < 0) {
+    return RunShardRouter(argc, argv);
+  }
+
+  // Building the function catalog takes a noticeable part of startup, so it
+  // is built in the background while the server starts and loads its state,
+  // rather than by the first query.
+  std::thread([] { backend::FunctionCatalog::Default(); }).detach();
+
+  // When saving a snapshot or fixtures on exit, SIGINT and SIGTERM are blocked
+  // here so that every thread inherits the mask, and are instead waited for
+  // below.
+  const std::string save_snapshot_path = config::save_snapshot_path();
+  const bool save_on_exit =
+      !save_snapshot_path.empty() || config::save_fixtures();
+  sigset_t exit_signals;
+  sigemptyset(&exit_signals);
+  sigaddset(&exit_signals, SIGINT);
+  sigaddset(&exit_signals, SIGTERM);
+  if (save_on_exit) {
+    pthread_sigmask(SIG_BLOCK, &exit_signals, nullptr);
+  }
+
+  // Allocations are counted from the start, since the handlers only subtract
+  // the counts they see when an RPC starts from those when it ends.
+  if (config::count_allocations()) {
+    profiling::EnableAllocationCounting();
+  }
+
+  // Record RPCs before the server starts so that the trace captures every RPC
+  // the server handles.
+  const std::string rpc_trace_file = config::rpc_trace_file();
+  if (!rpc_trace_file.empty()) {
+    auto recorder_or = frontend::RpcRecorder::Open(rpc_trace_file);
+    if (!recorder_or.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to open RPC trace file: "
+                 << recorder_or.status();
+      return EXIT_FAILURE;
+    }
+    frontend::RpcRecorder::SetDefault(std::move(recorder_or).value());
+    ZETASQL_LOG(INFO) << "Recording RPCs to " << rpc_trace_file;
+  }
+
+  if (config::database_scheduler_slots() > 0 ||
+      config::database_max_concurrent_rpcs() > 0) {
+    frontend::DatabaseScheduler::Options scheduler_options;
+    scheduler_options.max_slots = config::database_scheduler_slots();
+    scheduler_options.max_per_database = config::database_max_concurrent_rpcs();
+    absl::Status status = frontend::DatabaseScheduler::ParseWeights(
+        config::database_scheduler_weights(), &scheduler_options);
+    if (!status.ok()) {
+      ZETASQL_LOG(ERROR) << status;
+      return EXIT_FAILURE;
+    }
+    frontend::DatabaseScheduler::SetDefault(
+        std::make_unique<frontend::DatabaseScheduler>(scheduler_options));
+  }
+
+  if (config::admission_max_in_flight() > 0) {
+    frontend::AdmissionController::Options admission_options;
+    admission_options.max_in_flight = config::admission_max_in_flight();
+    admission_options.max_queued = config::admission_max_queued();
+    admission_options.max_queue_wait = config::admission_max_queue_wait();
+    frontend::AdmissionController::SetDefault(
+        std::make_unique<frontend::AdmissionController>(admission_options));
+  }
+
+  if (config::session_worker_threads() > 0) {
+    frontend::SessionExecutor::SetDefault(
+        std::make_unique<frontend::SessionExecutor>(
+            frontend::SessionExecutor::Options{
+                .num_workers = config::session_worker_threads()}));
+  }
+
+  if (config::enable_resource_accounting()) {
+    frontend::ResourceAccountant::Options accounting_options;
+    accounting_options.caller_label =
+        config::resource_accounting_caller_label();
+    frontend::ResourceAccountant::SetDefault(
+        std::make_unique<frontend::ResourceAccountant>(accounting_options));
+  }
+
   Server::Options options;
-  options.server_address = google::spanner::emulator::config::grpc_host_port();
+  options.server_address = config::grpc_host_port();
+  options.unix_socket_path = config::grpc_unix_socket_path();
+  options.num_completion_queues = config::grpc_num_completion_queues();
+  options.min_pollers = config::grpc_min_pollers();
+  options.max_pollers = config::grpc_max_pollers();
+  options.max_threads = config::grpc_max_threads();
   std::unique_ptr<Server> server = Server::Create(options);
   if (!server) {
     ZETASQL_LOG(ERROR) << "Failed to start gRPC server.";
     return EXIT_FAILURE;
   }
 
+  std::unique_ptr<frontend::MetricsServer> metrics_server;
+  const std::string metrics_host_port = config::metrics_host_port();
+  if (!metrics_host_port.empty()) {
+    std::map<std::string, frontend::MetricsServer::JsonPage> json_pages;
+    if (config::key_access_sampling_interval() > 0) {
+      frontend::ServerEnv* env = server->env();
+      json_pages["/keyheatmap"] = [env] { return KeyAccessHeatmapJson(env); };
+    }
+    if (frontend::ResourceAccountant* accountant =
+            frontend::ResourceAccountant::Default();
+        accountant != nullptr) {
+      json_pages["/resourceusage"] = [accountant] {
+        return accountant->ExportJson();
+      };
+    }
+    if (const std::string export_dir = config::export_dir();
+        !export_dir.empty()) {
+      frontend::ServerEnv* env = server->env();
+      json_pages["/debug/export"] = [env, export_dir] {
+        return ExportCsvFilesJson(env, export_dir);
+      };
+    }
+    auto metrics_server_or = frontend::MetricsServer::Create(
+        metrics_host_port, std::move(json_pages),
+        [grpc_server = server.get()] { return grpc_server->ready(); });
+    if (!metrics_server_or.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to start metrics server: "
+                 << metrics_server_or.status();
+      return EXIT_FAILURE;
+    }
+    metrics_server = std::move(metrics_server_or).value();
+    ZETASQL_LOG(INFO) << "Serving metrics at http://" << metrics_host_port
+              << "/metrics";
+  }
+
+  const std::string trace_export_file = config::trace_export_file();
+  if (!trace_export_file.empty()) {
+    absl::Status status = tracing::StartFileSpanExporter(trace_export_file);
+    if (!status.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to start trace exporter: " << status;
+      return EXIT_FAILURE;
+    }
+    ZETASQL_LOG(INFO) << "Exporting traces to " << trace_export_file;
+  }
+
+  const std::string restore_snapshot_path = config::restore_snapshot_path();
+  if (!restore_snapshot_path.empty()) {
+    absl::Status status =
+        frontend::RestoreSnapshot(restore_snapshot_path, server->env());
+    if (!status.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to restore snapshot: " << status;
+      return EXIT_FAILURE;
+    }
+    ZETASQL_LOG(INFO) << "Restored snapshot from " << restore_snapshot_path;
+  }
+
+  const std::string write_ahead_log_dir = config::write_ahead_log_dir();
+  if (!write_ahead_log_dir.empty()) {
+    absl::Status status = frontend::ReplayWriteAheadLogs(server->env());
+    if (!status.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to replay write ahead logs: " << status;
+      return EXIT_FAILURE;
+    }
+    ZETASQL_LOG(INFO) << "Replayed write ahead logs from " << write_ahead_log_dir;
+  }
+
+  // The follower's databases are copies of those of the followed emulator, and
+  // must not be changed by anything else.
+  std::unique_ptr<frontend::WriteAheadLogFollower> follower;
+  const std::string follow_write_ahead_log_dir =
+      config::follow_write_ahead_log_dir();
+  if (!follow_write_ahead_log_dir.empty()) {
+    if (!write_ahead_log_dir.empty() || !config::bulk_load_files().empty()) {
+      ZETASQL_LOG(ERROR) << "--follow_write_ahead_log_dir cannot be combined with "
+                    "--write_ahead_log_dir or --bulk_load.";
+      return EXIT_FAILURE;
+    }
+    auto follower_or = frontend::WriteAheadLogFollower::Start(
+        server->env(), follow_write_ahead_log_dir,
+        config::follow_write_ahead_log_poll_interval());
+    if (!follower_or.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to follow write ahead logs: "
+                 << follower_or.status();
+      return EXIT_FAILURE;
+    }
+    follower = std::move(follower_or).value();
+    ZETASQL_LOG(INFO) << "Following write ahead logs in "
+              << follow_write_ahead_log_dir;
+  }
+
+  const std::string bulk_load_files = config::bulk_load_files();
+  if (!bulk_load_files.empty()) {
+    absl::Status status =
+        frontend::BulkLoadCsvFiles(bulk_load_files, server->env());
+    if (!status.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to bulk load files: " << status;
+      return EXIT_FAILURE;
+    }
+    ZETASQL_LOG(INFO) << "Bulk loaded " << bulk_load_files;
+  }
+
+  // Requests are served while the state above is loaded, but clients waiting
+  // on the health service or /readyz only see the server once it is done.
+  server->SetReady();
+
+  if (save_on_exit) {
+    std::thread([&exit_signals, &server]() {
+      int sig;
+      sigwait(&exit_signals, &sig);
+      ZETASQL_LOG(INFO) << "Received signal " << sig << ", shutting down.";
+      server->Shutdown();
+    }).detach();
+  }
+
   ZETASQL_LOG(INFO) << "Cloud Spanner Emulator running.";
   ZETASQL_LOG(INFO) << "Server address: "
             << absl::StrCat(server->host(), ":", server->port());
+  if (!options.unix_socket_path.empty()) {
+    ZETASQL_LOG(INFO) << "Unix socket address: unix:"
+              << options.unix_socket_path;
+  }
 
   // Block forever until the server is terminated.
   server->WaitForShutdown();
 
+  if (!save_snapshot_path.empty()) {
+    absl::Status status =
+        frontend::SaveSnapshot(server->env(), save_snapshot_path);
+    if (!status.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to save snapshot: " << status;
+      return EXIT_FAILURE;
+    }
+    ZETASQL_LOG(INFO) << "Saved snapshot to " << save_snapshot_path;
+  }
+
+  if (config::save_fixtures()) {
+    absl::Status status = frontend::SaveFixtures(server->env());
+    if (!status.ok()) {
+      ZETASQL_LOG(ERROR) << "Failed to save fixtures: " << status;
+      return EXIT_FAILURE;
+    }
+    ZETASQL_LOG(INFO) << "Saved fixtures to " << config::fixture_dir();
+  }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,566 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Load generator which drives an emulator over gRPC with a configurable mix of
+// operations and reports latency percentiles and throughput per operation.
+//
+// By default an emulator server is started in-process. Point it at a running
+// emulator instead with --endpoint, e.g.
+//   bazel run -c opt //binaries:load_generator_main -- \
+//     --endpoint=localhost:9010 --sessions=64 --duration=60s \
+//     --mix=point_read=60,range_scan=10,dml=10,batch_dml=5,mutation=15 \
+//     --change_stream_readers=4
+//
+// Exits with a non-zero status if any operation failed, so that a short run
+// can be used as a test of the handlers under load.
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "google/longrunning/operations.grpc.pb.h"
+#include "google/protobuf/struct.pb.h"
+#include "google/spanner/admin/database/v1/spanner_database_admin.grpc.pb.h"
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.grpc.pb.h"
+#include "google/spanner/v1/spanner.grpc.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "zetasql/base/logging.h"
+#include "absl/random/random.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "frontend/server/server.h"
+#include "grpcpp/channel.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+#include "grpcpp/support/status.h"
+
+ABSL_FLAG(std::string, endpoint, "",
+          "Address of the emulator to load. If empty, an emulator server is "
+          "started in-process.");
+
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(30),
+          "How long to run the load for.");
+
+ABSL_FLAG(int, sessions, 8,
+          "Number of client sessions. Each session is driven by its own "
+          "thread, issuing one operation at a time.");
+
+ABSL_FLAG(std::string, mix,
+          "point_read=50,range_scan=10,dml=10,batch_dml=5,mutation=25",
+          "Comma separated relative weights of the operations issued by each "
+          "session. Valid operations are point_read, range_scan, dml, "
+          "batch_dml and mutation.");
+
+ABSL_FLAG(int, change_stream_readers, 0,
+          "Number of threads which repeatedly read one second windows of a "
+          "change stream on the load table.");
+
+ABSL_FLAG(int64_t, rows, 10000, "Number of rows in the load table.");
+
+ABSL_FLAG(int64_t, range_scan_rows, 100,
+          "Number of rows read by each range scan.");
+
+ABSL_FLAG(int, batch_size, 10,
+          "Number of statements per batch DML, and of rows per mutation "
+          "commit.");
+
+namespace {
+
+namespace database_api = ::google::spanner::admin::database::v1;
+namespace instance_api = ::google::spanner::admin::instance::v1;
+namespace operations_api = ::google::longrunning;
+namespace spanner_api = ::google::spanner::v1;
+
+using ::google::spanner::emulator::frontend::Server;
+
+constexpr absl::string_view kProject = "projects/load-test";
+constexpr absl::string_view kInstanceId = "load-test";
+constexpr absl::string_view kDatabaseId = "load-test";
+constexpr absl::string_view kTable = "LoadTable";
+constexpr absl::string_view kChangeStream = "LoadStream";
+
+enum class Op { kPointRead, kRangeScan, kDml, kBatchDml, kMutation };
+
+struct OpInfo {
+  Op op;
+  absl::string_view name;
+};
+
+constexpr OpInfo kOps[] = {
+    {Op::kPointRead, "point_read"}, {Op::kRangeScan, "range_scan"},
+    {Op::kDml, "dml"},              {Op::kBatchDml, "batch_dml"},
+    {Op::kMutation, "mutation"},
+};
+
+constexpr absl::string_view kChangeStreamOpName = "change_stream";
+
+// Latencies and errors of one kind of operation.
+struct OpStats {
+  std::vector<absl::Duration> latencies;
+  int64_t errors = 0;
+
+  void Merge(const OpStats& other) {
+    latencies.insert(latencies.end(), other.latencies.begin(),
+                     other.latencies.end());
+    errors += other.errors;
+  }
+};
+
+using Stats = absl::flat_hash_map<std::string, OpStats>;
+
+struct Stubs {
+  explicit Stubs(std::shared_ptr<grpc::Channel> channel)
+      : spanner(spanner_api::Spanner::NewStub(channel)),
+        database_admin(database_api::DatabaseAdmin::NewStub(channel)),
+        instance_admin(instance_api::InstanceAdmin::NewStub(channel)),
+        operations(operations_api::Operations::NewStub(channel)) {}
+
+  std::unique_ptr<spanner_api::Spanner::Stub> spanner;
+  std::unique_ptr<database_api::DatabaseAdmin::Stub> database_admin;
+  std::unique_ptr<instance_api::InstanceAdmin::Stub> instance_admin;
+  std::unique_ptr<operations_api::Operations::Stub> operations;
+};
+
+std::string InstanceUri() {
+  return absl::StrCat(kProject, "/instances/", kInstanceId);
+}
+
+std::string DatabaseUri() {
+  return absl::StrCat(InstanceUri(), "/databases/", kDatabaseId);
+}
+
+void CheckOk(const grpc::Status& status, absl::string_view what) {
+  ZETASQL_CHECK(status.ok()) << what << " failed: " << status.error_message();
+}
+
+// Polls the long running operation until it is done.
+void WaitForOperation(Stubs* stubs, operations_api::Operation op) {
+  while (!op.done()) {
+    absl::SleepFor(absl::Milliseconds(100));
+    grpc::ClientContext ctx;
+    operations_api::GetOperationRequest request;
+    request.set_name(op.name());
+    CheckOk(stubs->operations->GetOperation(&ctx, request, &op),
+            "GetOperation");
+  }
+  ZETASQL_CHECK(!op.has_error())
+      << op.name() << " failed: " << op.error().message();
+}
+
+google::protobuf::Value Int64Value(int64_t value) {
+  google::protobuf::Value proto;
+  proto.set_string_value(absl::StrCat(value));
+  return proto;
+}
+
+google::protobuf::Value StringValue(absl::string_view value) {
+  google::protobuf::Value proto;
+  proto.set_string_value(std::string(value));
+  return proto;
+}
+
+// Adds an insert_or_update mutation of rows [begin, end) to request.
+void AddRows(int64_t begin, int64_t end, absl::string_view value,
+             spanner_api::CommitRequest* request) {
+  auto* write = request->add_mutations()->mutable_insert_or_update();
+  write->set_table(std::string(kTable));
+  write->add_columns("k");
+  write->add_columns("v");
+  for (int64_t k = begin; k < end; ++k) {
+    auto* row = write->add_values();
+    *row->add_values() = Int64Value(k);
+    *row->add_values() = StringValue(value);
+  }
+}
+
+grpc::Status CommitSingleUse(Stubs* stubs, const std::string& session,
+                             spanner_api::CommitRequest request) {
+  request.set_session(session);
+  request.mutable_single_use_transaction()->mutable_read_write();
+  grpc::ClientContext ctx;
+  spanner_api::CommitResponse response;
+  return stubs->spanner->Commit(&ctx, request, &response);
+}
+
+grpc::Status CreateSession(Stubs* stubs, std::string* session) {
+  grpc::ClientContext ctx;
+  spanner_api::CreateSessionRequest request;
+  request.set_database(DatabaseUri());
+  spanner_api::Session response;
+  grpc::Status status = stubs->spanner->CreateSession(&ctx, request, &response);
+  *session = response.name();
+  return status;
+}
+
+// Creates the instance, database and load table, and fills the table.
+void SetUpDatabase(Stubs* stubs) {
+  {
+    grpc::ClientContext ctx;
+    instance_api::CreateInstanceRequest request;
+    request.set_parent(std::string(kProject));
+    request.set_instance_id(std::string(kInstanceId));
+    request.mutable_instance()->set_config(
+        absl::StrCat(kProject, "/instanceConfigs/emulator-config"));
+    request.mutable_instance()->set_display_name("Load test");
+    request.mutable_instance()->set_node_count(1);
+    operations_api::Operation op;
+    CheckOk(stubs->instance_admin->CreateInstance(&ctx, request, &op),
+            "CreateInstance");
+    WaitForOperation(stubs, std::move(op));
+  }
+  {
+    grpc::ClientContext ctx;
+    database_api::CreateDatabaseRequest request;
+    request.set_parent(InstanceUri());
+    request.set_create_statement(
+        absl::StrCat("CREATE DATABASE `", kDatabaseId, "`"));
+    request.add_extra_statements(absl::StrCat(
+        "CREATE TABLE ", kTable, "(k INT64, v STRING(MAX)) PRIMARY KEY(k)"));
+    request.add_extra_statements(
+        absl::StrCat("CREATE CHANGE STREAM ", kChangeStream, " FOR ", kTable));
+    operations_api::Operation op;
+    CheckOk(stubs->database_admin->CreateDatabase(&ctx, request, &op),
+            "CreateDatabase");
+    WaitForOperation(stubs, std::move(op));
+  }
+
+  std::string session;
+  CheckOk(CreateSession(stubs, &session), "CreateSession");
+  constexpr int64_t kRowsPerCommit = 1000;
+  const int64_t num_rows = absl::GetFlag(FLAGS_rows);
+  for (int64_t begin = 0; begin < num_rows; begin += kRowsPerCommit) {
+    spanner_api::CommitRequest request;
+    AddRows(begin, std::min(begin + kRowsPerCommit, num_rows), "initial",
+            &request);
+    CheckOk(CommitSingleUse(stubs, session, std::move(request)), "Commit");
+  }
+}
+
+grpc::Status DrainStream(
+    std::unique_ptr<grpc::ClientReader<spanner_api::PartialResultSet>>
+        reader) {
+  spanner_api::PartialResultSet result;
+  while (reader->Read(&result)) {
+  }
+  return reader->Finish();
+}
+
+grpc::Status BeginReadWrite(Stubs* stubs, const std::string& session,
+                            std::string* transaction_id) {
+  grpc::ClientContext ctx;
+  spanner_api::BeginTransactionRequest request;
+  request.set_session(session);
+  request.mutable_options()->mutable_read_write();
+  spanner_api::Transaction response;
+  grpc::Status status =
+      stubs->spanner->BeginTransaction(&ctx, request, &response);
+  *transaction_id = response.id();
+  return status;
+}
+
+grpc::Status Commit(Stubs* stubs, const std::string& session,
+                    const std::string& transaction_id) {
+  grpc::ClientContext ctx;
+  spanner_api::CommitRequest request;
+  request.set_session(session);
+  request.set_transaction_id(transaction_id);
+  spanner_api::CommitResponse response;
+  return stubs->spanner->Commit(&ctx, request, &response);
+}
+
+// Sets @k to key in an ExecuteSql or ExecuteBatchDml statement.
+template <typename Statement>
+void SetKeyParam(int64_t key, Statement* statement) {
+  (*statement->mutable_params()->mutable_fields())["k"] = Int64Value(key);
+  (*statement->mutable_param_types())["k"].set_code(spanner_api::INT64);
+}
+
+// Issues one operation from a session, returning its status.
+class SessionDriver {
+ public:
+  SessionDriver(Stubs* stubs, std::string session)
+      : stubs_(stubs), session_(std::move(session)) {}
+
+  grpc::Status Run(Op op) {
+    switch (op) {
+      case Op::kPointRead:
+        return PointRead();
+      case Op::kRangeScan:
+        return RangeScan();
+      case Op::kDml:
+        return Dml();
+      case Op::kBatchDml:
+        return BatchDml();
+      case Op::kMutation:
+        return Mutation();
+    }
+    return grpc::Status(grpc::StatusCode::INTERNAL, "Unknown operation");
+  }
+
+ private:
+  int64_t RandomKey(int64_t range = 1) {
+    return absl::Uniform<int64_t>(
+        gen_, 0, std::max<int64_t>(absl::GetFlag(FLAGS_rows) - range, 1));
+  }
+
+  grpc::Status PointRead() {
+    grpc::ClientContext ctx;
+    spanner_api::ReadRequest request;
+    request.set_session(session_);
+    request.set_table(std::string(kTable));
+    request.add_columns("k");
+    request.add_columns("v");
+    *request.mutable_key_set()->add_keys()->add_values() =
+        Int64Value(RandomKey());
+    spanner_api::ResultSet response;
+    return stubs_->spanner->Read(&ctx, request, &response);
+  }
+
+  grpc::Status RangeScan() {
+    const int64_t num_rows = absl::GetFlag(FLAGS_range_scan_rows);
+    grpc::ClientContext ctx;
+    spanner_api::ExecuteSqlRequest request;
+    request.set_session(session_);
+    request.set_sql(absl::StrCat("SELECT k, v FROM ", kTable,
+                                 " WHERE k >= @k AND k < @k + ", num_rows));
+    SetKeyParam(RandomKey(num_rows), &request);
+    return DrainStream(stubs_->spanner->ExecuteStreamingSql(&ctx, request));
+  }
+
+  grpc::Status Dml() {
+    std::string transaction_id;
+    grpc::Status status = BeginReadWrite(stubs_, session_, &transaction_id);
+    if (!status.ok()) return status;
+    {
+      grpc::ClientContext ctx;
+      spanner_api::ExecuteSqlRequest request;
+      request.set_session(session_);
+      request.mutable_transaction()->set_id(transaction_id);
+      request.set_seqno(seqno_++);
+      request.set_sql(
+          absl::StrCat("UPDATE ", kTable, " SET v = 'dml' WHERE k = @k"));
+      SetKeyParam(RandomKey(), &request);
+      spanner_api::ResultSet response;
+      status = stubs_->spanner->ExecuteSql(&ctx, request, &response);
+      if (!status.ok()) return status;
+    }
+    return Commit(stubs_, session_, transaction_id);
+  }
+
+  grpc::Status BatchDml() {
+    std::string transaction_id;
+    grpc::Status status = BeginReadWrite(stubs_, session_, &transaction_id);
+    if (!status.ok()) return status;
+    {
+      grpc::ClientContext ctx;
+      spanner_api::ExecuteBatchDmlRequest request;
+      request.set_session(session_);
+      request.mutable_transaction()->set_id(transaction_id);
+      request.set_seqno(seqno_++);
+      for (int i = 0; i < absl::GetFlag(FLAGS_batch_size); ++i) {
+        auto* statement = request.add_statements();
+        statement->set_sql(absl::StrCat("UPDATE ", kTable,
+                                        " SET v = 'batch_dml' WHERE k = @k"));
+        SetKeyParam(RandomKey(), statement);
+      }
+      spanner_api::ExecuteBatchDmlResponse response;
+      status = stubs_->spanner->ExecuteBatchDml(&ctx, request, &response);
+      if (!status.ok()) return status;
+      if (response.status().code() != 0) {
+        return grpc::Status(
+            static_cast<grpc::StatusCode>(response.status().code()),
+            response.status().message());
+      }
+    }
+    return Commit(stubs_, session_, transaction_id);
+  }
+
+  grpc::Status Mutation() {
+    const int64_t num_rows = absl::GetFlag(FLAGS_batch_size);
+    const int64_t begin = RandomKey(num_rows);
+    spanner_api::CommitRequest request;
+    AddRows(begin, begin + num_rows, "mutation", &request);
+    return CommitSingleUse(stubs_, session_, std::move(request));
+  }
+
+  Stubs* stubs_;
+  const std::string session_;
+  int64_t seqno_ = 1;
+  absl::BitGen gen_;
+};
+
+// Parses --mix into the cumulative weights of kOps.
+std::vector<int> ParseMix(absl::string_view mix) {
+  absl::flat_hash_map<std::string, int> weights;
+  for (absl::string_view entry : absl::StrSplit(mix, ',', absl::SkipEmpty())) {
+    std::pair<std::string, std::string> parts = absl::StrSplit(entry, '=');
+    int weight = 0;
+    ZETASQL_CHECK(absl::SimpleAtoi(parts.second, &weight) && weight >= 0)
+        << "Invalid weight in --mix: " << entry;
+    weights[parts.first] = weight;
+  }
+  std::vector<int> cumulative;
+  int total = 0;
+  for (const OpInfo& info : kOps) {
+    total += weights[info.name];
+    weights.erase(info.name);
+    cumulative.push_back(total);
+  }
+  ZETASQL_CHECK(weights.empty()) << "Unknown operation in --mix: "
+                         << weights.begin()->first;
+  ZETASQL_CHECK(total > 0) << "--mix must have at least one positive weight";
+  return cumulative;
+}
+
+void RunSession(Stubs* stubs, const std::vector<int>& cumulative_weights,
+                absl::Time deadline, Stats* stats) {
+  std::string session;
+  CheckOk(CreateSession(stubs, &session), "CreateSession");
+  SessionDriver driver(stubs, std::move(session));
+  absl::BitGen gen;
+  while (absl::Now() < deadline) {
+    const int r = absl::Uniform<int>(gen, 0, cumulative_weights.back());
+    const int i = std::upper_bound(cumulative_weights.begin(),
+                                   cumulative_weights.end(), r) -
+                  cumulative_weights.begin();
+    const absl::Time start = absl::Now();
+    const grpc::Status status = driver.Run(kOps[i].op);
+    OpStats& op_stats = (*stats)[kOps[i].name];
+    op_stats.latencies.push_back(absl::Now() - start);
+    if (!status.ok()) ++op_stats.errors;
+  }
+}
+
+// Repeatedly reads the change stream from the current time for one second.
+void RunChangeStreamReader(Stubs* stubs, absl::Time deadline, Stats* stats) {
+  std::string session;
+  CheckOk(CreateSession(stubs, &session), "CreateSession");
+  while (absl::Now() < deadline) {
+    grpc::ClientContext ctx;
+    spanner_api::ExecuteSqlRequest request;
+    request.set_session(session);
+    request.set_sql(absl::StrCat("SELECT ChangeRecord FROM READ_",
+                                 kChangeStream, "(@start, @end, NULL, 1000)"));
+    const absl::Time start = absl::Now();
+    auto& fields = *request.mutable_params()->mutable_fields();
+    fields["start"] = StringValue(absl::FormatTime(start, absl::UTCTimeZone()));
+    fields["end"] = StringValue(
+        absl::FormatTime(start + absl::Seconds(1), absl::UTCTimeZone()));
+    (*request.mutable_param_types())["start"].set_code(spanner_api::TIMESTAMP);
+    (*request.mutable_param_types())["end"].set_code(spanner_api::TIMESTAMP);
+    const grpc::Status status =
+        DrainStream(stubs->spanner->ExecuteStreamingSql(&ctx, request));
+    OpStats& op_stats = (*stats)[kChangeStreamOpName];
+    op_stats.latencies.push_back(absl::Now() - start);
+    if (!status.ok()) ++op_stats.errors;
+  }
+}
+
+void PrintReport(Stats stats, absl::Duration elapsed) {
+  absl::PrintF("%-14s %10s %8s %10s %10s %10s %10s\n", "operation", "count",
+               "errors", "ops/s", "p50 ms", "p99 ms", "max ms");
+  std::vector<std::string> names;
+  for (const auto& [name, op_stats] : stats) {
+    names.push_back(name);
+  }
+  std::sort(names.begin(), names.end());
+  for (const std::string& name : names) {
+    std::vector<absl::Duration>& latencies = stats[name].latencies;
+    if (latencies.empty()) continue;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+      return absl::ToDoubleMilliseconds(
+          latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+    };
+    absl::PrintF("%-14s %10d %8d %10.1f %10.2f %10.2f %10.2f\n", name,
+                 latencies.size(), stats[name].errors,
+                 latencies.size() / absl::ToDoubleSeconds(elapsed),
+                 percentile(0.5), percentile(0.99), percentile(1.0));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  std::unique_ptr<Server> server;
+  std::thread server_thread;
+  std::string endpoint = absl::GetFlag(FLAGS_endpoint);
+  if (endpoint.empty()) {
+    Server::Options options;
+    options.server_address = "localhost:0";
+    server = Server::Create(options);
+    ZETASQL_CHECK(server != nullptr) << "Failed to start gRPC server.";
+    endpoint = absl::StrCat(server->host(), ":", server->port());
+    server_thread = std::thread([&server]() { server->WaitForShutdown(); });
+  }
+
+  Stubs stubs(
+      grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials()));
+  SetUpDatabase(&stubs);
+  const std::vector<int> cumulative_weights =
+      ParseMix(absl::GetFlag(FLAGS_mix));
+
+  const int num_sessions = absl::GetFlag(FLAGS_sessions);
+  const int num_readers = absl::GetFlag(FLAGS_change_stream_readers);
+  std::vector<Stats> thread_stats(num_sessions + num_readers);
+  std::vector<std::thread> threads;
+  const absl::Time start = absl::Now();
+  const absl::Time deadline = start + absl::GetFlag(FLAGS_duration);
+  for (int i = 0; i < num_sessions; ++i) {
+    threads.emplace_back(RunSession, &stubs, std::cref(cumulative_weights),
+                         deadline, &thread_stats[i]);
+  }
+  for (int i = 0; i < num_readers; ++i) {
+    threads.emplace_back(RunChangeStreamReader, &stubs, deadline,
+                         &thread_stats[num_sessions + i]);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+
+  Stats stats;
+  int64_t errors = 0;
+  for (const Stats& s : thread_stats) {
+    for (const auto& [name, op_stats] : s) {
+      stats[name].Merge(op_stats);
+      errors += op_stats.errors;
+    }
+  }
+  PrintReport(std::move(stats), elapsed);
+
+  if (server != nullptr) {
+    server->Shutdown();
+    server_thread.join();
+  }
+  return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Replays a trace of RPCs recorded by an emulator started with
+// --rpc_trace_file and reports how the replay compares to the recording.
+//
+// By default the trace is replayed against a fresh emulator server started
+// in-process. Point it at a running emulator instead with --endpoint, e.g.
+//   bazel run -c opt //binaries:rpc_replay_main -- \
+//     --trace_file=/tmp/rpcs.trace --endpoint=localhost:9010 --speedup=2
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "zetasql/base/logging.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "frontend/proto/rpc_trace.pb.h"
+#include "frontend/server/rpc_recorder.h"
+#include "frontend/server/rpc_replayer.h"
+#include "frontend/server/server.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+
+ABSL_FLAG(std::string, trace_file, "",
+          "Path of the RPC trace to replay, as written by an emulator started "
+          "with --rpc_trace_file.");
+
+ABSL_FLAG(std::string, endpoint, "",
+          "Address of the emulator to replay the trace against. If empty, a "
+          "fresh emulator server is started in-process.");
+
+ABSL_FLAG(double, speedup, 1,
+          "Replay RPCs this many times faster than they were recorded. 0 "
+          "sends each RPC as soon as the RPCs it depends on have finished.");
+
+ABSL_FLAG(int, max_concurrent_rpcs, 64, "The most RPCs in flight at once.");
+
+using Server = ::google::spanner::emulator::frontend::Server;
+using RpcRecorder = ::google::spanner::emulator::frontend::RpcRecorder;
+using RpcReplayer = ::google::spanner::emulator::frontend::RpcReplayer;
+using RpcTraceEntry = ::google::spanner::emulator::frontend::RpcTraceEntry;
+
+namespace {
+
+double Percentile(std::vector<absl::Duration> latencies, double p) {
+  if (latencies.empty()) return 0;
+  std::sort(latencies.begin(), latencies.end());
+  return absl::ToDoubleMilliseconds(
+      latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+}
+
+void PrintReport(const RpcReplayer::Result& result) {
+  absl::PrintF("recorded %s, replayed %s\n\n",
+               absl::FormatDuration(result.recorded_elapsed),
+               absl::FormatDuration(result.replayed_elapsed));
+  absl::PrintF("%-40s %8s %10s %12s %12s %12s %12s\n", "method", "count",
+               "mismatches", "rec p50 ms", "p50 ms", "p99 ms", "max ms");
+  for (const auto& [name, stats] : result.methods) {
+    absl::PrintF("%-40s %8d %10d %12.2f %12.2f %12.2f %12.2f\n", name,
+                 stats.replayed_latencies.size(), stats.status_mismatches,
+                 Percentile(stats.recorded_latencies, 0.5),
+                 Percentile(stats.replayed_latencies, 0.5),
+                 Percentile(stats.replayed_latencies, 0.99),
+                 Percentile(stats.replayed_latencies, 1.0));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const std::string trace_file = absl::GetFlag(FLAGS_trace_file);
+  ZETASQL_CHECK(!trace_file.empty()) << "--trace_file is required.";
+  std::vector<RpcTraceEntry> entries;
+  absl::Status status =
+      RpcRecorder::ReadTrace(trace_file, [&entries](const RpcTraceEntry& e) {
+        entries.push_back(e);
+        return absl::OkStatus();
+      });
+  ZETASQL_CHECK(status.ok())
+      << "Failed to read " << trace_file << ": " << status;
+
+  std::unique_ptr<Server> server;
+  std::thread server_thread;
+  std::string endpoint = absl::GetFlag(FLAGS_endpoint);
+  if (endpoint.empty()) {
+    Server::Options options;
+    options.server_address = "localhost:0";
+    server = Server::Create(options);
+    ZETASQL_CHECK(server != nullptr) << "Failed to start gRPC server.";
+    endpoint = absl::StrCat(server->host(), ":", server->port());
+    server_thread = std::thread([&server]() { server->WaitForShutdown(); });
+  }
+
+  RpcReplayer::Options options;
+  options.speedup = absl::GetFlag(FLAGS_speedup);
+  options.max_concurrent_rpcs = absl::GetFlag(FLAGS_max_concurrent_rpcs);
+  RpcReplayer replayer(
+      grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials()),
+      options);
+  PrintReport(replayer.Replay(std::move(entries)));
+
+  if (server != nullptr) {
+    server->Shutdown();
+    server_thread.join();
+  }
+  return 0;
+}
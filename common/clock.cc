@@ -16,7 +16,10 @@
 
 #include "common/clock.h"
 
+#include <time.h>
+
 #include <algorithm>
+#include <cstdint>
 
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
@@ -27,27 +30,31 @@ namespace emulator {
 
 namespace {
 
-// Returns the current time at microsecond granularity.
-absl::Time NowMicros() {
-  return absl::FromUnixMicros(absl::ToUnixMicros(absl::Now()));
-}
+// Returns the current time in unix micros.
+int64_t NowMicros() { return absl::ToUnixMicros(absl::Now()); }
 
 }  // namespace
 
-Clock::Clock()
-    : last_system_time_(NowMicros()), last_dispensed_time_(last_system_time_) {}
+Clock::Clock() : last_dispensed_micros_(NowMicros()) {}
 
 absl::Time Clock::Now() {
-  absl::MutexLock lock(&mu_);
-
-  absl::Time now = NowMicros();
-  absl::Time next_dispensed_time =
-      last_dispensed_time_ +
-      std::max(absl::Microseconds(1), now - last_system_time_);
-  last_system_time_ = now;
-  last_dispensed_time_ = next_dispensed_time;
+  const int64_t now = NowMicros();
+  int64_t last_dispensed = last_dispensed_micros_.load();
+  int64_t next_dispensed;
+  do {
+    next_dispensed = std::max(last_dispensed + 1, now);
+  } while (
+      !last_dispensed_micros_.compare_exchange_weak(last_dispensed,
+                                                     next_dispensed));
+  return absl::FromUnixMicros(next_dispensed);
+}
 
-  return last_dispensed_time_;
+absl::Duration ThreadCpuTime() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return absl::ZeroDuration();
+  }
+  return absl::DurationFromTimespec(ts);
 }
 
 }  // namespace emulator
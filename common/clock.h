@@ -17,7 +17,9 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_CLOCK_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_CLOCK_H_
 
-#include "absl/synchronization/mutex.h"
+#include <atomic>
+#include <cstdint>
+
 #include "absl/time/time.h"
 
 namespace google {
@@ -37,25 +39,27 @@ namespace emulator {
 //   This is to conform with Cloud Spanner's commit timestamps which also
 //   operate at microsecond resolution.
 //
+// `Now()` returns the system time, unless that is not later than the last
+// value returned, in which case it returns one microsecond after the last
+// value. Values are dispensed with a compare-and-swap rather than a lock, so
+// concurrent callers do not serialize on the clock.
+//
 // This class is thread safe.
 class Clock {
  public:
   Clock();
 
   // Returns the current time.
-  absl::Time Now() ABSL_LOCKS_EXCLUDED(mu_);
+  absl::Time Now();
 
  private:
-  // Mutex to guard state below.
-  absl::Mutex mu_;
-
-  // The last value we got from the system clock.
-  absl::Time last_system_time_ ABSL_GUARDED_BY(mu_);
-
-  // The last value we handed out in a call to Clock::Now().
-  absl::Time last_dispensed_time_ ABSL_GUARDED_BY(mu_);
+  // The last value we handed out in a call to Clock::Now(), in unix micros.
+  std::atomic<int64_t> last_dispensed_micros_;
 };
 
+// Returns the CPU time used so far by the calling thread.
+absl::Duration ThreadCpuTime();
+
 }  // namespace emulator
 }  // namespace spanner
 }  // namespace google
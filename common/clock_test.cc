@@ -16,10 +16,15 @@
 
 #include "common/clock.h"
 
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/time/time.h"
 
 namespace google {
 namespace spanner {
@@ -28,6 +33,15 @@ namespace frontend {
 
 namespace {
 
+TEST(ThreadCpuTime, IncreasesWhileTheThreadRuns) {
+  const absl::Duration start = ThreadCpuTime();
+  absl::Duration now = start;
+  while (now == start) {
+    now = ThreadCpuTime();
+  }
+  EXPECT_GT(now, start);
+}
+
 TEST(Clock, ClockReturnsIncreasingValues) {
   Clock clock;
   absl::Time t1 = clock.Now();
@@ -42,6 +56,30 @@ TEST(Clock, ClockReturnsValuesAtMicrosecondGranularity) {
   EXPECT_EQ(t1, absl::FromUnixMicros(absl::ToUnixMicros(t1)));
 }
 
+TEST(Clock, ConcurrentCallersGetDistinctIncreasingValues) {
+  Clock clock;
+  constexpr int kNumThreads = 8;
+  constexpr int kNumCalls = 1000;
+  std::vector<std::vector<absl::Time>> values(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&clock, &thread_values = values[i]]() {
+      for (int j = 0; j < kNumCalls; ++j) {
+        thread_values.push_back(clock.Now());
+      }
+    });
+  }
+  std::vector<absl::Time> all_values;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads[i].join();
+    EXPECT_TRUE(std::is_sorted(values[i].begin(), values[i].end()));
+    all_values.insert(all_values.end(), values[i].begin(), values[i].end());
+  }
+  std::sort(all_values.begin(), all_values.end());
+  EXPECT_EQ(std::adjacent_find(all_values.begin(), all_values.end()),
+            all_values.end());
+}
+
 }  // namespace
 
 }  // namespace frontend
@@ -16,17 +16,151 @@
 
 #include "common/config.h"
 
+#include <cstdint>
 #include <string>
 
 #include "absl/flags/flag.h"
+#include "absl/time/time.h"
 
 ABSL_FLAG(std::string, host_port, "localhost:10007",
           "Emulator host IP and port that serves Cloud Spanner gRPC requests.");
 
+ABSL_FLAG(std::string, unix_socket_path, "",
+          "If set, the emulator also serves gRPC requests on a Unix domain "
+          "socket at this path, which clients on the same host can reach at "
+          "unix:<path> without the overhead of loopback TCP.");
+
+ABSL_FLAG(int, grpc_completion_queues, 0,
+          "Number of completion queues polled by the gRPC server for new "
+          "requests. 0 uses one completion queue per core.");
+
+ABSL_FLAG(int, grpc_min_pollers, 0,
+          "Minimum number of threads polling each gRPC completion queue. 0 "
+          "uses the gRPC default.");
+
+ABSL_FLAG(int, grpc_max_pollers, 0,
+          "Maximum number of threads polling each gRPC completion queue. 0 "
+          "uses the gRPC default.");
+
+ABSL_FLAG(int, grpc_max_threads, 0,
+          "Maximum number of threads the gRPC server uses to run requests, "
+          "including long-lived streaming reads, queries and change stream "
+          "queries. Requests beyond this limit are rejected with "
+          "RESOURCE_EXHAUSTED. 0 does not limit the number of threads.");
+
+ABSL_FLAG(int, database_shards, 0,
+          "If positive, the emulator starts this many worker processes, each "
+          "owning the databases whose URI hashes to it, and forwards every "
+          "request received at host_port to the worker owning its database. "
+          "Each worker has its own heap and threads, and a worker which exits, "
+          "for example after running out of memory, is restarted without "
+          "affecting the databases of the others. Instance changes are sent "
+          "to every worker.");
+
+ABSL_FLAG(int, database_shard_index, -1,
+          "Set on the worker processes started for --database_shards to the "
+          "index of the shard each of them owns. Not meant to be set by "
+          "hand.");
+
+ABSL_FLAG(int, database_scheduler_slots, 0,
+          "If positive, at most this many RPCs run against databases at once, "
+          "and RPCs beyond it queue per database. Queued RPCs are admitted "
+          "so that each busy database gets a share of the execution time in "
+          "proportion to its weight. 0 runs every RPC as soon as it "
+          "arrives.");
+
+ABSL_FLAG(int, database_max_concurrent_rpcs, 0,
+          "If positive, at most this many RPCs run against each database at "
+          "once, and RPCs beyond it queue until one finishes. 0 does not "
+          "limit RPCs per database.");
+
+ABSL_FLAG(std::string, database_scheduler_weights, "",
+          "Comma separated list of <database_uri>=<weight> entries giving "
+          "databases a larger or smaller share of the execution time than "
+          "the default weight of 1, with --database_scheduler_slots.");
+
+ABSL_FLAG(int, admission_max_in_flight, 0,
+          "If positive, at most this many RPCs run at once, and RPCs beyond "
+          "it wait for admission, with commits, point reads and session and "
+          "transaction management admitted before queries and scans. 0 "
+          "admits every RPC as soon as it arrives.");
+
+ABSL_FLAG(int, admission_max_queued, 100,
+          "Maximum number of RPCs waiting for admission, with "
+          "--admission_max_in_flight. RPCs arriving to a full queue are "
+          "rejected with RESOURCE_EXHAUSTED.");
+
+ABSL_FLAG(absl::Duration, admission_max_queue_wait, absl::Seconds(10),
+          "How long an RPC waits for admission, with "
+          "--admission_max_in_flight, before it is rejected with "
+          "RESOURCE_EXHAUSTED.");
+
+ABSL_FLAG(int, session_worker_threads, 0,
+          "If positive, RPCs addressed to a session run on one of this many "
+          "worker threads, chosen by the session, so that the RPCs of a "
+          "session keep finding its state in the caches of the same core. "
+          "An RPC whose worker is busy for more than a millisecond runs on "
+          "the gRPC thread which received it instead. 0 runs every RPC on "
+          "the gRPC thread which received it.");
+
+ABSL_FLAG(bool, enable_resource_accounting, false,
+          "If true, the CPU time, request and response bytes, rows scanned, "
+          "mutations and lock hold time of RPCs are summed per database, "
+          "session and caller, and served at /resourceusage with "
+          "--metrics_host_port.");
+
+ABSL_FLAG(std::string, resource_accounting_caller_label, "",
+          "With --enable_resource_accounting, the key of the session label "
+          "whose value names the caller that RPCs of the session are "
+          "accounted to.");
+
+ABSL_FLAG(int64_t, grpc_compression_threshold_bytes, 0,
+          "If positive, gRPC response messages of at least this many bytes "
+          "are compressed when the client accepts a compressed encoding "
+          "(gzip or deflate). Smaller messages are always sent uncompressed. "
+          "0 disables response compression.");
+
+ABSL_FLAG(std::string, metrics_host_port, "",
+          "If set, the emulator serves per-RPC and per-stage latency "
+          "histograms in the Prometheus text format over HTTP at "
+          "http://<metrics_host_port>/metrics, CPU profiles in the pprof "
+          "format at /debug/pprof/profile?seconds=N and malloc heap "
+          "statistics at /debug/heap.");
+
+ABSL_FLAG(std::string, rpc_trace_file, "",
+          "If set, every RPC handled by the emulator is appended to this file "
+          "with its request, timing and status, for replaying with "
+          "//binaries:rpc_replay_main. The file is replaced if it exists.");
+
+ABSL_FLAG(std::string, trace_export_file, "",
+          "If set, requests which carry a sampled W3C traceparent header are "
+          "traced, and their spans are appended to this file in the "
+          "OTLP/JSON format read by the OpenTelemetry collector's "
+          "otlpjsonfile receiver.");
+
+ABSL_FLAG(bool, count_allocations, false,
+          "If true, the allocations made by the handler of each RPC are "
+          "counted per method, exported as the emulator_rpc_allocations "
+          "metric and set on the span of the RPC.");
+
+ABSL_FLAG(absl::Duration, slow_rpc_threshold, absl::ZeroDuration(),
+          "If positive, every RPC running for at least this long is logged "
+          "as a single line of JSON with its method, database, SQL "
+          "fingerprint or read shape, rows scanned and returned, and the "
+          "time spent in each stage, such as session lookup, lock waits, "
+          "query analysis and evaluation, and commit flush.");
+
 ABSL_FLAG(bool, log_requests, false,
           "If true, gRPC request and response messages are streamed to the "
           "INFO log. This switch is intended for emulator debugging.");
 
+ABSL_FLAG(int, log_requests_sampling_interval, 1,
+          "With --log_requests, only one in every this many RPCs is logged.");
+
+ABSL_FLAG(int64_t, log_requests_max_bytes, 64 * 1024,
+          "With --log_requests, logged request and response messages are "
+          "truncated to this many bytes of text. 0 does not truncate.");
+
 ABSL_FLAG(
     bool, enable_fault_injection, false,
     "If true, the emulator will inject faults to allow testing application "
@@ -43,6 +177,210 @@ ABSL_FLAG(bool, disable_query_null_filtered_index_check, false,
           "to disable this check per query, instead of disabling this check "
           "for all the queries at once.");
 
+ABSL_FLAG(bool, use_compact_storage, false,
+          "If true, database rows are stored in a compact layout which keeps "
+          "all versions of a row contiguous in memory. This reduces memory "
+          "usage for large and wide tables.");
+
+ABSL_FLAG(bool, intern_string_values, false,
+          "If true, short STRING and BYTES values written to a database are "
+          "deduplicated, so that all rows holding the same value share one "
+          "copy of it. This reduces memory usage for columns with few "
+          "distinct values. Has no effect with use_compact_storage.");
+
+ABSL_FLAG(int64_t, database_memory_quota_mb, 0,
+          "If positive, commits which write to a database fail with "
+          "RESOURCE_EXHAUSTED while the rows of the database use more than "
+          "this many megabytes of memory. Commits which only delete rows are "
+          "still accepted. Has no effect with use_compact_storage or "
+          "disk_storage_dir.");
+
+ABSL_FLAG(int, key_access_sampling_interval, 0,
+          "If positive, one in this many key reads and writes of each "
+          "database is sampled into a per-minute heatmap of the accessed key "
+          "ranges of each table, served as JSON on /keyheatmap of the metrics "
+          "server. Has no effect with use_compact_storage or "
+          "disk_storage_dir.");
+
+ABSL_FLAG(bool, cluster_interleaved_tables, false,
+          "If true, the rows of interleaved tables are stored together with "
+          "the rows of their parent tables in a single ordered keyspace, so "
+          "that scans and cascading deletes of a parent and its children are "
+          "a single contiguous walk. Has no effect with use_compact_storage.");
+
+ABSL_FLAG(bool, enable_row_level_locking, false,
+          "If true, read-write transactions lock individual rows and key "
+          "ranges instead of the whole database, so that transactions which "
+          "do not conflict can run concurrently. Conflicts are resolved using "
+          "wound-wait based on transaction age.");
+
+ABSL_FLAG(bool, enable_optimistic_concurrency, false,
+          "If true, read-write transactions do not lock the rows they read or "
+          "write. Instead, the key ranges they access are validated when they "
+          "commit, and they are aborted only if another transaction committed "
+          "a write to a key range they read. Takes precedence over "
+          "enable_row_level_locking.");
+
+ABSL_FLAG(bool, enable_online_index_backfill, false,
+          "If true, schema changes made only of CREATE INDEX statements "
+          "return a pending operation and backfill the new indexes in the "
+          "background, in chunks of rows, so that transactions can commit "
+          "while the backfill runs. The indexes cannot be read from until the "
+          "operation is done.");
+
+ABSL_FLAG(int64_t, query_cache_size, 0,
+          "The maximum number of analyzed SQL statements cached per database. "
+          "Repeated statements with the same parameter types skip analysis "
+          "and preparation. Since cached statements are not re-validated, "
+          "changes to emulator feature flags may not apply to statements "
+          "which are already cached. 0 disables the cache.");
+
+ABSL_FLAG(int64_t, query_result_cache_size, 0,
+          "The maximum number of query results cached per database. Repeated "
+          "queries in read-only transactions which read the same state of "
+          "the database, i.e. at the same timestamp or with no commit since, "
+          "return the cached rows. Queries calling non-deterministic "
+          "functions or reading SPANNER_SYS tables are not cached. 0 disables "
+          "the cache.");
+
+ABSL_FLAG(int64_t, query_spill_memory_mb, 0,
+          "If positive, queries which sort or group the rows of a single "
+          "table by columns of it, such as SELECT ... FROM t ORDER BY c or "
+          "SELECT c, COUNT(*) FROM t GROUP BY c, are executed outside the "
+          "ZetaSQL evaluator, and keep at most this many megabytes of rows in "
+          "memory. Larger inputs are sorted in runs which are written to "
+          "temporary files in query_spill_dir and merged. 0 evaluates these "
+          "queries fully in memory.");
+
+ABSL_FLAG(std::string, query_spill_dir, "/tmp",
+          "The directory in which queries spill rows which do not fit in "
+          "query_spill_memory_mb. The files are removed as soon as they are "
+          "created, and their space is released once the query's result has "
+          "been read.");
+
+ABSL_FLAG(int64_t, query_memory_limit_mb, 0,
+          "If positive, the number of megabytes which a single query may hold "
+          "in its materialized result rows, the intermediate values of its "
+          "evaluation and the protos its rows are converted to. Queries "
+          "which need more fail with RESOURCE_EXHAUSTED. 0 does not limit the "
+          "memory of queries, whose peak is still reported in PROFILE mode.");
+
+ABSL_FLAG(absl::Duration, version_gc_interval, absl::Minutes(10),
+          "How often each database discards row versions which are older than "
+          "the stale read limit and any change stream retention period. A "
+          "zero or negative interval keeps all versions forever.");
+
+ABSL_FLAG(absl::Duration, cold_version_age, absl::ZeroDuration(),
+          "Row versions superseded longer ago than this are compressed each "
+          "time versions are garbage collected, and decoded only by stale "
+          "reads which see them. A zero or negative age keeps every version "
+          "uncompressed.");
+
+ABSL_FLAG(int64_t, min_streaming_chunk_size, 0,
+          "If positive, streaming reads and queries start with chunks of this "
+          "many bytes, growing them up to the 1 MB limit while the client "
+          "keeps up and shrinking them while it falls behind. Otherwise "
+          "every chunk is up to 1 MB.");
+
+ABSL_FLAG(absl::Duration, idle_transaction_timeout, absl::Minutes(1),
+          "Read-write transactions which hold locks without making any "
+          "request for longer than this are aborted, so that a client which "
+          "abandons a transaction does not block other writers. A zero or "
+          "negative timeout never aborts idle transactions.");
+
+ABSL_FLAG(std::string, restore_snapshot, "",
+          "If set, instances and databases are restored on startup from the "
+          "snapshot file at this path, as written by --save_snapshot.");
+
+ABSL_FLAG(std::string, save_snapshot, "",
+          "If set, the emulator shuts down on SIGINT or SIGTERM and saves its "
+          "instances and databases to a snapshot file at this path. Only the "
+          "latest version of each row is saved.");
+
+ABSL_FLAG(std::string, bulk_load, "",
+          "Comma separated list of <database_uri>/tables/<table>=<csv_path> "
+          "entries. On startup, after any --restore_snapshot, the rows in each "
+          "CSV file are bulk loaded into the named table, which must exist and "
+          "be empty. The first line of each file names the columns.");
+
+ABSL_FLAG(std::string, export_dir, "",
+          "If set, a request to http://<metrics_host_port>/debug/export writes "
+          "the latest rows of every table of every database to "
+          "<export_dir>/<database_uri>/tables/<table>.csv, in the format "
+          "read by --bulk_load.");
+
+ABSL_FLAG(std::string, write_ahead_log_dir, "",
+          "If set, committed transactions, schema changes and bulk loads of "
+          "each database are appended to a log file in this directory, and "
+          "databases are recreated from their log files on startup. "
+          "--save_snapshot compacts the logs of the saved databases.");
+
+ABSL_FLAG(std::string, follow_write_ahead_log_dir, "",
+          "If set, the emulator serves read-only copies of the databases of "
+          "another emulator whose --write_ahead_log_dir is this directory, "
+          "applying the changes appended to their logs. Writes, schema "
+          "changes and new databases are rejected on the copies. Strong reads "
+          "first apply everything logged so far; stale reads may lag.");
+
+ABSL_FLAG(absl::Duration, follow_write_ahead_log_poll_interval,
+          absl::Milliseconds(100),
+          "How often --follow_write_ahead_log_dir is checked for new logs and "
+          "for records appended to the followed logs.");
+
+ABSL_FLAG(bool, write_ahead_log_fsync, true,
+          "If true, commits return only once their write ahead log record is "
+          "flushed to disk with fsync. Concurrent commits share one fsync. If "
+          "false, records only survive an emulator crash, not a machine "
+          "crash.");
+
+ABSL_FLAG(std::string, disk_storage_dir, "",
+          "If set, the databases named by --disk_storage_databases keep their "
+          "rows in a storage which spills large column values to a scratch "
+          "file in this directory instead of keeping them in memory.");
+
+ABSL_FLAG(std::string, disk_storage_databases, "*",
+          "Comma separated list of the IDs of the databases which use disk "
+          "storage when --disk_storage_dir is set, or * for all databases.");
+
+ABSL_FLAG(int64_t, disk_storage_cache_mb, 64,
+          "The maximum size in megabytes of the column values read back from "
+          "its scratch file that each disk storage database caches in "
+          "memory.");
+
+ABSL_FLAG(std::string, fixture_dir, "",
+          "If set, a database created with a fixture file in this directory, "
+          "as written by --save_fixtures, starts with the rows of the "
+          "fixture. They are read from the memory-mapped file, so emulators "
+          "on one host share its pages, and changes are kept in memory.");
+
+ABSL_FLAG(bool, save_fixtures, false,
+          "If true, the emulator shuts down on SIGINT or SIGTERM and writes "
+          "the latest version of the rows of each database to a fixture file "
+          "in --fixture_dir.");
+
+ABSL_FLAG(bool, lazy_snapshot_restore, false,
+          "If true, a database restored from a snapshot or write ahead log "
+          "decodes the rows of each table when the table is first read or "
+          "written, so that it can serve requests for some tables before "
+          "the rows of all of them are restored.");
+
+ABSL_FLAG(int, snapshot_hydration_threads, 1,
+          "The number of background threads per database restored with "
+          "--lazy_snapshot_restore which decode the rows of tables that "
+          "have not been accessed yet. 0 leaves them until they are.");
+
+ABSL_FLAG(int, commit_verification_threads, 8,
+          "The maximum number of threads checking the constraints of a "
+          "commit which writes at least 256 rows. 1 checks them on the "
+          "committing thread.");
+
+ABSL_FLAG(int64_t, schema_cache_size, 0,
+          "The maximum number of schemas built for CreateDatabase requests "
+          "that are cached for reuse by databases created later with the "
+          "same DDL statements. Since cached schemas are not re-validated, "
+          "changes to emulator feature flags may not apply to DDL which is "
+          "already cached. 0 disables the cache.");
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -50,8 +388,94 @@ namespace config {
 
 std::string grpc_host_port() { return absl::GetFlag(FLAGS_host_port); }
 
+std::string grpc_unix_socket_path() {
+  return absl::GetFlag(FLAGS_unix_socket_path);
+}
+
+int grpc_num_completion_queues() {
+  return absl::GetFlag(FLAGS_grpc_completion_queues);
+}
+
+int grpc_min_pollers() { return absl::GetFlag(FLAGS_grpc_min_pollers); }
+
+int grpc_max_pollers() { return absl::GetFlag(FLAGS_grpc_max_pollers); }
+
+int grpc_max_threads() { return absl::GetFlag(FLAGS_grpc_max_threads); }
+
+int database_shards() { return absl::GetFlag(FLAGS_database_shards); }
+
+int database_shard_index() {
+  return absl::GetFlag(FLAGS_database_shard_index);
+}
+
+int database_scheduler_slots() {
+  return absl::GetFlag(FLAGS_database_scheduler_slots);
+}
+
+int database_max_concurrent_rpcs() {
+  return absl::GetFlag(FLAGS_database_max_concurrent_rpcs);
+}
+
+std::string database_scheduler_weights() {
+  return absl::GetFlag(FLAGS_database_scheduler_weights);
+}
+
+int admission_max_in_flight() {
+  return absl::GetFlag(FLAGS_admission_max_in_flight);
+}
+
+int admission_max_queued() {
+  return absl::GetFlag(FLAGS_admission_max_queued);
+}
+
+absl::Duration admission_max_queue_wait() {
+  return absl::GetFlag(FLAGS_admission_max_queue_wait);
+}
+
+int session_worker_threads() {
+  return absl::GetFlag(FLAGS_session_worker_threads);
+}
+
+bool enable_resource_accounting() {
+  return absl::GetFlag(FLAGS_enable_resource_accounting);
+}
+
+std::string resource_accounting_caller_label() {
+  return absl::GetFlag(FLAGS_resource_accounting_caller_label);
+}
+
+int64_t grpc_compression_threshold_bytes() {
+  return absl::GetFlag(FLAGS_grpc_compression_threshold_bytes);
+}
+
+std::string metrics_host_port() {
+  return absl::GetFlag(FLAGS_metrics_host_port);
+}
+
+std::string rpc_trace_file() {
+  return absl::GetFlag(FLAGS_rpc_trace_file);
+}
+
+std::string trace_export_file() {
+  return absl::GetFlag(FLAGS_trace_export_file);
+}
+
+bool count_allocations() { return absl::GetFlag(FLAGS_count_allocations); }
+
+absl::Duration slow_rpc_threshold() {
+  return absl::GetFlag(FLAGS_slow_rpc_threshold);
+}
+
 bool should_log_requests() { return absl::GetFlag(FLAGS_log_requests); }
 
+int log_requests_sampling_interval() {
+  return absl::GetFlag(FLAGS_log_requests_sampling_interval);
+}
+
+int64_t log_requests_max_bytes() {
+  return absl::GetFlag(FLAGS_log_requests_max_bytes);
+}
+
 bool fault_injection_enabled() {
   return absl::GetFlag(FLAGS_enable_fault_injection);
 }
@@ -60,6 +484,122 @@ bool disable_query_null_filtered_index_check() {
   return absl::GetFlag(FLAGS_disable_query_null_filtered_index_check);
 }
 
+bool use_compact_storage() { return absl::GetFlag(FLAGS_use_compact_storage); }
+
+bool intern_string_values() {
+  return absl::GetFlag(FLAGS_intern_string_values);
+}
+
+int64_t database_memory_quota_bytes() {
+  return absl::GetFlag(FLAGS_database_memory_quota_mb) << 20;
+}
+
+int key_access_sampling_interval() {
+  return absl::GetFlag(FLAGS_key_access_sampling_interval);
+}
+
+bool cluster_interleaved_tables() {
+  return absl::GetFlag(FLAGS_cluster_interleaved_tables);
+}
+
+bool enable_row_level_locking() {
+  return absl::GetFlag(FLAGS_enable_row_level_locking);
+}
+
+bool enable_optimistic_concurrency() {
+  return absl::GetFlag(FLAGS_enable_optimistic_concurrency);
+}
+
+bool enable_online_index_backfill() {
+  return absl::GetFlag(FLAGS_enable_online_index_backfill);
+}
+
+int64_t query_cache_size() { return absl::GetFlag(FLAGS_query_cache_size); }
+
+int64_t query_result_cache_size() {
+  return absl::GetFlag(FLAGS_query_result_cache_size);
+}
+
+int64_t query_spill_memory_bytes() {
+  return absl::GetFlag(FLAGS_query_spill_memory_mb) << 20;
+}
+
+std::string query_spill_dir() { return absl::GetFlag(FLAGS_query_spill_dir); }
+
+int64_t query_memory_limit_bytes() {
+  return absl::GetFlag(FLAGS_query_memory_limit_mb) << 20;
+}
+
+absl::Duration version_gc_interval() {
+  return absl::GetFlag(FLAGS_version_gc_interval);
+}
+
+absl::Duration cold_version_age() {
+  return absl::GetFlag(FLAGS_cold_version_age);
+}
+
+int64_t min_streaming_chunk_size() {
+  return absl::GetFlag(FLAGS_min_streaming_chunk_size);
+}
+
+absl::Duration idle_transaction_timeout() {
+  return absl::GetFlag(FLAGS_idle_transaction_timeout);
+}
+
+std::string restore_snapshot_path() {
+  return absl::GetFlag(FLAGS_restore_snapshot);
+}
+
+std::string save_snapshot_path() { return absl::GetFlag(FLAGS_save_snapshot); }
+
+std::string bulk_load_files() { return absl::GetFlag(FLAGS_bulk_load); }
+
+std::string export_dir() { return absl::GetFlag(FLAGS_export_dir); }
+
+std::string write_ahead_log_dir() {
+  return absl::GetFlag(FLAGS_write_ahead_log_dir);
+}
+
+std::string follow_write_ahead_log_dir() {
+  return absl::GetFlag(FLAGS_follow_write_ahead_log_dir);
+}
+
+absl::Duration follow_write_ahead_log_poll_interval() {
+  return absl::GetFlag(FLAGS_follow_write_ahead_log_poll_interval);
+}
+
+bool write_ahead_log_fsync() {
+  return absl::GetFlag(FLAGS_write_ahead_log_fsync);
+}
+
+std::string disk_storage_dir() { return absl::GetFlag(FLAGS_disk_storage_dir); }
+
+std::string disk_storage_databases() {
+  return absl::GetFlag(FLAGS_disk_storage_databases);
+}
+
+int64_t disk_storage_cache_bytes() {
+  return absl::GetFlag(FLAGS_disk_storage_cache_mb) << 20;
+}
+
+std::string fixture_dir() { return absl::GetFlag(FLAGS_fixture_dir); }
+
+bool save_fixtures() { return absl::GetFlag(FLAGS_save_fixtures); }
+
+bool lazy_snapshot_restore() {
+  return absl::GetFlag(FLAGS_lazy_snapshot_restore);
+}
+
+int snapshot_hydration_threads() {
+  return absl::GetFlag(FLAGS_snapshot_hydration_threads);
+}
+
+int commit_verification_threads() {
+  return absl::GetFlag(FLAGS_commit_verification_threads);
+}
+
+int64_t schema_cache_size() { return absl::GetFlag(FLAGS_schema_cache_size); }
+
 }  // namespace config
 }  // namespace emulator
 }  // namespace spanner
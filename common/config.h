@@ -17,8 +17,11 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_CONFIG_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_CONFIG_H_
 
+#include <cstdint>
 #include <string>
 
+#include "absl/time/time.h"
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -27,9 +30,97 @@ namespace config {
 // The address at which the emulator will serve gRPC requests.
 std::string grpc_host_port();
 
+// The path of a Unix domain socket on which the emulator will also serve gRPC
+// requests, or empty if it only serves them at grpc_host_port().
+std::string grpc_unix_socket_path();
+
+// The number of completion queues polled by the gRPC server. 0 uses the gRPC
+// default of one per core.
+int grpc_num_completion_queues();
+
+// The minimum and maximum number of threads polling each gRPC completion queue
+// for new requests. 0 uses the gRPC default.
+int grpc_min_pollers();
+int grpc_max_pollers();
+
+// The maximum number of threads the gRPC server uses to run requests. 0 does
+// not limit the number of threads.
+int grpc_max_threads();
+
+// The number of worker processes databases are spread over, or 0 to serve all
+// databases in this process.
+int database_shards();
+
+// The shard owned by this process if it is one of the workers started for
+// database_shards(), or -1 otherwise.
+int database_shard_index();
+
+// The maximum number of RPCs running against databases at once, above which
+// RPCs queue for a weighted fair share of execution time. 0 disables queueing.
+int database_scheduler_slots();
+
+// The maximum number of RPCs running against each database at once. 0 does not
+// limit RPCs per database.
+int database_max_concurrent_rpcs();
+
+// Comma separated list of <database_uri>=<weight> entries setting the share of
+// database_scheduler_slots given to each database.
+std::string database_scheduler_weights();
+
+// The maximum number of RPCs the emulator runs at once, above which RPCs wait
+// for admission. 0 admits every RPC right away.
+int admission_max_in_flight();
+
+// The maximum number of RPCs waiting for admission, above which RPCs are
+// rejected with RESOURCE_EXHAUSTED.
+int admission_max_queued();
+
+// How long an RPC waits for admission before it is rejected with
+// RESOURCE_EXHAUSTED.
+absl::Duration admission_max_queue_wait();
+
+// The number of worker threads which the RPCs of sessions are dispatched to
+// by session. 0 runs RPCs on the gRPC threads which receive them.
+int session_worker_threads();
+
+// If true, the CPU time, bytes, rows scanned, mutations and lock hold time of
+// RPCs are summed per database, session and caller.
+bool enable_resource_accounting();
+
+// The session label whose value identifies the caller of an RPC for resource
+// accounting. Empty accounts no callers.
+std::string resource_accounting_caller_label();
+
+// The size in bytes at and above which gRPC responses are compressed for
+// clients that accept a compressed encoding. 0 disables compression.
+int64_t grpc_compression_threshold_bytes();
+
+// If non-empty, the address at which the emulator serves latency histograms
+// in the Prometheus text format over HTTP, at /metrics.
+std::string metrics_host_port();
+
+// If non-empty, the file to which every RPC is recorded for replaying.
+std::string rpc_trace_file();
+
+// If non-empty, the file to which the spans of traced requests are exported.
+std::string trace_export_file();
+
+// If true, the allocations made by the handler of each RPC are counted per
+// method.
+bool count_allocations();
+
+// RPCs running for at least this long are logged with the time spent in each
+// of their stages. 0 logs no RPCs.
+absl::Duration slow_rpc_threshold();
+
 // If true, gRPC requests and response messages are streamed to the INFO log.
 bool should_log_requests();
 
+// With should_log_requests, one in every log_requests_sampling_interval RPCs
+// is logged, and each message is truncated to log_requests_max_bytes of text.
+int log_requests_sampling_interval();
+int64_t log_requests_max_bytes();
+
 // Returns true if fault injection is enabled.
 bool fault_injection_enabled();
 
@@ -45,6 +136,141 @@ bool fault_injection_enabled();
 // once.
 bool disable_query_null_filtered_index_check();
 
+// If true, databases use CompactInMemoryStorage which keeps all versions of a
+// row in a single contiguous vector instead of a map per cell.
+bool use_compact_storage();
+
+// If true, InMemoryStorage interns STRING and BYTES values as they are
+// written, see ValueInterner.
+bool intern_string_values();
+
+// The memory quota of each database using InMemoryStorage, or zero or less if
+// databases have no quota.
+int64_t database_memory_quota_bytes();
+
+// One in this many key accesses of each database using InMemoryStorage is
+// sampled into its key access heatmap, or zero or less if none are.
+int key_access_sampling_interval();
+
+// If true, InMemoryStorage stores each interleave hierarchy in the keyspace of
+// its root table, with child rows placed directly after their parent rows.
+bool cluster_interleaved_tables();
+
+// If true, read-write transactions acquire row and key range locks instead of
+// a database-wide lock, allowing non-conflicting transactions to run
+// concurrently.
+bool enable_row_level_locking();
+
+// If true, read-write transactions validate the key ranges they read when they
+// commit instead of acquiring locks.
+bool enable_optimistic_concurrency();
+
+// If true, UpdateDatabaseDdl operations made only of CREATE INDEX statements
+// return once the indexes are created, and backfill them in the background
+// without blocking writes to the database.
+bool enable_online_index_backfill();
+
+// The maximum number of analyzed SQL statements each database caches for
+// reuse by later executions of the same statement. 0 disables the cache.
+int64_t query_cache_size();
+
+// The maximum number of query results each database caches for read-only
+// transactions which read the same state of the database. 0 disables the
+// cache.
+int64_t query_result_cache_size();
+
+// If positive, the number of bytes of rows which ORDER BY and GROUP BY queries
+// of a single table keep in memory before spilling them to files in
+// query_spill_dir(). 0 evaluates these queries fully in memory.
+int64_t query_spill_memory_bytes();
+std::string query_spill_dir();
+
+// If positive, the number of bytes of result rows, evaluator intermediate
+// values and converted protos a single query may hold before it fails with
+// RESOURCE_EXHAUSTED. 0 does not limit the memory of queries.
+int64_t query_memory_limit_bytes();
+
+// How often each database discards row versions which can no longer be read.
+// A zero or negative interval disables version garbage collection.
+absl::Duration version_gc_interval();
+
+// How long ago a row version must have been superseded before it is kept
+// compressed, see Storage::CompressVersions. A zero or negative age disables
+// compression.
+absl::Duration cold_version_age();
+
+// If positive, the size in bytes of the first chunk of streaming reads and
+// queries, whose later chunks adapt to how fast the client consumes them, see
+// StreamingChunkSizer.
+int64_t min_streaming_chunk_size();
+
+// How long a read-write transaction may hold locks without making a request
+// before it is aborted. A zero or negative timeout disables the check.
+absl::Duration idle_transaction_timeout();
+
+// If non-empty, the emulator restores instances and databases from the snapshot
+// file at this path on startup.
+std::string restore_snapshot_path();
+
+// If non-empty, the emulator saves its instances and databases to a snapshot
+// file at this path when it is asked to exit with SIGINT or SIGTERM.
+std::string save_snapshot_path();
+
+// Comma separated list of <database_uri>/tables/<table>=<csv_path> entries
+// whose rows are bulk loaded into empty tables on startup.
+std::string bulk_load_files();
+
+// If non-empty, the directory which the metrics server's /debug/export page
+// exports the tables of every database to as CSV files.
+std::string export_dir();
+
+// If non-empty, the directory holding a write ahead log file per database, from
+// which databases are recreated on startup.
+std::string write_ahead_log_dir();
+
+// If non-empty, the write ahead log directory of another emulator whose
+// databases this emulator serves read-only copies of.
+std::string follow_write_ahead_log_dir();
+
+// How often the followed write ahead log directory is polled for changes.
+absl::Duration follow_write_ahead_log_poll_interval();
+
+// Whether commits wait for their write ahead log record to be fsynced.
+bool write_ahead_log_fsync();
+
+// If non-empty, the directory in which databases selected by
+// disk_storage_databases create the scratch file of their DiskStorage.
+std::string disk_storage_dir();
+
+// Comma separated list of the IDs of the databases which use DiskStorage, or
+// "*" for all databases.
+std::string disk_storage_databases();
+
+// The size of the cache of spilled values of each DiskStorage.
+int64_t disk_storage_cache_bytes();
+
+// If non-empty, the directory of the fixtures new databases are created with.
+std::string fixture_dir();
+
+// If true, the emulator writes a fixture of each database to fixture_dir when
+// it is asked to exit with SIGINT or SIGTERM.
+bool save_fixtures();
+
+// If true, the rows of databases restored from snapshots are decoded into
+// storage per table, when each table is first accessed.
+bool lazy_snapshot_restore();
+
+// The number of threads per lazily restored database decoding the rows of the
+// tables which have not been accessed yet.
+int snapshot_hydration_threads();
+
+// The maximum number of threads verifying the constraints of a large commit.
+int commit_verification_threads();
+
+// The maximum number of schemas the database manager caches for databases
+// created with the same DDL statements. 0 disables the cache.
+int64_t schema_cache_size();
+
 }  // namespace config
 }  // namespace emulator
 }  // namespace spanner
@@ -42,6 +42,12 @@ absl::Status Internal(absl::string_view msg) {
   return absl::Status(absl::StatusCode::kInternal, msg);
 }
 
+absl::Status StreamClosedByClient() {
+  return absl::Status(absl::StatusCode::kCancelled,
+                      "The client closed the stream before all results were "
+                      "sent.");
+}
+
 absl::Status CycleDetected(absl::string_view object_type,
                            absl::string_view cycle) {
   return absl::Status(absl::StatusCode::kFailedPrecondition,
@@ -178,6 +184,34 @@ absl::Status TooManyDatabasesPerInstance(absl::string_view instance_uri) {
           "more information."));
 }
 
+absl::Status DatabaseMemoryQuotaExceeded(int64_t used_bytes,
+                                         int64_t quota_bytes) {
+  return absl::Status(
+      absl::StatusCode::kResourceExhausted,
+      absl::StrCat("Database uses an estimated ", used_bytes,
+                   " bytes of memory, which exceeds its quota of ",
+                   quota_bytes,
+                   " bytes. Deleted rows free their memory once their "
+                   "versions are garbage collected."));
+}
+
+absl::Status FollowerDatabaseIsReadOnly(absl::string_view uri) {
+  return absl::Status(
+      absl::StatusCode::kFailedPrecondition,
+      absl::StrCat("Database ", uri,
+                   " is a read-only copy of a database of the emulator whose "
+                   "write ahead log this emulator follows. Send writes and "
+                   "schema changes to that emulator instead."));
+}
+
+absl::Status FollowerDatabaseReloading(absl::string_view uri) {
+  return absl::Status(
+      absl::StatusCode::kUnavailable,
+      absl::StrCat("The write ahead log of database ", uri,
+                   " was replaced or removed, and the database is being "
+                   "reloaded from it. Retry with a new session."));
+}
+
 absl::Status InvalidDatabaseName(absl::string_view database_id) {
   return absl::Status(
       absl::StatusCode::kInvalidArgument,
@@ -455,6 +489,43 @@ absl::Status AbortConcurrentTransaction(int64_t requestor_id,
                    ". The emulator only supports one transaction at a time."));
 }
 
+absl::Status AbortWoundedTransaction(int64_t wounded_id, int64_t requestor_id) {
+  return absl::Status(
+      absl::StatusCode::kAborted,
+      absl::StrCat("Transaction ", wounded_id,
+                   " aborted due to a conflicting lock request from older "
+                   "transaction ",
+                   requestor_id, "."));
+}
+
+absl::Status AbortLockWaitTimeout(int64_t requestor_id,
+                                  absl::Duration timeout) {
+  return absl::Status(
+      absl::StatusCode::kAborted,
+      absl::StrCat("Transaction ", requestor_id,
+                   " aborted after waiting more than ",
+                   absl::FormatDuration(timeout),
+                   " for conflicting locks to be released."));
+}
+
+absl::Status AbortIdleTransaction(int64_t transaction_id,
+                                  absl::Duration idle_time) {
+  return absl::Status(
+      absl::StatusCode::kAborted,
+      absl::StrCat("Transaction ", transaction_id, " aborted after being idle "
+                   "for ", absl::FormatDuration(idle_time),
+                   " while holding locks."));
+}
+
+absl::Status AbortOptimisticConflict(int64_t transaction_id,
+                                     int64_t writer_id) {
+  return absl::Status(
+      absl::StatusCode::kAborted,
+      absl::StrCat("Transaction ", transaction_id,
+                   " aborted because data it read was modified by transaction ",
+                   writer_id, " before it could commit."));
+}
+
 absl::Status TransactionNotFound(backend::TransactionID id) {
   return absl::Status(
       absl::StatusCode::kNotFound,
@@ -1756,6 +1827,25 @@ absl::Status IndexTableDoesNotMatchBaseTable(absl::string_view base_table,
                    "'."));
 }
 
+absl::Status IndexNotReadable(absl::string_view index) {
+  return absl::Status(
+      absl::StatusCode::kFailedPrecondition,
+      absl::StrCat("Index '", index,
+                   "' cannot be read from until its backfill has completed."));
+}
+
+absl::Status OnlineIndexBackfillCancelled(absl::string_view index) {
+  return absl::Status(
+      absl::StatusCode::kCancelled,
+      absl::StrCat("The backfill of index '", index, "' was cancelled."));
+}
+
+absl::Status IndexBackfillInProgress(absl::string_view index) {
+  return absl::Status(
+      absl::StatusCode::kFailedPrecondition,
+      absl::StrCat("Index '", index, "' is still being backfilled."));
+}
+
 absl::Status IndexNotFound(absl::string_view index, absl::string_view table) {
   return absl::Status(absl::StatusCode::kNotFound,
                       absl::StrCat("No index '", index,
@@ -2298,6 +2388,29 @@ absl::Status ReadOnlyTransactionDoesNotSupportDml(
           transaction_type));
 }
 
+absl::Status QueryCancelled() {
+  return absl::Status(absl::StatusCode::kCancelled,
+                      "The query was cancelled by the client.");
+}
+
+absl::Status QueryDeadlineExceeded() {
+  return absl::Status(absl::StatusCode::kDeadlineExceeded,
+                      "The query did not complete before the deadline of its "
+                      "request.");
+}
+
+absl::Status SumOverflow() {
+  return absl::Status(absl::StatusCode::kOutOfRange,
+                      "int64 overflow in SUM aggregation.");
+}
+
+absl::Status QueryMemoryLimitExceeded(int64_t limit_bytes) {
+  return absl::Status(
+      absl::StatusCode::kResourceExhausted,
+      absl::StrCat("The query needed more than its memory limit of ",
+                   limit_bytes, " bytes to execute."));
+}
+
 // Unsupported query shape errors.
 absl::Status UnsupportedReturnStructAsColumn() {
   return absl::Status(
@@ -2554,6 +2667,11 @@ absl::Status InvalidPartitionToken() {
                       "Invalid partition token.");
 }
 
+absl::Status InvalidResumeToken() {
+  return absl::Status(absl::StatusCode::kInvalidArgument,
+                      "Invalid resume token.");
+}
+
 absl::Status ReadFromDifferentSession() {
   return absl::Status(
       absl::StatusCode::kInvalidArgument,
@@ -2763,6 +2881,118 @@ absl::Status WithViewsAreNotSupported() {
   return absl::Status(absl::StatusCode::kInvalidArgument,
                       "WITH clauses are unsupported in view definitions.");
 }
+
+absl::Status BulkLoadIntoIndex(absl::string_view index_name) {
+  return absl::Status(
+      absl::StatusCode::kInvalidArgument,
+      absl::Substitute("Rows cannot be bulk loaded into index $0. Index "
+                       "entries are computed from the rows of the indexed "
+                       "table.",
+                       index_name));
+}
+
+absl::Status BulkLoadTableNotEmpty(absl::string_view table_name) {
+  return absl::Status(
+      absl::StatusCode::kFailedPrecondition,
+      absl::Substitute("Cannot bulk load rows into table $0 because it "
+                       "already contains rows.",
+                       table_name));
+}
+
+absl::Status BulkLoadMissingKeyColumn(absl::string_view table_name,
+                                      absl::string_view column_name) {
+  return absl::Status(
+      absl::StatusCode::kInvalidArgument,
+      absl::Substitute("Bulk load for table $0 is missing key column $1.",
+                       table_name, column_name));
+}
+
+absl::Status BulkLoadRowSizeMismatch(absl::string_view table_name,
+                                     int num_values, int num_columns) {
+  return absl::Status(
+      absl::StatusCode::kInvalidArgument,
+      absl::Substitute("Bulk load row for table $0 has $1 values, expected $2.",
+                       table_name, num_values, num_columns));
+}
+
+absl::Status InvalidBulkLoadSpec(absl::string_view spec) {
+  return absl::Status(
+      absl::StatusCode::kInvalidArgument,
+      absl::Substitute("Invalid bulk load file $0. Expected "
+                       "<database_uri>/tables/<table_name>=<csv_path>.",
+                       spec));
+}
+
+absl::Status InvalidBulkLoadCsv(absl::string_view path, int record,
+                                absl::string_view reason) {
+  return absl::Status(
+      absl::StatusCode::kInvalidArgument,
+      absl::Substitute("Invalid CSV record $0 in bulk load file $1: $2",
+                       record, path, reason));
+}
+
+absl::Status BulkLoadUnsupportedColumnType(absl::string_view table_name,
+                                           absl::string_view column_name,
+                                           absl::string_view type) {
+  return absl::Status(
+      absl::StatusCode::kUnimplemented,
+      absl::Substitute("Column $0.$1 of type $2 cannot be bulk loaded from a "
+                       "CSV file.",
+                       table_name, column_name, type));
+}
+
+absl::Status InvalidDatabaseSchedulerWeight(absl::string_view entry) {
+  return absl::Status(
+      absl::StatusCode::kInvalidArgument,
+      absl::Substitute("Invalid database scheduler weight $0. Expected "
+                       "<database_uri>=<weight> with a positive weight.",
+                       entry));
+}
+
+absl::Status DatabaseQueueDeadlineExceeded(absl::string_view database_uri) {
+  return absl::Status(
+      absl::StatusCode::kDeadlineExceeded,
+      absl::Substitute("Deadline exceeded while queued behind other requests "
+                       "to database $0.",
+                       database_uri));
+}
+
+absl::Status DatabaseQueueCancelled(absl::string_view database_uri) {
+  return absl::Status(
+      absl::StatusCode::kCancelled,
+      absl::Substitute("The request was cancelled by the client while queued "
+                       "behind other requests to database $0.",
+                       database_uri));
+}
+
+absl::Status AdmissionQueueFull(int in_flight, int queued) {
+  return absl::Status(
+      absl::StatusCode::kResourceExhausted,
+      absl::Substitute("The emulator is overloaded: $0 requests are running "
+                       "and $1 are queued. Retry the request later.",
+                       in_flight, queued));
+}
+
+absl::Status AdmissionQueueTimeout(absl::Duration max_queue_wait) {
+  return absl::Status(
+      absl::StatusCode::kResourceExhausted,
+      absl::StrCat("The emulator is overloaded: the request was queued for "
+                   "more than ",
+                   absl::FormatDuration(max_queue_wait),
+                   ". Retry the request later."));
+}
+
+absl::Status AdmissionQueueDeadlineExceeded() {
+  return absl::Status(absl::StatusCode::kDeadlineExceeded,
+                      "Deadline exceeded while queued behind other requests "
+                      "to the emulator.");
+}
+
+absl::Status AdmissionQueueCancelled() {
+  return absl::Status(absl::StatusCode::kCancelled,
+                      "The request was cancelled by the client while queued "
+                      "behind other requests to the emulator.");
+}
 }  // namespace error
 }  // namespace emulator
 }  // namespace spanner
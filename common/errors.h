@@ -35,6 +35,7 @@ namespace error {
 absl::Status Internal(absl::string_view msg);
 absl::Status CycleDetected(absl::string_view object_type,
                            absl::string_view cycle);
+absl::Status StreamClosedByClient();
 
 // Project errors.
 absl::Status InvalidProjectURI(absl::string_view uri);
@@ -62,6 +63,10 @@ absl::Status InvalidCreateDatabaseStatement(absl::string_view statement);
 absl::Status UpdateDatabaseMissingStatements();
 absl::Status TooManyDatabasesPerInstance(absl::string_view instance_uri);
 absl::Status InvalidDatabaseName(absl::string_view database_id);
+absl::Status DatabaseMemoryQuotaExceeded(int64_t used_bytes,
+                                         int64_t quota_bytes);
+absl::Status FollowerDatabaseIsReadOnly(absl::string_view uri);
+absl::Status FollowerDatabaseReloading(absl::string_view uri);
 
 // Operation errors.
 absl::Status InvalidOperationId(absl::string_view id);
@@ -119,6 +124,12 @@ absl::Status MutationTableRequired();
 
 // Transaction errors.
 absl::Status AbortConcurrentTransaction(int64_t requestor_id, int64_t holder_id);
+absl::Status AbortWoundedTransaction(int64_t wounded_id, int64_t requestor_id);
+absl::Status AbortLockWaitTimeout(int64_t requestor_id, absl::Duration timeout);
+absl::Status AbortIdleTransaction(int64_t transaction_id,
+                                  absl::Duration idle_time);
+absl::Status AbortOptimisticConflict(int64_t transaction_id,
+                                     int64_t writer_id);
 absl::Status TransactionNotFound(backend::TransactionID id);
 absl::Status TransactionClosed(backend::TransactionID id);
 absl::Status InvalidTransactionID(backend::TransactionID id);
@@ -438,6 +449,12 @@ absl::Status IndexTableDoesNotMatchBaseTable(absl::string_view base_table,
 
 absl::Status IndexNotFound(absl::string_view index, absl::string_view table);
 
+absl::Status IndexNotReadable(absl::string_view index);
+
+absl::Status OnlineIndexBackfillCancelled(absl::string_view index);
+
+absl::Status IndexBackfillInProgress(absl::string_view index);
+
 absl::Status ColumnNotFoundInIndex(absl::string_view index,
                                    absl::string_view indexed_table,
                                    absl::string_view column);
@@ -577,6 +594,10 @@ absl::Status ExecuteBatchDmlOnlySupportsDmlStatements(int index,
                                                       absl::string_view query);
 absl::Status ReadOnlyTransactionDoesNotSupportDml(
     absl::string_view transaction_type);
+absl::Status QueryCancelled();
+absl::Status QueryDeadlineExceeded();
+absl::Status SumOverflow();
+absl::Status QueryMemoryLimitExceeded(int64_t limit_bytes);
 // Unsupported query shape errors.
 absl::Status UnsupportedReturnStructAsColumn();
 absl::Status UnsupportedArrayConstructorSyntaxForEmptyStructArray();
@@ -619,6 +640,7 @@ absl::Status QueryStringTooLong(int query_length, int max_length);
 absl::Status InvalidBytesPerBatch(absl::string_view message_name);
 absl::Status InvalidMaxPartitionCount(absl::string_view message_name);
 absl::Status InvalidPartitionToken();
+absl::Status InvalidResumeToken();
 absl::Status ReadFromDifferentSession();
 absl::Status ReadFromDifferentTransaction();
 absl::Status ReadFromDifferentParameters();
@@ -672,6 +694,31 @@ absl::Status InvalidDropDependentViews(absl::string_view type_kind,
                                        absl::string_view dependent_views);
 absl::Status WithViewsAreNotSupported();
 
+// Bulk load errors.
+absl::Status BulkLoadIntoIndex(absl::string_view index_name);
+absl::Status BulkLoadTableNotEmpty(absl::string_view table_name);
+absl::Status BulkLoadMissingKeyColumn(absl::string_view table_name,
+                                      absl::string_view column_name);
+absl::Status BulkLoadRowSizeMismatch(absl::string_view table_name,
+                                     int num_values, int num_columns);
+absl::Status InvalidBulkLoadSpec(absl::string_view spec);
+absl::Status InvalidBulkLoadCsv(absl::string_view path, int record,
+                                absl::string_view reason);
+absl::Status BulkLoadUnsupportedColumnType(absl::string_view table_name,
+                                           absl::string_view column_name,
+                                           absl::string_view type);
+
+// Database scheduler errors.
+absl::Status InvalidDatabaseSchedulerWeight(absl::string_view entry);
+absl::Status DatabaseQueueDeadlineExceeded(absl::string_view database_uri);
+absl::Status DatabaseQueueCancelled(absl::string_view database_uri);
+
+// Admission control errors.
+absl::Status AdmissionQueueFull(int in_flight, int queued);
+absl::Status AdmissionQueueTimeout(absl::Duration max_queue_wait);
+absl::Status AdmissionQueueDeadlineExceeded();
+absl::Status AdmissionQueueCancelled();
+
 }  // namespace error
 }  // namespace emulator
 }  // namespace spanner
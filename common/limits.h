@@ -38,6 +38,9 @@ constexpr int64_t kMaxGRPCErrorMessageLength = 1024;
 // Maximum number of outstanding transactions per session.
 constexpr int kMaxTransactionsPerSession = 32;
 
+// Maximum number of outstanding transactions per multiplexed session.
+constexpr int kMaxTransactionsPerMultiplexedSession = 4096;
+
 // Maximum number of tables per database.
 constexpr int kMaxTablesPerDatabase = 2560;
 
@@ -119,6 +122,14 @@ constexpr int kMaxStringColumnLength = (kMaxBytesColumnLength / 4);  // 2621440
 // pieces, each no larger than this limit.
 constexpr int64_t kMaxStreamingChunkSize = 1024 * 1024;  // 1 MB
 
+// Size of each partition returned by PartitionRead when the request does not
+// set partition_options.partition_size_bytes.
+constexpr int64_t kDefaultPartitionSizeBytes = 1024 * 1024 * 1024;  // 1 GB
+
+// Maximum number of partitions returned by PartitionRead when the request does
+// not set partition_options.max_partitions.
+constexpr int64_t kDefaultMaxPartitions = 10000;
+
 // Maximum size of a key in bytes.
 constexpr int kMaxKeySizeBytes = 8 * 1024;  // 8 KB
 
@@ -128,6 +139,11 @@ constexpr int kMaxQueryStringSize = 1024 * 1024;  // 1 K
 // Maximum depth of column expressions.
 constexpr int kColumnExpressionMaxDepth = 20;
 
+// Number of the most recent DML requests of a read-write transaction which are
+// remembered for replay. Clients only retry their latest requests, so older
+// requests are forgotten and rejected as out of order if they are sent again.
+constexpr int kMaxReplayableDmlRequests = 16;
+
 }  // namespace limits
 }  // namespace emulator
 }  // namespace spanner
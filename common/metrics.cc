@@ -0,0 +1,224 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "common/metrics.h"
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace metrics {
+
+namespace {
+
+// The upper bound of the first bucket, in seconds.
+constexpr double kFirstBucketUpperBound = 1e-5;
+
+// Identifies a histogram by metric name, label name and label value.
+using HistogramKey = std::tuple<std::string, std::string, std::string>;
+
+class HistogramRegistry {
+ public:
+  LatencyHistogram* Get(absl::string_view name, absl::string_view label_name,
+                        absl::string_view label_value) {
+    absl::MutexLock lock(&mu_);
+    std::unique_ptr<LatencyHistogram>& histogram =
+        histograms_[HistogramKey(std::string(name), std::string(label_name),
+                                 std::string(label_value))];
+    if (histogram == nullptr) {
+      histogram = std::make_unique<LatencyHistogram>();
+    }
+    return histogram.get();
+  }
+
+  std::string Export() {
+    absl::MutexLock lock(&mu_);
+    std::string out;
+    absl::string_view last_name;
+    for (const auto& [key, histogram] : histograms_) {
+      const auto& [name, label_name, label_value] = key;
+      if (name != last_name) {
+        absl::StrAppend(&out, "# TYPE ", name, " histogram\n");
+        last_name = name;
+      }
+      // Labels of the series, followed by a separator if there are any.
+      std::string labels;
+      if (!label_name.empty()) {
+        labels = absl::StrCat(label_name, "=\"", label_value, "\",");
+      }
+      int64_t cumulative_count = 0;
+      for (int i = 0; i <= LatencyHistogram::kNumBuckets; ++i) {
+        cumulative_count += histogram->BucketCount(i);
+        const std::string le =
+            i < LatencyHistogram::kNumBuckets
+                ? absl::StrCat(LatencyHistogram::BucketUpperBound(i))
+                : "+Inf";
+        absl::StrAppend(&out, name, "_bucket{", labels, "le=\"", le, "\"} ",
+                        cumulative_count, "\n");
+      }
+      if (!labels.empty()) {
+        labels.pop_back();
+        labels = absl::StrCat("{", labels, "}");
+      }
+      absl::StrAppend(&out, name, "_sum", labels, " ",
+                      absl::ToDoubleSeconds(histogram->Sum()), "\n");
+      absl::StrAppend(&out, name, "_count", labels, " ", cumulative_count,
+                      "\n");
+    }
+    return out;
+  }
+
+ private:
+  absl::Mutex mu_;
+
+  // Ordered so that all series of a metric are exported together.
+  std::map<HistogramKey, std::unique_ptr<LatencyHistogram>> histograms_
+      ABSL_GUARDED_BY(mu_);
+};
+
+HistogramRegistry* GetRegistry() {
+  static HistogramRegistry* registry = new HistogramRegistry();
+  return registry;
+}
+
+class GaugeRegistry {
+ public:
+  int64_t Register(absl::string_view name,
+                   std::vector<std::string> label_names,
+                   GaugeCallback callback) {
+    absl::MutexLock lock(&mu_);
+    int64_t id = next_id_++;
+    gauges_.emplace(id, Gauge{std::string(name), std::move(label_names),
+                              std::move(callback)});
+    return id;
+  }
+
+  void Unregister(int64_t id) {
+    absl::MutexLock lock(&mu_);
+    gauges_.erase(id);
+  }
+
+  // Callbacks are run with the registry locked, so Unregister returns only
+  // once no export is running the callback.
+  std::string Export() {
+    absl::MutexLock lock(&mu_);
+    std::map<std::string, std::vector<const Gauge*>> gauges_by_name;
+    for (const auto& [id, gauge] : gauges_) {
+      gauges_by_name[gauge.name].push_back(&gauge);
+    }
+    std::string out;
+    for (const auto& [name, gauges] : gauges_by_name) {
+      absl::StrAppend(&out, "# TYPE ", name, " gauge\n");
+      for (const Gauge* gauge : gauges) {
+        for (const GaugeSample& sample : gauge->callback()) {
+          std::string labels;
+          for (size_t i = 0; i < gauge->label_names.size() &&
+                          i < sample.label_values.size();
+               ++i) {
+            absl::StrAppend(&labels, labels.empty() ? "{" : ",",
+                            gauge->label_names[i], "=\"",
+                            sample.label_values[i], "\"");
+          }
+          if (!labels.empty()) {
+            labels.push_back('}');
+          }
+          absl::StrAppend(&out, name, labels, " ", sample.value, "\n");
+        }
+      }
+    }
+    return out;
+  }
+
+ private:
+  struct Gauge {
+    std::string name;
+    std::vector<std::string> label_names;
+    GaugeCallback callback;
+  };
+
+  absl::Mutex mu_;
+  int64_t next_id_ ABSL_GUARDED_BY(mu_) = 0;
+  std::map<int64_t, Gauge> gauges_ ABSL_GUARDED_BY(mu_);
+};
+
+GaugeRegistry* GetGaugeRegistry() {
+  static GaugeRegistry* registry = new GaugeRegistry();
+  return registry;
+}
+
+}  // namespace
+
+double LatencyHistogram::BucketUpperBound(int i) {
+  return std::ldexp(kFirstBucketUpperBound, i);
+}
+
+void LatencyHistogram::Record(absl::Duration latency) {
+  const double seconds = absl::ToDoubleSeconds(latency);
+  int bucket = 0;
+  while (bucket < kNumBuckets && seconds > BucketUpperBound(bucket)) {
+    ++bucket;
+  }
+  bucket_counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_nanos_.fetch_add(absl::ToInt64Nanoseconds(latency),
+                       std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::Count() const {
+  int64_t count = 0;
+  for (const auto& bucket_count : bucket_counts_) {
+    count += bucket_count.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+LatencyHistogram* GetLatencyHistogram(absl::string_view name,
+                                      absl::string_view label_name,
+                                      absl::string_view label_value) {
+  return GetRegistry()->Get(name, label_name, label_value);
+}
+
+int64_t RegisterGaugeCallback(absl::string_view name,
+                              std::vector<std::string> label_names,
+                              GaugeCallback callback) {
+  return GetGaugeRegistry()->Register(name, std::move(label_names),
+                                      std::move(callback));
+}
+
+void UnregisterGaugeCallback(int64_t id) { GetGaugeRegistry()->Unregister(id); }
+
+std::string ExportPrometheusText() {
+  return absl::StrCat(GetRegistry()->Export(), GetGaugeRegistry()->Export());
+}
+
+}  // namespace metrics
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,122 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_METRICS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace metrics {
+
+// LatencyHistogram counts durations in exponentially sized buckets.
+//
+// Bucket i counts durations of at most BucketUpperBound(i), with the last
+// bucket counting everything longer. Recording only touches atomic counters,
+// so histograms can be updated from hot paths without taking a lock.
+//
+// This class is thread safe.
+class LatencyHistogram {
+ public:
+  // The number of bounded buckets, spanning 10us to ~84s.
+  static constexpr int kNumBuckets = 24;
+
+  // Returns the inclusive upper bound of bucket i, in seconds.
+  static double BucketUpperBound(int i);
+
+  void Record(absl::Duration latency);
+
+  // Returns the number of durations recorded in bucket i, where bucket
+  // kNumBuckets holds the durations above every bound.
+  int64_t BucketCount(int i) const {
+    return bucket_counts_[i].load(std::memory_order_relaxed);
+  }
+
+  // Returns the total number of durations recorded.
+  int64_t Count() const;
+
+  // Returns the sum of all durations recorded.
+  absl::Duration Sum() const {
+    return absl::Nanoseconds(sum_nanos_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  std::array<std::atomic<int64_t>, kNumBuckets + 1> bucket_counts_{};
+  std::atomic<int64_t> sum_nanos_ = 0;
+};
+
+// Returns the histogram for the given metric name and label, creating it on
+// first use. Histograms are never destroyed, so callers on hot paths should
+// look them up once and keep the pointer.
+LatencyHistogram* GetLatencyHistogram(absl::string_view name,
+                                      absl::string_view label_name = "",
+                                      absl::string_view label_value = "");
+
+// A value of a gauge, with one label value per label name of its gauge.
+struct GaugeSample {
+  std::vector<std::string> label_values;
+  double value = 0;
+};
+
+using GaugeCallback = std::function<std::vector<GaugeSample>()>;
+
+// Registers a gauge whose samples are read from callback on every export, for
+// values which are cheaper to compute on demand than to keep up to date (e.g.
+// memory usage). Several callbacks may be registered for the same name, in
+// which case their samples are exported together. Returns an id for
+// UnregisterGaugeCallback, which must be called before anything used by the
+// callback is destroyed.
+int64_t RegisterGaugeCallback(absl::string_view name,
+                              std::vector<std::string> label_names,
+                              GaugeCallback callback);
+void UnregisterGaugeCallback(int64_t id);
+
+// Returns all histograms and gauges in the Prometheus text exposition format.
+std::string ExportPrometheusText();
+
+// Records the time between its construction and destruction in a histogram.
+class ScopedLatencyTimer {
+ public:
+  explicit ScopedLatencyTimer(LatencyHistogram* histogram)
+      : histogram_(histogram), start_(absl::Now()) {}
+  ~ScopedLatencyTimer() { histogram_->Record(absl::Now() - start_); }
+
+  ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+  ScopedLatencyTimer& operator=(const ScopedLatencyTimer&) = delete;
+
+ private:
+  LatencyHistogram* histogram_;
+  absl::Time start_;
+};
+
+}  // namespace metrics
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_METRICS_H_
@@ -0,0 +1,94 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "common/metrics.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace metrics {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+TEST(LatencyHistogramTest, RecordsIntoBucketByUpperBound) {
+  LatencyHistogram histogram;
+  histogram.Record(absl::Microseconds(5));
+  histogram.Record(absl::Microseconds(10));
+  histogram.Record(absl::Microseconds(15));
+  histogram.Record(absl::Hours(1));
+  EXPECT_EQ(histogram.BucketCount(0), 2);
+  EXPECT_EQ(histogram.BucketCount(1), 1);
+  EXPECT_EQ(histogram.BucketCount(LatencyHistogram::kNumBuckets), 1);
+  EXPECT_EQ(histogram.Count(), 4);
+  EXPECT_EQ(histogram.Sum(), absl::Microseconds(30) + absl::Hours(1));
+}
+
+TEST(LatencyHistogramTest, GetReturnsSameHistogramForSameLabels) {
+  LatencyHistogram* a = GetLatencyHistogram("test_get_seconds", "k", "a");
+  EXPECT_EQ(a, GetLatencyHistogram("test_get_seconds", "k", "a"));
+  EXPECT_NE(a, GetLatencyHistogram("test_get_seconds", "k", "b"));
+}
+
+TEST(LatencyHistogramTest, ExportsPrometheusText) {
+  GetLatencyHistogram("test_export_seconds", "method", "Read")
+      ->Record(absl::Microseconds(1));
+  GetLatencyHistogram("test_export_unlabeled_seconds")
+      ->Record(absl::Seconds(1000));
+  const std::string text = ExportPrometheusText();
+  EXPECT_THAT(text, HasSubstr("# TYPE test_export_seconds histogram\n"));
+  EXPECT_THAT(text,
+              HasSubstr("test_export_seconds_bucket{method=\"Read\","
+                        "le=\"1e-05\"} 1\n"));
+  EXPECT_THAT(text,
+              HasSubstr("test_export_seconds_count{method=\"Read\"} 1\n"));
+  EXPECT_THAT(text, HasSubstr("test_export_unlabeled_seconds_bucket{"
+                              "le=\"+Inf\"} 1\n"));
+  EXPECT_THAT(text, HasSubstr("test_export_unlabeled_seconds_sum 1000\n"));
+}
+
+TEST(GaugeTest, ExportsCallbackSamplesUntilUnregistered) {
+  int64_t id = RegisterGaugeCallback(
+      "test_gauge_bytes", {"database", "table"}, [] {
+        return std::vector<GaugeSample>{{{"db", "t1"}, 10}, {{"db", "t2"}, 20}};
+      });
+  std::string text = ExportPrometheusText();
+  EXPECT_THAT(text, HasSubstr("# TYPE test_gauge_bytes gauge\n"));
+  EXPECT_THAT(text,
+              HasSubstr("test_gauge_bytes{database=\"db\",table=\"t1\"} 10\n"));
+  EXPECT_THAT(text,
+              HasSubstr("test_gauge_bytes{database=\"db\",table=\"t2\"} 20\n"));
+
+  UnregisterGaugeCallback(id);
+  EXPECT_THAT(ExportPrometheusText(),
+              Not(HasSubstr("test_gauge_bytes")));
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,234 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "common/profiling.h"
+
+#include <execinfo.h>
+#include <malloc.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace profiling {
+
+namespace {
+
+// The deepest stack recorded for a sample, and the number of samples which a
+// profile holds. The samples take about 17MB while a profile is collected.
+constexpr int kMaxDepth = 32;
+constexpr int kMaxSamples = 1 << 16;
+
+// The frames of SIGPROF's handler and of the signal trampoline, which are at
+// the top of every stack sampled by the handler.
+constexpr int kSkippedFrames = 2;
+
+std::atomic<bool> allocation_counting_enabled = false;
+
+// Constant initialized, so that operator new can count allocations made before
+// the thread runs any dynamic initializers, or while it is destroyed.
+thread_local AllocationCount thread_allocations;
+
+struct Sample {
+  int depth;
+  void* pcs[kMaxDepth];
+};
+
+// The samples of the current profile, or nullptr if none is being collected.
+// Written by the signal handler, which cannot take locks.
+std::atomic<Sample*> samples = nullptr;
+std::atomic<int> num_samples = 0;
+
+// The number of signal handlers running, so that the samples are only freed
+// once none of them might still write to them.
+std::atomic<int> active_handlers = 0;
+
+absl::Mutex mu(absl::kConstInit);
+std::unique_ptr<Sample[]> profile_samples ABSL_GUARDED_BY(mu);
+int64_t sampling_period_us ABSL_GUARDED_BY(mu) = 0;
+bool handler_installed ABSL_GUARDED_BY(mu) = false;
+
+void HandleSigprof(int) {
+  active_handlers.fetch_add(1, std::memory_order_acquire);
+  Sample* sample_buffer = samples.load(std::memory_order_acquire);
+  if (sample_buffer != nullptr) {
+    const int i = num_samples.fetch_add(1, std::memory_order_relaxed);
+    if (i < kMaxSamples) {
+      const int saved_errno = errno;
+      sample_buffer[i].depth = backtrace(sample_buffer[i].pcs, kMaxDepth);
+      errno = saved_errno;
+    }
+  }
+  active_handlers.fetch_sub(1, std::memory_order_release);
+}
+
+void SetProfilingTimer(int64_t period_us) {
+  itimerval timer = {};
+  timer.it_interval.tv_sec = period_us / 1000000;
+  timer.it_interval.tv_usec = period_us % 1000000;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+void AppendWord(uintptr_t word, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&word), sizeof(word));
+}
+
+}  // namespace
+
+absl::Status StartCpuProfile(int frequency_hz) {
+  if (frequency_hz <= 0 || frequency_hz > 1000) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "CPU profiling frequency must be between 1 and 1000Hz, got ",
+        frequency_hz));
+  }
+  absl::MutexLock lock(&mu);
+  if (profile_samples != nullptr) {
+    return absl::FailedPreconditionError(
+        "A CPU profile is already being collected.");
+  }
+
+  // The first call to backtrace loads the unwinder, which allocates, so it is
+  // made here rather than in the signal handler.
+  void* pcs[1];
+  backtrace(pcs, 1);
+
+  profile_samples = std::make_unique<Sample[]>(kMaxSamples);
+  sampling_period_us = 1000000 / frequency_hz;
+  num_samples.store(0, std::memory_order_relaxed);
+  samples.store(profile_samples.get(), std::memory_order_release);
+
+  // The handler stays installed once the profile is stopped, as it does
+  // nothing without samples to write to, and a SIGPROF still pending when the
+  // timer is stopped would otherwise terminate the process.
+  if (!handler_installed) {
+    struct sigaction action = {};
+    action.sa_handler = HandleSigprof;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+    handler_installed = true;
+  }
+  SetProfilingTimer(sampling_period_us);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> StopCpuProfile() {
+  absl::MutexLock lock(&mu);
+  if (profile_samples == nullptr) {
+    return absl::FailedPreconditionError(
+        "No CPU profile is being collected.");
+  }
+  SetProfilingTimer(0);
+  samples.store(nullptr, std::memory_order_release);
+  while (active_handlers.load(std::memory_order_acquire) > 0) {
+  }
+  std::unique_ptr<Sample[]> collected = std::move(profile_samples);
+
+  // Identical stacks are recorded once with the number of their samples.
+  const int n =
+      std::min(num_samples.load(std::memory_order_relaxed), kMaxSamples);
+  absl::flat_hash_map<std::vector<uintptr_t>, int64_t> counts;
+  for (int i = 0; i < n; ++i) {
+    const Sample& sample = collected[i];
+    if (sample.depth <= kSkippedFrames) {
+      continue;
+    }
+    std::vector<uintptr_t> stack;
+    for (int j = kSkippedFrames; j < sample.depth; ++j) {
+      stack.push_back(reinterpret_cast<uintptr_t>(sample.pcs[j]));
+    }
+    ++counts[stack];
+  }
+
+  // The header is: header words, version, sampling period, padding.
+  std::string profile;
+  for (uintptr_t word : {uintptr_t{0}, uintptr_t{3}, uintptr_t{0},
+                         static_cast<uintptr_t>(sampling_period_us),
+                         uintptr_t{0}}) {
+    AppendWord(word, &profile);
+  }
+  for (const auto& [stack, count] : counts) {
+    AppendWord(count, &profile);
+    AppendWord(stack.size(), &profile);
+    for (uintptr_t pc : stack) {
+      AppendWord(pc, &profile);
+    }
+  }
+  // The trailer is a sample with no count and a single null frame.
+  for (uintptr_t word : {uintptr_t{0}, uintptr_t{1}, uintptr_t{0}}) {
+    AppendWord(word, &profile);
+  }
+  std::ifstream maps("/proc/self/maps");
+  std::stringstream mappings;
+  mappings << maps.rdbuf();
+  absl::StrAppend(&profile, mappings.str());
+  return profile;
+}
+
+std::string HeapStatsText() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  const struct mallinfo2 info = mallinfo2();
+  return absl::StrCat(
+      "arena_bytes ", info.arena, "\nmmap_bytes ", info.hblkhd,
+      "\nin_use_bytes ", info.uordblks + info.hblkhd, "\nfree_bytes ",
+      info.fordblks, "\nreleasable_bytes ", info.keepcost, "\n");
+#else
+  return "";
+#endif
+}
+
+void EnableAllocationCounting() {
+  allocation_counting_enabled.store(true, std::memory_order_relaxed);
+}
+
+bool AllocationCountingEnabled() {
+  return allocation_counting_enabled.load(std::memory_order_relaxed);
+}
+
+AllocationCount ThreadAllocationCount() { return thread_allocations; }
+
+void RecordAllocation(size_t size) {
+  if (!allocation_counting_enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  ++thread_allocations.allocations;
+  thread_allocations.bytes += size;
+}
+
+}  // namespace profiling
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,75 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_PROFILING_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_PROFILING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace profiling {
+
+// Starts sampling the stacks of the threads of the process which use CPU,
+// frequency_hz times per second of CPU time, using SIGPROF, whose handler is
+// left installed afterwards so that a late signal is ignored. Returns
+// FAILED_PRECONDITION if a profile is already being collected, as only one
+// profile can be collected at a time.
+absl::Status StartCpuProfile(int frequency_hz = 100);
+
+// Stops the profile started by StartCpuProfile and returns it in the legacy
+// gperftools CPU profile format, followed by the memory mappings of the
+// process, which is read by pprof. Samples beyond the capacity of the profile,
+// about eleven minutes of a single busy core at 100Hz, are dropped.
+// Returns FAILED_PRECONDITION if no profile is being collected.
+absl::StatusOr<std::string> StopCpuProfile();
+
+// Returns the statistics of the malloc heap of the process as text, one
+// "name value" line per statistic, or an empty string if the allocator does
+// not report any.
+std::string HeapStatsText();
+
+// The allocations made by a thread.
+struct AllocationCount {
+  int64_t allocations = 0;
+  int64_t bytes = 0;
+};
+
+// Starts counting the allocations made with operator new by each thread. The
+// allocations are only counted if the binary links the operator new
+// replacements of //common:allocation_hooks.
+void EnableAllocationCounting();
+bool AllocationCountingEnabled();
+
+// Returns the allocations counted so far on the calling thread.
+AllocationCount ThreadAllocationCount();
+
+// Counts an allocation of size bytes on the calling thread, if counting is
+// enabled. Called by the operator new replacements.
+void RecordAllocation(size_t size);
+
+}  // namespace profiling
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_PROFILING_H_
@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "common/profiling.h"
+
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace profiling {
+
+namespace {
+
+using ::testing::HasSubstr;
+
+// Returns the word at index i of a legacy CPU profile.
+uintptr_t Word(const std::string& profile, int i) {
+  uintptr_t word;
+  std::memcpy(&word, profile.data() + i * sizeof(word), sizeof(word));
+  return word;
+}
+
+TEST(ProfilingTest, CollectsSamplesInLegacyCpuProfileFormat) {
+  ASSERT_TRUE(StartCpuProfile(1000).ok());
+  // Spin for long enough to be sampled a few times.
+  volatile int64_t sum = 0;
+  const absl::Time end = absl::Now() + absl::Milliseconds(200);
+  while (absl::Now() < end) {
+    for (int i = 0; i < 1000; ++i) {
+      sum = sum + i;
+    }
+  }
+  absl::StatusOr<std::string> profile = StopCpuProfile();
+  ASSERT_TRUE(profile.ok());
+
+  ASSERT_GT(profile->size(), 5 * sizeof(uintptr_t));
+  EXPECT_EQ(Word(*profile, 0), 0);
+  EXPECT_EQ(Word(*profile, 1), 3);
+  EXPECT_EQ(Word(*profile, 2), 0);
+  EXPECT_EQ(Word(*profile, 3), 1000);
+  EXPECT_EQ(Word(*profile, 4), 0);
+  // At least one sample precedes the trailer, and the mappings follow it.
+  EXPECT_GT(Word(*profile, 5), 0);
+  EXPECT_THAT(*profile, HasSubstr("r-xp"));
+}
+
+TEST(ProfilingTest, CollectsOneProfileAtATime) {
+  EXPECT_EQ(StopCpuProfile().status().code(),
+            absl::StatusCode::kFailedPrecondition);
+  ASSERT_TRUE(StartCpuProfile().ok());
+  EXPECT_EQ(StartCpuProfile().code(), absl::StatusCode::kFailedPrecondition);
+  EXPECT_TRUE(StopCpuProfile().ok());
+}
+
+TEST(ProfilingTest, IgnoresSignalsAfterProfileStops) {
+  ASSERT_TRUE(StartCpuProfile().ok());
+  ASSERT_TRUE(StopCpuProfile().ok());
+  // A signal delivered once the profile stopped does not terminate the test.
+  raise(SIGPROF);
+}
+
+TEST(ProfilingTest, RejectsInvalidFrequencies) {
+  EXPECT_EQ(StartCpuProfile(0).code(), absl::StatusCode::kInvalidArgument);
+}
+
+TEST(ProfilingTest, CountsAllocationsOfThread) {
+  EnableAllocationCounting();
+  ASSERT_TRUE(AllocationCountingEnabled());
+  const AllocationCount before = ThreadAllocationCount();
+  // Called directly, as allocations of new expressions may be elided.
+  void* ptr = ::operator new(100);
+  ::operator delete(ptr);
+  const AllocationCount after = ThreadAllocationCount();
+  EXPECT_EQ(after.allocations - before.allocations, 1);
+  EXPECT_EQ(after.bytes - before.bytes, 100);
+}
+
+}  // namespace
+
+}  // namespace profiling
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,283 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "common/tracing.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace tracing {
+
+namespace {
+
+ABSL_CONST_INIT absl::Mutex exporter_mu(absl::kConstInit);
+std::atomic<bool> tracing_enabled = false;
+
+SpanExporter& Exporter() ABSL_EXCLUSIVE_LOCKS_REQUIRED(exporter_mu) {
+  static SpanExporter* exporter = new SpanExporter();
+  return *exporter;
+}
+
+// The innermost recording span of this thread, or null.
+thread_local ScopedSpan* current_span = nullptr;
+thread_local StageTimer* current_stage_timer = nullptr;
+
+bool IsLowerHex(absl::string_view s) {
+  for (char c : s) {
+    if (!absl::ascii_isdigit(c) && (c < 'a' || c > 'f')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsAllZeros(absl::string_view s) {
+  return s.find_first_not_of('0') == absl::string_view::npos;
+}
+
+std::string NewSpanId() {
+  thread_local absl::BitGen gen;
+  uint64_t id = 0;
+  while (id == 0) {
+    id = absl::Uniform<uint64_t>(gen);
+  }
+  return absl::StrFormat("%016x", id);
+}
+
+// Returns s quoted as a JSON string.
+std::string JsonString(absl::string_view s) {
+  std::string out = "\"";
+  for (char c : s) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&out, "\\u%04x", static_cast<int>(c));
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += "\"";
+  return out;
+}
+
+std::string JsonStringAttribute(absl::string_view key,
+                                absl::string_view value) {
+  return absl::StrCat("{\"key\":", JsonString(key),
+                      ",\"value\":{\"stringValue\":", JsonString(value), "}}");
+}
+
+void Export(const SpanData& span) {
+  absl::MutexLock lock(&exporter_mu);
+  if (Exporter()) {
+    Exporter()(span);
+  }
+}
+
+}  // namespace
+
+std::optional<SpanContext> SpanContext::FromTraceparent(
+    absl::string_view header) {
+  std::vector<absl::string_view> parts = absl::StrSplit(header, '-');
+  if (parts.size() < 4 || parts[0].size() != 2 || parts[1].size() != 32 ||
+      parts[2].size() != 16 || parts[3].size() != 2) {
+    return std::nullopt;
+  }
+  // Later versions may append fields, version 00 may not.
+  if (parts[0] == "ff" || (parts[0] == "00" && parts.size() != 4)) {
+    return std::nullopt;
+  }
+  for (int i = 0; i < 4; ++i) {
+    if (!IsLowerHex(parts[i])) {
+      return std::nullopt;
+    }
+  }
+  if (IsAllZeros(parts[1]) || IsAllZeros(parts[2])) {
+    return std::nullopt;
+  }
+  SpanContext context;
+  context.trace_id = std::string(parts[1]);
+  context.span_id = std::string(parts[2]);
+  // The sampled flag is the lowest bit of the flags.
+  const char flags = parts[3][1];
+  context.sampled =
+      ((absl::ascii_isdigit(flags) ? flags - '0' : flags - 'a' + 10) & 1) != 0;
+  return context;
+}
+
+std::string SpanContext::ToTraceparent() const {
+  return absl::StrCat("00-", trace_id, "-", span_id, sampled ? "-01" : "-00");
+}
+
+void SetSpanExporter(SpanExporter exporter) {
+  absl::MutexLock lock(&exporter_mu);
+  tracing_enabled.store(static_cast<bool>(exporter),
+                        std::memory_order_relaxed);
+  Exporter() = std::move(exporter);
+}
+
+absl::Status StartFileSpanExporter(const std::string& path) {
+  auto file = std::make_shared<std::ofstream>(path, std::ios::app);
+  if (!file->is_open()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Could not open trace export file ", path));
+  }
+  SetSpanExporter([file](const SpanData& span) {
+    *file << ToOtlpJson(span) << std::endl;
+  });
+  return absl::OkStatus();
+}
+
+bool TracingEnabled() {
+  return tracing_enabled.load(std::memory_order_relaxed);
+}
+
+std::string ToOtlpJson(const SpanData& span) {
+  std::vector<std::string> attributes;
+  attributes.reserve(span.attributes.size());
+  for (const auto& [key, value] : span.attributes) {
+    attributes.push_back(JsonStringAttribute(key, value));
+  }
+  std::string status = "{}";
+  if (!span.status.ok()) {
+    // STATUS_CODE_ERROR.
+    status = absl::StrCat("{\"code\":2,\"message\":",
+                          JsonString(span.status.ToString()), "}");
+  }
+  return absl::StrCat(
+      "{\"resourceSpans\":[{\"resource\":{\"attributes\":[",
+      JsonStringAttribute("service.name", "cloud-spanner-emulator"),
+      "]},\"scopeSpans\":[{\"scope\":{\"name\":\"cloud-spanner-emulator\"},"
+      "\"spans\":[{\"traceId\":",
+      JsonString(span.context.trace_id),
+      ",\"spanId\":", JsonString(span.context.span_id),
+      ",\"parentSpanId\":", JsonString(span.parent_span_id),
+      ",\"name\":", JsonString(span.name),
+      // SPAN_KIND_SERVER or SPAN_KIND_INTERNAL.
+      ",\"kind\":", span.server ? 2 : 1, ",\"startTimeUnixNano\":\"",
+      absl::ToUnixNanos(span.start_time), "\",\"endTimeUnixNano\":\"",
+      absl::ToUnixNanos(span.end_time), "\",\"attributes\":[",
+      absl::StrJoin(attributes, ","), "],\"status\":", status, "}]}]}]}");
+}
+
+ScopedSpan::ScopedSpan(absl::string_view name) {
+  if (current_stage_timer != nullptr) {
+    stage_timer_ = current_stage_timer;
+    stage_name_ = std::string(name);
+    stage_start_ = absl::Now();
+  }
+  if (current_span != nullptr) {
+    Start(name, current_span->data_->context);
+  }
+}
+
+ScopedSpan::ScopedSpan(absl::string_view name,
+                       const std::optional<SpanContext>& remote_parent) {
+  if (remote_parent.has_value() && remote_parent->sampled &&
+      TracingEnabled()) {
+    Start(name, *remote_parent);
+    data_->server = true;
+  }
+}
+
+void ScopedSpan::Start(absl::string_view name, const SpanContext& parent) {
+  data_ = std::make_unique<SpanData>();
+  data_->name = std::string(name);
+  data_->context.trace_id = parent.trace_id;
+  data_->context.span_id = NewSpanId();
+  data_->context.sampled = true;
+  data_->parent_span_id = parent.span_id;
+  data_->start_time = absl::Now();
+  previous_ = current_span;
+  current_span = this;
+}
+
+ScopedSpan::~ScopedSpan() {
+  if (stage_timer_ != nullptr) {
+    stage_timer_->Add(stage_name_, absl::Now() - stage_start_);
+  }
+  if (data_ == nullptr) {
+    return;
+  }
+  data_->end_time = absl::Now();
+  current_span = previous_;
+  Export(*data_);
+}
+
+void ScopedSpan::SetAttribute(absl::string_view key, absl::string_view value) {
+  if (data_ != nullptr) {
+    data_->attributes.emplace_back(std::string(key), std::string(value));
+  }
+}
+
+void ScopedSpan::SetStatus(const absl::Status& status) {
+  if (data_ != nullptr) {
+    data_->status = status;
+  }
+}
+
+StageTimer::StageTimer() : previous_(current_stage_timer) {
+  current_stage_timer = this;
+}
+
+StageTimer::~StageTimer() { current_stage_timer = previous_; }
+
+void StageTimer::Add(absl::string_view name, absl::Duration duration) {
+  for (auto& [stage, total] : stages_) {
+    if (stage == name) {
+      total += duration;
+      return;
+    }
+  }
+  stages_.emplace_back(std::string(name), duration);
+}
+
+}  // namespace tracing
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
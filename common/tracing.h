@@ -0,0 +1,172 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_TRACING_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_TRACING_H_
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace tracing {
+
+// The identity of a span, as propagated in a W3C traceparent header, e.g.
+// "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01".
+struct SpanContext {
+  // 32 lowercase hex digits.
+  std::string trace_id;
+
+  // 16 lowercase hex digits.
+  std::string span_id;
+
+  bool sampled = false;
+
+  // Returns the context of a traceparent header, or nullopt if the header is
+  // malformed.
+  static std::optional<SpanContext> FromTraceparent(absl::string_view header);
+
+  std::string ToTraceparent() const;
+};
+
+// A finished span.
+struct SpanData {
+  std::string name;
+  SpanContext context;
+
+  // Empty for a span without a parent.
+  std::string parent_span_id;
+
+  // Whether the span covers the handling of an RPC, as opposed to work done
+  // within one.
+  bool server = false;
+
+  absl::Time start_time;
+  absl::Time end_time;
+  std::vector<std::pair<std::string, std::string>> attributes;
+  absl::Status status;
+};
+
+using SpanExporter = std::function<void(const SpanData&)>;
+
+// Sets the function to which finished spans are passed, replacing any previous
+// one. An empty exporter disables tracing, which is the default. The exporter
+// may be called from any thread, but never concurrently.
+void SetSpanExporter(SpanExporter exporter);
+
+// Exports finished spans to the file at path, one OTLP/JSON
+// ExportTraceServiceRequest per line, as read by the OpenTelemetry
+// collector's otlpjsonfile receiver. The file is appended to.
+absl::Status StartFileSpanExporter(const std::string& path);
+
+// Returns true if an exporter is set.
+bool TracingEnabled();
+
+// Returns span as an OTLP/JSON ExportTraceServiceRequest on a single line.
+std::string ToOtlpJson(const SpanData& span);
+
+class StageTimer;
+
+// ScopedSpan records the time between its construction and destruction as a
+// span, and makes it the current span of its thread while it lives, so that
+// spans started further down the call stack, e.g. in the backend, become its
+// children.
+//
+// A span is only recorded if tracing is enabled and it has a sampled parent:
+// either the remote parent of the RPC it handles, or the current span of the
+// thread. Otherwise it costs a thread-local lookup. Work handed to other
+// threads is not traced. Spans are also timed by the current StageTimer of
+// their thread, if any, whether or not they are recorded.
+class ScopedSpan {
+ public:
+  // Starts a child of the current span of this thread, if any.
+  explicit ScopedSpan(absl::string_view name);
+
+  // Starts the server span of an RPC whose client sent remote_parent.
+  ScopedSpan(absl::string_view name,
+             const std::optional<SpanContext>& remote_parent);
+
+  ~ScopedSpan();
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+  // Returns true if this span is being recorded.
+  bool recording() const { return data_ != nullptr; }
+
+  void SetAttribute(absl::string_view key, absl::string_view value);
+  void SetStatus(const absl::Status& status);
+
+ private:
+  void Start(absl::string_view name, const SpanContext& parent);
+
+  // Null if this span is not recorded.
+  std::unique_ptr<SpanData> data_;
+
+  // The current span of the thread when this one started.
+  ScopedSpan* previous_ = nullptr;
+
+  // The timer to which the duration of this span is added, if any.
+  StageTimer* stage_timer_ = nullptr;
+  std::string stage_name_;
+  absl::Time stage_start_;
+};
+
+// StageTimer sums the time spent in the spans started on its thread while it
+// lives, by span name, so that the stages of a slow RPC can be reported
+// without recording traces. Spans nest, so the time of a span includes that
+// of the spans started within it. Timers nest too, the innermost timing the
+// spans started while it lives.
+class StageTimer {
+ public:
+  StageTimer();
+  ~StageTimer();
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+  // The total time spent in the spans of each name, in the order in which
+  // the first span of each name finished.
+  const std::vector<std::pair<std::string, absl::Duration>>& stages() const {
+    return stages_;
+  }
+
+ private:
+  friend class ScopedSpan;
+
+  void Add(absl::string_view name, absl::Duration duration);
+
+  std::vector<std::pair<std::string, absl::Duration>> stages_;
+
+  // The current timer of the thread when this one was created.
+  StageTimer* previous_ = nullptr;
+};
+
+}  // namespace tracing
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_TRACING_H_
@@ -0,0 +1,180 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "common/tracing.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace tracing {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+
+constexpr char kTraceparent[] =
+    "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01";
+
+class TracingTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    SetSpanExporter([this](const SpanData& span) { spans_.push_back(span); });
+  }
+  void TearDown() override { SetSpanExporter(nullptr); }
+
+  std::vector<SpanData> spans_;
+};
+
+TEST(SpanContextTest, ParsesTraceparent) {
+  std::optional<SpanContext> context =
+      SpanContext::FromTraceparent(kTraceparent);
+  ASSERT_TRUE(context.has_value());
+  EXPECT_EQ(context->trace_id, "4bf92f3577b34da6a3ce929d0e0e4736");
+  EXPECT_EQ(context->span_id, "00f067aa0ba902b7");
+  EXPECT_TRUE(context->sampled);
+  EXPECT_EQ(context->ToTraceparent(), kTraceparent);
+
+  context = SpanContext::FromTraceparent(
+      "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00");
+  ASSERT_TRUE(context.has_value());
+  EXPECT_FALSE(context->sampled);
+}
+
+TEST(SpanContextTest, RejectsMalformedTraceparent) {
+  EXPECT_FALSE(SpanContext::FromTraceparent("").has_value());
+  EXPECT_FALSE(SpanContext::FromTraceparent(
+                   "ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01")
+                   .has_value());
+  EXPECT_FALSE(SpanContext::FromTraceparent(
+                   "00-00000000000000000000000000000000-00f067aa0ba902b7-01")
+                   .has_value());
+  EXPECT_FALSE(SpanContext::FromTraceparent(
+                   "00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01")
+                   .has_value());
+  EXPECT_FALSE(
+      SpanContext::FromTraceparent(
+          "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-extra")
+          .has_value());
+}
+
+TEST_F(TracingTest, RecordsNestedSpansOfSampledRequest) {
+  {
+    ScopedSpan rpc("Spanner.Read", SpanContext::FromTraceparent(kTraceparent));
+    EXPECT_TRUE(rpc.recording());
+    ScopedSpan child("GetSession");
+    child.SetAttribute("session", "s1");
+    child.SetStatus(absl::NotFoundError("no session"));
+  }
+
+  ASSERT_EQ(spans_.size(), 2);
+  const SpanData& child = spans_[0];
+  const SpanData& rpc = spans_[1];
+  EXPECT_EQ(rpc.name, "Spanner.Read");
+  EXPECT_TRUE(rpc.server);
+  EXPECT_EQ(rpc.context.trace_id, "4bf92f3577b34da6a3ce929d0e0e4736");
+  EXPECT_EQ(rpc.parent_span_id, "00f067aa0ba902b7");
+  EXPECT_EQ(child.name, "GetSession");
+  EXPECT_FALSE(child.server);
+  EXPECT_EQ(child.context.trace_id, rpc.context.trace_id);
+  EXPECT_EQ(child.parent_span_id, rpc.context.span_id);
+  EXPECT_THAT(child.attributes, ElementsAre(Pair("session", "s1")));
+  EXPECT_EQ(child.status.code(), absl::StatusCode::kNotFound);
+  EXPECT_LE(rpc.start_time, child.start_time);
+  EXPECT_LE(child.end_time, rpc.end_time);
+}
+
+TEST_F(TracingTest, SkipsUnsampledAndUntracedRequests) {
+  {
+    ScopedSpan rpc("Spanner.Read", std::nullopt);
+    EXPECT_FALSE(rpc.recording());
+    ScopedSpan child("GetSession");
+    EXPECT_FALSE(child.recording());
+  }
+  {
+    ScopedSpan rpc(
+        "Spanner.Read",
+        SpanContext::FromTraceparent(
+            "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00"));
+    EXPECT_FALSE(rpc.recording());
+  }
+  EXPECT_THAT(spans_, IsEmpty());
+}
+
+TEST_F(TracingTest, SkipsSpansWhenDisabled) {
+  SetSpanExporter(nullptr);
+  ScopedSpan rpc("Spanner.Read", SpanContext::FromTraceparent(kTraceparent));
+  EXPECT_FALSE(rpc.recording());
+}
+
+TEST(StageTimerTest, TimesUnrecordedSpansByName) {
+  StageTimer timer;
+  {
+    ScopedSpan lookup("GetSession");
+    EXPECT_FALSE(lookup.recording());
+  }
+  {
+    ScopedSpan evaluate("QueryEngine.Evaluate");
+    absl::SleepFor(absl::Milliseconds(5));
+    ScopedSpan wait("LockManager.Wait");
+  }
+  { ScopedSpan lookup("GetSession"); }
+  ASSERT_EQ(timer.stages().size(), 3);
+  EXPECT_EQ(timer.stages()[0].first, "GetSession");
+  EXPECT_EQ(timer.stages()[1].first, "LockManager.Wait");
+  EXPECT_EQ(timer.stages()[2].first, "QueryEngine.Evaluate");
+  EXPECT_GE(timer.stages()[2].second, absl::Milliseconds(5));
+}
+
+TEST(OtlpJsonTest, FormatsSpan) {
+  SpanData span;
+  span.name = "Commit \"flush\"";
+  span.context = *SpanContext::FromTraceparent(kTraceparent);
+  span.parent_span_id = "0000000000000001";
+  span.start_time = absl::FromUnixNanos(1000);
+  span.end_time = absl::FromUnixNanos(2000);
+  span.attributes.emplace_back("rows", "3");
+  span.status = absl::AbortedError("aborted");
+
+  std::string json = ToOtlpJson(span);
+  EXPECT_THAT(json,
+              HasSubstr("\"traceId\":\"4bf92f3577b34da6a3ce929d0e0e4736\""));
+  EXPECT_THAT(json, HasSubstr("\"name\":\"Commit \\\"flush\\\"\""));
+  EXPECT_THAT(json, HasSubstr("\"kind\":1"));
+  EXPECT_THAT(json, HasSubstr("\"startTimeUnixNano\":\"1000\""));
+  EXPECT_THAT(json, HasSubstr("\"endTimeUnixNano\":\"2000\""));
+  EXPECT_THAT(json, HasSubstr("{\"key\":\"rows\",\"value\":{\"stringValue\":"
+                              "\"3\"}}"));
+  EXPECT_THAT(json, HasSubstr("\"status\":{\"code\":2"));
+  EXPECT_EQ(json.find('\n'), std::string::npos);
+}
+
+}  // namespace
+}  // namespace tracing
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
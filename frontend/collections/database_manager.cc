@@ -16,9 +16,15 @@
 
 #include "frontend/collections/database_manager.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>  // NOLINT
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <system_error>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -26,11 +32,21 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/common/memory_reclaimer.h"
 #include "backend/database/database.h"
+#include "backend/database/write_ahead_log.h"
+#include "backend/database/write_ahead_log.pb.h"
 #include "common/clock.h"
 #include "common/errors.h"
 #include "common/limits.h"
+#include "common/metrics.h"
 #include "frontend/common/uris.h"
 #include "zetasql/base/status_macros.h"
 
@@ -57,8 +73,111 @@ std::vector<std::shared_ptr<Database>> GetDatabasesByInstance(
   return databases;
 }
 
+constexpr char kWriteAheadLogSuffix[] = ".wal";
+constexpr char kFixtureSuffix[] = ".fixture";
+
+// Database URIs are turned into file names by escaping the slashes separating
+// their components. Project IDs may contain dots and colons, but never
+// percent signs or slashes.
+std::string DatabaseUriToFileName(const std::string& database_uri) {
+  return absl::StrCat(absl::StrReplaceAll(database_uri, {{"/", "%2F"}}),
+                      kWriteAheadLogSuffix);
+}
+
+std::string FileNameToDatabaseUri(absl::string_view file_name) {
+  file_name.remove_suffix(sizeof(kWriteAheadLogSuffix) - 1);
+  return absl::StrReplaceAll(file_name, {{"%2F", "/"}});
+}
+
 }  // namespace
 
+DatabaseManager::DatabaseManager(Clock* clock, DatabaseManagerOptions options)
+    : clock_(clock), options_(std::move(options)) {
+  memory_gauge_id_ = metrics::RegisterGaugeCallback(
+      "emulator_database_memory_bytes", {"database", "table"}, [this] {
+        std::vector<metrics::GaugeSample> samples;
+        for (const std::shared_ptr<Database>& database : ListAllDatabases()) {
+          for (const auto& [table, bytes] :
+               database->backend()->GetMemoryUsage()) {
+            samples.push_back({{database->database_uri(), table},
+                               static_cast<double>(bytes)});
+          }
+        }
+        return samples;
+      });
+  idle_transactions_gauge_id_ = metrics::RegisterGaugeCallback(
+      "emulator_idle_transactions_aborted", {"database"}, [this] {
+        std::vector<metrics::GaugeSample> samples;
+        for (const std::shared_ptr<Database>& database : ListAllDatabases()) {
+          samples.push_back(
+              {{database->database_uri()},
+               static_cast<double>(
+                   database->backend()->idle_transactions_aborted())});
+        }
+        return samples;
+      });
+  lock_gauge_ids_.push_back(metrics::RegisterGaugeCallback(
+      "emulator_lock_waiting_transactions", {"database"}, [this] {
+        std::vector<metrics::GaugeSample> samples;
+        for (const std::shared_ptr<Database>& database : ListAllDatabases()) {
+          samples.push_back(
+              {{database->database_uri()},
+               static_cast<double>(database->backend()
+                                       ->GetLockContentionStats()
+                                       .waiting_transactions)});
+        }
+        return samples;
+      }));
+  lock_gauge_ids_.push_back(metrics::RegisterGaugeCallback(
+      "emulator_lock_aborted_transactions", {"database", "reason"}, [this] {
+        std::vector<metrics::GaugeSample> samples;
+        for (const std::shared_ptr<Database>& database : ListAllDatabases()) {
+          const backend::LockManager::ContentionStats stats =
+              database->backend()->GetLockContentionStats();
+          const std::string& uri = database->database_uri();
+          samples.push_back(
+              {{uri, "concurrent_transaction"},
+               static_cast<double>(stats.concurrent_transaction_aborts)});
+          samples.push_back({{uri, "wounded"},
+                             static_cast<double>(stats.wounded_transactions)});
+          samples.push_back({{uri, "lock_wait_timeout"},
+                             static_cast<double>(stats.lock_wait_timeouts)});
+          samples.push_back(
+              {{uri, "idle"},
+               static_cast<double>(stats.idle_transaction_aborts)});
+          samples.push_back(
+              {{uri, "optimistic_conflict"},
+               static_cast<double>(stats.optimistic_conflict_aborts)});
+        }
+        return samples;
+      }));
+  lock_gauge_ids_.push_back(metrics::RegisterGaugeCallback(
+      "emulator_lock_longest_hold_seconds", {"database", "transaction_id"},
+      [this] {
+        std::vector<metrics::GaugeSample> samples;
+        for (const std::shared_ptr<Database>& database : ListAllDatabases()) {
+          const backend::LockManager::ContentionStats stats =
+              database->backend()->GetLockContentionStats();
+          if (stats.longest_holder_id == backend::kInvalidTransactionID) {
+            continue;
+          }
+          samples.push_back(
+              {{database->database_uri(),
+                absl::StrCat(stats.longest_holder_id)},
+               absl::ToDoubleSeconds(stats.longest_hold_duration)});
+        }
+        return samples;
+      }));
+}
+
+DatabaseManager::~DatabaseManager() {
+  metrics::UnregisterGaugeCallback(memory_gauge_id_);
+  metrics::UnregisterGaugeCallback(idle_transactions_gauge_id_);
+  for (int64_t id : lock_gauge_ids_) {
+    metrics::UnregisterGaugeCallback(id);
+  }
+}
+
 absl::StatusOr<std::shared_ptr<Database>> DatabaseManager::CreateDatabase(
     const std::string& database_uri,
     const backend::SchemaChangeOperation& schema_change_operation) {
@@ -71,8 +190,221 @@ absl::StatusOr<std::shared_ptr<Database>> DatabaseManager::CreateDatabase(
       ParseDatabaseUri(database_uri, &project_id, &instance_id, &database_id));
   std::string instance_uri = MakeInstanceUri(project_id, instance_id);
 
+  std::shared_ptr<const backend::Database::SchemaTemplate> schema_template;
+  if (options_.schema_cache_size > 0 &&
+      !schema_change_operation.statements.empty()) {
+    ZETASQL_ASSIGN_OR_RETURN(schema_template,
+                     GetSchemaTemplate(schema_change_operation.statements));
+  }
+  // Databases restored from snapshots or logs already have all of their rows,
+  // so only new databases are created with the rows of a fixture.
+  backend::StorageOptions storage_options = GetStorageOptions(database_id);
+  const std::string fixture_path = FixturePath(database_uri);
+  std::error_code error_code;
+  if (!fixture_path.empty() &&
+      std::filesystem::exists(fixture_path, error_code)) {
+    storage_options.fixture_path = fixture_path;
+  }
+  std::unique_ptr<backend::Database> backend_db;
+  if (schema_template != nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(backend_db, backend::Database::CreateFromTemplate(
+                                     clock_, std::move(schema_template),
+                                     storage_options));
+  } else {
+    ZETASQL_ASSIGN_OR_RETURN(backend_db,
+                     backend::Database::Create(clock_, schema_change_operation,
+                                               storage_options));
+  }
+  return AddDatabase(database_uri, instance_uri, std::move(backend_db));
+}
+
+absl::StatusOr<std::shared_ptr<const backend::Database::SchemaTemplate>>
+DatabaseManager::GetSchemaTemplate(absl::Span<const std::string> statements) {
+  // Statements which differ only in leading or trailing whitespace create the
+  // same schema.
+  std::string key = absl::StrJoin(
+      statements, absl::string_view("\0", 1),
+      [](std::string* out, const std::string& statement) {
+        absl::StrAppend(out, absl::StripAsciiWhitespace(statement));
+      });
+  {
+    absl::MutexLock lock(&schema_cache_mu_);
+    auto itr = schema_cache_.find(key);
+    if (itr != schema_cache_.end()) {
+      schema_cache_lru_.splice(schema_cache_lru_.begin(), schema_cache_lru_,
+                               itr->second.lru_position);
+      return itr->second.schema_template;
+    }
+  }
+
+  // Build the schema outside the lock, so that databases with different
+  // schemas are created in parallel. Failed statements are not cached.
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::shared_ptr<const backend::Database::SchemaTemplate> schema_template,
+      backend::Database::CreateSchemaTemplate(
+          backend::SchemaChangeOperation{.statements = statements}));
+
+  absl::MutexLock lock(&schema_cache_mu_);
+  auto [itr, inserted] = schema_cache_.try_emplace(key);
+  if (!inserted) {
+    return itr->second.schema_template;
+  }
+  schema_cache_lru_.push_front(std::move(key));
+  itr->second = {schema_template, schema_cache_lru_.begin()};
+  while (static_cast<int64_t>(schema_cache_lru_.size()) >
+         options_.schema_cache_size) {
+    schema_cache_.erase(schema_cache_lru_.back());
+    schema_cache_lru_.pop_back();
+  }
+  return schema_template;
+}
+
+absl::StatusOr<std::shared_ptr<Database>>
+DatabaseManager::CreateDatabaseFromSnapshot(
+    const std::string& database_uri,
+    const backend::DatabaseSnapshot& snapshot) {
+  absl::string_view project_id, instance_id, database_id;
+  ZETASQL_RETURN_IF_ERROR(
+      ParseDatabaseUri(database_uri, &project_id, &instance_id, &database_id));
+  std::string instance_uri = MakeInstanceUri(project_id, instance_id);
+
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<backend::Database> backend_db,
-                   backend::Database::Create(clock_, schema_change_operation));
+                   backend::Database::CreateFromSnapshot(
+                       clock_, snapshot, GetStorageOptions(database_id)));
+  return AddDatabase(database_uri, instance_uri, std::move(backend_db));
+}
+
+absl::StatusOr<std::shared_ptr<Database>> DatabaseManager::CloneDatabase(
+    const std::string& source_database_uri, const std::string& database_uri) {
+  absl::string_view project_id, instance_id, database_id;
+  ZETASQL_RETURN_IF_ERROR(
+      ParseDatabaseUri(database_uri, &project_id, &instance_id, &database_id));
+  std::string instance_uri = MakeInstanceUri(project_id, instance_id);
+
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Database> source,
+                   GetDatabase(source_database_uri));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<backend::Database> backend_db,
+                   source->backend()->Clone());
+  return AddDatabase(database_uri, instance_uri, std::move(backend_db));
+}
+
+absl::StatusOr<std::shared_ptr<Database>> DatabaseManager::RecoverDatabase(
+    const std::string& database_uri) {
+  absl::string_view project_id, instance_id, database_id;
+  ZETASQL_RETURN_IF_ERROR(
+      ParseDatabaseUri(database_uri, &project_id, &instance_id, &database_id));
+  std::string instance_uri = MakeInstanceUri(project_id, instance_id);
+
+  // The first record of a log is a snapshot of the database, and every record
+  // after it is a change to be replayed on top.
+  std::unique_ptr<backend::Database> backend_db;
+  ZETASQL_ASSIGN_OR_RETURN(
+      int64_t log_size,
+      backend::WriteAheadLog::Replay(
+          WriteAheadLogPath(database_uri),
+          [&](const backend::WriteAheadLogRecord& record) -> absl::Status {
+            if (backend_db != nullptr) {
+              return backend_db->ReplayWriteAheadLogRecord(record);
+            }
+            if (!record.has_snapshot()) {
+              return error::Internal(absl::StrCat(
+                  "Write ahead log of ", database_uri,
+                  " does not start with a snapshot"));
+            }
+            ZETASQL_ASSIGN_OR_RETURN(backend_db,
+                             backend::Database::CreateFromSnapshot(
+                                 clock_, record.snapshot(),
+                                 GetStorageOptions(database_id)));
+            return absl::OkStatus();
+          }));
+  if (backend_db == nullptr) {
+    // The log was created, but the emulator stopped before the initial snapshot
+    // was written, so the database was never returned to a client.
+    std::remove(WriteAheadLogPath(database_uri).c_str());
+    return error::DatabaseNotFound(database_uri);
+  }
+  return AddDatabase(database_uri, instance_uri, std::move(backend_db),
+                     log_size);
+}
+
+absl::StatusOr<std::vector<std::string>> DatabaseManager::ListWriteAheadLogs()
+    const {
+  if (options_.write_ahead_log_dir.empty()) {
+    return std::vector<std::string>();
+  }
+  return ListWriteAheadLogsIn(options_.write_ahead_log_dir);
+}
+
+absl::StatusOr<std::vector<std::string>> DatabaseManager::ListWriteAheadLogsIn(
+    const std::string& log_dir) {
+  std::vector<std::string> database_uris;
+  std::error_code error_code;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(log_dir, error_code)) {
+    const std::string file_name = entry.path().filename().string();
+    if (entry.is_regular_file() &&
+        absl::EndsWith(file_name, kWriteAheadLogSuffix)) {
+      database_uris.push_back(FileNameToDatabaseUri(file_name));
+    }
+  }
+  if (error_code) {
+    return error::Internal(absl::StrCat("Failed to list write ahead logs in ",
+                                        log_dir, ": ", error_code.message()));
+  }
+  std::sort(database_uris.begin(), database_uris.end());
+  return database_uris;
+}
+
+bool DatabaseManager::HasWriteAheadLog(const std::string& database_uri) const {
+  std::error_code error_code;
+  return !options_.write_ahead_log_dir.empty() &&
+         std::filesystem::exists(WriteAheadLogPath(database_uri), error_code);
+}
+
+std::string DatabaseManager::WriteAheadLogPath(
+    const std::string& database_uri) const {
+  return WriteAheadLogPathIn(options_.write_ahead_log_dir, database_uri);
+}
+
+std::string DatabaseManager::WriteAheadLogPathIn(
+    const std::string& log_dir, const std::string& database_uri) {
+  return absl::StrCat(log_dir, "/", DatabaseUriToFileName(database_uri));
+}
+
+std::string DatabaseManager::FixturePath(
+    const std::string& database_uri) const {
+  if (options_.fixture_dir.empty()) {
+    return "";
+  }
+  return absl::StrCat(options_.fixture_dir, "/",
+                      absl::StrReplaceAll(database_uri, {{"/", "%2F"}}),
+                      kFixtureSuffix);
+}
+
+backend::StorageOptions DatabaseManager::GetStorageOptions(
+    absl::string_view database_id) const {
+  backend::StorageOptions storage_options{
+      .hydrate_snapshots_lazily = options_.hydrate_snapshots_lazily,
+      .snapshot_hydration_threads = options_.snapshot_hydration_threads,
+  };
+  if (options_.disk_storage_dir.empty()) {
+    return storage_options;
+  }
+  for (const std::string& id : options_.disk_storage_databases) {
+    if (id == "*" || id == database_id) {
+      storage_options.disk_storage_dir = options_.disk_storage_dir;
+      storage_options.disk_storage_cache_bytes =
+          options_.disk_storage_cache_bytes;
+      break;
+    }
+  }
+  return storage_options;
+}
+
+absl::StatusOr<std::shared_ptr<Database>> DatabaseManager::AddDatabase(
+    const std::string& database_uri, const std::string& instance_uri,
+    std::unique_ptr<backend::Database> backend_db, int64_t log_size) {
+  backend::Database* backend = backend_db.get();
   auto database = std::make_shared<Database>(
       database_uri, std::move(backend_db), clock_->Now());
 
@@ -93,6 +425,26 @@ absl::StatusOr<std::shared_ptr<Database>> DatabaseManager::CreateDatabase(
     return error::TooManyDatabasesPerInstance(instance_uri);
   }
 
+  // The log is started while holding the lock, so that it is never replaced by
+  // a concurrent attempt to create the same database, and before the database
+  // is returned to any caller.
+  if (!options_.write_ahead_log_dir.empty()) {
+    const std::string path = WriteAheadLogPath(database_uri);
+    absl::StatusOr<std::unique_ptr<backend::WriteAheadLog>> log =
+        backend::WriteAheadLog::Open(path, log_size,
+                                     options_.sync_write_ahead_log);
+    absl::Status status = log.status();
+    if (status.ok()) {
+      status = backend->StartWriteAheadLog(std::move(log).value());
+    }
+    if (!status.ok()) {
+      if (log_size == 0) {
+        std::remove(path.c_str());
+      }
+      return status;
+    }
+  }
+
   // Record this database in the database manager.
   database_map_[database_uri] = database;
   num_databases_per_instance_[instance_uri] += 1;
@@ -111,14 +463,27 @@ absl::StatusOr<std::shared_ptr<Database>> DatabaseManager::GetDatabase(
 }
 
 absl::Status DatabaseManager::DeleteDatabase(const std::string& database_uri) {
-  absl::MutexLock lock(&mu_);
-  if (database_map_.erase(database_uri) > 0) {
+  // The dropped database is destroyed on the reclamation thread rather than
+  // under mu_, since freeing a large database can take seconds.
+  std::shared_ptr<Database> dropped;
+  {
+    absl::MutexLock lock(&mu_);
+    auto itr = database_map_.find(database_uri);
+    if (itr == database_map_.end()) {
+      return absl::OkStatus();
+    }
+    dropped = std::move(itr->second);
+    database_map_.erase(itr);
     absl::string_view project_id, instance_id, database_id;
     ZETASQL_RETURN_IF_ERROR(ParseDatabaseUri(database_uri, &project_id, &instance_id,
                                      &database_id));
     std::string instance_uri = MakeInstanceUri(project_id, instance_id);
     num_databases_per_instance_[instance_uri] -= 1;
+    if (!options_.write_ahead_log_dir.empty()) {
+      std::remove(WriteAheadLogPath(database_uri).c_str());
+    }
   }
+  backend::MemoryReclaimer::Default()->Reclaim(std::move(dropped));
   return absl::OkStatus();
 }
 
@@ -128,6 +493,17 @@ DatabaseManager::ListDatabases(const std::string& instance_uri) const {
   return GetDatabasesByInstance(database_map_, instance_uri);
 }
 
+std::vector<std::shared_ptr<Database>> DatabaseManager::ListAllDatabases()
+    const {
+  absl::MutexLock lock(&mu_);
+  std::vector<std::shared_ptr<Database>> databases;
+  databases.reserve(database_map_.size());
+  for (const auto& [database_uri, database] : database_map_) {
+    databases.push_back(database);
+  }
+  return databases;
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
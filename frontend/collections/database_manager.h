@@ -17,15 +17,23 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_DATABASE_MANAGER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_DATABASE_MANAGER_H_
 
+#include <cstdint>
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "backend/database/database.h"
+#include "backend/database/snapshot.pb.h"
 #include "backend/schema/updater/schema_updater.h"
 #include "common/clock.h"
 #include "frontend/entities/database.h"
@@ -36,10 +44,52 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+// Options for the databases created by a DatabaseManager.
+struct DatabaseManagerOptions {
+  // If non-empty, every database added to the manager logs its changes to a
+  // file in this directory, see backend::Database::StartWriteAheadLog.
+  std::string write_ahead_log_dir;
+
+  // Passed on to backend::WriteAheadLog::Open.
+  bool sync_write_ahead_log = true;
+
+  // If non-empty, databases whose ID is in disk_storage_databases keep their
+  // rows in a backend::DiskStorage with its scratch file in this directory.
+  std::string disk_storage_dir;
+
+  // IDs of the databases which use disk storage. "*" selects all of them.
+  std::vector<std::string> disk_storage_databases = {"*"};
+
+  // The size of the cache of spilled values of each disk storage database.
+  int64_t disk_storage_cache_bytes = 64 << 20;
+
+  // If non-empty, databases created by CreateDatabase which have a fixture in
+  // this directory, named by FixturePath, start with the rows of the fixture,
+  // which are served from the file rather than loaded into memory.
+  std::string fixture_dir;
+
+  // Passed on to backend::StorageOptions for the databases restored from
+  // snapshots, including those recovered from write ahead logs.
+  bool hydrate_snapshots_lazily = false;
+  int snapshot_hydration_threads = 0;
+
+  // The number of most recently used schemas, keyed by the DDL statements they
+  // were created from, kept for creating further databases from the same
+  // statements. Databases created from a cached schema share it. Zero disables
+  // the cache.
+  int64_t schema_cache_size = 0;
+};
+
 // DatabaseManager manages the set of active databases in the emulator.
 class DatabaseManager {
  public:
-  explicit DatabaseManager(Clock* clock) : clock_(clock) {}
+  // The memory used by each table of the managed databases is exported as the
+  // emulator_database_memory_bytes gauge while the manager exists.
+  explicit DatabaseManager(Clock* clock, DatabaseManagerOptions options = {});
+  ~DatabaseManager();
+
+  DatabaseManager(const DatabaseManager&) = delete;
+  DatabaseManager& operator=(const DatabaseManager&) = delete;
 
   // Creates a database with a schema initialized from `create_statements`.
   absl::StatusOr<std::shared_ptr<Database>> CreateDatabase(
@@ -47,6 +97,45 @@ class DatabaseManager {
       const backend::SchemaChangeOperation& schema_change_operation)
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Creates a database with the schema and rows of the given snapshot.
+  absl::StatusOr<std::shared_ptr<Database>> CreateDatabaseFromSnapshot(
+      const std::string& database_uri,
+      const backend::DatabaseSnapshot& snapshot) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Creates a database which starts out as a copy of the database at
+  // source_database_uri. The copy shares storage with the source until either
+  // is modified, so this is cheap even for large databases.
+  absl::StatusOr<std::shared_ptr<Database>> CloneDatabase(
+      const std::string& source_database_uri,
+      const std::string& database_uri) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Recreates the database at database_uri by replaying its write ahead log,
+  // which it then continues to append to. Returns NOT_FOUND, and removes the
+  // log, if the log has no complete records.
+  absl::StatusOr<std::shared_ptr<Database>> RecoverDatabase(
+      const std::string& database_uri) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the URIs of the databases with a log in the write ahead log
+  // directory, ordered by URI.
+  absl::StatusOr<std::vector<std::string>> ListWriteAheadLogs() const;
+
+  // Returns true if there is a write ahead log for the database at
+  // database_uri.
+  bool HasWriteAheadLog(const std::string& database_uri) const;
+
+  // Returns the URIs of the databases with a log in log_dir, ordered by URI.
+  static absl::StatusOr<std::vector<std::string>> ListWriteAheadLogsIn(
+      const std::string& log_dir);
+
+  // Returns the path of the write ahead log of the database at database_uri in
+  // log_dir.
+  static std::string WriteAheadLogPathIn(const std::string& log_dir,
+                                         const std::string& database_uri);
+
+  // Returns the path of the fixture of the database at database_uri in the
+  // fixture directory, or an empty string if there is no such directory.
+  std::string FixturePath(const std::string& database_uri) const;
+
   // Returns a database with the given URI.
   absl::StatusOr<std::shared_ptr<Database>> GetDatabase(
       const std::string& database_uri) const ABSL_LOCKS_EXCLUDED(mu_);
@@ -59,10 +148,47 @@ class DatabaseManager {
   absl::StatusOr<std::vector<std::shared_ptr<Database>>> ListDatabases(
       const std::string& instance_uri) const ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Lists all databases across all instances, ordered by URI.
+  std::vector<std::shared_ptr<Database>> ListAllDatabases() const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
  private:
+  // Records a newly created backend database under the given URI. With a write
+  // ahead log directory, the log of the database is truncated to log_size bytes
+  // and then continued, starting with a snapshot of the database if log_size is
+  // zero.
+  absl::StatusOr<std::shared_ptr<Database>> AddDatabase(
+      const std::string& database_uri, const std::string& instance_uri,
+      std::unique_ptr<backend::Database> backend_db, int64_t log_size = 0)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the path of the write ahead log of the database at database_uri.
+  std::string WriteAheadLogPath(const std::string& database_uri) const;
+
+  // Returns the storage options of the database with the given ID.
+  backend::StorageOptions GetStorageOptions(
+      absl::string_view database_id) const;
+
+  // Returns the schema template for statements from the schema cache, creating
+  // and caching it if needed. Returns null if the schema cannot be shared.
+  absl::StatusOr<std::shared_ptr<const backend::Database::SchemaTemplate>>
+  GetSchemaTemplate(absl::Span<const std::string> statements)
+      ABSL_LOCKS_EXCLUDED(schema_cache_mu_);
+
   // System-wide clock.
   Clock* clock_;
 
+  const DatabaseManagerOptions options_;
+
+  // ID of the memory usage gauge callback, see metrics::RegisterGaugeCallback.
+  int64_t memory_gauge_id_;
+
+  // ID of the gauge callback counting transactions aborted for being idle.
+  int64_t idle_transactions_gauge_id_;
+
+  // IDs of the lock contention gauge callbacks.
+  std::vector<int64_t> lock_gauge_ids_;
+
   // Mutex to guard state below.
   mutable absl::Mutex mu_;
 
@@ -73,6 +199,23 @@ class DatabaseManager {
   // Count of databases per instance.
   absl::flat_hash_map<std::string, int> num_databases_per_instance_
       ABSL_GUARDED_BY(mu_);
+
+  // Mutex to guard the schema cache below.
+  absl::Mutex schema_cache_mu_;
+
+  // Keys of the cached schema templates, most recently used first.
+  std::list<std::string> schema_cache_lru_ ABSL_GUARDED_BY(schema_cache_mu_);
+
+  // An entry of the schema cache, with the position of its key in
+  // schema_cache_lru_.
+  struct SchemaCacheEntry {
+    std::shared_ptr<const backend::Database::SchemaTemplate> schema_template;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  // Map from the joined DDL statements to their schema template.
+  absl::flat_hash_map<std::string, SchemaCacheEntry> schema_cache_
+      ABSL_GUARDED_BY(schema_cache_mu_);
 };
 
 }  // namespace frontend
@@ -24,6 +24,9 @@
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "backend/schema/catalog/schema.h"
 #include "frontend/entities/database.h"
 
 namespace google {
@@ -75,6 +78,25 @@ TEST_F(DatabaseManagerTest, GetNonExistingDatabaseReturnsNotFound) {
               zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
 }
 
+TEST_F(DatabaseManagerTest, CloneExistingDatabase) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<Database> source,
+      database_manager_.CreateDatabase(database_uri_, empty_schema_operation_));
+  std::string clone_uri =
+      "projects/test-p/instances/test-instance/databases/test-clone";
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Database> clone,
+                       database_manager_.CloneDatabase(database_uri_, clone_uri));
+  EXPECT_EQ(clone->database_uri(), clone_uri);
+  EXPECT_NE(clone->backend(), source->backend());
+
+  EXPECT_THAT(database_manager_.CloneDatabase(database_uri_, clone_uri),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAlreadyExists));
+  EXPECT_THAT(database_manager_.CloneDatabase(
+                  "projects/test-p/instances/test-instance/databases/missing",
+                  "projects/test-p/instances/test-instance/databases/other"),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+}
+
 TEST_F(DatabaseManagerTest, DeleteExistingDatabase) {
   ZETASQL_ASSERT_OK_AND_ASSIGN(
       std::shared_ptr<Database> database,
@@ -153,6 +175,70 @@ TEST_F(DatabaseManagerTest, DatabaseQuotaIsEnforced) {
       absl::StrCat(database_uri_prefix, 101), empty_schema_operation_));
 }
 
+TEST_F(DatabaseManagerTest, RecoversDatabaseFromWriteAheadLog) {
+  const std::string log_dir = testing::TempDir();
+  std::vector<std::string> statements = {
+      "CREATE TABLE T(k INT64) PRIMARY KEY(k)"};
+  {
+    DatabaseManager logged_manager(
+        &clock_, DatabaseManagerOptions{.write_ahead_log_dir = log_dir});
+    ZETASQL_ASSERT_OK(logged_manager.CreateDatabase(
+        database_uri_,
+        backend::SchemaChangeOperation{.statements = statements}));
+    EXPECT_TRUE(logged_manager.HasWriteAheadLog(database_uri_));
+  }
+
+  DatabaseManager recovered_manager(
+      &clock_, DatabaseManagerOptions{.write_ahead_log_dir = log_dir});
+  EXPECT_THAT(
+      recovered_manager.ListWriteAheadLogs(),
+      zetasql_base::testing::IsOkAndHolds(testing::Contains(database_uri_)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Database> database,
+                       recovered_manager.RecoverDatabase(database_uri_));
+  EXPECT_NE(database->backend()->GetLatestSchema()->FindTable("T"), nullptr);
+
+  ZETASQL_ASSERT_OK(recovered_manager.DeleteDatabase(database_uri_));
+  EXPECT_FALSE(recovered_manager.HasWriteAheadLog(database_uri_));
+}
+
+TEST_F(DatabaseManagerTest, SharesCachedSchemas) {
+  DatabaseManager cached_manager(
+      &clock_, DatabaseManagerOptions{.schema_cache_size = 1});
+  const std::string instance_uri = "projects/test-p/instances/test-instance";
+  std::vector<std::string> statements = {
+      "CREATE TABLE T(k INT64) PRIMARY KEY(k)"};
+  std::vector<std::string> padded_statements = {
+      "\n  CREATE TABLE T(k INT64) PRIMARY KEY(k)\n"};
+  std::vector<std::string> other_statements = {
+      "CREATE TABLE U(k INT64) PRIMARY KEY(k)"};
+  auto create = [&](absl::string_view database_id,
+                    const std::vector<std::string>& ddl) {
+    return cached_manager.CreateDatabase(
+        absl::StrCat(instance_uri, "/databases/", database_id),
+        backend::SchemaChangeOperation{.statements = ddl});
+  };
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Database> db1,
+                       create("db1", statements));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Database> db2,
+                       create("db2", padded_statements));
+  EXPECT_EQ(db1->backend()->GetLatestSchema(),
+            db2->backend()->GetLatestSchema());
+
+  // Creating a database with other statements evicts the cached schema.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Database> db3,
+                       create("db3", other_statements));
+  EXPECT_NE(db3->backend()->GetLatestSchema()->FindTable("U"), nullptr);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Database> db4,
+                       create("db4", statements));
+  EXPECT_NE(db4->backend()->GetLatestSchema(),
+            db1->backend()->GetLatestSchema());
+  EXPECT_NE(db4->backend()->GetLatestSchema()->FindTable("T"), nullptr);
+
+  EXPECT_THAT(create("db5", {"CREATE TABLE"}),
+              zetasql_base::testing::StatusIs(
+                  absl::StatusCode::kInvalidArgument));
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
@@ -55,6 +55,17 @@ InstanceManager::ListInstances(const std::string& project_uri) const {
   return instances;
 }
 
+std::vector<std::shared_ptr<Instance>> InstanceManager::ListAllInstances()
+    const {
+  absl::MutexLock lock(&mu_);
+  std::vector<std::shared_ptr<Instance>> instances;
+  instances.reserve(instances_.size());
+  for (const auto& [instance_uri, instance] : instances_) {
+    instances.push_back(instance);
+  }
+  return instances;
+}
+
 absl::StatusOr<std::shared_ptr<Instance>> InstanceManager::GetInstance(
     const std::string& instance_uri) const {
   absl::MutexLock lock(&mu_);
@@ -17,6 +17,9 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_COLLECTIONS_INSTANCE_MANAGER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_COLLECTIONS_INSTANCE_MANAGER_H_
 
+#include <memory>
+#include <vector>
+
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
@@ -49,6 +52,10 @@ class InstanceManager {
   absl::StatusOr<std::vector<std::shared_ptr<Instance>>> ListInstances(
       const std::string& project_uri) const ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Lists all instances across all projects, ordered by URI.
+  std::vector<std::shared_ptr<Instance>> ListAllInstances() const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
  private:
   // Mutex to guard state below.
   mutable absl::Mutex mu_;
@@ -18,6 +18,7 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -25,6 +26,8 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "common/errors.h"
 #include "frontend/common/uris.h"
 
@@ -38,6 +41,7 @@ const char OperationManager::kAutoGeneratedId[] = "";
 absl::StatusOr<std::shared_ptr<Operation>> OperationManager::CreateOperation(
     const std::string& resource_uri, const std::string& operation_id) {
   absl::MutexLock lock(&mu_);
+  UpdateDoneOperations();
 
   // Generate an operation id if the user did not specify one.
   std::string operation_uri = MakeOperationUri(
@@ -55,6 +59,7 @@ absl::StatusOr<std::shared_ptr<Operation>> OperationManager::CreateOperation(
   std::shared_ptr<Operation> operation =
       std::make_shared<Operation>(operation_uri);
   operations_map_[operation_uri] = operation;
+  pending_operations_[operation_uri] = operation;
 
   return operation;
 }
@@ -74,15 +79,34 @@ absl::Status OperationManager::DeleteOperation(
     const std::string& operation_uri) {
   absl::MutexLock lock(&mu_);
   operations_map_.erase(operation_uri);
+  pending_operations_.erase(operation_uri);
+  auto done_itr = done_operations_.find(operation_uri);
+  if (done_itr != done_operations_.end()) {
+    auto [begin, end] =
+        done_operations_by_time_.equal_range(*done_itr->second->done_time());
+    for (auto itr = begin; itr != end; ++itr) {
+      if (itr->second == operation_uri) {
+        done_operations_by_time_.erase(itr);
+        break;
+      }
+    }
+    done_operations_.erase(done_itr);
+  }
   return absl::OkStatus();
 }
 
 absl::StatusOr<std::vector<std::shared_ptr<Operation>>>
-OperationManager::ListOperations(const std::string& resource_uri) {
+OperationManager::ListOperations(const std::string& resource_uri,
+                                 std::optional<bool> done) {
   absl::MutexLock lock(&mu_);
+  UpdateDoneOperations();
+  const OperationMap& operations_map =
+      !done.has_value() ? operations_map_
+      : *done           ? done_operations_
+                        : pending_operations_;
   std::vector<std::shared_ptr<Operation>> operations;
-  auto itr = operations_map_.lower_bound(resource_uri);
-  while (itr != operations_map_.end()) {
+  auto itr = operations_map.lower_bound(resource_uri);
+  while (itr != operations_map.end()) {
     if (!absl::StartsWith(itr->first, resource_uri)) {
       break;
     }
@@ -93,6 +117,29 @@ OperationManager::ListOperations(const std::string& resource_uri) {
   return operations;
 }
 
+void OperationManager::UpdateDoneOperations() {
+  for (auto itr = pending_operations_.begin();
+       itr != pending_operations_.end();) {
+    std::optional<absl::Time> done_time = itr->second->done_time();
+    if (!done_time.has_value()) {
+      ++itr;
+      continue;
+    }
+    done_operations_by_time_.emplace(*done_time, itr->first);
+    done_operations_.insert(*itr);
+    itr = pending_operations_.erase(itr);
+  }
+
+  const absl::Time cutoff = absl::Now() - done_operation_retention_;
+  while (!done_operations_by_time_.empty() &&
+         done_operations_by_time_.begin()->first < cutoff) {
+    const std::string& operation_uri = done_operations_by_time_.begin()->second;
+    operations_map_.erase(operation_uri);
+    done_operations_.erase(operation_uri);
+    done_operations_by_time_.erase(done_operations_by_time_.begin());
+  }
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
@@ -19,12 +19,15 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "frontend/entities/operation.h"
 #include "absl/status/status.h"
 
@@ -56,6 +59,11 @@ namespace frontend {
 // returns success at the handler level as there is nothing to cancel. Wait is
 // not implemented by Cloud Spanner, so we don't need to implement it here.
 //
+// Operations are kept ordered by URI, so that the operations of a resource are
+// listed without visiting those of others, and are also indexed by whether they
+// are done. Done operations are removed once they have been done for longer
+// than the retention period passed to the constructor.
+//
 // For more details on the long running operations api, see
 //     https://cloud.google.com/spanner/docs/reference/rpc/google.longrunning
 class OperationManager {
@@ -63,6 +71,14 @@ class OperationManager {
   // A constant indicating that the operation id should be auto generated.
   static const char kAutoGeneratedId[];
 
+  // The default time for which done operations are kept.
+  static constexpr absl::Duration kDefaultDoneOperationRetention =
+      absl::Hours(24);
+
+  explicit OperationManager(
+      absl::Duration done_operation_retention = kDefaultDoneOperationRetention)
+      : done_operation_retention_(done_operation_retention) {}
+
   // Creates an operation. Some operations (like update database) allow the
   // user to specify the operation id. If the user specifies an operation id,
   // it is used as-is, otherwise a system generated operation id is used.
@@ -81,11 +97,23 @@ class OperationManager {
   absl::Status DeleteOperation(const std::string& operation_uri)
       ABSL_LOCKS_EXCLUDED(mu_);
 
-  // Lists all the operations registered with the operation manager.
+  // Lists the operations registered with the operation manager whose URIs
+  // start with resource_uri, in order of their URIs. If done is set, only the
+  // operations which are done, or not done, are listed.
   absl::StatusOr<std::vector<std::shared_ptr<Operation>>> ListOperations(
-      const std::string& resource_uri) ABSL_LOCKS_EXCLUDED(mu_);
+      const std::string& resource_uri, std::optional<bool> done = std::nullopt)
+      ABSL_LOCKS_EXCLUDED(mu_);
 
  private:
+  using OperationMap = std::map<std::string, std::shared_ptr<Operation>>;
+
+  // Moves the operations which are done since they were last checked into
+  // done_operations_, and removes those done for longer than the retention.
+  void UpdateDoneOperations() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // The time for which done operations are kept.
+  const absl::Duration done_operation_retention_;
+
   // Mutex to guard state below.
   absl::Mutex mu_;
 
@@ -93,7 +121,17 @@ class OperationManager {
   int next_operation_id_ ABSL_GUARDED_BY(mu_) = 0;
 
   // Map from operation URI to actual operation.
-  std::map<std::string, std::shared_ptr<Operation>> operations_map_
+  OperationMap operations_map_ ABSL_GUARDED_BY(mu_);
+
+  // The operations in operations_map_, split by whether they were done when
+  // last checked. Operations usually complete as soon as they are created, so
+  // few of them are ever checked more than once.
+  OperationMap pending_operations_ ABSL_GUARDED_BY(mu_);
+  OperationMap done_operations_ ABSL_GUARDED_BY(mu_);
+
+  // The URIs of the operations in done_operations_, by the time they were
+  // done.
+  std::multimap<absl::Time, std::string> done_operations_by_time_
       ABSL_GUARDED_BY(mu_);
 };
 
@@ -22,7 +22,10 @@
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
 #include "absl/strings/match.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "frontend/entities/operation.h"
 
 namespace google {
@@ -30,6 +33,9 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+using ::testing::ElementsAre;
+using ::zetasql_base::testing::IsOkAndHolds;
+
 class OperationManagerTest : public testing::Test {
  protected:
   OperationManager* manager() { return &manager_; }
@@ -138,6 +144,38 @@ TEST_F(OperationManagerTest, ListsOperationsWithSimilarInstanceURI) {
             operation_pb.name());
 }
 
+TEST_F(OperationManagerTest, ListsOperationsByDoneState) {
+  std::string instance_uri = "projects/test-project/instances/test-instance";
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Operation> done,
+                       manager()->CreateOperation(instance_uri, "done"));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Operation> pending,
+                       manager()->CreateOperation(instance_uri, "pending"));
+  done->SetError(absl::InternalError("failed"));
+
+  EXPECT_THAT(manager()->ListOperations(instance_uri, /*done=*/true),
+              IsOkAndHolds(ElementsAre(done)));
+  EXPECT_THAT(manager()->ListOperations(instance_uri, /*done=*/false),
+              IsOkAndHolds(ElementsAre(pending)));
+  EXPECT_THAT(manager()->ListOperations(instance_uri),
+              IsOkAndHolds(ElementsAre(done, pending)));
+}
+
+TEST(OperationManagerRetentionTest, RemovesDoneOperations) {
+  OperationManager manager(/*done_operation_retention=*/absl::ZeroDuration());
+  std::string instance_uri = "projects/test-project/instances/test-instance";
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Operation> done,
+                       manager.CreateOperation(instance_uri, "done"));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Operation> pending,
+                       manager.CreateOperation(instance_uri, "pending"));
+  done->SetError(absl::InternalError("failed"));
+  absl::SleepFor(absl::Milliseconds(1));
+
+  EXPECT_THAT(manager.ListOperations(instance_uri),
+              IsOkAndHolds(ElementsAre(pending)));
+  EXPECT_THAT(manager.GetOperation(done->operation_uri()),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
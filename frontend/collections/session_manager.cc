@@ -16,11 +16,14 @@
 
 #include "frontend/collections/session_manager.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
+#include "absl/hash/hash.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
@@ -36,32 +39,64 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+SessionManager::SessionManager(Clock* clock, absl::Duration idle_timeout,
+                               absl::Duration sweep_interval)
+    : clock_(clock), idle_timeout_(idle_timeout) {
+  sweeper_thread_ = std::thread(&SessionManager::PeriodicallyExpireIdleSessions,
+                                this, sweep_interval);
+}
+
+SessionManager::~SessionManager() {
+  {
+    absl::MutexLock lock(&sweeper_mu_);
+    stop_sweeper_ = true;
+  }
+  sweeper_thread_.join();
+}
+
+SessionManager::Shard& SessionManager::ShardFor(
+    const std::string& session_uri) {
+  return shards_[absl::Hash<std::string>()(session_uri) % kNumShards];
+}
+
 absl::StatusOr<std::shared_ptr<Session>> SessionManager::CreateSession(
-    const Labels& labels, std::shared_ptr<Database> database) {
-  absl::MutexLock lock(&mu_);
+    const Labels& labels, std::shared_ptr<Database> database,
+    bool multiplexed) {
   const std::string session_id = absl::StrCat(next_session_id_++);
   std::string session_uri =
       MakeSessionUri(database->database_uri(), session_id);
   std::shared_ptr<Session> session =
       std::make_shared<Session>(session_uri, labels,
-                                /* create_time = */ clock_->Now(), database);
-  session->set_approximate_last_use_time(clock_->Now());
+                                /* create_time = */ clock_->Now(), database,
+                                multiplexed);
+  session->set_approximate_last_use_time(session->create_time());
 
-  session_map_[session_uri] = session;
+  Shard& shard = ShardFor(session_uri);
+  absl::MutexLock lock(&shard.mu);
+  shard.session_map[session_uri] = session;
+  shard.expiry_queue.emplace(session->create_time(), session_uri);
   return session;
 }
 
 absl::StatusOr<std::shared_ptr<Session>> SessionManager::GetSession(
     const std::string& session_uri) {
-  absl::MutexLock lock(&mu_);
-  auto itr = session_map_.find(session_uri);
-  if (itr == session_map_.end()) {
-    return error::SessionNotFound(session_uri);
+  Shard& shard = ShardFor(session_uri);
+  std::shared_ptr<Session> session;
+  {
+    absl::ReaderMutexLock lock(&shard.mu);
+    auto itr = shard.session_map.find(session_uri);
+    if (itr == shard.session_map.end()) {
+      return error::SessionNotFound(session_uri);
+    }
+    session = itr->second;
   }
-  std::shared_ptr<Session> session = itr->second;
-  if (clock_->Now() - session->approximate_last_use_time() > absl::Hours(1)) {
-    // Delete inactive sessions after 1 hour.
-    session_map_.erase(session_uri);
+  if (clock_->Now() - session->approximate_last_use_time() > idle_timeout_) {
+    // The sweeper may not have caught up with this session yet.
+    absl::MutexLock lock(&shard.mu);
+    auto itr = shard.session_map.find(session_uri);
+    if (itr != shard.session_map.end() && itr->second == session) {
+      shard.session_map.erase(itr);
+    }
     return error::SessionNotFound(session_uri);
   }
   session->set_approximate_last_use_time(clock_->Now());
@@ -70,26 +105,80 @@ absl::StatusOr<std::shared_ptr<Session>> SessionManager::GetSession(
 
 absl::StatusOr<std::vector<std::shared_ptr<Session>>>
 SessionManager::ListSessions(const std::string& database_uri) const {
-  absl::MutexLock lock(&mu_);
   std::string session_uri_prefix = absl::StrCat(database_uri, "/");
   std::vector<std::shared_ptr<Session>> sessions;
-  for (auto itr = session_map_.lower_bound(session_uri_prefix);
-       itr != session_map_.end(); ++itr) {
-    if (absl::StartsWith(itr->first, session_uri_prefix)) {
+  for (const Shard& shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mu);
+    for (auto itr = shard.session_map.lower_bound(session_uri_prefix);
+         itr != shard.session_map.end() &&
+         absl::StartsWith(itr->first, session_uri_prefix);
+         ++itr) {
       sessions.push_back(itr->second);
-    } else {
-      return sessions;
     }
   }
+  // Keep listing sessions in URI order, as if they were in a single map.
+  std::sort(sessions.begin(), sessions.end(),
+            [](const std::shared_ptr<Session>& a,
+               const std::shared_ptr<Session>& b) {
+              return a->session_uri() < b->session_uri();
+            });
   return sessions;
 }
 
 absl::Status SessionManager::DeleteSession(const std::string& session_uri) {
-  absl::MutexLock lock(&mu_);
-  session_map_.erase(session_uri);
+  Shard& shard = ShardFor(session_uri);
+  absl::MutexLock lock(&shard.mu);
+  shard.session_map.erase(session_uri);
   return absl::OkStatus();
 }
 
+void SessionManager::PeriodicallyExpireIdleSessions(
+    absl::Duration sweep_interval) {
+  while (true) {
+    {
+      absl::MutexLock lock(&sweeper_mu_);
+      sweeper_mu_.AwaitWithTimeout(absl::Condition(&stop_sweeper_),
+                                   sweep_interval);
+      if (stop_sweeper_) {
+        return;
+      }
+    }
+    ExpireIdleSessions();
+  }
+}
+
+void SessionManager::ExpireIdleSessions() {
+  const absl::Time expire_before = clock_->Now() - idle_timeout_;
+  for (Shard& shard : shards_) {
+    bool done = false;
+    while (!done) {
+      absl::MutexLock lock(&shard.mu);
+      for (int i = 0; i < kSweepBatchSize; ++i) {
+        if (shard.expiry_queue.empty() ||
+            shard.expiry_queue.top().first >= expire_before) {
+          done = true;
+          break;
+        }
+        std::string session_uri = shard.expiry_queue.top().second;
+        shard.expiry_queue.pop();
+        auto itr = shard.session_map.find(session_uri);
+        if (itr == shard.session_map.end()) {
+          continue;
+        }
+        // Requests only update the session's last use time, so the queue entry
+        // is re-queued if the session has been used since it was queued.
+        const absl::Time last_use_time =
+            itr->second->approximate_last_use_time();
+        if (last_use_time >= expire_before) {
+          shard.expiry_queue.emplace(last_use_time, std::move(session_uri));
+          continue;
+        }
+        shard.session_map.erase(itr);
+      }
+    }
+  }
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
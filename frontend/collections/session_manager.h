@@ -17,9 +17,23 @@
 #ifndef STORAGE_CLOUD_SPANNER_EMULATOR_FRONTEND_SESSION_MANAGER_H_
 #define STORAGE_CLOUD_SPANNER_EMULATOR_FRONTEND_SESSION_MANAGER_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "common/clock.h"
 #include "frontend/entities/database.h"
 #include "frontend/entities/session.h"
@@ -31,40 +45,91 @@ namespace emulator {
 namespace frontend {
 
 // Session manager manages the set of active sessions in the emulator.
+//
+// Every request looks up its session here, so sessions are spread across
+// shards by a hash of their URI, each guarded by its own reader-writer mutex.
+// Concurrent lookups of different sessions, and of the same session, do not
+// contend with each other.
+//
+// Sessions which have not been used for idle_timeout are deleted by a
+// background sweeper, which visits sessions in order of their last use instead
+// of scanning every session on each request.
 class SessionManager {
  public:
-  explicit SessionManager(Clock* clock) : clock_(clock) {}
+  static constexpr absl::Duration kDefaultIdleTimeout = absl::Hours(1);
+  static constexpr absl::Duration kDefaultSweepInterval = absl::Minutes(1);
+
+  explicit SessionManager(
+      Clock* clock, absl::Duration idle_timeout = kDefaultIdleTimeout,
+      absl::Duration sweep_interval = kDefaultSweepInterval);
+  ~SessionManager();
 
   // Creates a session attached to the given database.
   absl::StatusOr<std::shared_ptr<Session>> CreateSession(
-      const Labels& labels, std::shared_ptr<Database> database)
-      ABSL_LOCKS_EXCLUDED(mu_);
+      const Labels& labels, std::shared_ptr<Database> database,
+      bool multiplexed = false);
 
   // Returns a session with the given URI.
   absl::StatusOr<std::shared_ptr<Session>> GetSession(
-      const std::string& session_uri) ABSL_LOCKS_EXCLUDED(mu_);
+      const std::string& session_uri);
 
   // Deletes a session with the given URI.
-  absl::Status DeleteSession(const std::string& session_uri)
-      ABSL_LOCKS_EXCLUDED(mu_);
+  absl::Status DeleteSession(const std::string& session_uri);
 
   // Lists sessions attached to the given database URI.
   absl::StatusOr<std::vector<std::shared_ptr<Session>>> ListSessions(
-      const std::string& database_uri) const ABSL_LOCKS_EXCLUDED(mu_);
+      const std::string& database_uri) const;
 
  private:
+  static constexpr int kNumShards = 16;
+
+  // The maximum number of expiry queue entries processed per acquisition of a
+  // shard mutex, so that a large sweep does not block requests for long.
+  static constexpr int kSweepBatchSize = 256;
+
+  // Min-heap of (last use time, session URI). The last use time of an entry
+  // may be stale, in which case the entry is pushed back when it is popped.
+  using ExpiryQueue =
+      std::priority_queue<std::pair<absl::Time, std::string>,
+                          std::vector<std::pair<absl::Time, std::string>>,
+                          std::greater<std::pair<absl::Time, std::string>>>;
+
+  struct Shard {
+    // Mutex to guard the map below.
+    mutable absl::Mutex mu;
+
+    // Map from session URI to session objects.
+    std::map<std::string, std::shared_ptr<Session>> session_map
+        ABSL_GUARDED_BY(mu);
+
+    // Sessions in session_map ordered by when they were last known to be used.
+    // Entries of deleted sessions are dropped once they reach the top.
+    ExpiryQueue expiry_queue ABSL_GUARDED_BY(mu);
+  };
+
+  Shard& ShardFor(const std::string& session_uri);
+
+  // Runs ExpireIdleSessions every sweep_interval until stop_sweeper_ is set.
+  void PeriodicallyExpireIdleSessions(absl::Duration sweep_interval);
+
+  // Deletes the sessions which have not been used for idle_timeout_.
+  void ExpireIdleSessions();
+
   // System-wide clock.
   Clock* clock_;
 
-  // Mutex to guard state below.
-  mutable absl::Mutex mu_;
-
   // Counter for session ids.
-  int next_session_id_ ABSL_GUARDED_BY(mu_) = 0;
+  std::atomic<int64_t> next_session_id_ = 0;
+
+  std::array<Shard, kNumShards> shards_;
+
+  // Sessions unused for this long are deleted.
+  const absl::Duration idle_timeout_;
 
-  // Map from session URI to session objects.
-  std::map<std::string, std::shared_ptr<Session>> session_map_
-      ABSL_GUARDED_BY(mu_);
+  // Background sweeper of idle sessions.
+  absl::Mutex sweeper_mu_;
+  bool stop_sweeper_ ABSL_GUARDED_BY(sweeper_mu_) = false;
+  std::thread sweeper_thread_;
 };
 
 }  // namespace frontend
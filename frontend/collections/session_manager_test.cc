@@ -17,6 +17,9 @@
 #include "frontend/collections/session_manager.h"
 
 #include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -84,6 +87,32 @@ TEST_F(SessionManagerTest, GetSessionFailsAfterVersionGcDuration) {
               zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
 }
 
+TEST_F(SessionManagerTest, SweeperDeletesIdleSessions) {
+  Clock clock;
+  SessionManager session_manager(&clock,
+                                 /*idle_timeout=*/absl::Milliseconds(200),
+                                 /*sweep_interval=*/absl::Milliseconds(1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Session> idle,
+                       session_manager.CreateSession(test_labels_, database_));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Session> active,
+                       session_manager.CreateSession(test_labels_, database_));
+
+  // Keep one session in use while waiting for the sweeper to delete the other,
+  // without ever looking the idle session up by its URI.
+  const std::string database_uri = database_->database_uri();
+  std::vector<std::shared_ptr<Session>> sessions;
+  for (int i = 0; i < 1000; ++i) {
+    ZETASQL_ASSERT_OK(session_manager.GetSession(active->session_uri()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(sessions, session_manager.ListSessions(database_uri));
+    if (sessions.size() == 1) break;
+    absl::SleepFor(absl::Milliseconds(5));
+  }
+  ASSERT_EQ(sessions.size(), 1);
+  EXPECT_EQ(sessions[0]->session_uri(), active->session_uri());
+  EXPECT_THAT(session_manager.GetSession(idle->session_uri()),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+}
+
 TEST_F(SessionManagerTest, DeleteSession) {
   ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Session> actual,
                        session_manager_.CreateSession(test_labels_, database_));
@@ -138,6 +167,43 @@ TEST_F(SessionManagerTest, ListSessionsWithSimilarPrefix) {
   }
 }
 
+TEST_F(SessionManagerTest, ListSessionsReturnsSessionsInUriOrder) {
+  int num = 50;
+  for (int i = 0; i < num; i++) {
+    ZETASQL_ASSERT_OK(session_manager_.CreateSession(test_labels_, database_));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::shared_ptr<Session>> actual,
+      session_manager_.ListSessions(database_->database_uri()));
+  ASSERT_EQ(actual.size(), num);
+  for (int i = 1; i < num; i++) {
+    EXPECT_LT(actual[i - 1]->session_uri(), actual[i]->session_uri());
+  }
+}
+
+TEST_F(SessionManagerTest, ConcurrentCreateAndGetSessions) {
+  constexpr int kNumThreads = 8;
+  constexpr int kSessionsPerThread = 20;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([this]() {
+      for (int i = 0; i < kSessionsPerThread; ++i) {
+        auto session = session_manager_.CreateSession(test_labels_, database_);
+        ASSERT_TRUE(session.ok());
+        EXPECT_TRUE(
+            session_manager_.GetSession((*session)->session_uri()).ok());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::shared_ptr<Session>> actual,
+      session_manager_.ListSessions(database_->database_uri()));
+  EXPECT_EQ(actual.size(), kNumThreads * kSessionsPerThread);
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
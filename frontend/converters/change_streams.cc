@@ -18,24 +18,30 @@
 
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/struct.pb.h"
 #include "google/spanner/v1/result_set.pb.h"
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/analyzer_options.h"
+#include "zetasql/public/json_value.h"
 #include "zetasql/public/simple_catalog.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/types/array_type.h"
 #include "zetasql/public/types/type.h"
 #include "zetasql/public/types/type_factory.h"
 #include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
 #include "backend/access/read.h"
+#include "backend/database/change_stream/change_stream_scan_cache.h"
 #include "backend/query/analyzer_options.h"
 #include "common/constants.h"
 #include "common/limits.h"
@@ -241,8 +247,39 @@ absl::StatusOr<zetasql::Value> CreateChildPartitionRecord(
   return final_child_partition_record;
 }
 
+// Memoizes JSON values parsed from the nested JSON strings stored in the change
+// stream data table. Column type JSONs and empty old values are repeated across
+// every record of a query, so parsing each distinct string once keeps the
+// per-record cost proportional to the mods rather than the column count.
+class NestedJsonCache {
+ public:
+  absl::StatusOr<zetasql::Value> Get(absl::string_view json_str) {
+    auto it = cache_.find(json_str);
+    if (it != cache_.end()) {
+      return it->second;
+    }
+    ZETASQL_ASSIGN_OR_RETURN(zetasql::Value value, Parse(json_str));
+    if (cache_.size() < kMaxCachedEntries) {
+      cache_.emplace(json_str, value);
+    }
+    return value;
+  }
+
+  static absl::StatusOr<zetasql::Value> Parse(absl::string_view json_str) {
+    ZETASQL_ASSIGN_OR_RETURN(zetasql::JSONValue json,
+                     zetasql::JSONValue::ParseJSONString(json_str));
+    return zetasql::Value::Json(std::move(json));
+  }
+
+ private:
+  // Bounds the memory held for queries over tables with many distinct types.
+  static constexpr int kMaxCachedEntries = 1024;
+
+  absl::flat_hash_map<std::string, zetasql::Value> cache_;
+};
+
 absl::StatusOr<zetasql::Value> CreateDataChangeRecord(
-    backend::RowCursor* cursor) {
+    backend::RowCursor* cursor, NestedJsonCache* json_cache) {
   const ChangeStreamOutputTypes* types = GetChangeStreamOutputTypes();
   std::vector<zetasql::Value> values;
   // The passed in cursor is guaranteed to have the shape of
@@ -285,16 +322,17 @@ absl::StatusOr<zetasql::Value> CreateDataChangeRecord(
   //     ordinal_position INT64>>
   zetasql::Value column_types_json_arr = cursor->ColumnValue(6);
   std::vector<zetasql::Value> column_types_arr_vals;
+  column_types_arr_vals.reserve(column_types_json_arr.num_elements());
   for (int i = 0; i < column_types_json_arr.num_elements(); i++) {
     zetasql::JSONValueConstRef curr_column_type =
         column_types_json_arr.element(i).json_value();
+    ZETASQL_ASSIGN_OR_RETURN(
+        zetasql::Value type_json,
+        json_cache->Get(curr_column_type.GetMember("type").GetString()));
     std::vector<zetasql::Value> curr_column_type_vals{
         zetasql::Value::String(
             curr_column_type.GetMember("name").GetString()),
-        zetasql::Value::Json(
-            zetasql::JSONValue::ParseJSONString(
-                curr_column_type.GetMember("type").GetString())
-                .value()),
+        std::move(type_json),
         zetasql::Value::Bool(
             curr_column_type.GetMember("is_primary_key").GetBoolean()),
         zetasql::Value::Int64(
@@ -302,7 +340,7 @@ absl::StatusOr<zetasql::Value> CreateDataChangeRecord(
     ZETASQL_ASSIGN_OR_RETURN(auto curr_column_type_val,
                      zetasql::Value::MakeStruct(types->column_types_struct,
                                                   curr_column_type_vals));
-    column_types_arr_vals.push_back(curr_column_type_val);
+    column_types_arr_vals.push_back(std::move(curr_column_type_val));
   }
   ZETASQL_ASSIGN_OR_RETURN(auto column_types_struct_array_val,
                    zetasql::Value::MakeArray(types->column_types_arr,
@@ -316,26 +354,28 @@ absl::StatusOr<zetasql::Value> CreateDataChangeRecord(
   //   old_values JSON>>
   std::vector<zetasql::Value> mods_arr_vals;
   zetasql::Value mods_json_arr = cursor->ColumnValue(7);
+  mods_arr_vals.reserve(mods_json_arr.num_elements());
   for (int i = 0; i < mods_json_arr.num_elements(); i++) {
     zetasql::JSONValueConstRef curr_mod =
         mods_json_arr.element(i).json_value();
-
-    std::vector<zetasql::Value> curr_mod_vals{
-        zetasql::Value::Json(zetasql::JSONValue::ParseJSONString(
-                                   curr_mod.GetMember("keys").GetString())
-                                   .value()),
-        zetasql::Value::Json(zetasql::JSONValue::ParseJSONString(
-                                   curr_mod.GetMember("new_values").GetString())
-                                   .value()),
-        zetasql::Value::Json(zetasql::JSONValue::ParseJSONString(
-                                   curr_mod.GetMember("old_values").GetString())
-                                   .value()),
-    };
+    // Keys and new values are distinct per mod, so they bypass the cache.
+    ZETASQL_ASSIGN_OR_RETURN(
+        zetasql::Value keys_json,
+        NestedJsonCache::Parse(curr_mod.GetMember("keys").GetString()));
+    ZETASQL_ASSIGN_OR_RETURN(
+        zetasql::Value new_values_json,
+        NestedJsonCache::Parse(curr_mod.GetMember("new_values").GetString()));
+    ZETASQL_ASSIGN_OR_RETURN(
+        zetasql::Value old_values_json,
+        json_cache->Get(curr_mod.GetMember("old_values").GetString()));
+    std::vector<zetasql::Value> curr_mod_vals{std::move(keys_json),
+                                                std::move(new_values_json),
+                                                std::move(old_values_json)};
 
     ZETASQL_ASSIGN_OR_RETURN(
         auto curr_mods_struct_val,
         zetasql::Value::MakeStruct(types->mods_struct, curr_mod_vals));
-    mods_arr_vals.push_back(curr_mods_struct_val);
+    mods_arr_vals.push_back(std::move(curr_mods_struct_val));
   }
 
   ZETASQL_ASSIGN_OR_RETURN(auto mods_struct_array_val,
@@ -420,14 +460,13 @@ ConvertChildPartitionRecordsToPartialResultSetProto(
   return responses;
 }
 
-absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
-ConvertDataTableRowCursorToPartialResultSetProto(backend::RowCursor* row_cursor,
-                                                 bool expect_metadata) {
-  spanner_api::ResultSet result_pb;
+absl::StatusOr<std::vector<backend::ChangeStreamScanCache::Record>>
+ConvertDataTableRowCursorToChangeRecords(backend::RowCursor* row_cursor) {
+  std::vector<backend::ChangeStreamScanCache::Record> records;
+  NestedJsonCache json_cache;
   while (row_cursor->Next()) {
-    auto* row_pb = result_pb.add_rows();
     ZETASQL_ASSIGN_OR_RETURN(auto data_change_record,
-                     CreateDataChangeRecord(row_cursor));
+                     CreateDataChangeRecord(row_cursor, &json_cache));
     ZETASQL_ASSIGN_OR_RETURN(
         auto change_record,
         CreateChangeRecord(
@@ -436,7 +475,21 @@ ConvertDataTableRowCursorToPartialResultSetProto(backend::RowCursor* row_cursor,
                 ChangeStreamOutputTypes::ReturningType::HEARTBEAT),
             CreateEmptyArrayForRecordType(
                 ChangeStreamOutputTypes::ReturningType::CHILD_PARTITIONS)));
-    ZETASQL_ASSIGN_OR_RETURN(*row_pb->add_values(), ValueToProto(change_record));
+    records.push_back({row_cursor->ColumnValue(1).ToTime(),
+                       std::move(change_record)});
+  }
+  return records;
+}
+
+absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
+ConvertChangeRecordsToPartialResultSetProto(
+    absl::Span<const backend::ChangeStreamScanCache::Record> records,
+    bool expect_metadata) {
+  spanner_api::ResultSet result_pb;
+  for (const auto& record : records) {
+    auto* row_pb = result_pb.add_rows();
+    ZETASQL_ASSIGN_OR_RETURN(*row_pb->add_values(),
+                     ValueToProto(record.change_record));
   }
   ZETASQL_ASSIGN_OR_RETURN(auto responses,
                    ChunkResultSet(result_pb, limits::kMaxStreamingChunkSize));
@@ -448,6 +501,14 @@ ConvertDataTableRowCursorToPartialResultSetProto(backend::RowCursor* row_cursor,
   return responses;
 }
 
+absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
+ConvertDataTableRowCursorToPartialResultSetProto(backend::RowCursor* row_cursor,
+                                                 bool expect_metadata) {
+  ZETASQL_ASSIGN_OR_RETURN(auto records,
+                   ConvertDataTableRowCursorToChangeRecords(row_cursor));
+  return ConvertChangeRecordsToPartialResultSetProto(records, expect_metadata);
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
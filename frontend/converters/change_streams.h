@@ -21,7 +21,10 @@
 #include <vector>
 
 #include "google/spanner/v1/result_set.pb.h"
+#include "absl/types/span.h"
 #include "backend/access/read.h"
+#include "backend/database/change_stream/change_stream_scan_cache.h"
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -45,6 +48,18 @@ absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
 ConvertHeartbeatTimestampToPartialResultSetProto(absl::Time timestamp,
                                                  bool expect_metadata = false);
 
+// Takes a row cursor from data table and convert each row into a data change
+// record, as kept by the change stream scan cache.
+absl::StatusOr<std::vector<backend::ChangeStreamScanCache::Record>>
+ConvertDataTableRowCursorToChangeRecords(backend::RowCursor* row_cursor);
+
+// Takes data change records and convert them into a vector of partial result
+// set.
+absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
+ConvertChangeRecordsToPartialResultSetProto(
+    absl::Span<const backend::ChangeStreamScanCache::Record> records,
+    bool expect_metadata = false);
+
 // Takes a row cursor from data table and convert all rows into a vector of
 // partial result set.
 absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
@@ -18,10 +18,12 @@
 
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
+#include "zetasql/public/json_value.h"
 #include "zetasql/public/types/type.h"
 #include "zetasql/public/types/type_factory.h"
 #include "zetasql/public/value.h"
@@ -29,6 +31,9 @@
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/time/clock.h"
 #include "frontend/converters/chunking.h"
@@ -766,6 +771,111 @@ TEST_F(ChangeStreamResultConverterTest,
   ASSERT_EQ(change_recods.data_change_records.size(), 1);
 }
 
+// Returns an array of the given JSON strings.
+absl::StatusOr<zetasql::Value> JsonArray(
+    const std::vector<std::string>& json_strs) {
+  std::vector<zetasql::Value> values;
+  for (const std::string& json_str : json_strs) {
+    ZETASQL_ASSIGN_OR_RETURN(zetasql::JSONValue json,
+                     zetasql::JSONValue::ParseJSONString(json_str));
+    values.push_back(Json(std::move(json)));
+  }
+  return zetasql::Value::MakeArray(JsonArrayType(), values);
+}
+
+// Returns a cursor over rows of a change stream data table with the given
+// column_types and mods.
+TestRowCursor DataTableRowCursor(
+    absl::Time commit_timestamp,
+    const std::vector<std::pair<zetasql::Value, zetasql::Value>>& records) {
+  const int num_records = records.size();
+  std::vector<std::vector<zetasql::Value>> rows;
+  for (int i = 0; i < num_records; ++i) {
+    rows.push_back({String("test_token"), Timestamp(commit_timestamp),
+                    String("test_id"), String(absl::StrCat("0000000", i)),
+                    Bool(i == num_records - 1), String("test_table"),
+                    records[i].first, records[i].second, String("INSERT"),
+                    String("NEW_VALUES"), Int64(num_records), Int64(1),
+                    String(""), Bool(false)});
+  }
+  return TestRowCursor(
+      {"partition_token", "commit_timestamp", "server_transaction_id",
+       "record_sequence", "is_last_record_in_transaction_in_partition",
+       "table_name", "column_types", "mods", "mod_type", "value_capture_type",
+       "number_of_records_in_transaction",
+       "number_of_partitions_in_transaction", "transaction_tag",
+       "is_system_transaction"},
+      {StringType(), TimestampType(), StringType(), StringType(), BoolType(),
+       StringType(), JsonArrayType(), JsonArrayType(), StringType(),
+       StringType(), Int64Type(), Int64Type(), StringType(), BoolType()},
+      rows);
+}
+
+constexpr char kColumnTypeJson[] =
+    R"({ "name": "UserId", "type": "{ \"code\": \"STRING\" }",
+         "is_primary_key": true, "ordinal_position": 1 })";
+
+TEST_F(ChangeStreamResultConverterTest,
+       ConvertDataChangeRecordsWithSameColumnTypes) {
+  // The nested type JSON of the column types is shared by the records, and
+  // must be rendered for each of them.
+  std::vector<std::pair<zetasql::Value, zetasql::Value>> records;
+  for (absl::string_view user : {"User1", "User2"}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(zetasql::Value column_types,
+                         JsonArray({kColumnTypeJson}));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        zetasql::Value mods,
+        JsonArray({absl::Substitute(
+            R"({ "keys": "{\"UserId\": \"$0\"}", "new_values": "{}",
+                 "old_values": "{}" })",
+            user)}));
+    records.emplace_back(std::move(column_types), std::move(mods));
+  }
+  TestRowCursor cursor = DataTableRowCursor(now_, records);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<PartialResultSet> results,
+      ConvertDataTableRowCursorToPartialResultSetProto(&cursor));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto result_set,
+      backend::test::MergePartialResultSets(results, /*columns_per_row=*/1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(test::ChangeStreamRecords change_records,
+                       test::GetChangeStreamRecordsFromResultSet(result_set));
+  ASSERT_EQ(change_records.data_change_records.size(), 2);
+  for (int i = 0; i < 2; ++i) {
+    const test::DataChangeRecord& record =
+        change_records.data_change_records[i];
+    EXPECT_THAT(record.column_types, EqualsProto(R"pb(
+                  values {
+                    list_value {
+                      values { string_value: "UserId" }
+                      values { string_value: "{\"code\":\"STRING\"}" }
+                      values { bool_value: true }
+                      values { string_value: "1" }
+                    }
+                  }
+                )pb"));
+    EXPECT_EQ(record.mods.values(0).list_value().values(0).string_value(),
+              absl::StrCat(R"({"UserId":"User)", i + 1, R"("})"));
+  }
+}
+
+TEST_F(ChangeStreamResultConverterTest,
+       ConvertDataChangeRecordWithInvalidNestedJsonFails) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      zetasql::Value column_types,
+      JsonArray({R"({ "name": "UserId", "type": "{ not json",
+                      "is_primary_key": true, "ordinal_position": 1 })"}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      zetasql::Value mods,
+      JsonArray({R"({ "keys": "{\"UserId\": \"User1\"}",
+                      "new_values": "{}", "old_values": "{}" })"}));
+  TestRowCursor cursor = DataTableRowCursor(
+      now_, {{std::move(column_types), std::move(mods)}});
+
+  EXPECT_FALSE(ConvertDataTableRowCursorToPartialResultSetProto(&cursor).ok());
+}
+
 }  // namespace
 
 }  // namespace frontend
@@ -17,12 +17,25 @@
 #include "frontend/converters/chunking.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/struct.pb.h"
+#include "google/spanner/v1/result_set.pb.h"
+#include "zetasql/public/value.h"
 #include "absl/memory/memory.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "common/errors.h"
+#include "frontend/converters/values.h"
 #include "zetasql/base/status_macros.h"
 
 namespace google {
@@ -30,6 +43,8 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+namespace spanner_api = ::google::spanner::v1;
+
 namespace {
 
 // UTF-8 is at most 4 bytes. The follow chart explains the format of each
@@ -72,234 +87,309 @@ int64_t RemovePartialUTF8(absl::string_view string, int64_t available) {
   return available;
 }
 
-// Constructs a set of PartialResultSets. Data will be chunked as necessary to
-// comply with the Cloud Spanner streaming chunk size limit. Only Strings and
-// Lists need to be chunked (Structs are not a valid column type and will return
-// an error if encountered).
-class ResultSetBuilder {
- public:
-  explicit ResultSetBuilder(
-      int64_t max_chunk_size,
-      std::vector<google::spanner::v1::PartialResultSet>* results)
-      : max_chunk_size_(max_chunk_size), results_(results) {
-    if (results_->empty()) {
-      results_->emplace_back();
-    }
-    current_chunk_size_ = results_->back().ByteSizeLong();
-    stack_.push_back(results_->back().mutable_values());
-  }
+// Returns the size of the padded base64 encoding of num_bytes bytes.
+int64_t Base64EncodedSize(int64_t num_bytes) { return (num_bytes + 2) / 3 * 4; }
 
-  // Adds the incoming value to the set of PartialResultSets chunking as
-  // necessary.
-  absl::Status AddValue(const protobuf::Value& value) {
-    // If the current size exceeds the limit, create a new chunk.
-    if (HasExceededChunkLimit()) {
-      StartNewResultSet();
-    }
+// Returns the serialized size of a protobuf::Value holding a string of the
+// given size, i.e. the tag and length of the string_value field and the string.
+int64_t StringValueSize(int64_t size) {
+  return 1 + google::protobuf::io::CodedOutputStream::VarintSize64(size) +
+         size;
+}
 
-    // Adds the value to the current result set. It will be chunked into pieces
-    // if the size of a result set would exceed max_chunk_size_. In that case,
-    // partial values will be added to the end of this result set and beginning
-    // of the next one. The partial results will be merged back together by the
-    // receiving client.
-    auto value_size = value.ByteSizeLong();
-    switch (value.kind_case()) {
-      case protobuf::Value::kListValue: {
-        // Check if list can fit into current chunk.
-        if (current_chunk_size_ + value_size <= max_chunk_size_) {
-          AddUnchunkedValue(value);
-        } else {
-          StartList();
-          for (const auto& list_value : value.list_value().values()) {
-            ZETASQL_RETURN_IF_ERROR(AddValue(list_value));
-          }
-          FinishList();
-        }
-        CheckListBoundary();
-        break;
-      }
-      case protobuf::Value::kStringValue: {
-        // Check if string can fit into current chunk.
-        if (current_chunk_size_ + value_size <= max_chunk_size_) {
-          AddUnchunkedValue(value);
-        } else {
-          AddString(value.string_value());
-        }
-        CheckStringBoundary();
-        break;
-      }
-      case protobuf::Value::kBoolValue:
-      case protobuf::Value::kNumberValue:
-      case protobuf::Value::kNullValue:
-        AddUnchunkedValue(value);
-        break;
+}  // namespace
 
-      default:
-        return error::Internal(absl::Substitute(
-            "Cannot convert value of type ($0) to a potentially "
-            "chunked PartialResultSet.",
-            value.GetTypeName()));
-    }
-    return absl::OkStatus();
+ResultSetChunker::ResultSetChunker(
+    int64_t max_chunk_size, bool use_arena,
+    std::function<absl::Status(spanner_api::PartialResultSet*)> emit)
+    : max_chunk_size_(max_chunk_size), emit_(std::move(emit)) {
+  if (use_arena) {
+    arena_ = std::make_unique<google::protobuf::Arena>();
   }
+  AllocateChunk();
+  current_chunk_size_ = chunk_->ByteSizeLong();
+  stack_.push_back(chunk_->mutable_values());
+}
 
- private:
-  ResultSetBuilder(const ResultSetBuilder&) = delete;
-  ResultSetBuilder& operator=(const ResultSetBuilder&) = delete;
+void ResultSetChunker::SetMetadata(
+    const spanner_api::ResultSetMetadata& metadata) {
+  *chunk_->mutable_metadata() = metadata;
+  current_chunk_size_ = chunk_->ByteSizeLong();
+}
 
-  bool HasExceededChunkLimit() {
-    return current_chunk_size_ >= max_chunk_size_;
+void ResultSetChunker::AllocateChunk() {
+  if (arena_ != nullptr) {
+    // The previous chunk (if any) has been emitted, so everything on the arena
+    // can be released at once.
+    arena_->Reset();
+    chunk_ = google::protobuf::Arena::CreateMessage<
+        spanner_api::PartialResultSet>(arena_.get());
+  } else {
+    owned_chunk_ = std::make_unique<spanner_api::PartialResultSet>();
+    chunk_ = owned_chunk_.get();
   }
+}
 
-  bool IsListOpen() { return stack_.size() > 1; }
-
-  // Adds a value as the next value without chunking. The value will be added to
-  // a list if there are any nested lists otherwise it will be added as the next
-  // value in results. Used for the fast path when it is known this will not
-  // need to be chunked.
-  void AddUnchunkedValue(const protobuf::Value& value) {
-    *stack_.back()->Add() = value;
-    current_chunk_size_ += value.ByteSizeLong();
+absl::Status ResultSetChunker::AddValue(const zetasql::Value& value) {
+  // If the current size exceeds the limit, create a new chunk.
+  if (HasExceededChunkLimit()) {
+    ZETASQL_RETURN_IF_ERROR(StartNewResultSet());
   }
 
-  // If a nested list ends at the boundary of the chunk, we need to make sure
-  // that an empty list is added at the beginning of the next chunk so they will
-  // be merged together. Otherwise it could end up being incorrectly merged with
-  // a disjoint list in the next chunk. We explicitly check for this to catch
-  // edge cases.
-  void CheckListBoundary() {
-    if (HasExceededChunkLimit() && IsListOpen()) {
-      StartNewResultSet();
-      // Add and empty list to merge with the last list from the previous
-      // chunk.
-      StartList();
-      FinishList();
+  // Strings and bytes which need to be split are split straight from the
+  // buffer of the value, which is shared with storage, rather than from a copy
+  // of their encoding.
+  if (!value.is_null()) {
+    if (value.type_kind() == zetasql::TypeKind::TYPE_STRING &&
+        current_chunk_size_ + StringValueSize(value.string_value().size()) >
+            max_chunk_size_) {
+      ZETASQL_RETURN_IF_ERROR(AddString(value.string_value()));
+      return CheckStringBoundary();
+    }
+    if (value.type_kind() == zetasql::TypeKind::TYPE_BYTES &&
+        current_chunk_size_ +
+                StringValueSize(Base64EncodedSize(value.bytes_value().size())) >
+            max_chunk_size_) {
+      ZETASQL_RETURN_IF_ERROR(AddBase64String(value.bytes_value()));
+      return CheckStringBoundary();
     }
   }
 
-  // If a string nested inside a list ends at the boundary of the chunk, we
-  // need to make sure that an empty string is added at the beginning of the
-  // next chunk so they will be merged together. Otherwise it could end up being
-  // incorrectly merged with another string in the next chunk. We explicitly
-  // check for this to catch edge cases.
-  void CheckStringBoundary() {
-    if (HasExceededChunkLimit() && IsListOpen()) {
-      StartNewResultSet();
-      // The last string ended within the previous chunk, so we don't want to
-      // concatenate it with the next string. Add an empty string to prevent
-      // this.
-      AddUnchunkedString("");
-    }
+  // Encode the value in place. This is the common case, since only strings and
+  // lists larger than the remaining space need to be split across chunks.
+  protobuf::Value* value_pb = stack_.back()->Add();
+  ZETASQL_RETURN_IF_ERROR(ValueToProto(value, value_pb));
+  const int64_t value_size = value_pb->ByteSizeLong();
+  if (current_chunk_size_ + value_size <= max_chunk_size_ ||
+      (value_pb->kind_case() != protobuf::Value::kListValue &&
+       value_pb->kind_case() != protobuf::Value::kStringValue)) {
+    current_chunk_size_ += value_size;
+    return absl::OkStatus();
   }
 
-  // Adds a string as the next value. The value will be added to a list if there
-  // are any nested lists otherwise it will be added as the next value in
-  // results.
-  void AddString(absl::string_view str) {
-    if (str.empty()) {
-      // Handle empty string case.
-      AddUnchunkedString("");
-      return;
-    }
+  // The value needs to be split, which is done from a copy of its encoding.
+  protobuf::Value large_value = *value_pb;
+  stack_.back()->RemoveLast();
+  return AddValue(large_value);
+}
 
-    while (!str.empty()) {
-      int64_t available = std::max(max_chunk_size_ - current_chunk_size_,
-                                   static_cast<int64_t>(0));
-      if (str.size() > available) {
-        // Strings are UTF-8 encoded. Not all client libraries support a split
-        // UTF-8 character. Flush the entire and not partial UTF-8 character.
-        if (available > 0 && IsPartialUTF8(str[available - 1])) {
-          available = RemovePartialUTF8(str, available);
+absl::Status ResultSetChunker::AddValue(const protobuf::Value& value) {
+  // If the current size exceeds the limit, create a new chunk.
+  if (HasExceededChunkLimit()) {
+    ZETASQL_RETURN_IF_ERROR(StartNewResultSet());
+  }
+
+  // Adds the value to the current result set. It will be chunked into pieces
+  // if the size of a result set would exceed max_chunk_size_. In that case,
+  // partial values will be added to the end of this result set and beginning
+  // of the next one. The partial results will be merged back together by the
+  // receiving client.
+  auto value_size = value.ByteSizeLong();
+  switch (value.kind_case()) {
+    case protobuf::Value::kListValue: {
+      // Check if list can fit into current chunk.
+      if (current_chunk_size_ + value_size <= max_chunk_size_) {
+        AddUnchunkedValue(value);
+      } else {
+        StartList();
+        for (const auto& list_value : value.list_value().values()) {
+          ZETASQL_RETURN_IF_ERROR(AddValue(list_value));
         }
-        // Chunk the string into pieces.
-        AddUnchunkedString(str.substr(0, available));
-        results_->back().set_chunked_value(true);
-        StartNewResultSet();
-        str.remove_prefix(available);
+        FinishList();
+      }
+      ZETASQL_RETURN_IF_ERROR(CheckListBoundary());
+      break;
+    }
+    case protobuf::Value::kStringValue: {
+      // Check if string can fit into current chunk.
+      if (current_chunk_size_ + value_size <= max_chunk_size_) {
+        AddUnchunkedValue(value);
       } else {
-        // String can fit into remaing space of current chunk.
-        AddUnchunkedString(str);
-        break;
+        ZETASQL_RETURN_IF_ERROR(AddString(value.string_value()));
       }
+      ZETASQL_RETURN_IF_ERROR(CheckStringBoundary());
+      break;
     }
+    case protobuf::Value::kBoolValue:
+    case protobuf::Value::kNumberValue:
+    case protobuf::Value::kNullValue:
+      AddUnchunkedValue(value);
+      break;
+
+    default:
+      return error::Internal(absl::Substitute(
+          "Cannot convert value of type ($0) to a potentially "
+          "chunked PartialResultSet.",
+          value.GetTypeName()));
   }
+  return absl::OkStatus();
+}
 
-  // Adds an unchunked string to the current result set or list.
-  void AddUnchunkedString(absl::string_view str) {
-    auto value = stack_.back()->Add();
-    value->mutable_string_value()->assign(str.data(), str.size());
-    current_chunk_size_ += value->ByteSizeLong();
+absl::Status ResultSetChunker::Finish() { return emit_(chunk_); }
+
+// Adds a value as the next value without chunking. The value will be added to
+// a list if there are any nested lists otherwise it will be added as the next
+// value in results. Used for the fast path when it is known this will not
+// need to be chunked.
+void ResultSetChunker::AddUnchunkedValue(const protobuf::Value& value) {
+  *stack_.back()->Add() = value;
+  current_chunk_size_ += value.ByteSizeLong();
+}
+
+// If a nested list ends at the boundary of the chunk, we need to make sure
+// that an empty list is added at the beginning of the next chunk so they will
+// be merged together. Otherwise it could end up being incorrectly merged with
+// a disjoint list in the next chunk. We explicitly check for this to catch
+// edge cases.
+absl::Status ResultSetChunker::CheckListBoundary() {
+  if (HasExceededChunkLimit() && IsListOpen()) {
+    ZETASQL_RETURN_IF_ERROR(StartNewResultSet());
+    // Add and empty list to merge with the last list from the previous
+    // chunk.
+    StartList();
+    FinishList();
   }
+  return absl::OkStatus();
+}
 
-  // Adds a list as the next value. The list will be nested in another list if
-  // there are any lists currently in the stack otherwise it will be added as
-  // the next value in results.
-  void StartList() {
-    auto value = stack_.back()->Add();
-    stack_.push_back(value->mutable_list_value()->mutable_values());
-    current_chunk_size_ += value->ByteSizeLong();
+// If a string nested inside a list ends at the boundary of the chunk, we
+// need to make sure that an empty string is added at the beginning of the
+// next chunk so they will be merged together. Otherwise it could end up being
+// incorrectly merged with another string in the next chunk. We explicitly
+// check for this to catch edge cases.
+absl::Status ResultSetChunker::CheckStringBoundary() {
+  if (HasExceededChunkLimit() && IsListOpen()) {
+    ZETASQL_RETURN_IF_ERROR(StartNewResultSet());
+    // The last string ended within the previous chunk, so we don't want to
+    // concatenate it with the next string. Add an empty string to prevent
+    // this.
+    AddUnchunkedString("");
   }
+  return absl::OkStatus();
+}
 
-  // Removes a list from the stack.
-  void FinishList() { stack_.pop_back(); }
-
-  // Adds a new partial result set to results. If list(s) are currently being
-  // processed it will create corresponding list(s) in the new chunk. The
-  // current result set will have chunked_value set to true if a list was
-  // currently being processed or if a string is split up.
-  void StartNewResultSet() {
-    if (IsListOpen()) {
-      // Always mark as chunked if inside a list.
-      results_->back().set_chunked_value(true);
-    }
-    size_t stack_depth = stack_.size() - 1;
-    stack_.clear();
-
-    results_->emplace_back();
-    stack_.push_back(results_->back().mutable_values());
-    for (int i = 0; i < stack_depth; ++i) {
-      auto list = stack_.back()->Add()->mutable_list_value();
-      stack_.push_back(list->mutable_values());
-    }
-    // Reset the size of the current result set.
-    current_chunk_size_ = results_->back().ByteSizeLong();
+// Adds a string as the next value. The value will be added to a list if there
+// are any nested lists otherwise it will be added as the next value in
+// results.
+absl::Status ResultSetChunker::AddString(absl::string_view str) {
+  if (str.empty()) {
+    // Handle empty string case.
+    AddUnchunkedString("");
+    return absl::OkStatus();
   }
 
-  // The size of the current chunk that is being appended to. This is an
-  // estimate of the current chunk size. This estimate should work fine in
-  // practice since the max chunk size is 1MB and the default message size limit
-  // is 4MB for gRPC. Since we do not explicitly track the metadata, our size
-  // estimate could be off by as much as a factor of 2. However, this shouldn't
-  // be a problem since it will be well below the gRPC limit.
-  int64_t current_chunk_size_;
+  while (!str.empty()) {
+    int64_t available = std::max(max_chunk_size_ - current_chunk_size_,
+                                 static_cast<int64_t>(0));
+    if (str.size() > available) {
+      // Strings are UTF-8 encoded. Not all client libraries support a split
+      // UTF-8 character. Flush the entire and not partial UTF-8 character.
+      if (available > 0 && IsPartialUTF8(str[available - 1])) {
+        available = RemovePartialUTF8(str, available);
+      }
+      // Chunk the string into pieces.
+      AddUnchunkedString(str.substr(0, available));
+      chunk_->set_chunked_value(true);
+      ZETASQL_RETURN_IF_ERROR(StartNewResultSet());
+      str.remove_prefix(available);
+    } else {
+      // String can fit into remaing space of current chunk.
+      AddUnchunkedString(str);
+      break;
+    }
+  }
+  return absl::OkStatus();
+}
 
-  // The maximum allowed size of a chunk.
-  int64_t max_chunk_size_;
+// Adds the base64 encoding of bytes as the next value, split exactly as
+// AddString would split the encoding. Each piece is encoded from the groups of
+// three bytes it overlaps, so the whole encoding is never materialized.
+absl::Status ResultSetChunker::AddBase64String(absl::string_view bytes) {
+  const int64_t encoded_size = Base64EncodedSize(bytes.size());
+  if (encoded_size == 0) {
+    AddUnchunkedString("");
+    return absl::OkStatus();
+  }
 
-  // The list of PartialResultSets that store the resulting chunks.
-  std::vector<::google::spanner::v1::PartialResultSet>* results_;
+  std::string encoded_piece;
+  int64_t pos = 0;
+  while (true) {
+    int64_t available = std::max(max_chunk_size_ - current_chunk_size_,
+                                 static_cast<int64_t>(0));
+    const int64_t length = std::min(encoded_size - pos, available);
+    const int64_t begin_group = pos / 4;
+    const int64_t end_group = (pos + length + 3) / 4;
+    absl::Base64Escape(
+        bytes.substr(begin_group * 3, (end_group - begin_group) * 3),
+        &encoded_piece);
+    AddUnchunkedString(absl::string_view(encoded_piece)
+                           .substr(pos - begin_group * 4, length));
+    pos += length;
+    if (pos == encoded_size) {
+      break;
+    }
+    chunk_->set_chunked_value(true);
+    ZETASQL_RETURN_IF_ERROR(StartNewResultSet());
+  }
+  return absl::OkStatus();
+}
 
-  // The list stack is used to track nested lists. When a result set is chunked
-  // all current lists need to be truncated and matching versions created in the
-  // next chunk.
-  std::vector<google::protobuf::RepeatedPtrField<protobuf::Value>*> stack_;
-};
+// Adds an unchunked string to the current result set or list.
+void ResultSetChunker::AddUnchunkedString(absl::string_view str) {
+  auto value = stack_.back()->Add();
+  value->mutable_string_value()->assign(str.data(), str.size());
+  current_chunk_size_ += value->ByteSizeLong();
+}
 
-}  // namespace
+// Adds a list as the next value. The list will be nested in another list if
+// there are any lists currently in the stack otherwise it will be added as
+// the next value in results.
+void ResultSetChunker::StartList() {
+  auto value = stack_.back()->Add();
+  stack_.push_back(value->mutable_list_value()->mutable_values());
+  current_chunk_size_ += value->ByteSizeLong();
+}
 
-absl::StatusOr<std::vector<google::spanner::v1::PartialResultSet>>
-ChunkResultSet(const google::spanner::v1::ResultSet& set,
-               int64_t max_chunk_size) {
-  std::vector<google::spanner::v1::PartialResultSet> results;
-  results.emplace_back();
-  *results.front().mutable_metadata() = set.metadata();
+// Emits the current chunk and starts a new one. If list(s) are currently being
+// processed it will create corresponding list(s) in the new chunk. The
+// current chunk will have chunked_value set to true if a list was currently
+// being processed or if a string is split up.
+absl::Status ResultSetChunker::StartNewResultSet() {
+  if (IsListOpen()) {
+    // Always mark as chunked if inside a list.
+    chunk_->set_chunked_value(true);
+  }
+  size_t stack_depth = stack_.size() - 1;
+  stack_.clear();
+
+  ZETASQL_RETURN_IF_ERROR(emit_(chunk_));
+  AllocateChunk();
+  stack_.push_back(chunk_->mutable_values());
+  for (int i = 0; i < stack_depth; ++i) {
+    auto list = stack_.back()->Add()->mutable_list_value();
+    stack_.push_back(list->mutable_values());
+  }
+  // Reset the size of the current result set.
+  current_chunk_size_ = chunk_->ByteSizeLong();
+  return absl::OkStatus();
+}
 
-  ResultSetBuilder builder(max_chunk_size, &results);
+absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
+ChunkResultSet(const spanner_api::ResultSet& set, int64_t max_chunk_size) {
+  std::vector<spanner_api::PartialResultSet> results;
+  ResultSetChunker chunker(
+      max_chunk_size, /*use_arena=*/false,
+      [&results](spanner_api::PartialResultSet* chunk) {
+        results.push_back(std::move(*chunk));
+        return absl::OkStatus();
+      });
+  chunker.SetMetadata(set.metadata());
   for (const auto& row : set.rows()) {
     for (const auto& value : row.values()) {
-      ZETASQL_RETURN_IF_ERROR(builder.AddValue(value));
+      ZETASQL_RETURN_IF_ERROR(chunker.AddValue(value));
     }
   }
+  ZETASQL_RETURN_IF_ERROR(chunker.Finish());
   return results;
 }
 
@@ -17,10 +17,16 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_CHUNKING_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_CHUNKING_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 
+#include "google/protobuf/arena.h"
 #include "google/protobuf/struct.pb.h"
 #include "google/spanner/v1/result_set.pb.h"
+#include "zetasql/public/value.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/status/status.h"
@@ -30,6 +36,141 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+// Incrementally builds a sequence of PartialResultSets from the values of a
+// result, chunking them as necessary to comply with the Cloud Spanner streaming
+// chunk size limit. Each resulting piece will have a size <= max_chunk_size.
+//
+// ZetaSQL values are encoded directly into the chunk being filled, so values
+// which fit into it are never copied. Each completed chunk is passed to emit as
+// soon as the next one is started, so only one chunk is held in memory at a
+// time. If use_arena is set, chunks are allocated on an arena owned by the
+// chunker, which is reset after every chunk is emitted. In that case a chunk is
+// only valid for the duration of the emit call, and emit must copy rather than
+// move from it to keep it.
+//
+// Usage:
+//     ResultSetChunker chunker(max_chunk_size, /*use_arena=*/true, emit);
+//     chunker.SetMetadata(metadata);
+//     for (const zetasql::Value& value : values) {
+//       ZETASQL_RETURN_IF_ERROR(chunker.AddValue(value));
+//     }
+//     ZETASQL_RETURN_IF_ERROR(chunker.Finish());
+class ResultSetChunker {
+ public:
+  ResultSetChunker(
+      int64_t max_chunk_size, bool use_arena,
+      std::function<absl::Status(google::spanner::v1::PartialResultSet*)> emit);
+
+  ResultSetChunker(const ResultSetChunker&) = delete;
+  ResultSetChunker& operator=(const ResultSetChunker&) = delete;
+
+  // Sets the metadata of the result. Must be called before any value is added.
+  void SetMetadata(const google::spanner::v1::ResultSetMetadata& metadata);
+
+  // Converts a ZetaSQL value to its proto encoding and adds it as the next
+  // value of the result.
+  absl::Status AddValue(const zetasql::Value& value);
+
+  // Adds an already encoded value as the next value of the result.
+  absl::Status AddValue(const google::protobuf::Value& value);
+
+  // Emits the last chunk. No values may be added afterwards.
+  absl::Status Finish();
+
+  // Changes the maximum size of chunks. Intended to be called from emit, in
+  // which case it applies from the next chunk on.
+  void set_max_chunk_size(int64_t max_chunk_size) {
+    max_chunk_size_ = max_chunk_size;
+  }
+
+ private:
+  bool HasExceededChunkLimit() const {
+    return current_chunk_size_ >= max_chunk_size_;
+  }
+
+  bool IsListOpen() const { return stack_.size() > 1; }
+
+  // Allocates an empty chunk to fill.
+  void AllocateChunk();
+
+  void AddUnchunkedValue(const google::protobuf::Value& value);
+  absl::Status CheckListBoundary();
+  absl::Status CheckStringBoundary();
+  absl::Status AddString(absl::string_view str);
+  absl::Status AddBase64String(absl::string_view bytes);
+  void AddUnchunkedString(absl::string_view str);
+  void StartList();
+  void FinishList() { stack_.pop_back(); }
+  absl::Status StartNewResultSet();
+
+  // The maximum allowed size of a chunk.
+  int64_t max_chunk_size_;
+
+  // Called with each completed chunk.
+  std::function<absl::Status(google::spanner::v1::PartialResultSet*)> emit_;
+
+  // The arena chunks are allocated on, if any.
+  std::unique_ptr<google::protobuf::Arena> arena_;
+
+  // The chunk being filled. Owned by arena_ if it is set and by owned_chunk_
+  // otherwise.
+  google::spanner::v1::PartialResultSet* chunk_ = nullptr;
+  std::unique_ptr<google::spanner::v1::PartialResultSet> owned_chunk_;
+
+  // The size of the current chunk that is being appended to. This is an
+  // estimate of the current chunk size. This estimate should work fine in
+  // practice since the max chunk size is 1MB and the default message size limit
+  // is 4MB for gRPC. Since we do not explicitly track the metadata, our size
+  // estimate could be off by as much as a factor of 2. However, this shouldn't
+  // be a problem since it will be well below the gRPC limit.
+  int64_t current_chunk_size_ = 0;
+
+  // The list stack is used to track nested lists. When a result set is chunked
+  // all current lists need to be truncated and matching versions created in the
+  // next chunk.
+  std::vector<google::protobuf::RepeatedPtrField<google::protobuf::Value>*>
+      stack_;
+};
+
+// Chooses the size of the chunks of a result stream, between a minimum and a
+// maximum size, from how fast the client consumes them. Streams start with the
+// minimum size, so that the first rows reach the client early. The size
+// doubles with every chunk sent without waiting for earlier ones to be
+// written, which cuts the per-message overhead of fast clients, and halves
+// with every chunk which waited, which bounds the memory buffered for slow
+// ones. A minimum size which is not positive fixes the size at the maximum.
+//
+// This class is not thread safe.
+class StreamingChunkSizer {
+ public:
+  // Chunks need room for the nested lists which a chunked value continues, so
+  // minimum sizes are raised to at least this.
+  static constexpr int64_t kSmallestChunkSize = 1024;
+
+  StreamingChunkSizer(int64_t min_chunk_size, int64_t max_chunk_size)
+      : min_chunk_size_(
+            min_chunk_size > 0
+                ? std::clamp(min_chunk_size, kSmallestChunkSize, max_chunk_size)
+                : max_chunk_size),
+        max_chunk_size_(max_chunk_size),
+        chunk_size_(min_chunk_size_) {}
+
+  // The size of the next chunk.
+  int64_t chunk_size() const { return chunk_size_; }
+
+  // Records that a chunk was sent, and whether sending it had to wait for the
+  // chunks before it to be written.
+  void RecordSend(bool waited) {
+    chunk_size_ = waited ? std::max(chunk_size_ / 2, min_chunk_size_)
+                         : std::min(chunk_size_ * 2, max_chunk_size_);
+  }
+
+ private:
+  const int64_t min_chunk_size_;
+  const int64_t max_chunk_size_;
+  int64_t chunk_size_;
+};
+
 // Takes a ResultSet and chunks it into smaller pieces as necessary. Each
 // resulting piece will have a size <= max_chunk_size. Returns an ordered list
 // of PartialResultSets or an error.
@@ -31,6 +31,7 @@
 #include "absl/time/time.h"
 #include "common/limits.h"
 #include "frontend/converters/reads.h"
+#include "frontend/converters/values.h"
 #include "tests/common/chunking.h"
 #include "tests/common/row_cursor.h"
 #include "absl/status/status.h"
@@ -710,6 +711,130 @@ TEST(ChunkingTest, RandomChunking) {
   }
 }
 
+TEST(ChunkingTest, ChunkerEncodesValuesLikeChunkResultSet) {
+  const size_t kChunkSize = 40;
+  std::vector<zetasql::Value> values = {
+      zetasql::values::Int64(1),
+      zetasql::values::String(std::string(100, 'a')),
+      zetasql::values::NullString(),
+      zetasql::values::Int64Array({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}),
+      zetasql::values::String("b"),
+  };
+
+  ResultSet result;
+  auto* row = result.add_rows();
+  for (const zetasql::Value& value : values) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(*row->add_values(), ValueToProto(value));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<PartialResultSet> expected,
+                       ChunkResultSet(result, kChunkSize));
+
+  std::vector<PartialResultSet> results;
+  ResultSetChunker chunker(kChunkSize, /*use_arena=*/true,
+                           [&results](PartialResultSet* chunk) {
+                             results.push_back(*chunk);
+                             return absl::OkStatus();
+                           });
+  chunker.SetMetadata(result.metadata());
+  for (const zetasql::Value& value : values) {
+    ZETASQL_ASSERT_OK(chunker.AddValue(value));
+  }
+  ZETASQL_ASSERT_OK(chunker.Finish());
+
+  ASSERT_EQ(results.size(), expected.size());
+  for (int i = 0; i < results.size(); ++i) {
+    EXPECT_THAT(results[i], test::EqualsProto(expected[i]));
+  }
+}
+
+TEST(ChunkingTest, ChunkerSplitsLargeBytesLikeChunkResultSet) {
+  std::string bytes;
+  for (int i = 0; i < 200; ++i) {
+    bytes.push_back(static_cast<char>(i * 7));
+  }
+
+  // Splits encodings which end with each amount of padding, at chunk sizes
+  // which split them both on and off the boundaries of groups of bytes.
+  for (int num_bytes : {0, 1, 2, 100, 101, 102, 200}) {
+    for (size_t chunk_size : {20, 29, 40}) {
+      const zetasql::Value value =
+          zetasql::values::Bytes(bytes.substr(0, num_bytes));
+      ResultSet result;
+      auto* row = result.add_rows();
+      ZETASQL_ASSERT_OK_AND_ASSIGN(*row->add_values(), ValueToProto(value));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(*row->add_values(),
+                           ValueToProto(zetasql::values::String("b")));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<PartialResultSet> expected,
+                           ChunkResultSet(result, chunk_size));
+
+      std::vector<PartialResultSet> results;
+      ResultSetChunker chunker(chunk_size, /*use_arena=*/true,
+                               [&results](PartialResultSet* chunk) {
+                                 results.push_back(*chunk);
+                                 return absl::OkStatus();
+                               });
+      ZETASQL_ASSERT_OK(chunker.AddValue(value));
+      ZETASQL_ASSERT_OK(chunker.AddValue(zetasql::values::String("b")));
+      ZETASQL_ASSERT_OK(chunker.Finish());
+
+      ASSERT_EQ(results.size(), expected.size());
+      for (int i = 0; i < results.size(); ++i) {
+        EXPECT_THAT(results[i], test::EqualsProto(expected[i]));
+      }
+    }
+  }
+}
+
+TEST(ChunkingTest, ChunkerStopsOnEmitError) {
+  ResultSetChunker chunker(/*max_chunk_size=*/10, /*use_arena=*/true,
+                           [](PartialResultSet* chunk) {
+                             return absl::CancelledError("stream closed");
+                           });
+  EXPECT_THAT(chunker.AddValue(zetasql::values::String(std::string(50, 'a'))),
+              StatusIs(absl::StatusCode::kCancelled));
+}
+
+TEST(ChunkingTest, ChunkerAppliesNewMaxChunkSizeToNextChunk) {
+  std::vector<int64_t> chunk_sizes;
+  ResultSetChunker* chunker_ptr = nullptr;
+  ResultSetChunker chunker(/*max_chunk_size=*/100, /*use_arena=*/true,
+                           [&](PartialResultSet* chunk) {
+                             chunk_sizes.push_back(chunk->ByteSizeLong());
+                             chunker_ptr->set_max_chunk_size(400);
+                             return absl::OkStatus();
+                           });
+  chunker_ptr = &chunker;
+  for (int i = 0; i < 100; ++i) {
+    ZETASQL_ASSERT_OK(chunker.AddValue(zetasql::values::Double(i)));
+  }
+  ZETASQL_ASSERT_OK(chunker.Finish());
+
+  // Only the first chunk is limited to the initial size. Chunks end with the
+  // first value past the limit.
+  ASSERT_GE(chunk_sizes.size(), 3);
+  EXPECT_LT(chunk_sizes[0], 150);
+  EXPECT_GT(chunk_sizes[1], 350);
+  EXPECT_LT(chunk_sizes[1], 450);
+}
+
+TEST(ChunkingTest, SizerGrowsForFastStreamsAndShrinksForSlowOnes) {
+  StreamingChunkSizer sizer(/*min_chunk_size=*/4096, /*max_chunk_size=*/32768);
+  EXPECT_EQ(sizer.chunk_size(), 4096);
+  for (int64_t expected_size : {8192, 16384, 32768, 32768}) {
+    sizer.RecordSend(/*waited=*/false);
+    EXPECT_EQ(sizer.chunk_size(), expected_size);
+  }
+  for (int64_t expected_size : {16384, 8192, 4096, 4096}) {
+    sizer.RecordSend(/*waited=*/true);
+    EXPECT_EQ(sizer.chunk_size(), expected_size);
+  }
+
+  // Without a minimum, the size stays at the maximum.
+  StreamingChunkSizer fixed(/*min_chunk_size=*/0, /*max_chunk_size=*/32768);
+  fixed.RecordSend(/*waited=*/true);
+  EXPECT_EQ(fixed.chunk_size(), 32768);
+}
+
 }  // namespace
 
 }  // namespace frontend
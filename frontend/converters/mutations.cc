@@ -17,6 +17,7 @@
 #include "frontend/converters/mutations.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,6 +27,8 @@
 #include "google/spanner/v1/result_set.pb.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "backend/access/write.h"
 #include "backend/datamodel/key.h"
@@ -50,6 +53,53 @@ namespace spanner_api = ::google::spanner::v1;
 
 namespace {
 
+// Decodes a value of a column of a Write. Decoders are picked once per Write
+// for each of its columns, so that every cell of the column skips the type
+// switch of ValueFromProto.
+using ValueDecoder = absl::StatusOr<zetasql::Value> (*)(
+    const google::protobuf::Value& value_pb, const zetasql::Type* type);
+
+// The decoders of the most common column types only handle well formed values,
+// and leave every other value to ValueFromProto, which reports the error.
+absl::StatusOr<zetasql::Value> DecodeBool(
+    const google::protobuf::Value& value_pb, const zetasql::Type* type) {
+  if (value_pb.kind_case() == google::protobuf::Value::kBoolValue) {
+    return zetasql::values::Bool(value_pb.bool_value());
+  }
+  return ValueFromProto(value_pb, type);
+}
+
+absl::StatusOr<zetasql::Value> DecodeInt64(
+    const google::protobuf::Value& value_pb, const zetasql::Type* type) {
+  int64_t num = 0;
+  if (value_pb.kind_case() == google::protobuf::Value::kStringValue &&
+      absl::SimpleAtoi(value_pb.string_value(), &num)) {
+    return zetasql::values::Int64(num);
+  }
+  return ValueFromProto(value_pb, type);
+}
+
+absl::StatusOr<zetasql::Value> DecodeString(
+    const google::protobuf::Value& value_pb, const zetasql::Type* type) {
+  if (value_pb.kind_case() == google::protobuf::Value::kStringValue) {
+    return zetasql::values::String(value_pb.string_value());
+  }
+  return ValueFromProto(value_pb, type);
+}
+
+ValueDecoder DecoderForType(const zetasql::Type* type) {
+  switch (type->kind()) {
+    case zetasql::TypeKind::TYPE_BOOL:
+      return DecodeBool;
+    case zetasql::TypeKind::TYPE_INT64:
+      return DecodeInt64;
+    case zetasql::TypeKind::TYPE_STRING:
+      return DecodeString;
+    default:
+      return ValueFromProto;
+  }
+}
+
 absl::Status WriteFromProto(const backend::Schema& schema,
                             const spanner_api::Mutation::Write& write_pb,
                             backend::MutationOpType op_type,
@@ -65,12 +115,14 @@ absl::Status WriteFromProto(const backend::Schema& schema,
   // Check that columns exist within table and get the column names.
   std::vector<const backend::Column*> columns(write_pb.columns_size());
   std::vector<std::string> column_names(write_pb.columns_size());
+  std::vector<ValueDecoder> decoders(write_pb.columns_size());
   for (int i = 0; i < write_pb.columns_size(); ++i) {
     columns[i] = table->FindColumn(write_pb.columns(i));
     if (columns[i] == nullptr) {
       return error::ColumnNotFound(write_pb.table(), write_pb.columns(i));
     }
     column_names[i] = columns[i]->Name();
+    decoders[i] = DecoderForType(columns[i]->GetType());
   }
 
   if (write_pb.values_size() == 0) {
@@ -79,15 +131,23 @@ absl::Status WriteFromProto(const backend::Schema& schema,
 
   // Populate the list of values for the rows that will be written to.
   std::vector<backend::ValueList> value_list;
+  value_list.reserve(write_pb.values_size());
   for (const google::protobuf::ListValue& values : write_pb.values()) {
     backend::ValueList row_values;
     if (values.values_size() != columns.size()) {
       return error::MutationColumnAndValueSizeMismatch(columns.size(),
                                                        values.values_size());
     }
+    row_values.reserve(columns.size());
     for (int i = 0; i < columns.size(); ++i) {
+      const google::protobuf::Value& value_pb = values.values(i);
+      const zetasql::Type* type = columns[i]->GetType();
+      if (value_pb.kind_case() == google::protobuf::Value::kNullValue) {
+        row_values.push_back(zetasql::values::Null(type));
+        continue;
+      }
       ZETASQL_ASSIGN_OR_RETURN(row_values.emplace_back(),
-                       ValueFromProto(values.values(i), columns[i]->GetType()));
+                       decoders[i](value_pb, type));
     }
     value_list.push_back(std::move(row_values));
   }
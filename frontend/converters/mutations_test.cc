@@ -173,6 +173,53 @@ TEST_F(AccessProtosTest, CannotCreateMutationFromInvalidProto) {
               StatusIs(absl::StatusCode::kNotFound));
 }
 
+TEST_F(AccessProtosTest, DecodesEveryValueOfAColumnWithItsType) {
+  google::protobuf::RepeatedPtrField<google::spanner::v1::Mutation> mutation_pb;
+  google::spanner::v1::Mutation::Write insert = PARSE_TEXT_PROTO(R"(
+    table: "test_table"
+    columns: "int64_col"
+    columns: "string_col"
+    values {
+      values { string_value: "1" }
+      values { string_value: "a" }
+    }
+    values {
+      values { string_value: "2" }
+      values { null_value: NULL_VALUE }
+    }
+  )");
+  *mutation_pb.Add()->mutable_insert() = insert;
+
+  backend::Mutation mutation;
+  ZETASQL_ASSERT_OK(MutationFromProto(*schema_.get(), mutation_pb, &mutation));
+  ASSERT_EQ(mutation.ops().size(), 1);
+  EXPECT_THAT(mutation.ops()[0].rows,
+              testing::ElementsAre(
+                  testing::ElementsAre(zetasql::values::Int64(1),
+                                       zetasql::values::String("a")),
+                  testing::ElementsAre(zetasql::values::Int64(2),
+                                       zetasql::values::NullString())));
+}
+
+TEST_F(AccessProtosTest, CannotCreateMutationFromMalformedValues) {
+  google::protobuf::RepeatedPtrField<google::spanner::v1::Mutation> mutation_pb;
+  google::spanner::v1::Mutation::Write insert = PARSE_TEXT_PROTO(R"(
+    table: "test_table"
+    columns: "int64_col"
+    values { values { string_value: "not a number" } }
+  )");
+  *mutation_pb.Add()->mutable_insert() = insert;
+
+  backend::Mutation mutation;
+  EXPECT_THAT(MutationFromProto(*schema_.get(), mutation_pb, &mutation),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+
+  insert.mutable_values(0)->mutable_values(0)->set_bool_value(true);
+  *mutation_pb.Mutable(0)->mutable_insert() = insert;
+  EXPECT_THAT(MutationFromProto(*schema_.get(), mutation_pb, &mutation),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
 }  // namespace
 
 }  // namespace frontend
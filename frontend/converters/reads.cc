@@ -16,7 +16,12 @@
 
 #include "frontend/converters/reads.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/struct.pb.h"
@@ -27,6 +32,9 @@
 #include "zetasql/public/value.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "backend/access/read.h"
 #include "backend/access/write.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
@@ -38,6 +46,8 @@
 #include "backend/transaction/options.h"
 #include "common/errors.h"
 #include "common/limits.h"
+#include "common/metrics.h"
+#include "common/tracing.h"
 #include "frontend/converters/chunking.h"
 #include "frontend/converters/keys.h"
 #include "frontend/converters/partition.h"
@@ -45,6 +55,7 @@
 #include "frontend/converters/types.h"
 #include "frontend/converters/values.h"
 #include "frontend/proto/partition_token.pb.h"
+#include "frontend/proto/resume_token.pb.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
@@ -57,10 +68,22 @@ namespace spanner_api = ::google::spanner::v1;
 
 namespace {
 
-absl::Status ResultSetMetadataToProto(backend::RowCursor* cursor,
-                                      v1::ResultSetMetadata* metadata_pb) {
+// The number of rows read from a row cursor at a time.
+constexpr int64_t kRowsPerBatch = 256;
+
+// Returns the number of rows to read in the next batch of a conversion which
+// has converted row_count rows, stopping at limit if it is positive.
+int64_t RowsInNextBatch(int limit, int64_t row_count) {
+  if (limit <= 0) {
+    return kRowsPerBatch;
+  }
+  return std::min(kRowsPerBatch, limit - row_count);
+}
+
+absl::Status RowTypeToProto(backend::RowCursor* cursor,
+                            v1::StructType* row_type_pb) {
   for (int i = 0; i < cursor->NumColumns(); ++i) {
-    auto* field_pb = metadata_pb->mutable_row_type()->add_fields();
+    auto* field_pb = row_type_pb->add_fields();
     field_pb->set_name(cursor->ColumnName(i));
     ZETASQL_RETURN_IF_ERROR(
         TypeToProto(cursor->ColumnType(i), field_pb->mutable_type()))
@@ -70,6 +93,15 @@ absl::Status ResultSetMetadataToProto(backend::RowCursor* cursor,
   return absl::OkStatus();
 }
 
+absl::Status ResultSetMetadataToProto(backend::RowCursor* cursor,
+                                      v1::ResultSetMetadata* metadata_pb,
+                                      ResultSetMetadataCache* metadata_cache) {
+  if (metadata_cache != nullptr) {
+    return metadata_cache->GetRowType(cursor, metadata_pb);
+  }
+  return RowTypeToProto(cursor, metadata_pb->mutable_row_type());
+}
+
 absl::Status ValidateStaleness(absl::Duration staleness) {
   if (staleness < absl::ZeroDuration()) {
     return error::StalenessMustBeNonNegative();
@@ -130,6 +162,27 @@ absl::Status ValidatePartitionToken(
   return absl::OkStatus();
 }
 
+// Returns the resume token for a stream reading at read_timestamp which has
+// sent value_count complete values.
+std::string EncodeResumeToken(int64_t value_count,
+                              std::optional<absl::Time> read_timestamp) {
+  ResumeToken token;
+  token.set_value_count(value_count);
+  if (read_timestamp.has_value()) {
+    token.set_read_timestamp_micros(absl::ToUnixMicros(*read_timestamp));
+  }
+  return token.SerializeAsString();
+}
+
+absl::StatusOr<ResumeToken> DecodeResumeToken(absl::string_view resume_token) {
+  ResumeToken token;
+  if (!token.ParseFromString(std::string(resume_token)) ||
+      token.value_count() < 0) {
+    return error::InvalidResumeToken();
+  }
+  return token;
+}
+
 }  // namespace
 
 absl::StatusOr<backend::ReadOnlyOptions> ReadOnlyOptionsFromProto(
@@ -177,6 +230,45 @@ absl::StatusOr<backend::ReadOnlyOptions> ReadOnlyOptionsFromProto(
   return options;
 }
 
+absl::Status PinSelectorToResumeToken(
+    absl::string_view resume_token,
+    spanner_api::TransactionSelector* selector) {
+  if (resume_token.empty()) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(ResumeToken token, DecodeResumeToken(resume_token));
+  if (!token.has_read_timestamp_micros()) {
+    return absl::OkStatus();
+  }
+  // No selector is a single-use strong read. Other transactions keep their
+  // read timestamp, which ValidateResumeTokenReadTimestamp checks.
+  if (selector->selector_case() !=
+          spanner_api::TransactionSelector::SELECTOR_NOT_SET &&
+      !selector->single_use().has_read_only()) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      *selector->mutable_single_use()
+           ->mutable_read_only()
+           ->mutable_read_timestamp(),
+      TimestampToProto(absl::FromUnixMicros(token.read_timestamp_micros())));
+  return absl::OkStatus();
+}
+
+absl::Status ValidateResumeTokenReadTimestamp(
+    absl::string_view resume_token, std::optional<absl::Time> read_timestamp) {
+  if (resume_token.empty()) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(ResumeToken token, DecodeResumeToken(resume_token));
+  if (token.has_read_timestamp_micros() != read_timestamp.has_value() ||
+      (read_timestamp.has_value() &&
+       token.read_timestamp_micros() != absl::ToUnixMicros(*read_timestamp))) {
+    return error::InvalidResumeToken();
+  }
+  return absl::OkStatus();
+}
+
 absl::Status ReadArgFromProto(const backend::Schema& schema,
                               const google::spanner::v1::ReadRequest& request,
                               backend::ReadArg* read_arg) {
@@ -204,6 +296,7 @@ absl::Status ReadArgFromProto(const backend::Schema& schema,
   read_arg->table = request.table();
   read_arg->index = request.index();
   read_arg->columns.assign(request.columns().begin(), request.columns().end());
+  read_arg->limit = request.limit();
 
   const backend::Table* table = schema.FindTable(request.table());
   if (table == nullptr) {
@@ -221,20 +314,63 @@ absl::Status ReadArgFromProto(const backend::Schema& schema,
   return absl::OkStatus();
 }
 
+absl::Status ResultSetMetadataCache::GetRowType(
+    backend::RowCursor* cursor, v1::ResultSetMetadata* metadata_pb) {
+  // Names cannot contain a NUL character, so it ends each of them, and is
+  // followed by the fixed size address of the column's type.
+  std::string key;
+  for (int i = 0; i < cursor->NumColumns(); ++i) {
+    const zetasql::Type* type = cursor->ColumnType(i);
+    absl::StrAppend(&key, cursor->ColumnName(i), absl::string_view("\0", 1));
+    key.append(reinterpret_cast<const char*>(&type), sizeof(type));
+  }
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    auto itr = row_types_.find(key);
+    if (itr != row_types_.end()) {
+      *metadata_pb->mutable_row_type() = itr->second;
+      return absl::OkStatus();
+    }
+  }
+
+  v1::StructType row_type;
+  ZETASQL_RETURN_IF_ERROR(RowTypeToProto(cursor, &row_type));
+  *metadata_pb->mutable_row_type() = row_type;
+  absl::MutexLock lock(&mu_);
+  if (row_types_.size() >= kMaxRowTypes) {
+    row_types_.clear();
+  }
+  row_types_.emplace(std::move(key), std::move(row_type));
+  return absl::OkStatus();
+}
+
 absl::Status RowCursorToResultSetProto(backend::RowCursor* cursor, int limit,
-                                       spanner_api::ResultSet* result_pb) {
-  ZETASQL_RETURN_IF_ERROR(
-      ResultSetMetadataToProto(cursor, result_pb->mutable_metadata()));
+                                       spanner_api::ResultSet* result_pb,
+                                       backend::MemoryTracker* memory,
+                                       ResultSetMetadataCache* metadata_cache) {
+  static metrics::LatencyHistogram* histogram = metrics::GetLatencyHistogram(
+      "emulator_serialization_seconds", "converter", "ResultSet");
+  metrics::ScopedLatencyTimer timer(histogram);
+  tracing::ScopedSpan span("Convert.ResultSet");
+  ZETASQL_RETURN_IF_ERROR(ResultSetMetadataToProto(
+      cursor, result_pb->mutable_metadata(), metadata_cache));
 
   // Iterate over all rows and populate column values into ResultSet.
+  const int num_columns = cursor->NumColumns();
   int row_count = 0;
-  while (cursor->Next()) {
-    auto* row_pb = result_pb->add_rows();
-    for (int i = 0; i < cursor->NumColumns(); ++i) {
-      ZETASQL_ASSIGN_OR_RETURN(*row_pb->add_values(),
-                       ValueToProto(cursor->ColumnValue(i)));
+  backend::RowBatch batch;
+  while (cursor->NextBatch(RowsInNextBatch(limit, row_count), &batch)) {
+    for (int64_t r = 0; r < batch.num_rows; ++r) {
+      auto* row_pb = result_pb->add_rows();
+      for (int i = 0; i < num_columns; ++i) {
+        ZETASQL_ASSIGN_OR_RETURN(*row_pb->add_values(),
+                         ValueToProto(batch.columns[i][r]));
+      }
+      if (memory != nullptr) {
+        ZETASQL_RETURN_IF_ERROR(memory->Reserve(row_pb->ByteSizeLong()));
+      }
     }
-    ++row_count;
+    row_count += batch.num_rows;
     if (limit > 0 && limit == row_count) {
       break;
     }
@@ -244,10 +380,110 @@ absl::Status RowCursorToResultSetProto(backend::RowCursor* cursor, int limit,
 }
 
 absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
-RowCursorToPartialResultSetProtos(backend::RowCursor* cursor, int limit) {
-  spanner_api::ResultSet result_set;
-  ZETASQL_RETURN_IF_ERROR(RowCursorToResultSetProto(cursor, limit, &result_set));
-  return ChunkResultSet(result_set, limits::kMaxStreamingChunkSize);
+RowCursorToPartialResultSetProtos(backend::RowCursor* cursor, int limit,
+                                  ResultSetMetadataCache* metadata_cache) {
+  static metrics::LatencyHistogram* histogram = metrics::GetLatencyHistogram(
+      "emulator_serialization_seconds", "converter", "PartialResultSet");
+  metrics::ScopedLatencyTimer timer(histogram);
+  tracing::ScopedSpan span("Convert.PartialResultSet");
+  std::vector<spanner_api::PartialResultSet> results;
+  ResultSetChunker chunker(limits::kMaxStreamingChunkSize, /*use_arena=*/false,
+                           [&results](spanner_api::PartialResultSet* chunk) {
+                             results.push_back(std::move(*chunk));
+                             return absl::OkStatus();
+                           });
+  spanner_api::ResultSetMetadata metadata;
+  ZETASQL_RETURN_IF_ERROR(
+      ResultSetMetadataToProto(cursor, &metadata, metadata_cache));
+  chunker.SetMetadata(metadata);
+
+  const int num_columns = cursor->NumColumns();
+  int row_count = 0;
+  backend::RowBatch batch;
+  while (cursor->NextBatch(RowsInNextBatch(limit, row_count), &batch)) {
+    for (int64_t r = 0; r < batch.num_rows; ++r) {
+      for (int i = 0; i < num_columns; ++i) {
+        ZETASQL_RETURN_IF_ERROR(chunker.AddValue(batch.columns[i][r]));
+      }
+    }
+    row_count += batch.num_rows;
+    if (limit > 0 && limit == row_count) {
+      break;
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(chunker.Finish());
+  return results;
+}
+
+absl::Status StreamRowCursorToPartialResultSetProtos(
+    backend::RowCursor* cursor, int limit,
+    absl::FunctionRef<absl::Status(spanner_api::PartialResultSet*)> emit,
+    absl::string_view resume_token, bool emit_resume_tokens,
+    ResultSetMetadataCache* metadata_cache, StreamingChunkSizer* chunk_sizer,
+    std::optional<absl::Time> read_timestamp) {
+  // The span includes the time spent emitting each chunk.
+  tracing::ScopedSpan span("Convert.PartialResultSetStream");
+  int64_t values_to_skip = 0;
+  if (!resume_token.empty()) {
+    ZETASQL_ASSIGN_OR_RETURN(ResumeToken token, DecodeResumeToken(resume_token));
+    values_to_skip = token.value_count();
+  }
+
+  // A chunked value is completed by the first value of the next chunk, so it
+  // is only counted once that chunk has been emitted.
+  int64_t values_sent = values_to_skip;
+  ResultSetChunker* chunker_ptr = nullptr;
+  auto emit_with_resume_token =
+      [&](spanner_api::PartialResultSet* chunk) -> absl::Status {
+    values_sent += chunk->values_size() - (chunk->chunked_value() ? 1 : 0);
+    if (emit_resume_tokens && !chunk->chunked_value()) {
+      chunk->set_resume_token(EncodeResumeToken(values_sent, read_timestamp));
+    }
+    ZETASQL_RETURN_IF_ERROR(emit(chunk));
+    if (chunk_sizer != nullptr) {
+      chunker_ptr->set_max_chunk_size(chunk_sizer->chunk_size());
+    }
+    return absl::OkStatus();
+  };
+
+  // Values are encoded straight into arena allocated chunks, each of which is
+  // released as soon as it has been emitted.
+  ResultSetChunker chunker(chunk_sizer != nullptr
+                               ? chunk_sizer->chunk_size()
+                               : limits::kMaxStreamingChunkSize,
+                           /*use_arena=*/true, emit_with_resume_token);
+  chunker_ptr = &chunker;
+  spanner_api::ResultSetMetadata metadata;
+  ZETASQL_RETURN_IF_ERROR(
+      ResultSetMetadataToProto(cursor, &metadata, metadata_cache));
+  chunker.SetMetadata(metadata);
+
+  // Skip the rows, and the leading values of the row, which the interrupted
+  // stream had already sent.
+  const int num_columns = cursor->NumColumns();
+  int row_count = 0;
+  int first_column = 0;
+  if (values_to_skip > 0 && num_columns > 0) {
+    const int64_t rows_to_skip = values_to_skip / num_columns;
+    first_column = values_to_skip % num_columns;
+    while (row_count < rows_to_skip && cursor->Next()) {
+      ++row_count;
+    }
+  }
+
+  backend::RowBatch batch;
+  while ((limit <= 0 || row_count < limit) &&
+         cursor->NextBatch(RowsInNextBatch(limit, row_count), &batch)) {
+    for (int64_t r = 0; r < batch.num_rows; ++r) {
+      for (int i = first_column; i < num_columns; ++i) {
+        ZETASQL_RETURN_IF_ERROR(chunker.AddValue(batch.columns[i][r]));
+      }
+      first_column = 0;
+    }
+    row_count += batch.num_rows;
+  }
+  ZETASQL_RETURN_IF_ERROR(cursor->Status());
+  return chunker.Finish();
 }
 
 }  // namespace frontend
@@ -17,17 +17,27 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_READS_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_READS_H_
 
+#include <optional>
+#include <string>
+
 #include "google/spanner/v1/mutation.pb.h"
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "google/spanner/v1/transaction.pb.h"
 #include "absl/status/status.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/statusor.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/access/write.h"
 #include "backend/common/ids.h"
+#include "backend/common/memory_tracker.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/transaction/options.h"
+#include "frontend/converters/chunking.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -38,6 +48,44 @@ namespace frontend {
 absl::StatusOr<backend::ReadOnlyOptions> ReadOnlyOptionsFromProto(
     const google::spanner::v1::TransactionOptions::ReadOnly& proto);
 
+// Changes selector to read at the read timestamp recorded in resume_token, if
+// any, when it selects a single-use read-only transaction, so that a stream
+// restarted with the token reads the same rows as the interrupted one.
+absl::Status PinSelectorToResumeToken(
+    absl::string_view resume_token,
+    google::spanner::v1::TransactionSelector* selector);
+
+// Returns an error if a stream restarted with resume_token does not read at
+// the read timestamp of the interrupted stream. read_timestamp is the one of
+// the restarted stream, if it reads at one.
+absl::Status ValidateResumeTokenReadTimestamp(
+    absl::string_view resume_token, std::optional<absl::Time> read_timestamp);
+
+// A cache of the row types of result sets, keyed by the names and types of
+// their columns. Reads and queries of the same shape return rows of the same
+// type, whose conversion to a proto is costly for wide rows and nested types.
+// Types are keyed by address, so the cache must not outlive the types of the
+// rows it is used with, such as those of the type factory of a database.
+//
+// This class is thread-safe.
+class ResultSetMetadataCache {
+ public:
+  // Sets the row type of metadata_pb to that of the rows of cursor, from the
+  // cache if rows of the same shape were converted before.
+  absl::Status GetRowType(backend::RowCursor* cursor,
+                          google::spanner::v1::ResultSetMetadata* metadata_pb)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // The cache is cleared once it holds this many row types, which bounds its
+  // size without tracking recency.
+  static constexpr int kMaxRowTypes = 1024;
+
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::string, google::spanner::v1::StructType> row_types_
+      ABSL_GUARDED_BY(mu_);
+};
+
 // Populates a ReadArg from a ReadRequest proto.
 absl::Status ReadArgFromProto(const backend::Schema& schema,
                               const google::spanner::v1::ReadRequest& request,
@@ -48,9 +96,15 @@ absl::Status ReadArgFromProto(const backend::Schema& schema,
 // Only handles the types and values supported by Cloud Spanner. Invalid types
 // or values not supported by Cloud Spanner will return errors. If limit > 0,
 // will only convert first limit numbers of rows into result_pb.
+//
+// If memory is not null, the size of each converted row is charged to it, and
+// the conversion fails with RESOURCE_EXHAUSTED once memory is past its limit.
+// If metadata_cache is not null, the row type is taken from it.
 absl::Status RowCursorToResultSetProto(
     backend::RowCursor* cursor, int limit,
-    google::spanner::v1::ResultSet* result_pb);
+    google::spanner::v1::ResultSet* result_pb,
+    backend::MemoryTracker* memory = nullptr,
+    ResultSetMetadataCache* metadata_cache = nullptr);
 
 // Converts a RowCursor to a set of one or more PartialResultSet protos.
 //
@@ -58,9 +112,42 @@ absl::Status RowCursorToResultSetProto(
 // or values not supported by Cloud Spanner will return errors. If limit > 0,
 // will only convert first limit numbers of rows. If the results exceed the max
 // streaming chunk size for a given partial result set, it will be chunked into
-// multiple partial result sets.
+// multiple partial result sets. If metadata_cache is not null, the row type is
+// taken from it.
 absl::StatusOr<std::vector<google::spanner::v1::PartialResultSet>>
-RowCursorToPartialResultSetProtos(backend::RowCursor* cursor, int limit);
+RowCursorToPartialResultSetProtos(
+    backend::RowCursor* cursor, int limit,
+    ResultSetMetadataCache* metadata_cache = nullptr);
+
+// Converts a RowCursor to a sequence of PartialResultSet protos, passing each
+// one to emit as soon as enough rows have been read from the cursor to fill a
+// streaming chunk. Unlike RowCursorToPartialResultSetProtos, at most one chunk
+// is buffered at any time, so results can be sent while the cursor is still
+// producing them. Values are encoded directly into arena allocated chunks, so a
+// PartialResultSet passed to emit is only valid for the duration of the call.
+//
+// The first emitted PartialResultSet carries the result set metadata, and at
+// least one PartialResultSet is always emitted. Returns the first non-OK status
+// returned by emit or the cursor.
+//
+// If emit_resume_tokens is set, every PartialResultSet which does not end in a
+// chunked value carries a resume token, which records read_timestamp if set.
+// If resume_token is non-empty, the values which were sent up to the
+// PartialResultSet carrying it are read from the cursor but not emitted again,
+// so the cursor must produce the same rows in the same order as the one of the
+// interrupted stream.
+//
+// If metadata_cache is not null, the row type is taken from it. If chunk_sizer
+// is not null, the size of each chunk is the one it picks once the previous
+// chunk has been emitted, which emit is expected to record with it.
+absl::Status StreamRowCursorToPartialResultSetProtos(
+    backend::RowCursor* cursor, int limit,
+    absl::FunctionRef<absl::Status(google::spanner::v1::PartialResultSet*)>
+        emit,
+    absl::string_view resume_token = "", bool emit_resume_tokens = false,
+    ResultSetMetadataCache* metadata_cache = nullptr,
+    StreamingChunkSizer* chunk_sizer = nullptr,
+    std::optional<absl::Time> read_timestamp = std::nullopt);
 
 }  // namespace frontend
 }  // namespace emulator
@@ -17,6 +17,7 @@
 #include "frontend/converters/reads.h"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "google/spanner/v1/mutation.pb.h"
@@ -29,9 +30,12 @@
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
 #include "absl/status/status.h"
+#include "absl/time/time.h"
 #include "backend/datamodel/key_range.h"
 #include "backend/datamodel/key_set.h"
 #include "backend/schema/catalog/schema.h"
+#include "common/limits.h"
+#include "frontend/proto/resume_token.pb.h"
 #include "tests/common/row_cursor.h"
 #include "tests/common/schema_constructor.h"
 #include "absl/status/status.h"
@@ -47,6 +51,7 @@ using ::google::spanner::emulator::test::TestRowCursor;
 using ::google::spanner::v1::PartialResultSet;
 using ::google::spanner::v1::ReadRequest;
 using ::google::spanner::v1::ResultSet;
+using ::google::spanner::v1::TransactionSelector;
 using zetasql::StructField;
 using zetasql::Value;
 using zetasql::types::BoolType;
@@ -297,6 +302,226 @@ TEST_F(AccessProtosTest, CanConvertRowCursorToPartialResultSetWithLimit) {
                               )"));
 }
 
+TEST_F(AccessProtosTest, CanStreamRowCursorToPartialResultSet) {
+  TestRowCursor cursor({"int64", "string"}, {Int64Type(), StringType()},
+                       {{Int64(1), String("Test")}, {Int64(2), NullString()}});
+  std::vector<PartialResultSet> results;
+  ZETASQL_ASSERT_OK(StreamRowCursorToPartialResultSetProtos(
+      &cursor, 0, [&](PartialResultSet* result) {
+        results.push_back(*result);
+        return absl::OkStatus();
+      }));
+
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0], test::EqualsProto(
+                              R"(metadata {
+                                   row_type {
+                                     fields {
+                                       name: "int64"
+                                       type { code: INT64 }
+                                     }
+                                     fields {
+                                       name: "string"
+                                       type { code: STRING }
+                                     }
+                                   }
+                                 }
+                                 values { string_value: "1" }
+                                 values { string_value: "Test" }
+                                 values { string_value: "2" }
+                                 values { null_value: NULL_VALUE }
+                              )"));
+}
+
+TEST_F(AccessProtosTest, StreamsLargeRowCursorInMultipleBatches) {
+  const std::string large_string(limits::kMaxStreamingChunkSize / 4, 'a');
+  std::vector<std::vector<Value>> rows;
+  for (int i = 0; i < 10; ++i) {
+    rows.push_back({String(large_string)});
+  }
+  TestRowCursor cursor({"string"}, {StringType()}, rows);
+
+  std::vector<PartialResultSet> results;
+  ZETASQL_ASSERT_OK(StreamRowCursorToPartialResultSetProtos(
+      &cursor, 0, [&](PartialResultSet* result) {
+        results.push_back(*result);
+        return absl::OkStatus();
+      }));
+
+  ASSERT_GT(results.size(), 1);
+  EXPECT_TRUE(results[0].has_metadata());
+  int num_values = 0;
+  for (int i = 0; i < results.size(); ++i) {
+    if (i > 0) {
+      EXPECT_FALSE(results[i].has_metadata());
+    }
+    num_values += results[i].values_size();
+    if (results[i].chunked_value()) {
+      --num_values;
+    }
+  }
+  EXPECT_EQ(num_values, rows.size());
+}
+
+TEST_F(AccessProtosTest, ResumesStreamAfterResumeToken) {
+  std::vector<std::vector<Value>> rows = {{Int64(1), String("one")},
+                                          {Int64(2), String("two")}};
+  std::vector<PartialResultSet> results;
+  TestRowCursor cursor({"int64", "string"}, {Int64Type(), StringType()}, rows);
+  ZETASQL_ASSERT_OK(StreamRowCursorToPartialResultSetProtos(
+      &cursor, 0,
+      [&](PartialResultSet* result) {
+        results.push_back(*result);
+        return absl::OkStatus();
+      },
+      /*resume_token=*/"", /*emit_resume_tokens=*/true));
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_FALSE(results[0].resume_token().empty());
+
+  // A restarted stream only sends the rows after the resume token.
+  rows.push_back({Int64(3), String("three")});
+  TestRowCursor resumed_cursor({"int64", "string"},
+                               {Int64Type(), StringType()}, rows);
+  std::vector<PartialResultSet> resumed_results;
+  ZETASQL_ASSERT_OK(StreamRowCursorToPartialResultSetProtos(
+      &resumed_cursor, 0,
+      [&](PartialResultSet* result) {
+        resumed_results.push_back(*result);
+        return absl::OkStatus();
+      },
+      results[0].resume_token(), /*emit_resume_tokens=*/true));
+  ASSERT_EQ(resumed_results.size(), 1);
+  ASSERT_EQ(resumed_results[0].values_size(), 2);
+  EXPECT_EQ(resumed_results[0].values(0).string_value(), "3");
+  EXPECT_EQ(resumed_results[0].values(1).string_value(), "three");
+}
+
+TEST_F(AccessProtosTest, ResumesStreamInTheMiddleOfARow) {
+  TestRowCursor cursor({"int64", "string"}, {Int64Type(), StringType()},
+                       {{Int64(1), String("one")}, {Int64(2), String("two")}});
+  ResumeToken token;
+  token.set_value_count(3);
+  std::vector<PartialResultSet> results;
+  ZETASQL_ASSERT_OK(StreamRowCursorToPartialResultSetProtos(
+      &cursor, 0,
+      [&](PartialResultSet* result) {
+        results.push_back(*result);
+        return absl::OkStatus();
+      },
+      token.SerializeAsString()));
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_EQ(results[0].values_size(), 1);
+  EXPECT_EQ(results[0].values(0).string_value(), "two");
+  EXPECT_TRUE(results[0].resume_token().empty());
+}
+
+TEST_F(AccessProtosTest, ResumeTokensRecordTheReadTimestamp) {
+  const absl::Time read_timestamp = absl::FromUnixMicros(1'000'000);
+  TestRowCursor cursor({"int64"}, {Int64Type()}, {{Int64(1)}});
+  std::vector<PartialResultSet> results;
+  ZETASQL_ASSERT_OK(StreamRowCursorToPartialResultSetProtos(
+      &cursor, 0,
+      [&](PartialResultSet* result) {
+        results.push_back(*result);
+        return absl::OkStatus();
+      },
+      /*resume_token=*/"", /*emit_resume_tokens=*/true,
+      /*metadata_cache=*/nullptr, /*chunk_sizer=*/nullptr, read_timestamp));
+  ASSERT_EQ(results.size(), 1);
+  const std::string& resume_token = results[0].resume_token();
+
+  // A restarted single-use read is pinned to the read timestamp.
+  TransactionSelector selector;
+  ZETASQL_ASSERT_OK(PinSelectorToResumeToken(resume_token, &selector));
+  EXPECT_EQ(selector.single_use().read_only().read_timestamp().seconds(), 1);
+  selector.mutable_single_use()->mutable_read_only()->set_strong(true);
+  ZETASQL_ASSERT_OK(PinSelectorToResumeToken(resume_token, &selector));
+  EXPECT_EQ(selector.single_use().read_only().read_timestamp().seconds(), 1);
+
+  // Other transactions keep theirs, which must be the same.
+  selector.set_id("txn");
+  ZETASQL_ASSERT_OK(PinSelectorToResumeToken(resume_token, &selector));
+  EXPECT_EQ(selector.id(), "txn");
+  ZETASQL_EXPECT_OK(ValidateResumeTokenReadTimestamp(resume_token, read_timestamp));
+  EXPECT_THAT(ValidateResumeTokenReadTimestamp(
+                  resume_token, read_timestamp + absl::Seconds(1)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ValidateResumeTokenReadTimestamp(resume_token, std::nullopt),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(AccessProtosTest, RejectsInvalidResumeToken) {
+  TestRowCursor cursor({"int64"}, {Int64Type()}, {{Int64(1)}});
+  EXPECT_THAT(StreamRowCursorToPartialResultSetProtos(
+                  &cursor, 0,
+                  [](PartialResultSet* result) { return absl::OkStatus(); },
+                  "not a resume token"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(AccessProtosTest, StreamingStopsOnEmitError) {
+  TestRowCursor cursor({"int64"}, {Int64Type()}, {{Int64(1)}, {Int64(2)}});
+  EXPECT_THAT(StreamRowCursorToPartialResultSetProtos(
+                  &cursor, 0,
+                  [](PartialResultSet* result) {
+                    return absl::CancelledError("stream closed");
+                  }),
+              StatusIs(absl::StatusCode::kCancelled));
+}
+
+TEST_F(AccessProtosTest, ReusesCachedRowTypes) {
+  ResultSetMetadataCache metadata_cache;
+  TestRowCursor cursor1({"int64", "string"}, {Int64Type(), StringType()},
+                        {{Int64(1), String("a")}});
+  ResultSet result_pb1;
+  ZETASQL_ASSERT_OK(RowCursorToResultSetProto(&cursor1, 0, &result_pb1,
+                                      /*memory=*/nullptr, &metadata_cache));
+
+  // The cached row type is set alongside the transaction metadata.
+  TestRowCursor cursor2({"int64", "string"}, {Int64Type(), StringType()},
+                        {{Int64(2), String("b")}});
+  ResultSet result_pb2;
+  result_pb2.mutable_metadata()->mutable_transaction()->set_id("txn");
+  ZETASQL_ASSERT_OK(RowCursorToResultSetProto(&cursor2, 0, &result_pb2,
+                                      /*memory=*/nullptr, &metadata_cache));
+  EXPECT_THAT(result_pb2, test::EqualsProto(
+                              R"(metadata {
+                                   row_type {
+                                     fields {
+                                       name: "int64"
+                                       type { code: INT64 }
+                                     }
+                                     fields {
+                                       name: "string"
+                                       type { code: STRING }
+                                     }
+                                   }
+                                   transaction { id: "txn" }
+                                 }
+                                 rows {
+                                   values { string_value: "2" }
+                                   values { string_value: "b" }
+                                 })"));
+
+  // Rows of another type are not given the cached row type.
+  TestRowCursor cursor3({"int64", "string"}, {Int64Type(), Int64Type()},
+                        {{Int64(3), Int64(3)}});
+  ResultSet result_pb3;
+  ZETASQL_ASSERT_OK(RowCursorToResultSetProto(&cursor3, 0, &result_pb3,
+                                      /*memory=*/nullptr, &metadata_cache));
+  EXPECT_THAT(result_pb3.metadata(), test::EqualsProto(
+                                         R"(row_type {
+                                              fields {
+                                                name: "int64"
+                                                type { code: INT64 }
+                                              }
+                                              fields {
+                                                name: "string"
+                                                type { code: INT64 }
+                                              }
+                                            })"));
+}
+
 TEST_F(AccessProtosTest, CanConvertEmptyRowCursorToResultSet) {
   const zetasql::Type* struct_array;
   ZETASQL_EXPECT_OK(type_factory_->MakeStructTypeFromVector(
@@ -197,7 +197,9 @@ absl::StatusOr<zetasql::Value> ValueFromProto(
             _ << "\nWhen parsing array element #" << i << ": {"
               << element_pb.DebugString() << "} in " << value_pb.DebugString());
       }
-      return zetasql::values::Array(type->AsArray(), values);
+      // The elements are moved into the array, whose copies then share them
+      // through storage and query evaluation.
+      return zetasql::Value::MakeArray(type->AsArray(), std::move(values));
     }
 
     case zetasql::TypeKind::TYPE_STRUCT: {
@@ -228,38 +230,44 @@ absl::StatusOr<zetasql::Value> ValueFromProto(
 
 absl::StatusOr<google::protobuf::Value> ValueToProto(
     const zetasql::Value& value) {
+  google::protobuf::Value value_pb;
+  ZETASQL_RETURN_IF_ERROR(ValueToProto(value, &value_pb));
+  return value_pb;
+}
+
+absl::Status ValueToProto(const zetasql::Value& value,
+                          google::protobuf::Value* value_pb) {
   if (!value.is_valid()) {
     return error::Internal(
         "Uninitialized ZetaSQL value passed to ValueToProto");
   }
 
-  google::protobuf::Value value_pb;
   if (value.is_null()) {
-    value_pb.set_null_value(google::protobuf::NullValue());
-    return value_pb;
+    value_pb->set_null_value(google::protobuf::NullValue());
+    return absl::OkStatus();
   }
 
   switch (value.type_kind()) {
     case zetasql::TypeKind::TYPE_BOOL: {
-      value_pb.set_bool_value(value.bool_value());
+      value_pb->set_bool_value(value.bool_value());
       break;
     }
 
     case zetasql::TypeKind::TYPE_INT64: {
-      value_pb.set_string_value(absl::StrCat(value.int64_value()));
+      value_pb->set_string_value(absl::StrCat(value.int64_value()));
       break;
     }
 
     case zetasql::TypeKind::TYPE_DOUBLE: {
       double val = value.double_value();
       if (std::isfinite(val)) {
-        value_pb.set_number_value(val);
+        value_pb->set_number_value(val);
       } else if (val == std::numeric_limits<double>::infinity()) {
-        value_pb.set_string_value("Infinity");
+        value_pb->set_string_value("Infinity");
       } else if (val == -std::numeric_limits<double>::infinity()) {
-        value_pb.set_string_value("-Infinity");
+        value_pb->set_string_value("-Infinity");
       } else if (std::isnan(val)) {
-        value_pb.set_string_value("NaN");
+        value_pb->set_string_value("NaN");
       } else {
         return error::Internal(absl::StrCat("Unsupported double value ",
                                             value.double_value(),
@@ -269,7 +277,7 @@ absl::StatusOr<google::protobuf::Value> ValueToProto(
     }
 
     case zetasql::TypeKind::TYPE_TIMESTAMP: {
-      value_pb.set_string_value(
+      value_pb->set_string_value(
           absl::StrCat(absl::FormatTime(kRFC3339TimeFormatNoOffset,
                                         value.ToTime(), absl::UTCTimeZone()),
                        "Z"));
@@ -285,52 +293,51 @@ absl::StatusOr<google::protobuf::Value> ValueToProto(
             "Unsupported date value ", value.DebugString(),
             " passed to ValueToProto. Year must be between 1 and 9999."));
       }
-      absl::StrAppendFormat(value_pb.mutable_string_value(), "%04d-%02d-%02d",
+      absl::StrAppendFormat(value_pb->mutable_string_value(), "%04d-%02d-%02d",
                             date.year(), date.month(), date.day());
       break;
     }
 
     case zetasql::TypeKind::TYPE_STRING: {
-      value_pb.set_string_value(value.string_value());
+      value_pb->set_string_value(value.string_value());
       break;
     }
 
     case zetasql::TypeKind::TYPE_NUMERIC: {
-      value_pb.set_string_value(value.numeric_value().ToString());
+      value_pb->set_string_value(value.numeric_value().ToString());
       break;
     }
 
     case zetasql::TypeKind::TYPE_JSON: {
-      value_pb.set_string_value(value.json_string());
+      value_pb->set_string_value(value.json_string());
       break;
     }
 
     case zetasql::TypeKind::TYPE_BYTES: {
-      absl::Base64Escape(value.bytes_value(), value_pb.mutable_string_value());
+      absl::Base64Escape(value.bytes_value(), value_pb->mutable_string_value());
       break;
     }
 
     case zetasql::TypeKind::TYPE_ARRAY: {
       google::protobuf::ListValue* list_value_pb =
-          value_pb.mutable_list_value();
+          value_pb->mutable_list_value();
       for (int i = 0; i < value.num_elements(); ++i) {
-        ZETASQL_ASSIGN_OR_RETURN(*list_value_pb->add_values(),
-                         ValueToProto(value.element(i)),
-                         _ << "\nWhen encoding array element #" << i << ": "
-                           << value.element(i).DebugString() << " in "
-                           << value.DebugString());
+        ZETASQL_RETURN_IF_ERROR(
+            ValueToProto(value.element(i), list_value_pb->add_values()))
+            << "\nWhen encoding array element #" << i << ": "
+            << value.element(i).DebugString() << " in " << value.DebugString();
       }
       break;
     }
 
     case zetasql::TypeKind::TYPE_STRUCT: {
       google::protobuf::ListValue* list_value_pb =
-          value_pb.mutable_list_value();
+          value_pb->mutable_list_value();
       for (int i = 0; i < value.num_fields(); ++i) {
-        ZETASQL_ASSIGN_OR_RETURN(
-            *list_value_pb->add_values(), ValueToProto(value.field(i)),
-            _ << "\nWhen encoding struct element #" << i << ": "
-              << value.field(i).DebugString() << " in " << value.DebugString());
+        ZETASQL_RETURN_IF_ERROR(
+            ValueToProto(value.field(i), list_value_pb->add_values()))
+            << "\nWhen encoding struct element #" << i << ": "
+            << value.field(i).DebugString() << " in " << value.DebugString();
       }
       break;
     }
@@ -342,7 +349,7 @@ absl::StatusOr<google::protobuf::Value> ValueToProto(
     }
   }
 
-  return value_pb;
+  return absl::OkStatus();
 }
 
 }  // namespace frontend
@@ -47,6 +47,11 @@ absl::StatusOr<zetasql::Value> ValueFromProto(
 absl::StatusOr<google::protobuf::Value> ValueToProto(
     const zetasql::Value& value);
 
+// Same as above, but encodes the value into value_pb, which must be empty.
+// Used to encode values directly into the message which will hold them.
+absl::Status ValueToProto(const zetasql::Value& value,
+                          google::protobuf::Value* value_pb);
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
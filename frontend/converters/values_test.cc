@@ -28,6 +28,7 @@
 #include "tests/common/proto_matchers.h"
 #include "absl/time/time.h"
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 
 namespace google {
 namespace spanner {
@@ -46,6 +47,7 @@ using zetasql::types::JsonArrayType;
 using zetasql::types::JsonType;
 using zetasql::types::NumericArrayType;
 using zetasql::types::NumericType;
+using zetasql::types::StringArrayType;
 using zetasql::types::StringType;
 using zetasql::types::TimestampType;
 
@@ -64,6 +66,7 @@ using zetasql::values::String;
 using zetasql::values::Struct;
 using zetasql::values::Timestamp;
 
+using zetasql_base::testing::IsOkAndHolds;
 using zetasql_base::testing::StatusIs;
 
 class ValueProtos : public ::testing::Test {
@@ -142,6 +145,26 @@ TEST_F(ValueProtos, ConvertsBasicTypesBetweenValuesAndProtos) {
   }
 }
 
+TEST_F(ValueProtos, ParsesLargeArraysWithNullElements) {
+  google::protobuf::Value value_pb;
+  std::vector<zetasql::Value> elements;
+  for (int i = 0; i < 1000; ++i) {
+    google::protobuf::Value* element_pb =
+        value_pb.mutable_list_value()->add_values();
+    if (i % 10 == 0) {
+      element_pb->set_null_value(google::protobuf::NULL_VALUE);
+      elements.push_back(Null(StringType()));
+    } else {
+      element_pb->set_string_value(absl::StrCat("tag", i));
+      elements.push_back(String(absl::StrCat("tag", i)));
+    }
+  }
+
+  EXPECT_THAT(ValueFromProto(value_pb, StringArrayType()),
+              IsOkAndHolds(zetasql::values::Array(StringArrayType(),
+                                                    elements)));
+}
+
 TEST_F(ValueProtos, DoesNotConvertUnknownValueTypesToProtos) {
   EXPECT_THAT(ValueToProto(zetasql::values::Invalid()),
               StatusIs(absl::StatusCode::kInternal));
@@ -16,8 +16,14 @@
 
 #include "frontend/entities/database.h"
 
+#include <functional>
+#include <utility>
+
 #include "google/spanner/admin/database/v1/spanner_database_admin.pb.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "common/config.h"
+#include "common/errors.h"
 #include "zetasql/base/status_macros.h"
 
 namespace google {
@@ -31,6 +37,30 @@ absl::Status Database::ToProto(admin::database::v1::Database* database) {
   return absl::OkStatus();
 }
 
+absl::Status Database::CheckWritable() const {
+  if (!config::follow_write_ahead_log_dir().empty()) {
+    return error::FollowerDatabaseIsReadOnly(database_uri_);
+  }
+  return absl::OkStatus();
+}
+
+void Database::SetCatchUp(std::function<absl::Status()> catch_up) {
+  absl::MutexLock lock(&mu_);
+  catch_up_ = std::move(catch_up);
+}
+
+absl::Status Database::CatchUp() const {
+  std::function<absl::Status()> catch_up;
+  {
+    absl::MutexLock lock(&mu_);
+    catch_up = catch_up_;
+  }
+  if (catch_up == nullptr) {
+    return absl::OkStatus();
+  }
+  return catch_up();
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
@@ -17,12 +17,16 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_DATABASE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_DATABASE_H_
 
+#include <functional>
 #include <string>
 
 #include "google/spanner/admin/database/v1/spanner_database_admin.pb.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/database/database.h"
+#include "frontend/converters/reads.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -53,6 +57,23 @@ class Database {
   // Converts this database object to its proto representation.
   absl::Status ToProto(admin::database::v1::Database* database);
 
+  // Returns FAILED_PRECONDITION if the emulator follows the write ahead logs of
+  // another emulator, in which case its databases are read-only copies.
+  absl::Status CheckWritable() const;
+
+  // Sets the function which strong reads call first, to apply the changes the
+  // followed emulator has logged for this database so far, see
+  // WriteAheadLogFollower.
+  void SetCatchUp(std::function<absl::Status()> catch_up)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Calls the function set by SetCatchUp, if any.
+  absl::Status CatchUp() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the cache of the row types of the reads and queries of this
+  // database.
+  ResultSetMetadataCache* metadata_cache() { return &metadata_cache_; }
+
  private:
   // The URI for this database.
   const std::string database_uri_;
@@ -62,6 +83,15 @@ class Database {
 
   // The time at which this database was created.
   const absl::Time create_time_;
+
+  mutable absl::Mutex mu_;
+
+  // Brings a follower's copy of the database up to date. May be null.
+  std::function<absl::Status()> catch_up_ ABSL_GUARDED_BY(mu_);
+
+  // Row types are keyed by the types of the backend database, which outlive
+  // the cache.
+  ResultSetMetadataCache metadata_cache_;
 };
 
 }  // namespace frontend
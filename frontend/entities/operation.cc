@@ -16,10 +16,14 @@
 
 #include "frontend/entities/operation.h"
 
+#include <optional>
 #include <string>
 
 #include "google/rpc/status.pb.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "frontend/common/protos.h"
 
 namespace google {
@@ -40,6 +44,9 @@ void Operation::SetError(const absl::Status& status) {
   absl::MutexLock lock(&mu_);
   status_ = status;
   response_.reset();
+  if (!done_time_.has_value() && !status_.ok()) {
+    done_time_ = absl::Now();
+  }
 }
 
 void Operation::SetResponse(const google::protobuf::Message& response) {
@@ -47,6 +54,14 @@ void Operation::SetResponse(const google::protobuf::Message& response) {
   response_.reset(response.New());
   response_->CopyFrom(response);
   status_ = absl::OkStatus();
+  if (!done_time_.has_value()) {
+    done_time_ = absl::Now();
+  }
+}
+
+std::optional<absl::Time> Operation::done_time() {
+  absl::MutexLock lock(&mu_);
+  return done_time_;
 }
 
 void Operation::ToProto(google::longrunning::Operation* operation_pb) {
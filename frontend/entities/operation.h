@@ -17,12 +17,14 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_ENTITIES_OPERATION_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_ENTITIES_OPERATION_H_
 
+#include <optional>
 #include <string>
 
 #include "google/longrunning/operations.pb.h"
 #include "google/protobuf/message.h"
 #include "absl/status/status.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -43,6 +45,9 @@ class Operation {
   // Constructs an empty operation.
   explicit Operation(const std::string& operation_uri);
 
+  // Returns the URI of this operation.
+  const std::string& operation_uri() const { return operation_uri_; }
+
   // Sets the metadata for an operation.
   void SetMetadata(const google::protobuf::Message& metadata) ABSL_LOCKS_EXCLUDED(mu_);
 
@@ -58,6 +63,10 @@ class Operation {
   void ToProto(google::longrunning::Operation* operation_pb)
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Returns the time at which the operation was first put in a done state, or
+  // nullopt if it is not done yet.
+  std::optional<absl::Time> done_time() ABSL_LOCKS_EXCLUDED(mu_);
+
  private:
   // The immutable URI for an operation.
   const std::string operation_uri_;
@@ -73,6 +82,9 @@ class Operation {
 
   // The status for this operation if this operation was not successful.
   absl::Status status_ ABSL_GUARDED_BY(mu_);
+
+  // The time at which this operation was first put in a done state.
+  std::optional<absl::Time> done_time_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace frontend
@@ -21,6 +21,7 @@
 #include <string>
 #include <utility>
 
+#include "google/protobuf/unknown_field_set.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "google/spanner/v1/transaction.pb.h"
 #include "absl/status/statusor.h"
@@ -49,6 +50,11 @@ namespace spanner_api = ::google::spanner::v1;
 
 namespace {
 
+// Field number of google.spanner.v1.Session.multiplexed. The googleapis
+// version the emulator is built against predates this field, so it is read
+// from and written to the unknown fields of the message.
+constexpr int kSessionMultiplexedFieldNumber = 7;
+
 // Validate that read only options specify a concurrency mode that can be used
 // with multi use transactions.
 absl::Status ValidateReadOptionsForMultiUseTransaction(
@@ -93,9 +99,21 @@ absl::Status ValidateSingleUseTransactionOptions(
 
 }  // namespace
 
+bool IsMultiplexedSession(const spanner_api::Session& session) {
+  const google::protobuf::UnknownFieldSet& fields =
+      session.GetReflection()->GetUnknownFields(session);
+  for (int i = 0; i < fields.field_count(); ++i) {
+    const google::protobuf::UnknownField& field = fields.field(i);
+    if (field.number() == kSessionMultiplexedFieldNumber &&
+        field.type() == google::protobuf::UnknownField::TYPE_VARINT) {
+      return field.varint() != 0;
+    }
+  }
+  return false;
+}
+
 absl::Status Session::ToProto(spanner_api::Session* session,
                               bool include_labels) {
-  absl::ReaderMutexLock lock(&mu_);
   session->set_name(session_uri_);
   if (include_labels) {
     session->mutable_labels()->insert(labels_.begin(), labels_.end());
@@ -103,7 +121,12 @@ absl::Status Session::ToProto(spanner_api::Session* session,
   ZETASQL_ASSIGN_OR_RETURN(*session->mutable_create_time(),
                    TimestampToProto(create_time_));
   ZETASQL_ASSIGN_OR_RETURN(*session->mutable_approximate_last_use_time(),
-                   TimestampToProto(approximate_last_use_time_));
+                   TimestampToProto(approximate_last_use_time()));
+  if (multiplexed_) {
+    session->GetReflection()
+        ->MutableUnknownFields(session)
+        ->AddVarint(kSessionMultiplexedFieldNumber, 1);
+  }
   return absl::OkStatus();
 }
 
@@ -143,6 +166,17 @@ absl::StatusOr<std::shared_ptr<Transaction>> Session::CreateMultiUseTransaction(
   // Insert shared transaction object into transaction map.
   transaction_map_.emplace(txn->id(), txn);
 
+  // Transactions of a multiplexed session are independent of each other, so
+  // none of them becomes the active transaction.
+  if (multiplexed_) {
+    while (transaction_map_.size() >
+           limits::kMaxTransactionsPerMultiplexedSession) {
+      transaction_map_.begin()->second->Close();
+      transaction_map_.erase(transaction_map_.begin());
+    }
+    return txn;
+  }
+
   // Clear older transactions if too many transactions are tracked by session.
   while (transaction_map_.size() > limits::kMaxTransactionsPerSession) {
     transaction_map_.begin()->second->Close();
@@ -195,18 +229,26 @@ absl::StatusOr<std::unique_ptr<Transaction>> Session::CreateReadOnly(
   ZETASQL_ASSIGN_OR_RETURN(backend::ReadOnlyOptions read_only_options,
                    ReadOnlyOptionsFromProto(options.read_only()));
 
+  // A strong read of a follower's copy of a database must see every commit
+  // the followed emulator had made before the read started.
+  if (read_only_options.bound == backend::TimestampBound::kStrongRead) {
+    ZETASQL_RETURN_IF_ERROR(database_->CatchUp());
+  }
+
   // Create a new backend read only transaction.
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<backend::ReadOnlyTransaction> read_only_transaction,
       database_->backend()->CreateReadOnlyTransaction(read_only_options));
   return std::make_unique<Transaction>(std::move(read_only_transaction),
-                                       database_->backend()->query_engine(),
+                                       database_->backend(),
                                        options, usage);
 }
 
 absl::StatusOr<std::unique_ptr<Transaction>> Session::CreateReadWrite(
     const spanner_api::TransactionOptions& options,
     const Transaction::Usage& usage, const backend::RetryState& retry_state) {
+  ZETASQL_RETURN_IF_ERROR(database_->CheckWritable());
+
   // Create a new backend read write transaction.
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<backend::ReadWriteTransaction> read_write_transaction,
@@ -214,13 +256,27 @@ absl::StatusOr<std::unique_ptr<Transaction>> Session::CreateReadWrite(
           backend::ReadWriteOptions(), retry_state));
 
   return std::make_unique<Transaction>(std::move(read_write_transaction),
-                                       database_->backend()->query_engine(),
+                                       database_->backend(),
                                        options, usage);
 }
 
 absl::StatusOr<std::shared_ptr<Transaction>> Session::FindAndUseTransaction(
     const std::string& bytes) {
   const backend::TransactionID& id = TransactionIDFromProto(bytes);
+  if (multiplexed_) {
+    return FindMultiplexedTransaction(id);
+  }
+  {
+    // Every request after the first in a transaction uses the transaction
+    // which is already active, so check for that under a shared lock first.
+    absl::ReaderMutexLock lock(&mu_);
+    if (id != backend::kInvalidTransactionID && id == min_valid_id_ &&
+        active_transaction_ != nullptr && active_transaction_->id() == id &&
+        !transaction_map_.empty() && transaction_map_.begin()->first == id &&
+        !active_transaction_->IsClosed()) {
+      return active_transaction_;
+    }
+  }
   absl::MutexLock lock(&mu_);
   if (id == backend::kInvalidTransactionID) {
     return error::InvalidTransactionID(backend::kInvalidTransactionID);
@@ -248,6 +304,22 @@ absl::StatusOr<std::shared_ptr<Transaction>> Session::FindAndUseTransaction(
   return active_transaction_;
 }
 
+absl::StatusOr<std::shared_ptr<Transaction>>
+Session::FindMultiplexedTransaction(const backend::TransactionID& id) {
+  absl::ReaderMutexLock lock(&mu_);
+  if (id == backend::kInvalidTransactionID) {
+    return error::InvalidTransactionID(backend::kInvalidTransactionID);
+  }
+  auto it = transaction_map_.find(id);
+  if (it == transaction_map_.end()) {
+    return error::TransactionNotFound(id);
+  }
+  if (it->second->IsClosed()) {
+    return error::TransactionClosed(id);
+  }
+  return it->second;
+}
+
 absl::StatusOr<std::shared_ptr<Transaction>> Session::FindOrInitTransaction(
     const spanner_api::TransactionSelector& selector) {
   std::shared_ptr<Transaction> txn;
@@ -17,6 +17,8 @@
 #ifndef STORAGE_CLOUD_SPANNER_EMULATOR_FRONTEND_SESSION_H_
 #define STORAGE_CLOUD_SPANNER_EMULATOR_FRONTEND_SESSION_H_
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -53,6 +55,11 @@ namespace frontend {
 // active, and any transactions created prior to the active transaction are
 // marked as invalid. Invalid transactions will be rolled back if necessary.
 //
+// A multiplexed session instead carries any number of concurrent transactions
+// (up to kMaxTransactionsPerMultiplexedSession). Using one of its transactions
+// does not invalidate the others, so clients can share a single multiplexed
+// session rather than keeping a pool of sessions.
+//
 // More information about sessions can be found at:
 //     https://cloud.google.com/spanner/docs/sessions
 class Session {
@@ -67,11 +74,13 @@ class Session {
   };
 
   Session(const std::string& session_uri, const Labels& labels,
-          const absl::Time create_time, std::shared_ptr<Database> database)
+          const absl::Time create_time, std::shared_ptr<Database> database,
+          bool multiplexed = false)
       : session_uri_(session_uri),
         labels_(labels),
         create_time_(create_time),
-        database_(database) {}
+        database_(database),
+        multiplexed_(multiplexed) {}
 
   // Returns the URI for this session.
   const std::string& session_uri() const { return session_uri_; }
@@ -82,17 +91,24 @@ class Session {
   // Returns the time this session was created.
   absl::Time create_time() const { return create_time_; }
 
+  // Returns the database to which this session is attached.
+  std::shared_ptr<Database> database() const { return database_; }
+
+  // Returns true if this session may carry many concurrent transactions.
+  bool multiplexed() const { return multiplexed_; }
+
   // Return the time this session was last used.
-  absl::Time approximate_last_use_time() const ABSL_LOCKS_EXCLUDED(mu_) {
-    absl::MutexLock lock(&mu_);
-    return approximate_last_use_time_;
+  absl::Time approximate_last_use_time() const {
+    return absl::FromUnixNanos(
+        approximate_last_use_time_nanos_.load(std::memory_order_relaxed));
   }
 
-  // Sets the time this session was last used.
-  void set_approximate_last_use_time(absl::Time approximate_last_use_time)
-      ABSL_LOCKS_EXCLUDED(mu_) {
-    absl::MutexLock lock(&mu_);
-    approximate_last_use_time_ = approximate_last_use_time;
+  // Sets the time this session was last used. This is called on every request
+  // to the session, so it does not take the session mutex.
+  void set_approximate_last_use_time(absl::Time approximate_last_use_time) {
+    approximate_last_use_time_nanos_.store(
+        absl::ToUnixNanos(approximate_last_use_time),
+        std::memory_order_relaxed);
   }
 
   // Converts this session to its proto representation.
@@ -133,6 +149,11 @@ class Session {
       const spanner_api::TransactionOptions& options,
       const Transaction::Usage& usage, const backend::RetryState& retry_state);
 
+  // Finds a transaction of a multiplexed session by id. Other transactions of
+  // the session are left untouched.
+  absl::StatusOr<std::shared_ptr<Transaction>> FindMultiplexedTransaction(
+      const backend::TransactionID& id) ABSL_LOCKS_EXCLUDED(mu_);
+
   // Builds the retry state from active transaction.
   backend::RetryState MakeRetryState(
       const spanner_api::TransactionOptions& options, bool is_single_use_txn)
@@ -150,12 +171,15 @@ class Session {
   // The database to which this session is attached.
   std::shared_ptr<Database> database_;
 
+  // Whether this is a multiplexed session.
+  const bool multiplexed_;
+
+  // The last time this session was used, in nanoseconds since the Unix epoch.
+  std::atomic<int64_t> approximate_last_use_time_nanos_ = 0;
+
   // Mutex to guard the state below.
   mutable absl::Mutex mu_;
 
-  // The last time this session was used.
-  absl::Time approximate_last_use_time_ ABSL_GUARDED_BY(mu_);
-
   // Map of transactions that have been pre-created in this session.
   std::map<backend::TransactionID, std::shared_ptr<Transaction>>
       transaction_map_ ABSL_GUARDED_BY(mu_);
@@ -167,6 +191,9 @@ class Session {
   backend::TransactionID min_valid_id_ = backend::kInvalidTransactionID + 1;
 };
 
+// Returns true if the client asked for the given session to be multiplexed.
+bool IsMultiplexedSession(const google::spanner::v1::Session& session);
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
@@ -41,6 +41,8 @@
 #include "backend/transaction/read_write_transaction.h"
 #include "common/constants.h"
 #include "common/errors.h"
+#include "common/limits.h"
+#include "common/tracing.h"
 #include "frontend/converters/time.h"
 #include "frontend/converters/types.h"
 #include "frontend/converters/values.h"
@@ -90,14 +92,23 @@ Transaction::Transaction(
     std::variant<std::unique_ptr<backend::ReadWriteTransaction>,
                  std::unique_ptr<backend::ReadOnlyTransaction>>
         backend_transaction,
-    const backend::QueryEngine* query_engine,
+    backend::Database* database,
     const spanner_api::TransactionOptions& options, const Usage& usage)
     : transaction_(std::move(backend_transaction)),
-      query_engine_(query_engine),
+      database_(database),
+      query_engine_(database->query_engine()),
       usage_type_(usage),
       type_(TypeFromTransactionOptions(options)),
       options_(options) {}
 
+Transaction::~Transaction() {
+  if (usage_type_ == kSingleUse && transaction_.index() == 0 &&
+      read_write() != nullptr) {
+    database_->ReleaseReadWriteTransaction(
+        std::move(std::get<0>(transaction_)));
+  }
+}
+
 void Transaction::Close() {
   absl::MutexLock lock(&mu_);
   closed_ = true;
@@ -139,12 +150,12 @@ bool Transaction::HasState(
 }
 
 bool Transaction::IsRolledback() const {
-  mu_.AssertHeld();
+  mu_.AssertReaderHeld();
   return HasState(backend::ReadWriteTransaction::State::kRolledback);
 }
 
 bool Transaction::IsInvalid() const {
-  mu_.AssertHeld();
+  mu_.AssertReaderHeld();
   return HasState(backend::ReadWriteTransaction::State::kInvalid);
 }
 
@@ -154,7 +165,7 @@ bool Transaction::IsAborted() const {
 }
 
 bool Transaction::IsCommitted() const {
-  mu_.AssertHeld();
+  mu_.AssertReaderHeld();
   return HasState(backend::ReadWriteTransaction::State::kCommitted);
 }
 
@@ -184,7 +195,7 @@ backend::TransactionID Transaction::id() const {
 
 absl::Status Transaction::Read(const backend::ReadArg& read_arg,
                                std::unique_ptr<backend::RowCursor>* cursor) {
-  mu_.AssertHeld();
+  mu_.AssertReaderHeld();
   switch (type_) {
     case kReadOnly: {
       return read_only()->Read(read_arg, cursor);
@@ -199,28 +210,40 @@ absl::Status Transaction::Read(const backend::ReadArg& read_arg,
 }
 
 absl::StatusOr<backend::QueryResult> Transaction::ExecuteSql(
-    const backend::Query& query) {
-  mu_.AssertHeld();
+    const backend::Query& query, absl::Time deadline,
+    std::function<bool()> is_cancelled) {
+  mu_.AssertReaderHeld();
   switch (type_) {
     case kReadOnly: {
-      return query_engine_->ExecuteSql(
-          query,
-          backend::QueryContext{
-              .schema = schema(), .reader = read_only(), .writer = nullptr});
+      auto context = backend::QueryContext{.schema = schema(),
+                                           .reader = read_only(),
+                                           .writer = nullptr,
+                                           .deadline = deadline,
+                                           .is_cancelled = is_cancelled};
+      if (query_engine_->caches_query_results()) {
+        // Reads past the version GC limit fail in the engine as usual.
+        absl::StatusOr<absl::Time> epoch = read_only()->SnapshotEpoch();
+        if (epoch.ok()) context.snapshot_epoch = *epoch;
+      }
+      return query_engine_->ExecuteSql(query, context);
     }
     case kReadWrite: {
       return query_engine_->ExecuteSql(
           query, backend::QueryContext{.schema = schema(),
                                        .reader = read_write(),
-                                       .writer = read_write()});
+                                       .writer = read_write(),
+                                       .deadline = deadline,
+                                       .is_cancelled = is_cancelled});
     }
     case kPartitionedDml: {
       auto context = backend::QueryContext{
           .schema = schema(), .reader = read_write(), .writer = read_write()};
       ZETASQL_RETURN_IF_ERROR(query_engine_->IsValidPartitionedDML(query, context));
+      // The statement is committed per key range in transactions of its own.
       // PartitionedDml will auto-commit transactions and cannot be reused.
-      ZETASQL_ASSIGN_OR_RETURN(backend::QueryResult result,
-                       query_engine_->ExecuteSql(query, context));
+      backend::QueryResult result;
+      ZETASQL_ASSIGN_OR_RETURN(result.modified_row_count,
+                       database_->ExecutePartitionedDml(query));
       ZETASQL_RETURN_IF_ERROR(read_write()->Commit());
       return result;
     }
@@ -309,10 +332,14 @@ Transaction::LookupOrRegisterDmlRequest(int64_t seqno, int64_t request_hash,
       return state;
     }
 
-    // Order was valid, so we record the new sequence number.
+    // Order was valid, so we record the new sequence number, forgetting the
+    // oldest request once the client can no longer retry it.
     dml_requests_.emplace(
         seqno, Transaction::RequestReplayState{.status = absl::OkStatus(),
                                                .request_hash = request_hash});
+    if (dml_requests_.size() > limits::kMaxReplayableDmlRequests) {
+      dml_requests_.erase(dml_requests_.begin());
+    }
     dml_error_mode_ = DMLErrorHandlingMode::kDmlRequest;
     return std::nullopt;
   }
@@ -368,6 +395,26 @@ Transaction::DMLErrorHandlingMode Transaction::DMLErrorType() const {
 
 absl::Status Transaction::GuardedCall(OpType op,
                                       const std::function<absl::Status()>& fn) {
+  // The span includes the wait for other calls on this transaction.
+  tracing::ScopedSpan span("Transaction.GuardedCall");
+  if (type_ == kReadOnly && (op == OpType::kRead || op == OpType::kSql)) {
+    absl::Status call_status;
+    {
+      absl::ReaderMutexLock lock(&mu_);
+      ZETASQL_RETURN_IF_ERROR(status_);
+      call_status = fn();
+    }
+    span.SetStatus(call_status);
+
+    // Reads do not abort read-only transactions or violate constraints, but
+    // should they fail so, the error is replayed as for other calls.
+    if (HasPayload(call_status, kConstraintError) ||
+        call_status.code() == absl::StatusCode::kAborted) {
+      absl::MutexLock lock(&mu_);
+      status_ = absl::Status(call_status.code(), call_status.message());
+    }
+    return absl::Status(call_status.code(), call_status.message());
+  }
   absl::MutexLock lock(&mu_);
 
   // Cannot reuse a transaction that previously encountered an error.
@@ -383,6 +430,7 @@ absl::Status Transaction::GuardedCall(OpType op,
   // operations can never cause the transaction to be aborted and never repeat
   // status errors. Non-DML SQL statements are read-only.
   const absl::Status call_status = fn();
+  span.SetStatus(call_status);
 
   if (!call_status.ok()) {
     if (op == OpType::kCommit || HasPayload(call_status, kConstraintError) ||
@@ -17,6 +17,7 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_ENTITIES_TRANSACTIONS_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_ENTITIES_TRANSACTIONS_H_
 
+#include <functional>
 #include <memory>
 #include <optional>
 #include <variant>
@@ -109,10 +110,14 @@ class Transaction {
   Transaction(std::variant<std::unique_ptr<backend::ReadWriteTransaction>,
                            std::unique_ptr<backend::ReadOnlyTransaction>>
                   backend_transaction,
-              const backend::QueryEngine* query_engine,
+              backend::Database* database,
               const spanner_api::TransactionOptions& options,
               const Usage& usage);
 
+  // Returns the backend transaction of a single-use read write transaction
+  // to the database for reuse.
+  ~Transaction();
+
   // Mark the transaction as closed. This indicates that the transaction is no
   // longer valid in the context of its owning session.  For example, prior
   // transactions are closed once a new transaction is started.
@@ -134,8 +139,12 @@ class Transaction {
   absl::Status Read(const backend::ReadArg& read_arg,
                     std::unique_ptr<backend::RowCursor>* cursor);
 
-  // Calls ExecuteSql using the backend transaction and query engine.
-  absl::StatusOr<backend::QueryResult> ExecuteSql(const backend::Query& query);
+  // Calls ExecuteSql using the backend transaction and query engine. The query
+  // is aborted once `deadline` has passed or `is_cancelled` returns true.
+  absl::StatusOr<backend::QueryResult> ExecuteSql(
+      const backend::Query& query,
+      absl::Time deadline = absl::InfiniteFuture(),
+      std::function<bool()> is_cancelled = nullptr);
 
   // Calls Write using the backend transaction.
   absl::Status Write(const backend::Mutation& mutation);
@@ -179,7 +188,10 @@ class Transaction {
   // Returns true if the current transaction is a PartitionedDmlTransaction.
   bool IsPartitionedDml() const { return type_ == kPartitionedDml; }
 
-  // All transaction methods should be called inside GuardedCall.
+  // All transaction methods should be called inside GuardedCall. Calls are
+  // serialized, except for reads and queries of read-only transactions, which
+  // read a fixed snapshot and change no state of the transaction, so they run
+  // concurrently (e.g. for the partitions of a batch read).
   absl::Status GuardedCall(OpType op, const std::function<absl::Status()>& fn)
       ABSL_LOCKS_EXCLUDED(mu_);
 
@@ -240,6 +252,10 @@ class Transaction {
                std::unique_ptr<backend::ReadOnlyTransaction>>
       transaction_;
 
+  // The database which the transaction belongs to. Used to execute partitioned
+  // DML statements, which are committed in transactions of their own.
+  backend::Database* database_;
+
   // The query engine for executing queries.
   const backend::QueryEngine* query_engine_;
 
@@ -275,7 +291,8 @@ class Transaction {
   // The type of DML request.
   DMLErrorHandlingMode dml_error_mode_;
 
-  // DML sequence request map.
+  // The most recent DML requests, by sequence number, see
+  // limits::kMaxReplayableDmlRequests.
   std::map<int64_t, RequestReplayState> dml_requests_ ABSL_GUARDED_BY(mu_);
 };
 
@@ -0,0 +1,112 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/entities/transaction.h"
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "google/spanner/v1/transaction.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "backend/database/database.h"
+#include "backend/schema/updater/schema_updater.h"
+#include "backend/transaction/options.h"
+#include "backend/transaction/read_only_transaction.h"
+#include "common/clock.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+using zetasql_base::testing::StatusIs;
+
+class ReadOnlyTransactionTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        database_,
+        backend::Database::Create(&clock_, backend::SchemaChangeOperation{}));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<backend::ReadOnlyTransaction> read_only,
+        database_->CreateReadOnlyTransaction(backend::ReadOnlyOptions()));
+    spanner_api::TransactionOptions options;
+    options.mutable_read_only()->set_strong(true);
+    transaction_ = std::make_unique<Transaction>(
+        std::move(read_only), database_.get(), options, Transaction::kMultiUse);
+  }
+
+  Clock clock_;
+  std::unique_ptr<backend::Database> database_;
+  std::unique_ptr<Transaction> transaction_;
+};
+
+TEST_F(ReadOnlyTransactionTest, RunsReadsAndQueriesConcurrently) {
+  // The read waits inside its call until the query has run, which it can only
+  // do while the read holds the transaction lock if both hold it shared.
+  absl::Notification read_started;
+  absl::Notification query_done;
+  absl::Status read_status;
+  std::thread reader([&]() {
+    read_status =
+        transaction_->GuardedCall(Transaction::OpType::kRead, [&]() {
+          read_started.Notify();
+          if (!query_done.WaitForNotificationWithTimeout(absl::Seconds(30))) {
+            return absl::DeadlineExceededError("The query did not run.");
+          }
+          return absl::OkStatus();
+        });
+  });
+  read_started.WaitForNotification();
+  ZETASQL_EXPECT_OK(transaction_->GuardedCall(Transaction::OpType::kSql, [&]() {
+    query_done.Notify();
+    return absl::OkStatus();
+  }));
+  reader.join();
+  ZETASQL_EXPECT_OK(read_status);
+}
+
+TEST_F(ReadOnlyTransactionTest, ReplaysAbortedReads) {
+  EXPECT_THAT(transaction_->GuardedCall(
+                  Transaction::OpType::kRead,
+                  []() { return absl::AbortedError("Aborted read."); }),
+              StatusIs(absl::StatusCode::kAborted));
+
+  // Later calls fail with the same status without running.
+  bool called = false;
+  EXPECT_THAT(transaction_->GuardedCall(Transaction::OpType::kSql,
+                                        [&]() {
+                                          called = true;
+                                          return absl::OkStatus();
+                                        }),
+              StatusIs(absl::StatusCode::kAborted, "Aborted read."));
+  EXPECT_FALSE(called);
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
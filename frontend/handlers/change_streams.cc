@@ -24,17 +24,25 @@
 
 #include "google/spanner/v1/spanner.pb.h"
 #include "google/spanner/v1/transaction.pb.h"
+#include "zetasql/public/value.h"
 #include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/substitute.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/database/change_stream/change_stream_notifier.h"
+#include "backend/database/change_stream/change_stream_partition_cache.h"
+#include "backend/database/change_stream/change_stream_scan_cache.h"
 #include "backend/query/change_stream/change_stream_query_validator.h"
 #include "backend/schema/catalog/schema.h"
 #include "common/clock.h"
 #include "common/errors.h"
 #include "frontend/converters/change_streams.h"
 #include "frontend/converters/time.h"
+#include "frontend/entities/database.h"
+#include "frontend/entities/session.h"
 #include "frontend/server/handler.h"
 #include "zetasql/base/status_macros.h"
 #include "zetasql/base/time_proto_util.h"
@@ -83,18 +91,9 @@ absl::Status VerifyChangeStreamExistence(const std::string& change_stream_name,
   return error::ChangeStreamNotFound(change_stream_name);
 }
 
-absl::StatusOr<absl::Duration> TryGetChangeStreamRetentionPeriod(
-    const std::string& change_stream_name, std::shared_ptr<Session> session,
-    absl::Time read_ts) {
-  spanner_api::TransactionOptions txn_options;
-  txn_options.mutable_read_only()->set_return_read_timestamp(false);
-  // If the user provided tvf start time is past now, wait until this future
-  // time to perform a read on partition token end time.
-  ZETASQL_ASSIGN_OR_RETURN(
-      *txn_options.mutable_read_only()->mutable_min_read_timestamp(),
-      TimestampToProto(read_ts));
-  ZETASQL_ASSIGN_OR_RETURN(auto txn, session->CreateSingleUseTransaction(txn_options));
-  auto change_stream = txn->schema()->FindChangeStream(change_stream_name);
+absl::StatusOr<absl::Duration> GetChangeStreamRetentionPeriod(
+    const std::string& change_stream_name, const backend::Schema* schema) {
+  auto change_stream = schema->FindChangeStream(change_stream_name);
   if (change_stream != nullptr) {
     return absl::Seconds(change_stream->parsed_retention_period());
   }
@@ -126,22 +125,43 @@ absl::Status ValidateTokenInRetentionWindow(
   return absl::OkStatus();
 }
 
+// Waits until a transaction commits new records to the change stream at or
+// after start, or until end if there are none, instead of polling the change
+// stream tables. Returns the end of the window which should be scanned next,
+// which includes the newly committed records.
+absl::Time WaitForChangeStreamCommit(backend::ChangeStreamNotifier* notifier,
+                                     const std::string& change_stream_name,
+                                     absl::Time start, absl::Time end) {
+  const absl::Time now = Clock().Now();
+  if (end <= now) {
+    return end;
+  }
+  const absl::Time commit_timestamp =
+      notifier->WaitForCommit(change_stream_name, start, end - now);
+  if (commit_timestamp < start) {
+    return end;
+  }
+  // Scans exclude their end time, so move past the commit timestamp.
+  return std::min(
+      end, std::max(commit_timestamp + absl::Microseconds(1), Clock().Now()));
+}
+
 absl::Status ProcessDataChangeRecordsAndStreamBack(
-    backend::QueryResult& result, const bool expect_heartbeat,
-    const absl::Time scan_end, bool* expect_metadata,
-    absl::Time* last_record_time,
+    absl::Span<const backend::ChangeStreamScanCache::Record> records,
+    const bool expect_heartbeat, const absl::Time scan_end,
+    bool* expect_metadata, absl::Time* last_record_time,
     ServerStream<spanner_api::PartialResultSet>* stream) {
   std::vector<spanner_api::PartialResultSet> responses;
-  if (IsQueryResultEmpty(result) && expect_heartbeat) {
+  if (records.empty() && expect_heartbeat) {
     ZETASQL_ASSIGN_OR_RETURN(responses,
                      ConvertHeartbeatTimestampToPartialResultSetProto(
                          scan_end, *expect_metadata));
     *expect_metadata = false;
     *last_record_time = scan_end;
-  } else if (!IsQueryResultEmpty(result)) {
+  } else if (!records.empty()) {
     ZETASQL_ASSIGN_OR_RETURN(responses,
-                     ConvertDataTableRowCursorToPartialResultSetProto(
-                         result.rows.get(), *expect_metadata));
+                     ConvertChangeRecordsToPartialResultSetProto(
+                         records, *expect_metadata));
     *last_record_time = scan_end;
     *expect_metadata = false;
   }
@@ -241,22 +261,25 @@ absl::StatusOr<absl::Time> ChangeStreamsHandler::TryGetPartitionTokenEndTime(
 
 backend::Query ChangeStreamsHandler::ConstructDataTablePartitionQuery(
     absl::Time start, absl::Time end) const {
-  // If user passed end_timestamp is not null and current scan is the last scan
-  // in query lifetime, we do an inclusive scan to include the data change
-  // record with commit_timestamp exactly at the user passed end_timestamp. If
-  // current scan is a middle chopped scan, we do an exclusive scan because all
-  // data records of a partition token has a commit_timestamp in
-  // [partition_start_time,partition_end_time).
-  const bool is_inclusive_read = metadata().end_timestamp.has_value() &&
-                                 metadata().end_timestamp.value() == end;
+  // The data table is keyed by (partition_token, commit_timestamp, ...), so
+  // these filters are pushed down into a read of the key range of the window
+  // rather than of the whole retained history. The window is passed as
+  // parameters so that every scan of a query reuses the same prepared
+  // statement.
   backend::Query data_table_partition_query = backend::Query{absl::Substitute(
       "SELECT * "
       "FROM $0 "
-      "WHERE( partition_token='$1' AND commit_timestamp >= '$2' AND "
-      "commit_timestamp $3 '$4' ) ORDER BY partition_token, commit_timestamp, "
-      "server_transaction_id,record_sequence",
-      data_table_, metadata().partition_token.value(), start,
-      is_inclusive_read ? "<=" : "<", end)};
+      "WHERE( partition_token=@partition_token AND "
+      "commit_timestamp >= @window_start AND "
+      "commit_timestamp < @window_end ) ORDER BY partition_token, "
+      "commit_timestamp, server_transaction_id,record_sequence",
+      data_table_)};
+  data_table_partition_query.declared_params = {
+      {"partition_token",
+       zetasql::values::String(metadata().partition_token.value())},
+      {"window_start", zetasql::values::Timestamp(start)},
+      {"window_end", zetasql::values::Timestamp(end)},
+  };
   data_table_partition_query.change_stream_internal_lookup =
       metadata().change_stream_name;
   return data_table_partition_query;
@@ -285,6 +308,22 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
       absl::Milliseconds(metadata().heartbeat_milliseconds);
   absl::Time last_record_time = now;
   absl::Time partition_token_end_time = absl::InfiniteFuture();
+  // The last snapshot time at which the partition table was read to find the
+  // end time of the partition, which was still active then. Until a churn may
+  // have ended the partition since, the partition cache tells that it is still
+  // active without the table being read again. Mock partition tables are not
+  // churned, so they are always read.
+  absl::Time partition_active_at = absl::InfinitePast();
+  backend::ChangeStreamPartitionCache* partition_cache =
+      partition_table_ == metadata().partition_table
+          ? session->database()->backend()->change_stream_partition_cache()
+          : nullptr;
+  // Queries reading the same partition scan each window of its data records
+  // once between them through the scan cache, unless they read mock tables.
+  backend::ChangeStreamScanCache* scan_cache =
+      data_table_ == metadata().data_table
+          ? session->database()->backend()->change_stream_scan_cache()
+          : nullptr;
   absl::Time current_start = metadata().start_timestamp;
   absl::Time current_end = std::min(
       std::max(now,
@@ -295,25 +334,102 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
   // Metadata is only expected for the first response to users in a single
   // query's lifetime.
   bool expect_metadata = true;
+  backend::ChangeStreamScanCache::Subscription subscription;
+  if (scan_cache != nullptr) {
+    subscription = scan_cache->Subscribe(metadata().change_stream_name,
+                                         metadata().partition_token.value(),
+                                         current_start);
+  }
+  backend::ChangeStreamNotifier* notifier =
+      session->database()->backend()->change_stream_notifier();
+  // Moves on to the window after scan_end.
+  auto move_past = [&](absl::Time scan_end) {
+    // Increment by 1 microsecond gap to avoid repetitive records.
+    current_start = scan_end + absl::Microseconds(1);
+    current_end = std::min(
+        {current_start +
+             absl::GetFlag(FLAGS_change_streams_partition_query_chop_interval),
+         tvf_end, partition_token_end_time});
+  };
+  // If user passed end_timestamp is not null and current scan is the last scan
+  // in query lifetime, we do an inclusive scan to include the data change
+  // record with commit_timestamp exactly at the user passed end_timestamp. If
+  // current scan is a middle chopped scan, we do an exclusive scan because all
+  // data records of a partition token has a commit_timestamp in
+  // [partition_start_time,partition_end_time).
+  auto window_end_of = [&](absl::Time scan_end) {
+    return scan_end == tvf_end ? scan_end + absl::Microseconds(1) : scan_end;
+  };
   while (current_start <= tvf_end && current_start < partition_token_end_time) {
+    // Stop waiting for the end of the chop interval as soon as there are new
+    // records to return.
+    current_end = WaitForChangeStreamCommit(
+        notifier, metadata().change_stream_name, current_start, current_end);
+    // While no transaction commits to the change stream, heartbeats are sent
+    // without reading the change stream tables in a transaction. Once the
+    // window has passed, the notifier tells whether it may have records, and
+    // the partition cache whether the partition may have ended since it was
+    // last read.
+    if (partition_cache != nullptr && scan_cache != nullptr &&
+        partition_active_at != absl::InfinitePast() &&
+        partition_token_end_time == absl::InfiniteFuture() &&
+        !notifier->MayHaveCommits(metadata().change_stream_name, current_start,
+                                  window_end_of(current_end)) &&
+        partition_cache->FindEndTime(metadata().change_stream_name,
+                                     metadata().partition_token.value(),
+                                     partition_active_at) ==
+            absl::InfiniteFuture()) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          absl::Duration current_retention,
+          GetChangeStreamRetentionPeriod(
+              metadata().change_stream_name,
+              session->database()->backend()->GetLatestSchema()));
+      ZETASQL_RETURN_IF_ERROR(ValidateTokenInRetentionWindow(
+          metadata().start_timestamp, current_start, partition_token_end_time,
+          current_retention));
+      ZETASQL_RETURN_IF_ERROR(ProcessDataChangeRecordsAndStreamBack(
+          /*records=*/{},
+          /*expect_heartbeat=*/current_end - last_record_time >=
+              heartbeat_interval,
+          current_end, &expect_metadata, &last_record_time, stream));
+      move_past(current_end);
+      continue;
+    }
     // For historical queries where tvf end is in the past, set the read
     // transaction snapshot time to now to prevent >1h stale read, which is now
     // allowed.
     absl::Time current_txn_snapshot_time = std::max(current_end, now);
-    // Get the newest retention period so most up to date retention will apply
-    // to curent running query.
-    ZETASQL_ASSIGN_OR_RETURN(
-        absl::Duration current_retention,
-        TryGetChangeStreamRetentionPeriod(metadata().change_stream_name,
-                                          session, current_txn_snapshot_time));
     spanner_api::TransactionOptions txn_options;
-    // If the partition token hasn't been churned yet, we re-scan the partition
-    // table to see if the end time has been churned and update the partition
-    // end time.
+    // This transaction will be blocked until now passes current_end.
+    ZETASQL_ASSIGN_OR_RETURN(*txn_options.mutable_read_only()->mutable_read_timestamp(),
+                     TimestampToProto(current_txn_snapshot_time));
+    ZETASQL_ASSIGN_OR_RETURN(auto txn,
+                     session->CreateSingleUseTransaction(txn_options));
+    // Get the newest retention period so most up to date retention will apply
+    // to curent running query. Getting the schema waits for the commits before
+    // the snapshot time, so the partition cache reflects their churns below.
+    ZETASQL_ASSIGN_OR_RETURN(absl::Duration current_retention,
+                     GetChangeStreamRetentionPeriod(
+                         metadata().change_stream_name, txn->schema()));
+    // If the partition token hasn't been churned yet, we check whether the end
+    // time has been churned and update the partition end time, re-scanning the
+    // partition table unless the partition cache knows the answer.
     if (partition_token_end_time == absl::InfiniteFuture()) {
-      ZETASQL_ASSIGN_OR_RETURN(
-          partition_token_end_time,
-          TryGetPartitionTokenEndTime(session, current_txn_snapshot_time));
+      std::optional<absl::Time> cached_end_time;
+      if (partition_cache != nullptr &&
+          partition_active_at != absl::InfinitePast()) {
+        cached_end_time = partition_cache->FindEndTime(
+            metadata().change_stream_name, metadata().partition_token.value(),
+            partition_active_at);
+      }
+      if (cached_end_time.has_value()) {
+        partition_token_end_time = *cached_end_time;
+      } else {
+        ZETASQL_ASSIGN_OR_RETURN(
+            partition_token_end_time,
+            TryGetPartitionTokenEndTime(session, current_txn_snapshot_time));
+        partition_active_at = current_txn_snapshot_time;
+      }
     }
     ZETASQL_RETURN_IF_ERROR(ValidateTokenInRetentionWindow(
         metadata().start_timestamp, current_start, partition_token_end_time,
@@ -321,22 +437,33 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
     // Only scan data records up to minimum of current chopped end time
     // and end time of current partition token.
     const absl::Time scan_end = std::min(partition_token_end_time, current_end);
+    const absl::Time window_end = window_end_of(scan_end);
     const bool expect_heartbeat =
         current_end - last_record_time >= heartbeat_interval;
-    // This transaction will be blocked until now passes current_end.
-    ZETASQL_ASSIGN_OR_RETURN(*txn_options.mutable_read_only()->mutable_read_timestamp(),
-                     TimestampToProto(current_txn_snapshot_time));
-    ZETASQL_ASSIGN_OR_RETURN(auto txn,
-                     session->CreateSingleUseTransaction(txn_options));
     absl::Status status =
         txn->GuardedCall(Transaction::OpType::kSql, [&]() -> absl::Status {
-          backend::Query read_data_query =
-              ConstructDataTablePartitionQuery(current_start, scan_end);
-          ZETASQL_ASSIGN_OR_RETURN(auto data_records_results,
-                           txn->ExecuteSql(read_data_query));
+          // The transaction reads at or after scan_end, so it sees every
+          // record committed before window_end.
+          auto scan = [&](absl::Time start, absl::Time end)
+              -> absl::StatusOr<
+                  std::vector<backend::ChangeStreamScanCache::Record>> {
+            ZETASQL_ASSIGN_OR_RETURN(
+                auto data_records_results,
+                txn->ExecuteSql(ConstructDataTablePartitionQuery(start, end)));
+            return ConvertDataTableRowCursorToChangeRecords(
+                data_records_results.rows.get());
+          };
+          std::vector<backend::ChangeStreamScanCache::Record> records;
+          if (scan_cache != nullptr) {
+            ZETASQL_ASSIGN_OR_RETURN(
+                records, scan_cache->Read(&subscription, current_start,
+                                          window_end, scan));
+          } else {
+            ZETASQL_ASSIGN_OR_RETURN(records, scan(current_start, window_end));
+          }
           ZETASQL_RETURN_IF_ERROR(ProcessDataChangeRecordsAndStreamBack(
-              data_records_results, expect_heartbeat, scan_end,
-              &expect_metadata, &last_record_time, stream));
+              records, expect_heartbeat, scan_end, &expect_metadata,
+              &last_record_time, stream));
           if (partition_token_end_time <= current_end) {
             // Get child partition records after all data records are returned
             // in current query.
@@ -358,12 +485,7 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
           return absl::OkStatus();
         });
     ZETASQL_RETURN_IF_ERROR(status);
-    // Increment by 1 microsecond gap to avoid repetitive records.
-    current_start = scan_end + absl::Microseconds(1);
-    current_end = std::min(
-        {current_start +
-             absl::GetFlag(FLAGS_change_streams_partition_query_chop_interval),
-         tvf_end, partition_token_end_time});
+    move_past(scan_end);
   }
   return absl::OkStatus();
 }
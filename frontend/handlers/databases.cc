@@ -30,12 +30,13 @@
 #include "backend/database/database.h"
 #include "backend/schema/ddl/operations.pb.h"
 #include "backend/schema/parser/ddl_parser.h"
-#include "backend/schema/printer/print_ddl.h"
 #include "backend/schema/updater/schema_updater.h"
+#include "common/config.h"
 #include "common/errors.h"
 #include "frontend/common/uris.h"
 #include "frontend/converters/time.h"
 #include "frontend/entities/database.h"
+#include "frontend/proto/emulator_admin.pb.h"
 #include "frontend/server/handler.h"
 #include "zetasql/base/status_macros.h"
 
@@ -115,6 +116,9 @@ absl::Status CreateDatabase(RequestContext* ctx,
 
   // Create the database.
   std::string database_uri = MakeDatabaseUri(request->parent(), database_name);
+  if (!config::follow_write_ahead_log_dir().empty()) {
+    return error::FollowerDatabaseIsReadOnly(database_uri);
+  }
   std::vector<std::string> create_statements;
   for (const std::string& statement : request->extra_statements()) {
     create_statements.push_back(statement);
@@ -180,6 +184,7 @@ absl::Status UpdateDatabaseDdl(
   // Lookup the database by URI.
   ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Database> database,
                    GetDatabase(ctx, request->database()));
+  ZETASQL_RETURN_IF_ERROR(database->CheckWritable());
 
   std::vector<std::string> statements;
   for (const std::string& statement : request->statements()) {
@@ -187,14 +192,42 @@ absl::Status UpdateDatabaseDdl(
   }
 
   backend::Database* backend_database = database->backend();
+  const backend::SchemaChangeOperation schema_change_operation{
+      .statements = statements,
+  };
   int num_succesful_statements;
   absl::Time commit_timestamp;
   absl::Status backfill_status;
-  ZETASQL_RETURN_IF_ERROR(backend_database->UpdateSchema(
-      backend::SchemaChangeOperation{
-          .statements = statements,
-      },
-      &num_succesful_statements, &commit_timestamp, &backfill_status));
+  std::shared_ptr<Operation> operation;
+  if (config::enable_online_index_backfill() &&
+      backend::Database::CanCreateIndexesOnline(schema_change_operation)) {
+    // The operation is completed by the backfill, which may finish before the
+    // response is sent, so it is created up front.
+    ZETASQL_ASSIGN_OR_RETURN(operation,
+                     ctx->env()->operation_manager()->CreateOperation(
+                         request->database(), request->operation_id()));
+    absl::Status status = backend_database->CreateIndexesOnline(
+        schema_change_operation, &commit_timestamp,
+        [operation](absl::Status result) {
+          if (result.ok()) {
+            operation->SetResponse(protobuf_api::Empty());
+          } else {
+            operation->SetError(result);
+          }
+        });
+    if (!status.ok()) {
+      ctx->env()
+          ->operation_manager()
+          ->DeleteOperation(operation->operation_uri())
+          .IgnoreError();
+      return status;
+    }
+    num_succesful_statements = statements.size();
+  } else {
+    ZETASQL_RETURN_IF_ERROR(backend_database->UpdateSchema(
+        schema_change_operation, &num_succesful_statements, &commit_timestamp,
+        &backfill_status));
+  }
 
   // Populate ResultSet metadata.
   // For simplicity in emulator, we have implemented the schema updates in such
@@ -214,15 +247,17 @@ absl::Status UpdateDatabaseDdl(
 
   // Create operation to be returned as part of the response.
   // A user-supplied operation_id would have already been validated above.
-  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Operation> operation,
-                   ctx->env()->operation_manager()->CreateOperation(
-                       request->database(), request->operation_id()));
-  operation->SetMetadata(update_md);
-  if (backfill_status.ok()) {
-    operation->SetResponse(protobuf_api::Empty());
-  } else {
-    operation->SetError(backfill_status);
+  if (operation == nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(operation,
+                     ctx->env()->operation_manager()->CreateOperation(
+                         request->database(), request->operation_id()));
+    if (backfill_status.ok()) {
+      operation->SetResponse(protobuf_api::Empty());
+    } else {
+      operation->SetError(backfill_status);
+    }
   }
+  operation->SetMetadata(update_md);
   operation->ToProto(response);
 
   return absl::OkStatus();
@@ -244,6 +279,7 @@ absl::Status DropDatabase(RequestContext* ctx,
   auto maybe_database =
       ctx->env()->database_manager()->GetDatabase(request->database());
   if (maybe_database.ok()) {
+    ZETASQL_RETURN_IF_ERROR((*maybe_database)->CheckWritable());
     ZETASQL_ASSIGN_OR_RETURN(
         std::vector<std::shared_ptr<Session>> sessions,
         ctx->env()->session_manager()->ListSessions(request->database()));
@@ -266,7 +302,8 @@ absl::Status GetDatabaseDdl(RequestContext* ctx,
                    GetDatabase(ctx, request->database()));
 
   absl::StatusOr<std::vector<std::string>> printed_statements =
-      backend::PrintDDLStatements(database->backend()->GetLatestSchema());
+      database->backend()->PrintDDLStatements(
+          database->backend()->GetLatestSchema());
   ZETASQL_RETURN_IF_ERROR(printed_statements.status());
   for (const auto& statement : *printed_statements) {
     response->add_statements(statement);
@@ -275,6 +312,17 @@ absl::Status GetDatabaseDdl(RequestContext* ctx,
 }
 REGISTER_GRPC_HANDLER(DatabaseAdmin, GetDatabaseDdl);
 
+// Discards the rows of a database, keeping its schema.
+absl::Status ResetDatabase(RequestContext* ctx,
+                           const ResetDatabaseRequest* request,
+                           protobuf_api::Empty* response) {
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Database> database,
+                   GetDatabase(ctx, request->database()));
+  ZETASQL_RETURN_IF_ERROR(database->CheckWritable());
+  return database->backend()->ResetData();
+}
+REGISTER_GRPC_HANDLER(EmulatorAdmin, ResetDatabase);
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
@@ -401,6 +401,42 @@ TEST_F(DatabaseApiTest, DropDatabaseIdempotent) {
   ZETASQL_EXPECT_OK(DropDatabase(test_database_uri_));
 }
 
+TEST_F(DatabaseApiTest, ResetDatabaseDiscardsRows) {
+  ZETASQL_EXPECT_OK(CreateTestDatabase());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const std::string session, CreateTestSession());
+  spanner_api::CommitRequest commit_request = PARSE_TEXT_PROTO(R"pb(
+    single_use_transaction { read_write {} }
+    mutations {
+      insert {
+        table: "test_table"
+        columns: "int64_col"
+        columns: "string_col"
+        values {
+          values { string_value: "1" }
+          values { string_value: "a" }
+        }
+      }
+    }
+  )pb");
+  *commit_request.mutable_session() = session;
+  spanner_api::CommitResponse commit_response;
+  ZETASQL_ASSERT_OK(Commit(commit_request, &commit_response));
+
+  ZETASQL_ASSERT_OK(ResetDatabase(test_database_uri_));
+
+  // The schema and the session are kept, but the rows are gone.
+  spanner_api::ExecuteSqlRequest query;
+  query.set_session(session);
+  query.set_sql("SELECT int64_col FROM test_table");
+  spanner_api::ResultSet result;
+  ZETASQL_ASSERT_OK(ExecuteSql(query, &result));
+  EXPECT_EQ(result.rows_size(), 0);
+  ZETASQL_EXPECT_OK(Commit(commit_request, &commit_response));
+
+  EXPECT_THAT(ResetDatabase(MakeDatabaseUri(test_instance_uri_, "missing")),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
 TEST_F(DatabaseApiTest, UpdateAndGetDatabaseDDL) {
   std::vector<std::vector<std::string>> test_schemas = {
       {
@@ -15,9 +15,12 @@
 //
 
 #include <memory>
+#include <optional>
+#include <string>
 
 #include "google/longrunning/operations.pb.h"
 #include "google/protobuf/empty.pb.h"
+#include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "frontend/common/uris.h"
 #include "frontend/server/handler.h"
@@ -39,9 +42,19 @@ absl::Status ListOperations(
   absl::string_view resource_uri, operation_id;
   ZETASQL_RETURN_IF_ERROR(ParseOperationUri(absl::StrCat(request->name(), "/"),
                                     &resource_uri, &operation_id));
+  // Filtering on whether operations are done is supported, other filters are
+  // ignored.
+  std::optional<bool> done;
+  const std::string filter =
+      absl::StrReplaceAll(request->filter(), {{" ", ""}});
+  if (filter == "done:true" || filter == "done=true") {
+    done = true;
+  } else if (filter == "done:false" || filter == "done=false") {
+    done = false;
+  }
   ZETASQL_ASSIGN_OR_RETURN(
       std::vector<std::shared_ptr<Operation>> operations,
-      ctx->env()->operation_manager()->ListOperations(request->name()));
+      ctx->env()->operation_manager()->ListOperations(request->name(), done));
   for (const auto& op : operations) {
     op->ToProto(response->add_operations());
   }
@@ -14,8 +14,12 @@
 // limitations under the License.
 //
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "google/protobuf/struct.pb.h"
 #include "google/spanner/v1/keys.pb.h"
@@ -24,13 +28,24 @@
 #include "google/spanner/v1/type.pb.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/query/query_engine.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
 #include "common/config.h"
 #include "common/errors.h"
+#include "common/limits.h"
+#include "frontend/converters/keys.h"
 #include "frontend/converters/partition.h"
 #include "frontend/converters/query.h"
 #include "frontend/converters/reads.h"
+#include "frontend/converters/values.h"
 #include "frontend/entities/session.h"
+#include "frontend/entities/transaction.h"
 #include "frontend/proto/partition_token.pb.h"
 #include "frontend/server/handler.h"
 #include "zetasql/base/status_macros.h"
@@ -94,6 +109,188 @@ absl::StatusOr<PartitionToken> CreatePartitionTokenForRead(
   return partition_token;
 }
 
+// Returns the table whose key space a partition read request is split over:
+// the index data table for index reads, and the read table otherwise.
+absl::StatusOr<const backend::Table*> GetPartitionedTable(
+    const backend::Schema& schema,
+    const spanner_api::PartitionReadRequest& request) {
+  const backend::Table* table = schema.FindTable(request.table());
+  if (table == nullptr) {
+    return error::TableNotFound(request.table());
+  }
+  if (request.index().empty()) {
+    return table;
+  }
+  const backend::Index* index = schema.FindIndex(request.index());
+  if (index == nullptr) {
+    return error::IndexNotFound(request.index(), request.table());
+  }
+  return index->index_data_table();
+}
+
+// A row matched by a partition read request, reduced to the key parts that can
+// be named in a key set and the approximate size of the row.
+struct RowSample {
+  backend::Key key;
+  int64_t size;
+};
+
+// Reads the rows matched by request in key order.
+absl::StatusOr<std::vector<RowSample>> SampleRows(
+    const spanner_api::PartitionReadRequest& request,
+    const backend::Table& table, Transaction* txn) {
+  // Key sets can only name the indexed columns of index data tables, so
+  // partitions are only split at those.
+  const int num_key_parts = table.owner_index() != nullptr
+                                ? table.owner_index()->key_columns().size()
+                                : table.primary_key().size();
+  backend::ReadArg read_arg;
+  read_arg.table = request.table();
+  read_arg.index = request.index();
+  ZETASQL_ASSIGN_OR_RETURN(read_arg.key_set,
+                   KeySetFromProto(request.key_set(), table));
+  for (int i = 0; i < num_key_parts; ++i) {
+    read_arg.columns.push_back(table.primary_key()[i]->column()->Name());
+  }
+  for (const std::string& column : request.columns()) {
+    if (std::none_of(read_arg.columns.begin(),
+                     read_arg.columns.begin() + num_key_parts,
+                     [&column](const std::string& key_column) {
+                       return absl::EqualsIgnoreCase(column, key_column);
+                     })) {
+      read_arg.columns.push_back(column);
+    }
+  }
+
+  std::unique_ptr<backend::RowCursor> cursor;
+  ZETASQL_RETURN_IF_ERROR(txn->Read(read_arg, &cursor));
+  std::vector<RowSample> samples;
+  while (cursor->Next()) {
+    RowSample& sample = samples.emplace_back();
+    sample.size = 0;
+    for (int i = 0; i < cursor->NumColumns(); ++i) {
+      const zetasql::Value& value = cursor->ColumnValue(i);
+      if (i < num_key_parts) {
+        sample.key.AddColumn(value, table.primary_key()[i]->is_descending());
+      }
+      sample.size += value.physical_byte_size();
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(cursor->Status());
+  // Rows of different ranges in the key set are not returned in key order.
+  std::stable_sort(samples.begin(), samples.end(),
+                   [](const RowSample& a, const RowSample& b) {
+                     return a.key < b.key;
+                   });
+  return samples;
+}
+
+// Returns the keys at which the sampled rows are split into partitions of
+// roughly equal size, in increasing order. Each split key starts a partition.
+std::vector<backend::Key> ComputeSplitKeys(
+    const std::vector<RowSample>& samples,
+    const spanner_api::PartitionOptions& options) {
+  const int64_t partition_size_bytes = options.partition_size_bytes() > 0
+                                           ? options.partition_size_bytes()
+                                           : limits::kDefaultPartitionSizeBytes;
+  const int64_t max_partitions = options.max_partitions() > 0
+                                     ? options.max_partitions()
+                                     : limits::kDefaultMaxPartitions;
+  int64_t total_size = 0;
+  for (const RowSample& sample : samples) {
+    total_size += sample.size;
+  }
+  const int64_t num_partitions = std::clamp<int64_t>(
+      (total_size + partition_size_bytes - 1) / partition_size_bytes, 1,
+      max_partitions);
+
+  // Place the splits by cumulative size rather than by row count, so that
+  // partitions are balanced when row sizes vary.
+  std::vector<backend::Key> split_keys;
+  int64_t size_before = 0;
+  for (const RowSample& sample : samples) {
+    if (static_cast<int64_t>(split_keys.size()) + 1 >= num_partitions) {
+      break;
+    }
+    // Rows that share a split key prefix cannot be placed in different
+    // partitions.
+    if (size_before * num_partitions >=
+            total_size * static_cast<int64_t>(split_keys.size() + 1) &&
+        sample.key > (split_keys.empty() ? samples.front().key
+                                         : split_keys.back())) {
+      split_keys.push_back(sample.key);
+    }
+    size_before += sample.size;
+  }
+  return split_keys;
+}
+
+// Returns the key parts of key as a key proto.
+absl::StatusOr<google::protobuf::ListValue> KeyToProto(
+    const backend::Key& key) {
+  google::protobuf::ListValue key_pb;
+  for (int i = 0; i < key.NumColumns(); ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(*key_pb.add_values(),
+                     ValueToProto(key.ColumnValue(i)));
+  }
+  return key_pb;
+}
+
+// Splits key_set_pb into one key set per partition, where partition i holds
+// the keys in [split_keys[i - 1], split_keys[i]). Together the returned key
+// sets match exactly the same rows as key_set_pb.
+absl::StatusOr<std::vector<spanner_api::KeySet>> SplitKeySet(
+    const spanner_api::KeySet& key_set_pb, const backend::Table& table,
+    const std::vector<backend::Key>& split_keys) {
+  std::vector<google::protobuf::ListValue> split_key_pbs;
+  for (const backend::Key& split_key : split_keys) {
+    ZETASQL_ASSIGN_OR_RETURN(split_key_pbs.emplace_back(), KeyToProto(split_key));
+  }
+  std::vector<spanner_api::KeySet> partitions(split_keys.size() + 1);
+
+  for (const google::protobuf::ListValue& key_pb : key_set_pb.keys()) {
+    ZETASQL_ASSIGN_OR_RETURN(backend::Key key, KeyFromProto(key_pb, table));
+    const int partition =
+        std::upper_bound(split_keys.begin(), split_keys.end(), key) -
+        split_keys.begin();
+    *partitions[partition].add_keys() = key_pb;
+  }
+
+  std::vector<spanner_api::KeyRange> range_pbs(key_set_pb.ranges().begin(),
+                                               key_set_pb.ranges().end());
+  if (key_set_pb.all()) {
+    spanner_api::KeyRange& all_pb = range_pbs.emplace_back();
+    all_pb.mutable_start_closed();
+    all_pb.mutable_end_closed();
+  }
+  for (const spanner_api::KeyRange& range_pb : range_pbs) {
+    ZETASQL_ASSIGN_OR_RETURN(backend::KeyRange range,
+                     KeyRangeFromProto(range_pb, table));
+    range = range.ToClosedOpen();
+    for (int i = 0; i < partitions.size(); ++i) {
+      const bool clip_start = i > 0 && range.start_key() < split_keys[i - 1];
+      const bool clip_limit =
+          i < split_keys.size() && range.limit_key() > split_keys[i];
+      const backend::Key& start =
+          clip_start ? split_keys[i - 1] : range.start_key();
+      const backend::Key& limit =
+          clip_limit ? split_keys[i] : range.limit_key();
+      if (start >= limit) {
+        continue;
+      }
+      spanner_api::KeyRange* partition_range_pb = partitions[i].add_ranges();
+      *partition_range_pb = range_pb;
+      if (clip_start) {
+        *partition_range_pb->mutable_start_closed() = split_key_pbs[i - 1];
+      }
+      if (clip_limit) {
+        *partition_range_pb->mutable_end_open() = split_key_pbs[i];
+      }
+    }
+  }
+  return partitions;
+}
+
 // Create a partition token for the given partition query request.
 absl::StatusOr<PartitionToken> CreatePartitionTokenForQuery(
     const google::spanner::v1::PartitionQueryRequest& request,
@@ -142,24 +339,25 @@ absl::Status PartitionRead(RequestContext* ctx,
     ZETASQL_ASSIGN_OR_RETURN(*response->mutable_transaction(), txn->ToProto());
   }
 
-  // Add two partitions to result set, with first partition being empty.
-  ZETASQL_ASSIGN_OR_RETURN(
-      auto empty_partition_token,
-      CreatePartitionTokenForRead(*request, txn->id(), spanner_api::KeySet()));
-  spanner_api::Partition empty_partition;
-  ZETASQL_ASSIGN_OR_RETURN(*empty_partition.mutable_partition_token(),
-                   PartitionTokenToString(empty_partition_token));
-
-  // Second partition contains full result set for requested key_set.
+  // Split the requested key set at keys of the rows it matches, such that each
+  // partition holds about partition_size_bytes of data.
+  ZETASQL_ASSIGN_OR_RETURN(const backend::Table* table,
+                   GetPartitionedTable(*txn->schema(), *request));
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<RowSample> samples,
+                   SampleRows(*request, *table, txn.get()));
   ZETASQL_ASSIGN_OR_RETURN(
-      auto full_partition_token,
-      CreatePartitionTokenForRead(*request, txn->id(), request->key_set()));
-  spanner_api::Partition full_partition;
-  ZETASQL_ASSIGN_OR_RETURN(*full_partition.mutable_partition_token(),
-                   PartitionTokenToString(full_partition_token));
+      std::vector<spanner_api::KeySet> partitioned_key_sets,
+      SplitKeySet(request->key_set(), *table,
+                  ComputeSplitKeys(samples, request->partition_options())));
 
-  *response->mutable_partitions()->Add() = empty_partition;
-  *response->mutable_partitions()->Add() = full_partition;
+  for (const spanner_api::KeySet& partitioned_key_set : partitioned_key_sets) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        PartitionToken partition_token,
+        CreatePartitionTokenForRead(*request, txn->id(), partitioned_key_set));
+    ZETASQL_ASSIGN_OR_RETURN(
+        *response->add_partitions()->mutable_partition_token(),
+        PartitionTokenToString(partition_token));
+  }
 
   return absl::OkStatus();
 }
@@ -14,6 +14,9 @@
 // limitations under the License.
 //
 
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -21,6 +24,9 @@
 #include <variant>
 #include <vector>
 
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/struct.pb.h"
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
@@ -28,25 +34,35 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
 #include "backend/access/read.h"
+#include "backend/query/analyzed_query_cache.h"
 #include "backend/query/change_stream/change_stream_query_validator.h"
 #include "backend/query/query_engine.h"
+#include "common/config.h"
 #include "common/constants.h"
 #include "common/errors.h"
+#include "common/limits.h"
 #include "frontend/common/protos.h"
+#include "frontend/converters/chunking.h"
 #include "frontend/converters/partition.h"
 #include "frontend/converters/query.h"
 #include "frontend/converters/reads.h"
 #include "frontend/converters/types.h"
 #include "frontend/converters/values.h"
+#include "frontend/entities/database.h"
 #include "frontend/entities/session.h"
 #include "frontend/entities/transaction.h"
 #include "frontend/handlers/change_streams.h"
 #include "frontend/proto/partition_token.pb.h"
 #include "frontend/server/handler.h"
+#include "frontend/server/pipelined_stream.h"
 #include "frontend/server/request_context.h"
+#include "frontend/server/resource_accounting.h"
 #include "farmhash.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
@@ -62,6 +78,36 @@ namespace {
 
 absl::Duration kMaxFutureReadDuration = absl::Hours(1);
 
+// Returns the deadline of the request, or an infinite future if the client did
+// not set one.
+absl::Time RequestDeadline(RequestContext* ctx) {
+  if (ctx->grpc() == nullptr ||
+      ctx->grpc()->deadline() == std::chrono::system_clock::time_point::max()) {
+    return absl::InfiniteFuture();
+  }
+  return absl::FromChrono(ctx->grpc()->deadline());
+}
+
+// Returns a function which reports whether the client has cancelled the
+// request, so that the queries executed for it can be abandoned.
+std::function<bool()> RequestCancelled(RequestContext* ctx) {
+  grpc::ServerContext* grpc = ctx->grpc();
+  if (grpc == nullptr) {
+    return nullptr;
+  }
+  return [grpc]() { return grpc->IsCancelled(); };
+}
+
+// Makes query count the rows it scans and returns towards the resource usage
+// of the request, if counted.
+void CountRows(RequestContext* ctx, backend::Query* query) {
+  if (RpcResourceCounters* counters = ctx->resource_counters();
+      counters != nullptr) {
+    query->rows_scanned = counters->rows_scanned();
+    query->rows_returned = counters->rows_returned();
+  }
+}
+
 absl::Status ValidateReadTimestampNotTooFarInFuture(absl::Time read_timestamp,
                                                     absl::Time now) {
   if (read_timestamp - now > kMaxFutureReadDuration) {
@@ -138,56 +184,182 @@ absl::Status ValidatePartitionToken(
   return absl::OkStatus();
 }
 
+// Populates stats from the execution statistics of result. bytes_returned is
+// the serialized size of the rows sent back to the client. All values are
+// strings, matching the query stats returned by Cloud Spanner.
 void AddQueryStatsFromQueryResult(const backend::QueryResult& result,
+                                  int64_t bytes_returned,
                                   google::protobuf::Struct* stats) {
-  (*stats->mutable_fields())["rows_returned"].set_string_value(
+  auto& fields = *stats->mutable_fields();
+  fields["rows_returned"].set_string_value(
       absl::StrCat(result.num_output_rows));
-  (*stats->mutable_fields())["elapsed_time"].set_string_value(
+  fields["elapsed_time"].set_string_value(
       absl::FormatDuration(result.elapsed_time));
+  fields["bytes_returned"].set_string_value(absl::StrCat(bytes_returned));
+
+  const backend::QueryExecutionStats& execution = result.stats;
+  fields["rows_scanned"].set_string_value(
+      absl::StrCat(execution.rows_scanned));
+  fields["analysis_cached"].set_string_value(
+      execution.analysis_cached ? "true" : "false");
+  fields["cpu_time"].set_string_value(absl::FormatDuration(
+      execution.analyze_cpu_time + execution.prepare_cpu_time +
+      execution.execute_cpu_time));
+  fields["analyze_cpu_time"].set_string_value(
+      absl::FormatDuration(execution.analyze_cpu_time));
+  fields["prepare_cpu_time"].set_string_value(
+      absl::FormatDuration(execution.prepare_cpu_time));
+  fields["execute_cpu_time"].set_string_value(
+      absl::FormatDuration(execution.execute_cpu_time));
+  // The tracker's peak also covers the conversion of the rows to protos.
+  fields["peak_memory_bytes"].set_string_value(
+      absl::StrCat(result.memory != nullptr ? result.memory->peak_bytes()
+                                            : execution.peak_memory_bytes));
+
+  // Each read is described as "<table>[.<index>] <key ranges>: <rows>".
+  std::vector<std::string> scans;
+  for (const backend::TableScanStats& scan : execution.table_scans) {
+    scans.push_back(absl::StrCat(
+        scan.table, scan.index.empty() ? "" : ".", scan.index, " ",
+        scan.key_ranges, ": ", scan.rows_scanned));
+  }
+  fields["table_scans"].set_string_value(absl::StrJoin(scans, "; "));
+}
+
+// Sends the rows of a SELECT query to the client as they are read from the
+// cursor rather than converting the entire result before sending anything.
+// No resume tokens are handed out: rows which tie under an ORDER BY come back
+// in a scrambled order, so a restarted query may not return the same rows in
+// the same order.
+absl::Status StreamQueryResult(
+    const spanner_api::ExecuteSqlRequest* request, Transaction* txn,
+    const backend::QueryResult& result,
+    ResultSetMetadataCache* metadata_cache,
+    ServerStream<spanner_api::PartialResultSet>* stream) {
+  // Chunks are written on a thread of their own, so that the next one is
+  // produced while the previous one is being sent.
+  PipelinedServerStream<spanner_api::PartialResultSet> pipeline(stream);
+  StreamingChunkSizer chunk_sizer(config::min_streaming_chunk_size(),
+                                  limits::kMaxStreamingChunkSize);
+  bool is_first_response = true;
+  ZETASQL_RETURN_IF_ERROR(StreamRowCursorToPartialResultSetProtos(
+      result.rows.get(), /*limit=*/0,
+      [&](spanner_api::PartialResultSet* response) -> absl::Status {
+        // Populate transaction metadata.
+        if (is_first_response &&
+            ShouldReturnTransaction(request->transaction())) {
+          ZETASQL_ASSIGN_OR_RETURN(
+              *response->mutable_metadata()->mutable_transaction(),
+              txn->ToProto());
+        }
+        is_first_response = false;
+        if (!pipeline.Send(*response)) {
+          // Stop reading rows nobody will receive.
+          return error::StreamClosedByClient();
+        }
+        chunk_sizer.RecordSend(pipeline.last_send_waited());
+        return absl::OkStatus();
+      },
+      /*resume_token=*/"", /*emit_resume_tokens=*/false, metadata_cache,
+      &chunk_sizer));
+  if (!pipeline.Close()) {
+    return error::StreamClosedByClient();
+  }
+  return absl::OkStatus();
 }
 
+// Executes a statement of a batch. Statements with the same text and parameter
+// types are analyzed and prepared once per batch through statement_cache.
 absl::StatusOr<backend::QueryResult> ExecuteQuery(
+    RequestContext* ctx,
     const spanner_api::ExecuteBatchDmlRequest_Statement& statement,
-    std::shared_ptr<Transaction> txn) {
-  ZETASQL_ASSIGN_OR_RETURN(const backend::Query query,
+    std::shared_ptr<Transaction> txn,
+    backend::AnalyzedQueryCache* statement_cache) {
+  ZETASQL_ASSIGN_OR_RETURN(backend::Query query,
                    QueryFromProto(statement.sql(), statement.params(),
                                   statement.param_types(),
                                   txn->query_engine()->type_factory()));
-  return txn->ExecuteSql(query);
+  query.statement_cache = statement_cache;
+  CountRows(ctx, &query);
+  return txn->ExecuteSql(query, RequestDeadline(ctx), RequestCancelled(ctx));
 }
 
+// A ZeroCopyOutputStream which fingerprints the bytes written to it as they
+// are written, a buffer at a time, instead of collecting them in a string.
+class FingerprintOutputStream
+    : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  bool Next(void** data, int* size) override {
+    Fold();
+    *data = buffer_;
+    *size = sizeof(buffer_);
+    buffered_ = sizeof(buffer_);
+    return true;
+  }
+
+  void BackUp(int count) override { buffered_ -= count; }
+
+  int64_t ByteCount() const override { return byte_count_ + buffered_; }
+
+  // Returns the fingerprint of the bytes written so far.
+  int64_t Fingerprint() {
+    Fold();
+    return fingerprint_;
+  }
+
+ private:
+  // Folds the buffered bytes into the fingerprint.
+  void Fold() {
+    if (buffered_ == 0) return;
+    fingerprint_ = farmhash::Fingerprint(farmhash::Uint128(
+        fingerprint_, farmhash::Fingerprint64(buffer_, buffered_)));
+    byte_count_ += buffered_;
+    buffered_ = 0;
+  }
+
+  char buffer_[4096];
+  int buffered_ = 0;
+  int64_t byte_count_ = 0;
+  uint64_t fingerprint_ = 0;
+};
+
 template <typename Request>
 int64_t SerializeAndHashRequest(const Request& request) {
-  std::string serialized_request;
+  FingerprintOutputStream stream;
   {
     // Serialize the request proto deterministically.
     // Message::SerializeToString() is not guaranteed to deterministically
     // generate the same string for a message that contains map fields.
     // We create the output stream in an inner scope so that it gets flushed
     // in the destructor before computing the fingerprint.
-    google::protobuf::io::StringOutputStream stream(&serialized_request);
     google::protobuf::io::CodedOutputStream output(&stream);
     output.SetSerializationDeterministic(true);
     request.SerializeToCodedStream(&output);
   }
-  return farmhash::Fingerprint64(serialized_request);
+  return stream.Fingerprint();
 }
 
-int64_t HashRequest(const spanner_api::ExecuteSqlRequest* request) {
-  spanner_api::ExecuteSqlRequest copy = *request;
-  // Clearing resume token and sequence number so that the hash is based
-  // entirely on the sql statement.
-  copy.clear_resume_token();
-  copy.set_seqno(0);
-  return SerializeAndHashRequest(copy);
+// The hash of a request is only compared with that of other requests with the
+// same sequence number, so the sequence number is hashed along with the rest
+// of the request rather than copying the request to clear it. The copy of a
+// resumed request is made on arena.
+int64_t HashRequest(const spanner_api::ExecuteSqlRequest* request,
+                    google::protobuf::Arena* arena) {
+  if (request->resume_token().empty()) {
+    return SerializeAndHashRequest(*request);
+  }
+  // Clearing the resume token so that a resumed request hashes like the
+  // original one.
+  auto* copy =
+      google::protobuf::Arena::CreateMessage<spanner_api::ExecuteSqlRequest>(
+          arena);
+  *copy = *request;
+  copy->clear_resume_token();
+  return SerializeAndHashRequest(*copy);
 }
 
 int64_t HashRequest(const spanner_api::ExecuteBatchDmlRequest* request) {
-  spanner_api::ExecuteBatchDmlRequest copy = *request;
-  // Clearing sequence number so that the hash is based entirely on the sql
-  // statement.
-  copy.set_seqno(0);
-  return SerializeAndHashRequest(copy);
+  return SerializeAndHashRequest(*request);
 }
 
 }  //  namespace
@@ -215,7 +387,8 @@ absl::Status ExecuteSql(RequestContext* ctx,
         // Register DML request and check for status replay.
         if (is_dml_query) {
           const auto state = txn->LookupOrRegisterDmlRequest(
-              request->seqno(), HashRequest(request), request->sql());
+              request->seqno(), HashRequest(request, ctx->arena()),
+              request->sql());
           if (state.has_value()) {
             if (!state->status.ok()) {
               return state->status;
@@ -255,11 +428,15 @@ absl::Status ExecuteSql(RequestContext* ctx,
         }
 
         // Convert and execute provided SQL statement.
-        ZETASQL_ASSIGN_OR_RETURN(const backend::Query query,
+        ZETASQL_ASSIGN_OR_RETURN(backend::Query query,
                          QueryFromProto(request->sql(), request->params(),
                                         request->param_types(),
                                         txn->query_engine()->type_factory()));
-        auto maybe_result = txn->ExecuteSql(query);
+        query.collect_stats =
+            request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE;
+        CountRows(ctx, &query);
+        auto maybe_result = txn->ExecuteSql(query, RequestDeadline(ctx),
+                                            RequestCancelled(ctx));
         if (!maybe_result.ok()) {
           absl::Status error = maybe_result.status();
           if (txn->IsPartitionedDml()) {
@@ -291,12 +468,14 @@ absl::Status ExecuteSql(RequestContext* ctx,
             response->mutable_metadata()->mutable_row_type();
           } else {
             // It contains DML THEN RETURN row results.
-            ZETASQL_RETURN_IF_ERROR(RowCursorToResultSetProto(result.rows.get(),
-                                                      /*limit=*/0, response));
+            ZETASQL_RETURN_IF_ERROR(RowCursorToResultSetProto(
+                result.rows.get(), /*limit=*/0, response, result.memory.get(),
+                session->database()->metadata_cache()));
           }
         } else {
-          ZETASQL_RETURN_IF_ERROR(RowCursorToResultSetProto(result.rows.get(),
-                                                    /*limit=*/0, response));
+          ZETASQL_RETURN_IF_ERROR(RowCursorToResultSetProto(
+              result.rows.get(), /*limit=*/0, response, result.memory.get(),
+              session->database()->metadata_cache()));
         }
 
         if (!request->partition_token().empty()) {
@@ -309,12 +488,14 @@ absl::Status ExecuteSql(RequestContext* ctx,
           }
         }
 
-        // Add basic stats for PROFILE mode. We do this to interoperate with
-        // REPL applications written for Cloud Spanner. The profile will not
-        // contain statistics for plan nodes.
+        // Add execution stats for PROFILE mode. We do this to interoperate
+        // with REPL applications written for Cloud Spanner. The profile will
+        // not contain statistics for plan nodes, but does describe the table
+        // and index reads the query issued.
         if (request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE) {
           AddQueryStatsFromQueryResult(
-              result, response->mutable_stats()->mutable_query_stats());
+              result, response->ByteSizeLong(),
+              response->mutable_stats()->mutable_query_stats());
         }
 
         // Reject requests for PLAN mode. The emulator uses ZetaSQL reference
@@ -335,8 +516,8 @@ REGISTER_GRPC_HANDLER(Spanner, ExecuteSql);
 
 // Executes a SQL statement, returning all results as a stream.
 //
-// resume_tokens is not supported in the emulator. This implementation does not
-// limit the size of the response and therefore, chunked_value will always be
+// Plain SELECT queries are streamed in chunks, without resume tokens. Other
+// statements are sent as a single response, so their chunked_value is always
 // false.
 absl::Status ExecuteStreamingSql(
     RequestContext* ctx, const spanner_api::ExecuteSqlRequest* request,
@@ -364,7 +545,8 @@ absl::Status ExecuteStreamingSql(
         // Register DML request and check for status replay.
         if (is_dml_query) {
           const auto state = txn->LookupOrRegisterDmlRequest(
-              request->seqno(), HashRequest(request), request->sql());
+              request->seqno(), HashRequest(request, ctx->arena()),
+              request->sql());
           if (state.has_value()) {
             if (!state->status.ok()) {
               return state->status;
@@ -374,12 +556,13 @@ absl::Status ExecuteStreamingSql(
               return error::ReplayRequestMismatch(request->seqno(),
                                                   request->sql());
             }
-            spanner_api::PartialResultSet response;
-            spanner_api::ResultSet replay_result =
+            auto* response = google::protobuf::Arena::CreateMessage<
+                spanner_api::PartialResultSet>(ctx->arena());
+            const spanner_api::ResultSet& replay_result =
                 std::get<spanner_api::ResultSet>(state->outcome);
-            *response.mutable_stats() = replay_result.stats();
-            *response.mutable_metadata() = replay_result.metadata();
-            stream->Send(response);
+            *response->mutable_stats() = replay_result.stats();
+            *response->mutable_metadata() = replay_result.metadata();
+            stream->Send(*response);
             return state->status;
           }
 
@@ -408,10 +591,20 @@ absl::Status ExecuteStreamingSql(
               read_timestamp, ctx->env()->clock()->Now()));
         }
         // Convert and execute provided SQL statement.
-        ZETASQL_ASSIGN_OR_RETURN(const backend::Query query,
+        ZETASQL_ASSIGN_OR_RETURN(backend::Query query,
                          QueryFromProto(request->sql(), request->params(),
                                         request->param_types(),
                                         txn->query_engine()->type_factory()));
+        // Plain SELECT queries stream their rows back as they are evaluated.
+        // PROFILE stats need the full row count up front and partitioned
+        // queries may discard their rows, so those are still materialized.
+        query.stream_results =
+            !is_dml_query &&
+            request->query_mode() == spanner_api::ExecuteSqlRequest::NORMAL &&
+            request->partition_token().empty();
+        query.collect_stats =
+            request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE;
+        CountRows(ctx, &query);
         ZETASQL_ASSIGN_OR_RETURN(change_stream_metadata,
                          backend::QueryEngine::TryGetChangeStreamMetadata(
                              query, txn->schema()));
@@ -420,7 +613,8 @@ absl::Status ExecuteStreamingSql(
         if (change_stream_metadata.is_change_stream_query) {
           return absl::OkStatus();
         }
-        auto maybe_result = txn->ExecuteSql(query);
+        auto maybe_result = txn->ExecuteSql(query, RequestDeadline(ctx),
+                                            RequestCancelled(ctx));
         if (!maybe_result.ok()) {
           absl::Status error = maybe_result.status();
           if (txn->IsPartitionedDml()) {
@@ -432,6 +626,12 @@ absl::Status ExecuteStreamingSql(
         }
         backend::QueryResult& result = maybe_result.value();
 
+        if (query.stream_results) {
+          return StreamQueryResult(request, txn.get(), result,
+                                   session->database()->metadata_cache(),
+                                   stream);
+        }
+
         std::vector<spanner_api::PartialResultSet> responses;
         if (is_dml_query) {
           responses.emplace_back();
@@ -447,12 +647,16 @@ absl::Status ExecuteStreamingSql(
             responses.back().mutable_metadata()->mutable_row_type();
           } else {
             // It contains DML THEN RETURN row results.
-            ZETASQL_ASSIGN_OR_RETURN(responses, RowCursorToPartialResultSetProtos(
-                                            result.rows.get(), /*limit=*/0));
+            ZETASQL_ASSIGN_OR_RETURN(responses,
+                             RowCursorToPartialResultSetProtos(
+                                 result.rows.get(), /*limit=*/0,
+                                 session->database()->metadata_cache()));
           }
         } else {
-          ZETASQL_ASSIGN_OR_RETURN(responses, RowCursorToPartialResultSetProtos(
-                                          result.rows.get(), /*limit=*/0));
+          ZETASQL_ASSIGN_OR_RETURN(responses,
+                           RowCursorToPartialResultSetProtos(
+                               result.rows.get(), /*limit=*/0,
+                               session->database()->metadata_cache()));
         }
 
         if (!request->partition_token().empty()) {
@@ -476,12 +680,18 @@ absl::Status ExecuteStreamingSql(
               txn->ToProto());
         }
 
-        // Add basic stats for PROFILE mode. We do this to interoperate with
-        // REPL applications written for Cloud Spanner. The profile will not
-        // contain statistics for plan nodes.
+        // Add execution stats for PROFILE mode. We do this to interoperate
+        // with REPL applications written for Cloud Spanner. The profile will
+        // not contain statistics for plan nodes, but does describe the table
+        // and index reads the query issued.
         if (request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE) {
+          int64_t bytes_returned = 0;
+          for (const auto& response : responses) {
+            bytes_returned += response.ByteSizeLong();
+          }
           AddQueryStatsFromQueryResult(
-              result, responses.front().mutable_stats()->mutable_query_stats());
+              result, bytes_returned,
+              responses.front().mutable_stats()->mutable_query_stats());
         }
 
         // Reject requests for PLAN mode. The emulator uses ZetaSQL reference
@@ -577,6 +787,8 @@ absl::Status ExecuteBatchDml(RequestContext* ctx,
       return error::CannotReadOrQueryAfterCommitOrRollback();
     }
 
+    backend::AnalyzedQueryCache statement_cache(
+        /*capacity=*/request->statements_size());
     for (int index = 0; index < request->statements_size(); ++index) {
       const auto& statement = request->statements(index);
       if (!backend::IsDMLQuery(statement.sql())) {
@@ -587,7 +799,8 @@ absl::Status ExecuteBatchDml(RequestContext* ctx,
         return absl::OkStatus();
       }
 
-      const auto maybe_result = ExecuteQuery(statement, txn);
+      const auto maybe_result =
+          ExecuteQuery(ctx, statement, txn, &statement_cache);
       if (!maybe_result.ok() &&
           maybe_result.status().code() != absl::StatusCode::kAborted) {
         absl::Status error = maybe_result.status();
@@ -30,6 +30,7 @@
 #include "absl/strings/string_view.h"
 #include "backend/datamodel/types.h"
 #include "common/errors.h"
+#include "common/limits.h"
 #include "frontend/converters/types.h"
 #include "frontend/converters/values.h"
 #include "tests/common/test_env.h"
@@ -127,6 +128,46 @@ TEST_F(QueryApiTest, ExecuteBatchDml) {
                             )"));
 }
 
+TEST_F(QueryApiTest, ReplaysOnlyRecentDmlRequests) {
+  spanner_api::BeginTransactionRequest begin_request = PARSE_TEXT_PROTO(R"(
+    options { read_write {} }
+  )");
+  begin_request.set_session(test_session_uri_);
+  spanner_api::Transaction transaction_response;
+  ZETASQL_ASSERT_OK(BeginTransaction(begin_request, &transaction_response));
+
+  auto dml_request = [&](int64_t seqno) {
+    spanner_api::ExecuteSqlRequest request;
+    request.set_session(test_session_uri_);
+    request.mutable_transaction()->set_id(transaction_response.id());
+    request.set_sql(absl::StrFormat(
+        "INSERT INTO test_table(int64_col, string_col) VALUES (%d, 'row')",
+        100 + seqno));
+    request.set_seqno(seqno);
+    return request;
+  };
+  const int64_t last_seqno = limits::kMaxReplayableDmlRequests + 1;
+  for (int64_t seqno = 1; seqno <= last_seqno; ++seqno) {
+    spanner_api::ResultSet response;
+    ZETASQL_ASSERT_OK(ExecuteSql(dml_request(seqno), &response));
+  }
+
+  // The latest request is replayed instead of inserting its row again.
+  spanner_api::ResultSet response;
+  ZETASQL_ASSERT_OK(ExecuteSql(dml_request(last_seqno), &response));
+  EXPECT_EQ(response.stats().row_count_exact(), 1);
+
+  // The same sequence number with another statement is not a replay.
+  spanner_api::ExecuteSqlRequest mismatch = dml_request(last_seqno);
+  mismatch.set_sql("DELETE FROM test_table WHERE true");
+  EXPECT_THAT(ExecuteSql(mismatch, &response),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  // The first request can no longer be replayed.
+  EXPECT_THAT(ExecuteSql(dml_request(1), &response),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST_F(QueryApiTest, ExecuteBatchDmlFailsOnInvalidDmlStatement) {
   spanner_api::BeginTransactionRequest begin_request = PARSE_TEXT_PROTO(R"(
     options { read_write {} }
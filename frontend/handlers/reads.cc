@@ -16,18 +16,32 @@
 
 #include "frontend/converters/reads.h"
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
 
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "google/spanner/v1/transaction.pb.h"
 #include "backend/common/ids.h"
+#include "backend/database/database.h"
+#include "backend/query/read_stats_aggregator.h"
+#include "common/config.h"
 #include "common/errors.h"
+#include "common/limits.h"
 #include "frontend/common/protos.h"
+#include "frontend/converters/chunking.h"
+#include "frontend/entities/database.h"
 #include "frontend/entities/session.h"
 #include "frontend/entities/transaction.h"
 #include "frontend/server/handler.h"
+#include "frontend/server/pipelined_stream.h"
+#include "frontend/server/resource_accounting.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "zetasql/base/status_macros.h"
 
 namespace google {
@@ -59,6 +73,29 @@ absl::Status ValidateTransactionSelectorForRead(
   return absl::OkStatus();
 }
 
+// Records a read of read_arg which returned rows and bytes for the
+// SPANNER_SYS read statistics of the session's database, and as rows scanned
+// and returned by the request.
+void RecordReadStats(RequestContext* ctx, const Session& session,
+                     const Transaction& txn, const backend::ReadArg& read_arg,
+                     int64_t rows, int64_t bytes, absl::Time start) {
+  if (RpcResourceCounters* counters = ctx->resource_counters();
+      counters != nullptr) {
+    counters->AddRowsScanned(rows);
+    counters->AddRowsReturned(rows);
+  }
+  backend::ReadExecutionSample sample;
+  for (const std::string& column : read_arg.columns) {
+    sample.read_columns.insert(absl::StrCat(read_arg.table, ".", column));
+  }
+  sample.rows = rows;
+  sample.bytes = bytes;
+  sample.in_read_write_transaction = !txn.IsReadOnly();
+  const absl::Time now = absl::Now();
+  sample.latency = now - start;
+  session.database()->backend()->read_stats()->Record(sample, now);
+}
+
 }  //  namespace
 
 // Reads rows from the database, returning all results in a single reply.
@@ -89,6 +126,7 @@ absl::Status Read(RequestContext* ctx, const spanner_api::ReadRequest* request,
     }
 
     // Parse read request.
+    const absl::Time start = absl::Now();
     backend::ReadArg read_arg;
     ZETASQL_RETURN_IF_ERROR(ReadArgFromProto(*txn->schema(), *request, &read_arg));
 
@@ -103,16 +141,23 @@ absl::Status Read(RequestContext* ctx, const spanner_api::ReadRequest* request,
     }
 
     // Convert read results to proto.
-    return RowCursorToResultSetProto(cursor.get(), request->limit(), response);
+    ZETASQL_RETURN_IF_ERROR(RowCursorToResultSetProto(
+        cursor.get(), request->limit(), response, /*memory=*/nullptr,
+        session->database()->metadata_cache()));
+    RecordReadStats(ctx, *session, *txn, read_arg, response->rows_size(),
+                    response->ByteSizeLong(), start);
+    return absl::OkStatus();
   });
 }
 REGISTER_GRPC_HANDLER(Spanner, Read);
 
 // Reads rows from the database, returning all results as a stream.
 //
-// StreamingReads do not support resume_tokens in the emulator. This
-// implementation does not limit the size of the response and therefore,
-// chunked_value will always be false.
+// Rows are encoded into arena allocated PartialResultSets which are sent to the
+// client one at a time, so the whole result is never held in memory at once.
+// Since rows are read in key order, a read which is restarted with a resume
+// token reads the same rows again, at the read timestamp of the interrupted
+// read, and skips the ones which were already sent.
 absl::Status StreamingRead(
     RequestContext* ctx, const spanner_api::ReadRequest* request,
     ServerStream<spanner_api::PartialResultSet>* stream) {
@@ -122,8 +167,11 @@ absl::Status StreamingRead(
 
   // Get underlying transaction.
   ZETASQL_RETURN_IF_ERROR(ValidateTransactionSelectorForRead(request->transaction()));
+  spanner_api::TransactionSelector selector = request->transaction();
+  ZETASQL_RETURN_IF_ERROR(
+      PinSelectorToResumeToken(request->resume_token(), &selector));
   ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Transaction> txn,
-                   session->FindOrInitTransaction(request->transaction()));
+                   session->FindOrInitTransaction(selector));
 
   // Wrap all operations on this transaction so they are atomic.
   return txn->GuardedCall(Transaction::OpType::kRead, [&]() -> absl::Status {
@@ -134,13 +182,17 @@ absl::Status StreamingRead(
     if (txn->IsCommitted() || txn->IsRolledback()) {
       return error::CannotReadOrQueryAfterCommitOrRollback();
     }
+    std::optional<absl::Time> read_timestamp;
     if (txn->IsReadOnly()) {
-      ZETASQL_ASSIGN_OR_RETURN(absl::Time read_timestamp, txn->GetReadTimestamp());
+      ZETASQL_ASSIGN_OR_RETURN(read_timestamp, txn->GetReadTimestamp());
       ZETASQL_RETURN_IF_ERROR(ValidateReadTimestampNotTooFarInFuture(
-          read_timestamp, ctx->env()->clock()->Now()));
+          *read_timestamp, ctx->env()->clock()->Now()));
     }
+    ZETASQL_RETURN_IF_ERROR(ValidateResumeTokenReadTimestamp(request->resume_token(),
+                                                     read_timestamp));
 
     // Parse read request.
+    const absl::Time start = absl::Now();
     backend::ReadArg read_arg;
     ZETASQL_RETURN_IF_ERROR(ReadArgFromProto(*txn->schema(), *request, &read_arg));
 
@@ -148,22 +200,44 @@ absl::Status StreamingRead(
     std::unique_ptr<backend::RowCursor> cursor;
     ZETASQL_RETURN_IF_ERROR(txn->Read(read_arg, &cursor));
 
-    // Convert read results to protos.
-    ZETASQL_ASSIGN_OR_RETURN(
-        std::vector<spanner_api::PartialResultSet> responses,
-        RowCursorToPartialResultSetProtos(cursor.get(), request->limit()));
-
-    // Populate transaction metadata.
-    if (ShouldReturnTransaction(request->transaction())) {
-      ZETASQL_ASSIGN_OR_RETURN(
-          *responses.front().mutable_metadata()->mutable_transaction(),
-          txn->ToProto());
-    }
-
-    // Send results back to client.
-    for (const auto& response : responses) {
-      stream->Send(response);
+    // Convert read results to protos and send them back to the client as
+    // they are produced. The protos are written on a thread of their own, so
+    // that the next one is encoded while the previous one is being sent.
+    PipelinedServerStream<spanner_api::PartialResultSet> pipeline(stream);
+    StreamingChunkSizer chunk_sizer(config::min_streaming_chunk_size(),
+                                    limits::kMaxStreamingChunkSize);
+    bool is_first_response = true;
+    int64_t values = 0;
+    int64_t bytes = 0;
+    ZETASQL_RETURN_IF_ERROR(StreamRowCursorToPartialResultSetProtos(
+        cursor.get(), request->limit(),
+        [&](spanner_api::PartialResultSet* response) -> absl::Status {
+          // Populate transaction metadata.
+          if (is_first_response &&
+              ShouldReturnTransaction(request->transaction())) {
+            ZETASQL_ASSIGN_OR_RETURN(
+                *response->mutable_metadata()->mutable_transaction(),
+                txn->ToProto());
+          }
+          is_first_response = false;
+          // A chunked value continues in the next response.
+          values += response->values_size() - response->chunked_value();
+          bytes += response->ByteSizeLong();
+          if (!pipeline.Send(*response)) {
+            // Stop reading rows nobody will receive.
+            return error::StreamClosedByClient();
+          }
+          chunk_sizer.RecordSend(pipeline.last_send_waited());
+          return absl::OkStatus();
+        },
+        request->resume_token(), /*emit_resume_tokens=*/true,
+        session->database()->metadata_cache(), &chunk_sizer, read_timestamp));
+    if (!pipeline.Close()) {
+      return error::StreamClosedByClient();
     }
+    const int64_t columns = read_arg.columns.size();
+    RecordReadStats(ctx, *session, *txn, read_arg,
+                    columns == 0 ? 0 : values / columns, bytes, start);
     return absl::OkStatus();
   });
 }
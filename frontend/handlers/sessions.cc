@@ -63,7 +63,8 @@ absl::Status CreateSession(RequestContext* ctx,
                 request->session().labels().end());
   ZETASQL_ASSIGN_OR_RETURN(
       std::shared_ptr<Session> session,
-      ctx->env()->session_manager()->CreateSession(labels, database));
+      ctx->env()->session_manager()->CreateSession(
+          labels, database, IsMultiplexedSession(request->session())));
 
   // Return details about the newly created session.
   return session->ToProto(response, /*include_labels=*/true);
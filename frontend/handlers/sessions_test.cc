@@ -15,6 +15,7 @@
 //
 
 #include <string>
+#include <vector>
 
 #include "google/protobuf/empty.pb.h"
 #include "google/spanner/admin/database/v1/spanner_database_admin.pb.h"
@@ -26,6 +27,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "frontend/common/protos.h"
 #include "frontend/common/uris.h"
+#include "frontend/entities/session.h"
 #include "tests/common/test_env.h"
 
 namespace google {
@@ -164,6 +166,50 @@ TEST_F(SessionApiTest, CanBeginAndUseMultipleTransactionsInSameSession) {
               StatusIs(absl::StatusCode::kFailedPrecondition));
 }
 
+TEST_F(SessionApiTest, MultiplexedSessionKeepsConcurrentTransactions) {
+  // Create a multiplexed session. Session.multiplexed is field 7, which is not
+  // known to the protos the emulator is built against.
+  spanner_api::CreateSessionRequest request;
+  request.set_database(test_database_uri_);
+  request.mutable_session()
+      ->GetReflection()
+      ->MutableUnknownFields(request.mutable_session())
+      ->AddVarint(7, 1);
+  ZETASQL_EXPECT_OK(test_env()->spanner_client()->CreateSession(&context_, request,
+                                                        &response_));
+  EXPECT_TRUE(IsMultiplexedSession(response_));
+  std::string test_sessions_uri = response_.name();
+
+  // Begin more transactions than a regular session tracks.
+  std::vector<std::string> ids;
+  for (int i = 0; i < 50; ++i) {
+    spanner_api::BeginTransactionRequest txn_request = PARSE_TEXT_PROTO(R"(
+      options { read_only {} }
+    )");
+    txn_request.set_session(test_sessions_uri);
+
+    spanner_api::Transaction txn_response;
+    ZETASQL_ASSERT_OK(BeginTransaction(txn_request, &txn_response));
+    ids.push_back(txn_response.id());
+  }
+
+  spanner_api::ReadRequest read_request = PARSE_TEXT_PROTO(R"(
+    table: "test_table"
+    columns: "int64_col"
+    key_set {}
+  )");
+  read_request.set_session(test_sessions_uri);
+
+  // Using a newer transaction does not invalidate the older ones.
+  spanner_api::ResultSet read_response;
+  for (int i = ids.size() - 1; i >= 0; --i) {
+    read_request.mutable_transaction()->set_id(ids[i]);
+    ZETASQL_EXPECT_OK(Read(read_request, &read_response));
+  }
+  read_request.mutable_transaction()->set_id(ids.back());
+  ZETASQL_EXPECT_OK(Read(read_request, &read_response));
+}
+
 }  // namespace
 
 }  // namespace frontend
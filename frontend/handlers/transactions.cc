@@ -14,7 +14,11 @@
 // limitations under the License.
 //
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "google/protobuf/empty.pb.h"
 #include "google/spanner/v1/commit_response.pb.h"
@@ -23,12 +27,17 @@
 #include "google/spanner/v1/transaction.pb.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "common/config.h"
 #include "common/errors.h"
+#include "frontend/common/protos.h"
 #include "frontend/converters/mutations.h"
 #include "frontend/converters/time.h"
 #include "frontend/entities/session.h"
 #include "frontend/entities/transaction.h"
+#include "frontend/proto/batch_write.pb.h"
 #include "frontend/server/handler.h"
+#include "frontend/server/resource_accounting.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
@@ -39,6 +48,21 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+namespace {
+
+// Accounts the mutations committed by the read-write transaction txn, and the
+// time it held its locks, to counters, if not null.
+void AccountCommit(RpcResourceCounters* counters, const Transaction& txn,
+                   int64_t mutations) {
+  if (counters == nullptr) {
+    return;
+  }
+  counters->AddMutations(mutations);
+  counters->AddLockHoldTime(txn.read_write()->committed_attempt_duration());
+}
+
+}  // namespace
+
 // Begins a new transaction.
 absl::Status BeginTransaction(
     RequestContext* ctx, const spanner_api::BeginTransactionRequest* request,
@@ -117,6 +141,7 @@ absl::Status Commit(RequestContext* ctx,
 
     // Actually commit the request.
     ZETASQL_RETURN_IF_ERROR(txn->Commit());
+    AccountCommit(ctx->resource_counters(), *txn, request->mutations_size());
 
     // Return commit timestamp to user.
     ZETASQL_ASSIGN_OR_RETURN(absl::Time commit_timestamp, txn->GetCommitTimestamp());
@@ -127,6 +152,117 @@ absl::Status Commit(RequestContext* ctx,
 }
 REGISTER_GRPC_HANDLER(Spanner, Commit);
 
+namespace {
+
+// The maximum number of mutation groups of a BatchWrite applied concurrently.
+constexpr int kMaxConcurrentMutationGroups = 8;
+
+// The number of times a mutation group is attempted before its abort is
+// reported to the client.
+constexpr int kMaxMutationGroupAttempts = 10;
+
+// Commits the mutations of a group in a single-use read-write transaction,
+// retrying the transaction if it is aborted by a concurrent group. The commit
+// is accounted to counters, if not null.
+absl::Status ApplyMutationGroup(
+    Session* session,
+    const google::protobuf::RepeatedPtrField<spanner_api::Mutation>& mutations,
+    RpcResourceCounters* counters, absl::Time* commit_timestamp) {
+  spanner_api::TransactionOptions options;
+  options.mutable_read_write();
+  absl::Status status;
+  for (int attempt = 0; attempt < kMaxMutationGroupAttempts; ++attempt) {
+    ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Transaction> txn,
+                     session->CreateSingleUseTransaction(options));
+    status = txn->GuardedCall(Transaction::OpType::kCommit,
+                              [&]() -> absl::Status {
+      backend::Mutation mutation;
+      ZETASQL_RETURN_IF_ERROR(
+          MutationFromProto(*txn->schema(), mutations, &mutation));
+      ZETASQL_RETURN_IF_ERROR(txn->Write(mutation));
+      ZETASQL_RETURN_IF_ERROR(txn->Commit());
+      AccountCommit(counters, *txn, mutations.size());
+      ZETASQL_ASSIGN_OR_RETURN(*commit_timestamp, txn->GetCommitTimestamp());
+      return absl::OkStatus();
+    });
+    if (status.code() != absl::StatusCode::kAborted) {
+      break;
+    }
+  }
+  return status;
+}
+
+}  // namespace
+
+// Applies groups of mutations which are not atomic with respect to each other.
+//
+// With row level locking, up to kMaxConcurrentMutationGroups groups are
+// committed concurrently, so groups touching disjoint rows do not wait for each
+// other. With the default database lock, concurrent groups would only abort
+// each other, so the groups are applied one at a time. Either way, the result
+// of each group is streamed back as soon as the group is done.
+absl::Status BatchWrite(RequestContext* ctx,
+                        const BatchWriteRequest* request,
+                        ServerStream<BatchWriteResponse>* stream) {
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Session> session,
+                   GetSession(ctx, request->session()));
+  if (request->mutation_groups().empty()) {
+    return error::MissingRequiredFieldError(
+        "BatchWriteRequest.mutation_groups");
+  }
+
+  const int num_groups = request->mutation_groups_size();
+  const int num_workers =
+      config::enable_row_level_locking() ||
+              config::enable_optimistic_concurrency()
+          ? std::min(num_groups, kMaxConcurrentMutationGroups)
+          : 1;
+  std::atomic<int> next_group = 0;
+  absl::Mutex stream_mu;
+  bool stream_closed = false;
+  auto apply_groups = [&]() {
+    for (int index = next_group++; index < num_groups; index = next_group++) {
+      BatchWriteResponse response;
+      response.add_indexes(index);
+      absl::Time commit_timestamp;
+      absl::Status status =
+          ApplyMutationGroup(session.get(),
+                             request->mutation_groups(index).mutations(),
+                             ctx->resource_counters(), &commit_timestamp);
+      if (status.ok()) {
+        absl::StatusOr<protobuf_api::Timestamp> timestamp =
+            TimestampToProto(commit_timestamp);
+        if (timestamp.ok()) {
+          *response.mutable_commit_timestamp() = *timestamp;
+        } else {
+          status = timestamp.status();
+        }
+      }
+      *response.mutable_status() = StatusToProto(status);
+
+      absl::MutexLock lock(&stream_mu);
+      if (stream_closed || !stream->Send(response)) {
+        // The client has gone away, stop applying further groups.
+        stream_closed = true;
+        next_group = num_groups;
+        return;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i < num_workers; ++i) {
+    workers.emplace_back(apply_groups);
+  }
+  apply_groups();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  absl::MutexLock lock(&stream_mu);
+  return stream_closed ? error::StreamClosedByClient() : absl::OkStatus();
+}
+REGISTER_GRPC_HANDLER(Spanner, BatchWrite);
+
 // Rolls back a transaction, releasing any locks it holds.
 absl::Status Rollback(RequestContext* ctx,
                       const spanner_api::RollbackRequest* request,
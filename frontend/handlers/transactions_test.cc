@@ -14,8 +14,10 @@
 // limitations under the License.
 //
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "google/spanner/v1/commit_response.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
@@ -32,6 +34,7 @@
 #include "frontend/converters/mutations.h"
 #include "frontend/entities/database.h"
 #include "frontend/entities/session.h"
+#include "frontend/proto/batch_write.pb.h"
 #include "frontend/server/environment.h"
 #include "frontend/server/handler.h"
 #include "frontend/server/request_context.h"
@@ -186,6 +189,56 @@ TEST_F(TransactionApiTest, CommitTransactionIsIdempotent) {
   EXPECT_THAT(commit_response1, test::EqualsProto(commit_response2));
 }
 
+TEST_F(TransactionApiTest, BatchWriteAppliesGroupsIndependently) {
+  BatchWriteRequest request = PARSE_TEXT_PROTO(R"(
+    mutation_groups {
+      mutations {
+        insert {
+          table: "test_table"
+          columns: "int64_col"
+          values { values { string_value: "1" } }
+        }
+      }
+    }
+    mutation_groups {
+      mutations {
+        insert {
+          table: "test_table"
+          columns: "int64_col"
+          values { values { string_value: "2" } }
+        }
+      }
+    }
+    mutation_groups {
+      mutations {
+        insert {
+          table: "test_table"
+          columns: "int64_col"
+          values { values { string_value: "1" } }
+        }
+      }
+    }
+  )");
+  request.set_session(test_session_uri_);
+
+  std::vector<BatchWriteResponse> responses;
+  ZETASQL_ASSERT_OK(BatchWrite(request, &responses));
+  ASSERT_EQ(responses.size(), 3);
+  std::sort(responses.begin(), responses.end(),
+            [](const BatchWriteResponse& a, const BatchWriteResponse& b) {
+              return a.indexes(0) < b.indexes(0);
+            });
+  EXPECT_EQ(responses[0].status().code(), 0);
+  EXPECT_TRUE(responses[0].has_commit_timestamp());
+  EXPECT_EQ(responses[1].status().code(), 0);
+  EXPECT_TRUE(responses[1].has_commit_timestamp());
+  // The last group conflicts with the first one, which does not affect the
+  // groups that were committed.
+  EXPECT_EQ(responses[2].status().code(),
+            static_cast<int>(absl::StatusCode::kAlreadyExists));
+  EXPECT_FALSE(responses[2].has_commit_timestamp());
+}
+
 TEST_F(TransactionApiTest, CanRollbackAlreadyStartedTransaction) {
   spanner_api::BeginTransactionRequest begin_request = PARSE_TEXT_PROTO(R"(
     options { read_write {} }
@@ -0,0 +1,233 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/admission_controller.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "common/errors.h"
+#include "common/metrics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+std::atomic<AdmissionController*> default_controller = nullptr;
+
+// How often an RPC waiting to be admitted checks whether it was cancelled.
+constexpr absl::Duration kCancellationPollInterval = absl::Milliseconds(50);
+
+constexpr absl::string_view kPriorityNames[] = {"short", "long"};
+
+// Methods which do a small, bounded amount of work whatever their request.
+bool IsShortMethod(absl::string_view method_name) {
+  static const auto* methods = new absl::flat_hash_set<absl::string_view>({
+      "BatchCreateSessions",
+      "BeginTransaction",
+      "Commit",
+      "CreateSession",
+      "DeleteSession",
+      "GetOperation",
+      "GetSession",
+      "Rollback",
+  });
+  return methods->contains(method_name);
+}
+
+// Returns true if request, a ReadRequest, only reads individual keys.
+bool IsPointRead(const google::protobuf::Message& request) {
+  const google::protobuf::FieldDescriptor* key_set_field =
+      request.GetDescriptor()->FindFieldByName("key_set");
+  if (key_set_field == nullptr || key_set_field->is_repeated() ||
+      key_set_field->cpp_type() !=
+          google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+    return false;
+  }
+  const google::protobuf::Message& key_set =
+      request.GetReflection()->GetMessage(request, key_set_field);
+  const google::protobuf::Descriptor* descriptor = key_set.GetDescriptor();
+  const google::protobuf::FieldDescriptor* all =
+      descriptor->FindFieldByName("all");
+  const google::protobuf::FieldDescriptor* ranges =
+      descriptor->FindFieldByName("ranges");
+  const google::protobuf::Reflection* reflection = key_set.GetReflection();
+  return all != nullptr && !reflection->GetBool(key_set, all) &&
+         ranges != nullptr && reflection->FieldSize(key_set, ranges) == 0;
+}
+
+}  // namespace
+
+AdmissionController::Ticket& AdmissionController::Ticket::operator=(
+    Ticket&& other) {
+  if (this != &other) {
+    Release();
+    controller_ = std::exchange(other.controller_, nullptr);
+  }
+  return *this;
+}
+
+void AdmissionController::Ticket::Release() {
+  if (controller_ != nullptr) {
+    controller_->Release();
+    controller_ = nullptr;
+  }
+}
+
+AdmissionController::Priority AdmissionController::PriorityOf(
+    absl::string_view method_name, const google::protobuf::Message& request) {
+  if (IsShortMethod(method_name)) return Priority::kShort;
+  if ((method_name == "Read" || method_name == "StreamingRead") &&
+      IsPointRead(request)) {
+    return Priority::kShort;
+  }
+  return Priority::kLong;
+}
+
+AdmissionController* AdmissionController::Default() {
+  return default_controller.load(std::memory_order_acquire);
+}
+
+void AdmissionController::SetDefault(
+    std::unique_ptr<AdmissionController> controller) {
+  default_controller.store(controller.release(), std::memory_order_release);
+}
+
+AdmissionController::AdmissionController(const Options& options)
+    : options_(options) {
+  for (size_t i = 0; i < queue_wait_histograms_.size(); ++i) {
+    queue_wait_histograms_[i] = metrics::GetLatencyHistogram(
+        "emulator_admission_queue_wait_seconds", "priority",
+        kPriorityNames[i]);
+  }
+  gauge_id_ = metrics::RegisterGaugeCallback(
+      "emulator_admission_rpcs", {"state"}, [this]() {
+        absl::MutexLock lock(&mu_);
+        std::vector<metrics::GaugeSample> samples = {
+            {{"running"}, static_cast<double>(in_flight_)},
+            {{"rejected"}, static_cast<double>(rejected_)},
+        };
+        for (size_t i = 0; i < queues_.size(); ++i) {
+          samples.push_back({{absl::StrCat("queued_", kPriorityNames[i])},
+                             static_cast<double>(queues_[i].size())});
+        }
+        return samples;
+      });
+}
+
+AdmissionController::~AdmissionController() {
+  metrics::UnregisterGaugeCallback(gauge_id_);
+}
+
+absl::StatusOr<AdmissionController::Ticket> AdmissionController::Admit(
+    Priority priority, absl::Time deadline,
+    const std::function<bool()>& is_cancelled) {
+  absl::MutexLock lock(&mu_);
+  const int index = static_cast<int>(priority);
+  // Short RPCs only wait behind other short RPCs, so that a queue of scans
+  // does not hold up commits.
+  const bool must_wait = in_flight_ >= options_.max_in_flight ||
+                         !queues_[index].empty() ||
+                         (priority == Priority::kLong &&
+                          !queues_[static_cast<int>(Priority::kShort)].empty());
+  if (!must_wait) {
+    ++in_flight_;
+    return Ticket(this);
+  }
+  if (NumQueuedLocked() >= options_.max_queued) {
+    ++rejected_;
+    return error::AdmissionQueueFull(in_flight_, NumQueuedLocked());
+  }
+
+  const absl::Time queued = absl::Now();
+  const absl::Time give_up =
+      std::min(deadline, queued + options_.max_queue_wait);
+  Waiter waiter;
+  queues_[index].push_back(&waiter);
+  while (true) {
+    const absl::Time wake_up =
+        is_cancelled == nullptr
+            ? give_up
+            : std::min(give_up, absl::Now() + kCancellationPollInterval);
+    mu_.AwaitWithDeadline(absl::Condition(&waiter.admitted), wake_up);
+    if (waiter.admitted) break;
+    absl::Status status;
+    const absl::Time now = absl::Now();
+    if (now >= deadline) {
+      status = error::AdmissionQueueDeadlineExceeded();
+    } else if (now >= give_up) {
+      ++rejected_;
+      status = error::AdmissionQueueTimeout(options_.max_queue_wait);
+    } else if (is_cancelled != nullptr && is_cancelled()) {
+      status = error::AdmissionQueueCancelled();
+    } else {
+      continue;
+    }
+    std::deque<Waiter*>& queue = queues_[index];
+    queue.erase(std::find(queue.begin(), queue.end(), &waiter));
+    // Leaving the queue can let the long RPCs behind it run.
+    DispatchLocked();
+    return status;
+  }
+  queue_wait_histograms_[index]->Record(absl::Now() - queued);
+  return Ticket(this);
+}
+
+void AdmissionController::Release() {
+  absl::MutexLock lock(&mu_);
+  --in_flight_;
+  DispatchLocked();
+}
+
+int AdmissionController::NumQueuedLocked() const {
+  int queued = 0;
+  for (const std::deque<Waiter*>& queue : queues_) queued += queue.size();
+  return queued;
+}
+
+void AdmissionController::DispatchLocked() {
+  for (std::deque<Waiter*>& queue : queues_) {
+    while (in_flight_ < options_.max_in_flight && !queue.empty()) {
+      queue.front()->admitted = true;
+      queue.pop_front();
+      ++in_flight_;
+    }
+  }
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,146 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_ADMISSION_CONTROLLER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_ADMISSION_CONTROLLER_H_
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "google/protobuf/message.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "common/metrics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// AdmissionController bounds the RPCs the emulator runs at once, so that a
+// burst of requests queues or is turned away instead of thrashing the server.
+//
+// At most Options::max_in_flight RPCs run at once. Further RPCs wait in a
+// queue of at most Options::max_queued RPCs, in which short RPCs, such as
+// commits and point reads, are admitted before long ones, such as queries and
+// scans. RPCs arriving to a full queue, and RPCs which waited longer than
+// Options::max_queue_wait, fail right away with RESOURCE_EXHAUSTED so that
+// clients back off and retry.
+//
+// This class is thread-safe.
+class AdmissionController {
+ public:
+  enum class Priority { kShort, kLong };
+
+  struct Options {
+    // The most RPCs running at once. Must be positive.
+    int max_in_flight = 1;
+
+    // The most RPCs waiting to run. 0 rejects every RPC which cannot run
+    // right away.
+    int max_queued = 0;
+
+    // How long an RPC waits to run before it is rejected.
+    absl::Duration max_queue_wait = absl::InfiniteDuration();
+  };
+
+  // The admission of a running RPC, which frees its place when destroyed.
+  class Ticket {
+   public:
+    Ticket() = default;
+    Ticket(Ticket&& other) { *this = std::move(other); }
+    Ticket& operator=(Ticket&& other);
+    ~Ticket() { Release(); }
+
+   private:
+    friend class AdmissionController;
+
+    explicit Ticket(AdmissionController* controller)
+        : controller_(controller) {}
+
+    void Release();
+
+    AdmissionController* controller_ = nullptr;
+  };
+
+  // Returns the priority of an RPC of the Spanner API method method_name with
+  // request. Transaction and session management, commits and reads of
+  // individual keys are short, and everything else is long.
+  static Priority PriorityOf(absl::string_view method_name,
+                             const google::protobuf::Message& request);
+
+  // Returns the controller used by the gRPC handlers, or nullptr if every RPC
+  // is admitted right away.
+  static AdmissionController* Default();
+
+  // Makes controller the one returned by Default. Must be called at most
+  // once, before the server starts.
+  static void SetDefault(std::unique_ptr<AdmissionController> controller);
+
+  explicit AdmissionController(const Options& options);
+  ~AdmissionController();
+
+  // Waits for an RPC of the given priority to be admitted. Returns
+  // RESOURCE_EXHAUSTED if the queue is full or the RPC waits for longer than
+  // Options::max_queue_wait, and an error if deadline passes or is_cancelled,
+  // polled while waiting, returns true first.
+  absl::StatusOr<Ticket> Admit(Priority priority,
+                               absl::Time deadline = absl::InfiniteFuture(),
+                               const std::function<bool()>& is_cancelled =
+                                   nullptr) ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Waiter {
+    bool admitted = false;
+  };
+
+  AdmissionController(const AdmissionController&) = delete;
+  AdmissionController& operator=(const AdmissionController&) = delete;
+
+  void Release() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Admits waiting RPCs, short ones first, while there is room.
+  void DispatchLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  int NumQueuedLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  // Histograms of the time admitted RPCs waited, per priority.
+  std::array<metrics::LatencyHistogram*, 2> queue_wait_histograms_;
+
+  int64_t gauge_id_ = -1;
+
+  absl::Mutex mu_;
+  int in_flight_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t rejected_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // The waiting RPCs of each priority, oldest first.
+  std::array<std::deque<Waiter*>, 2> queues_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_ADMISSION_CONTROLLER_H_
@@ -0,0 +1,131 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/admission_controller.h"
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace spanner_api = ::google::spanner::v1;
+
+using ::testing::ElementsAre;
+using ::zetasql_base::testing::StatusIs;
+using Priority = AdmissionController::Priority;
+
+TEST(AdmissionControllerTest, ClassifiesRpcs) {
+  EXPECT_EQ(AdmissionController::PriorityOf("Commit",
+                                            spanner_api::CommitRequest()),
+            Priority::kShort);
+  EXPECT_EQ(AdmissionController::PriorityOf(
+                "ExecuteStreamingSql", spanner_api::ExecuteSqlRequest()),
+            Priority::kLong);
+
+  spanner_api::ReadRequest read;
+  read.mutable_key_set()->add_keys()->add_values()->set_string_value("1");
+  EXPECT_EQ(AdmissionController::PriorityOf("Read", read), Priority::kShort);
+  EXPECT_EQ(AdmissionController::PriorityOf("StreamingRead", read),
+            Priority::kShort);
+
+  read.mutable_key_set()->add_ranges();
+  EXPECT_EQ(AdmissionController::PriorityOf("Read", read), Priority::kLong);
+
+  read.mutable_key_set()->clear_ranges();
+  read.mutable_key_set()->set_all(true);
+  EXPECT_EQ(AdmissionController::PriorityOf("Read", read), Priority::kLong);
+}
+
+TEST(AdmissionControllerTest, RejectsRpcsWhenQueueIsFull) {
+  AdmissionController controller(
+      AdmissionController::Options{.max_in_flight = 1, .max_queued = 0});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(AdmissionController::Ticket ticket,
+                       controller.Admit(Priority::kLong));
+  EXPECT_THAT(controller.Admit(Priority::kShort),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+
+  ticket = AdmissionController::Ticket();
+  ZETASQL_EXPECT_OK(controller.Admit(Priority::kShort).status());
+}
+
+TEST(AdmissionControllerTest, QueuedRpcsGiveUp) {
+  AdmissionController controller(AdmissionController::Options{
+      .max_in_flight = 1,
+      .max_queued = 1,
+      .max_queue_wait = absl::Milliseconds(100)});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(AdmissionController::Ticket ticket,
+                       controller.Admit(Priority::kLong));
+  EXPECT_THAT(controller.Admit(Priority::kLong),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+  EXPECT_THAT(
+      controller.Admit(Priority::kLong, absl::Now() + absl::Milliseconds(1)),
+      StatusIs(absl::StatusCode::kDeadlineExceeded));
+  EXPECT_THAT(controller.Admit(Priority::kLong, absl::InfiniteFuture(),
+                               []() { return true; }),
+              StatusIs(absl::StatusCode::kCancelled));
+
+  // The abandoned RPCs do not hold up those queued after them.
+  ticket = AdmissionController::Ticket();
+  ZETASQL_EXPECT_OK(controller.Admit(Priority::kLong).status());
+}
+
+TEST(AdmissionControllerTest, AdmitsShortRpcsFirst) {
+  AdmissionController controller(
+      AdmissionController::Options{.max_in_flight = 1, .max_queued = 2});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(AdmissionController::Ticket ticket,
+                       controller.Admit(Priority::kLong));
+
+  absl::Mutex mu;
+  std::vector<Priority> order;
+  auto run = [&](Priority priority) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(AdmissionController::Ticket ticket,
+                         controller.Admit(priority));
+    absl::MutexLock lock(&mu);
+    order.push_back(priority);
+  };
+  std::thread long_rpc(run, Priority::kLong);
+  absl::SleepFor(absl::Milliseconds(20));
+  std::thread short_rpc(run, Priority::kShort);
+  absl::SleepFor(absl::Milliseconds(20));
+
+  ticket = AdmissionController::Ticket();
+  long_rpc.join();
+  short_rpc.join();
+  EXPECT_THAT(order, ElementsAre(Priority::kShort, Priority::kLong));
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,260 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/bulk_load.h"
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/struct.pb.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "backend/database/snapshot.pb.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
+#include "common/errors.h"
+#include "frontend/converters/values.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+// A field of a CSV record. Quoting is kept so that an empty unquoted field can
+// be read as NULL.
+struct CsvField {
+  std::string text;
+  bool quoted = false;
+};
+
+using CsvRecord = std::vector<CsvField>;
+
+// Parses content as RFC 4180 CSV. Both LF and CRLF end a record, and quoted
+// fields may span lines.
+absl::Status ParseCsv(absl::string_view path, absl::string_view content,
+                      std::vector<CsvRecord>* records) {
+  CsvRecord record;
+  CsvField field;
+  // Whether any character of the current record has been consumed, so that
+  // blank lines do not produce records.
+  bool in_record = false;
+  size_t pos = 0;
+  while (pos < content.size()) {
+    const char c = content[pos];
+    if (c == '"' && field.text.empty() && !field.quoted) {
+      field.quoted = true;
+      in_record = true;
+      ++pos;
+      while (true) {
+        if (pos == content.size()) {
+          return error::InvalidBulkLoadCsv(path, records->size() + 1,
+                                           "unterminated quoted field");
+        }
+        if (content[pos] == '"') {
+          if (pos + 1 < content.size() && content[pos + 1] == '"') {
+            field.text.push_back('"');
+            pos += 2;
+            continue;
+          }
+          ++pos;
+          break;
+        }
+        field.text.push_back(content[pos++]);
+      }
+      if (pos < content.size() && content[pos] != ',' && content[pos] != '\n' &&
+          content[pos] != '\r') {
+        return error::InvalidBulkLoadCsv(path, records->size() + 1,
+                                         "unexpected character after quote");
+      }
+      continue;
+    }
+    if (c == ',') {
+      record.push_back(std::move(field));
+      field = CsvField();
+      in_record = true;
+      ++pos;
+      continue;
+    }
+    if (c == '\n' || c == '\r') {
+      pos += (c == '\r' && pos + 1 < content.size() && content[pos + 1] == '\n')
+                 ? 2
+                 : 1;
+      if (in_record) {
+        record.push_back(std::move(field));
+        records->push_back(std::move(record));
+      }
+      record = CsvRecord();
+      field = CsvField();
+      in_record = false;
+      continue;
+    }
+    if (field.quoted) {
+      return error::InvalidBulkLoadCsv(path, records->size() + 1,
+                                       "unexpected character after quote");
+    }
+    field.text.push_back(c);
+    in_record = true;
+    ++pos;
+  }
+  if (in_record) {
+    record.push_back(std::move(field));
+    records->push_back(std::move(record));
+  }
+  return absl::OkStatus();
+}
+
+// Converts a CSV field into a value of the given type using the encoding of
+// the Cloud Spanner API for that type.
+absl::StatusOr<zetasql::Value> ValueFromCsvField(const CsvField& field,
+                                                 const zetasql::Type* type) {
+  google::protobuf::Value value_pb;
+  if (field.text.empty() && !field.quoted) {
+    value_pb.set_null_value(google::protobuf::NULL_VALUE);
+  } else if (type->IsBool()) {
+    const std::string text = absl::AsciiStrToLower(field.text);
+    if (text == "true" || text == "false") {
+      value_pb.set_bool_value(text == "true");
+    } else {
+      value_pb.set_string_value(field.text);
+    }
+  } else if (double number;
+             type->IsDouble() && absl::SimpleAtod(field.text, &number)) {
+    value_pb.set_number_value(number);
+  } else {
+    value_pb.set_string_value(field.text);
+  }
+  return ValueFromProto(value_pb, type);
+}
+
+// Reads the CSV file at path into a snapshot of table.
+absl::StatusOr<backend::TableSnapshot> ReadCsvFile(const backend::Table* table,
+                                                   const std::string& path) {
+  std::string content;
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      return error::Internal(
+          absl::StrCat("Failed to read bulk load file ", path));
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    content = buffer.str();
+  }
+  std::vector<CsvRecord> records;
+  ZETASQL_RETURN_IF_ERROR(ParseCsv(path, content, &records));
+  if (records.empty()) {
+    return error::InvalidBulkLoadCsv(path, 1, "missing header record");
+  }
+
+  backend::TableSnapshot table_snapshot;
+  table_snapshot.set_name(table->Name());
+  std::vector<const zetasql::Type*> types;
+  for (const CsvField& field : records[0]) {
+    const backend::Column* column = table->FindColumn(field.text);
+    if (column == nullptr) {
+      return error::ColumnNotFound(table->Name(), field.text);
+    }
+    if (column->GetType()->IsArray() || column->GetType()->IsStruct()) {
+      return error::BulkLoadUnsupportedColumnType(
+          table->Name(), column->Name(), column->GetType()->DebugString());
+    }
+    table_snapshot.add_columns(column->Name());
+    types.push_back(column->GetType());
+  }
+  for (int i = 1; i < records.size(); ++i) {
+    const CsvRecord& record = records[i];
+    if (record.size() != types.size()) {
+      return error::InvalidBulkLoadCsv(
+          path, i + 1,
+          absl::StrCat("expected ", types.size(), " fields, found ",
+                       record.size()));
+    }
+    backend::TableSnapshot::Row* row = table_snapshot.add_rows();
+    for (int j = 0; j < record.size(); ++j) {
+      absl::StatusOr<zetasql::Value> value =
+          ValueFromCsvField(record[j], types[j]);
+      if (!value.ok()) {
+        return error::InvalidBulkLoadCsv(path, i + 1, value.status().message());
+      }
+      ZETASQL_RETURN_IF_ERROR(value->Serialize(row->add_values()));
+    }
+  }
+  return table_snapshot;
+}
+
+}  // namespace
+
+absl::Status BulkLoadCsvFiles(absl::string_view spec, ServerEnv* env) {
+  // Files are grouped by database so that each database is loaded at once.
+  std::map<std::string, std::vector<std::pair<std::string, std::string>>>
+      files_by_database;
+  for (absl::string_view entry :
+       absl::StrSplit(spec, ',', absl::SkipWhitespace())) {
+    entry = absl::StripAsciiWhitespace(entry);
+    std::pair<absl::string_view, absl::string_view> table_and_path =
+        absl::StrSplit(entry, absl::MaxSplits('=', 1));
+    const size_t tables_pos = table_and_path.first.rfind("/tables/");
+    if (tables_pos == absl::string_view::npos ||
+        table_and_path.second.empty()) {
+      return error::InvalidBulkLoadSpec(entry);
+    }
+    absl::string_view table_name =
+        table_and_path.first.substr(tables_pos + sizeof("/tables/") - 1);
+    if (table_name.empty()) {
+      return error::InvalidBulkLoadSpec(entry);
+    }
+    files_by_database[std::string(table_and_path.first.substr(0, tables_pos))]
+        .emplace_back(table_name, table_and_path.second);
+  }
+
+  for (const auto& [database_uri, files] : files_by_database) {
+    ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Database> database,
+                     env->database_manager()->GetDatabase(database_uri));
+    const backend::Schema* schema = database->backend()->GetLatestSchema();
+    std::vector<backend::TableSnapshot> tables;
+    for (const auto& [table_name, path] : files) {
+      const backend::Table* table = schema->FindTable(table_name);
+      if (table == nullptr) {
+        return error::TableNotFound(table_name);
+      }
+      ZETASQL_ASSIGN_OR_RETURN(tables.emplace_back(), ReadCsvFile(table, path));
+    }
+    ZETASQL_RETURN_IF_ERROR(database->backend()->BulkLoad(tables));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,46 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_BULK_LOAD_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_BULK_LOAD_H_
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// Bulk loads CSV files into existing, empty tables of databases in env.
+//
+// spec is a comma separated list of <database_uri>/tables/<table_name>=<path>
+// entries. Each file is parsed as RFC 4180 CSV whose first record names the
+// columns of the rows that follow. An empty unquoted field is NULL, while ""
+// is an empty string. Other fields use the value encoding of the Cloud Spanner
+// API, e.g. base64 for BYTES and RFC 3339 for TIMESTAMP. All the files of a
+// database are loaded together, so interleaved tables and foreign keys may be
+// split across files.
+absl::Status BulkLoadCsvFiles(absl::string_view spec, ServerEnv* env);
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_BULK_LOAD_H_
@@ -0,0 +1,169 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/bulk_load.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "backend/access/read.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/transaction/options.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+namespace {
+
+namespace instance_api = ::google::spanner::admin::instance::v1;
+
+using zetasql::values::Bool;
+using zetasql::values::Int64;
+using zetasql::values::NullString;
+using zetasql::values::String;
+using zetasql_base::testing::StatusIs;
+
+constexpr char kInstanceUri[] = "projects/test-project/instances/test-instance";
+constexpr char kDatabaseUri[] =
+    "projects/test-project/instances/test-instance/databases/test-database";
+
+class BulkLoadTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    instance_api::Instance instance_pb = PARSE_TEXT_PROTO(R"pb(
+      name: "projects/test-project/instances/test-instance"
+      node_count: 1
+    )pb");
+    ZETASQL_ASSERT_OK(
+        env_.instance_manager()->CreateInstance(kInstanceUri, instance_pb));
+    std::vector<std::string> statements = {R"(
+      CREATE TABLE P(
+        k INT64,
+        v STRING(MAX),
+      ) PRIMARY KEY(k)
+    )",
+                                           R"(
+      CREATE TABLE C(
+        k INT64,
+        c INT64,
+        b BOOL,
+      ) PRIMARY KEY(k, c),
+        INTERLEAVE IN PARENT P
+    )"};
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        database_,
+        env_.database_manager()->CreateDatabase(
+            kDatabaseUri,
+            backend::SchemaChangeOperation{.statements = statements}));
+  }
+
+  // Writes content to a file named name in the test directory, and returns a
+  // bulk load spec entry loading it into table.
+  std::string WriteCsvFile(absl::string_view name, absl::string_view table,
+                           absl::string_view content) {
+    const std::string path = absl::StrCat(testing::TempDir(), "/", name);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+    return absl::StrCat(kDatabaseUri, "/tables/", table, "=", path);
+  }
+
+  std::vector<std::vector<zetasql::Value>> ReadTable(
+      const std::string& table, std::vector<std::string> columns) {
+    std::vector<std::vector<zetasql::Value>> rows;
+    auto txn = database_->backend()->CreateReadOnlyTransaction(
+        backend::ReadOnlyOptions());
+    ZETASQL_EXPECT_OK(txn.status());
+    backend::ReadArg read_arg;
+    read_arg.table = table;
+    read_arg.key_set = backend::KeySet::All();
+    read_arg.columns = std::move(columns);
+    std::unique_ptr<backend::RowCursor> cursor;
+    ZETASQL_EXPECT_OK((*txn)->Read(read_arg, &cursor));
+    while (cursor->Next()) {
+      std::vector<zetasql::Value>& row = rows.emplace_back();
+      for (int i = 0; i < cursor->NumColumns(); ++i) {
+        row.push_back(cursor->ColumnValue(i));
+      }
+    }
+    return rows;
+  }
+
+  ServerEnv env_;
+  std::shared_ptr<Database> database_;
+};
+
+TEST_F(BulkLoadTest, LoadsInterleavedTablesFromCsvFiles) {
+  const std::string spec = absl::StrCat(
+      WriteCsvFile("c.csv", "C", "k,c,b\n1,1,true\n1,2,FALSE\n2,1,\n"), ",",
+      WriteCsvFile("p.csv", "P",
+                   "v,k\r\n"
+                   "\"a, \"\"quoted\"\"\nvalue\",1\r\n"
+                   "\"\",2\r\n"
+                   ",3\r\n"));
+  ZETASQL_ASSERT_OK(BulkLoadCsvFiles(spec, &env_));
+
+  EXPECT_THAT(
+      ReadTable("P", {"k", "v"}),
+      testing::ElementsAre(
+          testing::ElementsAre(Int64(1), String("a, \"quoted\"\nvalue")),
+          testing::ElementsAre(Int64(2), String("")),
+          testing::ElementsAre(Int64(3), NullString())));
+  EXPECT_THAT(ReadTable("C", {"k", "c", "b"}),
+              testing::ElementsAre(
+                  testing::ElementsAre(Int64(1), Int64(1), Bool(true)),
+                  testing::ElementsAre(Int64(1), Int64(2), Bool(false)),
+                  testing::ElementsAre(Int64(2), Int64(1),
+                                       zetasql::values::NullBool())));
+}
+
+TEST_F(BulkLoadTest, RejectsInvalidFiles) {
+  EXPECT_THAT(BulkLoadCsvFiles("p.csv", &env_),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(BulkLoadCsvFiles(WriteCsvFile("bad.csv", "P", "k,v\n1\n"), &env_),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      BulkLoadCsvFiles(WriteCsvFile("bad.csv", "P", "k,v\n\"1,a\n"), &env_),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      BulkLoadCsvFiles(WriteCsvFile("bad.csv", "P", "k,v\none,a\n"), &env_),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      BulkLoadCsvFiles(WriteCsvFile("bad.csv", "P", "k,w\n1,a\n"), &env_),
+      StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(
+      BulkLoadCsvFiles(WriteCsvFile("bad.csv", "Q", "k\n1\n"), &env_),
+      StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(ReadTable("P", {"k"}), testing::IsEmpty());
+}
+
+}  // namespace
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
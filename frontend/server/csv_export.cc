@@ -0,0 +1,217 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/csv_export.h"
+
+#include <cstdint>
+#include <filesystem>  // NOLINT
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>  // NOLINT
+
+#include "google/protobuf/struct.pb.h"
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/table.h"
+#include "backend/storage/iterator.h"
+#include "common/errors.h"
+#include "frontend/converters/values.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+// Rows are written to the files in chunks of about this size.
+constexpr int64_t kWriteBufferSize = 1 << 20;
+
+// Appends text to out as a JSON string.
+void AppendJsonString(absl::string_view text, std::string* out) {
+  out->push_back('"');
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      absl::StrAppendFormat(out, "\\u%04x", static_cast<int>(c));
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+// Appends value_pb to out as JSON.
+void AppendJson(const google::protobuf::Value& value_pb, std::string* out) {
+  switch (value_pb.kind_case()) {
+    case google::protobuf::Value::kBoolValue:
+      out->append(value_pb.bool_value() ? "true" : "false");
+      break;
+    case google::protobuf::Value::kNumberValue:
+      absl::StrAppendFormat(out, "%.17g", value_pb.number_value());
+      break;
+    case google::protobuf::Value::kStringValue:
+      AppendJsonString(value_pb.string_value(), out);
+      break;
+    case google::protobuf::Value::kListValue: {
+      out->push_back('[');
+      for (int i = 0; i < value_pb.list_value().values_size(); ++i) {
+        if (i > 0) {
+          out->push_back(',');
+        }
+        AppendJson(value_pb.list_value().values(i), out);
+      }
+      out->push_back(']');
+      break;
+    }
+    case google::protobuf::Value::kStructValue: {
+      out->push_back('{');
+      bool first = true;
+      for (const auto& [name, field] : value_pb.struct_value().fields()) {
+        if (!first) {
+          out->push_back(',');
+        }
+        first = false;
+        AppendJsonString(name, out);
+        out->push_back(':');
+        AppendJson(field, out);
+      }
+      out->push_back('}');
+      break;
+    }
+    default:
+      out->append("null");
+  }
+}
+
+// Appends text to out as a CSV field, quoted if it is empty, so that it is not
+// read back as NULL, or if it contains characters which end a field.
+void AppendCsvText(absl::string_view text, std::string* out) {
+  if (!text.empty() &&
+      text.find_first_of(",\"\r\n") == absl::string_view::npos) {
+    out->append(text);
+    return;
+  }
+  out->push_back('"');
+  for (const char c : text) {
+    if (c == '"') {
+      out->push_back('"');
+    }
+    out->push_back(c);
+  }
+  out->push_back('"');
+}
+
+// Appends value to out as a CSV field read back by BulkLoadCsvFiles, using the
+// encoding of the Cloud Spanner API for its type.
+absl::Status AppendCsvValue(const zetasql::Value& value, std::string* out) {
+  // Columns which were never written are returned as invalid values.
+  if (!value.is_valid() || value.is_null()) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(google::protobuf::Value value_pb,
+                   ValueToProto(value));
+  switch (value_pb.kind_case()) {
+    case google::protobuf::Value::kStringValue:
+      AppendCsvText(value_pb.string_value(), out);
+      break;
+    case google::protobuf::Value::kBoolValue:
+    case google::protobuf::Value::kNumberValue:
+      AppendJson(value_pb, out);
+      break;
+    default: {
+      std::string json;
+      AppendJson(value_pb, &json);
+      AppendCsvText(json, out);
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Writes the rows returned by itr, which are those of table, to a CSV file at
+// path with a header record of the names of its columns.
+absl::Status WriteCsvFile(const backend::Table* table,
+                          backend::StorageIterator* itr,
+                          const std::string& path) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return error::Internal(absl::StrCat("Failed to write export file ", path));
+  }
+  std::string buffer;
+  for (const backend::Column* column : table->columns()) {
+    if (!buffer.empty()) {
+      buffer.push_back(',');
+    }
+    AppendCsvText(column->Name(), &buffer);
+  }
+  buffer.push_back('\n');
+  while (itr->Next()) {
+    for (int i = 0; i < itr->NumColumns(); ++i) {
+      if (i > 0) {
+        buffer.push_back(',');
+      }
+      ZETASQL_RETURN_IF_ERROR(AppendCsvValue(itr->ColumnValue(i), &buffer));
+    }
+    buffer.push_back('\n');
+    if (buffer.size() >= kWriteBufferSize) {
+      out.write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+  out.write(buffer.data(), buffer.size());
+  out.close();
+  if (!out) {
+    return error::Internal(absl::StrCat("Failed to write export file ", path));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status ExportCsvFiles(ServerEnv* env, const std::string& dir) {
+  for (const std::shared_ptr<Database>& database :
+       env->database_manager()->ListAllDatabases()) {
+    const std::string tables_dir =
+        absl::StrCat(dir, "/", database->database_uri(), "/tables");
+    std::error_code error_code;
+    std::filesystem::create_directories(tables_dir, error_code);
+    if (error_code) {
+      return error::Internal(absl::StrCat("Failed to create export directory ",
+                                          tables_dir, ": ",
+                                          error_code.message()));
+    }
+    ZETASQL_RETURN_IF_ERROR(database->backend()->ExportTables(
+        [&tables_dir](const backend::Table* table,
+                      backend::StorageIterator* itr) {
+          return WriteCsvFile(
+              table, itr, absl::StrCat(tables_dir, "/", table->Name(), ".csv"));
+        }));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
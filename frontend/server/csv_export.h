@@ -0,0 +1,46 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_CSV_EXPORT_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_CSV_EXPORT_H_
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// Writes the rows of every table of the databases in env visible to a strong
+// read to CSV files under dir, replacing existing files. Table T of a database
+// is written to <dir>/<database_uri>/tables/T.csv in the format read by
+// BulkLoadCsvFiles, with a header record naming every column of the table,
+// so that the files can be loaded back. ARRAY and STRUCT values, which bulk
+// loads do not support, are written as JSON arrays of their encoded elements.
+//
+// Rows are streamed from storage rather than read through the query engine,
+// and the tables of each database are written in parallel.
+absl::Status ExportCsvFiles(ServerEnv* env, const std::string& dir);
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_CSV_EXPORT_H_
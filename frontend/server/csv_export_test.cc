@@ -0,0 +1,126 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/csv_export.h"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "frontend/server/bulk_load.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+namespace {
+
+namespace instance_api = ::google::spanner::admin::instance::v1;
+
+constexpr char kInstanceUri[] = "projects/test-project/instances/test-instance";
+constexpr char kDatabaseUri[] =
+    "projects/test-project/instances/test-instance/databases/test-database";
+constexpr char kCopyUri[] =
+    "projects/test-project/instances/test-instance/databases/test-copy";
+
+class CsvExportTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    instance_api::Instance instance_pb = PARSE_TEXT_PROTO(R"pb(
+      name: "projects/test-project/instances/test-instance"
+      node_count: 1
+    )pb");
+    ZETASQL_ASSERT_OK(
+        env_.instance_manager()->CreateInstance(kInstanceUri, instance_pb));
+    for (const char* database_uri : {kDatabaseUri, kCopyUri}) {
+      ZETASQL_ASSERT_OK(env_.database_manager()
+                    ->CreateDatabase(
+                        database_uri,
+                        backend::SchemaChangeOperation{.statements = {R"(
+                          CREATE TABLE P(
+                            k INT64,
+                            v STRING(MAX),
+                            b BOOL,
+                          ) PRIMARY KEY(k)
+                        )"}})
+                    .status());
+    }
+  }
+
+  // Returns the content of the file at path.
+  static std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+  }
+
+  // Returns the path of the file table of database_uri is exported to.
+  std::string ExportPath(absl::string_view database_uri,
+                         absl::string_view table) {
+    return absl::StrCat(export_dir_, "/", database_uri, "/tables/", table,
+                        ".csv");
+  }
+
+  const std::string export_dir_ = absl::StrCat(testing::TempDir(), "/export");
+  ServerEnv env_;
+};
+
+TEST_F(CsvExportTest, ExportsTablesInBulkLoadFormat) {
+  const std::string loaded_path =
+      absl::StrCat(testing::TempDir(), "/csv_export_test.csv");
+  {
+    std::ofstream out(loaded_path, std::ios::binary | std::ios::trunc);
+    out << "k,v,b\n"
+           "1,\"a, \"\"quoted\"\"\nvalue\",true\n"
+           "2,\"\",\n"
+           "3,,false\n";
+  }
+  ZETASQL_ASSERT_OK(BulkLoadCsvFiles(
+      absl::StrCat(kDatabaseUri, "/tables/P=", loaded_path), &env_));
+
+  ZETASQL_ASSERT_OK(ExportCsvFiles(&env_, export_dir_));
+  EXPECT_EQ(ReadFile(ExportPath(kDatabaseUri, "P")),
+            "k,v,b\n"
+            "1,\"a, \"\"quoted\"\"\nvalue\",true\n"
+            "2,\"\",\n"
+            "3,,false\n");
+  EXPECT_EQ(ReadFile(ExportPath(kCopyUri, "P")), "k,v,b\n");
+
+  // The exported file loads the same rows into another database.
+  ZETASQL_ASSERT_OK(BulkLoadCsvFiles(
+      absl::StrCat(kCopyUri, "/tables/P=", ExportPath(kDatabaseUri, "P")),
+      &env_));
+  ZETASQL_ASSERT_OK(ExportCsvFiles(&env_, export_dir_));
+  EXPECT_EQ(ReadFile(ExportPath(kCopyUri, "P")),
+            ReadFile(ExportPath(kDatabaseUri, "P")));
+}
+
+}  // namespace
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,273 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/database_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "common/errors.h"
+#include "common/metrics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+std::atomic<DatabaseScheduler*> default_scheduler = nullptr;
+
+// How often an RPC waiting for a slot checks whether it was cancelled.
+constexpr absl::Duration kCancellationPollInterval = absl::Milliseconds(50);
+
+constexpr absl::string_view kDatabasesSegment = "/databases/";
+
+metrics::LatencyHistogram* QueueWaitHistogram() {
+  static metrics::LatencyHistogram* histogram =
+      metrics::GetLatencyHistogram("emulator_database_queue_wait_seconds");
+  return histogram;
+}
+
+}  // namespace
+
+DatabaseScheduler::Slot& DatabaseScheduler::Slot::operator=(Slot&& other) {
+  if (this != &other) {
+    Release();
+    scheduler_ = std::exchange(other.scheduler_, nullptr);
+    database_uri_ = std::move(other.database_uri_);
+    start_ = other.start_;
+  }
+  return *this;
+}
+
+void DatabaseScheduler::Slot::Release() {
+  if (scheduler_ != nullptr) {
+    scheduler_->Release(database_uri_, start_);
+    scheduler_ = nullptr;
+  }
+}
+
+absl::Status DatabaseScheduler::ParseWeights(absl::string_view weights,
+                                             Options* options) {
+  for (absl::string_view entry :
+       absl::StrSplit(weights, ',', absl::SkipWhitespace())) {
+    entry = absl::StripAsciiWhitespace(entry);
+    const size_t separator = entry.rfind('=');
+    double weight = 0;
+    if (separator == absl::string_view::npos || separator == 0 ||
+        !absl::SimpleAtod(entry.substr(separator + 1), &weight) ||
+        weight <= 0) {
+      return error::InvalidDatabaseSchedulerWeight(entry);
+    }
+    options->weights[std::string(entry.substr(0, separator))] = weight;
+  }
+  return absl::OkStatus();
+}
+
+DatabaseScheduler* DatabaseScheduler::Default() {
+  return default_scheduler.load(std::memory_order_acquire);
+}
+
+void DatabaseScheduler::SetDefault(
+    std::unique_ptr<DatabaseScheduler> scheduler) {
+  default_scheduler.store(scheduler.release(), std::memory_order_release);
+}
+
+std::string DatabaseScheduler::DatabaseUriOf(
+    const google::protobuf::Message& request) {
+  const google::protobuf::Descriptor* descriptor = request.GetDescriptor();
+  for (const char* name : {"session", "database", "name"}) {
+    const google::protobuf::FieldDescriptor* field =
+        descriptor->FindFieldByName(name);
+    if (field == nullptr || field->is_repeated() ||
+        field->type() != google::protobuf::FieldDescriptor::TYPE_STRING) {
+      continue;
+    }
+    const std::string value =
+        request.GetReflection()->GetString(request, field);
+    const absl::string_view uri = value;
+    const size_t begin = uri.find(kDatabasesSegment);
+    if (begin == absl::string_view::npos) continue;
+    return std::string(
+        uri.substr(0, uri.find('/', begin + kDatabasesSegment.size())));
+  }
+  return "";
+}
+
+DatabaseScheduler::DatabaseScheduler(const Options& options)
+    : options_(options) {
+  gauge_id_ = metrics::RegisterGaugeCallback(
+      "emulator_database_scheduler_rpcs", {"database", "state"}, [this]() {
+        absl::MutexLock lock(&mu_);
+        std::vector<metrics::GaugeSample> samples;
+        for (const auto& [database_uri, state] : databases_) {
+          samples.push_back({{database_uri, "running"},
+                             static_cast<double>(state.running)});
+          samples.push_back({{database_uri, "queued"},
+                             static_cast<double>(state.waiters.size())});
+        }
+        return samples;
+      });
+}
+
+DatabaseScheduler::~DatabaseScheduler() {
+  metrics::UnregisterGaugeCallback(gauge_id_);
+}
+
+absl::StatusOr<DatabaseScheduler::Slot> DatabaseScheduler::Acquire(
+    const std::string& database_uri, absl::Time deadline,
+    const std::function<bool()>& is_cancelled) {
+  absl::MutexLock lock(&mu_);
+  DatabaseState* state = ActivateLocked(database_uri);
+  const absl::Time queued = absl::Now();
+  if (state->waiters.empty() && CanRunLocked(*state)) {
+    StartLocked(state, queued);
+    return Slot(this, database_uri, queued);
+  }
+
+  Waiter waiter;
+  state->waiters.push_back(&waiter);
+  while (true) {
+    const absl::Time wake_up =
+        is_cancelled == nullptr
+            ? deadline
+            : std::min(deadline, absl::Now() + kCancellationPollInterval);
+    mu_.AwaitWithDeadline(absl::Condition(&waiter.granted), wake_up);
+    if (waiter.granted) break;
+    absl::Status status;
+    if (absl::Now() >= deadline) {
+      status = error::DatabaseQueueDeadlineExceeded(database_uri);
+    } else if (is_cancelled != nullptr && is_cancelled()) {
+      status = error::DatabaseQueueCancelled(database_uri);
+    } else {
+      continue;
+    }
+    // Other RPCs may have been queued meanwhile, so the state is looked up
+    // again rather than kept across the wait.
+    std::deque<Waiter*>& waiters = databases_[database_uri].waiters;
+    waiters.erase(std::find(waiters.begin(), waiters.end(), &waiter));
+    MaybeEraseLocked(database_uri);
+    return status;
+  }
+  QueueWaitHistogram()->Record(waiter.start - queued);
+  return Slot(this, database_uri, waiter.start);
+}
+
+void DatabaseScheduler::Release(const std::string& database_uri,
+                                absl::Time start) {
+  absl::MutexLock lock(&mu_);
+  DatabaseState& state = databases_[database_uri];
+  --state.running;
+  --running_;
+  state.running_start_sum -= absl::ToDoubleSeconds(start - absl::UnixEpoch());
+  state.virtual_time +=
+      absl::ToDoubleSeconds(absl::Now() - start) / state.weight;
+  MaybeEraseLocked(database_uri);
+  DispatchLocked();
+}
+
+double DatabaseScheduler::VirtualTime(const DatabaseState& state,
+                                      absl::Time now) {
+  const double running_time =
+      state.running * absl::ToDoubleSeconds(now - absl::UnixEpoch()) -
+      state.running_start_sum;
+  return state.virtual_time + running_time / state.weight;
+}
+
+DatabaseScheduler::DatabaseState* DatabaseScheduler::ActivateLocked(
+    const std::string& database_uri) {
+  auto [it, inserted] = databases_.try_emplace(database_uri);
+  DatabaseState& state = it->second;
+  if (inserted) {
+    auto weight = options_.weights.find(database_uri);
+    if (weight != options_.weights.end()) state.weight = weight->second;
+    const absl::Time now = absl::Now();
+    bool first = true;
+    for (const auto& [other_uri, other] : databases_) {
+      if (&other == &state) continue;
+      const double virtual_time = VirtualTime(other, now);
+      if (first || virtual_time < state.virtual_time) {
+        state.virtual_time = virtual_time;
+        first = false;
+      }
+    }
+  }
+  return &state;
+}
+
+bool DatabaseScheduler::CanRunLocked(const DatabaseState& state) const {
+  return (options_.max_slots <= 0 || running_ < options_.max_slots) &&
+         (options_.max_per_database <= 0 ||
+          state.running < options_.max_per_database);
+}
+
+void DatabaseScheduler::StartLocked(DatabaseState* state, absl::Time now) {
+  ++state->running;
+  ++running_;
+  state->running_start_sum += absl::ToDoubleSeconds(now - absl::UnixEpoch());
+}
+
+void DatabaseScheduler::DispatchLocked() {
+  const absl::Time now = absl::Now();
+  while (true) {
+    DatabaseState* next = nullptr;
+    double next_virtual_time = 0;
+    for (auto& [database_uri, state] : databases_) {
+      if (state.waiters.empty() || !CanRunLocked(state)) continue;
+      const double virtual_time = VirtualTime(state, now);
+      if (next == nullptr || virtual_time < next_virtual_time) {
+        next = &state;
+        next_virtual_time = virtual_time;
+      }
+    }
+    if (next == nullptr) return;
+    Waiter* waiter = next->waiters.front();
+    waiter->granted = true;
+    waiter->start = now;
+    next->waiters.pop_front();
+    StartLocked(next, now);
+  }
+}
+
+void DatabaseScheduler::MaybeEraseLocked(const std::string& database_uri) {
+  auto it = databases_.find(database_uri);
+  if (it != databases_.end() && it->second.running == 0 &&
+      it->second.waiters.empty()) {
+    databases_.erase(it);
+  }
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
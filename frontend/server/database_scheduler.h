@@ -0,0 +1,189 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_DATABASE_SCHEDULER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_DATABASE_SCHEDULER_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "google/protobuf/message.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// DatabaseScheduler queues the RPCs to each database so that a database busy
+// with expensive requests, such as a large partitioned DML or table scan, does
+// not slow down the RPCs to every other database of the emulator.
+//
+// At most Options::max_slots RPCs run at once. When more arrive, they wait in
+// a queue per database, and a freed slot goes to the first RPC of the database
+// which has used the least execution time relative to its weight, counting
+// the time of its RPCs still running, in the manner of weighted fair queueing.
+// A database which was idle starts level with the active database furthest
+// behind, rather than with credit for its idle time. Options::max_per_database
+// additionally caps the RPCs running against any single database.
+//
+// This class is thread-safe.
+class DatabaseScheduler {
+ public:
+  struct Options {
+    // The most RPCs running at once, or 0 for no limit.
+    int max_slots = 0;
+
+    // The most RPCs running at once against one database, or 0 for no limit.
+    int max_per_database = 0;
+
+    // The weights of databases whose share differs from the default of 1,
+    // keyed by database URI.
+    absl::flat_hash_map<std::string, double> weights;
+  };
+
+  // A slot held by a running RPC, released when destroyed.
+  class Slot {
+   public:
+    Slot() = default;
+    Slot(Slot&& other) { *this = std::move(other); }
+    Slot& operator=(Slot&& other);
+    ~Slot() { Release(); }
+
+   private:
+    friend class DatabaseScheduler;
+
+    Slot(DatabaseScheduler* scheduler, std::string database_uri,
+         absl::Time start)
+        : scheduler_(scheduler),
+          database_uri_(std::move(database_uri)),
+          start_(start) {}
+
+    void Release();
+
+    DatabaseScheduler* scheduler_ = nullptr;
+    std::string database_uri_;
+    absl::Time start_;
+  };
+
+  // Parses weights, a comma separated list of <database_uri>=<weight> entries
+  // as passed to --database_scheduler_weights, into options.
+  static absl::Status ParseWeights(absl::string_view weights,
+                                   Options* options);
+
+  // Returns the scheduler used by the gRPC handlers, or nullptr if RPCs run
+  // as soon as they arrive.
+  static DatabaseScheduler* Default();
+
+  // Makes scheduler the one returned by Default. Must be called at most once,
+  // before the server starts.
+  static void SetDefault(std::unique_ptr<DatabaseScheduler> scheduler);
+
+  // Returns the URI of the database an RPC request is addressed to, read
+  // from its session, database or name field, or an empty string if it is
+  // not addressed to a database.
+  static std::string DatabaseUriOf(const google::protobuf::Message& request);
+
+  explicit DatabaseScheduler(const Options& options);
+  ~DatabaseScheduler();
+
+  // Waits for a slot to run an RPC against database_uri. Returns an error if
+  // deadline passes or is_cancelled, polled while waiting, returns true before
+  // a slot is granted.
+  absl::StatusOr<Slot> Acquire(const std::string& database_uri,
+                               absl::Time deadline = absl::InfiniteFuture(),
+                               const std::function<bool()>& is_cancelled =
+                                   nullptr) ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // An RPC waiting for a slot.
+  struct Waiter {
+    bool granted = false;
+
+    // When the slot was granted.
+    absl::Time start;
+  };
+
+  struct DatabaseState {
+    double weight = 1;
+    int running = 0;
+    std::deque<Waiter*> waiters;
+
+    // The execution time of the finished RPCs divided by the weight, in
+    // seconds.
+    double virtual_time = 0;
+
+    // The sum of the start times of the running RPCs, in seconds since the
+    // Unix epoch.
+    double running_start_sum = 0;
+  };
+
+  DatabaseScheduler(const DatabaseScheduler&) = delete;
+  DatabaseScheduler& operator=(const DatabaseScheduler&) = delete;
+
+  void Release(const std::string& database_uri, absl::Time start)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the virtual time of state at now, including the time so far of
+  // its running RPCs.
+  static double VirtualTime(const DatabaseState& state, absl::Time now);
+
+  // Returns the state of database_uri, setting its virtual time level with
+  // the active databases if it was idle.
+  DatabaseState* ActivateLocked(const std::string& database_uri)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  bool CanRunLocked(const DatabaseState& state) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Counts an RPC starting at now against state.
+  void StartLocked(DatabaseState* state, absl::Time now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Grants free slots to waiters, in weighted fair order.
+  void DispatchLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Forgets databases with no running or waiting RPC.
+  void MaybeEraseLocked(const std::string& database_uri)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  int64_t gauge_id_ = -1;
+
+  absl::Mutex mu_;
+  int running_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // The databases with running or waiting RPCs.
+  absl::flat_hash_map<std::string, DatabaseState> databases_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_DATABASE_SCHEDULER_H_
@@ -0,0 +1,155 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/database_scheduler.h"
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "google/spanner/admin/database/v1/spanner_database_admin.pb.h"
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.pb.h"
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace database_api = ::google::spanner::admin::database::v1;
+namespace instance_api = ::google::spanner::admin::instance::v1;
+namespace spanner_api = ::google::spanner::v1;
+
+using ::testing::ElementsAre;
+using ::zetasql_base::testing::StatusIs;
+
+constexpr char kDatabaseA[] = "projects/p/instances/i/databases/a";
+constexpr char kDatabaseB[] = "projects/p/instances/i/databases/b";
+
+TEST(DatabaseSchedulerTest, ParsesWeights) {
+  DatabaseScheduler::Options options;
+  ZETASQL_ASSERT_OK(DatabaseScheduler::ParseWeights(
+      "projects/p/instances/i/databases/a=4, projects/p/instances/i/databases/"
+      "b=0.5",
+      &options));
+  EXPECT_EQ(options.weights[kDatabaseA], 4);
+  EXPECT_EQ(options.weights[kDatabaseB], 0.5);
+
+  EXPECT_THAT(DatabaseScheduler::ParseWeights(kDatabaseA, &options),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(DatabaseScheduler::ParseWeights(
+                  "projects/p/instances/i/databases/a=0", &options),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(DatabaseSchedulerTest, FindsDatabaseOfRequests) {
+  spanner_api::CommitRequest commit;
+  commit.set_session(absl::StrCat(kDatabaseA, "/sessions/s"));
+  EXPECT_EQ(DatabaseScheduler::DatabaseUriOf(commit), kDatabaseA);
+
+  spanner_api::BatchCreateSessionsRequest create_sessions;
+  create_sessions.set_database(kDatabaseA);
+  EXPECT_EQ(DatabaseScheduler::DatabaseUriOf(create_sessions), kDatabaseA);
+
+  database_api::GetDatabaseRequest get_database;
+  get_database.set_name(kDatabaseA);
+  EXPECT_EQ(DatabaseScheduler::DatabaseUriOf(get_database), kDatabaseA);
+
+  instance_api::GetInstanceRequest get_instance;
+  get_instance.set_name("projects/p/instances/i");
+  EXPECT_EQ(DatabaseScheduler::DatabaseUriOf(get_instance), "");
+}
+
+TEST(DatabaseSchedulerTest, CapsRpcsPerDatabase) {
+  DatabaseScheduler scheduler(
+      DatabaseScheduler::Options{.max_per_database = 1});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(DatabaseScheduler::Slot slot,
+                       scheduler.Acquire(kDatabaseA));
+
+  // Other databases are not held up by the busy one.
+  ZETASQL_EXPECT_OK(scheduler.Acquire(kDatabaseB).status());
+
+  absl::Notification acquired;
+  std::thread waiter([&]() {
+    ZETASQL_EXPECT_OK(scheduler.Acquire(kDatabaseA).status());
+    acquired.Notify();
+  });
+  EXPECT_FALSE(acquired.WaitForNotificationWithTimeout(absl::Milliseconds(50)));
+  slot = DatabaseScheduler::Slot();
+  acquired.WaitForNotification();
+  waiter.join();
+}
+
+TEST(DatabaseSchedulerTest, QueuedRpcsGiveUpAtDeadlineOrCancellation) {
+  DatabaseScheduler scheduler(DatabaseScheduler::Options{.max_slots = 1});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(DatabaseScheduler::Slot slot,
+                       scheduler.Acquire(kDatabaseA));
+  EXPECT_THAT(
+      scheduler.Acquire(kDatabaseB, absl::Now() + absl::Milliseconds(10)),
+      StatusIs(absl::StatusCode::kDeadlineExceeded));
+  EXPECT_THAT(scheduler.Acquire(kDatabaseB, absl::InfiniteFuture(),
+                                []() { return true; }),
+              StatusIs(absl::StatusCode::kCancelled));
+
+  // The abandoned RPCs do not hold up those queued after them.
+  slot = DatabaseScheduler::Slot();
+  ZETASQL_EXPECT_OK(scheduler.Acquire(kDatabaseB).status());
+}
+
+TEST(DatabaseSchedulerTest, FreedSlotGoesToLeastServedDatabase) {
+  DatabaseScheduler scheduler(DatabaseScheduler::Options{.max_slots = 1});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(DatabaseScheduler::Slot slot,
+                       scheduler.Acquire(kDatabaseA));
+  absl::SleepFor(absl::Milliseconds(20));
+
+  // Database A queues first, but has used the slot for longer than database
+  // B, which starts level with the time A had used when B arrived.
+  absl::Mutex mu;
+  std::vector<std::string> order;
+  auto run = [&](const char* database_uri) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(DatabaseScheduler::Slot slot,
+                         scheduler.Acquire(database_uri));
+    absl::MutexLock lock(&mu);
+    order.push_back(database_uri);
+  };
+  std::thread a(run, kDatabaseA);
+  absl::SleepFor(absl::Milliseconds(50));
+  std::thread b(run, kDatabaseB);
+  absl::SleepFor(absl::Milliseconds(50));
+  slot = DatabaseScheduler::Slot();
+  a.join();
+  b.join();
+  EXPECT_THAT(order, ElementsAre(kDatabaseB, kDatabaseA));
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,49 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/database_shards.h"
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "common/config.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+int DatabaseShard(absl::string_view database_uri, int num_shards) {
+  // FNV-1a, since absl::Hash is seeded differently in each process.
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : database_uri) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return static_cast<int>(hash % num_shards);
+}
+
+bool OwnsDatabase(absl::string_view database_uri) {
+  const int shard_index = config::database_shard_index();
+  return shard_index < 0 ||
+         DatabaseShard(database_uri, config::database_shards()) == shard_index;
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
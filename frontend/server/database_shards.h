@@ -0,0 +1,42 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_DATABASE_SHARDS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_DATABASE_SHARDS_H_
+
+#include "absl/strings/string_view.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// Returns the shard, in [0, num_shards), which owns the database at
+// database_uri. The assignment only depends on the URI, so that the router and
+// every worker process agree on it, including across restarts.
+int DatabaseShard(absl::string_view database_uri, int num_shards);
+
+// Returns false if this process is a worker started for --database_shards and
+// the database at database_uri belongs to another worker.
+bool OwnsDatabase(absl::string_view database_uri);
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_DATABASE_SHARDS_H_
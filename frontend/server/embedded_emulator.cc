@@ -0,0 +1,50 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/embedded_emulator.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "common/errors.h"
+#include "frontend/server/server.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+absl::StatusOr<std::unique_ptr<EmbeddedEmulator>> EmbeddedEmulator::Create() {
+  std::unique_ptr<Server> server = Server::Create(Server::Options{});
+  if (server == nullptr) {
+    return error::Internal("Failed to start the embedded emulator.");
+  }
+  server->SetReady();
+  return absl::WrapUnique(new EmbeddedEmulator(std::move(server)));
+}
+
+EmbeddedEmulator::EmbeddedEmulator(std::unique_ptr<Server> server)
+    : server_(std::move(server)), channel_(server_->InProcessChannel()) {}
+
+EmbeddedEmulator::~EmbeddedEmulator() { server_->Shutdown(); }
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
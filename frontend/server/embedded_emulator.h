@@ -0,0 +1,70 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_EMBEDDED_EMULATOR_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_EMBEDDED_EMULATOR_H_
+
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "frontend/server/server.h"
+#include "grpcpp/channel.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// EmbeddedEmulator runs an emulator inside the calling process, for C++ tests
+// which link the emulator directly instead of starting it as a separate
+// binary.
+//
+// The emulator does not listen on any port. Clients reach it through channel(),
+// which hands requests to the gRPC server without going through the network
+// stack, so tests need no port management. For example:
+//
+//   ZETASQL_ASSERT_OK_AND_ASSIGN(auto emulator, EmbeddedEmulator::Create());
+//   auto stub = google::spanner::v1::Spanner::NewStub(emulator->channel());
+//
+// Each EmbeddedEmulator has its own instances and databases, and shuts down
+// when it is destroyed.
+class EmbeddedEmulator {
+ public:
+  static absl::StatusOr<std::unique_ptr<EmbeddedEmulator>> Create();
+
+  ~EmbeddedEmulator();
+
+  // Returns a channel to the emulator. Stubs created on it may be used
+  // concurrently, but must not outlive the emulator.
+  std::shared_ptr<grpc::Channel> channel() const { return channel_; }
+
+  // Returns the underlying server.
+  Server* server() const { return server_.get(); }
+
+ private:
+  explicit EmbeddedEmulator(std::unique_ptr<Server> server);
+
+  std::unique_ptr<Server> server_;
+  std::shared_ptr<grpc::Channel> channel_;
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_EMBEDDED_EMULATOR_H_
@@ -0,0 +1,85 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/embedded_emulator.h"
+
+#include <memory>
+#include <string>
+
+#include "google/longrunning/operations.pb.h"
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.grpc.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/support/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace instance_api = ::google::spanner::admin::instance::v1;
+
+absl::StatusOr<instance_api::Instance> GetInstance(
+    EmbeddedEmulator* emulator, const std::string& name) {
+  auto stub = instance_api::InstanceAdmin::NewStub(emulator->channel());
+  grpc::ClientContext context;
+  instance_api::GetInstanceRequest request;
+  request.set_name(name);
+  instance_api::Instance instance;
+  grpc::Status status = stub->GetInstance(&context, request, &instance);
+  if (!status.ok()) {
+    return absl::Status(static_cast<absl::StatusCode>(status.error_code()),
+                        status.error_message());
+  }
+  return instance;
+}
+
+TEST(EmbeddedEmulatorTest, ServesRequestsInProcess) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EmbeddedEmulator> emulator,
+                       EmbeddedEmulator::Create());
+  EXPECT_TRUE(emulator->server()->ready());
+
+  auto stub = instance_api::InstanceAdmin::NewStub(emulator->channel());
+  grpc::ClientContext context;
+  instance_api::CreateInstanceRequest request;
+  request.set_parent("projects/p");
+  request.set_instance_id("i");
+  request.mutable_instance()->set_config("emulator-config");
+  request.mutable_instance()->set_node_count(1);
+  longrunning::Operation operation;
+  ASSERT_TRUE(stub->CreateInstance(&context, request, &operation).ok());
+  ZETASQL_EXPECT_OK(GetInstance(emulator.get(), "projects/p/instances/i"));
+
+  // Every embedded emulator has its own state.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EmbeddedEmulator> other,
+                       EmbeddedEmulator::Create());
+  EXPECT_THAT(GetInstance(other.get(), "projects/p/instances/i"),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -18,8 +18,12 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_ENV_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "absl/strings/str_split.h"
 #include "common/clock.h"
+#include "common/config.h"
 #include "frontend/collections/database_manager.h"
 #include "frontend/collections/instance_manager.h"
 #include "frontend/collections/operation_manager.h"
@@ -35,7 +39,20 @@ class ServerEnv {
  public:
   ServerEnv()
       : clock_(new Clock()),
-        database_manager_(new DatabaseManager(clock_.get())),
+        database_manager_(
+            new DatabaseManager(clock_.get(), DatabaseManagerOptions{
+                .write_ahead_log_dir = config::write_ahead_log_dir(),
+                .sync_write_ahead_log = config::write_ahead_log_fsync(),
+                .disk_storage_dir = config::disk_storage_dir(),
+                .disk_storage_databases = absl::StrSplit(
+                    config::disk_storage_databases(), ',', absl::SkipEmpty()),
+                .disk_storage_cache_bytes = config::disk_storage_cache_bytes(),
+                .fixture_dir = config::fixture_dir(),
+                .hydrate_snapshots_lazily = config::lazy_snapshot_restore(),
+                .snapshot_hydration_threads =
+                    config::snapshot_hydration_threads(),
+                .schema_cache_size = config::schema_cache_size(),
+            })),
         instance_manager_(new InstanceManager()),
         operation_manager_(new OperationManager()),
         session_manager_(new SessionManager(clock_.get())) {}
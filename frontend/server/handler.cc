@@ -16,13 +16,39 @@
 
 #include "frontend/server/handler.h"
 
+#include <chrono>  // NOLINT
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "google/protobuf/message.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "zetasql/base/logging.h"
+#include "common/clock.h"
+#include "common/config.h"
+#include "common/metrics.h"
+#include "common/profiling.h"
+#include "common/tracing.h"
+#include "frontend/collections/session_manager.h"
+#include "frontend/entities/session.h"
+#include "frontend/proto/rpc_trace.pb.h"
+#include "frontend/server/admission_controller.h"
+#include "frontend/server/database_scheduler.h"
+#include "frontend/server/request_context.h"
+#include "frontend/server/resource_accounting.h"
+#include "frontend/server/rpc_recorder.h"
+#include "frontend/server/slow_rpc_log.h"
+#include "grpcpp/server_context.h"
 
 namespace google {
 namespace spanner {
@@ -37,6 +63,26 @@ namespace {
 // after that (i.e. handlers should not be added dynamically).
 class HandlerRegistry {
  public:
+  HandlerRegistry() {
+    metrics::RegisterGaugeCallback(
+        "emulator_rpc_allocations", {"method", "unit"}, [this]() {
+          absl::MutexLock lock(&mu_);
+          std::vector<metrics::GaugeSample> samples;
+          for (const auto& [method, handler] : handler_map_) {
+            // Methods are left out until they allocate, which they never do
+            // unless --count_allocations is set.
+            if (handler->allocations() == 0) continue;
+            samples.push_back(
+                {{method, "allocations"},
+                 static_cast<double>(handler->allocations())});
+            samples.push_back(
+                {{method, "bytes"},
+                 static_cast<double>(handler->allocated_bytes())});
+          }
+          return samples;
+        });
+  }
+
   // Adds a handler to the registry.
   void AddHandler(std::unique_ptr<GRPCHandlerBase> handler) {
     absl::MutexLock lock(&mu_);
@@ -72,6 +118,141 @@ HandlerRegistry* GetHandlerRegistry() {
 
 }  // namespace
 
+absl::Status GRPCHandlerBase::AdmitRpc(RequestContext* ctx,
+                                       const google::protobuf::Message& request,
+                                       RpcAdmission* admission) const {
+  AdmissionController* controller = AdmissionController::Default();
+  DatabaseScheduler* scheduler = DatabaseScheduler::Default();
+  if (controller == nullptr && scheduler == nullptr) return absl::OkStatus();
+  tracing::ScopedSpan span("AdmitRpc");
+  absl::Time deadline = absl::InfiniteFuture();
+  std::function<bool()> is_cancelled;
+  if (grpc::ServerContext* grpc = ctx->grpc(); grpc != nullptr) {
+    if (grpc->deadline() != std::chrono::system_clock::time_point::max()) {
+      deadline = absl::FromChrono(grpc->deadline());
+    }
+    is_cancelled = [grpc]() { return grpc->IsCancelled(); };
+  }
+  if (controller != nullptr) {
+    absl::StatusOr<AdmissionController::Ticket> ticket = controller->Admit(
+        AdmissionController::PriorityOf(method_name_, request), deadline,
+        is_cancelled);
+    if (!ticket.ok()) return ticket.status();
+    admission->ticket = std::move(ticket).value();
+  }
+  const std::string database_uri =
+      scheduler != nullptr ? DatabaseScheduler::DatabaseUriOf(request) : "";
+  if (!database_uri.empty()) {
+    absl::StatusOr<DatabaseScheduler::Slot> slot =
+        scheduler->Acquire(database_uri, deadline, is_cancelled);
+    if (!slot.ok()) return slot.status();
+    admission->slot = std::move(slot).value();
+  }
+  return absl::OkStatus();
+}
+
+void GRPCHandlerBase::RecordRpc(RpcRecorder* recorder, bool server_streaming,
+                                absl::Time start,
+                                const google::protobuf::Message& request,
+                                absl::string_view response_type,
+                                std::string response,
+                                const absl::Status& status) const {
+  RpcTraceEntry entry;
+  entry.set_service(service_name_);
+  entry.set_method(method_name_);
+  entry.set_server_streaming(server_streaming);
+  entry.set_start_time_micros(absl::ToUnixMicros(start));
+  entry.set_duration_micros(absl::ToInt64Microseconds(absl::Now() - start));
+  entry.set_request_type(request.GetDescriptor()->full_name());
+  request.SerializeToString(entry.mutable_request());
+  entry.set_response_type(std::string(response_type));
+  entry.set_response(std::move(response));
+  entry.set_status_code(static_cast<int>(status.code()));
+  recorder->Record(entry);
+}
+
+GRPCHandlerBase::RpcUsage::RpcUsage(RequestContext* ctx)
+    : ctx_(ctx),
+      accountant_(ResourceAccountant::Default()),
+      slow_threshold_(config::slow_rpc_threshold()),
+      start_(slow_threshold_ > absl::ZeroDuration() ? absl::Now()
+                                                    : absl::InfinitePast()),
+      cpu_start_(accountant_ != nullptr ? ThreadCpuTime()
+                                        : absl::ZeroDuration()) {
+  if (slow_threshold_ > absl::ZeroDuration()) {
+    stages_.emplace();
+  }
+  if (enabled()) {
+    ctx_->set_resource_counters(&counters_);
+  }
+}
+
+GRPCHandlerBase::RpcUsage::~RpcUsage() {
+  if (enabled()) {
+    ctx_->set_resource_counters(nullptr);
+  }
+}
+
+void GRPCHandlerBase::RpcUsage::Record(absl::string_view method,
+                                       const google::protobuf::Message& request,
+                                       int64_t response_bytes,
+                                       const absl::Status& status) {
+  if (stages_.has_value()) {
+    const absl::Duration latency = absl::Now() - start_;
+    if (latency >= slow_threshold_) {
+      SlowRpcRecord record;
+      record.method = std::string(method);
+      record.database_uri = DatabaseScheduler::DatabaseUriOf(request);
+      record.shape = RequestShape(request);
+      record.latency = latency;
+      record.status_code = status.code();
+      record.stages = stages_->stages();
+      ResourceUsage rows;
+      counters_.AddTo(&rows);
+      record.rows_scanned = rows.rows_scanned;
+      record.rows_returned = rows.rows_returned;
+      ZETASQL_LOG(WARNING) << "Slow RPC: " << SlowRpcRecordJson(record);
+    }
+  }
+  if (accountant_ == nullptr) {
+    return;
+  }
+
+  ResourceUsage usage;
+  usage.rpcs = 1;
+  usage.cpu_time = ThreadCpuTime() - cpu_start_;
+  usage.request_bytes = request.ByteSizeLong();
+  usage.response_bytes = response_bytes;
+  counters_.AddTo(&usage);
+
+  // The caller is named by a label of the session, which the RPC just looked
+  // up itself, so that looking it up again is cheap.
+  const std::string session_uri = ResourceAccountant::SessionUriOf(request);
+  std::string caller;
+  if (!session_uri.empty() && !accountant_->caller_label().empty() &&
+      ctx_->env() != nullptr) {
+    absl::StatusOr<std::shared_ptr<Session>> session =
+        ctx_->env()->session_manager()->GetSession(session_uri);
+    if (session.ok()) {
+      auto it = (*session)->labels().find(accountant_->caller_label());
+      if (it != (*session)->labels().end()) caller = it->second;
+    }
+  }
+  accountant_->Record(DatabaseScheduler::DatabaseUriOf(request), session_uri,
+                      caller, usage);
+}
+
+void GRPCHandlerBase::RecordAllocations(
+    const profiling::AllocationCount& start, tracing::ScopedSpan* span) {
+  const profiling::AllocationCount end = profiling::ThreadAllocationCount();
+  const int64_t allocations = end.allocations - start.allocations;
+  const int64_t bytes = end.bytes - start.bytes;
+  allocations_.fetch_add(allocations, std::memory_order_relaxed);
+  allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  span->SetAttribute("allocations", absl::StrCat(allocations));
+  span->SetAttribute("allocated_bytes", absl::StrCat(bytes));
+}
+
 HandlerRegisterer::HandlerRegisterer(std::unique_ptr<GRPCHandlerBase> handler) {
   GetHandlerRegistry()->AddHandler(std::move(handler));
 }
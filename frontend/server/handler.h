@@ -17,10 +17,29 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_HANDLER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_HANDLER_H_
 
-#include "zetasql/base/logging.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "google/protobuf/message.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "common/config.h"
+#include "common/metrics.h"
+#include "common/profiling.h"
+#include "common/tracing.h"
+#include "frontend/server/admission_controller.h"
+#include "frontend/server/database_scheduler.h"
 #include "frontend/server/request_context.h"
+#include "frontend/server/request_logger.h"
+#include "frontend/server/resource_accounting.h"
+#include "frontend/server/rpc_recorder.h"
 #include "grpcpp/grpcpp.h"
 #include "grpcpp/support/sync_stream.h"
 #include "absl/status/status.h"
@@ -30,6 +49,22 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+// Returns true if a response message of the given serialized size should be
+// compressed, as configured by --grpc_compression_threshold_bytes.
+inline bool ShouldCompressResponse(size_t size) {
+  const int64_t threshold = config::grpc_compression_threshold_bytes();
+  return threshold > 0 && size >= static_cast<size_t>(threshold);
+}
+
+// Asks gRPC to compress the responses of the call with the best algorithm that
+// the client advertised in its grpc-accept-encoding header. Clients which do
+// not accept any compressed encoding keep receiving uncompressed messages.
+inline void EnableResponseCompression(grpc::ServerContext* context) {
+  if (context != nullptr) {
+    context->set_compression_level(GRPC_COMPRESS_LEVEL_HIGH);
+  }
+}
+
 // ServerStream intercepts writes to a grpc::ServerWriter.
 //
 // Instead of passing a grpc::ServerWriter to server streaming handlers, we pass
@@ -38,18 +73,63 @@ namespace frontend {
 template <typename T>
 class ServerStream {
  public:
-  explicit ServerStream(grpc::ServerWriterInterface<T>* writer)
-      : writer_(writer) {}
+  // If context is non-null, messages above the configured compression
+  // threshold are compressed for clients that accept it. If log_messages is
+  // true, sent messages are written to the request log. If first_response is
+  // non-null, the first message sent is serialized to it.
+  explicit ServerStream(grpc::ServerWriterInterface<T>* writer,
+                        grpc::ServerContext* context = nullptr,
+                        bool log_messages = false,
+                        std::string* first_response = nullptr)
+      : writer_(writer),
+        context_(context),
+        log_messages_(log_messages),
+        first_response_(first_response) {}
 
-  void Send(const T& msg) {
-    if (config::should_log_requests()) {
-      ZETASQL_LOG(INFO) << "Sending streaming response:\n" << msg.DebugString();
+  // Sends msg to the client, blocking while the transport has no room for it.
+  // Returns false once the stream has been closed, e.g. because the client has
+  // gone away, in which case no further messages can be sent.
+  bool Send(const T& msg) {
+    if (log_messages_) {
+      RequestLogger::Default()->Log("Sending streaming response:", &msg);
+    }
+    if (first_response_ != nullptr) {
+      msg.SerializeToString(first_response_);
+      first_response_ = nullptr;
     }
-    writer_->Write(msg);
+    if (count_response_bytes_) {
+      response_bytes_ += msg.ByteSizeLong();
+    }
+    if (context_ == nullptr ||
+        config::grpc_compression_threshold_bytes() <= 0) {
+      return writer_->Write(msg);
+    }
+    // The compression level must be set before the initial metadata is sent,
+    // i.e. before the first message. Small messages opt out per write.
+    if (!compression_enabled_) {
+      EnableResponseCompression(context_);
+      compression_enabled_ = true;
+    }
+    grpc::WriteOptions options;
+    if (!ShouldCompressResponse(msg.ByteSizeLong())) {
+      options.set_no_compression();
+    }
+    return writer_->Write(msg, options);
   }
 
+  // Makes Send sum the serialized sizes of the messages it sends, returned by
+  // response_bytes once nothing is sending any more.
+  void CountResponseBytes() { count_response_bytes_ = true; }
+  int64_t response_bytes() const { return response_bytes_; }
+
  private:
   grpc::ServerWriterInterface<T>* writer_;
+  grpc::ServerContext* context_;
+  const bool log_messages_;
+  std::string* first_response_;
+  bool compression_enabled_ = false;
+  bool count_response_bytes_ = false;
+  int64_t response_bytes_ = 0;
 };
 
 // Base class for gRPC handlers.
@@ -57,15 +137,120 @@ class GRPCHandlerBase {
  public:
   GRPCHandlerBase(const std::string& service_name,
                   const std::string& method_name)
-      : service_name_(service_name), method_name_(method_name) {}
+      : service_name_(service_name),
+        method_name_(method_name),
+        latency_histogram_(metrics::GetLatencyHistogram(
+            "emulator_rpc_latency_seconds", "method",
+            service_name + "." + method_name)) {}
   virtual ~GRPCHandlerBase() {}
 
   const std::string& service_name() { return service_name_; }
   const std::string& method_name() { return method_name_; }
 
+  // Histogram of the time spent running this handler.
+  metrics::LatencyHistogram* latency_histogram() { return latency_histogram_; }
+
+  // The allocations made by the threads running this handler, counted with
+  // --count_allocations.
+  int64_t allocations() const {
+    return allocations_.load(std::memory_order_relaxed);
+  }
+  int64_t allocated_bytes() const {
+    return allocated_bytes_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  // Returns true if the current RPC should be written to the request log.
+  static bool ShouldLogRpc() {
+    return config::should_log_requests() &&
+           RequestLogger::Default()->ShouldLogRpc();
+  }
+
+  // Returns the first line of a log entry, e.g. "Request[Spanner.Read]".
+  std::string RpcLogHeader(absl::string_view kind) const {
+    return absl::StrCat(kind, "[", service_name_, ".", method_name_, "]");
+  }
+
+  // Returns the name of the span of an RPC, e.g. "Spanner.Read".
+  std::string RpcSpanName() const {
+    return absl::StrCat(service_name_, ".", method_name_);
+  }
+
+  // Returns the last line of a response log entry.
+  static std::string RpcLogStatus(const absl::Status& status) {
+    return status.ok() ? "OK" : "Error: " + status.ToString();
+  }
+
+  // What an RPC holds while it runs, in the order it is acquired.
+  struct RpcAdmission {
+    AdmissionController::Ticket ticket;
+    DatabaseScheduler::Slot slot;
+  };
+
+  // Waits for the default AdmissionController and DatabaseScheduler, if any,
+  // to let the RPC of request run, and sets admission to what it holds while
+  // running.
+  absl::Status AdmitRpc(RequestContext* ctx,
+                        const google::protobuf::Message& request,
+                        RpcAdmission* admission) const;
+
+  // Appends an RPC which started running at start to the trace of recorder,
+  // with the given serialized response of type response_type.
+  void RecordRpc(RpcRecorder* recorder, bool server_streaming,
+                 absl::Time start, const google::protobuf::Message& request,
+                 absl::string_view response_type, std::string response,
+                 const absl::Status& status) const;
+
+  // Returns the allocations made so far by the calling thread, if they are
+  // counted.
+  static profiling::AllocationCount AllocationsStart() {
+    return profiling::AllocationCountingEnabled()
+               ? profiling::ThreadAllocationCount()
+               : profiling::AllocationCount();
+  }
+
+  // Counts the allocations the calling thread made since start, as returned
+  // by AllocationsStart, towards this handler and sets them on span.
+  void RecordAllocations(const profiling::AllocationCount& start,
+                         tracing::ScopedSpan* span);
+
+  // The resource usage of a running RPC, measured if there is a default
+  // ResourceAccountant or RPCs slower than --slow_rpc_threshold are logged.
+  // The stages of the RPC are timed from its construction.
+  class RpcUsage {
+   public:
+    explicit RpcUsage(RequestContext* ctx);
+    ~RpcUsage();
+
+    // Accounts the RPC of request to method, which sent response_bytes of
+    // responses and ended with status, to the default ResourceAccountant, and
+    // logs it if it was slow. Must be called on the thread which constructed
+    // this object.
+    void Record(absl::string_view method,
+                const google::protobuf::Message& request,
+                int64_t response_bytes, const absl::Status& status);
+
+    bool enabled() const {
+      return accountant_ != nullptr || stages_.has_value();
+    }
+
+   private:
+    RequestContext* const ctx_;
+    ResourceAccountant* const accountant_;
+    const absl::Duration slow_threshold_;
+    const absl::Time start_;
+    const absl::Duration cpu_start_;
+    RpcResourceCounters counters_;
+    // Set if slow RPCs are logged.
+    std::optional<tracing::StageTimer> stages_;
+  };
+
  private:
   const std::string service_name_;
   const std::string method_name_;
+  metrics::LatencyHistogram* const latency_histogram_;
+  std::atomic<int64_t> allocations_ = 0;
+  std::atomic<int64_t> allocated_bytes_ = 0;
 };
 
 // UnaryGRPCHandler handles unary gRPC methods.
@@ -84,17 +269,41 @@ class UnaryGRPCHandler final : public GRPCHandlerBase {
   // Invokes the user-defined handler function wrapped by this class.
   absl::Status Run(RequestContext* ctx, const RequestT* request,
                    ResponseT* response) {
-    if (config::should_log_requests()) {
-      ZETASQL_LOG(INFO) << "Request[" << service_name() << "." << method_name() << "]\n"
-                << request->DebugString();
+    metrics::ScopedLatencyTimer timer(latency_histogram());
+    tracing::ScopedSpan span(RpcSpanName(), ctx->trace_context());
+    RpcRecorder* const recorder = RpcRecorder::Default();
+    const absl::Time start =
+        recorder != nullptr ? absl::Now() : absl::InfinitePast();
+    const bool log_rpc = ShouldLogRpc();
+    if (log_rpc) {
+      RequestLogger::Default()->Log(RpcLogHeader("Request"), request);
+    }
+    const profiling::AllocationCount allocations_start = AllocationsStart();
+    RpcUsage usage(ctx);
+    RpcAdmission admission;
+    absl::Status status = AdmitRpc(ctx, *request, &admission);
+    if (status.ok()) status = fn_(ctx, request, response);
+    if (profiling::AllocationCountingEnabled()) {
+      RecordAllocations(allocations_start, &span);
+    }
+    if (status.ok() && ctx->grpc() != nullptr &&
+        ShouldCompressResponse(response->ByteSizeLong())) {
+      EnableResponseCompression(ctx->grpc());
     }
-    absl::Status status = fn_(ctx, request, response);
-    if (config::should_log_requests()) {
-      ZETASQL_LOG(INFO) << "Response[" << service_name() << "." << method_name()
-                << "]\n"
-                << response->DebugString() << "\n"
-                << (status.ok() ? "OK" : "Error: " + status.ToString());
+    if (usage.enabled()) {
+      usage.Record(RpcSpanName(), *request,
+                   status.ok() ? response->ByteSizeLong() : 0, status);
     }
+    if (log_rpc) {
+      RequestLogger::Default()->Log(RpcLogHeader("Response"), response,
+                                    RpcLogStatus(status));
+    }
+    if (recorder != nullptr) {
+      RecordRpc(recorder, /*server_streaming=*/false, start, *request,
+                ResponseT::descriptor()->full_name(),
+                status.ok() ? response->SerializeAsString() : "", status);
+    }
+    span.SetStatus(status);
     return status;
   }
 
@@ -118,17 +327,41 @@ class ServerStreamingGRPCHandler final : public GRPCHandlerBase {
   // Invokes the user-defined handler function wrapped by this class.
   absl::Status Run(RequestContext* ctx, const RequestT* request,
                    grpc::ServerWriterInterface<ResponseT>* writer) {
-    if (config::should_log_requests()) {
-      ZETASQL_LOG(INFO) << "Request[" << service_name() << "." << method_name() << "]\n"
-                << request->DebugString();
+    metrics::ScopedLatencyTimer timer(latency_histogram());
+    tracing::ScopedSpan span(RpcSpanName(), ctx->trace_context());
+    RpcRecorder* const recorder = RpcRecorder::Default();
+    const absl::Time start =
+        recorder != nullptr ? absl::Now() : absl::InfinitePast();
+    const bool log_rpc = ShouldLogRpc();
+    if (log_rpc) {
+      RequestLogger::Default()->Log(RpcLogHeader("Request"), request);
+    }
+    std::string first_response;
+    ServerStream<ResponseT> stream(writer, ctx->grpc(), log_rpc,
+                                   recorder != nullptr ? &first_response
+                                                       : nullptr);
+    const profiling::AllocationCount allocations_start = AllocationsStart();
+    RpcUsage usage(ctx);
+    if (usage.enabled()) stream.CountResponseBytes();
+    RpcAdmission admission;
+    absl::Status status = AdmitRpc(ctx, *request, &admission);
+    if (status.ok()) status = fn_(ctx, request, &stream);
+    if (profiling::AllocationCountingEnabled()) {
+      RecordAllocations(allocations_start, &span);
+    }
+    if (usage.enabled()) {
+      usage.Record(RpcSpanName(), *request, stream.response_bytes(), status);
+    }
+    if (log_rpc) {
+      RequestLogger::Default()->Log(RpcLogHeader("Response"), nullptr,
+                                    RpcLogStatus(status));
     }
-    ServerStream<ResponseT> stream(writer);
-    absl::Status status = fn_(ctx, request, &stream);
-    if (config::should_log_requests()) {
-      ZETASQL_LOG(INFO) << "Response[" << service_name() << "." << method_name()
-                << "]\n"
-                << (status.ok() ? "OK" : "Error: " + status.ToString());
+    if (recorder != nullptr) {
+      RecordRpc(recorder, /*server_streaming=*/true, start, *request,
+                ResponseT::descriptor()->full_name(),
+                std::move(first_response), status);
     }
+    span.SetStatus(status);
 
     return status;
   }
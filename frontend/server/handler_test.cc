@@ -16,13 +16,20 @@
 
 #include "frontend/server/handler.h"
 
+#include <string>
+#include <vector>
+
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
 
+ABSL_DECLARE_FLAG(int64_t, grpc_compression_threshold_bytes);
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -62,13 +69,23 @@ class TestServerWriter : public grpc::ServerWriterInterface<MessageT> {
  public:
   void SendInitialMetadata() override {}
   bool Write(const MessageT& msg, grpc::WriteOptions options) override {
+    if (closed_) {
+      return false;
+    }
     messages_.push_back(msg);
+    compressed_.push_back(!options.get_no_compression());
     return true;
   }
   const std::vector<MessageT>& messages() { return messages_; }
+  const std::vector<bool>& compressed() { return compressed_; }
+
+  // Makes all subsequent writes fail, as if the client had gone away.
+  void Close() { closed_ = true; }
 
  private:
   std::vector<MessageT> messages_;
+  std::vector<bool> compressed_;
+  bool closed_ = false;
 };
 
 // Example handler to test server streaming gRPC method registration.
@@ -104,6 +121,31 @@ TEST(HandlerRegisterer, RegistersServerStreamingGRPCHandler) {
   EXPECT_EQ("World", writer.messages().at(1).resume_token());
 }
 
+TEST(ServerStream, SendReportsClosedStream) {
+  TestServerWriter<google::spanner::v1::PartialResultSet> writer;
+  ServerStream<google::spanner::v1::PartialResultSet> stream(&writer);
+  google::spanner::v1::PartialResultSet prs;
+  EXPECT_TRUE(stream.Send(prs));
+  writer.Close();
+  EXPECT_FALSE(stream.Send(prs));
+  EXPECT_EQ(1, writer.messages().size());
+}
+
+TEST(ServerStream, CompressesOnlyMessagesAboveThreshold) {
+  absl::SetFlag(&FLAGS_grpc_compression_threshold_bytes, 100);
+  grpc::ServerContext context;
+  TestServerWriter<google::spanner::v1::PartialResultSet> writer;
+  ServerStream<google::spanner::v1::PartialResultSet> stream(&writer, &context);
+  google::spanner::v1::PartialResultSet small;
+  small.set_resume_token("small");
+  google::spanner::v1::PartialResultSet large;
+  large.set_resume_token(std::string(200, 'x'));
+  EXPECT_TRUE(stream.Send(small));
+  EXPECT_TRUE(stream.Send(large));
+  EXPECT_THAT(writer.compressed(), testing::ElementsAre(false, true));
+  absl::SetFlag(&FLAGS_grpc_compression_threshold_bytes, 0);
+}
+
 TEST(HandlerRegisterer, ReturnsNullptrForUnrecognizedHandlers) {
   ASSERT_EQ(nullptr, GetHandler("UnknownServer", "UnknownMethod"));
 }
@@ -0,0 +1,294 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/metrics_server.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "common/errors.h"
+#include "common/metrics.h"
+#include "common/profiling.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+// Maximum size of an HTTP request header that the server reads.
+constexpr int kMaxRequestSize = 8192;
+
+// How long a read or write on a connection may block, so that a client which
+// stops sending or reading does not hold up the connections behind it.
+constexpr absl::Duration kConnectionTimeout = absl::Seconds(5);
+
+// Writes data to the connection fd. A client which closed the connection does
+// not raise SIGPIPE, which would terminate the emulator.
+void WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n =
+        send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return;
+    }
+    written += n;
+  }
+}
+
+std::string HttpResponse(
+    absl::string_view status, absl::string_view body,
+    absl::string_view content_type = "text/plain; version=0.0.4") {
+  return absl::StrCat("HTTP/1.0 ", status, "\r\nContent-Type: ", content_type,
+                      "\r\nContent-Length: ", body.size(),
+                      "\r\nConnection: close\r\n\r\n", body);
+}
+
+// The longest CPU profile served.
+constexpr int kMaxProfileSeconds = 300;
+constexpr int kDefaultProfileSeconds = 30;
+
+// Returns the path requested by an HTTP request line such as
+// "GET /metrics?x=1 HTTP/1.1", without its query, or an empty string if the
+// request is not a GET.
+absl::string_view RequestPath(absl::string_view request) {
+  if (!absl::ConsumePrefix(&request, "GET ")) {
+    return "";
+  }
+  return request.substr(0, request.find_first_of(" ?\r\n"));
+}
+
+// Returns the value of the query parameter name of an HTTP request line, or an
+// empty string if the request does not have it.
+absl::string_view QueryParam(absl::string_view request,
+                             absl::string_view name) {
+  request = request.substr(0, request.find_first_of(" \r\n", 4));
+  const size_t query = request.find('?');
+  if (query == absl::string_view::npos) {
+    return "";
+  }
+  for (absl::string_view param :
+       absl::StrSplit(request.substr(query + 1), '&')) {
+    if (absl::ConsumePrefix(&param, name) && absl::ConsumePrefix(&param, "=")) {
+      return param;
+    }
+  }
+  return "";
+}
+
+// Collects a CPU profile for the number of seconds requested, or until stopping
+// is notified, and returns the response with the profile.
+std::string CpuProfileResponse(absl::string_view request,
+                               absl::Notification* stopping) {
+  int seconds = kDefaultProfileSeconds;
+  const absl::string_view seconds_param = QueryParam(request, "seconds");
+  if (!seconds_param.empty() &&
+      (!absl::SimpleAtoi(seconds_param, &seconds) || seconds <= 0 ||
+       seconds > kMaxProfileSeconds)) {
+    return HttpResponse("400 Bad Request",
+                        absl::StrCat("seconds must be between 1 and ",
+                                     kMaxProfileSeconds, "\n"));
+  }
+  if (absl::Status status = profiling::StartCpuProfile(); !status.ok()) {
+    return HttpResponse("409 Conflict", absl::StrCat(status.message(), "\n"));
+  }
+  stopping->WaitForNotificationWithTimeout(absl::Seconds(seconds));
+  absl::StatusOr<std::string> profile = profiling::StopCpuProfile();
+  if (!profile.ok()) {
+    return HttpResponse("500 Internal Server Error",
+                        absl::StrCat(profile.status().message(), "\n"));
+  }
+  return HttpResponse("200 OK", *profile, "application/octet-stream");
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<MetricsServer>> MetricsServer::Create(
+    const std::string& address, std::map<std::string, JsonPage> json_pages,
+    ReadinessCheck is_ready) {
+  const size_t colon = address.find_last_of(':');
+  if (colon == std::string::npos) {
+    return error::Internal(
+        absl::StrCat("Invalid metrics server address: ", address));
+  }
+  const std::string host = address.substr(0, colon);
+  const std::string port = address.substr(colon + 1);
+
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  addrinfo* addresses = nullptr;
+  if (int rc = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+                           &hints, &addresses);
+      rc != 0) {
+    return error::Internal(absl::StrCat("Failed to resolve ", address, ": ",
+                                        gai_strerror(rc)));
+  }
+  int fd = -1;
+  for (addrinfo* ai = addresses; ai != nullptr; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 16) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) {
+    return error::Internal(absl::StrCat("Failed to bind metrics server to ",
+                                        address, ": ", std::strerror(errno)));
+  }
+
+  sockaddr_storage bound = {};
+  socklen_t bound_len = sizeof(bound);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &bound_len);
+  const int bound_port =
+      bound.ss_family == AF_INET6
+          ? ntohs(reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port)
+          : ntohs(reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+  return absl::WrapUnique(new MetricsServer(
+      fd, bound_port, std::move(json_pages), std::move(is_ready)));
+}
+
+MetricsServer::MetricsServer(int listen_fd, int port,
+                             std::map<std::string, JsonPage> json_pages,
+                             ReadinessCheck is_ready)
+    : listen_fd_(listen_fd),
+      port_(port),
+      json_pages_(std::move(json_pages)),
+      is_ready_(std::move(is_ready)) {
+  thread_ = std::thread(&MetricsServer::Serve, this);
+}
+
+MetricsServer::~MetricsServer() {
+  // Cuts short a CPU profile being collected.
+  stopping_.Notify();
+  // Unblocks the accept() in Serve().
+  shutdown(listen_fd_, SHUT_RDWR);
+  thread_.join();
+  if (profile_thread_.joinable()) {
+    profile_thread_.join();
+  }
+  close(listen_fd_);
+}
+
+void MetricsServer::Serve() {
+  while (true) {
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // The listening socket was shut down.
+      return;
+    }
+    const timeval timeout = absl::ToTimeval(kConnectionTimeout);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    HandleConnection(fd);
+  }
+}
+
+void MetricsServer::HandleConnection(int fd) {
+  std::string request;
+  char buffer[1024];
+  while (request.size() < kMaxRequestSize &&
+         !absl::StrContains(request, "\r\n\r\n")) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      break;
+    }
+    request.append(buffer, n);
+  }
+  const absl::string_view path = RequestPath(request);
+  if (path == "/debug/pprof/profile") {
+    ServeCpuProfile(fd, std::move(request));
+    return;
+  }
+  if (path == "/metrics") {
+    WriteAll(fd, HttpResponse("200 OK", metrics::ExportPrometheusText()));
+  } else if (path == "/readyz") {
+    WriteAll(fd, is_ready_ == nullptr || is_ready_()
+                     ? HttpResponse("200 OK", "ready\n")
+                     : HttpResponse("503 Service Unavailable", "not ready\n"));
+  } else if (path == "/debug/heap") {
+    WriteAll(fd, HttpResponse("200 OK", profiling::HeapStatsText()));
+  } else if (auto page = json_pages_.find(std::string(path));
+             page != json_pages_.end()) {
+    WriteAll(fd, HttpResponse("200 OK", page->second(), "application/json"));
+  } else {
+    WriteAll(fd, HttpResponse("404 Not Found", "Not found\n"));
+  }
+  close(fd);
+}
+
+void MetricsServer::ServeCpuProfile(int fd, std::string request) {
+  absl::MutexLock lock(&mu_);
+  if (profiling_) {
+    WriteAll(fd, HttpResponse("409 Conflict",
+                              "A CPU profile is already being collected.\n"));
+    close(fd);
+    return;
+  }
+  // The previous profile has been sent, so its thread is about to exit.
+  if (profile_thread_.joinable()) {
+    profile_thread_.join();
+  }
+  profiling_ = true;
+  profile_thread_ = std::thread([this, fd, request = std::move(request)] {
+    WriteAll(fd, CpuProfileResponse(request, &stopping_));
+    close(fd);
+    absl::MutexLock lock(&mu_);
+    profiling_ = false;
+  });
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,120 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_METRICS_SERVER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_METRICS_SERVER_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// MetricsServer serves the emulator's latency histograms over HTTP.
+//
+// Every request to /metrics is answered with the output of
+// metrics::ExportPrometheusText(), so the endpoint can be scraped directly by
+// Prometheus or any collector which understands its text format. The server
+// handles one connection at a time on a single background thread, which is
+// plenty for periodic scrapes. A connection which does not send its request or
+// read its response within a few seconds is closed.
+//
+// The server also serves profiles of the emulator process, so that it can be
+// profiled where attaching a profiler is not possible:
+//
+//   /debug/pprof/profile?seconds=N  collects a CPU profile for N seconds,
+//                                   30 by default, in a format read by pprof.
+//   /debug/heap                     the statistics of the malloc heap.
+//
+// A CPU profile is collected on a thread of its own, so other requests are
+// served meanwhile, but only one profile is collected at a time.
+//
+// Other diagnostics can be served as JSON pages, each produced on request by a
+// function which is called on the serving thread.
+//
+// Requests to /readyz are answered with 200 OK once the emulator is ready to
+// serve, and 503 Service Unavailable until then, so that jobs which start an
+// emulator can poll it instead of sleeping.
+class MetricsServer {
+ public:
+  // Returns the body of a JSON page.
+  using JsonPage = std::function<std::string()>;
+
+  // Returns true if the emulator is ready to serve.
+  using ReadinessCheck = std::function<bool()>;
+
+  // Starts serving on the given host:port address. Port 0 picks a free port.
+  // json_pages maps paths such as "/keyheatmap" to the pages served on them.
+  // Without is_ready, the emulator is ready as soon as the server is.
+  static absl::StatusOr<std::unique_ptr<MetricsServer>> Create(
+      const std::string& address,
+      std::map<std::string, JsonPage> json_pages = {},
+      ReadinessCheck is_ready = nullptr);
+
+  // Stops serving and waits for the serving thread to exit.
+  ~MetricsServer();
+
+  // The port the server is listening on.
+  int port() const { return port_; }
+
+ private:
+  MetricsServer(int listen_fd, int port,
+                std::map<std::string, JsonPage> json_pages,
+                ReadinessCheck is_ready);
+
+  void Serve();
+
+  // Responds to a single HTTP request on the connection and closes it.
+  void HandleConnection(int fd);
+
+  // Collects the CPU profile requested on the connection on profile_thread_,
+  // which responds and closes the connection.
+  void ServeCpuProfile(int fd, std::string request) ABSL_LOCKS_EXCLUDED(mu_);
+
+  const int listen_fd_;
+  const int port_;
+  const std::map<std::string, JsonPage> json_pages_;
+  const ReadinessCheck is_ready_;
+  std::thread thread_;
+
+  // Notified when the server is destroyed.
+  absl::Notification stopping_;
+
+  // Whether profile_thread_ is still collecting a profile. The thread itself
+  // is only touched by the serving thread, and by the destructor once that has
+  // exited.
+  absl::Mutex mu_;
+  bool profiling_ ABSL_GUARDED_BY(mu_) = false;
+  std::thread profile_thread_;
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_METRICS_SERVER_H_
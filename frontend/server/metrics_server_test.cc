@@ -0,0 +1,197 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/metrics_server.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/time/time.h"
+#include "common/metrics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::StartsWith;
+
+// Sends request to the server on localhost and returns the full response.
+std::string SendRequest(int port, const std::string& request) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)),
+            0);
+  EXPECT_EQ(write(fd, request.data(), request.size()), request.size());
+  std::string response;
+  char buffer[1024];
+  ssize_t n;
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+    response.append(buffer, n);
+  }
+  close(fd);
+  return response;
+}
+
+TEST(MetricsServerTest, ServesHistogramsOnMetricsPath) {
+  metrics::GetLatencyHistogram("metrics_server_test_seconds")
+      ->Record(absl::Milliseconds(1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MetricsServer> server,
+                       MetricsServer::Create("127.0.0.1:0"));
+  ASSERT_GT(server->port(), 0);
+
+  std::string response =
+      SendRequest(server->port(), "GET /metrics HTTP/1.1\r\n\r\n");
+  EXPECT_THAT(response, StartsWith("HTTP/1.0 200 OK"));
+  EXPECT_THAT(response, HasSubstr("metrics_server_test_seconds_count 1\n"));
+}
+
+TEST(MetricsServerTest, ServesJsonPages) {
+  int calls = 0;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<MetricsServer> server,
+      MetricsServer::Create("127.0.0.1:0", {{"/page", [&calls] {
+                                               ++calls;
+                                               return std::string("[1,2]");
+                                             }}}));
+
+  std::string response =
+      SendRequest(server->port(), "GET /page?x=1 HTTP/1.1\r\n\r\n");
+  EXPECT_THAT(response, StartsWith("HTTP/1.0 200 OK"));
+  EXPECT_THAT(response, HasSubstr("Content-Type: application/json\r\n"));
+  EXPECT_THAT(response, HasSubstr("\r\n\r\n[1,2]"));
+  EXPECT_EQ(calls, 1);
+  EXPECT_THAT(SendRequest(server->port(), "GET /pages HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 404 Not Found"));
+}
+
+TEST(MetricsServerTest, ServesCpuProfiles) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MetricsServer> server,
+                       MetricsServer::Create("127.0.0.1:0"));
+  std::string response = SendRequest(
+      server->port(), "GET /debug/pprof/profile?seconds=1 HTTP/1.1\r\n\r\n");
+  EXPECT_THAT(response, StartsWith("HTTP/1.0 200 OK"));
+  EXPECT_THAT(response,
+              HasSubstr("Content-Type: application/octet-stream\r\n"));
+  EXPECT_THAT(
+      SendRequest(server->port(),
+                  "GET /debug/pprof/profile?seconds=0 HTTP/1.1\r\n\r\n"),
+      StartsWith("HTTP/1.0 400 Bad Request"));
+}
+
+TEST(MetricsServerTest, ServesOtherRequestsWhileCollectingCpuProfile) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MetricsServer> server,
+                       MetricsServer::Create("127.0.0.1:0"));
+  std::atomic<bool> profile_sent = false;
+  std::thread profile([&] {
+    EXPECT_THAT(
+        SendRequest(server->port(),
+                    "GET /debug/pprof/profile?seconds=2 HTTP/1.1\r\n\r\n"),
+        StartsWith("HTTP/1.0 200 OK"));
+    profile_sent = true;
+  });
+  EXPECT_THAT(SendRequest(server->port(), "GET /readyz HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 200 OK"));
+  EXPECT_FALSE(profile_sent);
+  profile.join();
+}
+
+TEST(MetricsServerTest, ServesHeapStats) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MetricsServer> server,
+                       MetricsServer::Create("127.0.0.1:0"));
+  EXPECT_THAT(SendRequest(server->port(), "GET /debug/heap HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 200 OK"));
+}
+
+TEST(MetricsServerTest, ServesReadiness) {
+  bool ready = false;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<MetricsServer> server,
+      MetricsServer::Create("127.0.0.1:0", {}, [&ready] { return ready; }));
+  EXPECT_THAT(SendRequest(server->port(), "GET /readyz HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 503 Service Unavailable"));
+  ready = true;
+  EXPECT_THAT(SendRequest(server->port(), "GET /readyz HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 200 OK"));
+}
+
+TEST(MetricsServerTest, ServesRequestsBehindAStalledConnection) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MetricsServer> server,
+                       MetricsServer::Create("127.0.0.1:0"));
+
+  // The client connects but never sends its request.
+  int stalled_fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(server->port());
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(connect(stalled_fd, reinterpret_cast<sockaddr*>(&address),
+                    sizeof(address)),
+            0);
+
+  EXPECT_THAT(SendRequest(server->port(), "GET /readyz HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 200 OK"));
+  close(stalled_fd);
+}
+
+TEST(MetricsServerTest, KeepsServingAfterClientCloses) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MetricsServer> server,
+                       MetricsServer::Create("127.0.0.1:0"));
+
+  // The client closes the connection without reading the response.
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(server->port());
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)),
+            0);
+  const std::string request = "GET /debug/heap HTTP/1.1\r\n\r\n";
+  ASSERT_EQ(write(fd, request.data(), request.size()), request.size());
+  close(fd);
+
+  EXPECT_THAT(SendRequest(server->port(), "GET /readyz HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 200 OK"));
+}
+
+TEST(MetricsServerTest, RejectsOtherPaths) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<MetricsServer> server,
+                       MetricsServer::Create("127.0.0.1:0"));
+  EXPECT_THAT(SendRequest(server->port(), "GET / HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.0 404 Not Found"));
+}
+
+}  // namespace
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
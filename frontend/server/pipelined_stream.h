@@ -0,0 +1,161 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_PIPELINED_STREAM_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_PIPELINED_STREAM_H_
+
+#include <deque>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "frontend/server/handler.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// PipelinedServerStream writes messages to a ServerStream on a thread of its
+// own, so that a streaming handler can produce the next message while the
+// previous one is blocked on gRPC flow control.
+//
+// At most `capacity` messages are buffered at any time, which bounds the memory
+// held by a stream whose client reads slower than the handler produces. With
+// the default capacity of 2, one message is being written while the next one is
+// waiting for it. The writer thread is started by the first call to Send.
+// last_send_waited() tells whether the client is keeping up: it is set when a
+// message could only be queued once an earlier one had been written.
+//
+// Usage:
+//     PipelinedServerStream<spanner_api::PartialResultSet> pipeline(stream);
+//     while (...) {
+//       if (!pipeline.Send(std::move(message))) {
+//         return error::StreamClosedByClient();
+//       }
+//     }
+//     if (!pipeline.Close()) {
+//       return error::StreamClosedByClient();
+//     }
+template <typename T>
+class PipelinedServerStream {
+ public:
+  explicit PipelinedServerStream(ServerStream<T>* stream, int capacity = 2)
+      : stream_(stream), capacity_(capacity) {}
+
+  PipelinedServerStream(const PipelinedServerStream&) = delete;
+  PipelinedServerStream& operator=(const PipelinedServerStream&) = delete;
+
+  ~PipelinedServerStream() { Close(); }
+
+  // Queues msg to be written, blocking while the buffer is full. Returns false
+  // once a write has failed, in which case msg is dropped.
+  bool Send(T msg) {
+    absl::MutexLock lock(&mu_);
+    if (!writer_.joinable()) {
+      writer_ = std::thread(&PipelinedServerStream::WriteMessages, this);
+    }
+    auto has_room = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return failed_ || static_cast<int>(pending_.size()) < capacity_;
+    };
+    last_send_waited_ = !has_room();
+    mu_.Await(absl::Condition(&has_room));
+    if (failed_) {
+      return false;
+    }
+    pending_.push_back(std::move(msg));
+    return true;
+  }
+
+  // Returns true if the last call to Send had to wait for room in the buffer.
+  bool last_send_waited() const {
+    absl::MutexLock lock(&mu_);
+    return last_send_waited_;
+  }
+
+  // Waits for all the queued messages to be written and stops the writer
+  // thread. Returns false if any write failed. No message may be sent after.
+  bool Close() {
+    {
+      absl::MutexLock lock(&mu_);
+      closed_ = true;
+    }
+    if (writer_.joinable()) {
+      writer_.join();
+    }
+    absl::MutexLock lock(&mu_);
+    return !failed_;
+  }
+
+ private:
+  // Body of the writer thread.
+  void WriteMessages() {
+    while (true) {
+      T msg;
+      {
+        absl::MutexLock lock(&mu_);
+        auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          return closed_ || !pending_.empty();
+        };
+        mu_.Await(absl::Condition(&has_work));
+        if (pending_.empty()) {
+          return;
+        }
+        msg = std::move(pending_.front());
+        pending_.pop_front();
+      }
+      // The message is written without holding the lock, so that the next one
+      // can be queued in the meantime.
+      if (!stream_->Send(msg)) {
+        absl::MutexLock lock(&mu_);
+        failed_ = true;
+        pending_.clear();
+        return;
+      }
+    }
+  }
+
+  // The stream the messages are written to.
+  ServerStream<T>* stream_;
+
+  // The maximum number of messages waiting to be written.
+  const int capacity_;
+
+  mutable absl::Mutex mu_;
+
+  // Messages waiting to be written, in order.
+  std::deque<T> pending_ ABSL_GUARDED_BY(mu_);
+
+  // Set by Close() once no more messages will be sent.
+  bool closed_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Set once a write has failed.
+  bool failed_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Whether the last call to Send had to wait for room in the buffer.
+  bool last_send_waited_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Writes the queued messages to stream_.
+  std::thread writer_;
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_PIPELINED_STREAM_H_
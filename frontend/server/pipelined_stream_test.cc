@@ -0,0 +1,142 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/pipelined_stream.h"
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "google/spanner/v1/result_set.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+using ::google::spanner::v1::PartialResultSet;
+
+// Test ServerWriter which captures the written messages and fails all writes
+// after the first max_writes. If unblock is not null, writes wait for it.
+class TestServerWriter : public grpc::ServerWriterInterface<PartialResultSet> {
+ public:
+  explicit TestServerWriter(int max_writes = -1,
+                            absl::Notification* unblock = nullptr)
+      : max_writes_(max_writes), unblock_(unblock) {}
+
+  void SendInitialMetadata() override {}
+
+  bool Write(const PartialResultSet& msg, grpc::WriteOptions options) override {
+    if (unblock_ != nullptr) {
+      unblock_->WaitForNotification();
+    }
+    absl::MutexLock lock(&mu_);
+    if (max_writes_ >= 0 && static_cast<int>(tokens_.size()) >= max_writes_) {
+      return false;
+    }
+    tokens_.push_back(msg.resume_token());
+    return true;
+  }
+
+  std::vector<std::string> tokens() {
+    absl::MutexLock lock(&mu_);
+    return tokens_;
+  }
+
+ private:
+  const int max_writes_;
+  absl::Notification* unblock_;
+  absl::Mutex mu_;
+  std::vector<std::string> tokens_ ABSL_GUARDED_BY(mu_);
+};
+
+PartialResultSet MakeMessage(const std::string& token) {
+  PartialResultSet msg;
+  msg.set_resume_token(token);
+  return msg;
+}
+
+TEST(PipelinedServerStreamTest, WritesMessagesInOrder) {
+  TestServerWriter writer;
+  ServerStream<PartialResultSet> stream(&writer);
+  PipelinedServerStream<PartialResultSet> pipeline(&stream);
+  std::vector<std::string> expected;
+  for (int i = 0; i < 100; ++i) {
+    expected.push_back(std::to_string(i));
+    ASSERT_TRUE(pipeline.Send(MakeMessage(expected.back())));
+  }
+  EXPECT_TRUE(pipeline.Close());
+  EXPECT_EQ(writer.tokens(), expected);
+}
+
+TEST(PipelinedServerStreamTest, CloseWithoutMessagesSucceeds) {
+  TestServerWriter writer;
+  ServerStream<PartialResultSet> stream(&writer);
+  PipelinedServerStream<PartialResultSet> pipeline(&stream);
+  EXPECT_TRUE(pipeline.Close());
+  EXPECT_TRUE(writer.tokens().empty());
+}
+
+TEST(PipelinedServerStreamTest, ReportsFailedWrites) {
+  TestServerWriter writer(/*max_writes=*/3);
+  ServerStream<PartialResultSet> stream(&writer);
+  PipelinedServerStream<PartialResultSet> pipeline(&stream);
+  // Sends start failing at the latest once the buffer has filled up behind
+  // the failed write.
+  bool sent = true;
+  for (int i = 0; i < 10 && sent; ++i) {
+    sent = pipeline.Send(MakeMessage(std::to_string(i)));
+  }
+  EXPECT_FALSE(pipeline.Close());
+  EXPECT_THAT(writer.tokens(), testing::ElementsAre("0", "1", "2"));
+}
+
+TEST(PipelinedServerStreamTest, ReportsSendsWhichWaitedForWrites) {
+  absl::Notification unblock;
+  TestServerWriter writer(/*max_writes=*/-1, &unblock);
+  ServerStream<PartialResultSet> stream(&writer);
+  PipelinedServerStream<PartialResultSet> pipeline(&stream, /*capacity=*/1);
+  ASSERT_TRUE(pipeline.Send(MakeMessage("0")));
+  EXPECT_FALSE(pipeline.last_send_waited());
+
+  // The first message is stuck being written, so the buffer fills up with the
+  // second one and the third has to wait.
+  std::thread unblocker([&unblock]() {
+    absl::SleepFor(absl::Milliseconds(50));
+    unblock.Notify();
+  });
+  ASSERT_TRUE(pipeline.Send(MakeMessage("1")));
+  ASSERT_TRUE(pipeline.Send(MakeMessage("2")));
+  EXPECT_TRUE(pipeline.last_send_waited());
+  unblocker.join();
+  EXPECT_TRUE(pipeline.Close());
+  EXPECT_THAT(writer.tokens(), testing::ElementsAre("0", "1", "2"));
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
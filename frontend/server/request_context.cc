@@ -17,9 +17,12 @@
 #include "frontend/server/request_context.h"
 
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "common/tracing.h"
 #include "frontend/common/uris.h"
 #include "frontend/entities/instance.h"
 #include "zetasql/base/status_macros.h"
@@ -29,6 +32,38 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+namespace {
+
+absl::StatusOr<std::shared_ptr<Session>> LookupSession(
+    RequestContext* ctx, const std::string& session_uri) {
+  // The ParseSessionUri and GetDatabase calls are needed for verification that
+  // the session URI and the database for this session is valid, even though
+  // they are not used after that.
+  absl::string_view project_id, instance_id, database_id, session_id;
+  ZETASQL_RETURN_IF_ERROR(ParseSessionUri(session_uri, &project_id, &instance_id,
+                                  &database_id, &session_id));
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::shared_ptr<Database> database,
+      GetDatabase(ctx, MakeDatabaseUri(MakeInstanceUri(project_id, instance_id),
+                                       database_id)));
+  return ctx->env()->session_manager()->GetSession(session_uri);
+}
+
+}  // namespace
+
+std::optional<tracing::SpanContext> RequestContext::TraceContextFromMetadata(
+    const grpc::ServerContext* grpc) {
+  if (grpc == nullptr) {
+    return std::nullopt;
+  }
+  auto it = grpc->client_metadata().find("traceparent");
+  if (it == grpc->client_metadata().end()) {
+    return std::nullopt;
+  }
+  return tracing::SpanContext::FromTraceparent(
+      absl::string_view(it->second.data(), it->second.size()));
+}
+
 absl::StatusOr<std::shared_ptr<Instance>> GetInstance(
     RequestContext* ctx, const std::string& instance_uri) {
   absl::string_view project_id, instance_id;
@@ -51,17 +86,12 @@ absl::StatusOr<std::shared_ptr<Database>> GetDatabase(
 
 absl::StatusOr<std::shared_ptr<Session>> GetSession(
     RequestContext* ctx, const std::string& session_uri) {
-  // The ParseSessionUri and GetDatabase calls are needed for verification that
-  // the session URI and the database for this session is valid, even though
-  // they are not used after that.
-  absl::string_view project_id, instance_id, database_id, session_id;
-  ZETASQL_RETURN_IF_ERROR(ParseSessionUri(session_uri, &project_id, &instance_id,
-                                  &database_id, &session_id));
-  ZETASQL_ASSIGN_OR_RETURN(
-      std::shared_ptr<Database> database,
-      GetDatabase(ctx, MakeDatabaseUri(MakeInstanceUri(project_id, instance_id),
-                                       database_id)));
-  return ctx->env()->session_manager()->GetSession(session_uri);
+  tracing::ScopedSpan span("GetSession");
+  span.SetAttribute("session", session_uri);
+  absl::StatusOr<std::shared_ptr<Session>> session =
+      LookupSession(ctx, session_uri);
+  span.SetStatus(session.status());
+  return session;
 }
 
 }  // namespace frontend
@@ -17,8 +17,13 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_REQUEST_CONTEXT_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_REQUEST_CONTEXT_H_
 
+#include <optional>
+
+#include "google/protobuf/arena.h"
 #include "absl/status/statusor.h"
+#include "common/tracing.h"
 #include "frontend/server/environment.h"
+#include "frontend/server/resource_accounting.h"
 #include "grpcpp/server_context.h"
 
 namespace google {
@@ -30,18 +35,47 @@ namespace frontend {
 class RequestContext {
  public:
   RequestContext(ServerEnv* env, grpc::ServerContext* grpc)
-      : env_(env), grpc_(grpc) {}
+      : env_(env),
+        grpc_(grpc),
+        trace_context_(TraceContextFromMetadata(grpc)) {}
 
   // Accessors.
   ServerEnv* env() { return env_; }
   grpc::ServerContext* grpc() { return grpc_; }
 
+  // An arena for the messages which a handler builds while serving the
+  // request, which are all freed at once when the request completes. The
+  // request and response messages themselves are owned by gRPC.
+  google::protobuf::Arena* arena() { return &arena_; }
+
+  // The trace context sent by the client in its traceparent header, if any.
+  const std::optional<tracing::SpanContext>& trace_context() const {
+    return trace_context_;
+  }
+
+  // The counters of the resources used by the request, or nullptr if resource
+  // usage is not accounted.
+  RpcResourceCounters* resource_counters() { return resource_counters_; }
+  void set_resource_counters(RpcResourceCounters* counters) {
+    resource_counters_ = counters;
+  }
+
  private:
+  static std::optional<tracing::SpanContext> TraceContextFromMetadata(
+      const grpc::ServerContext* grpc);
+
   // Server environment shared by all requests.
   ServerEnv* env_;
 
   // gRPC context specific to a single request.
   grpc::ServerContext* grpc_;
+
+  std::optional<tracing::SpanContext> trace_context_;
+
+  RpcResourceCounters* resource_counters_ = nullptr;
+
+  // Does not allocate any memory until a message is created on it.
+  google::protobuf::Arena arena_;
 };
 
 // Checks if an instance exists. Returns the Instance entity or an error:
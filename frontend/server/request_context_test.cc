@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 
+#include "google/protobuf/arena.h"
 #include "google/spanner/admin/instance/v1/spanner_instance_admin.pb.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -117,6 +118,16 @@ TEST_F(SessionExistenceTest, WrongInstanceId) {
                   testing::MatchesRegex(".*Instance not found.*")));
 }
 
+TEST(RequestContextTest, CreatesMessagesOnItsArena) {
+  RequestContext ctx(/*env=*/nullptr, /*grpc=*/nullptr);
+  auto* instance =
+      google::protobuf::Arena::CreateMessage<instance_api::Instance>(
+          ctx.arena());
+  instance->set_display_name("test-instance");
+  EXPECT_EQ(instance->GetArena(), ctx.arena());
+  EXPECT_GT(ctx.arena()->SpaceUsed(), 0);
+}
+
 }  // namespace
 }  // namespace frontend
 }  // namespace emulator
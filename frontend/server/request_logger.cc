@@ -0,0 +1,149 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/request_logger.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/base/logging.h"
+#include "google/protobuf/message.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "common/config.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+RequestLogger::RequestLogger(const Options& options, Sink sink)
+    : options_(options), sink_(std::move(sink)) {
+  writer_thread_ = std::thread(&RequestLogger::WriterLoop, this);
+}
+
+RequestLogger::~RequestLogger() {
+  {
+    absl::MutexLock lock(&mu_);
+    stop_ = true;
+  }
+  writer_thread_.join();
+}
+
+RequestLogger* RequestLogger::Default() {
+  static RequestLogger* logger = new RequestLogger(
+      Options{.sampling_interval = config::log_requests_sampling_interval(),
+              .max_message_bytes = config::log_requests_max_bytes()});
+  return logger;
+}
+
+bool RequestLogger::ShouldLogRpc() {
+  if (options_.sampling_interval <= 1) {
+    return true;
+  }
+  return num_rpcs_.fetch_add(1) % options_.sampling_interval == 0;
+}
+
+void RequestLogger::Log(std::string header,
+                        const google::protobuf::Message* message,
+                        std::string trailer) {
+  Entry entry{.header = std::move(header), .trailer = std::move(trailer)};
+  if (message != nullptr) {
+    entry.prototype =
+        google::protobuf::MessageFactory::generated_factory()->GetPrototype(
+            message->GetDescriptor());
+    message->SerializeToString(&entry.serialized_message);
+  }
+  absl::MutexLock lock(&mu_);
+  if (static_cast<int>(queue_.size()) >= options_.max_queued_entries ||
+      queued_bytes_ + entry.size() > options_.max_queued_bytes) {
+    num_dropped_.fetch_add(1);
+    return;
+  }
+  queued_bytes_ += entry.size();
+  queue_.push_back(std::move(entry));
+}
+
+void RequestLogger::Flush() {
+  absl::MutexLock lock(&mu_);
+  auto written = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return queue_.empty() && num_writing_ == 0;
+  };
+  mu_.Await(absl::Condition(&written));
+}
+
+void RequestLogger::WriterLoop() {
+  absl::MutexLock lock(&mu_);
+  auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stop_ || !queue_.empty();
+  };
+  while (true) {
+    mu_.Await(absl::Condition(&has_work));
+    if (queue_.empty()) {
+      // Only stop once everything queued before the logger was destroyed has
+      // been written.
+      return;
+    }
+    std::deque<Entry> batch;
+    batch.swap(queue_);
+    queued_bytes_ = 0;
+    num_writing_ = batch.size();
+
+    mu_.Unlock();
+    for (const Entry& entry : batch) {
+      const std::string text = Render(entry);
+      if (sink_ != nullptr) {
+        sink_(text);
+      } else {
+        ZETASQL_LOG(INFO) << text;
+      }
+    }
+    mu_.Lock();
+
+    num_writing_ = 0;
+  }
+}
+
+std::string RequestLogger::Render(const Entry& entry) const {
+  std::string text = entry.header;
+  if (entry.prototype != nullptr) {
+    std::unique_ptr<google::protobuf::Message> message(entry.prototype->New());
+    std::string message_text;
+    if (message->ParseFromString(entry.serialized_message)) {
+      message_text = message->DebugString();
+    } else {
+      message_text = "<unparseable message>";
+    }
+    const int64_t full_size = message_text.size();
+    if (options_.max_message_bytes > 0 &&
+        full_size > options_.max_message_bytes) {
+      message_text.resize(options_.max_message_bytes);
+      absl::StrAppend(&message_text, "... <truncated ", full_size, " bytes>");
+    }
+    absl::StrAppend(&text, "\n", message_text);
+  }
+  if (!entry.trailer.empty()) {
+    absl::StrAppend(&text, "\n", entry.trailer);
+  }
+  return text;
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,126 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_REQUEST_LOGGER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_REQUEST_LOGGER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "google/protobuf/message.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// RequestLogger writes the requests and responses of sampled RPCs to the log
+// from a background thread.
+//
+// Rendering a proto as text is much more expensive than serializing it, so RPC
+// threads only serialize the message and queue it. The logger thread parses it
+// back and renders it, truncated to max_message_bytes. The queue is bounded;
+// entries which do not fit are dropped rather than slowing down the RPC.
+class RequestLogger {
+ public:
+  // Receives each rendered log entry.
+  using Sink = std::function<void(const std::string&)>;
+
+  struct Options {
+    // Log one in every sampling_interval RPCs.
+    int sampling_interval = 1;
+
+    // Truncate each rendered message to this many bytes. 0 does not truncate.
+    int64_t max_message_bytes = 64 * 1024;
+
+    // Bounds on the entries waiting to be logged.
+    int max_queued_entries = 1024;
+    int64_t max_queued_bytes = 64 * 1024 * 1024;
+  };
+
+  // Entries are written to sink, or to the INFO log if sink is null.
+  explicit RequestLogger(const Options& options, Sink sink = nullptr);
+  ~RequestLogger();
+
+  RequestLogger(const RequestLogger&) = delete;
+  RequestLogger& operator=(const RequestLogger&) = delete;
+
+  // Returns the logger used by the gRPC handlers, configured from flags.
+  static RequestLogger* Default();
+
+  // Returns true if the next RPC should be logged.
+  bool ShouldLogRpc();
+
+  // Queues an entry made of header, the text format of message (if non-null)
+  // and trailer, each separated by a newline. Never blocks on the logger
+  // thread.
+  void Log(std::string header, const google::protobuf::Message* message,
+           std::string trailer = "") ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Blocks until every entry queued so far has been written.
+  void Flush() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of entries dropped because the queue was full.
+  int64_t num_dropped() const { return num_dropped_.load(); }
+
+ private:
+  struct Entry {
+    std::string header;
+    // Default instance of the logged message type, or null for no message.
+    const google::protobuf::Message* prototype = nullptr;
+    std::string serialized_message;
+    std::string trailer;
+
+    size_t size() const {
+      return header.size() + serialized_message.size() + trailer.size();
+    }
+  };
+
+  void WriterLoop() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Renders entry as text.
+  std::string Render(const Entry& entry) const;
+
+  const Options options_;
+  const Sink sink_;
+
+  std::atomic<int64_t> num_rpcs_ = 0;
+  std::atomic<int64_t> num_dropped_ = 0;
+
+  absl::Mutex mu_;
+  std::deque<Entry> queue_ ABSL_GUARDED_BY(mu_);
+  int64_t queued_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // Number of entries taken off the queue but not yet written.
+  int num_writing_ ABSL_GUARDED_BY(mu_) = 0;
+  bool stop_ ABSL_GUARDED_BY(mu_) = false;
+
+  std::thread writer_thread_;
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_REQUEST_LOGGER_H_
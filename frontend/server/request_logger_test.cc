@@ -0,0 +1,112 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/request_logger.h"
+
+#include <string>
+#include <vector>
+
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+class RequestLoggerTest : public testing::Test {
+ protected:
+  RequestLogger::Sink sink() {
+    return [this](const std::string& text) {
+      absl::MutexLock lock(&mu_);
+      logged_.push_back(text);
+    };
+  }
+
+  std::vector<std::string> logged() {
+    absl::MutexLock lock(&mu_);
+    return logged_;
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<std::string> logged_;
+};
+
+TEST_F(RequestLoggerTest, RendersMessagesInTheBackground) {
+  RequestLogger logger(RequestLogger::Options{}, sink());
+  google::spanner::v1::GetSessionRequest request;
+  request.set_name("projects/p/instances/i/databases/d/sessions/s");
+  logger.Log("Request[Spanner.GetSession]", &request);
+  logger.Log("Response[Spanner.GetSession]", nullptr, "OK");
+  logger.Flush();
+  EXPECT_THAT(logged(),
+              ElementsAre("Request[Spanner.GetSession]\n"
+                          "name: \"projects/p/instances/i/databases/d/"
+                          "sessions/s\"\n",
+                          "Response[Spanner.GetSession]\nOK"));
+}
+
+TEST_F(RequestLoggerTest, TruncatesLargeMessages) {
+  RequestLogger logger(RequestLogger::Options{.max_message_bytes = 16},
+                       sink());
+  google::spanner::v1::GetSessionRequest request;
+  request.set_name(std::string(1000, 'x'));
+  logger.Log("Request[Spanner.GetSession]", &request);
+  logger.Flush();
+  ASSERT_EQ(logged().size(), 1);
+  EXPECT_THAT(logged()[0], HasSubstr("... <truncated 1009 bytes>"));
+  EXPECT_LT(logged()[0].size(), 100);
+}
+
+TEST_F(RequestLoggerTest, SamplesRpcs) {
+  RequestLogger logger(RequestLogger::Options{.sampling_interval = 3}, sink());
+  std::vector<bool> sampled;
+  for (int i = 0; i < 6; ++i) {
+    sampled.push_back(logger.ShouldLogRpc());
+  }
+  EXPECT_THAT(sampled, ElementsAre(true, false, false, true, false, false));
+}
+
+TEST_F(RequestLoggerTest, DropsEntriesWhenQueueIsFull) {
+  absl::Notification release_writer;
+  RequestLogger logger(RequestLogger::Options{.max_queued_entries = 1},
+                       [&](const std::string&) {
+                         release_writer.WaitForNotification();
+                       });
+  // The first entry may be taken by the writer, which then blocks in the sink.
+  for (int i = 0; i < 10; ++i) {
+    logger.Log("entry", nullptr);
+  }
+  release_writer.Notify();
+  logger.Flush();
+  EXPECT_GE(logger.num_dropped(), 8);
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,221 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/resource_accounting.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "common/metrics.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+std::atomic<ResourceAccountant*> default_accountant = nullptr;
+
+// Appends a gauge sample of each resource in usage, labelled with scope and
+// name.
+void AppendSamples(absl::string_view scope, const std::string& name,
+                   const ResourceUsage& usage,
+                   std::vector<metrics::GaugeSample>* samples) {
+  auto add = [&](const char* resource, double value) {
+    samples->push_back({{std::string(scope), name, resource}, value});
+  };
+  add("rpcs", usage.rpcs);
+  add("cpu_seconds", absl::ToDoubleSeconds(usage.cpu_time));
+  add("request_bytes", usage.request_bytes);
+  add("response_bytes", usage.response_bytes);
+  add("rows_scanned", usage.rows_scanned);
+  add("rows_returned", usage.rows_returned);
+  add("mutations", usage.mutations);
+  add("lock_hold_seconds", absl::ToDoubleSeconds(usage.lock_hold_time));
+}
+
+// Returns usage as a JSON object, with key set to name.
+std::string UsageJson(absl::string_view key, absl::string_view name,
+                      const ResourceUsage& usage) {
+  return absl::StrCat(
+      "{\"", key, "\":\"", name, "\",\"rpcs\":", usage.rpcs,
+      ",\"cpu_seconds\":", absl::ToDoubleSeconds(usage.cpu_time),
+      ",\"request_bytes\":", usage.request_bytes,
+      ",\"response_bytes\":", usage.response_bytes,
+      ",\"rows_scanned\":", usage.rows_scanned,
+      ",\"rows_returned\":", usage.rows_returned,
+      ",\"mutations\":", usage.mutations, ",\"lock_hold_seconds\":",
+      absl::ToDoubleSeconds(usage.lock_hold_time), "}");
+}
+
+}  // namespace
+
+void ResourceUsage::Add(const ResourceUsage& other) {
+  rpcs += other.rpcs;
+  cpu_time += other.cpu_time;
+  request_bytes += other.request_bytes;
+  response_bytes += other.response_bytes;
+  rows_scanned += other.rows_scanned;
+  rows_returned += other.rows_returned;
+  mutations += other.mutations;
+  lock_hold_time += other.lock_hold_time;
+}
+
+void RpcResourceCounters::AddTo(ResourceUsage* usage) const {
+  usage->rows_scanned += rows_scanned_.load(std::memory_order_relaxed);
+  usage->rows_returned += rows_returned_.load(std::memory_order_relaxed);
+  usage->mutations += mutations_.load(std::memory_order_relaxed);
+  usage->lock_hold_time +=
+      absl::Nanoseconds(lock_hold_nanos_.load(std::memory_order_relaxed));
+}
+
+ResourceAccountant* ResourceAccountant::Default() {
+  return default_accountant.load(std::memory_order_acquire);
+}
+
+void ResourceAccountant::SetDefault(
+    std::unique_ptr<ResourceAccountant> accountant) {
+  default_accountant.store(accountant.release(), std::memory_order_release);
+}
+
+std::string ResourceAccountant::SessionUriOf(
+    const google::protobuf::Message& request) {
+  const google::protobuf::FieldDescriptor* field =
+      request.GetDescriptor()->FindFieldByName("session");
+  if (field == nullptr || field->is_repeated() ||
+      field->type() != google::protobuf::FieldDescriptor::TYPE_STRING) {
+    return "";
+  }
+  std::string session_uri = request.GetReflection()->GetString(request, field);
+  if (!absl::StrContains(session_uri, "/sessions/")) {
+    return "";
+  }
+  return session_uri;
+}
+
+ResourceAccountant::ResourceAccountant(const Options& options)
+    : options_(options) {
+  gauge_id_ = metrics::RegisterGaugeCallback(
+      "emulator_resource_usage", {"scope", "name", "resource"}, [this]() {
+        absl::MutexLock lock(&mu_);
+        std::vector<metrics::GaugeSample> samples;
+        // Sessions are too many and short-lived to export as time series.
+        for (const auto& [database_uri, usage] : databases_) {
+          AppendSamples("database", database_uri, usage, &samples);
+        }
+        for (const auto& [caller, usage] : callers_) {
+          AppendSamples("caller", caller, usage, &samples);
+        }
+        return samples;
+      });
+}
+
+ResourceAccountant::~ResourceAccountant() {
+  metrics::UnregisterGaugeCallback(gauge_id_);
+}
+
+void ResourceAccountant::Record(absl::string_view database_uri,
+                                absl::string_view session_uri,
+                                absl::string_view caller,
+                                const ResourceUsage& usage) {
+  absl::MutexLock lock(&mu_);
+  if (!database_uri.empty()) {
+    databases_[database_uri].Add(usage);
+  }
+  if (!caller.empty()) {
+    callers_[caller].Add(usage);
+  }
+  if (session_uri.empty() || options_.max_sessions <= 0) {
+    return;
+  }
+  auto [it, inserted] = sessions_.try_emplace(session_uri);
+  SessionUsage& session = it->second;
+  if (inserted) {
+    sessions_by_activity_.emplace_front(session_uri);
+    session.activity = sessions_by_activity_.begin();
+  } else {
+    sessions_by_activity_.splice(sessions_by_activity_.begin(),
+                                 sessions_by_activity_, session.activity);
+  }
+  session.usage.Add(usage);
+  while (sessions_.size() > static_cast<size_t>(options_.max_sessions)) {
+    sessions_.erase(sessions_by_activity_.back());
+    sessions_by_activity_.pop_back();
+  }
+}
+
+ResourceUsage ResourceAccountant::UsageOf(Scope scope,
+                                          absl::string_view name) const {
+  absl::MutexLock lock(&mu_);
+  switch (scope) {
+    case Scope::kDatabase:
+      if (auto it = databases_.find(name); it != databases_.end()) {
+        return it->second;
+      }
+      break;
+    case Scope::kSession:
+      if (auto it = sessions_.find(name); it != sessions_.end()) {
+        return it->second.usage;
+      }
+      break;
+    case Scope::kCaller:
+      if (auto it = callers_.find(name); it != callers_.end()) {
+        return it->second;
+      }
+      break;
+  }
+  return ResourceUsage();
+}
+
+std::string ResourceAccountant::ExportJson() const {
+  absl::MutexLock lock(&mu_);
+  std::vector<std::string> databases;
+  for (const auto& [database_uri, usage] : databases_) {
+    databases.push_back(UsageJson("database", database_uri, usage));
+  }
+  std::vector<std::string> sessions;
+  for (const std::string& session_uri : sessions_by_activity_) {
+    sessions.push_back(
+        UsageJson("session", session_uri, sessions_.at(session_uri).usage));
+  }
+  std::vector<std::string> callers;
+  for (const auto& [caller, usage] : callers_) {
+    callers.push_back(UsageJson("caller", caller, usage));
+  }
+  return absl::StrCat("{\"databases\":[", absl::StrJoin(databases, ","),
+                      "],\"sessions\":[", absl::StrJoin(sessions, ","),
+                      "],\"callers\":[", absl::StrJoin(callers, ","), "]}");
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,179 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RESOURCE_ACCOUNTING_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RESOURCE_ACCOUNTING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "google/protobuf/message.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// The resources used by one or more RPCs.
+struct ResourceUsage {
+  int64_t rpcs = 0;
+
+  // CPU time of the threads which ran the handlers of the RPCs.
+  absl::Duration cpu_time;
+
+  // Serialized sizes of the requests received and responses sent.
+  int64_t request_bytes = 0;
+  int64_t response_bytes = 0;
+
+  // Rows read and returned by reads and queries, and mutations committed.
+  int64_t rows_scanned = 0;
+  int64_t rows_returned = 0;
+  int64_t mutations = 0;
+
+  // Time from the start to the commit of the committed read-write transaction
+  // attempts, during which they held their locks.
+  absl::Duration lock_hold_time;
+
+  void Add(const ResourceUsage& other);
+};
+
+// The resources used by a running RPC which only its handler sees, such as
+// the rows it scans. The handler, and threads working for it, add to the
+// counters as the RPC runs.
+class RpcResourceCounters {
+ public:
+  void AddRowsScanned(int64_t rows) {
+    rows_scanned_.fetch_add(rows, std::memory_order_relaxed);
+  }
+  void AddRowsReturned(int64_t rows) {
+    rows_returned_.fetch_add(rows, std::memory_order_relaxed);
+  }
+  void AddMutations(int64_t mutations) {
+    mutations_.fetch_add(mutations, std::memory_order_relaxed);
+  }
+  void AddLockHoldTime(absl::Duration duration) {
+    lock_hold_nanos_.fetch_add(absl::ToInt64Nanoseconds(duration),
+                               std::memory_order_relaxed);
+  }
+
+  // The counters of rows scanned and returned, for backend::Query.
+  std::atomic<int64_t>* rows_scanned() { return &rows_scanned_; }
+  std::atomic<int64_t>* rows_returned() { return &rows_returned_; }
+
+  // Adds the counters to usage.
+  void AddTo(ResourceUsage* usage) const;
+
+ private:
+  std::atomic<int64_t> rows_scanned_ = 0;
+  std::atomic<int64_t> rows_returned_ = 0;
+  std::atomic<int64_t> mutations_ = 0;
+  std::atomic<int64_t> lock_hold_nanos_ = 0;
+};
+
+// ResourceAccountant sums the resources used by RPCs per database, per session
+// and per caller, the latter named by a label of the session of the RPC, so
+// that the clients sharing an emulator can see which of them loads it.
+//
+// Only the Options::max_sessions most recently active sessions are kept, as
+// sessions come and go for the lifetime of the emulator. The usage of
+// databases and callers is kept for as long as the emulator runs.
+//
+// This class is thread-safe.
+class ResourceAccountant {
+ public:
+  struct Options {
+    // The key of the session label naming the caller. Empty accounts no
+    // callers.
+    std::string caller_label;
+
+    // The most sessions whose usage is kept.
+    int max_sessions = 10000;
+  };
+
+  // What the usage of an RPC is accounted to.
+  enum class Scope { kDatabase, kSession, kCaller };
+
+  // Returns the accountant used by the gRPC handlers, or nullptr if resource
+  // usage is not accounted.
+  static ResourceAccountant* Default();
+
+  // Makes accountant the one returned by Default. Must be called at most once,
+  // before the server starts.
+  static void SetDefault(std::unique_ptr<ResourceAccountant> accountant);
+
+  // Returns the session an RPC of request runs in, or an empty string if it
+  // runs in none.
+  static std::string SessionUriOf(const google::protobuf::Message& request);
+
+  explicit ResourceAccountant(const Options& options);
+  ~ResourceAccountant();
+
+  const std::string& caller_label() const { return options_.caller_label; }
+
+  // Accounts usage to each of database_uri, session_uri and caller which is
+  // not empty.
+  void Record(absl::string_view database_uri, absl::string_view session_uri,
+              absl::string_view caller, const ResourceUsage& usage)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the usage accounted to the database, session or caller name.
+  ResourceUsage UsageOf(Scope scope, absl::string_view name) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the usage as a JSON object with a "databases", "sessions" and
+  // "callers" array of the usage of each.
+  std::string ExportJson() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct SessionUsage {
+    ResourceUsage usage;
+    // The position of the session in sessions_by_activity_.
+    std::list<std::string>::iterator activity;
+  };
+
+  ResourceAccountant(const ResourceAccountant&) = delete;
+  ResourceAccountant& operator=(const ResourceAccountant&) = delete;
+
+  const Options options_;
+
+  int64_t gauge_id_ = -1;
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<std::string, ResourceUsage> databases_
+      ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, ResourceUsage> callers_
+      ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, SessionUsage> sessions_
+      ABSL_GUARDED_BY(mu_);
+
+  // The sessions, most recently active first.
+  std::list<std::string> sessions_by_activity_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RESOURCE_ACCOUNTING_H_
@@ -0,0 +1,122 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/resource_accounting.h"
+
+#include <cstdint>
+#include <string>
+
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace spanner_api = ::google::spanner::v1;
+
+using ::testing::HasSubstr;
+using Scope = ResourceAccountant::Scope;
+
+constexpr char kDatabase[] = "projects/p/instances/i/databases/d";
+
+ResourceUsage OneRpc(int64_t request_bytes) {
+  ResourceUsage usage;
+  usage.rpcs = 1;
+  usage.cpu_time = absl::Milliseconds(2);
+  usage.request_bytes = request_bytes;
+  usage.rows_scanned = 10;
+  return usage;
+}
+
+TEST(ResourceAccountantTest, FindsSessionOfRequest) {
+  spanner_api::ExecuteSqlRequest request;
+  request.set_session(absl::StrCat(kDatabase, "/sessions/s"));
+  EXPECT_EQ(ResourceAccountant::SessionUriOf(request),
+            absl::StrCat(kDatabase, "/sessions/s"));
+  EXPECT_EQ(ResourceAccountant::SessionUriOf(
+                spanner_api::CreateSessionRequest()),
+            "");
+}
+
+TEST(ResourceAccountantTest, AccountsUsagePerDatabaseSessionAndCaller) {
+  ResourceAccountant accountant(
+      ResourceAccountant::Options{.caller_label = "caller"});
+  const std::string session_a = absl::StrCat(kDatabase, "/sessions/a");
+  const std::string session_b = absl::StrCat(kDatabase, "/sessions/b");
+  accountant.Record(kDatabase, session_a, "batch", OneRpc(100));
+  accountant.Record(kDatabase, session_a, "batch", OneRpc(100));
+  accountant.Record(kDatabase, session_b, "", OneRpc(50));
+
+  ResourceUsage database = accountant.UsageOf(Scope::kDatabase, kDatabase);
+  EXPECT_EQ(database.rpcs, 3);
+  EXPECT_EQ(database.request_bytes, 250);
+  EXPECT_EQ(database.rows_scanned, 30);
+  EXPECT_EQ(database.cpu_time, absl::Milliseconds(6));
+  EXPECT_EQ(accountant.UsageOf(Scope::kSession, session_a).rpcs, 2);
+  EXPECT_EQ(accountant.UsageOf(Scope::kSession, session_b).rpcs, 1);
+  EXPECT_EQ(accountant.UsageOf(Scope::kCaller, "batch").request_bytes, 200);
+
+  EXPECT_THAT(accountant.ExportJson(),
+              HasSubstr("{\"caller\":\"batch\",\"rpcs\":2,"));
+}
+
+TEST(ResourceAccountantTest, KeepsMostRecentlyActiveSessions) {
+  ResourceAccountant accountant(
+      ResourceAccountant::Options{.max_sessions = 2});
+  const std::string session_a = absl::StrCat(kDatabase, "/sessions/a");
+  const std::string session_b = absl::StrCat(kDatabase, "/sessions/b");
+  const std::string session_c = absl::StrCat(kDatabase, "/sessions/c");
+  accountant.Record(kDatabase, session_a, "", OneRpc(1));
+  accountant.Record(kDatabase, session_b, "", OneRpc(1));
+  accountant.Record(kDatabase, session_a, "", OneRpc(1));
+  accountant.Record(kDatabase, session_c, "", OneRpc(1));
+
+  EXPECT_EQ(accountant.UsageOf(Scope::kSession, session_a).rpcs, 2);
+  EXPECT_EQ(accountant.UsageOf(Scope::kSession, session_b).rpcs, 0);
+  EXPECT_EQ(accountant.UsageOf(Scope::kSession, session_c).rpcs, 1);
+  // Evicted sessions still count towards their database.
+  EXPECT_EQ(accountant.UsageOf(Scope::kDatabase, kDatabase).rpcs, 4);
+}
+
+TEST(ResourceAccountantTest, CountersAddToUsage) {
+  RpcResourceCounters counters;
+  counters.AddRowsScanned(3);
+  counters.rows_scanned()->fetch_add(2);
+  counters.AddRowsReturned(1);
+  counters.AddMutations(4);
+  counters.AddLockHoldTime(absl::Milliseconds(7));
+
+  ResourceUsage usage;
+  counters.AddTo(&usage);
+  EXPECT_EQ(usage.rows_scanned, 5);
+  EXPECT_EQ(usage.rows_returned, 1);
+  EXPECT_EQ(usage.mutations, 4);
+  EXPECT_EQ(usage.lock_hold_time, absl::Milliseconds(7));
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
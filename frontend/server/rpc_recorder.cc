@@ -0,0 +1,151 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/rpc_recorder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/base/logging.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "common/errors.h"
+#include "frontend/proto/rpc_trace.pb.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+constexpr int kLengthSize = 4;
+
+std::atomic<RpcRecorder*> default_recorder = nullptr;
+
+// Returns entry prefixed with its serialized size.
+std::string FrameEntry(const RpcTraceEntry& entry) {
+  const std::string payload = entry.SerializeAsString();
+  const uint32_t length = payload.size();
+  std::string framed(kLengthSize, '\0');
+  for (int i = 0; i < kLengthSize; ++i) {
+    framed[i] = static_cast<char>((length >> (8 * i)) & 0xff);
+  }
+  framed.append(payload);
+  return framed;
+}
+
+absl::Status IoError(absl::string_view operation, absl::string_view path) {
+  return error::Internal(absl::StrCat("Failed to ", operation, " RPC trace ",
+                                      path, ": ", std::strerror(errno)));
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<RpcRecorder>> RpcRecorder::Open(
+    const std::string& path) {
+  const int fd =
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0) {
+    return IoError("open", path);
+  }
+  return absl::WrapUnique(new RpcRecorder(path, fd));
+}
+
+RpcRecorder* RpcRecorder::Default() {
+  return default_recorder.load(std::memory_order_acquire);
+}
+
+void RpcRecorder::SetDefault(std::unique_ptr<RpcRecorder> recorder) {
+  default_recorder.store(recorder.release(), std::memory_order_release);
+}
+
+absl::Status RpcRecorder::ReadTrace(
+    const std::string& path,
+    const std::function<absl::Status(const RpcTraceEntry&)>& fn) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return IoError("read", path);
+  }
+  std::string payload;
+  RpcTraceEntry entry;
+  while (true) {
+    unsigned char length_bytes[kLengthSize];
+    if (!in.read(reinterpret_cast<char*>(length_bytes), kLengthSize)) {
+      break;
+    }
+    uint32_t length = 0;
+    for (int i = 0; i < kLengthSize; ++i) {
+      length |= static_cast<uint32_t>(length_bytes[i]) << (8 * i);
+    }
+    payload.resize(length);
+    if (!in.read(payload.data(), length) || !entry.ParseFromString(payload)) {
+      break;
+    }
+    ZETASQL_RETURN_IF_ERROR(fn(entry));
+  }
+  return absl::OkStatus();
+}
+
+RpcRecorder::RpcRecorder(std::string path, int fd)
+    : path_(std::move(path)), fd_(fd) {}
+
+RpcRecorder::~RpcRecorder() {
+  absl::MutexLock lock(&mu_);
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+void RpcRecorder::Record(const RpcTraceEntry& entry) {
+  const std::string data = FrameEntry(entry);
+  absl::MutexLock lock(&mu_);
+  absl::string_view remaining = data;
+  while (fd_ >= 0 && !remaining.empty()) {
+    const ssize_t written = ::write(fd_, remaining.data(), remaining.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ZETASQL_LOG(ERROR) << IoError("write", path_)
+                 << "; RPCs are no longer recorded.";
+      ::close(fd_);
+      fd_ = -1;
+      return;
+    }
+    remaining.remove_prefix(written);
+  }
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,90 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RPC_RECORDER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RPC_RECORDER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "frontend/proto/rpc_trace.pb.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// RpcRecorder appends the RPCs handled by the emulator to an RPC trace file,
+// for replaying with RpcReplayer. Each entry is stored as its serialized size,
+// a 32-bit little endian integer, followed by the serialized RpcTraceEntry.
+//
+// Entries are written as RPCs finish, so they are ordered by their end time
+// rather than their start time. Recording is meant for capturing a workload,
+// not for production use: every RPC pays for serializing its request and
+// response and for a write to the file.
+//
+// This class is thread-safe.
+class RpcRecorder {
+ public:
+  // Opens the trace file at path, replacing it if it exists.
+  static absl::StatusOr<std::unique_ptr<RpcRecorder>> Open(
+      const std::string& path);
+
+  // Returns the recorder used by the gRPC handlers, or nullptr if RPCs are not
+  // recorded.
+  static RpcRecorder* Default();
+
+  // Makes recorder the one returned by Default. Must be called at most once,
+  // before the server starts.
+  static void SetDefault(std::unique_ptr<RpcRecorder> recorder);
+
+  // Calls fn with each complete entry of the trace file at path, in the order
+  // they were recorded, stopping at the first error returned by fn. An entry
+  // cut short at the end of the file is ignored.
+  static absl::Status ReadTrace(
+      const std::string& path,
+      const std::function<absl::Status(const RpcTraceEntry&)>& fn);
+
+  ~RpcRecorder();
+
+  // Appends entry to the trace. Once a write fails, the error is logged and
+  // no further entries are recorded.
+  void Record(const RpcTraceEntry& entry) ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  RpcRecorder(std::string path, int fd);
+  RpcRecorder(const RpcRecorder&) = delete;
+  RpcRecorder& operator=(const RpcRecorder&) = delete;
+
+  const std::string path_;
+
+  absl::Mutex mu_;
+
+  // File descriptor of the trace file, or -1 after a write failed.
+  int fd_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RPC_RECORDER_H_
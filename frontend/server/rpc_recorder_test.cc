@@ -0,0 +1,112 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/rpc_recorder.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "frontend/proto/rpc_trace.pb.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+using ::google::spanner::emulator::test::EqualsProto;
+using ::testing::ElementsAre;
+
+RpcTraceEntry Entry(const std::string& method, int64_t start_time_micros) {
+  RpcTraceEntry entry;
+  entry.set_service("Spanner");
+  entry.set_method(method);
+  entry.set_start_time_micros(start_time_micros);
+  entry.set_request_type("google.spanner.v1.GetSessionRequest");
+  entry.set_request("serialized request");
+  return entry;
+}
+
+std::vector<RpcTraceEntry> ReadEntries(const std::string& path) {
+  std::vector<RpcTraceEntry> entries;
+  ZETASQL_EXPECT_OK(
+      RpcRecorder::ReadTrace(path, [&](const RpcTraceEntry& entry) {
+        entries.push_back(entry);
+        return absl::OkStatus();
+      }));
+  return entries;
+}
+
+TEST(RpcRecorderTest, ReadsBackRecordedEntries) {
+  const std::string path = absl::StrCat(testing::TempDir(), "/rpc_trace");
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RpcRecorder> recorder,
+                         RpcRecorder::Open(path));
+    recorder->Record(Entry("GetSession", 1));
+    recorder->Record(Entry("Commit", 2));
+  }
+  EXPECT_THAT(ReadEntries(path),
+              ElementsAre(EqualsProto(Entry("GetSession", 1)),
+                          EqualsProto(Entry("Commit", 2))));
+}
+
+TEST(RpcRecorderTest, ReplacesExistingTraces) {
+  const std::string path = absl::StrCat(testing::TempDir(), "/replaced_trace");
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RpcRecorder> recorder,
+                         RpcRecorder::Open(path));
+    recorder->Record(Entry("GetSession", 1));
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RpcRecorder> recorder,
+                       RpcRecorder::Open(path));
+  recorder->Record(Entry("Commit", 2));
+  EXPECT_THAT(ReadEntries(path), ElementsAre(EqualsProto(Entry("Commit", 2))));
+}
+
+TEST(RpcRecorderTest, IgnoresTruncatedEntries) {
+  const std::string path = absl::StrCat(testing::TempDir(), "/truncated_trace");
+  {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<RpcRecorder> recorder,
+                         RpcRecorder::Open(path));
+    recorder->Record(Entry("GetSession", 1));
+  }
+  std::ofstream(path, std::ios::binary | std::ios::app) << "\x10\0\0\0abc";
+  EXPECT_THAT(ReadEntries(path),
+              ElementsAre(EqualsProto(Entry("GetSession", 1))));
+}
+
+TEST(RpcRecorderTest, FailsToReadMissingTraces) {
+  EXPECT_FALSE(RpcRecorder::ReadTrace(
+                   absl::StrCat(testing::TempDir(), "/missing_trace"),
+                   [](const RpcTraceEntry&) { return absl::OkStatus(); })
+                   .ok());
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
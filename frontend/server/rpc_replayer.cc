@@ -0,0 +1,412 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/rpc_replayer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "frontend/proto/rpc_trace.pb.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/completion_queue.h"
+#include "grpcpp/generic/generic_stub.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "grpcpp/support/slice.h"
+#include "grpcpp/support/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+using ::google::protobuf::Descriptor;
+using ::google::protobuf::DescriptorPool;
+using ::google::protobuf::FieldDescriptor;
+using ::google::protobuf::Message;
+using ::google::protobuf::MessageFactory;
+using ::google::protobuf::Reflection;
+
+// Returns the full name of a service handled by the emulator, or an empty
+// string if it is not one.
+absl::string_view FullServiceName(absl::string_view service) {
+  static const auto* const kServices =
+      new absl::flat_hash_map<absl::string_view, absl::string_view>({
+          {"Spanner", "google.spanner.v1.Spanner"},
+          {"DatabaseAdmin", "google.spanner.admin.database.v1.DatabaseAdmin"},
+          {"EmulatorAdmin", "google.spanner.emulator.frontend.EmulatorAdmin"},
+          {"InstanceAdmin", "google.spanner.admin.instance.v1.InstanceAdmin"},
+          {"Operations", "google.longrunning.Operations"},
+      });
+  auto it = kServices->find(service);
+  return it != kServices->end() ? it->second : "";
+}
+
+// Returns true if field holds a name or id assigned by the emulator, which
+// differs between the trace and the replay.
+bool IsAssignedName(const FieldDescriptor* field) {
+  static const auto* const kFields = new absl::flat_hash_set<absl::string_view>(
+      {"google.spanner.v1.Session.name", "google.spanner.v1.Transaction.id",
+       "google.longrunning.Operation.name"});
+  return kFields->contains(field->full_name());
+}
+
+// Returns a new message of the given type, parsed from serialized, or nullptr
+// if the type is not linked into the binary or serialized does not parse.
+std::unique_ptr<Message> ParseMessage(const std::string& type,
+                                      const std::string& serialized) {
+  const Descriptor* descriptor =
+      DescriptorPool::generated_pool()->FindMessageTypeByName(type);
+  if (descriptor == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<Message> message = absl::WrapUnique(
+      MessageFactory::generated_factory()->GetPrototype(descriptor)->New());
+  if (!message->ParseFromString(serialized)) {
+    return nullptr;
+  }
+  return message;
+}
+
+grpc::ByteBuffer ToByteBuffer(const Message& message) {
+  grpc::Slice slice(message.SerializeAsString());
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+std::string FromByteBuffer(const grpc::ByteBuffer& buffer) {
+  std::vector<grpc::Slice> slices;
+  std::string out;
+  if (buffer.Dump(&slices).ok()) {
+    for (const grpc::Slice& slice : slices) {
+      out.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+    }
+  }
+  return out;
+}
+
+// Waits for the next event of cq, returning whether it succeeded. The calls
+// of the replayer have a single operation in flight at a time.
+bool Await(grpc::CompletionQueue* cq) {
+  void* tag;
+  bool ok = false;
+  return cq->Next(&tag, &ok) && ok;
+}
+
+// Sends a unary request to method and sets response to the serialized reply.
+grpc::Status CallUnary(grpc::GenericStub* stub, const std::string& method,
+                       const grpc::ByteBuffer& request, std::string* response) {
+  grpc::ClientContext context;
+  grpc::CompletionQueue cq;
+  std::unique_ptr<grpc::GenericClientAsyncResponseReader> call =
+      stub->PrepareUnaryCall(&context, method, request, &cq);
+  call->StartCall();
+  grpc::ByteBuffer reply;
+  grpc::Status status;
+  call->Finish(&reply, &status, nullptr);
+  Await(&cq);
+  cq.Shutdown();
+  while (Await(&cq)) {
+  }
+  if (status.ok()) {
+    *response = FromByteBuffer(reply);
+  }
+  return status;
+}
+
+// Sends a request to the server streaming method, reads all of its responses,
+// and sets first_response to the first one.
+grpc::Status CallServerStreaming(grpc::GenericStub* stub,
+                                 const std::string& method,
+                                 const grpc::ByteBuffer& request,
+                                 std::string* first_response) {
+  grpc::ClientContext context;
+  grpc::CompletionQueue cq;
+  std::unique_ptr<grpc::GenericClientAsyncReaderWriter> call =
+      stub->PrepareCall(&context, method, &cq);
+  call->StartCall(nullptr);
+  if (Await(&cq)) {
+    call->WriteLast(request, grpc::WriteOptions(), nullptr);
+    if (Await(&cq)) {
+      grpc::ByteBuffer reply;
+      for (bool first = true;; first = false) {
+        call->Read(&reply, nullptr);
+        if (!Await(&cq)) {
+          break;
+        }
+        if (first) {
+          *first_response = FromByteBuffer(reply);
+        }
+      }
+    }
+  }
+  grpc::Status status;
+  call->Finish(&status, nullptr);
+  Await(&cq);
+  cq.Shutdown();
+  while (Await(&cq)) {
+  }
+  return status;
+}
+
+}  // namespace
+
+RpcReplayer::RpcReplayer(std::shared_ptr<grpc::Channel> channel,
+                         const Options& options)
+    : channel_(std::move(channel)), options_(options) {}
+
+RpcReplayer::Result RpcReplayer::Replay(std::vector<RpcTraceEntry> entries) {
+  entries.erase(
+      std::remove_if(entries.begin(), entries.end(),
+                     [](const RpcTraceEntry& entry) {
+                       return FullServiceName(entry.service()).empty() ||
+                              ParseMessage(entry.request_type(),
+                                           entry.request()) == nullptr;
+                     }),
+      entries.end());
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const RpcTraceEntry& a, const RpcTraceEntry& b) {
+                     return a.start_time_micros() < b.start_time_micros();
+                   });
+  Result result;
+  if (entries.empty()) {
+    return result;
+  }
+
+  // RPC i depends on the first num_dependencies[i] RPCs in end order, which
+  // finished before it started.
+  const int n = entries.size();
+  auto end_time = [&entries](int i) {
+    return entries[i].start_time_micros() + entries[i].duration_micros();
+  };
+  std::vector<int> end_order(n);
+  for (int i = 0; i < n; ++i) {
+    end_order[i] = i;
+  }
+  std::stable_sort(end_order.begin(), end_order.end(),
+                   [&](int a, int b) { return end_time(a) < end_time(b); });
+  std::vector<int64_t> sorted_end_times(n);
+  for (int i = 0; i < n; ++i) {
+    sorted_end_times[i] = end_time(end_order[i]);
+  }
+  std::vector<int> num_dependencies(n);
+  for (int i = 0; i < n; ++i) {
+    num_dependencies[i] =
+        std::upper_bound(sorted_end_times.begin(), sorted_end_times.end(),
+                         entries[i].start_time_micros()) -
+        sorted_end_times.begin();
+  }
+  const int64_t first_start = entries.front().start_time_micros();
+  result.recorded_elapsed =
+      absl::Microseconds(sorted_end_times.back() - first_start);
+
+  std::vector<MethodStats*> stats(n);
+  for (int i = 0; i < n; ++i) {
+    MethodStats& method_stats =
+        result.methods[absl::StrCat(entries[i].service(), ".",
+                                    entries[i].method())];
+    method_stats.recorded_latencies.push_back(
+        absl::Microseconds(entries[i].duration_micros()));
+    stats[i] = &method_stats;
+  }
+
+  // Workers take the RPCs in start order once they are due. As every RPC
+  // depends only on RPCs which started before it, the earliest unfinished RPC
+  // is always held by a worker whose dependencies have finished.
+  absl::Mutex mu;
+  int next = 0;
+  int num_done_in_end_order = 0;
+  std::vector<bool> done(n, false);
+  const absl::Time start = absl::Now();
+  auto due = [&](int i) {
+    if (options_.speedup <= 0) {
+      return start;
+    }
+    return start + absl::Microseconds(entries[i].start_time_micros() -
+                                      first_start) /
+                       options_.speedup;
+  };
+  auto worker = [&]() {
+    while (true) {
+      int i;
+      {
+        absl::MutexLock lock(&mu);
+        if (next == n) {
+          return;
+        }
+        i = next++;
+      }
+      absl::SleepFor(due(i) - absl::Now());
+      {
+        std::pair<const int*, int> dependencies(&num_done_in_end_order,
+                                                num_dependencies[i]);
+        absl::MutexLock lock(&mu);
+        mu.Await(absl::Condition(
+            +[](std::pair<const int*, int>* dependencies) {
+              return *dependencies->first >= dependencies->second;
+            },
+            &dependencies));
+      }
+      Send(entries[i], stats[i]);
+      absl::MutexLock lock(&mu);
+      done[i] = true;
+      while (num_done_in_end_order < n &&
+             done[end_order[num_done_in_end_order]]) {
+        ++num_done_in_end_order;
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int i = 0; i < std::max(options_.max_concurrent_rpcs, 1); ++i) {
+    workers.emplace_back(worker);
+  }
+  for (std::thread& thread : workers) {
+    thread.join();
+  }
+  result.replayed_elapsed = absl::Now() - start;
+  return result;
+}
+
+void RpcReplayer::Send(const RpcTraceEntry& entry, MethodStats* stats) {
+  std::unique_ptr<Message> request =
+      ParseMessage(entry.request_type(), entry.request());
+  RewriteRequest(request.get());
+  const std::string method =
+      absl::StrCat("/", FullServiceName(entry.service()), "/", entry.method());
+
+  grpc::GenericStub stub(channel_);
+  std::string response;
+  const absl::Time start = absl::Now();
+  const grpc::Status status =
+      entry.server_streaming()
+          ? CallServerStreaming(&stub, method, ToByteBuffer(*request),
+                                &response)
+          : CallUnary(&stub, method, ToByteBuffer(*request), &response);
+  const absl::Duration latency = absl::Now() - start;
+
+  if (!entry.response().empty() && !response.empty()) {
+    std::unique_ptr<Message> recorded =
+        ParseMessage(entry.response_type(), entry.response());
+    std::unique_ptr<Message> replayed =
+        ParseMessage(entry.response_type(), response);
+    if (recorded != nullptr && replayed != nullptr) {
+      LearnNames(*recorded, *replayed);
+    }
+  }
+  absl::MutexLock lock(&mu_);
+  stats->replayed_latencies.push_back(latency);
+  if (static_cast<int>(status.error_code()) != entry.status_code()) {
+    ++stats->status_mismatches;
+  }
+}
+
+void RpcReplayer::LearnNames(const Message& recorded, const Message& replayed) {
+  absl::MutexLock lock(&mu_);
+  LearnNamesLocked(recorded, replayed);
+}
+
+void RpcReplayer::LearnNamesLocked(const Message& recorded,
+                                   const Message& replayed) {
+  const Descriptor* descriptor = recorded.GetDescriptor();
+  const Reflection* recorded_reflection = recorded.GetReflection();
+  const Reflection* replayed_reflection = replayed.GetReflection();
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      if (field->is_repeated()) {
+        const int size =
+            std::min(recorded_reflection->FieldSize(recorded, field),
+                     replayed_reflection->FieldSize(replayed, field));
+        for (int j = 0; j < size; ++j) {
+          LearnNamesLocked(
+              recorded_reflection->GetRepeatedMessage(recorded, field, j),
+              replayed_reflection->GetRepeatedMessage(replayed, field, j));
+        }
+      } else if (recorded_reflection->HasField(recorded, field) &&
+                 replayed_reflection->HasField(replayed, field)) {
+        LearnNamesLocked(recorded_reflection->GetMessage(recorded, field),
+                         replayed_reflection->GetMessage(replayed, field));
+      }
+    } else if (!field->is_repeated() && IsAssignedName(field)) {
+      std::string recorded_name =
+          recorded_reflection->GetString(recorded, field);
+      std::string replayed_name =
+          replayed_reflection->GetString(replayed, field);
+      if (!recorded_name.empty() && !replayed_name.empty() &&
+          recorded_name != replayed_name) {
+        names_[std::move(recorded_name)] = std::move(replayed_name);
+      }
+    }
+  }
+}
+
+void RpcReplayer::RewriteRequest(Message* request) const {
+  absl::ReaderMutexLock lock(&mu_);
+  RewriteRequestLocked(request);
+}
+
+void RpcReplayer::RewriteRequestLocked(Message* request) const {
+  const Descriptor* descriptor = request->GetDescriptor();
+  const Reflection* reflection = request->GetReflection();
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      if (field->is_repeated()) {
+        for (int j = 0; j < reflection->FieldSize(*request, field); ++j) {
+          RewriteRequestLocked(
+              reflection->MutableRepeatedMessage(request, field, j));
+        }
+      } else if (reflection->HasField(*request, field)) {
+        RewriteRequestLocked(reflection->MutableMessage(request, field));
+      }
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+      if (field->is_repeated()) {
+        for (int j = 0; j < reflection->FieldSize(*request, field); ++j) {
+          auto it =
+              names_.find(reflection->GetRepeatedString(*request, field, j));
+          if (it != names_.end()) {
+            reflection->SetRepeatedString(request, field, j, it->second);
+          }
+        }
+      } else {
+        auto it = names_.find(reflection->GetString(*request, field));
+        if (it != names_.end()) {
+          reflection->SetString(request, field, it->second);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,127 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RPC_REPLAYER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RPC_REPLAYER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/message.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "frontend/proto/rpc_trace.pb.h"
+#include "grpcpp/channel.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// RpcReplayer re-drives the RPCs of a trace recorded by RpcRecorder against an
+// emulator, usually a fresh one, to turn a recorded workload into a benchmark.
+//
+// RPCs are sent in the order they started, with their original spacing divided
+// by Options::speedup. Each RPC waits for every RPC which had finished before
+// it started to finish in the replay as well, so the replay preserves the
+// dependencies between RPCs, such as a commit on the reads of its transaction,
+// however fast it runs. RPCs which overlapped in the trace may overlap in the
+// replay, up to Options::max_concurrent_rpcs at a time.
+//
+// Sessions, transactions and long running operations get new names and ids in
+// the replay. The replayer learns them by comparing the responses to the
+// recorded ones, and rewrites the requests which refer to them. Transactions
+// begun by the first response of a streaming read or query are learned from
+// that response, which the trace records.
+class RpcReplayer {
+ public:
+  struct Options {
+    // The replay sends RPCs this many times faster than they were recorded.
+    // 0 sends each RPC as soon as the RPCs it depends on have finished.
+    double speedup = 1;
+
+    // The most RPCs in flight at once.
+    int max_concurrent_rpcs = 64;
+  };
+
+  // The latencies of the RPCs of a method, as recorded and as replayed.
+  struct MethodStats {
+    std::vector<absl::Duration> recorded_latencies;
+    std::vector<absl::Duration> replayed_latencies;
+
+    // The number of RPCs which finished with a different status code than in
+    // the trace.
+    int64_t status_mismatches = 0;
+  };
+
+  struct Result {
+    // How long the RPCs of the trace took from the start of the first to the
+    // end of the last, as recorded and as replayed.
+    absl::Duration recorded_elapsed;
+    absl::Duration replayed_elapsed;
+
+    // Keyed by the name of the method, e.g. "Spanner.ExecuteSql".
+    std::map<std::string, MethodStats> methods;
+  };
+
+  RpcReplayer(std::shared_ptr<grpc::Channel> channel, const Options& options);
+
+  // Replays entries, which may be in any order, and returns once every RPC
+  // has finished. Entries of unknown methods or message types are skipped.
+  Result Replay(std::vector<RpcTraceEntry> entries) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Learns the names and ids of sessions, transactions and operations in
+  // replayed which replace those in recorded, a response of the same type.
+  void LearnNames(const google::protobuf::Message& recorded,
+                  const google::protobuf::Message& replayed)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Replaces the recorded names and ids learned so far in request by their
+  // replayed counterparts.
+  void RewriteRequest(google::protobuf::Message* request) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Sends the RPC of entry and waits for it to finish.
+  void Send(const RpcTraceEntry& entry, MethodStats* stats)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  void LearnNamesLocked(const google::protobuf::Message& recorded,
+                        const google::protobuf::Message& replayed)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void RewriteRequestLocked(google::protobuf::Message* request) const
+      ABSL_SHARED_LOCKS_REQUIRED(mu_);
+
+  const std::shared_ptr<grpc::Channel> channel_;
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+
+  // Recorded names and ids mapped to their replayed counterparts.
+  absl::flat_hash_map<std::string, std::string> names_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_RPC_REPLAYER_H_
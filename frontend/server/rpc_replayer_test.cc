@@ -0,0 +1,140 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/rpc_replayer.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "google/spanner/v1/result_set.pb.h"
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "frontend/proto/rpc_trace.pb.h"
+#include "frontend/server/server.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace spanner_api = ::google::spanner::v1;
+
+using ::google::spanner::emulator::test::EqualsProto;
+
+constexpr char kDatabase[] = "projects/p/instances/i/databases/d";
+
+TEST(RpcReplayerTest, RewritesLearnedSessionsAndTransactions) {
+  RpcReplayer replayer(nullptr, RpcReplayer::Options{});
+  spanner_api::Session recorded_session;
+  recorded_session.set_name(absl::StrCat(kDatabase, "/sessions/recorded"));
+  spanner_api::Session replayed_session;
+  replayed_session.set_name(absl::StrCat(kDatabase, "/sessions/replayed"));
+  replayer.LearnNames(recorded_session, replayed_session);
+
+  // Transactions begun by a query are learned from its result set metadata.
+  spanner_api::PartialResultSet recorded_results;
+  recorded_results.mutable_metadata()->mutable_transaction()->set_id("t1");
+  spanner_api::PartialResultSet replayed_results;
+  replayed_results.mutable_metadata()->mutable_transaction()->set_id("t2");
+  replayer.LearnNames(recorded_results, replayed_results);
+
+  spanner_api::CommitRequest request;
+  request.set_session(recorded_session.name());
+  request.set_transaction_id("t1");
+  replayer.RewriteRequest(&request);
+
+  spanner_api::CommitRequest expected;
+  expected.set_session(replayed_session.name());
+  expected.set_transaction_id("t2");
+  EXPECT_THAT(request, EqualsProto(expected));
+}
+
+TEST(RpcReplayerTest, LeavesOtherFieldsAlone) {
+  RpcReplayer replayer(nullptr, RpcReplayer::Options{});
+  spanner_api::ExecuteSqlRequest recorded_request;
+  recorded_request.set_session(absl::StrCat(kDatabase, "/sessions/s"));
+  recorded_request.set_sql("SELECT 1");
+  spanner_api::ExecuteSqlRequest replayed_request = recorded_request;
+  replayed_request.set_sql("SELECT 2");
+  // Only names and ids assigned by the emulator are learned.
+  replayer.LearnNames(recorded_request, replayed_request);
+
+  spanner_api::ExecuteSqlRequest request = recorded_request;
+  replayer.RewriteRequest(&request);
+  EXPECT_THAT(request, EqualsProto(recorded_request));
+}
+
+TEST(RpcReplayerTest, ReplaysTraceAgainstEmulator) {
+  Server::Options options;
+  options.server_address = "localhost:0";
+  std::unique_ptr<Server> server = Server::Create(options);
+  ASSERT_NE(server, nullptr);
+  std::thread server_thread([&server]() { server->WaitForShutdown(); });
+
+  // Creating a session fails as the database does not exist, which the first
+  // entry recorded and the second did not.
+  spanner_api::CreateSessionRequest request;
+  request.set_database(kDatabase);
+  std::vector<RpcTraceEntry> entries(2);
+  for (int i = 0; i < 2; ++i) {
+    entries[i].set_service("Spanner");
+    entries[i].set_method("CreateSession");
+    entries[i].set_start_time_micros(100 * i);
+    entries[i].set_duration_micros(50);
+    entries[i].set_request_type(request.GetDescriptor()->full_name());
+    entries[i].set_request(request.SerializeAsString());
+    entries[i].set_response_type("google.spanner.v1.Session");
+  }
+  entries[0].set_status_code(static_cast<int>(absl::StatusCode::kNotFound));
+  // Entries of methods which the emulator does not serve are skipped.
+  entries.push_back(entries[0]);
+  entries.back().set_service("Unknown");
+
+  RpcReplayer replayer(
+      grpc::CreateChannel(absl::StrCat(server->host(), ":", server->port()),
+                          grpc::InsecureChannelCredentials()),
+      RpcReplayer::Options{.speedup = 0});
+  RpcReplayer::Result result = replayer.Replay(entries);
+  EXPECT_EQ(result.recorded_elapsed, absl::Microseconds(150));
+  ASSERT_EQ(result.methods.size(), 1);
+  const RpcReplayer::MethodStats& stats =
+      result.methods["Spanner.CreateSession"];
+  EXPECT_EQ(stats.recorded_latencies.size(), 2);
+  EXPECT_EQ(stats.replayed_latencies.size(), 2);
+  EXPECT_EQ(stats.status_mismatches, 1);
+
+  server->Shutdown();
+  server_thread.join();
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -32,14 +32,22 @@
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.grpc.pb.h"
 #include "google/spanner/v1/transaction.pb.h"
+#include "absl/functional/function_ref.h"
 #include "absl/memory/memory.h"
 #include "common/constants.h"
 #include "common/errors.h"
 #include "common/limits.h"
 #include "frontend/common/status.h"
+#include "frontend/proto/batch_write.pb.h"
+#include "frontend/proto/emulator_admin.pb.h"
 #include "frontend/server/handler.h"
 #include "frontend/server/request_context.h"
+#include "frontend/server/session_executor.h"
+#include "grpcpp/health_check_service_interface.h"
+#include "grpcpp/impl/rpc_service_method.h"
+#include "grpcpp/resource_quota.h"
 #include "grpcpp/server_builder.h"
+#include "grpcpp/support/method_handler.h"
 #include "grpcpp/support/status.h"
 
 namespace google {
@@ -57,6 +65,14 @@ namespace spanner_api = ::google::spanner::v1;
 
 namespace {
 
+// Path of the Spanner.BatchWrite method.
+constexpr char kBatchWriteMethodPath[] =
+    "/google.spanner.v1.Spanner/BatchWrite";
+
+// Path of the EmulatorAdmin.ResetDatabase method.
+constexpr char kResetDatabaseMethodPath[] =
+    "/google.spanner.emulator.frontend.EmulatorAdmin/ResetDatabase";
+
 void MaybeAddTrailingMetadata(const absl::Status& status, RequestContext* ctx) {
   if (!status.ok()) {
     // Check for ResourceInfo within the returned status and append it as extra
@@ -71,6 +87,18 @@ void MaybeAddTrailingMetadata(const absl::Status& status, RequestContext* ctx) {
   }
 }
 
+// Calls run, on the worker of the session of request if there is a default
+// SessionExecutor.
+void RunForSession(const protobuf_api::Message& request,
+                   absl::FunctionRef<void()> run) {
+  SessionExecutor* executor = SessionExecutor::Default();
+  if (executor == nullptr) {
+    run();
+    return;
+  }
+  executor->Run(SessionExecutor::SessionOf(request), run);
+}
+
 }  // namespace
 
 // Invokes the given unary gRPC method on the given service by looking up the
@@ -86,9 +114,11 @@ absl::Status Invoke(const std::string& service_name,
                                         service_name, ".", method_name));
   }
   RequestContext ctx(env, grpc_ctx);
-  absl::Status status =
-      dynamic_cast<UnaryGRPCHandler<RequestT, ResponseT>*>(handler)->Run(
-          &ctx, request, response);
+  absl::Status status;
+  RunForSession(*request, [&]() {
+    status = dynamic_cast<UnaryGRPCHandler<RequestT, ResponseT>*>(handler)->Run(
+        &ctx, request, response);
+  });
   MaybeAddTrailingMetadata(status, &ctx);
   return status;
 }
@@ -108,9 +138,12 @@ absl::Status Invoke(const std::string& service_name,
                                         service_name, ".", method_name));
   }
   RequestContext ctx(env, grpc_ctx);
-  absl::Status status =
-      dynamic_cast<ServerStreamingGRPCHandler<RequestT, ResponseT>*>(handler)
-          ->Run(&ctx, request, writer);
+  absl::Status status;
+  RunForSession(*request, [&]() {
+    status =
+        dynamic_cast<ServerStreamingGRPCHandler<RequestT, ResponseT>*>(handler)
+            ->Run(&ctx, request, writer);
+  });
   MaybeAddTrailingMetadata(status, &ctx);
   return status;
 }
@@ -126,7 +159,20 @@ absl::Status Invoke(const std::string& service_name,
 // Implementation of the Spanner gRPC service.
 class SpannerService : public spanner_api::Spanner::Service {
  public:
-  explicit SpannerService(ServerEnv* env) : env_(env) {}
+  explicit SpannerService(ServerEnv* env) : env_(env) {
+    // The generated service predates BatchWrite, so register it the way the
+    // generated code registers its server streaming methods.
+    AddMethod(new grpc::internal::RpcServiceMethod(
+        kBatchWriteMethodPath, grpc::internal::RpcMethod::SERVER_STREAMING,
+        new grpc::internal::ServerStreamingHandler<
+            SpannerService, BatchWriteRequest, BatchWriteResponse>(
+            [](SpannerService* service, grpc::ServerContext* grpc_ctx,
+               const BatchWriteRequest* request,
+               grpc::ServerWriter<BatchWriteResponse>* writer) {
+              return service->BatchWrite(grpc_ctx, request, writer);
+            },
+            this)));
+  }
 
   // Sessions.
   DEFINE_GRPC_METHOD(Spanner, CreateSession, spanner_api::CreateSessionRequest,
@@ -173,6 +219,14 @@ class SpannerService : public spanner_api::Spanner::Service {
   DEFINE_GRPC_METHOD(Spanner, Rollback, spanner_api::RollbackRequest,
                      protobuf_api::Empty);
 
+  // Batch writes.
+  grpc::Status BatchWrite(grpc::ServerContext* grpc_ctx,
+                          const BatchWriteRequest* request,
+                          grpc::ServerWriter<BatchWriteResponse>* writer) {
+    return ToGRPCStatus(
+        Invoke("Spanner", "BatchWrite", grpc_ctx, env_, request, writer));
+  }
+
  private:
   ServerEnv* const env_;
 };
@@ -281,9 +335,38 @@ class OperationsService : public operations_api::Operations::Service {
   ServerEnv* const env_;
 };
 
+// Implementation of the EmulatorAdmin gRPC service, whose methods are
+// registered by hand as there is no generated service for it.
+class EmulatorAdminService : public grpc::Service {
+ public:
+  explicit EmulatorAdminService(ServerEnv* env) : env_(env) {
+    AddMethod(new grpc::internal::RpcServiceMethod(
+        kResetDatabaseMethodPath, grpc::internal::RpcMethod::NORMAL_RPC,
+        new grpc::internal::RpcMethodHandler<
+            EmulatorAdminService, ResetDatabaseRequest, protobuf_api::Empty>(
+            [](EmulatorAdminService* service, grpc::ServerContext* grpc_ctx,
+               const ResetDatabaseRequest* request,
+               protobuf_api::Empty* response) {
+              return service->ResetDatabase(grpc_ctx, request, response);
+            },
+            this)));
+  }
+
+  grpc::Status ResetDatabase(grpc::ServerContext* grpc_ctx,
+                             const ResetDatabaseRequest* request,
+                             protobuf_api::Empty* response) {
+    return ToGRPCStatus(Invoke("EmulatorAdmin", "ResetDatabase", grpc_ctx,
+                               env_, request, response));
+  }
+
+ private:
+  ServerEnv* const env_;
+};
+
 Server::Server(std::unique_ptr<ServerEnv> env)
     : env_(std::move(env)),
       database_admin_service_(new DatabaseAdminService(env_.get())),
+      emulator_admin_service_(new EmulatorAdminService(env_.get())),
       instance_admin_service_(new InstanceAdminService(env_.get())),
       operations_service_(new OperationsService(env_.get())),
       spanner_service_(new SpannerService(env_.get())) {}
@@ -292,13 +375,21 @@ Server::Server(std::unique_ptr<ServerEnv> env)
 std::unique_ptr<Server> Server::Create(const Server::Options& options) {
   auto env = std::make_unique<ServerEnv>();
   std::unique_ptr<Server> server = absl::WrapUnique(new Server(std::move(env)));
+  ::grpc::EnableDefaultHealthCheckService(true);
   ::grpc::ServerBuilder builder;
 
   // Configure server address.
-  server->host_ = options.server_address.substr(
-      0, options.server_address.find_last_of(':'));
-  builder.AddListeningPort(options.server_address,
-                           ::grpc::InsecureServerCredentials(), &server->port_);
+  if (!options.server_address.empty()) {
+    server->host_ = options.server_address.substr(
+        0, options.server_address.find_last_of(':'));
+    builder.AddListeningPort(options.server_address,
+                             ::grpc::InsecureServerCredentials(),
+                             &server->port_);
+  }
+  if (!options.unix_socket_path.empty()) {
+    builder.AddListeningPort(absl::StrCat("unix:", options.unix_socket_path),
+                             ::grpc::InsecureServerCredentials());
+  }
 
   // Configure server message limits.
   builder.AddChannelArgument(GRPC_ARG_MAX_SEND_MESSAGE_LENGTH,
@@ -306,18 +397,50 @@ std::unique_ptr<Server> Server::Create(const Server::Options& options) {
   builder.AddChannelArgument(GRPC_ARG_MAX_RECEIVE_MESSAGE_LENGTH,
                              limits::kMaxGRPCIncomingMessageSize);
 
+  // Configure the completion queues and threads serving requests.
+  if (options.num_completion_queues > 0) {
+    builder.SetSyncServerOption(
+        ::grpc::ServerBuilder::SyncServerOption::NUM_CQS,
+        options.num_completion_queues);
+  }
+  if (options.min_pollers > 0) {
+    builder.SetSyncServerOption(
+        ::grpc::ServerBuilder::SyncServerOption::MIN_POLLERS,
+        options.min_pollers);
+  }
+  if (options.max_pollers > 0) {
+    builder.SetSyncServerOption(
+        ::grpc::ServerBuilder::SyncServerOption::MAX_POLLERS,
+        options.max_pollers);
+  }
+  if (options.max_threads > 0) {
+    ::grpc::ResourceQuota quota("emulator_server");
+    quota.SetMaxThreads(options.max_threads);
+    builder.SetResourceQuota(quota);
+  }
+
   // Configure services exported on this server.
   builder.RegisterService(server->spanner_service_.get())
       .RegisterService(server->database_admin_service_.get())
+      .RegisterService(server->emulator_admin_service_.get())
       .RegisterService(server->instance_admin_service_.get())
       .RegisterService(server->operations_service_.get());
 
   // Actually start the server.
   server->grpc_server_ = builder.BuildAndStart();
-  if (server->port_ < 0) {
+  if (server->grpc_server_ == nullptr) {
+    ZETASQL_LOG(ERROR) << "Failed to start server at address: "
+               << options.server_address
+               << " or unix socket: " << options.unix_socket_path;
+    return nullptr;
+  }
+  if (!options.server_address.empty() && server->port_ < 0) {
     ZETASQL_LOG(ERROR) << "Failed to bind to address: " << options.server_address;
     return nullptr;
   }
+  if (auto* health = server->grpc_server_->GetHealthCheckService()) {
+    health->SetServingStatus(false);
+  }
 
   return server;
 }
@@ -326,6 +449,20 @@ void Server::WaitForShutdown() { grpc_server_->Wait(); }
 
 void Server::Shutdown() { grpc_server_->Shutdown(); }
 
+std::shared_ptr<grpc::Channel> Server::InProcessChannel() {
+  ::grpc::ChannelArguments args;
+  args.SetMaxSendMessageSize(limits::kMaxGRPCIncomingMessageSize);
+  args.SetMaxReceiveMessageSize(limits::kMaxGRPCOutgoingMessageSize);
+  return grpc_server_->InProcessChannel(args);
+}
+
+void Server::SetReady() {
+  ready_.store(true, std::memory_order_release);
+  if (auto* health = grpc_server_->GetHealthCheckService()) {
+    health->SetServingStatus(true);
+  }
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
@@ -17,10 +17,12 @@
 #ifndef STORAGE_SPANNER_CLOUD_EMULATOR_FRONTEND_SERVER_H_
 #define STORAGE_SPANNER_CLOUD_EMULATOR_FRONTEND_SERVER_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 
 #include "frontend/server/environment.h"
+#include "grpcpp/channel.h"
 #include "grpcpp/impl/service_type.h"
 #include "grpcpp/server.h"
 #include "grpcpp/support/status.h"
@@ -50,10 +52,41 @@ namespace frontend {
 // all state needed by a handler into a RequestContext and dispatches the
 // request to its associated free-standing handler function.
 //
+// The server also exports the standard gRPC health service
+// (grpc.health.v1.Health), which reports NOT_SERVING until SetReady() is
+// called, so that clients can wait for the server with a single RPC.
+//
+// The services use the synchronous gRPC API, since every handler blocks until
+// its RPC is done: streaming reads and queries write their results as they are
+// produced, and change stream queries wait for new records. Each in-flight RPC
+// therefore holds a thread. Rather than multiplexing calls on completion
+// queues, which would mean rewriting every handler as a state machine, Options
+// sizes the completion queues and bounds the threads serving them.
+//
 class Server {
  public:
   struct Options {
+    // Address at which requests are served. If empty, the server does not
+    // listen on a port and is only reachable through InProcessChannel().
     std::string server_address;
+
+    // If set, the path of a Unix domain socket on which requests are served
+    // in addition to server_address.
+    std::string unix_socket_path;
+
+    // Number of completion queues polled for new requests. 0 uses the gRPC
+    // default of one per core.
+    int num_completion_queues = 0;
+
+    // Minimum and maximum number of threads polling each completion queue. 0
+    // uses the gRPC default.
+    int min_pollers = 0;
+    int max_pollers = 0;
+
+    // Maximum number of threads running requests across all completion queues.
+    // Each in-flight streaming RPC holds one of these threads until it
+    // finishes. 0 does not limit the number of threads.
+    int max_threads = 0;
   };
 
   // Returns an initialized Server, or nullptr if the initialization failed.
@@ -68,6 +101,18 @@ class Server {
   // Shuts down the grpc server.
   void Shutdown();
 
+  // Marks the server as ready to serve, once any state it starts with has been
+  // loaded. Requests are accepted as soon as the server is created, but may
+  // not observe that state until then.
+  void SetReady();
+
+  // Returns true once SetReady() has been called.
+  bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+  // Returns a channel to this server which does not go through the network
+  // stack, for clients running in the same process.
+  std::shared_ptr<grpc::Channel> InProcessChannel();
+
   // Accessor to the ServerEnv of the server.
   ServerEnv* env() { return env_.get(); }
 
@@ -84,12 +129,16 @@ class Server {
 
   // Services implemented by this gRPC server.
   std::unique_ptr<grpc::Service> database_admin_service_;
+  std::unique_ptr<grpc::Service> emulator_admin_service_;
   std::unique_ptr<grpc::Service> instance_admin_service_;
   std::unique_ptr<grpc::Service> operations_service_;
   std::unique_ptr<grpc::Service> spanner_service_;
 
   // Underlying gRPC server.
   std::unique_ptr<grpc::Server> grpc_server_;
+
+  // Whether SetReady() has been called.
+  std::atomic<bool> ready_ = false;
 };
 
 }  // namespace frontend
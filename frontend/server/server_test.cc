@@ -0,0 +1,94 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/server.h"
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "google/spanner/v1/spanner.grpc.pb.h"
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+#include "grpcpp/support/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace spanner_api = ::google::spanner::v1;
+
+// Returns the status of creating a session in a database which does not exist
+// through the given target.
+grpc::Status CreateSession(const std::string& target) {
+  std::unique_ptr<spanner_api::Spanner::Stub> stub =
+      spanner_api::Spanner::NewStub(
+          grpc::CreateChannel(target, grpc::InsecureChannelCredentials()));
+  grpc::ClientContext ctx;
+  spanner_api::CreateSessionRequest request;
+  request.set_database("projects/p/instances/i/databases/d");
+  spanner_api::Session session;
+  return stub->CreateSession(&ctx, request, &session);
+}
+
+TEST(ServerTest, ServesRequestsOnUnixSocket) {
+  // Unix socket paths are limited to about a hundred bytes, which the
+  // temporary directory of the test may exceed.
+  const std::string socket_path =
+      absl::StrCat("/tmp/emulator_server_test_", getpid(), ".sock");
+  Server::Options options;
+  options.server_address = "localhost:0";
+  options.unix_socket_path = socket_path;
+  std::unique_ptr<Server> server = Server::Create(options);
+  ASSERT_NE(server, nullptr);
+  std::thread server_thread([&server]() { server->WaitForShutdown(); });
+
+  // Both listeners reach the handlers, which do not find the database.
+  EXPECT_EQ(CreateSession(absl::StrCat("unix:", socket_path)).error_code(),
+            grpc::StatusCode::NOT_FOUND);
+  EXPECT_EQ(
+      CreateSession(absl::StrCat(server->host(), ":", server->port()))
+          .error_code(),
+      grpc::StatusCode::NOT_FOUND);
+
+  server->Shutdown();
+  server_thread.join();
+  unlink(socket_path.c_str());
+}
+
+TEST(ServerTest, FailsToStartWhenUnixSocketCannotBeBound) {
+  Server::Options options;
+  options.server_address = "localhost:0";
+  options.unix_socket_path = "/nonexistent-directory/emulator.sock";
+  EXPECT_EQ(Server::Create(options), nullptr);
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
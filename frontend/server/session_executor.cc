@@ -0,0 +1,145 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/session_executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/functional/function_ref.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+std::atomic<SessionExecutor*> default_executor = nullptr;
+
+constexpr absl::string_view kSessionsSegment = "/sessions/";
+
+// The executor whose worker is running on this thread, or null.
+thread_local const SessionExecutor* current_executor = nullptr;
+
+}  // namespace
+
+SessionExecutor* SessionExecutor::Default() {
+  return default_executor.load(std::memory_order_acquire);
+}
+
+void SessionExecutor::SetDefault(std::unique_ptr<SessionExecutor> executor) {
+  default_executor.store(executor.release(), std::memory_order_release);
+}
+
+std::string SessionExecutor::SessionOf(
+    const google::protobuf::Message& request) {
+  const google::protobuf::Descriptor* descriptor = request.GetDescriptor();
+  for (const char* name : {"session", "name"}) {
+    const google::protobuf::FieldDescriptor* field =
+        descriptor->FindFieldByName(name);
+    if (field == nullptr || field->is_repeated() ||
+        field->type() != google::protobuf::FieldDescriptor::TYPE_STRING) {
+      continue;
+    }
+    std::string value = request.GetReflection()->GetString(request, field);
+    if (absl::StrContains(value, kSessionsSegment)) {
+      return value;
+    }
+  }
+  return "";
+}
+
+SessionExecutor::SessionExecutor(const Options& options) : options_(options) {
+  for (int i = 0; i < std::max(options_.num_workers, 1); ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    worker->thread = std::thread(&SessionExecutor::Work, this, worker.get());
+  }
+}
+
+SessionExecutor::~SessionExecutor() {
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    absl::MutexLock lock(&worker->mu);
+    worker->stopping = true;
+  }
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+void SessionExecutor::Run(absl::string_view session,
+                          absl::FunctionRef<void()> fn) {
+  if (session.empty() || current_executor == this) {
+    fn();
+    return;
+  }
+  Worker& worker =
+      *workers_[absl::Hash<absl::string_view>()(session) % workers_.size()];
+  Task task(fn);
+  bool started = false;
+  {
+    absl::MutexLock lock(&worker.mu);
+    worker.queue.push_back(&task);
+    started = worker.mu.AwaitWithTimeout(absl::Condition(&task.started),
+                                         options_.max_queue_delay);
+    if (!started) {
+      // The worker is busy, so the task is taken back and run here.
+      worker.queue.erase(
+          std::find(worker.queue.begin(), worker.queue.end(), &task));
+    }
+  }
+  if (!started) {
+    fn();
+    return;
+  }
+  task.done.WaitForNotification();
+}
+
+void SessionExecutor::Work(Worker* worker) {
+  current_executor = this;
+  while (true) {
+    Task* task = nullptr;
+    {
+      absl::MutexLock lock(&worker->mu);
+      worker->mu.Await(absl::Condition(worker, &Worker::HasWork));
+      if (worker->queue.empty()) {
+        return;
+      }
+      task = worker->queue.front();
+      worker->queue.pop_front();
+      task->started = true;
+    }
+    task->fn();
+    task->done.Notify();
+  }
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,123 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SESSION_EXECUTOR_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SESSION_EXECUTOR_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "google/protobuf/message.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// SessionExecutor runs the RPCs addressed to each session on one of a fixed
+// set of worker threads, chosen by a hash of the session name, rather than on
+// whichever gRPC thread received them. Consecutive RPCs of a session then find
+// its session, transaction and database state in the caches of the core which
+// last used them, instead of pulling them over from another core each time.
+//
+// The thread which received an RPC waits for it to finish on its worker. An
+// RPC which its worker has not picked up within Options::max_queue_delay, for
+// instance because the worker is blocked on a long streaming read or on a lock
+// held by a transaction of another session queued behind it, runs on the
+// receiving thread instead, so that a busy worker never holds up an RPC for
+// long and never deadlocks.
+//
+// This class is thread-safe.
+class SessionExecutor {
+ public:
+  struct Options {
+    // The number of worker threads. Must be positive.
+    int num_workers = 1;
+
+    // How long an RPC waits for its worker before running on the thread which
+    // received it.
+    absl::Duration max_queue_delay = absl::Milliseconds(1);
+  };
+
+  // Returns the executor used by the gRPC server, or nullptr if RPCs run on
+  // the threads which receive them.
+  static SessionExecutor* Default();
+
+  // Makes executor the one returned by Default. Must be called at most once,
+  // before the server starts.
+  static void SetDefault(std::unique_ptr<SessionExecutor> executor);
+
+  // Returns the name of the session an RPC request is addressed to, read from
+  // its session field, or from its name field if that names a session, or an
+  // empty string if it is not addressed to a session.
+  static std::string SessionOf(const google::protobuf::Message& request);
+
+  explicit SessionExecutor(const Options& options);
+
+  // Waits for the queued RPCs to finish and stops the workers.
+  ~SessionExecutor();
+
+  // Runs fn on the worker of session and returns once it has run. fn runs on
+  // the calling thread instead if session is empty, if the caller is a worker
+  // of this executor, or if the worker does not pick fn up in time.
+  void Run(absl::string_view session, absl::FunctionRef<void()> fn);
+
+ private:
+  // An RPC queued for a worker.
+  struct Task {
+    explicit Task(absl::FunctionRef<void()> fn) : fn(fn) {}
+
+    absl::FunctionRef<void()> fn;
+
+    // Set by the worker, under its mutex, once it has taken the task.
+    bool started = false;
+    absl::Notification done;
+  };
+
+  struct Worker {
+    bool HasWork() const ABSL_SHARED_LOCKS_REQUIRED(mu) {
+      return stopping || !queue.empty();
+    }
+
+    absl::Mutex mu;
+    std::deque<Task*> queue ABSL_GUARDED_BY(mu);
+    bool stopping ABSL_GUARDED_BY(mu) = false;
+    std::thread thread;
+  };
+
+  // Runs the tasks queued for worker until it is stopped and its queue is
+  // empty.
+  void Work(Worker* worker);
+
+  const Options options_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SESSION_EXECUTOR_H_
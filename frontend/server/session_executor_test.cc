@@ -0,0 +1,108 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/session_executor.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace spanner_api = ::google::spanner::v1;
+
+using ::testing::Each;
+
+constexpr char kSession[] = "projects/p/instances/i/databases/d/sessions/s";
+
+TEST(SessionExecutorTest, FindsSessionOfRequests) {
+  spanner_api::CommitRequest commit;
+  commit.set_session(kSession);
+  EXPECT_EQ(SessionExecutor::SessionOf(commit), kSession);
+
+  spanner_api::DeleteSessionRequest delete_session;
+  delete_session.set_name(kSession);
+  EXPECT_EQ(SessionExecutor::SessionOf(delete_session), kSession);
+
+  spanner_api::CreateSessionRequest create_session;
+  create_session.set_database("projects/p/instances/i/databases/d");
+  EXPECT_EQ(SessionExecutor::SessionOf(create_session), "");
+}
+
+TEST(SessionExecutorTest, RunsRpcsOfASessionOnOneWorker) {
+  SessionExecutor executor(
+      SessionExecutor::Options{.num_workers = 4,
+                               .max_queue_delay = absl::Seconds(10)});
+  std::vector<std::thread::id> thread_ids;
+  for (int i = 0; i < 8; ++i) {
+    executor.Run(kSession,
+                 [&]() { thread_ids.push_back(std::this_thread::get_id()); });
+  }
+  ASSERT_EQ(thread_ids.size(), 8);
+  EXPECT_NE(thread_ids[0], std::this_thread::get_id());
+  EXPECT_THAT(thread_ids, Each(thread_ids[0]));
+
+  // RPCs which are not addressed to a session run where they are received.
+  std::thread::id thread_id;
+  executor.Run("", [&]() { thread_id = std::this_thread::get_id(); });
+  EXPECT_EQ(thread_id, std::this_thread::get_id());
+}
+
+TEST(SessionExecutorTest, RunsRpcOnReceivingThreadWhileWorkerIsBusy) {
+  SessionExecutor executor(
+      SessionExecutor::Options{.num_workers = 1,
+                               .max_queue_delay = absl::Milliseconds(10)});
+  absl::Notification running;
+  absl::Notification release;
+  std::thread busy([&]() {
+    executor.Run(kSession, [&]() {
+      running.Notify();
+      release.WaitForNotification();
+    });
+  });
+  running.WaitForNotification();
+
+  // The only worker is blocked, for instance on a lock held by a transaction
+  // whose commit is the next RPC.
+  std::thread::id thread_id;
+  executor.Run(absl::StrCat(kSession, "2"),
+               [&]() { thread_id = std::this_thread::get_id(); });
+  EXPECT_EQ(thread_id, std::this_thread::get_id());
+
+  // Once the worker is free it runs the RPCs of its sessions again.
+  release.Notify();
+  busy.join();
+  executor.Run(kSession, [&]() { thread_id = std::this_thread::get_id(); });
+  EXPECT_NE(thread_id, std::this_thread::get_id());
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,657 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/shard_router.h"
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/unknown_field_set.h"
+#include "google/spanner/admin/database/v1/spanner_database_admin.pb.h"
+#include "zetasql/base/logging.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/schema/parser/ddl_parser.h"
+#include "common/errors.h"
+#include "common/limits.h"
+#include "frontend/common/uris.h"
+#include "frontend/server/database_shards.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/health_check_service_interface.h"
+#include "grpcpp/security/credentials.h"
+#include "grpcpp/security/server_credentials.h"
+#include "grpcpp/server_builder.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "grpcpp/support/channel_arguments.h"
+#include "grpcpp/support/client_callback.h"
+#include "grpcpp/support/server_callback.h"
+#include "grpcpp/support/slice.h"
+#include "grpcpp/support/status.h"
+#include "grpcpp/support/stub_options.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace database_api = ::google::spanner::admin::database::v1;
+
+constexpr char kCreateDatabaseMethod[] =
+    "/google.spanner.admin.database.v1.DatabaseAdmin/CreateDatabase";
+constexpr char kListDatabasesMethod[] =
+    "/google.spanner.admin.database.v1.DatabaseAdmin/ListDatabases";
+constexpr char kInstanceAdminPrefix[] =
+    "/google.spanner.admin.instance.v1.InstanceAdmin/";
+constexpr char kHealthCheckMethod[] = "/grpc.health.v1.Health/Check";
+
+// How often the workers are checked for having exited, and how long after
+// exiting, or failing to start, a worker is started again.
+constexpr absl::Duration kWorkerPollInterval = absl::Milliseconds(100);
+constexpr absl::Duration kWorkerRestartDelay = absl::Seconds(1);
+
+// A grpc.health.v1.HealthCheckResponse with status SERVING.
+constexpr absl::string_view kServingHealthCheckResponse("\x08\x01", 2);
+
+grpc::ByteBuffer ToByteBuffer(const std::string& bytes) {
+  grpc::Slice slice(bytes);
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+std::string FromByteBuffer(const grpc::ByteBuffer& buffer) {
+  std::vector<grpc::Slice> slices;
+  std::string out;
+  if (buffer.Dump(&slices).ok()) {
+    for (const grpc::Slice& slice : slices) {
+      out.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+    }
+  }
+  return out;
+}
+
+// Returns the database URI which resource_uri, such as a session or operation
+// URI, starts with, or an empty string if it is not below a database.
+std::string DatabaseUriPrefix(absl::string_view resource_uri) {
+  std::vector<absl::string_view> parts = absl::StrSplit(resource_uri, '/');
+  if (parts.size() < 6 || parts[0] != "projects" || parts[2] != "instances" ||
+      parts[4] != "databases" || parts[1].empty() || parts[3].empty() ||
+      parts[5].empty()) {
+    return "";
+  }
+  parts.resize(6);
+  return absl::StrJoin(parts, "/");
+}
+
+// How a request is routed to the workers.
+struct Route {
+  enum class Kind {
+    // To the worker of shard.
+    kShard,
+    // To every worker, answering with the response of the first.
+    kAllShards,
+    // To every worker, merging the databases they list.
+    kListDatabases,
+  };
+  Kind kind = Kind::kShard;
+  int shard = 0;
+};
+
+Route RouteRequest(absl::string_view method, absl::string_view request,
+                   int num_shards) {
+  const std::string database_uri = RoutedDatabaseUri(method, request);
+  if (!database_uri.empty()) {
+    return Route{.shard = DatabaseShard(database_uri, num_shards)};
+  }
+  if (method == kListDatabasesMethod) {
+    return Route{.kind = Route::Kind::kListDatabases};
+  }
+  if (absl::StartsWith(method, kInstanceAdminPrefix)) {
+    absl::string_view name = method.substr(sizeof(kInstanceAdminPrefix) - 1);
+    if (absl::StartsWith(name, "Create") || absl::StartsWith(name, "Update") ||
+        absl::StartsWith(name, "Delete")) {
+      return Route{.kind = Route::Kind::kAllShards};
+    }
+  }
+  return Route{};
+}
+
+// Forwards the metadata sent by the client with a request to the worker.
+void CopyClientMetadata(const grpc::GenericCallbackServerContext& from,
+                        grpc::ClientContext* to) {
+  for (const auto& [key, value] : from.client_metadata()) {
+    const absl::string_view name(key.data(), key.size());
+    if (absl::StartsWith(name, ":") || absl::StartsWith(name, "grpc-") ||
+        name == "user-agent" || name == "content-type" || name == "te") {
+      continue;
+    }
+    to->AddMetadata(std::string(name), std::string(value.data(), value.size()));
+  }
+  to->set_deadline(from.deadline());
+}
+
+std::shared_ptr<grpc::Channel> CreateWorkerChannel(const std::string& target) {
+  grpc::ChannelArguments args;
+  args.SetMaxSendMessageSize(limits::kMaxGRPCIncomingMessageSize);
+  args.SetMaxReceiveMessageSize(limits::kMaxGRPCOutgoingMessageSize);
+  return grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(),
+                                   args);
+}
+
+// Sends request to the unary method of a worker and waits for its response.
+grpc::Status CallWorker(grpc::GenericStub* stub, grpc::ClientContext* context,
+                        const std::string& method,
+                        const grpc::ByteBuffer& request,
+                        grpc::ByteBuffer* response) {
+  absl::Notification done;
+  grpc::Status status;
+  stub->UnaryCall(context, method, grpc::StubOptions(), &request, response,
+                  [&](grpc::Status call_status) {
+                    status = std::move(call_status);
+                    done.Notify();
+                  });
+  done.WaitForNotification();
+  return status;
+}
+
+}  // namespace
+
+std::string RoutedDatabaseUri(absl::string_view method,
+                              absl::string_view request) {
+  // The database created by CreateDatabase is only named by its statement.
+  if (method == kCreateDatabaseMethod) {
+    database_api::CreateDatabaseRequest create_request;
+    if (!create_request.ParseFromArray(request.data(), request.size())) {
+      return "";
+    }
+    absl::StatusOr<std::unique_ptr<backend::ddl::DDLStatement>> statement =
+        backend::ParseDDLByDialect(create_request.create_statement());
+    if (!statement.ok() || !(*statement)->has_create_database()) {
+      return "";
+    }
+    return MakeDatabaseUri(create_request.parent(),
+                           (*statement)->create_database().db_name());
+  }
+
+  // Every other request about a database names it, or a resource below it, in
+  // a top-level string field, usually the first.
+  google::protobuf::UnknownFieldSet fields;
+  if (!fields.ParseFromArray(request.data(), request.size())) {
+    return "";
+  }
+  for (int i = 0; i < fields.field_count(); ++i) {
+    const google::protobuf::UnknownField& field = fields.field(i);
+    if (field.type() != google::protobuf::UnknownField::TYPE_LENGTH_DELIMITED) {
+      continue;
+    }
+    std::string database_uri = DatabaseUriPrefix(field.length_delimited());
+    if (!database_uri.empty()) {
+      return database_uri;
+    }
+  }
+  return "";
+}
+
+absl::StatusOr<std::unique_ptr<ShardWorkers>> ShardWorkers::Start(
+    const std::string& binary_path, std::vector<std::string> args,
+    int num_shards, const std::string& socket_dir) {
+  auto workers = absl::WrapUnique(
+      new ShardWorkers(binary_path, std::move(args), num_shards, socket_dir));
+  {
+    absl::MutexLock lock(&workers->mu_);
+    for (int shard = 0; shard < num_shards; ++shard) {
+      ZETASQL_RETURN_IF_ERROR(workers->Spawn(shard));
+    }
+  }
+  workers->supervisor_ = std::thread(&ShardWorkers::Supervise, workers.get());
+  return workers;
+}
+
+ShardWorkers::ShardWorkers(std::string binary_path,
+                           std::vector<std::string> args, int num_shards,
+                           const std::string& socket_dir)
+    : binary_path_(std::move(binary_path)),
+      args_(std::move(args)),
+      pids_(num_shards, -1) {
+  for (int shard = 0; shard < num_shards; ++shard) {
+    socket_paths_.push_back(absl::StrCat(socket_dir, "/shard-", shard));
+    targets_.push_back(absl::StrCat("unix:", socket_paths_.back()));
+  }
+}
+
+ShardWorkers::~ShardWorkers() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+    for (pid_t pid : pids_) {
+      if (pid > 0) {
+        ::kill(pid, SIGTERM);
+      }
+    }
+  }
+  if (supervisor_.joinable()) {
+    supervisor_.join();
+  }
+}
+
+absl::Status ShardWorkers::Spawn(int shard) {
+  // Later flags override earlier ones, so the worker keeps every other flag of
+  // this process, for example its storage and concurrency options.
+  std::vector<std::string> args = args_;
+  args.push_back(absl::StrCat("--database_shard_index=", shard));
+  args.push_back("--host_port=");
+  args.push_back(absl::StrCat("--unix_socket_path=", socket_paths_[shard]));
+  args.push_back("--metrics_host_port=");
+  args.push_back("--rpc_trace_file=");
+  args.push_back("--trace_export_file=");
+  std::vector<char*> argv;
+  for (std::string& arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  const pid_t pid = ::fork();
+  if (pid < 0) {
+    return error::Internal(absl::StrCat("Failed to start worker of shard ",
+                                        shard, ": ", std::strerror(errno)));
+  }
+  if (pid == 0) {
+    // Only async-signal-safe functions may be called until exec. The worker
+    // is terminated with the router, and does not inherit its blocked signals.
+    ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+    sigset_t signals;
+    sigemptyset(&signals);
+    ::sigprocmask(SIG_SETMASK, &signals, nullptr);
+    ::execv(binary_path_.c_str(), argv.data());
+    ::_exit(127);
+  }
+  pids_[shard] = pid;
+  return absl::OkStatus();
+}
+
+void ShardWorkers::Supervise() {
+  // Only the workers are waited for, so that other child processes of this
+  // process are left to whoever started them.
+  const int num_shards = socket_paths_.size();
+  std::vector<absl::Time> restart_times(num_shards, absl::InfiniteFuture());
+  while (true) {
+    {
+      absl::MutexLock lock(&mu_);
+      bool running = false;
+      for (int shard = 0; shard < num_shards; ++shard) {
+        if (pids_[shard] > 0) {
+          int wait_status = 0;
+          const pid_t pid = ::waitpid(pids_[shard], &wait_status, WNOHANG);
+          if (pid == 0 || (pid < 0 && errno == EINTR)) {
+            running = true;
+            continue;
+          }
+          pids_[shard] = -1;
+          if (!stopping_) {
+            ZETASQL_LOG(WARNING) << "Worker of database shard " << shard
+                         << " exited with status " << wait_status
+                         << ", restarting it.";
+            restart_times[shard] = absl::Now() + kWorkerRestartDelay;
+          }
+        }
+        if (stopping_ || absl::Now() < restart_times[shard]) {
+          continue;
+        }
+        absl::Status status = Spawn(shard);
+        if (!status.ok()) {
+          ZETASQL_LOG(ERROR) << status << ", retrying.";
+          restart_times[shard] = absl::Now() + kWorkerRestartDelay;
+          continue;
+        }
+        restart_times[shard] = absl::InfiniteFuture();
+        running = true;
+      }
+      if (stopping_ && !running) {
+        return;
+      }
+    }
+    absl::SleepFor(kWorkerPollInterval);
+  }
+}
+
+// Call relays a request to the workers and their responses back to the client.
+// All the methods of the emulator take a single request, so the request is
+// read before the call is routed.
+class ShardRouter::Call : public grpc::ServerGenericBidiReactor {
+ public:
+  Call(ShardRouter* router, grpc::GenericCallbackServerContext* context)
+      : router_(router), context_(context), upstream_(this) {
+    StartRead(&request_);
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                          "The request was not sent."));
+      return;
+    }
+    const Route route = RouteRequest(
+        context_->method(), FromByteBuffer(request_), router_->stubs_.size());
+    if (route.kind != Route::Kind::kShard) {
+      // Fanning out blocks on several workers in turn, which is kept off the
+      // threads running reactions.
+      std::thread([this, route]() { FanOut(route); }).detach();
+      return;
+    }
+    CopyClientMetadata(*context_, &upstream_context_);
+    router_->stubs_[route.shard]->PrepareBidiStreamingCall(
+        &upstream_context_, context_->method(), grpc::StubOptions(),
+        &upstream_);
+    upstream_.StartWriteLast(&request_, grpc::WriteOptions());
+    upstream_.StartRead(&response_);
+    upstream_.StartCall();
+  }
+
+  void OnWriteDone(bool ok) override {
+    bool finish;
+    grpc::Status status;
+    {
+      absl::MutexLock lock(&mu_);
+      writing_ = false;
+      finish = upstream_done_;
+      status = upstream_status_;
+    }
+    if (finish) {
+      Finish(status);
+    } else if (ok) {
+      upstream_.StartRead(&response_);
+    } else {
+      // The client has gone away.
+      upstream_context_.TryCancel();
+    }
+  }
+
+  void OnCancel() override { upstream_context_.TryCancel(); }
+
+  void OnDone() override { delete this; }
+
+ private:
+  // The reactions of the call to the worker.
+  class Upstream : public grpc::ClientBidiReactor<grpc::ByteBuffer,
+                                                  grpc::ByteBuffer> {
+   public:
+    explicit Upstream(Call* call) : call_(call) {}
+
+    void OnReadDone(bool ok) override {
+      // Once the responses run out, OnDone follows with the status.
+      if (ok) {
+        call_->Relay();
+      }
+    }
+
+    void OnDone(const grpc::Status& status) override {
+      call_->Done(status);
+    }
+
+   private:
+    Call* const call_;
+  };
+
+  // Sends the response read from the worker to the client.
+  void Relay() {
+    {
+      absl::MutexLock lock(&mu_);
+      writing_ = true;
+    }
+    StartWrite(&response_);
+  }
+
+  // Finishes with the status of the call to the worker, once the response
+  // being sent to the client, if any, is out.
+  void Done(const grpc::Status& status) {
+    {
+      absl::MutexLock lock(&mu_);
+      if (writing_) {
+        upstream_done_ = true;
+        upstream_status_ = status;
+        return;
+      }
+    }
+    Finish(status);
+  }
+
+  void FanOut(const Route& route) {
+    grpc::Status status;
+    grpc::ByteBuffer response;
+    if (route.kind == Route::Kind::kAllShards) {
+      for (size_t shard = 0; shard < router_->stubs_.size(); ++shard) {
+        grpc::ClientContext context;
+        CopyClientMetadata(*context_, &context);
+        grpc::ByteBuffer shard_response;
+        grpc::Status shard_status =
+            CallWorker(router_->stubs_[shard].get(), &context,
+                       context_->method(), request_, &shard_response);
+        if (shard == 0) {
+          response = std::move(shard_response);
+        }
+        if (status.ok()) {
+          status = shard_status;
+        }
+      }
+    } else {
+      status = ListDatabases(&response);
+    }
+    if (!status.ok()) {
+      Finish(status);
+      return;
+    }
+    {
+      absl::MutexLock lock(&mu_);
+      writing_ = true;
+      upstream_done_ = true;
+    }
+    response_ = std::move(response);
+    StartWrite(&response_);
+  }
+
+  // Lists the databases of every worker. The page size and token of the
+  // request are dropped, since each worker pages through its own databases.
+  grpc::Status ListDatabases(grpc::ByteBuffer* response) {
+    database_api::ListDatabasesRequest request;
+    if (!request.ParseFromString(FromByteBuffer(request_))) {
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                          "Failed to parse ListDatabasesRequest.");
+    }
+    request.clear_page_size();
+    request.clear_page_token();
+    const grpc::ByteBuffer shard_request =
+        ToByteBuffer(request.SerializeAsString());
+    database_api::ListDatabasesResponse merged;
+    for (const auto& stub : router_->stubs_) {
+      grpc::ClientContext context;
+      CopyClientMetadata(*context_, &context);
+      grpc::ByteBuffer shard_response;
+      grpc::Status status = CallWorker(stub.get(), &context, context_->method(),
+                                       shard_request, &shard_response);
+      if (!status.ok()) {
+        return status;
+      }
+      database_api::ListDatabasesResponse databases;
+      if (!databases.ParseFromString(FromByteBuffer(shard_response))) {
+        return grpc::Status(grpc::StatusCode::INTERNAL,
+                            "Failed to parse ListDatabasesResponse.");
+      }
+      for (database_api::Database& database : *databases.mutable_databases()) {
+        *merged.add_databases() = std::move(database);
+      }
+    }
+    std::sort(merged.mutable_databases()->begin(),
+              merged.mutable_databases()->end(),
+              [](const database_api::Database& a,
+                 const database_api::Database& b) {
+                return a.name() < b.name();
+              });
+    *response = ToByteBuffer(merged.SerializeAsString());
+    return grpc::Status::OK;
+  }
+
+  ShardRouter* const router_;
+  grpc::GenericCallbackServerContext* const context_;
+
+  grpc::ByteBuffer request_;
+
+  // The response being relayed from the worker to the client.
+  grpc::ByteBuffer response_;
+
+  grpc::ClientContext upstream_context_;
+  Upstream upstream_;
+
+  absl::Mutex mu_;
+
+  // True while response_ is being sent to the client.
+  bool writing_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Set once the call to the worker is done while a response was being sent,
+  // or for fanned out calls, whose single response is the last.
+  bool upstream_done_ ABSL_GUARDED_BY(mu_) = false;
+  grpc::Status upstream_status_ ABSL_GUARDED_BY(mu_);
+};
+
+class ShardRouter::Service : public grpc::CallbackGenericService {
+ public:
+  explicit Service(ShardRouter* router) : router_(router) {}
+
+  grpc::ServerGenericBidiReactor* CreateReactor(
+      grpc::GenericCallbackServerContext* context) override {
+    return new Call(router_, context);
+  }
+
+ private:
+  ShardRouter* const router_;
+};
+
+ShardRouter::ShardRouter(const Options& options)
+    : service_(std::make_unique<Service>(this)) {
+  for (const std::string& target : options.worker_targets) {
+    stubs_.push_back(
+        std::make_unique<grpc::GenericStub>(CreateWorkerChannel(target)));
+  }
+}
+
+ShardRouter::~ShardRouter() {
+  if (grpc_server_ != nullptr) {
+    grpc_server_->Shutdown();
+  }
+}
+
+std::unique_ptr<ShardRouter> ShardRouter::Create(const Options& options) {
+  std::unique_ptr<ShardRouter> router =
+      absl::WrapUnique(new ShardRouter(options));
+  ::grpc::EnableDefaultHealthCheckService(true);
+  ::grpc::ServerBuilder builder;
+  if (!options.server_address.empty()) {
+    router->host_ = options.server_address.substr(
+        0, options.server_address.find_last_of(':'));
+    builder.AddListeningPort(options.server_address,
+                             ::grpc::InsecureServerCredentials(),
+                             &router->port_);
+  }
+  if (!options.unix_socket_path.empty()) {
+    builder.AddListeningPort(absl::StrCat("unix:", options.unix_socket_path),
+                             ::grpc::InsecureServerCredentials());
+  }
+  builder.AddChannelArgument(GRPC_ARG_MAX_SEND_MESSAGE_LENGTH,
+                             limits::kMaxGRPCOutgoingMessageSize);
+  builder.AddChannelArgument(GRPC_ARG_MAX_RECEIVE_MESSAGE_LENGTH,
+                             limits::kMaxGRPCIncomingMessageSize);
+  builder.RegisterCallbackGenericService(router->service_.get());
+
+  router->grpc_server_ = builder.BuildAndStart();
+  if (router->grpc_server_ == nullptr) {
+    ZETASQL_LOG(ERROR) << "Failed to start shard router at address: "
+               << options.server_address
+               << " or unix socket: " << options.unix_socket_path;
+    return nullptr;
+  }
+  if (!options.server_address.empty() && router->port_ < 0) {
+    ZETASQL_LOG(ERROR) << "Failed to bind to address: " << options.server_address;
+    return nullptr;
+  }
+  if (auto* health = router->grpc_server_->GetHealthCheckService()) {
+    health->SetServingStatus(false);
+  }
+  return router;
+}
+
+absl::Status ShardRouter::WaitForWorkers(absl::Duration timeout) {
+  const absl::Time deadline = absl::Now() + timeout;
+  const grpc::ByteBuffer request = ToByteBuffer("");
+  for (size_t shard = 0; shard < stubs_.size(); ++shard) {
+    while (true) {
+      grpc::ClientContext context;
+      context.set_wait_for_ready(true);
+      context.set_deadline(absl::ToChronoTime(deadline));
+      grpc::ByteBuffer response;
+      grpc::Status status = CallWorker(stubs_[shard].get(), &context,
+                                       kHealthCheckMethod, request, &response);
+      if (status.ok() &&
+          FromByteBuffer(response) == kServingHealthCheckResponse) {
+        break;
+      }
+      if (absl::Now() >= deadline) {
+        return error::Internal(absl::StrCat(
+            "Worker of database shard ", shard,
+            " did not start serving: ", status.error_message()));
+      }
+      absl::SleepFor(absl::Milliseconds(100));
+    }
+  }
+  if (auto* health = grpc_server_->GetHealthCheckService()) {
+    health->SetServingStatus(true);
+  }
+  return absl::OkStatus();
+}
+
+void ShardRouter::WaitForShutdown() { grpc_server_->Wait(); }
+
+void ShardRouter::Shutdown() { grpc_server_->Shutdown(); }
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
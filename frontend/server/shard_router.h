@@ -0,0 +1,158 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SHARD_ROUTER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SHARD_ROUTER_H_
+
+#include <sys/types.h>
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "grpcpp/generic/async_generic_service.h"
+#include "grpcpp/generic/generic_stub.h"
+#include "grpcpp/server.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// Returns the URI of the database which a request to method is about, or an
+// empty string for requests about instances and other resources above
+// databases. method is the full gRPC method name, such as
+// "/google.spanner.v1.Spanner/ExecuteSql", and request the serialized request.
+std::string RoutedDatabaseUri(absl::string_view method,
+                              absl::string_view request);
+
+// ShardWorkers runs the worker processes of --database_shards.
+class ShardWorkers {
+ public:
+  // Starts num_shards processes running the binary at binary_path with args,
+  // the command line of this process, followed by the flags which make worker
+  // i own shard i and serve it on a Unix socket in socket_dir only. A worker
+  // which exits, or fails to restart, is restarted a second later, until
+  // ShardWorkers is destroyed.
+  static absl::StatusOr<std::unique_ptr<ShardWorkers>> Start(
+      const std::string& binary_path, std::vector<std::string> args,
+      int num_shards, const std::string& socket_dir);
+
+  // Terminates the workers and waits for them to exit.
+  ~ShardWorkers();
+
+  // The gRPC target of the worker of each shard.
+  const std::vector<std::string>& targets() const { return targets_; }
+
+ private:
+  ShardWorkers(std::string binary_path, std::vector<std::string> args,
+               int num_shards, const std::string& socket_dir);
+  ShardWorkers(const ShardWorkers&) = delete;
+  ShardWorkers& operator=(const ShardWorkers&) = delete;
+
+  // Starts the worker of shard.
+  absl::Status Spawn(int shard) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Polls the workers, reaping those which exit and restarting them, until
+  // stopping_ is set and every worker has exited.
+  void Supervise();
+
+  const std::string binary_path_;
+  const std::vector<std::string> args_;
+  std::vector<std::string> socket_paths_;
+  std::vector<std::string> targets_;
+
+  absl::Mutex mu_;
+
+  // The process ID of the worker of each shard, or -1 while it is not running.
+  std::vector<pid_t> pids_ ABSL_GUARDED_BY(mu_);
+
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+
+  std::thread supervisor_;
+};
+
+// ShardRouter is the gRPC server of --database_shards. It forwards every
+// request to the worker owning the database the request is about, see
+// DatabaseShard, and relays the responses and status of the worker, so that
+// each database and its sessions live in a single worker process.
+//
+// Requests creating, updating or deleting instances are sent to every worker,
+// and answered with the response of the first. ListDatabases returns the
+// databases of all workers in a single page. Other requests above databases,
+// such as GetInstance, are answered by the first worker.
+class ShardRouter {
+ public:
+  struct Options {
+    // Address at which requests are served.
+    std::string server_address;
+
+    // If set, the path of a Unix domain socket on which requests are also
+    // served.
+    std::string unix_socket_path;
+
+    // The gRPC target of the worker of each shard.
+    std::vector<std::string> worker_targets;
+  };
+
+  // Returns a started router, or nullptr if the server could not be started.
+  static std::unique_ptr<ShardRouter> Create(const Options& options);
+
+  ~ShardRouter();
+
+  std::string host() const { return host_; }
+  int port() const { return port_; }
+
+  // Waits until every worker reports that it is serving on its health service,
+  // and then reports that the router is serving on its own.
+  absl::Status WaitForWorkers(absl::Duration timeout);
+
+  // Blocks until the server is shut down.
+  void WaitForShutdown();
+
+  // Shuts down the grpc server.
+  void Shutdown();
+
+ private:
+  class Call;
+  class Service;
+
+  explicit ShardRouter(const Options& options);
+
+  std::string host_;
+  int port_ = -1;
+
+  // A stub for the worker of each shard.
+  std::vector<std::unique_ptr<grpc::GenericStub>> stubs_;
+
+  std::unique_ptr<grpc::CallbackGenericService> service_;
+  std::unique_ptr<grpc::Server> grpc_server_;
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SHARD_ROUTER_H_
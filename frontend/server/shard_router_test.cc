@@ -0,0 +1,216 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/shard_router.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/longrunning/operations.pb.h"
+#include "google/spanner/admin/database/v1/spanner_database_admin.grpc.pb.h"
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.grpc.pb.h"
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "frontend/server/database_shards.h"
+#include "frontend/server/server.h"
+#include "grpcpp/client_context.h"
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+#include "grpcpp/support/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace database_api = ::google::spanner::admin::database::v1;
+namespace instance_api = ::google::spanner::admin::instance::v1;
+namespace spanner_api = ::google::spanner::v1;
+
+using ::testing::ElementsAre;
+using ::testing::Gt;
+
+constexpr char kInstanceUri[] = "projects/p/instances/i";
+constexpr char kDatabaseUri[] = "projects/p/instances/i/databases/d";
+
+TEST(RoutedDatabaseUriTest, FindsTheDatabaseOfRequests) {
+  spanner_api::ExecuteSqlRequest execute_sql;
+  execute_sql.set_session(absl::StrCat(kDatabaseUri, "/sessions/s"));
+  execute_sql.set_sql("SELECT 1");
+  EXPECT_EQ(RoutedDatabaseUri("/google.spanner.v1.Spanner/ExecuteSql",
+                              execute_sql.SerializeAsString()),
+            kDatabaseUri);
+
+  spanner_api::CreateSessionRequest create_session;
+  create_session.set_database(kDatabaseUri);
+  EXPECT_EQ(RoutedDatabaseUri("/google.spanner.v1.Spanner/CreateSession",
+                              create_session.SerializeAsString()),
+            kDatabaseUri);
+
+  database_api::CreateDatabaseRequest create_database;
+  create_database.set_parent(kInstanceUri);
+  create_database.set_create_statement("CREATE DATABASE `d`");
+  EXPECT_EQ(RoutedDatabaseUri(
+                "/google.spanner.admin.database.v1.DatabaseAdmin/"
+                "CreateDatabase",
+                create_database.SerializeAsString()),
+            kDatabaseUri);
+
+  database_api::ListDatabasesRequest list_databases;
+  list_databases.set_parent(kInstanceUri);
+  EXPECT_EQ(RoutedDatabaseUri(
+                "/google.spanner.admin.database.v1.DatabaseAdmin/"
+                "ListDatabases",
+                list_databases.SerializeAsString()),
+            "");
+}
+
+TEST(DatabaseShardTest, SpreadsDatabasesOverShards) {
+  std::vector<int> counts(4);
+  for (int i = 0; i < 400; ++i) {
+    const std::string database_uri =
+        absl::StrCat(kInstanceUri, "/databases/d", i);
+    const int shard = DatabaseShard(database_uri, counts.size());
+    EXPECT_EQ(shard, DatabaseShard(database_uri, counts.size()));
+    ++counts[shard];
+  }
+  EXPECT_THAT(counts, ElementsAre(Gt(50), Gt(50), Gt(50), Gt(50)));
+}
+
+TEST(ShardWorkersTest, LeavesOtherChildProcessesToTheirOwners) {
+  // The flags appended for the worker are ignored by the shell.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ShardWorkers> workers,
+      ShardWorkers::Start("/bin/sh", {"sh", "-c", "exec sleep 60"},
+                          /*num_shards=*/2, testing::TempDir()));
+
+  const pid_t child = ::fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    ::_exit(3);
+  }
+  int wait_status = 0;
+  ASSERT_EQ(::waitpid(child, &wait_status, 0), child);
+  ASSERT_TRUE(WIFEXITED(wait_status));
+  EXPECT_EQ(WEXITSTATUS(wait_status), 3);
+
+  // Destroying the workers terminates them and waits for them to exit.
+  workers.reset();
+}
+
+class ShardRouterTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ShardRouter::Options options{.server_address = "localhost:0"};
+    for (int shard = 0; shard < 2; ++shard) {
+      const std::string socket_path =
+          absl::StrCat(testing::TempDir(), "/shard-", shard);
+      workers_.push_back(
+          Server::Create(Server::Options{.unix_socket_path = socket_path}));
+      ASSERT_NE(workers_.back(), nullptr);
+      workers_.back()->SetReady();
+      options.worker_targets.push_back(absl::StrCat("unix:", socket_path));
+    }
+    router_ = ShardRouter::Create(options);
+    ASSERT_NE(router_, nullptr);
+    ZETASQL_ASSERT_OK(router_->WaitForWorkers(absl::Seconds(30)));
+    channel_ = grpc::CreateChannel(absl::StrCat("localhost:", router_->port()),
+                                   grpc::InsecureChannelCredentials());
+  }
+
+  std::vector<std::unique_ptr<Server>> workers_;
+  std::unique_ptr<ShardRouter> router_;
+  std::shared_ptr<grpc::Channel> channel_;
+};
+
+TEST_F(ShardRouterTest, RoutesDatabasesToTheirShard) {
+  auto instance_stub = instance_api::InstanceAdmin::NewStub(channel_);
+  {
+    grpc::ClientContext context;
+    instance_api::CreateInstanceRequest request;
+    request.set_parent("projects/p");
+    request.set_instance_id("i");
+    request.mutable_instance()->set_config("emulator-config");
+    request.mutable_instance()->set_node_count(1);
+    longrunning::Operation operation;
+    ASSERT_TRUE(
+        instance_stub->CreateInstance(&context, request, &operation).ok());
+  }
+
+  // Pick a database for each shard.
+  std::vector<std::string> database_ids(2);
+  for (int i = 0; database_ids[0].empty() || database_ids[1].empty(); ++i) {
+    const std::string database_id = absl::StrCat("d", i);
+    database_ids[DatabaseShard(absl::StrCat(kInstanceUri, "/databases/",
+                                            database_id),
+                               2)] = database_id;
+  }
+  auto database_stub = database_api::DatabaseAdmin::NewStub(channel_);
+  for (const std::string& database_id : database_ids) {
+    grpc::ClientContext context;
+    database_api::CreateDatabaseRequest request;
+    request.set_parent(kInstanceUri);
+    request.set_create_statement(
+        absl::StrCat("CREATE DATABASE `", database_id, "`"));
+    longrunning::Operation operation;
+    ASSERT_TRUE(
+        database_stub->CreateDatabase(&context, request, &operation).ok());
+  }
+
+  // Each worker only holds the database of its shard.
+  for (int shard = 0; shard < 2; ++shard) {
+    EXPECT_EQ(workers_[shard]->env()->database_manager()->ListAllDatabases()
+                  .size(),
+              1);
+    ZETASQL_EXPECT_OK(workers_[shard]->env()->database_manager()->GetDatabase(
+        absl::StrCat(kInstanceUri, "/databases/", database_ids[shard])));
+  }
+
+  grpc::ClientContext context;
+  database_api::ListDatabasesRequest request;
+  request.set_parent(kInstanceUri);
+  database_api::ListDatabasesResponse response;
+  ASSERT_TRUE(database_stub->ListDatabases(&context, request, &response).ok());
+  std::vector<std::string> names;
+  for (const database_api::Database& database : response.databases()) {
+    names.push_back(database.name());
+  }
+  std::vector<std::string> expected = {
+      absl::StrCat(kInstanceUri, "/databases/", database_ids[0]),
+      absl::StrCat(kInstanceUri, "/databases/", database_ids[1])};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(names, expected);
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,111 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/slow_rpc_log.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/message.h"
+#include "google/spanner/v1/spanner.pb.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "farmhash.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace spanner_api = ::google::spanner::v1;
+
+// Returns the fingerprint of sql, as reported in the text_fingerprint column
+// of SPANNER_SYS.QUERY_STATS_*.
+std::string SqlShape(absl::string_view sql) {
+  return absl::StrCat(
+      "sql:", static_cast<int64_t>(farmhash::Fingerprint64(sql)));
+}
+
+std::string ReadShape(
+    absl::string_view table, absl::string_view index,
+    const google::protobuf::RepeatedPtrField<std::string>& columns,
+    const spanner_api::KeySet& key_set) {
+  std::string shape = absl::StrCat("read:", table);
+  if (!index.empty()) absl::StrAppend(&shape, "@", index);
+  absl::StrAppend(&shape, "(", absl::StrJoin(columns, ","), ")");
+  if (key_set.all()) {
+    absl::StrAppend(&shape, " all");
+  } else {
+    absl::StrAppend(&shape, " keys:", key_set.keys_size(),
+                    " ranges:", key_set.ranges_size());
+  }
+  return shape;
+}
+
+double Milliseconds(absl::Duration duration) {
+  return absl::ToDoubleMilliseconds(duration);
+}
+
+}  // namespace
+
+std::string RequestShape(const google::protobuf::Message& request) {
+  if (auto* query = dynamic_cast<const spanner_api::ExecuteSqlRequest*>(
+          &request)) {
+    return SqlShape(query->sql());
+  }
+  if (auto* batch = dynamic_cast<const spanner_api::ExecuteBatchDmlRequest*>(
+          &request)) {
+    std::vector<std::string> statements;
+    for (const auto& statement : batch->statements()) {
+      statements.push_back(SqlShape(statement.sql()));
+    }
+    return absl::StrJoin(statements, " ");
+  }
+  if (auto* read = dynamic_cast<const spanner_api::ReadRequest*>(&request)) {
+    return ReadShape(read->table(), read->index(), read->columns(),
+                     read->key_set());
+  }
+  if (auto* commit =
+          dynamic_cast<const spanner_api::CommitRequest*>(&request)) {
+    return absl::StrCat("commit:", commit->mutations_size(), " mutations");
+  }
+  return "";
+}
+
+std::string SlowRpcRecordJson(const SlowRpcRecord& record) {
+  std::vector<std::string> stages;
+  for (const auto& [stage, duration] : record.stages) {
+    stages.push_back(absl::StrCat("\"", stage, "\":", Milliseconds(duration)));
+  }
+  return absl::StrCat(
+      "{\"method\":\"", record.method, "\",\"database\":\"",
+      record.database_uri, "\",\"shape\":\"", record.shape,
+      "\",\"latency_ms\":", Milliseconds(record.latency), ",\"status\":\"",
+      absl::StatusCodeToString(record.status_code), "\",\"rows_scanned\":",
+      record.rows_scanned, ",\"rows_returned\":", record.rows_returned,
+      ",\"stages_ms\":{", absl::StrJoin(stages, ","), "}}");
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
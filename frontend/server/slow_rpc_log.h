@@ -0,0 +1,73 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SLOW_RPC_LOG_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SLOW_RPC_LOG_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/message.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// What is logged about an RPC which ran for longer than --slow_rpc_threshold.
+struct SlowRpcRecord {
+  // E.g. "Spanner.ExecuteStreamingSql".
+  std::string method;
+
+  // Empty if the RPC is not against a database.
+  std::string database_uri;
+
+  // The work asked for, as returned by RequestShape.
+  std::string shape;
+
+  absl::Duration latency;
+  absl::StatusCode status_code = absl::StatusCode::kOk;
+
+  // The time spent in each stage of the RPC on its handler's thread, as timed
+  // by tracing::StageTimer. Stages nest, e.g. Transaction.GuardedCall
+  // includes the lock waits and query evaluation within it.
+  std::vector<std::pair<std::string, absl::Duration>> stages;
+
+  int64_t rows_scanned = 0;
+  int64_t rows_returned = 0;
+};
+
+// Returns what identifies the work asked for by request, leaving out its
+// parameters and keys, so that slow RPCs doing the same work look the same:
+// the fingerprints of the SQL statements of a query or DML, as in
+// SPANNER_SYS.QUERY_STATS_*, the table, index, columns and key set of a read,
+// or the number of mutations of a commit. Empty for other requests.
+std::string RequestShape(const google::protobuf::Message& request);
+
+// Returns record as a JSON object on a single line, with durations in
+// milliseconds.
+std::string SlowRpcRecordJson(const SlowRpcRecord& record);
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SLOW_RPC_LOG_H_
@@ -0,0 +1,89 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/slow_rpc_log.h"
+
+#include <cstdint>
+
+#include "google/spanner/v1/spanner.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "farmhash.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+namespace spanner_api = ::google::spanner::v1;
+
+TEST(SlowRpcLogTest, DescribesShapeOfRequests) {
+  spanner_api::ExecuteSqlRequest query;
+  query.set_sql("SELECT 1");
+  // Parameters are not part of the shape.
+  (*query.mutable_params()->mutable_fields())["p"].set_string_value("x");
+  EXPECT_EQ(RequestShape(query),
+            absl::StrCat("sql:", static_cast<int64_t>(
+                                     farmhash::Fingerprint64("SELECT 1"))));
+
+  spanner_api::ReadRequest read;
+  read.set_table("Users");
+  read.set_index("UsersByName");
+  read.add_columns("Id");
+  read.add_columns("Name");
+  read.mutable_key_set()->add_keys()->add_values()->set_string_value("a");
+  EXPECT_EQ(RequestShape(read), "read:Users@UsersByName(Id,Name) keys:1 "
+                                "ranges:0");
+  read.mutable_key_set()->set_all(true);
+  read.clear_index();
+  EXPECT_EQ(RequestShape(read), "read:Users(Id,Name) all");
+
+  spanner_api::CommitRequest commit;
+  commit.add_mutations();
+  EXPECT_EQ(RequestShape(commit), "commit:1 mutations");
+  EXPECT_EQ(RequestShape(spanner_api::CreateSessionRequest()), "");
+}
+
+TEST(SlowRpcLogTest, FormatsRecordAsJson) {
+  SlowRpcRecord record;
+  record.method = "Spanner.Read";
+  record.database_uri = "projects/p/instances/i/databases/d";
+  record.shape = "read:Users(Id) all";
+  record.latency = absl::Milliseconds(120);
+  record.status_code = absl::StatusCode::kDeadlineExceeded;
+  record.stages = {{"GetSession", absl::Microseconds(500)},
+                   {"LockManager.Wait", absl::Milliseconds(100)}};
+  record.rows_scanned = 10;
+  record.rows_returned = 2;
+  EXPECT_EQ(SlowRpcRecordJson(record),
+            "{\"method\":\"Spanner.Read\",\"database\":\"projects/p/instances"
+            "/i/databases/d\",\"shape\":\"read:Users(Id) all\",\"latency_ms\":"
+            "120,\"status\":\"DEADLINE_EXCEEDED\",\"rows_scanned\":10,"
+            "\"rows_returned\":2,\"stages_ms\":{\"GetSession\":0.5,"
+            "\"LockManager.Wait\":100}}");
+}
+
+}  // namespace
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
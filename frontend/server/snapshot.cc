@@ -0,0 +1,129 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/snapshot.h"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.pb.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "common/errors.h"
+#include "frontend/proto/emulator_snapshot.pb.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace instance_api = ::google::spanner::admin::instance::v1;
+
+absl::Status SaveSnapshot(ServerEnv* env, const std::string& path) {
+  EmulatorSnapshot snapshot;
+  for (const std::shared_ptr<Instance>& instance :
+       env->instance_manager()->ListAllInstances()) {
+    instance->ToProto(snapshot.add_instances());
+  }
+  const std::vector<std::shared_ptr<Database>> databases =
+      env->database_manager()->ListAllDatabases();
+  for (const std::shared_ptr<Database>& database : databases) {
+    EmulatorSnapshot::Database* database_snapshot = snapshot.add_databases();
+    database_snapshot->set_uri(database->database_uri());
+    ZETASQL_ASSIGN_OR_RETURN(*database_snapshot->mutable_snapshot(),
+                     database->backend()->CreateSnapshot());
+  }
+
+  // Write to a temporary file first so that an interrupted save does not
+  // destroy an existing snapshot.
+  const std::string temp_path = absl::StrCat(path, ".tmp");
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out || !snapshot.SerializeToOstream(&out)) {
+      return error::Internal(
+          absl::StrCat("Failed to write emulator snapshot to ", temp_path));
+    }
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    return error::Internal(
+        absl::StrCat("Failed to move emulator snapshot to ", path));
+  }
+
+  // Each database log now starts over from the saved snapshot of the database,
+  // so that replaying it on the next startup is as fast as restoring it.
+  for (int i = 0; i < databases.size(); ++i) {
+    ZETASQL_RETURN_IF_ERROR(databases[i]->backend()->ResetWriteAheadLog(
+        snapshot.databases(i).snapshot()));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RestoreSnapshot(const std::string& path, ServerEnv* env) {
+  EmulatorSnapshot snapshot;
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (!in || !snapshot.ParseFromIstream(&in)) {
+      return error::Internal(
+          absl::StrCat("Failed to read emulator snapshot from ", path));
+    }
+  }
+
+  for (instance_api::Instance& instance : *snapshot.mutable_instances()) {
+    // Instance::ToProto sets both node_count and processing_units, while an
+    // instance can only be created with one of them.
+    instance.clear_node_count();
+    ZETASQL_RETURN_IF_ERROR(
+        env->instance_manager()->CreateInstance(instance.name(), instance)
+            .status());
+  }
+  for (const EmulatorSnapshot::Database& database : snapshot.databases()) {
+    // A database log is at least as recent as the last saved snapshot, so such
+    // databases are left to ReplayWriteAheadLogs.
+    if (env->database_manager()->HasWriteAheadLog(database.uri())) {
+      continue;
+    }
+    ZETASQL_RETURN_IF_ERROR(env->database_manager()
+                        ->CreateDatabaseFromSnapshot(database.uri(),
+                                                     database.snapshot())
+                        .status());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SaveFixtures(ServerEnv* env) {
+  for (const std::shared_ptr<Database>& database :
+       env->database_manager()->ListAllDatabases()) {
+    const std::string path =
+        env->database_manager()->FixturePath(database->database_uri());
+    if (path.empty()) {
+      return error::Internal(
+          "Fixtures can only be saved with a fixture directory.");
+    }
+    // A fixture the database was created with stays mapped, as it is replaced
+    // rather than overwritten.
+    ZETASQL_RETURN_IF_ERROR(database->backend()->WriteFixture(path));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
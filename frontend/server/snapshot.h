@@ -0,0 +1,50 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SNAPSHOT_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SNAPSHOT_H_
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// Writes the instances and databases of env to the file at path, replacing
+// any existing file. Each database is captured as its schema and the rows
+// visible to a strong read; older row versions and change stream records are
+// not saved. The write ahead logs of the databases, if any, are compacted to
+// the saved snapshots.
+absl::Status SaveSnapshot(ServerEnv* env, const std::string& path);
+
+// Recreates the instances and databases saved by SaveSnapshot in env, except
+// for databases with a write ahead log, which are recovered from their logs.
+absl::Status RestoreSnapshot(const std::string& path, ServerEnv* env);
+
+// Writes a fixture of each database of env to its path in the fixture
+// directory of the database manager, see DatabaseManager::FixturePath.
+absl::Status SaveFixtures(ServerEnv* env);
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_SNAPSHOT_H_
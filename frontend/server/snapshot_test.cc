@@ -0,0 +1,120 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/snapshot.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/strings/str_cat.h"
+#include "backend/access/read.h"
+#include "backend/access/write.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/transaction/options.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+namespace {
+
+namespace instance_api = ::google::spanner::admin::instance::v1;
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+constexpr char kInstanceUri[] = "projects/test-project/instances/test-instance";
+constexpr char kDatabaseUri[] =
+    "projects/test-project/instances/test-instance/databases/test-database";
+
+TEST(SnapshotTest, RestoresInstancesAndDatabases) {
+  ServerEnv env;
+  instance_api::Instance instance_pb = PARSE_TEXT_PROTO(R"pb(
+    name: "projects/test-project/instances/test-instance"
+    display_name: "Test Instance"
+    node_count: 1
+  )pb");
+  ZETASQL_ASSERT_OK(env.instance_manager()->CreateInstance(kInstanceUri, instance_pb));
+  std::vector<std::string> statements = {R"(
+    CREATE TABLE T(
+      k INT64,
+      v STRING(MAX),
+    ) PRIMARY KEY(k)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<Database> database,
+      env.database_manager()->CreateDatabase(
+          kDatabaseUri,
+          backend::SchemaChangeOperation{.statements = statements}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<backend::ReadWriteTransaction> txn,
+                       database->backend()->CreateReadWriteTransaction(
+                           backend::ReadWriteOptions(), backend::RetryState()));
+  backend::Mutation m;
+  m.AddWriteOp(backend::MutationOpType::kInsert, "T", {"k", "v"},
+               {{Int64(1), String("one")}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_ASSERT_OK(txn->Commit());
+
+  const std::string path = absl::StrCat(testing::TempDir(), "/snapshot");
+  ZETASQL_ASSERT_OK(SaveSnapshot(&env, path));
+
+  ServerEnv restored_env;
+  ZETASQL_ASSERT_OK(RestoreSnapshot(path, &restored_env));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<Instance> instance,
+      restored_env.instance_manager()->GetInstance(kInstanceUri));
+  instance_api::Instance restored_instance_pb;
+  instance->ToProto(&restored_instance_pb);
+  EXPECT_EQ(restored_instance_pb.display_name(), "Test Instance");
+  EXPECT_EQ(restored_instance_pb.processing_units(), 1000);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<Database> restored_database,
+      restored_env.database_manager()->GetDatabase(kDatabaseUri));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<backend::ReadOnlyTransaction> ro_txn,
+      restored_database->backend()->CreateReadOnlyTransaction(
+          backend::ReadOnlyOptions()));
+  backend::ReadArg read_arg;
+  read_arg.table = "T";
+  read_arg.key_set = backend::KeySet::All();
+  read_arg.columns = {"k", "v"};
+  std::unique_ptr<backend::RowCursor> cursor;
+  ZETASQL_ASSERT_OK(ro_txn->Read(read_arg, &cursor));
+  ASSERT_TRUE(cursor->Next());
+  EXPECT_EQ(cursor->ColumnValue(0), Int64(1));
+  EXPECT_EQ(cursor->ColumnValue(1), String("one"));
+  EXPECT_FALSE(cursor->Next());
+}
+
+TEST(SnapshotTest, RestoreFailsForMissingFile) {
+  ServerEnv env;
+  EXPECT_FALSE(
+      RestoreSnapshot(absl::StrCat(testing::TempDir(), "/missing"), &env).ok());
+}
+
+}  // namespace
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
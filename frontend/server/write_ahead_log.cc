@@ -0,0 +1,77 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "frontend/server/write_ahead_log.h"
+
+#include <string>
+#include <vector>
+
+#include "google/spanner/admin/instance/v1/spanner_instance_admin.pb.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "frontend/common/uris.h"
+#include "frontend/server/database_shards.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace instance_api = ::google::spanner::admin::instance::v1;
+
+absl::Status EnsureWriteAheadLogInstance(ServerEnv* env,
+                                         const std::string& database_uri) {
+  absl::string_view project_id, instance_id, database_id;
+  ZETASQL_RETURN_IF_ERROR(
+      ParseDatabaseUri(database_uri, &project_id, &instance_id, &database_id));
+  const std::string instance_uri = MakeInstanceUri(project_id, instance_id);
+  if (env->instance_manager()->GetInstance(instance_uri).ok()) {
+    return absl::OkStatus();
+  }
+  instance_api::Instance instance;
+  instance.set_name(instance_uri);
+  instance.set_config(MakeInstanceConfigUri(project_id, "emulator-config"));
+  instance.set_display_name(std::string(instance_id));
+  instance.set_node_count(1);
+  return env->instance_manager()->CreateInstance(instance_uri, instance)
+      .status();
+}
+
+absl::Status ReplayWriteAheadLogs(ServerEnv* env) {
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<std::string> database_uris,
+                   env->database_manager()->ListWriteAheadLogs());
+  for (const std::string& database_uri : database_uris) {
+    // The workers started for --database_shards share the log directory.
+    if (!OwnsDatabase(database_uri)) {
+      continue;
+    }
+    ZETASQL_RETURN_IF_ERROR(EnsureWriteAheadLogInstance(env, database_uri));
+    absl::Status status =
+        env->database_manager()->RecoverDatabase(database_uri).status();
+    // A log without records belongs to a database whose creation never
+    // completed.
+    if (!status.ok() && !absl::IsNotFound(status)) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,45 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_WRITE_AHEAD_LOG_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_WRITE_AHEAD_LOG_H_
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// Recreates every database with a log in the write ahead log directory of env.
+// Instances which do not exist yet, because they were not restored from a
+// snapshot, are created with the emulator instance config and a single node.
+absl::Status ReplayWriteAheadLogs(ServerEnv* env);
+
+// Creates the instance of the database at database_uri in env, as described
+// above, if it does not exist yet.
+absl::Status EnsureWriteAheadLogInstance(ServerEnv* env,
+                                         const std::string& database_uri);
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_WRITE_AHEAD_LOG_H_
@@ -0,0 +1,280 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/write_ahead_log_follower.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/database/database.h"
+#include "backend/database/write_ahead_log.h"
+#include "backend/database/write_ahead_log.pb.h"
+#include "common/errors.h"
+#include "frontend/collections/database_manager.h"
+#include "frontend/entities/database.h"
+#include "frontend/entities/session.h"
+#include "frontend/server/write_ahead_log.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+namespace {
+
+// Returns the inode and size of the file at path, or false if it is gone.
+bool StatLog(const std::string& path, ino_t* inode, int64_t* size) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0) {
+    return false;
+  }
+  *inode = st.st_ino;
+  *size = st.st_size;
+  return true;
+}
+
+}  // namespace
+
+struct WriteAheadLogFollower::FollowedLog {
+  FollowedLog(std::string database_uri, std::string path)
+      : database_uri(std::move(database_uri)), path(std::move(path)) {}
+
+  const std::string database_uri;
+  const std::string path;
+
+  absl::Mutex mu;
+
+  // The copy of the database, or null once it has been dropped.
+  std::shared_ptr<Database> database ABSL_GUARDED_BY(mu);
+
+  // The inode of the log file the copy was loaded from. A compacted log is
+  // renamed over the old one, so it has a different inode.
+  ino_t inode ABSL_GUARDED_BY(mu) = 0;
+
+  // The end of the records applied to the copy.
+  int64_t offset ABSL_GUARDED_BY(mu) = 0;
+};
+
+absl::StatusOr<std::unique_ptr<WriteAheadLogFollower>>
+WriteAheadLogFollower::Start(ServerEnv* env, const std::string& log_dir,
+                             absl::Duration poll_interval) {
+  auto follower = absl::WrapUnique(new WriteAheadLogFollower(env, log_dir));
+  ZETASQL_RETURN_IF_ERROR(follower->Poll());
+  follower->poll_thread_ = std::thread(&WriteAheadLogFollower::PeriodicallyPoll,
+                                       follower.get(), poll_interval);
+  return follower;
+}
+
+WriteAheadLogFollower::WriteAheadLogFollower(ServerEnv* env,
+                                             std::string log_dir)
+    : env_(env), log_dir_(std::move(log_dir)) {}
+
+WriteAheadLogFollower::~WriteAheadLogFollower() {
+  {
+    absl::MutexLock lock(&stop_mu_);
+    stop_polling_ = true;
+  }
+  if (poll_thread_.joinable()) {
+    poll_thread_.join();
+  }
+}
+
+void WriteAheadLogFollower::PeriodicallyPoll(absl::Duration poll_interval) {
+  while (true) {
+    {
+      absl::MutexLock lock(&stop_mu_);
+      stop_mu_.AwaitWithTimeout(absl::Condition(&stop_polling_), poll_interval);
+      if (stop_polling_) {
+        return;
+      }
+    }
+    absl::Status status = Poll();
+    if (!status.ok()) {
+      ZETASQL_LOG(WARNING) << "Failed to follow write ahead logs in " << log_dir_
+                   << ": " << status;
+    }
+  }
+}
+
+absl::Status WriteAheadLogFollower::Poll() {
+  absl::MutexLock lock(&poll_mu_);
+  ZETASQL_ASSIGN_OR_RETURN(std::vector<std::string> database_uris,
+                   DatabaseManager::ListWriteAheadLogsIn(log_dir_));
+  absl::Status status;
+
+  // The log of a dropped database is removed.
+  for (auto it = logs_.begin(); it != logs_.end();) {
+    if (std::binary_search(database_uris.begin(), database_uris.end(),
+                           it->first)) {
+      ++it;
+      continue;
+    }
+    status.Update(Drop(it->second.get()));
+    it = logs_.erase(it);
+  }
+
+  for (const std::string& database_uri : database_uris) {
+    auto it = logs_.find(database_uri);
+    if (it != logs_.end()) {
+      absl::StatusOr<bool> caught_up = CatchUp(it->second.get());
+      if (caught_up.value_or(false)) {
+        continue;
+      }
+      status.Update(caught_up.status());
+      status.Update(Drop(it->second.get()));
+      logs_.erase(it);
+    }
+    absl::StatusOr<std::shared_ptr<FollowedLog>> log = Load(database_uri);
+    if (log.ok()) {
+      logs_[database_uri] = std::move(log).value();
+    } else if (!absl::IsNotFound(log.status())) {
+      // A log without a snapshot belongs to a database which is still being
+      // created, and is loaded by a later poll.
+      status.Update(log.status());
+    }
+  }
+  return status;
+}
+
+absl::StatusOr<std::shared_ptr<WriteAheadLogFollower::FollowedLog>>
+WriteAheadLogFollower::Load(const std::string& database_uri) {
+  ZETASQL_RETURN_IF_ERROR(EnsureWriteAheadLogInstance(env_, database_uri));
+  auto log = std::make_shared<FollowedLog>(
+      database_uri,
+      DatabaseManager::WriteAheadLogPathIn(log_dir_, database_uri));
+  std::weak_ptr<FollowedLog> weak_log = log;
+
+  // Strong reads of the new copy wait here until it is loaded, since its
+  // catch up function needs log->mu.
+  absl::MutexLock lock(&log->mu);
+  int64_t size;
+  if (!StatLog(log->path, &log->inode, &size)) {
+    return error::DatabaseNotFound(database_uri);
+  }
+  std::shared_ptr<Database> database;
+  absl::StatusOr<int64_t> offset = backend::WriteAheadLog::Replay(
+      log->path,
+      [&](const backend::WriteAheadLogRecord& record) -> absl::Status {
+        if (database != nullptr) {
+          return database->backend()->ReplayWriteAheadLogRecord(record);
+        }
+        if (!record.has_snapshot()) {
+          return error::Internal(
+              absl::StrCat("Write ahead log of ", database_uri,
+                           " does not start with a snapshot"));
+        }
+        ZETASQL_ASSIGN_OR_RETURN(database,
+                         env_->database_manager()->CreateDatabaseFromSnapshot(
+                             database_uri, record.snapshot()));
+        database->SetCatchUp([weak_log, database_uri]() -> absl::Status {
+          std::shared_ptr<FollowedLog> log = weak_log.lock();
+          if (log == nullptr) {
+            // The follower has stopped.
+            return absl::OkStatus();
+          }
+          ZETASQL_ASSIGN_OR_RETURN(bool caught_up, CatchUp(log.get()));
+          if (!caught_up) {
+            return error::FollowerDatabaseReloading(database_uri);
+          }
+          return absl::OkStatus();
+        });
+        return absl::OkStatus();
+      });
+  if (!offset.ok() || database == nullptr) {
+    if (database != nullptr) {
+      env_->database_manager()->DeleteDatabase(database_uri).IgnoreError();
+    }
+    return offset.ok() ? error::DatabaseNotFound(database_uri)
+                       : offset.status();
+  }
+
+  // A log compacted while it was being read is loaded again by the next poll.
+  ino_t inode;
+  if (!StatLog(log->path, &inode, &size) || inode != log->inode) {
+    log->inode = 0;
+  }
+  log->database = std::move(database);
+  log->offset = offset.value();
+  return log;
+}
+
+absl::Status WriteAheadLogFollower::Drop(FollowedLog* log) {
+  std::shared_ptr<Database> database;
+  {
+    absl::MutexLock lock(&log->mu);
+    database = std::move(log->database);
+    log->database = nullptr;
+  }
+  if (database == nullptr) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::vector<std::shared_ptr<Session>> sessions,
+      env_->session_manager()->ListSessions(log->database_uri));
+  for (const auto& session : sessions) {
+    ZETASQL_RETURN_IF_ERROR(
+        env_->session_manager()->DeleteSession(session->session_uri()));
+  }
+  return env_->database_manager()->DeleteDatabase(log->database_uri);
+}
+
+absl::StatusOr<bool> WriteAheadLogFollower::CatchUp(FollowedLog* log) {
+  absl::MutexLock lock(&log->mu);
+  ino_t inode;
+  int64_t size;
+  if (log->database == nullptr || !StatLog(log->path, &inode, &size) ||
+      inode != log->inode || size < log->offset) {
+    return false;
+  }
+  if (size == log->offset) {
+    return true;
+  }
+  backend::Database* backend = log->database->backend();
+  absl::StatusOr<int64_t> offset = backend::WriteAheadLog::Replay(
+      log->path,
+      [backend](const backend::WriteAheadLogRecord& record) {
+        return backend->ReplayWriteAheadLogRecord(record);
+      },
+      log->offset);
+  if (!offset.ok()) {
+    // Some of the records may have been applied, so the copy is loaded again.
+    log->inode = 0;
+    return offset.status();
+  }
+  log->offset = offset.value();
+  return true;
+}
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
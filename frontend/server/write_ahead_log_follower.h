@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_WRITE_AHEAD_LOG_FOLLOWER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_WRITE_AHEAD_LOG_FOLLOWER_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+
+// WriteAheadLogFollower keeps read-only copies of the databases of another
+// emulator process, whose write ahead log directory it tails, so that reads
+// can be spread over several processes.
+//
+// Each log found in the directory is loaded into a database of env, and the
+// commits, schema changes and bulk loads appended to it afterwards are applied
+// in log order, at timestamps of this process. Strong reads first apply every
+// record logged so far, see Database::SetCatchUp, while stale reads see the
+// records applied by the last poll. When a log is removed, or replaced by a
+// compacted one, the copy and its sessions are deleted, and the database is
+// loaded again.
+class WriteAheadLogFollower {
+ public:
+  // Loads the logs in log_dir into env, and then polls log_dir in the
+  // background every poll_interval until the follower is destroyed.
+  static absl::StatusOr<std::unique_ptr<WriteAheadLogFollower>> Start(
+      ServerEnv* env, const std::string& log_dir,
+      absl::Duration poll_interval);
+
+  ~WriteAheadLogFollower();
+
+  // Loads new logs, drops the copies of removed ones and applies the records
+  // appended to the others. Called by the polling thread.
+  absl::Status Poll() ABSL_LOCKS_EXCLUDED(poll_mu_);
+
+ private:
+  struct FollowedLog;
+
+  WriteAheadLogFollower(ServerEnv* env, std::string log_dir);
+  WriteAheadLogFollower(const WriteAheadLogFollower&) = delete;
+  WriteAheadLogFollower& operator=(const WriteAheadLogFollower&) = delete;
+
+  // Creates the copy of the database at database_uri from its log. Returns
+  // NOT_FOUND if the log does not hold a complete snapshot yet.
+  absl::StatusOr<std::shared_ptr<FollowedLog>> Load(
+      const std::string& database_uri) ABSL_EXCLUSIVE_LOCKS_REQUIRED(poll_mu_);
+
+  // Deletes the copy of log's database and the sessions using it.
+  absl::Status Drop(FollowedLog* log) ABSL_EXCLUSIVE_LOCKS_REQUIRED(poll_mu_);
+
+  // Applies the records appended to log since it was last read. Returns false
+  // if the log was replaced or removed since it was loaded, or could not be
+  // applied, in which case the copy has to be loaded again.
+  static absl::StatusOr<bool> CatchUp(FollowedLog* log);
+
+  // Calls Poll every poll_interval until stop_polling_ is set.
+  void PeriodicallyPoll(absl::Duration poll_interval);
+
+  ServerEnv* env_;
+
+  const std::string log_dir_;
+
+  // Serializes polls, and with them the loading and dropping of copies.
+  absl::Mutex poll_mu_;
+
+  // The logs being followed, by database URI.
+  std::map<std::string, std::shared_ptr<FollowedLog>> logs_
+      ABSL_GUARDED_BY(poll_mu_);
+
+  absl::Mutex stop_mu_;
+  bool stop_polling_ ABSL_GUARDED_BY(stop_mu_) = false;
+  std::thread poll_thread_;
+};
+
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_SERVER_WRITE_AHEAD_LOG_FOLLOWER_H_
@@ -0,0 +1,159 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "frontend/server/write_ahead_log_follower.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "backend/access/read.h"
+#include "backend/access/write.h"
+#include "backend/datamodel/key_set.h"
+#include "backend/transaction/options.h"
+#include "common/clock.h"
+#include "frontend/collections/database_manager.h"
+#include "frontend/server/environment.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace frontend {
+namespace {
+
+using zetasql::values::Int64;
+using ::testing::ElementsAre;
+using ::zetasql_base::testing::StatusIs;
+
+constexpr char kDatabaseUri[] =
+    "projects/test-project/instances/test-instance/databases/test-database";
+
+class WriteAheadLogFollowerTest : public testing::Test {
+ protected:
+  WriteAheadLogFollowerTest()
+      : log_dir_(testing::TempDir()),
+        primary_(&clock_, DatabaseManagerOptions{
+                              .write_ahead_log_dir = log_dir_,
+                              .sync_write_ahead_log = false,
+                          }) {}
+
+  void SetUp() override {
+    std::vector<std::string> statements = {
+        "CREATE TABLE T(k INT64) PRIMARY KEY(k)"};
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        primary_database_,
+        primary_.CreateDatabase(
+            kDatabaseUri,
+            backend::SchemaChangeOperation{.statements = statements}));
+  }
+
+  void TearDown() override {
+    follower_.reset();
+    ZETASQL_EXPECT_OK(primary_.DeleteDatabase(kDatabaseUri));
+  }
+
+  void Insert(int64_t k) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<backend::ReadWriteTransaction> txn,
+        primary_database_->backend()->CreateReadWriteTransaction(
+            backend::ReadWriteOptions(), backend::RetryState()));
+    backend::Mutation m;
+    m.AddWriteOp(backend::MutationOpType::kInsert, "T", {"k"}, {{Int64(k)}});
+    ZETASQL_ASSERT_OK(txn->Write(m));
+    ZETASQL_ASSERT_OK(txn->Commit());
+  }
+
+  // Returns the keys of T in the follower's copy of the database.
+  std::vector<int64_t> ReadKeys() {
+    std::vector<int64_t> keys;
+    absl::StatusOr<std::shared_ptr<Database>> database =
+        env_.database_manager()->GetDatabase(kDatabaseUri);
+    EXPECT_TRUE(database.ok());
+    if (!database.ok()) {
+      return keys;
+    }
+    EXPECT_TRUE((*database)->CatchUp().ok());
+    absl::StatusOr<std::unique_ptr<backend::ReadOnlyTransaction>> txn =
+        (*database)->backend()->CreateReadOnlyTransaction(
+            backend::ReadOnlyOptions());
+    EXPECT_TRUE(txn.ok());
+    backend::ReadArg read_arg;
+    read_arg.table = "T";
+    read_arg.key_set = backend::KeySet::All();
+    read_arg.columns = {"k"};
+    std::unique_ptr<backend::RowCursor> cursor;
+    EXPECT_TRUE((*txn)->Read(read_arg, &cursor).ok());
+    while (cursor->Next()) {
+      keys.push_back(cursor->ColumnValue(0).int64_value());
+    }
+    return keys;
+  }
+
+  const std::string log_dir_;
+  Clock clock_;
+  DatabaseManager primary_;
+  std::shared_ptr<Database> primary_database_;
+  ServerEnv env_;
+  std::unique_ptr<WriteAheadLogFollower> follower_;
+};
+
+TEST_F(WriteAheadLogFollowerTest, StrongReadsSeeEveryLoggedCommit) {
+  Insert(1);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(follower_, WriteAheadLogFollower::Start(
+                                      &env_, log_dir_, absl::Hours(1)));
+  EXPECT_THAT(ReadKeys(), ElementsAre(1));
+
+  // Reads catch up without waiting for the next poll.
+  Insert(2);
+  Insert(3);
+  EXPECT_THAT(ReadKeys(), ElementsAre(1, 2, 3));
+}
+
+TEST_F(WriteAheadLogFollowerTest, PollPicksUpSchemaChangesAndDrops) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(follower_, WriteAheadLogFollower::Start(
+                                      &env_, log_dir_, absl::Hours(1)));
+  int num_successful_statements;
+  absl::Time commit_timestamp;
+  absl::Status backfill_status;
+  std::vector<std::string> statements = {
+      "CREATE TABLE U(k INT64) PRIMARY KEY(k)"};
+  ZETASQL_ASSERT_OK(primary_database_->backend()->UpdateSchema(
+      backend::SchemaChangeOperation{.statements = statements},
+      &num_successful_statements, &commit_timestamp, &backfill_status));
+  ZETASQL_ASSERT_OK(follower_->Poll());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Database> copy,
+                       env_.database_manager()->GetDatabase(kDatabaseUri));
+  EXPECT_NE(copy->backend()->GetLatestSchema()->FindTable("U"), nullptr);
+
+  ZETASQL_ASSERT_OK(primary_.DeleteDatabase(kDatabaseUri));
+  EXPECT_THAT(copy->CatchUp(), StatusIs(absl::StatusCode::kUnavailable));
+  ZETASQL_ASSERT_OK(follower_->Poll());
+  EXPECT_THAT(env_.database_manager()->GetDatabase(kDatabaseUri),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+}  // namespace frontend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -350,7 +350,7 @@ void TestChangeStreamEffectsBuffer::LogTableMod(
         column_types.begin(), column_types.end()};
     Mod mod{tracked_table->primary_key(),
             non_key_cols,
-            key.column_values(),
+            {key.column_values().begin(), key.column_values().end()},
             new_values_for_tracked_cols,
             {}};
     last_mod_group_by_change_stream_[change_stream].mods.push_back(mod);
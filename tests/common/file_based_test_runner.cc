@@ -16,8 +16,12 @@
 
 #include "tests/common/file_based_test_runner.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <fstream>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -25,12 +29,21 @@
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/strip.h"
+#include "absl/time/clock.h"
 #include "tests/common/file_based_test_util.h"
 #include "re2/re2.h"
 
+ABSL_FLAG(int, file_based_test_workers, 0,
+          "If positive, file-based test suites which support it run all of "
+          "their cases in a single test, on this many threads with a database "
+          "per case, and log the time taken by each case. If zero, each case "
+          "runs as a test of its own.");
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -130,6 +143,54 @@ std::vector<FileBasedTestCase> ReadTestCasesFromFile(
   return test_cases;
 }
 
+int FileBasedTestWorkers() {
+  return std::max(absl::GetFlag(FLAGS_file_based_test_workers), 0);
+}
+
+std::vector<FileBasedTestCaseResult> RunTestCasesInParallel(
+    absl::Span<const FileBasedTestCase> test_cases, int num_workers,
+    const std::function<absl::StatusOr<FileBasedTestCaseOutput>(
+        const FileBasedTestCaseInput&)>& run_test_case) {
+  std::vector<FileBasedTestCaseResult> results(test_cases.size());
+  std::atomic<size_t> next_case = 0;
+  auto run_worker = [&]() {
+    for (size_t i = next_case++; i < test_cases.size(); i = next_case++) {
+      const absl::Time start = absl::Now();
+      results[i].output = run_test_case(test_cases[i].input);
+      results[i].duration = absl::Now() - start;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < std::max(num_workers, 1); ++i) {
+    workers.emplace_back(run_worker);
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  return results;
+}
+
+std::string FormatTestCaseTimings(
+    absl::Span<const FileBasedTestCase> test_cases,
+    absl::Span<const FileBasedTestCaseResult> results) {
+  std::vector<size_t> order(std::min(test_cases.size(), results.size()));
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return results[a].duration > results[b].duration;
+  });
+
+  std::string report;
+  for (size_t i : order) {
+    absl::StrAppend(&report, test_cases[i].input.file_name, ":",
+                    test_cases[i].input.line_no, "\t",
+                    absl::ToDoubleMilliseconds(results[i].duration), "\n");
+  }
+  return report;
+}
+
 std::string GetRunfilesDir(const std::string& dir) {
   return GetTestFileDir(
       absl::StrCat("com_google_cloud_spanner_emulator", "/", dir));
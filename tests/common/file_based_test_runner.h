@@ -22,6 +22,9 @@
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -83,6 +86,33 @@ std::vector<FileBasedTestCase> ReadTestCasesFromFile(
     const FileBasedTestOptions& options
 );
 
+// Returns the number of threads file-based test cases are to be run on with
+// RunTestCasesInParallel, as set by --file_based_test_workers, or 0 if each
+// case is to be run as a test of its own.
+int FileBasedTestWorkers();
+
+// Output of a file-based test case run by RunTestCasesInParallel, and the time
+// it took to run.
+struct FileBasedTestCaseResult {
+  absl::StatusOr<FileBasedTestCaseOutput> output;
+  absl::Duration duration;
+};
+
+// Runs `test_cases` with `run_test_case` on `num_workers` threads, each case on
+// the next free thread, and returns their results in the order of
+// `test_cases`. The cases must be independent of each other, e.g. by running
+// each against its own database.
+std::vector<FileBasedTestCaseResult> RunTestCasesInParallel(
+    absl::Span<const FileBasedTestCase> test_cases, int num_workers,
+    const std::function<absl::StatusOr<FileBasedTestCaseOutput>(
+        const FileBasedTestCaseInput&)>& run_test_case);
+
+// Returns a report of the time taken by each of `test_cases`, slowest first,
+// with one "<file>:<line>\t<milliseconds>" line per case.
+std::string FormatTestCaseTimings(
+    absl::Span<const FileBasedTestCase> test_cases,
+    absl::Span<const FileBasedTestCaseResult> results);
+
 // Returns the runfiles directory for the given source-root relative directory.
 std::string GetRunfilesDir(const std::string& dir);
 
@@ -0,0 +1,100 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tests/common/file_based_test_runner.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace {
+
+using google::spanner::emulator::test::FileBasedTestCase;
+using google::spanner::emulator::test::FileBasedTestCaseInput;
+using google::spanner::emulator::test::FileBasedTestCaseOutput;
+using google::spanner::emulator::test::FileBasedTestCaseResult;
+using google::spanner::emulator::test::FormatTestCaseTimings;
+using google::spanner::emulator::test::RunTestCasesInParallel;
+
+std::vector<FileBasedTestCase> MakeTestCases(int num_cases) {
+  std::vector<FileBasedTestCase> test_cases;
+  for (int i = 0; i < num_cases; ++i) {
+    test_cases.emplace_back("cases.test", i + 1);
+    test_cases.back().input.text = absl::StrCat(i);
+  }
+  return test_cases;
+}
+
+TEST(FileBasedTestRunnerTest, RunsEveryCaseConcurrently) {
+  const std::vector<FileBasedTestCase> test_cases = MakeTestCases(8);
+  absl::Mutex mu;
+  int running = 0;
+  int max_running = 0;
+  std::vector<FileBasedTestCaseResult> results = RunTestCasesInParallel(
+      test_cases, /*num_workers=*/4,
+      [&](const FileBasedTestCaseInput& input)
+          -> absl::StatusOr<FileBasedTestCaseOutput> {
+        {
+          absl::MutexLock lock(&mu);
+          max_running = std::max(max_running, ++running);
+        }
+        absl::SleepFor(absl::Milliseconds(20));
+        {
+          absl::MutexLock lock(&mu);
+          --running;
+        }
+        if (input.text == "3") {
+          return absl::InternalError("failed");
+        }
+        return FileBasedTestCaseOutput{.text = input.text};
+      });
+
+  ASSERT_EQ(results.size(), test_cases.size());
+  EXPECT_GT(max_running, 1);
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (i == 3) {
+      EXPECT_THAT(results[i].output,
+                  zetasql_base::testing::StatusIs(absl::StatusCode::kInternal));
+    } else {
+      ZETASQL_ASSERT_OK(results[i].output.status());
+      EXPECT_EQ(results[i].output->text, test_cases[i].input.text);
+    }
+    EXPECT_GE(results[i].duration, absl::Milliseconds(20));
+  }
+}
+
+TEST(FileBasedTestRunnerTest, FormatsSlowestCasesFirst) {
+  const std::vector<FileBasedTestCase> test_cases = MakeTestCases(2);
+  std::vector<FileBasedTestCaseResult> results(2);
+  results[0].duration = absl::Milliseconds(1);
+  results[1].duration = absl::Milliseconds(2.5);
+  EXPECT_EQ(FormatTestCaseTimings(test_cases, results),
+            "cases.test:2\t2.5\ncases.test:1\t1\n");
+}
+
+}  // namespace
@@ -17,6 +17,7 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_TESTS_COMMON_ROW_READER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_TESTS_COMMON_ROW_READER_H_
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -77,7 +78,8 @@ class ColumnRemappedRowCursor : public backend::RowCursor {
 
 // A fake implementation of DBReader for testing purposes.
 //
-// 'index' and 'key_set' in the input are ignored.
+// 'index' and 'key_set' in the input are ignored. Rows are returned in the
+// order given, or in the opposite order for a reverse read.
 class TestRowReader : public backend::RowReader {
  public:
   struct Table {
@@ -95,10 +97,15 @@ class TestRowReader : public backend::RowReader {
     if (!tables_.contains(table_name)) {
       return google::spanner::emulator::error::TableNotFound(table_name);
     }
+    std::vector<std::vector<zetasql::Value>> rows =
+        tables_[table_name].column_values;
+    if (read_arg.reverse) {
+      std::reverse(rows.begin(), rows.end());
+    }
     *cursor = std::make_unique<ColumnRemappedRowCursor>(
         std::make_unique<TestRowCursor>(tables_[table_name].column_names,
                                         tables_[table_name].column_types,
-                                        tables_[table_name].column_values),
+                                        rows),
         read_arg.columns);
     return absl::OkStatus();
   }
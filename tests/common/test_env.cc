@@ -23,6 +23,7 @@
 
 #include "zetasql/base/logging.h"
 #include "google/longrunning/operations.grpc.pb.h"
+#include "google/protobuf/empty.pb.h"
 #include "google/spanner/admin/database/v1/spanner_database_admin.grpc.pb.h"
 #include "google/spanner/admin/instance/v1/spanner_instance_admin.grpc.pb.h"
 #include "google/spanner/v1/spanner.grpc.pb.h"
@@ -32,7 +33,10 @@
 #include "frontend/server/server.h"
 #include "grpcpp/channel.h"
 #include "grpcpp/create_channel.h"
+#include "grpcpp/impl/client_unary_call.h"
+#include "grpcpp/impl/rpc_method.h"
 #include "grpcpp/security/credentials.h"
+#include "grpcpp/support/sync_stream.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -42,11 +46,12 @@ namespace test {
 
 namespace {
 
+template <typename ResponseT>
 absl::Status ReadFromClientReader(
-    std::unique_ptr<grpc::ClientReader<spanner_api::PartialResultSet>> reader,
-    std::vector<spanner_api::PartialResultSet>* response) {
+    std::unique_ptr<grpc::ClientReader<ResponseT>> reader,
+    std::vector<ResponseT>* response) {
   response->clear();
-  spanner_api::PartialResultSet result;
+  ResponseT result;
   while (reader->Read(&result)) {
     response->push_back(result);
   }
@@ -81,14 +86,14 @@ void TestEnv::SetupServer() {
 }
 
 void TestEnv::SetupClientStubs() {
-  std::shared_ptr<::grpc::Channel> channel =
+  channel_ =
       ::grpc::CreateChannel(host_port_, ::grpc::InsecureChannelCredentials());
-  spanner_client_ = v1::Spanner::NewStub(channel);
+  spanner_client_ = v1::Spanner::NewStub(channel_);
   database_admin_client_ =
-      admin::database::v1::DatabaseAdmin::NewStub(channel);
+      admin::database::v1::DatabaseAdmin::NewStub(channel_);
   instance_admin_client_ =
-      admin::instance::v1::InstanceAdmin::NewStub(channel);
-  operations_client_ = longrunning::Operations::NewStub(channel);
+      admin::instance::v1::InstanceAdmin::NewStub(channel_);
+  operations_client_ = longrunning::Operations::NewStub(channel_);
   ZETASQL_LOG(INFO) << "Client stubs setup finished.";
 }
 
@@ -112,6 +117,34 @@ absl::Status ServerTest::ExecuteStreamingSql(
   return ReadFromClientReader(std::move(client_reader), response);
 }
 
+absl::Status ServerTest::BatchWrite(
+    const frontend::BatchWriteRequest& request,
+    std::vector<frontend::BatchWriteResponse>* response) {
+  grpc::ClientContext ctx;
+  std::unique_ptr<grpc::ClientReader<frontend::BatchWriteResponse>>
+      client_reader(
+          grpc::internal::ClientReaderFactory<frontend::BatchWriteResponse>::
+              Create(test_env()->channel().get(),
+                     grpc::internal::RpcMethod(
+                         "/google.spanner.v1.Spanner/BatchWrite",
+                         grpc::internal::RpcMethod::SERVER_STREAMING),
+                     &ctx, request));
+  return ReadFromClientReader(std::move(client_reader), response);
+}
+
+absl::Status ServerTest::ResetDatabase(const std::string& database_uri) {
+  grpc::ClientContext ctx;
+  frontend::ResetDatabaseRequest request;
+  request.set_database(database_uri);
+  protobuf::Empty response;
+  return grpc::internal::BlockingUnaryCall(
+      test_env()->channel().get(),
+      grpc::internal::RpcMethod(
+          "/google.spanner.emulator.frontend.EmulatorAdmin/ResetDatabase",
+          grpc::internal::RpcMethod::NORMAL_RPC),
+      &ctx, request, &response);
+}
+
 }  // namespace test
 }  // namespace emulator
 }  // namespace spanner
@@ -36,6 +36,8 @@
 #include "absl/synchronization/notification.h"
 #include "absl/time/clock.h"
 #include "frontend/common/uris.h"
+#include "frontend/proto/batch_write.pb.h"
+#include "frontend/proto/emulator_admin.pb.h"
 #include "frontend/server/server.h"
 #include "tests/common/proto_matchers.h"
 #include "absl/status/status.h"
@@ -70,12 +72,14 @@ class TestEnv {
   }
   OperationsStub* operations_client() const { return operations_client_.get(); }
   SpannerStub* spanner_client() const { return spanner_client_.get(); }
+  std::shared_ptr<grpc::Channel> channel() const { return channel_; }
 
  private:
   void SetupServer();
   void SetupClientStubs();
   void WaitForServerReady();
 
+  std::shared_ptr<grpc::Channel> channel_;
   std::unique_ptr<SpannerStub> spanner_client_;
   std::unique_ptr<DatabaseAdminStub> database_admin_client_;
   std::unique_ptr<InstanceAdminStub> instance_admin_client_;
@@ -280,6 +284,14 @@ class ServerTest : public testing::Test {
       const spanner_api::ExecuteSqlRequest& request,
       std::vector<spanner_api::PartialResultSet>* response);
 
+  // Calls Spanner.BatchWrite, which the generated Spanner stub does not have.
+  absl::Status BatchWrite(
+      const frontend::BatchWriteRequest& request,
+      std::vector<frontend::BatchWriteResponse>* response);
+
+  // Calls EmulatorAdmin.ResetDatabase, for which there is no generated stub.
+  absl::Status ResetDatabase(const std::string& database_uri);
+
  private:
   TestEnv test_env_;
 };
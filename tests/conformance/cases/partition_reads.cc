@@ -202,6 +202,46 @@ TEST_F(PartitionReadsTest, CanReuseTransactionForPartitionReads) {
   }
 }
 
+TEST_F(PartitionReadsTest, SplitsReadIntoPartitionsOfRequestedSize) {
+  PopulateDatabase();
+
+  Transaction txn{Transaction::ReadOnlyOptions{}};
+
+  // Every row is larger than a single byte, so each gets its own partition.
+  PartitionOptions partition_options = {.partition_size_bytes = 1};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<ReadPartition> partitions,
+      PartitionRead(txn, "Users", KeySet::All(), {"UserId", "Name"},
+                    /**read_options =*/{}, partition_options));
+  EXPECT_EQ(partitions.size(), 3);
+
+  for (const ReadPartition& partition : partitions) {
+    EXPECT_THAT(Read({partition}),
+                zetasql_base::testing::IsOkAndHolds(testing::SizeIs(1)));
+  }
+  EXPECT_THAT(
+      Read(partitions),
+      IsOkAndHoldsUnorderedRows({{1, "Levin"}, {2, "Mark"}, {10, "Douglas"}}));
+}
+
+TEST_F(PartitionReadsTest, SplitsRangeIntoAtMostMaxPartitions) {
+  PopulateDatabase();
+
+  Transaction txn{Transaction::ReadOnlyOptions{}};
+
+  PartitionOptions partition_options = {.partition_size_bytes = 1,
+                                        .max_partitions = 2};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<ReadPartition> partitions,
+      PartitionRead(txn, "Users", OpenClosed(Key(1), Key(10)),
+                    {"UserId", "Name"}, /**read_options =*/{},
+                    partition_options));
+  EXPECT_EQ(partitions.size(), 2);
+
+  EXPECT_THAT(Read(partitions),
+              IsOkAndHoldsUnorderedRows({{2, "Mark"}, {10, "Douglas"}}));
+}
+
 TEST_F(PartitionReadsTest, CannotSetReadLimitWithPartitionToken) {
   ZETASQL_ASSERT_OK_AND_ASSIGN(auto session, CreateSession());
 
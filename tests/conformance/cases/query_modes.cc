@@ -69,6 +69,23 @@ TEST_F(QueryModesTest, ProvidesBasicStatsInProfileMode) {
   EXPECT_EQ(1, stats.value().count("elapsed_time"));
 }
 
+TEST_F(QueryModesTest, ProvidesExecutionStatsInProfileMode) {
+  if (in_prod_env()) {
+    GTEST_SKIP() << "Cloud Spanner reports different execution stats.";
+  }
+  auto stats = client()
+                   .ProfileQuery(SqlStatement("select * from Users"))
+                   .ExecutionStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ("2", stats.value()["rows_scanned"]);
+  EXPECT_EQ(1, stats.value().count("bytes_returned"));
+  EXPECT_EQ(1, stats.value().count("cpu_time"));
+  EXPECT_EQ(1, stats.value().count("analyze_cpu_time"));
+  EXPECT_EQ(1, stats.value().count("prepare_cpu_time"));
+  EXPECT_EQ(1, stats.value().count("execute_cpu_time"));
+  EXPECT_THAT(stats.value()["table_scans"], testing::HasSubstr("Users"));
+}
+
 }  // namespace
 
 }  // namespace test
@@ -15,9 +15,11 @@
 //
 
 #include <array>
+#include <cstddef>
 #include <string>
 #include <vector>
 
+#include "zetasql/base/logging.h"
 #include "zetasql/public/value.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -87,7 +89,13 @@ class SchemaChangeTest
 
     // Reset the database used for this test.
     ZETASQL_RETURN_IF_ERROR(ResetDatabase());
+    return RunSchemaChangeTestCase(*database(), input);
+  }
 
+  // Runs a file-based schema change test case against a new database.
+  absl::StatusOr<FileBasedTestCaseOutput> RunSchemaChangeTestCase(
+      const cloud::spanner::Database& database,
+      const FileBasedTestCaseInput& input) {
     // Split the input into individual DDL statements.
     std::string text = input.text;
     absl::StripAsciiWhitespace(&text);
@@ -95,7 +103,7 @@ class SchemaChangeTest
         absl::StrSplit(text, ';', absl::SkipEmpty());
 
     // Run the update.
-    absl::Status status = UpdateSchema(input_statements).status();
+    absl::Status status = UpdateSchema(database, input_statements).status();
 
     // For the error case, we expect the error string to match.
     if (!status.ok()) {
@@ -113,7 +121,7 @@ class SchemaChangeTest
 
     // For the success case, we expect the output of GetDatabaseDdl to match.
     ZETASQL_ASSIGN_OR_RETURN(std::vector<std::string> output_statements,
-                     GetDatabaseDdl());
+                     GetDatabaseDdl(database));
     return FileBasedTestCaseOutput{
         .text = absl::StrJoin(output_statements, ";\n") + ";\n",
         .status_code = absl::StatusCode::kOk};
@@ -146,13 +154,14 @@ class SchemaChangeTest
   }
 };
 
-TEST_P(SchemaChangeTest, FileBasedTests) {
-  const auto& input = GetParam().input;
+// Checks the output of a file-based schema change test case.
+void ExpectSchemaChangeTestCaseOutput(const FileBasedTestCase& test_case,
+                                      const FileBasedTestCaseOutput& actual) {
+  const auto& input = test_case.input;
   const std::string input_line_message = absl::StrCat(
       "for input at line number ", input.line_no, ":\n", input.text);
-  const auto& expected = GetParam().expected;
+  const auto& expected = test_case.expected;
 
-  ZETASQL_ASSERT_OK_AND_ASSIGN(auto actual, RunSchemaChangeTestCase(input));
   ASSERT_TRUE(actual.status_code.has_value());
 
   std::string expected_text = expected.text;
@@ -184,6 +193,47 @@ TEST_P(SchemaChangeTest, FileBasedTests) {
   }
 }
 
+TEST_P(SchemaChangeTest, FileBasedTests) {
+  if (FileBasedTestWorkers() > 0) {
+    GTEST_SKIP() << "Run by FileBasedTestsInParallel";
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto actual,
+                       RunSchemaChangeTestCase(GetParam().input));
+  ExpectSchemaChangeTestCaseOutput(GetParam(), actual);
+}
+
+// Runs every file-based test case, each against a database of its own, on
+// --file_based_test_workers threads, and logs the time taken by each case.
+TEST_F(SchemaChangeTest, FileBasedTestsInParallel) {
+  if (FileBasedTestWorkers() == 0) {
+    GTEST_SKIP() << "Each case is run by FileBasedTests";
+  }
+  const std::vector<FileBasedTestCase> test_cases = GetAllTestCases();
+  const std::vector<FileBasedTestCaseResult> results = RunTestCasesInParallel(
+      test_cases, FileBasedTestWorkers(),
+      [this](const FileBasedTestCaseInput& input)
+          -> absl::StatusOr<FileBasedTestCaseOutput> {
+        ZETASQL_RET_CHECK(!input.text.empty())
+            << "Found empty schema change test case.";
+        ZETASQL_ASSIGN_OR_RETURN(cloud::spanner::Database database,
+                         CreateIsolatedDatabase());
+        absl::StatusOr<FileBasedTestCaseOutput> output =
+            RunSchemaChangeTestCase(database, input);
+        ZETASQL_RETURN_IF_ERROR(DropIsolatedDatabase(database));
+        return output;
+      });
+  for (size_t i = 0; i < test_cases.size(); ++i) {
+    SCOPED_TRACE(absl::StrCat(test_cases[i].input.file_name, ":",
+                              test_cases[i].input.line_no));
+    ZETASQL_EXPECT_OK(results[i].output.status());
+    if (results[i].output.ok()) {
+      ExpectSchemaChangeTestCaseOutput(test_cases[i], *results[i].output);
+    }
+  }
+  ZETASQL_LOG(INFO) << "Schema change test case timings (ms):\n"
+            << FormatTestCaseTimings(test_cases, results);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     FileBasedTest, SchemaChangeTest,
     testing::ValuesIn(SchemaChangeTest::GetAllTestCases()),
@@ -16,17 +16,26 @@
 
 #include "tests/conformance/common/database_test_base.h"
 
+#include <atomic>
 #include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "google/protobuf/empty.pb.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
 #include "google/cloud/spanner/admin/database_admin_client.h"
 #include "google/cloud/spanner/backoff_policy.h"
 #include "google/cloud/spanner/batch_dml_result.h"
@@ -38,8 +47,11 @@
 #include "google/cloud/spanner/transaction.h"
 #include "google/cloud/status_or.h"
 #include "common/constants.h"
+#include "frontend/proto/emulator_admin.pb.h"
 #include "tests/common/file_based_schema_reader.h"
 #include "tests/conformance/common/environment.h"
+#include "grpcpp/impl/client_unary_call.h"
+#include "grpcpp/impl/rpc_method.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -47,6 +59,60 @@ namespace spanner {
 namespace emulator {
 namespace test {
 
+namespace {
+
+// Databases whose schema was set up by an earlier test, which later tests
+// setting up the same schema take over after resetting their rows, instead of
+// creating the schema again.
+class DatabasePool {
+ public:
+  // Returns the ID of a pooled database set up with the schema of key, or an
+  // empty string if there is none.
+  std::string Take(const std::string& key) {
+    absl::MutexLock lock(&mu_);
+    auto it = databases_.find(key);
+    if (it == databases_.end() || it->second.empty()) {
+      return "";
+    }
+    std::string database_id = std::move(it->second.back());
+    it->second.pop_back();
+    return database_id;
+  }
+
+  // Returns database_id, set up with the schema of key, to the pool.
+  void Release(const std::string& key, std::string database_id) {
+    absl::MutexLock lock(&mu_);
+    databases_[key].push_back(std::move(database_id));
+  }
+
+ private:
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::string, std::vector<std::string>> databases_
+      ABSL_GUARDED_BY(mu_);
+};
+
+DatabasePool* GetDatabasePool() {
+  static DatabasePool* pool = new DatabasePool();
+  return pool;
+}
+
+// Returns the key of the pooled databases set up with schema, or an empty
+// string if they cannot be reused: resetting the rows of a database does not
+// rewind its change streams or sequences.
+std::string DatabasePoolKey(database_api::DatabaseDialect dialect,
+                            const std::vector<std::string>& schema) {
+  std::string key = absl::StrCat(database_api::DatabaseDialect_Name(dialect),
+                                 "\n", absl::StrJoin(schema, ";\n"));
+  const std::string lower_key = absl::AsciiStrToLower(key);
+  if (absl::StrContains(lower_key, "change stream") ||
+      absl::StrContains(lower_key, "sequence")) {
+    return "";
+  }
+  return key;
+}
+
+}  // namespace
+
 void DatabaseTest::SetUp() {
   // Get the global environment in which the test runs.
   const ConformanceTestGlobals& globals = GetConformanceTestGlobals();
@@ -95,23 +161,70 @@ void DatabaseTest::SetUp() {
                                              *globals.connection_options));
 
   // Setup stubs to access low-level API features not exposed by the C++ client.
-  std::shared_ptr<grpc::Channel> channel = grpc::CreateChannel(
+  channel_ = grpc::CreateChannel(
       globals.connection_options->get<google::cloud::EndpointOption>(),
       globals.connection_options->get<google::cloud::GrpcCredentialOption>());
-  spanner_stub_ = v1::Spanner::NewStub(channel);
+  spanner_stub_ = v1::Spanner::NewStub(channel_);
   database_admin_stub_ =
-      admin::database::v1::DatabaseAdmin::NewStub(channel);
-  operations_stub_ = longrunning::Operations::NewStub(channel);
+      admin::database::v1::DatabaseAdmin::NewStub(channel_);
+  operations_stub_ = longrunning::Operations::NewStub(channel_);
 
   // Allow test suites to customize the database at SetUp time.
+  setting_up_database_ = true;
   ZETASQL_ASSERT_OK(SetUpDatabase());
+  setting_up_database_ = false;
 }
 
 void DatabaseTest::TearDown() {
+  // The database goes back to the pool unless the test changed its schema.
+  if (!pool_key_.empty()) {
+    absl::StatusOr<std::vector<std::string>> ddl = GetDatabaseDdl();
+    if (ddl.ok() && *ddl == pooled_ddl_) {
+      GetDatabasePool()->Release(pool_key_, database_->database_id());
+      return;
+    }
+  }
   database_client_->DropDatabase(database_->FullName());
 }
 
+absl::Status DatabaseTest::TakePooledDatabase(const std::string& pool_key) {
+  const std::string database_id = GetDatabasePool()->Take(pool_key);
+  if (database_id.empty()) {
+    return absl::NotFoundError("No pooled database");
+  }
+  const ConformanceTestGlobals& globals = GetConformanceTestGlobals();
+  auto database = std::make_unique<google::cloud::spanner::Database>(
+      google::cloud::spanner::Instance(globals.project_id, globals.instance_id),
+      database_id);
+
+  // Rows left behind by the previous test are discarded. A database which
+  // cannot be reset, e.g. because a transaction of the previous test is still
+  // holding locks, is dropped instead.
+  grpc::ClientContext context;
+  frontend::ResetDatabaseRequest request;
+  request.set_database(database->FullName());
+  protobuf::Empty response;
+  absl::Status status = grpc::internal::BlockingUnaryCall(
+      channel_.get(),
+      grpc::internal::RpcMethod(
+          "/google.spanner.emulator.frontend.EmulatorAdmin/ResetDatabase",
+          grpc::internal::RpcMethod::NORMAL_RPC),
+      &context, request, &response);
+  if (!status.ok()) {
+    database_client_->DropDatabase(database->FullName());
+    return status;
+  }
+
+  database_client_->DropDatabase(database_->FullName());
+  database_ = std::move(database);
+  client_ = std::make_unique<cloud::spanner::Client>(
+      google::cloud::spanner::MakeConnection(*database_,
+                                             *globals.connection_options));
+  return absl::OkStatus();
+}
+
 absl::Status DatabaseTest::ResetDatabase() {
+  pool_key_.clear();
   const ConformanceTestGlobals& globals = GetConformanceTestGlobals();
   ZETASQL_RETURN_IF_ERROR(
       ToUtilStatus(database_client_->DropDatabase(database_->FullName())));
@@ -127,6 +240,23 @@ absl::Status DatabaseTest::ResetDatabase() {
 }
 
 absl::Status DatabaseTest::SetSchema(const std::vector<std::string>& schema) {
+  // Only the first schema set up for a new database decides its pool, and only
+  // the emulator can reset the rows of a database.
+  const bool first_schema = setting_up_database_ && !schema_set_;
+  schema_set_ = true;
+  pool_key_.clear();
+  if (first_schema && !in_prod_env()) {
+    const std::string pool_key = DatabasePoolKey(dialect_, schema);
+    if (!pool_key.empty()) {
+      if (!TakePooledDatabase(pool_key).ok()) {
+        ZETASQL_RETURN_IF_ERROR(UpdateSchema(schema).status());
+      }
+      ZETASQL_ASSIGN_OR_RETURN(pooled_ddl_, GetDatabaseDdl());
+      pool_key_ = pool_key;
+      return absl::OkStatus();
+    }
+  }
+
   auto status_or =
       database_client_->UpdateDatabaseDdl(database_->FullName(), schema).get();
   if (!status_or.ok()) {
@@ -153,16 +283,50 @@ absl::Status DatabaseTest::SetSchemaFromFile(const std::string& file_name) {
 
 absl::StatusOr<DatabaseTest::UpdateDatabaseDdlMetadata>
 DatabaseTest::UpdateSchema(const std::vector<std::string>& schema) {
+  return UpdateSchema(*database_, schema);
+}
+
+absl::StatusOr<std::vector<std::string>> DatabaseTest::GetDatabaseDdl() const {
+  return GetDatabaseDdl(*database_);
+}
+
+absl::StatusOr<cloud::spanner::Database>
+DatabaseTest::CreateIsolatedDatabase() {
+  static std::atomic<int64_t> next_database = 0;
+  const ConformanceTestGlobals& globals = GetConformanceTestGlobals();
+  cloud::spanner::Database database(
+      google::cloud::spanner::Instance(globals.project_id, globals.instance_id),
+      absl::StrCat("test-database-", absl::ToUnixMicros(absl::Now()), "-",
+                   next_database++));
+  google::spanner::admin::database::v1::CreateDatabaseRequest request;
+  request.set_parent(database.instance().FullName());
+  std::string quote = kGSQLQuote;
+  request.set_create_statement("CREATE DATABASE " + quote +
+                               database.database_id() + quote);
+  ZETASQL_RETURN_IF_ERROR(
+      ToUtilStatus(database_client_->CreateDatabase(request).get().status()));
+  return database;
+}
+
+absl::Status DatabaseTest::DropIsolatedDatabase(
+    const cloud::spanner::Database& database) {
+  return ToUtilStatus(database_client_->DropDatabase(database.FullName()));
+}
+
+absl::StatusOr<DatabaseTest::UpdateDatabaseDdlMetadata>
+DatabaseTest::UpdateSchema(const cloud::spanner::Database& database,
+                           const std::vector<std::string>& schema) {
   auto status_or =
-      database_client_->UpdateDatabaseDdl(database_->FullName(), schema).get();
+      database_client_->UpdateDatabaseDdl(database.FullName(), schema).get();
   if (!status_or.ok()) {
     return ToUtilStatus(status_or.status());
   }
   return status_or.value();
 }
 
-absl::StatusOr<std::vector<std::string>> DatabaseTest::GetDatabaseDdl() const {
-  auto status_or = database_client_->GetDatabaseDdl(database_->FullName());
+absl::StatusOr<std::vector<std::string>> DatabaseTest::GetDatabaseDdl(
+    const cloud::spanner::Database& database) const {
+  auto status_or = database_client_->GetDatabaseDdl(database.FullName());
   if (!status_or.ok()) {
     return ToUtilStatus(status_or.status());
   }
@@ -51,6 +51,7 @@
 #include "google/cloud/spanner/value.h"
 #include "frontend/server/server.h"
 #include "tests/conformance/common/environment.h"
+#include "grpcpp/channel.h"
 #include "grpcpp/client_context.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
@@ -73,6 +74,11 @@ const char kSchemaTestDataDir[] = "tests/conformance/data/schemas";
 // are defined within this fixture to reduce the boilerplate required to write
 // the conformance tests.
 //
+// On the emulator, a database whose schema is set up by SetSchema during
+// SetUpDatabase is kept after the test, unless the test changed its schema,
+// and is reused by later tests setting up the same schema once its rows have
+// been reset, which is much faster than setting up the schema again.
+//
 // This fixture is intended to work with all Cloud Spanner environments -
 // emulator, test env, and production.
 //
@@ -209,6 +215,21 @@ class DatabaseTest : public ::testing::Test {
   // Returns the DDL for the database.
   absl::StatusOr<std::vector<std::string>> GetDatabaseDdl() const;
 
+  // Creates a new database in the instance of this test, apart from the
+  // database of the test, e.g. to run file-based test cases concurrently. The
+  // caller is responsible for dropping it with DropIsolatedDatabase. These
+  // methods, and the overloads below taking a database, are thread-safe.
+  absl::StatusOr<cloud::spanner::Database> CreateIsolatedDatabase();
+  absl::Status DropIsolatedDatabase(const cloud::spanner::Database& database);
+
+  // Overloads of UpdateSchema and GetDatabaseDdl for a database created by
+  // CreateIsolatedDatabase.
+  absl::StatusOr<UpdateDatabaseDdlMetadata> UpdateSchema(
+      const cloud::spanner::Database& database,
+      const std::vector<std::string>& schema);
+  absl::StatusOr<std::vector<std::string>> GetDatabaseDdl(
+      const cloud::spanner::Database& database) const;
+
   // Provides read-only access to the database object for the test.
   const cloud::spanner::Database* database() { return database_.get(); }
 
@@ -691,6 +712,10 @@ class DatabaseTest : public ::testing::Test {
       database_api::DatabaseDialect::GOOGLE_STANDARD_SQL;
 
  private:
+  // Takes over a pooled database set up with the schema of pool_key, resetting
+  // its rows, in place of the new database created for this test.
+  absl::Status TakePooledDatabase(const std::string& pool_key);
+
   // The database used in this test (a new one is created for each test case).
   std::unique_ptr<cloud::spanner::Database> database_;
 
@@ -708,6 +733,19 @@ class DatabaseTest : public ::testing::Test {
   std::unique_ptr<DatabaseAdminStub> database_admin_stub_;
 
   std::unique_ptr<OperationsStub> operations_stub_;
+
+  // Channel of the stubs above.
+  std::shared_ptr<grpc::Channel> channel_;
+
+  // Whether SetUpDatabase is running, and whether a schema was set on the
+  // database since it was created.
+  bool setting_up_database_ = false;
+  bool schema_set_ = false;
+
+  // Key of the database pool the database is returned to after the test, or
+  // empty if it is dropped, and its schema when it was set up.
+  std::string pool_key_;
+  std::vector<std::string> pooled_ddl_;
 };
 
 }  // namespace test